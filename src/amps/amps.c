@@ -246,7 +246,7 @@ void amps_number2min(const char *number, uint32_t *min1, uint16_t *min2)
  */
 const char *amps_min22number(uint16_t min2)
 {
-	static char number[4];
+	static __thread char number[4];
 
 	/* MIN2 */
 	if (min2 > 999)
@@ -263,7 +263,7 @@ const char *amps_min22number(uint16_t min2)
 
 const char *amps_min12number(uint32_t min1)
 {
-	static char number[8];
+	static __thread char number[8];
 
 	if (!tacs) {
 		/* MIN1 (amps) */
@@ -311,13 +311,34 @@ const char *amps_min12number(uint32_t min1)
 	return number;
 }
 
+/* converted numbers are cached, because every received word and every
+ * transaction lookup converts MIN1/MIN2 for logging and call control */
+#define MIN_CACHE_SIZE	256	/* must be power of 2 */
+static struct min_cache {
+	int		valid;
+	uint32_t	min1;
+	uint16_t	min2;
+	char		number[11];
+} min_cache[MIN_CACHE_SIZE];
+
 const char *amps_min2number(uint32_t min1, uint16_t min2)
 {
-	static char number[11];
-
-	sprintf(number, "%s%s", amps_min22number(min2), amps_min12number(min1));
-
-	return number;
+	struct min_cache *entry;
+	uint32_t x = min1 ^ ((uint32_t)min2 * 0x9e3779b1u);
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	entry = &min_cache[x & (MIN_CACHE_SIZE - 1)];
+	if (entry->valid && entry->min1 == min1 && entry->min2 == min2)
+		return entry->number;
+
+	sprintf(entry->number, "%s%s", amps_min22number(min2), amps_min12number(min1));
+	entry->min1 = min1;
+	entry->min2 = min2;
+	entry->valid = 1;
+
+	return entry->number;
 }
 
 /* encode ESN */
@@ -335,7 +356,7 @@ void amps_decode_esn(uint32_t esn, uint8_t *mfr, uint32_t *serial)
 
 const char *amps_scm(uint8_t scm)
 {
-	static char text[64];
+	static __thread char text[64];
 
 	sprintf(text, "Class %d / %sontinuous / %d MHz", ((scm & 16) >> 2) + (scm & 3) + 1, (scm & 4) ? "Disc" : "C", (scm & 8) ? 25 : 20);
 
@@ -361,7 +382,7 @@ static const char *amps_mpci(uint8_t mpci)
 
 static const char *amps_state_name(enum amps_state state)
 {
-	static char invalid[16];
+	static __thread char invalid[16];
 
 	switch (state) {
 	case STATE_NULL:
@@ -398,9 +419,13 @@ static void amps_new_state(amps_t *amps, enum amps_state new_state)
 		return;
 	LOGP_CHAN(DAMPS, LOGL_DEBUG, "State change: %s -> %s\n", amps_state_name(amps->state), amps_state_name(new_state));
 	amps->state = new_state;
+	chan_alloc_set_idle(&amps->sender, new_state == STATE_IDLE);
 	amps_display_status();
 }
 
+/* idle voice channels, combined CC/PC/VC are the second alternative */
+static chan_list_t vc_list, cc_pc_vc_list;
+
 static struct amps_channels {
 	enum amps_chan_type chan_type;
 	const char *short_name;
@@ -481,21 +506,14 @@ static amps_t *search_channel(int channel)
 static amps_t *search_free_vc(void)
 {
 	sender_t *sender;
-	amps_t *amps, *cc_pc_vc = NULL;
 
-	for (sender = sender_head; sender; sender = sender->next) {
-		amps = (amps_t *) sender;
-		if (amps->state != STATE_IDLE)
-			continue;
-		/* return first free voice channel */
-		if (amps->chan_type == CHAN_TYPE_VC)
-			return amps;
-		/* remember combined voice/control/paging channel as second alternative */
-		if (amps->chan_type == CHAN_TYPE_CC_PC_VC)
-			cc_pc_vc = amps;
-	}
+	if ((sender = chan_alloc(&vc_list)))
+		return (amps_t *) sender;
+	/* combined voice/control/paging channel is the second alternative */
+	if ((sender = chan_alloc(&cc_pc_vc_list)))
+		return (amps_t *) sender;
 
-	return cc_pc_vc;
+	return NULL;
 }
 
 static amps_t *search_pc(void)
@@ -604,6 +622,14 @@ int amps_create(const char *kanal, enum amps_chan_type chan_type, const char *de
 	}
 
 	amps->chan_type = chan_type;
+	/* voice channels are allocated from lists */
+	if (chan_type == CHAN_TYPE_VC || chan_type == CHAN_TYPE_CC_PC_VC) {
+		rc = chan_list_add((chan_type == CHAN_TYPE_CC_PC_VC) ? &cc_pc_vc_list : &vc_list, &amps->sender, amps->state == STATE_IDLE);
+		if (rc < 0)
+			goto error;
+	}
+	/* control channels must be demodulated, even if no signal is received */
+	amps->sender.rx_always_on = (chan_type != CHAN_TYPE_VC);
 	memcpy(&amps->si, si, sizeof(amps->si));
 	amps->sat = sat;
 	amps->send_callerid = send_callerid;
@@ -660,6 +686,7 @@ void amps_destroy(sender_t *sender)
 	}
 
 	dsp_cleanup_sender(amps);
+	chan_list_remove(&amps->sender);
 	sender_destroy(&amps->sender);
 	free(amps);
 }
@@ -709,7 +736,7 @@ static void amps_release(transaction_t *trans, uint8_t cause)
 	/* release towards call control */
 	if (trans->callref) {
 		call_up_release(trans->callref, cause);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 	}
 	/* change DSP mode to transmit release */
 	if (amps->dsp_mode == DSP_MODE_AUDIO_RX_AUDIO_TX || amps->dsp_mode == DSP_MODE_AUDIO_RX_SILENCE_TX || amps->dsp_mode == DSP_MODE_OFF)
@@ -930,7 +957,6 @@ reject:
 /* Call control starts call towards mobile station. */
 int call_down_setup(int callref, const char __attribute__((unused)) *caller_id, enum number_type __attribute__((unused)) caller_type, const char *dialing)
 {
-	sender_t *sender;
 	amps_t *amps;
 	transaction_t *trans;
 	uint32_t min1;
@@ -946,14 +972,8 @@ int call_down_setup(int callref, const char __attribute__((unused)) *caller_id,
 //	}
 
 	/* 3. check if given number is already in a call, return BUSY */
-	for (sender = sender_head; sender; sender = sender->next) {
-		amps = (amps_t *) sender;
-		/* search transaction for this number */
-		trans = search_transaction_number(amps, min1, min2);
-		if (trans)
-			break;
-	}
-	if (sender) {
+	trans = search_transaction_number_global(min1, min2);
+	if (trans) {
 		LOGP(DAMPS, LOGL_NOTICE, "Outgoing call to busy number, rejecting!\n");
 		return -CAUSE_BUSY;
 	}
@@ -979,7 +999,7 @@ int call_down_setup(int callref, const char __attribute__((unused)) *caller_id,
 		LOGP(DAMPS, LOGL_ERROR, "Failed to create transaction\n");
 		return -CAUSE_TEMPFAIL;
 	}
-	trans->callref = callref;
+	trans_set_callref(trans, callref);
 	trans->page_retry = 1;
 	if (caller_type == TYPE_INTERNATIONAL) {
 		trans->caller_id[0] = '+';
@@ -1000,24 +1020,19 @@ void call_down_answer(int __attribute__((unused)) callref, struct timeval __attr
  */
 void call_down_disconnect(int callref, int cause)
 {
-	sender_t *sender;
 	amps_t *amps;
 	transaction_t *trans;
 
 	LOGP(DAMPS, LOGL_INFO, "Call has been disconnected by network.\n");
 
-	for (sender = sender_head; sender; sender = sender->next) {
-		amps = (amps_t *) sender;
-		/* search transaction for this callref */
-		trans = search_transaction_callref(amps, callref);
-		if (trans)
-			break;
-	}
-	if (!sender) {
+	/* search transaction for this callref */
+	trans = search_transaction_callref_global(callref);
+	if (!trans) {
 		LOGP(DAMPS, LOGL_NOTICE, "Outgoing disconnect, but no callref!\n");
 		call_up_release(callref, CAUSE_INVALCALLREF);
 		return;
 	}
+	amps = trans->amps;
 
 	/* Release when not active */
 
@@ -1036,7 +1051,7 @@ void call_down_disconnect(int callref, int cause)
 	default:
 		LOGP_CHAN(DAMPS, LOGL_INFO, "Call control disconnects on control channel, removing transaction.\n");
 		call_up_release(callref, cause);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		destroy_transaction(trans);
 		amps_go_idle(amps);
 	}
@@ -1045,26 +1060,21 @@ void call_down_disconnect(int callref, int cause)
 /* Call control releases call toward mobile station. */
 void call_down_release(int callref, int cause)
 {
-	sender_t *sender;
 	amps_t *amps;
 	transaction_t *trans;
 
 	LOGP(DAMPS, LOGL_INFO, "Call has been released by network, releasing call.\n");
 
-	for (sender = sender_head; sender; sender = sender->next) {
-		amps = (amps_t *) sender;
-		/* search transaction for this callref */
-		trans = search_transaction_callref(amps, callref);
-		if (trans)
-			break;
-	}
-	if (!sender) {
+	/* search transaction for this callref */
+	trans = search_transaction_callref_global(callref);
+	if (!trans) {
 		LOGP(DAMPS, LOGL_NOTICE, "Outgoing release, but no callref!\n");
 		/* don't send release, because caller already released */
 		return;
 	}
+	amps = trans->amps;
 
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 
 	switch (amps->dsp_mode) {
 	case DSP_MODE_AUDIO_RX_SILENCE_TX:
@@ -1166,7 +1176,7 @@ static amps_t *assign_voice_channel(transaction_t *trans)
 		sprintf(esn_text, "%u", trans->esn);
 		/* setup call */
 		LOGP(DAMPS, LOGL_INFO, "Setup call to network.\n");
-		trans->callref = call_up_setup(callerid, trans->dialing, OSMO_CC_NETWORK_AMPS_ESN, esn_text);
+		trans_set_callref(trans, call_up_setup(callerid, trans->dialing, OSMO_CC_NETWORK_AMPS_ESN, esn_text));
 	}
 
 	return vc;
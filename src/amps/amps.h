@@ -1,4 +1,5 @@
 #include "../libgoertzel/goertzel.h"
+#include "../libfsk/fsk.h"
 #include "../libmobile/sender.h"
 #include <osmocom/core/timer.h>
 #include "../libcompandor/compandor.h"
@@ -99,14 +100,9 @@ struct amps {
 	/* the ex buffer holds the duration of one bit, and wraps every
 	 * bit. */
 	double			fsk_rx_bitcount;	/* counts the bit. if it reaches or exceeds 1, the bit is complete and the next bit starts */
-	sample_t		*fsk_rx_window;		/* rx buffer for one bit */
-	int			fsk_rx_window_length;	/* length of rx buffer */
-	int			fsk_rx_window_half;	/* half of length of rx buffer */
-	int			fsk_rx_window_begin;	/* where to begin detecting level */
-	int			fsk_rx_window_end;	/* where to end detecting level */
-	int			fsk_rx_window_pos;	/* current position in buffer */
+	fsk_manchester_t	fsk_rx_window;		/* rx window for one bit */
 	/* the rx buffer received one frame until rx length */
-	char			fsk_rx_frame[FSK_MAX_BITS + 1];	/* +1 because 0-termination */
+	uint8_t			fsk_rx_frame[FSK_MAX_BITS / 8 + 8]; /* packed MSB first, spare bytes to read 64 bits at the end */
 	int			fsk_rx_frame_length;	/* length of expected frame */
 	int			fsk_rx_frame_count;	/* count number of received bit */
 	double			fsk_rx_frame_level;	/* sum of level of all bits */
@@ -136,6 +132,10 @@ struct amps {
 	int			tx_focc_word_count;	/* counts transmitted words in a multi word message */
 	int			tx_focc_word_repeat;	/* counts repeats of multi word message */
 	int			tx_focc_debugged;	/* indicator to prevent debugging all SI/filler frames */
+	amps_si			tx_focc_cache_si;	/* system information that cached frames are encoded with */
+	uint32_t		tx_focc_cache_regid;	/* registration ID that cached frame is encoded with */
+	int			tx_focc_cache_valid[SYSINFO_TRAIN_MAX + 1];
+	char			tx_focc_cache[SYSINFO_TRAIN_MAX + 1][463 + 1]; /* encoded frames of train and filler (last) */
 	/* FVC frame states */
 	int			tx_fvc_send;		/* if set, send message words */
 	int			tx_fvc_chan;		/* channel to assign for voice call */
@@ -151,7 +151,7 @@ struct amps {
 	/* SAT tone */
 	int			sat;			/* use SAT tone 0..2 */
 	int			sat_samples;		/* number of samples in buffer for supervisory detection */
-	goertzel_t		sat_goertzel[5];	/* filter for SAT signal decoding */
+	goertzel_t		sat_goertzel[3];	/* filter for SAT, noise floor and signaling tone */
 	sample_t		*sat_filter_spl;	/* array with sample buffer for supervisory detection */
 	int			sat_filter_pos;		/* current sample position in filter_spl */
 	double			sat_phaseshift65536[3];	/* how much the phase of sine wave changes per sample */
@@ -4,7 +4,7 @@
 
 void numbering(const char *number, const char __attribute__((unused)) **carrier, const char **country, const char **national_number)
 {
-	static char digits[64];
+	static __thread char digits[64];
 
 	*country = "USA";
 	strcpy(digits, "1");
@@ -128,7 +128,10 @@
 #define BEST_QUALITY		0.68	/* Best possible RX quality */
 #define COMFORT_NOISE		0.02	/* audio level of comfort noise (relative to speech level) */
 
+/* ramp and SAT tables do not depend on the sample rate, so they are shared by
+ * all transceivers. they are generated when the first transceiver needs them */
 static sample_t ramp_up[256], ramp_down[256];
+static int ramp_valid = 0;
 
 static double sat_freq[4] = {
 	5970.0,
@@ -137,7 +140,7 @@ static double sat_freq[4] = {
 	5790.0, /* noise level to check against */
 };
 
-static sample_t dsp_sine_sat[65536];
+static sample_t *dsp_sine_sat = NULL;
 
 static uint8_t dsp_sync_check[0x800];
 
@@ -145,13 +148,6 @@ static uint8_t dsp_sync_check[0x800];
 void dsp_init(void)
 {
 	int i;
-	double s;
-
-	LOGP(DDSP, LOGL_DEBUG, "Generating sine table for SAT signal.\n");
-	for (i = 0; i < 65536; i++) {
-		s = sin((double)i / 65536.0 * 2.0 * PI);
-		dsp_sine_sat[i] = s * ((!tacs) ? AMPS_SAT_DEVIATION : TACS_SAT_DEVIATION);
-	}
 
 	/* sync checker */
 	for (i = 0; i < 0x800; i++) {
@@ -167,11 +163,39 @@ void dsp_init(void)
 	compandor_init();
 }
 
+/* SAT is only transmitted on voice channels */
+static int dsp_init_sat(void)
+{
+	double s;
+	int i;
+
+	if (dsp_sine_sat)
+		return 0;
+
+	dsp_sine_sat = malloc(sizeof(*dsp_sine_sat) * 65536);
+	if (!dsp_sine_sat) {
+		LOGP(DDSP, LOGL_ERROR, "No memory!\n");
+		return -ENOMEM;
+	}
+
+	LOGP(DDSP, LOGL_DEBUG, "Generating sine table for SAT signal.\n");
+	for (i = 0; i < 65536; i++) {
+		s = sin((double)i / 65536.0 * 2.0 * PI);
+		dsp_sine_sat[i] = s * ((!tacs) ? AMPS_SAT_DEVIATION : TACS_SAT_DEVIATION);
+	}
+
+	return 0;
+}
+
 static void dsp_init_ramp(amps_t *amps)
 {
 	double c;
         int i;
 
+	if (ramp_valid)
+		return;
+	ramp_valid = 1;
+
 	LOGP(DDSP, LOGL_DEBUG, "Generating smooth ramp table.\n");
 	for (i = 0; i < 256; i++) {
 		c = cos((double)i / 256.0 * PI);
@@ -188,19 +212,26 @@ static void dsp_init_ramp(amps_t *amps)
 
 static void sat_reset(amps_t *amps, const char *reason);
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init FSK of transceiver */
 int dsp_init_sender(amps_t *amps, int tolerant)
 {
 	sample_t *spl;
 	int i;
 	int rc;
-	int half;
+	int length, half;
 
 	/* attack (3ms) and recovery time (13.5ms) according to amps specs */
 	setup_compandor(&amps->cstate, 8000, 3.0, 13.5);
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for transceiver.\n");
 
+	/* protocol of this channel */
+	amps->sender.send = send_audio;
+	amps->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	sender_set_fm(&amps->sender,
 		(!tacs) ? AMPS_MAX_DEVIATION : TACS_MAX_DEVIATION,
@@ -226,21 +257,14 @@ int dsp_init_sender(amps_t *amps, int tolerant)
 	}
 	amps->fsk_tx_buffer = spl;
 
-	amps->fsk_rx_window_length = ceil(amps->fsk_bitduration); /* buffer holds one bit (rounded up) */
-	half = amps->fsk_rx_window_length >> 1;
-	amps->fsk_rx_window_begin = half >> 1;
-	amps->fsk_rx_window_half = half;
-	amps->fsk_rx_window_end = amps->fsk_rx_window_length - (half >> 1);
-	LOGP(DDSP, LOGL_DEBUG, "Bit window length: %d\n", amps->fsk_rx_window_length);
-	LOGP(DDSP, LOGL_DEBUG, " -> Samples in window to analyse level left of edge: %d..%d\n", amps->fsk_rx_window_begin, amps->fsk_rx_window_half - 1);
-	LOGP(DDSP, LOGL_DEBUG, " -> Samples in window to analyse level right of edge: %d..%d\n", amps->fsk_rx_window_half, amps->fsk_rx_window_end - 1);
-	spl = calloc(sizeof(*amps->fsk_rx_window), amps->fsk_rx_window_length);
-	if (!spl) {
-		LOGP(DDSP, LOGL_ERROR, "No memory!\n");
-		rc = -ENOMEM;
+	length = ceil(amps->fsk_bitduration); /* window holds one bit (rounded up) */
+	half = length >> 1;
+	LOGP(DDSP, LOGL_DEBUG, "Bit window length: %d\n", length);
+	LOGP(DDSP, LOGL_DEBUG, " -> Samples in window to analyse level left of edge: %d..%d\n", half >> 1, half - 1);
+	LOGP(DDSP, LOGL_DEBUG, " -> Samples in window to analyse level right of edge: %d..%d\n", half, length - (half >> 1) - 1);
+	rc = fsk_manchester_init(&amps->fsk_rx_window, length, half >> 1, half, length - (half >> 1));
+	if (rc < 0)
 		goto error;
-	}
-	amps->fsk_rx_window = spl;
 
 	/* create deviation and ramp */
 	amps->fsk_deviation = (!tacs) ? AMPS_FSK_DEVIATION : TACS_FSK_DEVIATION;
@@ -251,22 +275,27 @@ int dsp_init_sender(amps_t *amps, int tolerant)
 	 * we half our bandwidth, so that other supervisory signals will be canceled out completely by goertzel filter
 	 */
 	amps->sat_samples = (int)((double)amps->sender.samplerate * (1.0 / (SAT_BANDWIDTH / 2.0)) + 0.5);
-	spl = calloc(sizeof(*spl), amps->sat_samples);
-	if (!spl) {
-		LOGP(DDSP, LOGL_ERROR, "No memory!\n");
-		return -ENOMEM;
-	}
 	LOGP(DDSP, LOGL_DEBUG, "Sat detection interval is %d ms.\n", amps->sat_samples * 1000 / amps->sender.samplerate);
-	amps->sat_filter_spl = spl;
+	if (amps->chan_type == CHAN_TYPE_VC || amps->chan_type == CHAN_TYPE_CC_PC_VC) {
+		spl = calloc(sizeof(*spl), amps->sat_samples);
+		if (!spl) {
+			LOGP(DDSP, LOGL_ERROR, "No memory!\n");
+			rc = -ENOMEM;
+			goto error;
+		}
+		amps->sat_filter_spl = spl;
+		rc = dsp_init_sat();
+		if (rc < 0)
+			goto error;
+	}
 
 	/* count SAT tones */
-	for (i = 0; i < 4; i++) {
-		audio_goertzel_init(&amps->sat_goertzel[i], sat_freq[i], amps->sender.samplerate);
-		if (i < 3)
-			amps->sat_phaseshift65536[i] = 65536.0 / ((double)amps->sender.samplerate / sat_freq[i]);
-	}
-	/* signaling tone */
-	audio_goertzel_init(&amps->sat_goertzel[4], (!tacs) ? 10000.0 : 8000.0, amps->sender.samplerate);
+	for (i = 0; i < 3; i++)
+		amps->sat_phaseshift65536[i] = 65536.0 / ((double)amps->sender.samplerate / sat_freq[i]);
+	/* filter our SAT tone, noise floor and signaling tone, so all are filtered in one pass */
+	audio_goertzel_init(&amps->sat_goertzel[0], sat_freq[amps->sat], amps->sender.samplerate);
+	audio_goertzel_init(&amps->sat_goertzel[1], sat_freq[3], amps->sender.samplerate);
+	audio_goertzel_init(&amps->sat_goertzel[2], (!tacs) ? 10000.0 : 8000.0, amps->sender.samplerate);
 	sat_reset(amps, "Initial state");
 
 	/* be more tolerant when syncing */
@@ -279,6 +308,8 @@ int dsp_init_sender(amps_t *amps, int tolerant)
 		amps->dmp_sat_quality = display_measurements_add(&amps->sender.dispmeas, "SAT Quality", "%.1f %%", DISPLAY_MEAS_AVG, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 	}
 
+	sender_account_dsp(&amps->sender, sizeof(*amps) - sizeof(amps->sender) + sizeof(sample_t) * (amps->fsk_tx_buffer_size + ((amps->sat_filter_spl) ? amps->sat_samples : 0)));
+
 	return 0;
 
 error:
@@ -294,8 +325,7 @@ void dsp_cleanup_sender(amps_t *amps)
 
 	if (amps->fsk_tx_buffer)
 		free(amps->fsk_tx_buffer);
-	if (amps->fsk_rx_window)
-		free(amps->fsk_rx_window);
+	fsk_manchester_cleanup(&amps->fsk_rx_window);
 	if (amps->sat_filter_spl) {
 		free(amps->sat_filter_spl);
 		amps->sat_filter_spl = NULL;
@@ -474,7 +504,7 @@ static void sat_encode(amps_t *amps, sample_t *samples, int length)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	amps_t *amps = (amps_t *) sender;
 	int count, input_num;
@@ -522,46 +552,16 @@ again:
 	}
 }
 
-static void fsk_rx_bit(amps_t *amps, sample_t *spl, int len, int pos, int begin, int half, int end)
+static void fsk_rx_bit(amps_t *amps)
 {
-	int i;
 	double first, second;
 	int bit;
-	double max = 0, min = 0;
+	sample_t max, min;
 
 	/* decode one bit. subtract the first half from the second half.
 	 * the result shows the direction of the bit change: 1 == positive.
 	 */
-	pos -= begin; /* possible wrap is handled below */
-	second = first = 0;
-	for (i = begin; i < half; i++) {
-		if (--pos < 0)
-			pos += len;
-//printf("second %d: %d\n", pos, spl[pos]);
-		second += spl[pos];
-		if (i == 0 || spl[pos] > max)
-			max = spl[pos];
-		if (i == 0 || spl[pos] < min)
-			min = spl[pos];
-	}
-	second /= (half - begin);
-	for (i = half; i < end; i++) {
-		if (--pos < 0)
-			pos += len;
-//printf("first %d: %d\n", pos, spl[pos]);
-		first += spl[pos];
-		if (spl[pos] > max)
-			max = spl[pos];
-		if (spl[pos] < min)
-			min = spl[pos];
-	}
-	first /= (end - half);
-//printf("first = %d second = %d\n", first, second);
-	/* get bit */
-	if (second > first)
-		bit = 1;
-	else
-		bit = 0;
+	bit = fsk_manchester_bit(&amps->fsk_rx_window, &first, &second, &min, &max);
 #ifdef DEBUG_DECODER
 	if (amps->fsk_rx_sync != FSK_SYNC_POSITIVE && amps->fsk_rx_sync != FSK_SYNC_NEGATIVE)
 		printf("Decoded bit as %d (dotting life = %d)\n", bit, amps->fsk_rx_dotting_life);
@@ -584,6 +584,7 @@ static void fsk_rx_bit(amps_t *amps, sample_t *spl, int len, int pos, int begin,
 			amps->fsk_rx_sync = FSK_SYNC_POSITIVE;
 prepare_frame:
 			amps->fsk_rx_frame_count = 0;
+			memset(amps->fsk_rx_frame, 0, sizeof(amps->fsk_rx_frame));
 			amps->fsk_rx_frame_quality = 0.0;
 			amps->fsk_rx_frame_level = 0.0;
 			amps->fsk_rx_sync_register = 0x555;
@@ -625,11 +626,12 @@ prepare_frame:
 		bit = 1 - bit;
 
 	/* read next bit. after all bits, we reset to FSK_SYNC_NONE */
-	amps->fsk_rx_frame[amps->fsk_rx_frame_count++] = bit + '0';
-	if (amps->fsk_rx_frame_count > FSK_MAX_BITS) {
+	if (amps->fsk_rx_frame_count == FSK_MAX_BITS) {
 		fprintf(stderr, "our fsk_tx_count (%d) is larger than our max bits we can handle, please fix!\n", amps->fsk_rx_frame_count);
 		abort();
 	}
+	amps->fsk_rx_frame[amps->fsk_rx_frame_count >> 3] |= bit << (7 - (amps->fsk_rx_frame_count & 7));
+	amps->fsk_rx_frame_count++;
 	if (amps->fsk_rx_frame_count == amps->fsk_rx_frame_length) {
 		int more;
 
@@ -638,7 +640,6 @@ prepare_frame:
 		display_measurements_update(amps->dmp_frame_quality, amps->fsk_rx_frame_quality / (double)amps->fsk_rx_frame_count * 100.0, 0.0);
 
 		/* a complete frame was received, so we process it */
-		amps->fsk_rx_frame[amps->fsk_rx_frame_count] = '\0';
 		more = amps_decode_frame(amps, amps->fsk_rx_frame, amps->fsk_rx_frame_count, amps->fsk_rx_frame_level / (double)amps->fsk_rx_frame_count, amps->fsk_rx_frame_quality / amps->fsk_rx_frame_level, (amps->fsk_rx_sync == FSK_SYNC_NEGATIVE));
 		if (more) {
 			/* switch to next word length without DCC included */
@@ -715,9 +716,7 @@ static void sender_receive_frame(amps_t *amps, sample_t *samples, int length)
 		puts(debug_amplitude(samples[i] / (double)FSK_DEVIATION));
 #endif
 		/* push sample to detection window and shift */
-		amps->fsk_rx_window[amps->fsk_rx_window_pos++] = samples[i];
-		if (amps->fsk_rx_window_pos == amps->fsk_rx_window_length)
-			amps->fsk_rx_window_pos = 0;
+		fsk_manchester_push(&amps->fsk_rx_window, samples[i]);
 		if (amps->fsk_rx_sync != FSK_SYNC_POSITIVE && amps->fsk_rx_sync != FSK_SYNC_NEGATIVE) {
 			/* check for change in polarity */
 			if (amps->fsk_rx_last_sample <= 0) {
@@ -739,13 +738,7 @@ static void sender_receive_frame(amps_t *amps, sample_t *samples, int length)
 			amps->fsk_rx_bitcount += amps->fsk_bitstep;
 			if (amps->fsk_rx_bitcount >= 1.0) {
 				amps->fsk_rx_bitcount -= 1.0;
-				fsk_rx_bit(amps,
-					amps->fsk_rx_window,
-					amps->fsk_rx_window_length,
-					amps->fsk_rx_window_pos,
-					amps->fsk_rx_window_begin,
-					amps->fsk_rx_window_half,
-					amps->fsk_rx_window_end);
+				fsk_rx_bit(amps);
 			}
 		}
 	}
@@ -758,9 +751,7 @@ static void sat_decode(amps_t *amps, sample_t *samples, int length)
 {
 	double result[3], sat_quality, sig_quality, sat_level, sig_level;
 
-	audio_goertzel(&amps->sat_goertzel[amps->sat], samples, length, 0, &result[0], 1);
-	audio_goertzel(&amps->sat_goertzel[3], samples, length, 0, &result[1], 1);
-	audio_goertzel(&amps->sat_goertzel[4], samples, length, 0, &result[2], 1);
+	audio_goertzel(amps->sat_goertzel, samples, length, 0, result, 3);
 
 	/* normalize sat level and signaling tone level */
 	sat_level = result[0] / ((!tacs) ? AMPS_SAT_DEVIATION : TACS_SAT_DEVIATION);
@@ -785,7 +776,7 @@ static void sat_decode(amps_t *amps, sample_t *samples, int length)
 	display_measurements_update(amps->dmp_sat_quality, sat_quality * 100.0, 0.0);
 
 	/* debug signaling tone */
-	if (amps->sender.loopback || loglevel == LOGL_DEBUG) {
+	if (amps->sender.loopback || LOGLEVEL_HOT(LOGL_DEBUG)) {
 		LOGP_CHAN(DDSP, loglevel, "Signaling Tone level %.2f%% quality %.0f%%\n", sig_level * 100.0, sig_quality * 100.0);
 	}
 
@@ -899,7 +890,7 @@ static void sender_receive_audio(amps_t *amps, sample_t *samples, int length)
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	amps_t *amps = (amps_t *) sender;
 
@@ -997,7 +988,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (amps->dsp_mode == DSP_MODE_AUDIO_RX_AUDIO_TX) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&amps->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&amps->sender.dejitter, jf);
 	}
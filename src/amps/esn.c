@@ -140,7 +140,7 @@ const char *esn_to_string(uint32_t esn)
 {
 	uint8_t mfr;
 	uint32_t serial;
-	static char esn_string[256];
+	static __thread char esn_string[256];
 
 	amps_decode_esn(esn, &mfr, &serial);
 
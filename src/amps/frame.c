@@ -23,6 +23,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <errno.h>
 #include <math.h>
 #include <inttypes.h>
@@ -53,61 +54,67 @@ static uint64_t cut_bits[37] = {
 	0x1ffffffff, 0x3ffffffff, 0x7ffffffff, 0xfffffffff,
 };
 
-static char gp[12] = { 0, 1, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1 };
+/* generator polynomial of BCH(length+12,length,5) without the x^12 term */
+#define BCH_POLY	0x539
+
+static uint16_t bch_table[256];
+static int8_t bch_syndrome[4096];
 
 /* do BCH(length+12,length,5) encoding:
  * given data and length, return 12 bits redundancy
- * all arrays are MSB first.
+ * data is LSB aligned, leading zeros do not change the result, so we
+ * process whole bytes from the top
  */
-static const char *encode_bch(const char *data, int length)
+static uint16_t encode_bch(uint64_t data, int length)
 {
-	static char redun[13];
-	int i, j, feedback;
-
-	for (i = 0; i < 12; i++)
-		redun[i] = 0;
+	uint16_t crc = 0;
+	int i;
 
-	for (i = 0; i < length; i++) {
-		feedback = (data[i] & 1) ^ redun[0];
-		if (feedback) {
-			for (j = 11; j > 0; j--) {
-				if (gp[11 - j])
-					redun[11 - j] = redun[12 - j] ^ feedback;
-				else
-					redun[11 - j] = redun[12 - j];
-			}
-			redun[11] = gp[11];
-		} else {
-			for (j = 11; j > 0; j--)
-				redun[11 - j] = redun[12 - j];
-			redun[11] = 0;
-		}
-	}
-	for (i = 0; i < 12; i++)
-		redun[i] += '0';
-	redun[12] = '\0';
+	for (i = ((length + 7) >> 3) - 1; i >= 0; i--)
+		crc = bch_table[((crc >> 4) ^ (data >> (i << 3))) & 0xff] ^ ((crc << 8) & 0xfff);
 
-	return redun;
+	return crc;
 }
 
-/* same as above, but with binary data (without parity space holder) */
-static uint16_t encode_bch_binary(uint64_t value, int length)
+/* check word of length data bits plus 12 bits parity, correct a single bit error
+ * return 0 if word is correct, 1 if one bit was corrected, -1 if not correctable
+ */
+static int decode_bch(uint64_t *word, int length)
 {
-	char data[length + 1];
-	const char *redun;
-	uint16_t p = 0;
-	int i;
+	uint16_t syndrome;
+	int pos;
 
-	for (i = 0; i < length; i++)
-		data[i] = '0' + ((value >> (length - 1 - i)) & 1);
-	data[i] = '\0';
+	syndrome = encode_bch(*word >> 12, length) ^ (*word & 0xfff);
+	if (!syndrome)
+		return 0;
+	pos = bch_syndrome[syndrome];
+	if (pos < 0 || pos >= length + 12)
+		return -1;
+	*word ^= (uint64_t)1 << pos;
+	return 1;
+}
 
-	redun = encode_bch(data, length);
+/* generate CRC table for one byte and syndrome table for single bit errors */
+static void init_bch(void)
+{
+	uint16_t crc;
+	int i, j;
 
-	for (i = 0; i < 12; i++)
-		p = (p << 1) | ((*redun++) & 1);
+	for (i = 0; i < 256; i++) {
+		crc = i << 4;
+		for (j = 0; j < 8; j++)
+			crc = (crc & 0x800) ? ((crc << 1) ^ BCH_POLY) & 0xfff : (crc << 1) & 0xfff;
+		bch_table[i] = crc;
+	}
 
-	return p;
+	/* bit positions of the longest word (48 bits), counted from LSB */
+	memset(bch_syndrome, -1, sizeof(bch_syndrome));
+	for (i = 0; i < 48; i++) {
+		if (i < 12)
+			bch_syndrome[1 << i] = i;
+		else
+			bch_syndrome[encode_bch((uint64_t)1 << (i - 12), 36)] = i;
+	}
 }
 
 /*
@@ -1665,7 +1672,7 @@ static const char *amps_act[16] = {
 
 static const char *ie_hex(uint64_t value)
 {
-	static char string[64];
+	static __thread char string[64];
 	
 	sprintf(string, "0x%" PRIx64, value);
 	return string;
@@ -1718,7 +1725,7 @@ static const char *ie_bspc(uint64_t value)
 
 static const char *ie_chan(uint64_t value)
 {
-	static char string[64];
+	static __thread char string[64];
 	
 	if (value == 0)
 		return "No channel";
@@ -1752,7 +1759,7 @@ static const char *ie_cmac(uint64_t value)
 
 static const char *ie_cmax(uint64_t value)
 {
-	static char string[32];
+	static __thread char string[32];
 	
 	sprintf(string, "%" PRIu64, value + 1);
 	return string;
@@ -1760,7 +1767,7 @@ static const char *ie_cmax(uint64_t value)
 
 static const char *ie_n(uint64_t value)
 {
-	static char string[32];
+	static __thread char string[32];
 	
 	sprintf(string, "%" PRIu64, value + 1);
 	return string;
@@ -1827,7 +1834,7 @@ static const char *ie_t1t2(uint64_t value)
 
 static const char *ie_digit(uint64_t value)
 {
-	static char string[32];
+	static __thread char string[32];
 
 	switch (value) {
 	case 0:
@@ -1916,7 +1923,7 @@ static const char *ie_acked_data(uint64_t value)
 
 static const char *ie_ascii(uint64_t value)
 {
-	static char string[32];
+	static __thread char string[32];
 
 	if (value >= 32 && value <= 126)
 		sprintf(string, "'%c'", (char)value);
@@ -2044,7 +2051,7 @@ static const char *ie_si(uint64_t value)
 
 static const char *ie_signal(uint64_t value)
 {
-	static char string[256];
+	static __thread char string[256];
 	const char *pitch, *cadence;
 
 	switch ((value >> 6) & 0x3) {
@@ -2680,6 +2687,9 @@ void init_frame(void)
 		}
 	}
 
+	/* generate BCH tables */
+	init_bch();
+
 	/* generate DCC decoding table */
 	for (i = 0; i < 128; i++)
 		dcc_decode[i] = -1;
@@ -2725,15 +2735,15 @@ static uint64_t amps_encode_word(frame_t *frame, struct def_word *w, int debug)
 	for (i = 0; w->ie[i].name; i++) {
 		bits = w->ie[i].bits;
 		if (w->ie[i].name[0] == 'P' && w->ie[i].name[1] == '\0')
-			value = encode_bch_binary(word, sum_bits - bits);
+			value = encode_bch(word, sum_bits - bits);
 		else
 			value = frame->ie[w->ie[i].ie];
 		word = (word << bits) | (value & cut_bits[bits]);
 		if (debug) {
 			if (amps_ie_desc[w->ie[i].ie].decoder)
-				LOGP(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 " = %s  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].decoder(value), amps_ie_desc[w->ie[i].ie].desc);
+				LOGP_HOT(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 " = %s  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].decoder(value), amps_ie_desc[w->ie[i].ie].desc);
 			else
-				LOGP(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 "  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].desc);
+				LOGP_HOT(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 "  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].desc);
 		}
 		/* show result for 3 IEs of table 4 */
 		if (w->ie[i].ie == AMPS_IE_LOCAL_MSG_TYPE || w->ie[i].ie == AMPS_IE_ORDQ || w->ie[i].ie == AMPS_IE_ORDER)
@@ -2741,7 +2751,7 @@ static uint64_t amps_encode_word(frame_t *frame, struct def_word *w, int debug)
 		if (t4 == 3) {
 			t4 = 0;
 			if (debug)
-				LOGP(DFRAME, LOGL_DEBUG, " %s--> %s\n", spaces, amps_table4_name(frame->ie[AMPS_IE_LOCAL_MSG_TYPE], frame->ie[AMPS_IE_ORDQ], frame->ie[AMPS_IE_ORDER]));
+				LOGP_HOT(DFRAME, LOGL_DEBUG, " %s--> %s\n", spaces, amps_table4_name(frame->ie[AMPS_IE_LOCAL_MSG_TYPE], frame->ie[AMPS_IE_ORDQ], frame->ie[AMPS_IE_ORDER]));
 		}
 	}
 
@@ -3078,15 +3088,15 @@ static frame_t *amps_decode_word(uint64_t word, struct def_word *w)
 		value = (word >> bits_left) & cut_bits[bits];
 		frame.ie[w->ie[i].ie] = value;
 		if (amps_ie_desc[w->ie[i].ie].decoder)
-			LOGP(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 " = %s  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].decoder(value), amps_ie_desc[w->ie[i].ie].desc);
+			LOGP_HOT(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 " = %s  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].decoder(value), amps_ie_desc[w->ie[i].ie].desc);
 		else
-			LOGP(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 "  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].desc);
+			LOGP_HOT(DFRAME, LOGL_DEBUG, " %s%s: %" PRIu64 "  (%s)\n", spaces + strlen(w->ie[i].name), w->ie[i].name, value, amps_ie_desc[w->ie[i].ie].desc);
 		/* show result for 3 IEs of table 4 */
 		if (w->ie[i].ie == AMPS_IE_LOCAL_MSG_TYPE || w->ie[i].ie == AMPS_IE_ORDQ || w->ie[i].ie == AMPS_IE_ORDER)
 			t4++;
 		if (t4 == 3) {
 			t4 = 0;
-			LOGP(DFRAME, LOGL_DEBUG, " %s--> %s\n", spaces, amps_table4_name(frame.ie[AMPS_IE_LOCAL_MSG_TYPE], frame.ie[AMPS_IE_ORDQ], frame.ie[AMPS_IE_ORDER]));
+			LOGP_HOT(DFRAME, LOGL_DEBUG, " %s--> %s\n", spaces, amps_table4_name(frame.ie[AMPS_IE_LOCAL_MSG_TYPE], frame.ie[AMPS_IE_ORDQ], frame.ie[AMPS_IE_ORDER]));
 		}
 	}
 
@@ -3451,15 +3461,30 @@ int amps_encode_frame_focc(amps_t *amps, char *bits)
 {
 	uint64_t word;
 	int debug = !amps->tx_focc_debugged;
+	int slot = -1, count;
 
-	/* init overhead train */
-	if (amps->tx_focc_frame_count == 0)
+	/* init overhead train, cached frames become invalid when system information changes */
+	if (amps->tx_focc_frame_count == 0) {
 		prepare_sysinfo(&amps->si);
+		if (!!memcmp(&amps->tx_focc_cache_si, &amps->si, offsetof(amps_si, reg_id))) {
+			memcpy(&amps->tx_focc_cache_si, &amps->si, sizeof(amps->si));
+			memset(amps->tx_focc_cache_valid, 0, sizeof(amps->tx_focc_cache_valid));
+		}
+	}
 	/* send overhead train */
 	if (amps->si.num) {
-		word = get_sysinfo(&amps->si, debug);
+		count = next_sysinfo(&amps->si);
 		if (++amps->tx_focc_frame_count >= amps->si.overhead_repeat)
 			amps->tx_focc_frame_count = 0;
+		slot = count;
+		/* registration ID changes with time */
+		if (amps->si.type[count] == SYSINFO_REG_ID && amps->si.reg_id.regid != amps->tx_focc_cache_regid) {
+			amps->tx_focc_cache_regid = amps->si.reg_id.regid;
+			amps->tx_focc_cache_valid[slot] = 0;
+		}
+		if (amps->tx_focc_cache_valid[slot] && !debug)
+			goto cached;
+		word = encode_sysinfo(&amps->si, count, debug);
 		goto send;
 	}
 
@@ -3507,16 +3532,30 @@ int amps_encode_frame_focc(amps_t *amps, char *bits)
 		goto send;
 	}
 
-	/* send filler */
-	word = amps_encode_control_filler(amps, amps->si.dcc, amps->si.filler.cmac, amps->si.filler.sdcc1, amps->si.filler.sdcc2, amps->si.filler.wfom, debug);
+	/* send filler, it cannot be cached on loopback, because it carries an index to the transmit time */
 	if (++amps->tx_focc_frame_count >= amps->si.overhead_repeat)
 		amps->tx_focc_frame_count = 0;
+	if (!amps->sender.loopback) {
+		slot = SYSINFO_TRAIN_MAX;
+		if (amps->tx_focc_cache_valid[slot] && !debug)
+			goto cached;
+	}
+	word = amps_encode_control_filler(amps, amps->si.dcc, amps->si.filler.cmac, amps->si.filler.sdcc1, amps->si.filler.sdcc2, amps->si.filler.wfom, debug);
 	if (debug)
 		LOGP_CHAN(DFRAME, LOGL_INFO, "Subsequent system/filler frames are not shown, to prevent flooding the output.\n");
 	amps->tx_focc_debugged = 1;
 
 send:
 	amps_encode_focc_bits(word, word, bits);
+	if (slot >= 0) {
+		memcpy(amps->tx_focc_cache[slot], bits, sizeof(amps->tx_focc_cache[slot]));
+		amps->tx_focc_cache_valid[slot] = 1;
+	}
+
+	return 0;
+
+cached:
+	memcpy(bits, amps->tx_focc_cache[slot], sizeof(amps->tx_focc_cache[slot]));
 
 	return 0;
 }
@@ -3586,32 +3625,116 @@ int amps_encode_frame_fvc(amps_t *amps, char *bits)
 	return 0;
 }
 
+/* get up to 57 bits at given position of a frame that is packed MSB first */
+static uint64_t get_bits(const uint8_t *bits, int pos, int num)
+{
+	uint64_t value = 0;
+	int i;
+
+	bits += pos >> 3;
+	for (i = 0; i < 8; i++)
+		value = (value << 8) | bits[i];
+
+	return (value << (pos & 7)) >> (64 - num);
+}
+
+/* render bits of a frame for debugging */
+static const char *bits_string(const uint8_t *bits, int pos, int num)
+{
+	static __thread char text[64];
+	int i;
+
+	for (i = 0; i < num; i++, pos++)
+		text[i] = '0' + ((bits[pos >> 3] >> (7 - (pos & 7))) & 1);
+	text[i] = '\0';
+
+	return text;
+}
+
+/* vote each bit of 5 repeats, a bit is set if it is set in 3 of them
+ * the count of each bit position is held by 'ones', 'twos' and 'fours'
+ */
+static uint64_t majority_word(const uint64_t *words)
+{
+	uint64_t ones, twos, fours, carry;
+	int i;
+
+	ones = words[0];
+	twos = fours = 0;
+	for (i = 1; i < 5; i++) {
+		carry = ones & words[i];
+		ones ^= words[i];
+		fours |= twos & carry;
+		twos ^= carry;
+	}
+
+	return fours | (twos & ones);
+}
+
+/* select first repeat with correct CRC, or else first one that was corrected,
+ * or else vote bitwise over all 5 repeats
+ * return -1, if there is no usable word
+ */
+static int select_word(const uint64_t *words, const int *crc, int length, uint64_t *word)
+{
+	int i, corrected = -1;
+
+	for (i = 0; i < 5; i++) {
+		if (crc[i] == 0) {
+			*word = words[i];
+			return 0;
+		}
+		if (crc[i] > 0 && corrected < 0)
+			corrected = i;
+	}
+	if (corrected >= 0) {
+		*word = words[corrected];
+		return 1;
+	}
+
+	*word = majority_word(words);
+	return decode_bch(word, length);
+}
+
+static const char *crc_result(int crc)
+{
+	if (crc == 0)
+		return " ok";
+	if (crc > 0)
+		return " corrected";
+	return " BAD CRC!";
+}
+
+/* BCH corrects one bit per word, so count corrected words of 5 repetitions */
+static int corrected_words(const int *crc_ok)
+{
+	int i, count = 0;
+
+	for (i = 0; i < 5; i++) {
+		if (crc_ok[i] > 0)
+			count++;
+	}
+
+	return count;
+}
+
 /* assemble FOCC bits */
-static void amps_decode_bits_focc(amps_t *amps, const char *bits)
+static void amps_decode_bits_focc(amps_t *amps, const uint8_t *bits)
 {
-	char word_string[41];
-	uint64_t word_a[5], word_b[5], word;
+	uint64_t word_a[5], word_b[5], word, word_first;
 	int crc_a_ok[5], crc_b_ok[5], crc_ok;
 	int idle;
-	int i, j, k, crc_i, crc_j;
+	int i, j, pos, rc_a, rc_b;
 
-	bits++; /* skip B/I after sync */
+	pos = 1; /* skip B/I after sync */
 	idle = 0;
 	for (i = 0; i < 10; i++) {
 		word = 0;
-		for (j = 0, k = 0; j < 44; j++) {
-			if (j % 11 == 10) {
-				idle += (*bits++) & 1;
-				continue;
-			}
-			word_string[k++] = *bits;
-			word = (word << 1) | ((*bits++) & 1);
+		for (j = 0; j < 4; j++, pos += 11) {
+			word = (word << 10) | get_bits(bits, pos, 10);
+			idle += get_bits(bits, pos + 10, 1);
 		}
-		word_string[k] = '\0';
-		if (!strncmp(encode_bch(word_string, 28), word_string + 28, 12))
-			crc_ok = 1;
-		else
-			crc_ok = 0;
+		crc_ok = decode_bch(&word, 28);
 		if ((i & 1) == 0) {
 			word_a[i >> 1] = word;
 			crc_a_ok[i >> 1] = crc_ok;
@@ -3620,7 +3743,6 @@ static void amps_decode_bits_focc(amps_t *amps, const char *bits)
 			crc_b_ok[i >> 1] = crc_ok;
 		}
 	}
-	bits -= 440;
 
 	if (idle > 20)
 		idle = 1;
@@ -3629,103 +3751,70 @@ static void amps_decode_bits_focc(amps_t *amps, const char *bits)
 
 	LOGP_CHAN(DFRAME, LOGL_INFO, "RX FOCC: B/I = %s\n", (idle) ? "idle" : "busy");
 	if (loglevel == LOGL_DEBUG) {
-		char text[64];
-
 		for (i = 0; i < 10; i++) {
-			strncpy(text, bits + i * 44, 44);
-			text[44] = '\0';
 			if ((i & 1) == 0)
-				LOGP_CHAN(DFRAME, LOGL_DEBUG, "  word a - %s%s\n", text, (crc_a_ok[i >> 1]) ? " ok" : " BAD CRC!");
+				LOGP_CHAN(DFRAME, LOGL_DEBUG, "  word a - %s%s\n", bits_string(bits, 1 + i * 44, 44), crc_result(crc_a_ok[i >> 1]));
 			else
-				LOGP_CHAN(DFRAME, LOGL_DEBUG, "  word b - %s%s\n", text, (crc_b_ok[i >> 1]) ? " ok" : " BAD CRC!");
+				LOGP_CHAN(DFRAME, LOGL_DEBUG, "  word b - %s%s\n", bits_string(bits, 1 + i * 44, 44), crc_result(crc_b_ok[i >> 1]));
 		}
 	}
 
-	for (crc_i = 0; crc_i < 5; crc_i++) {
-		if (crc_a_ok[crc_i])
-			break;
-	}
-	if (crc_i < 5) {
-		amps_decode_word_focc(amps, word_a[crc_i]);
-	}
-	for (crc_j = 0; crc_j < 5; crc_j++) {
-		if (crc_b_ok[crc_j])
-			break;
+	rc_a = select_word(word_a, crc_a_ok, 28, &word_first);
+	sender_rx_frame(&amps->sender, (rc_a < 0) ? -1 : corrected_words(crc_a_ok));
+	if (rc_a >= 0) {
+		amps_decode_word_focc(amps, word_first);
 	}
-	if (crc_j < 5 && word_b[crc_j] != word_a[crc_i]) {
-		amps_decode_word_focc(amps, word_b[crc_j]);
+	rc_b = select_word(word_b, crc_b_ok, 28, &word);
+	if (rc_b >= 0 && (rc_a < 0 || word != word_first)) {
+		amps_decode_word_focc(amps, word);
 	}
 }
 
 /* assemble RECC bits, return true, if more bits are expected */
-static int amps_decode_bits_recc(amps_t *amps, const char *bits, int first)
+static int amps_decode_bits_recc(amps_t *amps, const uint8_t *bits, int first)
 {
-	char word_string[49];
 	int8_t dcc = -1;
 	uint64_t word_a[5], word;
 	int crc_a_ok[5], crc_ok, crc_ok_count = 0;
-	int i, j, k, crc_i;
-	const char *bits_ = bits; /* for extra check */
+	int i, j, pos = 0, rc;
 
 	/* decode color code */
 	if (first) {
-		dcc = 0;
-		for (j = 0; j < 7; j++) {
-			dcc = (dcc << 1) | ((*bits++) & 1);
-		}
-		dcc = dcc_decode[dcc];
+		dcc = dcc_decode[get_bits(bits, 0, 7)];
+		pos = 7;
 	}
 
 	/* assemble word */
 	for (i = 0; i < 5; i++) {
-		word = 0;
-		for (j = 0, k = 0; j < 48; j++) {
-			word_string[k++] = *bits;
-			word = (word << 1) | ((*bits++) & 1);
-		}
-		word_string[k] = '\0';
-		if (!strncmp(encode_bch(word_string, 36), word_string + 36, 12)) {
-			crc_ok = 1;
+		word = get_bits(bits, pos + i * 48, 48);
+		crc_ok = decode_bch(&word, 36);
+		if (crc_ok >= 0)
 			crc_ok_count++;
-		} else
-			crc_ok = 0;
 		word_a[i] = word;
 		crc_a_ok[i] = crc_ok;
 	}
-	bits -= 240;
 
 	if (crc_ok_count == 0) {
-		/* check if we receive frame in a loop */
+		/* check if we receive frame in a loop, skip B/I after sync */
 		crc_ok = 0;
-		bits_++; /* skip B/I after sync */
 		for (i = 0; i < 5; i++) {
 			word = 0;
-			for (j = 0, k = 0; j < 44; j++) {
-				if (j % 11 == 10) {
-					bits_++;
-					continue;
-				}
-				word_string[k++] = *bits_;
-				word = (word << 1) | ((*bits_++) & 1);
-			}
-			word_string[k] = '\0';
-			if (!strncmp(encode_bch(word_string, 28), word_string + 28, 12))
+			for (j = 0; j < 4; j++)
+				word = (word << 10) | get_bits(bits, 1 + i * 44 + j * 11, 10);
+			if (decode_bch(&word, 28) == 0)
 				crc_ok++;
 		}
 		if (crc_ok) {
 			LOGP_CHAN(DFRAME, LOGL_NOTICE, "Seems we RX FOCC frame due to loopback, ignoring!\n");
 			return 0;
 		}
-		bits_ -= 221;
 	}
 
-	for (crc_i = 0; crc_i < 5; crc_i++) {
-		if (crc_a_ok[crc_i])
-			break;
-	}
+	rc = select_word(word_a, crc_a_ok, 36, &word);
+	sender_rx_frame(&amps->sender, (rc < 0) ? -1 : corrected_words(crc_a_ok));
 
 	if (first) {
-		if (loglevel == LOGL_DEBUG || crc_ok_count > 0) {
+		if (loglevel == LOGL_DEBUG || rc >= 0) {
 			LOGP_CHAN(DFRAME, LOGL_INFO, "RX RECC: DCC=%d (%d of 5 CRCs are ok)\n", dcc, crc_ok_count);
 			if (dcc != amps->si.dcc) {
 				LOGP(DFRAME, LOGL_INFO, "received DCC=%d mismatches the base station's DCC=%d\n", dcc, amps->si.dcc);
@@ -3733,25 +3822,22 @@ static int amps_decode_bits_recc(amps_t *amps, const char *bits, int first)
 			}
 		}
 	} else {
-		if (loglevel == LOGL_DEBUG || crc_ok_count > 0)
+		if (loglevel == LOGL_DEBUG || rc >= 0)
 			LOGP_CHAN(DFRAME, LOGL_INFO, "RX RECC: (%d of 5 CRCs are ok)\n", crc_ok_count);
 	}
 	if (loglevel == LOGL_DEBUG) {
-		char text[64];
-
-		for (i = 0; i < 5; i++) {
-			strncpy(text, bits + i * 48, 48);
-			text[48] = '\0';
-			LOGP_CHAN(DFRAME, LOGL_DEBUG, "  word - %s%s\n", text, (crc_a_ok[i]) ? " ok" : " BAD CRC!");
-		}
+		for (i = 0; i < 5; i++)
+			LOGP_CHAN(DFRAME, LOGL_DEBUG, "  word - %s%s\n", bits_string(bits, pos + i * 48, 48), crc_result(crc_a_ok[i]));
+		if (crc_ok_count == 0)
+			LOGP_CHAN(DFRAME, LOGL_DEBUG, "  voted 3 of 5 repeats -%s\n", crc_result(rc));
 	}
 
-	if (crc_ok_count > 0)
-		return amps_decode_word_recc(amps, word_a[crc_i], first);
+	if (rc >= 0)
+		return amps_decode_word_recc(amps, word, first);
 	return 0;
 }
 
-int amps_decode_frame(amps_t *amps, const char *bits, int count, double level, double quality, int negative)
+int amps_decode_frame(amps_t *amps, const uint8_t *bits, int count, double level, double quality, int negative)
 {
 	int more = 0;
 
@@ -223,5 +223,5 @@ uint64_t amps_encode_access_type(uint8_t dcc, uint8_t bis, uint8_t pci_home, uin
 uint64_t amps_encode_access_attempt(uint8_t dcc, uint8_t maxbusy_pgr, uint8_t maxsztr_pgr, uint8_t maxbusy_other, uint8_t maxsztr_other, uint8_t end, int debug);
 int amps_encode_frame_focc(amps_t *amps, char *bits);
 int amps_encode_frame_fvc(amps_t *amps, char *bits);
-int amps_decode_frame(amps_t *amps, const char *bits, int count, double level, double quality, int negative);
+int amps_decode_frame(amps_t *amps, const uint8_t *bits, int count, double level, double quality, int negative);
 
@@ -138,15 +138,15 @@ static int16_t pattern_400[20] = {
 static int16_t tone_ringback[8000];
 static int16_t tone_400[8000];
 
-extern int16_t *ringback_spl;
+extern const int16_t *ringback_spl;
 extern int ringback_size;
 extern int ringback_max;
 
-extern int16_t *busy_spl;
+extern const int16_t *busy_spl;
 extern int busy_size;
 extern int busy_max;
 
-extern int16_t *congestion_spl;
+extern const int16_t *congestion_spl;
 extern int congestion_size;
 extern int congestion_max;
 
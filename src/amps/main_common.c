@@ -24,6 +24,7 @@
 #include <errno.h>
 #include "../libsample/sample.h"
 #include "../libmobile/main_mobile.h"
+#include "../libmobile/startup.h"
 #include "../liblogging/logging.h"
 #include "../libmobile/call.h"
 #include "../liboptions/options.h"
@@ -36,7 +37,7 @@
 
 /* settings */
 int num_chan_type = 0;
-enum amps_chan_type chan_type[MAX_SENDER] = { CHAN_TYPE_CC_PC_VC };
+enum amps_chan_type *chan_type = NULL;
 const char *flip_polarity = "";
 int ms_power = 4;
 int dtx = 0;
@@ -59,7 +60,7 @@ void print_help(const char *arg0)
 		main_mobile_print_help(arg0, "-p -d -F yes | no [-S aid=<aid>] ");
 	/*      -                                                                             - */
 	printf(" -T --channel-type <channel type> | list\n");
-	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(chan_type[0]));
+	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(CHAN_TYPE_CC_PC_VC));
 	printf(" -F --flip-polarity no | yes\n");
 	printf("        Flip polarity of transmitted FSK signal. If yes, the sound card\n");
 	printf("        generates a negative signal rather than a positive one. Be sure that\n");
@@ -284,6 +285,7 @@ int main_amps_tacs(const char *name, int argc, char *argv[])
 	argi = options_command_line(argc, argv, handle_options);
 	if (argi <= 0)
 		return argi;
+	startup_step("options");
 
 
 	if (argi < argc) {
@@ -300,25 +302,24 @@ int main_amps_tacs(const char *name, int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 		/* set channel types for more than 1 channel */
 		if (num_kanal > 1 && num_chan_type == 0) {
-			chan_type[0] = CHAN_TYPE_CC_PC;
+			OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC_PC)
 			for (i = 1; i < num_kanal; i++)
-				chan_type[i] = CHAN_TYPE_VC;
-			num_chan_type = num_kanal;
+				OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_VC)
 		}
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
 	}
 	if (num_kanal == 1 && num_chan_type == 0)
-		num_chan_type = 1; /* use default */
+		OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC_PC_VC) /* use default */
 	if (num_kanal != num_chan_type) {
 		fprintf(stderr, "You need to specify as many channel types as you have channels.\n");
 		exit(0);
@@ -356,11 +357,15 @@ int main_amps_tacs(const char *name, int argc, char *argv[])
 	}
 
 	sid_stations(sid);
+	startup_step("stations");
 
 	/* inits */
 	fm_init(fast_math);
+	startup_step("fm_init");
 	dsp_init();
+	startup_step("dsp_init");
 	init_frame();
+	startup_step("init_frame");
 
 	/* check for mandatory PC */
 	for (i = 0; i < num_kanal; i++) {
@@ -421,6 +426,7 @@ int main_amps_tacs(const char *name, int argc, char *argv[])
 		else
 			printf("Base station on channel %s ready (%s), please tune transmitter to %.4f MHz and receiver to %.4f MHz. (%.3f MHz offset)\n", kanal[i], chan_type_long_name(chan_type[i]), amps_channel2freq(atoi(kanal[i]), 0) / 1e6, amps_channel2freq(atoi(kanal[i]), 1) / 1e6, amps_channel2freq(atoi(kanal[i]), 2) / 1e6);
 	}
+	startup_step("create instances");
 
 	main_mobile_loop(name, &quit, NULL, station_id);
 
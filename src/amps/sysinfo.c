@@ -151,17 +151,27 @@ void prepare_sysinfo(amps_si *si)
 	}
 }
 
-uint64_t get_sysinfo(amps_si *si, int debug)
+/* get next message of train, returns its position in the train */
+int next_sysinfo(amps_si *si)
 {
-	int count, nawc, end = 0;
-	time_t ti = time(NULL);
+	int count;
 
 	count = si->count;
 
-	if (++si->count == si->num) {
-		end = 1;
+	if (++si->count == si->num)
 		si->num = 0; /* train is over */
-	}
+
+	/* use time stamp to generate regid */
+	if (si->type[count] == SYSINFO_REG_ID)
+		si->reg_id.regid = time(NULL) & 0xfffff;
+
+	return count;
+}
+
+/* encode message of train that has just been returned by next_sysinfo() */
+uint64_t encode_sysinfo(amps_si *si, int count, int debug)
+{
+	int nawc, end = (si->num == 0);
 
 	switch (si->type[count]) {
 	case SYSINFO_WORD1:
@@ -173,8 +183,6 @@ uint64_t get_sysinfo(amps_si *si, int debug)
 	case SYSINFO_WORD2:
 		return amps_encode_word2_system(si->dcc, si->word2.s, si->word2.e, si->word2.regh, si->word2.regr, si->word2.dtx, si->word2.n_1, si->word2.rcf, si->word2.cpa, si->word2.cmax_1, end, debug);
 	case SYSINFO_REG_ID:
-		/* use time stamp to generate regid */
-		si->reg_id.regid = ti & 0xfffff;
 		return amps_encode_registration_id(si->dcc, si->reg_id.regid, end, debug);
 	case SYSINFO_REG_INCR:
 		return amps_encode_registration_increment(si->dcc, si->reg_incr.regincr, end, debug);
@@ -190,7 +198,7 @@ uint64_t get_sysinfo(amps_si *si, int debug)
 		return amps_encode_access_attempt(si->dcc, si->acc_attempt.maxbusy_pgr, si->acc_attempt.maxsztr_pgr, si->acc_attempt.maxbusy_other, si->acc_attempt.maxsztr_other, end, debug);
 	}
 
-	fprintf(stderr, "get_sysinfo unknown type, please fix!\n");
+	fprintf(stderr, "encode_sysinfo unknown type, please fix!\n");
 	abort();
 }
 
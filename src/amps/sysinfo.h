@@ -85,6 +85,8 @@ struct sysinfo_reg_id {
 	uint32_t	regid;
 };
 
+#define SYSINFO_TRAIN_MAX	16	/* maximum number of messages in train */
+
 typedef struct system_information {
 	/* how ofter repeat overhead train (in frames) */
 	int				overhead_repeat;
@@ -105,12 +107,13 @@ typedef struct system_information {
 	struct sysinfo_reg_id		reg_id;
 
 	/* tx state */
-	enum amps_sysinfo_type		type[16];	/* list of messages in train */
+	enum amps_sysinfo_type		type[SYSINFO_TRAIN_MAX];	/* list of messages in train */
 	int				num;		/* number of messages in train */
 	int				count;		/* count message train */
 } amps_si;
 
 void init_sysinfo(amps_si *si, int cmac, int vmac, int dtx, int dcc, int sid1, int regh, int regr, int pureg, int pdreg, int locaid, int regincr, int bis);
 void prepare_sysinfo(amps_si *si);
-uint64_t get_sysinfo(amps_si *si, int debug);
+int next_sysinfo(amps_si *si);
+uint64_t encode_sysinfo(amps_si *si, int count, int debug);
 
@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "outoforder.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0000, 0x0000, 0xffff, 0x0002, 0xfffe, 0x0003, 0xfffd, 0x0001,
 	0x0001, 0xfffd, 0x0004, 0xfffb, 0x0004, 0xfffe, 0x0000, 0x0002,
 	0xfffc, 0x0003, 0xfffd, 0x0001, 0x0000, 0x0000, 0x0002, 0x0001,
@@ -8187,7 +8187,7 @@ static int16_t pattern[] = {
 	0xff69, 0xff9f, 0xffbe, 0xffb2, 0xffe9, 0x0003, 0x0062, 0x0111,
 };
 
-extern int16_t *outoforder_spl;
+extern const int16_t *outoforder_spl;
 extern int outoforder_size;
 extern int outoforder_max;
 
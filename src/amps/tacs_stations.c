@@ -30,7 +30,7 @@ static struct tacs_areas {
 void numbering(const char *number, const char **carrier, const char **country, const char **national_number)
 {
 	int i;
-	static char digits[64];
+	static __thread char digits[64];
 
 	for (i = 0; tacs_areas[i].carrier; i++) {
 		if (!strncmp(number, tacs_areas[i].number, 4)) {
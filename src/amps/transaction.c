@@ -27,6 +27,32 @@
 #include "amps.h"
 //#include "database.h"
 
+/* transactions of all amps instances are also indexed by MIN1/MIN2 and by
+ * callref, the lists of each instance are used for iteration */
+#define TRANS_HASH_SIZE	1024	/* must be power of 2 */
+static transaction_t *trans_hash_number[TRANS_HASH_SIZE];
+static transaction_t *trans_hash_callref[TRANS_HASH_SIZE];
+
+static unsigned int hash_number(uint32_t min1, uint16_t min2)
+{
+	uint32_t x = min1 ^ ((uint32_t)min2 * 0x9e3779b1u);
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (TRANS_HASH_SIZE - 1);
+}
+
+static unsigned int hash_callref(int callref)
+{
+	uint32_t x = callref;
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (TRANS_HASH_SIZE - 1);
+}
+
 static const char *trans_state_name(int state)
 {
 	switch (state) {
@@ -117,18 +143,10 @@ const char *trans_short_state_name(int state)
 /* create transaction */
 transaction_t *create_transaction(amps_t *amps, enum amps_trans_state state, uint32_t min1, uint16_t min2, uint32_t esn, uint8_t msg_type, uint8_t ordq, uint8_t order, uint16_t chan)
 {
-	sender_t *sender;
-	transaction_t *trans = NULL;
-	amps_t *search_amps;
+	transaction_t *trans, **transp;
 
 	/* search transaction for this subscriber */
-	for (sender = sender_head; sender; sender = sender->next) {
-		search_amps = (amps_t *) sender;
-		/* search transaction for this callref */
-		trans = search_transaction_number(search_amps, min1, min2);
-		if (trans)
-			break;
-	}
+	trans = search_transaction_number_global(min1, min2);
 	if (trans) {
 		const char *number = amps_min2number(trans->min1, trans->min2);
 		int old_callref = trans->callref;
@@ -152,6 +170,8 @@ transaction_t *create_transaction(amps_t *amps, enum amps_trans_state state, uin
 	trans_new_state(trans, state);
 	trans->min1 = min1;
 	trans->min2 = min2;
+	for (transp = &trans_hash_number[hash_number(min1, min2)]; *transp; transp = &(*transp)->hash_number_next);
+	*transp = trans;
 	trans->esn = esn;
 	trans->msg_type = msg_type;
 	trans->ordq = ordq;
@@ -169,7 +189,17 @@ transaction_t *create_transaction(amps_t *amps, enum amps_trans_state state, uin
 /* destroy transaction */
 void destroy_transaction(transaction_t *trans)
 {
+	transaction_t **transp;
+
 	unlink_transaction(trans);
+
+	trans_set_callref(trans, 0);
+	for (transp = &trans_hash_number[hash_number(trans->min1, trans->min2)]; *transp; transp = &(*transp)->hash_number_next) {
+		if (*transp == trans) {
+			*transp = trans->hash_number_next;
+			break;
+		}
+	}
 	
 	const char *number = amps_min2number(trans->min1, trans->min2);
 	LOGP(DTRANS, LOGL_INFO, "Destroying transaction for subscriber '%s'\n", number);
@@ -216,42 +246,88 @@ void unlink_transaction(transaction_t *trans)
 	amps_display_status();
 }
 
-transaction_t *search_transaction_number(amps_t *amps, uint32_t min1, uint16_t min2)
+/* search linked transaction of given amps instance, or of any instance if NULL */
+static transaction_t *search_number(amps_t *amps, uint32_t min1, uint16_t min2)
 {
-	transaction_t *trans = amps->trans_list;
+	transaction_t *trans;
 
-	while (trans) {
+	for (trans = trans_hash_number[hash_number(min1, min2)]; trans; trans = trans->hash_number_next) {
 		if (trans->min1 == min1
-		 && trans->min2 == min2) {
+		 && trans->min2 == min2
+		 && trans->amps
+		 && (!amps || trans->amps == amps)) {
 			const char *number = amps_min2number(trans->min1, trans->min2);
 			LOGP(DTRANS, LOGL_DEBUG, "Found transaction for subscriber '%s'\n", number);
 			return trans;
 		}
-		trans = trans->next;
 	}
 
 	return NULL;
 }
 
-transaction_t *search_transaction_callref(amps_t *amps, int callref)
+transaction_t *search_transaction_number(amps_t *amps, uint32_t min1, uint16_t min2)
 {
-	transaction_t *trans = amps->trans_list;
+	return search_number(amps, min1, min2);
+}
+
+transaction_t *search_transaction_number_global(uint32_t min1, uint16_t min2)
+{
+	return search_number(NULL, min1, min2);
+}
+
+/* search linked transaction of given amps instance, or of any instance if NULL */
+static transaction_t *search_callref(amps_t *amps, int callref)
+{
+	transaction_t *trans;
 
 	/* just in case, this should not happen */
 	if (!callref)
 		return NULL;
-	while (trans) {
-		if (trans->callref == callref) {
+	for (trans = trans_hash_callref[hash_callref(callref)]; trans; trans = trans->hash_callref_next) {
+		if (trans->callref == callref
+		 && trans->amps
+		 && (!amps || trans->amps == amps)) {
 			const char *number = amps_min2number(trans->min1, trans->min2);
 			LOGP(DTRANS, LOGL_DEBUG, "Found transaction for subscriber '%s'\n", number);
 			return trans;
 		}
-		trans = trans->next;
 	}
 
 	return NULL;
 }
 
+transaction_t *search_transaction_callref(amps_t *amps, int callref)
+{
+	return search_callref(amps, callref);
+}
+
+transaction_t *search_transaction_callref_global(int callref)
+{
+	return search_callref(NULL, callref);
+}
+
+void trans_set_callref(transaction_t *trans, int callref)
+{
+	transaction_t **transp;
+
+	if (trans->callref == callref)
+		return;
+	if (trans->callref) {
+		for (transp = &trans_hash_callref[hash_callref(trans->callref)]; *transp; transp = &(*transp)->hash_callref_next) {
+			if (*transp == trans) {
+				*transp = trans->hash_callref_next;
+				break;
+			}
+		}
+	}
+	trans->callref = callref;
+	if (callref) {
+		for (transp = &trans_hash_callref[hash_callref(callref)]; *transp; transp = &(*transp)->hash_callref_next);
+		trans->hash_callref_next = NULL;
+		*transp = trans;
+	}
+}
+
 void trans_new_state(transaction_t *trans, int state)
 {
 	LOGP(DTRANS, LOGL_INFO, "Transaction state %s -> %s\n", trans_state_name(trans->state), trans_state_name(state));
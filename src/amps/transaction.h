@@ -25,6 +25,8 @@ enum amps_trans_state {
 
 typedef struct transaction {
 	struct transaction	*next;			/* pointer to next node in list */
+	struct transaction	*hash_number_next;	/* next transaction in hash bucket of MIN1/MIN2 */
+	struct transaction	*hash_callref_next;	/* next transaction in hash bucket of callref */
 	amps_t			*amps;			/* pointer to amps instance */
 	int			callref;		/* call reference */
 	int			page_retry;		/* current number of paging (re)try */
@@ -50,7 +52,10 @@ void link_transaction(transaction_t *trans, amps_t *amps);
 void unlink_transaction(transaction_t *trans);
 transaction_t *search_transaction(amps_t *amps, uint32_t state_mask);
 transaction_t *search_transaction_number(amps_t *amps, uint32_t min1, uint16_t min2);
+transaction_t *search_transaction_number_global(uint32_t min1, uint16_t min2);
 transaction_t *search_transaction_callref(amps_t *amps, int callref);
+transaction_t *search_transaction_callref_global(int callref);
+void trans_set_callref(transaction_t *trans, int callref);
 void trans_new_state(transaction_t *trans, int state);
 void amps_flush_other_transactions(amps_t *amps, transaction_t *trans);
 void transaction_timeout(void *data);
@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "congestion.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0xfffd, 0x0004, 0xfffb, 0x0004, 0xfffe, 0x0001, 0x0001, 0xfffe,
 	0x0001, 0xfffe, 0x0002, 0xfffe, 0xffff, 0x0001, 0xfffd, 0x0001,
 	0xffff, 0x0000, 0x0001, 0x0001, 0xfffe, 0xffff, 0x0000, 0xfffe,
@@ -6632,7 +6632,7 @@ static int16_t pattern[] = {
 	0xfee3, 0xff0f, 0x0007, 0xff7b, 0xfee5, 0xfefe, 0xff93, 0x0033,
 };
 
-extern int16_t *congestion_spl;
+extern const int16_t *congestion_spl;
 extern int congestion_size;
 extern int congestion_max;
 
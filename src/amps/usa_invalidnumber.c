@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "invalidnumber.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0xfffe, 0x0001, 0xffff, 0x0001, 0xffff, 0x0002, 0xfffe, 0x0002,
 	0xfffd, 0x0002, 0xffff, 0xfffe, 0x0002, 0xfffc, 0x0003, 0xfffc,
 	0x0002, 0xfffe, 0x0003, 0xffff, 0x0001, 0xfffc, 0x0002, 0xfffd,
@@ -7209,7 +7209,7 @@ static int16_t pattern[] = {
 	0xfffc, 0x00c0, 0x005c, 0xff41, 0xff90, 0x0021, 0xff10, 0xff27,
 };
 
-extern int16_t *invalidnumber_spl;
+extern const int16_t *invalidnumber_spl;
 extern int invalidnumber_size;
 extern int invalidnumber_max;
 
@@ -32,21 +32,18 @@ typedef struct anetz {
 
 	/* dsp states */
 	enum dsp_mode		dsp_mode;		/* current mode: audio, durable tone 0 or 1, paging */
-	goertzel_t		fsk_tone_goertzel[2];	/* filter for tone decoding */
+	tone_track_t		fsk_tone_track;		/* filter for tone decoding */
 	int			samples_per_chunk;	/* how many samples lasts one chunk */
-	sample_t		*fsk_filter_spl;	/* array with samples_per_chunk */
-	int			fsk_filter_pos;		/* current sample position in filter_spl */
+	int			fsk_filter_pos;		/* current sample position in chunk */
 	int			tone_detected;		/* what tone has been detected */
 	int			tone_count;		/* how long has that tone been detected */
 	double			tone_phaseshift65536;	/* how much the phase of sine wave changes per sample */
 	double			tone_phase65536;	/* current phase */
 	double			page_gain;		/* factor to raise the paging tones */
 	int			page_sequence;		/* if set, use paging tones in sequence rather than parallel */
-	double			paging_phaseshift65536[4];/* how much the phase of sine wave changes per sample */
-	double			paging_phase65536[4];	/* current phase */
-	int			paging_tone;		/* current tone (0..3) in sequenced mode */
-	int			paging_count;		/* current sample count of tone in seq. mode */
-	int			paging_transition;	/* set to number of samples during transition */
+	sample_t		*paging_spl;		/* rendered period of paging tones */
+	int			paging_len;		/* length of rendered period */
+	int			paging_pos;		/* current sample position in paging_spl */
 	squelch_t		squelch;		/* squelch detection process */
 	const char		*operator;		/* destination to dial from mobile phone */
 } anetz_t;
@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "besetztton.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0004, 0xffe9, 0xffc9, 0xffac, 0xff92, 0xff83, 0xff75, 0xff56,
 	0xff40, 0xff2b, 0xff25, 0xff2b, 0xff1f, 0xff1b, 0xff32, 0xff6a,
 	0xffcb, 0x00a2, 0x01cb, 0x02e2, 0x0373, 0x0369, 0x030a, 0x0268,
@@ -174,11 +174,11 @@ static int16_t pattern[] = {
 	0x008f, 0x0099, 0x001c, 0xffa8, 0xff93, 0xff52, 0xff9a, 0x0060,
 };
 
-extern int16_t *busy_spl;
+extern const int16_t *busy_spl;
 extern int busy_size;
 extern int busy_max;
 
-extern int16_t *congestion_spl;
+extern const int16_t *congestion_spl;
 extern int congestion_size;
 extern int congestion_max;
 
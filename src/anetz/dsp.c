@@ -76,15 +76,43 @@ void dsp_init(void)
 	}
 }
 
+/* Length of one rendered period of 4 simultanious paging tones.
+ * All paging frequencies are multiples of 7.5 Hz, so every tone has a whole
+ * number of cycles after 2/15 seconds. Use the shortest multiple of that
+ * duration that is a whole number of samples, which is 2 seconds at most.
+ */
+static int paging_parallel_len(int samplerate)
+{
+	int n;
+
+	for (n = 1; n < 15; n++) {
+		if ((samplerate * 2 * n) % 15 == 0)
+			break;
+	}
+	return samplerate * 2 * n / 15;
+}
+
+/* Length of one rendered period of 4 sequenced paging tones. */
+static int paging_sequence_len(anetz_t *anetz)
+{
+	return 4 * (anetz->page_sequence * anetz->sender.samplerate / 1000 + anetz->sender.samplerate / 500);
+}
+
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_sender(anetz_t *anetz, double page_gain, int page_sequence, double squelch_db)
 {
-	sample_t *spl;
-	int i;
+	int rc;
 	double tone;
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for 'Sender'.\n");
 
+	/* protocol of this channel */
+	anetz->sender.send = send_audio;
+	anetz->sender.receive = receive_audio;
+
 	/* init squelch */
 	squelch_init(&anetz->squelch, anetz->sender.kanal, squelch_db, MUTE_TIME, LOSS_TIME);
 
@@ -96,23 +124,31 @@ int dsp_init_sender(anetz_t *anetz, double page_gain, int page_sequence, double
 
 	anetz->samples_per_chunk = anetz->sender.samplerate * CHUNK_DURATION;
 	LOGP(DDSP, LOGL_DEBUG, "Using %d samples per filter chunk duration.\n", anetz->samples_per_chunk);
-	spl = calloc(anetz->samples_per_chunk, sizeof(sample_t));
-	if (!spl) {
+	rc = tone_track_init(&anetz->fsk_tone_track, fsk_tones, 2, anetz->sender.samplerate, anetz->samples_per_chunk);
+	if (rc < 0)
+		return rc;
+
+	anetz->tone_detected = -1;
+
+	/* buffer for one period of paging tones, rendered when paging starts */
+	if (page_sequence)
+		anetz->paging_len = paging_sequence_len(anetz);
+	else
+		anetz->paging_len = paging_parallel_len(anetz->sender.samplerate);
+	anetz->paging_spl = calloc(anetz->paging_len, sizeof(sample_t));
+	if (!anetz->paging_spl) {
 		LOGP(DDSP, LOGL_ERROR, "No memory!\n");
 		return -ENOMEM;
 	}
-	anetz->fsk_filter_spl = spl;
 
-	anetz->tone_detected = -1;
-
-	for (i = 0; i < 2; i++)
-		audio_goertzel_init(&anetz->fsk_tone_goertzel[i], fsk_tones[i], anetz->sender.samplerate);
 	tone = fsk_tones[(anetz->sender.loopback == 0) ? 0 : 1];
 	anetz->tone_phaseshift65536 = 65536.0 / ((double)anetz->sender.samplerate / tone);
 
 	anetz->dmp_tone_level = display_measurements_add(&anetz->sender.dispmeas, "Tone Level", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 	anetz->dmp_tone_quality = display_measurements_add(&anetz->sender.dispmeas, "Tone Quality", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 
+	sender_account_dsp(&anetz->sender, sizeof(*anetz) - sizeof(anetz->sender) + sizeof(sample_t) * anetz->paging_len);
+
 	return 0;
 }
 
@@ -121,9 +157,10 @@ void dsp_cleanup_sender(anetz_t *anetz)
 {
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Cleanup DSP for 'Sender'.\n");
 
-	if (anetz->fsk_filter_spl) {
-		free(anetz->fsk_filter_spl);
-		anetz->fsk_filter_spl = NULL;
+	tone_track_exit(&anetz->fsk_tone_track);
+	if (anetz->paging_spl) {
+		free(anetz->paging_spl);
+		anetz->paging_spl = NULL;
 	}
 }
 
@@ -153,20 +190,25 @@ static void fsk_receive_tone(anetz_t *anetz, int tone, int goodtone, double leve
 	}
 }
 
-/* Filter one chunk of audio an detect tone and quality of signal. */
-static void fsk_decode_chunk(anetz_t *anetz, sample_t *spl, int max)
+/* Detect tone and quality of signal from the last chunk of audio.
+ * Both tones and the signal power are tracked in one pass over the samples.
+ */
+static void fsk_decode_chunk(anetz_t *anetz)
 {
 	double level, result[2], quality[2];
 
-	level = audio_mean_level(spl, max);
-	/* convert mean (if level comes from a sine curve) to peak value */
-	level = level * M_PI / 2.0 / TX_PEAK_TONE;
+	/* convert power (if level comes from a sine curve) to peak value */
+	level = sqrt(2.0 * tone_track_power(&anetz->fsk_tone_track));
 
-	audio_goertzel(anetz->fsk_tone_goertzel, spl, max, 0, result, 2);
+	tone_track_levels(&anetz->fsk_tone_track, result);
 
 	/* calculate quality of tones */
-	quality[0] = result[0] / level;
-	quality[1] = result[1] / level;
+	if (level > 0.0) {
+		quality[0] = result[0] / level;
+		quality[1] = result[1] / level;
+	} else
+		quality[0] = quality[1] = 0.0;
+	level /= TX_PEAK_TONE;
 	/* show tones */
 	display_measurements_update(anetz->dmp_tone_level, level * 100.0, 0.0);
 	display_measurements_update(anetz->dmp_tone_quality, quality[1] * 100.0, 0.0);
@@ -184,12 +226,12 @@ static void fsk_decode_chunk(anetz_t *anetz, sample_t *spl, int max)
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db)
 {
 	anetz_t *anetz = (anetz_t *) sender;
 	sample_t *spl;
 	int max, pos;
-	int i;
+	int i, n;
 
 	/* process signal mute/loss, also for signalling tone */
 	switch (squelch(&anetz->squelch, rf_level_db, (double)length / (double)anetz->sender.samplerate)) {
@@ -203,15 +245,18 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 		break;
 	}
 
-	/* write received samples to decode buffer */
+	/* track tones and decode after each chunk */
 	max = anetz->samples_per_chunk;
 	pos = anetz->fsk_filter_pos;
-	spl = anetz->fsk_filter_spl;
-	for (i = 0; i < length; i++) {
-		spl[pos++] = samples[i];
+	for (i = 0; i < length; i += n) {
+		n = max - pos;
+		if (n > length - i)
+			n = length - i;
+		tone_track_process(&anetz->fsk_tone_track, samples + i, n);
+		pos += n;
 		if (pos == max) {
 			pos = 0;
-			fsk_decode_chunk(anetz, spl, max);
+			fsk_decode_chunk(anetz);
 		}
 	}
 	anetz->fsk_filter_pos = pos;
@@ -235,103 +280,112 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 		anetz->sender.rxbuf_pos = 0;
 }
 
-/* Set 4 paging frequencies */
-void dsp_set_paging(anetz_t *anetz, double *freq)
-{
-	int i;
-
-	for (i = 0; i < 4; i++) {
-		anetz->paging_phaseshift65536[i] = 65536.0 / ((double)anetz->sender.samplerate / freq[i]);
-		anetz->paging_phase65536[i] = 0;
-	}
-}
-
-/* Generate audio stream of 4 simultanious paging tones. Keep phase for next call of function.
- * Use TX_PEAK_PAGE*page_gain for all tones, which gives peak of 1/4th for each individual tone. */
-static void fsk_paging_tone(anetz_t *anetz, sample_t *samples, int length)
+/* Render one period of 4 simultanious paging tones.
+ * Use TX_PEAK_PAGE*page_gain for all tones, which gives peak of 1/4th for each individual tone.
+ * Each tone is rounded to a whole number of cycles per period, so the period can be repeated.
+ */
+static void fsk_paging_tone(anetz_t *anetz, double *freq)
 {
-	double *phaseshift, *phase;
-	int i;
+	sample_t *samples = anetz->paging_spl;
+	int length = anetz->paging_len;
+	uint64_t cycles[4];
 	double sample;
+	int i, t;
 
-	phaseshift = anetz->paging_phaseshift65536;
-	phase = anetz->paging_phase65536;
+	for (t = 0; t < 4; t++)
+		cycles[t] = (uint64_t)(freq[t] * (double)length / (double)anetz->sender.samplerate + 0.5);
 
 	for (i = 0; i < length; i++) {
-		sample	= dsp_sine_page[(uint16_t)phase[0]]
-			+ dsp_sine_page[(uint16_t)phase[1]]
-			+ dsp_sine_page[(uint16_t)phase[2]]
-			+ dsp_sine_page[(uint16_t)phase[3]];
+		sample = 0;
+		for (t = 0; t < 4; t++)
+			sample += dsp_sine_page[(uint16_t)(cycles[t] * i * 65536 / length)];
 		*samples++ = sample / 4.0 * anetz->page_gain;
-		phase[0] += phaseshift[0];
-		phase[1] += phaseshift[1];
-		phase[2] += phaseshift[2];
-		phase[3] += phaseshift[3];
-		if (phase[0] >= 65536) phase[0] -= 65536;
-		if (phase[1] >= 65536) phase[1] -= 65536;
-		if (phase[2] >= 65536) phase[2] -= 65536;
-		if (phase[3] >= 65536) phase[3] -= 65536;
 	}
 }
 
-/* Generate audio stream of 4 sequenced paging tones. Keep phase for next call
- * of function.
+/* Render one period of 4 sequenced paging tones.
  *
  * Use TX_PEAK_PAGE for each tone, that is four times higher per tone.
  *
  * Click removal when changing tones that have individual phase:
  * When tone changes to next tone, a transition of 2ms is performed. The last
  * tone is faded out and the new tone faded in.
+ *
+ * The period starts with the first tone and ends with the transition back to
+ * it. The first tone is faded in with the phase it has at the start of the
+ * period, so the period can be repeated.
  */
-static void fsk_paging_tone_sequence(anetz_t *anetz, sample_t *samples, int length, int numspl)
+static void fsk_paging_tone_sequence(anetz_t *anetz, double *freq)
 {
-	double *phaseshift, *phase;
-	int tone, count, transition;
-
-	phaseshift = anetz->paging_phaseshift65536;
-	phase = anetz->paging_phase65536;
-	tone = anetz->paging_tone;
-	count = anetz->paging_count;
-	transition = anetz->paging_transition;
+	sample_t *samples = anetz->paging_spl;
+	int numspl = anetz->page_sequence * anetz->sender.samplerate / 1000;
+	int transition = anetz->sender.samplerate / 500;
+	double phaseshift[4], phase[4], fade_phase;
+	int tone, count, i;
+
+	for (tone = 0; tone < 4; tone++) {
+		phaseshift[tone] = 65536.0 / ((double)anetz->sender.samplerate / freq[tone]);
+		phase[tone] = 0;
+	}
 
-	while (length) {
-		/* use tone, but during transition of tones, keep phase 0 degrees (high level) until next tone reaches 0 degrees (high level) */
-		if (!transition)
-			*samples++ = dsp_sine_page[(uint16_t)phase[tone]] * anetz->page_gain;
-		else {
-			/* fade between old an new tone */
-			*samples++
-				= (double)dsp_sine_page[(uint16_t)phase[(tone - 1) & 3]] * (double)(transition - count) / (double)transition / 2.0 * anetz->page_gain
-				+ (double)dsp_sine_page[(uint16_t)phase[tone]] * (double)count / (double)transition / 2.0 * anetz->page_gain;
-		}
-		phase[0] += phaseshift[0];
-		phase[1] += phaseshift[1];
-		phase[2] += phaseshift[2];
-		phase[3] += phaseshift[3];
-		if (phase[0] >= 65536) phase[0] -= 65536;
-		if (phase[1] >= 65536) phase[1] -= 65536;
-		if (phase[2] >= 65536) phase[2] -= 65536;
-		if (phase[3] >= 65536) phase[3] -= 65536;
-		count++;
-		if (transition && count == transition) {
-			transition = 0;
-			/* reset counter again, when transition ends */
-			count = 0;
+	for (tone = 0; tone < 4; tone++) {
+		/* fade between old an new tone */
+		if (tone) {
+			for (count = 0; count < transition; count++) {
+				*samples++
+					= (double)dsp_sine_page[(uint16_t)phase[tone - 1]] * (double)(transition - count) / (double)transition / 2.0 * anetz->page_gain
+					+ (double)dsp_sine_page[(uint16_t)phase[tone]] * (double)count / (double)transition / 2.0 * anetz->page_gain;
+				for (i = 0; i < 4; i++)
+					phase[i] = fmod(phase[i] + phaseshift[i], 65536.0);
+			}
 		}
-		if (count >= numspl) {
-			/* start transition to next tone (lasts 2 ms) */
-			transition = anetz->sender.samplerate / 500;
-			/* reset counter here, when transition starts */
-			count = 0;
-			if (++tone == 4)
-				tone = 0;
+		for (count = 0; count < numspl; count++) {
+			*samples++ = dsp_sine_page[(uint16_t)phase[tone]] * anetz->page_gain;
+			for (i = 0; i < 4; i++)
+				phase[i] = fmod(phase[i] + phaseshift[i], 65536.0);
 		}
-		length--;
 	}
+	/* fade from last tone to the first tone, which ends at phase 0 */
+	for (count = 0; count < transition; count++) {
+		fade_phase = fmod(-(double)(transition - count) * phaseshift[0], 65536.0) + 65536.0;
+		if (fade_phase >= 65536.0)
+			fade_phase -= 65536.0;
+		*samples++
+			= (double)dsp_sine_page[(uint16_t)phase[3]] * (double)(transition - count) / (double)transition / 2.0 * anetz->page_gain
+			+ (double)dsp_sine_page[(uint16_t)fade_phase] * (double)count / (double)transition / 2.0 * anetz->page_gain;
+		phase[3] = fmod(phase[3] + phaseshift[3], 65536.0);
+	}
+}
+
+/* Set 4 paging frequencies and render the paging tones */
+void dsp_set_paging(anetz_t *anetz, double *freq)
+{
+	if (anetz->page_sequence)
+		fsk_paging_tone_sequence(anetz, freq);
+	else
+		fsk_paging_tone(anetz, freq);
+	anetz->paging_pos = 0;
+}
+
+/* Repeat rendered paging tones. */
+static void fsk_paging(anetz_t *anetz, sample_t *samples, int length)
+{
+	int pos = anetz->paging_pos;
+	int n;
 
-	anetz->paging_tone = tone;
-	anetz->paging_count = count;
-	anetz->paging_transition = transition;
+	while (length) {
+		n = anetz->paging_len - pos;
+		if (n > length)
+			n = length;
+		memcpy(samples, anetz->paging_spl + pos, n * sizeof(*samples));
+		samples += n;
+		length -= n;
+		pos += n;
+		if (pos == anetz->paging_len)
+			pos = 0;
+	}
+
+	anetz->paging_pos = pos;
 }
 
 /* Generate audio stream from tone. Keep phase for next call of function. */
@@ -354,10 +408,9 @@ static void fsk_tone(anetz_t *anetz, sample_t *samples, int length)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	anetz_t *anetz = (anetz_t *) sender;
-	int input_num;
 
 	memset(power, 1, length);
 
@@ -366,22 +419,13 @@ void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length
 		memset(samples, 0, length * sizeof(*samples));
 		break;
 	case DSP_MODE_AUDIO:
-		input_num = samplerate_upsample_input_num(&sender->srstate, length);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&sender->dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
-		}
-		samplerate_upsample(&sender->srstate, samples, input_num, samples, length);
+		sender_load_speech(&sender->dejitter, &sender->srstate, samples, length);
 		break;
 	case DSP_MODE_TONE:
 		fsk_tone(anetz, samples, length);
 		break;
 	case DSP_MODE_PAGING:
-		if (anetz->page_sequence)
-			fsk_paging_tone_sequence(anetz, samples, length, anetz->page_sequence * anetz->sender.samplerate / 1000);
-		else
-			fsk_paging_tone(anetz, samples, length);
+		fsk_paging(anetz, samples, length);
 		break;
 	}
 }
@@ -412,10 +456,8 @@ void anetz_set_dsp_mode(anetz_t *anetz, enum dsp_mode mode, int detect_reset)
 		jitter_reset(&anetz->sender.dejitter);
 
 	anetz->dsp_mode = mode;
-	/* reset sequence paging */
-	anetz->paging_tone = 0;
-	anetz->paging_count = 0;
-	anetz->paging_transition = 0;
+	/* restart paging tones */
+	anetz->paging_pos = 0;
 	/* reset tone detector */
 	if (detect_reset)
 		anetz->tone_detected = -1;
@@ -437,7 +479,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (anetz->dsp_mode == DSP_MODE_AUDIO) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&anetz->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&anetz->sender.dejitter, jf);
 	}
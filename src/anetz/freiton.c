@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "freiton.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0056, 0x0068, 0x0065, 0x005d, 0x0040, 0x0031, 0x001a, 0x000d,
 	0xfffe, 0xffda, 0xffbf, 0xffa1, 0xff8b, 0xff80, 0xff68, 0xff4f,
 	0xff36, 0xff27, 0xff28, 0xff27, 0xff1d, 0xff1e, 0xff46, 0xff84,
@@ -1062,7 +1062,7 @@ static int16_t pattern[] = {
 	0x0095, 0x0042, 0x0006, 0x0036, 0x0000, 0x003a, 0x00a9, 0xfffa,
 };
 
-extern int16_t *ringback_spl;
+extern const int16_t *ringback_spl;
 extern int ringback_size;
 extern int ringback_max;
 
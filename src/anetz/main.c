@@ -33,6 +33,7 @@
 #include "freiton.h"
 #include "besetztton.h"
 #include "anetz.h"
+#include "../libmobile/reconfig.h"
 #include "dsp.h"
 #include "stations.h"
 
@@ -126,6 +127,18 @@ static const struct number_lengths  number_lengths[] = {
 	{ 0, NULL }
 };
 
+/* change squelch via control socket, like '-S' */
+static int set_squelch(sender_t *sender, const char *value)
+{
+	anetz_t *anetz = (anetz_t *) sender;
+
+	if (!sender->use_sdr)
+		return -EINVAL;
+	squelch_set_threshold(&anetz->squelch, (!strcasecmp(value, "auto")) ? 0.0 : atof(value));
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int rc, argi;
@@ -164,12 +177,12 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
@@ -190,6 +203,8 @@ int main(int argc, char *argv[])
 		printf("Base station on channel %s ready, please tune transmitter to %.3f MHz and receiver to %.3f MHz. (%.3f MHz offset)\n", kanal[i], anetz_kanal2freq(atoi(kanal[i]), 0) / 1e6, anetz_kanal2freq(atoi(kanal[i]), 1) / 1e6, anetz_kanal2freq(atoi(kanal[i]), 2) / 1e6);
 	}
 
+	reconfig_add("squelch", 1, set_squelch, "Squelch threshold in dB or 'auto', like '-S' (SDR only)");
+
 	main_mobile_loop("anetz", &quit, NULL, station_id);
 
 fail:
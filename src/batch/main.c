@@ -0,0 +1,467 @@
+/* Batch decoding of recordings as fast as the CPU allows
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each recording is split into chunks of equal length. Each chunk is decoded
+ * by a network process with '--offline', which reads some seconds of the
+ * recording before and after the chunk ('--read-wave-window'). So the
+ * receiver is synchronized at the beginning of the chunk and frames that end
+ * after the chunk are still complete. A network process keeps all its state
+ * in globals, so chunks are decoded by separate processes. A pool of threads
+ * runs these processes, each thread takes the next chunk when its process
+ * has finished, so that all cores stay busy, even if recordings differ in
+ * length.
+ *
+ * Each process writes a frame trace (see libmobile/frametrace.c) with the
+ * position within the recording as time. Frames outside the chunk are
+ * dropped, because they belong to the neighbor chunk. The start time of the
+ * recording (modification time of the file minus its duration) is added.
+ * Then all frames of all recordings are sorted by time and written to one
+ * frame trace.
+ *
+ * The command is given once, '{}' is replaced by the file name of each
+ * recording, e.g.:
+ *
+ *   osmobatchdecode -t all.trace "nmt -k 1 -y 1 --read-iq-rx-wave {}" *.wav
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../libwave/wave.h"
+
+#define TRACE_MAGIC	"AFTR"
+#define TRACE_HEADER	44
+
+struct recording {
+	const char	*filename;
+	double		duration;	/* seconds, 0 if unknown */
+	uint64_t	start_us;	/* time of first sample since epoch */
+};
+
+struct job {
+	struct recording *rec;
+	int		chunk;
+	double		window_start;	/* part of recording to decode */
+	double		window_duration;
+	uint64_t	keep_from;	/* frames to keep, time within recording */
+	uint64_t	keep_until;
+	char		trace[512];
+	char		log[512];
+	int		failed;
+};
+
+struct frame {
+	uint64_t	time;
+	uint64_t	seq;		/* keep order of equal times */
+	uint8_t		*data;
+};
+
+static int jobs = 0;
+static double chunk_length = 600.0;
+static double overlap = 10.0;
+static const char *output = NULL;
+static const char *tmp_dir = "/tmp";
+static int keep = 0;
+
+static const char *command;
+static struct job *job_list;
+static int num_jobs, next_job, done_jobs;
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void print_help(const char *arg0)
+{
+	printf("Usage: %s [options] -t <trace file> \"<command>\" <recording> [<recording> ...]\n", arg0);
+	printf(" -t <file>       Write frames of all recordings, ordered by time, to this file.\n");
+	printf(" -j <number>     Number of processes to run at the same time. (default: CPU cores)\n");
+	printf(" -c <seconds>    Split recordings into chunks of this length, 0 to decode each\n");
+	printf("                 recording as a whole. (default %.0f)\n", chunk_length);
+	printf(" -o <seconds>    Decode this much of the recording before and after each chunk.\n");
+	printf("                 (default %.0f)\n", overlap);
+	printf(" -T <dir>        Directory for traces and logs of the chunks. (default '%s')\n", tmp_dir);
+	printf(" -k              Keep traces and logs of the chunks.\n");
+	printf("The command is the command line of a network, '{}' is replaced by the file name\n");
+	printf("of each recording, e.g. \"nmt -k 1 -y 1 --read-iq-rx-wave {}\". Compressed and raw\n");
+	printf("recordings cannot be split into chunks.\n");
+}
+
+/* duration of a recording, 0 if it cannot be split */
+static double recording_duration(const char *filename)
+{
+	wave_play_t play;
+	int samplerate = 0, channels = 0;
+	double duration;
+
+	if (wave_create_playback(&play, filename, &samplerate, &channels, 1.0, WAVE_FLAG_MMAP) < 0)
+		return 0.0;
+	duration = (play.iqz) ? 0.0 : (double)play.left / (double)samplerate;
+	wave_destroy_playback(&play);
+
+	return duration;
+}
+
+static int add_recording_jobs(struct recording *rec, int index)
+{
+	struct stat st;
+	struct job *job;
+	int chunks, c;
+
+	if (strchr(rec->filename, '\'')) {
+		fprintf(stderr, "File name '%s' must not contain quotes!\n", rec->filename);
+		return -EINVAL;
+	}
+	if (stat(rec->filename, &st) < 0) {
+		fprintf(stderr, "Failed to access recording '%s' (%s)\n", rec->filename, strerror(errno));
+		return -errno;
+	}
+	rec->duration = recording_duration(rec->filename);
+	rec->start_us = (uint64_t)(((double)st.st_mtime - rec->duration) * 1000000.0);
+
+	chunks = 1;
+	if (chunk_length > 0.0 && rec->duration > chunk_length)
+		chunks = (int)((rec->duration + chunk_length - 1e-6) / chunk_length);
+
+	job = realloc(job_list, sizeof(*job_list) * (num_jobs + chunks));
+	if (!job) {
+		fprintf(stderr, "No mem!\n");
+		return -ENOMEM;
+	}
+	job_list = job;
+	for (c = 0; c < chunks; c++) {
+		job = &job_list[num_jobs++];
+		memset(job, 0, sizeof(*job));
+		job->rec = rec;
+		job->chunk = c;
+		job->keep_from = 0;
+		job->keep_until = UINT64_MAX;
+		if (chunks > 1) {
+			job->window_start = (double)c * chunk_length - overlap;
+			if (job->window_start < 0.0)
+				job->window_start = 0.0;
+			job->window_duration = (double)(c + 1) * chunk_length + overlap - job->window_start;
+			if (c > 0)
+				job->keep_from = (uint64_t)((double)c * chunk_length * 1000000.0);
+			if (c < chunks - 1)
+				job->keep_until = (uint64_t)((double)(c + 1) * chunk_length * 1000000.0);
+		}
+		snprintf(job->trace, sizeof(job->trace), "%s/batch_%d_%d_%d.trace", tmp_dir, (int)getpid(), index, c);
+		snprintf(job->log, sizeof(job->log), "%s/batch_%d_%d_%d.log", tmp_dir, (int)getpid(), index, c);
+	}
+
+	return 0;
+}
+
+/* replace each '{}' of the command by the quoted file name */
+static int build_command(char *cmd, size_t size, const struct job *job)
+{
+	const char *p = command;
+	size_t len = 0;
+	int n;
+
+	while (*p && len < size) {
+		if (p[0] == '{' && p[1] == '}') {
+			n = snprintf(cmd + len, size - len, "'%s'", job->rec->filename);
+			len += n;
+			p += 2;
+			continue;
+		}
+		cmd[len++] = *p++;
+	}
+	if (len < size)
+		len += snprintf(cmd + len, size - len, " --offline --read-wave-window %.6f,%.6f --frame-trace '%s' >'%s' 2>&1", job->window_start, job->window_duration, job->trace, job->log);
+	if (len >= size)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void *worker(void __attribute__((unused)) *arg)
+{
+	char cmd[4096];
+	struct job *job;
+	int rc;
+
+	while (1) {
+		pthread_mutex_lock(&job_mutex);
+		if (next_job == num_jobs) {
+			pthread_mutex_unlock(&job_mutex);
+			break;
+		}
+		job = &job_list[next_job++];
+		pthread_mutex_unlock(&job_mutex);
+
+		if (build_command(cmd, sizeof(cmd), job) < 0) {
+			job->failed = 1;
+			rc = -EINVAL;
+		} else
+			rc = system(cmd);
+		if (rc != 0)
+			job->failed = 1;
+
+		pthread_mutex_lock(&job_mutex);
+		done_jobs++;
+		if (job->failed)
+			printf("[%d/%d] %s chunk %d: FAILED, see '%s'\n", done_jobs, num_jobs, job->rec->filename, job->chunk, job->log);
+		else
+			printf("[%d/%d] %s chunk %d: ok\n", done_jobs, num_jobs, job->rec->filename, job->chunk);
+		fflush(stdout);
+		pthread_mutex_unlock(&job_mutex);
+	}
+
+	return NULL;
+}
+
+static uint64_t get_le(const uint8_t *p, int bytes)
+{
+	uint64_t value = 0;
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		value |= (uint64_t)p[i] << (i * 8);
+	return value;
+}
+
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		p[i] = value >> (i * 8);
+}
+
+static int compare_frames(const void *a, const void *b)
+{
+	const struct frame *fa = a, *fb = b;
+
+	if (fa->time != fb->time)
+		return (fa->time < fb->time) ? -1 : 1;
+	return (fa->seq < fb->seq) ? -1 : (fa->seq > fb->seq);
+}
+
+/* read frames of the chunk, drop those outside, and stamp them with the time since epoch */
+static int read_trace(const struct job *job, uint8_t ***buffers, size_t *num_buffers, struct frame **frames, size_t *num_frames)
+{
+	struct frame *f;
+	uint8_t *data, **b;
+	size_t size, pos, len;
+	long file_size;
+	uint64_t time;
+	FILE *fp;
+
+	fp = fopen(job->trace, "r");
+	if (!fp)
+		return -errno;
+	fseek(fp, 0, SEEK_END);
+	file_size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (file_size < 4) {
+		fclose(fp);
+		return -EINVAL;
+	}
+	data = malloc(file_size);
+	if (!data || fread(data, file_size, 1, fp) != 1 || memcmp(data, TRACE_MAGIC, 4)) {
+		free(data);
+		fclose(fp);
+		return -EINVAL;
+	}
+	fclose(fp);
+
+	/* keep data of all chunks until frames are written */
+	b = realloc(*buffers, sizeof(**buffers) * (*num_buffers + 1));
+	if (!b) {
+		free(data);
+		return -ENOMEM;
+	}
+	*buffers = b;
+	b[(*num_buffers)++] = data;
+
+	size = file_size;
+	for (pos = 4; pos + TRACE_HEADER <= size; pos += len) {
+		len = get_le(data + pos, 2);
+		if (len < TRACE_HEADER || pos + len > size)
+			break;
+		time = get_le(data + pos + 4, 8);
+		if (time < job->keep_from || time >= job->keep_until)
+			continue;
+		put_le(data + pos + 4, time + job->rec->start_us, 8);
+		f = realloc(*frames, sizeof(**frames) * (*num_frames + 1));
+		if (!f)
+			return -ENOMEM;
+		*frames = f;
+		f = &(*frames)[*num_frames];
+		f->time = time + job->rec->start_us;
+		f->seq = *num_frames;
+		f->data = data + pos;
+		(*num_frames)++;
+	}
+
+	return 0;
+}
+
+static int merge_traces(void)
+{
+	uint8_t **buffers = NULL;
+	size_t num_buffers = 0, num_frames = 0, i;
+	struct frame *frames = NULL;
+	FILE *fp;
+	int j, rc = 0;
+
+	for (j = 0; j < num_jobs; j++) {
+		if (job_list[j].failed)
+			continue;
+		rc = read_trace(&job_list[j], &buffers, &num_buffers, &frames, &num_frames);
+		if (rc < 0) {
+			fprintf(stderr, "Failed to read trace '%s' of chunk (%s)\n", job_list[j].trace, strerror(-rc));
+			job_list[j].failed = 1;
+			rc = 0;
+		}
+	}
+
+	qsort(frames, num_frames, sizeof(*frames), compare_frames);
+
+	fp = fopen(output, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to create '%s' (%s)\n", output, strerror(errno));
+		rc = -errno;
+		goto out;
+	}
+	fwrite(TRACE_MAGIC, 4, 1, fp);
+	for (i = 0; i < num_frames; i++)
+		fwrite(frames[i].data, get_le(frames[i].data, 2), 1, fp);
+	fclose(fp);
+	printf("%zu frames written to '%s'.\n", num_frames, output);
+
+out:
+	for (i = 0; i < num_buffers; i++)
+		free(buffers[i]);
+	free(buffers);
+	free(frames);
+
+	return rc;
+}
+
+int main(int argc, char *argv[])
+{
+	struct recording *recs;
+	pthread_t *tids;
+	int num_recs, failed = 0;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "ht:j:c:o:T:k")) != -1) {
+		switch (c) {
+		case 't':
+			output = optarg;
+			break;
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'c':
+			chunk_length = atof(optarg);
+			break;
+		case 'o':
+			overlap = atof(optarg);
+			break;
+		case 'T':
+			tmp_dir = optarg;
+			break;
+		case 'k':
+			keep = 1;
+			break;
+		default:
+			print_help(argv[0]);
+			return 0;
+		}
+	}
+	if (!output || optind + 2 > argc) {
+		print_help(argv[0]);
+		return 0;
+	}
+	if (chunk_length < 0.0 || overlap < 0.0) {
+		fprintf(stderr, "Chunk length and overlap must not be negative.\n");
+		return 1;
+	}
+	if (jobs < 1)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs < 1)
+		jobs = 1;
+	command = argv[optind++];
+	if (!strstr(command, "{}")) {
+		fprintf(stderr, "Command must contain '{}' for the file name of the recording.\n");
+		return 1;
+	}
+
+	/* only errors of reading headers */
+	loglevel = LOGL_ERROR;
+	logging_init();
+
+	num_recs = argc - optind;
+	recs = calloc(num_recs, sizeof(*recs));
+	if (!recs) {
+		fprintf(stderr, "No mem!\n");
+		return 1;
+	}
+	for (i = 0; i < num_recs; i++) {
+		recs[i].filename = argv[optind + i];
+		if (add_recording_jobs(&recs[i], i) < 0)
+			return 1;
+	}
+	printf("Decoding %d recording(s) in %d chunk(s) with %d process(es)...\n", num_recs, num_jobs, jobs);
+
+	if (jobs > num_jobs)
+		jobs = num_jobs;
+	tids = calloc(jobs, sizeof(*tids));
+	if (!tids) {
+		fprintf(stderr, "No mem!\n");
+		return 1;
+	}
+	for (i = 0; i < jobs; i++) {
+		if (pthread_create(&tids[i], NULL, worker, NULL)) {
+			fprintf(stderr, "Failed to create thread!\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < jobs; i++)
+		pthread_join(tids[i], NULL);
+	free(tids);
+
+	if (merge_traces() < 0)
+		failed++;
+
+	for (i = 0; i < num_jobs; i++) {
+		if (job_list[i].failed)
+			failed++;
+		if (!keep && !job_list[i].failed) {
+			unlink(job_list[i].trace);
+			unlink(job_list[i].log);
+		}
+	}
+	if (failed)
+		printf("%d chunk(s) failed.\n", failed);
+
+	free(job_list);
+	free(recs);
+
+	return (failed) ? 1 : 0;
+}
@@ -1,5 +1,6 @@
 #include "../libsquelch/squelch.h"
 #include "../libfsk/fsk.h"
+#include "../libsample/nco.h"
 #include "../libmobile/sender.h"
 #include <osmocom/core/timer.h>
 
@@ -13,6 +14,16 @@ enum dsp_mode {
 	DSP_MODE_TELEGRAMM,	/* send "Telegramm" */
 };
 
+/* level and quality of the last received bits, sums are updated with each bit */
+typedef struct bnetz_stat {
+	int			size;			/* number of bits to collect */
+	int			pos;			/* index of oldest bit */
+	double			level[16];
+	double			quality[16];
+	double			level_sum, level_sum2, quality_sum;
+	uint16_t		good;			/* one bit for each of the last levels above threshold */
+} bnetz_stat_t;
+
 /* current state of b-netz sender */
 enum bnetz_state {
 	BNETZ_NULL = 0,
@@ -91,20 +102,15 @@ typedef struct bnetz {
 	fsk_mod_t		fsk_mod;		/* fsk modem instance */
 	fsk_demod_t		fsk_demod;
 	uint16_t		rx_telegramm;		/* rx shift register for receiving telegramm */
-	double			rx_telegramm_quality[16];/* quality of each bit in telegramm */
-	double			rx_telegramm_level[16];	/* level of each bit in telegramm */
-	int			rx_telegramm_qualidx;	/* index of quality array above */
+	bnetz_stat_t		rx_telegramm_stat;	/* level and quality of each bit in telegramm */
 	uint16_t		rx_tone;		/* rx shift register for receiving continuous tone */
-	double			rx_tone_quality[16];	/* quality of tone fragment (100th of second) */
-	double			rx_tone_level[16];	/* level of tone fragment (100th of second) */
-	int			rx_tone_qualidx;	/* index of quality array above */
+	bnetz_stat_t		rx_tone_stat;		/* level and quality of tone fragments (100th of second) */
 	int			tone_detected;		/* what tone has been detected */
 	int			tone_count;		/* how long has that tone been detected */
 	int			tone_duration;		/* how long has that tone been detected */
 	const char		*tx_telegramm;		/* carries bits of one frame to transmit */
 	int			tx_telegramm_pos;
-	double			meter_phaseshift65536;	/* how much the phase of sine wave changes per sample */
-	double			meter_phase65536;	/* current phase */
+	nco_t			meter_nco;		/* oscillator of metering pulse tone */
 	squelch_t		squelch;		/* squelch detection process */
 
 	/* loopback test for latency */
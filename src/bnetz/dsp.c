@@ -62,28 +62,64 @@
 #define MUTE_TIME	0.1	/* time to mute after loosing signal */
 #define LOSS_TIME	12.5	/* duration of signal loss before release (according to FTZ 1727 Pfl 32 Clause 3.2.3.2) */
 
-/* table for fast sine generation */
-static sample_t dsp_metering[65536];
+static int fsk_send_bit(void *inst);
+static void fsk_receive_bit(void *inst, int bit, double quality, double level);
+static void fsk_receive_bits(void *inst, const fsk_soft_bit_t *bits, int count);
+
+static void stat_init(bnetz_stat_t *stat, int size)
+{
+	memset(stat, 0, sizeof(*stat));
+	stat->size = size;
+}
 
-/* global init for FSK */
-void dsp_init(void)
+/* replace oldest bit by given bit */
+static void stat_add(bnetz_stat_t *stat, double level, double quality)
 {
+	double old = stat->level[stat->pos];
 	int i;
 
-	LOGP(DDSP, LOGL_DEBUG, "Generating sine table for metering tone.\n");
-	for (i = 0; i < 65536; i++)
-		dsp_metering[i] = sin((double)i / 65536.0 * 2.0 * PI) * TX_PEAK_METER;
+	stat->level_sum += level - old;
+	stat->level_sum2 += level * level - old * old;
+	stat->quality_sum += quality - stat->quality[stat->pos];
+	stat->level[stat->pos] = level;
+	stat->quality[stat->pos] = quality;
+	stat->good = ((stat->good << 1) | (level >= TONE_LEVEL_TH)) & ((1 << stat->size) - 1);
+	if (++stat->pos < stat->size)
+		return;
+	stat->pos = 0;
+
+	/* sum up again once per round, so rounding errors do not accumulate */
+	stat->level_sum = stat->level_sum2 = stat->quality_sum = 0;
+	for (i = 0; i < stat->size; i++) {
+		stat->level_sum += stat->level[i];
+		stat->level_sum2 += stat->level[i] * stat->level[i];
+		stat->quality_sum += stat->quality[i];
+	}
 }
 
-static int fsk_send_bit(void *inst);
-static void fsk_receive_bit(void *inst, int bit, double quality, double level);
+static void stat_get(bnetz_stat_t *stat, double *level_avg, double *level_stddev, double *quality_avg)
+{
+	double variance;
+
+	*level_avg = stat->level_sum / stat->size;
+	*quality_avg = stat->quality_sum / stat->size;
+	variance = stat->level_sum2 / stat->size - *level_avg * *level_avg;
+	*level_stddev = (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
 
 /* Init transceiver instance. */
 int dsp_init_sender(bnetz_t *bnetz, double squelch_db)
 {
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for 'Sender'.\n");
 
-	if (TONE_DETECT_CNT > sizeof(bnetz->rx_tone_quality) / sizeof(bnetz->rx_tone_quality[0])) {
+	/* protocol of this channel */
+	bnetz->sender.send = send_audio;
+	bnetz->sender.receive = receive_audio;
+
+	if (TONE_DETECT_CNT > sizeof(bnetz->rx_tone_stat.level) / sizeof(bnetz->rx_tone_stat.level[0])) {
 		LOGP_CHAN(DDSP, LOGL_ERROR, "buffer for tone quality is too small, please fix!\n");
 		return -EINVAL;
 	}
@@ -105,11 +141,14 @@ int dsp_init_sender(bnetz_t *bnetz, double squelch_db)
 		LOGP_CHAN(DDSP, LOGL_ERROR, "FSK init failed!\n");
 		return -EINVAL;
 	}
+	fsk_demod_set_receive_bits(&bnetz->fsk_demod, fsk_receive_bits);
+	stat_init(&bnetz->rx_tone_stat, TONE_DETECT_CNT);
+	stat_init(&bnetz->rx_telegramm_stat, 16);
 
 	bnetz->tone_detected = -1;
 
 	/* metering tone */
-	bnetz->meter_phaseshift65536 = 65536.0 / ((double)bnetz->sender.samplerate / METERING_HZ);
+	nco_init(&bnetz->meter_nco, 0.0, 65536.0 / ((double)bnetz->sender.samplerate / METERING_HZ));
 
 	bnetz->dmp_tone_level = display_measurements_add(&bnetz->sender.dispmeas, "Tone Level", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 	bnetz->dmp_tone_stddev = display_measurements_add(&bnetz->sender.dispmeas, "Tone Stddev", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
@@ -118,6 +157,8 @@ int dsp_init_sender(bnetz_t *bnetz, double squelch_db)
 	bnetz->dmp_frame_stddev = display_measurements_add(&bnetz->sender.dispmeas, "Frame Stddev", "%.1f %% (last)", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 	bnetz->dmp_frame_quality = display_measurements_add(&bnetz->sender.dispmeas, "Frame Quality", "%.1f %% (last)", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 
+	sender_account_dsp(&bnetz->sender, sizeof(*bnetz) - sizeof(bnetz->sender));
+
 	return 0;
 }
 
@@ -170,29 +211,18 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 {
 	double level_avg, level_stddev, quality_avg;
 	bnetz_t *bnetz = (bnetz_t *)inst;
-	int i, j;
+	uint16_t mask;
+	int continuous, j;
 
 	/* normalize FSK level */
 	level /= TX_PEAK_FSK;
 
-	/* store level and quality to tone buffer */
-	bnetz->rx_tone_quality[bnetz->rx_tone_qualidx] = quality;
-	bnetz->rx_tone_level[bnetz->rx_tone_qualidx] = level;
-	if (++bnetz->rx_tone_qualidx == TONE_DETECT_CNT)
-		bnetz->rx_tone_qualidx = 0;
+	/* store level and quality to tone and telegramm buffer */
+	stat_add(&bnetz->rx_tone_stat, level, quality);
+	stat_add(&bnetz->rx_telegramm_stat, level, quality);
 
 	/* average level and quality of tone */
-	level_avg = level_stddev = quality_avg = 0;
-	for (i = 0; i < TONE_DETECT_CNT; i++) {
-		level_avg += bnetz->rx_tone_level[i];
-		quality_avg += bnetz->rx_tone_quality[i];
-	}
-	level_avg /= TONE_DETECT_CNT; quality_avg /= TONE_DETECT_CNT;
-	for (i = 0; i < TONE_DETECT_CNT; i++) {
-		level = bnetz->rx_tone_level[i];
-		level_stddev += (level - level_avg) * (level - level_avg);
-	}
-	level_stddev = sqrt(level_stddev / TONE_DETECT_CNT);
+	stat_get(&bnetz->rx_tone_stat, &level_avg, &level_stddev, &quality_avg);
 
 	/* update tone measurements */
 	display_measurements_update(bnetz->dmp_tone_level, level_avg * 100.0, 0.0);
@@ -201,42 +231,18 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 
 	/* collect bits, and check for level and continuous tone */
 	bnetz->rx_tone = (bnetz->rx_tone << 1) | bit;
-	for (i = 0, j = 0; i < TONE_DETECT_CNT; i++) {
-		if (((bnetz->rx_tone >> i) & 1) != bit)
-			continue;
-		if (bnetz->rx_tone_level[i] < TONE_LEVEL_TH)
-			continue;
-		j++;
-	}
+	mask = (1 << TONE_DETECT_CNT) - 1;
+	continuous = ((bnetz->rx_tone & mask) == ((bit) ? mask : 0) && bnetz->rx_tone_stat.good == mask);
 
 	/* continuous tone detection:
 	 * 1. The quality must be good enough.
 	 * 2. All bits must be the same (continuous tone).
 	 */
-	if (level_stddev / level_avg > TONE_STDDEV_TH || j < TONE_DETECT_CNT)
+	if (level_stddev / level_avg > TONE_STDDEV_TH || !continuous)
 		fsk_receive_tone(bnetz, bit, 0, level_avg, level_stddev, quality_avg);
 	else
 		fsk_receive_tone(bnetz, bit, 1, level_avg, level_stddev, quality_avg);
 
-	/* store level and quality to telegram buffer */
-	bnetz->rx_telegramm_quality[bnetz->rx_telegramm_qualidx] = quality;
-	bnetz->rx_telegramm_level[bnetz->rx_telegramm_qualidx] = level;
-	if (++bnetz->rx_telegramm_qualidx == 16)
-		bnetz->rx_telegramm_qualidx = 0;
-
-	/* average level and quality of frame */
-	level_avg = level_stddev = quality_avg = 0;
-	for (i = 0; i < 16; i++) {
-		level_avg += bnetz->rx_telegramm_level[i];
-		quality_avg += bnetz->rx_telegramm_quality[i];
-	}
-	level_avg /= 16.0; quality_avg /= 16.0;
-	for (i = 0; i < 16; i++) {
-		level = bnetz->rx_telegramm_level[i];
-		level_stddev += (level - level_avg) * (level - level_avg);
-	}
-	level_stddev = sqrt(level_stddev / 16.0);
-
 	/* collect bits */
 	bnetz->rx_telegramm = (bnetz->rx_telegramm << 1) | bit;
 
@@ -244,13 +250,11 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 	if ((bnetz->rx_telegramm & 0xf800) != 0x7000)
 		return;
 
-	/* collect bits, and check for level */
-	for (i = 0, j = 0; i < 16; i++) {
-		if (bnetz->rx_telegramm_level[i] >= TONE_LEVEL_TH)
-			j++;
-	}
+	/* average level and quality of frame, and check for level */
+	stat_get(&bnetz->rx_telegramm_stat, &level_avg, &level_stddev, &quality_avg);
+	j = __builtin_popcount(bnetz->rx_telegramm_stat.good);
 
-	LOGP_CHAN(DDSP, LOGL_DEBUG, "FSK  Valid bits: %d/%d Level: %.0f%% (threshold %.0f%%)  Stddev: %.0f%% (threshold %.0f%%)\n", j, 16, level_avg * 100.0, TONE_LEVEL_TH * 100.0, level_stddev / level_avg * 100.0, TONE_STDDEV_TH * 100.0);
+	LOGP_CHAN_HOT(DDSP, LOGL_DEBUG, "FSK  Valid bits: %d/%d Level: %.0f%% (threshold %.0f%%)  Stddev: %.0f%% (threshold %.0f%%)\n", j, 16, level_avg * 100.0, TONE_LEVEL_TH * 100.0, level_stddev / level_avg * 100.0, TONE_STDDEV_TH * 100.0);
 
         /* drop any telegramm that is too bad */
 	if (level_stddev / level_avg > TONE_STDDEV_TH || j < 16)
@@ -267,8 +271,17 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 	bnetz_receive_telegramm(bnetz, bnetz->rx_telegramm);
 }
 
+/* all bits of a received chunk */
+static void fsk_receive_bits(void *inst, const fsk_soft_bit_t *bits, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		fsk_receive_bit(inst, bits[i].bit, bits[i].quality, bits[i].level);
+}
+
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db)
 {
 	bnetz_t *bnetz = (bnetz_t *) sender;
 	sample_t *spl;
@@ -339,29 +352,23 @@ static int fsk_send_bit(void *inst)
 /* Add metering pulse tone to audio stream. Keep phase for next call of function. */
 static void metering_tone(bnetz_t *bnetz, sample_t *samples, int length)
 {
-        double phaseshift, phase;
+	nco_t nco = bnetz->meter_nco;
 	int i;
 
-	phaseshift = bnetz->meter_phaseshift65536;
-	phase = bnetz->meter_phase65536;
-
 	for (i = 0; i < length; i++) {
 		/* Add metering pulse, also dampen audio level by 6 dB */
-		*samples = (*samples) * DAMPEN_METER + dsp_metering[(uint16_t)phase];
-		samples++;
-		phase += phaseshift;
-		if (phase >= 65536)
-			phase -= 65536;
+		samples[i] = samples[i] * DAMPEN_METER + nco.im * TX_PEAK_METER;
+		nco_next(&nco);
 	}
 
-	bnetz->meter_phase65536 = phase;
+	bnetz->meter_nco = nco;
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	bnetz_t *bnetz = (bnetz_t *) sender;
-	int count, input_num;
+	int count;
 
 	memset(power, 1, length);
 
@@ -372,13 +379,7 @@ again:
 		break;
 	case DSP_MODE_AUDIO:
 	case DSP_MODE_AUDIO_METER:
-		input_num = samplerate_upsample_input_num(&sender->srstate, length);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&sender->dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
-		}
-		samplerate_upsample(&sender->srstate, samples, input_num, samples, length);
+		sender_load_speech(&sender->dejitter, &sender->srstate, samples, length);
 		if (bnetz->dsp_mode == DSP_MODE_AUDIO_METER)
 			metering_tone(bnetz, samples, length);
 		break;
@@ -450,7 +451,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 	if (bnetz->dsp_mode == DSP_MODE_AUDIO
 	 || bnetz->dsp_mode == DSP_MODE_AUDIO_METER) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&bnetz->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&bnetz->sender.dejitter, jf);
 	}
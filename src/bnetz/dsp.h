@@ -1,5 +1,4 @@
 
-void dsp_init(void);
 int dsp_init_sender(bnetz_t *bnetz, double squelch_db);
 void dsp_cleanup_sender(bnetz_t *bnetz);
 void bnetz_set_dsp_mode(bnetz_t *bnetz, enum dsp_mode mode);
@@ -31,6 +31,7 @@
 #include "../anetz/besetztton.h"
 #include "../liboptions/options.h"
 #include "bnetz.h"
+#include "../libmobile/reconfig.h"
 #include "dsp.h"
 #include "stations.h"
 #include "ansage.h"
@@ -135,6 +136,18 @@ static const char *number_prefixes[] = {
 	NULL
 };
 
+/* change squelch via control socket, like '-S' */
+static int set_squelch(sender_t *sender, const char *value)
+{
+	bnetz_t *bnetz = (bnetz_t *) sender;
+
+	if (!sender->use_sdr)
+		return -EINVAL;
+	squelch_set_threshold(&bnetz->squelch, (!strcasecmp(value, "auto")) ? 0.0 : atof(value));
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int rc, argi;
@@ -171,12 +184,12 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /*deviceuse default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
@@ -184,7 +197,6 @@ int main(int argc, char *argv[])
 
 	/* inits */
 	fm_init(fast_math);
-	dsp_init();
 	bnetz_init();
 
 	/* SDR always requires emphasis */
@@ -212,6 +224,8 @@ int main(int argc, char *argv[])
 		printf("To call phone, switch transmitter (using paging signal) to %.3f MHz.\n", bnetz_kanal2freq(19, 0) / 1e6);
 	}
 
+	reconfig_add("squelch", 1, set_squelch, "Squelch threshold in dB or 'auto', like '-S' (SDR only)");
+
 	main_mobile_loop("bnetz", &quit, NULL, station_id);
 
 fail:
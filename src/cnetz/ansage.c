@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "ansage.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0012, 0x0019, 0x0016, 0x0019, 0x0015, 0x0008, 0xfffd, 0x0005,
 	0x000e, 0x0018, 0x000d, 0xfff4, 0xfffa, 0x0004, 0x0004, 0x0011,
 	0x0007, 0x0003, 0xffff, 0xffff, 0x0009, 0x000d, 0x001c, 0x0015,
@@ -5415,7 +5415,7 @@ static int16_t pattern[] = {
 	0xfff6, 0xfff7, 0x0007, 0x000e, 0x0015, 0x0005, 0x0002, 0xfff5,
 	0xfff8, 0x0003, 0x0002, 0x001c, 0x000d, 0x0004, 0xfff0, 0xfff6,
 };
-extern int16_t *outoforder_spl;
+extern const int16_t *outoforder_spl;
 extern int outoforder_size;
 extern int outoforder_max;
 
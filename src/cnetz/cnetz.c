@@ -232,7 +232,7 @@ static uint8_t cnetz_power2bits(int power)
 
 static const char *cnetz_state_name(enum cnetz_state state)
 {
-	static char invalid[16];
+	static __thread char invalid[16];
 
 	switch (state) {
 	case CNETZ_NULL:
@@ -263,12 +263,25 @@ void cnetz_display_status(void)
 	display_status_end();
 }
 
+/* idle speech channels, [1] for extended frequencies */
+static chan_list_t spk_list[2], ogk_spk_list[2];
+
+static int is_extended(int kanal)
+{
+	if ((kanal & 1) && kanal > 947)
+		return 1;
+	if (!(kanal & 1) && kanal > 758)
+		return 1;
+	return 0;
+}
+
 static void cnetz_new_state(cnetz_t *cnetz, enum cnetz_state new_state)
 {
 	if (cnetz->state == new_state)
 		return;
 	LOGP_CHAN(DCNETZ, LOGL_INFO, "State change: %s -> %s\n", cnetz_state_name(cnetz->state), cnetz_state_name(new_state));
 	cnetz->state = new_state;
+	chan_alloc_set_idle(&cnetz->sender, new_state == CNETZ_IDLE);
 	cnetz_display_status();
 }
 
@@ -380,6 +393,14 @@ int cnetz_create(const char *kanal_name, enum cnetz_chan_type chan_type, const c
 	}
 
 	cnetz->chan_type = chan_type;
+	/* speech channels are allocated from lists */
+	if (chan_type == CHAN_TYPE_SPK || chan_type == CHAN_TYPE_OGK_SPK) {
+		rc = chan_list_add((chan_type == CHAN_TYPE_SPK) ? &spk_list[is_extended(kanal)] : &ogk_spk_list[is_extended(kanal)], &cnetz->sender, cnetz->state == CNETZ_IDLE);
+		if (rc < 0)
+			goto error;
+	}
+	/* receiver keeps track of the time slots */
+	cnetz->sender.rx_always_on = 1;
 	cnetz->challenge_valid = challenge_valid;
 	cnetz->challenge = challenge;
 	cnetz->response_valid = response_valid;
@@ -476,6 +497,7 @@ void cnetz_destroy(sender_t *sender)
 	}
 
 	dsp_cleanup_sender(cnetz);
+	chan_list_remove(&cnetz->sender);
 	sender_destroy(&cnetz->sender);
 	free(cnetz);
 }
@@ -483,29 +505,18 @@ void cnetz_destroy(sender_t *sender)
 static cnetz_t *search_free_spk(int extended)
 {
 	sender_t *sender;
-	cnetz_t *cnetz, *ogk_spk = NULL;
 
-	for (sender = sender_head; sender; sender = sender->next) {
-		cnetz = (cnetz_t *) sender;
-		/* ignore extended frequency, if not supported */
-		if (!extended) {
-			if ((cnetz->kanal & 1) && cnetz->kanal > 947)
-				continue;
-			if (!(cnetz->kanal & 1) && cnetz->kanal > 758)
-				continue;
-		}
-		/* ignore busy channel */
-		if (cnetz->state != CNETZ_IDLE)
-			continue;
-		/* return first free SpK */
-		if (cnetz->chan_type == CHAN_TYPE_SPK)
-			return cnetz;
-		/* remember OgK/SpK combined channel as second alternative */
-		if (cnetz->chan_type == CHAN_TYPE_OGK_SPK)
-			ogk_spk = cnetz;
-	}
+	/* SpK first, OgK/SpK combined channel as second alternative, extended frequency only if supported */
+	if ((sender = chan_alloc(&spk_list[0])))
+		return (cnetz_t *) sender;
+	if (extended && (sender = chan_alloc(&spk_list[1])))
+		return (cnetz_t *) sender;
+	if ((sender = chan_alloc(&ogk_spk_list[0])))
+		return (cnetz_t *) sender;
+	if (extended && (sender = chan_alloc(&ogk_spk_list[1])))
+		return (cnetz_t *) sender;
 
-	return ogk_spk;
+	return NULL;
 }
 
 static cnetz_t *search_ogk(int kanal)
@@ -564,8 +575,8 @@ void cnetz_go_idle(cnetz_t *cnetz)
 	if (trans) {
 		LOGP(DCNETZ, LOGL_NOTICE, "Now channel is available for queued subscriber '%s'.\n", transaction2rufnummer(trans));
 		trans_new_state(trans, (trans->state == TRANS_MT_QUEUE) ? TRANS_MT_DELAY : TRANS_MO_DELAY);
-		osmo_timer_del(&trans->timer);
-		osmo_timer_schedule(&trans->timer, 3,0); /* Wait at least one frame cycles (2.4s) until timeout */
+		wheel_timer_del(&trans->timer);
+		wheel_timer_schedule(&trans->timer, 3,0); /* Wait at least one frame cycles (2.4s) until timeout */
 	}
 }
 
@@ -576,7 +587,7 @@ static void cnetz_release(transaction_t *trans, uint8_t cause)
 	trans->repeat = 0;
 	trans->release_cause = cause;
 	trans->cnetz->sched_dsp_mode_ts = -1;
-	osmo_timer_del(&trans->timer);
+	wheel_timer_del(&trans->timer);
 }
 
 int call_down_setup(int callref, const char __attribute__((unused)) *caller_id, enum number_type __attribute__((unused)) caller_type, const char *dialing)
@@ -639,7 +650,7 @@ int call_down_setup(int callref, const char __attribute__((unused)) *caller_id,
 		LOGP(DCNETZ, LOGL_ERROR, "Failed to create transaction\n");
 		return -CAUSE_TEMPFAIL;
 	}
-	trans->callref = callref;
+	trans_set_callref(trans, callref);
 	trans->try = 1;
 
 	return 0;
@@ -712,12 +723,12 @@ void call_down_disconnect(int callref, int cause)
 		LOGP(DCNETZ, LOGL_INFO, "Call control disconnects on speech channel, releasing towards mobile station.\n");
 		cnetz_release(trans, cnetz_cause_isdn2cnetz(cause));
 		call_up_release(callref, cause);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		break;
 	default:
 		LOGP(DCNETZ, LOGL_INFO, "Call control disconnects on organisation channel, removing transaction.\n");
 		call_up_release(callref, cause);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		if (trans->state == TRANS_MT_QUEUE || trans->state == TRANS_MT_DELAY) {
 			cnetz_release(trans, cnetz_cause_isdn2cnetz(cause));
 		} else {
@@ -750,7 +761,7 @@ void call_down_release(int callref, int cause)
 		return;
 	}
 
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 
 	switch (cnetz->dsp_mode) {
 	case DSP_MODE_SPK_K:
@@ -855,7 +866,7 @@ void transaction_timeout(void *data)
 	case TRANS_MT_QUEUE:
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Phone in queue, but still no channel available, releasing call!\n");
 		call_up_release(trans->callref, CAUSE_NOCHANNEL);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		cnetz_release(trans, CNETZ_CAUSE_GASSENBESETZT);
 		break;
 	case TRANS_MO_QUEUE:
@@ -877,7 +888,7 @@ void transaction_timeout(void *data)
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "No response after sending random number 'Zufallszahl'\n");
 		if (trans->callref) {
 			call_up_release(trans->callref, CAUSE_TEMPFAIL);
-			trans->callref = 0;
+			trans_set_callref(trans, 0);
 		}
 		cnetz_release(trans, CNETZ_CAUSE_FUNKTECHNISCH);
 		break;
@@ -885,7 +896,7 @@ void transaction_timeout(void *data)
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "No response after waiting for challenge response 'Autorisierungsparameter'\n");
 		if (trans->callref) {
 			call_up_release(trans->callref, CAUSE_TEMPFAIL);
-			trans->callref = 0;
+			trans_set_callref(trans, 0);
 		}
 		cnetz_release(trans, CNETZ_CAUSE_FUNKTECHNISCH);
 		break;
@@ -897,26 +908,26 @@ void transaction_timeout(void *data)
 			LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Lost signal from 'FuTln' (mobile station)\n");
 		if (trans->callref) {
 			call_up_release(trans->callref, CAUSE_TEMPFAIL);
-			trans->callref = 0;
+			trans_set_callref(trans, 0);
 		}
 		cnetz_release(trans, CNETZ_CAUSE_FUNKTECHNISCH);
 		break;
 	case TRANS_DS:
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "No response after connect 'Durchschalten'\n");
 		call_up_release(trans->callref, CAUSE_TEMPFAIL);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		cnetz_release(trans, CNETZ_CAUSE_FUNKTECHNISCH);
 		break;
 	case TRANS_RTA:
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "No response after ringing order 'Rufton anschalten'\n");
 		call_up_release(trans->callref, CAUSE_TEMPFAIL);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		cnetz_release(trans, CNETZ_CAUSE_FUNKTECHNISCH);
 		break;
 	case TRANS_AHQ:
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "No response after answer 'Abhebequittung'\n");
 		call_up_release(trans->callref, CAUSE_TEMPFAIL);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		cnetz_release(trans, CNETZ_CAUSE_FUNKTECHNISCH);
 		break;
 	default:
@@ -1033,7 +1044,7 @@ wbn:
 				LOGP_CHAN(DCNETZ, LOGL_INFO, "No free channel, sending call accept in queue 'Wahlbestaetigung positiv in Warteschlage'.\n");
 				telegramm.opcode = OPCODE_WWBP_R;
 				trans_new_state(trans, TRANS_MO_QUEUE);
-				osmo_timer_schedule(&trans->timer, T_VAG2); /* Maximum time to hold queue */
+				wheel_timer_schedule(&trans->timer, T_VAG2); /* Maximum time to hold queue */
 			} else {
 				LOGP(DCNETZ, LOGL_NOTICE, "No free channel anymore, rejecting call!\n");
 				trans_new_state(trans, TRANS_WBN);
@@ -1052,7 +1063,7 @@ vak:
 			}
 			trans_new_state(trans, TRANS_BQ);
 			trans->repeat = 0;
-			osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.150 + 0.0375 * F_BQ)); /* two slots + F_BQ frames */
+			wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.150 + 0.0375 * F_BQ)); /* two slots + F_BQ frames */
 			/* select channel */
 			spk = search_free_spk(trans->extended);
 			if (!spk) {
@@ -1101,7 +1112,7 @@ vak:
 			LOGP_CHAN(DCNETZ, LOGL_INFO, "No free channel, sending incoming call in queue 'Warteschglange kommend'.\n");
 			telegramm.opcode = OPCODE_WSK_R;
 			trans_new_state(trans, TRANS_MT_QUEUE);
-			osmo_timer_schedule(&trans->timer, T_VAK); /* Maximum time to hold queue */
+			wheel_timer_schedule(&trans->timer, T_VAK); /* Maximum time to hold queue */
 			call_up_alerting(trans->callref);
 		default:
 			; /* LR */
@@ -1271,7 +1282,7 @@ void cnetz_receive_telegramm_ogk(cnetz_t *cnetz, telegramm_t *telegramm, int blo
 		rufnummer = transaction2rufnummer(trans);
 		strncpy(trans->dialing, telegramm->wahlziffern, sizeof(trans->dialing) - 1);
 		LOGP_CHAN(DCNETZ, LOGL_INFO, "Received dialing digits 'Wahluebertragung' message from Subscriber '%s' to Number '%s'\n", rufnummer, trans->dialing);
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		trans_new_state(trans, TRANS_WBP);
 		trans->try = 1; /* try */
 		valid_frame = 1;
@@ -1293,7 +1304,7 @@ void cnetz_receive_telegramm_ogk(cnetz_t *cnetz, telegramm_t *telegramm, int blo
 			cnetz = trans->cnetz; /* cnetz may change, due to stronger reception on different OgK */
 		} else {
 			if (cnetz == trans->cnetz) {
-				osmo_timer_del(&trans->timer);
+				wheel_timer_del(&trans->timer);
 				trans_new_state(trans, TRANS_ATQ);
 			} else
 			if (trans->state == TRANS_ATQ_IDLE) {
@@ -1370,7 +1381,7 @@ const telegramm_t *cnetz_transmit_telegramm_spk_k(cnetz_t *cnetz)
 	case TRANS_BQ:
 		LOGP_CHAN(DCNETZ, LOGL_INFO, "Sending 'Belegungsquittung' on traffic channel\n");
 		telegramm.opcode = OPCODE_BQ_K;
-		if (++trans->repeat >= 8 && !osmo_timer_pending(&trans->timer)) {
+		if (++trans->repeat >= 8 && !wheel_timer_pending(&trans->timer)) {
 			if (cnetz->challenge_valid) {
 				if (si.authentifikationsbit == 0) {
 					LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Cannot authenticate, because base station does not support it. (Authentication disabled in sysinfo.)\n");
@@ -1382,11 +1393,11 @@ const telegramm_t *cnetz_transmit_telegramm_spk_k(cnetz_t *cnetz)
 				}
 				LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Perform authentication with subscriber's card, use challenge: 0x%016" PRIx64 "\n", telegramm.zufallszahl);
 				trans_new_state(trans, TRANS_ZFZ);
-				osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_ZFZ)); /* F_ZFZ frames */
+				wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_ZFZ)); /* F_ZFZ frames */
 			} else {
 no_auth:
 				trans_new_state(trans, TRANS_VHQ_K);
-				osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_VHQK)); /* F_VHQK frames */
+				wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_VHQK)); /* F_VHQK frames */
 			}
 			trans->repeat = 0;
 		}
@@ -1404,17 +1415,17 @@ no_auth:
 			LOGP_CHAN(DCNETZ, LOGL_INFO, "Sending 'Quittung Verbindung halten' on traffic channel\n");
 		telegramm.opcode = OPCODE_VHQ_K;
 		/* continue until next sub frame, so we send DS from first block of next sub frame. */
-		if (!cnetz->sender.loopback && (cnetz->sched_ts & 7) == 7 && cnetz->sched_r_m && !osmo_timer_pending(&trans->timer)) {
+		if (!cnetz->sender.loopback && (cnetz->sched_ts & 7) == 7 && cnetz->sched_r_m && !wheel_timer_pending(&trans->timer)) {
 			/* next sub frame */
 			if (trans->mo_call) {
-				trans->callref = call_up_setup(transaction2rufnummer(trans), trans->dialing, OSMO_CC_NETWORK_CNETZ_NONE, "");
+				trans_set_callref(trans, call_up_setup(transaction2rufnummer(trans), trans->dialing, OSMO_CC_NETWORK_CNETZ_NONE, ""));
 				trans_new_state(trans, TRANS_DS);
 				trans->repeat = 0;
-				osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_DS)); /* F_DS frames */
+				wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_DS)); /* F_DS frames */
 			}
 			if (trans->mt_call) {
 				trans_new_state(trans, TRANS_RTA);
-				osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_RTA)); /* F_RTA frames */
+				wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_RTA)); /* F_RTA frames */
 				trans->repeat = 0;
 				call_up_alerting(trans->callref);
 			}
@@ -1424,13 +1435,13 @@ no_auth:
 		LOGP_CHAN(DCNETZ, LOGL_INFO, "Sending 'Durchschalten' on traffic channel\n");
 		telegramm.opcode = OPCODE_DSB_K;
 		/* send exactly a sub frame (8 time slots) */
-		if ((cnetz->sched_ts & 7) == 7 && cnetz->sched_r_m && !osmo_timer_pending(&trans->timer)) {
+		if ((cnetz->sched_ts & 7) == 7 && cnetz->sched_r_m && !wheel_timer_pending(&trans->timer)) {
 			/* next sub frame */
 			trans_new_state(trans, TRANS_VHQ_V);
 			trans->repeat = 0;
 			cnetz_set_sched_dsp_mode(cnetz, DSP_MODE_SPK_V, (cnetz->sched_ts + 1) & 31);
 #ifndef DEBUG_SPK
-			osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.075 + 0.6 * F_VHQ)); /* one slot + F_VHQ frames */
+			wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.075 + 0.6 * F_VHQ)); /* one slot + F_VHQ frames */
 #endif
 		}
 		break;
@@ -1446,7 +1457,7 @@ no_auth:
 			trans_new_state(trans, TRANS_VHQ_V);
 			trans->repeat = 0;
 			cnetz_set_sched_dsp_mode(cnetz, DSP_MODE_SPK_V, (cnetz->sched_ts + 1) & 31);
-			osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.075 + 0.6 * F_VHQ)); /* one slot + F_VHQ frames */
+			wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.075 + 0.6 * F_VHQ)); /* one slot + F_VHQ frames */
 		}
 		break;
 	case TRANS_AF:
@@ -1538,7 +1549,7 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 		valid_frame = 1;
 		if (trans->state != TRANS_BQ)
 			break;
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		trans->try = 0;
 		break;
 	case OPCODE_DSQ_K:
@@ -1554,7 +1565,7 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 			break;
 		cnetz->scrambler = telegramm->betriebs_art;
 		cnetz->scrambler_switch = 0;
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		break;
 	case OPCODE_ZFZQ_K:
 		LOGP_CHAN(DCNETZ, LOGL_INFO, "Received random number acknowledge 'Zufallszahlquittung' message.\n");
@@ -1565,9 +1576,9 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 			LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Received random number acknowledge (0x%016" PRIx64 ") does not match the transmitted one (0x%016" PRIx64 "), ignoring!\n", telegramm->zufallszahl, cnetz->challenge);
 			break;
 		}
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		trans_new_state(trans, TRANS_AP);
-		osmo_timer_schedule(&trans->timer, T_AP); /* 750 milliseconds */
+		wheel_timer_schedule(&trans->timer, T_AP); /* 750 milliseconds */
 		break;
 	case OPCODE_AP_K:
 		LOGP_CHAN(DCNETZ, LOGL_INFO, "Received challenge response 'Autorisierungsparameter' message (0x%016" PRIx64 ").\n", telegramm->authorisierungsparameter);
@@ -1579,15 +1590,15 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 			LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Received challenge response (0x%016" PRIx64 ") does not match the expected one (0x%016" PRIx64 "), releasing!\n", telegramm->authorisierungsparameter, cnetz->response);
 			if (trans->callref) {
 				call_up_release(trans->callref, CAUSE_TEMPFAIL); /* jolly guesses that */
-				trans->callref = 0;
+				trans_set_callref(trans, 0);
 			}
 			cnetz_release(trans, CNETZ_CAUSE_GASSENBESETZT); /* when authentication is not valid */
 			break;
 		}
 		LOGP_CHAN(DCNETZ, LOGL_NOTICE, "Completed authentication with subscriber's card, challenge response: 0x%016" PRIx64 "\n", telegramm->authorisierungsparameter);
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		trans_new_state(trans, TRANS_VHQ_K);
-		osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_VHQK)); /* F_VHQK frames */
+		wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_VHQK)); /* F_VHQK frames */
 		break;
 	case OPCODE_VH_K:
 		if (!match_fuz(telegramm)) {
@@ -1600,7 +1611,7 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 		valid_frame = 1;
 		if (trans->state != TRANS_VHQ_K)
 			break;
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		break;
 	case OPCODE_RTAQ_K:
 		if (!match_fuz(telegramm)) {
@@ -1613,7 +1624,7 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 		LOGP_CHAN(DCNETZ, LOGL_INFO, "Received ringback 'Rufton anschalten Quittung' message.\n");
 		if (trans->state != TRANS_RTA)
 			break;
-		osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_RTA)); /* F_RTA frames */
+		wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.0375 * F_RTA)); /* F_RTA frames */
 		break;
 	case OPCODE_AH_K:
 		if (!match_fuz(telegramm)) {
@@ -1631,7 +1642,7 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 		cnetz->scrambler_switch = 0;
 		trans_new_state(trans, TRANS_AHQ);
 		trans->repeat = 0;
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		call_up_answer(trans->callref, transaction2rufnummer(trans));
 		break;
 	case OPCODE_AT_K:
@@ -1648,10 +1659,10 @@ void cnetz_receive_telegramm_spk_k(cnetz_t *cnetz, telegramm_t *telegramm)
 			break;
 		trans_new_state(trans, TRANS_AT);
 		trans->repeat = 0;
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		if (trans->callref) {
 			call_up_release(trans->callref, CAUSE_NORMAL);
-			trans->callref = 0;
+			trans_set_callref(trans, 0);
 		}
 		break;
 	default:
@@ -1750,7 +1761,7 @@ void cnetz_receive_telegramm_spk_v(cnetz_t *cnetz, telegramm_t *telegramm)
 		}
 		if (trans->state != TRANS_VHQ_V)
 			break;
-		osmo_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.6 * F_VHQ)); /* F_VHQ frames */
+		wheel_timer_schedule(&trans->timer, FLOAT_TO_TIMEOUT(0.6 * F_VHQ)); /* F_VHQ frames */
 		switch (opcode) {
 		case OPCODE_VH_V:
 			LOGP_CHAN(DCNETZ, LOGL_INFO, "Received supervisory frame 'Verbindung halten' message%s.\n", (telegramm->test_telefonteilnehmer_geraet) ? ", phone is a test-phone" : "");
@@ -1787,10 +1798,10 @@ void cnetz_receive_telegramm_spk_v(cnetz_t *cnetz, telegramm_t *telegramm)
 			break;
 		trans_new_state(trans, TRANS_AT);
 		trans->repeat = 0;
-		osmo_timer_del(&trans->timer);
+		wheel_timer_del(&trans->timer);
 		if (trans->callref) {
 			call_up_release(trans->callref, CAUSE_NORMAL);
-			trans->callref = 0;
+			trans_set_callref(trans, 0);
 		}
 		break;
 	default:
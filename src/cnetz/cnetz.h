@@ -1,5 +1,6 @@
 #include "../libcompandor/compandor.h"
 #include <osmocom/core/timer.h>
+#include "../libmobile/timerwheel.h"
 #include "../libmobile/sender.h"
 #include "../libscrambler/scrambler.h"
 typedef struct cnetz cnetz_t;
@@ -63,6 +64,17 @@ struct clock_speed {
 	int			num[4];			/* total num of values so far */
 };
 
+/* waveform of a rendered OgK block */
+#define FSK_CACHE_NUM	32
+struct fsk_cache {
+	uint64_t		bits[3];		/* telegramm, including sync */
+	int			ramp_phase;		/* integer part of phase at start */
+	double			phase_advance;		/* phase at end minus phase at start */
+	sample_t		*spl;			/* samples */
+	int			count;			/* number of samples, 0 if unused */
+	uint32_t		last_used;		/* to replace least recently used */
+};
+
 /* instance of cnetz sender */
 struct cnetz {
 	sender_t		sender;
@@ -102,6 +114,7 @@ struct cnetz {
 
 	/* dsp states */
 	enum dsp_mode		dsp_mode;		/* current mode: audio, "Telegramm", .... */
+	int			rx_prepared;		/* received samples are filtered by dsp_receive() */
 	double			rf_level_db;		/* current RF level or nan, if not applicable */
 	iir_filter_t		lp;			/* low pass filter to eliminate noise above 5280 Hz */
 	fsk_fm_demod_t		fsk_demod;		/* demod process */
@@ -116,6 +129,9 @@ struct cnetz {
 	double			fsk_tx_bitstep;		/* fraction of a bit each sample */
 	double			fsk_tx_phase;		/* current bit position */
 	uint64_t		fsk_tx_scount;		/* sample counter (used to sync multiple channels) */
+	struct fsk_cache	fsk_cache[FSK_CACHE_NUM]; /* cache of OgK blocks */
+	uint32_t		fsk_cache_use;		/* counts cache lookups */
+	uint32_t		fsk_cache_generation;	/* sysinfo generation of cached blocks */
 	int			scrambler;		/* 0 = normal speech, 1 = scrambled speech */
 	int			scrambler_switch;	/* counter to switch after 3 frames with new scrabler state */
 	sample_t		*dsp_speech_buffer;	/* samples in one chunk */
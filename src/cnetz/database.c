@@ -24,8 +24,10 @@
 #include "../libsample/sample.h"
 #include "../liblogging/logging.h"
 #include "../libmobile/get_time.h"
+#include "../libmobile/checkpoint.h"
 #include "cnetz.h"
 #include "database.h"
+#include "futln.h"
 #include "sysinfo.h"
 
 /* the network specs say: check every 1 - 6.5 minutes for availability
@@ -36,7 +38,9 @@
 
 typedef struct cnetz_database {
 
-	struct cnetz_database	*next;
+	struct cnetz_database	*next, *prev;
+	struct cnetz_database	*hash_next;	/* next subscriber in hash bucket of FuTln */
+	struct cnetz_database	*wheel_next, **wheel_pprev; /* link in timer wheel slot, pprev is NULL if not scheduled */
 	int			ogk_kanal;	/* available on which channel */
 	uint8_t			futln_nat;	/* who ... */
 	uint8_t			futln_fuvst;
@@ -46,15 +50,29 @@ typedef struct cnetz_database {
 	int			eingebucht;	/* set if still available */
 	double			last_seen;
 	int			busy;		/* set if currently in a call */
-	struct osmo_timer_list		timer;		/* timer for next availability check */
 	int			retry;		/* counts number of retries */
 } cnetz_db_t;
 
-cnetz_db_t *cnetz_db_head;
+cnetz_db_t *cnetz_db_head, *cnetz_db_tail;
+
+/* subscribers are also indexed by FuTln, the list is used for iteration */
+static cnetz_db_t *db_hash[FUTLN_HASH_SIZE];
+
+/* Availability checks of all subscribers share one timer that ticks every
+ * second, as long as checks are scheduled. Each check is linked to the slot of
+ * the tick when it expires. The wheel must have more slots than the longest
+ * interval (meldeinterval is limited to 20 minutes), so all checks in a slot
+ * expire at the same tick.
+ */
+#define DB_WHEEL_SIZE	2048	/* seconds, must be power of 2 */
+static cnetz_db_t *db_wheel[DB_WHEEL_SIZE];
+static uint32_t db_wheel_tick;
+static int db_wheel_count;
+static struct osmo_timer_list db_wheel_timer;
 
 static const char *print_meldeaufrufe(int versuche)
 {
-	static char text[32];
+	static __thread char text[32];
 
 	if (versuche <= 0)
 		return "infinite";
@@ -63,32 +81,68 @@ static const char *print_meldeaufrufe(int versuche)
 	return text;
 }
 
+static void db_wheel_del(cnetz_db_t *db)
+{
+	if (!db->wheel_pprev)
+		return;
+	*db->wheel_pprev = db->wheel_next;
+	if (db->wheel_next)
+		db->wheel_next->wheel_pprev = db->wheel_pprev;
+	db->wheel_pprev = NULL;
+	if (--db_wheel_count == 0)
+		osmo_timer_del(&db_wheel_timer);
+}
+
+static void db_wheel_schedule(cnetz_db_t *db, int seconds)
+{
+	cnetz_db_t **slot;
+
+	db_wheel_del(db);
+	if (seconds < 1)
+		seconds = 1;
+	if (seconds > DB_WHEEL_SIZE - 1)
+		seconds = DB_WHEEL_SIZE - 1;
+	slot = &db_wheel[(db_wheel_tick + seconds) & (DB_WHEEL_SIZE - 1)];
+	db->wheel_next = *slot;
+	if (db->wheel_next)
+		db->wheel_next->wheel_pprev = &db->wheel_next;
+	db->wheel_pprev = slot;
+	*slot = db;
+	if (db_wheel_count++ == 0)
+		osmo_timer_schedule(&db_wheel_timer, 1,0);
+}
+
 /* destroy transaction */
 static void remove_db(cnetz_db_t *db)
 {
 	cnetz_db_t **dbp;
 
 	/* uinlink */
-	dbp = &cnetz_db_head;
-	while (*dbp && *dbp != db)
-		dbp = &((*dbp)->next);
+	for (dbp = &db_hash[hash_futln(db->futln_nat, db->futln_fuvst, db->futln_rest)]; *dbp && *dbp != db; dbp = &(*dbp)->hash_next);
 	if (!(*dbp)) {
 		LOGP(DDB, LOGL_ERROR, "Subscriber not in list, please fix!!\n");
 		abort();
 	}
-	*dbp = db->next;
+	*dbp = db->hash_next;
+	if (db->prev)
+		db->prev->next = db->next;
+	else
+		cnetz_db_head = db->next;
+	if (db->next)
+		db->next->prev = db->prev;
+	else
+		cnetz_db_tail = db->prev;
 
 	LOGP(DDB, LOGL_INFO, "Removing subscriber '%d,%d,%05d' from database.\n", db->futln_nat, db->futln_fuvst, db->futln_rest);
 
-	osmo_timer_del(&db->timer);
+	db_wheel_del(db);
 
 	free(db);
 }
 
 /* Timeout handling */
-static void db_timeout(void *data)
+static void db_timeout(cnetz_db_t *db)
 {
-	cnetz_db_t *db = data;
 	int rc;
 
 	LOGP(DDB, LOGL_INFO, "Check, if subscriber '%d,%d,%05d' is still available.\n", db->futln_nat, db->futln_fuvst, db->futln_rest);
@@ -99,24 +153,39 @@ static void db_timeout(void *data)
 		 * network. We just assume that the phone has responded and
 		 * assume we had a response. */
 		LOGP(DDB, LOGL_INFO, "OgK busy, so we assume a positive response.\n");
-		osmo_timer_schedule(&db->timer, si.meldeinterval,0); /* when to check avaiability again */
+		db_wheel_schedule(db, si.meldeinterval); /* when to check avaiability again */
 		db->retry = 0;
 	}
 }
 
+static void db_wheel_timeout(void __attribute__((unused)) *data)
+{
+	cnetz_db_t **slot, *db;
+
+	db_wheel_tick++;
+	slot = &db_wheel[db_wheel_tick & (DB_WHEEL_SIZE - 1)];
+	/* rescheduled checks never go to the current slot */
+	while ((db = *slot)) {
+		db_wheel_del(db);
+		db_timeout(db);
+	}
+
+	if (db_wheel_count)
+		osmo_timer_schedule(&db_wheel_timer, 1,0);
+}
+
 /* create/update db entry */
 int update_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int ogk_kanal, int *futelg_bit, int *extended, int busy, int failed)
 {
-	cnetz_db_t *db, **dbp;
+	cnetz_db_t *db;
+	unsigned int hash = hash_futln(futln_nat, futln_fuvst, futln_rest);
 
 	/* search transaction for this subscriber */
-	db = cnetz_db_head;
-	while (db) {
+	for (db = db_hash[hash]; db; db = db->hash_next) {
 		if (db->futln_nat == futln_nat
 		 && db->futln_fuvst == futln_fuvst
 		 && db->futln_rest == futln_rest)
 			break;
-		db = db->next;
 	}
 	if (!db) {
 		db = calloc(1, sizeof(*db));
@@ -124,7 +193,8 @@ int update_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int o
 			LOGP(DDB, LOGL_ERROR, "No memory!\n");
 			return 0;
 		}
-		osmo_timer_setup(&db->timer, db_timeout, db);
+		if (!db_wheel_timer.cb)
+			osmo_timer_setup(&db_wheel_timer, db_wheel_timeout, NULL);
 
 		db->eingebucht = 1;
 		db->futln_nat = futln_nat;
@@ -132,10 +202,14 @@ int update_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int o
 		db->futln_rest = futln_rest;
 
 		/* attach to end of list */
-		dbp = &cnetz_db_head;
-		while (*dbp)
-			dbp = &((*dbp)->next);
-		*dbp = db;
+		db->prev = cnetz_db_tail;
+		if (cnetz_db_tail)
+			cnetz_db_tail->next = db;
+		else
+			cnetz_db_head = db;
+		cnetz_db_tail = db;
+		db->hash_next = db_hash[hash];
+		db_hash[hash] = db;
 
 		LOGP(DDB, LOGL_INFO, "Adding subscriber '%d,%d,%05d' to database.\n", db->futln_nat, db->futln_fuvst, db->futln_rest);
 	}
@@ -152,10 +226,10 @@ int update_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int o
 	db->busy = busy;
 	if (busy) {
 		LOGP(DDB, LOGL_INFO, "Subscriber '%d,%d,%05d' on OGK channel #%d is busy now.\n", db->futln_nat, db->futln_fuvst, db->futln_rest, db->ogk_kanal);
-		osmo_timer_del(&db->timer);
+		db_wheel_del(db);
 	} else if (!failed) {
 		LOGP(DDB, LOGL_INFO, "Subscriber '%d,%d,%05d' on OGK channel #%d is idle now.\n", db->futln_nat, db->futln_fuvst, db->futln_rest, db->ogk_kanal);
-		osmo_timer_schedule(&db->timer, si.meldeinterval,0); /* when to check avaiability (again) */
+		db_wheel_schedule(db, si.meldeinterval); /* when to check avaiability (again) */
 		db->retry = 0;
 		db->eingebucht = 1;
 		db->last_seen = get_time();
@@ -167,7 +241,7 @@ int update_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int o
 			db->eingebucht = 0;
 			return db->extended;
 		}
-		osmo_timer_schedule(&db->timer, (si.meldeinterval < MELDE_WIEDERHOLUNG) ? si.meldeinterval : MELDE_WIEDERHOLUNG,0); /* when to do retry */
+		db_wheel_schedule(db, (si.meldeinterval < MELDE_WIEDERHOLUNG) ? si.meldeinterval : MELDE_WIEDERHOLUNG); /* when to do retry */
 	}
 
 	if (futelg_bit)
@@ -179,9 +253,9 @@ int update_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int o
 
 int find_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int *ogk_kanal, int *futelg_bit, int *extended)
 {
-	cnetz_db_t *db = cnetz_db_head;
+	cnetz_db_t *db;
 
-	while (db) {
+	for (db = db_hash[hash_futln(futln_nat, futln_fuvst, futln_rest)]; db; db = db->hash_next) {
 		if (db->eingebucht
 		 && db->futln_nat == futln_nat
 		 && db->futln_fuvst == futln_fuvst
@@ -194,7 +268,6 @@ int find_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int *og
 				*extended = db->extended;
 			return 0;
 		}
-		db = db->next;
 	}
 	return -1;
 }
@@ -228,3 +301,57 @@ void dump_db(void)
 	}
 }
 
+/* Only attached subscribers are saved. Calls are not saved, subscribers that
+ * are busy are restored as idle.
+ */
+void save_db(checkpoint_buf_t *buf)
+{
+	cnetz_db_t *db;
+
+	for (db = cnetz_db_head; db; db = db->next) {
+		if (!db->eingebucht)
+			continue;
+		checkpoint_put_u8(buf, db->futln_nat);
+		checkpoint_put_u8(buf, db->futln_fuvst);
+		checkpoint_put_u16(buf, db->futln_rest);
+		checkpoint_put_u16(buf, db->ogk_kanal);
+		checkpoint_put_u8(buf, db->futelg_bit);
+		checkpoint_put_u8(buf, db->extended);
+		checkpoint_put_u64(buf, (uint64_t)db->last_seen);
+	}
+}
+
+/* The availability check is scheduled as if the subscriber registered now,
+ * so subscribers that are gone are removed by the usual Meldeaufrufe.
+ */
+void restore_db(checkpoint_buf_t *buf)
+{
+	uint8_t futln_nat, futln_fuvst;
+	uint16_t futln_rest;
+	int ogk_kanal, futelg_bit, extended;
+	double last_seen;
+	cnetz_db_t *db;
+	int count = 0;
+
+	while (buf->pos < buf->len) {
+		futln_nat = checkpoint_get_u8(buf);
+		futln_fuvst = checkpoint_get_u8(buf);
+		futln_rest = checkpoint_get_u16(buf);
+		ogk_kanal = checkpoint_get_u16(buf);
+		futelg_bit = checkpoint_get_u8(buf);
+		extended = checkpoint_get_u8(buf);
+		last_seen = (double)checkpoint_get_u64(buf);
+		if (buf->error)
+			break;
+		update_db(futln_nat, futln_fuvst, futln_rest, ogk_kanal, &futelg_bit, &extended, 0, 0);
+		for (db = db_hash[hash_futln(futln_nat, futln_fuvst, futln_rest)]; db; db = db->hash_next) {
+			if (db->futln_nat == futln_nat
+			 && db->futln_fuvst == futln_fuvst
+			 && db->futln_rest == futln_rest)
+				db->last_seen = last_seen;
+		}
+		count++;
+	}
+
+	LOGP(DDB, LOGL_NOTICE, "Restored %d subscriber(s) to database.\n", count);
+}
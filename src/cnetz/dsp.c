@@ -56,7 +56,7 @@ scrambler_t scrambler_test_scrambler2;
 
 static const char *cnetz_dsp_mode_name(enum dsp_mode mode)
 {
-        static char invalid[16];
+        static __thread char invalid[16];
 
 	switch (mode) {
         case DSP_SCHED_NONE:
@@ -94,6 +94,96 @@ static void dsp_init_ramp(cnetz_t *cnetz)
 	}
 }
 
+/* OgK blocks repeat most of the time, so their samples are cached.
+ * The samples only depend on the bits and the phase at start of the block.
+ * The integer part of the phase (ramp phase) is used as key, so the timing of
+ * a cached block may differ by less than 1/256 bit. The phase advance of the
+ * cached block is added to the current phase, so there is no drift.
+ */
+static void fsk_cache_flush(cnetz_t *cnetz)
+{
+	int i;
+
+	for (i = 0; i < FSK_CACHE_NUM; i++) {
+		free(cnetz->fsk_cache[i].spl);
+		cnetz->fsk_cache[i].spl = NULL;
+		cnetz->fsk_cache[i].count = 0;
+	}
+}
+
+static struct fsk_cache *fsk_cache_lookup(cnetz_t *cnetz, const uint64_t *bits, int ramp_phase)
+{
+	struct fsk_cache *cache;
+	int i;
+
+	/* blocks of old sysinfo will not be sent anymore */
+	if (cnetz->fsk_cache_generation != si_generation) {
+		fsk_cache_flush(cnetz);
+		cnetz->fsk_cache_generation = si_generation;
+	}
+
+	cnetz->fsk_cache_use++;
+	for (i = 0; i < FSK_CACHE_NUM; i++) {
+		cache = &cnetz->fsk_cache[i];
+		if (cache->count && cache->ramp_phase == ramp_phase && !memcmp(cache->bits, bits, sizeof(cache->bits))) {
+			cache->last_used = cnetz->fsk_cache_use;
+			return cache;
+		}
+	}
+
+	return NULL;
+}
+
+static void fsk_cache_store(cnetz_t *cnetz, const uint64_t *bits, int ramp_phase, double phase_advance, const sample_t *spl, int count)
+{
+	struct fsk_cache *cache = NULL;
+	sample_t *cache_spl;
+	int i;
+
+	/* use unused entry or replace least recently used entry */
+	for (i = 0; i < FSK_CACHE_NUM; i++) {
+		if (!cnetz->fsk_cache[i].count) {
+			cache = &cnetz->fsk_cache[i];
+			break;
+		}
+		if (!cache || cnetz->fsk_cache_use - cnetz->fsk_cache[i].last_used > cnetz->fsk_cache_use - cache->last_used)
+			cache = &cnetz->fsk_cache[i];
+	}
+
+	cache_spl = realloc(cache->spl, sizeof(*spl) * count);
+	if (!cache_spl) {
+		LOGP_CHAN(DDSP, LOGL_ERROR, "No memory!\n");
+		return;
+	}
+	memcpy(cache_spl, spl, sizeof(*spl) * count);
+	memcpy(cache->bits, bits, sizeof(cache->bits));
+	cache->ramp_phase = ramp_phase;
+	cache->phase_advance = phase_advance;
+	cache->spl = cache_spl;
+	cache->count = count;
+	cache->last_used = cnetz->fsk_cache_use;
+}
+
+/* filter received samples and evaluate the slope window in advance
+ * this does not depend on protocol state, so it may run in parallel
+ * with other channels, see process_sender_audio()
+ */
+static void dsp_receive(sender_t *sender, sample_t *samples, int length)
+{
+	cnetz_t *cnetz = (cnetz_t *) sender;
+
+#ifndef TEST_SCRAMBLE
+	if (cnetz->dsp_mode != DSP_MODE_OFF) {
+		iir_process(&cnetz->lp, samples, length);
+		fsk_fm_prepare(&cnetz->fsk_demod, samples, length);
+		cnetz->rx_prepared = 1;
+	}
+#endif
+}
+
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_sender(cnetz_t *cnetz, int measure_speed, double clock_speed[2], enum demod_type demod, double speech_deviation)
 {
@@ -102,6 +192,10 @@ int dsp_init_sender(cnetz_t *cnetz, int measure_speed, double clock_speed[2], en
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init FSK for 'Sender'.\n");
 
+	/* protocol of this channel */
+	cnetz->sender.send = send_audio;
+	cnetz->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	sender_set_fm(&cnetz->sender, MAX_DEVIATION, MAX_MODULATION, speech_deviation, MAX_DISPLAY);
 
@@ -135,6 +229,7 @@ int dsp_init_sender(cnetz_t *cnetz, int measure_speed, double clock_speed[2], en
 
 	/* init low pass filter for received signal */
 	iir_lowpass_init(&cnetz->lp, MAX_MODULATION, cnetz->sender.samplerate, 2);
+	cnetz->sender.dsp_receive = dsp_receive;
 
 	/* create speech buffer */
 	cnetz->dsp_speech_buffer = calloc(sizeof(sample_t), (int)(cnetz->fsk_bitduration * 70.0)); /* more to compensate clock speed. we just need it to fill 62 bits (60 bits, including pause bits). */
@@ -144,8 +239,11 @@ int dsp_init_sender(cnetz_t *cnetz, int measure_speed, double clock_speed[2], en
 		goto error;
 	}
 
-	/* reinit the sample rate to shrink/expand audio */
-	init_samplerate(&cnetz->sender.srstate, 8000.0, (double)cnetz->sender.samplerate / (1.1 / (1.0 + clock_speed[0] / 1000000.0)), 3300.0); /* 66 <-> 60 */
+	/* reinit the sample rate to shrink/expand audio
+	 * without clock correction, the ratio is rational, so polyphase filter is used */
+	rc = init_samplerate(&cnetz->sender.srstate, 8000.0, (double)cnetz->sender.samplerate / (1.1 / (1.0 + clock_speed[0] / 1000000.0)), 3300.0, (clock_speed[0] == 0.0) ? SAMPLERATE_POLYPHASE : SAMPLERATE_LINEAR); /* 66 <-> 60 */
+	if (rc < 0)
+		goto error;
 
 	rc = fsk_fm_init(&cnetz->fsk_demod, cnetz, cnetz->sender.samplerate, (double)BITRATE / (1.0 + clock_speed[0] / 1000000.0), demod);
 	if (rc < 0)
@@ -174,6 +272,8 @@ int dsp_init_sender(cnetz_t *cnetz, int measure_speed, double clock_speed[2], en
 
 	cnetz->sched_dsp_mode_ts = -1;
 
+	sender_account_dsp(&cnetz->sender, sizeof(*cnetz) - sizeof(cnetz->sender) + sizeof(sample_t) * (cnetz->fsk_tx_buffer_size + (int)(cnetz->fsk_bitduration * 70.0)));
+
 	return 0;
 
 error:
@@ -194,6 +294,7 @@ void dsp_cleanup_sender(cnetz_t *cnetz)
 		free(cnetz->dsp_speech_buffer);
 		cnetz->dsp_speech_buffer = NULL;
 	}
+	fsk_cache_flush(cnetz);
 
 	fsk_fm_exit(&cnetz->fsk_demod);
 }
@@ -284,16 +385,30 @@ static int fsk_nothing_encode(cnetz_t *cnetz)
 }
 
 /* encode one data block into samples
- * input: 184 data bits (including barker code)
+ * input: 184 packed data bits (including barker code)
  * output: samples
  * return number of samples */
-static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
+static int fsk_block_encode(cnetz_t *cnetz, const uint64_t *bits, int ogk)
 {
 	/* alloc samples, add 1 in case there is a rest */
 	sample_t *spl;
 	double phase, bitstep, deviation;
+	struct fsk_cache *cache;
+	int ramp_phase;
 	int i, count;
-	char last;
+	int bit, last;
+
+	/* use cached samples, if this block was sent with same ramp phase before */
+	ramp_phase = (int)floor(cnetz->fsk_tx_phase);
+	if (ogk) {
+		cache = fsk_cache_lookup(cnetz, bits, ramp_phase);
+		if (cache) {
+			memcpy(cnetz->fsk_tx_buffer, cache->spl, sizeof(*spl) * cache->count);
+			cnetz->fsk_tx_phase += cache->phase_advance;
+			cnetz->fsk_tx_buffer_length = cache->count;
+			return cache->count;
+		}
+	}
 
 	deviation = cnetz->fsk_deviation;
 	spl = cnetz->fsk_tx_buffer;
@@ -309,11 +424,12 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
 		phase -= 256.0;
 	}
 	/* add 184 bits */
-	last = ' ';
-	for (i = 0; i < 184; i++) {
+	last = -1;
+	for (i = 0; i < TELEGRAMM_FRAME_BITS; i++) {
+		bit = TELEGRAMM_FRAME_BIT(bits, i);
 		switch (last) {
-		case ' ':
-			if (bits[i] == '1') {
+		case -1:
+			if (bit) {
 				/* ramp up from 0 */
 				do {
 					*spl++ = cnetz->fsk_ramp_up[(uint8_t)phase] / 2 + deviation / 2;
@@ -329,8 +445,8 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
 				phase -= 256.0;
 			}
 			break;
-		case '1':
-			if (bits[i] == '1') {
+		case 1:
+			if (bit) {
 				/* stay up */
 				do {
 					*spl++ = deviation;
@@ -346,8 +462,8 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
 				phase -= 256.0;
 			}
 			break;
-		case '0':
-			if (bits[i] == '1') {
+		case 0:
+			if (bit) {
 				/* ramp up */
 				do {
 					*spl++ = cnetz->fsk_ramp_up[(uint8_t)phase];
@@ -364,10 +480,10 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
 			}
 			break;
 		}
-		last = bits[i];
+		last = bit;
 	}
 	/* add 7 bits of pause */
-	if (last == '0') {
+	if (last == 0) {
 		/* ramp up to 0 */
 		do {
 			*spl++ = cnetz->fsk_ramp_up[(uint8_t)phase] / 2 - deviation / 2;
@@ -401,6 +517,9 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
 	/* depending on the number of samples, return the number */
 	count = ((uintptr_t)spl - (uintptr_t)cnetz->fsk_tx_buffer) / sizeof(*spl);
 
+	if (ogk)
+		fsk_cache_store(cnetz, bits, ramp_phase, phase - cnetz->fsk_tx_phase, cnetz->fsk_tx_buffer, count);
+
 	cnetz->fsk_tx_phase = phase;
 	cnetz->fsk_tx_buffer_length = count;
 
@@ -408,7 +527,7 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
 }
 
 /* encode one distributed data block into samples
- * input: 184 data bits (including barker code)
+ * input: 184 packed data bits (including barker code)
  * output: samples
  * 	if a sample contains a marker, it indicates where to insert speech block
  * return number of samples
@@ -419,13 +538,13 @@ static int fsk_block_encode(cnetz_t *cnetz, const char *bits, int ogk)
  * the marker marks the point where the speech is ramped up, so the phone
  * will see the speech completely ramped up after the 6th bit
  */
-static int fsk_distributed_encode(cnetz_t *cnetz, const char *bits)
+static int fsk_distributed_encode(cnetz_t *cnetz, const uint64_t *bits)
 {
 	/* alloc samples, add 1 in case there is a rest */
 	sample_t *spl, *marker;
 	double phase, bitstep, deviation;
 	int i, j, count;
-	char last;
+	int bit, last;
 
 	deviation = cnetz->fsk_deviation;
 	spl = cnetz->fsk_tx_buffer;
@@ -459,11 +578,12 @@ static int fsk_distributed_encode(cnetz_t *cnetz, const char *bits)
 			phase += bitstep;
 		} while (phase < 256.0);
 		phase -= 256.0;
-		last = ' ';
+		last = -1;
 		for (j = 0; j < 4; j++) {
+			bit = TELEGRAMM_FRAME_BIT(bits, i * 4 + j);
 			switch (last) {
-			case ' ':
-				if (bits[i * 4 + j] == '1') {
+			case -1:
+				if (bit) {
 					/* ramp up from 0 */
 					do {
 						*spl++ = cnetz->fsk_ramp_up[(uint8_t)phase] / 2 + deviation / 2;
@@ -479,8 +599,8 @@ static int fsk_distributed_encode(cnetz_t *cnetz, const char *bits)
 					phase -= 256.0;
 				}
 				break;
-			case '1':
-				if (bits[i * 4 + j] == '1') {
+			case 1:
+				if (bit) {
 					/* stay up */
 					do {
 						*spl++ = deviation;
@@ -496,8 +616,8 @@ static int fsk_distributed_encode(cnetz_t *cnetz, const char *bits)
 					phase -= 256.0;
 				}
 				break;
-			case '0':
-				if (bits[i * 4 + j] == '1') {
+			case 0:
+				if (bit) {
 					/* ramp up */
 					do {
 						*spl++ = cnetz->fsk_ramp_up[(uint8_t)phase];
@@ -514,10 +634,10 @@ static int fsk_distributed_encode(cnetz_t *cnetz, const char *bits)
 				}
 				break;
 			}
-			last = bits[i * 4 + j];
+			last = bit;
 		}
 		/* ramp down */
-		if (last == '0') {
+		if (last == 0) {
 			/* ramp up to 0 */
 			do {
 				*spl++ = cnetz->fsk_ramp_up[(uint8_t)phase] / 2 - deviation / 2;
@@ -555,7 +675,7 @@ static int fsk_distributed_encode(cnetz_t *cnetz, const char *bits)
 /* decode samples and hut for bit changes
  * use deviation to find greatest slope of the signal (bit change)
  */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db)
 {
 	cnetz_t *cnetz = (cnetz_t *) sender;
 
@@ -572,7 +692,11 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 	return;
 #endif
 
-	if (cnetz->dsp_mode != DSP_MODE_OFF) {
+	if (cnetz->rx_prepared) {
+		/* filter has been applied by dsp_receive() */
+		cnetz->rx_prepared = 0;
+		fsk_fm_demod(&cnetz->fsk_demod, samples, length); /* process */
+	} else if (cnetz->dsp_mode != DSP_MODE_OFF) {
 		iir_process(&cnetz->lp, samples, length);
 		fsk_fm_demod(&cnetz->fsk_demod, samples, length); /* process */
 	} else
@@ -598,8 +722,8 @@ static int shrink_speech(cnetz_t *cnetz, sample_t *speech_buffer)
 		scrambler(&cnetz->scrambler_tx, speech_buffer, speech_length);
 	/* 4. pre-emphasis is done by cnetz code, not by common code */
 	/* pre-emphasis is only used when scrambler is off, see FTZ 171 TR 60 Clause 4 */
-	if (cnetz->pre_emphasis && !cnetz->scrambler)
-		pre_emphasis(&cnetz->estate, speech_buffer, speech_length);
+	else
+		pre_emphasis_gain(&cnetz->estate, speech_buffer, speech_length, cnetz->pre_emphasis, 1.0);
 
 	return speech_length;
 }
@@ -608,7 +732,7 @@ static int fsk_telegramm(cnetz_t *cnetz, sample_t *samples, uint8_t *power, int
 {
 	int count = 0, pos, copy, i, speech_length, speech_pos;
 	sample_t *spl, *speech_buffer;
-	const char *bits;
+	uint64_t bits[3];
 
 	speech_buffer = cnetz->dsp_speech_buffer;
 	speech_length = cnetz->dsp_speech_length;
@@ -667,15 +791,13 @@ again:
 						cnetz->negative_polarity = (cnetz->sched_ts & 7) >> 2;
 					/* set last time slot, so we know to which time slot the message from mobile station belongs to */
 					cnetz->sched_last_ts = cnetz->sched_ts;
-					bits = cnetz_encode_telegramm(cnetz);
-					if (bits) {
+					if (cnetz_encode_telegramm(cnetz, bits)) {
 						LOGP_CHAN(DDSP, LOGL_DEBUG, "Transmitting 'Rufblock' at timeslot %d\n", cnetz->sched_ts);
 						fsk_block_encode(cnetz, bits, 1);
 					} else
 						fsk_nothing_encode(cnetz);
 				} else {
-					bits = cnetz_encode_telegramm(cnetz);
-					if (bits) {
+					if (cnetz_encode_telegramm(cnetz, bits)) {
 						LOGP_CHAN(DDSP, LOGL_DEBUG, "Transmitting 'Meldeblock' at timeslot %d\n", cnetz->sched_ts);
 						fsk_block_encode(cnetz, bits, 1);
 					} else
@@ -686,16 +808,14 @@ again:
 			}
 			break;
 		case DSP_MODE_SPK_K:
-			bits = cnetz_encode_telegramm(cnetz);
-			if (bits) {
+			if (cnetz_encode_telegramm(cnetz, bits)) {
 				LOGP_CHAN(DDSP, LOGL_DEBUG, "Transmitting 'Konzentrierte Signalisierung' at timeslot %d.%d\n", cnetz->sched_ts, cnetz->sched_r_m * 5);
 				fsk_block_encode(cnetz, bits, 0);
 			} else
 				fsk_nothing_encode(cnetz);
 			break;
 		case DSP_MODE_SPK_V:
-			bits = cnetz_encode_telegramm(cnetz);
-			if (bits) {
+			if (cnetz_encode_telegramm(cnetz, bits)) {
 				LOGP_CHAN(DDSP, LOGL_DEBUG, "Transmitting 'Verteilte Signalisierung' starting at timeslot %d\n", cnetz->sched_ts);
 				fsk_distributed_encode(cnetz, bits);
 			} else
@@ -783,7 +903,7 @@ again:
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	cnetz_t *cnetz = (cnetz_t *) sender;
 	int count;
@@ -831,10 +951,10 @@ void unshrink_speech(cnetz_t *cnetz, sample_t *speech_buffer, int count)
 
 	/* 4. de-emphasis is done by cnetz code, not by common code */
 	/* de-emphasis is only used when scrambler is off, see FTZ 171 TR 60 Clause 4 */
-	if (cnetz->de_emphasis)
-		dc_filter(&cnetz->estate, speech_buffer, count);
 	if (cnetz->de_emphasis && !cnetz->scrambler)
-		de_emphasis(&cnetz->estate, speech_buffer, count);
+		de_emphasis_gain(&cnetz->estate, speech_buffer, count, 1, 1.0);
+	else if (cnetz->de_emphasis)
+		dc_filter(&cnetz->estate, speech_buffer, count);
 	/* 3. descramble */
 	if (cnetz->scrambler)
 		scrambler(&cnetz->scrambler_rx, speech_buffer, count);
@@ -895,7 +1015,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (cnetz->dsp_mode == DSP_MODE_SPK_V) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&cnetz->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&cnetz->sender.dejitter, jf);
 	}
@@ -137,9 +137,97 @@ static int debug = 0;
 #include "dsp.h"
 #include "telegramm.h"
 
+/* The slope detector needs level range and highest slope of the window for
+ * every sample. Instead of scanning the window, monotonic deques are used:
+ * A new sample removes all older samples from the back of the queue that
+ * cannot be the maximum (or minimum) anymore, so the front is always the
+ * maximum (or minimum) of the window. The same is done for the absolute
+ * slopes, where equal slopes are kept, so the front is the first of them.
+ *
+ * The scan in find_change_slope() started with a maximum slope of -1, so a
+ * window that starts with a run of rising negative slopes (all above -1)
+ * took the last slope of that run, rather than the steepest one. To get
+ * exactly the same decision, the positions where such a run breaks are
+ * queued, and the highest slope is searched from there on.
+ */
+static inline void window_pop(fsk_win_queue_t *q, uint32_t mask, uint32_t first)
+{
+	while (q->head != q->tail && (int32_t)(q->seq[q->head & mask] - first) < 0)
+		q->head++;
+}
+
+static inline void window_push(fsk_fm_demod_t *fsk, sample_t s)
+{
+	uint32_t mask = fsk->win_mask, n = fsk->win_seq++;
+	uint32_t first = n + 1 - fsk->bit_buffer_len; /* first sample of window */
+	fsk_win_queue_t *q;
+	sample_t d, last_d, a;
+
+	d = s - fsk->win_spl[(n - 1) & mask];
+	last_d = fsk->win_diff[(n - 1) & mask];
+	fsk->win_spl[n & mask] = s;
+	fsk->win_diff[n & mask] = d;
+
+	q = &fsk->win_max;
+	while (q->head != q->tail && fsk->win_spl[q->seq[(q->tail - 1) & mask] & mask] <= s)
+		q->tail--;
+	q->seq[q->tail++ & mask] = n;
+	window_pop(q, mask, first);
+
+	q = &fsk->win_min;
+	while (q->head != q->tail && fsk->win_spl[q->seq[(q->tail - 1) & mask] & mask] >= s)
+		q->tail--;
+	q->seq[q->tail++ & mask] = n;
+	window_pop(q, mask, first);
+
+	/* slope of first sample in window is not used */
+	a = fabs(d);
+	q = &fsk->win_slope;
+	while (q->head != q->tail && fabs(fsk->win_diff[q->seq[(q->tail - 1) & mask] & mask]) < a)
+		q->tail--;
+	q->seq[q->tail++ & mask] = n;
+	window_pop(q, mask, first + 1);
+
+	q = &fsk->win_break;
+	if (!(d > last_d && d < 0))
+		q->seq[q->tail++ & mask] = n;
+	window_pop(q, mask, first + 2);
+}
+
+/* get level range and highest slope of window, same result as scanning
+ * the window from the oldest sample, see find_change_slope() */
+static inline void window_change(fsk_fm_demod_t *fsk, sample_t *level_min, sample_t *level_max, int *change_at, int *change_positive)
+{
+	uint32_t mask = fsk->win_mask;
+	uint32_t first = fsk->win_seq - fsk->bit_buffer_len; /* first sample of window */
+	uint32_t from, head;
+	sample_t d;
+
+	*level_max = fsk->win_spl[fsk->win_max.seq[fsk->win_max.head & mask] & mask];
+	*level_min = fsk->win_spl[fsk->win_min.seq[fsk->win_min.head & mask] & mask];
+
+	/* skip a run of rising negative slopes at the start of the window */
+	from = first + 1;
+	d = fsk->win_diff[from & mask];
+	if (d > -1.0 && d < 0) {
+		if (fsk->win_break.head == fsk->win_break.tail) {
+			*change_at = fsk->bit_buffer_len - 1;
+			*change_positive = 1;
+			return;
+		}
+		from = fsk->win_break.seq[fsk->win_break.head & mask];
+	}
+
+	head = fsk->win_slope.head;
+	while ((int32_t)(fsk->win_slope.seq[head & mask] - from) < 0)
+		head++;
+	*change_at = fsk->win_slope.seq[head & mask] - first;
+	*change_positive = (fsk->win_diff[fsk->win_slope.seq[head & mask] & mask] >= 0);
+}
+
 int fsk_fm_init(fsk_fm_demod_t *fsk, cnetz_t *cnetz, int samplerate, double bitrate, enum demod_type demod)
 {
-	int len, half;
+	int len, half, size, i;
 
 	memset(fsk, 0, sizeof(*fsk));
 	if (samplerate < 48000) {
@@ -172,6 +260,23 @@ int fsk_fm_init(fsk_fm_demod_t *fsk, cnetz_t *cnetz, int samplerate, double bitr
 
 	fsk->bit_buffer_len = len;
 	fsk->bit_buffer_half = half;
+
+	for (size = 1; size < len + 1; size <<= 1)
+		;
+	fsk->win_mask = size - 1;
+	fsk->win_spl = calloc(sizeof(fsk->win_spl[0]), size * 2);
+	fsk->win_max.seq = calloc(sizeof(fsk->win_max.seq[0]), size * 4);
+	if (!fsk->win_spl || !fsk->win_max.seq) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		goto error;
+	}
+	fsk->win_diff = fsk->win_spl + size;
+	fsk->win_min.seq = fsk->win_max.seq + size;
+	fsk->win_slope.seq = fsk->win_max.seq + size * 2;
+	fsk->win_break.seq = fsk->win_max.seq + size * 3;
+	/* window starts with zeroes, like bit_buffer_spl */
+	for (i = 0; i < len; i++)
+		window_push(fsk, 0);
 	fsk->bits_per_sample = bitrate / (double)samplerate;
 
 	fsk->speech_size = samplerate * 60 / bitrate + 10; /* 60 bits duration, add 10 to be safe */
@@ -214,6 +319,19 @@ void fsk_fm_exit(fsk_fm_demod_t *fsk)
 		free(fsk->speech_buffer);
 		fsk->speech_buffer = NULL;
 	}
+	if (fsk->win_spl) {
+		free(fsk->win_spl);
+		fsk->win_spl = NULL;
+	}
+	if (fsk->win_max.seq) {
+		free(fsk->win_max.seq);
+		fsk->win_max.seq = NULL;
+	}
+	free(fsk->pre_range);
+	fsk->pre_range = NULL;
+	free(fsk->pre_change);
+	fsk->pre_change = NULL;
+	fsk->pre_size = 0;
 
 #ifdef DEBUG_DECODER
 	if (fsk->debug_fp) {
@@ -373,6 +491,7 @@ got_sync:
 			fsk->level_threshold = (double)avg;
 			fsk->rx_sync = 0;
 			fsk->rx_buffer_count = 0;
+			memset(fsk->rx_buffer, 0, sizeof(fsk->rx_buffer));
 			break;
 		}
 		if (detect_sync(fsk->rx_sync ^ 0xfffffffff)) {
@@ -384,8 +503,8 @@ got_sync:
 		bit = 1 - bit;
 		/* FALLTHRU */
 	case FSK_SYNC_POSITIVE:
-		fsk->rx_buffer[fsk->rx_buffer_count] = bit + '0';
-		if (++fsk->rx_buffer_count == 150) {
+		TELEGRAMM_BLOCK_SET(fsk->rx_buffer, fsk->rx_buffer_count, bit);
+		if (++fsk->rx_buffer_count == TELEGRAMM_BLOCK_BITS) {
 			fsk->sync = FSK_SYNC_NONE;
 #ifdef DEBUG_DECODER
 			if (debug)
@@ -411,36 +530,22 @@ got_sync:
 /* find bit change by checking slope within a window */
 static inline void find_change_slope(fsk_fm_demod_t *fsk)
 {
-	sample_t level_min = 0, level_max = 0, change_max = -1;
-	int change_at = -1, change_positive = -1;
-	sample_t s, last_s = 0;
+	sample_t level_min, level_max, range;
+	int change_at, change_positive;
 	sample_t threshold;
-	int i;
-	
+
 	/* get level range (level_min and level_max) and also
-	 * get maximum slope (change_max) and where it was
-	 * (change_at) and what direction it went (change_positive)
+	 * get maximum slope, where it was (change_at) and what
+	 * direction it went (change_positive)
 	 */
-	for (i = 0; i < fsk->bit_buffer_len; i++) {
-		last_s = s;
-		s = fsk->bit_buffer_spl[fsk->bit_buffer_pos++];
-		if (fsk->bit_buffer_pos == fsk->bit_buffer_len)
-			fsk->bit_buffer_pos = 0;
-		if (i > 0) {
-			if (s - last_s > change_max) {
-				change_max = s - last_s;
-				change_at = i;
-				change_positive = 1;
-			} else if (last_s - s > change_max) {
-				change_max = last_s - s;
-				change_at = i;
-				change_positive = 0;
-			}
-		}
-		if (i == 0 || s > level_max)
-			level_max = s;
-		if (i == 0 || s < level_min)
-			level_min = s;
+	if (fsk->pre_num) {
+		/* window has been evaluated in advance, see fsk_fm_prepare() */
+		range = fsk->pre_range[fsk->pre_pos];
+		change_at = (fsk->pre_change[fsk->pre_pos] & 1) ? fsk->bit_buffer_half : -1;
+		change_positive = fsk->pre_change[fsk->pre_pos] >> 1;
+	} else {
+		window_change(fsk, &level_min, &level_max, &change_at, &change_positive);
+		range = level_max - level_min;
 	}
 	/* for first bit, we have only half of the modulation deviation, so we divide the threshold by two */
 	if (fsk->cnetz->dsp_mode == DSP_MODE_SPK_V && fsk->bit_count == 0)
@@ -454,20 +559,20 @@ static inline void find_change_slope(fsk_fm_demod_t *fsk)
 	 * if we are in sync, we remember last change. after 1.5
 	 * bits after sync average, we measure the first bit
 	 * and then all subsequent bits after 1.0 bits */
-	if (level_max - level_min > threshold && change_at == fsk->bit_buffer_half) {
+	if (range > threshold && change_at == fsk->bit_buffer_half) {
 #ifdef DEBUG_DECODER
 		if (debug) {
 			fprintf(fsk->debug_fp, " CHANGE %d->%d (level=%.3f, threshold=%.3f)",
 				fsk->last_change_positive,
 				change_positive,
-				level_max - level_min,
+				range,
 				threshold);
 		}
 #endif
 		fsk->last_change_positive = change_positive;
 		if (!fsk->sync) {
 			fsk->next_bit = 1.5;
-			got_bit(fsk, change_positive, (level_max - level_min) / 2.0);
+			got_bit(fsk, change_positive, range / 2.0);
 		}
 	}
 	if (fsk->next_bit <= 0.0) {
@@ -554,6 +659,47 @@ done:
 	return;
 }
 
+/* Evaluate the window of slope detection for each sample in advance. This
+ * depends on received samples only, not on sync or protocol state, so it
+ * can be done in parallel with other channels. fsk_fm_demod() must be called
+ * with the same samples afterwards.
+ */
+void fsk_fm_prepare(fsk_fm_demod_t *fsk, sample_t *samples, int length)
+{
+	sample_t level_min, level_max;
+	int change_at, change_positive;
+	int i;
+
+	fsk->pre_num = 0;
+	if (fsk->demod_type != FSK_DEMOD_SLOPE)
+		return;
+
+	if (length > fsk->pre_size) {
+		sample_t *range;
+		uint8_t *change;
+
+		range = realloc(fsk->pre_range, length * sizeof(*range));
+		if (range)
+			fsk->pre_range = range;
+		change = realloc(fsk->pre_change, length * sizeof(*change));
+		if (change)
+			fsk->pre_change = change;
+		if (!range || !change) {
+			LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+			return;
+		}
+		fsk->pre_size = length;
+	}
+
+	for (i = 0; i < length; i++) {
+		window_push(fsk, samples[i]);
+		window_change(fsk, &level_min, &level_max, &change_at, &change_positive);
+		fsk->pre_range[i] = level_max - level_min;
+		fsk->pre_change[i] = (change_at == fsk->bit_buffer_half) | (change_positive << 1);
+	}
+	fsk->pre_num = length;
+}
+
 /* receive FM signal from receiver */
 void fsk_fm_demod(fsk_fm_demod_t *fsk, sample_t *samples, int length)
 {
@@ -567,6 +713,10 @@ void fsk_fm_demod(fsk_fm_demod_t *fsk, sample_t *samples, int length)
 			fsk->bit_buffer_spl[fsk->bit_buffer_pos++] = samples[i];
 			if (fsk->bit_buffer_pos == fsk->bit_buffer_len)
 				fsk->bit_buffer_pos = 0;
+			if (fsk->pre_num)
+				fsk->pre_pos = i;
+			else if (fsk->demod_type == FSK_DEMOD_SLOPE)
+				window_push(fsk, samples[i]);
 
 #ifdef DEBUG_DECODER
 			/* show deviation of center sample in window */
@@ -646,6 +796,7 @@ void fsk_fm_demod(fsk_fm_demod_t *fsk, sample_t *samples, int length)
 			calc_clock_speed(fsk->cnetz, (double)fsk->cnetz->sender.samplerate * 2.4, 0, 1);
 		}
 	}
+	fsk->pre_num = 0;
 }
 
 void fsk_correct_sync(fsk_fm_demod_t *fsk, double offset)
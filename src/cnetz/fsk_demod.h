@@ -16,6 +16,12 @@ enum demod_type {
 	FSK_DEMOD_LEVEL, /* check for zero crossing (good for SDR) */
 };
 
+/* queue of sample numbers, used as monotonic deque */
+typedef struct fsk_win_queue {
+	uint32_t	*seq;			/* ring of sample numbers */
+	uint32_t	head, tail;		/* read and write counter */
+} fsk_win_queue_t;
+
 typedef struct fsk_fm_demod {
 	cnetz_t		*cnetz;			/* pointer back to cnetz instance */
 
@@ -29,6 +35,18 @@ typedef struct fsk_fm_demod {
 	int		bit_buffer_len;		/* number of samples in ring buffer */
 	int		bit_buffer_half;	/* half of ring buffer */
 	int		bit_buffer_pos;		/* current position to write next sample */
+	uint32_t	win_seq;		/* number of next sample in window */
+	uint32_t	win_mask;		/* size of window rings - 1 */
+	sample_t	*win_spl;		/* ring of samples */
+	sample_t	*win_diff;		/* ring of slopes from previous sample */
+	fsk_win_queue_t	win_max, win_min;	/* candidates for level range */
+	fsk_win_queue_t	win_slope;		/* candidates for highest slope */
+	fsk_win_queue_t	win_break;		/* where a run of rising negative slopes breaks */
+	int		pre_num;		/* number of samples with window evaluated in advance */
+	int		pre_pos;		/* current sample of these */
+	int		pre_size;		/* size of arrays */
+	sample_t	*pre_range;		/* level range of window */
+	uint8_t		*pre_change;		/* bit 0: change in the middle of window, bit 1: change is positive */
 	double		level_threshold;	/* threshold for detection of next level change */
 	double		bits_per_sample;	/* duration of one sample in bits */
 	double		next_bit;		/* count time to detect bits */
@@ -46,7 +64,7 @@ typedef struct fsk_fm_demod {
 
 	/* bit decoder */
 	uint64_t	rx_sync;		/* sync shift register */
-	char		rx_buffer[151];		/* 150 bits + termination */
+	uint64_t	rx_buffer[3];		/* 150 bits, see telegramm.h */
 	int		rx_buffer_count;	/* counter when receiving bits */
 
 	/* statistics */
@@ -64,6 +82,7 @@ typedef struct fsk_fm_demod {
 
 int fsk_fm_init(fsk_fm_demod_t *fsk, cnetz_t *cnetz, int samplerate, double bitrate, enum demod_type);
 void fsk_fm_exit(fsk_fm_demod_t *fsk);
+void fsk_fm_prepare(fsk_fm_demod_t *fsk, sample_t *samples, int length);
 void fsk_fm_demod(fsk_fm_demod_t *fsk, sample_t *samples, int length);
 void fsk_correct_sync(fsk_fm_demod_t *fsk, double offset);
 void fsk_copy_sync(fsk_fm_demod_t *fsk_to, fsk_fm_demod_t *fsk_from);
@@ -0,0 +1,14 @@
+
+/* subscribers are indexed by FuTln, used by C-Netz database and FuVSt */
+#define FUTLN_HASH_SIZE	4096	/* must be power of 2 */
+
+static inline unsigned int hash_futln(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
+{
+	uint32_t x = ((uint32_t)futln_nat << 21) | ((uint32_t)futln_fuvst << 16) | futln_rest;
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (FUTLN_HASH_SIZE - 1);
+}
+
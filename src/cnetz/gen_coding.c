@@ -0,0 +1,303 @@
+/* generate C-Netz coding tables at build time
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This program runs on the build host. It writes the tables as constant C
+ * arrays to stdout, so they are placed in read-only memory and need no
+ * initialization at run time. An error in the definitions fails the build.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+static const char *barker_string = "11100010010";
+static const int16_t barker_code = 0x712; /* 11 bits: 11100010010 */
+
+static const char *blockcode[128] = {
+/*	 0123456 = Nutzbits */
+/*	           01234567 = Redundanzbits */
+	"0000000" "00000000",
+	"1000000" "11101000",
+	"0100000" "01110100",
+	"1100000" "10011100",
+	"0010000" "00111010",
+	"1010000" "11010010",
+	"0110000" "01001110",
+	"1110000" "10100110",
+	"0001000" "00011101",
+	"1001000" "11110101",
+	"0101000" "01101001",
+	"1101000" "10000001",
+	"0011000" "00100111",
+	"1011000" "11001111",
+	"0111000" "01010011",
+	"1111000" "10111011",
+	"0000100" "11100110",
+	"1000100" "00001110",
+	"0100100" "10010010",
+	"1100100" "01111010",
+	"0010100" "11011100",
+	"1010100" "00110100",
+	"0110100" "10101000",
+	"1110100" "01000000",
+	"0001100" "11111011",
+	"1001100" "00010011",
+	"0101100" "10001111",
+	"1101100" "01100111",
+	"0011100" "11000001",
+	"1011100" "00101001",
+	"0111100" "10110101",
+	"1111100" "01011101",
+	"0000010" "01110011",
+	"1000010" "10011011",
+	"0100010" "00000111",
+	"1100010" "11101111",
+	"0010010" "01001001",
+	"1010010" "10100001",
+	"0110010" "00111101",
+	"1110010" "11010101",
+	"0001010" "01101110",
+	"1001010" "10000110",
+	"0101010" "00011010",
+	"1101010" "11110010",
+	"0011010" "01010100",
+	"1011010" "10111100",
+	"0111010" "00100000",
+	"1111010" "11001000",
+	"0000110" "10010101",
+	"1000110" "01111101",
+	"0100110" "11100001",
+	"1100110" "00001001",
+	"0010110" "10101111",
+	"1010110" "01000111",
+	"0110110" "11011011",
+	"1110110" "00110011",
+	"0001110" "10001000",
+	"1001110" "01100000",
+	"0101110" "11111100",
+	"1101110" "00010100",
+	"0011110" "10110010",
+	"1011110" "01011010",
+	"0111110" "11000110",
+	"1111110" "00101110",
+	"0000001" "11010001",
+	"1000001" "00111001",
+	"0100001" "10100101",
+	"1100001" "01001101",
+	"0010001" "11101011",
+	"1010001" "00000011",
+	"0110001" "10011111",
+	"1110001" "01110111",
+	"0001001" "11001100",
+	"1001001" "00100100",
+	"0101001" "10111000",
+	"1101001" "01010000",
+	"0011001" "11110110",
+	"1011001" "00011110",
+	"0111001" "10000010",
+	"1111001" "01101010",
+	"0000101" "00110111",
+	"1000101" "11011111",
+	"0100101" "01000011",
+	"1100101" "10101011",
+	"0010101" "00001101",
+	"1010101" "11100101",
+	"0110101" "01111001",
+	"1110101" "10010001",
+	"0001101" "00101010",
+	"1001101" "11000010",
+	"0101101" "01011110",
+	"1101101" "10110110",
+	"0011101" "00010000",
+	"1011101" "11111000",
+	"0111101" "01100100",
+	"1111101" "10001100",
+	"0000011" "10100010",
+	"1000011" "01001010",
+	"0100011" "11010110",
+	"1100011" "00111110",
+	"0010011" "10011000",
+	"1010011" "01110000",
+	"0110011" "11101100",
+	"1110011" "00000100",
+	"0001011" "10111111",
+	"1001011" "01010111",
+	"0101011" "11001011",
+	"1101011" "00100011",
+	"0011011" "10000101",
+	"1011011" "01101101",
+	"0111011" "11110001",
+	"1111011" "00011001",
+	"0000111" "01000100",
+	"1000111" "10101100",
+	"0100111" "00110000",
+	"1100111" "11011000",
+	"0010111" "01111110",
+	"1010111" "10010110",
+	"0110111" "00001010",
+	"1110111" "11100010",
+	"0001111" "01011001",
+	"1001111" "10110001",
+	"0101111" "00101101",
+	"1101111" "11000101",
+	"0011111" "01100011",
+	"1011111" "10001011",
+	"0111111" "00010111",
+	"1111111" "11111111",
+};
+
+static uint8_t barker_decode[2048]; /* detected bits */
+static uint16_t block_code[128];
+static uint16_t block_decode[32768]; /* code word + flag / 0xffff=decode error */
+static uint64_t interleave_spread[32]; /* spread 5 bits to every 10th bit */
+static uint64_t sync_bits; /* 33 bits sync + 1, first bit is LSB */
+
+static int gen_tables(void)
+{
+	int i, j, k;
+
+	/* create table to decode barker code.
+	 * ech table entry returns the number of detected bits */
+	for (i = 0; i < 2048; i++) {
+		int match = 0;
+		for (j = 0; j < 11; j++) {
+			/* check if i matches barker code at given bit j */
+			if (((i ^ barker_code) & (0x400 >> j)) == 0)
+				match++;
+		}
+		barker_decode[i] = match;
+	}
+
+	/* create sync bits and table to spread code word bits for interleaving */
+	sync_bits = (uint64_t)1 << 33;
+	for (i = 0; i < 33; i++) {
+		if (barker_string[i % 11] == '1')
+			sync_bits |= (uint64_t)1 << i;
+	}
+	for (i = 0; i < 32; i++) {
+		interleave_spread[i] = 0;
+		for (j = 0; j < 5; j++) {
+			if ((i & (1 << j)))
+				interleave_spread[i] |= (uint64_t)1 << (j * 10);
+		}
+	}
+
+	/* convert string to block code words */
+	for (i = 0; i < 128; i++) {
+		int word = 0;
+		for (j = 0; j < 15; j++)
+			word = (word << 1) + (blockcode[i][14 - j] - '0');
+		if ((word & 0x7f) != i) {
+			fprintf(stderr, "Databits are wrong, expecting %d, but got %d\n", i, word & 0x7f);
+			return -1;
+		}
+		block_code[i] = word;
+	}
+
+	/* check if redundancy of a single bit matches the combined redundancy */
+	for (i = 0; i < 128; i++) {
+		int r = 0;
+		for (j = 0; j < 7; j++) {
+			if ((i & (1 << j)))
+				r ^= block_code[1 << j] >> 7;
+		}
+		if (r != block_code[i] >> 7) {
+			fprintf(stderr, "Redundancy bits are wrong\n");
+			return -1;
+		}
+	}
+
+	/* create table to decode one block code and return value + error */
+	/* set all combinations invalid */
+	for (i = 0; i < 32768; i++)
+		block_decode[i] = 0xffff;
+	for (i = 0; i < 128; i++) {
+		int word;
+		/* set all error free combinations valid */
+		word = block_code[i];
+		if (block_decode[word] != 0xffff) {
+			fprintf(stderr, "Overlap, please fix!\n");
+			return -1;
+		}
+		block_decode[word] = i;
+		/* set all one bit error combinations valid with flag */
+		for (j = 0; j < 15; j++) {
+			word = block_code[i];
+			word ^= (1 << j);
+			if (block_decode[word] != 0xffff) {
+				fprintf(stderr, "Overlap, please fix!\n");
+				return -1;
+			}
+			block_decode[word] = i | 0x100; /* indicate 1 error */
+			/* set all two bit error combinations valid with flag */
+			for (k = j + 1; k < 15; k++) {
+				word = block_code[i];
+				word ^= (1 << j) | (1 << k);
+				if (block_decode[word] != 0xffff) {
+					fprintf(stderr, "Overlap, please fix!\n");
+					return -1;
+				}
+				block_decode[word] = i | 0x200; /* indicate 2 errors */
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void print_table(const char *type, const char *name, const uint64_t *values, int num, int width)
+{
+	int i;
+
+	printf("static const %s %s[%d] = {", type, name, num);
+	for (i = 0; i < num; i++) {
+		if (!(i % width))
+			printf("\n\t");
+		else
+			printf(" ");
+		printf("0x%" PRIx64 ",", values[i]);
+	}
+	printf("\n};\n\n");
+}
+
+int main(void)
+{
+	static uint64_t values[32768];
+	int i;
+
+	if (gen_tables() < 0)
+		return 1;
+
+	printf("/* generated by gen_coding, do not edit */\n\n");
+	for (i = 0; i < 2048; i++)
+		values[i] = barker_decode[i];
+	print_table("uint8_t", "barker_decode", values, 2048, 16);
+	for (i = 0; i < 128; i++)
+		values[i] = block_code[i];
+	print_table("uint16_t", "block_code", values, 128, 12);
+	for (i = 0; i < 32768; i++)
+		values[i] = block_decode[i];
+	print_table("uint16_t", "block_decode", values, 32768, 12);
+	for (i = 0; i < 32; i++)
+		values[i] = interleave_spread[i];
+	print_table("uint64_t", "interleave_spread", values, 32, 4);
+	printf("static const uint64_t sync_bits = 0x%" PRIx64 "ULL;\n", sync_bits);
+
+	return 0;
+}
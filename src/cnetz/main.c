@@ -24,6 +24,7 @@
 #include <errno.h>
 #include "../libsample/sample.h"
 #include "../libmobile/main_mobile.h"
+#include "../libmobile/startup.h"
 #include "../liblogging/logging.h"
 #include "../libmobile/call.h"
 #include "../anetz/freiton.h"
@@ -31,6 +32,8 @@
 #include "../liboptions/options.h"
 #include "../libfm/fm.h"
 #include "cnetz.h"
+#include "../libmobile/reconfig.h"
+#include "../libmobile/checkpoint.h"
 #include "database.h"
 #include "sysinfo.h"
 #include "dsp.h"
@@ -40,7 +43,7 @@
 
 /* settings */
 int num_chan_type = 0;
-enum cnetz_chan_type chan_type[MAX_SENDER] = { CHAN_TYPE_OGK_SPK };
+enum cnetz_chan_type *chan_type = NULL;
 int measure_speed = 0;
 double clock_speed[2] = { 0.0, 0.0 };
 int set_clock_speed = 0;
@@ -73,6 +76,8 @@ uint8_t reduzierung = 0; /* factor 4 */
 uint8_t nachbar_prio = 0;
 int8_t	futln_sperre_start = -1; /* no blocking */
 int8_t	futln_sperre_end = -1; /* no range */
+int teilnehmergruppensperre = 0;
+int anzahl_gesperrter_teilnehmergruppen = 0;
 int meldeinterval = 120; /* when to ask the phone about beeing alive */
 int meldeaufrufe = 3; /* how many times to ask phone about beeing alive */
 enum demod_type demod = FSK_DEMOD_AUTO;
@@ -84,7 +89,7 @@ void print_help(const char *arg0)
 	main_mobile_print_help(arg0, "[-M] -S <rx ppm>,<tx ppm> -p -d ");
 	/*      -                                                                             - */
 	printf(" -T --channel-type <channel type> | list\n");
-	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(chan_type[0]));
+	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(CHAN_TYPE_OGK_SPK));
 	printf("        You must define at least one OgK at channel 131. This channel may be a\n");
 	printf("        a combined OgK+SpK channel, but this works with older phones only.\n");
 	printf("        You must define additionally one or more SpK, in order to make calls.\n");
@@ -500,14 +505,44 @@ static const char *number_prefixes[] = {
 	NULL
 };
 
+static void calc_futln_sperre(void)
+{
+	if (futln_sperre_start >= 0) {
+		teilnehmergruppensperre = futln_sperre_start;
+		if (futln_sperre_end >= 0)
+			anzahl_gesperrter_teilnehmergruppen = ((futln_sperre_end - futln_sperre_start) & 0xf) + 1;
+		else
+			anzahl_gesperrter_teilnehmergruppen = 1;
+	}
+}
+
+/* change system information via control socket, IDs and timeslots are not changed while on air */
+static int set_sysinfo(sender_t __attribute__((unused)) *sender, const char *value)
+{
+	static const char *safe[] = { "ws-kennung=", "fuvst-sperren=", "grenz-einbuchen=", "grenz-umschalten=", "grenz-ausloesen=", "mittel-umschalten=", "mittel-ausloesen=", "genauigkeit=", "bewertung=", "entfernung=", "nachbar-prio=", "futln-sperre=", "meldeinterval=", "meldeaufrufe=", NULL };
+	char *argv[1] = { (char *)value };
+	int i;
+
+	for (i = 0; safe[i]; i++) {
+		if (!strncasecmp(value, safe[i], strlen(safe[i])))
+			break;
+	}
+	if (!safe[i])
+		return -EINVAL;
+	if (handle_options('S', 0, argv) < 0)
+		return -EINVAL;
+	calc_futln_sperre();
+	init_sysinfo(si.timeslots, fuz_nat, fuz_fuvst, fuz_rest, kennung_fufst, bahn_bs, authentifikationsbit, ws_kennung, fuvst_sperren, grenz_einbuchen, grenz_umschalten, grenz_ausloesen, mittel_umschalten, mittel_ausloesen, genauigkeit, bewertung, entfernung, reduzierung, nachbar_prio, teilnehmergruppensperre, anzahl_gesperrter_teilnehmergruppen, meldeinterval, meldeaufrufe);
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int rc, argi;
 	const char *station_id = NULL;
 	int mandatory = 0;
 	int polarity;
-	int teilnehmergruppensperre = 0;
-	int anzahl_gesperrter_teilnehmergruppen = 0;
 	int i;
 
 	/* init common tones */
@@ -527,6 +562,7 @@ int main(int argc, char *argv[])
 	argi = options_command_line(argc, argv, handle_options);
 	if (argi <= 0)
 		return argi;
+	startup_step("options");
 
 	if (argi < argc) {
 		station_id = argv[argi];
@@ -558,32 +594,31 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 		/* set channel types for more than 1 channel */
 		if (num_kanal > 1 && num_chan_type == 0) {
-			chan_type[0] = CHAN_TYPE_OGK;
+			OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_OGK)
 			for (i = 1; i < num_kanal; i++)
-				chan_type[i] = CHAN_TYPE_SPK;
-			num_chan_type = num_kanal;
+				OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_SPK)
 		}
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
 	}
 	if (num_kanal == 1 && num_chan_type == 0)
-		num_chan_type = 1; /* use default */
+		OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_OGK_SPK) /* use default */
 	if (num_kanal != num_chan_type) {
 		fprintf(stderr, "You need to specify as many channel types as you have channels.\n");
 		exit(0);
 	}
 
-	if (!set_clock_speed && !measure_speed && !use_sdr) {
-		printf("No clock speed given. You need to measure clock using '-M' and later correct clock using '-S <rx ppm>,<tx ppm>'. See documentation for help!\n\n");
+	if (!set_clock_speed && !measure_speed && !use_sdr && !clock_drift) {
+		printf("No clock speed given. You need to measure clock using '-M' and later correct clock using '-S <rx ppm>,<tx ppm>' or use '--clock-drift'. See documentation for help!\n\n");
 		mandatory = 1;
 	}
 
@@ -594,14 +629,10 @@ int main(int argc, char *argv[])
 
 	/* inits */
 	fm_init(fast_math);
+	startup_step("fm_init");
 	scrambler_init();
-	if (futln_sperre_start >= 0) {
-		teilnehmergruppensperre = futln_sperre_start;
-		if (futln_sperre_end >= 0)
-			anzahl_gesperrter_teilnehmergruppen = ((futln_sperre_end - futln_sperre_start) & 0xf) + 1;
-		else
-			anzahl_gesperrter_teilnehmergruppen = 1;
-	}
+	startup_step("scrambler_init");
+	calc_futln_sperre();
     	if (anzahl_gesperrter_teilnehmergruppen)
 		printf("Blocked subscriber with number's last 4 bits from 0x%x to 0x%x\n", teilnehmergruppensperre, (teilnehmergruppensperre + anzahl_gesperrter_teilnehmergruppen - 1) & 0xf);
 	switch(timeslots) {
@@ -611,13 +642,15 @@ int main(int argc, char *argv[])
 		default: timeslots=0x11111111;
 	}
 	init_sysinfo(timeslots, fuz_nat, fuz_fuvst, fuz_rest, kennung_fufst, bahn_bs, authentifikationsbit, ws_kennung, fuvst_sperren, grenz_einbuchen, grenz_umschalten, grenz_ausloesen, mittel_umschalten, mittel_ausloesen, genauigkeit, bewertung, entfernung, reduzierung, nachbar_prio, teilnehmergruppensperre, anzahl_gesperrter_teilnehmergruppen, meldeinterval, meldeaufrufe);
+	reconfig_add("sysinfo", 0, set_sysinfo, "System information like '-S', except IDs and timeslots");
 	dsp_init();
+	startup_step("dsp_init");
 	rc = init_telegramm();
 	if (rc < 0) {
 		fprintf(stderr, "Error in Telegramm structure. Quitting!\n");
 		goto fail;
 	}
-	init_coding();
+	startup_step("init_telegramm");
 	cnetz_init();
 
 	/* check for mandatory standard OgK */
@@ -692,6 +725,11 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	startup_step("create instances");
+
+	/* attached subscribers survive a restart, if checkpoint is enabled */
+	checkpoint_add("CNDB", save_db, restore_db);
+
 	main_mobile_loop("cnetz", &quit, NULL, station_id);
 
 fail:
@@ -2133,8 +2133,65 @@ static struct cnetz_stations {
 	{ "",					"",		0,	0,	0,	},
 };
 
+/* number of stations, without the terminating entry */
+#define STATION_NUM	((int)(sizeof(cnetz_stations) / sizeof(cnetz_stations[0])) - 1)
+
+/* index of stations by cell ID and by names, created by init_station() */
+#define STATION_HASH_SIZE	4096	/* must be power of 2 */
+static int station_hash[STATION_HASH_SIZE];
+static int station_hash_next[STATION_NUM];
+static int station_by_name[STATION_NUM];
+static int station_by_long_name[STATION_NUM];
+
+static inline uint32_t hash_station(uint8_t nat, uint8_t fuvst, uint8_t rest)
+{
+	uint32_t x = ((uint32_t)nat << 16) | ((uint32_t)fuvst << 8) | rest;
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (STATION_HASH_SIZE - 1);
+}
+
+/* sort by name, equal names are kept in order of the list */
+static int compare_name(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+	int rc;
+
+	rc = strcasecmp(cnetz_stations[x].name, cnetz_stations[y].name);
+	return (rc) ? rc : x - y;
+}
+
+static int compare_long_name(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+	int rc;
+
+	rc = strcasecmp(cnetz_stations[x].long_name, cnetz_stations[y].long_name);
+	return (rc) ? rc : x - y;
+}
+
 void init_station(void)
 {
+	uint32_t h;
+	int i;
+
+	for (i = 0; i < STATION_HASH_SIZE; i++)
+		station_hash[i] = -1;
+	/* insert backwards, so the first of equal IDs is found first */
+	for (i = STATION_NUM - 1; i >= 0; i--) {
+		h = hash_station(cnetz_stations[i].nat, cnetz_stations[i].fuvst, cnetz_stations[i].rest);
+		station_hash_next[i] = station_hash[h];
+		station_hash[h] = i;
+	}
+
+	for (i = 0; i < STATION_NUM; i++) {
+		station_by_name[i] = i;
+		station_by_long_name[i] = i;
+	}
+	qsort(station_by_name, STATION_NUM, sizeof(*station_by_name), compare_name);
+	qsort(station_by_long_name, STATION_NUM, sizeof(*station_by_long_name), compare_long_name);
 }
 
 void station_list(void)
@@ -2159,10 +2216,9 @@ void station_list(void)
 
 const char *get_station_name(uint8_t nat, uint8_t fuvst, uint8_t rest, const char **long_name)
 {
-
 	int i;
 
-	for (i = 0; cnetz_stations[i].long_name[0]; i++) {
+	for (i = station_hash[hash_station(nat, fuvst, rest)]; i >= 0; i = station_hash_next[i]) {
 		if (cnetz_stations[i].nat == nat
 		 && cnetz_stations[i].fuvst == fuvst
 		 && cnetz_stations[i].rest == rest) {
@@ -2176,27 +2232,49 @@ const char *get_station_name(uint8_t nat, uint8_t fuvst, uint8_t rest, const cha
 	return *long_name;
 }
 
-const char *get_station_id(const char *name, uint8_t *nat, uint8_t *fuvst, uint8_t *rest)
+/* find stations whose (long) name starts with given prefix, using the sorted index
+ * return the first two of them, in order of the list */
+static void find_prefix(const int *index, int long_names, const char *name, int *first, int *second)
 {
-	int i, found = -1;
+	int len = strlen(name);
+	int low = 0, high = STATION_NUM, mid, i;
 
-	for (i = 0; cnetz_stations[i].name[0]; i++) {
-		/* check for given prefix */
-		if (!strncasecmp(cnetz_stations[i].name, name, strlen(name))
-		 || !strncasecmp(cnetz_stations[i].long_name, name, strlen(name)) ) {
-			/* found twice */
-			if (found >= 0)
-				return "Given station name is ambiguous, use more letters! Use '-S fuz-name=list' to get a list of all stations.";
-			/* found the first time */
-			found = i;
-			/* check for exact match, so we are done */
-			if (strlen(cnetz_stations[i].name) == strlen(name))
-				break;
-		}
+	/* search first entry that is not below prefix */
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (strncasecmp((long_names) ? cnetz_stations[index[mid]].long_name : cnetz_stations[index[mid]].name, name, len) < 0)
+			low = mid + 1;
+		else
+			high = mid;
 	}
+
+	for (; low < STATION_NUM; low++) {
+		i = index[low];
+		if (strncasecmp((long_names) ? cnetz_stations[i].long_name : cnetz_stations[i].name, name, len))
+			break;
+		if (i == *first || i == *second)
+			continue;
+		if (*first < 0 || i < *first) {
+			*second = *first;
+			*first = i;
+		} else if (*second < 0 || i < *second)
+			*second = i;
+	}
+}
+
+const char *get_station_id(const char *name, uint8_t *nat, uint8_t *fuvst, uint8_t *rest)
+{
+	int found = -1, found2 = -1;
+
+	/* check for given prefix */
+	find_prefix(station_by_name, 0, name, &found, &found2);
+	find_prefix(station_by_long_name, 1, name, &found, &found2);
 	/* mo match */
 	if (found < 0)
 		return "Given station name not found! Use '-S fuz-name=list' to get a list of all stations.\n";
+	/* found twice, unless the first one is an exact match */
+	if (found2 >= 0 && strlen(cnetz_stations[found].name) != strlen(name))
+		return "Given station name is ambiguous, use more letters! Use '-S fuz-name=list' to get a list of all stations.";
 
 	/* here we go */
 	*nat = cnetz_stations[found].nat;
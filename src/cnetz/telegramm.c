@@ -29,6 +29,7 @@
 #include "../libsample/sample.h"
 #include "../liblogging/logging.h"
 #include "cnetz.h"
+#include "../libmobile/frametrace.h"
 #include "dsp.h"
 #include "sysinfo.h"
 #include "telegramm.h"
@@ -458,7 +459,7 @@ int init_telegramm(void)
 
 const char *telegramm2rufnummer(telegramm_t *telegramm)
 {
-	static char rufnummer[32]; /* make GCC happy (overflow check) */
+	static __thread char rufnummer[32]; /* make GCC happy (overflow check) */
 
 	sprintf(rufnummer, "%d%d%05d", telegramm->futln_nationalitaet, telegramm->futln_heimat_fuvst_nr, telegramm->futln_rest_nr);
 
@@ -615,15 +616,30 @@ static void debug_parameter(char digit, uint64_t value)
 		LOGP(DFRAME, LOGL_DEBUG, " (%c) %s : %" PRIu64 "\n", digit, parameter->param_name, value);
 }
 
+/* show 70 bits of telegram, MSB first */
+static void debug_data(const char *string, const uint64_t *data)
+{
+	char debug_bits[71];
+	int i;
+
+	for (i = 0; i < 6; i++)
+		debug_bits[i] = ((data[1] >> (5 - i)) & 1) + '0';
+	for (i = 0; i < 64; i++)
+		debug_bits[69 - i] = ((data[0] >> i) & 1) + '0';
+	debug_bits[70] = '\0';
+	LOGP(DFRAME, LOGL_DEBUG, "OOOOOO%s\n", string);
+	LOGP(DFRAME, LOGL_DEBUG, "%s\n", debug_bits);
+}
+
 /* encode telegram to 70 bits
- * bit order MSB
+ * data[0]: 64 parameter bits, LSB is the last bit of the telegram
+ * data[1]: 6 opcode bits
  */
-static char *assemble_telegramm(const telegramm_t *telegramm, int debug)
+static void assemble_telegramm(const telegramm_t *telegramm, int debug, uint64_t *data)
 {
-	static char bits[71]; /* + termination char for debug */
 	char parameter;
 	const char *string;
-	uint64_t value, val;
+	uint64_t value, mask;
 	int i, j;
 	int rc;
 
@@ -636,17 +652,15 @@ static char *assemble_telegramm(const telegramm_t *telegramm, int debug)
 		LOGP(DFRAME, LOGL_INFO, "Coding %s %s\n", definition_opcode[telegramm->opcode].message_name, definition_opcode[telegramm->opcode].message_text);
 
 	/* copy opcode */
-	for (i = 0; i < 6; i++)
-		bits[5 - i] = (telegramm->opcode & (1 << i)) ? '1' : '0';
+	data[1] = telegramm->opcode;
 
 	/* copy parameters */
+	data[0] = 0;
 	string = definition_opcode[telegramm->opcode].no_auth_bits;
 	for (i = 0; i < 64; i++) {
 		parameter = string[63 - i];
-		if (parameter == '-') {
-			bits[69 - i] = '0';
+		if (parameter == '-')
 			continue;
-		}
 		switch (parameter) {
 		case 'A':
 			value = telegramm->fuz_fuvst_nr;
@@ -809,31 +823,26 @@ static char *assemble_telegramm(const telegramm_t *telegramm, int debug)
 			LOGP(DFRAME, LOGL_ERROR, "Parameter '%c' does not exist, please fix!\n", parameter);
 			abort();
 		}
-		if (debug && loglevel <= LOGL_DEBUG)
+		if (debug && LOGLEVEL_HOT(LOGL_DEBUG))
 			debug_parameter(parameter, value);
-		val = value;
-		for (j = 0; string[63 - i - j] == parameter; j++) {
-			bits[69 - i - j] = (val & 1) ? '1' : '0';
-			val >>= 1;
-		}
-		if (val)
+		for (j = 0; i + j < 64 && string[63 - i - j] == parameter; j++)
+			;
+		mask = (j < 64) ? ((uint64_t)1 << j) - 1 : ~(uint64_t)0;
+		if ((value & ~mask))
 			LOGP(DFRAME, LOGL_ERROR, "Parameter '%c' value '0x%" PRIx64 "' exceeds bit range!\n", parameter, value);
+		data[0] |= (value & mask) << i;
 		i += j - 1;
 	}
-	bits[70] = '\0';
-
-	if (debug) {
-		LOGP(DFRAME, LOGL_DEBUG, "OOOOOO%s\n", string);
-		LOGP(DFRAME, LOGL_DEBUG, "%s\n", bits);
-	}
 
-	return bits;
+	if (debug && LOG_HOT_ENABLED(LOGL_DEBUG))
+		debug_data(string, data);
 }
 
 /* decode telegram from 70 bits
- * bit order MSB
+ * data[0]: 64 parameter bits, LSB is the last bit of the telegram
+ * data[1]: 6 opcode bits
  */
-static void disassemble_telegramm(telegramm_t *telegramm, const char *bits, int auth)
+static void disassemble_telegramm(telegramm_t *telegramm, const uint64_t *data, int auth)
 {
 	uint64_t value;
 	const char *string;
@@ -843,15 +852,12 @@ static void disassemble_telegramm(telegramm_t *telegramm, const char *bits, int
 	memset(telegramm, 0, sizeof(*telegramm));
 
 	/* copy opcode */
-	value = 0;
-	for (i = 0; i < 6; i++)
-		value = (value << 1) | (bits[i] == '1');
-	telegramm->opcode = value;
+	telegramm->opcode = data[1] & 0x3f;
 
 	LOGP(DFRAME, LOGL_INFO, "Decoding %s %s\n", definition_opcode[telegramm->opcode].message_name, definition_opcode[telegramm->opcode].message_text);
 
 	/* copy parameters */
-	if (auth && bits[1]) /* auth flag and chip card flag */
+	if (auth && definition_opcode[telegramm->opcode].auth_bits) /* auth flag */
 		string = definition_opcode[telegramm->opcode].auth_bits;
 	else
 		string = definition_opcode[telegramm->opcode].no_auth_bits;
@@ -859,12 +865,13 @@ static void disassemble_telegramm(telegramm_t *telegramm, const char *bits, int
 		parameter = string[63 - i];
 		if (parameter == '-')
 			continue;
-		value = 0;
 		for (j = 0; i + j < 64 && string[63 - i - j] == parameter; j++)
-			value = (value >> 1) | ((uint64_t)(bits[69 - i - j] == '1') << 63);
-		value >>= 64 - j;
+			;
+		value = data[0] >> i;
+		if (j < 64)
+			value &= ((uint64_t)1 << j) - 1;
 		i += j - 1;
-		if (loglevel <= LOGL_DEBUG)
+		if (LOGLEVEL_HOT(LOGL_DEBUG))
 			debug_parameter(parameter, value);
 		switch (parameter) {
 		case 'A':
@@ -1026,245 +1033,12 @@ static void disassemble_telegramm(telegramm_t *telegramm, const char *bits, int
 		}
 	}
 
-	if (loglevel <= LOGL_DEBUG) {
-		char debug_bits[71];
-
-		memcpy(debug_bits, bits, 70);
-		debug_bits[70] = '\0';
-		LOGP(DFRAME, LOGL_DEBUG, "OOOOOO%s\n", string);
-		LOGP(DFRAME, LOGL_DEBUG, "%s\n", debug_bits);
-	}
-
+	if (LOGLEVEL_HOT(LOGL_DEBUG))
+		debug_data(string, data);
 }
 
-static const char *barker_string = "11100010010";
-static int16_t barker_code = 0x712; /* 11 bits: 11100010010 */
-static uint8_t barker_decode[2048]; /* detected bits */
-
-static char *blockcode[128] = {
-/*	 0123456 = Nutzbits */
-/*	           01234567 = Redundanzbits */
-	"0000000" "00000000",
-	"1000000" "11101000",
-	"0100000" "01110100",
-	"1100000" "10011100",
-	"0010000" "00111010",
-	"1010000" "11010010",
-	"0110000" "01001110",
-	"1110000" "10100110",
-	"0001000" "00011101",
-	"1001000" "11110101",
-	"0101000" "01101001",
-	"1101000" "10000001",
-	"0011000" "00100111",
-	"1011000" "11001111",
-	"0111000" "01010011",
-	"1111000" "10111011",
-	"0000100" "11100110",
-	"1000100" "00001110",
-	"0100100" "10010010",
-	"1100100" "01111010",
-	"0010100" "11011100",
-	"1010100" "00110100",
-	"0110100" "10101000",
-	"1110100" "01000000",
-	"0001100" "11111011",
-	"1001100" "00010011",
-	"0101100" "10001111",
-	"1101100" "01100111",
-	"0011100" "11000001",
-	"1011100" "00101001",
-	"0111100" "10110101",
-	"1111100" "01011101",
-	"0000010" "01110011",
-	"1000010" "10011011",
-	"0100010" "00000111",
-	"1100010" "11101111",
-	"0010010" "01001001",
-	"1010010" "10100001",
-	"0110010" "00111101",
-	"1110010" "11010101",
-	"0001010" "01101110",
-	"1001010" "10000110",
-	"0101010" "00011010",
-	"1101010" "11110010",
-	"0011010" "01010100",
-	"1011010" "10111100",
-	"0111010" "00100000",
-	"1111010" "11001000",
-	"0000110" "10010101",
-	"1000110" "01111101",
-	"0100110" "11100001",
-	"1100110" "00001001",
-	"0010110" "10101111",
-	"1010110" "01000111",
-	"0110110" "11011011",
-	"1110110" "00110011",
-	"0001110" "10001000",
-	"1001110" "01100000",
-	"0101110" "11111100",
-	"1101110" "00010100",
-	"0011110" "10110010",
-	"1011110" "01011010",
-	"0111110" "11000110",
-	"1111110" "00101110",
-	"0000001" "11010001",
-	"1000001" "00111001",
-	"0100001" "10100101",
-	"1100001" "01001101",
-	"0010001" "11101011",
-	"1010001" "00000011",
-	"0110001" "10011111",
-	"1110001" "01110111",
-	"0001001" "11001100",
-	"1001001" "00100100",
-	"0101001" "10111000",
-	"1101001" "01010000",
-	"0011001" "11110110",
-	"1011001" "00011110",
-	"0111001" "10000010",
-	"1111001" "01101010",
-	"0000101" "00110111",
-	"1000101" "11011111",
-	"0100101" "01000011",
-	"1100101" "10101011",
-	"0010101" "00001101",
-	"1010101" "11100101",
-	"0110101" "01111001",
-	"1110101" "10010001",
-	"0001101" "00101010",
-	"1001101" "11000010",
-	"0101101" "01011110",
-	"1101101" "10110110",
-	"0011101" "00010000",
-	"1011101" "11111000",
-	"0111101" "01100100",
-	"1111101" "10001100",
-	"0000011" "10100010",
-	"1000011" "01001010",
-	"0100011" "11010110",
-	"1100011" "00111110",
-	"0010011" "10011000",
-	"1010011" "01110000",
-	"0110011" "11101100",
-	"1110011" "00000100",
-	"0001011" "10111111",
-	"1001011" "01010111",
-	"0101011" "11001011",
-	"1101011" "00100011",
-	"0011011" "10000101",
-	"1011011" "01101101",
-	"0111011" "11110001",
-	"1111011" "00011001",
-	"0000111" "01000100",
-	"1000111" "10101100",
-	"0100111" "00110000",
-	"1100111" "11011000",
-	"0010111" "01111110",
-	"1010111" "10010110",
-	"0110111" "00001010",
-	"1110111" "11100010",
-	"0001111" "01011001",
-	"1001111" "10110001",
-	"0101111" "00101101",
-	"1101111" "11000101",
-	"0011111" "01100011",
-	"1011111" "10001011",
-	"0111111" "00010111",
-	"1111111" "11111111",
-};
-
-static uint16_t block_code[128];
-static uint16_t block_decode[32768]; /* code word + flag / 0xffff=decode error */
-
-int init_coding(void)
-{
-	int i, j, k;
-
-	/* create table to decode barker code.
-	 * ech table entry returns the number of detected bits */
-	for (i = 0; i < 2048; i++) {
-		int match = 0;
-		for (j = 0; j < 11; j++) {
-			/* check if i matches barker code at given bit j */
-			if (((i ^ barker_code) & (0x400 >> j)) == 0)
-				match++;
-		}
-		barker_decode[i] = match;
-	}
-
-	/* convert string to block code words */
-	for (i = 0; i < 128; i++) {
-		int word = 0;
-		for (j = 0; j < 15; j++)
-			word = (word << 1) + (blockcode[i][14 - j] - '0');
-		if ((word & 0x7f) != i) {
-			printf("Databits are wrong, expecting %d, but got %d\n", i, word & 0x7f);
-			return -1;
-		}
-		block_code[i] = word;
-	}
-
-	/* check if redundancy of a single bit matches the combined redundancy */
-	for (i = 0; i < 128; i++) {
-		int r = 0;
-		for (j = 0; j < 7; j++) {
-			if ((i & (1 << j)))
-				r ^= block_code[1 << j] >> 7;
-		}
-		if (r != block_code[i] >> 7) {
-			printf("Redundancy bits are wrong\n");
-			return -1;
-		}
-	}
-
-	/* create table to decode one block code and return value + error */
-	/* set all combinations invalid */
-	for (i = 0; i < 32768; i++)
-		block_decode[i] = 0xffff;
-	for (i = 0; i < 128; i++) {
-		int word;
-		/* set all error free combinations valid */
-		word = block_code[i];
-		if (block_decode[word] != 0xffff) {
-			printf("Overlap, please fix!\n");
-			return -1;
-		}
-		block_decode[word] = i;
-		/* set all one bit error combinations valid with flag */
-		for (j = 0; j < 15; j++) {
-			word = block_code[i];
-			word ^= (1 << j);
-			if (block_decode[word] != 0xffff) {
-				printf("Overlap, please fix!\n");
-				return -1;
-			}
-			block_decode[word] = i | 0x100; /* indicate 1 error */
-			/* set all two bit error combinations valid with flag */
-			for (k = j + 1; k < 15; k++) {
-				word = block_code[i];
-				word ^= (1 << j) | (1 << k);
-				if (block_decode[word] != 0xffff) {
-					printf("Overlap, please fix!\n");
-					return -1;
-				}
-				block_decode[word] = i | 0x200; /* indicate 2 errors */
-			}
-		}
-	}
-
-#if 0
-	int count = 0;
-	for (i = 0; i < 32768; i++) {
-		printf("%d,", (int16_t)block_decode[i]);
-		if (block_decode[i] == 0xffff)
-		count++;
-	}
-	printf("bad blocks = %d\n", count);
-#endif
-
-	return 0;
-}
+/* barker_decode, block_code, block_decode, interleave_spread and sync_bits */
+#include "coding_tables.h"
 
 /* check for sync (3 * barker code) + 1 bit */
 int detect_sync(uint64_t bitstream)
@@ -1289,69 +1063,58 @@ int detect_sync(uint64_t bitstream)
 }
 
 /* encode data block
- * input: 70 data bits MSB first
- * output: 10*15 code words (LSB first)
+ * input: 70 data bits (see assemble_telegramm)
+ * output: 10 code words of 15 bits, LSB is transmitted first
  * FTZ 171 TR 60 / 5.1.1.3 */
-static char *encode(const char *input)
+static void encode(const uint64_t *data, uint16_t *code)
 {
-	static char output[150];
-	int16_t word;
-	int i, j;
+	int i;
+
+	for (i = 0; i < 9; i++)
+		code[i] = block_code[(data[0] >> (i * 7)) & 0x7f];
+	code[9] = block_code[((data[0] >> 63) | (data[1] << 1)) & 0x7f];
 
 #ifdef DEBUG_CODER
+	int j;
+
 	printf("Encoding block to transmit:\n");
 	printf("0123456.01234567\n");
-#endif
 	for (i = 0; i < 10; i++) {
-		word = 0;
-		for (j = 0; j < 7; j++)
-			word = (word << 1) | (input[(9 - i) * 7 + j] == '1');
-		word = block_code[word];
 		for (j = 0; j < 15; j++) {
-			output[i * 15 + j] = ((word >> j) & 1) + '0';
-#ifdef DEBUG_CODER
-			printf("%c", output[i * 15 + j]);
+			printf("%d", (code[i] >> j) & 1);
 			if (j == 6)
 				printf(".");
-#endif
 		}
-#ifdef DEBUG_CODER
 		printf("\n");
-#endif
 	}
-
-	return output;
+#endif
 }
 
 /* decode data block
- * input: 10*15 code words (LSB first)
- * output: 70 data bits MSB first
+ * input: 10 code words of 15 bits, LSB is received first
+ * output: 70 data bits (see disassemble_telegramm)
  * FTZ 171 TR 60 / 5.1.1.3 */
-static const char *decode(const char *input, int *_bit_errors)
+static int decode(const uint16_t *code, uint64_t *data, int *_bit_errors)
 {
 	int failed = 0, warn = 0;
 	char fail_str[11];
-	static char output[70];
 	uint16_t word;
-	int i, j;
+	int i;
 
 #ifdef DEBUG_CODER
+	int j;
+
 	printf("Decoding received block:\n");
 	printf("0123456.01234567 Without errors:  Error bits:\n");
 #endif
+	data[0] = 0;
 	for (i = 0; i < 10; i++) {
-		word = 0;
-		for (j = 0; j < 15; j++) {
-			word = (word << 1) | (input[i * 15 + 14 - j] == '1');
-#ifdef DEBUG_CODER
-			printf("%c", input[i * 15 + j]);
-			if (j == 6)
-				printf(".");
-#endif
-		}
-		word = block_decode[word];
-		for (j = 0; j < 7; j++) {
-			output[(9 - i) * 7 + j] = ((word >> (6 - j)) & 1) + '0';
+		word = block_decode[code[i] & 0x7fff];
+		if (i < 9)
+			data[0] |= (uint64_t)(word & 0x7f) << (i * 7);
+		else {
+			data[0] |= (uint64_t)(word & 0x01) << 63;
+			data[1] = (word & 0x7f) >> 1;
 		}
 		if (word > 0x2ff) {
 			failed = 1;
@@ -1367,18 +1130,23 @@ static const char *decode(const char *input, int *_bit_errors)
 		} else
 			fail_str[i] = '.';
 #ifdef DEBUG_CODER
+		for (j = 0; j < 15; j++) {
+			printf("%d", (code[i] >> j) & 1);
+			if (j == 6)
+				printf(".");
+		}
 		if (word > 0x2ff)
 			printf("decode failed");
 		else {
 			printf(" ");
 			for (j = 0; j < 15; j++) {
-				printf("%c", blockcode[word & 0x7f][j]);
+				printf("%d", (block_code[word & 0x7f] >> j) & 1);
 				if (j == 6)
 					printf(".");
 			}
 			printf(" ");
 			for (j = 0; j < 15; j++) {
-				if (blockcode[word & 0x7f][j] != input[i * 15 + j])
+				if (((block_code[word & 0x7f] ^ code[i]) >> j) & 1)
 					printf("*");
 				else
 					printf("-");
@@ -1392,110 +1160,110 @@ static const char *decode(const char *input, int *_bit_errors)
 	fail_str[10] = '\0';
 	
 	if (failed)
-		LOGP(DFRAME, LOGL_DEBUG, "Received Telegram with these block errors: '%s' (X = uncorrectable)\n", fail_str);
+		LOGP_HOT(DFRAME, LOGL_DEBUG, "Received Telegram with these block errors: '%s' (X = uncorrectable)\n", fail_str);
 	else if (warn)
-		LOGP(DFRAME, LOGL_DEBUG, "Received Telegram with these block errors: '%s' (1 / 2 = correctable)\n", fail_str);
+		LOGP_HOT(DFRAME, LOGL_DEBUG, "Received Telegram with these block errors: '%s' (1 / 2 = correctable)\n", fail_str);
 	else
-		LOGP(DFRAME, LOGL_DEBUG, "Received Telegram with no block errors.\n");
+		LOGP_HOT(DFRAME, LOGL_DEBUG, "Received Telegram with no block errors.\n");
 
 	if (failed)
-		return NULL;
+		return -EINVAL;
 	*_bit_errors = warn;
-	return output;
+	return 0;
 }
 
 /* interleving of code words
- * input: 10*15 code words (LSB first)
- * output: stream of 33 sync + 1 + 150 interleaved bits
+ * input: 10 code words of 15 bits
+ * output: stream of 33 sync + 1 + 150 interleaved bits (see telegramm.h)
+ * bit j of code word i is sent at 34 + i + j * 10, so 5 bits of each code
+ * word are spread over one block word by table and shifted by i.
  * FTZ 171 TR 60 / 5.1.1.2 and 5.1.1.2 */
-static char *interleave(const char *input)
+static void interleave(const uint16_t *code, uint64_t *frame)
 {
-	static char output[185]; /* + termination char for debug */
-	int i, j;
-
-	strcpy(output, barker_string);
-	strcpy(output + 11, barker_string);
-	strcpy(output + 22, barker_string);
+	uint64_t block[3];
+	int i, c;
 
-	output[33] = '1';
-
-#ifdef DEBUG_BLOCK
-	printf("Interleaving block to transmit:\n");
-#endif
-	for (i = 0; i < 10; i++) {
-		for (j = 0; j < 15; j++) {
-			output[i + j * 10 + 34] = input[j + i * 15];
-#ifdef DEBUG_BLOCK
-			printf("%c", input[j + i * 15]);
-#endif
-		}
-#ifdef DEBUG_BLOCK
-		printf("\n");
-#endif
+	for (c = 0; c < 3; c++) {
+		block[c] = 0;
+		for (i = 0; i < 10; i++)
+			block[c] |= interleave_spread[(code[i] >> (c * 5)) & 0x1f] << i;
 	}
 
+	frame[0] = sync_bits | (block[0] << 34);
+	frame[1] = (block[0] >> 30) | (block[1] << 20);
+	frame[2] = (block[1] >> 44) | (block[2] << 6);
+
 #ifdef DEBUG_RAW
-	output[184] = '\0';
-	printf("Raw TX: %s\n", output + 34);
-#endif
+	char debug_bits[151];
 
-	return output;
+	for (i = 0; i < 150; i++)
+		debug_bits[i] = ((block[i / 50] >> (i % 50)) & 1) + '0';
+	debug_bits[150] = '\0';
+	printf("Raw TX: %s\n", debug_bits);
+#endif
 }
 
 /* deinterleave of code words
- * input: stream of 150 interleaved bits
- * output: 10*15 code words (LSB first)
+ * input: 150 interleaved bits (see telegramm.h)
+ * output: 10 code words of 15 bits
+ * every 10th bit of a block word is gathered by multiplication: bits 0, 10,
+ * 20, 30, 40 are shifted by 36, 27, 18, 9, 0, so they land at bits 36..40.
  * FTZ 171 TR 60 / 5.1.1.4 */
-static const char *deinterleave(const char *input)
+static void deinterleave(const uint64_t *block, uint16_t *code)
 {
-	static char output[150];
-	int i, j;
+	uint64_t x;
+	int i, c;
 
 #ifdef DEBUG_RAW
 	char debug_bits[151];
 
-	memcpy(debug_bits, input, 150);
-	debug_bits[151] = '\0';
+	for (i = 0; i < 150; i++)
+		debug_bits[i] = ((block[i / 50] >> (i % 50)) & 1) + '0';
+	debug_bits[150] = '\0';
 	printf("Raw RX: %s\n", debug_bits);
 #endif
 
-#ifdef DEBUG_BLOCK
-	printf("Deinterleaving received block:\n");
-#endif
 	for (i = 0; i < 10; i++) {
-		for (j = 0; j < 15; j++) {
-			output[j + i * 15] = input[i + j * 10];
-#ifdef DEBUG_BLOCK
-			printf("%c", output[j + i * 15]);
-#endif
+		code[i] = 0;
+		for (c = 0; c < 3; c++) {
+			x = (block[c] >> i) & 0x10040100401ULL;
+			code[i] |= ((x * 0x1008040201ULL) >> 36 & 0x1f) << (c * 5);
 		}
-#ifdef DEBUG_BLOCK
-		printf("\n");
-#endif
 	}
+}
 
-	return output;
+/* trace the 70 data bits: opcode, followed by the parameters */
+static void trace_telegramm(cnetz_t *cnetz, int direction, const uint64_t *data, int bit_errors, double level)
+{
+	uint8_t bytes[9];
+	int i;
+
+	bytes[0] = (data[1] << 2) | (data[0] >> 62);
+	for (i = 1; i < 8; i++)
+		bytes[i] = data[0] >> (62 - i * 8);
+	bytes[8] = data[0] << 2;
+	frametrace_frame(&cnetz->sender, direction, bytes, 70, bit_errors, level);
 }
 
-void cnetz_decode_telegramm(cnetz_t *cnetz, const char *bits, double level, double sync_time, double stddev)
+void cnetz_decode_telegramm(cnetz_t *cnetz, const uint64_t *bits, double level, double sync_time, double stddev)
 {
 	telegramm_t telegramm;
+	uint16_t code[10];
+	uint64_t data[2];
 	uint8_t opcode;
-	int i;
 	int block;
 	int bit_errors;
+	int rc;
 
-	bits = deinterleave(bits);
-	bits = decode(bits, &bit_errors);
-	if (!bits)
+	deinterleave(bits, code);
+	rc = decode(code, data, &bit_errors);
+	sender_rx_frame(&cnetz->sender, (rc < 0) ? -1 : bit_errors);
+	if (rc < 0)
 		return;
+	trace_telegramm(cnetz, FRAMETRACE_RX, data, bit_errors, level);
 
 	/* filter out mysterious zero-telegramm */
-	for (i = 0; i < 70; i++) {
-		if (bits[i] != bits[0])
-			break;
-	}
-	if (i == 70) {
+	if ((data[0] == 0 && data[1] == 0) || (data[0] == ~(uint64_t)0 && data[1] == 0x3f)) {
 		LOGP(DFRAME, LOGL_INFO, "Ignoring mysterious unmodulated telegramm (noise from phone's transmitter)\n");
 		return;
 	}
@@ -1504,7 +1272,7 @@ void cnetz_decode_telegramm(cnetz_t *cnetz, const char *bits, double level, doub
 	if (bit_errors)
 		LOGP_CHAN(DDSP, LOGL_INFO, " -> Frame has %d bit errors.\n", bit_errors);
 
-	disassemble_telegramm(&telegramm, bits, si.authentifikationsbit);
+	disassemble_telegramm(&telegramm, data, si.authentifikationsbit);
 	opcode = telegramm.opcode;
 	telegramm.level = level;
 	telegramm.sync_time = sync_time;
@@ -1574,11 +1342,12 @@ void cnetz_decode_telegramm(cnetz_t *cnetz, const char *bits, double level, doub
 	}
 }
 
-const char *cnetz_encode_telegramm(cnetz_t *cnetz)
+int cnetz_encode_telegramm(cnetz_t *cnetz, uint64_t *bits)
 {
 	const telegramm_t *telegramm = NULL;
+	uint16_t code[10];
+	uint64_t data[2];
 	uint8_t opcode;
-	char *bits;
 	int debug = 1;
 
 	switch (cnetz->dsp_mode) {
@@ -1599,23 +1368,23 @@ const char *cnetz_encode_telegramm(cnetz_t *cnetz)
 	}
 
 	if (!telegramm)
-		return NULL;
+		return 0;
 
 	opcode = telegramm->opcode;
 	if (opcode == OPCODE_LR_R && cnetz->sched_lr_debugged)
 		debug = 0;
 	if (opcode == OPCODE_MLR_M && cnetz->sched_mlr_debugged)
 		debug = 0;
-	bits = assemble_telegramm(telegramm, debug);
-	bits = encode(bits);
-	bits = interleave(bits);
+	assemble_telegramm(telegramm, debug, data);
+	trace_telegramm(cnetz, FRAMETRACE_TX, data, 0, NAN);
+	encode(data, code);
+	interleave(code, bits);
 
 	/* invert, if polarity of the cell is negative */
 	if (cnetz->negative_polarity) {
-		int i;
-
-		for (i = 0; i < 184; i++)
-			bits[i] ^= 1;
+		bits[0] ^= ~(uint64_t)0;
+		bits[1] ^= ~(uint64_t)0;
+		bits[2] ^= ((uint64_t)1 << (TELEGRAMM_FRAME_BITS - 128)) - 1;
 	}
 
 	if (opcode == OPCODE_LR_R && !cnetz->sched_lr_debugged)
@@ -1625,6 +1394,6 @@ const char *cnetz_encode_telegramm(cnetz_t *cnetz)
 		LOGP(DFRAME, LOGL_INFO, "Subsequent IDLE frames are not shown, to prevent flooding the output.\n");
 	}
 
-	return bits;
+	return 1;
 }
 
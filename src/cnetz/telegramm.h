@@ -117,14 +117,21 @@ typedef struct telegramm {
 } telegramm_t;
 
 int init_telegramm(void);
-int init_coding(void);
 const char *telegramm_name(uint8_t opcode);
 
 const char *telegramm2rufnummer(telegramm_t *telegramm);
 int match_fuz(telegramm_t *telegramm);
 int match_futln(telegramm_t *telegramm, uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest);
 
+/* frame to transmit: 33 sync bits + 1 + 150 interleaved bits, packed into
+ * three words, first bit is LSB of first word */
+#define TELEGRAMM_FRAME_BITS	184
+#define TELEGRAMM_FRAME_BIT(bits, n) (((bits)[(n) >> 6] >> ((n) & 63)) & 1)
+/* received block: 150 interleaved bits, 50 bits in each of three words */
+#define TELEGRAMM_BLOCK_BITS	150
+#define TELEGRAMM_BLOCK_SET(bits, n, bit) ((bits)[(n) / 50] |= (uint64_t)(bit) << ((n) % 50))
+
 int detect_sync(uint64_t bitstream);
-void cnetz_decode_telegramm(cnetz_t *cnetz, const char *bits, double level, double sync_time, double stddev);
-const char *cnetz_encode_telegramm(cnetz_t *cnetz);
+void cnetz_decode_telegramm(cnetz_t *cnetz, const uint64_t *bits, double level, double sync_time, double stddev);
+int cnetz_encode_telegramm(cnetz_t *cnetz, uint64_t *bits);
 
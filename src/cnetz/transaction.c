@@ -31,9 +31,97 @@
 
 static int new_cueue_position = 0;
 
+/* transactions of all cnetz instances are also indexed by subscriber number
+ * and by callref, the lists of each instance are used for iteration */
+#define TRANS_HASH_SIZE	1024	/* must be power of 2 */
+static transaction_t *trans_hash_number[TRANS_HASH_SIZE];
+static transaction_t *trans_hash_callref[TRANS_HASH_SIZE];
+
+/* linked transactions in queue state, as heap ordered by queue position */
+static transaction_t **trans_queue;
+static int trans_queue_num, trans_queue_size;
+
+static unsigned int hash_number(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
+{
+	uint32_t x = ((uint32_t)futln_nat << 21) | ((uint32_t)futln_fuvst << 16) | futln_rest;
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (TRANS_HASH_SIZE - 1);
+}
+
+static unsigned int hash_callref(int callref)
+{
+	uint32_t x = callref;
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (TRANS_HASH_SIZE - 1);
+}
+
+static void queue_set(int index, transaction_t *trans)
+{
+	trans_queue[index] = trans;
+	trans->queue_index = index + 1;
+}
+
+static void queue_sift(int index)
+{
+	transaction_t *trans = trans_queue[index];
+	int child;
+
+	/* move up */
+	while (index > 0 && trans_queue[(index - 1) / 2]->queue_position > trans->queue_position) {
+		queue_set(index, trans_queue[(index - 1) / 2]);
+		index = (index - 1) / 2;
+	}
+	/* move down */
+	while ((child = index * 2 + 1) < trans_queue_num) {
+		if (child + 1 < trans_queue_num && trans_queue[child + 1]->queue_position < trans_queue[child]->queue_position)
+			child++;
+		if (trans_queue[child]->queue_position >= trans->queue_position)
+			break;
+		queue_set(index, trans_queue[child]);
+		index = child;
+	}
+	queue_set(index, trans);
+}
+
+/* add or remove transaction to/from queue, depending on state and link */
+static void queue_update(transaction_t *trans)
+{
+	int queued = (trans->cnetz && (trans->state & (TRANS_MO_QUEUE | TRANS_MT_QUEUE)));
+	transaction_t **q;
+	int index;
+
+	if (queued && !trans->queue_index) {
+		if (trans_queue_num == trans_queue_size) {
+			q = realloc(trans_queue, sizeof(*q) * ((trans_queue_size) ? trans_queue_size * 2 : 16));
+			if (!q) {
+				LOGP(DTRANS, LOGL_ERROR, "No memory!\n");
+				abort();
+			}
+			trans_queue = q;
+			trans_queue_size = (trans_queue_size) ? trans_queue_size * 2 : 16;
+		}
+		queue_set(trans_queue_num++, trans);
+		queue_sift(trans_queue_num - 1);
+	}
+	if (!queued && trans->queue_index) {
+		index = trans->queue_index - 1;
+		trans->queue_index = 0;
+		if (index < --trans_queue_num) {
+			queue_set(index, trans_queue[trans_queue_num]);
+			queue_sift(index);
+		}
+	}
+}
+
 const char *transaction2rufnummer(transaction_t *trans)
 {
-	static char rufnummer[32]; /* make GCC happy (overflow check) */
+	static __thread char rufnummer[32]; /* make GCC happy (overflow check) */
 
 	sprintf(rufnummer, "%d%d%05d", trans->futln_nat, trans->futln_fuvst, trans->futln_rest);
 
@@ -43,7 +131,7 @@ const char *transaction2rufnummer(transaction_t *trans)
 /* create transaction */
 transaction_t *create_transaction(cnetz_t *cnetz, uint64_t state, uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, int futelg_bit, int extended, double rf_level_db)
 {
-	transaction_t *trans;
+	transaction_t *trans, **transp;
 
 	trans = search_transaction_number_global(futln_nat, futln_fuvst, futln_rest);
 	if (trans) {
@@ -83,12 +171,14 @@ transaction_t *create_transaction(cnetz_t *cnetz, uint64_t state, uint8_t futln_
 		return NULL;
 	}
 
-	osmo_timer_setup(&trans->timer, transaction_timeout, trans);
+	wheel_timer_setup(&trans->timer, transaction_timeout, trans);
 
 	trans_new_state(trans, state);
 	trans->futln_nat = futln_nat;
 	trans->futln_fuvst = futln_fuvst;
 	trans->futln_rest = futln_rest;
+	for (transp = &trans_hash_number[hash_number(futln_nat, futln_fuvst, futln_rest)]; *transp; transp = &(*transp)->hash_number_next);
+	*transp = trans;
 
 	if (state == TRANS_VWG)
 		trans->mo_call = 1;
@@ -113,15 +203,25 @@ transaction_t *create_transaction(cnetz_t *cnetz, uint64_t state, uint8_t futln_
 /* destroy transaction */
 void destroy_transaction(transaction_t *trans)
 {
+	transaction_t **transp;
+
 	/* update database: now idle */
 	update_db(trans->futln_nat, trans->futln_fuvst, trans->futln_rest, 0, NULL, NULL, 0, trans->page_failed);
 
 	unlink_transaction(trans);
+
+	trans_set_callref(trans, 0);
+	for (transp = &trans_hash_number[hash_number(trans->futln_nat, trans->futln_fuvst, trans->futln_rest)]; *transp; transp = &(*transp)->hash_number_next) {
+		if (*transp == trans) {
+			*transp = trans->hash_number_next;
+			break;
+		}
+	}
 	
 	const char *rufnummer = transaction2rufnummer(trans);
 	LOGP(DTRANS, LOGL_INFO, "Destroying transaction for subscriber '%s'\n", rufnummer);
 
-	osmo_timer_del(&trans->timer);
+	wheel_timer_del(&trans->timer);
 
 	trans_new_state(trans, 0);
 
@@ -141,6 +241,7 @@ void link_transaction(transaction_t *trans, cnetz_t *cnetz)
 	while (*transp)
 		transp = &((*transp)->next);
 	*transp = trans;
+	queue_update(trans);
 	cnetz_display_status();
 }
 
@@ -160,6 +261,7 @@ void unlink_transaction(transaction_t *trans)
 	}
 	*transp = trans->next;
 	trans->cnetz = NULL;
+	queue_update(trans);
 	cnetz_display_status();
 }
 
@@ -179,55 +281,49 @@ transaction_t *search_transaction(cnetz_t *cnetz, uint64_t state_mask)
 	return NULL;
 }
 
-transaction_t *search_transaction_number(cnetz_t *cnetz, uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
+/* search linked transaction of given cnetz instance, or of any instance if NULL */
+static transaction_t *search_number(cnetz_t *cnetz, uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
 {
-	transaction_t *trans = cnetz->trans_list;
+	transaction_t *trans;
 
-	while (trans) {
+	for (trans = trans_hash_number[hash_number(futln_nat, futln_fuvst, futln_rest)]; trans; trans = trans->hash_number_next) {
 		if (trans->futln_nat == futln_nat
 		 && trans->futln_fuvst == futln_fuvst
-		 && trans->futln_rest == futln_rest) {
+		 && trans->futln_rest == futln_rest
+		 && trans->cnetz
+		 && (!cnetz || trans->cnetz == cnetz)) {
 			const char *rufnummer = transaction2rufnummer(trans);
 			LOGP(DTRANS, LOGL_DEBUG, "Found transaction for subscriber '%s'\n", rufnummer);
 			return trans;
 		}
-		trans = trans->next;
 	}
 
 	return NULL;
 }
 
-transaction_t *search_transaction_number_global(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
+transaction_t *search_transaction_number(cnetz_t *cnetz, uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
 {
-	sender_t *sender;
-	cnetz_t *cnetz;
-	transaction_t *trans = NULL;
-
-	/* search transaction for this subscriber */
-	for (sender = sender_head; sender; sender = sender->next) {
-		cnetz = (cnetz_t *) sender;
-		/* search transaction for this callref */
-		trans = search_transaction_number(cnetz, futln_nat, futln_fuvst, futln_rest);
-		if (trans)
-			break;
-	}
+	return search_number(cnetz, futln_nat, futln_fuvst, futln_rest);
+}
 
-	return trans;
+transaction_t *search_transaction_number_global(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
+{
+	return search_number(NULL, futln_nat, futln_fuvst, futln_rest);
 }
+
 transaction_t *search_transaction_callref(cnetz_t *cnetz, int callref)
 {
-	transaction_t *trans = cnetz->trans_list;
+	transaction_t *trans;
 
 	/* just in case, this should not happen */
 	if (!callref)
 		return NULL;
-	while (trans) {
-		if (trans->callref == callref) {
+	for (trans = trans_hash_callref[hash_callref(callref)]; trans; trans = trans->hash_callref_next) {
+		if (trans->callref == callref && trans->cnetz == cnetz) {
 			const char *rufnummer = transaction2rufnummer(trans);
 			LOGP(DTRANS, LOGL_DEBUG, "Found transaction for subscriber '%s'\n", rufnummer);
 			return trans;
 		}
-		trans = trans->next;
 	}
 
 	return NULL;
@@ -240,25 +336,10 @@ transaction_t *search_transaction_callref(cnetz_t *cnetz, int callref)
  */
 transaction_t *search_transaction_queue(void)
 {
-	sender_t *sender;
-	transaction_t *trans, *found = NULL;
-	cnetz_t *cnetz;
-	int queue_max = 0;
-
-	for (sender = sender_head; sender; sender = sender->next) {
-		cnetz = (cnetz_t *) sender;
-		trans = cnetz->trans_list;
-		while (trans) {
-			if ((trans->state & (TRANS_MO_QUEUE | TRANS_MT_QUEUE))) {
-				/* select if first or lower number */
-				if (!found || trans->queue_position < queue_max) {
-					queue_max = trans->queue_position;
-					found = trans;
-				}
-			}
-			trans = trans->next;
-		}
-	}
+	transaction_t *found = NULL;
+
+	if (trans_queue_num)
+		found = trans_queue[0];
 
 	if (found) {
 		const char *rufnummer = transaction2rufnummer(found);
@@ -391,9 +472,33 @@ void trans_new_state(transaction_t *trans, uint64_t state)
 	/* in case of a queue, set new positon */
 	if (!trans->queue_position && (state == TRANS_MO_QUEUE || state == TRANS_MT_QUEUE))
 		trans->queue_position = ++new_cueue_position;
+	queue_update(trans);
 	cnetz_display_status();
 }
 
+/* set callref and keep callref index */
+void trans_set_callref(transaction_t *trans, int callref)
+{
+	transaction_t **transp;
+
+	if (trans->callref == callref)
+		return;
+	if (trans->callref) {
+		for (transp = &trans_hash_callref[hash_callref(trans->callref)]; *transp; transp = &(*transp)->hash_callref_next) {
+			if (*transp == trans) {
+				*transp = trans->hash_callref_next;
+				break;
+			}
+		}
+	}
+	trans->callref = callref;
+	if (callref) {
+		for (transp = &trans_hash_callref[hash_callref(callref)]; *transp; transp = &(*transp)->hash_callref_next);
+		trans->hash_callref_next = NULL;
+		*transp = trans;
+	}
+}
+
 void cnetz_flush_other_transactions(cnetz_t *cnetz, transaction_t *trans)
 {
 	/* flush after this very trans */
@@ -38,6 +38,9 @@
 
 typedef struct transaction {
 	struct transaction	*next;			/* pointer to next node in list */
+	struct transaction	*hash_number_next;	/* next transaction in hash bucket of subscriber number */
+	struct transaction	*hash_callref_next;	/* next transaction in hash bucket of callref */
+	int			queue_index;		/* index in queue heap + 1, 0 if not in queue */
 	cnetz_t			*cnetz;			/* pointer to cnetz instance */
 	int			callref;		/* callref for transaction */
 	uint8_t			futln_nat;		/* current station ID (3 values) */
@@ -50,7 +53,7 @@ typedef struct transaction {
 	int8_t			release_cause;		/* reason for release, (c-netz coding) */
 	int			try;			/* counts resending messages */
 	int			repeat;			/* counts repeating messages */
-	struct osmo_timer_list		timer;			/* for varous timeouts */
+	struct wheel_timer		timer;			/* for varous timeouts, re-armed with frames */
 	int			mo_call;		/* flags a moile originating call */
 	int			mt_call;		/* flags a moile terminating call */
 	int			page_failed;		/* failed to get a response from MS */
@@ -72,6 +75,7 @@ transaction_t *search_transaction_number_global(uint8_t futln_nat, uint8_t futln
 transaction_t *search_transaction_callref(cnetz_t *cnetz, int callref);
 transaction_t *search_transaction_queue(void);
 void trans_new_state(transaction_t *trans, uint64_t state);
+void trans_set_callref(transaction_t *trans, int callref);
 void cnetz_flush_other_transactions(cnetz_t *cnetz, transaction_t *trans);
 void transaction_timeout(void *data);
 const char *trans_short_state_name(uint64_t state);
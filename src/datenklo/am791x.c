@@ -363,6 +363,26 @@ void am791x_receive(am791x_t *am791x, sample_t *samples, int length)
 	}
 }
 
+/* receive audio of many modems, their demodulators are processed by the bank */
+void am791x_receive_bank(fsk_demod_bank_t *bank, am791x_t **am791x, sample_t **samples, int num, int length)
+{
+	fsk_demod_t *fsk[num];
+	sample_t *fsk_samples[num];
+	int i, n;
+
+	for (i = 0, n = 0; i < num; i++) {
+		if (!am791x[i]->f0_rx || am791x[i]->squelch)
+			memset(samples[i], 0, length * sizeof(*samples[i]));
+		if (!am791x[i]->f0_rx)
+			continue;
+		fsk[n] = &am791x[i]->fsk_rx;
+		fsk_samples[n] = samples[i];
+		n++;
+	}
+	if (n)
+		fsk_demod_bank_receive(bank, fsk, fsk_samples, n, length);
+}
+
 /* provide bit to FSK modulator */
 static int fsk_send_bit(void *inst)
 {
@@ -95,6 +95,7 @@ typedef struct am791x {
 
 void am791x_send(am791x_t *am791x, sample_t *samples, int length);
 void am791x_receive(am791x_t *am791x, sample_t *samples, int length);
+void am791x_receive_bank(fsk_demod_bank_t *bank, am791x_t **am791x, sample_t **samples, int num, int length);
 void am791x_list_mc(enum am791x_type type);
 int am791x_init(am791x_t *am791x, void *inst, enum am791x_type type, uint8_t mc, int samplerate, double tx_baud, double rx_baud, void (*cts)(void *inst, int cts), void (*bcts)(void *inst, int cts), void (*cd)(void *inst, int cd), void (*bcd)(void *inst, int cd), int (*td)(void *inst), int (*btd)(void *inst), void (*rd)(void *inst, int bit, double quality, double level), void (*brd)(void *inst, int bit, double quality, double level));
 void am791x_exit(am791x_t *am791x);
@@ -27,6 +27,8 @@
 #include <errno.h>
 #include <signal.h>
 #include <poll.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
 #include <pthread.h>
 #include <ctype.h>
 #include <fcntl.h>
@@ -39,6 +41,7 @@
 #include "../libwave/wave.h"
 #include "../libdisplay/display.h"
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 #include "../libmobile/get_time.c"
 #include "device.h"
 #include "am791x.h"
@@ -59,6 +62,42 @@ static int quit = 0;
 
 pthread_mutex_t mutex;
 
+/* eventfd to wake the main loop from the device thread */
+static int wake_fd = -1;
+
+static void wake_main(void)
+{
+	uint64_t one = 1;
+	int __attribute__((unused)) rc;
+
+	if (wake_fd >= 0)
+		rc = write(wake_fd, &one, sizeof(one));
+}
+
+/* sleep until timeout or until main loop is woken */
+static void wait_main(double sleep)
+{
+	struct timeval tv;
+	fd_set fds;
+	uint64_t value;
+	int __attribute__((unused)) rc;
+
+	if (wake_fd < 0) {
+		if (sleep > 0)
+			usleep(sleep * 1000000.0);
+		return;
+	}
+
+	if (sleep < 0)
+		sleep = 0;
+	tv.tv_sec = (time_t)sleep;
+	tv.tv_usec = (long)((sleep - (double)tv.tv_sec) * 1000000.0);
+	FD_ZERO(&fds);
+	FD_SET(wake_fd, &fds);
+	if (select(wake_fd + 1, &fds, NULL, NULL, &tv) > 0)
+		rc = read(wake_fd, &value, sizeof(value));
+}
+
 static tcflag_t baud2cflag(double _baudrate)
 {
 	tcflag_t cflag;
@@ -1077,12 +1116,14 @@ static void debug_data(const char *buf, int count)
 	}
 }
 
-/* tty performs read */
-static ssize_t dk_read(void *inst, char *buf, size_t size, int flags)
+/* tty performs read
+ * the data is not copied, but iov points to one or two spans inside the RX fifo
+ */
+static ssize_t dk_read(void *inst, struct iovec *iov, size_t size, int flags)
 {
 	datenklo_t *datenklo = (datenklo_t *)inst;
 	size_t fill, space;
-	size_t i, count;
+	size_t count, first;
 	unsigned char vtime = datenklo->termios.c_cc[VTIME];
 	unsigned char vmin = datenklo->termios.c_cc[VMIN];
 
@@ -1146,18 +1187,23 @@ static ssize_t dk_read(void *inst, char *buf, size_t size, int flags)
 
 	LOGP(DDATENKLO, LOGL_DEBUG, "Device has been read from. (fill = %zu)\n", fill);
 
-	/* get data from fifo */
-	count = 0;
-	for (i = 0; i < size; i++) {
-		if (!fill)
-			break;
-		fill--;
-		buf[i] = datenklo->rx_fifo[datenklo->rx_fifo_out++];
-		datenklo->rx_fifo_out %= datenklo->rx_fifo_size;
-		count++;
-	}
+	/* get data from fifo, in two spans, if it wraps */
+	count = (fill < size) ? fill : size;
+	first = datenklo->rx_fifo_size - datenklo->rx_fifo_out;
+	if (first > count)
+		first = count;
+	iov[0].iov_base = datenklo->rx_fifo + datenklo->rx_fifo_out;
+	iov[0].iov_len = first;
+	iov[1].iov_base = datenklo->rx_fifo;
+	iov[1].iov_len = count - first;
+	datenklo->rx_fifo_out = (datenklo->rx_fifo_out + count) % datenklo->rx_fifo_size;
+	fill -= count;
 
-	debug_data(buf, count);
+	debug_data(iov[0].iov_base, iov[0].iov_len);
+	debug_data(iov[1].iov_base, iov[1].iov_len);
+
+	/* a blocking read may have started the timer */
+	wake_main();
 
 	if (!fill) {
 		/* tell cuse not to read anymore */
@@ -1176,7 +1222,7 @@ static ssize_t dk_write(void *inst, const char *buf, size_t size, int __attribut
 {
 	datenklo_t *datenklo = (datenklo_t *)inst;
 	size_t space, fill;
-	size_t i;
+	size_t first;
 
 	if (!(datenklo->lines & TIOCM_DTR)) {
 		LOGP(DDATENKLO, LOGL_INFO, "Dropping data, DTR is off!\n");
@@ -1207,11 +1253,16 @@ static ssize_t dk_write(void *inst, const char *buf, size_t size, int __attribut
 	if (datenklo->auto_rts)
 		datenklo->auto_rts_on = 1;
 
-	/* put data to fifo */
-	for (i = 0; i < size; i++) {
-		datenklo->tx_fifo[datenklo->tx_fifo_in++] = buf[i];
-		datenklo->tx_fifo_in %= datenklo->tx_fifo_size;
-	}
+	/* put data to fifo, in two spans, if it wraps */
+	first = datenklo->tx_fifo_size - datenklo->tx_fifo_in;
+	if (first > size)
+		first = size;
+	memcpy(datenklo->tx_fifo + datenklo->tx_fifo_in, buf, first);
+	memcpy(datenklo->tx_fifo, buf + first, size - first);
+	datenklo->tx_fifo_in = (datenklo->tx_fifo_in + size) % datenklo->tx_fifo_size;
+
+	/* wake main loop, so transmission starts without waiting for the next interval */
+	wake_main();
 
 	fill = (datenklo->tx_fifo_in - datenklo->tx_fifo_out + datenklo->tx_fifo_size) % datenklo->tx_fifo_size;
 
@@ -1275,6 +1326,10 @@ void datenklo_init_global(void)
 		LOGP(DDATENKLO, LOGL_ERROR, "Failed to init mutex.\n");
 		exit(0);
 	}
+
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wake_fd < 0)
+		LOGP(DDATENKLO, LOGL_NOTICE, "Failed to create eventfd, main loop will not be woken by the device.\n");
 }
 
 /* init function */
@@ -1382,15 +1437,15 @@ error:
 	return rc;
 }
 
-/* open audio device of one or two datenlo_t instance */
+/* open audio device of all datenlo_t instances that are linked via slave, one channel each */
 int datenklo_open_audio(datenklo_t *datenklo, const char *audiodev, int buffer, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave)
 {
-	int channels = 1;
+	int channels = 0;
+	datenklo_t *dk;
 	int rc;
 
-	/* stereo */
-	if (datenklo->slave)
-		channels = 2;
+	for (dk = datenklo; dk; dk = dk->slave)
+		channels++;
 
 	/* size of send buffer in samples */
 	datenklo->buffer_size = datenklo->samplerate * buffer / 1000;
@@ -1405,28 +1460,28 @@ int datenklo_open_audio(datenklo_t *datenklo, const char *audiodev, int buffer,
 #endif
 
 	if (write_rx_wave) {
-		rc = wave_create_record(&datenklo->wave_rx_rec, write_rx_wave, datenklo->samplerate, channels, 1.0);
+		rc = wave_create_record(&datenklo->wave_rx_rec, write_rx_wave, datenklo->samplerate, channels, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DDATENKLO, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 			return rc;
 		}
 	}
 	if (write_tx_wave) {
-		rc = wave_create_record(&datenklo->wave_tx_rec, write_tx_wave, datenklo->samplerate, channels, 1.0);
+		rc = wave_create_record(&datenklo->wave_tx_rec, write_tx_wave, datenklo->samplerate, channels, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DDATENKLO, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 			return rc;
 		}
 	}
 	if (read_rx_wave) {
-		rc = wave_create_playback(&datenklo->wave_rx_play, read_rx_wave, &datenklo->samplerate, &channels, 1.0);
+		rc = wave_create_playback(&datenklo->wave_rx_play, read_rx_wave, &datenklo->samplerate, &channels, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DDATENKLO, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 			return rc;
 		}
 	}
 	if (read_tx_wave) {
-		rc = wave_create_playback(&datenklo->wave_tx_play, read_tx_wave, &datenklo->samplerate, &channels, 1.0);
+		rc = wave_create_playback(&datenklo->wave_tx_play, read_tx_wave, &datenklo->samplerate, &channels, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DDATENKLO, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 			return rc;
@@ -1472,20 +1527,171 @@ static void display_level(datenklo_t *datenklo, sample_t *samples, int count)
 	}
 }
 
+/* worker threads to demodulate the lines
+ *
+ * each worker demodulates a part of the lines with its own demodulator bank.
+ * the main thread holds the lock while the workers process, so the upper
+ * layers of each line are not accessed by the device thread at the same
+ * time. timers are only scheduled by the main thread.
+ */
+typedef struct dk_worker {
+	pthread_t	tid;
+	int		started;
+	int		first, num;		/* lines of this worker */
+	fsk_demod_bank_t bank;			/* demodulators of these lines */
+} dk_worker_t;
+
+static dk_worker_t *workers = NULL;
+static int num_workers = 0;
+static am791x_t **work_am791x;			/* modem of each line */
+static sample_t **work_samples;			/* samples of each line */
+static int work_count;				/* number of samples */
+static pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done_cond = PTHREAD_COND_INITIALIZER;
+static int work_job = 0, work_busy = 0, work_quit = 0;
+
+static void *worker_child(void *arg)
+{
+	dk_worker_t *worker = (dk_worker_t *)arg;
+	int job = 0;
+
+	thread_prio_apply(THREAD_WORKER);
+
+	while (1) {
+		pthread_mutex_lock(&work_mutex);
+		while (job == work_job && !work_quit)
+			pthread_cond_wait(&work_cond, &work_mutex);
+		if (work_quit) {
+			pthread_mutex_unlock(&work_mutex);
+			break;
+		}
+		job = work_job;
+		pthread_mutex_unlock(&work_mutex);
+
+		am791x_receive_bank(&worker->bank, work_am791x + worker->first, work_samples + worker->first, worker->num, work_count);
+
+		pthread_mutex_lock(&work_mutex);
+		if (--work_busy == 0)
+			pthread_cond_signal(&work_done_cond);
+		pthread_mutex_unlock(&work_mutex);
+	}
+
+	return NULL;
+}
+
+static void stop_workers(void)
+{
+	int w;
+
+	if (!workers)
+		return;
+
+	pthread_mutex_lock(&work_mutex);
+	work_quit = 1;
+	pthread_cond_broadcast(&work_cond);
+	pthread_mutex_unlock(&work_mutex);
+
+	for (w = 0; w < num_workers; w++) {
+		if (workers[w].started)
+			pthread_join(workers[w].tid, NULL);
+		fsk_demod_bank_exit(&workers[w].bank);
+	}
+	free(workers);
+	workers = NULL;
+	num_workers = 0;
+	work_quit = 0;
+}
+
+/* split lines to workers, the first worker is processed by the main thread */
+static int start_workers(int num_lines, int num)
+{
+	int w, rc;
+
+	if (num > num_lines)
+		num = num_lines;
+	if (num < 1)
+		num = 1;
+
+	workers = calloc(num, sizeof(*workers));
+	if (!workers) {
+		LOGP(DDATENKLO, LOGL_ERROR, "No memory!\n");
+		return -ENOMEM;
+	}
+	num_workers = num;
+
+	for (w = 0; w < num; w++) {
+		workers[w].first = num_lines * w / num;
+		workers[w].num = num_lines * (w + 1) / num - workers[w].first;
+		rc = fsk_demod_bank_init(&workers[w].bank, workers[w].num);
+		if (rc < 0)
+			goto error;
+		if (w == 0)
+			continue;
+		rc = pthread_create(&workers[w].tid, NULL, worker_child, &workers[w]);
+		if (rc) {
+			LOGP(DDATENKLO, LOGL_ERROR, "Failed to create worker thread!\n");
+			rc = -rc;
+			goto error;
+		}
+		workers[w].started = 1;
+	}
+	if (num > 1)
+		LOGP(DDATENKLO, LOGL_INFO, "Demodulating %d lines with %d threads.\n", num_lines, num);
+
+	return 0;
+
+error:
+	stop_workers();
+	return rc;
+}
+
+/* demodulate all lines, wait until all workers are done */
+static void receive_lines(am791x_t **am791x, sample_t **samples, int count)
+{
+	work_am791x = am791x;
+	work_samples = samples;
+	work_count = count;
+
+	if (num_workers > 1) {
+		pthread_mutex_lock(&work_mutex);
+		work_busy = num_workers - 1;
+		work_job++;
+		pthread_cond_broadcast(&work_cond);
+		pthread_mutex_unlock(&work_mutex);
+	}
+
+	am791x_receive_bank(&workers[0].bank, am791x + workers[0].first, samples + workers[0].first, workers[0].num, count);
+
+	if (num_workers > 1) {
+		pthread_mutex_lock(&work_mutex);
+		while (work_busy)
+			pthread_cond_wait(&work_done_cond, &work_mutex);
+		pthread_mutex_unlock(&work_mutex);
+	}
+}
+
 /* main loop */
-void datenklo_main(datenklo_t *datenklo, int loopback)
+void datenklo_main(datenklo_t *datenklo, int loopback, int threads)
 {
-	int num_chan = 1;
+	int num_chan = 0;
 	int interval = 1;
 	double begin_time, now, sleep;
 	struct termios term, term_orig;
+	datenklo_t *dk;
 	int c;
 	int i;
 
-	/* stereo */
-	if (datenklo->slave)
-		num_chan = 2;
+	/* all lines of this audio device */
+	for (dk = datenklo; dk; dk = dk->slave)
+		num_chan++;
 
+	datenklo_t *line[num_chan];
+	am791x_t *am791x[num_chan];
+	for (i = 0, dk = datenklo; dk; dk = dk->slave, i++) {
+		line[i] = dk;
+		am791x[i] = &dk->am791x;
+	}
 	sample_t buff[num_chan][datenklo->buffer_size], *samples[num_chan];
 	uint8_t pbuff[num_chan][datenklo->buffer_size], *power[num_chan];
 	for (i = 0; i < num_chan; i++) {
@@ -1496,6 +1702,16 @@ void datenklo_main(datenklo_t *datenklo, int loopback)
 	int count;
 	int __attribute__((unused)) rc;
 
+	if (start_workers(num_chan, threads) < 0)
+		return;
+
+	thread_prio_apply(THREAD_MAIN);
+	/* all buffers are allocated now */
+	if (thread_prio_lock_memory() < 0) {
+		stop_workers();
+		return;
+	}
+
 	pthread_mutex_lock(&mutex);
 
 	/* prepare terminal */
@@ -1517,19 +1733,21 @@ void datenklo_main(datenklo_t *datenklo, int loopback)
 	while (!quit) {
 		begin_time = get_time();
 
-		process_auto_rts(datenklo);
 		/* process Auto RTS */
-		if (num_chan > 1)
-			process_auto_rts(datenklo->slave);
+		for (i = 0; i < num_chan; i++)
+			process_auto_rts(line[i]);
 
 		/* Timers may only be processed in main thread, because libosmocore has timer lists for individual threads. */
-		if (datenklo->vtimer_us < 0)
-			osmo_timer_del(&datenklo->vtimer);
-		if (datenklo->vtimer_us > 0)
-			osmo_timer_schedule(&datenklo->vtimer, datenklo->vtimer_us / 1000000,datenklo->vtimer_us % 1000000);
-		datenklo->vtimer_us = 0;
-
-		am791x_add_del_timers(&datenklo->am791x);
+		for (i = 0; i < num_chan; i++) {
+			dk = line[i];
+			if (dk->vtimer_us < 0)
+				osmo_timer_del(&dk->vtimer);
+			if (dk->vtimer_us > 0)
+				osmo_timer_schedule(&dk->vtimer, dk->vtimer_us / 1000000,dk->vtimer_us % 1000000);
+			dk->vtimer_us = 0;
+
+			am791x_add_del_timers(&dk->am791x);
+		}
 
 		osmo_select_main(1);
 
@@ -1555,14 +1773,11 @@ void datenklo_main(datenklo_t *datenklo, int loopback)
 
 		/* put audio into modem */
 		if (!loopback) {
-			display_wave(&datenklo->dispwav, samples[0], count, 1);
-			display_level(datenklo, samples[0], count);
-			am791x_receive(&datenklo->am791x, samples[0], count);
-			if (num_chan > 1) {
-				display_wave(&datenklo->slave->dispwav, samples[1], count, 1);
-				display_level(datenklo->slave, samples[1], count);
-				am791x_receive(&datenklo->slave->am791x, samples[1], count);
+			for (i = 0; i < num_chan; i++) {
+				display_wave(&line[i]->dispwav, samples[i], count, 1);
+				display_level(line[i], samples[i], count);
 			}
+			receive_lines(am791x, samples, count);
 		}
 
 #ifdef HAVE_ALSA
@@ -1580,32 +1795,24 @@ void datenklo_main(datenklo_t *datenklo, int loopback)
 		}
 
 		/* get audio from modem */
-		am791x_send(&datenklo->am791x, samples[0], count);
-		if (num_chan > 1) {
-			am791x_send(&datenklo->slave->am791x, samples[1], count);
-		}
+		for (i = 0; i < num_chan; i++)
+			am791x_send(am791x[i], samples[i], count);
 		if (loopback) {
 			/* copy buffer to preserve original audio for later use */
 			sample_t lbuff[num_chan][datenklo->buffer_size];
 			memcpy(lbuff, buff, sizeof(lbuff));
-			if (loopback == 2 && num_chan == 2) {
-				/* swap */
-				samples[0] = lbuff[1];
-				samples[1] = lbuff[0];
-			} else {
-				samples[0] = lbuff[0];
-				samples[1] = lbuff[1];
-			}
-			display_wave(&datenklo->dispwav, samples[0], count, 1);
-			display_level(datenklo, samples[0], count);
-			am791x_receive(&datenklo->am791x, samples[0], count);
-			if (num_chan > 1) {
-				display_wave(&datenklo->slave->dispwav, samples[1], count, 1);
-				display_level(datenklo->slave, samples[1], count);
-				am791x_receive(&datenklo->slave->am791x, samples[1], count);
+			for (i = 0; i < num_chan; i++) {
+				/* swap pairs of lines */
+				if (loopback == 2 && (i ^ 1) < num_chan)
+					samples[i] = lbuff[i ^ 1];
+				else
+					samples[i] = lbuff[i];
+				display_wave(&line[i]->dispwav, samples[i], count, 1);
+				display_level(line[i], samples[i], count);
 			}
-			samples[0] = buff[0];
-			samples[1] = buff[1];
+			receive_lines(am791x, samples, count);
+			for (i = 0; i < num_chan; i++)
+				samples[i] = buff[i];
 		}
 		memset(power[0], 1, count);
 
@@ -1658,8 +1865,7 @@ next_char:
 		sleep = ((double)interval / 1000.0) - (now - begin_time);
 
 		pthread_mutex_unlock(&mutex);
-		if (sleep > 0)
-			usleep(sleep * 1000000.0);
+		wait_main(sleep);
 		pthread_mutex_lock(&mutex);
 	}
 
@@ -1676,6 +1882,8 @@ next_char:
 	display_wave_on(0);
 
 	pthread_mutex_unlock(&mutex);
+
+	stop_workers();
 }
 
 /* cleanup function */
@@ -1698,6 +1906,7 @@ void datenklo_exit(datenklo_t *datenklo)
 	wave_destroy_record(&datenklo->wave_rx_rec);
 	wave_destroy_record(&datenklo->wave_tx_rec);
 	wave_destroy_playback(&datenklo->wave_rx_play);
+	display_wave_exit(&datenklo->dispwav);
 	wave_destroy_playback(&datenklo->wave_tx_play);
 }
 
@@ -85,7 +85,7 @@ typedef struct datenklo {
 	int		last_bit;		/* to check if we have valid quality */
 } datenklo_t;
 
-void datenklo_main(datenklo_t *datenklo, int loopback);
+void datenklo_main(datenklo_t *datenklo, int loopback, int threads);
 int datenklo_init(datenklo_t *datenklo, const char *dev_name, enum am791x_type am791x_type, uint8_t mc, int auto_rts, double force_tx_baud, double force_rx_baud, int samplerate, int loopback);
 int datenklo_open_audio(datenklo_t *datenklo, const char *audiodev, int buffer, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave);
 void datenklo_exit(datenklo_t *datenklo);
@@ -27,7 +27,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/uio.h>
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 #define __USE_GNU
 #include <pthread.h>
 #include <signal.h>
@@ -47,7 +49,7 @@ typedef struct device {
 	int major, minor;
 	int (*open_cb)(void *inst, int flags);
 	void (*close_cb)(void *inst);
-	ssize_t (*read_cb)(void *inst, char *buf, size_t size, int flags);
+	ssize_t (*read_cb)(void *inst, struct iovec *iov, size_t size, int flags);
 	ssize_t (*write_cb)(void *inst, const char *buf, size_t size, int flags);
 	ssize_t (*ioctl_get_cb)(void *inst, int cmd, void *buf, size_t out_bufsz);
 	ssize_t (*ioctl_set_cb)(void *inst, int cmd, const void *buf, size_t in_bufsz);
@@ -65,6 +67,7 @@ typedef struct device {
 	fuse_req_t write_req;
 	size_t write_size;
 	char *write_buf;
+	size_t write_buf_size;
 	int write_flags;
 	int write_locked;
 } device_t;
@@ -133,6 +136,19 @@ static void cuse_read_interrupt(fuse_req_t req, void *data)
 		device->unlock_cb();
 }
 
+/* reply with the spans of the read buffer, must be called while locked, so the buffer is not overwritten */
+static void reply_read(fuse_req_t req, struct iovec *iov, ssize_t count)
+{
+	if (count < 0)
+		fuse_reply_err(req, -count);
+	else if (count == 0)
+		fuse_reply_buf(req, NULL, 0);
+	else if ((size_t)count == iov[0].iov_len)
+		fuse_reply_iov(req, iov, 1);
+	else
+		fuse_reply_iov(req, iov, 2);
+}
+
 void device_read_available(void *inst)
 {
 	device_t *device = (device_t *)inst;
@@ -142,12 +158,12 @@ void device_read_available(void *inst)
 
 	/* if enough data or if buffer is full */
 	if (device->read_req) {
-		char buf[device->read_size];
-		count = device->read_cb(device->inst, buf, device->read_size, device->read_flags);
+		struct iovec iov[2];
+		count = device->read_cb(device->inst, iov, device->read_size, device->read_flags);
 		/* still blocking, waiting for more... */
 		if (count == -EAGAIN)
 			return;
-		fuse_reply_buf(device->read_req, buf, count);
+		reply_read(device->read_req, iov, count);
 		device->read_req = NULL;
 	}
 }
@@ -157,11 +173,11 @@ static void cuse_device_read(fuse_req_t req, size_t size, off_t off, struct fuse
 	(void)off;
 	(void)fi;
 	ssize_t count;
+	struct iovec iov[2];
 	device_t *device = get_device_by_thread();
 
 	if (size > 65536)
 		size = 65536;
-	char buf[size];
 
 	device->lock_cb();
 
@@ -175,7 +191,7 @@ static void cuse_device_read(fuse_req_t req, size_t size, off_t off, struct fuse
 #ifdef DEBUG_POLL
 	puts("read: before fn");
 #endif
-	count = device->read_cb(device->inst, buf, size, fi->flags);
+	count = device->read_cb(device->inst, iov, size, fi->flags);
 #ifdef DEBUG_POLL
 	puts("read: after fn");
 #endif
@@ -197,12 +213,10 @@ static void cuse_device_read(fuse_req_t req, size_t size, off_t off, struct fuse
 		return;
 	}
 
-	device->unlock_cb();
+	/* the data is sent from the read buffer directly, so we reply before unlocking */
+	reply_read(req, iov, count);
 
-	if (count < 0)
-		fuse_reply_err(req, -count);
-	else
-		fuse_reply_buf(req, buf, count);
+	device->unlock_cb();
 #ifdef DEBUG_POLL
 	puts("read: after reply");
 #endif
@@ -220,8 +234,6 @@ static void cuse_write_interrupt(fuse_req_t req, void *data)
 
 	if (device->write_req) {
 		device->write_req = NULL;
-		free(device->write_buf);
-		device->write_buf = NULL;
 		/* flushing TX buffer */
 		device->flush_tx(device->inst);
 		fuse_reply_err(req, EINTR);
@@ -246,8 +258,6 @@ void device_write_available(void *inst)
 			return;
 		fuse_reply_write(device->write_req, count);
 		device->write_req = NULL;
-		free(device->write_buf);
-		device->write_buf = NULL;
 	}
 }
 	
@@ -275,10 +285,15 @@ static void cuse_device_write(fuse_req_t req, const char *buf, size_t size, off_
 
 		device->write_req = req;
 		device->write_size = size;
-		device->write_buf = malloc(size);
-		if (!buf) {
-			LOGP(DDEVICE, LOGL_ERROR, "No memory!\n");
-			exit(0);
+		/* keep the buffer for the next blocking write */
+		if (device->write_buf_size < size) {
+			free(device->write_buf);
+			device->write_buf = malloc(size);
+			if (!device->write_buf) {
+				LOGP(DDEVICE, LOGL_ERROR, "No memory!\n");
+				exit(0);
+			}
+			device->write_buf_size = size;
 		}
 		memcpy(device->write_buf, buf, size);
 		device->write_flags = fi->flags;
@@ -469,6 +484,8 @@ static void *device_child(void *arg)
 
 	strncat(dev_name, device->name, sizeof(dev_name) - strlen(dev_name) - 1);
 
+	thread_prio_apply(THREAD_DEVICE);
+
 	memset(&ci, 0, sizeof(ci));
 	ci.dev_major = device->major;
 	ci.dev_minor = device->minor;
@@ -487,7 +504,7 @@ static void *device_child(void *arg)
 	return NULL;
 }
 
-void *device_init(void *inst, const char *name, int (*open)(void *inst, int flags), void (*close)(void *inst), ssize_t (*read)(void *inst, char *buf, size_t size, int flags), ssize_t (*write)(void *inst, const char *buf, size_t size, int flags), ssize_t ioctl_get(void *inst, int cmd, void *buf, size_t out_bufsz), ssize_t ioctl_set(void *inst, int cmd, const void *buf, size_t in_bufsz), void (*flush_tx)(void *inst), void (*lock)(void), void (*unlock)(void))
+void *device_init(void *inst, const char *name, int (*open)(void *inst, int flags), void (*close)(void *inst), ssize_t (*read)(void *inst, struct iovec *iov, size_t size, int flags), ssize_t (*write)(void *inst, const char *buf, size_t size, int flags), ssize_t ioctl_get(void *inst, int cmd, void *buf, size_t out_bufsz), ssize_t ioctl_set(void *inst, int cmd, const void *buf, size_t in_bufsz), void (*flush_tx)(void *inst), void (*lock)(void), void (*unlock)(void))
 {
 	int rc = -EINVAL;
 	char tname[64];
@@ -554,6 +571,8 @@ void device_exit(void *inst)
 
 	/* the device-thread is terminated when the program terminates, so no kill required (REALLY????) */
 
+	if (device)
+		free(device->write_buf);
 	free(device);
 }
 
@@ -30,6 +30,7 @@
 #include <osmocom/cc/misc.h>
 #include "../liboptions/options.h"
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 #include "../libfsk/fsk.h"
 #include "../libwave/wave.h"
 #include "../libdisplay/display.h"
@@ -37,7 +38,7 @@
 #include "uart.h"
 #include "datenklo.h"
 
-#define MAX_DEVICES 2
+#define MAX_DEVICES 32
 
 #define OPT_ARRAY(num_name, name, value) \
 { \
@@ -66,6 +67,8 @@ static const char *audiodev = "hw:0,0";
 static int dsp_samplerate = 48000;
 static int dsp_buffer = 50;
 static int stereo = 0;
+static int num_lines = 0;
+static int threads = 1;
 static int loopback = 0;
 static int fast_math = 0;
 const char *write_tx_wave = NULL;
@@ -102,6 +105,13 @@ static void print_help(const char *arg0)
 	printf("        the right channel of the audio device. The device number in the device\n");
 	printf("        name is automatically increased by one. You must also define the mode\n");
 	printf("        twice. (-M <mode> -M <mode>)\n");
+	printf("    --lines <number>\n");
+	printf("        Generate a pool of devices. Each device connects to one channel of a\n");
+	printf("        multi channel audio device. (up to %d) The device number in the device\n", MAX_DEVICES);
+	printf("        name is automatically increased by one. If less modes than devices are\n");
+	printf("        defined, the last mode is used for all other devices.\n");
+	printf("    --threads <number>\n");
+	printf("        Number of threads to demodulate the lines of the pool. (default = '%d')\n", threads);
 	printf(" -a --audio-device hw:<card>,<device>\n");
 	printf("        Sound card and device number (default = '%s')\n", audiodev);
 	printf(" -s --samplerate <rate>\n");
@@ -114,6 +124,7 @@ static void print_help(const char *arg0)
 	printf("        type 2: Audio is crossed between two modem instances. (use with -S)\n");
 	printf("    --fast-math\n");
 	printf("        Use fast math approximation for slow CPU / ARM based systems.\n");
+	thread_prio_print_help();
         printf("    --write-rx-wave <file>\n");
         printf("        Write received audio to given wave file.\n");
         printf("    --write-tx-wave <file>\n");
@@ -130,6 +141,10 @@ static void print_help(const char *arg0)
 #define	OPT_READ_TX_WAVE	1004
 #define	OPT_MNCC_NAME		1006
 #define	OPT_FAST_MATH		1007
+#define	OPT_LINES		1008
+#define	OPT_THREADS		1009
+#define	OPT_THREAD		1010
+#define	OPT_MLOCK		1011
 
 static void add_options(void)
 {
@@ -141,6 +156,10 @@ static void add_options(void)
 	option_add('B', "baudrate", 2);
 	option_add('D', "device", 1);
 	option_add('S', "stereo", 0);
+	option_add(OPT_LINES, "lines", 1);
+	option_add(OPT_THREADS, "threads", 1);
+	option_add(OPT_THREAD, "thread", 1);
+	option_add(OPT_MLOCK, "mlock", 0);
 	option_add('a', "audio-device", 1);
 	option_add('s', "samplerate", 1);
 	option_add('b', "buffer", 1);
@@ -205,6 +224,27 @@ static int handle_options(int short_option, int argi, char **argv)
 	case 'S':
 		stereo = 1;
 		break;
+	case OPT_LINES:
+		num_lines = atoi(argv[argi]);
+		if (num_lines < 1 || num_lines > MAX_DEVICES) {
+			fprintf(stderr, "Given number of lines '%s' is invalid, use '-h' for help!\n", argv[argi]);
+			return -EINVAL;
+		}
+		break;
+	case OPT_THREADS:
+		threads = atoi(argv[argi]);
+		if (threads < 1) {
+			fprintf(stderr, "Given number of threads '%s' is invalid, use '-h' for help!\n", argv[argi]);
+			return -EINVAL;
+		}
+		break;
+	case OPT_THREAD:
+		if (thread_prio_parse(argv[argi]) < 0)
+			return -EINVAL;
+		break;
+	case OPT_MLOCK:
+		thread_prio_mlock = 1;
+		break;
 	case 'a':
 		audiodev = options_strdup(argv[argi]);
 		break;
@@ -284,10 +324,19 @@ int main(int argc, char *argv[])
 	if (stereo) {
 		num_kanal = 2;
 	}
+	if (num_lines)
+		num_kanal = num_lines;
 	if (num_mc == 0) {
 		fprintf(stderr, "You need to set the mode of the modem chip. See '--help'.\n");
 		exit(0);
 	}
+	/* a pool uses the last mode for the other lines */
+	if (num_lines) {
+		while (num_mc < num_kanal) {
+			mc[num_mc] = mc[num_mc - 1];
+			num_mc++;
+		}
+	}
 	if (num_mc < num_kanal) {
 		fprintf(stderr, "You need to specify as many mode settings as you have channels.\n");
 		exit(0);
@@ -317,7 +366,7 @@ int main(int argc, char *argv[])
 		goto fail;
 	}
 
-	datenklo_main(&datenklo[0], loopback);
+	datenklo_main(&datenklo[0], loopback, threads);
 
 fail:
 	for (i = 0; i < num_kanal; i++)
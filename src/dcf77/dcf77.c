@@ -36,6 +36,7 @@ double get_time(void);
 #define TEST_FREQUENCY		1000
 #define CARRIER_BANDWIDTH	10.0
 #define SAMPLE_CLOCK		1000
+#define DECIMATED_RATE		2000	/* rate after mixing, above SAMPLE_CLOCK */
 #define CLOCK_BANDWIDTH		0.1
 #define REDUCTION_FACTOR	0.15
 #define REDUCTION_TH		0.575
@@ -418,12 +419,16 @@ dcf77_t *dcf77_create(int samplerate, int use_tx, int use_rx, int test_tone)
 
 		/* carrier filter */
 		rx->carrier_phase_step = rx->phase_360 * (double)CARRIER_FREQUENCY / ((double)samplerate);
+		/* decimate right after mixing, the carrier carries only a few Hz */
+		rx->dec_factor = (int)round((double)samplerate / (double)DECIMATED_RATE);
+		if (rx->dec_factor < 1)
+			rx->dec_factor = 1;
 		/* use fourth order (2 iter) filter, since it is as fast as second order (1 iter) filter */
-		iir_lowpass_init(&rx->carrier_lp[0], CARRIER_BANDWIDTH, (double)samplerate, 2);
-		iir_lowpass_init(&rx->carrier_lp[1], CARRIER_BANDWIDTH, (double)samplerate, 2);
+		iir_lowpass_init(&rx->carrier_lp[0], CARRIER_BANDWIDTH, (double)samplerate / (double)rx->dec_factor, 2);
+		iir_lowpass_init(&rx->carrier_lp[1], CARRIER_BANDWIDTH, (double)samplerate / (double)rx->dec_factor, 2);
 
 		/* signal rate */
-		rx->sample_step = (double)SAMPLE_CLOCK / (double)samplerate;
+		rx->sample_step = (double)SAMPLE_CLOCK / ((double)samplerate / (double)rx->dec_factor);
 
 		/* delay buffer */
 		rx->delay_size = ceil((double)SAMPLE_CLOCK * 0.1);
@@ -464,6 +469,7 @@ void dcf77_destroy(dcf77_t *dcf77)
 	if (dcf77) {
 		dcf77_rx_t *rx = &dcf77->rx;
 		free(rx->delay_buffer);
+		display_wave_exit(&dcf77->dispwav);
 		free(dcf77);
 	}
 
@@ -1205,9 +1211,10 @@ static void rx_symbol(dcf77_t *dcf77, char symbol)
 void dcf77_decode(dcf77_t *dcf77, sample_t *samples, int length)
 {
 	dcf77_rx_t *rx = &dcf77->rx;
-	sample_t I[length], Q[length];
+	sample_t I[length / rx->dec_factor + 1], Q[length / rx->dec_factor + 1];
 	double phase, level, delayed_level, reduction, quality;
-	int i;
+	double i_mix, q_mix, fall, rise, norm;
+	int i, n, index, factor;
 
 	display_wave(&dcf77->dispwav, samples, length, 1.0);
 
@@ -1217,32 +1224,59 @@ void dcf77_decode(dcf77_t *dcf77, sample_t *samples, int length)
 	if (!rx->enable)
 		return;
 
-	/* rotate spectrum */
+	/* rotate spectrum and decimate
+	 * Each output is the sum over two decimation periods with triangular
+	 * weights, which is a second order CIC filter. Each sample adds to the
+	 * falling half of the current output and to the rising half of the next.
+	 */
 	phase = rx->carrier_phase;
+	factor = rx->dec_factor;
+	norm = 1.0 / ((double)factor * (double)(factor + 1));
+	index = rx->dec_index;
+	n = 0;
 	for (i = 0; i < length; i++) {
 		/* mix with carrier frequency */
 		if (fast_math) {
-			I[i] = cos_tab[(uint16_t)phase] * samples[i];
-			Q[i] = sin_tab[(uint16_t)phase] * samples[i];
+			i_mix = cos_tab[(uint16_t)phase] * samples[i];
+			q_mix = sin_tab[(uint16_t)phase] * samples[i];
 		} else {
-			I[i] = cos(phase) * samples[i];
-			Q[i] = sin(phase) * samples[i];
+			i_mix = cos(phase) * samples[i];
+			q_mix = sin(phase) * samples[i];
 		}
 		phase += rx->carrier_phase_step;
 		if (phase >= rx->phase_360)
 			phase -= rx->phase_360;
+		if (i == 0) {
+			level = sqrt(i_mix * i_mix + q_mix * q_mix);
+			if (level > 0.0) // don't average with level of 0.0 (-inf dB)
+				display_measurements_update(dcf77->dmp_input_level, level2db(level), 0.0);
+		}
+		/* decimate */
+		fall = (double)(factor - index);
+		rise = (double)(index + 1);
+		rx->dec_I[0] += fall * i_mix;
+		rx->dec_Q[0] += fall * q_mix;
+		rx->dec_I[1] += rise * i_mix;
+		rx->dec_Q[1] += rise * q_mix;
+		if (++index == factor) {
+			index = 0;
+			I[n] = rx->dec_I[0] * norm;
+			Q[n] = rx->dec_Q[0] * norm;
+			n++;
+			rx->dec_I[0] = rx->dec_I[1];
+			rx->dec_Q[0] = rx->dec_Q[1];
+			rx->dec_I[1] = 0.0;
+			rx->dec_Q[1] = 0.0;
+		}
 	}
 	rx->carrier_phase = phase;
+	rx->dec_index = index;
 
-	level = sqrt(I[0] * I[0] + Q[0] * Q[0]);
-	if (level > 0.0) // don't average with level of 0.0 (-inf dB)
-		display_measurements_update(dcf77->dmp_input_level, level2db(level), 0.0);
-
-	/* filter carrier */
-	iir_process(&rx->carrier_lp[0], I, length);
-	iir_process(&rx->carrier_lp[1], Q, length);
+	/* filter carrier at decimated rate */
+	iir_process(&rx->carrier_lp[0], I, n);
+	iir_process(&rx->carrier_lp[1], Q, n);
 
-	for (i = 0; i < length; i++) {
+	for (i = 0; i < n; i++) {
 		rx->sample_counter += rx->sample_step;
 		if (rx->sample_counter >= 1.0) {
 			rx->sample_counter -= 1.0;
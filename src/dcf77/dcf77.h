@@ -33,7 +33,9 @@ typedef struct dcf77_rx {
 	int enable;
 	double phase_360;
 	double carrier_phase, carrier_phase_step; /* uncorrected phase */
-	iir_filter_t carrier_lp[2]; /* filters received carrier signal */
+	int dec_factor, dec_index; /* decimation of mixed signal */
+	double dec_I[2], dec_Q[2]; /* sums of current and next output, triangular weighted */
+	iir_filter_t carrier_lp[2]; /* filters received carrier signal at decimated rate */
 	double sample_counter, sample_step; /* when to sample */
 	double *delay_buffer;
 	int delay_size, delay_index;
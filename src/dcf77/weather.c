@@ -6,6 +6,7 @@ https://github.com/tobozo/esp32-dcf77-weatherman/blob/master/dcf77.cpp
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <endian.h>
 #include "../liblogging/logging.h"
 #include "weather.h"
@@ -580,3 +581,224 @@ uint64_t weather_encode(uint32_t weather, uint64_t key)
 	return cipher;
 }
 
+
+/*
+ * Bit-sliced cipher for many blocks at once
+ *
+ * The cipher above is a Feistel network with two halves of 20 bits and a
+ * key of 40 bits, which is used as two halves of 20 bits that are rotated
+ * before each round. The round function expands 20 bits to 30 bits, adds the
+ * round key, feeds five 6-bit S-boxes and permutes their 20 output bits.
+ *
+ * Here each bit of the cipher is a 64 bit word, that holds this bit of 64
+ * blocks. All permutations are just indexes to these words. The S-boxes are
+ * evaluated as multiplexer trees, so all 64 blocks are processed with the
+ * same logic operations. The result is the same as above.
+ */
+
+#define WEATHER_LANES	64
+
+/* key bits of the round key in the first round (encryption) */
+static const uint8_t key_compress[30] = {
+	9, 5, 25, 35, 37, 7, 30, 24, 26, 36, 16, 34, 22, 4, 21,
+	19, 14, 38, 17, 20, 15, 6, 12, 10, 0, 31, 3, 1, 18, 28
+};
+
+/* rotation of the key halves after each round (encryption) */
+static const uint8_t key_shift[16] = {
+	1, 1, 2, 1, 1, 1, 2, 2, 1, 1, 1, 1, 1, 1, 1, 2
+};
+
+/* bits of the half that are expanded to bit 20..29 of the S-box input */
+static const uint8_t expand[10] = {
+	19, 4, 3, 8, 7, 12, 11, 16, 15, 0
+};
+
+/* S-box k gets S-box input bits 4k..4k+3 and 20+2k..21+2k */
+static const uint8_t sbox[5][64] = {
+	{
+		11, 14,  2,  5,  3, 15,  7, 13,  0,  9,  1,  8, 12,  4, 10,  6,
+		 4, 13,  8, 11,  1, 10,  3,  2, 12,  5,  7,  0,  9, 15,  6, 14,
+		 1,  7, 13,  3, 10,  0, 12, 15,  4,  8,  6, 11,  2,  9, 14,  5,
+		15,  0,  6,  3,  3, 11, 12, 14,  1,  2, 10,  4,  5,  8,  9,  7,
+	},
+	{
+		11,  0,  2, 12,  7, 13, 15,  6,  9, 14, 10,  3,  1,  8,  4,  5,
+		 6,  8,  2,  0, 13, 11,  9,  5,  1, 12, 10, 15, 14,  7,  3,  4,
+		12,  7,  3, 11, 10, 14,  0,  6,  1,  8, 15,  2, 13,  9,  5,  4,
+		 1,  7,  9, 13, 11,  0, 15, 14,  8,  4, 12,  3, 10,  5,  2,  6,
+	},
+	{
+		11, 13, 12,  4,  5,  6, 14, 15,  7,  1,  8,  9,  3,  2, 10,  0,
+		 5, 11,  2,  8,  9,  7,  1, 13,  3, 10,  0, 15,  6,  4, 12, 14,
+		 7, 12,  3, 15,  8,  6, 11,  5,  2, 10,  9, 13,  0,  1,  4, 14,
+		14,  1,  7,  0,  8,  2, 10, 15,  5, 11, 12, 13,  4,  3,  9,  6,
+	},
+	{
+		10,  3, 15,  7,  6, 14,  0,  4,  9,  1, 13,  5,  8, 12, 11,  2,
+		12,  1, 13,  5,  4,  3,  0,  7,  9, 15, 14,  2,  6, 11, 10,  8,
+		11, 12,  4, 15,  5,  6, 14,  3,  8,  2,  9, 13,  0,  7,  1, 10,
+		 4, 11, 15,  7,  1,  5, 10,  9, 13,  6, 12,  3,  0,  8, 14,  2,
+	},
+	{
+		10,  2,  0, 15,  6,  7, 13,  8,  3, 12, 11,  5,  9,  1,  4, 14,
+		 2,  9,  5, 13, 12, 14, 15,  8,  6,  7, 11,  1,  0, 10,  4,  3,
+		 8,  0, 13, 15,  1, 12,  3,  6, 11,  4,  9,  5, 10,  7,  2, 14,
+		 3, 13,  0, 12,  9,  6, 15, 11,  1, 14,  8, 10,  2,  7,  4,  5,
+	},
+};
+
+/* bit of the round function output for each S-box output bit 4k..4k+3 */
+static const uint8_t pbox[20] = {
+	18, 9, 8, 15, 5, 17, 3, 7, 4, 11, 6, 16, 14, 1, 12, 2, 19, 13, 0, 10
+};
+
+/* key bit of each round key bit for all 16 rounds of encryption */
+static void key_schedule(uint8_t sched[16][30])
+{
+	int round, shift = 0, i, bit;
+
+	for (round = 0; round < 16; round++) {
+		for (i = 0; i < 30; i++) {
+			/* each half of the key rotates within its 20 bits */
+			bit = key_compress[i] % 20 - shift;
+			if (bit < 0)
+				bit += 20;
+			sched[round][i] = (key_compress[i] / 20) * 20 + bit;
+		}
+		shift += key_shift[round];
+	}
+}
+
+/* one S-box for all lanes: each level of the multiplexer tree selects by one input bit */
+static void sbox_sliced(const uint8_t *table, const uint64_t *in, uint64_t *out)
+{
+	uint64_t v[32][4], c0, c1;
+	int i, b, n, level;
+
+	for (i = 0; i < 32; i++) {
+		for (b = 0; b < 4; b++) {
+			c0 = -(uint64_t)((table[i * 2] >> b) & 1);
+			c1 = -(uint64_t)((table[i * 2 + 1] >> b) & 1);
+			v[i][b] = c0 ^ ((c0 ^ c1) & in[0]);
+		}
+	}
+	for (level = 1, n = 16; n; level++, n >>= 1) {
+		for (i = 0; i < n; i++) {
+			for (b = 0; b < 4; b++)
+				v[i][b] = v[i * 2][b] ^ ((v[i * 2][b] ^ v[i * 2 + 1][b]) & in[level]);
+		}
+	}
+	for (b = 0; b < 4; b++)
+		out[b] = v[0][b];
+}
+
+/* run 16 rounds on up to 64 blocks, each bit of a block is one word */
+static void cipher_sliced(uint64_t *block, const uint64_t *key, int decrypt)
+{
+	uint8_t sched[16][30];
+	uint64_t half[2][20], x[30], in[6], out[4];
+	uint64_t *l = half[0], *r = half[1], *f_in, *f_out, *tmp;
+	int round, i, k;
+
+	key_schedule(sched);
+	memcpy(half[0], block, sizeof(half[0]));
+	memcpy(half[1], block + 20, sizeof(half[1]));
+
+	for (round = 0; round < 16; round++) {
+		/* decryption uses the round keys in reverse order and the round function on R */
+		const uint8_t *rk = sched[(decrypt) ? 15 - round : round];
+		f_in = (decrypt) ? r : l;
+		f_out = (decrypt) ? l : r;
+		for (i = 0; i < 20; i++)
+			x[i] = f_in[i] ^ key[rk[i]];
+		for (i = 0; i < 10; i++)
+			x[20 + i] = f_in[expand[i]] ^ key[rk[20 + i]];
+		for (k = 0; k < 5; k++) {
+			in[0] = x[k * 4];
+			in[1] = x[k * 4 + 1];
+			in[2] = x[k * 4 + 2];
+			in[3] = x[k * 4 + 3];
+			in[4] = x[20 + k * 2];
+			in[5] = x[21 + k * 2];
+			sbox_sliced(sbox[k], in, out);
+			for (i = 0; i < 4; i++)
+				f_out[pbox[k * 4 + i]] ^= out[i];
+		}
+		tmp = l;
+		l = r;
+		r = tmp;
+	}
+
+	/* after an even number of rounds, the halves are back in place */
+	memcpy(block, half[0], sizeof(half[0]));
+	memcpy(block + 20, half[1], sizeof(half[1]));
+}
+
+/* transpose up to 64 values of 40 bits into 40 words */
+static void slice(uint64_t *bits, const uint64_t *value, int num)
+{
+	int i, b;
+
+	memset(bits, 0, 40 * sizeof(*bits));
+	for (i = 0; i < num; i++) {
+		for (b = 0; b < 40; b++)
+			bits[b] |= ((value[i] >> b) & 1) << i;
+	}
+}
+
+static void unslice(uint64_t *value, const uint64_t *bits, int num)
+{
+	int i, b;
+
+	for (i = 0; i < num; i++) {
+		value[i] = 0;
+		for (b = 0; b < 40; b++)
+			value[i] |= ((bits[b] >> i) & 1) << b;
+	}
+}
+
+/* encode given weather infos with their keys, like weather_encode() */
+void weather_encode_batch(const uint32_t *weather, const uint64_t *key, uint64_t *cipher, int num)
+{
+	uint64_t plain[WEATHER_LANES], block[40], key_bits[40];
+	uint8_t *PlainBytes;
+	int n, i, j;
+
+	for (n = 0; n < num; n += WEATHER_LANES) {
+		int lanes = (num - n < WEATHER_LANES) ? num - n : WEATHER_LANES;
+		for (i = 0; i < lanes; i++) {
+			PlainBytes = GetPlainFromWeather(weather[n + i]);
+			plain[i] = 0;
+			for (j = 0; j < 5; j++)
+				plain[i] |= (uint64_t)PlainBytes[j] << (j * 8);
+		}
+		slice(block, plain, lanes);
+		slice(key_bits, key + n, lanes);
+		cipher_sliced(block, key_bits, 0);
+		unslice(cipher + n, block, lanes);
+	}
+}
+
+/* decode given crypted frames with their keys, like weather_decode()
+ * the weather info or -1 on checksum error is stored for each frame
+ */
+void weather_decode_batch(const uint64_t *cipher, const uint64_t *key, int32_t *weather, int num)
+{
+	uint64_t plain[WEATHER_LANES], block[40], key_bits[40];
+	uint8_t PlainBytes[5];
+	int n, i, j;
+
+	for (n = 0; n < num; n += WEATHER_LANES) {
+		int lanes = (num - n < WEATHER_LANES) ? num - n : WEATHER_LANES;
+		slice(block, cipher + n, lanes);
+		slice(key_bits, key + n, lanes);
+		cipher_sliced(block, key_bits, 1);
+		unslice(plain, block, lanes);
+		for (i = 0; i < lanes; i++) {
+			for (j = 0; j < 5; j++)
+				PlainBytes[j] = plain[i] >> (j * 8);
+			weather[n + i] = GetWeatherFromPlain(PlainBytes);
+		}
+	}
+}
@@ -1,3 +1,5 @@
 
 int32_t weather_decode(uint64_t cipher, uint64_t key);
 uint64_t weather_encode(uint32_t weather, uint64_t key);
+void weather_encode_batch(const uint32_t *weather, const uint64_t *key, uint64_t *cipher, int num);
+void weather_decode_batch(const uint64_t *cipher, const uint64_t *key, int32_t *weather, int num);
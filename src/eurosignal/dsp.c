@@ -42,9 +42,10 @@
 #define DIGIT_DURATION	0.1	/* duration of digit */
 #define PAUSE_DURATION	0.22	/* duration of pause */
 
-#define FREQUENCY_MIN	313.3
-#define FREQUENCY_MAX	1153.1
-#define FREQUENCY_TOL	15.0	/* tolerance of frequency */
+#define RX_SAMPLERATE	8000	/* sample rate of tone decoder */
+#define RX_WINDOW	240	/* window of tone decoder (30 ms), resolves adjacent tones */
+#define RX_HOP		40	/* decide every 5 ms */
+#define TONE_PURITY	0.35	/* minimum part of window power in the strongest tone */
 #define DIGIT_DETECT	200	/* time for a tone to sustain (in samples) */
 #define TIMEOUT_DETECT	4000	/* time for timeout detection (in samples) */
 
@@ -53,7 +54,7 @@ static struct dsp_digits {
 	char	*name;
 	double	frequency;
 	double	phaseshift65536;
-} dsp_digits[] = {
+} dsp_digits[EURO_TONES + 1] = {
 	{ 'I',	"Idle",		1153.1,	0 },
 	{ 'R',	"Repeat",	1062.9,	0 },
 	{ '0',	"Digit 0",	 979.8,	0 },
@@ -114,13 +115,22 @@ void dsp_init(int samplerate)
 		dsp_tone[i] = sin((double)i / 65536.0 * 2.0 * PI);
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_sender(euro_t *euro, int samplerate, int fm)
 {
+	double frequency[EURO_TONES];
 	int rc = 0;
+	int i;
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for 'Sender'.\n");
 
+	/* protocol of this channel */
+	euro->sender.send = send_audio;
+	euro->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	if (fm)
 		sender_set_fm(&euro->sender, MAX_DEVIATION, MAX_MODULATION, TONE_DEVIATION, MAX_DISPLAY);
@@ -132,17 +142,19 @@ int dsp_init_sender(euro_t *euro, int samplerate, int fm)
 	/* initial phase shift */
 	euro->tx_phaseshift65536 = digit_to_phaseshift65536('I');
 
-	/* init demodulator */
-	rc = fm_demod_init(&euro->rx_demod, 8000, (FREQUENCY_MIN + FREQUENCY_MAX) / 2.0, FREQUENCY_MAX - FREQUENCY_MIN);
+	/* init tone decoder */
+	for (i = 0; i < EURO_TONES; i++)
+		frequency[i] = dsp_digits[i].frequency;
+	rc = tone_track_init(&euro->rx_track, frequency, EURO_TONES, RX_SAMPLERATE, RX_WINDOW);
 	if (rc)
 		goto error;
-
-	/* use fourth order (2 iter) filter, since it is as fast as second order (1 iter) filter */
-	iir_lowpass_init(&euro->rx_lp, 25.0, 8000, 2);
+	euro->rx_hop = RX_HOP;
 
 	euro->dmp_tone_level = display_measurements_add(&euro->sender.dispmeas, "Tone Level", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 	//euro->dmp_tone_quality = display_measurements_add(&euro->sender.dispmeas, "Tone Quality", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 
+	sender_account_dsp(&euro->sender, sizeof(*euro) - sizeof(euro->sender));
+
 	return 0;
 
 error:
@@ -156,38 +168,45 @@ void dsp_cleanup_sender(euro_t *euro)
 {
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Cleanup DSP for 'Sender'.\n");
 
-	/* cleanup demodulator */
-	fm_demod_exit(&euro->rx_demod);
+	/* cleanup tone decoder */
+	tone_track_exit(&euro->rx_track);
 }
 
 //#define DEBUG_DECODER
 
+/* All tones are tracked by one sliding DFT. Every RX_HOP samples the strongest
+ * tone is taken, if it holds enough of the window's power. A pure tone of
+ * level L has a power of L * L / 2.
+ */
 static void tone_decode(euro_t *euro, sample_t *samples, int length)
 {
-	sample_t frequency[length], f;
-	sample_t I[length], Q[length];
-	int i, d;
+	double levels[EURO_TONES], level;
+	int i, n, t, d;
 	char digit;
 
-	/* tone demodulation */
-        fm_demodulate_real(&euro->rx_demod, frequency, length, samples, I, Q);
-
-	/* reduce bandwidth of tone detector */
-	iir_process(&euro->rx_lp, frequency, length);
-
-	/* detect tone */
-	for (i = 0; i < length; i++) {
-		/* get frequency */
-		f = frequency[i] + (FREQUENCY_MIN + FREQUENCY_MAX) / 2.0;
-#ifdef DEBUG_DECODER
-		if (i == 0) printf("%s %.5f   ", debug_amplitude(frequency[i] / (FREQUENCY_MAX - FREQUENCY_MIN) * 2.0), f);
-#endif
-		for (d = 0; dsp_digits[d].digit; d++) {
-			if (f >= dsp_digits[d].frequency - FREQUENCY_TOL && f <= dsp_digits[d].frequency + FREQUENCY_TOL)
-				break;
+	for (i = 0; i < length; i += n) {
+		/* slide window until next decision */
+		n = euro->rx_hop;
+		if (n > length - i)
+			n = length - i;
+		tone_track_process(&euro->rx_track, samples + i, n);
+		euro->rx_hop -= n;
+		if (euro->rx_hop)
+			continue;
+		euro->rx_hop = RX_HOP;
+
+		/* detect tone */
+		tone_track_levels(&euro->rx_track, levels);
+		d = 0;
+		for (t = 1; t < EURO_TONES; t++) {
+			if (levels[t] > levels[d])
+				d = t;
 		}
+		level = levels[d];
+		if (level * level < TONE_PURITY * 2.0 * tone_track_power(&euro->rx_track) || level == 0.0)
+			d = EURO_TONES;
 #ifdef DEBUG_DECODER
-		if (i == 0) printf("%c\n", dsp_digits[d].digit);
+		printf("%s %c\n", debug_amplitude(level), dsp_digits[d].digit);
 #endif
 
 		/* change detection and collect digits */
@@ -196,7 +215,7 @@ static void tone_decode(euro_t *euro, sample_t *samples, int length)
 			euro->rx_digit_last = digit;
 			euro->rx_digit_count = 0;
 		}
-		euro->rx_digit_count++;
+		euro->rx_digit_count += RX_HOP;
 		switch (digit) {
 		case 'I':
 			/* pause tone */
@@ -223,8 +242,6 @@ static void tone_decode(euro_t *euro, sample_t *samples, int length)
 				break;
 			/* got digit */
 			if (euro->rx_digit_count == DIGIT_DETECT) {
-				double level;
-				level = sqrt(I[i] * I[i] + Q[i] * Q[i]) * 2;
 				LOGP_CHAN(DDSP, LOGL_DEBUG, "Detected digit '%s' (level = %.0f%%)\n", digit_to_name(digit), level * 100.0);
 				display_measurements_update(euro->dmp_tone_level, level * 100.0, 0.0);
 				euro->rx_digits[euro->rx_digit_index] = digit;
@@ -241,7 +258,7 @@ static void tone_decode(euro_t *euro, sample_t *samples, int length)
 
 		/* abort if tone sustains too long or next tone will not become steady */
 		if (euro->rx_digit_receiving && euro->rx_digit_index) {
-			euro->rx_timeout_count++;
+			euro->rx_timeout_count += RX_HOP;
 			if (euro->rx_timeout_count == TIMEOUT_DETECT) {
 				LOGP_CHAN(DDSP, LOGL_DEBUG, "Timeout receiving, aborting.\n");
 				euro->rx_digit_receiving = 0;
@@ -253,7 +270,7 @@ static void tone_decode(euro_t *euro, sample_t *samples, int length)
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	euro_t *euro = (euro_t *) sender;
 
@@ -306,7 +323,7 @@ static void tone_send(euro_t *euro, sample_t *samples, int length)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	euro_t *euro = (euro_t *) sender;
 
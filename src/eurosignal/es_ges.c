@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "es_ges.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x003f, 0xff8e, 0x0092, 0x0097, 0x001f, 0x0048, 0xffd9, 0xffdb,
 	0xffdb, 0xffc5, 0x000c, 0xffd1, 0xffb2, 0xffe5, 0xff8d, 0xff90,
 	0x0002, 0xff88, 0xffa4, 0x0042, 0xffaa, 0xff57, 0x0013, 0x0040,
@@ -1659,7 +1659,7 @@ static int16_t pattern[] = {
 	0x000d, 0x0088, 0x0091, 0x0034, 0x0028, 0x0025, 0x0010, 0xfff4,
 };
 
-extern int16_t *es_ges_spl;
+extern const int16_t *es_ges_spl;
 extern int es_ges_size;
 
 void init_es_ges(void)
@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "es_kaudn.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0022, 0x0014, 0xffde, 0xff85, 0xff24, 0xff00, 0xff2c, 0xff88,
 	0x002e, 0x00b4, 0x0122, 0x0133, 0x00e3, 0x0077, 0xffde, 0xff48,
 	0xfeec, 0xfecf, 0xff0c, 0xff53, 0xff9b, 0xffda, 0x0034, 0x009a,
@@ -2192,7 +2192,7 @@ static int16_t pattern[] = {
 	0x009f, 0x009e, 0x006a, 0x001d, 0xffa2, 0xff2f, 0xff08, 0xff16,
 };
 
-extern int16_t *es_kaudn_spl;
+extern const int16_t *es_kaudn_spl;
 extern int es_kaudn_size;
 
 void init_es_kaudn(void)
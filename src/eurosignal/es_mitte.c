@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "es_mitte.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0xff96, 0xffd4, 0x0020, 0x0073, 0x0084, 0x0061, 0x002f, 0xfffd,
 	0xffcb, 0xffc5, 0xffc9, 0xffec, 0x0040, 0x0066, 0x007b, 0x0082,
 	0x0065, 0x0068, 0x003e, 0x0023, 0x0036, 0x0023, 0x0029, 0x0032,
@@ -1693,7 +1693,7 @@ static int16_t pattern[] = {
 	0x0125, 0x00d8, 0x0085, 0x002e, 0xffe5, 0xffae, 0xff88, 0xff6e,
 };
 
-extern int16_t *es_mitte_spl;
+extern const int16_t *es_mitte_spl;
 extern int es_mitte_size;
 
 void init_es_mitte(void)
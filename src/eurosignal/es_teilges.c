@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "es_teilges.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0xffa4, 0xffae, 0xffc2, 0xff8a, 0xffb4, 0xfff0, 0xfffa, 0x0005,
 	0xffed, 0xffec, 0x001e, 0x0057, 0x004e, 0x0032, 0x0043, 0x004e,
 	0xfffe, 0x000e, 0x0033, 0xfff9, 0xffd5, 0xffd4, 0xffcb, 0xffcb,
@@ -2251,7 +2251,7 @@ static int16_t pattern[] = {
 	0xff6f, 0xffbc, 0x0041, 0x0032, 0xffcc, 0xffca, 0x0008, 0x006d,
 };
 
-extern int16_t *es_teilges_spl;
+extern const int16_t *es_teilges_spl;
 extern int es_teilges_size;
 
 void init_es_teilges(void)
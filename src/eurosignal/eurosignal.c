@@ -217,6 +217,42 @@ void euro_list_channels(void)
 
 sample_t beep_tone[160];
 
+const int16_t *es_mitte_spl;
+int es_mitte_size;
+const int16_t *es_ges_spl;
+int es_ges_size;
+const int16_t *es_teilges_spl;
+int es_teilges_size;
+const int16_t *es_kaudn_spl;
+int es_kaudn_size;
+
+/* announcements at speech level, so they are copied while playing */
+static sample_t *es_mitte_speech;
+static sample_t *es_ges_speech;
+static sample_t *es_teilges_speech;
+static sample_t *es_kaudn_speech;
+
+static sample_t *render_announcement(const int16_t *spl, int size)
+{
+	int16_t chunk[160];
+	sample_t *speech;
+	int pos, i, n;
+
+	speech = malloc(size * sizeof(*speech));
+	if (!speech) {
+		LOGP(DEURO, LOGL_ERROR, "No mem!\n");
+		return NULL;
+	}
+	for (pos = 0; pos < size; pos += n) {
+		n = (size - pos < 160) ? size - pos : 160;
+		for (i = 0; i < n; i++)
+			chunk[i] = spl[pos + i] >> 2;
+		int16_to_samples_speech(speech + pos, chunk, n);
+	}
+
+	return speech;
+}
+
 /* global init */
 int euro_init(void)
 {
@@ -225,6 +261,13 @@ int euro_init(void)
 	for (i = 0; i < 160; i++)
 		beep_tone[i] = sin(2.0 * M_PI * (double)i * 2500.0 / 8000.0);
 
+	es_mitte_speech = render_announcement(es_mitte_spl, es_mitte_size);
+	es_ges_speech = render_announcement(es_ges_spl, es_ges_size);
+	es_teilges_speech = render_announcement(es_teilges_spl, es_teilges_size);
+	es_kaudn_speech = render_announcement(es_kaudn_spl, es_kaudn_size);
+	if (!es_mitte_speech || !es_ges_speech || !es_teilges_speech || !es_kaudn_speech)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -232,6 +275,15 @@ int euro_init(void)
 void euro_exit(void)
 {
 	flush_id();
+
+	free(es_mitte_speech);
+	es_mitte_speech = NULL;
+	free(es_ges_speech);
+	es_ges_speech = NULL;
+	free(es_teilges_speech);
+	es_teilges_speech = NULL;
+	free(es_kaudn_speech);
+	es_kaudn_speech = NULL;
 }
 
 static void call_timeout(void *data);
@@ -483,30 +535,23 @@ void euro_receive_id(euro_t *euro, char *id)
 	}
 }
 
-int16_t *es_mitte_spl;
-int es_mitte_size;
-int16_t *es_ges_spl;
-int es_ges_size;
-int16_t *es_teilges_spl;
-int es_teilges_size;
-int16_t *es_kaudn_spl;
-int es_kaudn_size;
-
 /* play announcement for one call */
 static void call_play_announcement(euro_call_t *call)
 {
-	int i;
-	int16_t chunk[160];
 	sample_t spl[160];
-
-	for (i = 0; i < 160; i++) {
-		/* announcement or silence, if finished or not set */
-		if (call->announcement_index < call->announcement_size)
-			chunk[i] = call->announcement_spl[call->announcement_index++] >> 2;
-		else
-			chunk[i] = 0.0;
-	}
-	int16_to_samples_speech(spl, chunk, 160);
+	int n;
+
+	/* announcement, then silence, if finished or not set */
+	n = call->announcement_size - call->announcement_index;
+	if (n < 0)
+		n = 0;
+	if (n > 160)
+		n = 160;
+	if (n) {
+		memcpy(spl, call->announcement_spl + call->announcement_index, n * sizeof(*spl));
+		call->announcement_index += n;
+	}
+	memset(spl + n, 0, (160 - n) * sizeof(*spl));
 	call_up_audio(call->callref, spl, 160);
 }
 
@@ -558,7 +603,7 @@ static void call_timeout(void *data)
 		/* if no station is linked to the call, we are out-of-order */
 		if (!call->euro) {
 			LOGP(DEURO, LOGL_INFO, "Station is unavailable, playing announcement.\n");
-			call->announcement_spl = es_ges_spl;
+			call->announcement_spl = es_ges_speech;
 			call->announcement_size = es_ges_size;
 			call->announcement_index = 0;
 			osmo_timer_schedule(&call->timer, OOO_TIME);
@@ -568,7 +613,7 @@ static void call_timeout(void *data)
 		/* if subcriber list is available, but ID is not found, we are unassigned */
 		if (id_list && !search_id(call->station_id)) {
 			LOGP(DEURO, LOGL_INFO, "Subscriber unknown, playing announcement.\n");
-			call->announcement_spl = es_kaudn_spl;
+			call->announcement_spl = es_kaudn_speech;
 			call->announcement_size = es_kaudn_size;
 			call->announcement_index = 0;
 			call->announcement_count = 1;
@@ -579,7 +624,7 @@ static void call_timeout(void *data)
 		/* if station is degraded, play that announcement */
 		if (call->euro->degraded) {
 			LOGP(DEURO, LOGL_INFO, "Station is degraded, playing announcement.\n");
-			call->announcement_spl = es_teilges_spl;
+			call->announcement_spl = es_teilges_speech;
 			call->announcement_size = es_teilges_size;
 			call->announcement_index = 0;
 			osmo_timer_schedule(&call->timer, DEGRADED_TIME);
@@ -589,7 +634,7 @@ static void call_timeout(void *data)
 	/* fall through */
 	case EURO_CALL_DEGRADED:
 		LOGP(DEURO, LOGL_INFO, "Station acknowledges, playing announcement.\n");
-		call->announcement_spl = es_mitte_spl;
+		call->announcement_spl = es_mitte_speech;
 		call->announcement_size = es_mitte_size;
 		call->announcement_index = 0;
 		call->announcement_count = 1;
@@ -598,7 +643,7 @@ static void call_timeout(void *data)
 		break;
 	case EURO_CALL_ACKNOWLEDGE:
 		if (call->announcement_count == 1) {
-			call->announcement_spl = es_mitte_spl;
+			call->announcement_spl = es_mitte_speech;
 			call->announcement_size = es_mitte_size;
 			call->announcement_index = 0;
 			call->announcement_count = 2;
@@ -623,7 +668,7 @@ static void call_timeout(void *data)
 		break;
 	case EURO_CALL_UNASSIGNED:
 		if (call->announcement_count == 1) {
-			call->announcement_spl = es_kaudn_spl;
+			call->announcement_spl = es_kaudn_speech;
 			call->announcement_size = es_kaudn_size;
 			call->announcement_index = 0;
 			call->announcement_count = 2;
@@ -631,7 +676,7 @@ static void call_timeout(void *data)
 			break;
 		}
 		LOGP(DEURO, LOGL_INFO, "Announcement played, playing again.\n");
-		call->announcement_spl = es_kaudn_spl;
+		call->announcement_spl = es_kaudn_speech;
 		call->announcement_size = es_kaudn_size;
 		call->announcement_index = 0;
 		call->announcement_count = 1;
@@ -1,7 +1,10 @@
 #include "../libfm/fm.h"
 #include "../libmobile/sender.h"
+#include "../libgoertzel/goertzel.h"
 #include <osmocom/core/timer.h>
 
+#define EURO_TONES	17	/* number of tones, including idle and repeat */
+
 /* current state of transmitter */
 enum euro_health_state {
 	EURO_HEALTH_WORKING = 0,/*  */
@@ -33,7 +36,7 @@ typedef struct euro_call {
 	struct osmo_timer_list		timer;
 	enum euro_call_state	state;			/* current state */
 	int			announcement_count;	/* used to replay annoucements */
-	int16_t			*announcement_spl;	/* current sample */
+	const sample_t		*announcement_spl;	/* current sample, at speech level */
 	int			announcement_size;	/* current size */
 	int			announcement_index;	/* current sample index */
 } euro_call_t;
@@ -67,8 +70,8 @@ typedef struct eurosignal {
 	double			tx_time;		/* current elapsed time of tone */
 	char			tx_digits[7];		/* current ID being transmitted */
 	int			tx_digit_index;		/* current digit beein transmitted */
-	fm_demod_t		rx_demod;		/* demodulator for frequency */
-	iir_filter_t		rx_lp;			/* low pass to filter the frequency result */
+	tone_track_t		rx_track;		/* sliding DFT of all tones */
+	int			rx_hop;			/* samples until next decision */
 	int			rx_digit_count;		/* count the tone until detected */
 	char			rx_digit_last;		/* last tone, so we detect any change */
 	int			rx_digit_receiving;	/* we receive digis */
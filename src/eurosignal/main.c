@@ -207,12 +207,12 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
@@ -221,7 +221,11 @@ int main(int argc, char *argv[])
 	/* inits */
 	fm_init(fast_math);
 	dsp_init(dsp_samplerate);
-	euro_init();
+	rc = euro_init();
+	if (rc < 0) {
+		fprintf(stderr, "Failed to render announcements. Quitting!\n");
+		goto fail;
+	}
 
 	/* TX is default */
 	if (!tx && !rx)
@@ -50,8 +50,8 @@
 /* RX parameters */
 #define RX_MIN_LEVEL		0.1	/* level relative to TONE_LEVEL, below is silence (-20 dB) */
 #define RX_MIN_PREAMBLE		800	/* duration of silence before detecting first digit (in samples) */
-#define RX_DIGIT_FILTER		100.0	/* frequency to allow change of tones ( 100 Hz = 5 ms ) */
-#define RX_TOL_DIGIT_FREQ	0.045	/* maximum frequency error factor allowd to detect a tone (+- 4.5%) */ 
+#define RX_DIGIT_WINDOW		56	/* window of digit detector, tolerates +-3% frequency error ( 7 ms ) */
+#define RX_DIGIT_PURITY		0.3	/* minimum part of power in the strongest digit */
 #define RX_LEN_DIGIT_TH		80	/* time to wait for digit being stable ( 10 ms ) */
 #define RX_LEN_DIGIT_MIN	400	/* minimum length in seconds allowed for a digit (- 20 ms in samples) */
 #define RX_LEN_DIGIT_MAX	720	/* minimum length in seconds allowed for a digit (+ 20 ms in samples) */
@@ -72,8 +72,6 @@ static double digit_freq[DSP_NUM_DIGITS] = {
 	2400.0,
 	2600.0, /* repeat digit */
 };
-#define DIGIT_FREQ_MIN 1080.0
-#define DIGIT_FREQ_MAX 2600.0
 
 #define REPEAT_DIGIT 10
 
@@ -98,6 +96,9 @@ static struct signals {
 	{ FUENF_FUNKTION_KATASTROPHE,	1, 2 },
 };
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_sender(fuenf_t *fuenf, int samplerate, double max_deviation, double signal_deviation)
 {
@@ -108,19 +109,20 @@ int dsp_init_sender(fuenf_t *fuenf, int samplerate, double max_deviation, double
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for transceiver.\n");
 
+	/* protocol of this channel */
+	fuenf->sender.send = send_audio;
+	fuenf->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	sender_set_fm(&fuenf->sender, max_deviation, MAX_MODULATION, signal_deviation, MAX_DISPLAY);
 
 	fuenf->sample_duration = 1.0 / (double)samplerate;
 
-	/* init digit demodulator */
-	rc = fm_demod_init(&fuenf->rx_digit_demod, 8000, (DIGIT_FREQ_MIN + DIGIT_FREQ_MAX) / 2.0, DIGIT_FREQ_MAX - DIGIT_FREQ_MIN);
+	/* init digit detector */
+	rc = tone_track_init(&fuenf->rx_digit_track, digit_freq, DSP_NUM_DIGITS, 8000, RX_DIGIT_WINDOW);
 	if (rc)
 		goto error;
 
-	/* use fourth order (2 iter) filter, since it is as fast as second order (1 iter) filter */
-	iir_lowpass_init(&fuenf->rx_digit_lp, RX_DIGIT_FILTER, 8000, 2);
-
 	/* init signal tone filters */
 	for (i = 0; i < DSP_NUM_TONES; i++)
 		audio_goertzel_init(&fuenf->rx_tone_goertzel[i], tone_freq[i], 8000);
@@ -143,6 +145,8 @@ int dsp_init_sender(fuenf_t *fuenf, int samplerate, double max_deviation, double
 		fuenf->dmp_tone_levels[i] = display_measurements_add(&fuenf->sender.dispmeas, name, "%.0f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 	}
 
+	sender_account_dsp(&fuenf->sender, sizeof(*fuenf) - sizeof(fuenf->sender) + sizeof(*fuenf->rx_tone_filter_spl) * fuenf->rx_tone_filter_size);
+
 	return 0;
 
 error:
@@ -156,6 +160,9 @@ void dsp_cleanup_sender(fuenf_t *fuenf)
 {
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Cleanup DSP for transceiver.\n");
 
+	/* free digit detector */
+	tone_track_exit(&fuenf->rx_digit_track);
+
 	/* free tone buffers */
 	if (fuenf->rx_tone_filter_spl)
 		free(fuenf->rx_tone_filter_spl);
@@ -166,50 +173,34 @@ void dsp_cleanup_sender(fuenf_t *fuenf)
 /* receive digits and decode */
 static void digit_decode(fuenf_t *fuenf, sample_t *samples, int length)
 {
-	sample_t frequency[length], f, a;
-	sample_t I[length], Q[length];
-	int i, d;
+	double levels[DSP_NUM_DIGITS], a;
+	int i, d, best;
 	int change, change_count;
 
-	/* tone demodulation */
-	fm_demodulate_real(&fuenf->rx_digit_demod, frequency, length, samples, I, Q);
-
-	/* reduce bandwidth of tone detector */
-	iir_process(&fuenf->rx_digit_lp, frequency, length);
-
-	/* detect tone */
 	for (i = 0; i < length; i++) {
-		/* get frequency */
-		f = frequency[i] + (DIGIT_FREQ_MIN + DIGIT_FREQ_MAX) / 2.0;
+		/* slide all digit frequencies by one sample, so changes are found at sample resolution */
+		tone_track_process(&fuenf->rx_digit_track, samples + i, 1);
+		tone_track_levels(&fuenf->rx_digit_track, levels);
+
+		/* get strongest digit */
+		best = 0;
+		for (d = 1; d < DSP_NUM_DIGITS; d++) {
+			if (levels[d] > levels[best])
+				best = d;
+		}
 
 		/* get amplitude (a is a sqaure of the amplitude for faster math) */
-		a = (I[i] * I[i] + Q[i] * Q[i]) * 2.0 * 2.0 / TONE_LEVEL / TONE_LEVEL;
+		a = levels[best] * levels[best] / TONE_LEVEL / TONE_LEVEL;
 
 #ifdef DEBUG_CODER
-		if (i == 0) printf("%s %.5f   ", debug_amplitude(frequency[i] / (DIGIT_FREQ_MAX - DIGIT_FREQ_MIN) * 2.0), f);
-		if (i == 0) printf("%s %.5f   ", debug_amplitude(sqrt(a)), sqrt(a));
+		if (i == 0) printf("%s %.5f digit=%d\n", debug_amplitude(sqrt(a)), sqrt(a), best);
 #endif
-		/* get digit that matches the frequency tolerance */
-		for (d = 0; d < DSP_NUM_DIGITS; d++) {
-			if (f >= digit_freq[d] * (1.0 - RX_TOL_DIGIT_FREQ) && f <= digit_freq[d] * (1.0 + RX_TOL_DIGIT_FREQ))
-				break;
-		}
-
-		/* digit lound enough ? */
-		if (a >= RX_MIN_LEVEL * RX_MIN_LEVEL && d < DSP_NUM_DIGITS) {
-#ifdef DEBUG_CODER
-			if (i == 0 && d < DSP_NUM_DIGITS) printf("digit=%d (%d == no digit detected)", d, DSP_NUM_DIGITS);
-#endif
-		} else
+		/* digit loud enough and not mixed with other tones or noise ? */
+		if (a >= RX_MIN_LEVEL * RX_MIN_LEVEL
+		 && levels[best] * levels[best] >= RX_DIGIT_PURITY * 2.0 * tone_track_power(&fuenf->rx_digit_track))
+			d = best;
+		else
 			d = -1;
-#ifdef DEBUG_CODER
-		sffd
-		if (i == 0) printf("\n");
-#endif
-
-		/* correct amplitude at cutoff frequency digit '1' and 'repeat'.*/
-		if (d == 0 || d == DSP_NUM_DIGITS - 1)
-			a = a * 2; /* actually 1.414 at cutoff, but a is a square, so we can use 2 */
 
 		/* count how long this digit sustains, also report if it has changed and when */
 		if (d != fuenf->rx_digit_last) {
@@ -396,7 +387,7 @@ static void tone_decode(fuenf_t *fuenf, sample_t *samples, int length)
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	fuenf_t *fuenf = (fuenf_t *) sender;
 
@@ -591,12 +582,12 @@ static int encode(fuenf_t *fuenf, sample_t *samples, int length)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	fuenf_t *fuenf = (fuenf_t *) sender;
 	sample_t *orig_samples = samples;
 	int orig_length = length;
-	int count, input_num;
+	int count;
 	sample_t *spl;
 	int pos;
 	int i;
@@ -604,13 +595,7 @@ void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length
 	/* speak through */
 	if (fuenf->state == FUENF_STATE_DURCHSAGE && fuenf->callref) {
 		memset(power, 1, length);
-		input_num = samplerate_upsample_input_num(&sender->srstate, length);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&sender->dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
-		}
-		samplerate_upsample(&sender->srstate, samples, input_num, samples, length);
+		sender_load_speech(&sender->dejitter, &sender->srstate, samples, length);
 	} else {
 		/* send if something has to be sent. else turn transmitter off */
 		while ((count = encode(fuenf, samples, length))) {
@@ -667,7 +652,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (fuenf->state == FUENF_STATE_DURCHSAGE) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&fuenf->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&fuenf->sender.dejitter, jf);
 	}
@@ -71,8 +71,7 @@ typedef struct fuenf {
 
 	/* RX dsp states */
 	enum rx_state		rx_state;		/* current state of decoder */
-	fm_demod_t		rx_digit_demod;		/* demodulator for frequency */
-	iir_filter_t		rx_digit_lp;		/* low pass to filter the frequency result */
+	tone_track_t		rx_digit_track;		/* sliding DFT of all digit frequencies */
 	int			rx_digit_last;		/* track if digit changes */
 	int			rx_digit_count;		/* count samples after digit changes */
 	goertzel_t		rx_tone_goertzel[DSP_NUM_TONES]; /* rx filter */
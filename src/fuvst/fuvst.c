@@ -44,6 +44,7 @@
 #include <osmocom/core/timer.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/cc/message.h>
+#include "../cnetz/futln.h"
 #include "fuvst.h"
 
 /* digital loopback test */
@@ -301,7 +302,8 @@ static int check_emerg(const char *number)
  */
 
 typedef struct cnetz_database {
-	struct cnetz_database	*next;
+	struct cnetz_database	*next, **pprev;
+	struct cnetz_database	*hash_next;	/* next subscriber in hash bucket of FuTln */
 	uint8_t			futln_nat;
 	uint8_t			futln_fuvst;
 	uint16_t		futln_rest;
@@ -309,63 +311,70 @@ typedef struct cnetz_database {
 	int32_t			sicherungscode;
 } cnetz_db_t;
 
-static cnetz_db_t *cnetz_db_head;
+/* the list keeps order of attachment, lookups are done via hash of FuTln */
+static cnetz_db_t *cnetz_db_head, **cnetz_db_tailp = &cnetz_db_head;
+static cnetz_db_t *cnetz_db_hash[FUTLN_HASH_SIZE];
 
 static cnetz_db_t *find_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
 {
-        cnetz_db_t *db;
-
-        /* search transaction for this subscriber */
-        db = cnetz_db_head;
-        while (db) {
-                if (db->futln_nat == futln_nat
-                 && db->futln_fuvst == futln_fuvst
-                 && db->futln_rest == futln_rest)
-                        break;
-                db = db->next;
-        }
+	cnetz_db_t *db;
+
+	for (db = cnetz_db_hash[hash_futln(futln_nat, futln_fuvst, futln_rest)]; db; db = db->hash_next) {
+		if (db->futln_nat == futln_nat
+		 && db->futln_fuvst == futln_fuvst
+		 && db->futln_rest == futln_rest)
+			break;
+	}
 
 	return db;
 }
 
-static void remove_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
+static void unlink_db(cnetz_db_t *db)
 {
-	cnetz_db_t *db, **dbp;
+	cnetz_db_t **dbp;
 
-	db = find_db(futln_nat, futln_fuvst, futln_rest);
-	if (!db)
-		return;
-
-	/* uinlink */
-	dbp = &cnetz_db_head;
-	while (*dbp && *dbp != db)
-		dbp = &((*dbp)->next);
+	/* unlink from hash bucket */
+	for (dbp = &cnetz_db_hash[hash_futln(db->futln_nat, db->futln_fuvst, db->futln_rest)]; *dbp && *dbp != db; dbp = &((*dbp)->hash_next))
+		;
 	if (!(*dbp)) {
 		LOGP(DDB, LOGL_ERROR, "Subscriber not in list, please fix!!\n");
 		abort();
 	}
-	*dbp = db->next;
+	*dbp = db->hash_next;
+
+	/* unlink from list */
+	*db->pprev = db->next;
+	if (db->next)
+		db->next->pprev = db->pprev;
+	else
+		cnetz_db_tailp = db->pprev;
 
 	LOGP(DDB, LOGL_INFO, "Removing subscriber '%d,%d,%d' from database.\n", db->futln_nat, db->futln_fuvst, db->futln_rest);
 
-	/* remove */
 	free(db);
 }
 
-static void flush_db(void)
+static void remove_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest)
 {
-        cnetz_db_t *db;
+	cnetz_db_t *db;
 
-	while ((db = cnetz_db_head)) {
-		LOGP(DDB, LOGL_INFO, "Removing subscriber '%d,%d,%d' from database.\n", db->futln_nat, db->futln_fuvst, db->futln_rest);
-		cnetz_db_head = db->next;
-		free(db);
-	}
+	db = find_db(futln_nat, futln_fuvst, futln_rest);
+	if (!db)
+		return;
+
+	unlink_db(db);
+}
+
+static void flush_db(void)
+{
+	while (cnetz_db_head)
+		unlink_db(cnetz_db_head);
 }
 
 static void add_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest, uint8_t chip, int32_t sicherungscode)
 {
-        cnetz_db_t *db, **dbp;
+	cnetz_db_t *db;
+	unsigned int hash;
 
 	db = find_db(futln_nat, futln_fuvst, futln_rest);
 	if (db)
@@ -386,10 +395,14 @@ static void add_db(uint8_t futln_nat, uint8_t futln_fuvst, uint16_t futln_rest,
 	LOGP(DDB, LOGL_INFO, "Adding subscriber '%d,%d,%d' to database. (reader=%s, sicherungs-code=%d)\n", db->futln_nat, db->futln_fuvst, db->futln_rest, (db->chip) ? "chip" : "magent", db->sicherungscode);
 
 	/* attach to end of list */
-	dbp = &cnetz_db_head;
-	while (*dbp)
-		dbp = &((*dbp)->next);
-	*dbp = db;
+	db->pprev = cnetz_db_tailp;
+	*cnetz_db_tailp = db;
+	cnetz_db_tailp = &db->next;
+
+	/* attach to hash bucket */
+	hash = hash_futln(futln_nat, futln_fuvst, futln_rest);
+	db->hash_next = cnetz_db_hash[hash];
+	cnetz_db_hash[hash] = db;
 }
 
 /*
@@ -1169,6 +1182,9 @@ static void mtp_receive(void *inst, enum mtp_prim prim, uint8_t slc, uint8_t *da
 	}
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Create transceiver instance and link to a list. */
 int fuvst_create(const char *kanal, enum fuvst_chan_type chan_type, const char *audiodev, int samplerate, double rx_gain, double tx_gain, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback, int ignore_link_monitor, uint8_t sio, uint16_t local_pc, uint16_t remote_pc)
 {
@@ -1196,6 +1212,8 @@ int fuvst_create(const char *kanal, enum fuvst_chan_type chan_type, const char *
 		LOGP(DCNETZ, LOGL_ERROR, "Failed to init transceiver process!\n");
 		goto error;
 	}
+	fuvst->sender.send = send_audio;
+	fuvst->sender.receive = receive_audio;
 	fuvst->chan_num = atoi(kanal);
 	fuvst->chan_type = chan_type;
 
@@ -1248,7 +1266,7 @@ void fuvst_destroy(sender_t *sender)
 	free(fuvst);
 }
 
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
         fuvst_t *fuvst = (fuvst_t *) sender;
 	int input_num;
@@ -1268,7 +1286,7 @@ void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length
 	}
 }
 
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	fuvst_t *fuvst = (fuvst_t *) sender;
 	sample_t *spl;
@@ -1314,7 +1332,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (fuvst->callref) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&fuvst->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&fuvst->sender.dejitter, jf);
 	}
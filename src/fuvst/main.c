@@ -33,9 +33,10 @@
 #include "../anetz/besetztton.h"
 #include "../cnetz/ansage.h"
 #include "fuvst.h"
+#include "systemmeldungen.h"
 
 static int num_chan_type = 0;
-static enum fuvst_chan_type chan_type[MAX_SENDER] = { CHAN_TYPE_ZZK };
+static enum fuvst_chan_type *chan_type = NULL;
 static uint8_t sio = 0xcd;
 static uint16_t uele_pc = 1400;
 static uint16_t fuko_pc = 1466;
@@ -188,6 +189,7 @@ int main(int argc, char *argv[])
 	main_mobile_init("0123456789", number_lengths, number_prefixes, cnetz_number_valid);
 
 	config_init();
+	check_systemmeldungen();
 
 	add_emergency("110");
 	add_emergency("112");
@@ -211,13 +213,13 @@ int main(int argc, char *argv[])
 	}
 
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		return -EINVAL;
 	}
 	if (num_kanal == 1 && num_chan_type == 0)
-		num_chan_type = 1; /* use default */
+		OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_ZZK) /* use default */
 	if (num_kanal != num_chan_type) {
 		fprintf(stderr, "You need to specify as many channel types as you have channels.\n");
 		return -EINVAL;
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 #include "../libsample/sample.h"
 #include <osmocom/core/timer.h>
 #include <osmocom/core/utils.h>
@@ -30,6 +31,7 @@
 #include "../libmobile/main_mobile.h"
 #include "../liboptions/options.h"
 #include "../libmobile/sender.h"
+#include "../libmobile/get_time.h"
 #include "../libv27/modem.h"
 #include "../libmtp/mtp.h"
 #include "../libfm/fm.h"
@@ -39,8 +41,15 @@ typedef struct sniffer {
 	v27modem_t		modem;
 	mtp_t			mtp;
 	uint8_t			last_fsn;
+	int			link;		/* index of channel, used as link number in trace */
 } sniffer_t;
 
+static const char *offline_file = NULL;
+static const char *trace_file = NULL;
+static FILE *trace_fp = NULL;
+static double trace_start = 0.0;	/* time stamp of first sample */
+static double trace_time = 0.0;		/* time stamp of current chunk */
+
 
 void print_help(const char *arg0)
 {
@@ -50,17 +59,35 @@ void print_help(const char *arg0)
 	printf("Use '-v 0' for total message logging, including errors.\n");
 	printf("Use '-v 1' for all messages, including resends (and weird messages from SAE).\n");
 	printf("Use '-v 2' for messages between DKO and MSC.\n");
+	printf("\n");
+	printf("    --offline <wave file>\n");
+	printf("        Decode given wave file as fast as possible, instead of using sound\n");
+	printf("        device. Each channel of the file carries one '-k' channel in order.\n");
+	printf("    --trace <pcap file>\n");
+	printf("        Write all received frames to given file in pcap format (MTP2 with\n");
+	printf("        pseudo header). The link number is the index of each '-k' channel.\n");
 	main_mobile_print_hotkeys();
 }
 
+#define OPT_OFFLINE	256
+#define OPT_TRACE	257
+
 static void add_options(void)
 {
 	main_mobile_add_options();
+	option_add(OPT_OFFLINE, "offline", 1);
+	option_add(OPT_TRACE, "trace", 1);
 }
 
 static int handle_options(int short_option, int argi, char **argv)
 {
 	switch (short_option) {
+	case OPT_OFFLINE:
+		offline_file = options_strdup(argv[argi]);
+		break;
+	case OPT_TRACE:
+		trace_file = options_strdup(argv[argi]);
+		break;
 	default:
 		return main_mobile_handle_options(short_option, argi, argv);
 	}
@@ -68,6 +95,69 @@ static int handle_options(int short_option, int argi, char **argv)
 	return 1;
 }
 
+/*
+ * pcap trace
+ */
+
+#define LINKTYPE_MTP2_WITH_PHDR	139
+
+static int trace_open(const char *filename)
+{
+	struct {
+		uint32_t magic;
+		uint16_t version_major, version_minor;
+		int32_t thiszone;
+		uint32_t sigfigs, snaplen, network;
+	} hdr = { 0xa1b2c3d4, 2, 4, 0, 0, 65535, LINKTYPE_MTP2_WITH_PHDR };
+
+	trace_fp = fopen(filename, "w");
+	if (!trace_fp) {
+		LOGP(DMTP3, LOGL_ERROR, "Failed to create trace file '%s'! (errno %d)\n", filename, errno);
+		return -EIO;
+	}
+	fwrite(&hdr, sizeof(hdr), 1, trace_fp);
+
+	return 0;
+}
+
+static void trace_close(void)
+{
+	if (!trace_fp)
+		return;
+	fclose(trace_fp);
+	trace_fp = NULL;
+}
+
+/* write frame without FCS, prefixed by MTP2 pseudo header */
+static void trace_frame(sniffer_t *sniffer, uint8_t bsn, uint8_t bib, uint8_t fsn, uint8_t fib, const uint8_t *payload, int len)
+{
+	struct {
+		uint32_t ts_sec, ts_usec, incl_len, orig_len;
+	} rec;
+	uint8_t header[7];
+	double now;
+
+	now = (offline_file) ? trace_time : get_time();
+	rec.ts_sec = (uint32_t)now;
+	rec.ts_usec = (uint32_t)((now - (double)rec.ts_sec) * 1000000.0);
+	rec.incl_len = rec.orig_len = sizeof(header) + len;
+
+	/* pseudo header: sent, annex A used, link number (big endian) */
+	header[0] = 0;
+	header[1] = 0;
+	header[2] = sniffer->link >> 8;
+	header[3] = sniffer->link;
+	/* MTP2 header: BSN/BIB, FSN/FIB, LI */
+	header[4] = (bsn & 0x7f) | (bib << 7);
+	header[5] = (fsn & 0x7f) | (fib << 7);
+	header[6] = (len < 63) ? len : 63;
+
+	fwrite(&rec, sizeof(rec), 1, trace_fp);
+	fwrite(header, sizeof(header), 1, trace_fp);
+	if (len)
+		fwrite(payload, len, 1, trace_fp);
+}
+
 /* FISU is received form L2 */
 static void receive_fisu(mtp_t *mtp, uint8_t bsn, uint8_t bib, uint8_t fsn, uint8_t fib)
 {
@@ -75,6 +165,9 @@ static void receive_fisu(mtp_t *mtp, uint8_t bsn, uint8_t bib, uint8_t fsn, uint
 
 	LOGP(DMTP3, (fsn == sniffer->last_fsn) ? LOGL_INFO : LOGL_NOTICE, "%s FISU Frame: FSN=%d FIB=%d BSN=%d BIB=%d\n", mtp->name, fsn, fib, bsn, bib);
 
+	if (trace_fp)
+		trace_frame(sniffer, bsn, bib, fsn, fib, NULL, 0);
+
 	/* store current FSN */
 	sniffer->last_fsn = fsn;
 }
@@ -86,6 +179,10 @@ static void receive_lssu(mtp_t *mtp, uint8_t fsn, uint8_t bib, uint8_t status)
 
 	LOGP(DMTP3, LOGL_INFO, "%s LSSU Frame: FSN=%d BIB=%d status=%d\n", mtp->name, fsn, bib, status);
 
+	/* BSN and FIB are not reported by L2 */
+	if (trace_fp)
+		trace_frame(sniffer, 0, bib, fsn, 0, &status, 1);
+
 	/* store initial FSN */
 	sniffer->last_fsn = fsn;
 }
@@ -98,6 +195,14 @@ static void receive_msu(mtp_t *mtp, uint8_t bsn, uint8_t bib, uint8_t fsn, uint8
 	uint8_t slc, h2h1;
 	uint8_t ident, opcode;
 
+	if (trace_fp) {
+		uint8_t payload[1 + len];
+
+		payload[0] = sio;
+		memcpy(payload + 1, data, len);
+		trace_frame(sniffer, bsn, bib, fsn, fib, payload, 1 + len);
+	}
+
 	if (len < 4) {
 		LOGP(DMTP3, LOGL_NOTICE, "Short frame from layer 2 (len=%d)\n", len);
 		return;
@@ -154,6 +259,71 @@ static void receive_bit(void *inst, int bit)
 	mtp_receive_bit(&sniffer->mtp, bit);
 }
 
+/* decode wave file without pacing, each wave channel feeds one sniffer */
+static int decode_offline(const char *filename)
+{
+	wave_play_t play;
+	sender_t *sender;
+	int samplerate = dsp_samplerate, channels = 0;
+	int chunk, got, c, rc;
+	uint64_t total, done = 0;
+	sample_t *buffer = NULL, **samples = NULL;
+	struct stat st;
+	double begin;
+
+	rc = wave_create_playback(&play, filename, &samplerate, &channels, 1.0, WAVE_FLAG_MMAP);
+	if (rc < 0)
+		return rc;
+	if (channels < num_kanal) {
+		LOGP(DCNETZ, LOGL_ERROR, "Wave file has %d channel(s), but %d channel(s) are given!\n", channels, num_kanal);
+		rc = -EINVAL;
+		goto out;
+	}
+	total = play.left;
+
+	chunk = samplerate / 100;
+	buffer = calloc((size_t)chunk * channels, sizeof(*buffer));
+	samples = calloc(channels, sizeof(*samples));
+	if (!buffer || !samples) {
+		LOGP(DCNETZ, LOGL_ERROR, "No memory!\n");
+		rc = -ENOMEM;
+		goto out;
+	}
+	for (c = 0; c < channels; c++)
+		samples[c] = buffer + (size_t)chunk * c;
+
+	/* the recording ended when the file was modified last */
+	trace_start = 0.0;
+	if (stat(filename, &st) == 0)
+		trace_start = (double)st.st_mtime - (double)total / (double)samplerate;
+
+	begin = get_time();
+	while (play.left && !quit) {
+		trace_time = trace_start + (double)done / (double)samplerate;
+		got = wave_read(&play, samples, chunk);
+		if (got <= 0)
+			break;
+		for (c = 0, sender = sender_head; sender; c++, sender = sender->next) {
+			if (rx_gain != 1.0) {
+				int s;
+				for (s = 0; s < got; s++)
+					samples[c][s] *= rx_gain;
+			}
+			v27_modem_receive(&((sniffer_t *)sender)->modem, samples[c], got);
+		}
+		done += got;
+	}
+
+	LOGP(DCNETZ, LOGL_NOTICE, "Decoded %.1f seconds of recording in %.1f seconds.\n", (double)done / (double)samplerate, get_time() - begin);
+	rc = 0;
+
+out:
+	free(samples);
+	free(buffer);
+	wave_destroy_playback(&play);
+	return rc;
+}
+
 /* Destroy transceiver instance and unlink from list. */
 static void sniffer_destroy(sender_t *sender)
 {
@@ -169,6 +339,9 @@ static void sniffer_destroy(sender_t *sender)
 	free(sniffer);
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 int main(int argc, char *argv[])
 {
 	int rc, argi;
@@ -200,8 +373,10 @@ int main(int argc, char *argv[])
 		goto fail;
 	}
 
-	if (num_device <= 1)
-		dsp_device[1] = dsp_device[0];
+	if (num_device == 0)
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT)
+	while (num_device < num_kanal)
+		OPT_ARRAY(num_device, dsp_device, dsp_device[0])
 	for (i = 0; i < num_kanal; i++) {
 		LOGP(DCNETZ, LOGL_DEBUG, "Creating 'Sniffer' instance for 'Kanal' = %s (sample rate %d).\n", kanal[i], dsp_samplerate);
 
@@ -216,6 +391,10 @@ int main(int argc, char *argv[])
 			goto fail;
 		}
 
+		sniffer->sender.send = send_audio;
+		sniffer->sender.receive = receive_audio;
+		sniffer->link = i;
+
 		rc = mtp_init(&sniffer->mtp, kanal[i], sniffer, NULL, 4800, 1, 0, 0, 0);
 		if (rc < 0)
 			goto fail;
@@ -227,9 +406,20 @@ int main(int argc, char *argv[])
 			goto fail;
 	}
 
-	main_mobile_loop(NULL, &quit, NULL, NULL);
+	if (trace_file) {
+		rc = trace_open(trace_file);
+		if (rc < 0)
+			goto fail;
+	}
+
+	if (offline_file)
+		decode_offline(offline_file);
+	else
+		main_mobile_loop(NULL, &quit, NULL, NULL);
 
 fail:
+	trace_close();
+
 	/* destroy transceiver instance */
 	while (sender_head)
 		sniffer_destroy(sender_head);
@@ -242,7 +432,7 @@ fail:
 }
 
 /* don't send anything */
-void sender_send(sender_t __attribute__((unused)) *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t __attribute__((unused)) *sender, sample_t *samples, uint8_t *power, int length)
 {
         memset(power, 0, length);
 
@@ -250,7 +440,7 @@ void sender_send(sender_t __attribute__((unused)) *sender, sample_t *samples, ui
 }
 
 /* we receive everything */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	sniffer_t *sniffer = (sniffer_t *) sender;
 
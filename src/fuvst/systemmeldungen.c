@@ -21878,24 +21878,51 @@ static struct systemmeldungen {
 	},
 };
 
+/* the table is sorted by code, so it can be searched by bisection */
+static struct systemmeldungen *find_systemmeldung(uint16_t code)
+{
+	int lo = 0, hi = sizeof(systemmeldungen) / sizeof(struct systemmeldungen) - 1, mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (systemmeldungen[mid].code == code)
+			return &systemmeldungen[mid];
+		if (systemmeldungen[mid].code < code)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return NULL;
+}
+
 void print_systemmeldung(uint16_t code, int bytes, uint8_t *ind)
 {
-	int i, ii, j;
+	struct systemmeldungen *sm;
+	int j;
 
 	if (bytes > 10)
 		bytes = 10;
 
-	ii = sizeof(systemmeldungen) / sizeof(struct systemmeldungen);
-
-	for (i = 0; i < ii; i++) {
-		if (systemmeldungen[i].code == code)
-			break;
-	}
-	if (i == ii)
+	sm = find_systemmeldung(code);
+	if (!sm)
 		return;
 
-	LOGP(DMUP, LOGL_INFO, " -> %s\n", systemmeldungen[i].desc);
-	for (j = 0; j < systemmeldungen[i].bytes; j++)
-		LOGP(DMUP, LOGL_INFO, "    Byte %d = %02Xh: %s\n", j, ind[j], systemmeldungen[i].ind[j]);
+	LOGP(DMUP, LOGL_INFO, " -> %s\n", sm->desc);
+	for (j = 0; j < sm->bytes; j++)
+		LOGP(DMUP, LOGL_INFO, "    Byte %d = %02Xh: %s\n", j, ind[j], sm->ind[j]);
 }
 
+void check_systemmeldungen(void)
+{
+	int i, ii;
+
+	ii = sizeof(systemmeldungen) / sizeof(struct systemmeldungen);
+
+	for (i = 1; i < ii; i++) {
+		if (systemmeldungen[i - 1].code >= systemmeldungen[i].code) {
+			LOGP(DMUP, LOGL_ERROR, "Systemmeldung 0x%04x is not sorted by code, please fix!\n", systemmeldungen[i].code);
+			abort();
+		}
+	}
+}
@@ -1,3 +1,4 @@
 
 void print_systemmeldung(uint16_t code, int bytes, uint8_t *ind);
+void check_systemmeldungen(void);
 
@@ -53,6 +53,9 @@ static void dsp_init_ramp(gsc_t *gsc)
         }
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_sender(gsc_t *gsc, int samplerate, double deviation, double polarity)
 {
@@ -60,6 +63,10 @@ int dsp_init_sender(gsc_t *gsc, int samplerate, double deviation, double polarit
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for transceiver.\n");
 
+	/* protocol of this channel */
+	gsc->sender.send = send_audio;
+	gsc->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	// NOTE: baudrate equals modulation, because we have a raised cosine ramp of beta = 0.5
 	sender_set_fm(&gsc->sender, deviation, 600.0, deviation, MAX_DISPLAY);
@@ -68,7 +75,7 @@ int dsp_init_sender(gsc_t *gsc, int samplerate, double deviation, double polarit
 	gsc->fsk_bitstep = 1.0 / gsc->fsk_bitduration;
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Use %.4f samples for one bit duration @ %d.\n", gsc->fsk_bitduration, gsc->sender.samplerate);
 
-	gsc->fsk_tx_buffer_size = gsc->fsk_bitduration + 10; /* 1 bit, add some extra to prevent short buffer due to rounding */
+	gsc->fsk_tx_buffer_size = gsc->fsk_bitduration * 32 + 10; /* 32 bits, add some extra to prevent short buffer due to rounding */
 	gsc->fsk_tx_buffer = calloc(sizeof(sample_t), gsc->fsk_tx_buffer_size);
 	if (!gsc->fsk_tx_buffer) {
 		LOGP_CHAN(DDSP, LOGL_ERROR, "No memory!\n");
@@ -80,6 +87,11 @@ int dsp_init_sender(gsc_t *gsc, int samplerate, double deviation, double polarit
 	gsc->fsk_deviation = 1.0; // equals what we st at sender_set_fm()
 	gsc->fsk_polarity = polarity;
 	dsp_init_ramp(gsc);
+	rc = fsk_burst_init(&gsc->fsk_tx_burst, gsc->fsk_bitduration, gsc->fsk_ramp_up, gsc->fsk_ramp_down, gsc->fsk_deviation * gsc->fsk_polarity);
+	if (rc < 0)
+		goto error;
+
+	sender_account_dsp(&gsc->sender, sizeof(*gsc) - sizeof(gsc->sender) + sizeof(sample_t) * gsc->fsk_tx_buffer_size);
 
 	return 0;
 
@@ -99,79 +111,26 @@ void dsp_cleanup_sender(gsc_t *gsc)
 		free(gsc->fsk_tx_buffer);
 		gsc->fsk_tx_buffer = NULL;
 	}
+	fsk_burst_cleanup(&gsc->fsk_tx_burst);
 }
 
 
-/* encode one bit into samples
- * input: bit
+/* encode bits into samples
+ * input: bits (first bit is LSB) and number of bits
  * output: samples
  * return number of samples */
-static int fsk_bit_encode(gsc_t *gsc, uint8_t bit)
+static int fsk_bits_encode(gsc_t *gsc, uint32_t bits, int num)
 {
-	/* alloc samples, add 1 in case there is a rest */
-	sample_t *spl;
-	double phase, bitstep, devpol;
-	int count;
-	uint8_t lastbit;
-
-	devpol = gsc->fsk_deviation * gsc->fsk_polarity;
-	spl = gsc->fsk_tx_buffer;
-	phase = gsc->fsk_tx_phase;
-	lastbit = gsc->fsk_tx_lastbit;
-	bitstep = gsc->fsk_bitstep * 256.0;
-
-	if (lastbit) {
-		if (bit) {
-			/* stay up */
-			do {
-				*spl++ = devpol;
-				phase += bitstep;
-			} while (phase < 256.0);
-			phase -= 256.0;
-		} else {
-			/* ramp down */
-			do {
-				*spl++ = gsc->fsk_ramp_down[(uint8_t)phase];
-				phase += bitstep;
-			} while (phase < 256.0);
-			phase -= 256.0;
-			lastbit = 0;
-		}
-	} else {
-		if (bit) {
-			/* ramp up */
-			do {
-				*spl++ = gsc->fsk_ramp_up[(uint8_t)phase];
-				phase += bitstep;
-			} while (phase < 256.0);
-			phase -= 256.0;
-			lastbit = 1;
-		} else {
-			/* stay down */
-			do {
-				*spl++ = -devpol;
-				phase += bitstep;
-			} while (phase < 256.0);
-			phase -= 256.0;
-		}
-	}
-
-	/* depending on the number of samples, return the number */
-	count = ((uintptr_t)spl - (uintptr_t)gsc->fsk_tx_buffer) / sizeof(*spl);
-
-	gsc->fsk_tx_phase = phase;
-	gsc->fsk_tx_lastbit = lastbit;
-
-	return count;
+	return fsk_burst_encode(&gsc->fsk_tx_burst, gsc->fsk_tx_buffer, bits, num, 1);
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t __attribute__((unused)) *sender, sample_t __attribute__((unused)) *samples, int __attribute__((unused)) length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t __attribute__((unused)) *sender, sample_t __attribute__((unused)) *samples, int __attribute__((unused)) length, double __attribute__((unused)) rf_level_db)
 {
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	gsc_t *gsc = (gsc_t *) sender;
 	int rc;
@@ -212,19 +171,20 @@ again:
 
 	/* get FSK bits or start playing wave file */
 	if (!gsc->fsk_tx_buffer_length) {
-		int8_t bit = get_bit(gsc);
+		uint32_t bits;
+		int num = get_bits(gsc, &bits);
 
-		/* bit == 2 means voice transmission. */
-		if (bit == 2) {
+		/* num == 0 means voice transmission. */
+		if (num == 0) {
 			if (gsc->wave_tx_filename[0]) {
 				gsc->wave_tx_samplerate = gsc->wave_tx_channels = 0;
-				rc = wave_create_playback(&gsc->wave_tx_play, gsc->wave_tx_filename, &gsc->wave_tx_samplerate, &gsc->wave_tx_channels, gsc->fsk_deviation);
+				rc = wave_create_playback(&gsc->wave_tx_play, gsc->wave_tx_filename, &gsc->wave_tx_samplerate, &gsc->wave_tx_channels, gsc->fsk_deviation, 0);
 				if (rc < 0) {
 					gsc->wave_tx_play.left = 0;
 					LOGP_CHAN(DDSP, LOGL_ERROR, "Failed to open wave file '%s' for voice message.\n", gsc->wave_tx_filename);
 				} else {
 					LOGP_CHAN(DDSP, LOGL_INFO, "Sending wave file '%s' for voice message after 2 seconds.\n", gsc->wave_tx_filename);
-					init_samplerate(&gsc->wave_tx_upsample, gsc->wave_tx_samplerate, gsc->sender.samplerate, VOICE_BANDWIDTH);
+					init_samplerate(&gsc->wave_tx_upsample, gsc->wave_tx_samplerate, gsc->sender.samplerate, VOICE_BANDWIDTH, SAMPLERATE_LINEAR);
 				}
 			}
 			gsc->wait_2_sec = gsc->sender.samplerate * 2.0;
@@ -232,14 +192,14 @@ again:
 		}
 
 		/* no message, power is off */
-		if (bit < 0) {
+		if (num < 0) {
 			memset(samples, 0, sizeof(samples) * length);
 			memset(power, 0, length);
 			return;
 		}
 
 		/* encode */
-		gsc->fsk_tx_buffer_length = fsk_bit_encode(gsc, bit);
+		gsc->fsk_tx_buffer_length = fsk_bits_encode(gsc, bits, num);
 		gsc->fsk_tx_buffer_pos = 0;
 	}
 
@@ -83,6 +83,7 @@ error:
 }
 
 static void golay_msg_destroy(gsc_t *gsc, gsc_msg_t *msg);
+static int queue_batch(gsc_msg_t *gsc, const char *address, enum gsc_msg_type type, const char *message);
 
 /* Destroy transceiver instance and unlink from list. */
 void golay_destroy(sender_t *sender)
@@ -145,12 +146,17 @@ static gsc_msg_t *golay_msg_create(gsc_t *gsc, const char *address, const char *
 	memcpy(msg->address, address, MIN(sizeof(msg->address) - 1, strlen(address) + 1));
 	msg->type = type;
 	memcpy(msg->data, text, MIN(sizeof(msg->data) - 1, strlen(text) + 1));
+	if (queue_batch(msg, msg->address, msg->type, msg->data) < 0) {
+		free(msg);
+		return NULL;
+	}
 
 	/* link */
 	msgp = &gsc->msg_list;
 	while ((*msgp))
 		msgp = &(*msgp)->next;
 	(*msgp) = msg;
+	gsc->msg_count++;
 
 	return msg;
 }
@@ -165,91 +171,60 @@ static void golay_msg_destroy(gsc_t *gsc, gsc_msg_t *msg)
 	while ((*msgp) != msg)
 		msgp = &(*msgp)->next;
 	(*msgp) = msg->next;
+	gsc->msg_count--;
 
 	/* destroy */
 	free(msg);
 }
 
-/* uncomment this for showing encoder tables ("<parity> <information>", LSB is the right most bit) */
-//#define DEBUG_TABLE
-
-static uint32_t golay_table[4096];
-
-#define X22	0x00400000
-#define X11	0x00000800
-#define MASK12	0xfffff800
-#define GEN_GOL	0x00000c75
-
-/* generate golay encoding table. the redundancy is shifted 12 bits */
-void init_golay(void)
-{
-	uint32_t syndrome, aux;
-	int data;
-
-	for (data = 0; data < 4096; data++) {
-		syndrome = data << 11;
-		/* calculate syndrome */
-		aux = X22;
-		if (syndrome >= X11) {
-			while (syndrome & MASK12) {
-				while (!(aux & syndrome))
-					aux = aux >> 1;
-				syndrome ^= (aux / X11) * GEN_GOL;
-			}
-		}
-		golay_table[data] = data | (syndrome << 12);
-#ifdef DEBUG_TABLE
-		printf("Golay %4d: ", data);
-		for (int i = 22; i >= 0; i--) {
-			if (i == 11)
-				printf(" ");
-			printf("%d", (golay_table[data] >> i) & 1);
-		}
-		printf("\n");
-#endif
-	}
-}
-
-static uint16_t bch_table[128];
+/* Golay (23,12) and BCH (15,7) encoding tables, the redundancy is shifted 12 or 7 bits.
+ * the Golay code is linear, so the code word is the sum of the code words of lower and upper 6 data bits.
+ * generator polynomials are 0xc75 (Golay) and 0x117 (BCH)
+ */
+static const uint32_t golay_table_low[64] = {
+	0x000000, 0x475001, 0x49f002, 0x0ea003, 0x54b004, 0x13e005, 0x1d4006, 0x5a1007,
+	0x6e3008, 0x296009, 0x27c00a, 0x60900b, 0x3a800c, 0x7dd00d, 0x73700e, 0x34200f,
+	0x1b3010, 0x5c6011, 0x52c012, 0x159013, 0x4f8014, 0x08d015, 0x067016, 0x412017,
+	0x750018, 0x325019, 0x3cf01a, 0x7ba01b, 0x21b01c, 0x66e01d, 0x68401e, 0x2f101f,
+	0x366020, 0x713021, 0x7f9022, 0x38c023, 0x62d024, 0x258025, 0x2b2026, 0x6c7027,
+	0x585028, 0x1f0029, 0x11a02a, 0x56f02b, 0x0ce02c, 0x4bb02d, 0x45102e, 0x02402f,
+	0x2d5030, 0x6a0031, 0x64a032, 0x23f033, 0x79e034, 0x3eb035, 0x301036, 0x774037,
+	0x436038, 0x043039, 0x0a903a, 0x4dc03b, 0x17d03c, 0x50803d, 0x5e203e, 0x19703f,
+};
 
-#define X14	0x4000
-#define X8	0x0100
-#define MASK7	0xff00
-#define GEN_BCH	0x00000117
+static const uint32_t golay_table_high[64] = {
+	0x000000, 0x6cc040, 0x1ed080, 0x7210c0, 0x3da100, 0x516140, 0x237180, 0x4fb1c0,
+	0x7b4200, 0x178240, 0x659280, 0x0952c0, 0x46e300, 0x2a2340, 0x583380, 0x34f3c0,
+	0x31d400, 0x5d1440, 0x2f0480, 0x43c4c0, 0x0c7500, 0x60b540, 0x12a580, 0x7e65c0,
+	0x4a9600, 0x265640, 0x544680, 0x3886c0, 0x773700, 0x1bf740, 0x69e780, 0x0527c0,
+	0x63a800, 0x0f6840, 0x7d7880, 0x11b8c0, 0x5e0900, 0x32c940, 0x40d980, 0x2c19c0,
+	0x18ea00, 0x742a40, 0x063a80, 0x6afac0, 0x254b00, 0x498b40, 0x3b9b80, 0x575bc0,
+	0x527c00, 0x3ebc40, 0x4cac80, 0x206cc0, 0x6fdd00, 0x031d40, 0x710d80, 0x1dcdc0,
+	0x293e00, 0x45fe40, 0x37ee80, 0x5b2ec0, 0x149f00, 0x785f40, 0x0a4f80, 0x668fc0,
+};
 
-/* generate bch encoding table. the redundancy is shifted 7 bits */
-void init_bch(void)
-{
-	uint16_t syndrome, aux;
-	int data;
-
-	for (data = 0; data < 128; data++) {
-		syndrome = data << 8;
-		/* calculate syndrome */
-		aux = X14;
-		if (syndrome >= X8) {
-			while (syndrome & MASK7) {
-				while (!(aux & syndrome))
-					aux = aux >> 1;
-				syndrome ^= (aux / X8) * GEN_BCH;
-			}
-		}
-		bch_table[data] = data | (syndrome << 7);
-#ifdef DEBUG_TABLE
-		printf("BCH %3d: ", data);
-		for (int i = 14; i >= 0; i--) {
-			if (i == 6)
-				printf(" ");
-			printf("%d", (bch_table[data] >> i) & 1);
-		}
-		printf("\n");
-#endif
-	}
-}
+static const uint16_t bch_table[128] = {
+	0x0000, 0x0b81, 0x1702, 0x1c83, 0x2e04, 0x2585, 0x3906, 0x3287,
+	0x5c08, 0x5789, 0x4b0a, 0x408b, 0x720c, 0x798d, 0x650e, 0x6e8f,
+	0x3390, 0x3811, 0x2492, 0x2f13, 0x1d94, 0x1615, 0x0a96, 0x0117,
+	0x6f98, 0x6419, 0x789a, 0x731b, 0x419c, 0x4a1d, 0x569e, 0x5d1f,
+	0x6720, 0x6ca1, 0x7022, 0x7ba3, 0x4924, 0x42a5, 0x5e26, 0x55a7,
+	0x3b28, 0x30a9, 0x2c2a, 0x27ab, 0x152c, 0x1ead, 0x022e, 0x09af,
+	0x54b0, 0x5f31, 0x43b2, 0x4833, 0x7ab4, 0x7135, 0x6db6, 0x6637,
+	0x08b8, 0x0339, 0x1fba, 0x143b, 0x26bc, 0x2d3d, 0x31be, 0x3a3f,
+	0x45c0, 0x4e41, 0x52c2, 0x5943, 0x6bc4, 0x6045, 0x7cc6, 0x7747,
+	0x19c8, 0x1249, 0x0eca, 0x054b, 0x37cc, 0x3c4d, 0x20ce, 0x2b4f,
+	0x7650, 0x7dd1, 0x6152, 0x6ad3, 0x5854, 0x53d5, 0x4f56, 0x44d7,
+	0x2a58, 0x21d9, 0x3d5a, 0x36db, 0x045c, 0x0fdd, 0x135e, 0x18df,
+	0x22e0, 0x2961, 0x35e2, 0x3e63, 0x0ce4, 0x0765, 0x1be6, 0x1067,
+	0x7ee8, 0x7569, 0x69ea, 0x626b, 0x50ec, 0x5b6d, 0x47ee, 0x4c6f,
+	0x1170, 0x1af1, 0x0672, 0x0df3, 0x3f74, 0x34f5, 0x2876, 0x23f7,
+	0x4d78, 0x46f9, 0x5a7a, 0x51fb, 0x637c, 0x68fd, 0x747e, 0x7fff,
+};
 
 static inline uint32_t calc_golay(uint16_t data)
 {
-	return golay_table[data & 0xfff];
+	return golay_table_low[data & 0x3f] ^ golay_table_high[(data >> 6) & 0x3f];
 }
 
 static inline uint16_t calc_bch(uint16_t data)
@@ -281,27 +256,27 @@ static char encode_alpha(char c)
 	switch (c) {
 	case 0x0a:
 	case 0x0d:
-		LOGP(DGOLAY, LOGL_DEBUG, " -> CR/LF character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> CR/LF character.\n");
 		c = 0x3c;
 		break;
 	case '{':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 		c = 0x3b;
 		break;
 	case '}':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 		c = 0x3d;
 		break;
 	case '\\':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 		c = 0x20;
 		break;
 	default:
 		if (c < 0x20 || c > 0x5d) {
-			LOGP(DGOLAY, LOGL_DEBUG, " -> ' ' character.\n");
+			LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> ' ' character.\n");
 			c = 0x20;
 		} else {
-			LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+			LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 			c = c - 0x20;
 		}
 	}
@@ -314,93 +289,93 @@ static char encode_numeric(char c)
 	switch (c) {
 	case 'u':
 	case 'U':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'U' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'U' character.\n");
 		c = 0xb;
 		break;
 	case ' ':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 		c = 0xc;
 		break;
 	case '-':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 		c = 0xd;
 		break;
 	case '=':
 	case '*':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> '*' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '*' character.\n");
 		c = 0xe;
 		break;
 	case 'a':
 	case 'A':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'A' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'A' character.\n");
 		c = 0xf0;
 		break;
 	case 'b':
 	case 'B':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'B' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'B' character.\n");
 		c = 0xf1;
 		break;
 	case 'c':
 	case 'C':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'C' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'C' character.\n");
 		c = 0xf2;
 		break;
 	case 'd':
 	case 'D':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'D' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'D' character.\n");
 		c = 0xf3;
 		break;
 	case 'e':
 	case 'E':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'E' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'E' character.\n");
 		c = 0xf4;
 		break;
 	case 'f':
 	case 'F':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'F' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'F' character.\n");
 		c = 0xf6;
 		break;
 	case 'g':
 	case 'G':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'G' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'G' character.\n");
 		c = 0xf7;
 		break;
 	case 'h':
 	case 'H':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'H' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'H' character.\n");
 		c = 0xf8;
 		break;
 	case 'j':
 	case 'J':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'J' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'J' character.\n");
 		c = 0xf9;
 		break;
 	case 'l':
 	case 'L':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'L' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'L' character.\n");
 		c = 0xfb;
 		break;
 	case 'n':
 	case 'N':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'N' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'N' character.\n");
 		c = 0xfc;
 		break;
 	case 'p':
 	case 'P':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'P' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'P' character.\n");
 		c = 0xfd;
 		break;
 	case 'r':
 	case 'R':
-		LOGP(DGOLAY, LOGL_DEBUG, " -> 'r' character.\n");
+		LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> 'r' character.\n");
 		c = 0xfe;
 		break;
 	default:
 		if (c >= '0' && c <= '9') {
-			LOGP(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
+			LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> '%c' character.\n", c);
 			c = c - '0';
 		} else {
-			LOGP(DGOLAY, LOGL_DEBUG, " -> ' ' character.\n");
+			LOGP_HOT(DGOLAY, LOGL_DEBUG, " -> ' ' character.\n");
 			c = 0xc;
 		}
 	}
@@ -474,26 +449,28 @@ static int encode_address(const char *code, int *preamble, uint16_t *word1, uint
 	return 0;
 }
 
-static inline void queue_reset(gsc_t *gsc)
+static inline void queue_reset(gsc_msg_t *gsc)
 {
-	gsc->bit_index = 0;
+	memset(gsc->bit, 0, sizeof(gsc->bit));
 	gsc->bit_num = 0;
 	gsc->bit_ac = 0;
 	gsc->bit_overflow = 0;
 }
 
-static inline void queue_bit(gsc_t *gsc, int bit)
+static inline void queue_bit(gsc_msg_t *gsc, int bit)
 {
-	if (gsc->bit_num == sizeof(gsc->bit))
+	if (gsc->bit_num == MAX_BITS)
 		gsc->bit_overflow = 1;
 	if (gsc->bit_overflow) {
 		gsc->bit_num++;
 		return;
 	}
-	gsc->bit[gsc->bit_num++] = bit;
+	if (bit)
+		gsc->bit[gsc->bit_num >> 5] |= 1u << (gsc->bit_num & 31);
+	gsc->bit_num++;
 }
 
-static inline void queue_dup(gsc_t *gsc, uint32_t data, int len)
+static inline void queue_dup(gsc_msg_t *gsc, uint32_t data, int len)
 {
 	int i;
 
@@ -503,7 +480,7 @@ static inline void queue_dup(gsc_t *gsc, uint32_t data, int len)
 	}
 }
 
-static inline void queue_comma(gsc_t *gsc, int bits, uint8_t polarity)
+static inline void queue_comma(gsc_msg_t *gsc, int bits, uint8_t polarity)
 {
 	int i;
 
@@ -513,7 +490,8 @@ static inline void queue_comma(gsc_t *gsc, int bits, uint8_t polarity)
 	}
 }
 
-static int queue_batch(gsc_t *gsc, const char *address, enum gsc_msg_type type, const char *message)
+/* encode complete bit stream of message, when it is queued */
+static int queue_batch(gsc_msg_t *gsc, const char *address, enum gsc_msg_type type, const char *message)
 {
 	int preamble;
 	uint16_t word1, word2;
@@ -685,8 +663,6 @@ static int queue_batch(gsc_t *gsc, const char *address, enum gsc_msg_type type,
 		}
 		break;
 	case TYPE_VOICE:
-		/* store wave file name */
-		memcpy(gsc->wave_tx_filename, message, MIN(sizeof(gsc->wave_tx_filename) - 1, strlen(message) + 1));
 		/* store bit number for activation code. this is used to play the AC again after voice message. */
 		gsc->bit_ac = gsc->bit_num;
 		/* encode activation code and store */
@@ -706,29 +682,30 @@ static int queue_batch(gsc_t *gsc, const char *address, enum gsc_msg_type type,
 
 	/* check overflow */
 	if (gsc->bit_overflow) {
-		LOGP(DGOLAY, LOGL_ERROR, "Bit stream (%d bits) overflows bit buffer size (%d bits), please fix!\n", gsc->bit_num, (int)sizeof(gsc->bit));
+		LOGP(DGOLAY, LOGL_ERROR, "Bit stream (%d bits) overflows bit buffer size (%d bits), please fix!\n", gsc->bit_num, MAX_BITS);
 		return -EOVERFLOW;
 	}
 
 	return 0;
 }
 
-/* get next bit
+/* get next bits, the first bit is the LSB
  *
  * if there is no message, return -1, so that the transmitter is turned off.
  *
- * if there is a message, return next bit to be transmitted.
+ * if there is a message, return number of next bits to be transmitted. (up to 32)
  *
- * if there is a message in the queue, encode message and return its first bit.
+ * if there is a message in the queue, take its bit stream and return its first bits.
  *
- * if there is a voice message, return 2 at the end, to tell the DSP to send voice.
+ * if there is a voice message, return 0 at the end, to tell the DSP to send voice.
  */
-int8_t get_bit(gsc_t *gsc)
+int get_bits(gsc_t *gsc, uint32_t *bits)
 {
 	gsc_msg_t *msg;
-	int rc;
+	uint64_t words;
+	int index, num;
 
-	/* if currently transmiting message, send next bit */
+	/* if currently transmiting message, send next bits */
 	if (gsc->bit_num) {
 		/* Transmission complete. */
 		if (gsc->bit_index == gsc->bit_num) {
@@ -738,13 +715,13 @@ int8_t get_bit(gsc_t *gsc)
 				gsc->bit_index = gsc->bit_ac;
 				gsc->bit_ac = 0;
 				/* indicate voice message to DSP */
-				return 2;
+				return 0;
 			}
-			queue_reset(gsc);
+			gsc->bit_num = 0;
 			LOGP(DGOLAY, LOGL_INFO, "Done transmitting message.\n");
 			goto next_msg;
 		}
-		return gsc->bit[gsc->bit_index++];
+		goto send;
 	}
 
 next_msg:
@@ -754,19 +731,31 @@ next_msg:
 	if (!msg)
 		return -1;
 
-	/* encode first message in queue */
-	rc = queue_batch(gsc, msg->address, msg->type, msg->data);
-	if (rc >= 0)
-		LOGP(DGOLAY, LOGL_INFO, "Transmitting message to address '%s'.\n", msg->address);
+	/* take encoded bit stream of first message in queue */
+	LOGP(DGOLAY, LOGL_INFO, "Transmitting message to address '%s'.\n", msg->address);
+	memcpy(gsc->bit, msg->bit, sizeof(gsc->bit));
+	gsc->bit_num = msg->bit_num;
+	gsc->bit_ac = msg->bit_ac;
+	gsc->bit_index = 0;
+	/* store wave file name */
+	if (msg->type == TYPE_VOICE)
+		memcpy(gsc->wave_tx_filename, msg->data, MIN(sizeof(gsc->wave_tx_filename) - 1, strlen(msg->data) + 1));
 	golay_msg_destroy(gsc, msg);
-	if (rc < 0)
-		goto next_msg;
 
-	/* return first bit */
-	return gsc->bit[gsc->bit_index++];
+send:
+	index = gsc->bit_index;
+	num = MIN(32, gsc->bit_num - index);
+	words = gsc->bit[index >> 5];
+	if ((index >> 5) + 1 < MAX_BITS / 32)
+		words |= (uint64_t)gsc->bit[(index >> 5) + 1] << 32;
+	*bits = words >> (index & 31);
+	gsc->bit_index += num;
+
+	return num;
 }
 
-void golay_msg_send(const char *text)
+/* send message given as "address[,type,message]", return -EINVAL, if it cannot be queued */
+int golay_msg_send(const char *text)
 {
 	char buffer[strlen(text) + 1], *p = buffer, *address_string, *message;
 	gsc_t *gsc;
@@ -774,8 +763,8 @@ void golay_msg_send(const char *text)
 
 	strcpy(buffer, text);
 	address_string = strsep(&p, ",");
-	message = p;
-	switch ((message[0] << 8) | message[1]) {
+	message = (p) ? p : "";
+	switch ((message[0] << 8) | (message[0] ? message[1] : 0)) {
 	case ('a' << 8) | ',':
 		type = TYPE_ALPHA;
 		message += 2;
@@ -793,7 +782,22 @@ void golay_msg_send(const char *text)
 	}
 
 	gsc = (gsc_t *) sender_head;
-	golay_msg_create(gsc, address_string, message, type);
+	if (!golay_msg_create(gsc, address_string, message, type))
+		return -EINVAL;
+
+	return 0;
+}
+
+/* number of messages waiting to be transmitted */
+int golay_queue_depth(void)
+{
+	sender_t *sender;
+	int depth = 0;
+
+	for (sender = sender_head; sender; sender = sender->next)
+		depth += ((gsc_t *)sender)->msg_count;
+
+	return depth;
 }
 
 void call_down_clock(void)
@@ -1,4 +1,5 @@
 #include "../libmobile/sender.h"
+#include "../libfsk/fsk.h"
 
 enum gsc_msg_type {
 	TYPE_AUTO = 0,	/* Defined by 7th digit */
@@ -10,6 +11,7 @@ enum gsc_msg_type {
 
 #define MAX_ADB		10	/* 80 characters */
 #define MAX_NDB		2	/* 24 digits */
+#define MAX_BITS	4096	/* size of bit stream of one message */
 
 /* instance of outgoing message */
 typedef struct gsc_msg {
@@ -17,6 +19,10 @@ typedef struct gsc_msg {
 	char			address[8];		/* 7 digits + EOL */
 	enum gsc_msg_type	type;			/* type of message */
 	char			data[256];		/* message to be transmitted */
+	uint32_t		bit[MAX_BITS / 32];	/* encoded bit stream, first bit is LSB of first word */
+	int			bit_num;
+	int			bit_ac;			/* where activation code starts (voice only). */
+	int			bit_overflow;
 } gsc_msg_t;
 
 typedef struct gsc {
@@ -24,14 +30,14 @@ typedef struct gsc {
 	int			tx;
 
 	gsc_msg_t		*msg_list;		/* queue of messages */
+	int			msg_count;		/* number of messages in queue */
 	const char		*default_message;
 
 	/* current trasmitting message */
-	uint8_t			bit[4096];
+	uint32_t		bit[MAX_BITS / 32];	/* bit stream, copied from message */
 	int			bit_num;
 	int			bit_ac;			/* where activation code starts (voice only). */
 	int			bit_index;		/* when playing out */
-	int			bit_overflow;
 
 	/* dsp states */
 	double			fsk_deviation;		/* deviation of FSK signal on sound card */
@@ -44,8 +50,7 @@ typedef struct gsc {
 	int			fsk_tx_buffer_size;	/* size of tx buffer (in samples) */
 	int			fsk_tx_buffer_length;	/* usage of buffer (in samples) */
 	int			fsk_tx_buffer_pos;	/* current position sending buffer */
-	double			fsk_tx_phase;		/* current bit position */
-	uint8_t			fsk_tx_lastbit;		/* last bit of last message, to correctly ramp */
+	fsk_burst_t		fsk_tx_burst;		/* waveforms and current bit position */
 
 	/* voice message */
 	int			wait_2_sec;		/* counter to wait 2 seconds before playback */
@@ -59,9 +64,8 @@ typedef struct gsc {
 int golay_create(const char *kanal, double frequency, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, double deviation, double polarity, const char *message, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback);
 void golay_destroy(sender_t *sender);
 
-void init_golay(void);
-void init_bch(void);
 
-int8_t get_bit(gsc_t *gsc);
-void golay_msg_send(const char *buffer);
+int get_bits(gsc_t *gsc, uint32_t *bits);
+int golay_msg_send(const char *buffer);
+int golay_queue_depth(void);
 
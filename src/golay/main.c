@@ -30,6 +30,7 @@
 #include "../liblogging/logging.h"
 #include "../libmobile/call.h"
 #include "../libmobile/main_mobile.h"
+#include "../libmobile/page_socket.h"
 #include "../liboptions/options.h"
 #include "../libfm/fm.h"
 #include "../amps/tones.h"
@@ -42,6 +43,8 @@
 #define MSG_SEND "/tmp/golay_msg_send"
 #define MSG_RECEIVED "/tmp/golay_msg_received"
 static int msg_send_fd = -1;
+static const char *page_socket = NULL;
+static int page_queue = 1000;
 
 static int tx = 0;		/* we transmit */
 static int rx = 0;		/* we receive */
@@ -68,6 +71,13 @@ void print_help(const char *arg0)
 	printf(" -M --message \"...\"\n");
 	printf("        Send this message, if no caller ID was given or if built-in console\n");
 	printf("        is used. (default \"%s\").\n", message);
+	printf("    --page-socket <path>\n");
+	printf("        Receive pages in bulk on this UNIX socket. Write one page per line in\n");
+	printf("        the format of the file below and an empty line after each batch. Each\n");
+	printf("        batch is answered by \"<accepted> <rejected> <queue depth>\".\n");
+	printf("    --page-queue <max>\n");
+	printf("        Stop reading from page socket while this number of messages is queued.\n");
+	printf("        (default = %d)\n", page_queue);
 	printf("\n");
 	printf("File: %s\n", MSG_SEND);
 	printf("        Write \"<address>[,message]\" to it, to send a default message.\n");
@@ -86,6 +96,9 @@ void print_help(const char *arg0)
 	main_mobile_print_hotkeys();
 }
 
+#define OPT_PAGE_SOCKET	256
+#define OPT_PAGE_QUEUE	257
+
 static void add_options(void)
 {
 	main_mobile_add_options();
@@ -94,6 +107,8 @@ static void add_options(void)
 	option_add('D', "deviation", 1);
 	option_add('P', "polarity", 1);
 	option_add('M', "message", 1);
+	option_add(OPT_PAGE_SOCKET, "page-socket", 1);
+	option_add(OPT_PAGE_QUEUE, "page-queue", 1);
 }
 
 static int handle_options(int short_option, int argi, char **argv)
@@ -140,6 +155,16 @@ static int handle_options(int short_option, int argi, char **argv)
 	case 'M':
 		message = options_strdup(argv[argi++]);
 		break;
+	case OPT_PAGE_SOCKET:
+		page_socket = options_strdup(argv[argi]);
+		break;
+	case OPT_PAGE_QUEUE:
+		page_queue = atoi(argv[argi]);
+		if (page_queue < 1) {
+			fprintf(stderr, "Given page queue size must be 1 or more!\n");
+			return -EINVAL;
+		}
+		break;
 	default:
 		return main_mobile_handle_options(short_option, argi, argv);
 	}
@@ -147,6 +172,13 @@ static int handle_options(int short_option, int argi, char **argv)
 	return 1;
 }
 
+static int page_received(const char *text)
+{
+	if (!tx)
+		return -EINVAL;
+	return golay_msg_send(text);
+}
+
 static void myhandler(void)
 {
 	static char buffer[256];
@@ -175,6 +207,8 @@ static void myhandler(void)
 				LOGP(DGOLAY, LOGL_ERROR, "Failed to send message, transmitter is not enabled!\n");
 		}
 	}
+
+	page_socket_work();
 }
 
 static const struct number_lengths number_lengths[] = {
@@ -199,10 +233,6 @@ int main(int argc, char *argv[])
 	init_invalidnumber();
 	init_congestion();
 
-	/* init coding tables */
-	init_golay();
-	init_bch();
-
 	/* init mobile interface */
 	main_mobile_init("0123456789", number_lengths, NULL, NULL);
 
@@ -229,12 +259,12 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		goto fail;
@@ -281,9 +311,17 @@ int main(int argc, char *argv[])
 		printf("Base station ready, please tune transmitter (or receiver) to %.4f MHz\n", frequency / 1e6);
 	}
 
+	if (page_socket) {
+		rc = page_socket_open(page_socket, page_queue, page_received, golay_queue_depth);
+		if (rc < 0)
+			goto fail;
+	}
+
 	main_mobile_loop("golay", &quit, myhandler, station_id);
 
 fail:
+	page_socket_close();
+
 	/* pipe */
 	if (msg_send_fd > 0)
 		close(msg_send_fd);
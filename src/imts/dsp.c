@@ -43,15 +43,15 @@
 #define SPEECH_DEVIATION	2500.0				/* deviation of speech (with emphasis) */
 #define TX_PEAK_TONE		(5000.0 / SPEECH_DEVIATION)	/* signaling tone level (5khz, no emphasis) */
 #define RX_MIN_AMPL		0.25				/* FIXME: Minimum level to detect tone */
-/* Note that 75 is half of the distance between two tones (2000 and 2150 Hz)
- * An error of more than 50 causes too much toggeling between two tones,
- * less would take too long to detect the tone and maybe not detect it, if
- * it is too far off the expected frequency.
+/* Note that a window of 8 ms resolves the two closest tones (2000 and 2150 Hz).
+ * The tone must hold most of the power of the window, so a tone that is too
+ * far off the expected frequency is not detected.
  */
-#define RX_MIN_FREQ		50.0				/* minimum frequency error to detect tone */
+#define RX_PURITY		0.5				/* minimum part of power in the detected tone */
 #define MAX_DISPLAY		(MAX_DEVIATION / SPEECH_DEVIATION)/* as much as MAX_DEVIATION */
-/* Note that FILTER_BW / SUSTAIN and QUAL_TIME sum up and should not exceed minimum tone length */
-#define RX_FILTER_BW		100.0				/* amplitude filter (causes delay) */
+/* Note that WINDOW / SUSTAIN and QUAL_TIME sum up and should not exceed minimum tone length */
+#define RX_WINDOW		0.008				/* window of tone detector (causes delay) */
+#define RX_HOP			0.001				/* interval of tone detection */
 #define RX_SUSTAIN		0.010				/* how long a tone must sustain until detected (causes delay) */
 #define RX_QUAL_TIME		0.005				/* how long a quality measurement lasts after detecting a tone */
 
@@ -74,17 +74,6 @@ static double tones[NUM_SIG_TONES] = {
 	1500.0,		/* MTS 1500 Hz */
 };
 
-/* signaling tones to be demodulated (a subset of tones above) */
-static double tone_response[NUM_SIG_TONES] = {
-	0.71,		/* guard */
-	1.08,		/* idle */
-	1.01,		/* seize */
-	1.04,		/* connect */
-	0.71,		/* disconnect */
-	0.71,		/* MTS 600 Hz */
-	0.71,		/* MTS 1500 Hz */
-};
-
 /* all tone, with signaling tones first */
 static const char *tone_names[] = {
 	"GUARD tone",
@@ -118,13 +107,21 @@ void dsp_init(void)
 	}
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_transceiver(imts_t *imts, double squelch_db, int ptt)
 {
+	int num_tones;
 	int rc = -1;
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for Transceiver.\n");
 
+	/* protocol of this channel */
+	imts->sender.send = send_audio;
+	imts->sender.receive = receive_audio;
+
 	imts->sample_duration = 1.0 / (double)imts->sender.samplerate;
 
 	/* init squelch */
@@ -133,21 +130,19 @@ int dsp_init_transceiver(imts_t *imts, double squelch_db, int ptt)
 	/* set modulation parameters */
 	sender_set_fm(&imts->sender, MAX_DEVIATION, MAX_MODULATION, SPEECH_DEVIATION, MAX_DISPLAY);
 
-	/* init FM demodulator for tone detection */
+	/* init tone detector for all signaling tones of the mode */
 	if (imts->mode == MODE_IMTS) {
-		imts->demod_center = (tones[TONE_GUARD] + tones[TONE_DISCONNECT]) / 2.0;
-		imts->demod_bandwidth = tones[TONE_GUARD] - tones[TONE_DISCONNECT];
+		imts->demod_first_tone = TONE_GUARD;
+		num_tones = TONE_DISCONNECT - TONE_GUARD + 1;
 	} else {
-		imts->demod_center = (tones[TONE_1500] + tones[TONE_600]) / 2.0;
-		imts->demod_bandwidth = tones[TONE_1500] - tones[TONE_600];
+		imts->demod_first_tone = TONE_600;
+		num_tones = TONE_1500 - TONE_600 + 1;
 	}
-	rc = fm_demod_init(&imts->demod, (double)imts->sender.samplerate, imts->demod_center, imts->demod_bandwidth);
+	rc = tone_track_init(&imts->demod_track, tones + imts->demod_first_tone, num_tones, imts->sender.samplerate, (int)((double)imts->sender.samplerate * RX_WINDOW));
 	if (rc < 0)
 		goto error;
-	/* use fourth order (2 iter) filter, since it is as fast as second order (1 iter) filter */
-	/* NOTE: CHANGE TONE RESPONSES ABOVE, IF YOU CHANGE FILTER */
-	iir_lowpass_init(&imts->demod_freq_lp, RX_FILTER_BW, (double)imts->sender.samplerate, 2);
-	iir_lowpass_init(&imts->demod_ampl_lp, RX_FILTER_BW, (double)imts->sender.samplerate, 2);
+	imts->demod_hop_size = (int)((double)imts->sender.samplerate * RX_HOP);
+	imts->demod_hop = imts->demod_hop_size;
 
 	/* tones */
 	imts->tone_idle_phaseshift65536 = 65536.0 / ((double)imts->sender.samplerate / tones[TONE_IDLE]);
@@ -165,9 +160,8 @@ int dsp_init_transceiver(imts_t *imts, double squelch_db, int ptt)
 	/* delay buffer */
 	if (ptt) {
 		LOGP_CHAN(DDSP, LOGL_DEBUG, "Push to talk: Adding delay buffer to remove noise when signal gets lost.\n");
-		imts->delay_max = (int)((double)imts->sender.samplerate * DELAY_TIME);
-		imts->delay_spl = calloc(imts->delay_max, sizeof(*imts->delay_spl));
-		if (!imts->delay_spl) {
+		rc = sample_delay_init(&imts->delay, (int)((double)imts->sender.samplerate * DELAY_TIME));
+		if (rc < 0) {
 			LOGP(DDSP, LOGL_ERROR, "No mem for delay buffer!\n");
 			goto error;
 		}
@@ -176,6 +170,8 @@ int dsp_init_transceiver(imts_t *imts, double squelch_db, int ptt)
 	imts->dmp_tone_level = display_measurements_add(&imts->sender.dispmeas, "Tone Level", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 	imts->dmp_tone_quality = display_measurements_add(&imts->sender.dispmeas, "Tone Quality", "%.1f %%", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 
+	sender_account_dsp(&imts->sender, sizeof(*imts) - sizeof(imts->sender));
+
 	return 0;
 
 error:
@@ -188,11 +184,8 @@ void dsp_cleanup_transceiver(imts_t *imts)
 {
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Cleanup DSP for Transceiver.\n");
 
-	fm_demod_exit(&imts->demod);
-	if (imts->delay_spl) {
-		free(imts->delay_spl);
-		imts->delay_spl = NULL;
-	}
+	tone_track_exit(&imts->demod_track);
+	sample_delay_exit(&imts->delay);
 }
 
 /* Generate audio stream from tone. Keep phase for next call of function. */
@@ -273,10 +266,10 @@ static int generate_tone(imts_t *imts, sample_t *samples, int length)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	imts_t *imts = (imts_t *) sender;
-	int count, input_num;
+	int count;
 
 	memset(power, 1, length);
 
@@ -296,13 +289,7 @@ again:
 		break;
 	case DSP_MODE_AUDIO:
 		memset(power, 1, length);
-		input_num = samplerate_upsample_input_num(&sender->srstate, length);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&sender->dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
-		}
-		samplerate_upsample(&sender->srstate, samples, input_num, samples, length);
+		sender_load_speech(&sender->dejitter, &sender->srstate, samples, length);
 		if (imts->pre_emphasis)
 			pre_emphasis(&imts->estate, samples, length);
 		break;
@@ -311,56 +298,45 @@ again:
 
 static void tone_demod(imts_t *imts, sample_t *samples, int length)
 {
-	sample_t frequency[length], amplitude[length];
-	sample_t I[length], Q[length];
-	double f, amp;
-	int i, t, tone = 0; // make GCC happy
-
-	/* demod frquency */
-	fm_demodulate_real(&imts->demod, frequency, length, samples, I, Q);
-	iir_process(&imts->demod_freq_lp, frequency, length);
-
-	/* demod amplitude
-	 * peak amplitude is the length of I/Q vector
-	 * since we filter out the unwanted modulation product, the vector is only half of length
-	 */
-	for (i = 0; i < length; i++)
-		amplitude[i] = sqrt(I[i] * I[i] + Q[i] * Q[i]) * 2.0;
-	iir_process(&imts->demod_ampl_lp, amplitude, length);
-
-	/* check result to detect tone or loss or change */
-	for (i = 0; i < length; i++) {
+	double levels[NUM_SIG_TONES], power, purity, amp, duration;
+	int num = imts->demod_track.k;
+	int i, n, t, best, tone;
+
+	for (i = 0; i < length; i += n) {
+		/* slide window of tone detector until next detection */
+		n = imts->demod_hop;
+		if (n > length - i)
+			n = length - i;
+		tone_track_process(&imts->demod_track, samples + i, n);
+		imts->demod_hop -= n;
+		if (imts->demod_hop)
+			continue;
+		imts->demod_hop = imts->demod_hop_size;
+		duration = (double)imts->demod_hop_size * imts->sample_duration;
+
 		/* duration until change in tone */
-		imts->demod_duration += imts->sample_duration;
-		/* correct FSK amplitude */
-		amplitude[i] /= TX_PEAK_TONE;
+		imts->demod_duration += duration;
+		/* get strongest tone and correct FSK amplitude */
+		tone_track_levels(&imts->demod_track, levels);
+		best = 0;
+		for (t = 1; t < num; t++) {
+			if (levels[t] > levels[best])
+				best = t;
+		}
+		amp = levels[best] / TX_PEAK_TONE;
+		/* part of the power that is in the strongest tone (a pure tone of level L has L * L / 2) */
+		power = tone_track_power(&imts->demod_track);
+		purity = (power > 0.0) ? levels[best] * levels[best] / (power * 2.0) : 0.0;
 		/* see what we detect at this moment; tone is set */
-		if (amplitude[i] < RX_MIN_AMPL) {
+		if (amp < RX_MIN_AMPL) {
 			/* silence */
 			tone = TONE_SILENCE;
-		} else {
+		} else if (purity >= RX_PURITY) {
 			/* tone */
-			f = frequency[i] + imts->demod_center;
-			if (imts->mode == MODE_IMTS) {
-				for (t = TONE_IDLE; t <= TONE_DISCONNECT; t++) {
-					/* check for frequency */
-					if (fabs(f - tones[t]) < RX_MIN_FREQ) {
-						tone = t;
-						break;
-					}
-				}
-			} else {
-				for (t = TONE_600; t <= TONE_1500; t++) {
-					/* check for frequency */
-					if (fabs(f - tones[t]) < RX_MIN_FREQ) {
-						tone = t;
-						break;
-					}
-				}
-			}
+			tone = imts->demod_first_tone + best;
+		} else {
 			/* noise */
-			if (t == NUM_SIG_TONES)
-				tone = TONE_NOISE;
+			tone = TONE_NOISE;
 		}
 #ifdef DEBUG_DECODER
 		/* debug decoder */
@@ -368,20 +344,15 @@ static void tone_demod(imts_t *imts, sample_t *samples, int length)
 			static int debug_interval = 0;
 			if (++debug_interval == 30) {
 				debug_interval = 0;
-				printf("decoder debug: diff=%s %.0f  ", debug_amplitude((f - tones[t]) / RX_MIN_FREQ), fabs(f - tones[t]));
-				amp = amplitude[i] / tone_response[t];
+				printf("decoder debug: purity=%s %.0f%%  ", debug_amplitude(purity), purity * 100.0);
 				printf("ampl=%s %.0f%%\n", debug_amplitude(amp), amp * 100.0);
 			}
 		}
 #endif
 		/* display level of tones, or zero at noise/silence */
-		imts->display_interval +=imts->sample_duration;
+		imts->display_interval += duration;
 		if (imts->display_interval >= DISPLAY_INTERVAL) {
-			if (tone < NUM_SIG_TONES)
-				amp = amplitude[i] / tone_response[tone];
-			else
-				amp = 0.0;
-			display_measurements_update(imts->dmp_tone_level, amp * 100.0, 0.0);
+			display_measurements_update(imts->dmp_tone_level, ((tone < NUM_SIG_TONES) ? amp : 0.0) * 100.0, 0.0);
 			imts->display_interval -= DISPLAY_INTERVAL;
 		}
 		/* check for tone change */
@@ -390,40 +361,34 @@ static void tone_demod(imts_t *imts, sample_t *samples, int length)
 			printf("decoder debug: %s detected, waiting to sustain\n", tone_names[tone]);
 #endif
 			if (imts->demod_sig_tone) {
-				LOGP_CHAN(DDSP, LOGL_DEBUG, "Lost %s (duration %.0f ms)\n", tone_names[imts->demod_current_tone], imts->demod_duration * 1000.0);
+				LOGP_CHAN_HOT(DDSP, LOGL_DEBUG, "Lost %s (duration %.0f ms)\n", tone_names[imts->demod_current_tone], imts->demod_duration * 1000.0);
 				imts_lost_tone(imts, imts->demod_current_tone, imts->demod_duration);
 				imts->demod_sig_tone = 0;
 			}
 			imts->demod_current_tone = tone;
 			imts->demod_sustain = 0.0;
 		} else if (imts->demod_sustain < RX_SUSTAIN) {
-			imts->demod_sustain += imts->sample_duration;
+			imts->demod_sustain += duration;
 			/* when sustained. also tone must change to prevent flapping; lost signaling tone can be detected again */
 			if (imts->demod_sustain >= RX_SUSTAIN && (imts->demod_current_tone != imts->demod_last_tone || !imts->demod_sig_tone)) {
 				if (imts->demod_current_tone < NUM_SIG_TONES) {
-					amp = amplitude[i] / tone_response[imts->demod_current_tone];
 					imts->demod_sig_tone = 1;
 					imts->demod_quality_time = 0.0;
 					imts->demod_quality_count = 0;
 					imts->demod_quality_value = 0.0;
-				} else {
-					amp = amplitude[i];
+				} else
 					imts->demod_sig_tone = 0;
-				}
-				LOGP_CHAN(DDSP, LOGL_DEBUG, "Detected %s (level %.0f%%)\n", tone_names[imts->demod_current_tone], amp * 100);
+				LOGP_CHAN_HOT(DDSP, LOGL_DEBUG, "Detected %s (level %.0f%%)\n", tone_names[imts->demod_current_tone], amp * 100);
 				imts_receive_tone(imts, imts->demod_current_tone, imts->demod_duration, amp);
 				imts->demod_last_tone = imts->demod_current_tone;
 				imts->demod_duration = imts->demod_sustain;
 			} else if (imts->demod_sig_tone && imts->demod_quality_time < RX_QUAL_TIME) {
-				f = frequency[i] + imts->demod_center;
-				imts->demod_quality_time += imts->sample_duration;
+				imts->demod_quality_time += duration;
 				imts->demod_quality_count++;
-				imts->demod_quality_value += fabs((f - tones[imts->demod_current_tone])) / RX_MIN_FREQ;
+				imts->demod_quality_value += purity;
 				if (imts->demod_quality_time >= RX_QUAL_TIME) {
-					double quality = 1.0 - imts->demod_quality_value / (double)imts->demod_quality_count * 2.0;
-					if (quality < 0)
-						quality = 0;
-					LOGP_CHAN(DDSP, LOGL_DEBUG, "Quality: %.0f%%\n", quality * 100.0);
+					double quality = imts->demod_quality_value / (double)imts->demod_quality_count;
+					LOGP_CHAN_HOT(DDSP, LOGL_DEBUG, "Quality: %.0f%%\n", quality * 100.0);
 					display_measurements_update(imts->dmp_tone_quality, quality * 100.0, 0.0);
 				}
 			}	
@@ -431,30 +396,8 @@ static void tone_demod(imts_t *imts, sample_t *samples, int length)
 	}
 }
 
-static void delay_audio(imts_t *imts, sample_t *samples, int count)
-{
-	sample_t *spl, s;
-	int pos, max;
-	int i;
-
-	spl = imts->delay_spl;
-	pos = imts->delay_pos;
-	max = imts->delay_max;
-
-	/* feed audio though delay buffer */
-	for (i = 0; i < count; i++) {
-		s = samples[i];
-		samples[i] = spl[pos];
-		spl[pos] = s;
-		if (++pos == max)
-			pos = 0;
-	}
-
-	imts->delay_pos = pos;
-}
-
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db)
 {
 	imts_t *imts = (imts_t *) sender;
 
@@ -470,7 +413,7 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 	case SQUELCH_MUTE:
 		if (imts->mode == MODE_MTS && !imts->is_mute) {
 			LOGP_CHAN(DDSP, LOGL_INFO, "Low RF level, muting.\n");
-			memset(imts->delay_spl, 0, sizeof(*samples) * imts->delay_max);
+			sample_delay_reset(&imts->delay);
 			imts->is_mute = 1;
 		}
 		memset(samples, 0, sizeof(*samples) * length);
@@ -496,8 +439,8 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 	tone_demod(imts, samples, length);
 
 	/* delay audio to prevent noise before squelch mutes (don't do that for signaling tones) */
-	if (imts->delay_spl)
-		delay_audio(imts, samples, length);
+	if (imts->delay.spl)
+		sample_delay_process(&imts->delay, samples, length);
 
 	/* Forward audio to network (call process). */
 	if (imts->dsp_mode == DSP_MODE_AUDIO && imts->callref) {
@@ -586,7 +529,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (imts->dsp_mode == DSP_MODE_AUDIO) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&imts->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&imts->sender.dejitter, jf);
 	}
@@ -1,6 +1,8 @@
 #include "../libsquelch/squelch.h"
 #include "../libfm/fm.h"
 #include "../libmobile/sender.h"
+#include "../libsample/delay.h"
+#include "../libgoertzel/goertzel.h"
 
 enum dsp_mode {
 	DSP_MODE_OFF = 0,	/* transmitter off */
@@ -92,11 +94,10 @@ typedef struct imts {
 
 	/* dsp states */
 	double			sample_duration;	/* 1 / samplerate */
-	double			demod_center;		/* center frequency for tone demodulation */
-	double			demod_bandwidth;	/* bandwidth for tone demodulation */
-	fm_demod_t		demod;			/* demodulator for frequency / amplitude */
-	iir_filter_t		demod_freq_lp;		/* filter for frequency response */
-	iir_filter_t		demod_ampl_lp;		/* filter for amplitude response */
+	tone_track_t		demod_track;		/* sliding DFT of all signaling tones to detect */
+	int			demod_first_tone;	/* first tone being tracked */
+	int			demod_hop;		/* samples until next detection */
+	int			demod_hop_size;		/* samples between detections */
 	int			demod_current_tone;	/* current tone being detected */
 	int			demod_sig_tone;		/* current tone is a signaling tone */
 	int			demod_last_tone;	/* last tone being detected */
@@ -119,9 +120,7 @@ typedef struct imts {
 	squelch_t		squelch;		/* squelch detection process */
 	int			is_mute;		/* set if quelch has muted */
 	int			rf_signal;		/* set if we have currently an RF signal */
-	sample_t		*delay_spl;		/* delay buffer for delaying audio */
-	int			delay_pos;		/* position in delay buffer */
-	int			delay_max;		/* number of samples in delay buffer */
+	sample_delay_t		delay;			/* delay buffer for delaying audio */
 } imts_t;
 
 
@@ -0,0 +1,339 @@
+/* IQ hub: share one SDR device between network processes
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The hub opens the SDR device and publishes the received IQ stream through
+ * shared memory. Network processes attach with '--sdr-shm <name>'. Their
+ * transmitted IQ streams are summed and sent to the device.
+ *
+ * Optionally one remote network process connects via UDP with
+ * '--sdr-udp <host>:<port>', so the hub can run next to the antenna.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <errno.h>
+#include <math.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../libsdr/sdr_config.h"
+#include "../libsdr/iqshm.h"
+#include "../libsdr/iqnet.h"
+#ifdef HAVE_UHD
+#include "../libsdr/uhd.h"
+#endif
+#ifdef HAVE_SOAPY
+#include "../libsdr/soapy.h"
+#endif
+#include "../liboptions/options.h"
+
+#define DEFAULT_LO_OFFSET -1000000.0
+
+int use_sdr = 0;
+
+static const char *name = "osmocom-iqhub";
+static double tx_frequency = 0.0;
+static double rx_frequency = 0.0;
+static int samplerate = 1000000;
+static int dsp_buffer = 10;
+static int ring_buffer = 500;
+static int udp_port = 0;
+static double udp_jitter = 20.0;
+
+/* global variable to quit main loop */
+int quit = 0;
+
+static void sighandler(int sigset)
+{
+	if (sigset == SIGHUP)
+		return;
+	if (sigset == SIGPIPE)
+		return;
+
+	printf("Signal received: %d\n", sigset);
+
+	quit = 1;
+}
+
+static void print_help(const char *arg0)
+{
+	printf("Usage: %s --sdr-soapy|--sdr-uhd <sdr options> -t <frequency> -r <frequency> [options]\n", arg0);
+	/*      -                                                                             - */
+	printf("\noptions:\n");
+	printf(" -h --help\n");
+	printf("        This help\n");
+	printf(" --config [~/]<path to config file>\n");
+	printf("        Give a config file to use. If it starts with '~/', path is at home dir.\n");
+	printf("        Each line in config file is one option, '-' or '--' must not be given!\n");
+	printf(" -n --name <name>\n");
+	printf("        Name of shared memory that network processes attach to, using\n");
+	printf("        '--sdr-shm <name>'. (default = '%s')\n", name);
+	printf(" -t --tx-frequency <frequency>\n");
+	printf("        Give center frequency of transmitter in Hertz.\n");
+	printf(" -r --rx-frequency <frequency>\n");
+	printf("        Give center frequency of receiver in Hertz.\n");
+	printf(" -s --samplerate <sample rate>\n");
+	printf("        Give sample rate of SDR device in Hz. (default = %d)\n", samplerate);
+	printf("        All network processes must use this rate with '--sdr-samplerate'.\n");
+	printf(" -b --buffer <ms>\n");
+	printf("        How many milliseconds are processed in advance. (default = %d)\n", dsp_buffer);
+	printf("    --ring-buffer <ms>\n");
+	printf("        Size of RX and TX rings in shared memory. (default = %d)\n", ring_buffer);
+	printf(" -u --udp <port>\n");
+	printf("        Serve a remote network process on given UDP port. (default = off)\n");
+	printf("    --udp-jitter <ms>\n");
+	printf("        Delay transmitted samples of the remote network process, to wait for\n");
+	printf("        late packets. (default = %.0f)\n", udp_jitter);
+	sdr_config_print_help();
+}
+
+#define OPT_RING_BUFFER		256
+#define OPT_UDP_JITTER		257
+
+static void add_options(void)
+{
+	option_add('h', "help", 0);
+	option_add('n', "name", 1);
+	option_add('t', "tx-frequency", 1);
+	option_add('r', "rx-frequency", 1);
+	option_add('s', "samplerate", 1);
+	option_add('b', "buffer", 1);
+	option_add(OPT_RING_BUFFER, "ring-buffer", 1);
+	option_add('u', "udp", 1);
+	option_add(OPT_UDP_JITTER, "udp-jitter", 1);
+	sdr_config_add_options();
+}
+
+static int handle_options(int short_option, int argi, char **argv)
+{
+	switch (short_option) {
+	case 'h':
+		print_help(argv[0]);
+		return 0;
+	case 'n':
+		name = options_strdup(argv[argi]);
+		break;
+	case 't':
+		tx_frequency = atof(argv[argi]);
+		break;
+	case 'r':
+		rx_frequency = atof(argv[argi]);
+		break;
+	case 's':
+		samplerate = atoi(argv[argi]);
+		break;
+	case 'b':
+		dsp_buffer = atoi(argv[argi]);
+		if (dsp_buffer < 1) {
+			fprintf(stderr, "Buffer must be at least 1 ms.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_RING_BUFFER:
+		ring_buffer = atoi(argv[argi]);
+		break;
+	case 'u':
+		udp_port = atoi(argv[argi]);
+		break;
+	case OPT_UDP_JITTER:
+		udp_jitter = atof(argv[argi]);
+		break;
+	default:
+		return sdr_config_handle_options(short_option, argi, argv);
+	}
+
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc, argi;
+	iqshm_t shm;
+	iqnet_t net;
+#ifdef HAVE_UHD
+	uhd_t uhd;
+#endif
+#ifdef HAVE_SOAPY
+	soapy_t soapy;
+#endif
+	float *buff = NULL, *mix;
+	int buffer_size, ring_size;
+	int count, tosend, s;
+
+	logging_init();
+
+	sdr_config_init(DEFAULT_LO_OFFSET);
+
+	/* handle options / config file */
+	add_options();
+	rc = options_config_file(argc, argv, "~/.osmocom/analog/iqhub.conf", handle_options);
+	if (rc < 0)
+		return 0;
+	argi = options_command_line(argc, argv, handle_options);
+	if (argi <= 0)
+		return argi;
+
+	if (tx_frequency == 0.0 || rx_frequency == 0.0) {
+		printf("No TX and RX center frequency given!\n\n");
+		print_help(argv[0]);
+		exit(0);
+	}
+
+	rc = sdr_configure(samplerate);
+	if (rc < 0)
+		return rc;
+	if (rc == 0 || sdr_config->shm || sdr_config->udp || sdr_config->loopback) {
+		fprintf(stderr, "Please select SDR device with '--sdr-uhd' or '--sdr-soapy', use '-h' for help!\n");
+		exit(0);
+	}
+	if (sdr_config->samplerate != samplerate) {
+		fprintf(stderr, "Do not use '--sdr-samplerate', use '-s' instead!\n");
+		exit(0);
+	}
+
+	buffer_size = samplerate * dsp_buffer / 1000;
+	ring_size = samplerate * ring_buffer / 1000;
+	if (ring_size < buffer_size * 4) {
+		fprintf(stderr, "Ring buffer must be at least four times the buffer size!\n");
+		exit(0);
+	}
+
+	buff = calloc(buffer_size * 2, sizeof(*buff));
+	if (!buff) {
+		fprintf(stderr, "No mem!\n");
+		exit(0);
+	}
+
+	memset(&net, 0, sizeof(net));
+	rc = iqshm_hub_create(&shm, name, tx_frequency, rx_frequency, samplerate, ring_size);
+	if (rc < 0) {
+		free(buff);
+		exit(0);
+	}
+	if (udp_port) {
+		rc = iqnet_hub_create(&net, udp_port, tx_frequency, rx_frequency, samplerate, ring_size, samplerate * udp_jitter / 1000.0);
+		if (rc < 0)
+			goto error;
+	}
+
+#ifdef HAVE_UHD
+	if (sdr_config->uhd)
+		rc = uhd_open(&uhd, sdr_config->channel, sdr_config->device_args[0], sdr_config->stream_args, sdr_config->tune_args, sdr_config->tx_antenna, sdr_config->rx_antenna, sdr_config->clock_source, tx_frequency, rx_frequency, sdr_config->lo_offset, samplerate, sdr_config->tx_gain, sdr_config->rx_gain, sdr_config->bandwidth, sdr_config->timestamps, sdr_config->wire_format, 0);
+#endif
+#ifdef HAVE_SOAPY
+	if (sdr_config->soapy)
+		rc = soapy_open(&soapy, sdr_config->channel, sdr_config->device_args[0], sdr_config->stream_args, sdr_config->tune_args, sdr_config->tx_antenna, sdr_config->rx_antenna, sdr_config->clock_source, tx_frequency, rx_frequency, sdr_config->lo_offset, samplerate, sdr_config->tx_gain, sdr_config->rx_gain, sdr_config->bandwidth, sdr_config->timestamps, sdr_config->wire_format, 0);
+#endif
+	if (rc < 0)
+		goto error;
+
+#ifdef HAVE_UHD
+	if (sdr_config->uhd)
+		rc = uhd_start(&uhd);
+#endif
+#ifdef HAVE_SOAPY
+	if (sdr_config->soapy)
+		rc = soapy_start(&soapy);
+#endif
+	if (rc < 0)
+		goto error_close;
+
+	signal(SIGINT, sighandler);
+	signal(SIGHUP, sighandler);
+	signal(SIGTERM, sighandler);
+	signal(SIGPIPE, sighandler);
+
+	printf("IQ hub '%s' running, press CTRL+c to exit.\n", name);
+
+	while (!quit) {
+		/* block on receiving, but return after buffer time to check for exit */
+		count = 0;
+#ifdef HAVE_UHD
+		if (sdr_config->uhd)
+			count = uhd_receive(&uhd, buff, buffer_size, dsp_buffer / 1000.0);
+#endif
+#ifdef HAVE_SOAPY
+		if (sdr_config->soapy)
+			count = soapy_receive(&soapy, buff, buffer_size, dsp_buffer / 1000.0);
+#endif
+		if (count > 0)
+			iqshm_hub_rx(&shm, buff, count);
+		if (udp_port) {
+			iqnet_hub_poll(&net);
+			if (count > 0)
+				iqnet_hub_rx(&net, buff, count);
+		}
+
+		/* keep the device filled with the sum of all clients */
+		tosend = 0;
+#ifdef HAVE_UHD
+		if (sdr_config->uhd)
+			tosend = uhd_get_tosend(&uhd, buffer_size);
+#endif
+#ifdef HAVE_SOAPY
+		if (sdr_config->soapy)
+			tosend = soapy_get_tosend(&soapy, buffer_size);
+#endif
+		if (tosend <= 0)
+			continue;
+		mix = iqshm_hub_tx(&shm, tosend);
+		if (udp_port)
+			iqnet_hub_tx(&net, mix, tosend);
+		for (s = 0; s < tosend * 2; s++) {
+			if (mix[s] > 1.0f)
+				mix[s] = 1.0f;
+			else if (mix[s] < -1.0f)
+				mix[s] = -1.0f;
+		}
+#ifdef HAVE_UHD
+		if (sdr_config->uhd)
+			uhd_send(&uhd, mix, tosend);
+#endif
+#ifdef HAVE_SOAPY
+		if (sdr_config->soapy)
+			soapy_send(&soapy, mix, tosend);
+#endif
+	}
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGHUP, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGPIPE, SIG_DFL);
+
+error_close:
+#ifdef HAVE_UHD
+	if (sdr_config->uhd)
+		uhd_close(&uhd);
+#endif
+#ifdef HAVE_SOAPY
+	if (sdr_config->soapy)
+		soapy_close(&soapy);
+#endif
+
+error:
+	iqnet_hub_destroy(&net);
+	iqshm_hub_destroy(&shm);
+	free(buff);
+	options_free();
+
+	return 0;
+}
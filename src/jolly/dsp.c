@@ -71,11 +71,18 @@ void dsp_init(void)
 	}
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
 int dsp_init_sender(jolly_t *jolly, int nbfm, double squelch_db, int repeater)
 {
 	int rc;
 
+	/* protocol of this channel */
+	jolly->sender.send = send_audio;
+	jolly->sender.receive = receive_audio;
+
 	/* init squelch */
 	squelch_init(&jolly->squelch, jolly->sender.kanal, squelch_db, MUTE_TIME, MUTE_TIME);
 	if (!isinf(squelch_db))
@@ -90,7 +97,7 @@ int dsp_init_sender(jolly_t *jolly, int nbfm, double squelch_db, int repeater)
 	/* init dtmf audio processing.
 	 * each frequency may be +6 dB deviation, which means a total deviation of +12 dB is allowed for detection.
 	 * also we allow a minimum of -30 dB for each tone. */
-	rc = dtmf_decode_init(&jolly->dtmf, jolly, jolly_receive_dtmf, 8000, db2level(6.0), db2level(-30.0), DTMF_FREQ_MARGIN_PERCENT_DEFAULT);
+	rc = dtmf_decode_init(&jolly->dtmf, jolly, jolly_receive_dtmf, 8000, db2level(6.0), db2level(-30.0), DTMF_FREQ_MARGIN_PERCENT_DEFAULT, DTMF_DECODE_GOERTZEL);
 	if (rc < 0) {
 		LOGP(DDSP, LOGL_ERROR, "Failed to init DTMF decoder!\n");
 		goto error;
@@ -103,9 +110,7 @@ int dsp_init_sender(jolly_t *jolly, int nbfm, double squelch_db, int repeater)
 	jolly->ack_max = (int)((double)jolly->sender.samplerate * ACK_TIME);
 
 	/* delay buffer */
-	jolly->delay_max = (int)((double)jolly->sender.samplerate * DELAY_TIME);
-	jolly->delay_spl = calloc(jolly->delay_max, sizeof(*jolly->delay_spl));
-	if (!jolly->delay_spl) {
+	if (sample_delay_init(&jolly->delay, (int)((double)jolly->sender.samplerate * DELAY_TIME)) < 0) {
 		LOGP(DDSP, LOGL_ERROR, "No mem for delay buffer!\n");
 		goto error;
 	}
@@ -123,6 +128,8 @@ int dsp_init_sender(jolly_t *jolly, int nbfm, double squelch_db, int repeater)
 	jolly->dmp_dtmf_low = display_measurements_add(&jolly->sender.dispmeas, "DTMF Low", "%.1f dB (last)", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, -30.0, 6.0, 0.0);
 	jolly->dmp_dtmf_high = display_measurements_add(&jolly->sender.dispmeas, "DTMF High", "%.1f dB (last)", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, -30.0, 6.0, 0.0);
 
+	sender_account_dsp(&jolly->sender, sizeof(*jolly) - sizeof(jolly->sender));
+
 	return 0;
 
 error:
@@ -132,113 +139,99 @@ error:
 
 void dsp_cleanup_sender(jolly_t *jolly)
 {
+	sender_account_dsp(&jolly->sender, -(ssize_t)jolly->speech_alloc * (ssize_t)sizeof(*jolly->speech));
+	free(jolly->speech);
+	jolly->speech = NULL;
+	jolly->speech_alloc = 0;
 	jitter_destroy(&jolly->repeater_dejitter);
 	dtmf_decode_exit(&jolly->dtmf);
-	if (jolly->delay_spl) {
-		free(jolly->delay_spl);
-		jolly->delay_spl = NULL;
+	sample_delay_exit(&jolly->delay);
+}
+
+/* voice sample of a character of the speech string, -1 if there is none */
+static int voice_index(char c)
+{
+	switch (c) {
+	case 'i':
+		return 10;
+	case 'o':
+		return 11;
+	case 'r':
+		return 12;
+	case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+		return c - '0';
 	}
+	return -1;
 }
 
+/* Render the complete announcement, so it is just copied while transmitting. */
 void set_speech_string(jolly_t *jolly, char announcement, const char *number)
 {
+	sample_t *speech;
+	int size, index, i;
+
 	jolly->speech_string[0] = announcement;
 	jolly->speech_string[1] = '\0';
 	strncat(jolly->speech_string, number, sizeof(jolly->speech_string) - strlen(jolly->speech_string) - 1);
-	jolly->speech_digit = 0;
+	jolly->speech_size = 0;
 	jolly->speech_pos = 0;
+
+	for (size = 0, i = 0; jolly->speech_string[i]; i++) {
+		index = voice_index(jolly->speech_string[i]);
+		if (index >= 0)
+			size += jolly_voice.size[index];
+	}
+	if (size > jolly->speech_alloc) {
+		speech = realloc(jolly->speech, size * sizeof(*speech));
+		if (!speech) {
+			LOGP(DDSP, LOGL_ERROR, "No mem for announcement!\n");
+			return;
+		}
+		sender_account_dsp(&jolly->sender, (ssize_t)(size - jolly->speech_alloc) * (ssize_t)sizeof(*speech));
+		jolly->speech = speech;
+		jolly->speech_alloc = size;
+	}
+	for (size = 0, i = 0; jolly->speech_string[i]; i++) {
+		index = voice_index(jolly->speech_string[i]);
+		if (index < 0)
+			continue;
+		memcpy(jolly->speech + size, jolly_voice.spl[index], jolly_voice.size[index] * sizeof(*jolly->speech));
+		size += jolly_voice.size[index];
+	}
+	jolly->speech_size = size;
+	LOGP(DDSP, LOGL_DEBUG, "speaking '%s'.\n", jolly->speech_string);
 }
 
 void reset_speech_string(jolly_t *jolly)
 {
 	jolly->speech_string[0] = '\0';
-	jolly->speech_digit = 0;
+	jolly->speech_size = 0;
 }
 
-/* Generate audio stream from voice samples. */
+/* Generate audio stream from rendered announcement. */
 static int speak_voice(jolly_t *jolly, sample_t *samples, int length)
 {
-	sample_t *spl;
-	int size;
-	int i;
-	int count = 0;
+	int count;
 
-again:
 	/* no speech */
-	if (!jolly->speech_string[jolly->speech_digit])
-		return count;
-
-	/* select sample */
-	switch (jolly->speech_string[jolly->speech_digit]) {
-	case 'i':
-		spl = jolly_voice.spl[10];
-		size = jolly_voice.size[10];
-		if (!jolly->speech_pos)
-			LOGP(DDSP, LOGL_DEBUG, "speaking 'incoming'.\n");
-		break;
-	case 'o':
-		spl = jolly_voice.spl[11];
-		size = jolly_voice.size[11];
-		if (!jolly->speech_pos)
-			LOGP(DDSP, LOGL_DEBUG, "speaking 'outgoing'.\n");
-		break;
-	case 'r':
-		spl = jolly_voice.spl[12];
-		size = jolly_voice.size[12];
-		if (!jolly->speech_pos)
-			LOGP(DDSP, LOGL_DEBUG, "speaking 'released'.\n");
-		break;
-	case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-		spl = jolly_voice.spl[jolly->speech_string[jolly->speech_digit] - '0'];
-		size = jolly_voice.size[jolly->speech_string[jolly->speech_digit] - '0'];
-		if (!jolly->speech_pos)
-			LOGP(DDSP, LOGL_DEBUG, "speaking digit '%c'.\n", jolly->speech_string[jolly->speech_digit]);
-		break;
-	default:
-		jolly->speech_digit++;
-		goto again;
-	}
+	if (!jolly->speech_size)
+		return 0;
 
-	/* copy sample */
-	for (; length && jolly->speech_pos < size; i++) {
-		*samples++ = spl[jolly->speech_pos++];
-		length--;
-		count++;
-	}
+	count = jolly->speech_size - jolly->speech_pos;
+	if (count > length)
+		count = length;
+	memcpy(samples, jolly->speech + jolly->speech_pos, count * sizeof(*samples));
+	jolly->speech_pos += count;
 
-	if (jolly->speech_pos == size) {
+	if (jolly->speech_pos == jolly->speech_size) {
+		jolly->speech_size = 0;
 		jolly->speech_pos = 0;
-		jolly->speech_digit++;
-		if (!jolly->speech_string[jolly->speech_digit])
-			speech_finished(jolly);
-		goto again;
+		speech_finished(jolly);
 	}
 
 	return count;
 }
 
-static void delay_audio(jolly_t *jolly, sample_t *samples, int count)
-{
-	sample_t *spl, s;
-	int pos, max;
-	int i;
-
-	spl = jolly->delay_spl;
-	pos = jolly->delay_pos;
-	max = jolly->delay_max;
-
-	/* feed audio though delay buffer */
-	for (i = 0; i < count; i++) {
-		s = samples[i];
-		samples[i] = spl[pos];
-		spl[pos] = s;
-		if (++pos == max)
-			pos = 0;
-	}
-
-	jolly->delay_pos = pos;
-}
-
 /* Generate audio stream from tone. Keep phase for next call of function. */
 static void dial_tone(jolly_t *jolly, sample_t *samples, int length)
 {
@@ -279,7 +272,7 @@ static void ack_tone(jolly_t *jolly, sample_t *samples, int length)
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db)
 {
 	jolly_t *jolly = (jolly_t *) sender;
 	sample_t *spl;
@@ -307,7 +300,7 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 	}
 
 	/* delay audio to prevent noise before squelch mutes */
-	delay_audio(jolly, samples, length);
+	sample_delay_process(&jolly->delay, samples, length);
 
 	/* play ack tone */
 	if (jolly->ack_count) {
@@ -320,7 +313,7 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 	/* if repeater mode, store sample in jitter buffer */
 	if (jolly->repeater) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)samples, length * sizeof(*samples), 0, jolly->repeater_sequence, jolly->repeater_timestamp, 123);
+		jf = jitter_frame_alloc(&jolly->repeater_dejitter, NULL, NULL, (uint8_t *)samples, length * sizeof(*samples), 0, jolly->repeater_sequence, jolly->repeater_timestamp, 123);
 		if (jf)
 			jitter_save(&jolly->repeater_dejitter, jf);
 		jolly->repeater_sequence += 1;
@@ -349,10 +342,10 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double rf_l
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	jolly_t *jolly = (jolly_t *) sender;
-	int count, input_num;
+	int count;
 
 	switch (jolly->state) {
 	case STATE_IDLE:
@@ -374,13 +367,7 @@ void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length
 	case STATE_CALL:
 	case STATE_CALL_DIALING:
 		memset(power, 1, length);
-		input_num = samplerate_upsample_input_num(&sender->srstate, length);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&sender->dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
-		}
-		samplerate_upsample(&sender->srstate, samples, input_num, samples, length);
+		sender_load_speech(&sender->dejitter, &sender->srstate, samples, length);
 		break;
 	case STATE_OUT_VERIFY:
 	case STATE_IN_PAGING:
@@ -426,7 +413,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (jolly->state == STATE_CALL || jolly->state == STATE_CALL_DIALING) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&jolly->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&jolly->sender.dejitter, jf);
 	}
@@ -1,5 +1,6 @@
 #include "../libsquelch/squelch.h"
 #include "../libmobile/sender.h"
+#include "../libsample/delay.h"
 #include "../libdtmf/dtmf_decode.h"
 
 enum jolly_state {
@@ -45,11 +46,11 @@ typedef struct jolly {
 	int			ack_max;		/* duration in samples */
 	struct osmo_timer_list		speech_timer;
 	char			speech_string[40];	/* speech string */
-	int			speech_digit;		/* counts digits */
+	sample_t		*speech;		/* announcement, rendered from speech string */
+	int			speech_size;		/* length of announcement, 0 if none */
+	int			speech_alloc;		/* allocated samples of buffer */
 	int			speech_pos;		/* counts samples */
-	sample_t		*delay_spl;		/* delay buffer for delaying audio */
-	int			delay_pos;		/* position in delay buffer */
-	int			delay_max;		/* number of samples in delay buffer */
+	sample_delay_t		delay;			/* delay buffer for delaying audio */
 } jolly_t;
 
 int jolly_create(const char *kanal, double dl_freq, double ul_freq, double step, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback, double squelch_db, int nbfm, int repeater);
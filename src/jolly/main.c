@@ -35,6 +35,7 @@
 #include "../anetz/besetztton.h"
 #include "../liboptions/options.h"
 #include "jolly.h"
+#include "../libmobile/reconfig.h"
 #include "dsp.h"
 #include "voice.h"
 
@@ -122,6 +123,19 @@ static const struct number_lengths number_lengths[] = {
 	{ 0, NULL }
 };
 
+/* change squelch via control socket, like '-S' */
+static int set_squelch(sender_t *sender, const char *value)
+{
+	jolly_t *jolly = (jolly_t *) sender;
+
+	if (!sender->use_sdr)
+		return -EINVAL;
+	squelch_set_threshold(&jolly->squelch, (!strcasecmp(value, "auto")) ? 0.0 : atof(value));
+	jolly->is_mute = 1;
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int rc, argi;
@@ -159,12 +173,12 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
@@ -202,6 +216,8 @@ int main(int argc, char *argv[])
 		printf("base station on channel %s ready, please tune transmitter to %.4f MHz and receiver to %.4f MHz. (%.4f MHz offset)\n", kanal[i], dl_freq + step / 1e3 * (double)atoi(kanal[i]), ul_freq + step / 1e3 * (double)atoi(kanal[i]), ul_freq - dl_freq);
 	}
 
+	reconfig_add("squelch", 1, set_squelch, "Squelch threshold in dB or 'auto', like '-S' (SDR only)");
+
 	main_mobile_loop("jollycom", &quit, NULL, station_id);
 
 fail:
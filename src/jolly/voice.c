@@ -5,7 +5,7 @@
 #include "../libsamplerate/samplerate.h"
 #include "voice.h"
 
-static int16_t digit_0[] = {
+static const int16_t digit_0[] = {
 	0xfff0, 0xfffc, 0xfffe, 0x0001, 0xfffe, 0xfffb, 0xfffe, 0xfffd,
 	0x0002, 0xffff, 0x0006, 0x0003, 0x0009, 0xfff8, 0x0008, 0x0017,
 	0x001a, 0x0019, 0x000e, 0x0024, 0x0021, 0x0016, 0x0014, 0x000e,
@@ -826,7 +826,7 @@ static int16_t digit_0[] = {
 	0x0002, 0xffff, 0x0001, 0x0000, 0x0002, 0xfffc, 0x0002, 0xfffd,
 };
 
-static int16_t digit_1[] = {
+static const int16_t digit_1[] = {
 	0xffa1, 0xffa1, 0xffad, 0xffb6, 0xffb8, 0xffcd, 0xffc8, 0xffcf,
 	0xffd0, 0xffe2, 0xffe2, 0xfff7, 0x0018, 0x0031, 0x003c, 0x0040,
 	0x0054, 0x0060, 0x005c, 0x0065, 0x0076, 0x007b, 0x0071, 0x0058,
@@ -1514,7 +1514,7 @@ static int16_t digit_1[] = {
 	0xffef, 0xffe2, 0xffd8, 0xffc9, 0xffd7, 0xffd2, 0xffd6, 0xffcb,
 };
 
-static int16_t digit_2[] = {
+static const int16_t digit_2[] = {
 	0x002c, 0x0033, 0x0028, 0x0027, 0x0027, 0x002f, 0x0027, 0x0024,
 	0x001a, 0x0011, 0x0011, 0x0003, 0x0007, 0xffff, 0xfff8, 0xfff3,
 	0xfff6, 0xffe9, 0xffe3, 0xffd1, 0xffcd, 0xffd7, 0xffd2, 0xffd5,
@@ -2083,7 +2083,7 @@ static int16_t digit_2[] = {
 	0xffc5, 0xffdb, 0xffcd, 0xffe5, 0xffea, 0xffff, 0x0001, 0x0004,
 };
 
-static int16_t digit_3[] = {
+static const int16_t digit_3[] = {
 	0xffef, 0xffd3, 0xffc9, 0xffc9, 0xffbd, 0xffc7, 0xffbe, 0xffc0,
 	0xffda, 0xffd9, 0xffd5, 0xffc8, 0xffcc, 0xffcb, 0xffc7, 0xffd9,
 	0xffd0, 0xffcf, 0xffbd, 0xffbb, 0xffba, 0xffb4, 0xffaf, 0xffb0,
@@ -2596,7 +2596,7 @@ static int16_t digit_3[] = {
 	0x0010, 0x0001, 0x0003, 0x0002, 0xfff9, 0xffee, 0xfff6, 0x000a,
 };
 
-static int16_t digit_4[] = {
+static const int16_t digit_4[] = {
 	0xfffb, 0xffff, 0xfff3, 0xfff2, 0x0001, 0xfffc, 0x0012, 0x0025,
 	0x002f, 0x0008, 0xfffc, 0x0004, 0x0008, 0x0009, 0x0002, 0xfffe,
 	0xfffc, 0xfffc, 0x0007, 0x0008, 0xfff8, 0xfffd, 0xffe3, 0xffcb,
@@ -3154,7 +3154,7 @@ static int16_t digit_4[] = {
 	0x0003, 0x0000, 0x0001, 0x0000, 0x0001, 0xffff, 0xfffe, 0x0003,
 };
 
-static int16_t digit_5[] = {
+static const int16_t digit_5[] = {
 	0xfffa, 0xfff7, 0xfff7, 0xffe7, 0xffec, 0xfff1, 0xfff9, 0xfff1,
 	0xfff1, 0xffe8, 0xffe8, 0xffee, 0xffe4, 0xffda, 0xffd6, 0xfffb,
 	0xfffa, 0x000b, 0xffff, 0x000c, 0xfffc, 0xffe8, 0xffe6, 0xffd2,
@@ -3833,7 +3833,7 @@ static int16_t digit_5[] = {
 	0xffff, 0x0000, 0x0000, 0x0008, 0x0014, 0x0018, 0x0011, 0x000c,
 };
 
-static int16_t digit_6[] = {
+static const int16_t digit_6[] = {
 	0x000f, 0x001a, 0x0010, 0x0012, 0xfff9, 0xffe7, 0xffe3, 0xffe5,
 	0xffec, 0xfff5, 0x0006, 0xfffe, 0x0010, 0x0013, 0x0012, 0x0009,
 	0x000c, 0x0008, 0xffff, 0xfff6, 0x0001, 0xfff4, 0xfff5, 0xfff7,
@@ -4473,7 +4473,7 @@ static int16_t digit_6[] = {
 	0x0008, 0xfffb, 0x0007, 0xfffc, 0x0004, 0xfffe, 0x0000, 0x0004,
 };
 
-static int16_t digit_7[] = {
+static const int16_t digit_7[] = {
 	0xffc9, 0xffd9, 0xfff3, 0x0003, 0x0020, 0x0029, 0x0035, 0x001c,
 	0x0011, 0x0002, 0x0000, 0xffe5, 0xffe5, 0xfffe, 0xfff2, 0xffed,
 	0xfffd, 0xfffa, 0xffe3, 0xffdc, 0xffd9, 0xffcf, 0xffd8, 0xffc9,
@@ -5117,7 +5117,7 @@ static int16_t digit_7[] = {
 	0x0002, 0xfffd, 0x0005, 0xfffc, 0x0004, 0xfffe, 0x0001, 0x0001,
 };
 
-static int16_t digit_8[] = {
+static const int16_t digit_8[] = {
 	0x0002, 0xfffd, 0x0004, 0xfffc, 0x0004, 0xfffd, 0x0002, 0xfffe,
 	0x0002, 0xfffe, 0x0002, 0xfffe, 0x0002, 0xfffd, 0x0003, 0xfffe,
 	0x0001, 0x0000, 0xffff, 0x0001, 0x0000, 0x0000, 0xffff, 0x0002,
@@ -5556,7 +5556,7 @@ static int16_t digit_8[] = {
 	0x0001, 0xffff, 0x0002, 0xfffe, 0x0001, 0x0000, 0xfffe, 0x0003,
 };
 
-static int16_t digit_9[] = {
+static const int16_t digit_9[] = {
 	0xfffd, 0x0004, 0xfffd, 0x0001, 0x0000, 0x0000, 0x0001, 0xffff,
 	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
 	0x0001, 0xfffe, 0x0002, 0xffff, 0x0001, 0xffff, 0x0001, 0xfffd,
@@ -6134,7 +6134,7 @@ static int16_t digit_9[] = {
 	0xfffc, 0x0004, 0xfffd, 0x0002, 0xfffe, 0x0002, 0xffff, 0x0000,
 };
 
-static int16_t incoming[] = {
+static const int16_t incoming[] = {
 	0x0004, 0x0002, 0x0003, 0x0000, 0x0002, 0xffff, 0xfffd, 0xffff,
 	0xfffb, 0xfffc, 0xfffe, 0xfffb, 0x0002, 0xfffc, 0x0006, 0xffff,
 	0x0009, 0x0002, 0x0006, 0x0003, 0x0005, 0x0000, 0xfffe, 0xfffd,
@@ -7586,7 +7586,7 @@ static int16_t incoming[] = {
 	0xfffe, 0x0001, 0xfffe, 0x0000, 0xffff, 0x0002, 0xfffd, 0x0004,
 };
 
-static int16_t outgoing[] = {
+static const int16_t outgoing[] = {
 	0x0001, 0x0000, 0xffff, 0x0001, 0x0000, 0xffff, 0x0002, 0xfffd,
 	0x0004, 0xfffc, 0x0003, 0xfffe, 0x0001, 0x0000, 0x0000, 0xffff,
 	0x0002, 0xfffe, 0x0002, 0xfffe, 0x0002, 0xfffe, 0x0002, 0xfffe,
@@ -9005,7 +9005,7 @@ static int16_t outgoing[] = {
 	0xfffb, 0x0004, 0xfffe, 0x0001, 0x0000, 0xffff, 0x0001, 0xffff,
 };
 
-static int16_t released[] = {
+static const int16_t released[] = {
 	0xfffe, 0x0001, 0x0000, 0xfffe, 0x0004, 0xfffa, 0x0007, 0xfff9,
 	0x0006, 0xfff9, 0x0007, 0xfff9, 0x0006, 0xfffd, 0x0000, 0x0001,
 	0xffff, 0x0001, 0x0000, 0x0000, 0x0000, 0xffff, 0x0003, 0xfffd,
@@ -11069,52 +11069,38 @@ jolly_voice_t jolly_voice;
 
 int init_voice(int samplerate)
 {
+	const int16_t *pattern[13] = {
+		digit_0, digit_1, digit_2, digit_3, digit_4, digit_5, digit_6, digit_7, digit_8, digit_9,
+		incoming, outgoing, released,
+	};
+	int size[13] = {
+		sizeof(digit_0) / sizeof(int16_t), sizeof(digit_1) / sizeof(int16_t),
+		sizeof(digit_2) / sizeof(int16_t), sizeof(digit_3) / sizeof(int16_t),
+		sizeof(digit_4) / sizeof(int16_t), sizeof(digit_5) / sizeof(int16_t),
+		sizeof(digit_6) / sizeof(int16_t), sizeof(digit_7) / sizeof(int16_t),
+		sizeof(digit_8) / sizeof(int16_t), sizeof(digit_9) / sizeof(int16_t),
+		sizeof(incoming) / sizeof(int16_t), sizeof(outgoing) / sizeof(int16_t),
+		sizeof(released) / sizeof(int16_t),
+	};
 	int i;
 
-	jolly_voice.spl[0] = (sample_t *)digit_0;
-	jolly_voice.size[0] = sizeof(digit_0) / sizeof(int16_t);
-	jolly_voice.spl[1] = (sample_t *)digit_1;
-	jolly_voice.size[1] = sizeof(digit_1) / sizeof(int16_t);
-	jolly_voice.spl[2] = (sample_t *)digit_2;
-	jolly_voice.size[2] = sizeof(digit_2) / sizeof(int16_t);
-	jolly_voice.spl[3] = (sample_t *)digit_3;
-	jolly_voice.size[3] = sizeof(digit_3) / sizeof(int16_t);
-	jolly_voice.spl[4] = (sample_t *)digit_4;
-	jolly_voice.size[4] = sizeof(digit_4) / sizeof(int16_t);
-	jolly_voice.spl[5] = (sample_t *)digit_5;
-	jolly_voice.size[5] = sizeof(digit_5) / sizeof(int16_t);
-	jolly_voice.spl[6] = (sample_t *)digit_6;
-	jolly_voice.size[6] = sizeof(digit_6) / sizeof(int16_t);
-	jolly_voice.spl[7] = (sample_t *)digit_7;
-	jolly_voice.size[7] = sizeof(digit_7) / sizeof(int16_t);
-	jolly_voice.spl[8] = (sample_t *)digit_8;
-	jolly_voice.size[8] = sizeof(digit_8) / sizeof(int16_t);
-	jolly_voice.spl[9] = (sample_t *)digit_9;
-	jolly_voice.size[9] = sizeof(digit_9) / sizeof(int16_t);
-	jolly_voice.spl[10] = (sample_t *)incoming;
-	jolly_voice.size[10] = sizeof(incoming) / sizeof(int16_t);
-	jolly_voice.spl[11] = (sample_t *)outgoing;
-	jolly_voice.size[11] = sizeof(outgoing) / sizeof(int16_t);
-	jolly_voice.spl[12] = (sample_t *)released;
-	jolly_voice.size[12] = sizeof(released) / sizeof(int16_t);
-
 	for (i = 0; i < 13; i++) {
 		samplerate_t srstate;
-		sample_t spl_in[jolly_voice.size[i]], *spl_out;
+		sample_t spl_in[size[i]], *spl_out;
 		int s, output_num;
 		int rc;
 
-		rc = init_samplerate(&srstate, 8000.0, (double)samplerate, 3400.0);
+		rc = init_samplerate(&srstate, 8000.0, (double)samplerate, 3400.0, SAMPLERATE_LINEAR);
 		if (rc < 0) {
 			fprintf(stderr, "Failed to init sample rate conversion!\n");
 			return -1;
 		}
 
-		output_num = samplerate_upsample_output_num(&srstate, jolly_voice.size[i]);
+		output_num = samplerate_upsample_output_num(&srstate, size[i]);
 		spl_out = calloc(output_num, sizeof(*spl_out));
-		for (s = 0; s < jolly_voice.size[i]; s ++)
-			spl_in[s] = (double)(((int16_t *)(jolly_voice.spl[i]))[s]) / 32767.0 * GAIN;
-		samplerate_upsample(&srstate, spl_in, jolly_voice.size[i], spl_out, output_num);
+		for (s = 0; s < size[i]; s ++)
+			spl_in[s] = (double)pattern[i][s] / 32767.0 * GAIN;
+		samplerate_upsample(&srstate, spl_in, size[i], spl_out, output_num);
 		jolly_voice.spl[i] = spl_out;
 		jolly_voice.size[i] = output_num;
 	}
@@ -28,6 +28,7 @@
 
 static int has_init = 0;
 static int fast_math = 0;
+/* built once by am_init(), shared read-only by all demodulators */
 static float *sin_tab = NULL, *cos_tab = NULL;
 
 /* global init */
@@ -35,7 +36,8 @@ int am_init(int _fast_math)
 {
 	fast_math = _fast_math;
 
-	if (fast_math) {
+	/* vector and phasor math do not use tables */
+	if (fast_math == AM_MATH_TABLE) {
 		int i;
 
 		sin_tab = calloc(65536+16384, sizeof(*sin_tab));
@@ -83,6 +85,8 @@ int am_mod_init(am_mod_t *mod, double samplerate, double offset, double gain, do
 		mod->rot = 65536.0 * offset / samplerate;
 	else
 		mod->rot = 2.0 * M_PI * offset / samplerate;
+	if (fast_math == AM_MATH_PHASOR)
+		nco_init(&mod->nco, 0.0, mod->rot);
 
 	return 0;
 }
@@ -91,6 +95,34 @@ void am_mod_exit(am_mod_t __attribute__((unused)) *mod)
 {
 }
 
+/* Modulate with float math.
+ *
+ * The carrier does not depend on the amplitude, so the phase of each sample is
+ * taken from the fixed point phase of the block start, without accumulation.
+ * The amplitude is set to 0 without a branch, if power is off. Then the loop
+ * can be vectorized.
+ */
+static void modulate_vector(am_mod_t *mod, sample_t *amplitude, uint8_t *power, int num, float *baseband)
+{
+	uint32_t acc, step;
+	float gain = mod->gain;
+	float bias = mod->bias;
+	int s;
+
+	/* phase unit is 65536 per turn, we use 2^32 per turn */
+	acc = (uint32_t)(mod->phase * 65536.0);
+	step = (uint32_t)(int64_t)(mod->rot * 65536.0);
+	for (s = 0; s < num; s++) {
+		float vector, _sin, _cos;
+		vector = (float)(power[s] != 0) * ((float)amplitude[s] * gain + bias);
+		sincos_vector(acc + step * (uint32_t)s, vector, &_sin, &_cos);
+		baseband[s * 2] += _cos;
+		baseband[s * 2 + 1] += _sin;
+	}
+	acc += step * (uint32_t)num;
+	mod->phase = (double)acc / 65536.0;
+}
+
 void am_modulate_complex(am_mod_t *mod, sample_t *amplitude, uint8_t *power, int num, float *baseband)
 {
 	int s;
@@ -100,6 +132,26 @@ void am_modulate_complex(am_mod_t *mod, sample_t *amplitude, uint8_t *power, int
 	double gain = mod->gain;
 	double bias = mod->bias;
 
+	if (fast_math == AM_MATH_VECTOR) {
+		modulate_vector(mod, amplitude, power, num, baseband);
+		return;
+	}
+
+	if (fast_math == AM_MATH_PHASOR) {
+		nco_t nco = mod->nco;
+		for (s = 0; s < num; s++) {
+			if (*power++)
+				vector = *amplitude++ * gain + bias;
+			else
+				vector = 0.0;
+			*baseband++ += nco.re * vector;
+			*baseband++ += nco.im * vector;
+			nco_next(&nco);
+		}
+		mod->nco = nco;
+		return;
+	}
+
 	for (s = 0; s < num; s++) {
 		if (*power++)
 			vector = *amplitude++ * gain + bias;
@@ -136,6 +188,8 @@ int am_demod_init(am_demod_t *demod, double samplerate, double offset, double ba
 		demod->rot = 65536.0 * -offset / samplerate;
 	else
 		demod->rot = 2 * M_PI * -offset / samplerate;
+	if (fast_math == AM_MATH_PHASOR)
+		nco_init(&demod->nco, 0.0, demod->rot);
 
 	/* use fourth order (2 iter) filter, since it is as fast as second order (1 iter) filter */
 	iir_lowpass_init(&demod->lp[0], bandwidth, samplerate, 2);
@@ -143,6 +197,7 @@ int am_demod_init(am_demod_t *demod, double samplerate, double offset, double ba
 
 	/* filter carrier */
 	iir_lowpass_init(&demod->lp[2], CARRIER_FILTER, samplerate, 1);
+	iir_lowpass_init(&demod->lp[3], CARRIER_FILTER, samplerate, 1);
 
 	return 0;
 }
@@ -151,6 +206,40 @@ void am_demod_exit(am_demod_t __attribute__((unused)) *demod)
 {
 }
 
+/* Synchronous demodulation:
+ * The carrier is estimated by filtering the IQ vectors with the carrier filter,
+ * instead of filtering their magnitude. Each vector is projected onto the
+ * carrier, so noise in quadrature to the carrier is removed and selective
+ * fading of one side band does not distort the envelope. The carrier must be
+ * tuned within the bandwidth of the carrier filter.
+ */
+void am_demod_sync(am_demod_t *demod, int sync)
+{
+	demod->sync = sync;
+}
+
+/* Rotate with float math, like the vector rotation of the FM demodulator. */
+static void rotate_vector(am_demod_t *demod, int length, float *baseband, sample_t *I, sample_t *Q)
+{
+	uint32_t acc, step;
+	int s;
+
+	/* phase unit is 65536 per turn, we use 2^32 per turn */
+	acc = (uint32_t)(demod->phase * 65536.0);
+	step = (uint32_t)(int64_t)(demod->rot * 65536.0);
+	for (s = 0; s < length; s++) {
+		float _sin, _cos;
+		sample_t i, q;
+		sincos_vector(acc + step * (uint32_t)(s + 1), 1.0f, &_sin, &_cos);
+		i = baseband[s * 2];
+		q = baseband[s * 2 + 1];
+		I[s] = i * _cos - q * _sin;
+		Q[s] = i * _sin + q * _cos;
+	}
+	acc += step * (uint32_t)length;
+	demod->phase = (double)acc / 65536.0;
+}
+
 /* do amplitude demodulation of baseband and write them to samples */
 void am_demodulate_complex(am_demod_t *demod, sample_t *amplitude, int length, float *baseband, sample_t *I, sample_t *Q, sample_t *carrier)
 {
@@ -162,6 +251,22 @@ void am_demodulate_complex(am_demod_t *demod, sample_t *amplitude, int length, f
 	double _sin, _cos;
 
 	/* rotate spectrum */
+	if (fast_math == AM_MATH_PHASOR) {
+		nco_t nco = demod->nco;
+		for (s = 0, ss = 0; s < length; s++) {
+			i = baseband[ss++];
+			q = baseband[ss++];
+			nco_next(&nco);
+			I[s] = i * nco.re - q * nco.im;
+			Q[s] = i * nco.im + q * nco.re;
+		}
+		demod->nco = nco;
+		goto filter;
+	}
+	if (fast_math == AM_MATH_VECTOR) {
+		rotate_vector(demod, length, baseband, I, Q);
+		goto filter;
+	}
 	for (s = 0, ss = 0; s < length; s++) {
 		i = baseband[ss++];
 		q = baseband[ss++];
@@ -186,11 +291,25 @@ void am_demodulate_complex(am_demod_t *demod, sample_t *amplitude, int length, f
 	}
 	demod->phase = phase;
 
+filter:
 	/* filter bandwidth */
-	iir_process(&demod->lp[0], I, length);
-	iir_process(&demod->lp[1], Q, length);
+	iir_process_iq(&demod->lp[0], &demod->lp[1], I, Q, length);
+
+	if (demod->sync) {
+		/* carrier vector: I in 'carrier', Q in 'amplitude' */
+		memcpy(carrier, I, length * sizeof(*carrier));
+		memcpy(amplitude, Q, length * sizeof(*amplitude));
+		iir_process_iq(&demod->lp[2], &demod->lp[3], carrier, amplitude, length);
+
+		/* project onto carrier and normalize by its squared magnitude, so no square root is required */
+		for (s = 0; s < length; s++) {
+			sample_t ci = carrier[s], cq = amplitude[s];
+			amplitude[s] = ((I[s] * ci + Q[s] * cq) / (ci * ci + cq * cq + 1e-30) - 1.0) * gain;
+		}
+		return;
+	}
 
-	/* demod */
+	/* demod, the magnitude is calculated for the whole block, so it can be vectorized */
 	for (s = 0; s < length; s++)
 		amplitude[s] = carrier[s] = sqrt(I[s] * I[s] + Q[s] * Q[s]);
 
@@ -1,4 +1,11 @@
 #include "../libfilter/iir_filter.h"
+#include "../libsample/nco.h"
+
+/* fast_math modes, same values as FM_MATH_* */
+#define AM_MATH_LIBM	0	/* double precision sin() / cos() */
+#define AM_MATH_TABLE	1	/* sine table lookup */
+#define AM_MATH_VECTOR	2	/* float polynomial on blocks of samples */
+#define AM_MATH_PHASOR	3	/* recursive phasor */
 
 int am_init(int fast_math);
 void am_exit(void);
@@ -8,6 +15,7 @@ typedef struct am_mod {
 	double	phase;		/* current phase */
 	double	gain;		/* gain to be multiplied to amplitude */
 	double	bias;		/* DC offset to add (carrier amplitude) */
+	nco_t	nco;		/* phasor (used with phasor math) */
 } am_mod_t;
 
 int am_mod_init(am_mod_t *mod, double samplerate, double offset, double gain, double bias);
@@ -17,12 +25,15 @@ void am_modulate_complex(am_mod_t *mod, sample_t *amplitude, uint8_t *power, int
 typedef struct am_demod {
 	double	rot;		/* angle to rotate vector per sample */
 	double	phase;		/* current rotation phase (used to shift) */
-	iir_filter_t lp[3];	/* filters received IQ signal/carrier */
+	iir_filter_t lp[4];	/* filters received IQ signal/carrier (I and Q of carrier with synchronous demodulation) */
 	double	gain;		/* gain to be expected from amplitude */
 	double	bias;		/* DC offset to be expected (carrier amplitude) */
+	nco_t	nco;		/* phasor (used with phasor math) */
+	int	sync;		/* synchronous demodulation */
 } am_demod_t;
 
 int am_demod_init(am_demod_t *demod, double samplerate, double offset, double gain, double bias);
 void am_demod_exit(am_demod_t *demod);
+void am_demod_sync(am_demod_t *demod, int sync);
 void am_demodulate_complex(am_demod_t *demod, sample_t *amplitude, int length, float *baseband, sample_t *I, sample_t *Q, sample_t *carrier);
 
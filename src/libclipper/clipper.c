@@ -45,17 +45,18 @@ void clipper_init(double point)
 		clipper_lut[i] = clipper_point + atan(a * i / 1000.0) / a;
 }
 
-void clipper_process(sample_t *samples, int length)
+/* Speech is mostly below the clipping point, so each block is checked for
+ * samples above it first, in a loop that the compiler vectorizes. Only blocks that exceed
+ * the clipping point are processed sample by sample.
+ */
+#define CLIPPER_BLOCK	64
+
+static void clipper_block(sample_t *samples, int length)
 {
 	int i;
 	double val, inv, shiftmultval;
 	int n, q;
 
-	if (isnan(clipper_point)) {
-		fprintf(stderr, "Clipper not initialized, aborting!\n");
-		abort();
-	}
-
 	for (i = 0; i < length; i++) {
 		val = samples[i];
 		if (val < 0) {
@@ -79,3 +80,23 @@ void clipper_process(sample_t *samples, int length)
 	}
 }
 
+void clipper_process(sample_t *samples, int length)
+{
+	sample_t point;
+	int i, n, over;
+
+	if (isnan(clipper_point)) {
+		fprintf(stderr, "Clipper not initialized, aborting!\n");
+		abort();
+	}
+
+	point = clipper_point;
+	for (; length > 0; length -= n, samples += n) {
+		n = (length < CLIPPER_BLOCK) ? length : CLIPPER_BLOCK;
+		over = 0;
+		for (i = 0; i < n; i++)
+			over |= (samples[i] > point) | (samples[i] < -point);
+		if (over)
+			clipper_block(samples, n);
+	}
+}
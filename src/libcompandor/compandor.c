@@ -36,10 +36,11 @@
 /* Minimum level value to keep state (-60 dB) */
 #define ENVELOPE_MIN	0.001
 
-/* Maximum level, to prevent sqrt_tab to overflow */
+/* Maximum level, to prevent gain_tab to overflow */
 #define ENVELOPE_MAX	9.990
 
-static double sqrt_tab[10000];
+/* gain of compressor, indexed by envelope in steps of ENVELOPE_MIN, float to keep the table small */
+static sample_t gain_tab[10000];
 static int compandor_initalized = 0;
 
 /*
@@ -54,8 +55,9 @@ void compandor_init(void)
 	int i;
 
 	// FIXME: make global, not at instance
-	for (i = 0; i < 10000; i++)
-		sqrt_tab[i] = sqrt(i * 0.001);
+	gain_tab[0] = 1.0 / sqrt(ENVELOPE_MIN);
+	for (i = 1; i < 10000; i++)
+		gain_tab[i] = 1.0 / sqrt(i * ENVELOPE_MIN);
 	compandor_initalized = 1;
 }
 
@@ -78,42 +80,42 @@ void setup_compandor(compandor_t *state, double samplerate, double attack_ms, do
 	state->e.step_down = pow(EXPAND_RECOVERY_FACTOR, 1000.0 / recovery_ms / samplerate);
 }
 
+/* The envelope must be tracked sample by sample, because it depends on the
+ * previous sample. It is done for a block of samples first, then the gain is
+ * applied to the whole block in a separate loop that the compiler vectorizes.
+ * The gain of the compressor is taken from a table of reciprocal square roots,
+ * so neither loop divides.
+ */
+#define COMPANDOR_BLOCK	64
+
 void compress_audio(compandor_t *state, sample_t *samples, int num)
 {
 	double value, peak, envelope, step_up, step_down;
-	int i;
+	sample_t gain[COMPANDOR_BLOCK];
+	int i, n;
 
 	step_up = state->c.step_up;
 	step_down = state->c.step_down;
 	peak = state->c.peak;
 	envelope = state->c.envelope;
 
-//	printf("envelope=%.4f\n", envelope);
-	for (i = 0; i < num; i++) {
-		value = *samples;
-
-		/* 'peak' is the level that raises directly with the signal
-		 * level, but falls with specified recovery rate. */
-		if (fabs(value) > peak)
-			peak = fabs(value);
-		else
-			peak *= step_down;
-		/* 'evelope' is the level that raises with the specified attack
-		 * rate to 'peak', but falls with specified recovery rate. */
-		if (peak > envelope)
-			envelope *= step_up;
-		else
-			envelope = peak;
-		if (envelope < ENVELOPE_MIN)
-			envelope = ENVELOPE_MIN;
-		if (envelope > ENVELOPE_MAX)
-			envelope = ENVELOPE_MAX;
-
-		*samples++ = value / sqrt_tab[(int)(envelope / 0.001)];
-//if (i > 47000.0 && i < 48144)
-//printf("time=%.4f envelope=%.4fdb, value=%.4f\n", (double)i/48000.0, 20*log10(envelope), value);
+	for (; num > 0; num -= n, samples += n) {
+		n = (num < COMPANDOR_BLOCK) ? num : COMPANDOR_BLOCK;
+		for (i = 0; i < n; i++) {
+			value = fabs(samples[i]);
+			/* 'peak' is the level that raises directly with the signal
+			 * level, but falls with specified recovery rate. */
+			peak = (value > peak) ? value : peak * step_down;
+			/* 'evelope' is the level that raises with the specified attack
+			 * rate to 'peak', but falls with specified recovery rate. */
+			envelope = (peak > envelope) ? envelope * step_up : peak;
+			envelope = (envelope < ENVELOPE_MIN) ? ENVELOPE_MIN : envelope;
+			envelope = (envelope > ENVELOPE_MAX) ? ENVELOPE_MAX : envelope;
+			gain[i] = gain_tab[(int)(envelope * (1.0 / ENVELOPE_MIN))];
+		}
+		for (i = 0; i < n; i++)
+			samples[i] *= gain[i];
 	}
-//exit(0);
 
 	state->c.envelope = envelope;
 	state->c.peak = peak;
@@ -122,32 +124,28 @@ void compress_audio(compandor_t *state, sample_t *samples, int num)
 void expand_audio(compandor_t *state, sample_t *samples, int num)
 {
 	double value, peak, envelope, step_up, step_down;
-	int i;
+	sample_t gain[COMPANDOR_BLOCK];
+	int i, n;
 
 	step_up = state->e.step_up;
 	step_down = state->e.step_down;
 	peak = state->e.peak;
 	envelope = state->e.envelope;
 
-	for (i = 0; i < num; i++) {
-		value = *samples;
-
-		/* for comments: see compress_audio() */
-		if (fabs(value) > peak)
-			peak = fabs(value);
-		else
-			peak *= step_down;
-		if (peak > envelope)
-			envelope *= step_up;
-		else
-			envelope = peak;
-		if (envelope < ENVELOPE_MIN)
-			envelope = ENVELOPE_MIN;
-
-		*samples++ = value * envelope;
+	for (; num > 0; num -= n, samples += n) {
+		n = (num < COMPANDOR_BLOCK) ? num : COMPANDOR_BLOCK;
+		for (i = 0; i < n; i++) {
+			value = fabs(samples[i]);
+			/* for comments: see compress_audio() */
+			peak = (value > peak) ? value : peak * step_down;
+			envelope = (peak > envelope) ? envelope * step_up : peak;
+			envelope = (envelope < ENVELOPE_MIN) ? ENVELOPE_MIN : envelope;
+			gain[i] = envelope;
+		}
+		for (i = 0; i < n; i++)
+			samples[i] *= gain[i];
 	}
 
 	state->e.envelope = envelope;
 	state->e.peak = peak;
 }
-
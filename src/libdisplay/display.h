@@ -1,15 +1,36 @@
+#include <stddef.h>
+#include <stdatomic.h>
+
 #define DISPLAY_MEAS_INTERVAL	0.1	/* time (in seconds) for each measurement values interval */
 #define DISPLAY_INTERVAL	0.04	/* time (in seconds) for each other interval */
 #define DISPLAY_PARAM_HISTORIES	10	/* number of intervals (should result in one seconds) */
 
 #define MAX_DISPLAY_WIDTH 1024
 
+/* snapshot hand over between DSP path and display thread */
+typedef struct display_mailbox {
+	struct display_mailbox *next;
+	void	(*render)(void *snapshot, void *priv);
+	void	*priv;
+	void	*slot[3];
+	int	write;		/* slot filled by DSP path */
+	int	read;		/* slot rendered by display thread */
+	atomic_int ready;	/* slot of latest snapshot */
+} dispmbox_t;
+
+typedef struct display_wave_snapshot {
+	double	range;
+	int	length;
+	sample_t buffer[MAX_DISPLAY_WIDTH + 1];
+} dispwavsnap_t;
+
 typedef struct display_wave {
 	const char *kanal;
 	int	interval_pos;
 	int	interval_max;
 	int	offset;
-	sample_t buffer[MAX_DISPLAY_WIDTH];
+	dispmbox_t mailbox;
+	dispwavsnap_t *snap;	/* snapshot currently filled */
 } dispwav_t;
 
 enum display_measurements_type {
@@ -36,6 +57,8 @@ typedef struct display_measurements_param {
 	double	value;		/* current value (peak, sum...) */
 	double	value2;		/* max value for min..max range */
 	double	last;		/* last valid value (used for DISPLAY_MEAS_LAST) */
+	double	current;	/* result of last interval */
+	double	hold;		/* result of last second, as displayed */
 	int	value_count;	/* count number of values of one interval */
 	double	value_history[DISPLAY_PARAM_HISTORIES]; /* history of values of last second */
 	double	value2_history[DISPLAY_PARAM_HISTORIES]; /* stores max for min..max range */
@@ -53,7 +76,8 @@ typedef struct display_measurements {
 typedef struct display_iq {
 	int	interval_pos;
 	int	interval_max;
-	float	buffer[MAX_DISPLAY_IQ * 2];
+	dispmbox_t mailbox;
+	float	*buffer;	/* snapshot currently filled */
 } dispiq_t;
 
 #define MAX_DISPLAY_SPECTRUM 1024
@@ -67,14 +91,66 @@ typedef struct display_spectrum_mark {
 typedef struct display_spectrum {
 	int	interval_pos;
 	int	interval_max;
-	double	buffer_I[MAX_DISPLAY_SPECTRUM];
-	double	buffer_Q[MAX_DISPLAY_SPECTRUM];
+	dispmbox_t mailbox;
+	float	*buffer;	/* snapshot currently filled, interleaved I/Q */
 	dispspectrum_mark_t *mark;
 } dispspectrum_t;
 
 #define MAX_HEIGHT_STATUS 32
 
+typedef struct display_status_entry {
+	char	kanal[32];
+	char	type[32];	/* channel type, if given */
+	char	number[32];	/* subscriber, empty for channel entries */
+	char	state[64];
+} dispstatus_t;
+
+#define DISPLAY_PROFILE_INTERVAL	1.0	/* time (in seconds) for each profile interval */
+#define DISPLAY_PROFILE_PER_OCTAVE	4	/* histogram buckets per octave */
+#define DISPLAY_PROFILE_BUCKETS		96	/* 1 us .. 16 s */
+
+enum display_profile_stage {
+	DISPLAY_PROFILE_GET_TOSEND,
+	DISPLAY_PROFILE_SEND,
+	DISPLAY_PROFILE_CONDITION,
+	DISPLAY_PROFILE_AUDIO_WRITE,
+	DISPLAY_PROFILE_AUDIO_READ,
+	DISPLAY_PROFILE_RECEIVE,
+	DISPLAY_PROFILE_STAGES,
+};
+
+typedef struct display_profile_hist {
+	/* current interval */
+	uint32_t count;
+	uint32_t bucket[DISPLAY_PROFILE_BUCKETS];
+	double	sum;		/* seconds */
+	double	max;		/* seconds */
+	/* results of last interval */
+	uint32_t last_count;
+	double	p50, p99, last_max; /* seconds */
+	double	load;		/* fraction of real time */
+} dispprofhist_t;
+
+typedef struct display_profile {
+	struct display_profile *next;
+	const char *kanal;
+	double	interval_start;
+	int	valid;		/* results of one interval are available */
+	dispprofhist_t stage[DISPLAY_PROFILE_STAGES];
+} dispprof_t;
+
+extern int display_suspended;			/* displays are not fed, due to overload */
+extern int display_measurements_suspended;	/* measurements are not updated, due to overload */
+
+void display_mailbox_init(dispmbox_t *mb, size_t size, void (*render)(void *snapshot, void *priv), void *priv);
+void display_mailbox_exit(dispmbox_t *mb);
+void *display_mailbox_slot(dispmbox_t *mb);
+void display_mailbox_post(dispmbox_t *mb);
+int display_thread_start(void);
+void display_thread_stop(void);
+
 void display_wave_init(dispwav_t *disp, int samplerate, const char *kanal);
+void display_wave_exit(dispwav_t *disp);
 void display_wave_on(int on);
 void display_wave(dispwav_t *disp, sample_t *samples, int length, double range);
 
@@ -83,6 +159,17 @@ void display_status_start(void);
 void display_status_channel(const char *kanal, const char *type, const char *state);
 void display_status_subscriber(const char *number, const char *state);
 void display_status_end(void);
+int display_status_entries(const dispstatus_t **entries_p);
+
+void display_profile_init(dispprof_t *prof, const char *kanal);
+void display_profile_exit(dispprof_t *prof);
+const char *display_profile_stage_name(enum display_profile_stage stage);
+double display_profile_time(void);
+void display_profile_update(dispprof_t *prof, enum display_profile_stage stage, double duration);
+void display_profile_tick(dispprof_t *prof, double now);
+void display_profile_on(int on);
+void display_profile(double elapsed);
+extern dispprof_t *prof_head;
 
 void display_measurements_init(dispmeas_t *disp, int samplerate, const char *kanal);
 void display_measurements_exit(dispmeas_t *disp);
@@ -90,8 +177,10 @@ void display_measurements_on(int on);
 dispmeasparam_t *display_measurements_add(dispmeas_t *disp, char *name, char *format, enum display_measurements_type type, enum display_measurements_bar bar, double min, double max, double mark);
 void display_measurements_update(dispmeasparam_t *param, double value, double value2);
 void display_measurements(double elapsed);
+extern dispmeas_t *meas_head;
 
 void display_iq_init(int samplerate);
+void display_iq_exit(void);
 void display_iq_on(int on);
 void display_iq(float *samples, int length);
 
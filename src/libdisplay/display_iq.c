@@ -36,8 +36,11 @@ static uint8_t screen_history[SIZE * 2][MAX_DISPLAY_WIDTH];
 static int iq_on = 0;
 static double db = 80;
 
+static int has_init = 0;
 static dispiq_t disp;
 
+static void display_iq_render(void *snapshot, void *priv);
+
 void display_iq_init(int samplerate)
 {
 	memset(&disp, 0, sizeof(disp));
@@ -46,6 +49,17 @@ void display_iq_init(int samplerate)
 	/* should not happen due to low interval */
 	if (disp.interval_max < MAX_DISPLAY_IQ - 1)
 		disp.interval_max = MAX_DISPLAY_IQ - 1;
+	display_mailbox_init(&disp.mailbox, sizeof(float) * MAX_DISPLAY_IQ * 2, display_iq_render, NULL);
+	disp.buffer = display_mailbox_slot(&disp.mailbox);
+	has_init = 1;
+}
+
+void display_iq_exit(void)
+{
+	if (!has_init)
+		return;
+	display_mailbox_exit(&disp.mailbox);
+	has_init = 0;
 }
 
 void display_iq_on(int on)
@@ -107,7 +121,39 @@ void display_iq(float *samples, int length)
 {
 	int pos, max;
 	float *buffer;
-	int i, j, k;
+	int i;
+
+	if (!iq_on || !has_init || display_suspended)
+		return;
+
+	pos = disp.interval_pos;
+	max = disp.interval_max;
+	buffer = disp.buffer;
+
+	for (i = 0; i < length; i++) {
+		if (pos >= MAX_DISPLAY_IQ) {
+			if (++pos == max)
+				pos = 0;
+			continue;
+		}
+		buffer[pos * 2] = samples[i * 2];
+		buffer[pos * 2 + 1] = samples[i * 2 + 1];
+		pos++;
+		if (pos == MAX_DISPLAY_IQ) {
+			/* hand over snapshot to display thread */
+			display_mailbox_post(&disp.mailbox);
+			buffer = disp.buffer = display_mailbox_slot(&disp.mailbox);
+		}
+	}
+
+	disp.interval_pos = pos;
+}
+
+/* render snapshot of MAX_DISPLAY_IQ samples */
+static void display_iq_render(void *snapshot, void __attribute__((unused)) *priv)
+{
+	float *buffer = snapshot;
+	int j, k;
 	int color = 9; /* default color */
 	int x_center, y_center;
 	double I, Q, L, l, s;
@@ -126,159 +172,141 @@ void display_iq(float *samples, int length)
 	x_center = width >> 1;
 	y_center = (SIZE - 1) >> 1;
 
-	pos = disp.interval_pos;
-	max = disp.interval_max;
-	buffer = disp.buffer;
-
-	for (i = 0; i < length; i++) {
-		if (pos >= MAX_DISPLAY_IQ) {
-			if (++pos == max)
-				pos = 0;
+	memset(&screen, ' ', sizeof(screen));
+	memset(&screen_color, 7, sizeof(screen_color));
+	/* render screen history to screen */
+	for (y = 0; y < SIZE * 2; y++) {
+		for (x = 0; x < width; x++) {
+			v = screen_history[y][x];
+			v -= 8;
+			if (v < 0)
+				v = 0;
+			screen_history[y][x] = v;
+			r = random() & 0x3f;
+			if (r >= v)
+				continue;
+			if (screen[y/2][x] == ':')
+				continue;
+			if (screen[y/2][x] == '.') {
+				if ((y & 1) == 0)
+					screen[y/2][x] = ':';
+				continue;
+			}
+			if (screen[y/2][x] == '\'') {
+				if ((y & 1))
+					screen[y/2][x] = ':';
+				continue;
+			}
+			if ((y & 1) == 0)
+				screen[y/2][x] = '\'';
+			else
+				screen[y/2][x] = '.';
+			screen_color[y/2][x] = 4;
+		}
+	}
+	/* plot current IQ date */
+	for (j = 0; j < MAX_DISPLAY_IQ; j++) {
+		I = buffer[j * 2];
+		Q = buffer[j * 2 + 1];
+		L = I*I + Q*Q;
+		if (iq_on > 1) {
+			/* logarithmic scale */
+			l = sqrt(L);
+			s = log10(l) * 20 + db;
+			if (s < 0)
+				s = 0;
+			I = (I / l) * (s / db);
+			Q = (Q / l) * (s / db);
+		}
+		x = x_center + (int)(I * (double)SIZE + (double)width + 0.5) - width;
+		if (x < 0)
+			continue;
+		if (x > width - 1)
+			continue;
+		if (Q >= 0)
+			y = SIZE - 1 - (int)(Q * (double)SIZE - 0.5);
+		else
+			y = SIZE - (int)(Q * (double)SIZE + 0.5);
+		if (y < 0)
+			continue;
+		if (y > SIZE * 2 - 1)
 			continue;
+		if (screen[y/2][x] == ':' && screen_color[y/2][x] >= 10)
+			goto cont;
+		if (screen[y/2][x] == '.' && screen_color[y/2][x] >= 10) {
+			if ((y & 1) == 0)
+				screen[y/2][x] = ':';
+			goto cont;
 		}
-		buffer[pos * 2] = samples[i * 2];
-		buffer[pos * 2 + 1] = samples[i * 2 + 1];
-		pos++;
-		if (pos == MAX_DISPLAY_IQ) {
-			memset(&screen, ' ', sizeof(screen));
-			memset(&screen_color, 7, sizeof(screen_color));
-			/* render screen history to screen */
-			for (y = 0; y < SIZE * 2; y++) {
-				for (x = 0; x < width; x++) {
-					v = screen_history[y][x];
-					v -= 8;
-					if (v < 0)
-						v = 0;
-					screen_history[y][x] = v;
-					r = random() & 0x3f;
-					if (r >= v)
-						continue;
-					if (screen[y/2][x] == ':')
-						continue;
-					if (screen[y/2][x] == '.') {
-						if ((y & 1) == 0)
-							screen[y/2][x] = ':';
-						continue;
-					}
-					if (screen[y/2][x] == '\'') {
-						if ((y & 1))
-							screen[y/2][x] = ':';
-						continue;
-					}
-					if ((y & 1) == 0)
-						screen[y/2][x] = '\'';
-					else
-						screen[y/2][x] = '.';
-					screen_color[y/2][x] = 4;
-				}
-			}
-			/* plot current IQ date */
-			for (j = 0; j < MAX_DISPLAY_IQ; j++) {
-				I = buffer[j * 2];
-				Q = buffer[j * 2 + 1];
-				L = I*I + Q*Q;
-				if (iq_on > 1) {
-					/* logarithmic scale */
-					l = sqrt(L);
-					s = log10(l) * 20 + db;
-					if (s < 0)
-						s = 0;
-					I = (I / l) * (s / db);
-					Q = (Q / l) * (s / db);
-				}
-				x = x_center + (int)(I * (double)SIZE + (double)width + 0.5) - width;
-				if (x < 0)
-					continue;
-				if (x > width - 1)
-					continue;
-				if (Q >= 0)
-					y = SIZE - 1 - (int)(Q * (double)SIZE - 0.5);
-				else
-					y = SIZE - (int)(Q * (double)SIZE + 0.5);
-				if (y < 0)
-					continue;
-				if (y > SIZE * 2 - 1)
-					continue;
-				if (screen[y/2][x] == ':' && screen_color[y/2][x] >= 10)
-					goto cont;
-				if (screen[y/2][x] == '.' && screen_color[y/2][x] >= 10) {
-					if ((y & 1) == 0)
-						screen[y/2][x] = ':';
-					goto cont;
+		if (screen[y/2][x] == '\'' && screen_color[y/2][x] >= 10) {
+			if ((y & 1))
+				screen[y/2][x] = ':';
+			goto cont;
+		}
+		if ((y & 1) == 0)
+			screen[y/2][x] = '\'';
+		else
+			screen[y/2][x] = '.';
+cont:
+		screen_history[y][x] = 255;
+		/* overdrive:
+		 * red = close to -1..1 or above
+		 * yellow = close to -0.5..0.5 or above
+		 * Note: L is square of vector length,
+		 * so we compare with square values.
+		 */
+		if (L > 0.9 * 0.9)
+			screen_color[y/2][x] = 11;
+		else if (L > 0.45 * 0.45 && screen_color[y/2][x] != 11)
+			screen_color[y/2][x] = 13;
+		else if (screen_color[y/2][x] < 10)
+			screen_color[y/2][x] = 12;
+	}
+	if (iq_on == 1)
+		sprintf(screen[0], "(IQ linear");
+	else
+		sprintf(screen[0], "(IQ log %.0f dB", db);
+	*strchr(screen[0], '\0') = ')';
+	lock_logging();
+	enable_limit_scroll(false);
+	printf("\0337\033[H");
+	for (j = 0; j < SIZE; j++) {
+		for (k = 0; k < width; k++) {
+			if ((j == y_center || k == x_center) && screen[j][k] == ' ') {
+				/* cross */
+				if (color != 4) {
+					color = 4;
+					printf("\033[0;34m");
 				}
-				if (screen[y/2][x] == '\'' && screen_color[y/2][x] >= 10) {
-					if ((y & 1))
-						screen[y/2][x] = ':';
-					goto cont;
+				if (j == y_center) {
+					if (k == x_center)
+						putchar('o');
+					else if (k == x_center - SIZE)
+						putchar('+');
+					else if (k == x_center + SIZE)
+						putchar('+');
+					else
+						putchar('-');
+				} else {
+					if (j == 0 || j == SIZE - 1)
+						putchar('+');
+					else
+						putchar('|');
 				}
-				if ((y & 1) == 0)
-					screen[y/2][x] = '\'';
-				else
-					screen[y/2][x] = '.';
-cont:
-				screen_history[y][x] = 255;
-				/* overdrive:
-				 * red = close to -1..1 or above
-				 * yellow = close to -0.5..0.5 or above
-				 * Note: L is square of vector length,
-				 * so we compare with square values.
-				 */
-				if (L > 0.9 * 0.9)
-					screen_color[y/2][x] = 11;
-				else if (L > 0.45 * 0.45 && screen_color[y/2][x] != 11)
-					screen_color[y/2][x] = 13;
-				else if (screen_color[y/2][x] < 10)
-					screen_color[y/2][x] = 12;
-			}
-			if (iq_on == 1)
-				sprintf(screen[0], "(IQ linear");
-			else
-				sprintf(screen[0], "(IQ log %.0f dB", db);
-			*strchr(screen[0], '\0') = ')';
-			lock_logging();
-			enable_limit_scroll(false);
-			printf("\0337\033[H");
-			for (j = 0; j < SIZE; j++) {
-				for (k = 0; k < width; k++) {
-					if ((j == y_center || k == x_center) && screen[j][k] == ' ') {
-						/* cross */
-						if (color != 4) {
-							color = 4;
-							printf("\033[0;34m");
-						}
-						if (j == y_center) {
-							if (k == x_center)
-								putchar('o');
-							else if (k == x_center - SIZE)
-								putchar('+');
-							else if (k == x_center + SIZE)
-								putchar('+');
-							else
-								putchar('-');
-						} else {
-							if (j == 0 || j == SIZE - 1)
-								putchar('+');
-							else
-								putchar('|');
-						}
-					} else {
-						if (screen_color[j][k] != color) {
-							color = screen_color[j][k];
-							printf("\033[%d;3%dm", color / 10, color % 10);
-						}
-						putchar(screen[j][k]);
-					}
+			} else {
+				if (screen_color[j][k] != color) {
+					color = screen_color[j][k];
+					printf("\033[%d;3%dm", color / 10, color % 10);
 				}
-				printf("\n");
+				putchar(screen[j][k]);
 			}
-			/* reset color and position */
-			printf("\033[0;39m\0338"); fflush(stdout);
-			enable_limit_scroll(true);
-			unlock_logging();
 		}
+		printf("\n");
 	}
-
-	disp.interval_pos = pos;
+	/* reset color and position */
+	printf("\033[0;39m\0338"); fflush(stdout);
+	enable_limit_scroll(true);
+	unlock_logging();
 }
 
 
@@ -92,40 +92,16 @@ static void display_line(int on, int w)
 	lines_total++;
 }
 
-static void print_measurements(int on)
+/* calculate results of interval and of last second for all parameters */
+static void measurements_interval(void)
 {
 	dispmeas_t *disp;
 	dispmeasparam_t *param;
 	int i, j;
-	int width, h;
-	char text[128];
 	double value = 0.0, value2 = 0.0, hold, hold2;
-	int bar_width, bar_left, bar_right, bar_hold, bar_mark;
 
-	get_win_size(&width, &h);
-	if (width > MAX_DISPLAY_WIDTH - 1)
-		width = MAX_DISPLAY_WIDTH - 1;
-
-	/* no display, if bar graph is less than one character */
-	bar_width = width - MAX_NAME_LEN - MAX_UNIT_LEN;
-	if (bar_width < 1)
-		return;
-
-	lines_total = 0;
-	color = -1;
-	lock_logging();
-	enable_limit_scroll(false);
-	printf("\0337\033[H");
 	for (disp = meas_head; disp; disp = disp->next) {
-		memset(line, ' ', width);
-		memset(line_color, 7, width);
-		sprintf(line, "Channel: %s", disp->kanal);
-		*strchr(line, '\0') = ' ';
-		display_line(on, width);
 		for (param = disp->param; param; param = param->next) {
-			memset(line, ' ', width);
-			memset(line_color, 7, width);
-			memset(line_color, 3, MAX_NAME_LEN); /* yellow */
 			switch (param->type) {
 			case DISPLAY_MEAS_LAST:
 				value = param->value;
@@ -206,6 +182,48 @@ static void print_measurements(int on)
 					hold /= j;
 				break;
 			}
+			param->current = value;
+			param->hold = hold;
+		}
+	}
+}
+
+static void print_measurements(int on)
+{
+	dispmeas_t *disp;
+	dispmeasparam_t *param;
+	int i;
+	int width, h;
+	char text[128];
+	double value, hold;
+	int bar_width, bar_left, bar_right, bar_hold, bar_mark;
+
+	get_win_size(&width, &h);
+	if (width > MAX_DISPLAY_WIDTH - 1)
+		width = MAX_DISPLAY_WIDTH - 1;
+
+	/* no display, if bar graph is less than one character */
+	bar_width = width - MAX_NAME_LEN - MAX_UNIT_LEN;
+	if (bar_width < 1)
+		return;
+
+	lines_total = 0;
+	color = -1;
+	lock_logging();
+	enable_limit_scroll(false);
+	printf("\0337\033[H");
+	for (disp = meas_head; disp; disp = disp->next) {
+		memset(line, ' ', width);
+		memset(line_color, 7, width);
+		sprintf(line, "Channel: %s", disp->kanal);
+		*strchr(line, '\0') = ' ';
+		display_line(on, width);
+		for (param = disp->param; param; param = param->next) {
+			memset(line, ' ', width);
+			memset(line_color, 7, width);
+			memset(line_color, 3, MAX_NAME_LEN); /* yellow */
+			value = param->current;
+			hold = param->hold;
 			/* "Deviation ::::::::::............   4.5 KHz" */
 			memcpy(line, param->name, (strlen(param->name) < MAX_NAME_LEN) ? strlen(param->name) : MAX_NAME_LEN);
 			if (isinf(value) || isnan(value)) {
@@ -299,6 +317,8 @@ dispmeasparam_t *display_measurements_add(dispmeas_t *disp, char *name, char *fo
 	param->value = -NAN;
 	param->value2 = -NAN;
 	param->last = -NAN;
+	param->current = -NAN;
+	param->hold = -NAN;
 	for (i = 0; i < DISPLAY_PARAM_HISTORIES; i++)
 		param->value_history[i] = -NAN;
 	param->value_count = 0;
@@ -309,7 +329,7 @@ dispmeasparam_t *display_measurements_add(dispmeas_t *disp, char *name, char *fo
 void display_measurements_update(dispmeasparam_t *param, double value, double value2)
 {
 	/* special case where we do not have an instance of the parameter */
-	if (!param)
+	if (!param || display_measurements_suspended)
 		return;
 
 	if (!has_init) {
@@ -342,11 +362,9 @@ void display_measurements_update(dispmeasparam_t *param, double value, double va
 	}
 }
 
+/* intervals are also calculated without display, so results can be exported */
 void display_measurements(double elapsed)
 {
-	if (!measurements_on)
-		return;
-
 	if (!has_init)
 		return;
 
@@ -356,6 +374,8 @@ void display_measurements(double elapsed)
 		return;
 	time_elapsed = fmod(time_elapsed, DISPLAY_MEAS_INTERVAL);
 
-	print_measurements(1);
+	measurements_interval();
+	if (measurements_on)
+		print_measurements(1);
 }
 
@@ -0,0 +1,226 @@
+/* display profile of sender processing stages
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each duration is counted in a histogram with DISPLAY_PROFILE_PER_OCTAVE
+ * buckets per octave, starting at 1 us. The histograms are evaluated and
+ * cleared after each DISPLAY_PROFILE_INTERVAL by the thread that updates
+ * them, so the display (and other readers) only read the results of the last
+ * interval.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <math.h>
+#include <time.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../libdisplay/display.h"
+
+static int profile_on = 0;
+static double time_elapsed = 0.0;
+static int lines_total = 0;
+
+static const char *stage_names[DISPLAY_PROFILE_STAGES] = {
+	"get_tosend",
+	"sender_send",
+	"emphasis/gain",
+	"audio_write",
+	"audio_read",
+	"sender_receive",
+};
+
+dispprof_t *prof_head = NULL;
+
+void display_profile_init(dispprof_t *prof, const char *kanal)
+{
+	dispprof_t **prof_p;
+
+	memset(prof, 0, sizeof(*prof));
+	prof->kanal = kanal;
+
+	prof_p = &prof_head;
+	while (*prof_p)
+		prof_p = &((*prof_p)->next);
+	*prof_p = prof;
+}
+
+void display_profile_exit(dispprof_t *prof)
+{
+	dispprof_t **prof_p;
+
+	prof_p = &prof_head;
+	while (*prof_p) {
+		if (*prof_p == prof) {
+			*prof_p = prof->next;
+			break;
+		}
+		prof_p = &((*prof_p)->next);
+	}
+}
+
+const char *display_profile_stage_name(enum display_profile_stage stage)
+{
+	return stage_names[stage];
+}
+
+/* get time in seconds, monotonic */
+double display_profile_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void display_profile_update(dispprof_t *prof, enum display_profile_stage stage, double duration)
+{
+	dispprofhist_t *hist = &prof->stage[stage];
+	double us = duration * 1e6;
+	int i;
+
+	i = (us > 1.0) ? (int)(log2(us) * DISPLAY_PROFILE_PER_OCTAVE) : 0;
+	if (i >= DISPLAY_PROFILE_BUCKETS)
+		i = DISPLAY_PROFILE_BUCKETS - 1;
+	hist->bucket[i]++;
+	hist->count++;
+	hist->sum += duration;
+	if (duration > hist->max)
+		hist->max = duration;
+}
+
+/* upper edge of the bucket that contains the given fraction of all durations */
+static double percentile(dispprofhist_t *hist, double fraction)
+{
+	uint32_t sum = 0, limit;
+	int i;
+
+	limit = (uint32_t)ceil((double)hist->count * fraction);
+	for (i = 0; i < DISPLAY_PROFILE_BUCKETS - 1; i++) {
+		sum += hist->bucket[i];
+		if (sum >= limit)
+			break;
+	}
+	return pow(2.0, (double)(i + 1) / DISPLAY_PROFILE_PER_OCTAVE) / 1e6;
+}
+
+/* evaluate and clear histograms, if interval has elapsed */
+void display_profile_tick(dispprof_t *prof, double now)
+{
+	dispprofhist_t *hist;
+	double interval;
+	int s;
+
+	if (!prof->interval_start)
+		prof->interval_start = now;
+	interval = now - prof->interval_start;
+	if (interval < DISPLAY_PROFILE_INTERVAL)
+		return;
+	prof->interval_start = now;
+
+	for (s = 0; s < DISPLAY_PROFILE_STAGES; s++) {
+		hist = &prof->stage[s];
+		if (hist->count) {
+			hist->p50 = percentile(hist, 0.50);
+			hist->p99 = percentile(hist, 0.99);
+			if (hist->p50 > hist->max)
+				hist->p50 = hist->max;
+			if (hist->p99 > hist->max)
+				hist->p99 = hist->max;
+			hist->last_max = hist->max;
+			hist->load = hist->sum / interval;
+		} else
+			hist->p50 = hist->p99 = hist->last_max = hist->load = 0.0;
+		hist->last_count = hist->count;
+		hist->count = 0;
+		hist->sum = 0.0;
+		hist->max = 0.0;
+		memset(hist->bucket, 0, sizeof(hist->bucket));
+	}
+	prof->valid = 1;
+}
+
+static void print_profile(int on)
+{
+	dispprof_t *prof;
+	dispprofhist_t *hist;
+	int w, h, s;
+	char line[MAX_DISPLAY_WIDTH];
+
+	get_win_size(&w, &h);
+	if (w > MAX_DISPLAY_WIDTH - 1)
+		w = MAX_DISPLAY_WIDTH - 1;
+
+	lines_total = 0;
+	lock_logging();
+	enable_limit_scroll(false);
+	printf("\0337\033[H");
+	for (prof = prof_head; prof; prof = prof->next) {
+		if (lines_total >= h - 1)
+			break;
+		snprintf(line, sizeof(line), "Channel: %-8s        p50 (us)   p99 (us)   max (us)   calls/s    load", prof->kanal);
+		printf("\033[1;33m%-*.*s\n", w, w, (on) ? line : "");
+		lines_total++;
+		for (s = 0; s < DISPLAY_PROFILE_STAGES; s++) {
+			hist = &prof->stage[s];
+			if (!hist->last_count)
+				continue;
+			if (lines_total >= h - 1)
+				break;
+			snprintf(line, sizeof(line), "  %-22s%10.1f %10.1f %10.1f %10u %6.2f%%", stage_names[s], hist->p50 * 1e6, hist->p99 * 1e6, hist->last_max * 1e6, hist->last_count, hist->load * 100.0);
+			printf("\033[%sm%-*.*s\n", (hist->load > 0.5) ? "1;31" : "0;37", w, w, (on) ? line : "");
+			lines_total++;
+		}
+	}
+	/* reset color and position */
+	printf("\033[0;39m\0338"); fflush(stdout);
+	enable_limit_scroll(true);
+	unlock_logging();
+	/* Set new limit. */
+	logging_limit_scroll_top(lines_total);
+}
+
+void display_profile_on(int on)
+{
+	if (profile_on)
+		print_profile(0);
+
+	if (on < 0)
+		profile_on = 1 - profile_on;
+	else
+		profile_on = on;
+
+	logging_limit_scroll_top(0);
+}
+
+void display_profile(double elapsed)
+{
+	if (!profile_on)
+		return;
+
+	/* count and check if we need to display this time */
+	time_elapsed += elapsed;
+	if (time_elapsed < DISPLAY_PROFILE_INTERVAL)
+		return;
+	time_elapsed = fmod(time_elapsed, DISPLAY_PROFILE_INTERVAL);
+
+	print_profile(1);
+}
@@ -39,6 +39,9 @@ static double db = 120;
 static double center_frequency, frequency_range;
 
 static dispspectrum_t disp;
+static fft_plan_t plan;
+
+static void display_spectrum_render(void *snapshot, void *priv);
 
 void display_spectrum_init(int samplerate, double _center_frequency)
 {
@@ -48,6 +51,8 @@ void display_spectrum_init(int samplerate, double _center_frequency)
 	if (disp.interval_max < MAX_DISPLAY_SPECTRUM - 1)
 		disp.interval_max = MAX_DISPLAY_SPECTRUM - 1;
 	memset(buffer_delay, 0, sizeof(buffer_delay));
+	display_mailbox_init(&disp.mailbox, sizeof(float) * MAX_DISPLAY_SPECTRUM * 2, display_spectrum_render, NULL);
+	disp.buffer = display_mailbox_slot(&disp.mailbox);
 
 	center_frequency = _center_frequency;
 	frequency_range = (double)samplerate;
@@ -80,12 +85,18 @@ void display_spectrum_exit(void)
 {
 	dispspectrum_mark_t *mark = disp.mark, *temp;
 
+	if (!has_init)
+		return;
+
+	display_mailbox_exit(&disp.mailbox);
+
 	while (mark) {
 		temp = mark;
 		mark = mark->next;
 		free(temp);
 	}
 	disp.mark = NULL;
+	fft_plan_exit(&plan);
 	has_init = 0;
 }
 
@@ -130,14 +141,47 @@ void display_spectrum_on(int on)
  *
  */
 void display_spectrum(float *samples, int length)
+{
+	int pos, max;
+	float *buffer;
+	int i;
+
+	if (!spectrum_on || !has_init || display_suspended)
+		return;
+
+	pos = disp.interval_pos;
+	max = disp.interval_max;
+	buffer = disp.buffer;
+
+	/* collect maximum FFT size, the FFT size is selected by the display thread */
+	for (i = 0; i < length; i++) {
+		if (pos >= MAX_DISPLAY_SPECTRUM) {
+			if (++pos == max)
+				pos = 0;
+			continue;
+		}
+		buffer[pos * 2] = samples[i * 2];
+		buffer[pos * 2 + 1] = samples[i * 2 + 1];
+		pos++;
+		if (pos == MAX_DISPLAY_SPECTRUM) {
+			/* hand over snapshot to display thread */
+			display_mailbox_post(&disp.mailbox);
+			buffer = disp.buffer = display_mailbox_slot(&disp.mailbox);
+		}
+	}
+
+	disp.interval_pos = pos;
+}
+
+/* render snapshot of MAX_DISPLAY_SPECTRUM samples */
+static void display_spectrum_render(void *snapshot, void __attribute__((unused)) *priv)
 {
 	dispspectrum_mark_t *mark;
 	char print_channel[32], print_frequency[32];
 	int width, h;
-	int pos, max;
-	double *buffer_I, *buffer_Q;
+	float *buffer = snapshot;
 	int color = 9; /* default color */
-	int i, j, k, o;
+	int j, k, o;
 	double I, Q, v;
 	int s, e, l, n;
 
@@ -165,251 +209,239 @@ void display_spectrum(float *samples, int length)
 
 	int hold[fft_size], delay[fft_size], current[fft_size];
 
-	pos = disp.interval_pos;
-	max = disp.interval_max;
-	buffer_I = disp.buffer_I;
-	buffer_Q = disp.buffer_Q;
+	/* create plan, if window size has changed */
+	if (plan.n != fft_size) {
+		fft_plan_exit(&plan);
+		if (fft_plan_init(&plan, fft_taps))
+			return;
+	}
 
-	for (i = 0; i < length; i++) {
-		if (pos >= fft_size) {
-			if (++pos == max)
-				pos = 0;
-			continue;
+	fft_plan_complex(&plan, 1, buffer);
+	k = 0;
+	for (j = 0; j < fft_size; j++) {
+		/* scale result vertically */
+		I = buffer[((j + fft_size / 2) % fft_size) * 2];
+		Q = buffer[((j + fft_size / 2) % fft_size) * 2 + 1];
+		v = sqrt(I*I + Q*Q) / (double)fft_size;
+		v = log10(v) * 20 + db;
+		if (v < 0)
+			v = 0;
+		v /= db;
+		/* delayed */
+		buffer_delay[j] -= DISPLAY_INTERVAL / 10.0;
+		if (v > buffer_delay[j])
+			buffer_delay[j] = v;
+		delay[j] = (double)(HEIGHT * 2 - 1) * (1.0 - buffer_delay[j]);
+		if (delay[j] < 0)
+			delay[j] = 0;
+		if (delay[j] >= (HEIGHT * 2))
+			delay[j] = (HEIGHT * 2) - 1;
+		/* hold */
+		if (spectrum_on == 2) {
+			if (v > buffer_hold[j])
+				buffer_hold[j] = v;
+			hold[j] = (double)(HEIGHT * 2 - 1) * (1.0 - buffer_hold[j]);
+			if (hold[j] < 0)
+				hold[j] = 0;
+			if (hold[j] >= (HEIGHT * 2))
+				hold[j] = (HEIGHT * 2) - 1;
 		}
-		buffer_I[pos] = samples[i * 2];
-		buffer_Q[pos] = samples[i * 2 + 1];
-		pos++;
-		if (pos == fft_size) {
-			fft_process(1, fft_taps, buffer_I, buffer_Q);
-			k = 0;
-			for (j = 0; j < fft_size; j++) {
-				/* scale result vertically */
-				I = buffer_I[(j + fft_size / 2) % fft_size];
-				Q = buffer_Q[(j + fft_size / 2) % fft_size];
-				v = sqrt(I*I + Q*Q);
-				v = log10(v) * 20 + db;
-				if (v < 0)
-					v = 0;
-				v /= db;
-				/* delayed */
-				buffer_delay[j] -= DISPLAY_INTERVAL / 10.0;
-				if (v > buffer_delay[j])
-					buffer_delay[j] = v;
-				delay[j] = (double)(HEIGHT * 2 - 1) * (1.0 - buffer_delay[j]);
-				if (delay[j] < 0)
-					delay[j] = 0;
-				if (delay[j] >= (HEIGHT * 2))
-					delay[j] = (HEIGHT * 2) - 1;
-				/* hold */
-				if (spectrum_on == 2) {
-					if (v > buffer_hold[j])
-						buffer_hold[j] = v;
-					hold[j] = (double)(HEIGHT * 2 - 1) * (1.0 - buffer_hold[j]);
-					if (hold[j] < 0)
-						hold[j] = 0;
-					if (hold[j] >= (HEIGHT * 2))
-						hold[j] = (HEIGHT * 2) - 1;
-				}
-				/* current */
-				current[j] = (double)(HEIGHT * 2 - 1) * (1.0 - v);
-				if (current[j] < 0)
-					current[j] = 0;
-				if (current[j] >= (HEIGHT * 2))
-					current[j] = (HEIGHT * 2) - 1;
+		/* current */
+		current[j] = (double)(HEIGHT * 2 - 1) * (1.0 - v);
+		if (current[j] < 0)
+			current[j] = 0;
+		if (current[j] >= (HEIGHT * 2))
+			current[j] = (HEIGHT * 2) - 1;
+	}
+	/* plot scaled buffer */
+	memset(&screen, ' ', sizeof(screen));
+	memset(&screen_color, 7, sizeof(screen_color)); /* all white */
+	sprintf(screen[0], "(spectrum log %.0f dB%s", db, (spectrum_on == 2) ? " HOLD" : "");
+	*strchr(screen[0], '\0') = ')';
+	for (j = 2; j < HEIGHT; j += 2) {
+		memset(screen_color[j], 4, 7); /* blue */
+		sprintf(screen[j], "%4.0f dB", -(double)(j+1) * db / (double)(HEIGHT - 1));
+		screen[j][7] = ' ';
+	}
+	o = (width - fft_size) / 2; /* offset from left border */
+	for (j = 0; j < fft_size; j++) {
+		/* show current spectrum in yellow */
+		s = l = n = current[j];
+			/* get last and next value */
+		if (j > 0)
+			l = (current[j - 1] + s) / 2;
+		if (j < fft_size - 1)
+			n = (current[j + 1] + s) / 2;
+		if (s > l && s > n) {
+			/* current value is a minimum */
+			e = s;
+			s = (l < n) ? (l + 1) : (n + 1);
+		} else if (s < l && s < n) {
+			/* current value is a maximum */
+			e = (l > n) ? l : n;
+		} else if (l < n) {
+			/* last value is higher, next value is lower */
+			s = l + 1;
+			e = n;
+		} else if (l > n) {
+			/* last value is lower, next value is higher */
+			s = n + 1;
+			e = l;
+		} else {
+			/* current, last and next values are equal */
+			e = s;
+		}
+		if (s == e) {
+			if ((s & 1) == 0)
+				screen[s >> 1][j + o] = '\'';
+			else
+				screen[s >> 1][j + o] = '.';
+			screen_color[s >> 1][j + o] = 13;
+		} else {
+			if ((s & 1) == 0)
+				screen[s >> 1][j + o] = '|';
+			else
+				screen[s >> 1][j + o] = '.';
+			screen_color[s >> 1][j + o] = 13;
+			if ((e & 1) == 0)
+				screen[e >> 1][j + o] = '\'';
+			else
+				screen[e >> 1][j + o] = '|';
+			screen_color[e >> 1][j + o] = 13;
+			for (k = (s >> 1) + 1; k < (e >> 1); k++) {
+				screen[k][j + o] = '|';
+				screen_color[k][j + o] = 13;
 			}
-			/* plot scaled buffer */
-			memset(&screen, ' ', sizeof(screen));
-			memset(&screen_color, 7, sizeof(screen_color)); /* all white */
-			sprintf(screen[0], "(spectrum log %.0f dB%s", db, (spectrum_on == 2) ? " HOLD" : "");
-			*strchr(screen[0], '\0') = ')';
-			for (j = 2; j < HEIGHT; j += 2) {
-				memset(screen_color[j], 4, 7); /* blue */
-				sprintf(screen[j], "%4.0f dB", -(double)(j+1) * db / (double)(HEIGHT - 1));
-				screen[j][7] = ' ';
+		}
+		/* show delayed spectrum in blue */
+		e = s;
+		s = delay[j];
+		if ((s >> 1) < (e >> 1)) {
+			if ((s & 1) == 0)
+				screen[s >> 1][j + o] = '|';
+			else
+				screen[s >> 1][j + o] = '.';
+			screen_color[s >> 1][j + o] = 4;
+			for (k = (s >> 1) + 1; k < (e >> 1); k++) {
+				screen[k][j + o] = '|';
+				screen_color[k][j + o] = 4;
 			}
-			o = (width - fft_size) / 2; /* offset from left border */
-			for (j = 0; j < fft_size; j++) {
-				/* show current spectrum in yellow */
-				s = l = n = current[j];
-					/* get last and next value */
-				if (j > 0)
-					l = (current[j - 1] + s) / 2;
-				if (j < fft_size - 1)
-					n = (current[j + 1] + s) / 2;
-				if (s > l && s > n) {
-					/* current value is a minimum */
-					e = s;
-					s = (l < n) ? (l + 1) : (n + 1);
-				} else if (s < l && s < n) {
-					/* current value is a maximum */
-					e = (l > n) ? l : n;
-				} else if (l < n) {
-					/* last value is higher, next value is lower */
-					s = l + 1;
-					e = n;
-				} else if (l > n) {
-					/* last value is lower, next value is higher */
-					s = n + 1;
-					e = l;
-				} else {
-					/* current, last and next values are equal */
-					e = s;
-				}
-				if (s == e) {
-					if ((s & 1) == 0)
-						screen[s >> 1][j + o] = '\'';
-					else
-						screen[s >> 1][j + o] = '.';
-					screen_color[s >> 1][j + o] = 13;
-				} else {
-					if ((s & 1) == 0)
-						screen[s >> 1][j + o] = '|';
-					else
-						screen[s >> 1][j + o] = '.';
-					screen_color[s >> 1][j + o] = 13;
-					if ((e & 1) == 0)
-						screen[e >> 1][j + o] = '\'';
-					else
-						screen[e >> 1][j + o] = '|';
-					screen_color[e >> 1][j + o] = 13;
-					for (k = (s >> 1) + 1; k < (e >> 1); k++) {
-						screen[k][j + o] = '|';
-						screen_color[k][j + o] = 13;
-					}
-				}
-				/* show delayed spectrum in blue */
+		}
+		if (spectrum_on == 2) {
+			/* show hold spectrum in white */
+			s = l = n = hold[j];
+				/* get last and next value */
+			if (j > 0)
+				l = (hold[j - 1] + s) / 2;
+			if (j < fft_size - 1)
+				n = (hold[j + 1] + s) / 2;
+			if (s > l && s > n) {
+				/* hold value is a minimum */
+				e = s;
+				s = (l < n) ? (l + 1) : (n + 1);
+			} else if (s < l && s < n) {
+				/* hold value is a maximum */
+				e = (l > n) ? l : n;
+			} else if (l < n) {
+				/* last value is higher, next value is lower */
+				s = l + 1;
+				e = n;
+			} else if (l > n) {
+				/* last value is lower, next value is higher */
+				s = n + 1;
+				e = l;
+			} else {
+				/* hold, last and next values are equal */
 				e = s;
-				s = delay[j];
-				if ((s >> 1) < (e >> 1)) {
-					if ((s & 1) == 0)
-						screen[s >> 1][j + o] = '|';
-					else
-						screen[s >> 1][j + o] = '.';
-					screen_color[s >> 1][j + o] = 4;
-					for (k = (s >> 1) + 1; k < (e >> 1); k++) {
-						screen[k][j + o] = '|';
-						screen_color[k][j + o] = 4;
-					}
-				}
-				if (spectrum_on == 2) {
-					/* show hold spectrum in white */
-					s = l = n = hold[j];
-						/* get last and next value */
-					if (j > 0)
-						l = (hold[j - 1] + s) / 2;
-					if (j < fft_size - 1)
-						n = (hold[j + 1] + s) / 2;
-					if (s > l && s > n) {
-						/* hold value is a minimum */
-						e = s;
-						s = (l < n) ? (l + 1) : (n + 1);
-					} else if (s < l && s < n) {
-						/* hold value is a maximum */
-						e = (l > n) ? l : n;
-					} else if (l < n) {
-						/* last value is higher, next value is lower */
-						s = l + 1;
-						e = n;
-					} else if (l > n) {
-						/* last value is lower, next value is higher */
-						s = n + 1;
-						e = l;
-					} else {
-						/* hold, last and next values are equal */
-						e = s;
-					}
-					if (s == e) {
-						if ((s & 1) == 0)
-							screen[s >> 1][j + o] = '\'';
-						else
-							screen[s >> 1][j + o] = '.';
-						screen_color[s >> 1][j + o] = 17;
-					} else {
-						if ((s & 1) == 0)
-							screen[s >> 1][j + o] = '|';
-						else
-							screen[s >> 1][j + o] = '.';
-						screen_color[s >> 1][j + o] = 17;
-						if ((e & 1) == 0)
-							screen[e >> 1][j + o] = '\'';
-						else
-							screen[e >> 1][j + o] = '|';
-						screen_color[e >> 1][j + o] = 17;
-						for (k = (s >> 1) + 1; k < (e >> 1); k++) {
-							screen[k][j + o] = '|';
-							screen_color[k][j + o] = 17;
-						}
-					}
-				}
 			}
-			/* add channel positions in spectrum */
-			for (mark = disp.mark; mark; mark = mark->next) {
-				j = (int)((mark->frequency - center_frequency) / frequency_range * (double) fft_size + width / 2 + 0.5);
-				if (j < 0 || j >= width) /* check out-of-range, should not happen */
-					continue;
-				for (k = 0; k < HEIGHT; k++) {
-					/* skip yellow/white graph */
-					if (screen_color[k][j] == 13 || screen_color[k][j] == 17)
-						continue;
-					screen[k][j] = ':';
-					screen_color[k][j] = 12;
-				}
-				sprintf(print_channel, "Ch(%s)", mark->kanal);
-				for (o = 0; o < (int)strlen(print_channel); o++) {
-					s = j - strlen(print_channel) + o;
-					if (s >= 0 && s < width) {
-						screen[HEIGHT - 1][s] = print_channel[o];
-						screen_color[HEIGHT - 1][s] = 7;
-					}
-				}
-				if (fmod(mark->frequency, 1000.0))
-					sprintf(print_frequency, "%.4f", mark->frequency / 1e6);
+			if (s == e) {
+				if ((s & 1) == 0)
+					screen[s >> 1][j + o] = '\'';
+				else
+					screen[s >> 1][j + o] = '.';
+				screen_color[s >> 1][j + o] = 17;
+			} else {
+				if ((s & 1) == 0)
+					screen[s >> 1][j + o] = '|';
 				else
-					sprintf(print_frequency, "%.3f", mark->frequency / 1e6);
-				for (o = 0; o < (int)strlen(print_frequency); o++) {
-					s = j + o + 1;
-					if (s >= 0 && s < width) {
-						screen[HEIGHT - 1][s] = print_frequency[o];
-						screen_color[HEIGHT - 1][s] = 7;
-					}
+					screen[s >> 1][j + o] = '.';
+				screen_color[s >> 1][j + o] = 17;
+				if ((e & 1) == 0)
+					screen[e >> 1][j + o] = '\'';
+				else
+					screen[e >> 1][j + o] = '|';
+				screen_color[e >> 1][j + o] = 17;
+				for (k = (s >> 1) + 1; k < (e >> 1); k++) {
+					screen[k][j + o] = '|';
+					screen_color[k][j + o] = 17;
 				}
 			}
-			/* add center (DC line) to spectrum */
-			j = width / 2 + 0.5;
-			if (j < 1 || j >= width-1) /* check out-of-range, should not happen */
+		}
+	}
+	/* add channel positions in spectrum */
+	for (mark = disp.mark; mark; mark = mark->next) {
+		j = (int)((mark->frequency - center_frequency) / frequency_range * (double) fft_size + width / 2 + 0.5);
+		if (j < 0 || j >= width) /* check out-of-range, should not happen */
+			continue;
+		for (k = 0; k < HEIGHT; k++) {
+			/* skip yellow/white graph */
+			if (screen_color[k][j] == 13 || screen_color[k][j] == 17)
 				continue;
-			for (k = 0; k < HEIGHT; k++) {
-				/* skip green/yellow/white graph */
-				if (screen_color[k][j] == 13 || screen_color[k][j] == 17 || screen_color[k][j] == 12)
-					continue;
-				screen[k][j] = '.';
-				screen_color[k][j] = 7;
+			screen[k][j] = ':';
+			screen_color[k][j] = 12;
+		}
+		sprintf(print_channel, "Ch(%s)", mark->kanal);
+		for (o = 0; o < (int)strlen(print_channel); o++) {
+			s = j - strlen(print_channel) + o;
+			if (s >= 0 && s < width) {
+				screen[HEIGHT - 1][s] = print_channel[o];
+				screen_color[HEIGHT - 1][s] = 7;
 			}
-			screen[0][j-1] = 'D';
-			screen[0][j+1] = 'C';
-			screen_color[0][j-1] = 7;
-			screen_color[0][j+1] = 7;
-			/* display buffer */
-			lock_logging();
-			enable_limit_scroll(false);
-			printf("\0337\033[H");
-			for (j = 0; j < HEIGHT; j++) {
-				for (k = 0; k < width; k++) {
-					if (screen_color[j][k] != color) {
-						color = screen_color[j][k];
-						printf("\033[%d;3%dm", color / 10, color % 10);
-					}
-					putchar(screen[j][k]);
-				}
-				printf("\n");
+		}
+		if (fmod(mark->frequency, 1000.0))
+			sprintf(print_frequency, "%.4f", mark->frequency / 1e6);
+		else
+			sprintf(print_frequency, "%.3f", mark->frequency / 1e6);
+		for (o = 0; o < (int)strlen(print_frequency); o++) {
+			s = j + o + 1;
+			if (s >= 0 && s < width) {
+				screen[HEIGHT - 1][s] = print_frequency[o];
+				screen_color[HEIGHT - 1][s] = 7;
 			}
-			/* reset color and position */
-			printf("\033[0;39m\0338"); fflush(stdout);
-			enable_limit_scroll(true);
-			unlock_logging();
 		}
 	}
-
-	disp.interval_pos = pos;
+	/* add center (DC line) to spectrum */
+	j = width / 2 + 0.5;
+	if (j >= 1 && j < width-1) { /* check out-of-range, should not happen */
+		for (k = 0; k < HEIGHT; k++) {
+			/* skip green/yellow/white graph */
+			if (screen_color[k][j] == 13 || screen_color[k][j] == 17 || screen_color[k][j] == 12)
+				continue;
+			screen[k][j] = '.';
+			screen_color[k][j] = 7;
+		}
+		screen[0][j-1] = 'D';
+		screen[0][j+1] = 'C';
+		screen_color[0][j-1] = 7;
+		screen_color[0][j+1] = 7;
+	}
+	/* display buffer */
+	lock_logging();
+	enable_limit_scroll(false);
+	printf("\0337\033[H");
+	for (j = 0; j < HEIGHT; j++) {
+		for (k = 0; k < width; k++) {
+			if (screen_color[j][k] != color) {
+				color = screen_color[j][k];
+				printf("\033[%d;3%dm", color / 10, color % 10);
+			}
+			putchar(screen[j][k]);
+		}
+		printf("\n");
+	}
+	/* reset color and position */
+	printf("\033[0;39m\0338"); fflush(stdout);
+	enable_limit_scroll(true);
+	unlock_logging();
 }
 
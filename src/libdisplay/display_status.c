@@ -31,6 +31,31 @@ static int line_count = 0;
 static int lines_total = 0;
 static char screen[MAX_HEIGHT_STATUS][MAX_DISPLAY_WIDTH];
 
+/* status as entries, for export without terminal */
+static dispstatus_t entries[MAX_HEIGHT_STATUS], entries_new[MAX_HEIGHT_STATUS];
+static int entries_num = 0, entries_new_num = 0;
+static const char *entries_kanal = "";
+
+static void add_entry(const char *kanal, const char *type, const char *number, const char *state)
+{
+	dispstatus_t *entry;
+
+	if (entries_new_num == MAX_HEIGHT_STATUS)
+		return;
+	entry = &entries_new[entries_new_num++];
+	snprintf(entry->kanal, sizeof(entry->kanal), "%s", kanal);
+	snprintf(entry->type, sizeof(entry->type), "%s", (type) ? : "");
+	snprintf(entry->number, sizeof(entry->number), "%s", (number) ? : "");
+	snprintf(entry->state, sizeof(entry->state), "%s", (state) ? : "");
+}
+
+/* get entries of last complete status */
+int display_status_entries(const dispstatus_t **entries_p)
+{
+	*entries_p = entries;
+	return entries_num;
+}
+
 static void print_status(int on)
 {
 	int i, j;
@@ -91,12 +116,17 @@ void display_status_start(void)
 	memset(screen[0], '-', sizeof(screen[0]));
 	memcpy(screen[0] + 4, "Channel Status", 14);
 	line_count = 1;
+	entries_new_num = 0;
+	entries_kanal = "";
 }
 
 void display_status_channel(const char *kanal, const char *type, const char *state)
 {
 	char line[MAX_DISPLAY_WIDTH];
 
+	add_entry(kanal, type, NULL, state);
+	entries_kanal = kanal;
+
 	/* add empty line after previous channel+subscriber */
 	if (line_count > 1 && line_count < MAX_HEIGHT_STATUS)
 		line_count++;
@@ -116,6 +146,8 @@ void display_status_subscriber(const char *number, const char *state)
 {
 	char line[MAX_DISPLAY_WIDTH];
 
+	add_entry(entries_kanal, NULL, number, state);
+
 	if (line_count == MAX_HEIGHT_STATUS)
 		return;
 
@@ -129,6 +161,9 @@ void display_status_subscriber(const char *number, const char *state)
 
 void display_status_end(void)
 {
+	memcpy(entries, entries_new, sizeof(*entries) * entries_new_num);
+	entries_num = entries_new_num;
+
 	if (line_count < MAX_HEIGHT_STATUS) {
 		memset(screen[line_count], '-', sizeof(screen[line_count]));
 		line_count++;
@@ -0,0 +1,171 @@
+/* display thread, renders snapshots of the DSP path
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each display owns a mailbox of three snapshot slots (triple buffer). The
+ * DSP path fills the write slot and posts it by swapping it with the ready
+ * slot. The display thread swaps the ready slot with the read slot, if a new
+ * snapshot was posted, and renders it at its own pace. Neither side blocks.
+ * If the display thread is not running, a posted snapshot is rendered at
+ * once, as it was done before.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
+#include "../libdisplay/display.h"
+
+#define MAILBOX_NEW	4	/* flag in 'ready': snapshot is not rendered yet */
+
+int display_suspended = 0;
+int display_measurements_suspended = 0;
+
+static pthread_mutex_t mailbox_mutex = PTHREAD_MUTEX_INITIALIZER;
+static dispmbox_t *mailbox_head = NULL;
+static atomic_int display_thread_running;
+static pthread_t display_thread_tid;
+
+void display_mailbox_init(dispmbox_t *mb, size_t size, void (*render)(void *snapshot, void *priv), void *priv)
+{
+	dispmbox_t **mb_p;
+	int i;
+
+	memset(mb, 0, sizeof(*mb));
+	for (i = 0; i < 3; i++) {
+		mb->slot[i] = calloc(1, size);
+		if (!mb->slot[i]) {
+			fprintf(stderr, "no mem!");
+			abort();
+		}
+	}
+	mb->write = 0;
+	atomic_init(&mb->ready, 1);
+	mb->read = 2;
+	mb->render = render;
+	mb->priv = priv;
+
+	pthread_mutex_lock(&mailbox_mutex);
+	mb_p = &mailbox_head;
+	while (*mb_p)
+		mb_p = &((*mb_p)->next);
+	*mb_p = mb;
+	pthread_mutex_unlock(&mailbox_mutex);
+}
+
+void display_mailbox_exit(dispmbox_t *mb)
+{
+	dispmbox_t **mb_p;
+	int i;
+
+	/* after unlinking, the display thread cannot render it anymore */
+	pthread_mutex_lock(&mailbox_mutex);
+	mb_p = &mailbox_head;
+	while (*mb_p) {
+		if (*mb_p == mb) {
+			*mb_p = mb->next;
+			break;
+		}
+		mb_p = &((*mb_p)->next);
+	}
+	pthread_mutex_unlock(&mailbox_mutex);
+
+	for (i = 0; i < 3; i++) {
+		free(mb->slot[i]);
+		mb->slot[i] = NULL;
+	}
+}
+
+/* get slot to be filled by DSP path */
+void *display_mailbox_slot(dispmbox_t *mb)
+{
+	return mb->slot[mb->write];
+}
+
+/* render latest snapshot, if there is one */
+static void mailbox_render(dispmbox_t *mb)
+{
+	if (!(atomic_load_explicit(&mb->ready, memory_order_relaxed) & MAILBOX_NEW))
+		return;
+	mb->read = atomic_exchange_explicit(&mb->ready, mb->read, memory_order_acq_rel) & ~MAILBOX_NEW;
+	mb->render(mb->slot[mb->read], mb->priv);
+}
+
+/* hand over filled slot, an older snapshot that is not rendered yet is replaced */
+void display_mailbox_post(dispmbox_t *mb)
+{
+	mb->write = atomic_exchange_explicit(&mb->ready, mb->write | MAILBOX_NEW, memory_order_acq_rel) & ~MAILBOX_NEW;
+
+	if (!atomic_load_explicit(&display_thread_running, memory_order_relaxed))
+		mailbox_render(mb);
+}
+
+static void *display_thread(void __attribute__((unused)) *arg)
+{
+	struct sched_param schedp;
+	dispmbox_t *mb;
+
+	/* never compete with real time DSP threads */
+	memset(&schedp, 0, sizeof(schedp));
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &schedp);
+	thread_prio_apply(THREAD_DISPLAY);
+
+	while (atomic_load(&display_thread_running)) {
+		pthread_mutex_lock(&mailbox_mutex);
+		for (mb = mailbox_head; mb; mb = mb->next)
+			mailbox_render(mb);
+		pthread_mutex_unlock(&mailbox_mutex);
+		usleep(DISPLAY_INTERVAL * 1000000.0 / 2);
+	}
+
+	return NULL;
+}
+
+int display_thread_start(void)
+{
+	int rc;
+
+	if (atomic_load(&display_thread_running))
+		return 0;
+
+	atomic_store(&display_thread_running, 1);
+	rc = pthread_create(&display_thread_tid, NULL, display_thread, NULL);
+	if (rc) {
+		atomic_store(&display_thread_running, 0);
+		LOGP(DDSP, LOGL_ERROR, "Failed to create display thread, rendering in DSP path.\n");
+		return -rc;
+	}
+
+	return 0;
+}
+
+void display_thread_stop(void)
+{
+	if (!atomic_load(&display_thread_running))
+		return;
+
+	atomic_store(&display_thread_running, 0);
+	pthread_join(display_thread_tid, NULL);
+}
@@ -32,6 +32,9 @@
 static int num_sender = 0;
 static char screen[HEIGHT][MAX_DISPLAY_WIDTH];
 static int wave_on = 0;
+static atomic_int wave_width = 80; /* width of terminal, updated by display thread */
+
+static void display_wave_render(void *snapshot, void *priv);
 
 void display_wave_init(dispwav_t *disp, int samplerate, const char *kanal)
 {
@@ -39,6 +42,14 @@ void display_wave_init(dispwav_t *disp, int samplerate, const char *kanal)
 	disp->offset = (num_sender++) * HEIGHT;
 	disp->interval_max = (double)samplerate * DISPLAY_INTERVAL + 0.5;
 	disp->kanal = kanal;
+	display_mailbox_init(&disp->mailbox, sizeof(*disp->snap), display_wave_render, disp);
+	disp->snap = display_mailbox_slot(&disp->mailbox);
+}
+
+void display_wave_exit(dispwav_t *disp)
+{
+	display_mailbox_exit(&disp->mailbox);
+	disp->snap = NULL;
 }
 
 void display_wave_on(int on)
@@ -49,6 +60,7 @@ void display_wave_on(int on)
 	get_win_size(&w, &h);
 	if (w > MAX_DISPLAY_WIDTH - 1)
 		w = MAX_DISPLAY_WIDTH - 1;
+	atomic_store_explicit(&wave_width, w, memory_order_relaxed);
 
 	if (wave_on) {
 		memset(&screen, ' ', sizeof(screen));
@@ -95,8 +107,46 @@ void display_wave_on(int on)
 void display_wave(dispwav_t *disp, sample_t *samples, int length, double range)
 {
 	int pos, max;
-	sample_t *buffer;
-	int i, j, k, s, e;
+	dispwavsnap_t *snap;
+	int i, width;
+
+	if (!wave_on || !disp->snap || display_suspended)
+		return;
+
+	/* the terminal width is taken from the display thread, to avoid ioctl here */
+	width = atomic_load_explicit(&wave_width, memory_order_relaxed);
+
+	pos = disp->interval_pos;
+	max = disp->interval_max;
+	snap = disp->snap;
+
+	for (i = 0; i < length; i++) {
+		if (pos >= width + 2) {
+			if (++pos == max)
+				pos = 0;
+			continue;
+		}
+		snap->buffer[pos++] = samples[i];
+		if (pos == width + 2) {
+			/* hand over snapshot to display thread */
+			snap->range = range;
+			snap->length = pos;
+			display_mailbox_post(&disp->mailbox);
+			snap = disp->snap = display_mailbox_slot(&disp->mailbox);
+		}
+	}
+
+	disp->interval_pos = pos;
+}
+
+/* render snapshot of terminal width + 2 samples */
+static void display_wave_render(void *snapshot, void *priv)
+{
+	dispwav_t *disp = priv;
+	dispwavsnap_t *snap = snapshot;
+	sample_t *buffer = snap->buffer;
+	double range = snap->range;
+	int j, k, s, e;
 	double last, current, next;
 	int color = 9; /* default color */
 	int center_line;
@@ -109,146 +159,134 @@ void display_wave(dispwav_t *disp, sample_t *samples, int length, double range)
 	get_win_size(&width, &h);
 	if (width > MAX_DISPLAY_WIDTH - 1)
 		width = MAX_DISPLAY_WIDTH - 1;
+	atomic_store_explicit(&wave_width, width, memory_order_relaxed);
+	/* terminal may have been resized since snapshot was taken */
+	if (width > snap->length - 2)
+		width = snap->length - 2;
 
 	/* at what line we draw our zero-line and what character we use */
 	center_line = (HEIGHT - 1) >> 1;
 	center_char = (HEIGHT & 1) ? '\'' : '.';
 
-	pos = disp->interval_pos;
-	max = disp->interval_max;
-	buffer = disp->buffer;
-
-	for (i = 0; i < length; i++) {
-		if (pos >= width + 2) {
-			if (++pos == max)
-				pos = 0;
-			continue;
+	memset(&screen, ' ', sizeof(screen));
+	for (j = 0; j < width; j++) {
+		/* Input value is scaled to range -1 .. 1 and then subtracted from 1,
+		 * so the result ranges from 0 .. 2.
+		 * HEIGHT-1 is multiplied with the range, so a HEIGHT of 3 would allow
+		 * 0..4 (5 steps) and a HEIGHT of 11 would allow 0..20 (21 steps).
+		 * We always use odd number of steps, so there will be a center between
+		 * values.
+		 */
+		last = (1.0 - buffer[j] / range) * (double)(HEIGHT - 1);
+		current = (1.0 - buffer[j + 1] / range) * (double)(HEIGHT - 1);
+		next = (1.0 - buffer[j + 2] / range) * (double)(HEIGHT - 1);
+		/* calculate start and end for vertical line
+		 * if the current value is a peak (above or below last AND next point),
+		 * round this peak point to become one end of the vertical line.
+		 * the other end is rounded up or down, so the end of the line will
+		 * not overlap with the ends of the surrounding lines.
+		 */
+		if (last > current) {
+			if (next > current) {
+				/* current point is a peak up */
+				s = round(current);
+				/* use lowest neighbor point and end is half way */
+				if (last > next)
+					e = floor((last + current) / 2.0);
+				else
+					e = floor((next + current) / 2.0);
+				/* end point must not be above start point */
+				if (e < s)
+					e = s;
+			} else {
+				/* current point is a transition upwards */
+				s = ceil((next + current) / 2.0);
+				e = floor((last + current) / 2.0);
+				/* end point must not be above start point */
+				if (e < s)
+					s = e = round(current);
+			}
+		} else {
+			if (next <= current) {
+				/* current point is a peak down */
+				e = round(current);
+				/* use heighes neighbor point and start is half way */
+				if (last <= next)
+					s = ceil((last + current) / 2.0);
+				else
+					s = ceil((next + current) / 2.0);
+				/* start point must not be below end point */
+				if (s > e)
+					s = e;
+			} else {
+				/* current point is a transition downwards */
+				s = ceil((last + current) / 2.0);
+				e = floor((next + current) / 2.0);
+				/* start point must not be below end point */
+				if (s > e)
+					s = e = round(current);
+			}
 		}
-		buffer[pos++] = samples[i];
-		if (pos == width + 2) {
-			memset(&screen, ' ', sizeof(screen));
-			for (j = 0; j < width; j++) {
-				/* Input value is scaled to range -1 .. 1 and then subtracted from 1,
-				 * so the result ranges from 0 .. 2.
-				 * HEIGHT-1 is multiplied with the range, so a HEIGHT of 3 would allow
-				 * 0..4 (5 steps) and a HEIGHT of 11 would allow 0..20 (21 steps).
-				 * We always use odd number of steps, so there will be a center between
-				 * values.
-				 */
-				last = (1.0 - buffer[j] / range) * (double)(HEIGHT - 1);
-				current = (1.0 - buffer[j + 1] / range) * (double)(HEIGHT - 1);
-				next = (1.0 - buffer[j + 2] / range) * (double)(HEIGHT - 1);
-				/* calculate start and end for vertical line
-				 * if the current value is a peak (above or below last AND next point),
-				 * round this peak point to become one end of the vertical line.
-				 * the other end is rounded up or down, so the end of the line will
-				 * not overlap with the ends of the surrounding lines.
-				 */
-				if (last > current) {
-					if (next > current) {
-						/* current point is a peak up */
-						s = round(current);
-						/* use lowest neighbor point and end is half way */
-						if (last > next)
-							e = floor((last + current) / 2.0);
-						else
-							e = floor((next + current) / 2.0);
-						/* end point must not be above start point */
-						if (e < s)
-							e = s;
-					} else {
-						/* current point is a transition upwards */
-						s = ceil((next + current) / 2.0);
-						e = floor((last + current) / 2.0);
-						/* end point must not be above start point */
-						if (e < s)
-							s = e = round(current);
-					}
-				} else {
-					if (next <= current) {
-						/* current point is a peak down */
-						e = round(current);
-						/* use heighes neighbor point and start is half way */
-						if (last <= next)
-							s = ceil((last + current) / 2.0);
-						else
-							s = ceil((next + current) / 2.0);
-						/* start point must not be below end point */
-						if (s > e)
-							s = e;
-					} else {
-						/* current point is a transition downwards */
-						s = ceil((last + current) / 2.0);
-						e = floor((next + current) / 2.0);
-						/* start point must not be below end point */
-						if (s > e)
-							s = e = round(current);
-					}
+		/* only draw line, if it is in range */
+		if (e >= 0 && s < HEIGHT * 2 - 1) {
+			/* clip */
+			if (s < 0)
+				s = 0;
+			if (e >= HEIGHT * 2 - 1)
+				e = HEIGHT * 2 - 1;
+			/* plot start and end point */
+			if ((s & 1))
+				screen[s >> 1][j] = '.';
+			else if (e != s)
+				screen[s >> 1][j] = '|';
+			if (!(e & 1))
+				screen[e >> 1][j] = '\'';
+			else if (e != s)
+				screen[e >> 1][j] = '|';
+			/* plot line between start and end point */
+			for (k = (s >> 1) + 1; k < (e >> 1); k++)
+				screen[k][j] = '|';
+		}
+	}
+	sprintf(screen[0], "Channel: %s", disp->kanal);
+	*strchr(screen[0], '\0') = ' ';
+	lock_logging();
+	enable_limit_scroll(false);
+	printf("\0337\033[H");
+	for (j = 0; j < disp->offset; j++)
+		puts("");
+	for (j = 0; j < HEIGHT; j++) {
+		for (k = 0; k < width; k++) {
+			if (j == center_line && screen[j][k] == ' ') {
+				/* blue 0-line */
+				if (color != 4) {
+					color = 4;
+					printf("\033[0;34m");
 				}
-				/* only draw line, if it is in range */
-				if (e >= 0 && s < HEIGHT * 2 - 1) {
-					/* clip */
-					if (s < 0)
-						s = 0;
-					if (e >= HEIGHT * 2 - 1)
-						e = HEIGHT * 2 - 1;
-					/* plot start and end point */
-					if ((s & 1))
-						screen[s >> 1][j] = '.';
-					else if (e != s)
-						screen[s >> 1][j] = '|';
-					if (!(e & 1))
-						screen[e >> 1][j] = '\'';
-					else if (e != s)
-						screen[e >> 1][j] = '|';
-					/* plot line between start and end point */
-					for (k = (s >> 1) + 1; k < (e >> 1); k++)
-						screen[k][j] = '|';
+				putchar(center_char);
+			} else if (screen[j][k] == '\'' || screen[j][k] == '.' || screen[j][k] == '|') {
+				/* green scope curve */
+				if (color != 2) {
+					color = 2;
+					printf("\033[1;32m");
 				}
-			}
-			sprintf(screen[0], "Channel: %s", disp->kanal);
-			*strchr(screen[0], '\0') = ' ';
-			lock_logging();
-			enable_limit_scroll(false);
-			printf("\0337\033[H");
-			for (j = 0; j < disp->offset; j++)
-				puts("");
-			for (j = 0; j < HEIGHT; j++) {
-				for (k = 0; k < width; k++) {
-					if (j == center_line && screen[j][k] == ' ') {
-						/* blue 0-line */
-						if (color != 4) {
-							color = 4;
-							printf("\033[0;34m");
-						}
-						putchar(center_char);
-					} else if (screen[j][k] == '\'' || screen[j][k] == '.' || screen[j][k] == '|') {
-						/* green scope curve */
-						if (color != 2) {
-							color = 2;
-							printf("\033[1;32m");
-						}
-						putchar(screen[j][k]);
-					} else if (screen[j][k] != ' ') {
-						/* white other characters */
-						if (color != 7) {
-							color = 7;
-							printf("\033[1;37m");
-						}
-						putchar(screen[j][k]);
-					} else
-						putchar(screen[j][k]);
+				putchar(screen[j][k]);
+			} else if (screen[j][k] != ' ') {
+				/* white other characters */
+				if (color != 7) {
+					color = 7;
+					printf("\033[1;37m");
 				}
-				printf("\n");
-			}
-			/* reset color and position */
-			printf("\033[0;39m\0338"); fflush(stdout);
-			enable_limit_scroll(true);
-			unlock_logging();
+				putchar(screen[j][k]);
+			} else
+				putchar(screen[j][k]);
 		}
+		printf("\n");
 	}
-
-	disp->interval_pos = pos;
+	/* reset color and position */
+	printf("\033[0;39m\0338"); fflush(stdout);
+	enable_limit_scroll(true);
+	unlock_logging();
 }
 
 
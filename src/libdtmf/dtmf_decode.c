@@ -40,14 +40,18 @@
 #define DTMF_HIGH_4	1633.0
 
 static const char dtmf_digit[] = "     123A456B789C*0#D";
+static const double dtmf_freq[8] = { DTMF_LOW_1, DTMF_LOW_2, DTMF_LOW_3, DTMF_LOW_4, DTMF_HIGH_1, DTMF_HIGH_2, DTMF_HIGH_3, DTMF_HIGH_4 };
 
-int dtmf_decode_init(dtmf_dec_t *dtmf, void *priv, void (*recv_digit)(void *priv, char digit, dtmf_meas_t *meas), int samplerate, double max_amplitude, double min_amplitude, double freq_margin)
+int dtmf_decode_init(dtmf_dec_t *dtmf, void *priv, void (*recv_digit)(void *priv, char digit, dtmf_meas_t *meas), int samplerate, double max_amplitude, double min_amplitude, double freq_margin, enum dtmf_decode_mode mode)
 {
+	double w;
+	int k;
 	int rc;
 
 	memset(dtmf, 0, sizeof(*dtmf));
 	dtmf->priv = priv;
 	dtmf->recv_digit = recv_digit;
+	dtmf->mode = mode;
 	dtmf->samplerate = samplerate;
 	dtmf->freq_margin = freq_margin;
 	dtmf->max_amplitude = max_amplitude;
@@ -58,6 +62,19 @@ int dtmf_decode_init(dtmf_dec_t *dtmf, void *priv, void (*recv_digit)(void *priv
 	dtmf->time_meas = (int)(0.015 * (double)samplerate);
 	dtmf->time_pause = (int)(0.010 * (double)samplerate);
 
+	if (mode == DTMF_DECODE_GOERTZEL) {
+		/* 13 ms blocks: the closest tones (697 and 770 Hz) are in the first
+		 * side lobe of each other (-25 dB), two blocks make a detection */
+		dtmf->block_size = (int)(0.013 * (double)samplerate);
+		for (k = 0; k < 8; k++) {
+			w = 2.0 * M_PI * dtmf_freq[k] / (double)samplerate;
+			dtmf->coeff[k] = 2.0 * cos(w);
+			dtmf->sin_w[k] = sin(w);
+			dtmf->phase_step[k] = fmod(w * (double)dtmf->block_size, 2.0 * M_PI);
+		}
+		return 0;
+	}
+
 	/* init fm demodulator */
 	rc = fm_demod_init(&dtmf->demod_low, (double)samplerate, (DTMF_LOW_1 + DTMF_LOW_4) / 2.0, DTMF_LOW_4 - DTMF_LOW_1);
 	if (rc < 0)
@@ -87,6 +104,9 @@ void dtmf_decode_reset(dtmf_dec_t *dtmf)
 {
 	dtmf->detected = 0;
 	dtmf->count = 0;
+	dtmf->block_pos = 0;
+	memset(dtmf->s1, 0, sizeof(dtmf->s1));
+	memset(dtmf->s2, 0, sizeof(dtmf->s2));
 }
 
 void dtmf_decode_filter(dtmf_dec_t *dtmf, sample_t *samples, int length, sample_t *frequency_low, sample_t *frequency_high, sample_t *amplitude_low, sample_t *amplitude_high)
@@ -106,15 +126,58 @@ void dtmf_decode_filter(dtmf_dec_t *dtmf, sample_t *samples, int length, sample_
 	iir_process(&dtmf->freq_lp[0], frequency_low, length);
 	iir_process(&dtmf->freq_lp[1], frequency_high, length);
 }
-void dtmf_decode(dtmf_dec_t *dtmf, sample_t *samples, int length)
+/* process the result of 'duration' samples
+ * valid: digit passed all checks
+ * measure: add frequency and amplitude to measurement
+ */
+static void dtmf_detect(dtmf_dec_t *dtmf, char digit, int valid, int measure, double f1, double f2, double amplitude_low, double amplitude_high, int duration)
+{
+	if (!dtmf->detected) {
+		if (digit && valid) {
+			if (dtmf->count == 0) {
+				memset(&dtmf->meas, 0, sizeof(dtmf->meas));
+			}
+			if (measure) {
+				dtmf->meas.frequency_low += f1;
+				dtmf->meas.frequency_high += f2;
+				dtmf->meas.amplitude_low += amplitude_low;
+				dtmf->meas.amplitude_high += amplitude_high;
+				dtmf->meas.count++;
+			}
+			dtmf->count += duration;
+			if (dtmf->count >= dtmf->time_detect && dtmf->meas.count) {
+				dtmf->detected = digit;
+				dtmf->meas.frequency_low /= dtmf->meas.count;
+				dtmf->meas.frequency_high /= dtmf->meas.count;
+				dtmf->meas.amplitude_low /= dtmf->meas.count;
+				dtmf->meas.amplitude_high /= dtmf->meas.count;
+				dtmf->meas.count = 1;
+				dtmf->recv_digit(dtmf->priv, digit, &dtmf->meas);
+			}
+		} else
+			dtmf->count = 0;
+	} else {
+		if (!digit || digit != dtmf->detected || !valid) {
+			dtmf->count += duration;
+			if (dtmf->count >= dtmf->time_pause) {
+				dtmf->detected = 0;
+#ifdef DEBUG_DTMF
+				printf("lost!\n");
+#endif
+			}
+		} else
+			dtmf->count = 0;
+	}
+}
+
+static void dtmf_decode_fm(dtmf_dec_t *dtmf, sample_t *samples, int length)
 {
 	sample_t frequency_low[length], amplitude_low[length];
 	sample_t frequency_high[length], amplitude_high[length];
 	double margin, min_amplitude, max_amplitude, forward_twist, reverse_twist, f1, f2;
-	int time_detect, time_meas, time_pause;
+	int time_meas;
 	int low = 0, high = 0;
-	char detected, digit;
-	int count;
+	char digit;
 	int amplitude_ok, twist_ok;
 	int i;
 
@@ -123,11 +186,7 @@ void dtmf_decode(dtmf_dec_t *dtmf, sample_t *samples, int length)
 	max_amplitude = dtmf->max_amplitude;
 	forward_twist = dtmf->forward_twist;
 	reverse_twist = dtmf->reverse_twist;
-	time_detect = dtmf->time_detect;
 	time_meas = dtmf->time_meas;
-	time_pause = dtmf->time_pause;
-	detected = dtmf->detected;
-	count = dtmf->count;
 
 	/* FM/AM demod */
 	dtmf_decode_filter(dtmf, samples, length, frequency_low, frequency_high, amplitude_low, amplitude_high);
@@ -202,49 +261,119 @@ void dtmf_decode(dtmf_dec_t *dtmf, sample_t *samples, int length)
 			}
 		}
 
-		if (!detected) {
-			if (digit && amplitude_ok && twist_ok) {
-				if (count == 0) {
-					memset(&dtmf->meas, 0, sizeof(dtmf->meas));
-				}
-				if (count >= time_meas) {
-					dtmf->meas.frequency_low += f1;
-					dtmf->meas.frequency_high += f2;
-					dtmf->meas.amplitude_low += amplitude_low[i];
-					dtmf->meas.amplitude_high += amplitude_high[i];
-					dtmf->meas.count++;
-				}
-				count++;
-				if (count >= time_detect) {
-					detected = digit;
-					dtmf->meas.frequency_low /= dtmf->meas.count;
-					dtmf->meas.frequency_high /= dtmf->meas.count;
-					dtmf->meas.amplitude_low /= dtmf->meas.count;
-					dtmf->meas.amplitude_high /= dtmf->meas.count;
-					dtmf->meas.count = 1;
-					dtmf->recv_digit(dtmf->priv, digit, &dtmf->meas);
-				}
-			} else
-				count = 0;
-		} else {
-			if (!digit || digit != detected || !amplitude_ok || !twist_ok) {
-				count++;
-				if (count >= time_pause) {
-					detected = 0;
-#ifdef DEBUG_DTMF
-					printf("lost!\n");
-#endif
-				}
-			} else
-				count = 0;
-		}
+		dtmf_detect(dtmf, digit, amplitude_ok && twist_ok, dtmf->count >= time_meas, f1, f2, amplitude_low[i], amplitude_high[i], 1);
 #ifdef DEBUG_DTMF
 		if (digit)
 			printf("DTMF tone='%c' diff frequency=%.1f %.1f amplitude=%.1f %.1f dB (%s) twist=%.1f dB (%s)\n", digit, f1, f2, level2db(amplitude_low[i]), level2db(amplitude_high[i]), (amplitude_ok) ? "OK" : "nok", level2db(amplitude_high[i] / amplitude_low[i]), (twist_ok) ? "OK" : "nok");
 #endif
+	}
+}
+
+
+/* evaluate Goertzel filters at the end of a block
+ *
+ * The phase of a tone advances by w' * block_size from one block to the next.
+ * The difference to the advance of the filter's frequency w is the frequency
+ * deviation. It is unambiguous within +- samplerate / block_size / 2, which is
+ * beyond the point where the filter attenuates the tone anyway.
+ */
+static void dtmf_goertzel_block(dtmf_dec_t *dtmf)
+{
+	double margin, re, im, phase, deviation[8], amplitude[8];
+	double f1, f2;
+	int low, high, k;
+	char digit = 0;
+	int known, amplitude_ok = 0, twist_ok = 0, freq_ok = 0;
+
+	margin = dtmf->freq_margin / 100.0 + 1.0;
+
+	for (k = 0; k < 8; k++) {
+		re = dtmf->s1[k] - dtmf->coeff[k] / 2.0 * dtmf->s2[k];
+		im = dtmf->sin_w[k] * dtmf->s2[k];
+		dtmf->s1[k] = dtmf->s2[k] = 0.0;
+		/* peak amplitude of the tone */
+		amplitude[k] = sqrt(re * re + im * im) * 2.0 / (double)dtmf->block_size;
+		phase = atan2(im, re);
+		deviation[k] = phase - dtmf->phase[k] - dtmf->phase_step[k];
+		deviation[k] -= 2.0 * M_PI * floor(deviation[k] / (2.0 * M_PI) + 0.5);
+		deviation[k] *= (double)dtmf->samplerate / (double)dtmf->block_size / (2.0 * M_PI);
+		dtmf->phase[k] = phase;
+	}
+
+	/* strongest frequency of each group */
+	low = 0;
+	for (k = 1; k < 4; k++) {
+		if (amplitude[k] > amplitude[low])
+			low = k;
+	}
+	high = 4;
+	for (k = 5; k < 8; k++) {
+		if (amplitude[k] > amplitude[high])
+			high = k;
+	}
+	f1 = deviation[low];
+	f2 = deviation[high];
+
+	digit = dtmf_digit[(low + 1) * 4 + (high - 3)];
+	/* check for limits */
+	if (amplitude[low] <= dtmf->max_amplitude && amplitude[low] >= dtmf->min_amplitude && amplitude[high] <= dtmf->max_amplitude && amplitude[high] >= dtmf->min_amplitude) {
+		amplitude_ok = 1;
+		if (amplitude[high] / amplitude[low] <= dtmf->forward_twist && amplitude[low] / amplitude[high] <= dtmf->reverse_twist)
+			twist_ok = 1;
+	}
+	/* the phase of the first block of a digit has no predecessor, so its frequency is checked with the next block */
+	known = (dtmf->detected || dtmf->count);
+	if (!known
+	 || (dtmf_freq[low] + f1 >= dtmf_freq[low] / margin && dtmf_freq[low] + f1 <= dtmf_freq[low] * margin
+	  && dtmf_freq[high] + f2 >= dtmf_freq[high] / margin && dtmf_freq[high] + f2 <= dtmf_freq[high] * margin))
+		freq_ok = 1;
+#ifdef DEBUG_DTMF
+	printf("DTMF tone='%c' diff frequency=%.1f %.1f amplitude=%.1f %.1f dB (%s) twist=%.1f dB (%s) frequency (%s)\n", digit, f1, f2, level2db(amplitude[low]), level2db(amplitude[high]), (amplitude_ok) ? "OK" : "nok", level2db(amplitude[high] / amplitude[low]), (twist_ok) ? "OK" : "nok", (freq_ok) ? "OK" : "nok");
+#endif
 
-		dtmf->detected = detected;
-		dtmf->count = count;
+	dtmf_detect(dtmf, digit, amplitude_ok && twist_ok && freq_ok, known, f1, f2, amplitude[low], amplitude[high], dtmf->block_size);
+}
+
+/* run all eight Goertzel filters, without any buffer */
+static void dtmf_decode_goertzel(dtmf_dec_t *dtmf, sample_t *samples, int length)
+{
+	double coeff[8], s1[8], s2[8], s, x;
+	int i, n, k;
+
+	while (length) {
+		n = dtmf->block_size - dtmf->block_pos;
+		if (n > length)
+			n = length;
+		for (k = 0; k < 8; k++) {
+			coeff[k] = dtmf->coeff[k];
+			s1[k] = dtmf->s1[k];
+			s2[k] = dtmf->s2[k];
+		}
+		for (i = 0; i < n; i++) {
+			x = *samples++;
+			for (k = 0; k < 8; k++) {
+				s = x + coeff[k] * s1[k] - s2[k];
+				s2[k] = s1[k];
+				s1[k] = s;
+			}
+		}
+		for (k = 0; k < 8; k++) {
+			dtmf->s1[k] = s1[k];
+			dtmf->s2[k] = s2[k];
+		}
+		length -= n;
+		dtmf->block_pos += n;
+		if (dtmf->block_pos == dtmf->block_size) {
+			dtmf->block_pos = 0;
+			dtmf_goertzel_block(dtmf);
+		}
 	}
 }
 
+void dtmf_decode(dtmf_dec_t *dtmf, sample_t *samples, int length)
+{
+	if (dtmf->mode == DTMF_DECODE_GOERTZEL)
+		dtmf_decode_goertzel(dtmf, samples, length);
+	else
+		dtmf_decode_fm(dtmf, samples, length);
+}
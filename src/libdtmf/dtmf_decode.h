@@ -2,6 +2,11 @@
 
 #define DTMF_FREQ_MARGIN_PERCENT_DEFAULT	3	/* 1.8 .. 3.5 % */
 
+enum dtmf_decode_mode {
+	DTMF_DECODE_FM = 0,			/* FM/AM demodulation of both groups for every sample */
+	DTMF_DECODE_GOERTZEL,			/* Goertzel filter bank, evaluated at end of each block */
+};
+
 typedef struct dtmf_meas {
 	double		frequency_low;
 	double		frequency_high;
@@ -13,6 +18,7 @@ typedef struct dtmf_meas {
 typedef struct dtmf_dec {
 	void		*priv;
 	void		(*recv_digit)(void *priv, char digit, dtmf_meas_t *meas);
+	enum dtmf_decode_mode mode;
 	int		samplerate;		/* samplerate */
 	double		freq_margin;		/* +- limit of frequency deviation (percent) valid tone*/
 	double		min_amplitude;		/* minimum amplitude relative to 0 dBm */
@@ -25,12 +31,19 @@ typedef struct dtmf_dec {
 	fm_demod_t	demod_low;		/* demodulator for low frequencies */
 	fm_demod_t	demod_high;		/* demodulator for high frequencies */
 	iir_filter_t	freq_lp[2];		/* low pass to filter the frequency result */
+	int		block_size;		/* number of samples for each Goertzel block */
+	int		block_pos;		/* number of samples in current block */
+	double		coeff[8];		/* 2 * cos(w) of each DTMF frequency */
+	double		sin_w[8];		/* sin(w) of each DTMF frequency */
+	double		phase_step[8];		/* phase advance of each frequency between blocks */
+	double		s1[8], s2[8];		/* Goertzel states */
+	double		phase[8];		/* phase of each frequency at previous block */
 	char		detected;		/* currently detected DTMF digit or 0 for no detection */
 	int		count;			/* counter to count detection or loss (pause) of signal */
 	dtmf_meas_t	meas;			/* measurements */
 } dtmf_dec_t;
 
-int dtmf_decode_init(dtmf_dec_t *dtmf, void *priv, void (*recv_digit)(void *priv, char digit, dtmf_meas_t *meas), int samplerate, double max_amplitude, double min_amplitude, double freq_margin);
+int dtmf_decode_init(dtmf_dec_t *dtmf, void *priv, void (*recv_digit)(void *priv, char digit, dtmf_meas_t *meas), int samplerate, double max_amplitude, double min_amplitude, double freq_margin, enum dtmf_decode_mode mode);
 void dtmf_decode_exit(dtmf_dec_t *dtmf);
 void dtmf_decode_reset(dtmf_dec_t *dtmf);
 void dtmf_decode(dtmf_dec_t *dtmf, sample_t *samples, int length);
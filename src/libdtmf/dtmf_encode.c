@@ -30,15 +30,12 @@
 
 void dtmf_encode_init(dtmf_enc_t *dtmf, int samplerate, double dBm_level)
 {
-	int i;
-
 	memset(dtmf, 0, sizeof(*dtmf));
 	dtmf->samplerate = samplerate;
 
-	for (i = 0; i < 65536; i++) {
-		dtmf->sine_low[i] = sin((double)i / 65536.0 * 2.0 * PI) * PEAK_DTMF_LOW * dBm_level;
-		dtmf->sine_high[i] = sin((double)i / 65536.0 * 2.0 * PI) * PEAK_DTMF_HIGH * dBm_level;
-	}
+	/* tones are generated by phasors, so no sine tables are needed */
+	dtmf->peak_low = PEAK_DTMF_LOW * dBm_level;
+	dtmf->peak_high = PEAK_DTMF_HIGH * dBm_level;
 }
 
 /* set dtmf tone */
@@ -71,10 +68,8 @@ int dtmf_encode_set_tone(dtmf_enc_t *dtmf, char tone, double on_duration, double
 	dtmf->pos = 0;
 	dtmf->on = (int)((double)dtmf->samplerate * on_duration);
 	dtmf->off = dtmf->on + (int)((double)dtmf->samplerate * off_duration);
-	dtmf->phaseshift65536[0] = 65536.0 / ((double)dtmf->samplerate / f1);
-	dtmf->phaseshift65536[1] = 65536.0 / ((double)dtmf->samplerate / f2);
-	dtmf->phase65536[0] = 0.0;
-	dtmf->phase65536[1] = 0.0;
+	nco_init(&dtmf->nco[0], 0.0, 65536.0 / ((double)dtmf->samplerate / f1));
+	nco_init(&dtmf->nco[1], 0.0, 65536.0 / ((double)dtmf->samplerate / f2));
 
 	return 0;
 }
@@ -85,8 +80,8 @@ int dtmf_encode_set_tone(dtmf_enc_t *dtmf, char tone, double on_duration, double
  */
 int dtmf_encode(dtmf_enc_t *dtmf, sample_t *samples, int length)
 {
-        double *phaseshift, *phase;
-	sample_t *sine_low, *sine_high;
+	nco_t *nco = dtmf->nco;
+	double peak_low, peak_high;
 	int count = 0;
 	int i;
 
@@ -94,28 +89,20 @@ int dtmf_encode(dtmf_enc_t *dtmf, sample_t *samples, int length)
 	if (!dtmf->tone)
 		return 0;
 
-	sine_low = dtmf->sine_low;
-	sine_high = dtmf->sine_high;
-	phaseshift = dtmf->phaseshift65536;
-	phase = dtmf->phase65536;
+	peak_low = dtmf->peak_low;
+	peak_high = dtmf->peak_high;
 
 	for (i = 0; i < length; i++) {
-		*samples++ = sine_low[(uint16_t)phase[0]]
-			   + sine_high[(uint16_t)phase[1]];
-		phase[0] += phaseshift[0];
-		if (phase[0] >= 65536.0)
-			phase[0] -= 65536.0;
-		phase[1] += phaseshift[1];
-		if (phase[1] >= 65536.0)
-			phase[1] -= 65536.0;
+		*samples++ = nco[0].im * peak_low
+			   + nco[1].im * peak_high;
+		nco_next(&nco[0]);
+		nco_next(&nco[1]);
 
 		dtmf->pos++;
-		/* tone ends */
+		/* tone ends, phasors stay at phase 0, so sine is 0 */
 		if (dtmf->pos == dtmf->on) {
-			phaseshift[0] = 0.0;
-			phaseshift[1] = 0.0;
-			phase[0] = 0.0;
-			phase[1] = 0.0;
+			nco_init(&nco[0], 0.0, 0.0);
+			nco_init(&nco[1], 0.0, 0.0);
 		}
 		/* pause ends */
 		if (dtmf->pos == dtmf->off) {
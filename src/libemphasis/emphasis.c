@@ -53,10 +53,78 @@ double timeconstant2cutoff(double time_constant_us)
 	return 1.0 / (2.0 * PI * time_constant_us / 1e6);
 }
 
+/* add the sections of an IIR filter to the chain */
+static void chain_add_filter(emphasis_chain_t *chain, const iir_filter_t *filter)
+{
+	emphasis_section_t *section;
+	int j;
+
+	for (j = 0; j < filter->iter; j++) {
+		section = &chain->section[chain->num++];
+		section->a0 = filter->a0;
+		section->a1 = filter->a1;
+		section->a2 = filter->a2;
+		section->b1 = filter->b1;
+		section->b2 = filter->b2;
+	}
+}
+
+/* add a first order section: amp * (1 + zero * z^-1) / (1 - pole * z^-1) */
+static void chain_add_first_order(emphasis_chain_t *chain, double zero, double pole, double amp)
+{
+	emphasis_section_t *section = &chain->section[chain->num++];
+
+	section->a0 = amp;
+	section->a1 = amp * zero;
+	section->b1 = -pole;
+}
+
+static void chain_reset(emphasis_chain_t *chain)
+{
+	int j;
+
+	for (j = 0; j < chain->num; j++)
+		chain->section[j].z1 = chain->section[j].z2 = 0.0;
+}
+
+/* Process the sections 'first' to 'last' - 1 of the chain in one pass, after
+ * applying the gain. See iir_process() for the structure of each section.
+ */
+static void chain_process(emphasis_chain_t *chain, int first, int last, sample_t *samples, int num, double gain)
+{
+	emphasis_section_t *section;
+	double in, out;
+	int i, j;
+
+	for (i = 0; i < num; i++) {
+		/* add a small value, so the filters do not get denormal */
+		in = samples[i] * gain + 0.000000001;
+		for (j = first; j < last; j++) {
+			section = &chain->section[j];
+			out = in * section->a0 + section->z1;
+			section->z1 = in * section->a1 + section->z2 - section->b1 * out;
+			section->z2 = in * section->a2 - section->b2 * out;
+			in = out;
+		}
+		samples[i] = in;
+	}
+}
+
+/* The filters before and after emphasis are merged with the emphasis into one
+ * chain of sections per direction:
+ *
+ * Pre-emphasis: two low pass sections, then the zero of the emphasis.
+ * De-emphasis: one high pass section, then the pole of the emphasis.
+ *
+ * The gain that makes the emphasis neutral at 1000 Hz is part of the last
+ * section, so each direction is done with one pass over the samples.
+ */
 int init_emphasis(emphasis_t *state, int samplerate, double cut_off, double cut_off_h, double cut_off_l)
 {
 	double factor;
+	iir_filter_t filter;
 	sample_t test_samples[samplerate / 10];
+	emphasis_section_t *section;
 
 	memset(state, 0, sizeof(*state));
 
@@ -69,13 +137,17 @@ int init_emphasis(emphasis_t *state, int samplerate, double cut_off, double cut_
 	state->d.factor = factor;
 	state->d.amp = 1.0;
 
-	/* do not de-emphasis below CUT_OFF_H */
-	iir_highpass_init(&state->d.hp, cut_off_h, samplerate, 1);
-
 	/* do not pre-emphasis above CUT_OFF_L
 	 * Mobile network specifications want -18 dB per octave.
 	 * With two iterations we have 24 dB, - 6 dB (from emphasis). */
-	iir_lowpass_init(&state->p.lp, cut_off_l, samplerate, 2);
+	iir_lowpass_init(&filter, cut_off_l, samplerate, 2);
+	chain_add_filter(&state->p.chain, &filter);
+	chain_add_first_order(&state->p.chain, -factor, 0.0, 1.0);
+
+	/* do not de-emphasis below CUT_OFF_H */
+	iir_highpass_init(&filter, cut_off_h, samplerate, 1);
+	chain_add_filter(&state->d.chain, &filter);
+	chain_add_first_order(&state->d.chain, 0.0, factor, 1.0);
 
 	/* calibrate amplification to be neutral at 1000 Hz */
 	gen_sine(test_samples, sizeof(test_samples) / sizeof(test_samples[0]), samplerate, 1000.0);
@@ -85,60 +157,71 @@ int init_emphasis(emphasis_t *state, int samplerate, double cut_off, double cut_
 	de_emphasis(state, test_samples, sizeof(test_samples) / sizeof(test_samples[0]));
 	state->d.amp = 1.0 / get_level(test_samples, sizeof(test_samples) / sizeof(test_samples[0]));
 
+	/* apply amplification to the emphasis sections, start with silence */
+	section = &state->p.chain.section[state->p.chain.num - 1];
+	section->a0 *= state->p.amp;
+	section->a1 *= state->p.amp;
+	section = &state->d.chain.section[state->d.chain.num - 1];
+	section->a0 *= state->d.amp;
+	chain_reset(&state->p.chain);
+	chain_reset(&state->d.chain);
+
 	return 0;
 }
 
 void pre_emphasis(emphasis_t *state, sample_t *samples, int num)
 {
-	double x, y, x_last, factor, amp;
-	int i;
+	chain_process(&state->p.chain, 0, state->p.chain.num, samples, num, 1.0);
+}
 
-	iir_process(&state->p.lp, samples, num);
+void de_emphasis(emphasis_t *state, sample_t *samples, int num)
+{
+	emphasis_chain_t *chain = &state->d.chain;
 
-	x_last = state->p.x_last;
-	factor = state->p.factor;
-	amp = state->p.amp;
+	chain_process(chain, chain->num - 1, chain->num, samples, num, 1.0);
+}
 
-	for (i = 0; i < num; i++) {
-		x = *samples;
+/* high pass filter to remove DC and low frequencies */
+void dc_filter(emphasis_t *state, sample_t *samples, int num)
+{
+	emphasis_chain_t *chain = &state->d.chain;
 
-		/* pre-emphasis */
-		y = x - factor * x_last;
+	chain_process(chain, 0, chain->num - 1, samples, num, 1.0);
+}
 
-		x_last = x;
+/* Fused conditioning of audio for transmission, in the same order as
+ * calling pre_emphasis() (if enabled) and then applying the gain.
+ */
+void pre_emphasis_gain(emphasis_t *state, sample_t *samples, int num, int emphasis, double gain)
+{
+	int i;
 
-		*samples++ = amp * y;
+	if (!emphasis) {
+		if (gain == 1.0)
+			return;
+		for (i = 0; i < num; i++)
+			samples[i] *= gain;
+		return;
 	}
 
-	state->p.x_last = x_last;
+	chain_process(&state->p.chain, 0, state->p.chain.num, samples, num, gain);
 }
 
-void de_emphasis(emphasis_t *state, sample_t *samples, int num)
+/* Fused conditioning of received audio, in the same order as applying the
+ * gain and then calling dc_filter() and de_emphasis() (if enabled).
+ */
+void de_emphasis_gain(emphasis_t *state, sample_t *samples, int num, int emphasis, double gain)
 {
-	double x, y, y_last, factor, amp;
 	int i;
 
-	y_last = state->d.y_last;
-	factor = state->d.factor;
-	amp = state->d.amp;
-
-	for (i = 0; i < num; i++) {
-		x = *samples;
-
-		/* de-emphasis */
-		y = x + factor * y_last;
-
-		y_last = y;
-
-		*samples++ = amp * y;
+	if (!emphasis) {
+		if (gain == 1.0)
+			return;
+		for (i = 0; i < num; i++)
+			samples[i] *= gain;
+		return;
 	}
 
-	state->d.y_last = y_last;
-}
-
-/* high pass filter to remove DC and low frequencies */
-void dc_filter(emphasis_t *state, sample_t *samples, int num)
-{
-	iir_process(&state->d.hp, samples, num);
+	chain_process(&state->d.chain, 0, state->d.chain.num, samples, num, gain);
 }
 
@@ -1,15 +1,29 @@
+
 #include "../libfilter/iir_filter.h"
 
+/* one second order section of a merged emphasis filter */
+typedef struct emphasis_section {
+	double a0, a1, a2, b1, b2;
+	double z1, z2;
+} emphasis_section_t;
+
+/* band limiting sections plus the emphasis section */
+#define EMPHASIS_MAX_SECTIONS	(IIR_MAX_ITER + 1)
+
+/* cascade of sections, the emphasis section (including its gain) is the last one */
+typedef struct emphasis_chain {
+	int num;
+	emphasis_section_t section[EMPHASIS_MAX_SECTIONS];
+} emphasis_chain_t;
+
 typedef struct emphasis {
 	struct {
-		iir_filter_t lp;
-		double x_last;
+		emphasis_chain_t chain;	/* low pass, low pass, emphasis zero */
 		double factor;
 		double amp;
 	} p;
 	struct {
-		iir_filter_t hp;
-		double y_last;
+		emphasis_chain_t chain;	/* high pass, emphasis pole */
 		double factor;
 		double amp;
 	} d;
@@ -25,4 +39,5 @@ int init_emphasis(emphasis_t *state, int samplerate, double cut_off, double cut_
 void pre_emphasis(emphasis_t *state, sample_t *samples, int num);
 void de_emphasis(emphasis_t *state, sample_t *samples, int num);
 void dc_filter(emphasis_t *state, sample_t *samples, int num);
-
+void pre_emphasis_gain(emphasis_t *state, sample_t *samples, int num, int emphasis, double gain);
+void de_emphasis_gain(emphasis_t *state, sample_t *samples, int num, int emphasis, double gain);
@@ -17,75 +17,344 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <math.h>
 #include <string.h>
 #include "fft.h"
 
 /*
- * Code based closely to work by Paul Bourke
+ * Planned FFT
+ *
+ * A plan holds the bit reversal table and the twiddle factors, so they are
+ * calculated only once. The transformation combines two radix-2 stages in one
+ * pass (radix-2^2), so that only half of the passes through memory are
+ * required. If log2 of the size is odd, a single radix-2 stage is done first.
+ *
+ * dir =  1 gives forward transform, exp(-j...)
+ * dir = -1 gives reverse transform, exp(+j...)
+ * No scaling is done in either direction.
+ */
+
+int fft_plan_init(fft_plan_t *plan, int m)
+{
+	int n = 1 << m, half = (n > 1) ? n / 2 : 1;
+	int i, b, r;
+
+	memset(plan, 0, sizeof(*plan));
+	plan->m = m;
+	plan->n = n;
+	plan->rev = calloc(n, sizeof(*plan->rev));
+	plan->tw = calloc(half * 2, sizeof(*plan->tw));
+	plan->tw_re = calloc(half, sizeof(*plan->tw_re));
+	plan->tw_im = calloc(half, sizeof(*plan->tw_im));
+	if (!plan->rev || !plan->tw || !plan->tw_re || !plan->tw_im) {
+		fprintf(stderr, "No mem!\n");
+		fft_plan_exit(plan);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		r = 0;
+		for (b = 0; b < m; b++) {
+			if ((i & (1 << b)))
+				r |= 1 << (m - 1 - b);
+		}
+		plan->rev[i] = r;
+	}
+
+	for (i = 0; i < n / 2; i++) {
+		plan->tw_re[i] = cos(2.0 * M_PI * (double)i / (double)n);
+		plan->tw_im[i] = -sin(2.0 * M_PI * (double)i / (double)n);
+		plan->tw[i * 2] = plan->tw_re[i];
+		plan->tw[i * 2 + 1] = plan->tw_im[i];
+	}
+
+	return 0;
+}
+
+void fft_plan_exit(fft_plan_t *plan)
+{
+	free(plan->rev);
+	free(plan->tw);
+	free(plan->tw_re);
+	free(plan->tw_im);
+	memset(plan, 0, sizeof(*plan));
+}
+
+/* complex transformation of interleaved data with size n >> shift */
+static void kernel_complex(fft_plan_t *plan, int shift, int dir, float *data)
+{
+	int m = plan->m - shift, n = 1 << m;
+	const float *tw = plan->tw;
+	float sign = (dir == 1) ? 1.0 : -1.0;
+	float ar, ai, br, bi, cr, ci, dr, di, tr, ti;
+	float w1r, w1i, w2r, w2i;
+	float *x;
+	int i, j, r, h, step;
+
+	/* bit reversal, the table of the full size can be used by shifting */
+	for (i = 0; i < n; i++) {
+		r = plan->rev[i] >> shift;
+		if (i < r) {
+			tr = data[i * 2];
+			ti = data[i * 2 + 1];
+			data[i * 2] = data[r * 2];
+			data[i * 2 + 1] = data[r * 2 + 1];
+			data[r * 2] = tr;
+			data[r * 2 + 1] = ti;
+		}
+	}
+
+	h = 1;
+	if ((m & 1)) {
+		/* single radix-2 stage, twiddle is 1 */
+		for (i = 0; i < n * 2; i += 4) {
+			ar = data[i];
+			ai = data[i + 1];
+			br = data[i + 2];
+			bi = data[i + 3];
+			data[i] = ar + br;
+			data[i + 1] = ai + bi;
+			data[i + 2] = ar - br;
+			data[i + 3] = ai - bi;
+		}
+		h = 2;
+	}
+
+	for (; h < n; h *= 4) {
+		/* stages with span h and 2h, step in twiddle table for exp(-j*2*pi*k/4h) */
+		step = (n / (4 * h)) << shift;
+		for (i = 0; i < n; i += 4 * h) {
+			x = data + i * 2;
+			for (j = 0; j < h; j++) {
+				w2r = tw[j * step * 2];
+				w2i = tw[j * step * 2 + 1] * sign;
+				w1r = tw[j * step * 4];
+				w1i = tw[j * step * 4 + 1] * sign;
+				/* first stage: (a, b) and (c, d) with twiddle w1 */
+				tr = x[(j + h) * 2];
+				ti = x[(j + h) * 2 + 1];
+				br = tr * w1r - ti * w1i;
+				bi = tr * w1i + ti * w1r;
+				tr = x[(j + 3 * h) * 2];
+				ti = x[(j + 3 * h) * 2 + 1];
+				dr = tr * w1r - ti * w1i;
+				di = tr * w1i + ti * w1r;
+				ar = x[j * 2] + br;
+				ai = x[j * 2 + 1] + bi;
+				br = x[j * 2] - br;
+				bi = x[j * 2 + 1] - bi;
+				cr = x[(j + 2 * h) * 2] + dr;
+				ci = x[(j + 2 * h) * 2 + 1] + di;
+				dr = x[(j + 2 * h) * 2] - dr;
+				di = x[(j + 2 * h) * 2 + 1] - di;
+				/* second stage: (a, c) with twiddle w2, (b, d) with twiddle w2 * -j */
+				tr = cr * w2r - ci * w2i;
+				ti = cr * w2i + ci * w2r;
+				cr = tr;
+				ci = ti;
+				tr = dr * w2r - di * w2i;
+				ti = dr * w2i + di * w2r;
+				dr = ti * sign;
+				di = -tr * sign;
+				x[j * 2] = ar + cr;
+				x[j * 2 + 1] = ai + ci;
+				x[(j + 2 * h) * 2] = ar - cr;
+				x[(j + 2 * h) * 2 + 1] = ai - ci;
+				x[(j + h) * 2] = br + dr;
+				x[(j + h) * 2 + 1] = bi + di;
+				x[(j + 3 * h) * 2] = br - dr;
+				x[(j + 3 * h) * 2 + 1] = bi - di;
+			}
+		}
+	}
+}
+
+/* complex transformation of interleaved data, in place */
+void fft_plan_complex(fft_plan_t *plan, int dir, float *data)
+{
+	kernel_complex(plan, 0, dir, data);
+}
+
+/* complex transformation of separate real and imaginary arrays, in place */
+void fft_plan_complex_split(fft_plan_t *plan, int dir, double *x, double *y)
+{
+	int m = plan->m, n = plan->n;
+	const double *tw_re = plan->tw_re, *tw_im = plan->tw_im;
+	double sign = (dir == 1) ? 1.0 : -1.0;
+	double ar, ai, br, bi, cr, ci, dr, di, tr, ti;
+	double w1r, w1i, w2r, w2i;
+	int i, j, k, r, h, step;
+
+	for (i = 0; i < n; i++) {
+		r = plan->rev[i];
+		if (i < r) {
+			tr = x[i];
+			ti = y[i];
+			x[i] = x[r];
+			y[i] = y[r];
+			x[r] = tr;
+			y[r] = ti;
+		}
+	}
+
+	h = 1;
+	if ((m & 1)) {
+		for (i = 0; i < n; i += 2) {
+			ar = x[i];
+			ai = y[i];
+			x[i] = ar + x[i + 1];
+			y[i] = ai + y[i + 1];
+			x[i + 1] = ar - x[i + 1];
+			y[i + 1] = ai - y[i + 1];
+		}
+		h = 2;
+	}
+
+	for (; h < n; h *= 4) {
+		step = n / (4 * h);
+		for (i = 0; i < n; i += 4 * h) {
+			for (j = 0; j < h; j++) {
+				k = i + j;
+				w2r = tw_re[j * step];
+				w2i = tw_im[j * step] * sign;
+				w1r = tw_re[j * step * 2];
+				w1i = tw_im[j * step * 2] * sign;
+				br = x[k + h] * w1r - y[k + h] * w1i;
+				bi = x[k + h] * w1i + y[k + h] * w1r;
+				dr = x[k + 3 * h] * w1r - y[k + 3 * h] * w1i;
+				di = x[k + 3 * h] * w1i + y[k + 3 * h] * w1r;
+				ar = x[k] + br;
+				ai = y[k] + bi;
+				br = x[k] - br;
+				bi = y[k] - bi;
+				cr = x[k + 2 * h] + dr;
+				ci = y[k + 2 * h] + di;
+				dr = x[k + 2 * h] - dr;
+				di = y[k + 2 * h] - di;
+				tr = cr * w2r - ci * w2i;
+				ti = cr * w2i + ci * w2r;
+				cr = tr;
+				ci = ti;
+				tr = dr * w2r - di * w2i;
+				ti = dr * w2i + di * w2r;
+				dr = ti * sign;
+				di = -tr * sign;
+				x[k] = ar + cr;
+				y[k] = ai + ci;
+				x[k + 2 * h] = ar - cr;
+				y[k + 2 * h] = ai - ci;
+				x[k + h] = br + dr;
+				y[k + h] = bi + di;
+				x[k + 3 * h] = br - dr;
+				y[k + 3 * h] = bi - di;
+			}
+		}
+	}
+}
+
+/* Forward transformation of n real samples.
+ *
+ * The samples are transformed as n/2 complex samples, then the spectrum is
+ * separated. 'out' receives n/2 + 1 complex values (n + 2 floats), which is
+ * the non-negative half of the spectrum. It may be the same buffer as 'in'.
+ */
+void fft_plan_real(fft_plan_t *plan, const float *in, float *out)
+{
+	int n = plan->n, half = n / 2, k;
+	const float *tw = plan->tw;
+	float zr, zi, cr, ci, er, ei, or, oi, wr, wi;
+
+	if (out != in)
+		memcpy(out, in, n * sizeof(*out));
+	if (n < 2) {
+		out[1] = 0.0;
+		return;
+	}
+	kernel_complex(plan, 1, 1, out);
+
+	/* DC and nyquist frequency */
+	zr = out[0];
+	zi = out[1];
+	out[0] = zr + zi;
+	out[1] = 0.0;
+	out[half * 2] = zr - zi;
+	out[half * 2 + 1] = 0.0;
+
+	/* X[k] = E[k] + W^k * O[k], with E and O taken from Z[k] and Z[n/2-k] */
+	for (k = 1; k <= half / 2; k++) {
+		zr = out[k * 2];
+		zi = out[k * 2 + 1];
+		cr = out[(half - k) * 2];
+		ci = -out[(half - k) * 2 + 1];
+		/* bin k */
+		er = (zr + cr) * 0.5;
+		ei = (zi + ci) * 0.5;
+		or = (zi - ci) * 0.5;
+		oi = -(zr - cr) * 0.5;
+		wr = tw[k * 2];
+		wi = tw[k * 2 + 1];
+		out[k * 2] = er + or * wr - oi * wi;
+		out[k * 2 + 1] = ei + or * wi + oi * wr;
+		if (k == half - k)
+			break;
+		/* bin n/2-k, Z swapped, W^(n/2-k) = -conj(W^k) */
+		er = (cr + zr) * 0.5;
+		ei = -(ci + zi) * 0.5;
+		or = -(ci - zi) * 0.5;
+		oi = -(cr - zr) * 0.5;
+		wr = -tw[k * 2];
+		wi = tw[k * 2 + 1];
+		out[(half - k) * 2] = er + or * wr - oi * wi;
+		out[(half - k) * 2 + 1] = ei + or * wi + oi * wr;
+	}
+}
+
+/*
+ * Compatibility to plain FFT calls
  *
  * This computes an in-place complex-to-complex FFT 
  * x and y are the real and imaginary arrays of 2^m points.
- * dir =  1 gives forward transform
+ * dir =  1 gives forward transform (scaled by 1/n)
  * dir = -1 gives reverse transform 
+ *
+ * Plans are created on first use and kept for each size.
  */
+#define FFT_CACHE_M	20
+static fft_plan_t *plan_cache[FFT_CACHE_M + 1];
+
 void fft_process(int dir, int m, double *x, double *y)
 {
-	int	n, i, i1, j, k, i2, l, l1, l2;
-	double	c1, c2, tx, ty, t1, t2, u1, u2, z;
-
-	/* Calculate the number of points */
-	n = 1 << m;
-
-	/* Do the bit reversal */
-	i2 = n >> 1;
-	j = 0;
-	for (i = 0; i < n - 1; i++) {
-		if (i < j) {
-			tx = x[i];
-			ty = y[i];
-			x[i] = x[j];
-			y[i] = y[j];
-			x[j] = tx;
-			y[j] = ty;
+	fft_plan_t *plan, temp, *expected = NULL;
+	int n = 1 << m, i;
+
+	plan = (m <= FFT_CACHE_M) ? __atomic_load_n(&plan_cache[m], __ATOMIC_ACQUIRE) : NULL;
+	if (!plan) {
+		if (fft_plan_init(&temp, m))
+			abort();
+		if (m > FFT_CACHE_M) {
+			fft_plan_complex_split(&temp, dir, x, y);
+			fft_plan_exit(&temp);
+			goto scale;
 		}
-		k = i2;
-		while (k <= j) {
-			j -= k;
-			k >>= 1;
+		plan = malloc(sizeof(*plan));
+		if (!plan) {
+			fprintf(stderr, "No mem!\n");
+			abort();
 		}
-		j += k;
-	}
-
-	/* Compute the FFT */
-	c1 = -1.0; 
-	c2 = 0.0;
-	l2 = 1;
-	for (l = 0; l < m; l++) {
-		l1 = l2;
-		l2 <<= 1;
-		u1 = 1.0; 
-		u2 = 0.0;
-		for (j = 0; j < l1; j++) {
-			for (i = j; i < n; i += l2) {
-				i1 = i + l1;
-				t1 = u1 * x[i1] - u2 * y[i1];
-				t2 = u1 * y[i1] + u2 * x[i1];
-				x[i1] = x[i] - t1; 
-				y[i1] = y[i] - t2;
-				x[i] += t1;
-				y[i] += t2;
-			}
-			z =  u1 * c1 - u2 * c2;
-			u2 = u1 * c2 + u2 * c1;
-			u1 = z;
+		*plan = temp;
+		/* another thread may have created the plan in the meantime */
+		if (!__atomic_compare_exchange_n(&plan_cache[m], &expected, plan, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			fft_plan_exit(plan);
+			free(plan);
+			plan = expected;
 		}
-		c2 = sqrt((1.0 - c1) / 2.0);
-		if (dir == 1) 
-			c2 = -c2;
-		c1 = sqrt((1.0 + c1) / 2.0);
 	}
+	fft_plan_complex_split(plan, dir, x, y);
 
+scale:
 	/* Scaling for forward transform */
 	if (dir == 1) {
 		for (i = 0; i < n; i++) {
@@ -1,3 +1,22 @@
+#ifndef _FFT_H
+#define _FFT_H
+
+/* FFT plan, create once for each size and use it for many transformations */
+typedef struct fft_plan {
+	int	m;		/* log2 of size */
+	int	n;		/* size */
+	int	*rev;		/* bit reversal table */
+	float	*tw;		/* twiddle factors exp(-j*2*pi*k/n) for k < n/2, interleaved */
+	double	*tw_re;		/* same in double precision */
+	double	*tw_im;
+} fft_plan_t;
+
+int fft_plan_init(fft_plan_t *plan, int m);
+void fft_plan_exit(fft_plan_t *plan);
+void fft_plan_complex(fft_plan_t *plan, int dir, float *data);
+void fft_plan_complex_split(fft_plan_t *plan, int dir, double *x, double *y);
+void fft_plan_real(fft_plan_t *plan, const float *in, float *out);
 
 void fft_process(int dir, int m, double *x, double *y);
 
+#endif /* _FFT_H */
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "../libsample/sample.h"
+#include "../libfft/fft.h"
 #include "fir_filter.h"
 
 //#define DEBUG_TAPS
@@ -107,6 +108,44 @@ static fir_filter_t *fir_init(double samplerate, double transition_bandwidth)
 	return fir;
 }
 
+/* Prepare FFT convolution, if the filter has many taps.
+ *
+ * The FFT size is at least four times the number of taps, so that three
+ * quarters of each FFT are new samples.
+ */
+static fir_filter_t *fir_init_fft(fir_filter_t *fir)
+{
+	int i;
+
+	if (fir->ntaps < FIR_FFT_TAPS)
+		return fir;
+
+	for (fir->fft_m = 1; (1 << fir->fft_m) < fir->ntaps * 4; fir->fft_m++);
+	fir->fft_n = 1 << fir->fft_m;
+
+	fir->fft_hx = calloc(fir->fft_n * 4, sizeof(*fir->fft_hx));
+	if (!fir->fft_hx) {
+		fprintf(stderr, "No memory creating FIR filter!\n");
+		fir_exit(fir);
+		return NULL;
+	}
+	fir->fft_hy = fir->fft_hx + fir->fft_n;
+	fir->fft_x = fir->fft_hy + fir->fft_n;
+	fir->fft_y = fir->fft_x + fir->fft_n;
+
+	/* the oldest sample is multiplied with the first tap, so the taps are reversed for convolution */
+	for (i = 0; i < fir->ntaps; i++)
+		fir->fft_hx[i] = fir->taps[fir->ntaps - 1 - i];
+	fft_process(1, fir->fft_m, fir->fft_hx, fir->fft_hy);
+	/* forward FFT scales by 1/n, but we need it only once */
+	for (i = 0; i < fir->fft_n; i++) {
+		fir->fft_hx[i] *= (double)fir->fft_n;
+		fir->fft_hy[i] *= (double)fir->fft_n;
+	}
+
+	return fir;
+}
+
 fir_filter_t *fir_lowpass_init(double samplerate, double cutoff, double transition_bandwidth)
 {
 	/* calculate kernel */
@@ -114,7 +153,7 @@ fir_filter_t *fir_lowpass_init(double samplerate, double cutoff, double transiti
 	if (!fir)
 		return NULL;
 	kernel(fir->taps, fir->ntaps - 1, cutoff / samplerate, 0);
-	return fir;
+	return fir_init_fft(fir);
 }
 
 fir_filter_t *fir_highpass_init(double samplerate, double cutoff, double transition_bandwidth)
@@ -123,7 +162,7 @@ fir_filter_t *fir_highpass_init(double samplerate, double cutoff, double transit
 	if (!fir)
 		return NULL;
 	kernel(fir->taps, fir->ntaps - 1, cutoff / samplerate, 1);
-	return fir;
+	return fir_init_fft(fir);
 }
 
 fir_filter_t *fir_allpass_init(double samplerate, double transition_bandwidth)
@@ -132,7 +171,7 @@ fir_filter_t *fir_allpass_init(double samplerate, double transition_bandwidth)
 	if (!fir)
 		return NULL;
 	fir->taps[(fir->ntaps - 1) / 2] = 1.0;
-	return fir;
+	return fir_init_fft(fir);
 }
 
 fir_filter_t *fir_twopass_init(double samplerate, double cutoff_low, double cutoff_high, double transition_bandwidth)
@@ -164,14 +203,78 @@ void fir_exit(fir_filter_t *fir)
 		return;
 	free(fir->taps);
 	free(fir->buffer);
+	free(fir->fft_hx);
+	free(fir->poly);
+	free(fir->hist);
 	free(fir);
 }
 
+/* Overlap-save convolution of a chunk that fits into the FFT.
+ *
+ * The FFT buffer is filled with the last ntaps - 1 samples from the ring
+ * buffer, followed by the new samples. After convolution, the new samples are
+ * stored in the ring buffer, so that direct and FFT convolution can be mixed.
+ */
+static void fir_process_fft(fir_filter_t *fir, sample_t *samples, int num)
+{
+	int ntaps = fir->ntaps, n = fir->fft_n;
+	double *x = fir->fft_x, *y = fir->fft_y;
+	double *hx = fir->fft_hx, *hy = fir->fft_hy;
+	double re, im;
+	int i, pos;
+
+	/* the oldest sample is at buffer_pos, skip it */
+	pos = fir->buffer_pos;
+	for (i = 0; i < ntaps - 1; i++) {
+		if (++pos == ntaps)
+			pos = 0;
+		x[i] = fir->buffer[pos];
+	}
+	for (i = 0; i < num; i++)
+		x[ntaps - 1 + i] = samples[i];
+	for (i = ntaps - 1 + num; i < n; i++)
+		x[i] = 0.0;
+	memset(y, 0, n * sizeof(*y));
+
+	/* store last samples in ring buffer */
+	for (i = (num > ntaps) ? num - ntaps : 0; i < num; i++) {
+		fir->buffer[fir->buffer_pos] = samples[i];
+		if (++fir->buffer_pos == ntaps)
+			fir->buffer_pos = 0;
+	}
+
+	fft_process(1, fir->fft_m, x, y);
+	for (i = 0; i < n; i++) {
+		re = x[i] * hx[i] - y[i] * hy[i];
+		im = x[i] * hy[i] + y[i] * hx[i];
+		x[i] = re;
+		y[i] = im;
+	}
+	fft_process(-1, fir->fft_m, x, y);
+
+	/* the first ntaps - 1 results are wrapped around, they are discarded */
+	for (i = 0; i < num; i++)
+		samples[i] = x[ntaps - 1 + i];
+}
+
 void fir_process(fir_filter_t *fir, sample_t *samples, int num)
 {
 	int i, j;
 	double y;
 
+	/* use FFT convolution, if there are enough samples to make it worth */
+	if (fir->fft_m && num >= fir->ntaps) {
+		int chunk = fir->fft_n - fir->ntaps + 1;
+		while (num) {
+			if (chunk > num)
+				chunk = num;
+			fir_process_fft(fir, samples, chunk);
+			samples += chunk;
+			num -= chunk;
+		}
+		return;
+	}
+
 	for (i = 0; i < num; i++) {
 		/* put sample in ring buffer */
 		fir->buffer[fir->buffer_pos] = samples[i];
@@ -190,8 +293,226 @@ void fir_process(fir_filter_t *fir, sample_t *samples, int num)
 	}
 }
 
+/* Overlap-save convolution of two real signals at once, one as real part
+ * and one as imaginary part. Because the taps are real, the result's real
+ * and imaginary parts are the filtered signals.
+ */
+static void fir_process_fft_iq(fir_filter_t *fir_i, fir_filter_t *fir_q, sample_t *I, sample_t *Q, int num)
+{
+	int ntaps = fir_i->ntaps, n = fir_i->fft_n;
+	double *x = fir_i->fft_x, *y = fir_i->fft_y;
+	double *hx = fir_i->fft_hx, *hy = fir_i->fft_hy;
+	double re, im;
+	int i, pos_i, pos_q;
+
+	pos_i = fir_i->buffer_pos;
+	pos_q = fir_q->buffer_pos;
+	for (i = 0; i < ntaps - 1; i++) {
+		if (++pos_i == ntaps)
+			pos_i = 0;
+		if (++pos_q == ntaps)
+			pos_q = 0;
+		x[i] = fir_i->buffer[pos_i];
+		y[i] = fir_q->buffer[pos_q];
+	}
+	for (i = 0; i < num; i++) {
+		x[ntaps - 1 + i] = I[i];
+		y[ntaps - 1 + i] = Q[i];
+	}
+	for (i = ntaps - 1 + num; i < n; i++)
+		x[i] = y[i] = 0.0;
+
+	for (i = (num > ntaps) ? num - ntaps : 0; i < num; i++) {
+		fir_i->buffer[fir_i->buffer_pos] = I[i];
+		if (++fir_i->buffer_pos == ntaps)
+			fir_i->buffer_pos = 0;
+		fir_q->buffer[fir_q->buffer_pos] = Q[i];
+		if (++fir_q->buffer_pos == ntaps)
+			fir_q->buffer_pos = 0;
+	}
+
+	fft_process(1, fir_i->fft_m, x, y);
+	for (i = 0; i < n; i++) {
+		re = x[i] * hx[i] - y[i] * hy[i];
+		im = x[i] * hy[i] + y[i] * hx[i];
+		x[i] = re;
+		y[i] = im;
+	}
+	fft_process(-1, fir_i->fft_m, x, y);
+
+	for (i = 0; i < num; i++) {
+		I[i] = x[ntaps - 1 + i];
+		Q[i] = y[ntaps - 1 + i];
+	}
+}
+
+/* filter I and Q with two filters that have equal taps, using one FFT for both */
+void fir_process_iq(fir_filter_t *fir_i, fir_filter_t *fir_q, sample_t *I, sample_t *Q, int num)
+{
+	if (!fir_i->fft_m || num < fir_i->ntaps || fir_q->ntaps != fir_i->ntaps) {
+		fir_process(fir_i, I, num);
+		fir_process(fir_q, Q, num);
+		return;
+	}
+
+	int chunk = fir_i->fft_n - fir_i->ntaps + 1;
+	while (num) {
+		if (chunk > num)
+			chunk = num;
+		fir_process_fft_iq(fir_i, fir_q, I, Q, chunk);
+		I += chunk;
+		Q += chunk;
+		num -= chunk;
+	}
+}
+
 int fir_get_delay(fir_filter_t *fir)
 {
 	return fir->delay;
 }
 
+
+/* Decimating low-pass filter
+ *
+ * The filter is designed at the given (input) sample rate. Only every
+ * 'factor'th output sample is calculated, so the cost is that of a filter
+ * running at the output sample rate. The delay is given in input samples.
+ */
+fir_filter_t *fir_decimate_init(double samplerate, int factor, double cutoff, double transition_bandwidth)
+{
+	fir_filter_t *fir;
+
+	if (factor < 1) {
+		fprintf(stderr, "Invalid decimation factor %d!\n", factor);
+		return NULL;
+	}
+
+	fir =  fir_init(samplerate, transition_bandwidth);
+	if (!fir)
+		return NULL;
+	kernel(fir->taps, fir->ntaps - 1, cutoff / samplerate, 0);
+	fir->factor = factor;
+
+	fir->hist_len = fir->ntaps;
+	fir->hist = calloc(fir->hist_len * 2, sizeof(*fir->hist));
+	if (!fir->hist) {
+		fprintf(stderr, "No memory creating FIR filter!\n");
+		fir_exit(fir);
+		return NULL;
+	}
+
+	return fir;
+}
+
+/* Filter and decimate 'num' input samples. Returns the number of output
+ * samples. The output may be the same buffer as the input.
+ */
+int fir_decimate_process(fir_filter_t *fir, sample_t *in, int num, sample_t *out)
+{
+	int ntaps = fir->ntaps;
+	double *taps = fir->taps, *x;
+	double y;
+	int i, j, count = 0;
+
+	for (i = 0; i < num; i++) {
+		/* put sample in history */
+		fir->hist[fir->hist_pos] = in[i];
+		fir->hist[fir->hist_pos + ntaps] = in[i];
+		if (++fir->hist_pos == ntaps)
+			fir->hist_pos = 0;
+
+		if (++fir->phase < fir->factor)
+			continue;
+		fir->phase = 0;
+
+		/* convolve samples, starting with oldest */
+		x = fir->hist + fir->hist_pos;
+		y = 0;
+		for (j = 0; j < ntaps; j++)
+			y += x[j] * taps[j];
+		out[count++] = y;
+	}
+
+	return count;
+}
+
+/* Interpolating low-pass filter
+ *
+ * The filter is designed at the given (output) sample rate. The taps are split
+ * into 'factor' polyphase branches, so that each output sample is calculated
+ * from the input samples only, without multiplying the inserted zeros. The
+ * delay is given in output samples.
+ */
+fir_filter_t *fir_interpolate_init(double samplerate, int factor, double cutoff, double transition_bandwidth)
+{
+	fir_filter_t *fir;
+	int p, j, k, K;
+
+	if (factor < 1) {
+		fprintf(stderr, "Invalid interpolation factor %d!\n", factor);
+		return NULL;
+	}
+
+	fir =  fir_init(samplerate, transition_bandwidth);
+	if (!fir)
+		return NULL;
+	kernel(fir->taps, fir->ntaps - 1, cutoff / samplerate, 0);
+	fir->factor = factor;
+
+	K = (fir->ntaps + factor - 1) / factor;
+	fir->poly_ntaps = K;
+	fir->poly = calloc(K * factor, sizeof(*fir->poly));
+	fir->hist_len = K;
+	fir->hist = calloc(fir->hist_len * 2, sizeof(*fir->hist));
+	if (!fir->poly || !fir->hist) {
+		fprintf(stderr, "No memory creating FIR filter!\n");
+		fir_exit(fir);
+		return NULL;
+	}
+
+	/* branch p gets taps p, p + factor, ...; reversed so that the oldest
+	 * sample comes first. the gain is raised by factor to compensate the
+	 * inserted zeros. */
+	for (p = 0; p < factor; p++) {
+		for (j = 0; j < K; j++) {
+			k = p + (K - 1 - j) * factor;
+			if (k < fir->ntaps)
+				fir->poly[p * K + j] = fir->taps[fir->ntaps - 1 - k] * (double)factor;
+		}
+	}
+
+	return fir;
+}
+
+/* Interpolate 'num' input samples. 'out' must have space for num * factor
+ * samples and must not be the input buffer. Returns the number of output
+ * samples.
+ */
+int fir_interpolate_process(fir_filter_t *fir, sample_t *in, int num, sample_t *out)
+{
+	int K = fir->poly_ntaps, factor = fir->factor;
+	double *poly, *x;
+	double y;
+	int i, j, p;
+
+	for (i = 0; i < num; i++) {
+		/* put sample in history */
+		fir->hist[fir->hist_pos] = in[i];
+		fir->hist[fir->hist_pos + K] = in[i];
+		if (++fir->hist_pos == K)
+			fir->hist_pos = 0;
+
+		/* calculate one output sample for each branch */
+		x = fir->hist + fir->hist_pos;
+		poly = fir->poly;
+		for (p = 0; p < factor; p++) {
+			y = 0;
+			for (j = 0; j < K; j++)
+				y += x[j] * poly[j];
+			*out++ = y;
+			poly += K;
+		}
+	}
+
+	return num * factor;
+}
@@ -1,12 +1,26 @@
 #ifndef _FIR_FILTER_H
 #define _FIR_FILTER_H
 
+/* use FFT convolution (overlap-save) for filters with this number of taps or more */
+#define FIR_FFT_TAPS	64
+
 typedef struct fir_filter {
 	int	ntaps;
 	int	delay;
 	double	*taps;
 	double	*buffer;
 	int	buffer_pos;
+	int	fft_m;		/* log2 of FFT size, 0 for direct convolution */
+	int	fft_n;		/* FFT size */
+	double	*fft_hx, *fft_hy; /* spectrum of taps (scaled) */
+	double	*fft_x, *fft_y;	/* FFT buffer */
+	int	factor;		/* decimation or interpolation factor */
+	int	phase;		/* input samples since last output (decimation) */
+	int	poly_ntaps;	/* taps per polyphase branch (interpolation) */
+	double	*poly;		/* polyphase branches, oldest sample first (interpolation) */
+	double	*hist;		/* history of input samples, stored twice to avoid wrapping */
+	int	hist_len;
+	int	hist_pos;
 } fir_filter_t;
 
 fir_filter_t *fir_lowpass_init(double samplerate, double cutoff, double transition_bandwidth);
@@ -15,7 +29,12 @@ fir_filter_t *fir_allpass_init(double samplerate, double transition_bandwidth);
 fir_filter_t *fir_twopass_init(double samplerate, double cutoff_low, double cutoff_high, double transition_bandwidth);
 void fir_exit(fir_filter_t *fir);
 void fir_process(fir_filter_t *fir, sample_t *samples, int num);
+void fir_process_iq(fir_filter_t *fir_i, fir_filter_t *fir_q, sample_t *I, sample_t *Q, int num);
 int fir_get_delay(fir_filter_t *fir);
+fir_filter_t *fir_decimate_init(double samplerate, int factor, double cutoff, double transition_bandwidth);
+int fir_decimate_process(fir_filter_t *fir, sample_t *in, int num, sample_t *out);
+fir_filter_t *fir_interpolate_init(double samplerate, int factor, double cutoff, double transition_bandwidth);
+int fir_interpolate_process(fir_filter_t *fir, sample_t *in, int num, sample_t *out);
 
 #endif /* _FIR_FILTER_H */
 
@@ -0,0 +1,139 @@
+/* bank of equal IIR filters for many channels
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "../libsample/sample.h"
+#include "iir_bank.h"
+
+/* init bank with coefficients of given filter (e.g. from iir_lowpass_init()) */
+int iir_bank_init(iir_bank_t *bank, const iir_filter_t *filter, int channels)
+{
+	memset(bank, 0, sizeof(*bank));
+
+	bank->z1 = calloc(filter->iter * channels * 2, sizeof(*bank->z1));
+	if (!bank->z1) {
+		fprintf(stderr, "No mem!\n");
+		return -ENOMEM;
+	}
+	bank->z2 = bank->z1 + filter->iter * channels;
+
+	bank->channels = channels;
+	bank->iter = filter->iter;
+	bank->a0 = filter->a0;
+	bank->a1 = filter->a1;
+	bank->a2 = filter->a2;
+	bank->b1 = filter->b1;
+	bank->b2 = filter->b2;
+
+	return 0;
+}
+
+void iir_bank_exit(iir_bank_t *bank)
+{
+	free(bank->z1);
+	bank->z1 = bank->z2 = NULL;
+}
+
+/* filter all channels, samples is a list of one buffer for each channel
+ *
+ * the channels are processed in tiles of IIR_BANK_TILE channels, so the
+ * states of a tile stay in registers while all samples are filtered. the
+ * last tile is filled up with the first channel of the tile, but these
+ * results are not stored.
+ */
+void iir_bank_process(iir_bank_t *bank, sample_t **samples, int length)
+{
+	double a0 = bank->a0, a1 = bank->a1, a2 = bank->a2, b1 = bank->b1, b2 = bank->b2;
+	double z1[IIR_MAX_ITER][IIR_BANK_TILE], z2[IIR_MAX_ITER][IIR_BANK_TILE], in[IIR_BANK_TILE];
+	sample_t *spl[IIR_BANK_TILE];
+	int channels = bank->channels, iter = bank->iter;
+	int i, j, c, t, w;
+
+	for (c = 0; c < channels; c += IIR_BANK_TILE) {
+		w = channels - c;
+		if (w > IIR_BANK_TILE)
+			w = IIR_BANK_TILE;
+		for (t = 0; t < IIR_BANK_TILE; t++) {
+			spl[t] = samples[c + ((t < w) ? t : 0)];
+			for (j = 0; j < iter; j++) {
+				z1[j][t] = (t < w) ? bank->z1[j * channels + c + t] : 0.0;
+				z2[j][t] = (t < w) ? bank->z2[j * channels + c + t] : 0.0;
+			}
+		}
+		for (i = 0; i < length; i++) {
+			/* add a small value, see iir_process() */
+			for (t = 0; t < IIR_BANK_TILE; t++)
+				in[t] = spl[t][i] + 0.000000001;
+			for (j = 0; j < iter; j++) {
+				/* this loop runs across channels, so it can be vectorized */
+				for (t = 0; t < IIR_BANK_TILE; t++) {
+					double out = in[t] * a0 + z1[j][t];
+					z1[j][t] = in[t] * a1 + z2[j][t] - b1 * out;
+					z2[j][t] = in[t] * a2 - b2 * out;
+					in[t] = out;
+				}
+			}
+			/* backwards, so the first channel is written last, if it fills the tile */
+			for (t = w - 1; t >= 0; t--)
+				spl[t][i] = in[t];
+		}
+		for (t = 0; t < w; t++) {
+			for (j = 0; j < iter; j++) {
+				bank->z1[j * channels + c + t] = z1[j][t];
+				bank->z2[j * channels + c + t] = z2[j][t];
+			}
+		}
+	}
+}
+
+/* check if filter has the same coefficients as the bank */
+int iir_bank_match(const iir_bank_t *bank, const iir_filter_t *filter)
+{
+	return bank->z1 && filter->iter == bank->iter
+	    && filter->a0 == bank->a0 && filter->a1 == bank->a1 && filter->a2 == bank->a2
+	    && filter->b1 == bank->b1 && filter->b2 == bank->b2;
+}
+
+/* copy states of a single filter into a channel of the bank
+ * this way, filters that are processed by a bank only for a while keep their states
+ */
+void iir_bank_load(iir_bank_t *bank, int channel, const iir_filter_t *filter)
+{
+	int j;
+
+	for (j = 0; j < bank->iter; j++) {
+		bank->z1[j * bank->channels + channel] = filter->z1[j];
+		bank->z2[j * bank->channels + channel] = filter->z2[j];
+	}
+}
+
+/* copy states of a channel of the bank back into a single filter */
+void iir_bank_store(const iir_bank_t *bank, int channel, iir_filter_t *filter)
+{
+	int j;
+
+	for (j = 0; j < bank->iter; j++) {
+		filter->z1[j] = bank->z1[j * bank->channels + channel];
+		filter->z2[j] = bank->z2[j * bank->channels + channel];
+	}
+}
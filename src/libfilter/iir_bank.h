@@ -0,0 +1,28 @@
+#ifndef _IIR_BANK_H
+#define _IIR_BANK_H
+
+#include "iir_filter.h"
+
+/* bank of equal IIR filters for many channels
+ *
+ * the states are stored as structure of arrays (all channels of one
+ * iteration are adjacent), so the compiler can filter several channels with
+ * one SIMD instruction.
+ */
+#define IIR_BANK_TILE	4	/* channels processed together */
+
+typedef struct iir_bank {
+	int channels;		/* number of channels */
+	int iter;		/* number of iterations (cascaded biquads) */
+	double a0, a1, a2, b1, b2;
+	double *z1, *z2;	/* states: iter * channels */
+} iir_bank_t;
+
+int iir_bank_init(iir_bank_t *bank, const iir_filter_t *filter, int channels);
+void iir_bank_exit(iir_bank_t *bank);
+void iir_bank_process(iir_bank_t *bank, sample_t **samples, int length);
+int iir_bank_match(const iir_bank_t *bank, const iir_filter_t *filter);
+void iir_bank_load(iir_bank_t *bank, int channel, const iir_filter_t *filter);
+void iir_bank_store(const iir_bank_t *bank, int channel, iir_filter_t *filter);
+
+#endif /* _IIR_BANK_H */
@@ -29,14 +29,19 @@
 
 #define PI M_PI
 
+static void check_iterations(const char *func, int iterations)
+{
+	if (iterations > IIR_MAX_ITER) {
+		fprintf(stderr, "%s failed: too many iterations, use iir_cascade_t, please fix!\n", func);
+		abort();
+	}
+}
+
 void iir_lowpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations)
 {
 	double Fc, Q, K, norm;
 
-	if (iterations > 64) {
-		fprintf(stderr, "%s failed: too many iterations, please fix!\n", __func__);
-		abort();
-	}
+	check_iterations(__func__, iterations);
 
 	memset(filter, 0, sizeof(*filter));
 	filter->iter = iterations;
@@ -58,6 +63,8 @@ void iir_highpass_init(iir_filter_t *filter, double frequency, int samplerate, i
 {
 	double Fc, Q, K, norm;
 
+	check_iterations(__func__, iterations);
+
 	memset(filter, 0, sizeof(*filter));
 	filter->iter = iterations;
 	Q = pow(sqrt(0.5), 1.0 / (double)iterations); /* 0.7071 @ 1 iteration */
@@ -71,13 +78,14 @@ void iir_highpass_init(iir_filter_t *filter, double frequency, int samplerate, i
 	filter->b2 = (1 - K / Q + K * K) * norm;
 }
 
-void iir_bandpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations)
+/* Q is given by the total number of iterations, which may be more than this filter has */
+static void bandpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations, int total)
 {
 	double Fc, Q, K, norm;
 
 	memset(filter, 0, sizeof(*filter));
 	filter->iter = iterations;
-	Q = pow(sqrt(0.5), 1.0 / (double)iterations); /* 0.7071 @ 1 iteration */
+	Q = pow(sqrt(0.5), 1.0 / (double)total); /* 0.7071 @ 1 iteration */
 	Fc = frequency / (double)samplerate;
 	K = tan(PI * Fc);
 	norm = 1 / (1 + K / Q + K * K);
@@ -88,10 +96,39 @@ void iir_bandpass_init(iir_filter_t *filter, double frequency, int samplerate, i
 	filter->b2 = (1 - K / Q + K * K) * norm;
 }
 
+void iir_bandpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations)
+{
+	check_iterations(__func__, iterations);
+
+	bandpass_init(filter, frequency, samplerate, iterations, iterations);
+}
+
+/* the iterations are split to filters of IIR_MAX_ITER iterations */
+void iir_bandpass_cascade_init(iir_cascade_t *cascade, double frequency, int samplerate, int iterations)
+{
+	int total = iterations;
+	int i, iter;
+
+	if (iterations > IIR_MAX_ITER * IIR_MAX_CASCADE) {
+		fprintf(stderr, "%s failed: too many iterations, please fix!\n", __func__);
+		abort();
+	}
+
+	memset(cascade, 0, sizeof(*cascade));
+	for (i = 0; iterations; i++) {
+		iter = (iterations > IIR_MAX_ITER) ? IIR_MAX_ITER : iterations;
+		bandpass_init(&cascade->filter[i], frequency, samplerate, iter, total);
+		iterations -= iter;
+	}
+	cascade->num = i;
+}
+
 void iir_notch_init(iir_filter_t *filter, double frequency, int samplerate, int iterations, double Q)
 {
 	double Fc, K, norm;
 
+	check_iterations(__func__, iterations);
+
 	memset(filter, 0, sizeof(*filter));
 	filter->iter = iterations;
 	Fc = frequency / (double)samplerate;
@@ -137,6 +174,57 @@ void iir_process(iir_filter_t *filter, sample_t *samples, int length)
 	}
 }
 
+void iir_cascade_process(iir_cascade_t *cascade, sample_t *samples, int length)
+{
+	int i;
+
+	for (i = 0; i < cascade->num; i++)
+		iir_process(&cascade->filter[i], samples, length);
+}
+
+/* process I and Q with two filters of equal coefficients in one loop
+ * both chains are independent, so they run in parallel on the CPU */
+void iir_process_iq(iir_filter_t *filter_i, iir_filter_t *filter_q, sample_t *I, sample_t *Q, int length)
+{
+	double a0, a1, a2, b1, b2;
+	double *z1_i, *z2_i, *z1_q, *z2_q;
+	double in_i, in_q, out_i, out_q;
+	int iterations = filter_i->iter;
+	int i, j;
+
+	/* get states */
+	a0 = filter_i->a0;
+	a1 = filter_i->a1;
+	a2 = filter_i->a2;
+	b1 = filter_i->b1;
+	b2 = filter_i->b2;
+
+	/* these are state pointers, so no need to write back */
+	z1_i = filter_i->z1;
+	z2_i = filter_i->z2;
+	z1_q = filter_q->z1;
+	z2_q = filter_q->z2;
+
+	/* process filter */
+	for (i = 0; i < length; i++) {
+		/* add a small value, see iir_process() */
+		in_i = I[i] + 0.000000001;
+		in_q = Q[i] + 0.000000001;
+		for (j = 0; j < iterations; j++) {
+			out_i = in_i * a0 + z1_i[j];
+			out_q = in_q * a0 + z1_q[j];
+			z1_i[j] = in_i * a1 + z2_i[j] - b1 * out_i;
+			z1_q[j] = in_q * a1 + z2_q[j] - b1 * out_q;
+			z2_i[j] = in_i * a2 - b2 * out_i;
+			z2_q[j] = in_q * a2 - b2 * out_q;
+			in_i = out_i;
+			in_q = out_q;
+		}
+		I[i] = in_i;
+		Q[i] = in_q;
+	}
+}
+
 #ifdef DEBUG_NAN
 #pragma GCC push_options
 //#pragma GCC optimize ("O0")
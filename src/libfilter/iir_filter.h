@@ -1,17 +1,31 @@
 #ifndef _FILTER_H
 #define _FILTER_H
 
+/* maximum iterations of one filter, so the filter fits into two cache lines */
+#define IIR_MAX_ITER	4
+
 typedef struct iir_filter {
 	int iter;
 	double a0, a1, a2, b1, b2;
-	double z1[64], z2[64];
+	double z1[IIR_MAX_ITER], z2[IIR_MAX_ITER];
 } iir_filter_t;
 
+/* cascade of filters, for the rare filters with more than IIR_MAX_ITER iterations */
+#define IIR_MAX_CASCADE	16
+
+typedef struct iir_cascade {
+	int num;
+	iir_filter_t filter[IIR_MAX_CASCADE];
+} iir_cascade_t;
+
 void iir_lowpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations);
 void iir_highpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations);
 void iir_bandpass_init(iir_filter_t *filter, double frequency, int samplerate, int iterations);
 void iir_notch_init(iir_filter_t *filter, double frequency, int samplerate, int iterations, double Q);
 void iir_process(iir_filter_t *filter, sample_t *samples, int length);
+void iir_process_iq(iir_filter_t *filter_i, iir_filter_t *filter_q, sample_t *I, sample_t *Q, int length);
 void iir_process_baseband(iir_filter_t *filter, float *baseband, int length);
+void iir_bandpass_cascade_init(iir_cascade_t *cascade, double frequency, int samplerate, int iterations);
+void iir_cascade_process(iir_cascade_t *cascade, sample_t *samples, int length);
 
 #endif /* _FILTER_H */
@@ -28,6 +28,7 @@
 
 static int has_init = 0;
 static int fast_math = 0;
+/* built once by fm_init(), shared read-only by all demodulators */
 static float *sin_tab = NULL, *cos_tab = NULL;
 
 /* global init */
@@ -35,7 +36,8 @@ int fm_init(int _fast_math)
 {
 	fast_math = _fast_math;
 
-	if (fast_math) {
+	/* vector and phasor math do not use tables */
+	if (fast_math == FM_MATH_TABLE) {
 		int i;
 
 		sin_tab = calloc(65536+16384, sizeof(*sin_tab));
@@ -45,9 +47,15 @@ int fm_init(int _fast_math)
 		}
 		cos_tab = sin_tab + 16384;
 
-		/* generate sine and cosine */
-		for (i = 0; i < 65536+16384; i++)
+		/* generate sine and cosine from the first quarter of a sine wave */
+		for (i = 0; i <= 16384; i++)
 			sin_tab[i] = sin(2.0 * M_PI * (double)i / 65536.0);
+		for (i = 16385; i < 32768; i++)
+			sin_tab[i] = sin_tab[32768 - i];
+		for (i = 32768; i < 65536; i++)
+			sin_tab[i] = -sin_tab[i - 32768];
+		for (i = 65536; i < 65536+16384; i++)
+			sin_tab[i] = sin_tab[i - 65536];
 	}
 
 	has_init = 1;
@@ -104,6 +112,47 @@ void fm_mod_exit(fm_mod_t *mod)
 	}
 }
 
+/* number of samples that are modulated by one block of vector kernel */
+#define VECTOR_BLOCK	64
+
+/* Modulate a run of samples that all have power, using float math.
+ *
+ * The phase is accumulated sequentially as 32 bit fixed point number of
+ * turns, so it wraps without branches. Sine and cosine of each block are then
+ * calculated by sincos_vector().
+ */
+static double modulate_vector(double phase, double offset, double rate, float amplitude, sample_t *frequency, int num, float *baseband)
+{
+	uint32_t turn[VECTOR_BLOCK];
+	double scale = 4294967296.0 / rate;
+	uint32_t acc;
+	int i, n;
+
+	/* phase unit is 65536 per turn, we use 2^32 per turn */
+	acc = (uint32_t)(phase * 65536.0);
+
+	while (num) {
+		n = (num > VECTOR_BLOCK) ? VECTOR_BLOCK : num;
+		/* phase accumulation, the only sequential part */
+		for (i = 0; i < n; i++) {
+			acc += (uint32_t)(int32_t)((offset + frequency[i]) * scale);
+			turn[i] = acc;
+		}
+		/* sine and cosine without branches */
+		for (i = 0; i < n; i++) {
+			float s, c;
+			sincos_vector(turn[i], amplitude, &s, &c);
+			baseband[i * 2] += c;
+			baseband[i * 2 + 1] += s;
+		}
+		frequency += n;
+		baseband += n * 2;
+		num -= n;
+	}
+
+	return (double)acc / 65536.0;
+}
+
 /* do frequency modulation of samples and add them to existing baseband */
 void fm_modulate_complex(fm_mod_t *mod, sample_t *frequency, uint8_t *power, int length, float *baseband)
 {
@@ -123,6 +172,23 @@ void fm_modulate_complex(fm_mod_t *mod, sample_t *frequency, uint8_t *power, int
 again:
 	switch (mod->state) {
 	case MOD_STATE_ON:
+		/* modulate runs of samples with constant power state */
+		if (fast_math >= FM_MATH_VECTOR) {
+			int run;
+
+			for (run = 0; run < length; run++) {
+				if (!power[run])
+					break;
+			}
+			phase = modulate_vector(phase, offset, rate, amplitude, frequency, run, baseband);
+			frequency += run;
+			power += run;
+			baseband += run * 2;
+			length -= run;
+			if (length)
+				mod->state = MOD_STATE_RAMP_DOWN;
+			break;
+		}
 		/* modulate */
 		while (length) {
 			/* is power is not set, ramp down */
@@ -173,8 +239,15 @@ again:
 					phase += 65536.0;
 				else if (phase >= 65536.0)
 					phase -= 65536.0;
-				*baseband++ += cos_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
-				*baseband++ += sin_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
+				if (sin_tab) {
+					*baseband++ += cos_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
+					*baseband++ += sin_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
+				} else {
+					float _sin, _cos;
+					sincos_vector((uint32_t)(phase * 65536.0), amplitude * ramp_tab[ramp], &_sin, &_cos);
+					*baseband++ += _cos;
+					*baseband++ += _sin;
+				}
 			} else {
 				phase += 2.0 * M_PI * dev / rate;
 				if (phase < 0.0)
@@ -222,8 +295,15 @@ again:
 					phase += 65536.0;
 				else if (phase >= 65536.0)
 					phase -= 65536.0;
-				*baseband++ += cos_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
-				*baseband++ += sin_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
+				if (sin_tab) {
+					*baseband++ += cos_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
+					*baseband++ += sin_tab[(uint16_t)phase] * amplitude * ramp_tab[ramp];
+				} else {
+					float _sin, _cos;
+					sincos_vector((uint32_t)(phase * 65536.0), amplitude * ramp_tab[ramp], &_sin, &_cos);
+					*baseband++ += _cos;
+					*baseband++ += _sin;
+				}
 			} else {
 				phase += 2.0 * M_PI * dev / rate;
 				if (phase < 0.0)
@@ -259,6 +339,8 @@ int fm_demod_init(fm_demod_t *demod, double samplerate, double offset, double ba
 		demod->rot = 65536.0 * -offset / samplerate;
 	else
 		demod->rot = 2 * M_PI * -offset / samplerate;
+	if (fast_math == FM_MATH_PHASOR)
+		nco_init(&demod->nco, 0.0, demod->rot);
 
 	/* use fourth order (2 iter) filter, since it is as fast as second order (1 iter) filter */
 	iir_lowpass_init(&demod->lp[0], bandwidth / 2.0, samplerate, 2);
@@ -305,15 +387,173 @@ static inline float fast_atan2(float y, float x)
 	return 0.0; /* x,y = 0. return 0, because NaN would harm further processing  */
 }
 
-/* do frequency demodulation of baseband and write them to samples */
-void fm_demodulate_complex(fm_demod_t *demod, sample_t *frequency, int length, float *baseband, sample_t *I, sample_t *Q)
+/* Branch-free atan2 using float math, so the compiler can vectorize.
+ *
+ * The octant is folded to 0 .. 1 using min/max, then a polynomial of 11th
+ * order is used. Error is below 1e-5 radians, which is much better than
+ * fast_atan2().
+ */
+static inline float atan2_vector(float y, float x)
+{
+	float ax, ay, d, mx, mn, a, s, r;
+
+	ax = fabsf(x);
+	ay = fabsf(y);
+	/* min and max without compare */
+	d = fabsf(ax - ay);
+	mx = (ax + ay + d) * 0.5f;
+	mn = (ax + ay - d) * 0.5f;
+	/* add a tiny value, so that 0/0 gives 0 */
+	a = mn / (mx + 1e-30f);
+	s = a * a;
+	r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f + s * (0.05265332f + s * -0.01172120f)))));
+	/* unfold octant: pi/2 - r if |y| > |x|, pi - r if x < 0 */
+	r += (float)(ay > ax) * ((float)M_PI_2 - 2.0f * r);
+	r += (float)(x < 0.0f) * ((float)M_PI - 2.0f * r);
+	return copysignf(r, y);
+}
+
+/* Rotate with float math.
+ *
+ * The rotation does not depend on previous samples, so it is calculated for
+ * the whole block with the fixed point phase of each sample. Either complex
+ * baseband or real samples are given, the other one is NULL.
+ *
+ * With phasor math, the rotation is done by the recursive phasor instead.
+ */
+static void rotate_vector(fm_demod_t *demod, int length, float *baseband, sample_t *real, sample_t *I, sample_t *Q)
+{
+	uint32_t acc, step;
+	int s;
+
+	if (fast_math == FM_MATH_PHASOR) {
+		/* phasor does the same rotation without sine and cosine */
+		nco_t nco = demod->nco;
+		if (baseband) {
+			for (s = 0; s < length; s++) {
+				nco_next(&nco);
+				I[s] = baseband[s * 2] * nco.re - baseband[s * 2 + 1] * nco.im;
+				Q[s] = baseband[s * 2] * nco.im + baseband[s * 2 + 1] * nco.re;
+			}
+		} else {
+			for (s = 0; s < length; s++) {
+				nco_next(&nco);
+				I[s] = real[s] * nco.re;
+				Q[s] = real[s] * nco.im;
+			}
+		}
+		demod->nco = nco;
+		return;
+	}
+
+	/* phase unit is 65536 per turn, we use 2^32 per turn */
+	acc = (uint32_t)(demod->phase * 65536.0);
+	step = (uint32_t)(int64_t)(demod->rot * 65536.0);
+	if (baseband) {
+		for (s = 0; s < length; s++) {
+			float _sin, _cos;
+			sample_t i, q;
+			sincos_vector(acc + step * (uint32_t)(s + 1), 1.0f, &_sin, &_cos);
+			i = baseband[s * 2];
+			q = baseband[s * 2 + 1];
+			I[s] = i * _cos - q * _sin;
+			Q[s] = i * _sin + q * _cos;
+		}
+	} else {
+		for (s = 0; s < length; s++) {
+			float _sin, _cos;
+			sincos_vector(acc + step * (uint32_t)(s + 1), 1.0f, &_sin, &_cos);
+			I[s] = real[s] * _cos;
+			Q[s] = real[s] * _sin;
+		}
+	}
+	acc += step * (uint32_t)length;
+	demod->phase = (double)acc / 65536.0;
+}
+
+/* Discriminate with float math.
+ *
+ * The phase difference is taken from the product of each IQ vector with the
+ * conjugate of the previous one, so no unwrapping is required.
+ */
+/* The level of the IQ vectors and the average, minimum and maximum frequency
+ * are measured in the same loop, so the block is not read again for the RF
+ * level and the deviation display. The loop is split into lanes, each with
+ * its own sums, so that the compiler can vectorize it without reordering
+ * float additions. Minimum and maximum are taken without compare.
+ */
+#define DISCRIMINATE_LANES	8
+
+static void discriminate_vector(fm_demod_t *demod, sample_t *frequency, int length, sample_t *I, sample_t *Q)
+{
+	float rate, f;
+	float power[DISCRIMINATE_LANES], sum[DISCRIMINATE_LANES], mn[DISCRIMINATE_LANES], mx[DISCRIMINATE_LANES];
+	sample_t li, lq;
+	int s, l;
+
+	if (!length)
+		return;
+	rate = demod->samplerate / 2.0 / M_PI;
+	li = demod->last_i;
+	lq = demod->last_q;
+	f = atan2_vector(Q[0] * li - I[0] * lq, I[0] * li + Q[0] * lq) * rate;
+	frequency[0] = f;
+	for (l = 0; l < DISCRIMINATE_LANES; l++) {
+		power[l] = 0.0f;
+		sum[l] = 0.0f;
+		mn[l] = f;
+		mx[l] = f;
+	}
+	power[0] = I[0] * I[0] + Q[0] * Q[0];
+	sum[0] = f;
+	for (s = 1; s + DISCRIMINATE_LANES <= length; s += DISCRIMINATE_LANES) {
+		for (l = 0; l < DISCRIMINATE_LANES; l++) {
+			f = atan2_vector(Q[s + l] * I[s + l - 1] - I[s + l] * Q[s + l - 1], I[s + l] * I[s + l - 1] + Q[s + l] * Q[s + l - 1]) * rate;
+			frequency[s + l] = f;
+			power[l] += I[s + l] * I[s + l] + Q[s + l] * Q[s + l];
+			sum[l] += f;
+			mn[l] = (mn[l] + f - fabsf(mn[l] - f)) * 0.5f;
+			mx[l] = (mx[l] + f + fabsf(mx[l] - f)) * 0.5f;
+		}
+	}
+	for (; s < length; s++) {
+		f = atan2_vector(Q[s] * I[s - 1] - I[s] * Q[s - 1], I[s] * I[s - 1] + Q[s] * Q[s - 1]) * rate;
+		frequency[s] = f;
+		power[0] += I[s] * I[s] + Q[s] * Q[s];
+		sum[0] += f;
+		mn[0] = (mn[0] + f - fabsf(mn[0] - f)) * 0.5f;
+		mx[0] = (mx[0] + f + fabsf(mx[0] - f)) * 0.5f;
+	}
+	demod->last_i = I[length - 1];
+	demod->last_q = Q[length - 1];
+
+	for (l = 1; l < DISCRIMINATE_LANES; l++) {
+		power[0] += power[l];
+		sum[0] += sum[l];
+		if (mn[l] < mn[0])
+			mn[0] = mn[l];
+		if (mx[l] > mx[0])
+			mx[0] = mx[l];
+	}
+	demod->meas_power = power[0] / (double)length;
+	demod->meas_avg = sum[0] / (double)length;
+	demod->meas_min = mn[0];
+	demod->meas_max = mx[0];
+}
+
+/* shift baseband to 0 Hz and write IQ vectors (first step of demodulation) */
+void fm_demodulate_rotate(fm_demod_t *demod, int length, float *baseband, sample_t *I, sample_t *Q)
 {
-	double phase, rot, last_phase, dev, rate;
+	double phase, rot;
 	double _sin, _cos;
 	sample_t i, q;
 	int s, ss;
 
-	rate = demod->samplerate;
+	if (fast_math >= FM_MATH_VECTOR) {
+		rotate_vector(demod, length, baseband, NULL, I, Q);
+		return;
+	}
+
 	phase = demod->phase;
 	rot = demod->rot;
 	for (s = 0, ss = 0; s < length; s++) {
@@ -339,9 +579,24 @@ void fm_demodulate_complex(fm_demod_t *demod, sample_t *frequency, int length, f
 		Q[s] = i * _sin + q * _cos;
 	}
 	demod->phase = phase;
-	iir_process(&demod->lp[0], I, length);
-	iir_process(&demod->lp[1], Q, length);
+}
+
+/* get frequency from filtered IQ vectors (last step of demodulation), measurements of the block are stored */
+void fm_demodulate_discriminate(fm_demod_t *demod, sample_t *frequency, int length, sample_t *I, sample_t *Q)
+{
+	double phase, last_phase, dev, rate;
+	double power, sum, min = 0.0, max = 0.0;
+	int s;
+
+	if (fast_math >= FM_MATH_VECTOR) {
+		discriminate_vector(demod, frequency, length, I, Q);
+		return;
+	}
+
+	rate = demod->samplerate;
 	last_phase = demod->last_phase;
+	power = 0.0;
+	sum = 0.0;
 	for (s = 0; s < length; s++) {
 		if (fast_math)
 			phase = fast_atan2(Q[s], I[s]);
@@ -355,18 +610,50 @@ void fm_demodulate_complex(fm_demod_t *demod, sample_t *frequency, int length, f
 			dev -= 1.0;
 		dev *= rate;
 		frequency[s] = dev;
+		/* measurements */
+		power += I[s] * I[s] + Q[s] * Q[s];
+		sum += dev;
+		if (s == 0 || dev < min)
+			min = dev;
+		if (s == 0 || dev > max)
+			max = dev;
 	}
 	demod->last_phase = last_phase;
+	if (!length)
+		return;
+	demod->meas_power = power / (double)length;
+	demod->meas_avg = sum / (double)length;
+	demod->meas_min = min;
+	demod->meas_max = max;
 }
 
-void fm_demodulate_real(fm_demod_t *demod, sample_t *frequency, int length, sample_t *baseband, sample_t *I, sample_t *Q)
+/* shift baseband to 0 Hz and filter the IQ vectors, so the level of the channel can be taken before discriminating */
+void fm_demodulate_filter(fm_demod_t *demod, int length, float *baseband, sample_t *I, sample_t *Q)
+{
+	fm_demodulate_rotate(demod, length, baseband, I, Q);
+	iir_process_iq(&demod->lp[0], &demod->lp[1], I, Q, length);
+}
+
+/* do frequency demodulation of baseband and write them to samples */
+void fm_demodulate_complex(fm_demod_t *demod, sample_t *frequency, int length, float *baseband, sample_t *I, sample_t *Q)
+{
+	fm_demodulate_filter(demod, length, baseband, I, Q);
+	fm_demodulate_discriminate(demod, frequency, length, I, Q);
+}
+
+/* shift real signal to 0 Hz and write IQ vectors (first step of demodulation) */
+void fm_demodulate_rotate_real(fm_demod_t *demod, int length, sample_t *baseband, sample_t *I, sample_t *Q)
 {
-	double phase, rot, last_phase, dev, rate;
+	double phase, rot;
 	double _sin, _cos;
 	sample_t i;
 	int s, ss;
 
-	rate = demod->samplerate;
+	if (fast_math >= FM_MATH_VECTOR) {
+		rotate_vector(demod, length, NULL, baseband, I, Q);
+		return;
+	}
+
 	phase = demod->phase;
 	rot = demod->rot;
 	for (s = 0, ss = 0; s < length; s++) {
@@ -391,23 +678,11 @@ void fm_demodulate_real(fm_demod_t *demod, sample_t *frequency, int length, samp
 		Q[s] = i * _sin;
 	}
 	demod->phase = phase;
-	iir_process(&demod->lp[0], I, length);
-	iir_process(&demod->lp[1], Q, length);
-	last_phase = demod->last_phase;
-	for (s = 0; s < length; s++) {
-		if (fast_math)
-			phase = fast_atan2(Q[s], I[s]);
-		else
-			phase = atan2(Q[s], I[s]);
-		dev = (phase - last_phase) / 2 / M_PI;
-		last_phase = phase;
-		if (dev < -0.49)
-			dev += 1.0;
-		else if (dev > 0.49)
-			dev -= 1.0;
-		dev *= rate;
-		frequency[s] = dev;
-	}
-	demod->last_phase = last_phase;
 }
 
+void fm_demodulate_real(fm_demod_t *demod, sample_t *frequency, int length, sample_t *baseband, sample_t *I, sample_t *Q)
+{
+	fm_demodulate_rotate_real(demod, length, baseband, I, Q);
+	iir_process_iq(&demod->lp[0], &demod->lp[1], I, Q, length);
+	fm_demodulate_discriminate(demod, frequency, length, I, Q);
+}
@@ -2,6 +2,13 @@
 #define _LIB_FM_H
 
 #include "../libfilter/iir_filter.h"
+#include "../libsample/nco.h"
+
+/* fast_math modes */
+#define FM_MATH_LIBM	0	/* double precision sin() / cos() */
+#define FM_MATH_TABLE	1	/* sine table lookup */
+#define FM_MATH_VECTOR	2	/* float polynomial on blocks of samples (FM only, AM uses table) */
+#define FM_MATH_PHASOR	3	/* like vector, but recursive phasor for fixed rotations */
 
 int fm_init(int fast_math);
 void fm_exit(void);
@@ -33,12 +40,23 @@ typedef struct fm_demod {
 	double phase;		/* current rotation phase (used to shift) */
 	double rot;		/* rotation step per sample to shift rx frequency (used to shift) */
 	double last_phase;	/* last phase of FM (used to demodulate) */
+	double last_i, last_q;	/* last filtered IQ vector (used to demodulate with vector math) */
+	nco_t nco;		/* phasor to shift rx frequency (used with phasor math) */
 	iir_filter_t lp[2];	/* filters received IQ signal */
+	/* measurements of the last block, taken while discriminating */
+	double meas_power;	/* average square length of IQ vectors */
+	double meas_avg;	/* average frequency (offset) */
+	double meas_min, meas_max; /* range of frequency (deviation) */
 } fm_demod_t;
 
 int fm_demod_init(fm_demod_t *demod, double samplerate, double offset, double bandwidth);
 void fm_demod_exit(fm_demod_t *demod);
 void fm_demodulate_complex(fm_demod_t *demod, sample_t *frequency, int length, float *baseband, sample_t *I, sample_t *Q);
 void fm_demodulate_real(fm_demod_t *demod, sample_t *frequency, int length, sample_t *baseband, sample_t *I, sample_t *Q);
+/* steps of fm_demodulate_complex(), to filter IQ vectors of many demodulators together */
+void fm_demodulate_rotate(fm_demod_t *demod, int length, float *baseband, sample_t *I, sample_t *Q);
+void fm_demodulate_filter(fm_demod_t *demod, int length, float *baseband, sample_t *I, sample_t *Q);
+void fm_demodulate_rotate_real(fm_demod_t *demod, int length, sample_t *baseband, sample_t *I, sample_t *Q);
+void fm_demodulate_discriminate(fm_demod_t *demod, sample_t *frequency, int length, sample_t *I, sample_t *Q);
 
 #endif /* _LIB_FM_H */
@@ -0,0 +1,138 @@
+/* baseband FSK burst renderer with precomputed bit waveforms
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each bit is rendered by stepping through a ramp table of 256 entries,
+ * starting at the phase left over from the previous bit. The waveform of a
+ * bit only depends on the transition (last bit, bit) and on this start phase,
+ * so all waveforms are rendered in advance for FSK_BURST_PHASES start phases.
+ * The start phase itself is kept exactly, so the number of samples per bit
+ * and the bit rate do not change. Only the shape is taken from the start phase
+ * below, which is less than 1/FSK_BURST_PHASES of a sample off. If a bit has
+ * an integer number of samples, the start phase is always 0 and the
+ * waveforms are exact.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "fsk.h"
+
+/* transition: bit 1 = last bit, bit 0 = current bit */
+#define WAVE(b, transition, p) ((b)->wave + ((transition) * FSK_BURST_PHASES + (p)) * (b)->size)
+
+/* ramp_up and ramp_down have 256 entries, high is the level of bit 1, the level of bit 0 is -high */
+int fsk_burst_init(fsk_burst_t *b, double bitduration, const sample_t *ramp_up, const sample_t *ramp_down, sample_t high)
+{
+	sample_t *w;
+	double phase;
+	int t, p, i;
+
+	memset(b, 0, sizeof(*b));
+
+	if (bitduration < 1.0) {
+		LOGP(DDSP, LOGL_ERROR, "Bit duration of %.3f samples is too short!\n", bitduration);
+		return -EINVAL;
+	}
+
+	b->step = 256.0 / bitduration;
+	b->size = (int)ceil(bitduration) + 1;
+	b->wave = calloc(4 * FSK_BURST_PHASES * b->size, sizeof(*b->wave));
+	if (!b->wave) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		return -ENOMEM;
+	}
+
+	for (t = 0; t < 4; t++) {
+		for (p = 0; p < FSK_BURST_PHASES; p++) {
+			w = WAVE(b, t, p);
+			for (i = 0; i < b->size; i++) {
+				phase = b->step * ((double)p / FSK_BURST_PHASES + i);
+				/* samples beyond the end of the bit are never used, keep the final level */
+				if (phase >= 255.0)
+					phase = 255.0;
+				switch (t) {
+				case 0: /* stay down */
+					w[i] = -high;
+					break;
+				case 1: /* ramp up */
+					w[i] = ramp_up[(uint8_t)phase];
+					break;
+				case 2: /* ramp down */
+					w[i] = ramp_down[(uint8_t)phase];
+					break;
+				default: /* stay up */
+					w[i] = high;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+void fsk_burst_cleanup(fsk_burst_t *b)
+{
+	free(b->wave);
+	b->wave = NULL;
+}
+
+/* render 'num' bits of 'bits' into spl, return number of samples
+ * spl must hold num * bit duration samples, plus one for rounding
+ */
+int fsk_burst_encode(fsk_burst_t *b, sample_t *spl, uint32_t bits, int num, int lsb_first)
+{
+	double phase = b->phase, step = b->step;
+	int lastbit = b->lastbit;
+	int bit, p, n, count = 0;
+
+	for (; num; num--) {
+		if (lsb_first) {
+			bit = bits & 1;
+			bits >>= 1;
+		} else {
+			bit = bits >> 31;
+			bits <<= 1;
+		}
+		/* samples until phase reaches the end of the bit, the sample at the end belongs to the next bit */
+		n = (int)ceil((256.0 - phase) / step - 1e-9);
+		if (n < 1)
+			n = 1;
+		if (n >= b->size)
+			n = b->size - 1;
+		p = (int)(phase / step * FSK_BURST_PHASES);
+		if (p >= FSK_BURST_PHASES)
+			p = FSK_BURST_PHASES - 1;
+		memcpy(spl + count, WAVE(b, (lastbit << 1) | bit, p), n * sizeof(*spl));
+		count += n;
+		phase += n * step - 256.0;
+		/* remove rounding errors, so an integer number of samples per bit keeps phase 0 */
+		if (phase < step * 1e-9)
+			phase = 0.0;
+		lastbit = bit;
+	}
+
+	b->phase = phase;
+	b->lastbit = lastbit;
+
+	return count;
+}
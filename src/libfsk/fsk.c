@@ -25,6 +25,7 @@
 #include <math.h>
 #include "../libsample/sample.h"
 #include "../liblogging/logging.h"
+#include "../libfilter/iir_bank.h"
 #include "fsk.h"
 
 #define PI			M_PI
@@ -35,10 +36,82 @@
 /* uncomment to see the shape of the filter */
 //#define DEBUG_MODULATOR_SHAPE
 
+/* maximum number of bits until the pattern of samples per bit repeats */
+#define FSK_TABLE_MAX_BITS	16
+
+/* Precompute the FFSK waveforms.
+ *
+ * With FFSK, every bit starts at a zero crossing, so the start phase is 0 or
+ * 180 degrees. If the number of samples of some bits is an integer, the
+ * sample positions repeat after these bits. Then each bit's waveform only
+ * depends on its position in that pattern, its start phase and its value.
+ * The waveforms are rendered exactly like fsk_mod_send() does it.
+ */
+static int fsk_mod_gen_table(fsk_mod_t *fsk, int samplerate, double bitrate)
+{
+	double samples_per_bit = (double)samplerate / bitrate;
+	double phase, bitpos;
+	int bits, p, h, b, i, start, end, max;
+	sample_t *wave;
+
+	for (bits = 1; bits <= FSK_TABLE_MAX_BITS; bits++) {
+		if (fabs(round(samples_per_bit * bits) - samples_per_bit * bits) < 1e-6)
+			break;
+	}
+	if (bits > FSK_TABLE_MAX_BITS) {
+		LOGP(DDSP, LOGL_DEBUG, "Samples per bit do not repeat, FFSK waveform table not used.\n");
+		return 0;
+	}
+
+	max = (int)ceil(samples_per_bit) + 1;
+	fsk->table = calloc(bits * 4 * max, sizeof(*fsk->table));
+	fsk->table_length = calloc(bits, sizeof(*fsk->table_length));
+	fsk->table_next = calloc(bits * 4, sizeof(*fsk->table_next));
+	if (!fsk->table || !fsk->table_length || !fsk->table_next) {
+		fprintf(stderr, "No mem!\n");
+		return -ENOMEM;
+	}
+
+	for (p = 0; p < bits; p++) {
+		/* first sample at or after the start of the bit */
+		start = (int)ceil(samples_per_bit * p - 1e-6);
+		end = (int)ceil(samples_per_bit * (p + 1) - 1e-6);
+		fsk->table_length[p] = end - start;
+		for (h = 0; h < 2; h++) {
+			for (b = 0; b < 2; b++) {
+				wave = fsk->table + ((p * 2 + h) * 2 + b) * max;
+				/* change phase forward to the sample position */
+				bitpos = (double)start * fsk->bits65536_per_sample - (double)p * 65536.0;
+				phase = h * 32768.0 + bitpos / 65536.0 * fsk->cycles_per_bit65536[b];
+				if (phase >= 65536.0)
+					phase -= 65536.0;
+				for (i = 0; i < end - start; i++) {
+					wave[i] = fsk->sin_tab[(uint16_t)phase];
+					phase += fsk->phaseshift65536[b];
+					if (phase >= 65536.0)
+						phase -= 65536.0;
+				}
+				/* change phase back to the end of the bit and round to zero crossing */
+				bitpos = (double)end * fsk->bits65536_per_sample - (double)(p + 1) * 65536.0;
+				phase -= bitpos / 65536.0 * fsk->cycles_per_bit65536[b];
+				if (phase < 0.0)
+					phase += 65536.0;
+				fsk->table_next[(p * 2 + h) * 2 + b] = (phase > 16384.0 && phase < 49152.0);
+			}
+		}
+	}
+	fsk->table_bits = bits;
+	fsk->table_size = max;
+	LOGP(DDSP, LOGL_DEBUG, "Using FFSK waveform table, sample pattern repeats after %d bits.\n", bits);
+
+	return 0;
+}
+
 /*
  * fsk = instance of fsk modem
  * inst = instance of user
  * send_bit() = function to be called whenever a new bit has to be sent
+ *  (may be NULL, if fsk_mod_set_send_bits() is used)
  * samplerate = samplerate
  * bitrate = bits per second
  * f0, f1 = two frequencies for bit 0 and bit 1
@@ -112,6 +185,9 @@ int fsk_mod_init(fsk_mod_t *fsk, void *inst, int (*send_bit)(void *inst), int sa
 			abort();
 		}
 		fsk->cycles_per_bit65536[1] = waves * 65536.0;
+		rc = fsk_mod_gen_table(fsk, samplerate, bitrate);
+		if (rc < 0)
+			goto error;
 	} else {
 		fsk->cycles_per_bit65536[0] = f0 / bitrate * 65536.0;
 		fsk->cycles_per_bit65536[1] = f1 / bitrate * 65536.0;
@@ -166,6 +242,112 @@ void fsk_mod_cleanup(fsk_mod_t *fsk)
 		fsk->phase_tab_0_1 = NULL;
 		fsk->phase_tab_1_0 = NULL;
 	}
+	free(fsk->table);
+	fsk->table = NULL;
+	free(fsk->table_length);
+	fsk->table_length = NULL;
+	free(fsk->table_next);
+	fsk->table_next = NULL;
+	fsk->table_bits = 0;
+}
+
+/* use a callback that returns several bits at once, instead of send_bit() */
+void fsk_mod_set_send_bits(fsk_mod_t *fsk, int (*send_bits)(void *inst, uint32_t *bits))
+{
+	fsk->send_bits = send_bits;
+	fsk->tx_word_bits = 0;
+}
+
+/* get next bit from callback or from the bits of last send_bits() */
+static int fsk_mod_get_bit(fsk_mod_t *fsk)
+{
+	int bit;
+
+	if (!fsk->send_bits)
+		return fsk->send_bit(fsk->inst);
+
+	if (!fsk->tx_word_bits) {
+		fsk->tx_word_bits = fsk->send_bits(fsk->inst, &fsk->tx_word);
+		if (fsk->tx_word_bits <= 0) {
+			fsk->tx_word_bits = 0;
+			return -1;
+		}
+	}
+	bit = fsk->tx_word & 1;
+	fsk->tx_word >>= 1;
+	fsk->tx_word_bits--;
+
+	return bit;
+}
+
+/* modulate bits by copying precomputed waveforms */
+static int fsk_mod_send_table(fsk_mod_t *fsk, sample_t *sample, int length, int add)
+{
+	const sample_t *wave;
+	int count = 0;
+	int n, i, state;
+
+	if (fsk->tx_bit < 0)
+		goto next_bit;
+
+	while (1) {
+		state = (fsk->tx_table_bit * 2 + fsk->tx_table_phase) * 2 + fsk->tx_bit;
+		wave = fsk->table + state * fsk->table_size + fsk->tx_table_pos;
+		n = fsk->table_length[fsk->tx_table_bit] - fsk->tx_table_pos;
+		if (n > length - count)
+			n = length - count;
+		if (add) {
+			for (i = 0; i < n; i++)
+				sample[count + i] += wave[i];
+		} else
+			memcpy(sample + count, wave, n * sizeof(*sample));
+		count += n;
+		fsk->tx_table_pos += n;
+		if (fsk->tx_table_pos < fsk->table_length[fsk->tx_table_bit])
+			break;
+		/* bit is complete */
+		fsk->tx_table_pos = 0;
+		fsk->tx_table_phase = fsk->table_next[state];
+		if (++fsk->tx_table_bit == fsk->table_bits)
+			fsk->tx_table_bit = 0;
+next_bit:
+		fsk->tx_bit = fsk_mod_get_bit(fsk);
+		if (fsk->tx_bit < 0) {
+			fsk_mod_reset(fsk);
+			break;
+		}
+		fsk->tx_bit &= 1;
+	}
+
+	return count;
+}
+
+/* render given bits (packed MSB first) by copying precomputed waveforms
+ *
+ * This is only possible if a waveform table is used and if the modulator is
+ * not inside a bit, see fsk_mod_send(). The state of the table is advanced,
+ * so the caller may store the samples and restore the state later.
+ * The sample buffer must hold num * table_size samples.
+ */
+int fsk_mod_render(fsk_mod_t *fsk, const uint8_t *bits, int num, sample_t *sample)
+{
+	int count = 0;
+	int i, n, state;
+
+	if (!fsk->table_bits || fsk->tx_table_pos)
+		return -EINVAL;
+
+	for (i = 0; i < num; i++) {
+		state = (fsk->tx_table_bit * 2 + fsk->tx_table_phase) * 2 + ((bits[i >> 3] >> (7 - (i & 7))) & 1);
+		n = fsk->table_length[fsk->tx_table_bit];
+		memcpy(sample + count, fsk->table + state * fsk->table_size, n * sizeof(*sample));
+		count += n;
+		fsk->tx_table_phase = fsk->table_next[state];
+		if (++fsk->tx_table_bit == fsk->table_bits)
+			fsk->tx_table_bit = 0;
+	}
+
+	return count;
 }
 
 /* modulate bits
@@ -183,13 +365,16 @@ int fsk_mod_send(fsk_mod_t *fsk, sample_t *sample, int length, int add)
 	int count = 0;
 	double phase, phaseshift;
 
+	if (fsk->table_bits)
+		return fsk_mod_send_table(fsk, sample, length, add);
+
 	phase = fsk->tx_phase65536;
 
 	/* get next bit */
 	if (fsk->tx_bit < 0) {
 next_bit:
 		fsk->tx_last_bit = fsk->tx_bit;
-		fsk->tx_bit = fsk->send_bit(fsk->inst);
+		fsk->tx_bit = fsk_mod_get_bit(fsk);
 #ifdef DEBUG_MODULATOR
 		printf("bit change from %d to %d\n", fsk->tx_last_bit, fsk->tx_bit);
 #endif
@@ -298,6 +483,10 @@ void fsk_mod_reset(fsk_mod_t *fsk)
 	fsk->tx_bitpos65536 = 0.0;
 	fsk->tx_bit = -1;
 	fsk->tx_last_bit = -1;
+	fsk->tx_table_bit = 0;
+	fsk->tx_table_phase = 0;
+	fsk->tx_table_pos = 0;
+	fsk->tx_word_bits = 0;
 }
 
 /*
@@ -362,10 +551,13 @@ void fsk_demod_cleanup(fsk_demod_t *fsk)
 //#define DEBUG_FILTER
 
 #define CHUNK 1024
+#define FSK_SOFT_BITS 256
 
 /* Demodulates bits
  *
- * If bit is received, callback function send_bit() is called.
+ * If bit is received, callback function receive_bit() is called. If
+ * receive_bits() is set, the received bits are collected and handed over in
+ * batches, the last batch when all samples are processed.
  *
  * We sample each bit 0.5 bits after polarity change.
  *
@@ -375,32 +567,40 @@ void fsk_demod_cleanup(fsk_demod_t *fsk)
  * Therefore we change the sample counter only slightly, so bit slips may not
  * happen so quickly.
  */
-void fsk_demod_receive(fsk_demod_t *fsk, sample_t *sample, int length)
+/* hand over bit, or collect it until end of chunk */
+static inline void fsk_demod_bit(fsk_demod_t *fsk, fsk_soft_bit_t *bits, int *count, int bit, double soft, double quality, double level)
 {
-	sample_t I[CHUNK], Q[CHUNK], frequency[CHUNK], f;
+	if (!fsk->receive_bits) {
+		fsk->receive_bit(fsk->inst, bit, quality, level);
+		return;
+	}
+	bits[*count].bit = bit;
+	bits[*count].soft = soft;
+	bits[*count].quality = quality;
+	bits[*count].level = level;
+	if (++(*count) == FSK_SOFT_BITS) {
+		fsk->receive_bits(fsk->inst, bits, *count);
+		*count = 0;
+	}
+}
+
+/* clock recovery of demodulated chunk */
+static void fsk_demod_clock(fsk_demod_t *fsk, const sample_t *frequency, const sample_t *I, const sample_t *Q, int n, fsk_soft_bit_t *bits, int *count)
+{
+	sample_t f;
 	int i;
 	int bit;
 	double level, quality;
 
-	for (i = 0; i < length; i++) {
-		/* this is called on first sample and subsequently every sample defined by CHUNK */
-		if (i % CHUNK == 0) {
-			length -= i;
-			i = 0;
-			/* demod CHUNK samples to offset around center frequency */
-			fm_demodulate_real(&fsk->demod, frequency, (length > CHUNK) ? CHUNK : length, sample, I, Q);
-			sample += CHUNK;
-		}
-
+	for (i = 0; i < n; i++) {
 		f = frequency[i];
 		if (f < 0)
 			bit = fsk->low_bit;
 		else
 			bit = fsk->high_bit;
 #ifdef DEBUG_FILTER
-			printf("|%s| %.3f\n", debug_amplitude(f / fabs(fsk->f0_deviation) / 2), f / fabs(fsk->f0_deviation));
+		printf("|%s| %.3f\n", debug_amplitude(f / fabs(fsk->f0_deviation) / 2), f / fabs(fsk->f0_deviation));
 #endif
-	
 
 		if (fsk->rx_bit != bit) {
 #ifdef DEBUG_FILTER
@@ -426,7 +626,7 @@ void fsk_demod_receive(fsk_demod_t *fsk, sample_t *sample, int length)
 				printf("prematurely bit change (level=%.3f)\n", level);
 #endif
 				/* quality is 0.0, because a prematurely level change is caused by noise and has nothing to measure. */
-				fsk->receive_bit(fsk->inst, fsk->rx_bit, 0.0, level);
+				fsk_demod_bit(fsk, bits, count, fsk->rx_bit, f / fsk->f1_deviation, 0.0, level);
 			}
 			fsk->rx_change = 1;
 		}
@@ -446,7 +646,7 @@ void fsk_demod_receive(fsk_demod_t *fsk, sample_t *sample, int length)
 #ifdef DEBUG_FILTER
 			printf("sample (level=%.3f, quality=%.3f)\n", level, quality);
 #endif
-			fsk->receive_bit(fsk->inst, bit, quality, level);
+			fsk_demod_bit(fsk, bits, count, bit, f / fsk->f1_deviation, quality, level);
 			fsk->rx_bitpos -= 1.0;
 			fsk->rx_change = 0;
 		}
@@ -454,3 +654,165 @@ void fsk_demod_receive(fsk_demod_t *fsk, sample_t *sample, int length)
 	}
 }
 
+void fsk_demod_receive(fsk_demod_t *fsk, sample_t *sample, int length)
+{
+	sample_t I[CHUNK], Q[CHUNK], frequency[CHUNK];
+	fsk_soft_bit_t bits[FSK_SOFT_BITS];
+	int count = 0;
+	int n;
+
+	while (length) {
+		n = (length > CHUNK) ? CHUNK : length;
+		/* demod the whole chunk to offset around center frequency */
+		fm_demodulate_real(&fsk->demod, frequency, n, sample, I, Q);
+		sample += n;
+		length -= n;
+
+		fsk_demod_clock(fsk, frequency, I, Q, n, bits, &count);
+	}
+
+	if (count)
+		fsk->receive_bits(fsk->inst, bits, count);
+}
+
+/* Demodulator bank
+ *
+ * Many demodulators (e.g. modems of a dial-in pool) are processed together.
+ * Demodulators with equal IQ filters are grouped and their filters are
+ * processed by one iir_bank_t. Each group gets its own bank, so the banks
+ * are only created again, if the mode of a demodulator changes. The states
+ * of each filter are loaded into the bank and stored back afterwards, so a
+ * demodulator can also be used without bank or move to another group.
+ */
+int fsk_demod_bank_init(fsk_demod_bank_t *b, int max)
+{
+	int i;
+
+	memset(b, 0, sizeof(*b));
+
+	b->max = max;
+	b->bank = calloc(max, sizeof(*b->bank));
+	b->group = calloc(max, sizeof(*b->group));
+	b->done = calloc(max, sizeof(*b->done));
+	b->iq = calloc(max * 2, sizeof(*b->iq));
+	b->buffer = calloc(max * 2 * CHUNK + CHUNK, sizeof(*b->buffer));
+	if (!b->bank || !b->group || !b->done || !b->iq || !b->buffer) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		fsk_demod_bank_exit(b);
+		return -ENOMEM;
+	}
+	for (i = 0; i < max * 2; i++)
+		b->iq[i] = b->buffer + i * CHUNK;
+	b->frequency = b->buffer + max * 2 * CHUNK;
+
+	return 0;
+}
+
+void fsk_demod_bank_exit(fsk_demod_bank_t *b)
+{
+	int i;
+
+	if (b->bank) {
+		for (i = 0; i < b->max; i++)
+			iir_bank_exit(&b->bank[i]);
+		free(b->bank);
+		b->bank = NULL;
+	}
+	free(b->group);
+	b->group = NULL;
+	free(b->done);
+	b->done = NULL;
+	free(b->iq);
+	b->iq = NULL;
+	free(b->buffer);
+	b->buffer = NULL;
+}
+
+/* demodulate a group of demodulators with equal filters */
+static void fsk_demod_bank_group(fsk_demod_bank_t *b, iir_bank_t *bank, fsk_demod_t **group, sample_t **samples, int num, int length)
+{
+	fsk_soft_bit_t bits[FSK_SOFT_BITS];
+	int count;
+	int i, n, pos;
+
+	for (i = 0; i < num; i++) {
+		iir_bank_load(bank, i * 2, &group[i]->demod.lp[0]);
+		iir_bank_load(bank, i * 2 + 1, &group[i]->demod.lp[1]);
+	}
+
+	for (pos = 0; pos < length; pos += n) {
+		n = (length - pos > CHUNK) ? CHUNK : length - pos;
+		for (i = 0; i < num; i++)
+			fm_demodulate_rotate_real(&group[i]->demod, n, samples[i] + pos, b->iq[i * 2], b->iq[i * 2 + 1]);
+		iir_bank_process(bank, b->iq, n);
+		for (i = 0; i < num; i++) {
+			fm_demodulate_discriminate(&group[i]->demod, b->frequency, n, b->iq[i * 2], b->iq[i * 2 + 1]);
+			count = 0;
+			fsk_demod_clock(group[i], b->frequency, b->iq[i * 2], b->iq[i * 2 + 1], n, bits, &count);
+			if (count)
+				group[i]->receive_bits(group[i]->inst, bits, count);
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		iir_bank_store(bank, i * 2, &group[i]->demod.lp[0]);
+		iir_bank_store(bank, i * 2 + 1, &group[i]->demod.lp[1]);
+	}
+}
+
+/* demodulate 'num' demodulators, each with its own samples */
+void fsk_demod_bank_receive(fsk_demod_bank_t *b, fsk_demod_t **fsk, sample_t **samples, int num, int length)
+{
+	sample_t *group_samples[num];
+	iir_bank_t *bank;
+	iir_filter_t *lp;
+	int g, i, j, n;
+
+	if (num > b->max) {
+		LOGP(DDSP, LOGL_ERROR, "Bank has only %d demodulators, please fix!\n", b->max);
+		num = b->max;
+	}
+
+	memset(b->done, 0, num * sizeof(*b->done));
+	for (g = 0, i = 0; i < num; i++) {
+		if (b->done[i])
+			continue;
+		lp = &fsk[i]->demod.lp[0];
+		/* collect all demodulators with the same filter */
+		for (n = 0, j = i; j < num; j++) {
+			if (b->done[j])
+				continue;
+			if (lp->iter != fsk[j]->demod.lp[0].iter
+			 || lp->a0 != fsk[j]->demod.lp[0].a0 || lp->a1 != fsk[j]->demod.lp[0].a1 || lp->a2 != fsk[j]->demod.lp[0].a2
+			 || lp->b1 != fsk[j]->demod.lp[0].b1 || lp->b2 != fsk[j]->demod.lp[0].b2)
+				continue;
+			b->done[j] = 1;
+			b->group[n] = fsk[j];
+			group_samples[n] = samples[j];
+			n++;
+		}
+		/* a single demodulator does not need a bank */
+		if (n == 1) {
+			fsk_demod_receive(b->group[0], group_samples[0], length);
+			continue;
+		}
+		bank = &b->bank[g++];
+		if (bank->channels != n * 2 || !iir_bank_match(bank, lp)) {
+			iir_bank_exit(bank);
+			if (iir_bank_init(bank, lp, n * 2) < 0) {
+				/* process without bank */
+				for (j = 0; j < n; j++)
+					fsk_demod_receive(b->group[j], group_samples[j], length);
+				continue;
+			}
+		}
+		fsk_demod_bank_group(b, bank, b->group, group_samples, n, length);
+	}
+}
+
+/* receive all bits of a call to fsk_demod_receive() at once, instead of receive_bit() */
+void fsk_demod_set_receive_bits(fsk_demod_t *fsk, void (*receive_bits)(void *inst, const fsk_soft_bit_t *bits, int count))
+{
+	fsk->receive_bits = receive_bits;
+}
+
@@ -6,6 +6,9 @@
 typedef struct fsk_mod {
 	void		*inst;
 	int (*send_bit)(void *inst);
+	int (*send_bits)(void *inst, uint32_t *bits); /* optional: returns number of bits, first bit in LSB */
+	uint32_t	tx_word;		/* bits from send_bits(), not yet transmitted */
+	int		tx_word_bits;		/* number of these bits */
 	double		bits65536_per_sample;	/* fraction of a bit per sample */
 	double		*sin_tab;		/* sine table with correct peak level */
 	double		*phase_tab_0_1;		/* cosine shaped phase table (bit 0 to 1) */
@@ -22,11 +25,29 @@ typedef struct fsk_mod {
 	int		tx_last_bit;		/* last transmitting bit (-1 if not set) */
 	double		tx_bitpos65536;		/* current transmit position in bit */
 	int		filter;			/* set, if filters are used */
+	/* FFSK waveform table of each (bit in pattern, start phase, bit) */
+	int		table_bits;		/* number of bits until sample pattern repeats (0 = no table) */
+	int		table_size;		/* samples reserved for each waveform */
+	sample_t	*table;			/* waveforms */
+	int		*table_length;		/* samples of each bit in pattern */
+	uint8_t		*table_next;		/* start phase of next bit after each waveform */
+	int		tx_table_bit;		/* current bit in pattern */
+	int		tx_table_phase;		/* current start phase (0 = 0, 1 = 180 degrees) */
+	int		tx_table_pos;		/* samples of current waveform already sent */
 } fsk_mod_t;
 
+/* received bit with its soft value */
+typedef struct fsk_soft_bit {
+	int		bit;
+	double		soft;			/* frequency offset relative to deviation of bit 1 (1.0 = bit 1, -1.0 = bit 0) */
+	double		quality;
+	double		level;
+} fsk_soft_bit_t;
+
 typedef struct fsk_demod {
 	void		*inst;
 	void (*receive_bit)(void *inst, int bit, double quality, double level);
+	void (*receive_bits)(void *inst, const fsk_soft_bit_t *bits, int count); /* optional: bits in batches */
 	fm_demod_t	demod;
 	double		bits_per_sample;	/* fraction of a bit per sample */
 	double		f0_deviation;		/* deviation of frequencies, relative to center */
@@ -38,12 +59,58 @@ typedef struct fsk_demod {
 	int		rx_change;		/* set, if we have a level change before sampling the bit */
 } fsk_demod_t;
 
+/* many demodulators, whose IQ filters are processed in filter banks */
+typedef struct fsk_demod_bank {
+	int		max;			/* maximum number of demodulators */
+	struct iir_bank	*bank;			/* filter bank of each group of equal filters */
+	fsk_demod_t	**group;		/* demodulators of current group */
+	uint8_t		*done;			/* demodulator has been assigned to a group */
+	sample_t	**iq;			/* I and Q buffer of each demodulator in a group */
+	sample_t	*frequency;		/* demodulated chunk */
+	sample_t	*buffer;		/* memory of all buffers */
+} fsk_demod_bank_t;
+
+/* Manchester bit decoder over a window of demodulated samples */
+typedef struct fsk_manchester {
+	int		length;			/* number of samples in window */
+	int		begin, half, end;	/* age of samples in the second half (begin..half-1) and first half (half..end-1) */
+	sample_t	*spl;			/* ring of last samples */
+	double		*sum;			/* ring of prefix sums, one more than samples */
+	uint64_t	count;			/* index of next sample */
+	uint64_t	*max_queue, *min_queue;	/* indexes of samples that may become the peak level */
+	uint64_t	max_head, max_tail;
+	uint64_t	min_head, min_tail;
+} fsk_manchester_t;
+
+/* baseband burst renderer with cosine shaped ramps (POCSAG and GSC) */
+#define FSK_BURST_PHASES	32	/* start phases of a bit, per sample */
+typedef struct fsk_burst {
+	double		step;			/* ramp table index (256 per bit) per sample */
+	int		size;			/* samples reserved for each waveform */
+	sample_t	*wave;			/* waveforms of each (transition, start phase) */
+	double		phase;			/* start phase of next bit */
+	int		lastbit;		/* last bit, to select transition */
+} fsk_burst_t;
+
 int fsk_mod_init(fsk_mod_t *fsk, void *inst, int (*send_bit)(void *inst), int samplerate, double bitrate, double f0, double f1, double level, int coherent, int filter);
 void fsk_mod_cleanup(fsk_mod_t *fsk);
 int fsk_mod_send(fsk_mod_t *fsk, sample_t *sample, int length, int add);
+int fsk_mod_render(fsk_mod_t *fsk, const uint8_t *bits, int num, sample_t *sample);
 void fsk_mod_reset(fsk_mod_t *fsk);
+void fsk_mod_set_send_bits(fsk_mod_t *fsk, int (*send_bits)(void *inst, uint32_t *bits));
 int fsk_demod_init(fsk_demod_t *fsk, void *inst, void (*receive_bit)(void *inst, int bit, double quality, double level), int samplerate, double bitrate, double f0, double f1, double bitadjust);
 void fsk_demod_cleanup(fsk_demod_t *fsk);
 void fsk_demod_receive(fsk_demod_t *fsk, sample_t *sample, int length);
+void fsk_demod_set_receive_bits(fsk_demod_t *fsk, void (*receive_bits)(void *inst, const fsk_soft_bit_t *bits, int count));
+int fsk_demod_bank_init(fsk_demod_bank_t *b, int max);
+void fsk_demod_bank_exit(fsk_demod_bank_t *b);
+void fsk_demod_bank_receive(fsk_demod_bank_t *b, fsk_demod_t **fsk, sample_t **samples, int num, int length);
+int fsk_manchester_init(fsk_manchester_t *m, int length, int begin, int half, int end);
+void fsk_manchester_cleanup(fsk_manchester_t *m);
+void fsk_manchester_push(fsk_manchester_t *m, sample_t sample);
+int fsk_manchester_bit(fsk_manchester_t *m, double *first, double *second, sample_t *min, sample_t *max);
+int fsk_burst_init(fsk_burst_t *b, double bitduration, const sample_t *ramp_up, const sample_t *ramp_down, sample_t high);
+void fsk_burst_cleanup(fsk_burst_t *b);
+int fsk_burst_encode(fsk_burst_t *b, sample_t *spl, uint32_t bits, int num, int lsb_first);
 
 #endif /* _LIB_FSK_H */
@@ -0,0 +1,132 @@
+/* Manchester bit decoder with constant costs per bit
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The window holds the last 'length' samples of the demodulated signal. The
+ * age of the latest sample is 0. At the end of each bit, the average of the
+ * samples of age begin..half-1 (second half of the bit) is compared against
+ * the average of the samples of age half..end-1 (first half of the bit).
+ *
+ * A prefix sum of all samples is kept in a ring, so the sum of each half is
+ * the difference of two entries. The ring is rebased after each round, so
+ * the prefix sum does not grow. The minimum and maximum of the samples of
+ * age begin..end-1 are kept with two monotonic queues of sample indexes, so
+ * each sample enters and leaves a queue only once. Before the first sample,
+ * the window holds silence, like a ring buffer that was cleared.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "fsk.h"
+
+int fsk_manchester_init(fsk_manchester_t *m, int length, int begin, int half, int end)
+{
+	memset(m, 0, sizeof(*m));
+
+	if (begin < 0 || begin >= half || half >= end || end > length) {
+		LOGP(DDSP, LOGL_ERROR, "Invalid Manchester window %d..%d..%d of length %d!\n", begin, half, end, length);
+		return -EINVAL;
+	}
+
+	m->length = length;
+	m->begin = begin;
+	m->half = half;
+	m->end = end;
+	m->spl = calloc(length, sizeof(*m->spl));
+	m->sum = calloc(length + 1, sizeof(*m->sum));
+	m->max_queue = calloc(length * 2, sizeof(*m->max_queue));
+	if (!m->spl || !m->sum || !m->max_queue) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		fsk_manchester_cleanup(m);
+		return -ENOMEM;
+	}
+	m->min_queue = m->max_queue + length;
+	/* start after one round of silence, so all indexes are valid */
+	m->count = length + 1;
+
+	return 0;
+}
+
+void fsk_manchester_cleanup(fsk_manchester_t *m)
+{
+	free(m->spl);
+	m->spl = NULL;
+	free(m->sum);
+	m->sum = NULL;
+	free(m->max_queue);
+	m->max_queue = NULL;
+}
+
+/* add one sample to the window */
+void fsk_manchester_push(fsk_manchester_t *m, sample_t sample)
+{
+	int length = m->length;
+	uint64_t count = m->count;
+	uint64_t enter, *q;
+	sample_t s;
+	double base;
+	int i;
+
+	m->spl[count % length] = sample;
+	m->sum[(count + 1) % (length + 1)] = m->sum[count % (length + 1)] + sample;
+	m->count = ++count;
+
+	/* rebase prefix sum once per round */
+	if (count % (length + 1) == 0) {
+		base = m->sum[0];
+		for (i = 0; i <= length; i++)
+			m->sum[i] -= base;
+	}
+
+	/* samples older than 'end - 1' leave the queues, sample of age 'begin' enters */
+	enter = count - 1 - m->begin;
+	s = m->spl[enter % length];
+	q = m->max_queue;
+	while (m->max_tail > m->max_head && q[m->max_head % length] + m->end < count)
+		m->max_head++;
+	while (m->max_tail > m->max_head && m->spl[q[(m->max_tail - 1) % length] % length] <= s)
+		m->max_tail--;
+	q[m->max_tail++ % length] = enter;
+	q = m->min_queue;
+	while (m->min_tail > m->min_head && q[m->min_head % length] + m->end < count)
+		m->min_head++;
+	while (m->min_tail > m->min_head && m->spl[q[(m->min_tail - 1) % length] % length] >= s)
+		m->min_tail--;
+	q[m->min_tail++ % length] = enter;
+}
+
+/* decode bit from the window: 1 == positive level change
+ * the averages of both halves and the peak levels of the window are returned
+ */
+int fsk_manchester_bit(fsk_manchester_t *m, double *first, double *second, sample_t *min, sample_t *max)
+{
+	int size = m->length + 1;
+	uint64_t count = m->count;
+
+	/* sum of ages a..b-1 is sum[count - a] - sum[count - b] */
+	*second = (m->sum[(count - m->begin) % size] - m->sum[(count - m->half) % size]) / (double)(m->half - m->begin);
+	*first = (m->sum[(count - m->half) % size] - m->sum[(count - m->end) % size]) / (double)(m->end - m->half);
+	*max = m->spl[m->max_queue[m->max_head % m->length] % m->length];
+	*min = m->spl[m->min_queue[m->min_head % m->length] % m->length];
+
+	return (*second > *first);
+}
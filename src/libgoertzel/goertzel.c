@@ -67,6 +67,43 @@ static void gen_window(void)
 	window_generated = 1;
 }
 
+/* window tables for the lengths used recently, each DSP thread has its own */
+#define WINDOW_CACHE	4
+
+static __thread struct window_length {
+	int	length;
+	double	*table;
+} window_cache[WINDOW_CACHE];
+static __thread int window_cache_next = 0;
+
+/* get window sampled for given length, the values equal window[n * 256 / length] */
+static const double *get_window(int length)
+{
+	struct window_length *cache;
+	double *table;
+	int i, n;
+
+	for (i = 0; i < WINDOW_CACHE; i++) {
+		if (window_cache[i].length == length)
+			return window_cache[i].table;
+	}
+
+	table = malloc(length * sizeof(*table));
+	if (!table) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		abort();
+	}
+	for (n = 0; n < length; n++)
+		table[n] = window[n * 256 / length];
+	cache = &window_cache[window_cache_next];
+	window_cache_next = (window_cache_next + 1) % WINDOW_CACHE;
+	free(cache->table);
+	cache->table = table;
+	cache->length = length;
+
+	return table;
+}
+
 void audio_goertzel_init(goertzel_t *goertzel, double freq, int samplerate)
 {
 	if (!window_generated)
@@ -79,6 +116,33 @@ void audio_goertzel_init(goertzel_t *goertzel, double freq, int samplerate)
  * goertzel filter
  */
 
+/* number of resonators that are updated together, unused ones have coefficient 0 */
+#define GOERTZEL_LANES	4
+
+/* run up to GOERTZEL_LANES resonators over a linear part of the buffer */
+static void goertzel_lanes(const double *cos2pik, const sample_t *samples, const double *win, int length, double *sk1, double *sk2)
+{
+	double s1[GOERTZEL_LANES], s2[GOERTZEL_LANES], sk, x;
+	int n, l;
+
+	for (l = 0; l < GOERTZEL_LANES; l++) {
+		s1[l] = sk1[l];
+		s2[l] = sk2[l];
+	}
+	for (n = 0; n < length; n++) {
+		x = samples[n] * win[n];
+		for (l = 0; l < GOERTZEL_LANES; l++) {
+			sk = (cos2pik[l] * s1[l]) - s2[l] + x;
+			s2[l] = s1[l];
+			s1[l] = sk;
+		}
+	}
+	for (l = 0; l < GOERTZEL_LANES; l++) {
+		sk1[l] = s1[l];
+		sk2[l] = s2[l];
+	}
+}
+
 /* filter frequencies and return their levels
  *
  * samples: pointer to sample buffer
@@ -88,33 +152,35 @@ void audio_goertzel_init(goertzel_t *goertzel, double freq, int samplerate)
  * coeff: array of coefficients (coeff << 15)
  * result: array of result levels (peak value of the target frequency)
  * k: number of frequencies to check
+ *
+ * all frequencies are filtered in one pass over the buffer
  */
 void audio_goertzel(goertzel_t *goertzel, sample_t *samples, int length, int offset, double *result, int k)
 {
-	double sk, sk1, sk2;
-	double cos2pik;
-	int i, n;
+	double cos2pik[GOERTZEL_LANES], sk1[GOERTZEL_LANES], sk2[GOERTZEL_LANES];
+	const double *win;
+	int i, l;
 
-	/* we do goertzel */
-	for (i = 0; i < k; i++) {
-		sk = 0;
-		sk1 = 0;
-		sk2 = 0;
-		cos2pik = goertzel[i].coeff;
-		/* note: after 'length' cycles, offset is restored to its initial value */
-		for (n = 0; n < length; n++) {
-			sk = (cos2pik * sk1) - sk2 + samples[offset++] * window[n * 256 / length];
-			sk2 = sk1;
-			sk1 = sk;
-			if (offset == length)
-				offset = 0;
+	if (length <= 0)
+		return;
+	win = get_window(length);
+
+	for (i = 0; i < k; i += GOERTZEL_LANES) {
+		for (l = 0; l < GOERTZEL_LANES; l++) {
+			cos2pik[l] = (i + l < k) ? goertzel[i + l].coeff : 0.0;
+			sk1[l] = 0;
+			sk2[l] = 0;
 		}
+		/* from offset to the end of the buffer, then from the start to offset */
+		goertzel_lanes(cos2pik, samples + offset, win, length - offset, sk1, sk2);
+		goertzel_lanes(cos2pik, samples, win + length - offset, offset, sk1, sk2);
 		/* compute level of signal */
-		result[i] = sqrt(
-			(sk * sk) -
-			(cos2pik * sk * sk2) +
-			(sk2 * sk2)
-				) / (double)length * 4 / 1.08;
+		for (l = 0; l < GOERTZEL_LANES && i + l < k; l++) {
+			result[i + l] = sqrt(
+				(sk1[l] * sk1[l]) -
+				(cos2pik[l] * sk1[l] * sk2[l]) +
+				(sk2[l] * sk2[l])
+					) / (double)length * 4 / 1.08;
+		}
 	}
 }
-
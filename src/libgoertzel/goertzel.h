@@ -8,3 +8,23 @@ typedef struct goertzel {
 void audio_goertzel_init(goertzel_t *goertzel, double freq, int samplerate);
 void audio_goertzel(goertzel_t *goertzel, sample_t *samples, int length, int offset, double *result, int k);
 
+
+/* sliding DFT over the last 'length' samples, can be read at any time */
+typedef struct tone_track {
+	int		k;		/* number of frequencies */
+	int		length;		/* window length */
+	sample_t	*history;	/* last 'length' samples */
+	int		pos;		/* position in history */
+	double		*rot_re, *rot_im; /* rotation of phasor per sample */
+	double		*delay_re, *delay_im; /* rotation of phasor over window length */
+	double		*phasor_re, *phasor_im; /* current phasor of each frequency */
+	double		*acc_re, *acc_im; /* DFT of the window */
+	double		energy;		/* sum of squared samples of the window */
+} tone_track_t;
+
+int tone_track_init(tone_track_t *tt, const double *freq, int k, int samplerate, int length);
+void tone_track_exit(tone_track_t *tt);
+void tone_track_reset(tone_track_t *tt);
+void tone_track_process(tone_track_t *tt, const sample_t *samples, int length);
+void tone_track_levels(tone_track_t *tt, double *result);
+double tone_track_power(tone_track_t *tt);
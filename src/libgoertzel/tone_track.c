@@ -0,0 +1,167 @@
+/* sliding DFT tone tracker
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* For each frequency w, the tracker holds A = sum(x[m] * e^(-jwm)) over the
+ * last 'length' samples. Each new sample adds its term and removes the term
+ * of the sample that leaves the window:
+ *
+ *	A += e^(-jwn) * (x[n] - x[n - length] * e^(jw * length))
+ *
+ * This costs the same for every sample, no matter how often the level is
+ * read. The window is rectangular, so the level matches audio_goertzel() for
+ * the tone itself, but the side lobes are higher. The phasor e^(-jwn) is
+ * normalized once per window length, so rounding errors do not accumulate.
+ * The energy of the window is summed the same way and recalculated once per
+ * window length, for the same reason.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "goertzel.h"
+
+int tone_track_init(tone_track_t *tt, const double *freq, int k, int samplerate, int length)
+{
+	double w;
+	int i;
+
+	memset(tt, 0, sizeof(*tt));
+	tt->k = k;
+	tt->length = length;
+	tt->history = calloc(length, sizeof(*tt->history));
+	/* all values of all frequencies in one block */
+	tt->rot_re = calloc(k * 8, sizeof(double));
+	if (!tt->history || !tt->rot_re) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		tone_track_exit(tt);
+		return -ENOMEM;
+	}
+	tt->rot_im = tt->rot_re + k;
+	tt->delay_re = tt->rot_re + k * 2;
+	tt->delay_im = tt->rot_re + k * 3;
+	tt->phasor_re = tt->rot_re + k * 4;
+	tt->phasor_im = tt->rot_re + k * 5;
+	tt->acc_re = tt->rot_re + k * 6;
+	tt->acc_im = tt->rot_re + k * 7;
+
+	for (i = 0; i < k; i++) {
+		w = 2.0 * M_PI * freq[i] / (double)samplerate;
+		tt->rot_re[i] = cos(w);
+		tt->rot_im[i] = -sin(w);
+		tt->delay_re[i] = cos(w * (double)length);
+		tt->delay_im[i] = sin(w * (double)length);
+	}
+	tone_track_reset(tt);
+
+	return 0;
+}
+
+void tone_track_exit(tone_track_t *tt)
+{
+	free(tt->history);
+	tt->history = NULL;
+	free(tt->rot_re);
+	tt->rot_re = NULL;
+}
+
+void tone_track_reset(tone_track_t *tt)
+{
+	int i;
+
+	memset(tt->history, 0, tt->length * sizeof(*tt->history));
+	tt->pos = 0;
+	tt->energy = 0.0;
+	for (i = 0; i < tt->k; i++) {
+		tt->phasor_re[i] = 1.0;
+		tt->phasor_im[i] = 0.0;
+		tt->acc_re[i] = 0.0;
+		tt->acc_im[i] = 0.0;
+	}
+}
+
+/* slide window over given samples */
+void tone_track_process(tone_track_t *tt, const sample_t *samples, int length)
+{
+	double *rot_re = tt->rot_re, *rot_im = tt->rot_im;
+	double *delay_re = tt->delay_re, *delay_im = tt->delay_im;
+	double *phasor_re = tt->phasor_re, *phasor_im = tt->phasor_im;
+	double *acc_re = tt->acc_re, *acc_im = tt->acc_im;
+	sample_t *history = tt->history;
+	double x, old, d_re, d_im, p_re, p_im, abs, energy = tt->energy;
+	int k = tt->k;
+	int i, n, l;
+
+	while (length) {
+		/* process until end of history */
+		n = tt->length - tt->pos;
+		if (n > length)
+			n = length;
+		for (i = 0; i < n; i++) {
+			x = *samples++;
+			old = history[tt->pos + i];
+			history[tt->pos + i] = x;
+			energy += x * x - old * old;
+			for (l = 0; l < k; l++) {
+				d_re = x - old * delay_re[l];
+				d_im = -old * delay_im[l];
+				p_re = phasor_re[l];
+				p_im = phasor_im[l];
+				acc_re[l] += p_re * d_re - p_im * d_im;
+				acc_im[l] += p_re * d_im + p_im * d_re;
+				phasor_re[l] = p_re * rot_re[l] - p_im * rot_im[l];
+				phasor_im[l] = p_re * rot_im[l] + p_im * rot_re[l];
+			}
+		}
+		length -= n;
+		tt->pos += n;
+		if (tt->pos == tt->length) {
+			tt->pos = 0;
+			energy = 0.0;
+			for (i = 0; i < tt->length; i++)
+				energy += history[i] * history[i];
+			for (l = 0; l < k; l++) {
+				abs = sqrt(phasor_re[l] * phasor_re[l] + phasor_im[l] * phasor_im[l]);
+				phasor_re[l] /= abs;
+				phasor_im[l] /= abs;
+			}
+		}
+	}
+	tt->energy = energy;
+}
+
+/* return levels (peak value of the target frequency) of the last window */
+void tone_track_levels(tone_track_t *tt, double *result)
+{
+	int l;
+
+	for (l = 0; l < tt->k; l++)
+		result[l] = sqrt(tt->acc_re[l] * tt->acc_re[l] + tt->acc_im[l] * tt->acc_im[l]) * 2.0 / (double)tt->length;
+}
+
+/* return mean power of the last window, a tone of level L has L * L / 2 */
+double tone_track_power(tone_track_t *tt)
+{
+	if (tt->energy <= 0.0)
+		return 0.0;
+	return tt->energy / (double)tt->length;
+}
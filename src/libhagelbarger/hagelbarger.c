@@ -31,6 +31,53 @@
 /* enable to debug the process of parity check */
 //#define DEBUG_HAGEL
 
+/* Tables to process four steps at once:
+ *
+ * The encoder's output of four input bits (one output byte) only depends on
+ * the last 6 bits in the shift register and the four input bits.
+ *
+ * With the decoder, the first parity check (r) does not depend on any
+ * correction. The second parity check (s) is changed by the correction of
+ * three steps before. So the corrections of four steps only depend on the
+ * uncorrected parity checks of these four steps and the corrections of the
+ * last three steps.
+ */
+static uint8_t enc_table[64 * 16];	/* reg (6 bits), input (4 bits) -> output byte */
+static uint8_t dec_table[8 * 256];	/* last corrections (3 bits), r (4 bits), s (4 bits) -> corrections (4 bits) */
+static int tables_generated = 0;
+
+static void gen_tables(void)
+{
+	uint8_t reg, out, data, check, r, s, flip, f;
+	int i, j;
+
+	for (i = 0; i < 64 * 16; i++) {
+		reg = i >> 4;
+		out = 0;
+		for (j = 0; j < 4; j++) {
+			reg = (reg << 1) | ((i >> (3 - j)) & 1);
+			data = (reg >> 6) & 1;
+			check = (reg + (reg >> 3) + 1) & 1;
+			out = (out << 2) | (check << 1) | data;
+		}
+		enc_table[i] = out;
+	}
+
+	/* bit 0 refers to the latest step */
+	for (i = 0; i < 8 * 256; i++) {
+		flip = i >> 8;
+		r = (i >> 4) & 0xf;
+		s = i & 0xf;
+		for (j = 3; j >= 0; j--) {
+			f = ((r >> j) & 1) & (((s >> j) & 1) ^ ((flip >> 2) & 1));
+			flip = (flip << 1) | f;
+		}
+		dec_table[i] = flip & 0xf;
+	}
+
+	tables_generated = 1;
+}
+
 /* To encode NMT message: (MSB first)
  * Use input with 9 bytes, the last byte must be 0x00.
  * Use output with 18 bytes, ignore the last four (lower) bits of last byte.
@@ -38,10 +85,20 @@
  */
 void hagelbarger_encode(const uint8_t *input, uint8_t *output, int length)
 {
-	uint8_t reg = 0x00, data, check;
+	uint8_t reg = 0x00, data, check, nibble;
 	int i;
 
-	for (i = 0; i < length; i++) {
+	if (!tables_generated)
+		gen_tables();
+
+	/* four bits at once */
+	for (i = 0; i + 4 <= length; i += 4) {
+		nibble = (input[i / 8] >> ((i & 4) ? 0 : 4)) & 0xf;
+		output[i / 4] = enc_table[((reg & 0x3f) << 4) | nibble];
+		reg = (reg << 4) | nibble;
+	}
+
+	for (; i < length; i++) {
 		/* get data from input (MSB first) */
 		data = (input[i / 8] >> (7 - (i & 7))) & 1;
 		/* push data into shift register (LSB first) */
@@ -58,6 +115,44 @@ void hagelbarger_encode(const uint8_t *input, uint8_t *output, int length)
 		output[i++ / 4] <<= 2;
 }
 
+/* split input byte into four check bits (upper nibble) and four data bits (lower nibble) */
+static inline uint8_t deinterleave(uint8_t byte)
+{
+	return (byte & 0x80) | ((byte << 1) & 0x40) | ((byte << 2) & 0x20) | ((byte << 3) & 0x10)
+	     | ((byte >> 3) & 0x08) | ((byte >> 2) & 0x04) | ((byte >> 1) & 0x02) | (byte & 0x01);
+}
+
+/* Return the number of steps that fail any parity check, without correction.
+ * If it is 0, the message is received without any error.
+ * A candidate with many failures may be rejected before decoding it.
+ * Use same input and length as with hagelbarger_decode().
+ */
+int hagelbarger_check(const uint8_t *input, int length)
+{
+	/* before the message, all check bits are 1 */
+	uint32_t reg_data = 0x00, reg_check = 0x3ff, fail;
+	uint8_t bits;
+	int i, n, count = 0;
+
+	/* the encoded message has 6 bits of tail, further steps have no valid check bits */
+	length += 6;
+
+	for (i = 0; i < length; i += 4) {
+		bits = deinterleave(input[i / 4]);
+		reg_check = (reg_check << 4) | (bits >> 4);
+		reg_data = (reg_data << 4) | (bits & 0xf);
+		fail = ((reg_data ^ (reg_data >> 3) ^ (reg_check >> 6) ^ 0xf)
+		      | ((reg_data >> 3) ^ (reg_data >> 6) ^ (reg_check >> 9) ^ 0xf)) & 0xf;
+		/* ignore steps beyond length */
+		n = length - i;
+		if (n < 4)
+			fail &= (0xf0 >> n) & 0xf;
+		count += (fail & 1) + ((fail >> 1) & 1) + ((fail >> 2) & 1) + ((fail >> 3) & 1);
+	}
+
+	return count;
+}
+
 /* To decode NMT message: (MSB first)
  * Use input with 19 bytes, the unused last 12 (lower) bits must be zero.
  * Use output with 8 bytes.
@@ -65,38 +160,44 @@ void hagelbarger_encode(const uint8_t *input, uint8_t *output, int length)
  */
 void hagelbarger_decode(const uint8_t *input, uint8_t *output, int length)
 {
-	uint16_t reg_data = 0x00, reg_check = 0xff, data, check, r_parity, s_parity;
-	int i, o;
-
-	length += 10;
-
-	for (i = 0, o = 0; i < length; i++) {
-		/* get check bit from input (MSB first) */
-		check = (input[i / 4] >> (7 - (i & 3) * 2)) & 1;
-		/* get data bit from input (MSB first) */
-		data = (input[i / 4] >> (6 - (i & 3) * 2)) & 1;
-		/* push check bit into shift register (LSB first) */
-		reg_check = (reg_check << 1) | check;
-		/* push data bit into shift register (LSB first) */
-		reg_data = (reg_data << 1) | data;
+	uint32_t reg_data = 0x00, reg_check = 0xff, reg_flip = 0x00, r, s, message, out = 0;
+	uint8_t bits;
+	int i, first, last, n, o = 0, out_bits = 0;
+	int steps = length + 10;
+
+	if (!tables_generated)
+		gen_tables();
+
+	/* four steps at once: most recent step at bit 0 */
+	for (i = 0; i < steps; i += 4) {
+		bits = deinterleave(input[i / 4]);
+		/* push check and data bits into shift registers */
+		reg_check = (reg_check << 4) | (bits >> 4);
+		reg_data = (reg_data << 4) | (bits & 0xf);
 		/* calculate parity */
-		r_parity = (reg_data + (reg_data >> 3) + (reg_check >> 6) + 1) & 1;
-		s_parity = ((reg_data >> 3) + (reg_data >> 6) + (reg_check >> 9) + 1) & 1;
-#ifdef DEBUG_HAGEL
-		printf("#%d: r=%d s=%d\n", i - 10, r_parity, s_parity);
-#endif
-		/* flip message bit, if both parity checks fail */
-		/* use 4th bit that will be shifted to 5th bit next loop */
-		if (r_parity && s_parity)
-			reg_data ^= 0x0008;
-		/* put message bit to output (MSB first) */
-		if (i >= 10) {
-			output[o / 8] = (output[o / 8] << 1) | ((reg_data >> 4) & 1);
-			o++;
+		r = (reg_data ^ (reg_data >> 3) ^ (reg_check >> 6) ^ 0xf) & 0xf;
+		s = ((reg_data >> 3) ^ (reg_data >> 6) ^ (reg_check >> 9) ^ 0xf) & 0xf;
+		/* flip message bit 3 steps back, if both parity checks fail */
+		if ((r & s) || (reg_flip & 0x7))
+			reg_flip = (reg_flip << 4) | dec_table[((reg_flip & 0x7) << 8) | (r << 4) | s];
+		else
+			reg_flip <<= 4;
+		/* message bits of these steps are 4 steps back, corrected by the flips 3 steps after them */
+		message = ((reg_data >> 4) ^ (reg_flip >> 1)) & 0xf;
+		/* put message bits of step 10 and above to output (MSB first) */
+		first = (i < 10) ? 10 - i : 0;
+		last = (steps - i < 4) ? steps - i : 4;
+		n = last - first;
+		if (n <= 0)
+			continue;
+		out = (out << n) | ((message >> (4 - last)) & ((1 << n) - 1));
+		out_bits += n;
+		if (out_bits >= 8) {
+			out_bits -= 8;
+			output[o++] = out >> out_bits;
 		}
 	}
 	/* shift last output byte all the way to MSB */
-	while ((o % 8))
-		output[o++ / 8] <<= 1;
+	if (out_bits)
+		output[o] = out << (8 - out_bits);
 }
-
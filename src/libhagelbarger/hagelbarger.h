@@ -2,3 +2,4 @@
 void hagelbarger_encode(const uint8_t *input, uint8_t *output, int length);
 void hagelbarger_decode(const uint8_t *input, uint8_t *output, int length);
 
+int hagelbarger_check(const uint8_t *input, int length);
@@ -21,7 +21,10 @@
  *
  * Storing:
  *
- * Each saved frame is sorted into the list of packages by their timestamp.
+ * Each saved frame is stored in a ring of JITTER_FRAMES entries, indexed by its
+ * sequence number, so storing and loading does not need to search. Frames are
+ * taken from a pool of each jitter buffer, so no memory is allocated after the
+ * first frames have been received.
  *
  * The first packet will be stored with a timestamp offset of minimum jitter
  * window size or half of the target size, depending on the adaptive jitter
@@ -41,6 +44,13 @@
  *
  * If ssrc changes, the buffer is reset, but not locked again.
  *
+ * Statistics are collected for each received frame. The interarrival jitter
+ * is estimated as described in RFC 3550, using the local clock as arrival
+ * time. If the adaptive flag is used, the target window size follows the
+ * measured jitter: Two frames plus four times the jitter. This replaces the
+ * target window size given at creation, which is only used at the start of
+ * each stream. Statistics are logged and cleared, when the buffer is reset.
+ *
  *
  * Loading:
  *
@@ -51,6 +61,7 @@
  * jitter_advance() will advance the jitter buffer's head by the given number of samples.
  *
  * jitter_load_samples() will read decoded samples from jitter buffer's frames.
+ * jitter_get_samples() does the same, but returns a pointer to the samples inside the jitter buffer, so they can be converted by the caller without copying them first.
  * This means that that the decoder of each frame must generate samples of equal type and size.
  * If there is a gap between jitter buffer's head and the next frame, the samples are taken from the last frame.
  * The conceal function is called in this case, to extrapolate the missing samples.
@@ -76,7 +87,9 @@
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <time.h>
 #include "../libsample/sample.h"
+#include "../libsample/memacct.h"
 #include "../liblogging/logging.h"
 #include "jitter.h"
 
@@ -101,22 +114,28 @@ int jitter_create(jitter_t *jb, const char *name, double samplerate, double targ
 		snprintf(jb->name, sizeof(jb->name) - 1, "(%s) ", name);
 	else
 		snprintf(jb->name, sizeof(jb->name) - 1, "(unnamed %d) ", unnamed_count++);
+	jb->owner = name;
 
 	jb->sample_duration = 1.0 / samplerate;
 	jb->samples_20ms = samplerate / 50;
 	jb->target_window_size = (int)ceil(target_window_duration / jb->sample_duration);
 	jb->max_window_size = (int)ceil(max_window_duration / jb->sample_duration);
+	jb->init_window_size = jb->target_window_size;
 	jb->window_flags = window_flags;
 
+	/* all frames are free, they are allocated on first use */
+	jb->pool_num = JITTER_POOL;
+
 	jitter_reset(jb);
 
-	LOGP(DJITTER, LOGL_INFO, "%s Created jitter buffer. (samperate=%.0f, target_window=%.0fms, max_window=%.0fms, flag:latency=%s flag:repeat=%s)\n",
+	LOGP(DJITTER, LOGL_INFO, "%s Created jitter buffer. (samperate=%.0f, target_window=%.0fms, max_window=%.0fms, flag:latency=%s flag:repeat=%s flag:adaptive=%s)\n",
 		jb->name,
 		samplerate,
 		(double)jb->target_window_size * jb->sample_duration * 1000.0,
 		(double)jb->max_window_size * jb->sample_duration * 1000.0,
 		(window_flags & JITTER_FLAG_LATENCY) ? "true" : "false",
-		(window_flags & JITTER_FLAG_REPEAT) ? "true" : "false");
+		(window_flags & JITTER_FLAG_REPEAT) ? "true" : "false",
+		(window_flags & JITTER_FLAG_ADAPTIVE) ? "true" : "false");
 
 	return rc;
 }
@@ -124,28 +143,47 @@ int jitter_create(jitter_t *jb, const char *name, double samplerate, double targ
 /* reset jitter buffer */
 void jitter_reset(jitter_t *jb)
 {
-	jitter_frame_t *jf, *temp;
+	int i;
 
 	LOGP(DJITTER, LOGL_INFO, "%s Reset jitter buffer.\n", jb->name);
 
+	/* log and clear statistics of last stream */
+	if (jb->stat_received) {
+		jitter_stats_t stats;
+
+		jitter_get_stats(jb, &stats);
+		LOGP(DJITTER, LOGL_INFO, "%s Stream statistics: received=%u late=%u lost=%u concealed=%u delay=%.0fms (min=%.0fms max=%.0fms) jitter=%.1fms target_window=%.0fms\n",
+			jb->name, stats.received, stats.late, stats.lost, stats.concealed, stats.delay, stats.delay_min, stats.delay_max, stats.jitter, stats.target);
+	}
+	jb->stat_received = 0;
+	jb->stat_late = 0;
+	jb->stat_cycles = 0;
+	jb->stat_concealed = 0;
+	jb->stat_delay = jb->stat_delay_min = jb->stat_delay_max = 0;
+	jb->stat_arrival_valid = false;
+	jb->stat_jitter = 0.0;
+	jb->stat_frame_size = 0;
+	jb->target_window_size = jb->init_window_size;
+
 	/* jitter buffer locked */
 	jb->unlocked = false;
 
 	/* window becomes invalid */
 	jb->window_valid = false;
 
-	/* remove all pending frames */
-	jf = jb->frame_list;
-	while(jf) {
-		temp = jf;
-		jf = jf->next;
-		free(temp);
+	/* return all pending frames to pool */
+	for (i = 0; i < JITTER_FRAMES; i++) {
+		if (jb->frames[i]) {
+			jitter_frame_free(jb, jb->frames[i]);
+			jb->frames[i] = NULL;
+		}
 	}
-	jb->frame_list = NULL;
+	jb->frames_num = 0;
 
 	/* remove current sample buffer */
 	free(jb->spl_buf);
 	jb->spl_buf = NULL;
+	jb->spl_size = 0;
 	jb->spl_valid = false;
 }
 
@@ -153,19 +191,40 @@ void jitter_destroy(jitter_t *jb)
 {
 	jitter_reset(jb);
 
+	/* all frames are in the pool now */
+	while (jb->pool_num) {
+		jb->pool_num--;
+		if (jb->pool[jb->pool_num])
+			memacct_add(MEMACCT_JITTER, jb->owner, -(ssize_t)(sizeof(jitter_frame_t) + jb->pool[jb->pool_num]->capacity));
+		free(jb->pool[jb->pool_num]);
+	}
+
 	LOGP(DJITTER, LOGL_INFO, "%s Destroying jitter buffer.\n", jb->name);
 }
 
-jitter_frame_t *jitter_frame_alloc(void (*decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv), void *decoder_priv, uint8_t *data, int size, uint8_t marker, uint16_t sequence, uint32_t timestamp, uint32_t ssrc)
+/* take frame from pool, memory is only allocated if the frame is used first or the data is larger than before */
+jitter_frame_t *jitter_frame_alloc(jitter_t *jb, void (*decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv), void *decoder_priv, uint8_t *data, int size, uint8_t marker, uint16_t sequence, uint32_t timestamp, uint32_t ssrc)
 {
-	jitter_frame_t *jf;
+	jitter_frame_t *jf, *temp;
+	ssize_t grow;
 
-	jf = malloc(sizeof(*jf) + size);
-	if (!jf) {
-		LOGP(DJITTER, LOGL_ERROR, "No memory for frame.\n");
+	if (!jb->pool_num) {
+		LOGP(DJITTER, LOGL_ERROR, "%s No free frame in pool, please fix!\n", jb->name);
 		return NULL;
 	}
-	memset(jf, 0, sizeof(*jf)); // note: clear header only
+	jf = jb->pool[--jb->pool_num];
+	if (!jf || jf->capacity < size) {
+		grow = (jf) ? size - jf->capacity : (ssize_t)sizeof(*jf) + size;
+		temp = realloc(jf, sizeof(*jf) + size);
+		if (!temp) {
+			LOGP(DJITTER, LOGL_ERROR, "No memory for frame.\n");
+			jb->pool[jb->pool_num++] = jf;
+			return NULL;
+		}
+		memacct_add(MEMACCT_JITTER, jb->owner, grow);
+		jf = temp;
+		jf->capacity = size;
+	}
 	jf->decoder = decoder;
 	jf->decoder_priv = decoder_priv;
 	memcpy(jf->data, data, size);
@@ -178,9 +237,10 @@ jitter_frame_t *jitter_frame_alloc(void (*decoder)(uint8_t *src_data, int src_le
 	return jf;
 }
 
-void jitter_frame_free(jitter_frame_t *jf)
+/* return frame to pool */
+void jitter_frame_free(jitter_t *jb, jitter_frame_t *jf)
 {
-	free(jf);
+	jb->pool[jb->pool_num++] = jf;
 }
 
 void jitter_frame_get(jitter_frame_t *jf, void (**decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv), void **decoder_priv, uint8_t **data, int *size, uint8_t *marker, uint16_t *sequence, uint32_t *timestamp, uint32_t *ssrc)
@@ -203,6 +263,64 @@ void jitter_frame_get(jitter_frame_t *jf, void (**decoder)(uint8_t *src_data, in
 		*ssrc = jf->ssrc;
 }
 
+/* update sequence tracking and interarrival jitter, see RFC 3550 Appendix A.1 and A.8 */
+static void jitter_stat_frame(jitter_t *jb, jitter_frame_t *jf)
+{
+	struct timespec ts;
+	double arrival, d;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	arrival = ((double)ts.tv_sec + (double)ts.tv_nsec / 1e9) / jb->sample_duration;
+
+	if (!jb->stat_received++) {
+		jb->stat_base_sequence = jf->sequence;
+		jb->stat_max_sequence = jf->sequence;
+	} else {
+		/* in order, allowing gaps */
+		if ((uint16_t)(jf->sequence - jb->stat_max_sequence) < 0x8000) {
+			if (jf->sequence < jb->stat_max_sequence)
+				jb->stat_cycles += 65536;
+			jb->stat_max_sequence = jf->sequence;
+		}
+		/* frame size from consecutive frames */
+		if (jf->sequence == (uint16_t)(jb->stat_last_sequence + 1) && jf->timestamp != jb->stat_last_timestamp)
+			jb->stat_frame_size = (int32_t)(jf->timestamp - jb->stat_last_timestamp);
+	}
+
+	/* J(i) = J(i-1) + (|D(i-1,i)| - J(i-1)) / 16 */
+	if (jb->stat_arrival_valid) {
+		d = (arrival - jb->stat_arrival) - (double)(int32_t)(jf->timestamp - jb->stat_last_timestamp);
+		jb->stat_jitter += (fabs(d) - jb->stat_jitter) / 16.0;
+	}
+	jb->stat_arrival = arrival;
+	jb->stat_arrival_valid = true;
+	jb->stat_last_sequence = jf->sequence;
+	jb->stat_last_timestamp = jf->timestamp;
+}
+
+/* size target window from measured jitter */
+static void jitter_adapt(jitter_t *jb)
+{
+	int frame_size, target;
+
+	if (!(jb->window_flags & JITTER_FLAG_ADAPTIVE) || !jb->stat_arrival_valid)
+		return;
+
+	frame_size = (jb->stat_frame_size > 0) ? jb->stat_frame_size : jb->samples_20ms;
+	target = 2 * frame_size + (int)ceil(4.0 * jb->stat_jitter);
+	if (target > jb->max_window_size)
+		target = jb->max_window_size;
+	if (target == jb->target_window_size)
+		return;
+
+	LOGP(DJITTER, LOGL_DEBUG, "%s Adapting target window size from %.0fms to %.0fms. (jitter=%.1fms)\n",
+		jb->name,
+		(double)jb->target_window_size * jb->sample_duration * 1000.0,
+		(double)target * jb->sample_duration * 1000.0,
+		jb->stat_jitter * jb->sample_duration * 1000.0);
+	jb->target_window_size = target;
+}
+
 /* Store frame in jitterbuffer
  *
  * Use sequence number to order frames.
@@ -212,10 +330,11 @@ void jitter_save(jitter_t *jb, jitter_frame_t *jf)
 {
 	jitter_frame_t **jfp;
 	int32_t offset_timestamp;
+	int reduce_threshold;
 
 	/* ignore frames until the buffer is unlocked by jitter_load() */
 	if (!jb->unlocked) {
-		jitter_frame_free(jf);
+		jitter_frame_free(jb, jf);
 		return;
 	}
 
@@ -241,16 +360,24 @@ void jitter_save(jitter_t *jb, jitter_frame_t *jf)
 		jb->delay_interval = INITIAL_DELAY_INTERVAL;
 	}
 
+	jitter_stat_frame(jb, jf);
+
 	/* reduce delay */
 	if (jb->delay_counter >= jb->delay_interval) {
+		jitter_adapt(jb);
 		if (jb->min_delay >= 0)
 			LOGP(DJITTER, LOGL_DEBUG, "%s Statistics: target_window_delay=%.0fms max_window_delay=%.0fms  current min_delay=%.0fms\n",
 				jb->name,
 				(double)jb->target_window_size * jb->sample_duration * 1000.0,
 				(double)jb->max_window_size * jb->sample_duration * 1000.0,
 				(double)jb->min_delay * jb->sample_duration * 1000.0);
-		/* delay reduction, if minimum delay is greater than target jitter window size */
-		if ((jb->window_flags & JITTER_FLAG_LATENCY) && jb->min_delay > jb->target_window_size) {
+		/* delay reduction, if minimum delay is greater than target jitter window size
+		 * (adaptive: greater than half of it, plus some hysteresis) */
+		if ((jb->window_flags & JITTER_FLAG_ADAPTIVE))
+			reduce_threshold = jb->target_window_size / 2 + jb->target_window_size / 8;
+		else
+			reduce_threshold = jb->target_window_size;
+		if ((jb->window_flags & JITTER_FLAG_LATENCY) && jb->min_delay > reduce_threshold) {
 			LOGP(DJITTER, LOGL_DEBUG, "%s Reducing current minimum delay of %.0fms, because maximum delay is greater than target window size of %.0fms.\n",
 				jb->name,
 				(double)jb->min_delay * jb->sample_duration * 1000.0,
@@ -264,42 +391,67 @@ void jitter_save(jitter_t *jb, jitter_frame_t *jf)
 		jb->min_delay = -1;
 	}
 
-	/* find location where to put frame into the list, depending on sequence number */
-	jfp = &jb->frame_list;
-	while(*jfp) {
-		offset_timestamp = (int16_t)(jf->timestamp - (*jfp)->timestamp);
-		/* found double entry */
-		if (offset_timestamp == 0) {
-			LOGP(DJITTER, LOGL_DEBUG, "%s Dropping double packet (timestamp = %u)\n", jb->name, jf->timestamp);
-			jitter_frame_free(jf);
+	/* find location where to put frame into the buffer, depending on sequence number */
+	if (!jb->frames_num)
+		jb->head_sequence = jb->tail_sequence = jf->sequence;
+	if ((int16_t)(jf->sequence - jb->head_sequence) < 0) {
+		/* frame is older than all other frames, it must fit into the buffer */
+		if ((uint16_t)(jb->tail_sequence - jf->sequence) >= JITTER_FRAMES) {
+			LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Dropping old packet (sequence = %u)\n", jb->name, jf->sequence);
+			jb->stat_late++;
+			jitter_frame_free(jb, jf);
 			return;
 		}
-		/* offset is negative, so we found the position to insert frame */
-		if (offset_timestamp < 0)
-			break;
-		jfp = &((*jfp)->next);
+		jb->head_sequence = jf->sequence;
+	}
+	/* frame is far ahead, so remove oldest frames */
+	while ((int16_t)(jf->sequence - jb->head_sequence) >= JITTER_FRAMES) {
+		jfp = &jb->frames[jb->head_sequence % JITTER_FRAMES];
+		if (*jfp) {
+			jitter_frame_free(jb, *jfp);
+			*jfp = NULL;
+			if (!--jb->frames_num) {
+				jb->head_sequence = jb->tail_sequence = jf->sequence;
+				break;
+			}
+		}
+		jb->head_sequence++;
+	}
+	if ((int16_t)(jf->sequence - jb->tail_sequence) > 0)
+		jb->tail_sequence = jf->sequence;
+	jfp = &jb->frames[jf->sequence % JITTER_FRAMES];
+	/* found double entry */
+	if (*jfp) {
+		LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Dropping double packet (sequence = %u)\n", jb->name, jf->sequence);
+		jitter_frame_free(jb, jf);
+		return;
 	}
 
 	offset_timestamp = jf->timestamp - jb->window_timestamp;
 #ifdef HEAVY_DEBUG
-	LOGP(DJITTER, LOGL_DEBUG, "%s Frame has offset of %.0fms in jitter buffer.\n", jb->name, (double)offset_timestamp * jb->sample_duration * 1000.0);
+	LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Frame has offset of %.0fms in jitter buffer.\n", jb->name, (double)offset_timestamp * jb->sample_duration * 1000.0);
 #endif
 
 	/* measure delay */
 	if (jb->min_delay < 0 || offset_timestamp < jb->min_delay)
 		jb->min_delay = offset_timestamp;
+	jb->stat_delay = offset_timestamp;
+	if (jb->stat_received == 1 || offset_timestamp < jb->stat_delay_min)
+		jb->stat_delay_min = offset_timestamp;
+	if (jb->stat_received == 1 || offset_timestamp > jb->stat_delay_max)
+		jb->stat_delay_max = offset_timestamp;
 
 	/* if frame is too early (delay ceases), shift window to the future */
 	if (offset_timestamp > jb->max_window_size) {
 		if ((jb->window_flags & JITTER_FLAG_LATENCY)) {
-			LOGP(DJITTER, LOGL_DEBUG, "%s Frame too early: Shift jitter buffer to the future, to make the frame fit to the end. (offset_sequence(%d) > max_window_size(%d))\n", jb->name, offset_timestamp, jb->max_window_size);
+			LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Frame too early: Shift jitter buffer to the future, to make the frame fit to the end. (offset_sequence(%d) > max_window_size(%d))\n", jb->name, offset_timestamp, jb->max_window_size);
 			/* shift window so it fits to the end of window */
 			jb->window_timestamp = jf->timestamp - jb->max_window_size;
 			jb->min_delay = -1;
 			jb->delay_counter = 0.0;
 			jb->delay_interval = REPEAT_DELAY_INTERVAL;
 		} else {
-			LOGP(DJITTER, LOGL_DEBUG, "%s Frame too early: Shift jitter buffer to the future, to make the frame fit to the target delay. (offset_sequence(%d) > max_window_size(%d))\n", jb->name, offset_timestamp, jb->max_window_size);
+			LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Frame too early: Shift jitter buffer to the future, to make the frame fit to the target delay. (offset_sequence(%d) > max_window_size(%d))\n", jb->name, offset_timestamp, jb->max_window_size);
 			/* shift window so frame fits to the start of window + target delay */
 			jb->window_timestamp = jf->timestamp - jb->target_window_size;
 			jb->min_delay = -1;
@@ -310,15 +462,17 @@ void jitter_save(jitter_t *jb, jitter_frame_t *jf)
 
 	/* is frame is too late, shift window to the past. */
 	if (offset_timestamp < 0) {
+		jb->stat_late++;
+		jitter_adapt(jb);
 		if ((jb->window_flags & JITTER_FLAG_LATENCY)) {
-			LOGP(DJITTER, LOGL_DEBUG, "%s Frame too late: Shift jitter buffer to the past, and add target window size. (offset_sequence(%d) < 0)\n", jb->name, offset_timestamp);
+			LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Frame too late: Shift jitter buffer to the past, and add target window size. (offset_sequence(%d) < 0)\n", jb->name, offset_timestamp);
 			/* shift window so frame fits to the start of window + half of target delay */
 			jb->window_timestamp = jf->timestamp - jb->target_window_size / 2;
 			jb->min_delay = -1;
 			jb->delay_counter = 0.0;
 			jb->delay_interval = REPEAT_DELAY_INTERVAL;
 		} else {
-			LOGP(DJITTER, LOGL_DEBUG, "%s Frame too late: Shift jitter buffer to the past, and add half target window size. (offset_sequence(%d) < 0)\n", jb->name, offset_timestamp);
+			LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Frame too late: Shift jitter buffer to the past, and add half target window size. (offset_sequence(%d) < 0)\n", jb->name, offset_timestamp);
 			/* shift window so frame fits to the start of window + target delay */
 			jb->window_timestamp = jf->timestamp - jb->target_window_size;
 			jb->min_delay = -1;
@@ -332,63 +486,72 @@ void jitter_save(jitter_t *jb, jitter_frame_t *jf)
 	#include <time.h>
 	static struct timespec tv;
         clock_gettime(CLOCK_REALTIME, &tv);
-	LOGP(DJITTER, LOGL_DEBUG, "%s Store frame. %ld.%04ld\n", jb->name, tv.tv_sec, tv.tv_nsec / 1000000);
+	LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Store frame. %ld.%04ld\n", jb->name, tv.tv_sec, tv.tv_nsec / 1000000);
 #endif
-	jf->next = *jfp;
 	*jfp = jf;
+	jb->frames_num++;
+}
+
+/* get first frame that is not in the past, remove all frames that are in the past */
+static jitter_frame_t *jitter_head(jitter_t *jb)
+{
+	jitter_frame_t **jfp;
+
+	while (jb->frames_num) {
+		jfp = &jb->frames[jb->head_sequence % JITTER_FRAMES];
+		if (*jfp) {
+			if ((int32_t)((*jfp)->timestamp - jb->window_timestamp) >= 0)
+				return *jfp;
+			/* detach and free */
+			jitter_frame_free(jb, *jfp);
+			*jfp = NULL;
+			jb->frames_num--;
+		}
+		jb->head_sequence++;
+	}
+
+	return NULL;
 }
 
 /* get offset to next chunk, return -1, if there is no */
 int32_t jitter_offset(jitter_t *jb)
 {
 	jitter_frame_t *jf;
-	int16_t offset_timestamp = 0;
 
 	/* now unlock jitter buffer */
 	jb->unlocked = true;
 
 	/* get timestamp of chunk that is not in the past */
-	for (jf = jb->frame_list; jf; jf = jf->next) {
-		offset_timestamp = jf->timestamp - jb->window_timestamp;
-		if (offset_timestamp >= 0)
-			break;
-	}
+	jf = jitter_head(jb);
 
-	return (jf) ? offset_timestamp : -1;
+	return (jf) ? (int32_t)(jf->timestamp - jb->window_timestamp) : -1;
 }
 
 /* get next data chunk from jitterbuffer */
 jitter_frame_t *jitter_load(jitter_t *jb)
 {
 	jitter_frame_t *jf;
-	int32_t offset_timestamp;
 
 #ifdef HEAVY_DEBUG
 	static struct timespec tv;
         clock_gettime(CLOCK_REALTIME, &tv);
-	LOGP(DJITTER, LOGL_DEBUG, "%s Load frame. %ld.%04ld\n", jb->name, tv.tv_sec, tv.tv_nsec / 1000000);
+	LOGP_HOT(DJITTER, LOGL_DEBUG, "%s Load frame. %ld.%04ld\n", jb->name, tv.tv_sec, tv.tv_nsec / 1000000);
 #endif
 
 	/* now unlock jitter buffer */
 	jb->unlocked = true;
 
 	/* get current chunk, free all chunks that are in the past */
-	while ((jf = jb->frame_list)) {
-		offset_timestamp = jf->timestamp - jb->window_timestamp;
-		if (offset_timestamp >= 0)
-			break;
-		/* detach and free */
-		jb->frame_list = jf->next;
-		jitter_frame_free(jf);
-	}
+	jf = jitter_head(jb);
 
 	/* next frame in the future */
-	if (jf && jf->timestamp != jb->window_timestamp)
+	if (!jf || jf->timestamp != jb->window_timestamp)
 		return NULL;
 
 	/* detach, and return */
-	if (jf)
-		jb->frame_list = jf->next;
+	jb->frames[jb->head_sequence % JITTER_FRAMES] = NULL;
+	jb->frames_num--;
+	jb->head_sequence++;
 	return jf;
 }
 
@@ -404,11 +567,12 @@ void jitter_advance(jitter_t *jb, uint32_t offset)
 	jb->delay_counter += jb->sample_duration * (double)offset;
 }
 
-/* load samples from jitter buffer
- * store in spl_buf until all copied
+/* get samples from jitter buffer without copying them
+ * return pointer to up to len samples and the number of samples
+ * the samples are valid until the next call
  * conceal, if frame is missing
  * ceate silence, if no spl_buf exists in the first place */
-void jitter_load_samples(jitter_t *jb, uint8_t *spl, int len, size_t sample_size, void (*conceal)(uint8_t *spl, int len, void *priv), void *conceal_priv)
+int jitter_get_samples(jitter_t *jb, uint8_t **spl, int len, size_t sample_size, void (*conceal)(uint8_t *spl, int len, void *priv), void *conceal_priv)
 {
 	jitter_frame_t *jf;
 	int32_t offset;
@@ -418,27 +582,9 @@ void jitter_load_samples(jitter_t *jb, uint8_t *spl, int len, size_t sample_size
 	int payload_len;
 	int tocopy;
 
-#ifdef VISUAL_DEBUG
-	int32_t offset_timestamp;
-	char debug[jb->max_window_size + 32];
-	int last = 0;
-	memset(debug, ' ', sizeof(debug));
-	for (jf = jb->frame_list; jf; jf = jf->next) {
-		offset_timestamp = jf->timestamp - jb->window_timestamp;
-		if (offset_timestamp < 0)
-			continue;
-		offset_timestamp = (int)((double)offset_timestamp * jb->sample_duration * 1000.0);
-		debug[offset_timestamp] = '0' + jf->sequence % 10;
-		last = offset_timestamp + 1;
-	}
-	debug[last] = '\0';
-	LOGP(DJITTER, LOGL_DEBUG, "%s:%s\n", jb->name, debug);
-#endif
-
-next_chunk:
 	/* nothing more to return */
 	if (!len)
-		return;
+		return 0;
 
 copy_chunk:
 	/* consume from buffer, if valid */
@@ -447,19 +593,17 @@ copy_chunk:
 		if (tocopy > len)
 			tocopy = len;
 #ifdef HEAVY_DEBUG
-		LOGP(DJITTER, LOGL_DEBUG, "%s loading %d samples: from valid sample buffer.\n", jb->name, tocopy);
+		LOGP_HOT(DJITTER, LOGL_DEBUG, "%s loading %d samples: from valid sample buffer.\n", jb->name, tocopy);
 #endif
 		/* advance jitter buffer */
 		jitter_advance(jb, tocopy);
-		memcpy(spl, jb->spl_buf + jb->spl_pos * sample_size, tocopy * sample_size);
-		spl += tocopy * sample_size;
-		len -= tocopy;
+		*spl = jb->spl_buf + jb->spl_pos * sample_size;
 		jb->spl_pos += tocopy;
 		if (jb->spl_pos == jb->spl_len) {
 			jb->spl_pos = 0;
 			jb->spl_valid = false;
 		}
-		goto next_chunk;
+		return tocopy;
 	}
 
 	/* get offset to next frame in jitter buffer */
@@ -473,31 +617,29 @@ copy_chunk:
 		if (offset > len)
 			offset = len;
 #ifdef HEAVY_DEBUG
-		LOGP(DJITTER, LOGL_DEBUG, "%s concealing %d samples: from invalid sample buffer.\n", jb->name, offset);
+		LOGP_HOT(DJITTER, LOGL_DEBUG, "%s concealing %d samples: from invalid sample buffer.\n", jb->name, offset);
 #endif
-		/* advance jitter buffer */
-		jitter_advance(jb, offset);
 		/* if there is no buffer, allocate 20ms, filled with 0 */
 		if (!jb->spl_buf) {
 			jb->spl_len = jb->samples_20ms;
 			jb->spl_buf = calloc(jb->spl_len, sample_size);
+			jb->spl_size = jb->spl_len * sample_size;
 		}
-		/* do until all samples are processed */
-		while (offset) {
-			tocopy = jb->spl_len - jb->spl_pos;
-			if (tocopy > offset)
-				tocopy = offset;
-			if (conceal)
-				conceal(jb->spl_buf + jb->spl_pos * sample_size, tocopy, conceal_priv);
-			memcpy(spl, jb->spl_buf + jb->spl_pos * sample_size, tocopy * sample_size);
-			spl += tocopy * sample_size;
-			len -= tocopy;
-			jb->spl_pos += tocopy;
-			if (jb->spl_pos == jb->spl_len)
-				jb->spl_pos = 0;
-			offset -= tocopy;
-		}
-		goto next_chunk;
+		/* process until end of buffer, the rest is returned by next call */
+		tocopy = jb->spl_len - jb->spl_pos;
+		if (tocopy > offset)
+			tocopy = offset;
+		/* advance jitter buffer */
+		jitter_advance(jb, tocopy);
+		if (jb->window_valid)
+			jb->stat_concealed += tocopy;
+		if (conceal)
+			conceal(jb->spl_buf + jb->spl_pos * sample_size, tocopy, conceal_priv);
+		*spl = jb->spl_buf + jb->spl_pos * sample_size;
+		jb->spl_pos += tocopy;
+		if (jb->spl_pos == jb->spl_len)
+			jb->spl_pos = 0;
+		return tocopy;
 	}
 
 	/* load from jitter buffer (it should work, because offset equals 0 */
@@ -505,41 +647,85 @@ copy_chunk:
 	if (!jf) {
 		LOGP(DJITTER, LOGL_ERROR, "%s Failed to get frame from jitter buffer, please fix!\n", jb->name);
 		jitter_reset(jb);
-		return;
+		return 0;
 	}
 #ifdef HEAVY_DEBUG
-	LOGP(DJITTER, LOGL_DEBUG, "%s loading new frame to sample buffer.\n", jb->name);
+	LOGP_HOT(DJITTER, LOGL_DEBUG, "%s loading new frame to sample buffer.\n", jb->name);
 #endif
 	/* get data from frame */
 	jitter_frame_get(jf, &decoder, &decoder_priv, &payload, &payload_len, NULL, NULL, NULL, NULL);
-	/* free previous buffer */
-	free(jb->spl_buf);
-	jb->spl_buf = NULL;
 	jb->spl_pos = 0;
 	/* decode */
 	if (decoder) {
+		/* the decoder allocates a new buffer */
+		free(jb->spl_buf);
+		jb->spl_buf = NULL;
 		decoder(payload, payload_len, &jb->spl_buf, &jb->spl_len, decoder_priv);
 		if (!jb->spl_buf) {
-			jitter_frame_free(jf);
-			return;
+			jitter_frame_free(jb, jf);
+			return 0;
 		}
+		jb->spl_size = jb->spl_len;
 	} else {
-		/* no decoder, so just copy as it is */
-		jb->spl_buf = malloc(payload_len);
-		if (!jb->spl_buf) {
-			jitter_frame_free(jf);
-			return;
+		/* no decoder, so just copy as it is, reuse buffer if large enough */
+		if (jb->spl_size < payload_len) {
+			free(jb->spl_buf);
+			jb->spl_buf = malloc(payload_len);
+			if (!jb->spl_buf) {
+				jb->spl_size = 0;
+				jitter_frame_free(jb, jf);
+				return 0;
+			}
+			jb->spl_size = payload_len;
 		}
 		memcpy(jb->spl_buf, payload, payload_len);
 		jb->spl_len = payload_len;
 	}
 	jb->spl_len /= sample_size;
 	jb->spl_valid = true;
-	/* free jiter frame */
-	jitter_frame_free(jf);
+	/* return jiter frame to pool */
+	jitter_frame_free(jb, jf);
 	goto copy_chunk;
 }
 
+/* load samples from jitter buffer
+ * store in spl_buf until all copied
+ * see jitter_get_samples() */
+void jitter_load_samples(jitter_t *jb, uint8_t *spl, int len, size_t sample_size, void (*conceal)(uint8_t *spl, int len, void *priv), void *conceal_priv)
+{
+	uint8_t *chunk;
+	int tocopy;
+
+#ifdef VISUAL_DEBUG
+	jitter_frame_t *jf;
+	int32_t offset_timestamp;
+	char debug[jb->max_window_size + 32];
+	int last = 0, i;
+	memset(debug, ' ', sizeof(debug));
+	for (i = 0; i < JITTER_FRAMES; i++) {
+		if (!(jf = jb->frames[i]))
+			continue;
+		offset_timestamp = jf->timestamp - jb->window_timestamp;
+		if (offset_timestamp < 0)
+			continue;
+		offset_timestamp = (int)((double)offset_timestamp * jb->sample_duration * 1000.0);
+		debug[offset_timestamp] = '0' + jf->sequence % 10;
+		last = offset_timestamp + 1;
+	}
+	debug[last] = '\0';
+	LOGP_HOT(DJITTER, LOGL_DEBUG, "%s:%s\n", jb->name, debug);
+#endif
+
+	while (len) {
+		tocopy = jitter_get_samples(jb, &chunk, len, sample_size, conceal, conceal_priv);
+		if (!tocopy)
+			return;
+		memcpy(spl, chunk, tocopy * sample_size);
+		spl += tocopy * sample_size;
+		len -= tocopy;
+	}
+}
+
 void jitter_conceal_s16(uint8_t *_spl, int len, void __attribute__((unused)) *priv)
 {
 	int16_t *spl = (int16_t *)_spl;
@@ -550,3 +736,25 @@ void jitter_conceal_s16(uint8_t *_spl, int len, void __attribute__((unused)) *pr
 	}
 }
 
+/* get statistics of current stream */
+void jitter_get_stats(jitter_t *jb, jitter_stats_t *stats)
+{
+	int64_t expected, lost;
+	double ms = jb->sample_duration * 1000.0;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->target = (double)jb->target_window_size * ms;
+	if (!jb->stat_received)
+		return;
+
+	expected = (int64_t)jb->stat_cycles + jb->stat_max_sequence - jb->stat_base_sequence + 1;
+	lost = expected - jb->stat_received;
+	stats->received = jb->stat_received;
+	stats->late = jb->stat_late;
+	stats->lost = (lost > 0) ? lost : 0;
+	stats->concealed = jb->stat_concealed / jb->samples_20ms;
+	stats->delay = (double)jb->stat_delay * ms;
+	stats->delay_min = (double)jb->stat_delay_min * ms;
+	stats->delay_max = (double)jb->stat_delay_max * ms;
+	stats->jitter = jb->stat_jitter * ms;
+}
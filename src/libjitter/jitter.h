@@ -2,14 +2,21 @@
 #define JITTER_FLAG_NONE	0		// no flags at all
 #define	JITTER_FLAG_LATENCY	(1 << 0)	// keep latency close to target_window_duration
 #define	JITTER_FLAG_REPEAT	(1 << 1)	// repeat audio to extrapolate gaps
+#define	JITTER_FLAG_ADAPTIVE	(1 << 2)	// size target window from measured jitter (requires JITTER_FLAG_LATENCY)
 
 /* window settings for low latency audio and extrapolation of gaps */
 #define JITTER_AUDIO		0.060, 1.000, JITTER_FLAG_LATENCY | JITTER_FLAG_REPEAT
+/* same, but target window follows the jitter of the network (e.g. RTP from SIP trunk) */
+#define JITTER_AUDIO_ADAPTIVE	0.060, 1.000, JITTER_FLAG_LATENCY | JITTER_FLAG_REPEAT | JITTER_FLAG_ADAPTIVE
 /* window settings for analog data (fax/modem) or digial data (HDLC) */
 #define JITTER_DATA		0.100, 0.200, JITTER_FLAG_NONE
 
+/* capacity of jitter buffer in frames (power of 2) and size of frame pool */
+#define JITTER_FRAMES		256
+#define JITTER_POOL		(JITTER_FRAMES + 2)
+
 typedef struct jitter_frame {
-	struct jitter_frame *next;
+	int capacity;			/* allocated size of data */
 	void (*decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv);
 	void *decoder_priv;
 	uint8_t marker;
@@ -20,8 +27,21 @@ typedef struct jitter_frame {
 	uint8_t data[0];
 } jitter_frame_t;
 
+/* statistics of current stream, they are cleared when the buffer is reset */
+typedef struct jitter_stats {
+	uint32_t received;		/* frames stored */
+	uint32_t late;			/* frames that arrived after their play out time */
+	uint32_t lost;			/* frames that never arrived (RFC 3550 cumulative lost) */
+	uint32_t concealed;		/* gaps concealed, counted in 20ms frames */
+	double delay;			/* delay of last frame (ms) */
+	double delay_min, delay_max;	/* minimum and maximum delay (ms) */
+	double jitter;			/* interarrival jitter (RFC 3550) (ms) */
+	double target;			/* current target window (ms) */
+} jitter_stats_t;
+
 typedef struct jitter {
 	char name[64];
+	const char *owner;		/* name for memory accounting */
 
 	/* frame properties */
 	double sample_duration;		/* duration of a frame (ms) */
@@ -40,14 +60,37 @@ typedef struct jitter {
 	double delay_interval;		/* interval for delay measurement (seconds) */
 	double delay_counter;		/* current counter to count interval (seconds) */
 	int min_delay;			/* minimum delay measured during interval (frames) */
+	int init_window_size;		/* target window size as given on creation (frames) */
+
+	/* statistics */
+	uint32_t stat_received, stat_late;
+	uint32_t stat_cycles;		/* sequence number wraps (shifted by 16 bits) */
+	uint16_t stat_max_sequence;	/* highest sequence number received */
+	uint32_t stat_base_sequence;	/* first sequence number of stream */
+	int64_t stat_concealed;		/* samples concealed */
+	int32_t stat_delay, stat_delay_min, stat_delay_max; /* samples */
+	bool stat_arrival_valid;
+	double stat_arrival;		/* arrival time of last frame (samples) */
+	double stat_jitter;		/* interarrival jitter estimate (samples) */
+	int stat_frame_size;		/* timestamp increment of consecutive frames (samples) */
+	uint16_t stat_last_sequence;	/* sequence number of last frame */
+	uint32_t stat_last_timestamp;	/* timestamp of last frame */
+
+	/* frames, indexed by sequence number */
+	jitter_frame_t *frames[JITTER_FRAMES];
+	int frames_num;			/* number of frames stored */
+	uint16_t head_sequence;		/* lowest sequence number that may be stored */
+	uint16_t tail_sequence;		/* highest sequence number that is stored */
 
-	/* list of frames */
-	jitter_frame_t *frame_list;
+	/* pool of free frames, allocated on first use and kept until destroyed */
+	jitter_frame_t *pool[JITTER_POOL];
+	int pool_num;			/* number of free frames in pool */
 
 	/* sample buffer (optional) */
 	uint8_t *spl_buf;		/* current samples buffer */
 	int spl_pos;			/* position of in buffer */
 	int spl_len;			/* total buffer size */
+	int spl_size;			/* allocated size of buffer (bytes) */
 	bool spl_valid;			/* if buffer has valid frame (not repeated) */
 
 } jitter_t;
@@ -55,13 +98,15 @@ typedef struct jitter {
 int jitter_create(jitter_t *jb, const char *name, double samplerate, double target_window_duration, double max_window_duration, uint32_t window_flags);
 void jitter_reset(jitter_t *jb);
 void jitter_destroy(jitter_t *jb);
-jitter_frame_t *jitter_frame_alloc(void (*decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv), void *decoder_priv, uint8_t *data, int size, uint8_t marker, uint16_t sequence, uint32_t timestamp, uint32_t ssrc);
-void jitter_frame_free(jitter_frame_t *jf);
+jitter_frame_t *jitter_frame_alloc(jitter_t *jb, void (*decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv), void *decoder_priv, uint8_t *data, int size, uint8_t marker, uint16_t sequence, uint32_t timestamp, uint32_t ssrc);
+void jitter_frame_free(jitter_t *jb, jitter_frame_t *jf);
 void jitter_frame_get(jitter_frame_t *jf, void (**decoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *priv), void **decoder_priv, uint8_t **data, int *size, uint8_t *marker, uint16_t *sequence, uint32_t *timestamp, uint32_t *ssrc);
 void jitter_save(jitter_t *jb, jitter_frame_t *jf);
 int32_t jitter_offset(jitter_t *jb);
 jitter_frame_t *jitter_load(jitter_t *jb);
 void jitter_advance(jitter_t *jb, uint32_t offset);
+int jitter_get_samples(jitter_t *jb, uint8_t **spl, int len, size_t sample_size, void (*conceal)(uint8_t *spl, int len, void *priv), void *conceal_priv);
 void jitter_load_samples(jitter_t *jb, uint8_t *spl, int len, size_t sample_size, void (*conceal)(uint8_t *spl, int len, void *priv), void *conceal_priv);
+void jitter_get_stats(jitter_t *jb, jitter_stats_t *stats);
 void jitter_conceal_s16(uint8_t *_spl, int len, void __attribute__((unused)) *priv);
 
@@ -20,11 +20,18 @@
 #include <sys/ioctl.h>
 #include <math.h>
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/application.h>
 #include "logging.h"
+#include "thread_prio.h"
 
 int loglevel = LOGL_INFO;
+int log_hot_suspended = 0;
 
 static int scroll_window_start = 0;
 static int scroll_window_end = 0;
@@ -40,6 +47,178 @@ void unlock_logging(void)
 	log_tgt_mutex_unlock();
 }
 
+/*
+ * Asynchronous output
+ *
+ * Each thread that logs gets its own lock-free ring of formatted messages.
+ * A background thread writes them, so a slow terminal or log file does not
+ * stall real time processing. If a ring is full, the message is dropped and
+ * counted instead of blocking.
+ */
+
+#define LOG_RING_SIZE		65536	/* bytes per thread, must be power of 2 */
+#define LOG_LINE_MAX		1024	/* longer messages are truncated */
+#define LOG_ASYNC_INTERVAL	10000	/* us to sleep, if there is nothing to write */
+
+struct log_ring {
+	struct log_ring	*next;
+	char		buffer[LOG_RING_SIZE];
+	atomic_uint	in;		/* bytes written, changed by producer only */
+	atomic_uint	out;		/* bytes read, changed by writer thread only */
+	atomic_uint	dropped;	/* messages dropped due to full ring */
+};
+
+static atomic_int log_async_running;
+static pthread_t log_async_tid;
+static pthread_mutex_t log_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct log_ring *log_ring_head = NULL;
+static __thread struct log_ring *log_ring_thread = NULL;
+static void (*log_sync_output)(struct log_target *target, unsigned int level, const char *string);
+
+static void ring_put(struct log_ring *ring, unsigned int pos, const void *data, int len)
+{
+	unsigned int offset = pos & (LOG_RING_SIZE - 1);
+	int first = LOG_RING_SIZE - offset;
+
+	if (first > len)
+		first = len;
+	memcpy(ring->buffer + offset, data, first);
+	memcpy(ring->buffer, (const char *)data + first, len - first);
+}
+
+static void ring_get(struct log_ring *ring, unsigned int pos, void *data, int len)
+{
+	unsigned int offset = pos & (LOG_RING_SIZE - 1);
+	int first = LOG_RING_SIZE - offset;
+
+	if (first > len)
+		first = len;
+	memcpy(data, ring->buffer + offset, first);
+	memcpy((char *)data + first, ring->buffer, len - first);
+}
+
+/* output function of log target, called by the thread that logs */
+static void async_output(struct log_target *target, unsigned int level, const char *string)
+{
+	struct log_ring *ring = log_ring_thread;
+	unsigned int in, out;
+	uint8_t header[3];
+	int len;
+
+	/* first message of this thread */
+	if (!ring) {
+		ring = calloc(1, sizeof(*ring));
+		if (!ring) {
+			log_sync_output(target, level, string);
+			return;
+		}
+		pthread_mutex_lock(&log_ring_mutex);
+		ring->next = log_ring_head;
+		log_ring_head = ring;
+		pthread_mutex_unlock(&log_ring_mutex);
+		log_ring_thread = ring;
+	}
+
+	len = strlen(string);
+	if (len > LOG_LINE_MAX)
+		len = LOG_LINE_MAX;
+	in = atomic_load_explicit(&ring->in, memory_order_relaxed);
+	out = atomic_load_explicit(&ring->out, memory_order_acquire);
+	if (LOG_RING_SIZE - (in - out) < (unsigned int)(len + 3)) {
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return;
+	}
+	header[0] = level;
+	header[1] = len;
+	header[2] = len >> 8;
+	ring_put(ring, in, header, 3);
+	ring_put(ring, in + 3, string, len);
+	atomic_store_explicit(&ring->in, in + 3 + len, memory_order_release);
+}
+
+/* write all messages of all rings, return number of messages */
+static int async_flush(void)
+{
+	struct log_ring *ring;
+	unsigned int in, out, dropped;
+	uint8_t header[3];
+	char string[LOG_LINE_MAX + 1];
+	int len, count = 0;
+
+	pthread_mutex_lock(&log_ring_mutex);
+	ring = log_ring_head;
+	pthread_mutex_unlock(&log_ring_mutex);
+
+	for (; ring; ring = ring->next) {
+		in = atomic_load_explicit(&ring->in, memory_order_acquire);
+		out = atomic_load_explicit(&ring->out, memory_order_relaxed);
+		while (in - out >= 3) {
+			ring_get(ring, out, header, 3);
+			len = header[1] | (header[2] << 8);
+			ring_get(ring, out + 3, string, len);
+			string[len] = '\0';
+			lock_logging();
+			log_sync_output(osmo_stderr_target, header[0], string);
+			unlock_logging();
+			out += 3 + len;
+			atomic_store_explicit(&ring->out, out, memory_order_release);
+			count++;
+		}
+		dropped = atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+		if (dropped) {
+			snprintf(string, sizeof(string), "*** %u log messages dropped, output is too slow! ***\n", dropped);
+			lock_logging();
+			log_sync_output(osmo_stderr_target, LOGL_ERROR, string);
+			unlock_logging();
+		}
+	}
+
+	return count;
+}
+
+static void *async_thread(void __attribute__((unused)) *arg)
+{
+	thread_prio_apply(THREAD_LOGGING);
+
+	while (atomic_load(&log_async_running)) {
+		if (!async_flush())
+			usleep(LOG_ASYNC_INTERVAL);
+	}
+
+	return NULL;
+}
+
+static void async_stop(void)
+{
+	if (!atomic_load(&log_async_running))
+		return;
+	atomic_store(&log_async_running, 0);
+	pthread_join(log_async_tid, NULL);
+	async_flush();
+	osmo_stderr_target->output = log_sync_output;
+}
+
+static int async_start(void)
+{
+	int rc;
+
+	if (atomic_load(&log_async_running))
+		return 0;
+	log_sync_output = osmo_stderr_target->output;
+	atomic_store(&log_async_running, 1);
+	rc = pthread_create(&log_async_tid, NULL, async_thread, NULL);
+	if (rc) {
+		atomic_store(&log_async_running, 0);
+		fprintf(stderr, "Failed to create logging thread (rc = %d)!\n", rc);
+		return -rc;
+	}
+	osmo_stderr_target->output = async_output;
+	/* write what is left, when the program ends */
+	atexit(async_stop);
+
+	return 0;
+}
+
 void get_win_size(int *w, int *h)
 {
 	struct winsize win;
@@ -113,7 +292,7 @@ void logging_limit_scroll_bottom(int lines)
 
 const char *debug_amplitude(double level)
 {
-	static char text[42];
+	static __thread char text[42];
 
 	strcpy(text, "                    :                    ");
 	if (level > 1.0)
@@ -129,7 +308,7 @@ const char *debug_amplitude(double level)
 
 const char *debug_db(double level_db)
 {
-	static char text[128];
+	static __thread char text[128];
 	int l;
 
 	strcpy(text, ":  .  :  .  :  .  :  .  :  .  :  .  :  .  :  .  |  .  :  .  :  .  :  .  :  .  :  .  :  .  :  .  :");
@@ -154,6 +333,10 @@ void logging_print_help(void)
 	printf("        -> If no category is specified, all categories are selected\n");
 	printf(" -v --verbose date\n");
 	printf("        Show date with debug output\n");
+	printf(" -v --verbose async\n");
+	printf("        Write debug output by a background thread, so that slow output does\n");
+	printf("        not stall processing. Messages are dropped (and counted) if output\n");
+	printf("        cannot keep up.\n");
 }
 
 static unsigned char log_levels[] = { LOGL_DEBUG, LOGL_INFO, LOGL_NOTICE, LOGL_ERROR };
@@ -196,6 +379,9 @@ int parse_logging_opt(const char *optarg)
 		return 0;
 	}
 
+	if (!strcasecmp(optarg, "async"))
+		return async_start();
+
 	dup = dstring = strdup(optarg);
 	p = strsep(&dstring, ",");
 	for (i = 0; i < p[i]; i++) {
@@ -4,9 +4,25 @@
 #include "categories.h"
 
 extern int loglevel;
+extern int log_hot_suspended;	/* debug in hot paths is suppressed, due to overload */
 
 #define LOGP_CHAN(cat, level, fmt, arg...) LOGP(cat, level, "(chan %s) " fmt, CHAN, ## arg)
 
+/* Logging in per bit, per frame and per sample paths. Messages below
+ * LOG_HOT_MIN_LEVEL are removed at compile time (see --disable-hot-debug),
+ * messages at or above it are still controlled at run time. Debug messages
+ * are suppressed while overload control sheds debug decoding.
+ */
+#ifndef LOG_HOT_MIN_LEVEL
+#define LOG_HOT_MIN_LEVEL LOGL_DEBUG
+#endif
+#define LOG_HOT_ENABLED(level) ((level) >= LOG_HOT_MIN_LEVEL && ((level) > LOGL_DEBUG || !log_hot_suspended))
+#define LOGLEVEL_HOT(level) (LOG_HOT_ENABLED(level) && loglevel <= (level))
+#define LOGP_HOT(cat, level, fmt, arg...) \
+	do { if (LOG_HOT_ENABLED(level)) LOGP(cat, level, fmt, ## arg); } while (0)
+#define LOGP_CHAN_HOT(cat, level, fmt, arg...) \
+	do { if (LOG_HOT_ENABLED(level)) LOGP_CHAN(cat, level, fmt, ## arg); } while (0)
+
 void get_win_size(int *w, int *h);
 void lock_logging(void);
 void unlock_logging(void);
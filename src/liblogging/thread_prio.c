@@ -0,0 +1,232 @@
+/* Scheduling policy and CPU affinity of threads by their role
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include "logging.h"
+#include "thread_prio.h"
+
+#define MAX_CPUS	256
+#define STACK_PREFAULT	(64 * 1024)
+
+static const char *role_names[THREAD_ROLES] = {
+	"main",
+	"sdr-rx",
+	"sdr-tx",
+	"worker",
+	"wave",
+	"logging",
+	"display",
+	"device",
+};
+
+static struct thread_config {
+	int		set_policy;
+	int		policy;
+	int		prio;
+	int		cpus[MAX_CPUS];	/* each instance of a role is pinned to the next CPU */
+	int		num_cpus;
+	atomic_int	instances;
+} config[THREAD_ROLES];
+
+int thread_prio_mlock = 0;
+
+void thread_prio_print_help(void)
+{
+	int r;
+
+	printf("    --thread <role>=[<policy>[:<prio>]][@<cpu>[,<cpu>|-<cpu>...]]\n");
+	printf("        Set scheduling policy, priority and CPU affinity of threads of a role.\n");
+	printf("        Give this option for each role. Policy is one of 'other', 'batch',\n");
+	printf("        'idle', 'fifo', 'rr'. Priority is used with 'fifo' and 'rr' only.\n");
+	printf("        Each thread of a role is pinned to the next CPU of the list, e.g.\n");
+	printf("        '--thread worker=fifo:50@2-5' pins the first worker to CPU 2 and the\n");
+	printf("        fifth worker to CPU 2 again. Roles are:");
+	for (r = 0; r < THREAD_ROLES; r++)
+		printf("%s '%s'", (r) ? "," : "", role_names[r]);
+	printf("\n");
+	printf("        Role 'main' overrides '--realtime'.\n");
+	printf("    --mlock\n");
+	printf("        Lock all memory of the process and prefault the stack of each thread,\n");
+	printf("        so DSP buffers are never paged out or faulted in while running.\n");
+}
+
+static int parse_policy(const char *name, int len)
+{
+	if (len == 5 && !strncmp(name, "other", len))
+		return SCHED_OTHER;
+	if (len == 5 && !strncmp(name, "batch", len))
+		return SCHED_BATCH;
+	if (len == 4 && !strncmp(name, "idle", len))
+		return SCHED_IDLE;
+	if (len == 4 && !strncmp(name, "fifo", len))
+		return SCHED_FIFO;
+	if (len == 2 && !strncmp(name, "rr", len))
+		return SCHED_RR;
+	return -EINVAL;
+}
+
+int thread_prio_parse(const char *arg)
+{
+	struct thread_config *c;
+	const char *p, *end;
+	char *next;
+	int r, len, first, last, cpu;
+
+	p = strchr(arg, '=');
+	if (!p)
+		goto invalid;
+	len = p - arg;
+	for (r = 0; r < THREAD_ROLES; r++) {
+		if ((int)strlen(role_names[r]) == len && !strncmp(arg, role_names[r], len))
+			break;
+	}
+	if (r == THREAD_ROLES) {
+		fprintf(stderr, "Unknown thread role '%.*s', use '-h' for help!\n", len, arg);
+		return -EINVAL;
+	}
+	c = &config[r];
+	p++;
+
+	/* policy and priority */
+	end = p + strcspn(p, ":@");
+	if (end > p) {
+		c->policy = parse_policy(p, end - p);
+		if (c->policy < 0) {
+			fprintf(stderr, "Unknown scheduling policy '%.*s', use '-h' for help!\n", (int)(end - p), p);
+			return -EINVAL;
+		}
+		c->set_policy = 1;
+		c->prio = 0;
+	}
+	p = end;
+	if (*p == ':') {
+		c->prio = strtol(p + 1, &next, 10);
+		if (next == p + 1)
+			goto invalid;
+		if (c->prio < sched_get_priority_min(c->policy) || c->prio > sched_get_priority_max(c->policy)) {
+			fprintf(stderr, "Priority %d is out of range %d..%d of given policy!\n", c->prio, sched_get_priority_min(c->policy), sched_get_priority_max(c->policy));
+			return -EINVAL;
+		}
+		p = next;
+	}
+
+	/* CPU list */
+	if (*p == '@') {
+		c->num_cpus = 0;
+		p++;
+		while (*p) {
+			first = strtol(p, &next, 10);
+			if (next == p)
+				goto invalid;
+			last = first;
+			p = next;
+			if (*p == '-') {
+				last = strtol(p + 1, &next, 10);
+				if (next == p + 1)
+					goto invalid;
+				p = next;
+			}
+			if (first < 0 || last < first || last >= CPU_SETSIZE) {
+				fprintf(stderr, "Invalid CPU range %d-%d!\n", first, last);
+				return -EINVAL;
+			}
+			for (cpu = first; cpu <= last && c->num_cpus < MAX_CPUS; cpu++)
+				c->cpus[c->num_cpus++] = cpu;
+			if (*p == ',')
+				p++;
+			else if (*p)
+				goto invalid;
+		}
+	}
+	if (*p)
+		goto invalid;
+
+	return 0;
+
+invalid:
+	fprintf(stderr, "Invalid thread option '%s', use '-h' for help!\n", arg);
+	return -EINVAL;
+}
+
+/* prefault stack, so it is not faulted in at the first deep call */
+static void __attribute__((noinline)) prefault_stack(void)
+{
+	volatile char stack[STACK_PREFAULT];
+
+	memset((char *)stack, 0, sizeof(stack));
+}
+
+/* to be called by each thread when it starts */
+void thread_prio_apply(enum thread_role role)
+{
+	struct thread_config *c = &config[role];
+	struct sched_param schedp;
+	cpu_set_t cpuset;
+	int instance, cpu, rc;
+
+	instance = atomic_fetch_add(&c->instances, 1);
+
+	if (c->set_policy) {
+		memset(&schedp, 0, sizeof(schedp));
+		schedp.sched_priority = c->prio;
+		rc = pthread_setschedparam(pthread_self(), c->policy, &schedp);
+		if (rc)
+			LOGP(DDSP, LOGL_ERROR, "Failed to set scheduling of %s thread (%s)\n", role_names[role], strerror(rc));
+	}
+
+	if (c->num_cpus) {
+		cpu = c->cpus[instance % c->num_cpus];
+		CPU_ZERO(&cpuset);
+		CPU_SET(cpu, &cpuset);
+		rc = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+		if (rc)
+			LOGP(DDSP, LOGL_ERROR, "Failed to pin %s thread to CPU %d (%s)\n", role_names[role], cpu, strerror(rc));
+		else
+			LOGP(DDSP, LOGL_DEBUG, "Pinned %s thread #%d to CPU %d\n", role_names[role], instance, cpu);
+	}
+
+	if (thread_prio_mlock)
+		prefault_stack();
+}
+
+/* lock current and future memory and keep freed memory, so that it is not faulted in again */
+int thread_prio_lock_memory(void)
+{
+	if (!thread_prio_mlock)
+		return 0;
+
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+		LOGP(DDSP, LOGL_ERROR, "Failed to lock memory (%s), check 'ulimit -l'!\n", strerror(errno));
+		return -errno;
+	}
+	prefault_stack();
+
+	return 0;
+}
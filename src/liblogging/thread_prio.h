@@ -0,0 +1,24 @@
+#ifndef _THREAD_PRIO_H
+#define _THREAD_PRIO_H
+
+/* roles of threads, each role may have its own scheduling and CPU affinity */
+enum thread_role {
+	THREAD_MAIN = 0,	/* main DSP loop */
+	THREAD_SDR_RX,		/* reading from SDR */
+	THREAD_SDR_TX,		/* writing to SDR */
+	THREAD_WORKER,		/* sender and channel workers */
+	THREAD_WAVE,		/* wave recording and playback */
+	THREAD_LOGGING,		/* asynchronous logging */
+	THREAD_DISPLAY,		/* rendering displays */
+	THREAD_DEVICE,		/* character device of datenklo */
+	THREAD_ROLES,
+};
+
+extern int thread_prio_mlock;
+
+void thread_prio_print_help(void);
+int thread_prio_parse(const char *arg);
+void thread_prio_apply(enum thread_role role);
+int thread_prio_lock_memory(void);
+
+#endif /* _THREAD_PRIO_H */
@@ -0,0 +1,115 @@
+/* Automatic tuning of DSP buffer
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Tuning starts with the whole buffer (--buffer) as target, which is how far
+ * TX is processed in advance. At each cycle the fill of the TX buffer is
+ * taken, right before it is refilled. This is the time that is left until
+ * the buffer runs empty. If the lowest fill within a window stays above the
+ * margin, the target is lowered by half of the excess. If it falls below
+ * half of the margin or if the processing of a cycle takes longer than the
+ * remaining fill would allow, the target is raised by twice the shortage.
+ * After an underrun the target is doubled. After each raise, the target is
+ * held for a while, so that it does not oscillate.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "get_time.h"
+#include "autotune.h"
+
+#define AUTOTUNE_WINDOW		2.0	/* evaluation after this time */
+#define AUTOTUNE_HOLD		30.0	/* do not lower target for this time after raising it */
+
+double autotune_margin = 0.0;		/* margin in ms, 0 = tuning is off */
+
+/* buffer_size is in samples, interval in ms */
+void autotune_init(autotune_t *at, int samplerate, int buffer_size, double interval)
+{
+	at->samplerate = samplerate;
+	at->max_target = at->target = buffer_size;
+	at->min_target = (int)((double)samplerate * interval * 2.0 / 1000.0);
+	if (at->min_target > buffer_size)
+		at->min_target = buffer_size;
+	at->margin = (int)((double)samplerate * autotune_margin / 1000.0);
+	at->window_min = -1;
+	at->window_busy = 0.0;
+	at->window_start = 0.0;
+	at->hold_until = 0.0;
+}
+
+static void set_target(autotune_t *at, int target, const char *reason)
+{
+	if (target > at->max_target)
+		target = at->max_target;
+	if (target < at->min_target)
+		target = at->min_target;
+	if (target == at->target)
+		return;
+	LOGP(DSENDER, (target > at->target) ? LOGL_NOTICE : LOGL_INFO, "%s DSP buffer target to %.1f ms (%s).\n", (target > at->target) ? "Raising" : "Lowering", (double)target / (double)at->samplerate * 1000.0, reason);
+	at->target = target;
+}
+
+/* fill of TX buffer before refill (samples) and processing time of this cycle (seconds) */
+void autotune_cycle(autotune_t *at, int fill, double busy)
+{
+	double now;
+	int busy_samples, shortage;
+
+	if (!autotune_margin)
+		return;
+
+	if (at->window_min < 0 || fill < at->window_min)
+		at->window_min = fill;
+	if (busy > at->window_busy)
+		at->window_busy = busy;
+
+	now = get_time();
+	if (!at->window_start)
+		at->window_start = now;
+	if (now - at->window_start < AUTOTUNE_WINDOW)
+		return;
+
+	/* processing time must fit into what is left, in addition to the margin */
+	busy_samples = (int)(at->window_busy * (double)at->samplerate);
+	shortage = at->margin + busy_samples - at->window_min;
+	if (at->window_min < at->margin / 2 || busy_samples > at->window_min) {
+		set_target(at, at->target + 2 * ((shortage > 0) ? shortage : at->margin), "load or jitter increased");
+		at->hold_until = now + AUTOTUNE_HOLD;
+	} else if (shortage < 0 && now >= at->hold_until)
+		set_target(at, at->target + shortage / 2, "stable");
+
+	at->window_min = -1;
+	at->window_busy = 0.0;
+	at->window_start = now;
+}
+
+void autotune_underrun(autotune_t *at)
+{
+	if (!autotune_margin)
+		return;
+
+	set_target(at, at->target * 2, "underrun");
+	at->hold_until = get_time() + AUTOTUNE_HOLD;
+	at->window_min = -1;
+	at->window_busy = 0.0;
+	at->window_start = 0.0;
+}
+
@@ -0,0 +1,20 @@
+
+/* automatic tuning of how far TX is processed in advance */
+typedef struct autotune {
+	int		samplerate;
+	int		target;		/* current fill target of TX buffer (samples) */
+	int		min_target;	/* never below two intervals */
+	int		max_target;	/* buffer size, this is where tuning starts */
+	int		margin;		/* lowest fill that must remain before refill */
+	int		window_min;	/* lowest fill within window */
+	double		window_busy;	/* longest processing of a cycle within window */
+	double		window_start;
+	double		hold_until;	/* target is not lowered before this time */
+} autotune_t;
+
+extern double autotune_margin;
+
+void autotune_init(autotune_t *at, int samplerate, int buffer_size, double interval);
+void autotune_cycle(autotune_t *at, int fill, double busy);
+void autotune_underrun(autotune_t *at);
+
@@ -37,6 +37,8 @@
 #include "sender.h"
 #include "call.h"
 #include "console.h"
+#include "overload.h"
+#include "session.h"
 
 #define DISC_TIMEOUT	30, 0
 
@@ -59,69 +61,107 @@ static double level_of(double *samples, int count)
 
 static int connect_on_setup;		/* send patterns towards fixed network */
 static int release_on_disconnect;	/* release towards mobile phone, if OSMO-CC call disconnects, don't send disconnect tone */
+static int use_socket;			/* fixed network is connected via OSMO-CC socket */
+
+struct call_stats call_stats;
 
 osmo_cc_endpoint_t endpoint, *ep;
 
-void encode_l16(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void __attribute__((unused)) *arg)
+/* encode into given buffer, return length of payload */
+static int encode_l16_buf(const int16_t *src, int len, uint8_t *dst_data)
 {
-	uint16_t *src = (uint16_t *)src_data, *dst;
+	uint16_t *dst = (uint16_t *)dst_data;
+	int i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = htons(src[i]);
+
+	return len * 2;
+}
+
+/* decode into given buffer, which may be the source buffer */
+static int decode_l16_buf(const uint8_t *src_data, int src_len, int16_t *dst)
+{
+	const uint16_t *src = (const uint16_t *)src_data;
 	int len = src_len / 2, i;
 
-	dst = malloc(len * 2);
+	for (i = 0; i < len; i++)
+		dst[i] = ntohs(src[i]);
+
+	return len;
+}
+
+void encode_l16(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void __attribute__((unused)) *arg)
+{
+	uint8_t *dst;
+
+	dst = malloc(src_len);
 	if (!dst)
 		return;
-	for (i = 0; i < len; i++)
-		dst[i] = htons(src[i]);
-	*dst_data = (uint8_t *)dst;
-	*dst_len = len * 2;
+	*dst_len = encode_l16_buf((int16_t *)src_data, src_len / 2, dst);
+	*dst_data = dst;
 }
 
 void decode_l16(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void __attribute__((unused)) *arg)
 {
-	uint16_t *src = (uint16_t *)src_data, *dst;
-	int len = src_len / 2, i;
+	int16_t *dst;
 
-	dst = malloc(len * 2);
+	dst = malloc(src_len);
 	if (!dst)
 		return;
-	for (i = 0; i < len; i++)
-		dst[i] = ntohs(src[i]);
+	*dst_len = decode_l16_buf(src_data, src_len, dst) * 2;
 	*dst_data = (uint8_t *)dst;
-	*dst_len = len * 2;
 }
 
+/* G.711 is offered first, to save bandwidth and transcoding at the peer */
 static struct osmo_cc_helper_audio_codecs codecs[] = {
+	{ "PCMA", 8000, 1, g711_encode_alaw, g711_decode_alaw },
+	{ "PCMU", 8000, 1, g711_encode_ulaw, g711_decode_ulaw },
 	{ "L16", 8000, 1, encode_l16, decode_l16 },
+	{ NULL, 0, 0, NULL, NULL},
+};
+
+static struct osmo_cc_helper_audio_codecs codecs_no_l16[] = {
 	{ "PCMA", 8000, 1, g711_encode_alaw, g711_decode_alaw },
 	{ "PCMU", 8000, 1, g711_encode_ulaw, g711_decode_ulaw },
 	{ NULL, 0, 0, NULL, NULL},
 };
 
+/* codecs that patterns and audio buffers are encoded for, once for all frames */
+static struct buffer_codec {
+	void (*encoder)(uint8_t *src_data, int src_len, uint8_t **dst_data, int *dst_len, void *arg);
+} buffer_codecs[] = {
+	{ g711_encode_alaw },
+	{ g711_encode_ulaw },
+	{ encode_l16 },
+	{ NULL },
+};
+
 static int no_l16 = 0;
 
 /* stream patterns/announcements */
-int16_t *ringback_spl = NULL;
+const int16_t *ringback_spl = NULL;
 int ringback_size = 0;
 int ringback_max = 0;
-int16_t *hangup_spl = NULL;
+const int16_t *hangup_spl = NULL;
 int hangup_size = 0;
 int hangup_max = 0;
-int16_t *busy_spl = NULL;
+const int16_t *busy_spl = NULL;
 int busy_size = 0;
 int busy_max = 0;
-int16_t *noanswer_spl = NULL;
+const int16_t *noanswer_spl = NULL;
 int noanswer_size = 0;
 int noanswer_max = 0;
-int16_t *outoforder_spl = NULL;
+const int16_t *outoforder_spl = NULL;
 int outoforder_size = 0;
 int outoforder_max = 0;
-int16_t *invalidnumber_spl = NULL;
+const int16_t *invalidnumber_spl = NULL;
 int invalidnumber_size = 0;
 int invalidnumber_max = 0;
-int16_t *congestion_spl = NULL;
+const int16_t *congestion_spl = NULL;
 int congestion_size = 0;
 int congestion_max = 0;
-int16_t *recall_spl = NULL;
+const int16_t *recall_spl = NULL;
 int recall_size = 0;
 int recall_max = 0;
 
@@ -247,7 +287,8 @@ enum process_state {
 
 /* call process */
 typedef struct process {
-	struct process *next;
+	struct process *next, *prev;
+	struct process *hash_next; /* next process in hash bucket of callref */
 	int callref;
 	enum process_state state;
 	int audio_disconnected; /* if not associated with transceiver anymore */
@@ -257,10 +298,27 @@ typedef struct process {
 	struct osmo_timer_list timer;
 	osmo_cc_session_t *session;
 	osmo_cc_session_codec_t *codec; /* codec to send */
+	uint8_t payload[160 * 2]; /* scratch buffer to encode one frame */
+	uint16_t direct_sequence; /* frames from console without RTP */
+	uint32_t direct_timestamp;
 } process_t;
 
 static process_t *process_head = NULL;
 
+/* processes are also indexed by callref, the list is used for iteration */
+#define PROCESS_HASH_SIZE	1024	/* must be power of 2 */
+static process_t *process_hash[PROCESS_HASH_SIZE];
+
+static unsigned int hash_callref(int callref)
+{
+	uint32_t x = callref;
+
+	x ^= x >> 16;
+	x *= 0x45d9f3bu;
+	x ^= x >> 16;
+	return x & (PROCESS_HASH_SIZE - 1);
+}
+
 static void process_timeout(void *data);
 static void indicate_disconnect_release(int callref, int cause, uint8_t msg_type);
 
@@ -275,9 +333,13 @@ static process_t *create_process(int callref, enum process_state state)
 	}
 	osmo_timer_setup(&process->timer, process_timeout, process);
 	process->next = process_head;
+	if (process_head)
+		process_head->prev = process;
 	process_head = process;
 
 	process->callref = callref;
+	process->hash_next = process_hash[hash_callref(callref)];
+	process_hash[hash_callref(callref)] = process;
 	process->state = state;
 
 	return process;
@@ -285,32 +347,38 @@ static process_t *create_process(int callref, enum process_state state)
 
 static void destroy_process(int callref)
 {
-	process_t *process = process_head;
-	process_t **process_p = &process_head;
-
-	while (process) {
-		if (process->callref == callref) {
-			*process_p = process->next;
-			osmo_timer_del(&process->timer);
-			if (process->session)
-				osmo_cc_free_session(process->session);
-			free(process);
-			return;
-		}
-		process_p = &process->next;
-		process = process->next;
+	process_t **process_p;
+	process_t *process;
+
+	for (process_p = &process_hash[hash_callref(callref)]; *process_p; process_p = &(*process_p)->hash_next) {
+		if ((*process_p)->callref == callref)
+			break;
 	}
-	LOGP(DCALL, LOGL_ERROR, "Process with callref %d not found!\n", callref);
+	process = *process_p;
+	if (!process) {
+		LOGP(DCALL, LOGL_ERROR, "Process with callref %d not found!\n", callref);
+		return;
+	}
+	*process_p = process->hash_next;
+	if (process->prev)
+		process->prev->next = process->next;
+	else
+		process_head = process->next;
+	if (process->next)
+		process->next->prev = process->prev;
+	osmo_timer_del(&process->timer);
+	if (process->session)
+		osmo_cc_free_session(process->session);
+	free(process);
 }
 
 static process_t *get_process(int callref)
 {
-	process_t *process = process_head;
+	process_t *process;
 
-	while (process) {
+	for (process = process_hash[hash_callref(callref)]; process; process = process->hash_next) {
 		if (process->callref == callref)
 			return process;
-		process = process->next;
 	}
 	return NULL;
 }
@@ -355,6 +423,101 @@ static void disconnect_process(int callref, int cause)
 	osmo_timer_schedule(&process->timer, DISC_TIMEOUT);
 }
 
+/* each pattern's cadence, pre-encoded for each buffer codec
+ * the first frame is repeated after the end, so every frame is contiguous */
+#define NUM_PATTERNS		(PATTERN_RECALL + 1)
+#define NUM_BUFFER_CODECS	(sizeof(buffer_codecs) / sizeof(buffer_codecs[0]) - 1)
+static struct pattern_frames {
+	const int16_t *spl;	/* pattern that was rendered */
+	int size, max;
+	uint8_t *payload;	/* encoded cadence */
+	int bytes_per_sample;
+} pattern_frames[NUM_PATTERNS][NUM_BUFFER_CODECS];
+
+static struct pattern_frames *get_pattern_frames(enum audio_pattern pattern, int codec)
+{
+	struct pattern_frames *pf = &pattern_frames[pattern][codec];
+	const int16_t *spl;
+	int size, max, i;
+	int16_t *samples;
+	int len;
+
+	get_pattern(&spl, &size, &max, pattern);
+	if (!spl || max <= 0)
+		return NULL;
+	if (pf->payload && pf->spl == spl && pf->size == size && pf->max == max)
+		return pf;
+
+	/* render cadence and encode it */
+	free(pf->payload);
+	pf->payload = NULL;
+	samples = malloc((max + 160) * sizeof(*samples));
+	if (!samples) {
+		LOGP(DCALL, LOGL_ERROR, "No memory!\n");
+		return NULL;
+	}
+	for (i = 0; i < max + 160; i++)
+		samples[i] = (i % max < size) ? spl[i % max] >> 2 : 0;
+	len = 0;
+	buffer_codecs[codec].encoder((uint8_t *)samples, (max + 160) * 2, &pf->payload, &len, NULL);
+	free(samples);
+	if (!pf->payload) {
+		LOGP(DCALL, LOGL_ERROR, "No memory!\n");
+		return NULL;
+	}
+	pf->bytes_per_sample = len / (max + 160);
+	pf->spl = spl;
+	pf->size = size;
+	pf->max = max;
+
+	return pf;
+}
+
+static void render_pattern_frames(void)
+{
+	int pattern, codec;
+
+	for (pattern = PATTERN_NONE + 1; pattern < NUM_PATTERNS; pattern++) {
+		for (codec = 0; codec < (int)NUM_BUFFER_CODECS; codec++)
+			get_pattern_frames(pattern, codec);
+	}
+}
+
+static void free_pattern_frames(void)
+{
+	int pattern, codec;
+
+	for (pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+		for (codec = 0; codec < (int)NUM_BUFFER_CODECS; codec++) {
+			free(pattern_frames[pattern][codec].payload);
+			memset(&pattern_frames[pattern][codec], 0, sizeof(pattern_frames[pattern][codec]));
+		}
+	}
+}
+
+/* send frame of pattern from pre-encoded cadence, return 0 if there is none */
+static int send_pattern_frame(process_t *process)
+{
+	struct pattern_frames *pf;
+	int codec;
+
+	for (codec = 0; buffer_codecs[codec].encoder; codec++) {
+		if (buffer_codecs[codec].encoder == process->codec->encoder)
+			break;
+	}
+	if (!buffer_codecs[codec].encoder)
+		return 0;
+	pf = get_pattern_frames(process->pattern, codec);
+	if (!pf)
+		return 0;
+	if (process->audio_pos >= pf->max)
+		process->audio_pos = 0;
+	osmo_cc_rtp_send(process->codec, pf->payload + process->audio_pos * pf->bytes_per_sample, 160 * pf->bytes_per_sample, 0, 1, 160);
+	process->audio_pos = (process->audio_pos + 160) % pf->max;
+
+	return 1;
+}
+
 static void get_process_patterns(process_t *process, int16_t *samples, int length)
 {
 	const int16_t *spl;
@@ -393,8 +556,12 @@ static void process_timeout(void *data)
 static void down_audio(struct osmo_cc_session_codec *codec, uint8_t marker, uint16_t sequence_number, uint32_t timestamp, uint32_t ssrc, uint8_t *payload, int payload_len)
 {
 	process_t *process = codec->media->session->priv;
+	int16_t spl[1024];
 //	sample_t samples[len / 2];
 
+	if (process && use_socket)
+		session_record_rtp(process->callref, marker, sequence_number, timestamp, ssrc, payload, payload_len);
+
 	/* if we are disconnected, ignore audio */
 	if (!process || process->pattern != PATTERN_NONE)
 		return;
@@ -405,6 +572,13 @@ static void down_audio(struct osmo_cc_session_codec *codec, uint8_t marker, uint
 	printf("festnetz-level: %s                  %.4f\n", debug_db(lev), (20 * log10(lev)));
 #endif
 #endif
+	/* decode L16 here, so the jitter buffer just copies the samples */
+	if (codec->decoder == decode_l16 && payload_len <= (int)sizeof(spl)) {
+		payload_len = decode_l16_buf(payload, payload_len, spl) * 2;
+		latency_probe_down(spl, payload_len / 2);
+		call_down_audio(NULL, NULL, process->callref, marker, sequence_number, timestamp, ssrc, (uint8_t *)spl, payload_len);
+		return;
+	}
 	call_down_audio(codec->decoder, process, process->callref, marker, sequence_number, timestamp, ssrc, payload, payload_len);
 }
 
@@ -425,7 +599,7 @@ static void indicate_setup(process_t *process, const char *callerid, const char
 	/* bearer capability */
 	osmo_cc_add_ie_bearer(msg, OSMO_CC_CODING_ITU_T, OSMO_CC_CAPABILITY_AUDIO, OSMO_CC_MODE_CIRCUIT);
 	/* sdp offer */
-	process->session = osmo_cc_helper_audio_offer(&ep->session_config, process, codecs + no_l16, down_audio, msg, 1);
+	process->session = osmo_cc_helper_audio_offer(&ep->session_config, process, (no_l16) ? codecs_no_l16 : codecs, down_audio, msg, 1);
 
 	LOGP(DCALL, LOGL_INFO, "Indicate OSMO-CC setup towards fixed network\n");
 	osmo_cc_ll_msg(ep, process->callref, msg);
@@ -512,6 +686,7 @@ int call_up_setup(const char *callerid, const char *dialing, uint8_t network, co
 		LOGP(DCALL, LOGL_INFO, " -> Call to Operator '%s'\n", dialing);
 
 	call = osmo_cc_call_new(ep);
+	call_stats.setup++;
 
 	process = create_process(call->callref, PROCESS_SETUP_RO);
 
@@ -551,6 +726,7 @@ void call_up_answer(int callref, const char *connect_id)
 	}
 
 	LOGP(DCALL, LOGL_INFO, "Call has been answered by '%s'\n", connect_id);
+	call_stats.answer++;
 
 	if (!connect_on_setup)
 		indicate_answer(callref, NULL, connect_id);
@@ -603,13 +779,32 @@ void call_tone_recall(int callref, int on)
 	set_pattern_process(callref, (on) ? PATTERN_RECALL : PATTERN_NONE);
 }
 
+/* encode frame of process and send it via RTP */
+static void send_process_audio(process_t *process, int16_t *spl, int len)
+{
+	uint8_t *payload;
+	int payload_len;
+
+	if (process->codec->encoder == encode_l16 && len * 2 <= (int)sizeof(process->payload)) {
+		payload_len = encode_l16_buf(spl, len, process->payload);
+		osmo_cc_rtp_send(process->codec, process->payload, payload_len, 0, 1, len);
+		return;
+	}
+
+	/* G.711 is encoded by libosmo-cc, which allocates the payload */
+	payload = NULL;
+	process->codec->encoder((uint8_t *)spl, len * 2, &payload, &payload_len, process);
+	if (!payload)
+		return;
+	osmo_cc_rtp_send(process->codec, payload, payload_len, 0, 1, len);
+	free(payload);
+}
+
 /* forward audio to OSMO-CC or call instance */
 void call_up_audio(int callref, sample_t *samples, int len)
 {
 	process_t *process;
 	int16_t spl[len];
-	uint8_t *payload;
-	int payload_len;
 
 	if (len != 160) {
 		fprintf(stderr, "Samples must be 160, please fix!\n");
@@ -632,15 +827,125 @@ void call_up_audio(int callref, sample_t *samples, int len)
 	double lev = level_of(samples, len);
 	printf("   mobil-level: %s%.4f\n", debug_db(lev), (20 * log10(lev)));
 #endif
+	latency_probe_up(samples, len);
+	/* console is local and takes samples directly */
+	if (console_up_audio_direct(callref, samples, len))
+		return;
 	/* real to integer */
 	samples_to_int16_speech(spl, samples, len);
 	/* encode and send via RTP */
-	process->codec->encoder((uint8_t *)spl, len * 2, &payload, &payload_len, process);
-	osmo_cc_rtp_send(process->codec, payload, payload_len, 0, 1, len);
-	free(payload);
+	send_process_audio(process, spl, len);
 	/* don't destroy process here in case of an error */
 }
 
+/* forward audio from the console's headset, without RTP */
+void call_down_audio_direct(int callref, int16_t *spl, int len)
+{
+	process_t *process;
+
+	/* if we are disconnected, ignore audio */
+	process = get_process(callref);
+	if (!process || process->pattern != PATTERN_NONE)
+		return;
+
+	latency_probe_down(spl, len);
+	call_down_audio(NULL, NULL, callref, process->direct_sequence++, 0, process->direct_timestamp, 0, (uint8_t *)spl, len * 2);
+	process->direct_timestamp += len;
+}
+
+/* Audio that is sent to many calls, like an announcement: it is converted
+ * once and encoded once for each buffer codec that is used by any call.
+ * Each call sends frames from its own position. */
+struct call_audio_buffer {
+	int16_t		*spl;				/* samples at speech level */
+	int		len;
+	uint8_t		*payload[NUM_BUFFER_CODECS];	/* encoded samples, if codec is used */
+	int		bytes_per_sample[NUM_BUFFER_CODECS];
+};
+
+call_audio_buffer_t *call_audio_buffer_create(sample_t *samples, int len)
+{
+	call_audio_buffer_t *buffer;
+
+	buffer = calloc(1, sizeof(*buffer));
+	if (!buffer) {
+		LOGP(DCALL, LOGL_ERROR, "No memory!\n");
+		return NULL;
+	}
+	buffer->spl = malloc(len * sizeof(*buffer->spl));
+	if (!buffer->spl) {
+		LOGP(DCALL, LOGL_ERROR, "No memory!\n");
+		free(buffer);
+		return NULL;
+	}
+	samples_to_int16_speech(buffer->spl, samples, len);
+	buffer->len = len;
+
+	return buffer;
+}
+
+void call_audio_buffer_destroy(call_audio_buffer_t *buffer)
+{
+	int codec;
+
+	if (!buffer)
+		return;
+	for (codec = 0; codec < (int)NUM_BUFFER_CODECS; codec++)
+		free(buffer->payload[codec]);
+	free(buffer->spl);
+	free(buffer);
+}
+
+/* send samples of buffer, starting at given position */
+void call_up_audio_buffer(int callref, call_audio_buffer_t *buffer, int pos, int len)
+{
+	process_t *process;
+	int codec;
+
+	if (len != 160) {
+		fprintf(stderr, "Samples must be 160, please fix!\n");
+		abort();
+	}
+	if (pos < 0 || pos + len > buffer->len) {
+		fprintf(stderr, "Samples exceed audio buffer, please fix!\n");
+		abort();
+	}
+	if (!callref)
+		return;
+
+	/* if we are disconnected, ignore audio */
+	process = get_process(callref);
+	if (!process || process->pattern != PATTERN_NONE)
+		return;
+
+	/* no codec negotiated (yet) */
+	if (!process->codec)
+		return;
+
+	for (codec = 0; buffer_codecs[codec].encoder; codec++) {
+		if (buffer_codecs[codec].encoder == process->codec->encoder)
+			break;
+	}
+	if (!buffer_codecs[codec].encoder) {
+		/* codec that is not encoded for buffers */
+		send_process_audio(process, buffer->spl + pos, len);
+		return;
+	}
+
+	/* encode for this codec on first use */
+	if (!buffer->payload[codec]) {
+		int payload_len = 0;
+
+		buffer_codecs[codec].encoder((uint8_t *)buffer->spl, buffer->len * 2, &buffer->payload[codec], &payload_len, NULL);
+		if (!buffer->payload[codec]) {
+			LOGP(DCALL, LOGL_ERROR, "No memory!\n");
+			return;
+		}
+		buffer->bytes_per_sample[codec] = payload_len / buffer->len;
+	}
+	osmo_cc_rtp_send(process->codec, buffer->payload[codec] + pos * buffer->bytes_per_sample[codec], len * buffer->bytes_per_sample[codec], 0, 1, len);
+}
+
 /* clock that is used to transmit patterns */
 void call_clock(void)
 {
@@ -649,10 +954,15 @@ void call_clock(void)
 	call_down_clock();
 
 	while(process) {
-		if (process->pattern != PATTERN_NONE) {
+		if (process->pattern != PATTERN_NONE && process->codec) {
 			int16_t spl[160];
-			uint8_t *payload;
-			int payload_len;
+#ifndef DEBUG_LEVEL
+			/* send cached frame */
+			if (send_pattern_frame(process)) {
+				process = process->next;
+				continue;
+			}
+#endif
 			/* try to get patterns, else copy the samples we got */
 			get_process_patterns(process, spl, 160);
 #ifdef DEBUG_LEVEL
@@ -663,9 +973,7 @@ void call_clock(void)
 			samples_to_int16(spl, samples, 160);
 #endif
 			/* encode and send via RTP */
-			process->codec->encoder((uint8_t *)spl, 160 * 2, &payload, &payload_len, process);
-			osmo_cc_rtp_send(process->codec, payload, payload_len, 0, 1, 160);
-			free(payload);
+			send_process_audio(process, spl, 160);
 			/* don't destroy process here in case of an error */
 		}
 		process = process->next;
@@ -684,6 +992,10 @@ static void ll_msg_cb(osmo_cc_endpoint_t __attribute__((unused)) *ep, uint32_t c
 	const char *suffix, *invalid;
 	int rc;
 
+	/* messages of the built-in console are caused by key strokes, which are recorded instead */
+	if (use_socket)
+		session_record_msg(callref, msg->type, msg->data, ntohs(msg->length_networkorder));
+
 	process = get_process(callref);
 	if (!process) {
 		if (msg->type == OSMO_CC_MSG_SETUP_REQ)
@@ -731,7 +1043,7 @@ static void ll_msg_cb(osmo_cc_endpoint_t __attribute__((unused)) *ep, uint32_t c
 		const char *sdp;
 
 		/* sdp accept */
-		sdp = osmo_cc_helper_audio_accept(&ep->session_config, process, codecs + no_l16, down_audio, msg, &process->session, &process->codec, 0);
+		sdp = osmo_cc_helper_audio_accept(&ep->session_config, process, (no_l16) ? codecs_no_l16 : codecs, down_audio, msg, &process->session, &process->codec, 0);
 		if (!sdp) {
 			disconnect_process(callref, 47);
 			indicate_disconnect_release(callref, 47, OSMO_CC_MSG_REJ_IND);
@@ -821,8 +1133,12 @@ static void ll_msg_cb(osmo_cc_endpoint_t __attribute__((unused)) *ep, uint32_t c
 			}
 		}
 
-		/* setup call */
-		rc = call_down_setup(callref, caller_id, caller_type, suffix);
+		/* setup call, unless the node is saturated */
+		if (overload_level >= OVERLOAD_CALLS) {
+			LOGP(DCALL, LOGL_NOTICE, "Refusing call, because of overload.\n");
+			rc = -CAUSE_RESOURCE_UNAVAIL;
+		} else
+			rc = call_down_setup(callref, caller_id, caller_type, suffix);
 		if (rc < 0) {
 			LOGP(DCALL, LOGL_NOTICE, "Call rejected, cause %d\n", -rc);
 			if (!connect_on_setup) {
@@ -921,15 +1237,41 @@ static void ll_msg_cb(osmo_cc_endpoint_t __attribute__((unused)) *ep, uint32_t c
 	osmo_cc_free_msg(msg);
 }
 
-int call_init(const char *name, int _send_patterns, int _release_on_disconnect, int use_socket, int argc, const char *argv[], int _no_l16)
+/* inject message of a recorded session, as if it was received from fixed network */
+void call_replay_msg(uint32_t callref, uint8_t type, const uint8_t *data, int len)
+{
+	osmo_cc_msg_t *msg;
+
+	msg = osmo_cc_new_msg(type);
+	memcpy(msg->data, data, len);
+	msg->length_networkorder = htons(len);
+	ll_msg_cb(ep, callref, msg);
+}
+
+/* inject RTP frame of a recorded session, the codec was negotiated by replayed messages */
+void call_replay_rtp(uint32_t callref, uint8_t marker, uint16_t sequence_number, uint32_t timestamp, uint32_t ssrc, uint8_t *payload, int payload_len)
+{
+	process_t *process;
+
+	process = get_process(callref);
+	if (!process || !process->codec)
+		return;
+	down_audio(process->codec, marker, sequence_number, timestamp, ssrc, payload, payload_len);
+}
+
+int call_init(const char *name, int _send_patterns, int _release_on_disconnect, int _use_socket, int argc, const char *argv[], int _no_l16)
 {
 	int rc;
 
+	use_socket = _use_socket;
 	connect_on_setup = _send_patterns;
 	release_on_disconnect = _release_on_disconnect;
 
 	g711_init();
 
+	/* patterns are set by the network before */
+	render_pattern_frames();
+
 	no_l16 = !!_no_l16;
 	ep = &endpoint;
 	rc = osmo_cc_new(ep, OSMO_CC_VERSION, name, OSMO_CC_LOCATION_PRIV_SERV_LOC_USER, ll_msg_cb, (use_socket) ? NULL : console_msg, NULL, argc, argv);
@@ -947,6 +1289,7 @@ void call_exit(void)
 		osmo_cc_delete(ep);
 		ep = NULL;
 	}
+	free_pattern_frames();
 }
 
 int call_handle(void)
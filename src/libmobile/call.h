@@ -17,6 +17,13 @@ void call_exit(void);
 int call_handle(void);
 void call_media_handle(void);
 
+/* calls set up by transceivers, for regression tests */
+struct call_stats {
+	int	setup;		/* calls from mobile phones */
+	int	answer;		/* calls answered by mobile phones */
+};
+extern struct call_stats call_stats;
+
 /* function pointer to delive MNCC messages to upper layer */
 extern int (*mncc_up)(uint8_t *buf, int length);
 /* MNCC messages from upper layer */
@@ -41,6 +48,17 @@ void call_down_release(int callref, int cause);
 /* send and receive audio */
 void call_up_audio(int callref, sample_t *samples, int count);
 void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t sequence, uint8_t marker, uint32_t timestamp, uint32_t ssrc, uint8_t *payload, int payload_len);
+void call_down_audio_direct(int callref, int16_t *spl, int len);
+
+/* events of a recorded session, see session.c */
+void call_replay_msg(uint32_t callref, uint8_t type, const uint8_t *data, int len);
+void call_replay_rtp(uint32_t callref, uint8_t marker, uint16_t sequence_number, uint32_t timestamp, uint32_t ssrc, uint8_t *payload, int payload_len);
+
+/* audio that many calls stream from, see call_audio_buffer_create() */
+typedef struct call_audio_buffer call_audio_buffer_t;
+call_audio_buffer_t *call_audio_buffer_create(sample_t *samples, int len);
+void call_audio_buffer_destroy(call_audio_buffer_t *buffer);
+void call_up_audio_buffer(int callref, call_audio_buffer_t *buffer, int pos, int count);
 
 /* clock to transmit to */
 void call_clock(void); /* from main loop */
@@ -22,7 +22,7 @@
 
 const char *cause_name(int cause)
 {
-	static char cause_str[16];
+	static __thread char cause_str[16];
 
 	switch (cause) {
 	case CAUSE_NORMAL:
@@ -0,0 +1,184 @@
+/* Allocation of traffic channels
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each network puts its traffic channels into lists, one list for each type
+ * of channel. When the state of a channel changes between idle and busy, the
+ * bit of the channel is set or cleared. So the first idle channel is found by
+ * scanning one word for up to 64 channels, instead of walking the list of all
+ * transceivers and checking their states.
+ *
+ * The number of busy channels is counted for each audio device. An audio
+ * device (sound card or SDR) is processed by its own thread, so the count is
+ * the load of that thread also. If there are idle channels on different audio
+ * devices, the policy selects between them:
+ *
+ *  first:    first idle channel, in order of creation (default)
+ *  balance:  audio device with the fewest busy channels, to spread the load
+ *  pack:     audio device with the most busy channels, so that the other
+ *            devices stay idle and their receivers are gated
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "sender.h"
+
+enum chan_alloc_policy chan_alloc_policy = CHAN_ALLOC_FIRST;
+
+static const char *policy_names[] = {
+	"first",
+	"balance",
+	"pack",
+};
+
+int chan_alloc_set_policy(const char *name)
+{
+	int i;
+
+	for (i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); i++) {
+		if (!strcmp(name, policy_names[i])) {
+			chan_alloc_policy = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+const char *chan_alloc_policy_name(enum chan_alloc_policy policy)
+{
+	return policy_names[policy];
+}
+
+/* the audio device that processes the channel */
+static sender_t *device_of(sender_t *sender)
+{
+	return (sender->master) ? sender->master : sender;
+}
+
+/* add channel to list of its type, it must be removed before it is destroyed */
+int chan_list_add(chan_list_t *list, sender_t *sender, int idle)
+{
+	sender_t **senders;
+	uint64_t *bits;
+	int words = (list->num + 64) / 64;
+
+	senders = realloc(list->sender, (list->num + 1) * sizeof(*senders));
+	if (!senders)
+		goto nomem;
+	list->sender = senders;
+	bits = realloc(list->idle, words * sizeof(*bits));
+	if (!bits)
+		goto nomem;
+	if ((list->num & 63) == 0)
+		bits[words - 1] = 0;
+	list->idle = bits;
+
+	sender->alloc_list = list;
+	sender->alloc_index = list->num;
+	list->sender[list->num++] = sender;
+	/* channel starts as busy, then it is set to its state */
+	device_of(sender)->alloc_busy++;
+	chan_alloc_set_idle(sender, idle);
+
+	return 0;
+
+nomem:
+	LOGP(DSENDER, LOGL_ERROR, "No memory!\n");
+	return -ENOMEM;
+}
+
+/* remove channel from its list, the list is freed with its last channel
+ *
+ * the count of the audio device is not touched, because the master may have
+ * been destroyed already */
+void chan_list_remove(sender_t *sender)
+{
+	chan_list_t *list = sender->alloc_list;
+	int i;
+
+	if (!list)
+		return;
+
+	list->idle[sender->alloc_index / 64] &= ~((uint64_t)1 << (sender->alloc_index % 64));
+	list->sender[sender->alloc_index] = NULL;
+	sender->alloc_list = NULL;
+
+	for (i = 0; i < list->num; i++) {
+		if (list->sender[i])
+			return;
+	}
+	free(list->sender);
+	free(list->idle);
+	memset(list, 0, sizeof(*list));
+}
+
+/* must be called whenever the channel changes between idle and busy state */
+void chan_alloc_set_idle(sender_t *sender, int idle)
+{
+	chan_list_t *list = sender->alloc_list;
+	uint64_t bit;
+	int word;
+
+	if (!list)
+		return;
+
+	word = sender->alloc_index / 64;
+	bit = (uint64_t)1 << (sender->alloc_index % 64);
+	if (!!(list->idle[word] & bit) == !!idle)
+		return;
+	if (idle) {
+		list->idle[word] |= bit;
+		device_of(sender)->alloc_busy--;
+	} else {
+		list->idle[word] &= ~bit;
+		device_of(sender)->alloc_busy++;
+	}
+}
+
+/* return an idle channel of the list or NULL, the channel stays idle until its state changes */
+sender_t *chan_alloc(chan_list_t *list)
+{
+	int words = (list->num + 63) / 64;
+	sender_t *sender, *best = NULL;
+	int busy, best_busy = 0;
+	uint64_t bits;
+	int w;
+
+	for (w = 0; w < words; w++) {
+		for (bits = list->idle[w]; bits; bits &= bits - 1) {
+			sender = list->sender[w * 64 + __builtin_ctzll(bits)];
+			if (chan_alloc_policy == CHAN_ALLOC_FIRST)
+				return sender;
+			busy = device_of(sender)->alloc_busy;
+			if (!best
+			 || (chan_alloc_policy == CHAN_ALLOC_BALANCE && busy < best_busy)
+			 || (chan_alloc_policy == CHAN_ALLOC_PACK && busy > best_busy)) {
+				best = sender;
+				best_busy = busy;
+			}
+		}
+	}
+
+	return best;
+}
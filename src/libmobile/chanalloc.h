@@ -0,0 +1,26 @@
+
+struct sender;
+
+/* policy to select between idle traffic channels of different audio devices */
+enum chan_alloc_policy {
+	CHAN_ALLOC_FIRST = 0,	/* first channel, in order of creation */
+	CHAN_ALLOC_BALANCE,	/* channel of the device with the fewest busy channels */
+	CHAN_ALLOC_PACK,	/* channel of the device with the most busy channels */
+};
+
+/* traffic channels of one type, one bit is set for each idle channel */
+typedef struct chan_list {
+	struct sender	**sender;	/* channels in order of creation */
+	uint64_t	*idle;		/* one bit for each channel */
+	int		num;		/* number of channels */
+} chan_list_t;
+
+extern enum chan_alloc_policy chan_alloc_policy;
+
+int chan_alloc_set_policy(const char *name);
+const char *chan_alloc_policy_name(enum chan_alloc_policy policy);
+int chan_list_add(chan_list_t *list, struct sender *sender, int idle);
+void chan_list_remove(struct sender *sender);
+void chan_alloc_set_idle(struct sender *sender, int idle);
+struct sender *chan_alloc(chan_list_t *list);
+
@@ -0,0 +1,387 @@
+/* Checkpoint and restore of subscriber state
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Networks add a section with a save and a restore function. At each
+ * interval, the save functions serialize the state into a buffer. This is
+ * done by a timer of the main loop, so the state is consistent and no lock
+ * is needed by the network. The buffer is a snapshot that is handed to a
+ * background thread, which writes it to a temporary file and renames it, so
+ * the main loop never waits for the disk and the file is always complete.
+ * If a snapshot is not yet written when the next one is taken, the older one
+ * is dropped.
+ *
+ * File format (all values little endian):
+ *
+ *   "ACKP" <u32 version> { <4 character tag> <u32 length> <data> } ...
+ *
+ * Sections of unknown tags are skipped, so a file remains usable when a
+ * network is changed.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../liblogging/logging.h"
+#include <osmocom/core/timer.h>
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC	"ACKP"
+#define CHECKPOINT_VERSION	1
+#define CHECKPOINT_SECTIONS	8
+
+static struct checkpoint_section {
+	char		tag[5];
+	void		(*save)(checkpoint_buf_t *buf);
+	void		(*restore)(checkpoint_buf_t *buf);
+} sections[CHECKPOINT_SECTIONS];
+static int num_sections = 0;
+
+static char *checkpoint_path = NULL;
+static double checkpoint_interval;
+static struct osmo_timer_list checkpoint_timer;
+
+/* writer thread */
+static pthread_t writer_tid;
+static int writer_running = 0;
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cond = PTHREAD_COND_INITIALIZER;
+static checkpoint_buf_t *writer_pending = NULL;
+static int writer_quit = 0;
+
+static void put(checkpoint_buf_t *buf, const void *data, size_t len)
+{
+	uint8_t *p;
+	size_t size;
+
+	if (buf->error)
+		return;
+	if (buf->len + len > buf->size) {
+		size = (buf->size) ? buf->size * 2 : 4096;
+		while (size < buf->len + len)
+			size *= 2;
+		p = realloc(buf->data, size);
+		if (!p) {
+			buf->error = 1;
+			return;
+		}
+		buf->data = p;
+		buf->size = size;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+}
+
+static void put_le(checkpoint_buf_t *buf, uint64_t value, int bytes)
+{
+	uint8_t data[8];
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		data[i] = value >> (i * 8);
+	put(buf, data, bytes);
+}
+
+void checkpoint_put_u8(checkpoint_buf_t *buf, uint8_t value)
+{
+	put_le(buf, value, 1);
+}
+
+void checkpoint_put_u16(checkpoint_buf_t *buf, uint16_t value)
+{
+	put_le(buf, value, 2);
+}
+
+void checkpoint_put_u32(checkpoint_buf_t *buf, uint32_t value)
+{
+	put_le(buf, value, 4);
+}
+
+void checkpoint_put_u64(checkpoint_buf_t *buf, uint64_t value)
+{
+	put_le(buf, value, 8);
+}
+
+static uint64_t get_le(checkpoint_buf_t *buf, int bytes)
+{
+	uint64_t value = 0;
+	int i;
+
+	if (buf->error || buf->pos + bytes > buf->len) {
+		buf->error = 1;
+		return 0;
+	}
+	for (i = 0; i < bytes; i++)
+		value |= (uint64_t)buf->data[buf->pos + i] << (i * 8);
+	buf->pos += bytes;
+	return value;
+}
+
+uint8_t checkpoint_get_u8(checkpoint_buf_t *buf)
+{
+	return get_le(buf, 1);
+}
+
+uint16_t checkpoint_get_u16(checkpoint_buf_t *buf)
+{
+	return get_le(buf, 2);
+}
+
+uint32_t checkpoint_get_u32(checkpoint_buf_t *buf)
+{
+	return get_le(buf, 4);
+}
+
+uint64_t checkpoint_get_u64(checkpoint_buf_t *buf)
+{
+	return get_le(buf, 8);
+}
+
+/* tag is a string of 4 characters */
+void checkpoint_add(const char *tag, void (*save)(checkpoint_buf_t *buf), void (*restore)(checkpoint_buf_t *buf))
+{
+	if (num_sections == CHECKPOINT_SECTIONS) {
+		LOGP(DSENDER, LOGL_ERROR, "Too many checkpoint sections, please fix!\n");
+		return;
+	}
+	strncpy(sections[num_sections].tag, tag, 4);
+	sections[num_sections].save = save;
+	sections[num_sections].restore = restore;
+	num_sections++;
+}
+
+static void buf_free(checkpoint_buf_t *buf)
+{
+	if (!buf)
+		return;
+	free(buf->data);
+	free(buf);
+}
+
+static checkpoint_buf_t *snapshot(void)
+{
+	checkpoint_buf_t *buf;
+	size_t len_pos, len;
+	int i, j;
+
+	buf = calloc(1, sizeof(*buf));
+	if (!buf)
+		return NULL;
+	put(buf, CHECKPOINT_MAGIC, 4);
+	checkpoint_put_u32(buf, CHECKPOINT_VERSION);
+	for (i = 0; i < num_sections; i++) {
+		put(buf, sections[i].tag, 4);
+		len_pos = buf->len;
+		checkpoint_put_u32(buf, 0);
+		sections[i].save(buf);
+		if (buf->error)
+			break;
+		len = buf->len - len_pos - 4;
+		for (j = 0; j < 4; j++)
+			buf->data[len_pos + j] = len >> (j * 8);
+	}
+	if (buf->error) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem for checkpoint!\n");
+		buf_free(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static void write_file(checkpoint_buf_t *buf)
+{
+	char tmp[strlen(checkpoint_path) + 5];
+	FILE *fp;
+	int rc;
+
+	sprintf(tmp, "%s.tmp", checkpoint_path);
+	fp = fopen(tmp, "w");
+	if (!fp) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create checkpoint file '%s' (errno %d)!\n", tmp, errno);
+		return;
+	}
+	rc = (fwrite(buf->data, buf->len, 1, fp) == 1) ? 0 : -EIO;
+	if (!rc && fflush(fp))
+		rc = -errno;
+	if (!rc && fsync(fileno(fp)))
+		rc = -errno;
+	fclose(fp);
+	if (!rc && rename(tmp, checkpoint_path))
+		rc = -errno;
+	if (rc < 0) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to write checkpoint file '%s' (rc %d)!\n", checkpoint_path, rc);
+		unlink(tmp);
+	}
+}
+
+static void *writer_thread(void __attribute__((unused)) *arg)
+{
+	checkpoint_buf_t *buf;
+
+	pthread_mutex_lock(&writer_mutex);
+	while (1) {
+		while (!writer_pending && !writer_quit)
+			pthread_cond_wait(&writer_cond, &writer_mutex);
+		buf = writer_pending;
+		writer_pending = NULL;
+		if (!buf)
+			break;
+		pthread_mutex_unlock(&writer_mutex);
+		write_file(buf);
+		buf_free(buf);
+		pthread_mutex_lock(&writer_mutex);
+	}
+	pthread_mutex_unlock(&writer_mutex);
+
+	return NULL;
+}
+
+static void hand_to_writer(checkpoint_buf_t *buf)
+{
+	pthread_mutex_lock(&writer_mutex);
+	/* older snapshot that is not yet written is replaced */
+	buf_free(writer_pending);
+	writer_pending = buf;
+	pthread_cond_signal(&writer_cond);
+	pthread_mutex_unlock(&writer_mutex);
+}
+
+static void checkpoint_timeout(void __attribute__((unused)) *data)
+{
+	checkpoint_buf_t *buf;
+
+	buf = snapshot();
+	if (buf)
+		hand_to_writer(buf);
+	osmo_timer_schedule(&checkpoint_timer, (int)checkpoint_interval, (int)((checkpoint_interval - (int)checkpoint_interval) * 1000000.0));
+}
+
+/* interval in seconds */
+int checkpoint_open(const char *path, double interval)
+{
+	int rc;
+
+	checkpoint_path = strdup(path);
+	checkpoint_interval = interval;
+	writer_quit = 0;
+	rc = pthread_create(&writer_tid, NULL, writer_thread, NULL);
+	if (rc) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create checkpoint thread (rc %d)!\n", rc);
+		free(checkpoint_path);
+		checkpoint_path = NULL;
+		return -rc;
+	}
+	writer_running = 1;
+	osmo_timer_setup(&checkpoint_timer, checkpoint_timeout, NULL);
+	osmo_timer_schedule(&checkpoint_timer, (int)checkpoint_interval, (int)((checkpoint_interval - (int)checkpoint_interval) * 1000000.0));
+	LOGP(DSENDER, LOGL_INFO, "Checkpoint of subscriber state is written to '%s' every %.0f seconds.\n", checkpoint_path, checkpoint_interval);
+
+	return 0;
+}
+
+/* read state of previous run, if any, before going on air */
+void checkpoint_restore(const char *path)
+{
+	checkpoint_buf_t file, section;
+	FILE *fp;
+	long size;
+	char tag[4];
+	uint32_t len;
+	int i, restored = 0;
+
+	fp = fopen(path, "r");
+	if (!fp) {
+		LOGP(DSENDER, LOGL_INFO, "No checkpoint file '%s' to restore state from.\n", path);
+		return;
+	}
+	memset(&file, 0, sizeof(file));
+	if (fseek(fp, 0, SEEK_END) || (size = ftell(fp)) < 8 || fseek(fp, 0, SEEK_SET))
+		goto invalid;
+	file.data = malloc(size);
+	if (!file.data)
+		goto invalid;
+	if (fread(file.data, size, 1, fp) != 1)
+		goto invalid;
+	file.len = size;
+	if (memcmp(file.data, CHECKPOINT_MAGIC, 4))
+		goto invalid;
+	file.pos = 4;
+	if (checkpoint_get_u32(&file) != CHECKPOINT_VERSION)
+		goto invalid;
+
+	while (file.pos + 8 <= file.len) {
+		memcpy(tag, file.data + file.pos, 4);
+		file.pos += 4;
+		len = checkpoint_get_u32(&file);
+		if (file.pos + len > file.len)
+			goto invalid;
+		for (i = 0; i < num_sections; i++) {
+			if (!memcmp(sections[i].tag, tag, 4))
+				break;
+		}
+		if (i < num_sections) {
+			memset(&section, 0, sizeof(section));
+			section.data = file.data + file.pos;
+			section.len = len;
+			sections[i].restore(&section);
+			if (section.error)
+				LOGP(DSENDER, LOGL_ERROR, "Checkpoint section '%.4s' of file '%s' is truncated!\n", tag, path);
+			restored++;
+		}
+		file.pos += len;
+	}
+
+	LOGP(DSENDER, LOGL_NOTICE, "Restored %d section(s) of state from checkpoint file '%s'.\n", restored, path);
+	free(file.data);
+	fclose(fp);
+	return;
+
+invalid:
+	LOGP(DSENDER, LOGL_ERROR, "Checkpoint file '%s' is invalid, state is not restored!\n", path);
+	free(file.data);
+	fclose(fp);
+}
+
+/* write final state and stop thread */
+void checkpoint_close(void)
+{
+	checkpoint_buf_t *buf;
+
+	if (!writer_running)
+		return;
+
+	osmo_timer_del(&checkpoint_timer);
+	buf = snapshot();
+	if (buf)
+		hand_to_writer(buf);
+	pthread_mutex_lock(&writer_mutex);
+	writer_quit = 1;
+	pthread_cond_signal(&writer_cond);
+	pthread_mutex_unlock(&writer_mutex);
+	pthread_join(writer_tid, NULL);
+	writer_running = 0;
+
+	free(checkpoint_path);
+	checkpoint_path = NULL;
+}
+
@@ -0,0 +1,24 @@
+
+/* serialized state of a network */
+typedef struct checkpoint_buf {
+	uint8_t		*data;
+	size_t		len;
+	size_t		size;
+	size_t		pos;		/* read position */
+	int		error;		/* out of memory or read beyond end */
+} checkpoint_buf_t;
+
+void checkpoint_put_u8(checkpoint_buf_t *buf, uint8_t value);
+void checkpoint_put_u16(checkpoint_buf_t *buf, uint16_t value);
+void checkpoint_put_u32(checkpoint_buf_t *buf, uint32_t value);
+void checkpoint_put_u64(checkpoint_buf_t *buf, uint64_t value);
+uint8_t checkpoint_get_u8(checkpoint_buf_t *buf);
+uint16_t checkpoint_get_u16(checkpoint_buf_t *buf);
+uint32_t checkpoint_get_u32(checkpoint_buf_t *buf);
+uint64_t checkpoint_get_u64(checkpoint_buf_t *buf);
+
+void checkpoint_add(const char *tag, void (*save)(checkpoint_buf_t *buf), void (*restore)(checkpoint_buf_t *buf));
+int checkpoint_open(const char *path, double interval);
+void checkpoint_restore(const char *path);
+void checkpoint_close(void);
+
@@ -0,0 +1,205 @@
+/* Sample clock drift estimation and compensation
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The clock of a sound card (or SDR) is never exactly at its nominal rate.
+ * The protocol and the fixed network run on the system clock, so a jitter
+ * buffer between them slowly drifts until it underruns or overflows.
+ *
+ * The total number of samples that the device has consumed or produced is
+ * taken once per second, together with the system time. A linear regression
+ * over the last points gives the speed of the device clock. Because the
+ * number of samples includes the fill of the device buffer, the trend of
+ * the buffer is part of the estimation.
+ *
+ * The fine resampler converts between the device rate and the nominal rate.
+ * In addition to the estimated speed, the number of nominal samples that
+ * were exchanged with the protocol is compared with the elapsed system time.
+ * The remaining error is pulled in slowly, so the nominal stream follows
+ * the system clock over weeks, even if the estimation is slightly off.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "get_time.h"
+#include "clockdrift.h"
+
+#define CLOCKDRIFT_SETTLE	2.0	/* skip filling of buffers */
+#define CLOCKDRIFT_INTERVAL	1.0	/* take a point every second */
+#define CLOCKDRIFT_MIN_POINTS	30	/* compensation starts with this number of points */
+#define CLOCKDRIFT_MAX_PPM	1000.0	/* devices beyond that are broken */
+#define CLOCKDRIFT_PULL		60.0	/* time to pull in the remaining error */
+#define CLOCKDRIFT_MAX_PULL	0.0001	/* limit of speed change by pulling */
+
+int clock_drift = 0;
+
+void clockdrift_init(clockdrift_t *cd, const char *name, double samplerate)
+{
+	memset(cd, 0, sizeof(*cd));
+	strncpy(cd->name, name, sizeof(cd->name) - 1);
+	cd->samplerate = samplerate;
+	cd->factor = 1.0;
+}
+
+static void estimate(clockdrift_t *cd, double now)
+{
+	double mean_t = 0.0, mean_s = 0.0, var = 0.0, cov = 0.0;
+	double ppm, error, pull;
+	int i;
+
+	for (i = 0; i < cd->point_num; i++) {
+		mean_t += cd->point_time[i];
+		mean_s += cd->point_samples[i];
+	}
+	mean_t /= (double)cd->point_num;
+	mean_s /= (double)cd->point_num;
+	for (i = 0; i < cd->point_num; i++) {
+		var += (cd->point_time[i] - mean_t) * (cd->point_time[i] - mean_t);
+		cov += (cd->point_time[i] - mean_t) * (cd->point_samples[i] - mean_s);
+	}
+	if (var <= 0.0)
+		return;
+	ppm = (cov / var / cd->samplerate - 1.0) * 1000000.0;
+	if (fabs(ppm) > CLOCKDRIFT_MAX_PPM) {
+		if (cd->valid || cd->point_num == CLOCKDRIFT_MIN_POINTS)
+			LOGP(DSENDER, LOGL_ERROR, "Clock of %s is off by %.1f ppm, not compensating!\n", cd->name, ppm);
+		cd->valid = 0;
+		cd->factor = 1.0;
+		return;
+	}
+	cd->ppm = ppm;
+
+	if (!cd->valid) {
+		LOGP(DSENDER, LOGL_INFO, "Clock of %s is off by %.1f ppm, compensating.\n", cd->name, ppm);
+		cd->valid = 1;
+		cd->ref_time = now;
+		cd->nominal_ref = cd->nominal;
+	}
+
+	/* nominal samples missing (positive) or in excess (negative) against system time */
+	error = cd->samplerate * (now - cd->ref_time) - (cd->nominal - cd->nominal_ref);
+	pull = error / (cd->samplerate * CLOCKDRIFT_PULL);
+	if (pull > CLOCKDRIFT_MAX_PULL)
+		pull = CLOCKDRIFT_MAX_PULL;
+	if (pull < -CLOCKDRIFT_MAX_PULL)
+		pull = -CLOCKDRIFT_MAX_PULL;
+	cd->factor = (1.0 + pull) / (1.0 + ppm / 1000000.0);
+}
+
+/* total samples consumed or produced by device so far, including its buffer */
+void clockdrift_update(clockdrift_t *cd, double samples)
+{
+	double now;
+
+	if (!clock_drift)
+		return;
+
+	now = get_time();
+	if (!cd->settle_until) {
+		cd->settle_until = now + CLOCKDRIFT_SETTLE;
+		return;
+	}
+	if (now < cd->settle_until || now < cd->next_point)
+		return;
+	if (!cd->base_time) {
+		cd->base_time = now;
+		cd->base_samples = samples;
+	}
+	cd->next_point += CLOCKDRIFT_INTERVAL;
+	if (cd->next_point < now)
+		cd->next_point = now + CLOCKDRIFT_INTERVAL;
+
+	cd->point_time[cd->point_idx] = now - cd->base_time;
+	cd->point_samples[cd->point_idx] = samples - cd->base_samples;
+	cd->point_idx = (cd->point_idx + 1) % CLOCKDRIFT_POINTS;
+	if (cd->point_num < CLOCKDRIFT_POINTS)
+		cd->point_num++;
+	if (cd->point_num >= CLOCKDRIFT_MIN_POINTS)
+		estimate(cd, now);
+}
+
+/* samples at nominal rate that were exchanged with the protocol */
+void clockdrift_nominal(clockdrift_t *cd, int count)
+{
+	cd->nominal += (double)count;
+}
+
+void clockdrift_report(clockdrift_t *cd)
+{
+	if (!clock_drift || !cd->point_num)
+		return;
+
+	LOGP(DSENDER, LOGL_NOTICE, "Clock of %s: %+.2f ppm against system clock (%s).\n", cd->name, cd->ppm, (cd->valid) ? "compensated" : "not compensated");
+}
+
+void clockdrift_rs_init(clockdrift_rs_t *rs)
+{
+	memset(rs, 0, sizeof(*rs));
+}
+
+/* input samples required to get exactly output_num samples */
+int clockdrift_input_num(clockdrift_rs_t *rs, double step, int output_num)
+{
+	int input_num;
+
+	if (output_num <= 0)
+		return 0;
+	input_num = (int)floor(rs->pos + (double)(output_num - 1) * step) + 2;
+	if (input_num < 0)
+		input_num = 0;
+	return input_num;
+}
+
+/* linear interpolation, step is the input distance of output samples
+ * the power state follows the input sample that is at or after the output */
+int clockdrift_resample(clockdrift_rs_t *rs, double step, sample_t *input, uint8_t *power_in, int input_num, sample_t *output, uint8_t *power_out, int output_max)
+{
+	double pos = rs->pos, frac;
+	sample_t a, b;
+	int i, count = 0;
+
+	while (count < output_max && pos < (double)(input_num - 1)) {
+		i = (int)floor(pos);
+		frac = pos - (double)i;
+		a = (i >= 0) ? input[i] : rs->hist[i + 2];
+		b = (i + 1 >= 0) ? input[i + 1] : rs->hist[i + 3];
+		output[count] = a + (b - a) * frac;
+		if (power_in && power_out)
+			power_out[count] = (i + 1 >= 0) ? power_in[i + 1] : rs->power;
+		pos += step;
+		count++;
+	}
+
+	if (input_num >= 2) {
+		rs->hist[0] = input[input_num - 2];
+		rs->hist[1] = input[input_num - 1];
+	} else if (input_num == 1) {
+		rs->hist[0] = rs->hist[1];
+		rs->hist[1] = input[0];
+	}
+	if (power_in && input_num)
+		rs->power = power_in[input_num - 1];
+	rs->pos = pos - (double)input_num;
+
+	return count;
+}
+
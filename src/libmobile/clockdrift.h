@@ -0,0 +1,40 @@
+
+#define CLOCKDRIFT_POINTS	128	/* points of regression window */
+
+/* estimation of a device's sample clock against the system clock */
+typedef struct clockdrift {
+	char		name[64];
+	double		samplerate;	/* nominal sample rate of device */
+	double		settle_until;	/* no points are taken before buffers are filled */
+	double		next_point;	/* time of next point */
+	double		base_time;	/* origin of points, keeps precision over weeks */
+	double		base_samples;
+	double		point_time[CLOCKDRIFT_POINTS];
+	double		point_samples[CLOCKDRIFT_POINTS];
+	int		point_num;
+	int		point_idx;
+	double		ppm;		/* estimated speed of device clock */
+	int		valid;		/* estimation is used */
+	double		ref_time;	/* when compensation started */
+	double		nominal;	/* samples at nominal rate exchanged with protocol since start */
+	double		nominal_ref;
+	double		factor;		/* nominal samples per device sample */
+} clockdrift_t;
+
+/* fine resampler, one per channel, step is close to 1 */
+typedef struct clockdrift_rs {
+	double		pos;		/* position of next output, relative to first input sample */
+	sample_t	hist[2];	/* last two input samples (index -2 and -1) */
+	uint8_t		power;		/* last power state */
+} clockdrift_rs_t;
+
+extern int clock_drift;
+
+void clockdrift_init(clockdrift_t *cd, const char *name, double samplerate);
+void clockdrift_update(clockdrift_t *cd, double samples);
+void clockdrift_nominal(clockdrift_t *cd, int count);
+void clockdrift_report(clockdrift_t *cd);
+void clockdrift_rs_init(clockdrift_rs_t *rs);
+int clockdrift_input_num(clockdrift_rs_t *rs, double step, int output_num);
+int clockdrift_resample(clockdrift_rs_t *rs, double step, sample_t *input, uint8_t *power_in, int input_num, sample_t *output, uint8_t *power_out, int output_max);
+
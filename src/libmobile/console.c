@@ -27,8 +27,6 @@
 #include <sys/time.h>
 #include <sys/param.h>
 #include "../libsample/sample.h"
-#include "../libsamplerate/samplerate.h"
-#include "../libjitter/jitter.h"
 #include "../liblogging/logging.h"
 #include <osmocom/core/timer.h>
 #include <osmocom/core/select.h>
@@ -38,10 +36,8 @@
 #include "testton.h"
 #include "console.h"
 #include "cause.h"
-#include "../libmobile/call.h"
-#ifdef HAVE_ALSA
-#include "../libsound/sound.h"
-#endif
+#include "sender.h"
+#include "call.h"
 
 enum console_state {
 	CONSOLE_IDLE = 0,	/* IDLE */
@@ -63,6 +59,11 @@ static const char *console_state_name[] = {
 	"DISCONNECT_RO",
 };
 
+/* Size of fifo towards headset in direct mode. The call delivers frames of 160
+ * samples, so one frame is kept in the fifo after an underrun. */
+#define DIRECT_FIFO	1024
+#define DIRECT_PRIME	160
+
 /* console call instance */
 typedef struct console {
 	osmo_cc_session_t *session;
@@ -78,6 +79,17 @@ typedef struct console {
 	int buffer_size;	/* sample buffer size at headphone interface */
 	samplerate_t srstate;	/* patterns/announcement upsampling */
 	jitter_t dejitter;	/* headphone audio dejittering */
+	int direct;		/* audio of local call is exchanged without RTP and jitter buffer */
+	sample_t direct_fifo[DIRECT_FIFO]; /* audio from call at 8000 Hz */
+	int direct_out;		/* position to read from fifo */
+	int direct_fill;	/* samples in fifo */
+	int direct_primed;	/* fifo has been filled after underrun */
+	uint64_t rx_samples;	/* samples read from headphone interface */
+	uint64_t tx_samples;	/* samples written to headphone interface */
+	clockdrift_t drift_rx;	/* clock of headphone interface */
+	clockdrift_t drift_tx;
+	clockdrift_rs_t drift_rs_rx;
+	clockdrift_rs_t drift_rs_tx;
 	int test_audio_pos;	/* position for test tone toward mobile */
 	sample_t tx_buffer[160];/* transmit audio buffer */
 	int tx_buffer_pos;	/* current position in transmit audio buffer */
@@ -98,7 +110,7 @@ static struct osmo_cc_helper_audio_codecs codecs[] = {
 };
 
 /* stream test music */
-int16_t *test_spl = NULL;
+const int16_t *test_spl = NULL;
 int test_size = 0;
 int test_max = 0;
 
@@ -139,14 +151,85 @@ static void free_console(void)
 	}
 	console.codec = NULL;
 	console.callref = 0;
+	console.direct_fill = 0;
+	console.direct_primed = 0;
+}
+
+static void direct_write(sample_t *samples, int len)
+{
+	int in, i;
+
+	/* drop oldest samples, if fifo overflows */
+	if (console.direct_fill + len > DIRECT_FIFO) {
+		i = console.direct_fill + len - DIRECT_FIFO;
+		console.direct_out = (console.direct_out + i) % DIRECT_FIFO;
+		console.direct_fill -= i;
+	}
+	in = (console.direct_out + console.direct_fill) % DIRECT_FIFO;
+	for (i = 0; i < len; i++) {
+		console.direct_fifo[in] = samples[i];
+		if (++in == DIRECT_FIFO)
+			in = 0;
+	}
+	console.direct_fill += len;
+}
+
+#ifdef HAVE_ALSA
+static void direct_read(sample_t *samples, int len)
+{
+	int out, i;
+
+	if (!console.direct_primed) {
+		if (console.direct_fill < DIRECT_PRIME) {
+			memset(samples, 0, len * sizeof(*samples));
+			return;
+		}
+		console.direct_primed = 1;
+	}
+	out = console.direct_out;
+	for (i = 0; i < len && console.direct_fill; i++, console.direct_fill--) {
+		samples[i] = console.direct_fifo[out];
+		if (++out == DIRECT_FIFO)
+			out = 0;
+	}
+	console.direct_out = out;
+	/* underrun */
+	if (i < len) {
+		memset(samples + i, 0, (len - i) * sizeof(*samples));
+		console.direct_primed = 0;
+	}
+}
+#endif
+
+/* take audio of local call from the call process, returns 1 if taken */
+int console_up_audio_direct(int callref, sample_t *samples, int len)
+{
+	if (!console.direct || !console.sound || !callref || (uint32_t)callref != console.callref)
+		return 0;
+
+	direct_write(samples, len);
+	return 1;
 }
 
 static void up_audio(struct osmo_cc_session_codec *codec, uint8_t marker, uint16_t sequence, uint32_t timestamp, uint32_t ssrc, uint8_t *payload, int payload_len)
 {
+	/* tones and announcements are still received via RTP in direct mode */
+	if (console.sound && console.direct) {
+		uint8_t *data = NULL;
+		int len;
+		codec->decoder(payload, payload_len, &data, &len, &console);
+		if (!data)
+			return;
+		sample_t samples[len / 2];
+		int16_to_samples_speech(samples, (int16_t *)data, len / 2);
+		direct_write(samples, len / 2);
+		free(data);
+		return;
+	}
 	/* save audio from transceiver to jitter buffer */
 	if (console.sound) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(codec->decoder, &console, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&console.dejitter, codec->decoder, &console, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (!jf)
 			return;
 		jitter_save(&console.dejitter, jf);
@@ -344,7 +427,7 @@ void console_msg(osmo_cc_call_t *call, osmo_cc_msg_t *msg)
 static char console_text[256];
 static int console_len = 0;
 
-int console_init(const char *audiodev, int samplerate, int buffer, int loopback, int echo_test, const char *digits, const struct number_lengths *lengths, const char *station_id)
+int console_init(const char *audiodev, int samplerate, int buffer, int direct, int loopback, int echo_test, const char *digits, const struct number_lengths *lengths, const char *station_id)
 {
 	int rc = 0;
 	int i;
@@ -358,6 +441,7 @@ int console_init(const char *audiodev, int samplerate, int buffer, int loopback,
 	strncpy(console.audiodev, audiodev, sizeof(console.audiodev) - 1);
 	console.samplerate = samplerate;
 	console.buffer_size = buffer * samplerate / 1000;
+	console.direct = direct;
 	console.loopback = loopback;
 	console.echo_test = echo_test;
 	console.digits = digits;
@@ -374,7 +458,7 @@ int console_init(const char *audiodev, int samplerate, int buffer, int loopback,
 	if (!audiodev[0])
 		return 0;
 
-	rc = init_samplerate(&console.srstate, 8000.0, (double)samplerate, 3400.0);
+	rc = init_samplerate(&console.srstate, 8000.0, (double)samplerate, 3400.0, SAMPLERATE_POLYPHASE);
 	if (rc < 0) {
 		LOGP(DSENDER, LOGL_ERROR, "Failed to init sample rate conversion!\n");
 		goto error;
@@ -386,6 +470,11 @@ int console_init(const char *audiodev, int samplerate, int buffer, int loopback,
 		goto error;
 	}
 
+	clockdrift_init(&console.drift_rx, "console RX", (double)samplerate);
+	clockdrift_init(&console.drift_tx, "console TX", (double)samplerate);
+	clockdrift_rs_init(&console.drift_rs_rx);
+	clockdrift_rs_init(&console.drift_rs_tx);
+
 	return 0;
 
 error:
@@ -431,6 +520,8 @@ void console_cleanup(void)
 #ifdef HAVE_ALSA
 	/* close sound devoice */
 	if (console.sound) {
+		clockdrift_report(&console.drift_rx);
+		clockdrift_report(&console.drift_tx);
 		sound_close(console.sound);
 		console.sound = NULL;
 	}
@@ -571,9 +662,12 @@ void process_console(int c)
 
 #ifdef HAVE_ALSA
 	/* handle audio, if sound device is used */
-	sample_t samples[console.buffer_size + 10], *samples_list[1];
+	/* clock drift compensation may exchange some more samples at nominal rate */
+	int size = console.buffer_size + console.buffer_size / 500 + 10;
+	sample_t samples[size], resampled[size], *buffer, *samples_list[1];
 	uint8_t *power_list[1];
-	int count, input_num;
+	int count, input_num, nominal;
+	double step = 1.0;
 	int rc;
 
 	count = sound_get_tosend(console.sound, console.buffer_size);
@@ -584,16 +678,30 @@ void process_console(int c)
 		return;
 	}
 	if (count > 0) {
+		nominal = count;
+		buffer = samples;
+		if (clock_drift) {
+			clockdrift_update(&console.drift_tx, (double)console.tx_samples - (double)(console.buffer_size - count));
+			step = console.drift_tx.factor;
+			nominal = clockdrift_input_num(&console.drift_rs_tx, step, count);
+			if (nominal > size)
+				nominal = size;
+		}
 		/* load and upsample */
-		input_num = samplerate_upsample_input_num(&console.srstate, count);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&console.dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
+		if (console.direct) {
+			input_num = samplerate_upsample_input_num(&console.srstate, nominal);
+			direct_read(samples, input_num);
+			samplerate_upsample(&console.srstate, samples, input_num, samples, nominal);
+		} else
+			sender_load_speech(&console.dejitter, &console.srstate, samples, nominal);
+		/* resample to the clock of sound device */
+		if (clock_drift) {
+			clockdrift_resample(&console.drift_rs_tx, step, samples, NULL, nominal, resampled, NULL, count);
+			clockdrift_nominal(&console.drift_tx, nominal);
+			buffer = resampled;
 		}
-		samplerate_upsample(&console.srstate, samples, input_num, samples, count);
 		/* write to sound device */
-		samples_list[0] = samples;
+		samples_list[0] = buffer;
 		power_list[0] = NULL;
 		rc = sound_write(console.sound, samples_list, power_list, count, NULL, NULL, 1);
 		if (rc < 0) {
@@ -602,6 +710,7 @@ void process_console(int c)
 				LOGP(DSENDER, LOGL_ERROR, "Trying to recover.\n");
 			return;
 		}
+		console.tx_samples += count;
 	}
 	samples_list[0] = samples;
 	count = sound_read(console.sound, samples_list, console.buffer_size, 1, NULL);
@@ -614,10 +723,20 @@ void process_console(int c)
 	if (count) {
 		int i;
 
-		count = samplerate_downsample(&console.srstate, samples, count);
+		console.rx_samples += count;
+		buffer = samples;
+		/* resample from the clock of sound device */
+		if (clock_drift) {
+			clockdrift_update(&console.drift_rx, (double)console.rx_samples);
+			step = 1.0 / console.drift_rx.factor;
+			count = clockdrift_resample(&console.drift_rs_rx, step, samples, NULL, count, resampled, NULL, size);
+			clockdrift_nominal(&console.drift_rx, count);
+			buffer = resampled;
+		}
+		count = samplerate_downsample(&console.srstate, buffer, count);
 		/* put samples into ring buffer */
 		for (i = 0; i < count; i++) {
-			console.tx_buffer[console.tx_buffer_pos] = samples[i];
+			console.tx_buffer[console.tx_buffer_pos] = buffer[i];
 			/* if ring buffer wraps, deliver data down to call process */
 			if (++console.tx_buffer_pos == 160) {
 				console.tx_buffer_pos = 0;
@@ -627,6 +746,10 @@ void process_console(int c)
 					uint8_t *payload;
 					int payload_len;
 					samples_to_int16_speech(spl, console.tx_buffer, 160);
+					if (console.direct) {
+						call_down_audio_direct(console.callref, spl, 160);
+						continue;
+					}
 					console.codec->encoder((uint8_t *)spl, 160 * 2, &payload, &payload_len, &console);
 					osmo_cc_rtp_send(console.codec, payload, payload_len, 0, 1, 160);
 				}
@@ -0,0 +1,212 @@
+/* Graph of DSP stages of a transceiver
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The common DSP of each transceiver (gain, emphasis) and the DSP that a
+ * protocol hooks in (e.g. demodulator) are stages of a graph for each
+ * direction. The graph is built when the audio device is opened:
+ *
+ *  - Gain stages are multiplied and folded into the first linear stage of
+ *    a run of gain and linear stages. If there is none, they become one
+ *    gain node that uses the SIMD kernel of libsample. A gain of 1 is
+ *    removed.
+ *  - Adjacent elementwise stages become one node that is processed in
+ *    chunks, so a chunk is still in cache for the next stage.
+ *  - Block stages are nodes of their own, split into their block size.
+ *
+ * The processing time of each node is measured and reported on exit.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../libdisplay/display.h"
+#include "dsp_graph.h"
+
+void dsp_graph_init(dsp_graph_t *graph, const char *name, int rate)
+{
+	memset(graph, 0, sizeof(*graph));
+	graph->name = name;
+	graph->rate = rate;
+}
+
+int dsp_graph_add(dsp_graph_t *graph, const char *name, enum dsp_stage_type type, int rate, int block, int linear, dsp_stage_fn process, void *priv)
+{
+	dsp_stage_t *stage;
+
+	if (graph->num_stages == DSP_GRAPH_MAX_STAGES) {
+		LOGP(DDSP, LOGL_ERROR, "Too many stages in DSP graph '%s', please fix!\n", graph->name);
+		return -ENOMEM;
+	}
+	/* there are no resampling stages, the protocol resamples at the end */
+	if (rate != graph->rate) {
+		LOGP(DDSP, LOGL_ERROR, "Stage '%s' has rate %d, but DSP graph '%s' runs at %d, please fix!\n", name, rate, graph->name, graph->rate);
+		return -EINVAL;
+	}
+
+	stage = &graph->stage[graph->num_stages++];
+	stage->name = name;
+	stage->type = type;
+	stage->rate = rate;
+	stage->block = block;
+	stage->linear = linear;
+	stage->process = process;
+	stage->priv = priv;
+	stage->gain = 1.0;
+
+	return 0;
+}
+
+int dsp_graph_add_gain(dsp_graph_t *graph, const char *name, double gain)
+{
+	int rc;
+
+	rc = dsp_graph_add(graph, name, DSP_STAGE_GAIN, graph->rate, 0, 1, NULL, NULL);
+	if (rc < 0)
+		return rc;
+	graph->stage[graph->num_stages - 1].gain = gain;
+
+	return 0;
+}
+
+static void node_name(dsp_node_t *node, const char *name)
+{
+	size_t len = strlen(node->name);
+
+	snprintf(node->name + len, sizeof(node->name) - len, "%s%s", (len) ? "+" : "", name);
+}
+
+void dsp_graph_build(dsp_graph_t *graph)
+{
+	dsp_stage_t *stage;
+	dsp_node_t *node;
+	double gain;
+	int i, j, first_linear;
+
+	/* fold gain of each run of gain and linear elementwise stages */
+	for (i = 0; i < graph->num_stages; i = j) {
+		gain = 1.0;
+		first_linear = -1;
+		for (j = i; j < graph->num_stages; j++) {
+			stage = &graph->stage[j];
+			if (stage->type == DSP_STAGE_BLOCK || !stage->linear)
+				break;
+			if (stage->type == DSP_STAGE_GAIN)
+				gain *= stage->gain;
+			else if (first_linear < 0)
+				first_linear = j;
+		}
+		if (j == i) {
+			j++;
+			continue;
+		}
+		if (first_linear < 0) {
+			/* gain stages only: keep the first one with total gain */
+			graph->stage[i].gain = gain;
+			for (i++; i < j; i++)
+				graph->stage[i].gain = 1.0;
+			continue;
+		}
+		for (; i < j; i++) {
+			stage = &graph->stage[i];
+			stage->gain = (i == first_linear) ? gain : 1.0;
+		}
+	}
+
+	/* group stages to nodes */
+	graph->num_nodes = 0;
+	node = NULL;
+	for (i = 0; i < graph->num_stages; i++) {
+		stage = &graph->stage[i];
+		/* removed gain */
+		if (stage->type == DSP_STAGE_GAIN && stage->gain == 1.0)
+			continue;
+		/* elementwise stages are combined, a gain node is combined with them */
+		if (node && stage->type != DSP_STAGE_BLOCK && graph->stage[node->last].type != DSP_STAGE_BLOCK) {
+			node->last = i;
+			node->chunk = DSP_GRAPH_CHUNK;
+			if (stage->type == DSP_STAGE_GAIN)
+				node->gain *= stage->gain;
+			node_name(node, stage->name);
+			continue;
+		}
+		node = &graph->node[graph->num_nodes++];
+		memset(node, 0, sizeof(*node));
+		node->first = node->last = i;
+		node->chunk = (stage->type == DSP_STAGE_BLOCK) ? stage->block : DSP_GRAPH_CHUNK;
+		node->gain = (stage->type == DSP_STAGE_GAIN) ? stage->gain : 1.0;
+		node_name(node, stage->name);
+	}
+
+	for (i = 0; i < graph->num_nodes; i++)
+		LOGP(DDSP, LOGL_DEBUG, "DSP graph '%s' node %d: %s\n", graph->name, i + 1, graph->node[i].name);
+}
+
+static void process_node(dsp_graph_t *graph, dsp_node_t *node, sample_t *samples, int count)
+{
+	dsp_stage_t *stage;
+	int i;
+
+	for (i = node->first; i <= node->last; i++) {
+		stage = &graph->stage[i];
+		if (stage->type == DSP_STAGE_GAIN)
+			continue;
+		stage->process(stage->priv, samples, count, (stage->linear) ? stage->gain : 1.0);
+	}
+	/* gain that could not be folded into a linear stage */
+	if (node->gain != 1.0)
+		samples_gain(samples, count, node->gain);
+}
+
+void dsp_graph_process(dsp_graph_t *graph, sample_t *samples, int count)
+{
+	dsp_node_t *node;
+	double t1, t2;
+	int i, pos, n;
+
+	for (i = 0; i < graph->num_nodes; i++) {
+		node = &graph->node[i];
+		t1 = display_profile_time();
+		for (pos = 0; pos < count; pos += n) {
+			n = count - pos;
+			if (node->chunk && n > node->chunk)
+				n = node->chunk;
+			process_node(graph, node, samples + pos, n);
+		}
+		t2 = display_profile_time();
+		node->time += t2 - t1;
+		node->samples += count;
+	}
+}
+
+void dsp_graph_report(dsp_graph_t *graph, const char *kanal)
+{
+	dsp_node_t *node;
+	int i;
+
+	for (i = 0; i < graph->num_nodes; i++) {
+		node = &graph->node[i];
+		if (!node->samples)
+			continue;
+		LOGP(DDSP, LOGL_INFO, "Channel %s %s node '%s': %.1f us per second of signal.\n", kanal, graph->name, node->name, node->time / ((double)node->samples / (double)graph->rate) * 1000000.0);
+	}
+}
+
@@ -0,0 +1,51 @@
+
+#define DSP_GRAPH_MAX_STAGES	8
+#define DSP_GRAPH_CHUNK		256	/* samples of fused elementwise stages processed at once */
+
+/* how a stage processes samples */
+enum dsp_stage_type {
+	DSP_STAGE_GAIN,		/* multiply by factor, folded into other stages if possible */
+	DSP_STAGE_ELEMENTWISE,	/* sample by sample (with filter state), processed in chunks */
+	DSP_STAGE_BLOCK,	/* needs whole blocks, e.g. demodulator of a protocol */
+};
+
+/* process samples in place, 'gain' is only given to linear stages, otherwise it is 1.0 */
+typedef void (*dsp_stage_fn)(void *priv, sample_t *samples, int count, double gain);
+
+typedef struct dsp_stage {
+	const char		*name;
+	enum dsp_stage_type	type;
+	int			rate;		/* sample rate of stage */
+	int			block;		/* largest block processed at once, 0 = any */
+	int			linear;		/* takes gain, so gain can be moved through this stage */
+	dsp_stage_fn		process;
+	void			*priv;
+	double			gain;		/* factor of gain stage, gain folded into linear stage */
+} dsp_stage_t;
+
+/* adjacent stages that are processed together */
+typedef struct dsp_node {
+	char			name[64];
+	int			first, last;	/* range of stages */
+	int			chunk;		/* samples processed at once, 0 = all */
+	double			gain;		/* remaining gain that is not folded */
+	double			time;		/* processing time */
+	uint64_t		samples;	/* samples processed */
+} dsp_node_t;
+
+typedef struct dsp_graph {
+	const char		*name;
+	int			rate;
+	int			num_stages;
+	dsp_stage_t		stage[DSP_GRAPH_MAX_STAGES];
+	int			num_nodes;
+	dsp_node_t		node[DSP_GRAPH_MAX_STAGES];
+} dsp_graph_t;
+
+void dsp_graph_init(dsp_graph_t *graph, const char *name, int rate);
+int dsp_graph_add(dsp_graph_t *graph, const char *name, enum dsp_stage_type type, int rate, int block, int linear, dsp_stage_fn process, void *priv);
+int dsp_graph_add_gain(dsp_graph_t *graph, const char *name, double gain);
+void dsp_graph_build(dsp_graph_t *graph);
+void dsp_graph_process(dsp_graph_t *graph, sample_t *samples, int count);
+void dsp_graph_report(dsp_graph_t *graph, const char *kanal);
+
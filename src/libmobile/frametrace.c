@@ -0,0 +1,356 @@
+/* Binary trace of received and transmitted frames
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Frame decoders and encoders hand each frame to frametrace_frame(). This is
+ * done by the thread that processes the channel, so it only copies a small
+ * record into a ring buffer. A background thread takes the records from the
+ * ring and writes them to a file or sends each record as a UDP datagram.
+ * If the ring is full, records are dropped and counted, so the DSP never
+ * waits for the disk or the network.
+ *
+ * Record format (all values little endian):
+ *
+ *   <u16 record length> <u8 version> <u8 direction: 0 = RX, 1 = TX>
+ *   <u64 time in us since epoch, or since start of recording, see below>
+ *   <char protocol[8]> <char channel[16]>
+ *   <s16 bit errors, -1 if frame is corrupt> <s32 level in 1/1000, or
+ *   0x80000000 if unknown> <u16 number of bits> <bits, packed MSB first>
+ *
+ * A file starts with "AFTR", UDP datagrams carry one record each.
+ *
+ * When scanning a band, a record of direction 2 is written whenever the
+ * channel is tuned to a carrier or released. Its 48 bits carry 1 (tuned) or 0
+ * (released) in the first 8 bits and the frequency in Hz in the other 40 bits.
+ * The level is the level of the carrier above the noise floor in dB. Frames of
+ * the channel that follow are received on that frequency.
+ *
+ * When decoding a recording offline, frametrace_recording_time() selects the
+ * position within the recording as time, so that traces of parts of the same
+ * recording can be merged.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "sender.h"
+#include "frametrace.h"
+
+#define FRAMETRACE_MAGIC	"AFTR"
+#define FRAMETRACE_VERSION	1
+#define FRAMETRACE_HEADER	44
+#define FRAMETRACE_MAX_BITS	512
+#define FRAMETRACE_RING		(1 << 20)
+#define FRAMETRACE_FLUSH	100	/* ms between writes */
+
+static struct frametrace {
+	int		enabled;
+	char		protocol[8];
+	int		recording_time;	/* use position of received signal as time */
+	double		recording_start; /* position of first sample in recording */
+	FILE		*fp;		/* file */
+	int		sock;		/* or UDP socket */
+	/* ring of records, written by channels, read by writer thread */
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	uint8_t		*ring;
+	size_t		head, tail;	/* write and read position */
+	uint64_t	records;
+	uint64_t	dropped;
+	pthread_t	tid;
+	int		quit;
+} ft = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+	.sock = -1,
+};
+
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		p[i] = value >> (i * 8);
+}
+
+void frametrace_frame(sender_t *sender, int direction, const uint8_t *data, int bits, int bit_errors, double level)
+{
+	uint8_t record[FRAMETRACE_HEADER + FRAMETRACE_MAX_BITS / 8];
+	struct timespec ts;
+	uint64_t time_us;
+	size_t len, used, first;
+
+	if (!ft.enabled)
+		return;
+
+	if (bits > FRAMETRACE_MAX_BITS)
+		bits = FRAMETRACE_MAX_BITS;
+	len = FRAMETRACE_HEADER + (bits + 7) / 8;
+	if (ft.recording_time) {
+		sender_t *master = (sender->master) ? : sender;
+
+		time_us = (uint64_t)((ft.recording_start + (double)__atomic_load_n(&master->rx_samples, __ATOMIC_RELAXED) / (double)master->samplerate) * 1000000.0);
+	} else {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		time_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+	put_le(record, len, 2);
+	record[2] = FRAMETRACE_VERSION;
+	record[3] = direction;
+	put_le(record + 4, time_us, 8);
+	memcpy(record + 12, ft.protocol, 8);
+	memset(record + 20, 0, 16);
+	strncpy((char *)record + 20, sender->kanal, 16);
+	put_le(record + 36, (uint16_t)bit_errors, 2);
+	put_le(record + 38, (isnan(level)) ? 0x80000000 : (uint32_t)(int32_t)(level * 1000.0), 4);
+	put_le(record + 42, bits, 2);
+	memcpy(record + FRAMETRACE_HEADER, data, (bits + 7) / 8);
+
+	pthread_mutex_lock(&ft.mutex);
+	used = ft.head - ft.tail;
+	/* trace may be closed meanwhile */
+	if (!ft.enabled) {
+		pthread_mutex_unlock(&ft.mutex);
+		return;
+	}
+	if (used + len > FRAMETRACE_RING) {
+		ft.dropped++;
+		pthread_mutex_unlock(&ft.mutex);
+		return;
+	}
+	first = FRAMETRACE_RING - (ft.head % FRAMETRACE_RING);
+	if (first > len)
+		first = len;
+	memcpy(ft.ring + ft.head % FRAMETRACE_RING, record, first);
+	memcpy(ft.ring, record + first, len - first);
+	ft.head += len;
+	ft.records++;
+	/* wake writer early, if the ring fills up */
+	if (used + len > FRAMETRACE_RING / 2)
+		pthread_cond_signal(&ft.cond);
+	pthread_mutex_unlock(&ft.mutex);
+}
+
+/* trace frame given as a word, the bits are right aligned */
+void frametrace_word(sender_t *sender, int direction, uint64_t word, int bits, int bit_errors, double level)
+{
+	uint8_t data[8];
+	int i;
+
+	if (!ft.enabled)
+		return;
+
+	word <<= 64 - bits;
+	for (i = 0; i < 8; i++)
+		data[i] = word >> (56 - i * 8);
+	frametrace_frame(sender, direction, data, bits, bit_errors, level);
+}
+
+/* trace carrier that a channel is tuned to when scanning, or that it lost */
+void frametrace_carrier(sender_t *sender, double frequency, int attached, double level)
+{
+	uint64_t word;
+
+	if (!ft.enabled)
+		return;
+
+	word = ((uint64_t)(attached != 0) << 40) | ((uint64_t)llround(frequency) & 0xffffffffffULL);
+	frametrace_word(sender, FRAMETRACE_SCAN, word, 48, 0, level);
+}
+
+static void write_records(const uint8_t *data, size_t len)
+{
+	size_t rec;
+
+	if (ft.fp) {
+		if (fwrite(data, len, 1, ft.fp) != 1)
+			LOGP(DSENDER, LOGL_ERROR, "Failed to write frame trace (errno %d)!\n", errno);
+		fflush(ft.fp);
+		return;
+	}
+	while (len >= 2) {
+		rec = data[0] | (data[1] << 8);
+		send(ft.sock, data, rec, 0);
+		data += rec;
+		len -= rec;
+	}
+}
+
+static void *writer_thread(void __attribute__((unused)) *arg)
+{
+	uint8_t *chunk;
+	size_t len, first;
+	struct timespec ts;
+	int quit;
+
+	chunk = malloc(FRAMETRACE_RING);
+	if (!chunk)
+		return NULL;
+
+	pthread_mutex_lock(&ft.mutex);
+	do {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += FRAMETRACE_FLUSH * 1000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		if (!ft.quit)
+			pthread_cond_timedwait(&ft.cond, &ft.mutex, &ts);
+		quit = ft.quit;
+		/* take all records out of the ring */
+		len = ft.head - ft.tail;
+		first = FRAMETRACE_RING - (ft.tail % FRAMETRACE_RING);
+		if (first > len)
+			first = len;
+		memcpy(chunk, ft.ring + ft.tail % FRAMETRACE_RING, first);
+		memcpy(chunk + first, ft.ring, len - first);
+		ft.tail += len;
+		pthread_mutex_unlock(&ft.mutex);
+		if (len)
+			write_records(chunk, len);
+		pthread_mutex_lock(&ft.mutex);
+	} while (!quit);
+	pthread_mutex_unlock(&ft.mutex);
+
+	free(chunk);
+	return NULL;
+}
+
+/* target is a file or 'udp:<host>:<port>' */
+int frametrace_open(const char *target, const char *protocol)
+{
+	int rc;
+
+	if (!strncmp(target, "udp:", 4)) {
+		struct addrinfo hints, *res;
+		char host[256], *port;
+
+		strncpy(host, target + 4, sizeof(host) - 1);
+		host[sizeof(host) - 1] = '\0';
+		port = strrchr(host, ':');
+		if (!port) {
+			LOGP(DSENDER, LOGL_ERROR, "Frame trace '%s' requires a port, use 'udp:<host>:<port>'!\n", target);
+			return -EINVAL;
+		}
+		*port++ = '\0';
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_DGRAM;
+		rc = getaddrinfo(host, port, &hints, &res);
+		if (rc) {
+			LOGP(DSENDER, LOGL_ERROR, "Failed to resolve frame trace host '%s' (%s)!\n", host, gai_strerror(rc));
+			return -EINVAL;
+		}
+		ft.sock = socket(res->ai_family, SOCK_DGRAM, 0);
+		if (ft.sock < 0 || connect(ft.sock, res->ai_addr, res->ai_addrlen) < 0) {
+			rc = -errno;
+			LOGP(DSENDER, LOGL_ERROR, "Failed to open frame trace socket to '%s' (errno %d)!\n", target, -rc);
+			freeaddrinfo(res);
+			if (ft.sock >= 0)
+				close(ft.sock);
+			ft.sock = -1;
+			return rc;
+		}
+		freeaddrinfo(res);
+	} else {
+		ft.fp = fopen(target, "w");
+		if (!ft.fp) {
+			rc = -errno;
+			LOGP(DSENDER, LOGL_ERROR, "Failed to create frame trace file '%s' (errno %d)!\n", target, -rc);
+			return rc;
+		}
+		fwrite(FRAMETRACE_MAGIC, 4, 1, ft.fp);
+	}
+
+	ft.ring = malloc(FRAMETRACE_RING);
+	if (!ft.ring) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem for frame trace!\n");
+		rc = -ENOMEM;
+		goto error;
+	}
+	memset(ft.protocol, 0, sizeof(ft.protocol));
+	snprintf(ft.protocol, sizeof(ft.protocol), "%s", protocol);
+	ft.head = ft.tail = 0;
+	ft.records = ft.dropped = 0;
+	ft.quit = 0;
+	rc = pthread_create(&ft.tid, NULL, writer_thread, NULL);
+	if (rc) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create frame trace thread (rc %d)!\n", rc);
+		rc = -rc;
+		goto error;
+	}
+	ft.enabled = 1;
+	LOGP(DSENDER, LOGL_INFO, "Tracing frames to '%s'.\n", target);
+
+	return 0;
+
+error:
+	free(ft.ring);
+	ft.ring = NULL;
+	if (ft.fp)
+		fclose(ft.fp);
+	ft.fp = NULL;
+	if (ft.sock >= 0)
+		close(ft.sock);
+	ft.sock = -1;
+	return rc;
+}
+
+/* stamp frames with the position in the recording, starting at given seconds */
+void frametrace_recording_time(double start)
+{
+	ft.recording_time = 1;
+	ft.recording_start = start;
+}
+
+/* write remaining records and stop thread */
+void frametrace_close(void)
+{
+	if (!ft.enabled)
+		return;
+
+	pthread_mutex_lock(&ft.mutex);
+	ft.enabled = 0;
+	ft.quit = 1;
+	pthread_cond_signal(&ft.cond);
+	pthread_mutex_unlock(&ft.mutex);
+	pthread_join(ft.tid, NULL);
+
+	LOGP(DSENDER, LOGL_INFO, "Traced %" PRIu64 " frames, dropped %" PRIu64 " frames.\n", ft.records, ft.dropped);
+	free(ft.ring);
+	ft.ring = NULL;
+	if (ft.fp)
+		fclose(ft.fp);
+	ft.fp = NULL;
+	if (ft.sock >= 0)
+		close(ft.sock);
+	ft.sock = -1;
+}
+
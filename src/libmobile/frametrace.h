@@ -0,0 +1,12 @@
+
+#define FRAMETRACE_RX	0
+#define FRAMETRACE_TX	1
+#define FRAMETRACE_SCAN	2
+
+int frametrace_open(const char *target, const char *protocol);
+void frametrace_recording_time(double start);
+void frametrace_close(void);
+void frametrace_frame(sender_t *sender, int direction, const uint8_t *data, int bits, int bit_errors, double level);
+void frametrace_word(sender_t *sender, int direction, uint64_t word, int bits, int bit_errors, double level);
+void frametrace_carrier(sender_t *sender, double frequency, int attached, double level);
+
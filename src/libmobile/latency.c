@@ -0,0 +1,278 @@
+/* Mouth-to-ear latency probe
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* While a call is active, the audio from the fixed network is replaced by
+ * silence and a burst of 1000 Hz is inserted at every interval, before it is
+ * stored in the jitter buffer. The burst is detected in the TX signal of the
+ * transmitter, in the RX signal of the receiver and in the audio towards the
+ * fixed network. The receiver must get the transmitted signal, either by
+ * external loopback ('-l 2') or by a radio that sends the audio back.
+ *
+ * The TX detector knows how many samples are queued in the audio device,
+ * which gives the time the burst is on air. The stages are:
+ *
+ *  dejitter:  jitter buffer and DSP of transmitter
+ *  tx buffer: samples queued in audio device
+ *  air:       air, RX buffer of audio device and demodulation
+ *  rx dsp:    DSP of receiver until audio is forwarded
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "get_time.h"
+#include "latency.h"
+
+#define PROBE_FREQ	1000.0	/* frequency of burst */
+#define PROBE_LEVEL	8000	/* amplitude of burst at speech level */
+#define PROBE_SAMPLES	320	/* 40 ms at 8000 Hz */
+#define PROBE_WINDOW	0.002	/* resolution of detectors */
+#define PROBE_TRIGGER	10.0	/* level of burst over floor */
+#define PROBE_TIMEOUT	2.0	/* burst is lost, if not detected */
+#define MAX_PROBES	1024
+
+enum stage {
+	STAGE_DEJITTER = 0,
+	STAGE_TX_BUFFER,
+	STAGE_AIR,
+	STAGE_RX_DSP,
+	STAGE_TOTAL,
+	STAGES,
+};
+
+static const char *stage_names[STAGES] = {
+	"dejitter",
+	"tx buffer",
+	"air",
+	"rx dsp",
+	"total",
+};
+
+int latency_probe = 0;
+
+static pthread_mutex_t probe_mutex = PTHREAD_MUTEX_INITIALIZER;
+static double probe_interval;
+static double probe_next = 0.0;
+static int probe_seq = 0;		/* number of probe in flight, 0 if none */
+static int probe_count = 0;
+static int probe_burst_pos;		/* samples of burst injected */
+static double t_inject, t_tx, t_air, t_rx;
+static int num_lost = 0;
+static int num_results = 0;
+static double results[STAGES][MAX_PROBES];
+static latency_det_t up_det;
+
+void latency_probe_init(double interval)
+{
+	probe_interval = interval;
+	latency_probe = 1;
+	latency_det_init(&up_det, 8000.0);
+}
+
+void latency_det_init(latency_det_t *det, double samplerate)
+{
+	memset(det, 0, sizeof(*det));
+	det->samplerate = samplerate;
+	det->step = 2.0 * M_PI * PROBE_FREQ / samplerate;
+	det->window = (int)(samplerate * PROBE_WINDOW);
+	if (det->window < 1)
+		det->window = 1;
+	det->floor = -1.0;
+}
+
+/* return the sample index where the burst of current probe begins, or -1 */
+static int detect(latency_det_t *det, sample_t *samples, int count)
+{
+	double level;
+	int s, onset = -1, seq;
+
+	seq = __atomic_load_n(&probe_seq, __ATOMIC_ACQUIRE);
+	for (s = 0; s < count; s++) {
+		det->sum_i += samples[s] * cos(det->phase);
+		det->sum_q += samples[s] * sin(det->phase);
+		det->phase += det->step;
+		if (det->phase >= 2.0 * M_PI)
+			det->phase -= 2.0 * M_PI;
+		if (++det->count < det->window)
+			continue;
+		level = sqrt(det->sum_i * det->sum_i + det->sum_q * det->sum_q) / (double)det->count;
+		det->sum_i = det->sum_q = 0.0;
+		det->count = 0;
+		if (seq && det->seq != seq && onset < 0 && det->floor >= 0.0 && level > det->floor * PROBE_TRIGGER && level > 0.0) {
+			det->seq = seq;
+			onset = s + 1 - det->window;
+			if (onset < 0)
+				onset = 0;
+			continue;
+		}
+		/* learn floor while there is no burst */
+		if (det->seq != seq || !seq)
+			det->floor = (det->floor < 0.0) ? level : det->floor * 0.99 + level * 0.01;
+	}
+
+	return onset;
+}
+
+static void store_result(double t_up)
+{
+	double stage[STAGES];
+	int i;
+
+	stage[STAGE_DEJITTER] = (t_tx) ? t_tx - t_inject : NAN;
+	stage[STAGE_TX_BUFFER] = (t_tx) ? t_air - t_tx : NAN;
+	stage[STAGE_AIR] = (t_tx && t_rx) ? t_rx - t_air : NAN;
+	stage[STAGE_RX_DSP] = (t_rx) ? t_up - t_rx : NAN;
+	stage[STAGE_TOTAL] = t_up - t_inject;
+
+	LOGP(DSENDER, LOGL_NOTICE, "Latency probe %d: total %.1f ms (dejitter %.1f, tx buffer %.1f, air %.1f, rx dsp %.1f)\n", probe_count, stage[STAGE_TOTAL] * 1000.0, stage[STAGE_DEJITTER] * 1000.0, stage[STAGE_TX_BUFFER] * 1000.0, stage[STAGE_AIR] * 1000.0, stage[STAGE_RX_DSP] * 1000.0);
+	if (num_results == MAX_PROBES)
+		return;
+	for (i = 0; i < STAGES; i++)
+		results[i][num_results] = stage[i];
+	num_results++;
+}
+
+/* replace audio from fixed network by silence and bursts, this is called before the jitter buffer */
+void latency_probe_down(int16_t *spl, int len)
+{
+	double now;
+	int s;
+
+	if (!latency_probe)
+		return;
+
+	memset(spl, 0, len * sizeof(*spl));
+	now = get_time();
+
+	pthread_mutex_lock(&probe_mutex);
+	if (probe_seq && now - t_inject > PROBE_TIMEOUT) {
+		LOGP(DSENDER, LOGL_NOTICE, "Latency probe %d: burst was not received.\n", probe_count);
+		num_lost++;
+		__atomic_store_n(&probe_seq, 0, __ATOMIC_RELEASE);
+	}
+	if (!probe_seq && now >= probe_next) {
+		probe_count++;
+		t_inject = now;
+		t_tx = t_air = t_rx = 0.0;
+		probe_burst_pos = 0;
+		probe_next = now + probe_interval;
+		__atomic_store_n(&probe_seq, probe_count, __ATOMIC_RELEASE);
+	}
+	if (probe_seq) {
+		for (s = 0; s < len && probe_burst_pos < PROBE_SAMPLES; s++, probe_burst_pos++)
+			spl[s] = (int16_t)(PROBE_LEVEL * sin(2.0 * M_PI * PROBE_FREQ * (double)probe_burst_pos / 8000.0));
+	}
+	pthread_mutex_unlock(&probe_mutex);
+}
+
+/* TX signal of transmitter, 'queued' is the duration of samples that are in the audio device before these */
+void latency_probe_tx(latency_det_t *det, sample_t *samples, int count, double queued)
+{
+	double now;
+	int onset;
+
+	onset = detect(det, samples, count);
+	if (onset < 0)
+		return;
+
+	now = get_time();
+	pthread_mutex_lock(&probe_mutex);
+	if (probe_seq && !t_tx) {
+		t_tx = now;
+		t_air = now + queued + (double)onset / det->samplerate;
+	}
+	pthread_mutex_unlock(&probe_mutex);
+}
+
+/* RX signal of receiver, the last sample has just been read */
+void latency_probe_rx(latency_det_t *det, sample_t *samples, int count)
+{
+	double now;
+	int onset;
+
+	onset = detect(det, samples, count);
+	if (onset < 0)
+		return;
+
+	now = get_time();
+	pthread_mutex_lock(&probe_mutex);
+	if (probe_seq && !t_rx)
+		t_rx = now - (double)(count - onset) / det->samplerate;
+	pthread_mutex_unlock(&probe_mutex);
+}
+
+/* audio towards fixed network, after all processing of receiver */
+void latency_probe_up(sample_t *samples, int len)
+{
+	double now;
+	int onset;
+
+	if (!latency_probe)
+		return;
+
+	onset = detect(&up_det, samples, len);
+	if (onset < 0)
+		return;
+
+	now = get_time();
+	pthread_mutex_lock(&probe_mutex);
+	if (probe_seq) {
+		store_result(now - (double)(len - onset) / 8000.0);
+		__atomic_store_n(&probe_seq, 0, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&probe_mutex);
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+void latency_probe_report(void)
+{
+	double sorted[MAX_PROBES];
+	int i, j, n;
+
+	if (!latency_probe)
+		return;
+
+	LOGP(DSENDER, LOGL_NOTICE, "Latency probe: %d burst(s) received, %d lost.\n", num_results, num_lost);
+	if (!num_results)
+		return;
+	LOGP(DSENDER, LOGL_NOTICE, " %-10s %9s %9s %9s %9s (ms)\n", "stage", "min", "median", "95%", "max");
+	for (i = 0; i < STAGES; i++) {
+		for (j = 0, n = 0; j < num_results; j++) {
+			if (!isnan(results[i][j]))
+				sorted[n++] = results[i][j] * 1000.0;
+		}
+		if (!n) {
+			LOGP(DSENDER, LOGL_NOTICE, " %-10s not detected\n", stage_names[i]);
+			continue;
+		}
+		qsort(sorted, n, sizeof(*sorted), compare_double);
+		LOGP(DSENDER, LOGL_NOTICE, " %-10s %9.1f %9.1f %9.1f %9.1f\n", stage_names[i], sorted[0], sorted[n / 2], sorted[(n * 95) / 100], sorted[n - 1]);
+	}
+}
@@ -0,0 +1,21 @@
+
+/* detector of probe bursts at one point of the audio path */
+typedef struct latency_det {
+	double		samplerate;
+	double		phase, step;
+	double		sum_i, sum_q;
+	int		count, window;
+	double		floor;		/* level while there is no burst */
+	int		seq;		/* number of last probe that was detected */
+} latency_det_t;
+
+extern int latency_probe;
+
+void latency_probe_init(double interval);
+void latency_det_init(latency_det_t *det, double samplerate);
+void latency_probe_down(int16_t *spl, int len);
+void latency_probe_tx(latency_det_t *det, sample_t *samples, int count, double queued);
+void latency_probe_rx(latency_det_t *det, sample_t *samples, int count);
+void latency_probe_up(sample_t *samples, int len);
+void latency_probe_report(void);
+
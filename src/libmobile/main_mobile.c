@@ -19,16 +19,27 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
 #include <sched.h>
 #include <unistd.h>
 #include <math.h>
+#include <time.h>
 #include <termios.h>
 #include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include "../libsample/sample.h"
+#include "../libsample/kernels.h"
+#include "../libsample/memacct.h"
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 #include "sender.h"
 #include <osmocom/core/timer.h>
 #include <osmocom/core/select.h>
@@ -36,6 +47,14 @@
 #include "call.h"
 #include "console.h"
 #include "get_time.h"
+#include "metrics.h"
+#include "startup.h"
+#include "overload.h"
+#include "reconfig.h"
+#include "checkpoint.h"
+#include "session.h"
+#include "frametrace.h"
+#include "timerwheel.h"
 #ifdef HAVE_SDR
 #include "../libsdr/sdr.h"
 #include "../libsdr/sdr_config.h"
@@ -50,9 +69,9 @@ static int got_init = 0;
 
 /* common mobile settings */
 int num_kanal = 0;
-const char *kanal[MAX_SENDER];
+const char **kanal = NULL;
 int num_device = 0;
-const char *dsp_device[MAX_SENDER] = { "hw:0,0" };
+const char **dsp_device = NULL;
 int allow_sdr = 1;
 int use_sdr = 0;
 int dsp_samplerate = 48000;
@@ -61,6 +80,7 @@ int dsp_buffer = 50;
 static const char *call_device = "";
 static int call_samplerate = 48000;
 static int call_buffer = 50;
+static int call_direct = 0;
 int uses_emphasis = 1;
 int do_pre_emphasis = 0;
 int do_de_emphasis = 0;
@@ -78,10 +98,27 @@ static int release_on_disconnect = 1;
 int loopback = 0;
 int rt_prio = 0;
 int fast_math = 0;
+int use_threads = 0;
+int use_channel_threads = 0;
 const char *write_tx_wave = NULL;
 const char *write_rx_wave = NULL;
 const char *read_tx_wave = NULL;
 const char *read_rx_wave = NULL;
+static const char *metrics_address = NULL;
+static const char *frame_trace = NULL;
+static int daemon_mode = 0;
+static const char *control_path = NULL;
+static double benchmark = 0.0;
+static int offline = 0;
+static const char *report_file = NULL;
+static const char *checkpoint_file = NULL;
+static double checkpoint_interval = 60.0;
+static int memory_report = 0;
+static const char *record_session = NULL;
+static const char *replay_session = NULL;
+static int replay_pace = 0;
+static double wave_window_start = 0.0;
+static double wave_window_duration = 0.0;
 
 static const char *number_digits;
 static const struct number_lengths *number_lengths;
@@ -120,7 +157,7 @@ const char *mobile_number_check_length(const char *number)
 {
 	size_t len;
 	int i;
-	static char invalid[256];
+	static __thread char invalid[256];
 
 	if (!number_lengths)
 		return NULL;
@@ -151,7 +188,7 @@ const char *mobile_number_check_length(const char *number)
 const char *mobile_number_check_digits(const char *number)
 {
 	int i;
-	static char invalid[256];
+	static __thread char invalid[256];
 
 	for (i = 0; number[i]; i++) {
 		if (!strchr(number_digits, number[i])) {
@@ -167,8 +204,12 @@ const char *(*mobile_number_check_valid)(const char *);
 
 void main_mobile_init(const char *digits, const struct number_lengths lengths[], const char *prefixes[], const char *(*check_valid)(const char *))
 {
+	startup_begin();
+
 	logging_init();
 
+	dsp_kernels_init();
+
 	cc_argv[cc_argc++] = options_strdup("remote auto");
 
 	number_digits = digits;
@@ -190,6 +231,18 @@ void main_mobile_exit(void)
 	}
 }
 
+/* resize array of per channel option to given number of elements */
+void *main_mobile_array(void *array, int num, size_t size)
+{
+	array = realloc(array, num * size);
+	if (!array) {
+		fprintf(stderr, "No mem!\n");
+		exit(0);
+	}
+
+	return array;
+}
+
 void main_mobile_set_number_check_valid(const char *(*check_valid)(const char *))
 {
 	mobile_number_check_valid = check_valid;
@@ -249,8 +302,17 @@ void main_mobile_print_help(const char *arg0, const char *ext_usage)
 	printf("        Channel (German = Kanal) number of \"Sender\" (German = Transceiver)\n");
 	printf("        Use 'list' to show all channels. (Not supported by all applications.)\n");
 	printf(" -a --audio-device hw:<card>,<device>[/hw:<card>.<rec-device>]\n");
-	printf("        Sound card and device number (default = '%s')\n", dsp_device[0]);
+	printf("        Sound card and device number (default = '%s')\n", DSP_DEVICE_DEFAULT);
 	printf("        You may specify a different recording device by using '/'.\n");
+#ifdef HAVE_ALSA
+	printf("        Join sound cards with '+' to use them as one device, e.g. for six\n");
+	printf("        channels 'hw:0,0+hw:1,0+hw:2,0'. Each card carries two channels, or\n");
+	printf("        the number given after '*'. Clocks are synchronized to the first card.\n");
+#endif
+#ifdef HAVE_JACK
+	printf("        Use 'jack' or 'jack:<client name>' to be a client of a JACK or PipeWire\n");
+	printf("        server. Processing then follows the period of the server.\n");
+#endif
 	printf("        Don't set it for SDR!\n");
 	printf(" -s --samplerate <rate>\n");
 	printf("        Sample rate of sound device (default = '%d')\n", dsp_samplerate);
@@ -261,6 +323,36 @@ void main_mobile_print_help(const char *arg0, const char *ext_usage)
 	printf(" -b --buffer <ms>\n");
 	printf("        How many milliseconds are processed in advance (default = '%d')\n", dsp_buffer);
 	printf("        A buffer below 10 ms requires low interval like 0.1 ms.\n");
+	printf("    --buffer-auto-tune <ms>\n");
+	printf("        Start with the buffer given by '-b' and lower how far audio is processed\n");
+	printf("        in advance, as long as the TX buffer never gets below the given margin\n");
+	printf("        before it is refilled, e.g. '5'. The buffer is raised again when load or\n");
+	printf("        jitter increases or at underrun. Use a large '-b' as upper limit.\n");
+	printf("    --clock-drift\n");
+	printf("        Estimate the sample clock of the transceiver's and console's sound card\n");
+	printf("        (or SDR) against the system clock and compensate it by fine resampling.\n");
+	printf("        Compensation starts after about 30 seconds. Small buffers can then be\n");
+	printf("        used for a long time without slow drift of jitter buffers.\n");
+	printf("    --checkpoint <file>\n");
+	printf("        Restore state of registered subscribers from given file at startup and\n");
+	printf("        write it to that file periodically and when the program ends. After a\n");
+	printf("        restart, subscribers can be called without registering again. Only\n");
+	printf("        networks with a subscriber database support this.\n");
+	printf("    --checkpoint-interval <seconds>\n");
+	printf("        Interval of writing the checkpoint file. (default = %.0f)\n", checkpoint_interval);
+	printf("    --memory-report\n");
+	printf("        Show memory used by each subsystem and channel after startup and\n");
+	printf("        whenever info is dumped with 'i' key or via control socket.\n");
+#ifdef HAVE_ALSA
+	printf("    --audio-mmap\n");
+	printf("        Convert samples directly in the DMA buffer of the sound card, instead\n");
+	printf("        of copying them. The period size follows the interval, so a low\n");
+	printf("        interval and buffer can be used. Not all sound cards support this.\n");
+	printf("    --audio-poll\n");
+	printf("        Process audio when the sound card has captured a period, instead of\n");
+	printf("        polling its buffer at every interval. The period size follows the\n");
+	printf("        interval, so audio is exchanged with stable latency.\n");
+#endif
     if (uses_emphasis) {
 	printf(" -p --pre-emphasis\n");
 	printf("        Enable pre-emphasis, if you directly connect to the oscillator of the\n");
@@ -285,6 +377,10 @@ void main_mobile_print_help(const char *arg0, const char *ext_usage)
 	printf("        Sample rate of sound device for headset (default = '%d')\n", call_samplerate);
 	printf("    --call-buffer <ms>\n");
 	printf("        How many milliseconds are processed in advance (default = '%d')\n", call_buffer);
+	printf("    --call-direct\n");
+	printf("        Exchange audio between headset and call directly, without RTP and\n");
+	printf("        jitter buffer. The headset is serviced right after each period of the\n");
+	printf("        transceiver, so test calls have less delay. Use a small call buffer.\n");
 	printf(" -x --osmocc-cross\n");
 	printf("        Enable built-in call forwarding between mobiles. Be sure to have\n");
 	printf("        at least one control channel and two voice channels. Alternatively\n");
@@ -302,8 +398,28 @@ void main_mobile_print_help(const char *arg0, const char *ext_usage)
 	printf("        Loopback test: 1 = internal | 2 = external | 3 = echo\n");
 	printf(" -r --realtime <prio>\n");
 	printf("        Set prio: 0 to disable, 99 for maximum (default = %d)\n", rt_prio);
+	printf("    --threads\n");
+	printf("        Process audio of each audio device (channel and its slave channels)\n");
+	printf("        by a separate thread. The protocol of each channel, call control,\n");
+	printf("        timers and the console stay on the main thread.\n");
+	printf("    --channel-threads\n");
+	printf("        Process conditioning and DSP of each channel of an audio device by a\n");
+	printf("        separate thread, in lockstep with the other channels. The result is the\n");
+	printf("        same as without it, but multi channel SDR can use more CPU cores.\n");
+	thread_prio_print_help();
+	dsp_kernels_print_help();
+	printf("    --huge-pages\n");
+	printf("        Place the DSP buffers of all channels on huge pages, if the system has\n");
+	printf("        them reserved. Reduces TLB misses with many channels.\n");
 	printf("    --fast-math\n");
 	printf("        Use fast math approximation for slow CPU / ARM based systems.\n");
+	printf("    --vector-math\n");
+	printf("        Like --fast-math, but FM and AM modulation and demodulation use float\n");
+	printf("        math on blocks of samples, which can be vectorized by the compiler\n");
+	printf("        (SSE/AVX/NEON).\n");
+	printf("    --phasor-math\n");
+	printf("        Like --vector-math, but fixed frequency shifts use a recursive phasor.\n");
+	printf("        No sine tables are used, so less cache is required for many channels.\n");
 	printf("    --write-rx-wave <file>\n");
 	printf("        Write received audio to given wave file.\n");
 	printf("    --write-tx-wave <file>\n");
@@ -312,8 +428,69 @@ void main_mobile_print_help(const char *arg0, const char *ext_usage)
 	printf("        Replace received audio by given wave file.\n");
 	printf("    --read-tx-wave <file>\n");
 	printf("        Replace transmitted audio by given wave file.\n");
+	printf("    --read-wave-window <start>[,<duration>]\n");
+	printf("        Read received audio or IQ recording from given second on, and for the\n");
+	printf("        given duration only. With '--offline', frames are traced with their\n");
+	printf("        time within the recording. Used by 'osmobatchdecode'.\n");
+	printf("    --metrics <path> | <port>\n");
+	printf("        Serve measurements, channel states and statistics in Prometheus text\n");
+	printf("        format on a UNIX socket at given path or on a TCP port of localhost.\n");
+	printf("        Use e.g. 'curl --unix-socket <path> http://localhost/metrics'.\n");
+	printf("    --frame-trace <file> | udp:<host>:<port>\n");
+	printf("        Write each received and transmitted frame with time, channel, bits,\n");
+	printf("        bit errors and level to a binary file or send it as UDP datagram.\n");
+	printf("        Frames are dropped rather than delaying the signal processing.\n");
+	printf("    --daemon\n");
+	printf("        Run without terminal: No banner, no terminal setup, no keyboard input\n");
+	printf("        and no displays. Use --control and --metrics to control and monitor.\n");
+	printf("    --control <path>\n");
+	printf("        Accept hotkeys on a UNIX socket at given path, e.g.:\n");
+	printf("        'echo i | nc -U <path>' to dump info.\n");
+	printf("        Parameters can be changed without restart, e.g.:\n");
+	printf("        'echo set rx-gain all -3 | nc -U <path>'. Use 'params' to list them.\n");
+	printf("        'channel <channel> off|on' takes a channel off air and back on air.\n");
+	printf("    --startup-profile\n");
+	printf("        Report the time spent in each step of initialization, when going on air.\n");
+	printf("    --latency-probe <seconds>\n");
+	printf("        Measure the delay from the fixed network through transmitter and receiver\n");
+	printf("        back to the fixed network. During a call, the audio towards the phone is\n");
+	printf("        replaced by a burst at given interval (at least 0.5 seconds). The burst\n");
+	printf("        must be received again, use '-l 2' or a radio that sends audio back.\n");
+	printf("        The delay of each stage is reported on exit.\n");
+	printf("    --overload-control <percent>\n");
+	printf("        Shed optional work when processing takes more than the given percentage\n");
+	printf("        of real time or when audio buffers overflow or underrun, e.g. '90'.\n");
+	printf("        Work is shed in this order: displays, measurements, debug decoding,\n");
+	printf("        demodulation of idle SDR channels, then new calls are refused. Control\n");
+	printf("        channels are never shed. Work is resumed when the load is low again.\n");
+	printf("    --channel-allocation first | balance | pack\n");
+	printf("        Select between idle traffic channels of different sound cards or SDRs.\n");
+	printf("        'first' takes the first channel as given at the command line.\n");
+	printf("        'balance' takes the device with the fewest calls, to spread the load\n");
+	printf("        of its thread. 'pack' takes the device with the most calls, so other\n");
+	printf("        devices stay idle. (default = '%s')\n", chan_alloc_policy_name(chan_alloc_policy));
 #ifdef HAVE_SDR
     if (allow_sdr) {
+	printf("    --benchmark <seconds>\n");
+	printf("        Run all channels as fast as possible for the given time, with no SDR\n");
+	printf("        hardware. Transmitted IQ samples are looped back to the receiver in\n");
+	printf("        memory ('--sdr-loopback -l 2'), so the protocol decodes what it sends.\n");
+	printf("        Then report how many channels one CPU core can process in real time.\n");
+	printf("    --offline\n");
+	printf("        Decode a recording given by '--read-rx-wave' or '--read-iq-rx-wave' as\n");
+	printf("        fast as possible, with no SDR hardware. Exit when the recording ends.\n");
+	printf("    --record-session <file>\n");
+	printf("        Record key strokes, OSMO-CC messages and RTP from the fixed network\n");
+	printf("        to given file. Record the received signal with '--write-rx-wave' or\n");
+	printf("        '--write-iq-rx-wave' at the same time.\n");
+	printf("    --replay-session <file>\n");
+	printf("        Replay a recorded session with '--offline' and the recorded signal.\n");
+	printf("        Each event is injected at the same sample of the signal as recorded.\n");
+	printf("    --replay-pace\n");
+	printf("        Replay a session at the recorded pace, instead of as fast as possible.\n");
+	printf("    --report <file>\n");
+	printf("        Write decode results, CPU time and memory use of '--offline' or\n");
+	printf("        '--benchmark' to given file. Used by 'test_regression'.\n");
 	printf("    --limesdr\n");
 	printf("        Auto-select several required options for LimeSDR\n");
 	printf("    --limesdr-mini\n");
@@ -359,6 +536,7 @@ void main_mobile_print_hotkeys(void)
 	printf("Press 'w' key to toggle display of RX wave form.\n");
 	printf("Press 'c' key to toggle display of channel status.\n");
 	printf("Press 'm' key to toggle display of measurement value.\n");
+	printf("Press 'p' key to toggle display of processing time of each stage.\n");
 #ifdef HAVE_SDR
     if (allow_sdr) {
 	sdr_config_print_hotkeys();
@@ -378,6 +556,37 @@ void main_mobile_print_hotkeys(void)
 #define	OPT_CALL_BUFFER		1009
 #define	OPT_FAST_MATH		1010
 #define	OPT_NO_L16		1011
+#define	OPT_VECTOR_MATH		1012
+#define	OPT_PHASOR_MATH		1013
+#define	OPT_THREADS		1014
+#define	OPT_METRICS		1015
+#define	OPT_DAEMON		1016
+#define	OPT_CONTROL		1017
+#define	OPT_CHANNEL_THREADS	1018
+#define	OPT_STARTUP_PROFILE	1019
+#define	OPT_THREAD		1020
+#define	OPT_MLOCK		1021
+#define	OPT_HUGE_PAGES		1022
+#define	OPT_DSP_KERNELS		1023
+#define	OPT_BENCHMARK		1024
+#define	OPT_OFFLINE		1025
+#define	OPT_REPORT		1026
+#define	OPT_LATENCY_PROBE	1027
+#define	OPT_AUDIO_MMAP		1028
+#define	OPT_AUDIO_POLL		1029
+#define	OPT_OVERLOAD		1030
+#define	OPT_BUFFER_AUTO_TUNE	1031
+#define	OPT_CLOCK_DRIFT		1032
+#define	OPT_CHECKPOINT		1033
+#define	OPT_CHECKPOINT_INTERVAL	1034
+#define	OPT_MEMORY_REPORT	1035
+#define	OPT_CALL_DIRECT		1036
+#define	OPT_RECORD_SESSION	1037
+#define	OPT_REPLAY_SESSION	1038
+#define	OPT_REPLAY_PACE		1039
+#define	OPT_FRAME_TRACE		1040
+#define	OPT_READ_WAVE_WINDOW	1041
+#define	OPT_CHANNEL_ALLOCATION	1042
 #define	OPT_LIMESDR		1100
 #define	OPT_LIMESDR_MINI	1101
 
@@ -391,6 +600,11 @@ void main_mobile_add_options(void)
 	option_add('s', "samplerate", 1);
 	option_add('i', "interval", 1);
 	option_add('b', "buffer", 1);
+	option_add(OPT_BUFFER_AUTO_TUNE, "buffer-auto-tune", 1);
+	option_add(OPT_CLOCK_DRIFT, "clock-drift", 0);
+	option_add(OPT_CHECKPOINT, "checkpoint", 1);
+	option_add(OPT_CHECKPOINT_INTERVAL, "checkpoint-interval", 1);
+	option_add(OPT_MEMORY_REPORT, "memory-report", 0);
 	option_add('p', "pre-emphasis", 0);
 	option_add('d', "de-emphasis", 0);
 	option_add(OPT_RX_GAIN, "rx-gain", 1);
@@ -403,15 +617,43 @@ void main_mobile_add_options(void)
 	option_add('c', "call-device", 1);
 	option_add(OPT_CALL_SAMPLERATE, "call-samplerate", 1);
 	option_add(OPT_CALL_BUFFER, "call-buffer", 1);
+	option_add(OPT_CALL_DIRECT, "call-direct", 0);
 	option_add('t', "tones", 1);
 	option_add('l', "loopback", 1);
 	option_add('r', "realtime", 1);
+	option_add(OPT_THREADS, "threads", 0);
+	option_add(OPT_CHANNEL_THREADS, "channel-threads", 0);
 	option_add(OPT_FAST_MATH, "fast-math", 0);
+	option_add(OPT_VECTOR_MATH, "vector-math", 0);
+	option_add(OPT_PHASOR_MATH, "phasor-math", 0);
 	option_add(OPT_WRITE_RX_WAVE, "write-rx-wave", 1);
 	option_add(OPT_WRITE_TX_WAVE, "write-tx-wave", 1);
 	option_add(OPT_READ_RX_WAVE, "read-rx-wave", 1);
 	option_add(OPT_READ_TX_WAVE, "read-tx-wave", 1);
+	option_add(OPT_READ_WAVE_WINDOW, "read-wave-window", 1);
+	option_add(OPT_METRICS, "metrics", 1);
+	option_add(OPT_FRAME_TRACE, "frame-trace", 1);
+	option_add(OPT_DAEMON, "daemon", 0);
+	option_add(OPT_CONTROL, "control", 1);
+	option_add(OPT_STARTUP_PROFILE, "startup-profile", 0);
+	option_add(OPT_LATENCY_PROBE, "latency-probe", 1);
+	option_add(OPT_OVERLOAD, "overload-control", 1);
+	option_add(OPT_CHANNEL_ALLOCATION, "channel-allocation", 1);
+	option_add(OPT_THREAD, "thread", 1);
+	option_add(OPT_MLOCK, "mlock", 0);
+	option_add(OPT_HUGE_PAGES, "huge-pages", 0);
+	option_add(OPT_DSP_KERNELS, "dsp-kernels", 1);
+#ifdef HAVE_ALSA
+	option_add(OPT_AUDIO_MMAP, "audio-mmap", 0);
+	option_add(OPT_AUDIO_POLL, "audio-poll", 0);
+#endif
 #ifdef HAVE_SDR
+	option_add(OPT_BENCHMARK, "benchmark", 1);
+	option_add(OPT_OFFLINE, "offline", 0);
+	option_add(OPT_RECORD_SESSION, "record-session", 1);
+	option_add(OPT_REPLAY_SESSION, "replay-session", 1);
+	option_add(OPT_REPLAY_PACE, "replay-pace", 0);
+	option_add(OPT_REPORT, "report", 1);
 	option_add(OPT_LIMESDR, "limesdr", 0);
 	option_add(OPT_LIMESDR_MINI, "limesdr-mini", 0);
 	sdr_config_add_options();
@@ -456,6 +698,29 @@ int main_mobile_handle_options(int short_option, int argi, char **argv)
 	case 'b':
 		dsp_buffer = atoi(argv[argi]);
 		break;
+	case OPT_BUFFER_AUTO_TUNE:
+		autotune_margin = atof(argv[argi]);
+		if (autotune_margin <= 0.0) {
+			fprintf(stderr, "Margin of buffer auto-tuning must be greater than 0.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_CLOCK_DRIFT:
+		clock_drift = 1;
+		break;
+	case OPT_CHECKPOINT:
+		checkpoint_file = options_strdup(argv[argi]);
+		break;
+	case OPT_CHECKPOINT_INTERVAL:
+		checkpoint_interval = atof(argv[argi]);
+		if (checkpoint_interval < 1.0) {
+			fprintf(stderr, "Interval of checkpoint must be at least 1 second.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_MEMORY_REPORT:
+		memory_report = 1;
+		break;
 	case 'p':
 		if (!uses_emphasis) {
 			no_emph:
@@ -509,6 +774,9 @@ int main_mobile_handle_options(int short_option, int argi, char **argv)
 	case OPT_CALL_BUFFER:
 		call_buffer = atoi(argv[argi]);
 		break;
+	case OPT_CALL_DIRECT:
+		call_direct = 1;
+		break;
 	case 't':
 		send_patterns = atoi(argv[argi]);
 		break;
@@ -518,8 +786,20 @@ int main_mobile_handle_options(int short_option, int argi, char **argv)
 	case 'r':
 		rt_prio = atoi(argv[argi]);
 		break;
+	case OPT_THREADS:
+		use_threads = 1;
+		break;
+	case OPT_CHANNEL_THREADS:
+		use_channel_threads = 1;
+		break;
 	case OPT_FAST_MATH:
-		fast_math = 1;
+		fast_math = FM_MATH_TABLE;
+		break;
+	case OPT_VECTOR_MATH:
+		fast_math = FM_MATH_VECTOR;
+		break;
+	case OPT_PHASOR_MATH:
+		fast_math = FM_MATH_PHASOR;
 		break;
 	case OPT_WRITE_RX_WAVE:
 		write_rx_wave = options_strdup(argv[argi]);
@@ -533,7 +813,110 @@ int main_mobile_handle_options(int short_option, int argi, char **argv)
 	case OPT_READ_TX_WAVE:
 		read_tx_wave = options_strdup(argv[argi]);
 		break;
+	case OPT_READ_WAVE_WINDOW:
+		wave_window_start = atof(argv[argi]);
+		wave_window_duration = (strchr(argv[argi], ',')) ? atof(strchr(argv[argi], ',') + 1) : 0.0;
+		if (wave_window_start < 0.0 || wave_window_duration < 0.0) {
+			fprintf(stderr, "Given window of recording must not be negative.\n");
+			return -EINVAL;
+		}
+		wave_playback_window(wave_window_start, wave_window_duration);
+		break;
+	case OPT_METRICS:
+		metrics_address = options_strdup(argv[argi]);
+		break;
+	case OPT_FRAME_TRACE:
+		frame_trace = options_strdup(argv[argi]);
+		break;
+	case OPT_DAEMON:
+		daemon_mode = 1;
+		break;
+	case OPT_CONTROL:
+		control_path = options_strdup(argv[argi]);
+		break;
+	case OPT_STARTUP_PROFILE:
+		startup_profile = 1;
+		break;
+	case OPT_LATENCY_PROBE:
+		if (atof(argv[argi]) < 0.5) {
+			fprintf(stderr, "Interval of latency probe must be at least 0.5 seconds.\n");
+			return -EINVAL;
+		}
+		latency_probe_init(atof(argv[argi]));
+		break;
+	case OPT_OVERLOAD:
+		if (atof(argv[argi]) < 10.0 || atof(argv[argi]) > 100.0) {
+			fprintf(stderr, "Threshold of overload control must be in range of 10..100 percent.\n");
+			return -EINVAL;
+		}
+		overload_init(atof(argv[argi]) / 100.0);
+		break;
+	case OPT_CHANNEL_ALLOCATION:
+		if (chan_alloc_set_policy(argv[argi]) < 0) {
+			fprintf(stderr, "Given channel allocation policy '%s' is invalid, use '-h' for help.\n", argv[argi]);
+			return -EINVAL;
+		}
+		break;
+	case OPT_THREAD:
+		if (thread_prio_parse(argv[argi]) < 0)
+			return -EINVAL;
+		break;
+	case OPT_MLOCK:
+		thread_prio_mlock = 1;
+		break;
+	case OPT_HUGE_PAGES:
+		arena_huge_pages = 1;
+		break;
+	case OPT_DSP_KERNELS:
+		if (dsp_kernels_force(argv[argi]) < 0)
+			return -EINVAL;
+		break;
+#ifdef HAVE_ALSA
+	case OPT_AUDIO_MMAP:
+		sound_mmap = 1;
+		break;
+	case OPT_AUDIO_POLL:
+		sound_poll = 1;
+		break;
+#endif
 #ifdef HAVE_SDR
+	case OPT_BENCHMARK:
+		if (allow_sdr) {
+			char *argv_bench[] = { argv[0],
+				"--sdr-loopback",
+				"--loopback", "2",
+			};
+			int argc_bench = sizeof(argv_bench) / sizeof (*argv_bench);
+			benchmark = atof(argv[argi]);
+			if (benchmark <= 0.0) {
+				fprintf(stderr, "Benchmark duration must be greater than 0.\n");
+				return -EINVAL;
+			}
+			return options_command_line(argc_bench, argv_bench, main_mobile_handle_options);
+		}
+		break;
+	case OPT_OFFLINE:
+		if (allow_sdr) {
+			char *argv_offline[] = { argv[0],
+				"--sdr-loopback",
+			};
+			int argc_offline = sizeof(argv_offline) / sizeof (*argv_offline);
+			offline = 1;
+			return options_command_line(argc_offline, argv_offline, main_mobile_handle_options);
+		}
+		break;
+	case OPT_RECORD_SESSION:
+		record_session = options_strdup(argv[argi]);
+		break;
+	case OPT_REPLAY_SESSION:
+		replay_session = options_strdup(argv[argi]);
+		break;
+	case OPT_REPLAY_PACE:
+		replay_pace = 1;
+		break;
+	case OPT_REPORT:
+		report_file = options_strdup(argv[argi]);
+		break;
 	case OPT_LIMESDR:
 		if (allow_sdr) {
 			char *argv_lime[] = { argv[0],
@@ -594,21 +977,828 @@ void sighandler(int sigset)
 	quit = 1;
 }
 
-static int get_char()
+/* handle hotkeys, return character, if it is not handled */
+static int main_mobile_key(int c, int *quit)
 {
-	struct timeval tv = {0, 0};
-	fd_set fds;
-	char c = 0;
-	int __attribute__((__unused__)) rc;
+	/* there is no terminal to display at */
+	if (daemon_mode && strchr("wcmqsp", c))
+		return -1;
 
-	FD_ZERO(&fds);
-	FD_SET(0, &fds);
-	select(0+1, &fds, NULL, NULL, &tv);
-	if (FD_ISSET(0, &fds)) {
-		rc = read(0, &c, 1);
-		return c;
-	} else
+	switch (c) {
+	case 3:
+		/* quit */
+		printf("CTRL+c received, quitting!\n");
+		*quit = 1;
+		return -1;
+	case 'w':
+		/* toggle wave display */
+		display_status_on(0);
+		display_measurements_on(0);
+#ifdef HAVE_SDR
+		display_iq_on(0);
+		display_spectrum_on(0);
+#endif
+		display_profile_on(0);
+		display_wave_on(-1);
+		return -1;
+	case 'c':
+		/* toggle call state display */
+		display_wave_on(0);
+		display_measurements_on(0);
+#ifdef HAVE_SDR
+		display_iq_on(0);
+		display_spectrum_on(0);
+#endif
+		display_profile_on(0);
+		display_status_on(-1);
+		return -1;
+	case 'm':
+		/* toggle measurements display */
+		display_wave_on(0);
+		display_status_on(0);
+#ifdef HAVE_SDR
+		display_iq_on(0);
+		display_spectrum_on(0);
+#endif
+		display_profile_on(0);
+		display_measurements_on(-1);
+		return -1;
+#ifdef HAVE_SDR
+	case 'q':
+		/* toggle IQ display */
+		if (!use_sdr)
+			return -1;
+		display_wave_on(0);
+		display_status_on(0);
+		display_measurements_on(0);
+		display_spectrum_on(0);
+		display_profile_on(0);
+		display_iq_on(-1);
+		return -1;
+	case 's':
+		/* toggle spectrum display */
+		if (!use_sdr)
+			return -1;
+		display_wave_on(0);
+		display_status_on(0);
+		display_measurements_on(0);
+		display_iq_on(0);
+		display_profile_on(0);
+		display_spectrum_on(-1);
+		return -1;
+#endif
+	case 'p':
+		/* toggle profile display */
+		display_wave_on(0);
+		display_status_on(0);
+		display_measurements_on(0);
+#ifdef HAVE_SDR
+		display_iq_on(0);
+		display_spectrum_on(0);
+#endif
+		display_profile_on(-1);
+		return -1;
+	case 'i':
+		/* dump info */
+		dump_info();
+		if (memory_report)
+			memacct_report();
+		return -1;
+#ifdef HAVE_SDR
+	case 'b':
+		calibrate_bias();
+		return -1;
+	case 't':
+		if (!use_sdr)
+			return -1;
+		sdr_print_stats();
 		return -1;
+#endif
+	}
+
+	return c;
+}
+
+/* The main loop waits in osmo_select_main() until an event happens. Audio
+ * processing is driven by a timerfd at the DSP interval, the call clock by a
+ * timerfd of 20 ms and the keyboard is a registered file descriptor, so no
+ * time is spent for sleeping and polling. Osmo-CC sockets and timers are
+ * handled by the same select loop.
+ *
+ * If the audio device provides poll descriptors, its audio is processed when
+ * a period has been captured, so RX is read and TX is refilled once per
+ * period. Other devices are processed by the DSP interval.
+ */
+#define MAX_AUDIO_POLL	4
+
+struct main_loop_audio {
+	struct main_loop_audio *next;
+	sender_t	*sender;
+	int		num;
+	struct pollfd	pfd[MAX_AUDIO_POLL];
+	struct osmo_fd	ofd[MAX_AUDIO_POLL];
+};
+
+static struct main_loop {
+	int		*quit;
+	void		(*myhandler)(void);
+	sample_t	**samples;
+	uint8_t		**powers;
+	int		buffer_size;
+	struct osmo_fd	dsp_ofd;
+	struct osmo_fd	clock_ofd;
+	struct osmo_fd	stdin_ofd;
+	struct osmo_fd	metrics_ofd;
+	struct osmo_fd	control_ofd;
+	struct osmo_fd	queue_ofd;	/* protocol processing handed over by worker threads */
+	struct control_client *control_clients;
+	struct main_loop_audio *audio_polls;
+	overload_meter_t overload;	/* processing time of main thread */
+} main_loop;
+
+struct control_client {
+	struct control_client *next;
+	struct osmo_fd	ofd;
+	char		line[256];	/* received line, until it is complete */
+	int		line_len;
+};
+
+static int main_loop_timerfd(struct osmo_fd *ofd, double interval, int (*cb)(struct osmo_fd *ofd, unsigned int what))
+{
+	struct itimerspec its;
+	int fd;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create timerfd (errno %d)!\n", errno);
+		return -errno;
+	}
+	its.it_interval.tv_sec = (time_t)interval;
+	its.it_interval.tv_nsec = (long)((interval - (double)its.it_interval.tv_sec) * 1e9);
+	its.it_value = its.it_interval;
+	if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to start timerfd (errno %d)!\n", errno);
+		close(fd);
+		return -errno;
+	}
+	osmo_fd_setup(ofd, fd, OSMO_FD_READ, cb, NULL, 0);
+	osmo_fd_register(ofd);
+
+	return 0;
+}
+
+/* return number of timer expirations since last read */
+static uint64_t main_loop_expirations(struct osmo_fd *ofd)
+{
+	uint64_t expirations;
+
+	if (read(ofd->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return 0;
+	return expirations;
+}
+
+static void main_loop_unregister(struct osmo_fd *ofd, int do_close)
+{
+	if (ofd->fd < 0)
+		return;
+	osmo_fd_unregister(ofd);
+	if (do_close)
+		close(ofd->fd);
+	ofd->fd = -1;
+}
+
+static int main_loop_dsp_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	sender_t *sender;
+	uint64_t expirations;
+	double start;
+
+	expirations = main_loop_expirations(ofd);
+	if (!expirations)
+		return 0;
+
+	start = get_time();
+
+	/* process sound of all transceivers */
+	for (sender = sender_head; !sender_threaded && sender; sender = sender->next) {
+		/* do not process audio for an audio slave, since it is done by audio master */
+		if (sender->master) /* if master is set, we are an audio slave */
+			continue;
+		/* processed when the device completes a period */
+		if (sender->audio_polled)
+			continue;
+		process_sender_audio(sender, main_loop.quit, main_loop.samples, main_loop.powers, main_loop.buffer_size);
+	}
+
+	if (!use_osmocc_sock)
+		process_console(-1);
+
+	if (main_loop.myhandler)
+		main_loop.myhandler();
+
+	display_measurements((double)expirations * dsp_interval / 1000.0);
+	display_profile((double)expirations * dsp_interval / 1000.0);
+
+	overload_meter_busy(&main_loop.overload, start);
+
+	return 0;
+}
+
+static int main_loop_audio_cb(struct osmo_fd *ofd, unsigned int what);
+
+static void main_loop_audio_unregister(struct main_loop_audio *audio)
+{
+	int i;
+
+	for (i = 0; i < audio->num; i++)
+		main_loop_unregister(&audio->ofd[i], 0);
+	audio->num = 0;
+	audio->sender->audio_polled = 0;
+}
+
+/* (re-)register poll descriptors, they change when the device is reopened after an underrun */
+static void main_loop_audio_register(struct main_loop_audio *audio)
+{
+	struct pollfd pfd[MAX_AUDIO_POLL];
+	int num, i;
+
+	num = audio->sender->audio_get_poll(audio->sender->audio, pfd, MAX_AUDIO_POLL);
+	if (num == audio->num) {
+		for (i = 0; i < num; i++) {
+			if (pfd[i].fd != audio->pfd[i].fd || pfd[i].events != audio->pfd[i].events)
+				break;
+		}
+		if (i == num)
+			return;
+	}
+
+	main_loop_audio_unregister(audio);
+	for (i = 0; i < num; i++) {
+		audio->pfd[i] = pfd[i];
+		osmo_fd_setup(&audio->ofd[i], pfd[i].fd, ((pfd[i].events & POLLIN) ? OSMO_FD_READ : 0) | ((pfd[i].events & POLLOUT) ? OSMO_FD_WRITE : 0), main_loop_audio_cb, audio, i);
+		osmo_fd_register(&audio->ofd[i]);
+	}
+	audio->num = (num > 0) ? num : 0;
+	audio->sender->audio_polled = (num > 0);
+}
+
+static int main_loop_audio_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct main_loop_audio *audio = ofd->data;
+	double start;
+	int i;
+
+	/* the device tells from the events of all descriptors, if a period is complete */
+	for (i = 0; i < audio->num; i++)
+		audio->pfd[i].revents = 0;
+	audio->pfd[ofd->priv_nr].revents = ((what & OSMO_FD_READ) ? POLLIN : 0) | ((what & OSMO_FD_WRITE) ? POLLOUT : 0) | ((what & OSMO_FD_EXCEPT) ? POLLERR : 0);
+	if (!audio->sender->audio_poll_ready(audio->sender->audio, audio->pfd, audio->num))
+		return 0;
+
+	start = get_time();
+	process_sender_audio(audio->sender, main_loop.quit, main_loop.samples, main_loop.powers, main_loop.buffer_size);
+	main_loop_audio_register(audio);
+	/* headset follows the clock of the transceiver */
+	if (call_direct && !use_osmocc_sock)
+		process_console(-1);
+	overload_meter_busy(&main_loop.overload, start);
+
+	return 0;
+}
+
+static int main_loop_audio_open(void)
+{
+	struct main_loop_audio *audio;
+	sender_t *sender;
+
+	for (sender = sender_head; sender; sender = sender->next) {
+		if (sender->master || !sender->audio_get_poll)
+			continue;
+		audio = calloc(1, sizeof(*audio));
+		if (!audio) {
+			LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+			return -ENOMEM;
+		}
+		audio->sender = sender;
+		audio->next = main_loop.audio_polls;
+		main_loop.audio_polls = audio;
+		main_loop_audio_register(audio);
+		if (audio->num)
+			LOGP(DSENDER, LOGL_INFO, "Audio of channel %s is processed by periods of the device.\n", sender->kanal);
+	}
+
+	return 0;
+}
+
+static void main_loop_audio_close(void)
+{
+	struct main_loop_audio *audio;
+
+	while ((audio = main_loop.audio_polls)) {
+		main_loop.audio_polls = audio->next;
+		main_loop_audio_unregister(audio);
+		free(audio);
+	}
+}
+
+static int main_loop_clock_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	uint64_t expirations;
+
+	/* call clock every 20ms, skip if we are more than 100ms behind */
+	expirations = main_loop_expirations(ofd);
+	if (expirations >= 5)
+		return 0;
+	while (expirations--)
+		call_clock();
+
+	return 0;
+}
+
+/* key stroke from keyboard or from replayed session */
+static void main_loop_key(int c)
+{
+	if (main_mobile_key(c, main_loop.quit) < 0)
+		return;
+	if (!use_osmocc_sock)
+		process_console(c);
+}
+
+static int main_loop_stdin_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	char c;
+
+	if (read(ofd->fd, &c, 1) != 1) {
+		/* stdin closed, stop watching it */
+		main_loop_unregister(ofd, 0);
+		return 0;
+	}
+	session_record_key(c);
+	main_loop_key(c);
+
+	return 0;
+}
+
+static void control_client_close(struct control_client *client)
+{
+	struct control_client **client_p;
+
+	for (client_p = &main_loop.control_clients; *client_p; client_p = &((*client_p)->next)) {
+		if (*client_p == client) {
+			*client_p = client->next;
+			break;
+		}
+	}
+	main_loop_unregister(&client->ofd, 1);
+	free(client);
+}
+
+/* a line is a command of reconfiguration, otherwise each character is handled like a key stroke */
+static void control_client_line(struct control_client *client)
+{
+	char reply[4096];
+	int i;
+
+	client->line[client->line_len] = '\0';
+	if (reconfig_command(client->line, reply, sizeof(reply))) {
+		if (write(client->ofd.fd, reply, strlen(reply)) < 0)
+			LOGP(DSENDER, LOGL_DEBUG, "Failed to write reply to control socket (errno %d)\n", errno);
+	} else {
+		for (i = 0; i < client->line_len; i++)
+			main_mobile_key(client->line[i], main_loop.quit);
+	}
+	client->line_len = 0;
+}
+
+static int main_loop_control_client_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	struct control_client *client = ofd->data;
+	char buffer[256];
+	ssize_t rc;
+	int i;
+
+	rc = read(ofd->fd, buffer, sizeof(buffer));
+	if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rc <= 0) {
+		/* input without line end, e.g. 'echo -n' */
+		if (client->line_len)
+			control_client_line(client);
+		control_client_close(client);
+		return 0;
+	}
+	for (i = 0; i < rc; i++) {
+		if (buffer[i] == '\n' || buffer[i] == '\r') {
+			if (client->line_len)
+				control_client_line(client);
+			continue;
+		}
+		if (client->line_len < (int)sizeof(client->line) - 1)
+			client->line[client->line_len++] = buffer[i];
+	}
+
+	return 0;
+}
+
+static int main_loop_control_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	struct control_client *client;
+	int fd;
+
+	fd = accept(ofd->fd, NULL, NULL);
+	if (fd < 0)
+		return 0;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	client = calloc(1, sizeof(*client));
+	if (!client) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+		close(fd);
+		return 0;
+	}
+	osmo_fd_setup(&client->ofd, fd, OSMO_FD_READ, main_loop_control_client_cb, client, 0);
+	osmo_fd_register(&client->ofd);
+	client->next = main_loop.control_clients;
+	main_loop.control_clients = client;
+
+	return 0;
+}
+
+static int main_loop_control_open(const char *path)
+{
+	struct sockaddr_un sa;
+	int fd, rc;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		LOGP(DSENDER, LOGL_ERROR, "Path of control socket '%s' is too long!\n", path);
+		return -EINVAL;
+	}
+	strcpy(sa.sun_path, path);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		rc = -errno;
+		goto error;
+	}
+	/* remove stale socket of previous run */
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 4) < 0) {
+		rc = -errno;
+		close(fd);
+		goto error;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	osmo_fd_setup(&main_loop.control_ofd, fd, OSMO_FD_READ, main_loop_control_cb, NULL, 0);
+	osmo_fd_register(&main_loop.control_ofd);
+
+	return 0;
+
+error:
+	LOGP(DSENDER, LOGL_ERROR, "Failed to open control socket '%s' (errno %d)!\n", path, -rc);
+	return rc;
+}
+
+static int main_loop_queue_cb(struct osmo_fd __attribute__((unused)) *ofd, unsigned int __attribute__((unused)) what)
+{
+	sender_queue_process();
+
+	return 0;
+}
+
+static int main_loop_open(int *quit, void (*myhandler)(void), sample_t **samples, uint8_t **powers, int buffer_size)
+{
+	int rc;
+
+	memset(&main_loop, 0, sizeof(main_loop));
+	main_loop.quit = quit;
+	main_loop.myhandler = myhandler;
+	main_loop.samples = samples;
+	main_loop.powers = powers;
+	main_loop.buffer_size = buffer_size;
+	main_loop.dsp_ofd.fd = main_loop.clock_ofd.fd = main_loop.stdin_ofd.fd = main_loop.metrics_ofd.fd = main_loop.control_ofd.fd = main_loop.queue_ofd.fd = -1;
+
+	rc = main_loop_timerfd(&main_loop.dsp_ofd, dsp_interval / 1000.0, main_loop_dsp_cb);
+	if (rc < 0)
+		return rc;
+	rc = main_loop_timerfd(&main_loop.clock_ofd, 0.020, main_loop_clock_cb);
+	if (rc < 0)
+		return rc;
+	/* worker threads poll their devices themselves and hand over the protocol */
+	if (!sender_threaded) {
+		rc = main_loop_audio_open();
+		if (rc < 0)
+			return rc;
+	} else {
+		osmo_fd_setup(&main_loop.queue_ofd, sender_queue_fd, OSMO_FD_READ, main_loop_queue_cb, NULL, 0);
+		osmo_fd_register(&main_loop.queue_ofd);
+	}
+	if (!daemon_mode) {
+		osmo_fd_setup(&main_loop.stdin_ofd, 0, OSMO_FD_READ, main_loop_stdin_cb, NULL, 0);
+		osmo_fd_register(&main_loop.stdin_ofd);
+	}
+	if (control_path) {
+		rc = main_loop_control_open(control_path);
+		if (rc < 0)
+			return rc;
+	}
+	if (metrics_address) {
+		rc = metrics_open(&main_loop.metrics_ofd, metrics_address);
+		if (rc < 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+static void main_loop_close(void)
+{
+	main_loop_unregister(&main_loop.dsp_ofd, 1);
+	main_loop_unregister(&main_loop.clock_ofd, 1);
+	main_loop_unregister(&main_loop.stdin_ofd, 0);
+	main_loop_unregister(&main_loop.queue_ofd, 0);
+	main_loop_audio_close();
+	while (main_loop.control_clients)
+		control_client_close(main_loop.control_clients);
+	if (main_loop.control_ofd.fd >= 0) {
+		main_loop_unregister(&main_loop.control_ofd, 1);
+		unlink(control_path);
+	}
+	metrics_close(&main_loop.metrics_ofd);
+}
+
+/* allocate sample and power buffers of all channels from the arena, the buffers
+ * of one channel are placed next to each other */
+static int chan_buffers_alloc(arena_t *arena, int num_chan, int buffer_size, sample_t ***samples_p, uint8_t ***powers_p)
+{
+	sample_t **samples;
+	uint8_t **powers;
+	int i;
+
+	samples = calloc(num_chan + 1, sizeof(*samples));
+	powers = calloc(num_chan + 1, sizeof(*powers));
+	if (!samples || !powers)
+		goto nomem;
+	for (i = 0; i < num_chan; i++) {
+		samples[i] = arena_alloc(arena, buffer_size + 1, sizeof(**samples));
+		powers[i] = arena_alloc(arena, buffer_size + 1, sizeof(**powers));
+		if (!samples[i] || !powers[i])
+			goto nomem;
+	}
+	*samples_p = samples;
+	*powers_p = powers;
+
+	return 0;
+
+nomem:
+	LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+	free(samples);
+	free(powers);
+	return -ENOMEM;
+}
+
+/* the buffers itself are released with their arena */
+static void chan_buffers_free(sample_t **samples, uint8_t **powers)
+{
+	free(samples);
+	free(powers);
+}
+
+/* worker thread that processes audio of one audio master and its slaves */
+struct sender_worker {
+	pthread_t	tid;
+	int		running;
+	sender_t	*sender;
+	int		*quit;
+	int		buffer_size;
+	int		num_chan;
+	sample_t	**samples;
+	uint8_t		**powers;
+	overload_meter_t overload;
+};
+
+static void *sender_worker_thread(void *arg)
+{
+	struct sender_worker *worker = arg;
+	sender_t *sender = worker->sender;
+	struct pollfd pfd[MAX_AUDIO_POLL];
+	double begin_time, start, now, sleep;
+	int num;
+
+	thread_prio_apply(THREAD_WORKER);
+
+	while (!(*worker->quit)) {
+		begin_time = start = get_time();
+
+		/* descriptors are fetched each time, because they change when the device is reopened */
+		num = (sender->audio_get_poll) ? sender->audio_get_poll(sender->audio, pfd, MAX_AUDIO_POLL) : 0;
+		if (num > 0) {
+			/* wait until a period has been captured, return to check for quit */
+			if (poll(pfd, num, 100) > 0 && sender->audio_poll_ready(sender->audio, pfd, num)) {
+				start = get_time();
+				process_sender_audio(sender, worker->quit, worker->samples, worker->powers, worker->buffer_size);
+			} else
+				start = get_time();
+		} else
+			process_sender_audio(sender, worker->quit, worker->samples, worker->powers, worker->buffer_size);
+
+		overload_meter_busy(&worker->overload, start);
+
+		if (num > 0)
+			continue;
+
+		now = get_time();
+
+		/* sleep interval */
+		sleep = (dsp_interval / 1000.0) - (now - begin_time);
+		if (sleep > 0)
+			usleep(sleep * 1000000.0);
+	}
+
+	return NULL;
+}
+
+static void sender_worker_free(struct sender_worker *worker)
+{
+	chan_buffers_free(worker->samples, worker->powers);
+	worker->samples = NULL;
+	worker->powers = NULL;
+	worker->num_chan = 0;
+}
+
+static int sender_worker_start(struct sender_worker *worker, sender_t *sender, int *quit, int buffer_size)
+{
+	sender_t *inst;
+	int rc;
+
+	memset(worker, 0, sizeof(*worker));
+	worker->sender = sender;
+	worker->quit = quit;
+	worker->buffer_size = buffer_size;
+	for (worker->num_chan = 0, inst = sender; inst; worker->num_chan++, inst = inst->slave);
+	rc = chan_buffers_alloc(&sender->arena, worker->num_chan, buffer_size, &worker->samples, &worker->powers);
+	if (rc < 0)
+		return rc;
+
+	rc = pthread_create(&worker->tid, NULL, sender_worker_thread, worker);
+	if (rc) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create worker thread for channel %s (rc = %d)!\n", sender->kanal, rc);
+		sender_worker_free(worker);
+		return -rc;
+	}
+	worker->running = 1;
+
+	return 0;
+}
+
+static void sender_worker_stop(struct sender_worker *worker)
+{
+	if (worker->running) {
+		pthread_join(worker->tid, NULL);
+		worker->running = 0;
+	}
+	sender_worker_free(worker);
+}
+
+static double cpu_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* one 'key value' per line, so that reports of different runs can be compared */
+static void write_report(const char *name, int num_chan, double signal, double cpu)
+{
+	sender_t *sender;
+	uint64_t frames = 0, frames_bad = 0, bit_errors = 0;
+	size_t arena_used = 0;
+	int slabs = 0;
+	FILE *fp;
+
+	for (sender = sender_head; sender; sender = sender->next) {
+		frames += sender->rx_frames;
+		frames_bad += sender->rx_frames_bad;
+		bit_errors += sender->rx_bit_errors;
+		if (!sender->master) {
+			arena_used += sender->arena.used;
+			slabs += sender->arena.slabs;
+		}
+	}
+
+	fp = fopen(report_file, "w");
+	if (!fp) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to write report '%s' (%s)\n", report_file, strerror(errno));
+		return;
+	}
+	fprintf(fp, "network %s\n", name);
+	fprintf(fp, "channels %d\n", num_chan);
+	fprintf(fp, "frames_decoded %" PRIu64 "\n", frames);
+	fprintf(fp, "frames_bad %" PRIu64 "\n", frames_bad);
+	fprintf(fp, "bit_errors %" PRIu64 "\n", bit_errors);
+	fprintf(fp, "calls_setup %d\n", call_stats.setup);
+	fprintf(fp, "calls_answered %d\n", call_stats.answer);
+	fprintf(fp, "signal_seconds %.3f\n", signal);
+	fprintf(fp, "cpu_seconds %.3f\n", cpu);
+	fprintf(fp, "realtime_factor %.3f\n", (cpu > 0.0) ? signal / cpu : 0.0);
+	fprintf(fp, "arena_bytes %zu\n", arena_used);
+	fprintf(fp, "arena_slabs %d\n", slabs);
+	fclose(fp);
+}
+
+/* position of recorded session events, counted in received samples */
+static uint64_t session_position(void)
+{
+	return __atomic_load_n(&sender_head->rx_samples, __ATOMIC_RELAXED);
+}
+
+/* Process all channels without pause, because the SDR loops back in memory
+ * and never blocks. Timers and events are handled in between, so the protocol
+ * runs as usual. With worker threads, the workers process at their own pace.
+ * The CPU time of all threads is compared against the duration of the signal
+ * that all channels processed.
+ * In offline mode, the run ends when the recording has been played back.
+ * Events of a replayed session are injected before each period.
+ */
+static void benchmark_run(const char *name, int *quit, sample_t **samples, uint8_t **powers, int buffer_size)
+{
+	sender_t *sender;
+	double begin_wall, begin_cpu, cpu, signal = 0.0;
+	int num_chan = 0, work;
+
+	for (sender = sender_head; sender; sender = sender->next)
+		sender->rx_samples = 0;
+
+#ifdef HAVE_SDR
+	if (offline && !read_rx_wave && !sdr_config->read_iq_rx_wave) {
+		LOGP(DSENDER, LOGL_ERROR, "Offline mode requires a recording, use '--read-rx-wave' or '--read-iq-rx-wave'!\n");
+		*quit = 1;
+		return;
+	}
+#endif
+	if (replay_session && !offline) {
+		LOGP(DSENDER, LOGL_ERROR, "Replay of a session requires '--offline'!\n");
+		*quit = 1;
+		return;
+	}
+	if (replay_session && session_replay_open(replay_session, session_position, sender_head->samplerate, replay_pace, main_loop_key) < 0) {
+		*quit = 1;
+		return;
+	}
+
+	if (offline)
+		LOGP(DSENDER, LOGL_NOTICE, "Decoding recording...\n");
+	else
+		LOGP(DSENDER, LOGL_NOTICE, "Running benchmark for %.1f seconds...\n", benchmark);
+	begin_wall = get_time();
+	begin_cpu = cpu_time();
+	while (!(*quit)) {
+		if (offline && __atomic_load_n(&wave_playbacks_finished, __ATOMIC_RELAXED))
+			break;
+		if (!offline && get_time() - begin_wall >= benchmark)
+			break;
+		if (replay_session)
+			session_replay();
+		/* wait for protocol processing of the workers or the next interval */
+		if (sender_threaded)
+			osmo_select_main(0);
+		else {
+			for (sender = sender_head; sender; sender = sender->next) {
+				if (sender->master)
+					continue;
+				process_sender_audio(sender, quit, samples, powers, buffer_size);
+			}
+			if (main_loop.myhandler)
+				main_loop.myhandler();
+		}
+
+		do {
+			work = 0;
+			work |= osmo_cc_handle();
+			work |= osmo_select_main(1);
+		} while (work);
+		timerwheel_update();
+	}
+	cpu = cpu_time() - begin_cpu;
+
+	/* signal duration of all channels */
+	for (sender = sender_head; sender; sender = sender->next) {
+		if (sender->master)
+			continue;
+		signal += (double)sender->rx_samples / (double)sender->samplerate * (double)sender->num_chan;
+		num_chan += sender->num_chan;
+	}
+	if (cpu <= 0.0 || signal <= 0.0)
+		LOGP(DSENDER, LOGL_ERROR, "Benchmark did not process any samples!\n");
+	else {
+		LOGP(DSENDER, LOGL_NOTICE, "Benchmark: %d channel(s) processed %.1f seconds of signal in %.1f seconds of CPU time.\n", num_chan, signal, cpu);
+		LOGP(DSENDER, LOGL_NOTICE, "Benchmark: One CPU core processes %.1f channels in real time.\n", signal / cpu);
+	}
+	if (report_file)
+		write_report(name, num_chan, signal, cpu);
+
+	*quit = 1;
 }
 
 /* Loop through all transceiver instances of one network. */
@@ -616,10 +1806,12 @@ void main_mobile_loop(const char *name, int *quit, void (*myhandler)(void), cons
 {
 	int buffer_size;
 	sender_t *sender;
-	double last_time_call = 0, begin_time, now, sleep;
 	struct termios term, term_orig;
-	int num_chan, i;
-	int c;
+	int num_chan, num_master, i;
+	sample_t **samples;
+	uint8_t **powers;
+	struct sender_worker *workers;
+	arena_t loop_arena;
 	int rc;
 
 	if (!got_init) {
@@ -674,7 +1866,7 @@ void main_mobile_loop(const char *name, int *quit, void (*myhandler)(void), cons
 
 	/* init OSMO-CC */
 	if (!use_osmocc_sock)
-		console_init(call_device, call_samplerate, call_buffer, loopback, echo_test, number_digits, number_lengths, station_id);
+		console_init(call_device, call_samplerate, call_buffer, call_direct, loopback, echo_test, number_digits, number_lengths, station_id);
 
 	/* init call control instance */
 	rc = call_init(name, (use_osmocc_sock) ? send_patterns : 0, release_on_disconnect, use_osmocc_sock, cc_argc, cc_argv, no_l16);
@@ -682,11 +1874,13 @@ void main_mobile_loop(const char *name, int *quit, void (*myhandler)(void), cons
 		fprintf(stderr, "Failed to create call control instance. Quitting!\n");
 		return;
 	}
+	startup_step("call control");
 
 #ifdef HAVE_SDR
 	rc = sdr_configure(dsp_samplerate);
 	if (rc < 0)
 		return;
+	startup_step("sdr configure");
 #endif
 
 	/* open audio */
@@ -694,15 +1888,30 @@ void main_mobile_loop(const char *name, int *quit, void (*myhandler)(void), cons
 		return;
 	if (console_open_audio(buffer_size, dsp_interval))
 		return;
+	startup_step("open audio");
 
 	/* alloc memory for audio processing */
 	for (num_chan = 0, sender = sender_head; sender; num_chan++, sender = sender->next);
-	sample_t *samples[num_chan];
-	uint8_t *powers[num_chan];
-	for (i = 0; i < num_chan; i++) {
-		samples[i] = calloc(buffer_size, sizeof(**samples));
-		powers[i] = calloc(buffer_size, sizeof(**powers));
+	arena_init(&loop_arena, MEMACCT_BUFFERS, "main loop", (size_t)num_chan * (buffer_size + 1) * (sizeof(sample_t) + 1) + 4096);
+	if (chan_buffers_alloc(&loop_arena, num_chan, buffer_size, &samples, &powers) < 0) {
+		arena_free(&loop_arena);
+		return;
+	}
+	for (num_master = 0, sender = sender_head; sender; sender = sender->next) {
+		if (!sender->master)
+			num_master++;
 	}
+	workers = calloc(num_master + 1, sizeof(*workers));
+	if (!workers) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+		chan_buffers_free(samples, powers);
+		arena_free(&loop_arena);
+		return;
+	}
+
+	/* render displays outside the DSP path */
+	if (!daemon_mode)
+		display_thread_start();
 
 	/* real time priority */
 	if (rt_prio > 0) {
@@ -714,20 +1923,30 @@ void main_mobile_loop(const char *name, int *quit, void (*myhandler)(void), cons
 		rc = sched_setscheduler(0, SCHED_RR, &schedp);
 		if (rc) {
 			fprintf(stderr, "Error setting SCHED_RR with prio %d\n", rt_prio);
+			display_thread_stop();
 			return;
 		}
 	}
+	thread_prio_apply(THREAD_MAIN);
+
+	/* all buffers are allocated now */
+	if (thread_prio_lock_memory() < 0) {
+		display_thread_stop();
+		return;
+	}
 
-	if (!loopback)
+	if (!loopback && !daemon_mode)
 		print_aaimage();
 
 	/* prepare terminal */
-	tcgetattr(0, &term_orig);
-	term = term_orig;
-	term.c_lflag &= ~(ISIG|ICANON|ECHO);
-	term.c_cc[VMIN]=1;
-	term.c_cc[VTIME]=2;
-	tcsetattr(0, TCSANOW, &term);
+	if (!daemon_mode) {
+		tcgetattr(0, &term_orig);
+		term = term_orig;
+		term.c_lflag &= ~(ISIG|ICANON|ECHO);
+		term.c_cc[VMIN]=1;
+		term.c_cc[VTIME]=2;
+		tcsetattr(0, TCSANOW, &term);
+	}
 
 	/* catch signals */
 	signal(SIGINT, sighandler);
@@ -735,104 +1954,84 @@ void main_mobile_loop(const char *name, int *quit, void (*myhandler)(void), cons
 	signal(SIGTERM, sighandler);
 	signal(SIGPIPE, sighandler);
 
+	/* restore subscriber state of previous run */
+	if (checkpoint_file && !(*quit)) {
+		checkpoint_restore(checkpoint_file);
+		if (checkpoint_open(checkpoint_file, checkpoint_interval) < 0)
+			*quit = 1;
+	}
+
+	if (frame_trace && frametrace_open(frame_trace, name) < 0)
+		*quit = 1;
+	if (frame_trace && offline)
+		frametrace_recording_time(wave_window_start);
+#ifdef HAVE_SDR
+	/* carriers found when scanning are traced together with the frames */
+	sdr_scan_notify = frametrace_carrier;
+#endif
+
 	/* start streaming */
 	if (sender_start_audio())
 		*quit = 1;
 	if (console_start_audio())
 		*quit = 1;
+	startup_step("start audio");
+	if (memory_report && !(*quit))
+		memacct_report();
 
-	while(!(*quit)) {
-		int work;
-		begin_time = get_time();
-
-		/* process sound of all transceivers */
+	/* start worker threads for slave channels of each audio master */
+	if (use_channel_threads && !(*quit)) {
 		for (sender = sender_head; sender; sender = sender->next) {
-			/* do not process audio for an audio slave, since it is done by audio master */
-			if (sender->master) /* if master is set, we are an audio slave */
+			if (sender->master)
 				continue;
-			process_sender_audio(sender, quit, samples, powers, buffer_size);
+			if (sender_pool_start(sender) < 0) {
+				*quit = 1;
+				break;
+			}
 		}
+	}
 
-		/* process audio for call instances */
-		now = get_time();
-		if (now - last_time_call >= 0.1)
-			last_time_call = now;
-		if (now - last_time_call >= 0.020) {
-			last_time_call += 0.020;
-			/* call clock every 20ms */
-			call_clock();
+	/* start worker thread for each audio master */
+	if (use_threads && !(*quit) && sender_queue_open() < 0)
+		*quit = 1;
+	if (use_threads && !(*quit)) {
+		sender_threaded = 1;
+		for (i = 0, sender = sender_head; sender; sender = sender->next) {
+			if (sender->master)
+				continue;
+			if (sender_worker_start(&workers[i++], sender, quit, buffer_size) < 0) {
+				*quit = 1;
+				break;
+			}
 		}
+	}
 
-next_char:
-		c = get_char();
-		switch (c) {
-		case 3:
-			/* quit */
-			printf("CTRL+c received, quitting!\n");
-			*quit = 1;
-			goto next_char;
-		case 'w':
-			/* toggle wave display */
-			display_status_on(0);
-			display_measurements_on(0);
-#ifdef HAVE_SDR
-			display_iq_on(0);
-			display_spectrum_on(0);
-#endif
-			display_wave_on(-1);
-			goto next_char;
-		case 'c':
-			/* toggle call state display */
-			display_wave_on(0);
-			display_measurements_on(0);
-#ifdef HAVE_SDR
-			display_iq_on(0);
-			display_spectrum_on(0);
-#endif
-			display_status_on(-1);
-			goto next_char;
-		case 'm':
-			/* toggle measurements display */
-			display_wave_on(0);
-			display_status_on(0);
-#ifdef HAVE_SDR
-			display_iq_on(0);
-			display_spectrum_on(0);
-#endif
-			display_measurements_on(-1);
-			goto next_char;
-#ifdef HAVE_SDR
-		case 'q':
-			/* toggle IQ display */
-			if (!use_sdr)
-				goto next_char;
-			display_wave_on(0);
-			display_status_on(0);
-			display_measurements_on(0);
-			display_spectrum_on(0);
-			display_iq_on(-1);
-			goto next_char;
-		case 's':
-			/* toggle spectrum display */
-			if (!use_sdr)
-				goto next_char;
-			display_wave_on(0);
-			display_status_on(0);
-			display_measurements_on(0);
-			display_iq_on(0);
-			display_spectrum_on(-1);
-			goto next_char;
-#endif
-		case 'i':
-			/* dump info */
-			dump_info();
-			goto next_char;
-#ifdef HAVE_SDR
-		case 'b':
-			calibrate_bias();
-			goto next_char;
-#endif
-		}
+	/* register events: dsp interval, call clock and keyboard */
+	if (main_loop_open(quit, myhandler, samples, powers, buffer_size) < 0)
+		*quit = 1;
+	startup_step("threads and events");
+
+	dsp_kernels_report();
+
+	/* memory footprint of DSP buffers */
+	for (sender = sender_head; sender; sender = sender->next) {
+		if (!sender->master)
+			arena_report(&sender->arena);
+	}
+	arena_report(&loop_arena);
+	startup_report();
+
+	if (record_session && !(*quit) && session_record_open(record_session, session_position) < 0)
+		*quit = 1;
+
+	if ((benchmark || offline) && !(*quit))
+		benchmark_run(name, quit, samples, powers, buffer_size);
+
+	while(!(*quit)) {
+		int work;
+
+		/* wait for events, including protocol processing of worker threads */
+		osmo_select_main(0);
 
 		/* handle all handlers until no more events */
 		do {
@@ -840,25 +2039,35 @@ next_char:
 			work |= osmo_cc_handle();
 			work |= osmo_select_main(1);
 		} while (work);
+		timerwheel_update();
+	}
 
-		if (!use_osmocc_sock)
-			process_console(c);
+	main_loop_close();
+	reconfig_exit();
+	session_close();
 
-		if (myhandler)
-			myhandler();
+	latency_probe_report();
+	sender_graph_report();
+	sender_drift_report();
 
-		display_measurements(dsp_interval / 1000.0);
+	/* wait for worker threads */
+	if (sender_threaded) {
+		sender_queue_stop();
+		for (i = 0; i < num_master; i++)
+			sender_worker_stop(&workers[i]);
+		sender_threaded = 0;
+	}
+	sender_queue_close();
 
-		now = get_time();
+	/* stop worker threads for slave channels */
+	for (sender = sender_head; sender; sender = sender->next)
+		sender_pool_stop(sender);
 
-		/* sleep interval */
-		sleep = (dsp_interval / 1000.0) - (now - begin_time);
-		if (sleep > 0)
-			usleep(sleep * 1000000.0);
+	/* write final subscriber state */
+	checkpoint_close();
 
-//		now = get_time();
-//		printf("duration =%.6f\n", now - begin_time);
-	}
+	/* write remaining frames */
+	frametrace_close();
 
 	/* reset signals */
 	signal(SIGINT, SIG_DFL);
@@ -866,13 +2075,15 @@ next_char:
 	signal(SIGTERM, SIG_DFL);
 	signal(SIGPIPE, SIG_DFL);
 
-	for (i = 0; i < num_chan; i++) {
-		free(samples[i]);
-		free(powers[i]);
-	}
+	display_thread_stop();
+
+	chan_buffers_free(samples, powers);
+	arena_free(&loop_arena);
+	free(workers);
 
 	/* reset terminal */
-	tcsetattr(0, TCSANOW, &term_orig);
+	if (!daemon_mode)
+		tcsetattr(0, TCSANOW, &term_orig);
 	
 	/* reset real time prio */
 	if (rt_prio > 0) {
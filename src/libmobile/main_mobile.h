@@ -1,23 +1,27 @@
 
 extern int num_kanal;
-extern const char *kanal[];
+extern const char **kanal;
 extern int swap_links;
 extern int num_device;
 extern int allow_sdr;
 extern int use_sdr;
-extern const char *dsp_device[];
+extern const char **dsp_device;
 extern int dsp_samplerate;
 extern double dsp_interval;
 extern int dsp_buffer;
 extern int uses_emphasis;
 extern int do_pre_emphasis;
 extern int do_de_emphasis;
+/* The following globals are set from the command line before any channel or
+ * thread is created and are not changed afterwards. */
 extern double rx_gain;
 extern double tx_gain;
 extern int send_patterns;
 extern int loopback;
 extern int rt_prio;
 extern int fast_math;
+extern int use_threads;
+extern int use_channel_threads;
 extern const char *write_rx_wave;
 extern const char *write_tx_wave;
 extern const char *read_rx_wave;
@@ -45,12 +49,13 @@ void main_mobile_print_station_id(void);
 void main_mobile_add_options(void);
 int main_mobile_handle_options(int short_option, int argi, char **argv);
 
+#define DSP_DEVICE_DEFAULT "hw:0,0"
+
+/* per channel options are stored in arrays that grow with each entry */
+void *main_mobile_array(void *array, int num, size_t size);
 #define OPT_ARRAY(num_name, name, value) \
 { \
-	if (num_name == MAX_SENDER) { \
-		fprintf(stderr, "Too many channels defined!\n"); \
-		exit(0); \
-	} \
+	name = main_mobile_array(name, num_name + 1, sizeof(*name)); \
 	name[num_name++] = value; \
 }
 
@@ -0,0 +1,495 @@
+/* export of measurements and statistics for monitoring
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The metrics are served in Prometheus text format (version 0.0.4) as HTTP
+ * response on a local socket. The socket is a UNIX socket, if a path is
+ * given, or a TCP socket on localhost, if a port is given:
+ *
+ *   curl --unix-socket /run/analog/nmt.sock http://localhost/metrics
+ *   curl http://localhost:9100/metrics
+ *
+ * A response is sent after the request (or end of input) is received, so
+ * 'nc -U <path> </dev/null' also works. The values are taken from the same
+ * data as the terminal displays. The main loop serves the socket, so values
+ * are consistent with protocol processing.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include <osmocom/core/select.h>
+#include "sender.h"
+#ifdef HAVE_SDR
+#include "../libsdr/sdr_stats.h"
+#include "../libsdr/sdr_config.h"
+#endif
+#include "get_time.h"
+#include "overload.h"
+#include "metrics.h"
+
+#define METRICS_PREFIX		"analog_"
+#define METRICS_REQUEST_MAX	4096	/* ignore rest of larger requests */
+
+typedef struct metrics_client {
+	struct osmo_fd	ofd;
+	int		received;
+} metrics_client_t;
+
+static const char *metrics_path = NULL;
+static double metrics_start;
+
+/* write label value, escaped as required by the text format */
+static void label(FILE *fp, const char *name, const char *value, int first)
+{
+	fprintf(fp, "%s%s=\"", (first) ? "" : ",", name);
+	for (; *value; value++) {
+		if (*value == '\\' || *value == '"')
+			fprintf(fp, "\\%c", *value);
+		else if (*value == '\n')
+			fprintf(fp, "\\n");
+		else
+			fputc(*value, fp);
+	}
+	fputc('"', fp);
+}
+
+static void value(FILE *fp, double v)
+{
+	if (isnan(v))
+		fprintf(fp, "} NaN\n");
+	else if (isinf(v))
+		fprintf(fp, "} %sInf\n", (v < 0) ? "-" : "+");
+	else
+		fprintf(fp, "} %.9g\n", v);
+}
+
+static void metric_kanal(FILE *fp, const char *name, const char *kanal, double v)
+{
+	fprintf(fp, METRICS_PREFIX "%s{", name);
+	label(fp, "channel", kanal, 1);
+	value(fp, v);
+}
+
+static void write_measurements(FILE *fp)
+{
+	dispmeas_t *disp;
+	dispmeasparam_t *param;
+
+	fprintf(fp, "# HELP " METRICS_PREFIX "measurement Measurement of last second, as displayed.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "measurement gauge\n");
+	for (disp = meas_head; disp; disp = disp->next) {
+		for (param = disp->param; param; param = param->next) {
+			fprintf(fp, METRICS_PREFIX "measurement{");
+			label(fp, "channel", disp->kanal, 1);
+			label(fp, "name", param->name, 0);
+			label(fp, "format", param->format, 0);
+			value(fp, param->hold);
+		}
+	}
+}
+
+static void write_status(FILE *fp)
+{
+	const dispstatus_t *entries;
+	int num, i;
+
+	num = display_status_entries(&entries);
+
+	fprintf(fp, "# HELP " METRICS_PREFIX "channel_state Current state of channel.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "channel_state gauge\n");
+	for (i = 0; i < num; i++) {
+		if (entries[i].number[0])
+			continue;
+		fprintf(fp, METRICS_PREFIX "channel_state{");
+		label(fp, "channel", entries[i].kanal, 1);
+		label(fp, "type", entries[i].type, 0);
+		label(fp, "state", entries[i].state, 0);
+		value(fp, 1);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "subscriber Subscriber that is attached to channel.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "subscriber gauge\n");
+	for (i = 0; i < num; i++) {
+		if (!entries[i].number[0])
+			continue;
+		fprintf(fp, METRICS_PREFIX "subscriber{");
+		label(fp, "channel", entries[i].kanal, 1);
+		label(fp, "number", entries[i].number, 0);
+		label(fp, "state", entries[i].state, 0);
+		value(fp, 1);
+	}
+}
+
+static void write_jitter(FILE *fp)
+{
+	static const char *names[] = { "received", "late", "lost", "concealed" };
+	sender_t *sender;
+	jitter_stats_t stats;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		fprintf(fp, "# HELP " METRICS_PREFIX "jitter_%s_total Frames %s by jitter buffer of audio towards transmitter.\n", names[i], names[i]);
+		fprintf(fp, "# TYPE " METRICS_PREFIX "jitter_%s_total counter\n", names[i]);
+		for (sender = sender_head; sender; sender = sender->next) {
+			char name[64];
+			jitter_get_stats(&sender->dejitter, &stats);
+			snprintf(name, sizeof(name), "jitter_%s_total", names[i]);
+			metric_kanal(fp, name, sender->kanal, (i == 0) ? stats.received : (i == 1) ? stats.late : (i == 2) ? stats.lost : stats.concealed);
+		}
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "jitter_seconds Interarrival jitter (RFC 3550).\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "jitter_seconds gauge\n");
+	for (sender = sender_head; sender; sender = sender->next) {
+		jitter_get_stats(&sender->dejitter, &stats);
+		metric_kanal(fp, "jitter_seconds", sender->kanal, stats.jitter / 1000.0);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "jitter_delay_seconds Delay of last frame in jitter buffer.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "jitter_delay_seconds gauge\n");
+	for (sender = sender_head; sender; sender = sender->next) {
+		jitter_get_stats(&sender->dejitter, &stats);
+		metric_kanal(fp, "jitter_delay_seconds", sender->kanal, stats.delay / 1000.0);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "jitter_target_seconds Target window of jitter buffer.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "jitter_target_seconds gauge\n");
+	for (sender = sender_head; sender; sender = sender->next) {
+		jitter_get_stats(&sender->dejitter, &stats);
+		metric_kanal(fp, "jitter_target_seconds", sender->kanal, stats.target / 1000.0);
+	}
+}
+
+static void write_profile(FILE *fp)
+{
+	dispprof_t *prof;
+	int i;
+
+	fprintf(fp, "# HELP " METRICS_PREFIX "stage_duration_seconds Duration of processing stage in last profile interval.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "stage_duration_seconds gauge\n");
+	for (prof = prof_head; prof; prof = prof->next) {
+		if (!prof->valid)
+			continue;
+		for (i = 0; i < DISPLAY_PROFILE_STAGES; i++) {
+			dispprofhist_t *hist = &prof->stage[i];
+			if (!hist->last_count)
+				continue;
+			fprintf(fp, METRICS_PREFIX "stage_duration_seconds{");
+			label(fp, "channel", prof->kanal, 1);
+			label(fp, "stage", display_profile_stage_name(i), 0);
+			fprintf(fp, ",quantile=\"0.5\"");
+			value(fp, hist->p50);
+			fprintf(fp, METRICS_PREFIX "stage_duration_seconds{");
+			label(fp, "channel", prof->kanal, 1);
+			label(fp, "stage", display_profile_stage_name(i), 0);
+			fprintf(fp, ",quantile=\"0.99\"");
+			value(fp, hist->p99);
+			fprintf(fp, METRICS_PREFIX "stage_duration_seconds{");
+			label(fp, "channel", prof->kanal, 1);
+			label(fp, "stage", display_profile_stage_name(i), 0);
+			fprintf(fp, ",quantile=\"1\"");
+			value(fp, hist->last_max);
+		}
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "stage_load Fraction of real time used by processing stage.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "stage_load gauge\n");
+	for (prof = prof_head; prof; prof = prof->next) {
+		if (!prof->valid)
+			continue;
+		for (i = 0; i < DISPLAY_PROFILE_STAGES; i++) {
+			if (!prof->stage[i].last_count)
+				continue;
+			fprintf(fp, METRICS_PREFIX "stage_load{");
+			label(fp, "channel", prof->kanal, 1);
+			label(fp, "stage", display_profile_stage_name(i), 0);
+			value(fp, prof->stage[i].load);
+		}
+	}
+}
+
+#ifdef HAVE_SDR
+static void write_sdr(FILE *fp)
+{
+	sdr_stats_t *stats;
+	char device[16];
+	int d, samplerate;
+
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_overflows_total Overflows of SDR receive buffer.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_overflows_total counter\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)))
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_overflows_total{");
+		label(fp, "device", device, 1);
+		value(fp, stats->rx.events);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_underruns_total Underruns of SDR transmit buffer.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_underruns_total counter\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)))
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_underruns_total{");
+		label(fp, "device", device, 1);
+		value(fp, stats->tx.events);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_buffer_fill_max_seconds Highest fill level of SDR buffer.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_buffer_fill_max_seconds gauge\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)) || !samplerate)
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_buffer_fill_max_seconds{");
+		label(fp, "device", device, 1);
+		fprintf(fp, ",direction=\"rx\"");
+		value(fp, (double)stats->rx.fill_max / (double)samplerate);
+		fprintf(fp, METRICS_PREFIX "sdr_buffer_fill_max_seconds{");
+		label(fp, "device", device, 1);
+		fprintf(fp, ",direction=\"tx\"");
+		value(fp, (double)stats->tx.fill_max / (double)samplerate);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_latency_seconds RX latency until demodulation.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_latency_seconds gauge\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)) || !stats->latency_count)
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_latency_seconds{");
+		label(fp, "device", device, 1);
+		fprintf(fp, ",stat=\"avg\"");
+		value(fp, stats->latency_sum / (double)stats->latency_count);
+		fprintf(fp, METRICS_PREFIX "sdr_latency_seconds{");
+		label(fp, "device", device, 1);
+		fprintf(fp, ",stat=\"max\"");
+		value(fp, stats->latency_max);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_dc_offset Tracked DC offset of received IQ samples.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_dc_offset gauge\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)) || !stats->iq_correct || !stats->iq_correct->valid)
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_dc_offset{");
+		label(fp, "device", device, 1);
+		fprintf(fp, ",component=\"i\"");
+		value(fp, stats->iq_correct->dc_I);
+		fprintf(fp, METRICS_PREFIX "sdr_dc_offset{");
+		label(fp, "device", device, 1);
+		fprintf(fp, ",component=\"q\"");
+		value(fp, stats->iq_correct->dc_Q);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_iq_gain_imbalance_db Amplitude of Q relative to I before correction.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_iq_gain_imbalance_db gauge\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)) || !stats->iq_correct || !stats->iq_correct->valid)
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_iq_gain_imbalance_db{");
+		label(fp, "device", device, 1);
+		value(fp, stats->iq_correct->gain_db);
+	}
+	fprintf(fp, "# HELP " METRICS_PREFIX "sdr_iq_phase_imbalance_degrees Deviation from 90 degrees between I and Q before correction.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "sdr_iq_phase_imbalance_degrees gauge\n");
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (!(stats = sdr_get_stats(d, &samplerate)) || !stats->iq_correct || !stats->iq_correct->valid)
+			continue;
+		snprintf(device, sizeof(device), "%d", d + 1);
+		fprintf(fp, METRICS_PREFIX "sdr_iq_phase_imbalance_degrees{");
+		label(fp, "device", device, 1);
+		value(fp, stats->iq_correct->phase_deg);
+	}
+}
+#endif
+
+/* render all metrics, return allocated text */
+static char *metrics_render(size_t *size_p)
+{
+	char *text = NULL;
+	FILE *fp;
+
+	fp = open_memstream(&text, size_p);
+	if (!fp)
+		return NULL;
+
+	fprintf(fp, "# HELP " METRICS_PREFIX "uptime_seconds Time since metrics socket was opened.\n");
+	fprintf(fp, "# TYPE " METRICS_PREFIX "uptime_seconds counter\n");
+	fprintf(fp, METRICS_PREFIX "uptime_seconds %.3f\n", get_time() - metrics_start);
+	write_status(fp);
+	write_measurements(fp);
+	write_jitter(fp);
+	write_profile(fp);
+	if (overload_control) {
+		fprintf(fp, "# HELP " METRICS_PREFIX "overload_level Level of work shed by overload control.\n");
+		fprintf(fp, "# TYPE " METRICS_PREFIX "overload_level gauge\n");
+		fprintf(fp, METRICS_PREFIX "overload_level");
+		value(fp, overload_level);
+	}
+#ifdef HAVE_SDR
+	write_sdr(fp);
+#endif
+
+	fclose(fp);
+
+	return text;
+}
+
+static void client_close(metrics_client_t *client)
+{
+	osmo_fd_unregister(&client->ofd);
+	close(client->ofd.fd);
+	free(client);
+}
+
+static int client_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	metrics_client_t *client = ofd->data;
+	char buffer[1024], header[128];
+	char *text;
+	size_t size;
+	ssize_t rc;
+
+	rc = recv(ofd->fd, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
+	if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rc > 0) {
+		buffer[rc] = '\0';
+		client->received += rc;
+		/* wait for end of HTTP request header */
+		if (!strstr(buffer, "\r\n\r\n") && !strstr(buffer, "\n\n") && client->received < METRICS_REQUEST_MAX)
+			return 0;
+	}
+
+	text = metrics_render(&size);
+	if (text) {
+		snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", size);
+		/* the response fits into the socket buffer, if not, it is truncated */
+		if (send(ofd->fd, header, strlen(header), MSG_DONTWAIT | MSG_NOSIGNAL) > 0)
+			send(ofd->fd, text, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+		free(text);
+	}
+	client_close(client);
+
+	return 0;
+}
+
+static int listen_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	metrics_client_t *client;
+	int fd;
+
+	fd = accept(ofd->fd, NULL, NULL);
+	if (fd < 0)
+		return 0;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	client = calloc(1, sizeof(*client));
+	if (!client) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+		close(fd);
+		return 0;
+	}
+	osmo_fd_setup(&client->ofd, fd, OSMO_FD_READ, client_cb, client, 0);
+	osmo_fd_register(&client->ofd);
+
+	return 0;
+}
+
+/* open socket, the address is a port number on localhost or a path of UNIX socket */
+int metrics_open(struct osmo_fd *ofd, const char *address)
+{
+	const char *p;
+	int fd, rc;
+
+	ofd->fd = -1;
+
+	for (p = address; *p >= '0' && *p <= '9'; p++);
+	if (!*p) {
+		struct sockaddr_in sa;
+		int on = 1;
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(atoi(address));
+		sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			goto error;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		rc = bind(fd, (struct sockaddr *)&sa, sizeof(sa));
+	} else {
+		struct sockaddr_un sa;
+
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		if (strlen(address) >= sizeof(sa.sun_path)) {
+			LOGP(DSENDER, LOGL_ERROR, "Path of metrics socket '%s' is too long!\n", address);
+			return -EINVAL;
+		}
+		strcpy(sa.sun_path, address);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			goto error;
+		/* remove stale socket of previous run */
+		unlink(address);
+		rc = bind(fd, (struct sockaddr *)&sa, sizeof(sa));
+		metrics_path = address;
+	}
+	if (rc < 0 || listen(fd, 8) < 0) {
+		rc = -errno;
+		LOGP(DSENDER, LOGL_ERROR, "Failed to open metrics socket '%s' (errno %d)!\n", address, -rc);
+		close(fd);
+		metrics_path = NULL;
+		return rc;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	metrics_start = get_time();
+	osmo_fd_setup(ofd, fd, OSMO_FD_READ, listen_cb, NULL, 0);
+	osmo_fd_register(ofd);
+
+	LOGP(DSENDER, LOGL_INFO, "Serving metrics at '%s'.\n", address);
+
+	return 0;
+
+error:
+	rc = -errno;
+	LOGP(DSENDER, LOGL_ERROR, "Failed to open metrics socket '%s' (errno %d)!\n", address, errno);
+	return rc;
+}
+
+void metrics_close(struct osmo_fd *ofd)
+{
+	if (ofd->fd < 0)
+		return;
+	osmo_fd_unregister(ofd);
+	close(ofd->fd);
+	ofd->fd = -1;
+	if (metrics_path) {
+		unlink(metrics_path);
+		metrics_path = NULL;
+	}
+}
@@ -0,0 +1,5 @@
+#include <osmocom/core/select.h>
+
+int metrics_open(struct osmo_fd *ofd, const char *address);
+void metrics_close(struct osmo_fd *ofd);
+
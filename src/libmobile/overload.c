@@ -0,0 +1,177 @@
+/* Overload control of DSP processing
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each thread that processes audio reports its processing time. The load
+ * is the fraction of time spent processing within a window. If the load of
+ * any thread is above the threshold, or if buffers of the SDR or sound card
+ * overflow or underrun, optional work is shed, one level after another:
+ *
+ *  displays:      wave, IQ and spectrum displays are not fed
+ *  measurements:  measurements (display and metrics) are not updated
+ *  debug:         debug output of decoders in hot paths is suppressed
+ *  idle rx:       idle traffic channels of SDR are not demodulated
+ *  calls:         new calls from the fixed network are refused
+ *
+ * Control channels are never shed. If the load stays below the threshold
+ * for some time, the work is resumed, one level after another.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../libdisplay/display.h"
+#ifdef HAVE_SDR
+#include "../libsdr/sdr_config.h"
+#include "../libsdr/sdr_stats.h"
+#include "../libsdr/sdr.h"
+#endif
+#include "get_time.h"
+#include "overload.h"
+
+#define OVERLOAD_WINDOW		0.5	/* load is evaluated after this time */
+#define OVERLOAD_RAISE_HOLD	1.0	/* minimum time between shedding levels */
+#define OVERLOAD_STABLE		10.0	/* resume a level after this time without overload */
+#define OVERLOAD_HYSTERESIS	0.8	/* load must be below this part of threshold to resume */
+
+int overload_control = 0;
+int overload_level = OVERLOAD_NONE;
+
+static pthread_mutex_t overload_mutex = PTHREAD_MUTEX_INITIALIZER;
+static double overload_threshold;
+static double last_change = 0.0;	/* time of last level change */
+static double last_high = 0.0;		/* time of last overload */
+static int buffer_events = 0;		/* events reported since last evaluation */
+#ifdef HAVE_SDR
+static uint64_t sdr_events = 0;		/* events of SDR statistics at last evaluation */
+#endif
+
+static const char *level_names[OVERLOAD_LEVELS] = {
+	"none",
+	"displays",
+	"measurements",
+	"debug decoding",
+	"idle channel RX",
+	"new calls",
+};
+
+const char *overload_level_name(int level)
+{
+	if (level < 0 || level >= OVERLOAD_LEVELS)
+		return "invalid";
+	return level_names[level];
+}
+
+/* threshold is the load (0..1) at which work is shed */
+void overload_init(double threshold)
+{
+	overload_threshold = threshold;
+	overload_control = 1;
+}
+
+static void set_level(int level)
+{
+	overload_level = level;
+	display_suspended = (level >= OVERLOAD_DISPLAY);
+	display_measurements_suspended = (level >= OVERLOAD_MEASUREMENT);
+	log_hot_suspended = (level >= OVERLOAD_DEBUG);
+#ifdef HAVE_SDR
+	sdr_rx_gate_forced = (level >= OVERLOAD_IDLE_RX);
+#endif
+}
+
+/* get new overflows and underruns of all SDR devices */
+static int sdr_buffer_events(void)
+{
+#ifdef HAVE_SDR
+	sdr_stats_t *stats;
+	uint64_t events = 0, new;
+	int d, samplerate;
+
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if ((stats = sdr_get_stats(d, &samplerate)))
+			events += stats->rx.events + stats->tx.events;
+	}
+	new = events - sdr_events;
+	sdr_events = events;
+	return (int)new;
+#else
+	return 0;
+#endif
+}
+
+static void evaluate(double load, double now)
+{
+	int events;
+
+	pthread_mutex_lock(&overload_mutex);
+	events = buffer_events + sdr_buffer_events();
+	buffer_events = 0;
+
+	if (load > overload_threshold || events) {
+		last_high = now;
+		if (overload_level < OVERLOAD_CALLS && now - last_change >= OVERLOAD_RAISE_HOLD) {
+			set_level(overload_level + 1);
+			last_change = now;
+			LOGP(DSENDER, LOGL_NOTICE, "Overload: load %.0f%%, %d buffer event(s), shedding %s.\n", load * 100.0, events, level_names[overload_level]);
+		}
+	} else if (overload_level > OVERLOAD_NONE && load < overload_threshold * OVERLOAD_HYSTERESIS
+		&& now - last_high >= OVERLOAD_STABLE && now - last_change >= OVERLOAD_STABLE) {
+		LOGP(DSENDER, LOGL_NOTICE, "Load is %.0f%%, resuming %s.\n", load * 100.0, level_names[overload_level]);
+		set_level(overload_level - 1);
+		last_change = now;
+	}
+	pthread_mutex_unlock(&overload_mutex);
+}
+
+/* add processing time from given start until now, evaluate at end of window */
+void overload_meter_busy(overload_meter_t *meter, double start)
+{
+	double now, load;
+
+	if (!overload_control)
+		return;
+
+	now = get_time();
+	if (!meter->begin) {
+		meter->begin = start;
+		meter->busy = 0.0;
+	}
+	meter->busy += now - start;
+	if (now - meter->begin < OVERLOAD_WINDOW)
+		return;
+
+	load = meter->busy / (now - meter->begin);
+	meter->begin = now;
+	meter->busy = 0.0;
+	evaluate(load, now);
+}
+
+/* buffer of audio device did overflow or underrun */
+void overload_event(void)
+{
+	if (!overload_control)
+		return;
+
+	pthread_mutex_lock(&overload_mutex);
+	buffer_events++;
+	pthread_mutex_unlock(&overload_mutex);
+}
+
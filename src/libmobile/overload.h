@@ -0,0 +1,26 @@
+
+/* work that is shed by overload control, in order of priority */
+enum overload_level {
+	OVERLOAD_NONE = 0,
+	OVERLOAD_DISPLAY,	/* displays are not fed */
+	OVERLOAD_MEASUREMENT,	/* measurements are not updated */
+	OVERLOAD_DEBUG,		/* debug decoding is not logged */
+	OVERLOAD_IDLE_RX,	/* idle channels are not demodulated */
+	OVERLOAD_CALLS,		/* new calls are refused */
+	OVERLOAD_LEVELS,
+};
+
+/* processing time of one thread, evaluated at each window */
+typedef struct overload_meter {
+	double		begin;		/* start of current window */
+	double		busy;		/* processing time within window */
+} overload_meter_t;
+
+extern int overload_control;
+extern int overload_level;
+
+void overload_init(double threshold);
+void overload_meter_busy(overload_meter_t *meter, double start);
+void overload_event(void);
+const char *overload_level_name(int level);
+
@@ -0,0 +1,237 @@
+/* socket to receive pages in bulk
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Pages are written to a UNIX socket, one page per line, using the same
+ * format as the message FIFO of the paging network. A batch of pages is
+ * terminated by an empty line. After each batch, a line is returned:
+ *
+ *   <accepted> <rejected> <queue depth>
+ *
+ * When the queue depth reaches the given limit, no more lines are read until
+ * the queue drains. Then the socket buffer fills and the client blocks, so
+ * the client cannot overrun the transmitter.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../liblogging/logging.h"
+#include <osmocom/core/select.h>
+#include "page_socket.h"
+
+#define PAGE_BUFFER	4096	/* must hold at least one line */
+
+typedef struct page_client {
+	struct page_client	*next;
+	struct osmo_fd		ofd;
+	char			buffer[PAGE_BUFFER];
+	int			length;		/* bytes in buffer */
+	int			accepted, rejected; /* pages of current batch */
+	int			paused;		/* queue was full, reading is disabled */
+} page_client_t;
+
+static struct osmo_fd page_ofd = { .fd = -1 };
+static const char *page_path = NULL;
+static page_client_t *page_clients = NULL;
+static int page_queue_max;
+static int (*page_cb)(const char *text);
+static int (*page_queue_depth)(void);
+
+static void client_close(page_client_t *client)
+{
+	page_client_t **client_p;
+
+	for (client_p = &page_clients; *client_p; client_p = &((*client_p)->next)) {
+		if (*client_p == client) {
+			*client_p = client->next;
+			break;
+		}
+	}
+	osmo_fd_unregister(&client->ofd);
+	close(client->ofd.fd);
+	free(client);
+}
+
+/* handle all complete lines, until queue is full */
+static void client_process(page_client_t *client)
+{
+	char reply[64], *line, *end;
+	int start = 0;
+
+	while (start < client->length) {
+		line = client->buffer + start;
+		end = memchr(line, '\n', client->length - start);
+		if (!end) {
+			/* line does not fit into buffer */
+			if (start == 0 && client->length == PAGE_BUFFER) {
+				LOGP(DSENDER, LOGL_NOTICE, "Page on socket exceeds %d bytes, dropping.\n", PAGE_BUFFER);
+				client->rejected++;
+				start = client->length;
+			}
+			break;
+		}
+		if (line[0] != '\n' && line[0] != '\r' && page_queue_depth() >= page_queue_max) {
+			if (!client->paused) {
+				LOGP(DSENDER, LOGL_DEBUG, "Queue is full, stop reading pages from socket.\n");
+				osmo_fd_read_disable(&client->ofd);
+				client->paused = 1;
+			}
+			break;
+		}
+		start = end - client->buffer + 1;
+		*end = '\0';
+		if (end > line && end[-1] == '\r')
+			*--end = '\0';
+		if (end == line) {
+			/* end of batch */
+			snprintf(reply, sizeof(reply), "%d %d %d\n", client->accepted, client->rejected, page_queue_depth());
+			send(client->ofd.fd, reply, strlen(reply), MSG_DONTWAIT | MSG_NOSIGNAL);
+			client->accepted = client->rejected = 0;
+			continue;
+		}
+		if (page_cb(line) < 0)
+			client->rejected++;
+		else
+			client->accepted++;
+	}
+
+	client->length -= start;
+	memmove(client->buffer, client->buffer + start, client->length);
+}
+
+static int client_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	page_client_t *client = ofd->data;
+	ssize_t rc;
+
+	if (client->paused)
+		return 0;
+
+	rc = recv(ofd->fd, client->buffer + client->length, PAGE_BUFFER - client->length, MSG_DONTWAIT);
+	if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rc <= 0) {
+		client_close(client);
+		return 0;
+	}
+	client->length += rc;
+	client_process(client);
+
+	return 0;
+}
+
+static int listen_cb(struct osmo_fd *ofd, unsigned int __attribute__((unused)) what)
+{
+	page_client_t *client;
+	int fd;
+
+	fd = accept(ofd->fd, NULL, NULL);
+	if (fd < 0)
+		return 0;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	client = calloc(1, sizeof(*client));
+	if (!client) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+		close(fd);
+		return 0;
+	}
+	osmo_fd_setup(&client->ofd, fd, OSMO_FD_READ, client_cb, client, 0);
+	osmo_fd_register(&client->ofd);
+	client->next = page_clients;
+	page_clients = client;
+
+	return 0;
+}
+
+/* open socket, each received page is given to page(), which returns < 0, if the page is rejected */
+int page_socket_open(const char *path, int queue_max, int (*page)(const char *text), int (*queue_depth)(void))
+{
+	struct sockaddr_un sa;
+	int fd, rc;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		LOGP(DSENDER, LOGL_ERROR, "Path of page socket '%s' is too long!\n", path);
+		return -EINVAL;
+	}
+	strcpy(sa.sun_path, path);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		rc = -errno;
+		goto error;
+	}
+	/* remove stale socket of previous run */
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 4) < 0) {
+		rc = -errno;
+		close(fd);
+		goto error;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	osmo_fd_setup(&page_ofd, fd, OSMO_FD_READ, listen_cb, NULL, 0);
+	osmo_fd_register(&page_ofd);
+
+	page_path = path;
+	page_queue_max = queue_max;
+	page_cb = page;
+	page_queue_depth = queue_depth;
+
+	LOGP(DSENDER, LOGL_INFO, "Receiving pages at '%s'.\n", path);
+
+	return 0;
+
+error:
+	LOGP(DSENDER, LOGL_ERROR, "Failed to open page socket '%s' (errno %d)!\n", path, -rc);
+	return rc;
+}
+
+/* resume paused clients, when the queue has drained */
+void page_socket_work(void)
+{
+	page_client_t *client;
+
+	for (client = page_clients; client; client = client->next) {
+		if (!client->paused || page_queue_depth() >= page_queue_max)
+			continue;
+		client->paused = 0;
+		osmo_fd_read_enable(&client->ofd);
+		client_process(client);
+	}
+}
+
+void page_socket_close(void)
+{
+	while (page_clients)
+		client_close(page_clients);
+	if (page_ofd.fd < 0)
+		return;
+	osmo_fd_unregister(&page_ofd);
+	close(page_ofd.fd);
+	page_ofd.fd = -1;
+	unlink(page_path);
+	page_path = NULL;
+}
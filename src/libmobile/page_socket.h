@@ -0,0 +1,4 @@
+
+int page_socket_open(const char *path, int queue_max, int (*page)(const char *text), int (*queue_depth)(void));
+void page_socket_work(void);
+void page_socket_close(void);
@@ -0,0 +1,239 @@
+/* Reconfiguration at run time
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Commands are given as lines on the control socket:
+ *
+ *   params                              list parameters
+ *   set <param> <value>                 set global parameter
+ *   set <param> <channel>|all <value>   set parameter of one or all channels
+ *   channel <channel> off|on            take channel off air or back on air
+ *
+ * Commands are handled by the main loop, which also runs the protocol, so
+ * protocol state can be changed directly. The conditioning stages of audio
+ * are used by channel workers, so a new gain is only marked and the graphs
+ * are rebuilt by the audio processing of the transceiver.
+ *
+ * Parameters of the protocol are added with reconfig_add() by the network,
+ * only parameters that are safe to change while calls are active.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "sender.h"
+#include "reconfig.h"
+
+static int set_rx_gain(sender_t *sender, const char *value)
+{
+	if (sender->use_sdr)
+		return -EINVAL;
+	sender->rx_gain = pow(10, atof(value) / 20.0);
+	sender->reconfigure = 1;
+	return 0;
+}
+
+static int set_tx_gain(sender_t *sender, const char *value)
+{
+	if (sender->use_sdr)
+		return -EINVAL;
+	sender->tx_gain = pow(10, atof(value) / 20.0);
+	sender->reconfigure = 1;
+	return 0;
+}
+
+static int set_verbose(sender_t __attribute__((unused)) *sender, const char *value)
+{
+	return (parse_logging_opt(value) < 0) ? -EINVAL : 0;
+}
+
+static reconfig_param_t builtin_params[] = {
+	{ NULL, "rx-gain", "Gain of received audio in dB (not with SDR)", 1, set_rx_gain },
+	{ NULL, "tx-gain", "Gain of transmitted audio in dB (not with SDR)", 1, set_tx_gain },
+	{ NULL, "verbose", "Logging level and categories, like '-v'", 0, set_verbose },
+	{ NULL, NULL, NULL, 0, NULL },
+};
+
+static reconfig_param_t *reconfig_params = NULL;
+
+void reconfig_add(const char *name, int per_channel, int (*set)(sender_t *sender, const char *value), const char *help)
+{
+	reconfig_param_t *param, **param_p;
+
+	param = calloc(1, sizeof(*param));
+	if (!param) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+		return;
+	}
+	param->name = name;
+	param->help = help;
+	param->per_channel = per_channel;
+	param->set = set;
+
+	/* keep order of adding for the list */
+	for (param_p = &reconfig_params; *param_p; param_p = &((*param_p)->next))
+		;
+	*param_p = param;
+}
+
+void reconfig_exit(void)
+{
+	reconfig_param_t *param;
+
+	while ((param = reconfig_params)) {
+		reconfig_params = param->next;
+		free(param);
+	}
+}
+
+static reconfig_param_t *find_param(const char *name)
+{
+	reconfig_param_t *param;
+	int i;
+
+	for (i = 0; builtin_params[i].name; i++) {
+		if (!strcasecmp(builtin_params[i].name, name))
+			return &builtin_params[i];
+	}
+	for (param = reconfig_params; param; param = param->next) {
+		if (!strcasecmp(param->name, name))
+			return param;
+	}
+	return NULL;
+}
+
+static void list_params(char *reply, size_t reply_size)
+{
+	reconfig_param_t *param;
+	size_t len = 0;
+	int i;
+
+	for (i = 0; builtin_params[i].name && len < reply_size; i++)
+		len += snprintf(reply + len, reply_size - len, "%s%s: %s\n", builtin_params[i].name, (builtin_params[i].per_channel) ? " <channel>|all" : "", builtin_params[i].help);
+	for (param = reconfig_params; param && len < reply_size; param = param->next)
+		len += snprintf(reply + len, reply_size - len, "%s%s: %s\n", param->name, (param->per_channel) ? " <channel>|all" : "", param->help);
+}
+
+static int set_param(char *args, char *reply, size_t reply_size)
+{
+	reconfig_param_t *param;
+	sender_t *sender;
+	char *name, *kanal = NULL, *value;
+	int count = 0, rc;
+
+	name = strsep(&args, " \t");
+	param = (name) ? find_param(name) : NULL;
+	if (!param) {
+		snprintf(reply, reply_size, "Unknown parameter '%s', use 'params' to list them.\n", (name) ? : "");
+		return -EINVAL;
+	}
+	if (param->per_channel)
+		kanal = strsep(&args, " \t");
+	value = args;
+	if (!value || !value[0] || (param->per_channel && !kanal[0])) {
+		snprintf(reply, reply_size, "Missing %svalue of parameter '%s'.\n", (param->per_channel) ? "channel or " : "", param->name);
+		return -EINVAL;
+	}
+
+	if (!param->per_channel) {
+		rc = param->set(NULL, value);
+		goto done;
+	}
+
+	rc = 0;
+	for (sender = sender_head; sender; sender = sender->next) {
+		if (strcasecmp(kanal, "all") && strcmp(kanal, sender->kanal))
+			continue;
+		rc = param->set(sender, value);
+		if (rc < 0)
+			break;
+		count++;
+	}
+	if (!count && rc == 0) {
+		snprintf(reply, reply_size, "Channel '%s' does not exist.\n", kanal);
+		return -EINVAL;
+	}
+
+done:
+	if (rc < 0) {
+		snprintf(reply, reply_size, "Value '%s' of parameter '%s' cannot be set.\n", value, param->name);
+		return rc;
+	}
+	LOGP(DSENDER, LOGL_NOTICE, "Parameter '%s'%s%s set to '%s' via control socket.\n", param->name, (kanal) ? " of channel " : "", (kanal) ? : "", value);
+	snprintf(reply, reply_size, "OK\n");
+	return 0;
+}
+
+static int set_channel(char *args, char *reply, size_t reply_size)
+{
+	sender_t *sender;
+	char *kanal, *state;
+	int off;
+
+	kanal = strsep(&args, " \t");
+	state = args;
+	if (!kanal || !state || (strcasecmp(state, "off") && strcasecmp(state, "on"))) {
+		snprintf(reply, reply_size, "Use 'channel <channel> off|on'.\n");
+		return -EINVAL;
+	}
+	sender = get_sender_by_kanal(kanal);
+	if (!sender) {
+		snprintf(reply, reply_size, "Channel '%s' does not exist.\n", kanal);
+		return -EINVAL;
+	}
+	off = !strcasecmp(state, "off");
+	if (sender->disabled != off) {
+		sender->disabled = off;
+		LOGP(DSENDER, LOGL_NOTICE, "Channel %s is %s air.\n", sender->kanal, (off) ? "taken off" : "back on");
+	}
+	snprintf(reply, reply_size, "OK\n");
+	return 0;
+}
+
+/* returns 0, if the line is not a command, so it is handled as key strokes */
+int reconfig_command(const char *line, char *reply, size_t reply_size)
+{
+	char buffer[256], *args, *cmd;
+
+	strncpy(buffer, line, sizeof(buffer) - 1);
+	buffer[sizeof(buffer) - 1] = '\0';
+	args = buffer;
+	cmd = strsep(&args, " \t");
+
+	reply[0] = '\0';
+	if (!strcasecmp(cmd, "params") && !args) {
+		list_params(reply, reply_size);
+		return 1;
+	}
+	if (!strcasecmp(cmd, "set") && args) {
+		set_param(args, reply, reply_size);
+		return 1;
+	}
+	if (!strcasecmp(cmd, "channel") && args) {
+		set_channel(args, reply, reply_size);
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,14 @@
+
+/* parameter that can be changed at run time via control socket */
+typedef struct reconfig_param {
+	struct reconfig_param	*next;
+	const char		*name;
+	const char		*help;
+	int			per_channel;	/* value is set for one or all channels */
+	int			(*set)(sender_t *sender, const char *value); /* sender is NULL, if not per channel */
+} reconfig_param_t;
+
+void reconfig_add(const char *name, int per_channel, int (*set)(sender_t *sender, const char *value), const char *help);
+void reconfig_exit(void);
+int reconfig_command(const char *line, char *reply, size_t reply_size);
+
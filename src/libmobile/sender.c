@@ -24,29 +24,433 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include "../libsample/sample.h"
+#include "../libsample/memacct.h"
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 #include "sender.h"
+#include "overload.h"
 #include <osmocom/core/timer.h>
 #ifdef HAVE_SDR
 #include "../libsdr/sdr_config.h"
 #endif
 
-/* debug time consumption of audio processing */
-//#define DEBUG_TIME_CONSUMPTION
-
 sender_t *sender_head = NULL;
 static sender_t **sender_tailp = &sender_head;
+
+/* index of senders by receive frequency and by channel name */
+#define SENDER_HASH_SIZE	256	/* must be power of 2 */
+static sender_t *hash_freq[SENDER_HASH_SIZE];
+static sender_t *hash_kanal[SENDER_HASH_SIZE];
+
+static unsigned int hash_frequency(double freq)
+{
+	uint64_t x;
+
+	/* -0.0 equals 0.0 */
+	if (freq == 0.0)
+		freq = 0.0;
+	memcpy(&x, &freq, sizeof(x));
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	return x & (SENDER_HASH_SIZE - 1);
+}
+
+static unsigned int hash_string(const char *s)
+{
+	uint32_t h = 2166136261u;
+
+	while (*s) {
+		h ^= (uint8_t)*s++;
+		h *= 16777619u;
+	}
+	return h & (SENDER_HASH_SIZE - 1);
+}
+
+/* append to buckets, so the first sender of equal keys is found first, as with the list */
+static void sender_hash_add(sender_t *sender)
+{
+	sender_t **sp;
+
+	sender->hash_freq_next = NULL;
+	for (sp = &hash_freq[hash_frequency(sender->empfangsfrequenz)]; *sp; sp = &(*sp)->hash_freq_next);
+	*sp = sender;
+	sender->hash_kanal_next = NULL;
+	for (sp = &hash_kanal[hash_string(sender->kanal)]; *sp; sp = &(*sp)->hash_kanal_next);
+	*sp = sender;
+}
+
+static void sender_hash_remove(sender_t *sender)
+{
+	sender_t **sp;
+
+	for (sp = &hash_freq[hash_frequency(sender->empfangsfrequenz)]; *sp; sp = &(*sp)->hash_freq_next) {
+		if (*sp == sender) {
+			*sp = sender->hash_freq_next;
+			break;
+		}
+	}
+	if (!sender->kanal)
+		return;
+	for (sp = &hash_kanal[hash_string(sender->kanal)]; *sp; sp = &(*sp)->hash_kanal_next) {
+		if (*sp == sender) {
+			*sp = sender->hash_kanal_next;
+			break;
+		}
+	}
+}
 int cant_recover = 0;
 int check_channel = 1;
 
+/* If audio of each master is processed by a worker thread, the protocol of
+ * each channel, call control, timers and display stay on the main thread.
+ * Timers of libosmocore belong to the thread that schedules them, so no
+ * protocol code must run on a worker. Audio device access, wave files,
+ * clock drift, emphasis and gain run on the worker. The protocol part of each
+ * period is handed to the main thread through a queue. The worker waits
+ * until it has been processed, because it needs the TX samples of the
+ * protocol and must not touch the channel while the protocol does.
+ */
+int sender_threaded = 0;
+
+struct sender_job {
+	struct sender_job	*next;
+	void			(*func)(void *priv);
+	void			*priv;
+	int			done;
+};
+
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static struct sender_job *queue_head = NULL, **queue_tailp = &queue_head;
+static int queue_stopped = 0;
+int sender_queue_fd = -1;
+
+/* create the event that wakes up the main thread, before workers are started */
+int sender_queue_open(void)
+{
+	sender_queue_fd = eventfd(0, EFD_NONBLOCK);
+	if (sender_queue_fd < 0) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create event for worker queue (errno = %d)!\n", errno);
+		return -errno;
+	}
+	queue_stopped = 0;
+
+	return 0;
+}
+
+/* workers return without protocol processing from now on, before workers are joined */
+void sender_queue_stop(void)
+{
+	pthread_mutex_lock(&queue_mutex);
+	queue_stopped = 1;
+	queue_head = NULL;
+	queue_tailp = &queue_head;
+	pthread_cond_broadcast(&queue_cond);
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+void sender_queue_close(void)
+{
+	if (sender_queue_fd >= 0) {
+		close(sender_queue_fd);
+		sender_queue_fd = -1;
+	}
+}
+
+/* run protocol function on the main thread and wait until it is done */
+static void sender_queue_run(void (*func)(void *priv), void *priv)
+{
+	struct sender_job job = { .func = func, .priv = priv };
+	uint64_t one = 1;
+
+	if (!sender_threaded) {
+		func(priv);
+		return;
+	}
+
+	pthread_mutex_lock(&queue_mutex);
+	if (queue_stopped) {
+		pthread_mutex_unlock(&queue_mutex);
+		return;
+	}
+	*queue_tailp = &job;
+	queue_tailp = &job.next;
+	if (write(sender_queue_fd, &one, sizeof(one)) < 0)
+		LOGP(DSENDER, LOGL_ERROR, "Failed to wake up main thread (errno = %d)!\n", errno);
+	while (!job.done && !queue_stopped)
+		pthread_cond_wait(&queue_cond, &queue_mutex);
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+/* process queued protocol functions, called by the main thread when the event fires */
+void sender_queue_process(void)
+{
+	struct sender_job *job;
+	uint64_t count;
+
+	if (read(sender_queue_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		LOGP(DSENDER, LOGL_ERROR, "Failed to read worker event (errno = %d)!\n", errno);
+
+	pthread_mutex_lock(&queue_mutex);
+	while ((job = queue_head)) {
+		queue_head = job->next;
+		if (!queue_head)
+			queue_tailp = &queue_head;
+		/* the worker waits, so its buffers do not change */
+		pthread_mutex_unlock(&queue_mutex);
+		job->func(job->priv);
+		pthread_mutex_lock(&queue_mutex);
+		job->done = 1;
+	}
+	pthread_cond_broadcast(&queue_cond);
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+/* If channel workers are used, each channel of an audio device, except the
+ * first one, gets its own worker thread for conditioning and DSP of audio.
+ * The first channel is processed by the thread that handles the audio
+ * device. For each DSP block, all workers are started and the block is not
+ * finished until all channels have been processed (barrier). Protocol
+ * processing is never done by channel workers, so the result is the same as
+ * without them.
+ */
+enum chan_job {
+	CHAN_JOB_TX,		/* condition audio towards radio */
+	CHAN_JOB_RX,		/* condition audio from radio and do DSP */
+	CHAN_JOB_QUIT,
+};
+
+struct chan_worker {
+	struct sender_pool	*pool;
+	sender_t		*inst;
+	int			index;		/* index of channel at audio device */
+	pthread_t		tid;
+};
+
+struct sender_pool {
+	pthread_mutex_t		mutex;
+	pthread_cond_t		start_cond, done_cond;
+	unsigned int		seq;		/* incremented for each job */
+	int			pending;	/* workers that did not finish the job */
+	int			num_worker;	/* workers that are running */
+	struct chan_worker	*worker;
+	enum chan_job		job;
+	sample_t		**samples;
+	int			count;
+};
+
+static void stage_pre_emphasis(void *priv, sample_t *samples, int count, double gain)
+{
+	sender_t *inst = priv;
+
+	pre_emphasis_gain(&inst->estate, samples, count, 1, gain);
+}
+
+static void stage_de_emphasis(void *priv, sample_t *samples, int count, double gain)
+{
+	sender_t *inst = priv;
+
+	de_emphasis_gain(&inst->estate, samples, count, 1, gain);
+}
+
+static void stage_dsp_receive(void *priv, sample_t *samples, int count, double __attribute__((unused)) gain)
+{
+	sender_t *inst = priv;
+
+	inst->dsp_receive(inst, samples, count);
+}
+
+/* build graphs of conditioning stages, protocol stages are added by dsp_receive */
+static int chan_build_graphs(sender_t *inst, int samplerate)
+{
+	int rc = 0;
+
+	/* pre emphasis towards radio, tx gain and normal level to frequency deviation of speech level */
+	dsp_graph_init(&inst->tx_graph, "TX", samplerate);
+	if (inst->pre_emphasis)
+		rc |= dsp_graph_add(&inst->tx_graph, "pre-emphasis", DSP_STAGE_ELEMENTWISE, samplerate, 0, 1, stage_pre_emphasis, inst);
+	rc |= dsp_graph_add_gain(&inst->tx_graph, "tx gain", inst->tx_gain);
+	rc |= dsp_graph_add_gain(&inst->tx_graph, "deviation", inst->speech_deviation);
+	dsp_graph_build(&inst->tx_graph);
+
+	/* frequency deviation of speech level to normal level, rx gain, do filter and de-emphasis from radio receive audio */
+	dsp_graph_init(&inst->rx_graph, "RX", samplerate);
+	rc |= dsp_graph_add_gain(&inst->rx_graph, "deviation", 1.0 / inst->speech_deviation);
+	rc |= dsp_graph_add_gain(&inst->rx_graph, "rx gain", inst->rx_gain);
+	if (inst->de_emphasis)
+		rc |= dsp_graph_add(&inst->rx_graph, "de-emphasis", DSP_STAGE_ELEMENTWISE, samplerate, 0, 1, stage_de_emphasis, inst);
+	/* in internal loopback, TX audio is received instead */
+	if (inst->dsp_receive && inst->loopback != 1)
+		rc |= dsp_graph_add(&inst->rx_graph, "receive", DSP_STAGE_BLOCK, samplerate, 0, 0, stage_dsp_receive, inst);
+	dsp_graph_build(&inst->rx_graph);
+
+	return (rc) ? -EINVAL : 0;
+}
+
+static void chan_process(sender_t *inst, enum chan_job job, sample_t *samples, int count)
+{
+	double t1, t2;
+
+	t1 = display_profile_time();
+	if (job == CHAN_JOB_TX)
+		dsp_graph_process(&inst->tx_graph, samples, count);
+	else if (!inst->rx_gated) /* idle channels got silence without demodulation */
+		dsp_graph_process(&inst->rx_graph, samples, count);
+	t2 = display_profile_time();
+	display_profile_update(&inst->dispprof, DISPLAY_PROFILE_CONDITION, t2 - t1);
+}
+
+static void *chan_worker_thread(void *arg)
+{
+	struct chan_worker *worker = arg;
+	struct sender_pool *pool = worker->pool;
+	unsigned int seq = 0;
+	enum chan_job job;
+
+	thread_prio_apply(THREAD_WORKER);
+
+	while (1) {
+		pthread_mutex_lock(&pool->mutex);
+		while (pool->seq == seq)
+			pthread_cond_wait(&pool->start_cond, &pool->mutex);
+		seq = pool->seq;
+		job = pool->job;
+		pthread_mutex_unlock(&pool->mutex);
+		if (job == CHAN_JOB_QUIT)
+			break;
+
+		chan_process(worker->inst, job, pool->samples[worker->index], pool->count);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->pending == 0)
+			pthread_cond_signal(&pool->done_cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return NULL;
+}
+
+/* process all channels of audio device, in parallel if there are workers */
+static void chan_process_all(sender_t *sender, enum chan_job job, sample_t **samples, int count)
+{
+	struct sender_pool *pool = sender->pool;
+	sender_t *inst;
+	int i;
+
+	if (!pool) {
+		for (i = 0, inst = sender; inst; i++, inst = inst->slave)
+			chan_process(inst, job, samples[i], count);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->job = job;
+	pool->samples = samples;
+	pool->count = count;
+	pool->pending = pool->num_worker;
+	pool->seq++;
+	pthread_cond_broadcast(&pool->start_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	chan_process(sender, job, samples[0], count);
+
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->pending)
+		pthread_cond_wait(&pool->done_cond, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/* start worker for each slave channel of given audio master */
+int sender_pool_start(sender_t *master)
+{
+	struct sender_pool *pool;
+	sender_t *inst;
+	int rc;
+
+	if (!master->slave || master->pool)
+		return 0;
+
+	pool = calloc(1, sizeof(*pool));
+	if (pool)
+		pool->worker = calloc(master->num_chan, sizeof(*pool->worker));
+	if (!pool || !pool->worker) {
+		LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+		free(pool);
+		return -ENOMEM;
+	}
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+	master->pool = pool;
+
+	for (inst = master->slave; inst; inst = inst->slave) {
+		struct chan_worker *worker = &pool->worker[pool->num_worker];
+
+		worker->pool = pool;
+		worker->inst = inst;
+		worker->index = pool->num_worker + 1;
+		rc = pthread_create(&worker->tid, NULL, chan_worker_thread, worker);
+		if (rc) {
+			LOGP(DSENDER, LOGL_ERROR, "Failed to create worker thread for channel %s (rc = %d)!\n", inst->kanal, rc);
+			sender_pool_stop(master);
+			return -rc;
+		}
+		pool->num_worker++;
+	}
+
+	return 0;
+}
+
+void sender_pool_stop(sender_t *master)
+{
+	struct sender_pool *pool = master->pool;
+	int i;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->job = CHAN_JOB_QUIT;
+	pool->seq++;
+	pthread_cond_broadcast(&pool->start_cond);
+	pthread_mutex_unlock(&pool->mutex);
+	for (i = 0; i < pool->num_worker; i++)
+		pthread_join(pool->worker[i].tid, NULL);
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->start_cond);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool->worker);
+	free(pool);
+	master->pool = NULL;
+}
+
 /* Init transceiver instance and link to list of transceivers. */
 int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, double empfangsfrequenz, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback, enum paging_signal paging_signal)
 {
 	sender_t *master, *slave;
 	int rc = 0;
+#ifdef HAVE_SDR
+	char sdr_device[16];
+
+	/* with multiple SDR devices, transceivers are grouped by the device that covers their frequency */
+	if (use_sdr && sdr_config->devices > 1) {
+		rc = sdr_assign_device(sendefrequenz, (loopback) ? sendefrequenz : empfangsfrequenz, samplerate);
+		if (rc < 0)
+			return rc;
+		snprintf(sdr_device, sizeof(sdr_device), "sdr%d", rc);
+		device = sdr_device;
+		rc = 0;
+	}
+#endif
 
 	sender->kanal = kanal;
+	memacct_add(MEMACCT_SENDER, kanal, sizeof(*sender));
 	sender->sendefrequenz = sendefrequenz;
 	sender->empfangsfrequenz = (loopback) ? sendefrequenz : empfangsfrequenz;
 	strncpy(sender->device, device, sizeof(sender->device) - 1);
@@ -56,6 +460,7 @@ int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, dou
 	sender->pre_emphasis = pre_emphasis;
 	sender->de_emphasis = de_emphasis;
 	sender->loopback = loopback;
+	sender->use_sdr = use_sdr;
 	sender->paging_signal = paging_signal;
 	sender->write_rx_wave = write_rx_wave;
 	sender->write_tx_wave = write_tx_wave;
@@ -81,12 +486,12 @@ int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, dou
 	 * receive and send audio via second channel of the device
 	 * of the master channel.
 	 */
+	if (get_sender_by_kanal(kanal)) {
+		LOGP(DSENDER, LOGL_ERROR, "Channel %s may not be defined for multiple transceivers!\n", kanal);
+		rc = -EIO;
+		goto error;
+	}
 	for (master = sender_head; master; master = master->next) {
-		if (!strcmp(master->kanal, kanal)) {
-			LOGP(DSENDER, LOGL_ERROR, "Channel %s may not be defined for multiple transceivers!\n", kanal);
-			rc = -EIO;
-			goto error;
-		}
 		if (check_channel && abs(atoi(master->kanal) - atoi(kanal)) == 1) {
 			LOGP(DSENDER, LOGL_NOTICE, "------------------------------------------------------------------------\n");
 			LOGP(DSENDER, LOGL_NOTICE, "NOTE: Channel %s is next to channel %s. This will cause interferences.\n", kanal, master->kanal);
@@ -125,16 +530,44 @@ int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, dou
 			sender->audio_read = sdr_read;
 			sender->audio_write = sdr_write;
 			sender->audio_get_tosend = sdr_get_tosend;
+			sender->audio_annotate = sdr_annotate;
 		} else
 #endif
 		{
 #ifdef HAVE_ALSA
-			sender->audio_open = sound_open;
-			sender->audio_start = sound_start;
-			sender->audio_close = sound_close;
-			sender->audio_read = sound_read;
-			sender->audio_write = sound_write;
-			sender->audio_get_tosend = sound_get_tosend;
+#ifdef HAVE_JACK
+			/* client of JACK or PipeWire server */
+			if (!strcmp(device, "jack") || !strncmp(device, "jack:", 5)) {
+				sender->audio_open = sound_jack_open;
+				sender->audio_start = sound_jack_start;
+				sender->audio_close = sound_jack_close;
+				sender->audio_read = sound_jack_read;
+				sender->audio_write = sound_jack_write;
+				sender->audio_get_tosend = sound_jack_get_tosend;
+				sender->audio_get_poll = sound_jack_get_poll;
+				sender->audio_poll_ready = sound_jack_poll_ready;
+			} else
+#endif
+			/* several sound cards, operated as one device */
+			if (strchr(device, '+')) {
+				sender->audio_open = sound_aggregate_open;
+				sender->audio_start = sound_aggregate_start;
+				sender->audio_close = sound_aggregate_close;
+				sender->audio_read = sound_aggregate_read;
+				sender->audio_write = sound_aggregate_write;
+				sender->audio_get_tosend = sound_aggregate_get_tosend;
+				sender->audio_get_poll = sound_aggregate_get_poll;
+				sender->audio_poll_ready = sound_aggregate_poll_ready;
+			} else {
+				sender->audio_open = sound_open;
+				sender->audio_start = sound_start;
+				sender->audio_close = sound_close;
+				sender->audio_read = sound_read;
+				sender->audio_write = sound_write;
+				sender->audio_get_tosend = sound_get_tosend;
+				sender->audio_get_poll = sound_get_poll;
+				sender->audio_poll_ready = sound_poll_ready;
+			}
 #else
 			LOGP(DSENDER, LOGL_ERROR, "No sound card support compiled in!\n");
 			rc = -ENOTSUP;
@@ -143,13 +576,13 @@ int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, dou
 		}
 	}
 
-	rc = init_samplerate(&sender->srstate, 8000.0, (double)samplerate, 3400.0);
+	rc = init_samplerate(&sender->srstate, 8000.0, (double)samplerate, 3400.0, SAMPLERATE_LINEAR);
 	if (rc < 0) {
 		LOGP(DSENDER, LOGL_ERROR, "Failed to init sample rate conversion!\n");
 		goto error;
 	}
 
-	rc = jitter_create(&sender->dejitter, sender->kanal, 8000, JITTER_AUDIO);
+	rc = jitter_create(&sender->dejitter, sender->kanal, 8000, JITTER_AUDIO_ADAPTIVE);
 	if (rc < 0) {
 		LOGP(DSENDER, LOGL_ERROR, "Failed to create and init audio buffer!\n");
 		goto error;
@@ -167,9 +600,11 @@ int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, dou
 
 	*sender_tailp = sender;
 	sender_tailp = &sender->next;
+	sender_hash_add(sender);
 
 	display_wave_init(&sender->dispwav, samplerate, sender->kanal);
 	display_measurements_init(&sender->dispmeas, samplerate, sender->kanal);
+	display_profile_init(&sender->dispprof, sender->kanal);
 
 	return 0;
 error:
@@ -195,6 +630,16 @@ int sender_open_audio(int buffer_size, double interval)
 		for (inst = master; inst; inst = inst->slave) {
 			channels++;
 		}
+		master->num_chan = channels;
+		/* tables and sample buffers of all channels */
+		arena_init(&master->arena, MEMACCT_BUFFERS, master->kanal, (size_t)channels * buffer_size * (sizeof(sample_t) + 1) + 4096);
+		master->chan_paging_signal = arena_alloc(&master->arena, channels, sizeof(*master->chan_paging_signal));
+		master->chan_paging_on = arena_alloc(&master->arena, channels, sizeof(*master->chan_paging_on));
+		master->chan_rf_level_db = arena_alloc(&master->arena, channels, sizeof(*master->chan_rf_level_db));
+		if (!master->chan_paging_signal || !master->chan_paging_on || !master->chan_rf_level_db) {
+			LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+			return -ENOMEM;
+		}
 		double tx_f[channels], rx_f[channels], paging_frequency = 0.0;
 		int am[channels];
 		for (i = 0, inst = master; inst; i++, inst = inst->slave) {
@@ -206,34 +651,76 @@ int sender_open_audio(int buffer_size, double interval)
 		}
 
 		if (master->write_rx_wave) {
-			rc = wave_create_record(&master->wave_rx_rec, master->write_rx_wave, master->samplerate, channels, (master->max_deviation) ?: 1.0);
+			rc = wave_create_record(&master->wave_rx_rec, master->write_rx_wave, master->samplerate, channels, (master->max_deviation) ?: 1.0, 0);
 			if (rc < 0) {
 				LOGP(DSENDER, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 				return rc;
 			}
 		}
 		if (master->write_tx_wave) {
-			rc = wave_create_record(&master->wave_tx_rec, master->write_tx_wave, master->samplerate, channels, (master->max_deviation) ?: 1.0);
+			rc = wave_create_record(&master->wave_tx_rec, master->write_tx_wave, master->samplerate, channels, (master->max_deviation) ?: 1.0, 0);
 			if (rc < 0) {
 				LOGP(DSENDER, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 				return rc;
 			}
 		}
 		if (master->read_rx_wave) {
-			rc = wave_create_playback(&master->wave_rx_play, master->read_rx_wave, &master->samplerate, &channels, (master->max_deviation) ?: 1.0);
+			rc = wave_create_playback(&master->wave_rx_play, master->read_rx_wave, &master->samplerate, &channels, (master->max_deviation) ?: 1.0, WAVE_FLAG_WINDOW);
 			if (rc < 0) {
 				LOGP(DSENDER, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 				return rc;
 			}
 		}
 		if (master->read_tx_wave) {
-			rc = wave_create_playback(&master->wave_tx_play, master->read_tx_wave, &master->samplerate, &channels, (master->max_deviation) ?: 1.0);
+			rc = wave_create_playback(&master->wave_tx_play, master->read_tx_wave, &master->samplerate, &channels, (master->max_deviation) ?: 1.0, 0);
 			if (rc < 0) {
 				LOGP(DSENDER, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 				return rc;
 			}
 		}
 
+		/* detectors of latency probe, at the rate of the audio device */
+		if (latency_probe) {
+			for (inst = master; inst; inst = inst->slave) {
+				latency_det_init(&inst->latency_tx, master->samplerate);
+				latency_det_init(&inst->latency_rx, master->samplerate);
+			}
+		}
+
+		autotune_init(&master->autotune, master->samplerate, buffer_size, interval);
+
+		/* buffers at nominal rate, they hold the samples before or after fine resampling */
+		if (clock_drift) {
+			char name[64];
+
+			snprintf(name, sizeof(name), "transceiver '%s' RX", master->kanal);
+			clockdrift_init(&master->drift_rx, name, master->samplerate);
+			snprintf(name, sizeof(name), "transceiver '%s' TX", master->kanal);
+			clockdrift_init(&master->drift_tx, name, master->samplerate);
+			master->drift_size = buffer_size + buffer_size / 500 + 4;
+			master->drift_samples = arena_alloc(&master->arena, channels, sizeof(*master->drift_samples));
+			master->drift_powers = arena_alloc(&master->arena, channels, sizeof(*master->drift_powers));
+			if (!master->drift_samples || !master->drift_powers) {
+				LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+				return -ENOMEM;
+			}
+			for (i = 0, inst = master; inst; i++, inst = inst->slave) {
+				master->drift_samples[i] = arena_alloc(&master->arena, master->drift_size, sizeof(**master->drift_samples));
+				master->drift_powers[i] = arena_alloc(&master->arena, master->drift_size, sizeof(**master->drift_powers));
+				if (!master->drift_samples[i] || !master->drift_powers[i]) {
+					LOGP(DSENDER, LOGL_ERROR, "No mem!\n");
+					return -ENOMEM;
+				}
+				clockdrift_rs_init(&inst->drift_rs_rx);
+				clockdrift_rs_init(&inst->drift_rs_tx);
+			}
+		}
+		for (inst = master; inst; inst = inst->slave) {
+			rc = chan_build_graphs(inst, master->samplerate);
+			if (rc < 0)
+				return rc;
+		}
+
 		/* open device */
 		master->audio = master->audio_open(SOUND_DIR_DUPLEX, master->device, tx_f, rx_f, am, channels, paging_frequency, master->samplerate, buffer_size, interval, (master->max_deviation) ?: 1.0, master->max_modulation, master->modulation_index);
 		if (!master->audio) {
@@ -277,9 +764,10 @@ void sender_destroy(sender_t *sender)
 
 	sender_tailp = &sender_head;
 	while (*sender_tailp) {
-		if (sender == *sender_tailp)
+		if (sender == *sender_tailp) {
 			*sender_tailp = (*sender_tailp)->next;
-		else
+			sender_hash_remove(sender);
+		} else
 			sender_tailp = &((*sender_tailp)->next);
 	}
 
@@ -295,6 +783,29 @@ void sender_destroy(sender_t *sender)
 
 	jitter_destroy(&sender->dejitter);
 	jitter_destroy(&sender->loop_dejitter);
+
+	display_wave_exit(&sender->dispwav);
+
+	sender_pool_stop(sender);
+	sender->chan_paging_signal = NULL;
+	sender->chan_paging_on = NULL;
+	sender->chan_rf_level_db = NULL;
+	sender->drift_samples = NULL;
+	sender->drift_powers = NULL;
+	arena_free(&sender->arena);
+
+	display_profile_exit(&sender->dispprof);
+
+	memacct_add(MEMACCT_DSP, sender->kanal, -sender->dsp_bytes);
+	sender->dsp_bytes = 0;
+	memacct_add(MEMACCT_SENDER, sender->kanal, -(ssize_t)sizeof(*sender));
+}
+
+/* Account state and buffers that the network allocates for its DSP. */
+void sender_account_dsp(sender_t *sender, ssize_t bytes)
+{
+	sender->dsp_bytes += bytes;
+	memacct_add(MEMACCT_DSP, sender->kanal, bytes);
 }
 
 /* set frequency modulation and parameters */
@@ -322,34 +833,111 @@ void sender_set_am(sender_t *sender, double max_modulation, double speech_level,
 	LOGP_CHAN(DSENDER, LOGL_DEBUG, "Modulation degree: %.0f %%, Maximum modulation: %.1f kHz\n", modulation_index / 100.0, max_modulation / 1000.0);
 }
 
-static void gain_samples(sample_t *samples, int length, double gain)
+/* samples of one period of all channels of an audio master, for the protocol */
+struct protocol_job {
+	sender_t	*sender;
+	sample_t	**samples;
+	uint8_t		**power;
+	int		count;
+	double		delay;		/* time until TX samples are transmitted */
+};
+
+/* load TX samples from the protocol of all channels */
+static void protocol_tx(void *priv)
 {
+	struct protocol_job *job = priv;
+	sender_t *sender = job->sender, *inst;
+	sample_t **samples = job->samples;
+	uint8_t **power = job->power;
+	int count = job->count;
+	double t1, t2;
 	int i;
 
-	for (i = 0; i < length; i++)
-		*samples++ *= gain;
+	for (i = 0, inst = sender; inst; i++, inst = inst->slave) {
+		t1 = display_profile_time();
+		/* gains changed via control socket, graphs are not in use now */
+		if (inst->reconfigure) {
+			inst->reconfigure = 0;
+			chan_build_graphs(inst, sender->samplerate);
+		}
+		/* load TX data from audio loop or from sender instance, transmitter is off if channel is off air */
+		if (inst->disabled) {
+			memset(samples[i], 0, count * sizeof(*(samples[i])));
+			memset(power[i], 0, count);
+		} else if (inst->loopback == 3)
+			jitter_load_samples(&inst->loop_dejitter, (uint8_t *)samples[i], count, sizeof(*(samples[i])), NULL, NULL);
+		else
+			inst->send(inst, samples[i], power[i], count);
+		if (latency_probe)
+			latency_probe_tx(&inst->latency_tx, samples[i], count, job->delay);
+		/* internal loopback: loop back TX audio to RX */
+		if (inst->loopback == 1 && !inst->disabled) {
+			display_wave(&inst->dispwav, samples[i], count, inst->max_display);
+			inst->receive(inst, samples[i], count, 0.0);
+		}
+		/* set paging signal */
+		sender->chan_paging_signal[i] = inst->paging_signal;
+		sender->chan_paging_on[i] = inst->paging_on;
+		t2 = display_profile_time();
+		display_profile_update(&inst->dispprof, DISPLAY_PROFILE_SEND, t2 - t1);
+	}
+}
+
+/* forward RX samples to the protocol of all channels */
+static void protocol_rx(void *priv)
+{
+	struct protocol_job *job = priv;
+	sender_t *sender = job->sender, *inst;
+	sample_t **samples = job->samples;
+	int count = job->count;
+	double t1, t2;
+	int i;
+
+	for (i = 0, inst = sender; inst; i++, inst = inst->slave) {
+		t1 = display_profile_time();
+		if (latency_probe)
+			latency_probe_rx(&inst->latency_rx, samples[i], count);
+		if (inst->loopback != 1 && !inst->disabled) {
+			display_wave(&inst->dispwav, samples[i], count, inst->max_display);
+			inst->receive(inst, samples[i], count, sender->chan_rf_level_db[i]);
+		}
+		if (inst->loopback == 3) {
+			jitter_frame_t *jf;
+			jf = jitter_frame_alloc(&inst->loop_dejitter, NULL, NULL, (uint8_t *)samples[i], count * sizeof(*(samples[i])), 0, inst->loop_sequence, inst->loop_timestamp, 123);
+			if (jf)
+				jitter_save(&inst->loop_dejitter, jf);
+			inst->loop_sequence += 1;
+			inst->loop_timestamp += count;
+		}
+		t2 = display_profile_time();
+		display_profile_update(&inst->dispprof, DISPLAY_PROFILE_RECEIVE, t2 - t1);
+	}
 }
 
 /* Handle audio streaming of one transceiver. */
 void process_sender_audio(sender_t *sender, int *quit, sample_t **samples, uint8_t **power, int buffer_size)
 {
 	sender_t *inst;
-	int rc, count;
-	int num_chan, i;
-#ifdef DEBUG_TIME_CONSUMPTION
-	static double t1, t2, t3, t4, t5, d1 = 0, d2 = 0, d3 = 0, d4 = 0, s = 0;
-#endif
+	int rc, count, target, nominal;
+	int i;
+	double t1, t2, t_start, step;
+	enum paging_signal *paging_signal = sender->chan_paging_signal;
+	int *on = sender->chan_paging_on;
+	double *rf_level_db = sender->chan_rf_level_db;
+	sample_t **nominal_samples = samples;
+	uint8_t **nominal_power = power;
+	struct protocol_job job;
 
-	/* count instances for audio channel */
-	for (num_chan = 0, inst = sender; inst; num_chan++, inst = inst->slave);
-	enum paging_signal paging_signal[num_chan];
-	int on[num_chan];
-	double rf_level_db[num_chan];
+	/* evaluate profile of last interval */
+	t_start = t1 = display_profile_time();
+	for (inst = sender; inst; inst = inst->slave)
+		display_profile_tick(&inst->dispprof, t1);
 
-#ifdef DEBUG_TIME_CONSUMPTION
-	t1 = get_time();
-#endif
-	count = sender->audio_get_tosend(sender->audio, buffer_size);
+	/* how far TX is processed in advance, lowered by auto-tuning */
+	target = (autotune_margin) ? sender->autotune.target : buffer_size;
+	count = sender->audio_get_tosend(sender->audio, target);
+	t2 = display_profile_time();
+	display_profile_update(&sender->dispprof, DISPLAY_PROFILE_GET_TOSEND, t2 - t1);
 	if (count < 0) {
 		LOGP_CHAN(DSENDER, LOGL_ERROR, "Failed to get number of samples in buffer (rc = %d)!\n", count);
 		if (count == -EPIPE) {
@@ -360,65 +948,65 @@ cant_recover:
 				return;
 			}
 			LOGP(DSENDER, LOGL_ERROR, "Trying to recover!\n");
+			overload_event();
+			autotune_underrun(&sender->autotune);
 		}
 		return;
 	}
-#ifdef DEBUG_TIME_CONSUMPTION
-	t2 = get_time();
-#endif
 	if (count > 0) {
 		/* limit to our buffer */
 		if (count > buffer_size)
 			count = buffer_size;
-		/* loop through all channels */
-		for (i = 0, inst = sender; inst; i++, inst = inst->slave) {
-			/* load TX data from audio loop or from sender instance */
-			if (inst->loopback == 3)
-				jitter_load_samples(&inst->loop_dejitter, (uint8_t *)samples[i], count, sizeof(*(samples[i])), NULL, NULL);
-			else
-				sender_send(inst, samples[i], power[i], count);
-			/* internal loopback: loop back TX audio to RX */
-			if (inst->loopback == 1) {
-				display_wave(&inst->dispwav, samples[i], count, inst->max_display);
-				sender_receive(inst, samples[i], count, 0.0);
-			}
-			/* do pre emphasis towards radio */
-			if (inst->pre_emphasis)
-				pre_emphasis(&inst->estate, samples[i], count);
-			/* tx gain */
-			if (inst->tx_gain != 1.0)
-				gain_samples(samples[i], count, inst->tx_gain);
-			/* normal level to frequency deviation of speech level */
-			gain_samples(samples[i], count, inst->speech_deviation);
-			/* set paging signal */
-			paging_signal[i] = inst->paging_signal;
-			on[i] = inst->paging_on;
+		/* samples at nominal rate that are resampled to the device's clock */
+		nominal = count;
+		step = 1.0;
+		if (sender->drift_samples) {
+			clockdrift_update(&sender->drift_tx, (double)sender->tx_samples - (double)(target - count));
+			step = sender->drift_tx.factor;
+			nominal = clockdrift_input_num(&sender->drift_rs_tx, step, count);
+			if (nominal > sender->drift_size)
+				nominal = sender->drift_size;
+			nominal_samples = sender->drift_samples;
+			nominal_power = sender->drift_powers;
+		}
+		/* protocol of all channels */
+		job = (struct protocol_job){ .sender = sender, .samples = nominal_samples, .power = nominal_power, .count = nominal, .delay = (double)(target - count) / (double)sender->samplerate };
+		sender_queue_run(protocol_tx, &job);
+		chan_process_all(sender, CHAN_JOB_TX, nominal_samples, nominal);
+		if (sender->drift_samples) {
+			for (i = 0, inst = sender; inst; i++, inst = inst->slave)
+				clockdrift_resample(&inst->drift_rs_tx, step, nominal_samples[i], nominal_power[i], nominal, samples[i], power[i], count);
+			clockdrift_nominal(&sender->drift_tx, nominal);
 		}
 
-#ifdef DEBUG_TIME_CONSUMPTION
-		t2 = get_time();
-#endif
+		t1 = display_profile_time();
 		if (sender->wave_tx_rec.fp)
 			wave_write(&sender->wave_tx_rec, samples, count);
 		if (sender->wave_tx_play.fp)
 			wave_read(&sender->wave_tx_play, samples, count);
 
-		rc = sender->audio_write(sender->audio, samples, power, count, paging_signal, on, num_chan);
+		rc = sender->audio_write(sender->audio, samples, power, count, paging_signal, on, sender->num_chan);
+		t2 = display_profile_time();
+		display_profile_update(&sender->dispprof, DISPLAY_PROFILE_AUDIO_WRITE, t2 - t1);
 		if (rc < 0) {
 			LOGP(DSENDER, LOGL_ERROR, "Failed to write TX data to audio device (rc = %d)\n", rc);
 			if (rc == -EPIPE) {
 				if (cant_recover)
 					goto cant_recover;
 				LOGP(DSENDER, LOGL_ERROR, "Trying to recover!\n");
+				overload_event();
+				autotune_underrun(&sender->autotune);
 			}
 			return;
 		}
+		sender->tx_samples += count;
+		autotune_cycle(&sender->autotune, (target > count) ? target - count : 0, display_profile_time() - t_start);
 	}
-#ifdef DEBUG_TIME_CONSUMPTION
-	t3 = get_time();
-#endif
 
-	count = sender->audio_read(sender->audio, samples, buffer_size, num_chan, rf_level_db);
+	t1 = display_profile_time();
+	count = sender->audio_read(sender->audio, samples, buffer_size, sender->num_chan, rf_level_db);
+	t2 = display_profile_time();
+	display_profile_update(&sender->dispprof, DISPLAY_PROFILE_AUDIO_READ, t2 - t1);
 	if (count < 0) {
 		/* special case when audio_read wants us to quit */
 		if (count == -EPERM) {
@@ -430,56 +1018,55 @@ cant_recover:
 			if (cant_recover)
 				goto cant_recover;
 			LOGP(DSENDER, LOGL_ERROR, "Trying to recover!\n");
+			overload_event();
 		}
 		return;
 	}
-#ifdef DEBUG_TIME_CONSUMPTION
-	t4 = get_time();
-#endif
 	if (count) {
+		sender->rx_samples += count;
 		if (sender->wave_rx_rec.fp)
 			wave_write(&sender->wave_rx_rec, samples, count);
 		if (sender->wave_rx_play.fp)
 			wave_read(&sender->wave_rx_play, samples, count);
 
-		/* loop through all channels */
-		for (i = 0, inst = sender; inst; i++, inst = inst->slave) {
-			/* frequency deviation of speech level to normal level */
-			gain_samples(samples[i], count, 1.0 / inst->speech_deviation);
-			/* rx gain */
-			if (inst->rx_gain != 1.0)
-				gain_samples(samples[i], count, inst->rx_gain);
-			/* do filter and de-emphasis from radio receive audio, process echo test */
-			if (inst->de_emphasis) {
-				dc_filter(&inst->estate, samples[i], count);
-				de_emphasis(&inst->estate, samples[i], count);
-			}
-			if (inst->loopback != 1) {
-				display_wave(&inst->dispwav, samples[i], count, inst->max_display);
-				sender_receive(inst, samples[i], count, rf_level_db[i]);
-			}
-			if (inst->loopback == 3) {
-				jitter_frame_t *jf;
-				jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)samples[i], count * sizeof(*(samples[i])), 0, inst->loop_sequence, inst->loop_timestamp, 123);
-				if (jf)
-					jitter_save(&inst->loop_dejitter, jf);
-				inst->loop_sequence += 1;
-				inst->loop_timestamp += count;
-			}
+		/* resample from the device's clock to nominal rate */
+		if (sender->drift_samples) {
+			clockdrift_update(&sender->drift_rx, (double)sender->rx_samples);
+			step = 1.0 / sender->drift_rx.factor;
+			for (i = 0, inst = sender; inst; i++, inst = inst->slave)
+				nominal = clockdrift_resample(&inst->drift_rs_rx, step, samples[i], NULL, count, sender->drift_samples[i], NULL, sender->drift_size);
+			clockdrift_nominal(&sender->drift_rx, nominal);
+			nominal_samples = sender->drift_samples;
+			count = nominal;
 		}
+
+		chan_process_all(sender, CHAN_JOB_RX, nominal_samples, count);
+		/* protocol of all channels */
+		job = (struct protocol_job){ .sender = sender, .samples = nominal_samples, .count = count };
+		sender_queue_run(protocol_rx, &job);
 	}
-#ifdef DEBUG_TIME_CONSUMPTION
-	t5 = get_time();
-	d1 += (t2 - t1);
-	d2 += (t3 - t2);
-	d3 += (t4 - t3);
-	d4 += (t5 - t4);
-	if (get_time() - s >= 1.0) {
-		printf("duration: %.3f (process TX), %.3f (send TX), %.3f (receive RX), %.3f (process RX)\n", d1, d2, d3, d4);
-		s = get_time();
-		d1 = d2 = d3 = d4 = 0;
+}
+
+void sender_graph_report(void)
+{
+	sender_t *inst;
+
+	for (inst = sender_head; inst; inst = inst->next) {
+		dsp_graph_report(&inst->tx_graph, inst->kanal);
+		dsp_graph_report(&inst->rx_graph, inst->kanal);
+	}
+}
+
+void sender_drift_report(void)
+{
+	sender_t *inst;
+
+	for (inst = sender_head; inst; inst = inst->next) {
+		if (!inst->drift_samples)
+			continue;
+		clockdrift_report(&inst->drift_rx);
+		clockdrift_report(&inst->drift_tx);
 	}
-#endif
 }
 
 void sender_paging(sender_t *sender, int on)
@@ -487,11 +1074,58 @@ void sender_paging(sender_t *sender, int on)
 	sender->paging_on = on;
 }
 
+/* mark received frame of given duration (seconds) in IQ recording, if any */
+void sender_annotate(sender_t *sender, double duration, const char *label)
+{
+	sender_t *master = (sender->master) ? sender->master : sender;
+
+	if (master->audio && master->audio_annotate)
+		master->audio_annotate(master->audio, sender->empfangsfrequenz, duration, label);
+}
+
+/* count received frame, bit_errors < 0 if the frame could not be decoded */
+void sender_rx_frame(sender_t *sender, int bit_errors)
+{
+	if (bit_errors < 0) {
+		sender->rx_frames_bad++;
+		return;
+	}
+	sender->rx_frames++;
+	sender->rx_bit_errors += bit_errors;
+}
+
+/* load speech from jitter buffer and upsample it into the DSP buffer
+ *
+ * The int16 samples are taken from the decoded frames inside the jitter
+ * buffer and converted while upsampling, so they are not copied first.
+ */
+void sender_load_speech(jitter_t *jb, samplerate_t *srstate, sample_t *samples, int length)
+{
+	int input_num, n, output_num;
+	int16_t *spl;
+
+	input_num = samplerate_upsample_input_num(srstate, length);
+	while (input_num) {
+		n = jitter_get_samples(jb, (uint8_t **)&spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
+		if (!n)
+			break;
+		input_num -= n;
+		/* the last chunk provides all remaining output samples */
+		output_num = (input_num) ? samplerate_upsample_output_num(srstate, n) : length;
+		samplerate_upsample_int16(srstate, spl, n, int16_speech_factor(), samples, output_num);
+		samples += output_num;
+		length -= output_num;
+	}
+	/* jitter buffer failed */
+	if (length)
+		memset(samples, 0, length * sizeof(*samples));
+}
+
 sender_t *get_sender_by_empfangsfrequenz(double freq)
 {
 	sender_t *sender;
 
-	for (sender = sender_head; sender; sender = sender->next) {
+	for (sender = hash_freq[hash_frequency(freq)]; sender; sender = sender->hash_freq_next) {
 		if (sender->empfangsfrequenz == freq)
 			return sender;
 	}
@@ -499,3 +1133,15 @@ sender_t *get_sender_by_empfangsfrequenz(double freq)
 	return NULL;
 }
 
+sender_t *get_sender_by_kanal(const char *kanal)
+{
+	sender_t *sender;
+
+	for (sender = hash_kanal[hash_string(kanal)]; sender; sender = sender->hash_kanal_next) {
+		if (!strcmp(sender->kanal, kanal))
+			return sender;
+	}
+
+	return NULL;
+}
+
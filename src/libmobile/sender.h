@@ -5,12 +5,18 @@
 #include "../libsdr/sdr.h"
 #endif
 #include "../libwave/wave.h"
+#include "../libsample/arena.h"
 #include "../libsamplerate/samplerate.h"
 #include "../libjitter/jitter.h"
 #include "../libemphasis/emphasis.h"
 #include "../libdisplay/display.h"
+#include "latency.h"
+#include "autotune.h"
+#include "clockdrift.h"
+#include "dsp_graph.h"
+#include "chanalloc.h"
 
-#define MAX_SENDER	16
+struct pollfd;
 
 /* how to send a 'paging' signal (trigger transmitter) */
 enum paging_signal {
@@ -26,6 +32,8 @@ typedef struct sender {
 	struct sender		*next;
 	struct sender		*slave;			/* points to 'slave' that uses next channel of audio device */
 	struct sender		*master;		/* if set, the audio device is owned by 'master' */
+	struct sender		*hash_freq_next;	/* next sender in hash bucket of receive frequency */
+	struct sender		*hash_kanal_next;	/* next sender in hash bucket of channel name */
 
 	/* system info */
 	const char		*kanal;			/* channel number */
@@ -50,6 +58,10 @@ typedef struct sender {
 	int			(*audio_write)(void *, sample_t **, uint8_t **, int, enum paging_signal *, int *, int);
 	int			(*audio_read)(void *, sample_t **, int, int, double *);
 	int			(*audio_get_tosend)(void *, int);
+	int			(*audio_get_poll)(void *, struct pollfd *, int);
+	int			(*audio_poll_ready)(void *, struct pollfd *, int);
+	int			audio_polled;		/* audio is processed when the device completes a period */
+	void			(*audio_annotate)(void *, double, double, const char *);
 	int			samplerate;
 	samplerate_t		srstate;		/* sample rate conversion state */
 	double			rx_gain;		/* factor of level to apply on RX samples */
@@ -57,10 +69,67 @@ typedef struct sender {
 	int			pre_emphasis;		/* use pre_emhasis, done by sender */
 	int			de_emphasis;		/* use de_emhasis, done by sender */
 	emphasis_t		estate;			/* pre and de emphasis */
+	int			num_chan;		/* number of channels of audio device (master only) */
+	enum paging_signal	*chan_paging_signal;	/* per channel tables of audio device (master only) */
+	int			*chan_paging_on;
+	double			*chan_rf_level_db;
+	arena_t			arena;			/* DSP buffers of audio device's channels (master only) */
+	uint64_t		rx_samples;		/* samples read from audio device (master only) */
+	struct sender_pool	*pool;			/* channel workers of audio device (master only) */
+	autotune_t		autotune;		/* fill target of TX buffer (master only) */
+	uint64_t		tx_samples;		/* samples written to audio device (master only) */
+	clockdrift_t		drift_rx;		/* clock of audio device (master only) */
+	clockdrift_t		drift_tx;
+	sample_t		**drift_samples;	/* channel buffers at nominal rate (master only) */
+	uint8_t			**drift_powers;
+	int			drift_size;		/* size of these buffers */
+	clockdrift_rs_t		drift_rs_rx;		/* fine resampler of channel */
+	clockdrift_rs_t		drift_rs_tx;
+
+	/* protocol of this channel, set by the protocol when it creates the
+	 * channel, audio processing reaches the protocol only through these
+	 * (a process still hosts channels of one protocol only) */
+	void			(*send)(struct sender *sender, sample_t *samples, uint8_t *power, int count);
+	void			(*receive)(struct sender *sender, sample_t *samples, int count, double rf_level_db);
+
+	/* DSP of received audio that does not touch protocol state or other
+	 * channels, it is called before receive() and may run in
+	 * parallel with other channels of the same audio device */
+	void			(*dsp_receive)(struct sender *sender, sample_t *samples, int count);
+
+	/* stages of audio conditioning towards radio and from radio, including dsp_receive */
+	dsp_graph_t		tx_graph;
+	dsp_graph_t		rx_graph;
 
 	/* loopback test */
 	int			loopback;		/* 0 = off, 1 = internal, 2 = external, 3 = audio loop */
 
+	/* reconfiguration at run time */
+	int			use_sdr;		/* gains are fixed with SDR */
+	int			reconfigure;		/* gains changed, graphs must be rebuilt */
+	int			disabled;		/* channel is taken off air */
+
+	/* allocation of traffic channels */
+	chan_list_t		*alloc_list;		/* list of channels of same type, if channel is allocated by list */
+	int			alloc_index;		/* bit of channel in that list */
+	int			alloc_busy;		/* busy channels of audio device (master only) */
+
+	/* memory accounting */
+	ssize_t			dsp_bytes;		/* memory of the network's DSP state */
+
+	/* activity gate of receiver */
+	int			rx_always_on;		/* never gated, set by protocol (e.g. control channel) */
+	int			rx_gated;		/* channel is idle, received samples are silence (set by audio device) */
+
+	/* decode results, for regression tests */
+	uint64_t		rx_frames;		/* frames decoded */
+	uint64_t		rx_frames_bad;		/* frames that could not be decoded */
+	uint64_t		rx_bit_errors;		/* bit errors corrected in decoded frames */
+
+	/* latency probe */
+	latency_det_t		latency_tx;		/* detector of bursts in TX signal */
+	latency_det_t		latency_rx;		/* detector of bursts in RX signal */
+
 	/* record and playback */
 	const char		*write_rx_wave;		/* file name pointers */
 	const char		*write_tx_wave;
@@ -90,22 +159,38 @@ typedef struct sender {
 
 	/* display measurements */
 	dispmeas_t		dispmeas;		/* display measurements */
+
+	/* profile of processing stages */
+	dispprof_t		dispprof;		/* display profile */
 } sender_t;
 
 extern sender_t *sender_head;
 extern int cant_recover;
 extern int check_channel;
+extern int sender_threaded;
+extern int sender_queue_fd;
 
 int sender_create(sender_t *sender, const char *kanal, double sendefrequenz, double empfangsfrequenz, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback, enum paging_signal paging_signal);
 void sender_destroy(sender_t *sender);
+void sender_account_dsp(sender_t *sender, ssize_t bytes);
 void sender_set_fm(sender_t *sender, double max_deviation, double max_modulation, double speech_deviation, double max_display);
 void sender_set_am(sender_t *sender, double max_modulation, double speech_deviation, double max_display, double modulation_index);
 int sender_open_audio(int buffer_size, double interval);
+void sender_graph_report(void);
+void sender_drift_report(void);
 int sender_start_audio(void);
+int sender_queue_open(void);
+void sender_queue_stop(void);
+void sender_queue_close(void);
+void sender_queue_process(void);
+int sender_pool_start(sender_t *master);
+void sender_pool_stop(sender_t *master);
 void process_sender_audio(sender_t *sender, int *quit, sample_t **samples, uint8_t **power, int buffer_size);
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int count);
-void sender_receive(sender_t *sender, sample_t *samples, int count, double rf_level_db);
 void sender_paging(sender_t *sender, int on);
+void sender_annotate(sender_t *sender, double duration, const char *label);
+void sender_rx_frame(sender_t *sender, int bit_errors);
+void sender_load_speech(jitter_t *jb, samplerate_t *srstate, sample_t *samples, int length);
 sender_t *get_sender_by_empfangsfrequenz(double freq);
+sender_t *get_sender_by_kanal(const char *kanal);
 void sender_conceal(uint8_t *_spl, int len, void __attribute__((unused)) *priv);
 
@@ -0,0 +1,311 @@
+/* Recording and replay of a session
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* All events that enter the process from outside, other than the received
+ * signal, are written to a file: key strokes, Osmo-CC messages and RTP
+ * frames from the fixed network. Each event is stamped with the number of
+ * samples the transceiver has received at that time and with the time since
+ * the recording started. The received signal is recorded by the wave files
+ * of '--write-rx-wave' or '--write-iq-rx-wave'.
+ *
+ * When replaying, the recording of the signal is decoded offline. Each event
+ * is injected as soon as the transceiver has received the same number of
+ * samples, so the protocol sees the same events at the same position of the
+ * signal, no matter how fast the replay runs. Optionally the replay is paced
+ * to the recorded time.
+ *
+ * While replaying, the monotonic clock of libosmocore is overridden and set
+ * from the number of samples received, so osmo timers and the timer wheel
+ * expire at the same position of the signal in each run. The clock starts at
+ * a whole second, so rounding of timers does not depend on the start time.
+ *
+ * An event must not exceed SESSION_MAX_DATA bytes. Larger events are not
+ * recorded, so that a recording can always be replayed.
+ *
+ * File format (all values little endian):
+ *
+ *   "ASES" <u32 version> { <u8 type> <u64 position> <u64 time in us>
+ *                          <u32 callref> <u32 length> <data> } ...
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <osmocom/core/timer.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "get_time.h"
+#include "call.h"
+#include "session.h"
+
+#define SESSION_MAGIC		"ASES"
+#define SESSION_VERSION		1
+#define SESSION_MAX_DATA	65536
+
+enum session_type {
+	SESSION_KEY = 1,	/* data: character */
+	SESSION_MSG,		/* data: message type, IEs */
+	SESSION_RTP,		/* data: marker, sequence, timestamp, ssrc, payload */
+};
+
+static struct session {
+	FILE		*fp;
+	int		replay;
+	uint64_t	(*position)(void);
+	double		begin;		/* time when recording or replay started */
+	int		samplerate;	/* rate of positions */
+	int		pace;		/* pace replay to the recorded time */
+	time_t		clock_base;	/* monotonic time at position 0 of replay */
+	void		(*key)(int c);
+	/* next event to replay */
+	int		pending;
+	uint8_t		type;
+	uint64_t	pos;
+	uint64_t	time_us;
+	uint32_t	callref;
+	uint32_t	len;
+	uint8_t		data[SESSION_MAX_DATA];
+} session;
+
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		p[i] = value >> (i * 8);
+}
+
+static uint64_t get_le(const uint8_t *p, int bytes)
+{
+	uint64_t value = 0;
+	int i;
+
+	for (i = 0; i < bytes; i++)
+		value |= (uint64_t)p[i] << (i * 8);
+	return value;
+}
+
+static void record(uint8_t type, uint32_t callref, const uint8_t *head, int head_len, const uint8_t *data, int len)
+{
+	uint8_t hdr[25];
+
+	if (!session.fp || session.replay)
+		return;
+
+	if (head_len + len > SESSION_MAX_DATA) {
+		LOGP(DSENDER, LOGL_ERROR, "Event of %d bytes exceeds maximum size of session file, not recording it!\n", head_len + len);
+		return;
+	}
+
+	hdr[0] = type;
+	put_le(hdr + 1, session.position(), 8);
+	put_le(hdr + 9, (uint64_t)((get_time() - session.begin) * 1000000.0), 8);
+	put_le(hdr + 17, callref, 4);
+	put_le(hdr + 21, head_len + len, 4);
+	if (fwrite(hdr, sizeof(hdr), 1, session.fp) != 1
+	 || (head_len && fwrite(head, head_len, 1, session.fp) != 1)
+	 || (len && fwrite(data, len, 1, session.fp) != 1)) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to write session file, stopping recording!\n");
+		fclose(session.fp);
+		session.fp = NULL;
+	}
+}
+
+int session_record_open(const char *path, uint64_t (*position)(void))
+{
+	uint8_t hdr[8];
+
+	memset(&session, 0, sizeof(session));
+	session.fp = fopen(path, "w");
+	if (!session.fp) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to create session file '%s' (errno %d)!\n", path, errno);
+		return -errno;
+	}
+	memcpy(hdr, SESSION_MAGIC, 4);
+	put_le(hdr + 4, SESSION_VERSION, 4);
+	fwrite(hdr, sizeof(hdr), 1, session.fp);
+	session.position = position;
+	session.begin = get_time();
+	LOGP(DSENDER, LOGL_NOTICE, "Recording session to '%s'.\n", path);
+
+	return 0;
+}
+
+void session_record_key(int c)
+{
+	uint8_t data = c;
+
+	record(SESSION_KEY, 0, NULL, 0, &data, 1);
+}
+
+void session_record_msg(uint32_t callref, uint8_t type, const uint8_t *data, int len)
+{
+	record(SESSION_MSG, callref, &type, 1, data, len);
+}
+
+void session_record_rtp(uint32_t callref, uint8_t marker, uint16_t sequence_number, uint32_t timestamp, uint32_t ssrc, const uint8_t *payload, int payload_len)
+{
+	uint8_t head[11];
+
+	head[0] = marker;
+	put_le(head + 1, sequence_number, 2);
+	put_le(head + 3, timestamp, 4);
+	put_le(head + 7, ssrc, 4);
+	record(SESSION_RTP, callref, head, sizeof(head), payload, payload_len);
+}
+
+/* read next event, return 0 at end of file */
+static int read_event(void)
+{
+	uint8_t hdr[25];
+
+	session.pending = 0;
+	if (fread(hdr, sizeof(hdr), 1, session.fp) != 1)
+		return 0;
+	session.type = hdr[0];
+	session.pos = get_le(hdr + 1, 8);
+	session.time_us = get_le(hdr + 9, 8);
+	session.callref = get_le(hdr + 17, 4);
+	session.len = get_le(hdr + 21, 4);
+	if (session.len > SESSION_MAX_DATA || (session.len && fread(session.data, session.len, 1, session.fp) != 1)) {
+		LOGP(DSENDER, LOGL_ERROR, "Session file is truncated or corrupt, stopping replay!\n");
+		return 0;
+	}
+	session.pending = 1;
+	return 1;
+}
+
+/* set monotonic clock of libosmocore to given position */
+static void replay_clock(uint64_t position)
+{
+	struct timespec *ts = osmo_clock_override_gettimespec(CLOCK_MONOTONIC);
+	uint64_t ns = position * 1000000000ULL / (uint64_t)session.samplerate;
+
+	ts->tv_sec = session.clock_base + ns / 1000000000ULL;
+	ts->tv_nsec = ns % 1000000000ULL;
+}
+
+int session_replay_open(const char *path, uint64_t (*position)(void), int samplerate, int pace, void (*key)(int c))
+{
+	struct timespec ts;
+	uint8_t hdr[8];
+
+	memset(&session, 0, sizeof(session));
+	session.fp = fopen(path, "r");
+	if (!session.fp) {
+		LOGP(DSENDER, LOGL_ERROR, "Failed to open session file '%s' (errno %d)!\n", path, errno);
+		return -errno;
+	}
+	if (fread(hdr, sizeof(hdr), 1, session.fp) != 1 || memcmp(hdr, SESSION_MAGIC, 4) || get_le(hdr + 4, 4) != SESSION_VERSION) {
+		LOGP(DSENDER, LOGL_ERROR, "File '%s' is not a session recording of this version!\n", path);
+		fclose(session.fp);
+		session.fp = NULL;
+		return -EINVAL;
+	}
+	session.replay = 1;
+	session.position = position;
+	session.samplerate = samplerate;
+	session.pace = pace;
+	session.key = key;
+	session.begin = get_time();
+	read_event();
+
+	/* timers that are already running must not expire too late, so the clock continues at the next second */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	session.clock_base = ts.tv_sec + 1;
+	osmo_clock_override_enable(CLOCK_MONOTONIC, true);
+	replay_clock(position());
+
+	LOGP(DSENDER, LOGL_NOTICE, "Replaying session from '%s'%s.\n", path, (pace) ? " at recorded pace" : "");
+
+	return 0;
+}
+
+static void inject(void)
+{
+	switch (session.type) {
+	case SESSION_KEY:
+		if (session.len == 1 && session.key)
+			session.key(session.data[0]);
+		break;
+	case SESSION_MSG:
+		if (session.len >= 1)
+			call_replay_msg(session.callref, session.data[0], session.data + 1, session.len - 1);
+		break;
+	case SESSION_RTP:
+		if (session.len >= 11)
+			call_replay_rtp(session.callref, session.data[0], get_le(session.data + 1, 2), get_le(session.data + 3, 4), get_le(session.data + 7, 4), session.data + 11, session.len - 11);
+		break;
+	default:
+		/* skip events of later versions */
+		break;
+	}
+}
+
+/* Inject all events up to the current position, called by the main loop
+ * before each period is processed. Return 1, if all events are replayed.
+ */
+int session_replay(void)
+{
+	uint64_t position;
+	double elapsed;
+
+	if (!session.fp || !session.replay)
+		return 1;
+
+	position = session.position();
+	replay_clock(position);
+
+	/* do not process the signal faster than it was received */
+	if (session.pace) {
+		elapsed = get_time() - session.begin;
+		if ((double)position / (double)session.samplerate > elapsed)
+			usleep((useconds_t)(((double)position / (double)session.samplerate - elapsed) * 1000000.0));
+	}
+
+	while (session.pending && session.pos <= position) {
+		if (session.pace) {
+			elapsed = get_time() - session.begin;
+			if ((double)session.time_us / 1000000.0 > elapsed)
+				usleep((useconds_t)((double)session.time_us - elapsed * 1000000.0));
+		}
+		inject();
+		read_event();
+	}
+
+	return !session.pending;
+}
+
+void session_close(void)
+{
+	if (!session.fp)
+		return;
+	if (session.replay && session.pending)
+		LOGP(DSENDER, LOGL_NOTICE, "Replay ended before all events of the session were injected.\n");
+	if (session.replay)
+		osmo_clock_override_enable(CLOCK_MONOTONIC, false);
+	fclose(session.fp);
+	session.fp = NULL;
+}
+
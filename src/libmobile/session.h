@@ -0,0 +1,9 @@
+
+int session_record_open(const char *path, uint64_t (*position)(void));
+int session_replay_open(const char *path, uint64_t (*position)(void), int samplerate, int pace, void (*key)(int c));
+void session_close(void);
+void session_record_key(int c);
+void session_record_msg(uint32_t callref, uint8_t type, const uint8_t *data, int len);
+void session_record_rtp(uint32_t callref, uint8_t marker, uint16_t sequence_number, uint32_t timestamp, uint32_t ssrc, const uint8_t *payload, int payload_len);
+int session_replay(void);
+
@@ -0,0 +1,90 @@
+/* Startup profiler
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Each step is marked after it has been done. The time since the previous
+ * mark is the duration of that step. The report is given when the sender
+ * starts streaming, which is the time the instance is back on air.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "../liblogging/logging.h"
+#include "startup.h"
+
+#define MAX_STEPS	64
+
+int startup_profile = 0;
+
+static double begin_time = 0.0, last_time = 0.0;
+static struct startup_step {
+	const char	*name;
+	double		duration;
+} steps[MAX_STEPS];
+static int num_steps = 0;
+
+static double monotonic_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+/* start measurement, this is done by main_mobile_init() */
+void startup_begin(void)
+{
+	begin_time = last_time = monotonic_time();
+	num_steps = 0;
+}
+
+/* mark the end of a step, the name must be a constant string */
+void startup_step(const char *name)
+{
+	double now;
+
+	if (!begin_time)
+		return;
+
+	now = monotonic_time();
+	if (num_steps < MAX_STEPS) {
+		steps[num_steps].name = name;
+		steps[num_steps].duration = now - last_time;
+		num_steps++;
+	}
+	last_time = now;
+}
+
+/* give report once, if enabled */
+void startup_report(void)
+{
+	int i;
+
+	if (!begin_time)
+		return;
+
+	if (startup_profile) {
+		LOGP(DSENDER, LOGL_NOTICE, "Startup profile:\n");
+		for (i = 0; i < num_steps; i++)
+			LOGP(DSENDER, LOGL_NOTICE, " %-24s %9.3f ms\n", steps[i].name, steps[i].duration * 1000.0);
+		LOGP(DSENDER, LOGL_NOTICE, " %-24s %9.3f ms\n", "total", (last_time - begin_time) * 1000.0);
+	}
+	begin_time = 0.0;
+}
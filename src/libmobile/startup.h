@@ -0,0 +1,6 @@
+
+extern int startup_profile;
+
+void startup_begin(void);
+void startup_step(const char *name);
+void startup_report(void);
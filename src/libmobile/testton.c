@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "testton.h"
 
-static uint16_t pattern[] = {
+static const uint16_t pattern[] = {
 	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0001, 0x0001, 0x0000,
 	0x0000, 0x0000, 0x0001, 0xffff, 0x0000, 0x0000, 0x0000, 0x0000,
 	0x0000, 0x0000, 0x0000, 0x0000, 0x0001, 0x0001, 0x0000, 0xffff,
@@ -30064,13 +30064,13 @@ static uint16_t pattern[] = {
 	0x0000, 0x0000, 0x0000, 0x0000, 0x0001, 0x0000, 0x0000, 0x0001,
 	0x0000, 0xffff, 0x0000, 0x0000, 0x0000, 0x0001, 0x0001, 0x0000,
 };
-extern int16_t *test_spl;
+extern const int16_t *test_spl;
 extern int test_size;
 extern int test_max;
 
 void init_testton(void)
 {
-	test_spl = (int16_t *)pattern;
+	test_spl = (const int16_t *)pattern;
 	test_size = sizeof(pattern) / sizeof(pattern[0]);
 	test_max = test_size;
 }
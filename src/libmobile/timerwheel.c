@@ -0,0 +1,201 @@
+/* Hierarchical timer wheel for frequent protocol timers
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Timers that are re-armed or cancelled with (almost) every frame cost a tree
+ * operation each with osmo timers. The wheel stores each timer in a slot
+ * list, so that arming, re-arming and cancelling is O(1).
+ *
+ * The wheel advances in ticks of 1 ms. Level 0 has one slot per tick for the
+ * next 256 ms. Each slot of the higher levels covers a whole turn of the
+ * level below. When a level turns, the timers of the next slot of the level
+ * above are moved down. Timers beyond the last level are parked in its last
+ * slot and re-inserted, until they are in range.
+ *
+ * The wheel is advanced by timerwheel_update() wherever osmo timers are
+ * handled, i.e. after processing each DSP interval. Like osmo timers, it must
+ * be used and updated by the main thread only.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <osmocom/core/timer.h>
+#include "timerwheel.h"
+
+#define LEVEL0_BITS	8
+#define LEVELN_BITS	6
+#define LEVELS		4
+#define LEVEL0_SIZE	(1 << LEVEL0_BITS)
+#define LEVELN_SIZE	(1 << LEVELN_BITS)
+#define WHEEL_RANGE	((uint64_t)1 << (LEVEL0_BITS + (LEVELS - 1) * LEVELN_BITS))
+
+static struct wheel {
+	int			init;
+	uint64_t		now;		/* tick that was processed last */
+	int			active;		/* number of timers in the wheel */
+	struct wheel_timer	*level0[LEVEL0_SIZE];
+	struct wheel_timer	*leveln[LEVELS - 1][LEVELN_SIZE];
+} wheel;
+
+static uint64_t get_tick(void)
+{
+	struct timespec ts;
+
+	/* same clock as osmo timers, so it follows the clock of a replayed session */
+	osmo_clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void link_timer(struct wheel_timer **slot, struct wheel_timer *timer)
+{
+	timer->next = *slot;
+	if (timer->next)
+		timer->next->pprev = &timer->next;
+	timer->pprev = slot;
+	*slot = timer;
+}
+
+static void unlink_timer(struct wheel_timer *timer)
+{
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+static void insert_timer(struct wheel_timer *timer)
+{
+	uint64_t expires = timer->expires, delta = expires - wheel.now;
+	int level, shift;
+
+	if (delta < LEVEL0_SIZE) {
+		link_timer(&wheel.level0[expires & (LEVEL0_SIZE - 1)], timer);
+		return;
+	}
+	/* park far timers in the last slot that is in range */
+	if (delta >= WHEEL_RANGE)
+		expires = wheel.now + WHEEL_RANGE - 1;
+	for (level = 0, shift = LEVEL0_BITS; level < LEVELS - 1; level++, shift += LEVELN_BITS) {
+		if ((expires - wheel.now) < ((uint64_t)1 << (shift + LEVELN_BITS)))
+			break;
+	}
+	link_timer(&wheel.leveln[level][(expires >> shift) & (LEVELN_SIZE - 1)], timer);
+}
+
+/* move timers of the current slot of given level to lower levels */
+static void cascade(int level)
+{
+	struct wheel_timer **slot, *timer, *list;
+	int shift = LEVEL0_BITS + level * LEVELN_BITS;
+
+	slot = &wheel.leveln[level][(wheel.now >> shift) & (LEVELN_SIZE - 1)];
+	list = *slot;
+	*slot = NULL;
+	while ((timer = list)) {
+		list = timer->next;
+		insert_timer(timer);
+	}
+}
+
+void wheel_timer_setup(struct wheel_timer *timer, void (*cb)(void *data), void *data)
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->cb = cb;
+	timer->data = data;
+}
+
+void wheel_timer_schedule(struct wheel_timer *timer, int seconds, int microseconds)
+{
+	uint64_t now = get_tick();
+
+	if (!wheel.init) {
+		wheel.now = now;
+		wheel.init = 1;
+	}
+
+	wheel_timer_del(timer);
+
+	/* round up, so the timer never expires too early */
+	timer->expires = now + (uint64_t)seconds * 1000 + (microseconds + 999) / 1000;
+	if (timer->expires <= wheel.now)
+		timer->expires = wheel.now + 1;
+	insert_timer(timer);
+	timer->active = 1;
+	wheel.active++;
+}
+
+void wheel_timer_del(struct wheel_timer *timer)
+{
+	if (!timer->active)
+		return;
+	unlink_timer(timer);
+	timer->active = 0;
+	wheel.active--;
+}
+
+int wheel_timer_pending(struct wheel_timer *timer)
+{
+	return timer->active;
+}
+
+/* process all ticks up to now, fire expired timers */
+void timerwheel_update(void)
+{
+	struct wheel_timer *list, *timer;
+	uint64_t target;
+	int level;
+
+	if (!wheel.init)
+		return;
+
+	target = get_tick();
+	while (wheel.now < target) {
+		/* nothing to do until now */
+		if (!wheel.active) {
+			wheel.now = target;
+			break;
+		}
+		wheel.now++;
+		if (!(wheel.now & (LEVEL0_SIZE - 1))) {
+			for (level = 0; level < LEVELS - 1; level++) {
+				cascade(level);
+				if ((wheel.now >> (LEVEL0_BITS + level * LEVELN_BITS)) & (LEVELN_SIZE - 1))
+					break;
+			}
+		}
+		/* detach slot, because callbacks may add or remove timers */
+		list = wheel.level0[wheel.now & (LEVEL0_SIZE - 1)];
+		wheel.level0[wheel.now & (LEVEL0_SIZE - 1)] = NULL;
+		if (list)
+			list->pprev = &list;
+		while ((timer = list)) {
+			unlink_timer(timer);
+			/* parked timers are not due yet */
+			if (timer->expires > wheel.now) {
+				insert_timer(timer);
+				continue;
+			}
+			timer->active = 0;
+			wheel.active--;
+			timer->cb(timer->data);
+		}
+	}
+}
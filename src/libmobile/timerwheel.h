@@ -0,0 +1,15 @@
+
+struct wheel_timer {
+	struct wheel_timer	*next, **pprev;	/* list of slot */
+	uint64_t		expires;	/* tick of expiry */
+	int			active;
+	void			(*cb)(void *data);
+	void			*data;
+};
+
+void wheel_timer_setup(struct wheel_timer *timer, void (*cb)(void *data), void *data);
+void wheel_timer_schedule(struct wheel_timer *timer, int seconds, int microseconds);
+void wheel_timer_del(struct wheel_timer *timer);
+int wheel_timer_pending(struct wheel_timer *timer);
+void timerwheel_update(void);
+
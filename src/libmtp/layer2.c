@@ -743,11 +743,7 @@ int mtp_l3l2(mtp_t *mtp, enum mtp_prim prim, uint8_t sio, uint8_t *data, int len
 		tailp = &((*tailp)->next);
 
 	/* add new message to queue */
-	msg = calloc(sizeof(*msg) + len, 1);
-	if (!msg) {
-		LOGP_CHAN(DMTP2, LOGL_ERROR, "No mem!\n");
-		abort();
-	}
+	msg = mtp_msg_alloc(mtp, len);
 	mtp->tx_queue_seq = (mtp->tx_queue_seq + 1) & 0x7f;
 	msg->sequence = mtp->tx_queue_seq;
 	msg->sio = sio;
@@ -869,13 +865,13 @@ static int ack_msg(mtp_t *mtp, uint8_t bsn)
 		LOGP_CHAN(DMTP2, LOGL_DEBUG, "ACK: Message with sequence number %d has been acked and is removed.\n", mtp->tx_queue->sequence);
 		temp = mtp->tx_queue;
 		mtp->tx_queue = temp->next;
-		free(temp);
+		mtp_msg_free(mtp, temp);
 	}
 
 	/* remove the message found */
 	LOGP_CHAN(DMTP2, LOGL_DEBUG, "ACK: Message with sequence number %d has been acked and is removed.\n", mtp->tx_queue->sequence);
 	mtp->tx_queue = msg->next;
-	free(msg);
+	mtp_msg_free(mtp, msg);
 
 	return 0;
 }
@@ -57,10 +57,28 @@ static void mtp_t4(void *data)
 	mtp_send(mtp, MTP_PRIM_T4_TIMEOUT, 0, NULL, 0);
 }
 
+/* each slot holds message header and data */
+#define MSG_SLOT_SIZE	(sizeof(struct mtp_msg) + MTP_MSG_MAX)
+
 int mtp_init(mtp_t *mtp, const char *name, void *inst, void (*mtp_receive)(void *inst, enum mtp_prim prim, uint8_t slc, uint8_t *data, int len), int bitrate, int ignore_monitor, uint8_t sio, uint16_t local_pc, uint16_t remote_pc)
 {
+	struct mtp_msg *msg;
+	int i;
+
 	memset(mtp, 0, sizeof(*mtp));
 
+	/* preallocate messages, so that queueing messages does not need memory allocation */
+	mtp->msg_slots = calloc(MTP_MSG_SLOTS, MSG_SLOT_SIZE);
+	if (!mtp->msg_slots) {
+		LOGP(DMTP2, LOGL_ERROR, "No mem!\n");
+		return -ENOMEM;
+	}
+	for (i = MTP_MSG_SLOTS - 1; i >= 0; i--) {
+		msg = (struct mtp_msg *)(mtp->msg_slots + i * MSG_SLOT_SIZE);
+		msg->next = mtp->msg_free;
+		mtp->msg_free = msg;
+	}
+
 	mtp->name = name;
 	mtp->inst = inst;
 	mtp->mtp_receive = mtp_receive;
@@ -92,6 +110,40 @@ void mtp_exit(mtp_t *mtp)
 	osmo_timer_del(&mtp->t4);
 
 	mtp_flush(mtp);
+
+	free(mtp->msg_slots);
+	mtp->msg_slots = NULL;
+	mtp->msg_free = NULL;
+}
+
+/* get message from unused slots, allocate only if there is no slot or message is too large */
+struct mtp_msg *mtp_msg_alloc(mtp_t *mtp, int len)
+{
+	struct mtp_msg *msg;
+
+	if (mtp->msg_free && len <= MTP_MSG_MAX) {
+		msg = mtp->msg_free;
+		mtp->msg_free = msg->next;
+		memset(msg, 0, sizeof(*msg));
+		return msg;
+	}
+
+	msg = calloc(sizeof(*msg) + len, 1);
+	if (!msg) {
+		LOGP_CHAN(DMTP2, LOGL_ERROR, "No mem!\n");
+		abort();
+	}
+	return msg;
+}
+
+void mtp_msg_free(mtp_t *mtp, struct mtp_msg *msg)
+{
+	if (mtp->msg_slots && (uint8_t *)msg >= mtp->msg_slots && (uint8_t *)msg < mtp->msg_slots + MTP_MSG_SLOTS * MSG_SLOT_SIZE) {
+		msg->next = mtp->msg_free;
+		mtp->msg_free = msg;
+		return;
+	}
+	free(msg);
 }
 
 void mtp_flush(mtp_t *mtp)
@@ -101,7 +153,7 @@ void mtp_flush(mtp_t *mtp)
 	while (mtp->tx_queue) {
 		temp = mtp->tx_queue;
 		mtp->tx_queue = mtp->tx_queue->next;
-		free(temp);
+		mtp_msg_free(mtp, temp);
 	}
 }
 
@@ -48,6 +48,9 @@ enum mtp_l2state {
 	MTP_L2STATE_PROCESSOR_OUTAGE,
 };
 
+#define MTP_MSG_SLOTS	128	/* up to 127 unacknowledged messages plus one to be sent */
+#define MTP_MSG_MAX	272	/* maximum message length that fits into a slot */
+
 struct mtp_msg {
 	struct mtp_msg	*next;
 	uint8_t		sequence;
@@ -99,6 +102,8 @@ typedef struct mtp {
 
 	/* frame sequencing */
 	struct mtp_msg	*tx_queue;	/* head of all messages in queue */
+	uint8_t		*msg_slots;	/* preallocated messages */
+	struct mtp_msg	*msg_free;	/* list of unused slots */
 	uint8_t		tx_queue_seq;	/* last sequence assigned to a frame in the queue */
 	uint8_t		tx_seq;		/* current sequence number transmitting */
 	uint8_t		fib;		/* current FIB */
@@ -122,6 +127,8 @@ typedef struct mtp {
 int mtp_init(mtp_t *mtp, const char *name, void *inst, void (*mtp_receive)(void *inst, enum mtp_prim prim, uint8_t slc, uint8_t *data, int len), int bitrate, int ignore_monitor, uint8_t sio, uint16_t local_pc, uint16_t remote_pc);
 void mtp_exit(mtp_t *mtp);
 void mtp_flush(mtp_t *mtp);
+struct mtp_msg *mtp_msg_alloc(mtp_t *mtp, int len);
+void mtp_msg_free(mtp_t *mtp, struct mtp_msg *msg);
 
 void mtp_l2_new_state(mtp_t *mtp, enum mtp_l2state state);
 
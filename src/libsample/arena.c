@@ -0,0 +1,137 @@
+/* Arena allocator for DSP buffers
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* All buffers of one owner (a channel or an SDR device) are taken from the
+ * owner's slabs, so its working set is contiguous. Each buffer starts at a
+ * cache line. Buffers are not freed individually, only all at once when the
+ * owner is destroyed. Slabs are mapped, so they are zeroed and page aligned.
+ * If huge pages are requested, but not available, normal pages are used.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "arena.h"
+#include "../liblogging/logging.h"
+
+#define HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+
+struct arena_slab {
+	struct arena_slab	*next;
+	size_t			size;
+	size_t			used;
+};
+
+/* use huge pages for all arenas */
+int arena_huge_pages = 0;
+
+void arena_init(arena_t *arena, enum memacct_sub sub, const char *name, size_t slab_size)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->sub = sub;
+	arena->name = name;
+	arena->slab_size = slab_size;
+}
+
+static struct arena_slab *slab_create(arena_t *arena, size_t min_size)
+{
+	struct arena_slab *slab;
+	size_t size = arena->slab_size;
+	void *mem = MAP_FAILED;
+
+	if (size < min_size)
+		size = min_size;
+
+	if (arena_huge_pages) {
+		size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (mem != MAP_FAILED)
+			arena->huge++;
+	}
+	if (mem == MAP_FAILED) {
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+			return NULL;
+		/* transparent huge pages, if no huge pages are reserved */
+		if (arena_huge_pages)
+			madvise(mem, size, MADV_HUGEPAGE);
+	}
+
+	slab = mem;
+	slab->size = size;
+	slab->used = (sizeof(*slab) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	slab->next = arena->slab;
+	arena->slab = slab;
+	arena->mapped += size;
+	arena->slabs++;
+	memacct_add(arena->sub, arena->name, size);
+
+	return slab;
+}
+
+/* return zeroed buffer, aligned to a cache line, NULL if out of memory */
+void *arena_alloc(arena_t *arena, size_t nmemb, size_t size)
+{
+	struct arena_slab *slab = arena->slab;
+	size_t bytes;
+	void *p;
+
+	if (size && nmemb > SIZE_MAX / size)
+		return NULL;
+	bytes = (nmemb * size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!bytes)
+		bytes = ARENA_ALIGN;
+
+	if (!slab || slab->size - slab->used < bytes) {
+		slab = slab_create(arena, bytes + ARENA_ALIGN);
+		if (!slab) {
+			LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+			return NULL;
+		}
+	}
+
+	p = (uint8_t *)slab + slab->used;
+	slab->used += bytes;
+	arena->used += bytes;
+
+	return p;
+}
+
+void arena_free(arena_t *arena)
+{
+	struct arena_slab *slab;
+
+	while ((slab = arena->slab)) {
+		arena->slab = slab->next;
+		memacct_add(arena->sub, arena->name, -(ssize_t)slab->size);
+		munmap(slab, slab->size);
+	}
+	arena->used = 0;
+	arena->mapped = 0;
+	arena->slabs = 0;
+	arena->huge = 0;
+}
+
+void arena_report(arena_t *arena)
+{
+	if (!arena->slabs)
+		return;
+	LOGP(DDSP, LOGL_INFO, "Buffers of '%s' use %zu bytes in %d slab(s) of %zu bytes total%s\n", arena->name, arena->used, arena->slabs, arena->mapped, (arena->huge) ? ", on huge pages" : "");
+}
@@ -0,0 +1,30 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include "memacct.h"
+
+#define ARENA_ALIGN	64	/* cache line */
+
+struct arena_slab;
+
+/* buffers that live as long as their owner, allocated from few contiguous slabs */
+typedef struct arena {
+	const char		*name;		/* owner, for the report */
+	enum memacct_sub	sub;		/* subsystem for memory accounting */
+	struct arena_slab	*slab;		/* list of slabs, latest first */
+	size_t			slab_size;	/* minimum size of a slab */
+	size_t			used;		/* total bytes handed out */
+	size_t			mapped;		/* total bytes of all slabs */
+	int			slabs;
+	int			huge;		/* number of slabs on huge pages */
+} arena_t;
+
+extern int arena_huge_pages;
+
+void arena_init(arena_t *arena, enum memacct_sub sub, const char *name, size_t slab_size);
+void *arena_alloc(arena_t *arena, size_t nmemb, size_t size);
+void arena_free(arena_t *arena);
+void arena_report(arena_t *arena);
+
+#endif /* _ARENA_H */
@@ -0,0 +1,98 @@
+/* fixed delay line for audio samples
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The buffer holds the last 'size' samples, starting at the oldest one.
+ * The samples of a chunk are exchanged with the buffer in at most two spans,
+ * one up to the end of the buffer and one after the wrap. The samples are
+ * exchanged in steps through a small stack buffer, so no wrap check is
+ * needed per sample.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "sample.h"
+#include "delay.h"
+
+#define SWAP_CHUNK	256
+
+int sample_delay_init(sample_delay_t *delay, int size)
+{
+	memset(delay, 0, sizeof(*delay));
+
+	if (size < 1)
+		return -EINVAL;
+
+	delay->spl = calloc(size, sizeof(*delay->spl));
+	if (!delay->spl)
+		return -ENOMEM;
+	delay->size = size;
+
+	return 0;
+}
+
+void sample_delay_exit(sample_delay_t *delay)
+{
+	free(delay->spl);
+	delay->spl = NULL;
+}
+
+/* fill with silence */
+void sample_delay_reset(sample_delay_t *delay)
+{
+	if (delay->spl)
+		memset(delay->spl, 0, delay->size * sizeof(*delay->spl));
+	delay->pos = 0;
+}
+
+/* exchange samples with buffer content */
+static void swap_span(sample_t *a, sample_t *b, int length)
+{
+	sample_t tmp[SWAP_CHUNK];
+	int n;
+
+	while (length) {
+		n = (length > SWAP_CHUNK) ? SWAP_CHUNK : length;
+		memcpy(tmp, a, n * sizeof(*a));
+		memcpy(a, b, n * sizeof(*a));
+		memcpy(b, tmp, n * sizeof(*a));
+		a += n;
+		b += n;
+		length -= n;
+	}
+}
+
+/* delay samples in place */
+void sample_delay_process(sample_delay_t *delay, sample_t *samples, int length)
+{
+	int n;
+
+	while (length) {
+		n = delay->size - delay->pos;
+		if (n > length)
+			n = length;
+		swap_span(samples, delay->spl + delay->pos, n);
+		delay->pos += n;
+		if (delay->pos == delay->size)
+			delay->pos = 0;
+		samples += n;
+		length -= n;
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef _DELAY_H
+#define _DELAY_H
+
+/* fixed delay line for audio samples */
+
+typedef struct sample_delay {
+	sample_t	*spl;		/* delayed samples */
+	int		size;		/* delay in samples */
+	int		pos;		/* oldest sample in buffer */
+} sample_delay_t;
+
+int sample_delay_init(sample_delay_t *delay, int size);
+void sample_delay_exit(sample_delay_t *delay);
+void sample_delay_reset(sample_delay_t *delay);
+void sample_delay_process(sample_delay_t *delay, sample_t *samples, int length);
+
+#endif /* _DELAY_H */
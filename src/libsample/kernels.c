@@ -0,0 +1,203 @@
+/* Runtime selection of DSP kernel variants
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A library that has kernels for different instruction sets registers them as
+ * family. The features of the CPU are detected once, then every family is bound
+ * to the best variant that the CPU supports and the family provides. A variant
+ * can be forced with '--dsp-kernels', to compare them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#include "../liblogging/logging.h"
+#include "kernels.h"
+
+/* family of libsample */
+extern struct dsp_kernel_family sample_kernels;
+
+static const char *variant_names[DSP_VARIANTS] = {
+	"generic",
+	"avx2",
+	"neon",
+};
+
+static int detected = 0;
+static int initialized = 0;
+static int cpu_has[DSP_VARIANTS];
+static int forced = -1;
+static struct dsp_kernel_family *families = NULL;
+
+static void detect_cpu(void)
+{
+	if (detected)
+		return;
+	detected = 1;
+
+	cpu_has[DSP_VARIANT_GENERIC] = 1;
+#ifdef DSP_HAVE_AVX2
+	__builtin_cpu_init();
+	cpu_has[DSP_VARIANT_AVX2] = __builtin_cpu_supports("avx2");
+#endif
+#ifdef DSP_HAVE_NEON
+#if defined(__aarch64__)
+	/* mandatory on ARM64 */
+	cpu_has[DSP_VARIANT_NEON] = 1;
+#elif defined(__linux__)
+	cpu_has[DSP_VARIANT_NEON] = !!(getauxval(AT_HWCAP) & HWCAP_NEON);
+#endif
+#endif
+}
+
+static void bind_family(struct dsp_kernel_family *family)
+{
+	int v, i;
+
+	/* take the forced or the best variant, fall back to generic if the family does not have it */
+	if (forced >= 0)
+		v = forced;
+	else {
+		for (v = DSP_VARIANTS - 1; v > DSP_VARIANT_GENERIC; v--) {
+			if (cpu_has[v] && family->variant[v])
+				break;
+		}
+	}
+	if (!family->variant[v])
+		v = DSP_VARIANT_GENERIC;
+
+	for (i = 0; i < family->num; i++)
+		family->slot[i] = family->variant[v][i];
+	family->bound = v;
+}
+
+/* detect CPU features and bind the kernels of libsample, may be called more than once */
+void dsp_kernels_init(void)
+{
+	if (initialized)
+		return;
+	initialized = 1;
+	detect_cpu();
+	dsp_kernels_register(&sample_kernels);
+}
+
+/* force a variant of all kernels, "auto" selects the best again */
+int dsp_kernels_force(const char *name)
+{
+	struct dsp_kernel_family *family;
+	int v;
+
+	dsp_kernels_init();
+
+	if (!strcmp(name, "auto"))
+		v = -1;
+	else {
+		for (v = 0; v < DSP_VARIANTS; v++) {
+			if (!strcmp(name, variant_names[v]))
+				break;
+		}
+		if (v == DSP_VARIANTS) {
+			fprintf(stderr, "Unknown DSP kernel variant '%s', use '-h' for help!\n", name);
+			return -EINVAL;
+		}
+		if (!cpu_has[v]) {
+			fprintf(stderr, "DSP kernel variant '%s' is not supported by this CPU or build!\n", name);
+			return -EINVAL;
+		}
+	}
+	forced = v;
+
+	for (family = families; family; family = family->next)
+		bind_family(family);
+
+	return 0;
+}
+
+/* add a family of kernels and bind it to the selected variant */
+void dsp_kernels_register(struct dsp_kernel_family *family)
+{
+	struct dsp_kernel_family **familyp;
+
+	detect_cpu();
+
+	for (familyp = &families; *familyp; familyp = &((*familyp)->next)) {
+		if (*familyp == family)
+			break;
+	}
+	if (!*familyp) {
+		family->next = NULL;
+		*familyp = family;
+	}
+
+	bind_family(family);
+}
+
+/* name of the variant that is bound to given family, NULL if not registered */
+const char *dsp_kernels_variant(const char *name)
+{
+	struct dsp_kernel_family *family;
+
+	dsp_kernels_init();
+
+	for (family = families; family; family = family->next) {
+		if (!strcmp(family->name, name))
+			return variant_names[family->bound];
+	}
+
+	return NULL;
+}
+
+void dsp_kernels_report(void)
+{
+	struct dsp_kernel_family *family;
+	char features[64] = "";
+	int v;
+
+	dsp_kernels_init();
+
+	for (v = DSP_VARIANT_GENERIC + 1; v < DSP_VARIANTS; v++) {
+		if (!cpu_has[v])
+			continue;
+		strcat(features, " ");
+		strcat(features, variant_names[v]);
+	}
+	LOGP(DDSP, LOGL_INFO, "CPU features:%s\n", (features[0]) ? features : " none");
+	for (family = families; family; family = family->next)
+		LOGP(DDSP, LOGL_INFO, "DSP kernels '%s' use %s variant%s.\n", family->name, variant_names[family->bound], (forced >= 0) ? " (forced)" : "");
+}
+
+void dsp_kernels_print_help(void)
+{
+	printf("    --dsp-kernels auto | generic");
+#ifdef DSP_HAVE_AVX2
+	printf(" | avx2");
+#endif
+#ifdef DSP_HAVE_NEON
+	printf(" | neon");
+#endif
+	printf("\n");
+	printf("        Select variant of DSP kernels. By default (auto) the best variant that the\n");
+	printf("        CPU supports is selected when the program starts. Force a variant to\n");
+	printf("        compare them.\n");
+}
@@ -0,0 +1,42 @@
+#ifndef _KERNELS_H
+#define _KERNELS_H
+
+/* variants of DSP kernels, the order is the order of preference */
+enum dsp_variant {
+	DSP_VARIANT_GENERIC = 0,	/* plain C, vectorized for the baseline of the architecture */
+	DSP_VARIANT_AVX2,		/* x86_64 with AVX2 */
+	DSP_VARIANT_NEON,		/* ARM with NEON */
+	DSP_VARIANTS,
+};
+
+/* kernels that are built for a variant must be declared with this attribute */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DSP_HAVE_AVX2
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_NEON))
+#define DSP_HAVE_NEON
+#endif
+
+typedef void (*dsp_fn_t)(void);
+
+/* one family of kernels, all members are bound to the same variant
+ * 'slot' points to an array of function pointers that are called by the user,
+ * 'variant' has the implementations of each variant, NULL if not available */
+struct dsp_kernel_family {
+	struct dsp_kernel_family *next;
+	const char		*name;
+	int			num;		/* number of functions in family */
+	dsp_fn_t		*slot;
+	const dsp_fn_t		*variant[DSP_VARIANTS];
+	enum dsp_variant	bound;		/* variant that is currently bound */
+};
+
+void dsp_kernels_init(void);
+int dsp_kernels_force(const char *name);
+void dsp_kernels_register(struct dsp_kernel_family *family);
+const char *dsp_kernels_variant(const char *family);
+void dsp_kernels_report(void);
+void dsp_kernels_print_help(void);
+
+#endif /* _KERNELS_H */
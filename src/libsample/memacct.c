@@ -0,0 +1,135 @@
+/* Memory accounting per subsystem and owner
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The main allocation sites add the bytes they allocate (and subtract what
+ * they free) to a subsystem and an owner. The owner is the channel, or a name
+ * like "SDR" for shared instances. Small allocations are not accounted, so
+ * the total is lower than the resident memory of the process, which is
+ * reported for comparison.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "memacct.h"
+#include "../liblogging/logging.h"
+
+#define MEMACCT_OWNERS	256
+
+static const char *memacct_sub_name[MEMACCT_NUM] = {
+	"sender",
+	"dsp",
+	"buffers",
+	"sdr",
+	"jitter",
+	"wave",
+};
+
+static struct memacct_owner {
+	char		name[32];
+	ssize_t		bytes[MEMACCT_NUM];
+} owners[MEMACCT_OWNERS];
+static int num_owners = 0;
+
+/* jitter buffers may grow in worker threads */
+static pthread_mutex_t memacct_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void memacct_add(enum memacct_sub sub, const char *owner, ssize_t bytes)
+{
+	int i;
+
+	if (!owner || !owner[0])
+		owner = "common";
+
+	pthread_mutex_lock(&memacct_mutex);
+	for (i = 0; i < num_owners; i++) {
+		if (!strncmp(owners[i].name, owner, sizeof(owners[i].name) - 1))
+			break;
+	}
+	if (i == num_owners) {
+		if (num_owners == MEMACCT_OWNERS) {
+			/* account to last owner, rather than losing it */
+			i = MEMACCT_OWNERS - 1;
+		} else {
+			strncpy(owners[i].name, owner, sizeof(owners[i].name) - 1);
+			num_owners++;
+		}
+	}
+	owners[i].bytes[sub] += bytes;
+	pthread_mutex_unlock(&memacct_mutex);
+}
+
+/* resident set size of the process, -1 if not available */
+static ssize_t resident_bytes(void)
+{
+	FILE *fp;
+	unsigned long size, resident;
+	int rc;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (!fp)
+		return -1;
+	rc = fscanf(fp, "%lu %lu", &size, &resident);
+	fclose(fp);
+	if (rc != 2)
+		return -1;
+	return (ssize_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+void memacct_report(void)
+{
+	char line[256];
+	ssize_t total[MEMACCT_NUM], sum, all = 0, rss;
+	int i, s, len;
+
+	memset(total, 0, sizeof(total));
+
+	len = snprintf(line, sizeof(line), "%-16s", "Owner");
+	for (s = 0; s < MEMACCT_NUM; s++)
+		len += snprintf(line + len, sizeof(line) - len, " %10s", memacct_sub_name[s]);
+	snprintf(line + len, sizeof(line) - len, " %10s", "total");
+	LOGP(DDSP, LOGL_NOTICE, "Memory used by subsystems (bytes):\n");
+	LOGP(DDSP, LOGL_NOTICE, "%s\n", line);
+
+	pthread_mutex_lock(&memacct_mutex);
+	for (i = 0; i < num_owners; i++) {
+		len = snprintf(line, sizeof(line), "%-16s", owners[i].name);
+		for (s = 0, sum = 0; s < MEMACCT_NUM; s++) {
+			len += snprintf(line + len, sizeof(line) - len, " %10zd", owners[i].bytes[s]);
+			sum += owners[i].bytes[s];
+			total[s] += owners[i].bytes[s];
+		}
+		snprintf(line + len, sizeof(line) - len, " %10zd", sum);
+		all += sum;
+		LOGP(DDSP, LOGL_NOTICE, "%s\n", line);
+	}
+	pthread_mutex_unlock(&memacct_mutex);
+
+	len = snprintf(line, sizeof(line), "%-16s", "Total");
+	for (s = 0; s < MEMACCT_NUM; s++)
+		len += snprintf(line + len, sizeof(line) - len, " %10zd", total[s]);
+	snprintf(line + len, sizeof(line) - len, " %10zd", all);
+	LOGP(DDSP, LOGL_NOTICE, "%s\n", line);
+
+	rss = resident_bytes();
+	if (rss >= 0)
+		LOGP(DDSP, LOGL_NOTICE, "Resident memory of process: %zd bytes (not accounted: %zd bytes)\n", rss, rss - all);
+}
@@ -0,0 +1,20 @@
+#ifndef _MEMACCT_H
+#define _MEMACCT_H
+
+#include <sys/types.h>
+
+/* subsystems that memory is accounted to */
+enum memacct_sub {
+	MEMACCT_SENDER = 0,	/* transceiver instance */
+	MEMACCT_DSP,		/* protocol DSP state and buffers */
+	MEMACCT_BUFFERS,	/* arena buffers of audio processing */
+	MEMACCT_SDR,		/* SDR device and channelizer */
+	MEMACCT_JITTER,		/* frame pools of jitter buffers */
+	MEMACCT_WAVE,		/* wave file buffers */
+	MEMACCT_NUM
+};
+
+void memacct_add(enum memacct_sub sub, const char *owner, ssize_t bytes);
+void memacct_report(void);
+
+#endif /* _MEMACCT_H */
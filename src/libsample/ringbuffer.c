@@ -0,0 +1,177 @@
+/* Single producer / single consumer ring buffer
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The producer owns 'in', the consumer owns 'out'. Each side loads the
+ * other side's pointer with acquire semantic and stores its own pointer
+ * with release semantic, so the data written before a commit is visible to
+ * the consumer after it sees the new 'in' pointer, and vice versa.
+ *
+ * The span functions return a pointer into the buffer and the number of
+ * elements that can be accessed there without wrapping. After processing
+ * in place, the span is committed or released. A second call returns the
+ * part after the wrap, if any.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "ringbuffer.h"
+
+/* init ring buffer that can hold the given number of elements */
+int ringbuffer_init(ringbuffer_t *rb, int elements, int element_size)
+{
+	memset(rb, 0, sizeof(*rb));
+
+	if (elements < 1 || element_size < 1)
+		return -EINVAL;
+
+	rb->size = elements + 1;
+	rb->element_size = element_size;
+	rb->buffer = calloc(rb->size, element_size);
+	if (!rb->buffer)
+		return -ENOMEM;
+	atomic_init(&rb->in, 0);
+	atomic_init(&rb->out, 0);
+
+	return 0;
+}
+
+void ringbuffer_exit(ringbuffer_t *rb)
+{
+	free(rb->buffer);
+	rb->buffer = NULL;
+}
+
+/* number of elements that can be read */
+int ringbuffer_fill(ringbuffer_t *rb)
+{
+	int in = atomic_load_explicit(&rb->in, memory_order_acquire);
+	int out = atomic_load_explicit(&rb->out, memory_order_acquire);
+
+	return (in - out + rb->size) % rb->size;
+}
+
+/* number of elements that can be written */
+int ringbuffer_space(ringbuffer_t *rb)
+{
+	int in = atomic_load_explicit(&rb->in, memory_order_acquire);
+	int out = atomic_load_explicit(&rb->out, memory_order_acquire);
+
+	return (out - in - 1 + rb->size) % rb->size;
+}
+
+/* get contiguous space to write to (producer) */
+int ringbuffer_write_span(ringbuffer_t *rb, void **span)
+{
+	int in = atomic_load_explicit(&rb->in, memory_order_relaxed);
+	int out = atomic_load_explicit(&rb->out, memory_order_acquire);
+	int num;
+
+	if (out > in)
+		num = out - in - 1;
+	else
+		num = rb->size - in - (out == 0);
+	*span = rb->buffer + in * rb->element_size;
+
+	return num;
+}
+
+/* make written elements available to consumer */
+void ringbuffer_write_commit(ringbuffer_t *rb, int num)
+{
+	int in = atomic_load_explicit(&rb->in, memory_order_relaxed);
+
+	in += num;
+	if (in >= rb->size)
+		in -= rb->size;
+	atomic_store_explicit(&rb->in, in, memory_order_release);
+}
+
+/* get contiguous elements to read from (consumer) */
+int ringbuffer_read_span(ringbuffer_t *rb, void **span)
+{
+	int out = atomic_load_explicit(&rb->out, memory_order_relaxed);
+	int in = atomic_load_explicit(&rb->in, memory_order_acquire);
+	int num;
+
+	if (in >= out)
+		num = in - out;
+	else
+		num = rb->size - out;
+	*span = rb->buffer + out * rb->element_size;
+
+	return num;
+}
+
+/* give read elements back to producer */
+void ringbuffer_read_release(ringbuffer_t *rb, int num)
+{
+	int out = atomic_load_explicit(&rb->out, memory_order_relaxed);
+
+	out += num;
+	if (out >= rb->size)
+		out -= rb->size;
+	atomic_store_explicit(&rb->out, out, memory_order_release);
+}
+
+/* copy elements into ring buffer, return number of elements written */
+int ringbuffer_write(ringbuffer_t *rb, const void *data, int num)
+{
+	const uint8_t *p = data;
+	void *span;
+	int written = 0, len;
+
+	while (written < num) {
+		len = ringbuffer_write_span(rb, &span);
+		if (!len)
+			break;
+		if (len > num - written)
+			len = num - written;
+		memcpy(span, p, len * rb->element_size);
+		ringbuffer_write_commit(rb, len);
+		p += len * rb->element_size;
+		written += len;
+	}
+
+	return written;
+}
+
+/* copy elements out of ring buffer, return number of elements read */
+int ringbuffer_read(ringbuffer_t *rb, void *data, int num)
+{
+	uint8_t *p = data;
+	void *span;
+	int read = 0, len;
+
+	while (read < num) {
+		len = ringbuffer_read_span(rb, &span);
+		if (!len)
+			break;
+		if (len > num - read)
+			len = num - read;
+		memcpy(p, span, len * rb->element_size);
+		ringbuffer_read_release(rb, len);
+		p += len * rb->element_size;
+		read += len;
+	}
+
+	return read;
+}
+
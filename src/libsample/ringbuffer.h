@@ -0,0 +1,28 @@
+#ifndef _RINGBUFFER_H
+#define _RINGBUFFER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/* lock-free ring buffer for one producer and one consumer thread */
+
+typedef struct ringbuffer {
+	uint8_t		*buffer;	/* storage of elements */
+	int		size;		/* number of elements in storage (one is always kept free) */
+	int		element_size;	/* size of each element in bytes */
+	atomic_int	in;		/* next element to write, changed by producer only */
+	atomic_int	out;		/* next element to read, changed by consumer only */
+} ringbuffer_t;
+
+int ringbuffer_init(ringbuffer_t *rb, int elements, int element_size);
+void ringbuffer_exit(ringbuffer_t *rb);
+int ringbuffer_fill(ringbuffer_t *rb);
+int ringbuffer_space(ringbuffer_t *rb);
+int ringbuffer_write_span(ringbuffer_t *rb, void **span);
+void ringbuffer_write_commit(ringbuffer_t *rb, int num);
+int ringbuffer_read_span(ringbuffer_t *rb, void **span);
+void ringbuffer_read_release(ringbuffer_t *rb, int num);
+int ringbuffer_write(ringbuffer_t *rb, const void *data, int num);
+int ringbuffer_read(ringbuffer_t *rb, void *data, int num);
+
+#endif /* _RINGBUFFER_H */
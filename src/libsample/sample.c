@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include "sample.h"
+#include "kernels.h"
 
 /*
  * A regular voice conversation takes place at this factor below the full range
@@ -41,49 +42,191 @@ static double int_16_1mw_level = 0.7079; /* dBm0, 3dBm below full 16 bit range *
  * envelope is network dependent.
  */
 
-/* sample conversion relative to SPEECH level */
-void samples_to_int16_speech(int16_t *spl, sample_t *samples, int length)
+/* The conversion kernels are branch-free, so the compiler vectorizes them.
+ * On x86_64, they are additionally built for AVX2. The variant is bound at
+ * runtime, see kernels.c.
+ */
+
+/* scale samples and saturate to +-32767, output every 'stride' value (interleaved channels) */
+static inline __attribute__((always_inline)) void to_int16_scale(int16_t *spl, int stride, const sample_t *samples, int length, double scale)
 {
-	int32_t value;
+	double value;
+	int i;
 
-	while (length--) {
-		value = *samples++ * int_16_speech_level * 32768.0;
-		if (value > 32767.0)
-			*spl++ = 32767;
-		else if (value < -32767.0)
-			*spl++ = -32767;
-		else
-			*spl++ = (uint16_t)value;
+	/* a separate loop for contiguous output, so it is vectorized */
+	if (stride == 1) {
+		for (i = 0; i < length; i++) {
+			value = samples[i] * scale;
+			value = (value > 32767.0) ? 32767.0 : value;
+			value = (value < -32767.0) ? -32767.0 : value;
+			spl[i] = (int32_t)value;
+		}
+		return;
+	}
+	for (i = 0; i < length; i++) {
+		value = samples[i] * scale;
+		value = (value > 32767.0) ? 32767.0 : value;
+		value = (value < -32767.0) ? -32767.0 : value;
+		spl[i * stride] = (int32_t)value;
 	}
 }
 
-void int16_to_samples_speech(sample_t *samples, int16_t *spl, int length)
+/* scale every 'stride' value (interleaved channels) to samples */
+static inline __attribute__((always_inline)) void from_int16_scale(sample_t *samples, const int16_t *spl, int stride, int length, double scale)
 {
-	while (length--) {
-		*samples++ = (double)(*spl++) / 32767.0 / int_16_speech_level;
+	int i;
+
+	if (stride == 1) {
+		for (i = 0; i < length; i++)
+			samples[i] = (double)spl[i] * scale;
+		return;
 	}
+	for (i = 0; i < length; i++)
+		samples[i] = (double)spl[i * stride] * scale;
+}
+
+/* multiply samples by gain */
+static inline __attribute__((always_inline)) void gain_scale(sample_t *samples, int length, double gain)
+{
+	int i;
+
+	for (i = 0; i < length; i++)
+		samples[i] *= gain;
+}
+
+typedef void (*to_int16_fn)(int16_t *spl, int stride, const sample_t *samples, int length, double scale);
+typedef void (*from_int16_fn)(sample_t *samples, const int16_t *spl, int stride, int length, double scale);
+typedef void (*gain_fn)(sample_t *samples, int length, double gain);
+
+static void to_int16_generic(int16_t *spl, int stride, const sample_t *samples, int length, double scale)
+{
+	to_int16_scale(spl, stride, samples, length, scale);
+}
+
+static void from_int16_generic(sample_t *samples, const int16_t *spl, int stride, int length, double scale)
+{
+	from_int16_scale(samples, spl, stride, length, scale);
+}
+
+static void gain_generic(sample_t *samples, int length, double gain)
+{
+	gain_scale(samples, length, gain);
+}
+
+static const dsp_fn_t generic_kernels[] = {
+	(dsp_fn_t)to_int16_generic,
+	(dsp_fn_t)from_int16_generic,
+	(dsp_fn_t)gain_generic,
+};
+
+#ifdef DSP_HAVE_AVX2
+DSP_TARGET_AVX2
+static void to_int16_avx2(int16_t *spl, int stride, const sample_t *samples, int length, double scale)
+{
+	to_int16_scale(spl, stride, samples, length, scale);
+}
+
+DSP_TARGET_AVX2
+static void from_int16_avx2(sample_t *samples, const int16_t *spl, int stride, int length, double scale)
+{
+	from_int16_scale(samples, spl, stride, length, scale);
+}
+
+DSP_TARGET_AVX2
+static void gain_avx2(sample_t *samples, int length, double gain)
+{
+	gain_scale(samples, length, gain);
+}
+
+static const dsp_fn_t avx2_kernels[] = {
+	(dsp_fn_t)to_int16_avx2,
+	(dsp_fn_t)from_int16_avx2,
+	(dsp_fn_t)gain_avx2,
+};
+#endif
+
+/* until bound, the slots detect the CPU on first use */
+static void to_int16_resolve(int16_t *spl, int stride, const sample_t *samples, int length, double scale);
+static void from_int16_resolve(sample_t *samples, const int16_t *spl, int stride, int length, double scale);
+static void gain_resolve(sample_t *samples, int length, double gain);
+
+static dsp_fn_t sample_slot[] = {
+	(dsp_fn_t)to_int16_resolve,
+	(dsp_fn_t)from_int16_resolve,
+	(dsp_fn_t)gain_resolve,
+};
+
+struct dsp_kernel_family sample_kernels = {
+	.name = "sample conversion",
+	.num = 3,
+	.slot = sample_slot,
+	.variant = {
+		[DSP_VARIANT_GENERIC] = generic_kernels,
+#ifdef DSP_HAVE_AVX2
+		[DSP_VARIANT_AVX2] = avx2_kernels,
+#endif
+	},
+};
+
+static void to_int16_resolve(int16_t *spl, int stride, const sample_t *samples, int length, double scale)
+{
+	dsp_kernels_init();
+	((to_int16_fn)sample_slot[0])(spl, stride, samples, length, scale);
+}
+
+static void from_int16_resolve(sample_t *samples, const int16_t *spl, int stride, int length, double scale)
+{
+	dsp_kernels_init();
+	((from_int16_fn)sample_slot[1])(samples, spl, stride, length, scale);
+}
+
+static void gain_resolve(sample_t *samples, int length, double gain)
+{
+	dsp_kernels_init();
+	((gain_fn)sample_slot[2])(samples, length, gain);
+}
+
+void samples_to_int16_scale(int16_t *spl, int stride, const sample_t *samples, int length, double scale)
+{
+	((to_int16_fn)sample_slot[0])(spl, stride, samples, length, scale);
+}
+
+void int16_to_samples_scale(sample_t *samples, const int16_t *spl, int stride, int length, double scale)
+{
+	((from_int16_fn)sample_slot[1])(samples, spl, stride, length, scale);
+}
+/* multiply samples by gain */
+/* sample conversion relative to SPEECH level */
+void samples_gain(sample_t *samples, int length, double gain)
+{
+	((gain_fn)sample_slot[2])(samples, length, gain);
+}
+
+/* sample conversion relative to SPEECH level */
+void samples_to_int16_speech(int16_t *spl, sample_t *samples, int length)
+{
+	samples_to_int16_scale(spl, 1, samples, length, int_16_speech_level * 32768.0);
+}
+
+void int16_to_samples_speech(sample_t *samples, int16_t *spl, int length)
+{
+	int16_to_samples_scale(samples, spl, 1, length, 1.0 / 32767.0 / int_16_speech_level);
+}
+
+/* factor of int16_to_samples_speech(), for conversions that are done by other processing */
+double int16_speech_factor(void)
+{
+	return 1.0 / 32767.0 / int_16_speech_level;
 }
 
 /* sample conversion relative to 1mW level */
 void samples_to_int16_1mw(int16_t *spl, sample_t *samples, int length)
 {
-	int32_t value;
-
-	while (length--) {
-		value = *samples++ * int_16_1mw_level * 32768.0;
-		if (value > 32767.0)
-			*spl++ = 32767;
-		else if (value < -32767.0)
-			*spl++ = -32767;
-		else
-			*spl++ = (uint16_t)value;
-	}
+	samples_to_int16_scale(spl, 1, samples, length, int_16_1mw_level * 32768.0);
 }
 
 void int16_to_samples_1mw(sample_t *samples, int16_t *spl, int length)
 {
-	while (length--) {
-		*samples++ = (double)(*spl++) / 32767.0 / int_16_1mw_level;
-	}
+	int16_to_samples_scale(samples, spl, 1, length, 1.0 / 32767.0 / int_16_1mw_level);
 }
 
@@ -1,10 +1,21 @@
 
+/* with --enable-float-samples, sample buffers use half the memory.
+ * phase accumulators, resampler positions and filter states are double in
+ * any case, so they do not lose precision. */
+#ifdef FLOAT_SAMPLES
+typedef float sample_t;
+#else
 typedef double sample_t;
+#endif
 
 #define	SPEECH_LEVEL	0.1585
 
+void samples_to_int16_scale(int16_t *spl, int stride, const sample_t *samples, int length, double scale);
+void int16_to_samples_scale(sample_t *samples, const int16_t *spl, int stride, int length, double scale);
+void samples_gain(sample_t *samples, int length, double gain);
 void samples_to_int16_speech(int16_t *spl, sample_t *samples, int length);
 void int16_to_samples_speech(sample_t *samples, int16_t *spl, int length);
+double int16_speech_factor(void);
 void samples_to_int16_1mw(int16_t *spl, sample_t *samples, int length);
 void int16_to_samples_1mw(sample_t *samples, int16_t *spl, int length);
 
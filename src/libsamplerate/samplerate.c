@@ -22,11 +22,166 @@
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include "../libsample/sample.h"
 #include "samplerate.h"
 
-int init_samplerate(samplerate_t *state, double low_samplerate, double high_samplerate, double filter_cutoff)
+/*
+ * Polyphase resampler
+ *
+ * The input is (virtually) interpolated by 'phases', filtered and decimated
+ * by 'step'. Only the required output samples are calculated, each from one
+ * branch of the filter. The branches are cached for each ratio, so all
+ * senders with equal sample rates share one table.
+ */
+
+typedef struct samplerate_table {
+	struct samplerate_table *next;
+	int phases, step, taps;
+	double *coeff;
+} samplerate_table_t;
+
+static samplerate_table_t *table_list = NULL;
+
+/* find phases / step that equals the given ratio using continued fractions */
+static int rational_ratio(double ratio, int *phases, int *step)
+{
+	long long h0 = 0, h1 = 1, k0 = 1, k1 = 0, h2, k2, a;
+	double x = ratio;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		a = floor(x);
+		h2 = a * h1 + h0;
+		k2 = a * k1 + k0;
+		if (h2 > SAMPLERATE_MAX_PHASES || k2 > SAMPLERATE_MAX_PHASES)
+			break;
+		h0 = h1;
+		h1 = h2;
+		k0 = k1;
+		k1 = k2;
+		if (fabs((double)h1 / (double)k1 - ratio) < ratio * 1e-9) {
+			*phases = h1;
+			*step = k1;
+			return 0;
+		}
+		x -= (double)a;
+		if (x < 1e-12)
+			break;
+		x = 1.0 / x;
+	}
+
+	return -EINVAL;
+}
+
+/* get branches of windowed sinc low-pass, cutoff is relative to the interpolated rate */
+static const double *get_table(int phases, int step, int taps, double cutoff)
 {
+	samplerate_table_t *table;
+	int ntaps = phases * taps, p, j, k;
+	double *h, t, sum;
+
+	for (table = table_list; table; table = table->next) {
+		if (table->phases == phases && table->step == step && table->taps == taps)
+			return table->coeff;
+	}
+
+	table = calloc(1, sizeof(*table));
+	if (!table) {
+		fprintf(stderr, "No mem!\n");
+		return NULL;
+	}
+	table->coeff = calloc(ntaps, sizeof(*table->coeff));
+	h = calloc(ntaps, sizeof(*h));
+	if (!table->coeff || !h) {
+		fprintf(stderr, "No mem!\n");
+		free(h);
+		free(table->coeff);
+		free(table);
+		return NULL;
+	}
+	table->phases = phases;
+	table->step = step;
+	table->taps = taps;
+
+	/* sinc with blackman window */
+	sum = 0;
+	for (k = 0; k < ntaps; k++) {
+		t = (double)k - (double)(ntaps - 1) / 2.0;
+		if (t == 0.0)
+			h[k] = 2.0 * cutoff;
+		else
+			h[k] = sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+		h[k] *= 0.42 - 0.5 * cos(2.0 * M_PI * (double)k / (double)(ntaps - 1))
+			+ 0.08 * cos(4.0 * M_PI * (double)k / (double)(ntaps - 1));
+		sum += h[k];
+	}
+
+	/* each branch gets every 'phases'th tap, oldest sample first. the gain
+	 * compensates the inserted zeros. */
+	for (p = 0; p < phases; p++) {
+		for (j = 0; j < taps; j++)
+			table->coeff[p * taps + j] = h[p + (taps - 1 - j) * phases] * (double)phases / sum;
+	}
+	free(h);
+
+	table->next = table_list;
+	table_list = table;
+
+	return table->coeff;
+}
+
+static int poly_init(samplerate_poly_t *poly, int phases, int step, double in_samplerate, double pass, double low_samplerate)
+{
+	double interpolated = in_samplerate * (double)phases;
+	double tb = low_samplerate - 2.0 * pass;
+	int taps;
+
+	/* a blackman window needs about 5.5 / transition band taps for 70 dB */
+	taps = ceil(5.5 * interpolated / tb / (double)phases);
+	if (taps > SAMPLERATE_MAX_TAPS)
+		taps = SAMPLERATE_MAX_TAPS;
+	if (taps < 2)
+		taps = 2;
+
+	poly->phases = phases;
+	poly->step = step;
+	poly->taps = taps;
+	/* stop band starts at low_samplerate - pass, so -6 dB is at half of low_samplerate */
+	poly->coeff = get_table(phases, step, taps, low_samplerate / 2.0 / interpolated);
+	if (!poly->coeff)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static inline void poly_push(samplerate_poly_t *poly, sample_t sample)
+{
+	poly->hist[poly->hist_pos] = sample;
+	poly->hist[poly->hist_pos + poly->taps] = sample;
+	if (++poly->hist_pos == poly->taps)
+		poly->hist_pos = 0;
+}
+
+static inline sample_t poly_output(samplerate_poly_t *poly)
+{
+	const double *coeff = poly->coeff + poly->phase * poly->taps;
+	const sample_t *x = poly->hist + poly->hist_pos;
+	double y = 0;
+	int j;
+
+	for (j = 0; j < poly->taps; j++)
+		y += x[j] * coeff[j];
+
+	return y;
+}
+
+int init_samplerate(samplerate_t *state, double low_samplerate, double high_samplerate, double filter_cutoff, int mode)
+{
+	int phases, step, exact;
+	double pass;
+	int rc;
+
 	memset(state, 0, sizeof(*state));
 	state->factor = high_samplerate / low_samplerate;
 	if (state->factor < 1.0) {
@@ -34,7 +189,47 @@ int init_samplerate(samplerate_t *state, double low_samplerate, double high_samp
 		abort();
 	}
 
+	exact = (rational_ratio(state->factor, &phases, &step) == 0);
+	if (mode == SAMPLERATE_POLYPHASE && !exact) {
+		fprintf(stderr, "Sample rate ratio %.6f cannot be used for polyphase resampler, using linear interpolation.\n", state->factor);
+		mode = SAMPLERATE_LINEAR;
+	}
+	state->mode = mode;
+
 	state->filter_cutoff = filter_cutoff;
+	if (state->mode == SAMPLERATE_POLYPHASE) {
+		/* the pass band is limited, so that there is a transition band below the nyquist frequency */
+		pass = 0.45 * low_samplerate;
+		if (filter_cutoff && filter_cutoff < pass)
+			pass = filter_cutoff;
+		/* up: interpolate by high/low, down: interpolate by low/high */
+		rc = poly_init(&state->up.poly, phases, step, low_samplerate, pass, low_samplerate);
+		if (rc < 0)
+			return rc;
+		rc = poly_init(&state->down.poly, step, phases, high_samplerate, pass, low_samplerate);
+		if (rc < 0)
+			return rc;
+		/* first input must be stored before output can be calculated */
+		state->down.poly.phase = state->down.poly.phases;
+		return 0;
+	}
+
+	/* The input index is counted in fractions of an input sample, so it
+	 * does not drift. If the ratio is not rational, the fraction is 2^-32,
+	 * so the error of the ratio is less than 1e-9.
+	 */
+	if (exact) {
+		state->up.den = phases;
+		state->up.step = step;
+		state->down.den = step;
+		state->down.step = phases;
+	} else {
+		state->up.den = 1ULL << 32;
+		state->up.step = llround((double)(1ULL << 32) / state->factor);
+		state->down.den = 1ULL << 32;
+		state->down.step = llround((double)(1ULL << 32) * state->factor);
+	}
+
 	if (state->filter_cutoff) {
 		iir_lowpass_init(&state->up.lp, filter_cutoff, high_samplerate, 2);
 		iir_lowpass_init(&state->down.lp, filter_cutoff, high_samplerate, 2);
@@ -43,14 +238,36 @@ int init_samplerate(samplerate_t *state, double low_samplerate, double high_samp
 	return 0;
 }
 
+static int poly_downsample(samplerate_poly_t *poly, sample_t *samples, int input_num)
+{
+	int output_num = 0, i;
+
+	/* output index never exceeds input index, so it can be done in place */
+	for (i = 0; i < input_num; i++) {
+		poly_push(poly, samples[i]);
+		poly->phase -= poly->phases;
+		while (poly->phase < poly->phases) {
+			samples[output_num++] = poly_output(poly);
+			poly->phase += poly->step;
+		}
+	}
+
+	return output_num;
+}
+
 /* convert high sample rate to low sample rate */
 int samplerate_downsample(samplerate_t *state, sample_t *samples, int input_num)
 {
 	int output_num = 0, i, idx;
-	double factor = state->factor, in_index, diff;
-	sample_t output[(int)((double)input_num / factor + 0.5) + 10]; /* add some safety */
+	uint64_t den = state->down.den, step = state->down.step, in_index;
+	double diff;
 	sample_t last_sample;
 
+	if (state->mode == SAMPLERATE_POLYPHASE)
+		return poly_downsample(&state->down.poly, samples, input_num);
+
+	sample_t output[(int)((double)input_num / state->factor + 0.5) + 10]; /* add some safety */
+
 	/* filter down */
 	if (state->filter_cutoff)
 		iir_process(&state->down.lp, samples, input_num);
@@ -63,12 +280,12 @@ int samplerate_downsample(samplerate_t *state, sample_t *samples, int input_num)
 
 	for (i = 0; ; i++) {
 		/* convert index to int */
-		idx = (int)in_index;
+		idx = in_index / den;
 		/* if index is outside input sample range, we are done */
 		if (idx >= input_num)
 			break;
 		/* linear interpolation */
-		diff = in_index - (double)idx;
+		diff = (double)(in_index % den) / (double)den;
 		if (idx)
 			output[i] = samples[idx - 1] * (1.0 - diff) + samples[idx] * diff;
 		else
@@ -76,18 +293,15 @@ int samplerate_downsample(samplerate_t *state, sample_t *samples, int input_num)
 		/* count output number */
 		output_num++;
 		/* increment input index */
-		in_index += factor;
+		in_index += step;
 	}
 
 	/* store last sample for interpolation */
 	if (input_num)
 		state->down.last_sample = samples[input_num - 1];
 
-	/* remove number of input samples from index */
-	in_index -= (double)input_num;
-	/* in_index cannot be negative, except due to rounding error, so... */
-	if ((int)in_index < 0)
-		in_index = 0.0;
+	/* remove number of input samples from index, it is never negative */
+	in_index -= (uint64_t)input_num * den;
 
 	state->down.in_index = in_index;
 
@@ -98,55 +312,104 @@ int samplerate_downsample(samplerate_t *state, sample_t *samples, int input_num)
 	return output_num;
 }
 
-int samplerate_upsample_input_num(samplerate_t *state, int output_num)
+/* number of inputs that are stored while generating output_num samples */
+static int inputs_passed(uint64_t index, uint64_t den, uint64_t step, int output_num)
 {
-	double factor = 1.0 / state->factor, in_index;
-	int idx = 0;
+	return (index + (uint64_t)output_num * step) / den;
+}
 
-	/* count output */
-	in_index = state->up.in_index;
+/* number of outputs until input_num samples are stored */
+static int outputs_until(uint64_t index, uint64_t den, uint64_t step, int input_num)
+{
+	uint64_t need = (uint64_t)input_num * den;
 
-	while (output_num--) {
-		/* increment input index */
-		in_index += factor;
-		/* count index on overflow */
-		if (in_index >= 1.0) {
-			idx++;
-			in_index -= 1.0;
-		}
-	}
+	if (need <= index)
+		return 0;
+	return (need - index + step - 1) / step;
+}
 
-	return idx;
+int samplerate_upsample_input_num(samplerate_t *state, int output_num)
+{
+	samplerate_poly_t *poly = &state->up.poly;
+
+	if (state->mode == SAMPLERATE_POLYPHASE)
+		return inputs_passed(poly->phase, poly->phases, poly->step, output_num);
+	return inputs_passed(state->up.in_index, state->up.den, state->up.step, output_num);
 }
 
 int samplerate_upsample_output_num(samplerate_t *state, int input_num)
 {
-	double factor = 1.0 / state->factor, in_index;
-	int output_num = 0, idx = 0;
+	samplerate_poly_t *poly = &state->up.poly;
 
-	/* count output */
-	in_index = state->up.in_index;
+	if (state->mode == SAMPLERATE_POLYPHASE)
+		return outputs_until(poly->phase, poly->phases, poly->step, input_num);
+	return outputs_until(state->up.in_index, state->up.den, state->up.step, input_num);
+}
 
-	while (idx < input_num) {
-		/* count output number */
-		output_num++;
-		/* increment input index */
-		in_index += factor;
-		/* count index on overflow */
-		if (in_index >= 1.0) {
-			idx++;
-			in_index -= 1.0;
+static void poly_upsample(samplerate_poly_t *poly, sample_t *input, int input_num, sample_t *samples, int output_num)
+{
+	int i, idx = 0;
+
+	for (i = 0; i < output_num; i++) {
+		samples[i] = poly_output(poly);
+		poly->phase += poly->step;
+		/* store next input samples after the phase has passed them */
+		while (poly->phase >= poly->phases) {
+			if (idx == input_num) {
+				fprintf(stderr, "Given input_num is too small, please fix!\n");
+				poly->phase -= poly->phases;
+				continue;
+			}
+			poly_push(poly, input[idx++]);
+			poly->phase -= poly->phases;
 		}
 	}
+	if (idx < input_num) {
+		fprintf(stderr, "Given input_num is too large, please fix!\n");
+		abort();
+	}
+}
 
-	return output_num;
+/* convert int16 samples at low sample rate to high sample rate
+ * with polyphase mode, each input is scaled when it is stored into the
+ * filter history, so no converted copy of the input is required */
+void samplerate_upsample_int16(samplerate_t *state, const int16_t *input, int input_num, double factor, sample_t *output, int output_num)
+{
+	samplerate_poly_t *poly = &state->up.poly;
+	int i, idx = 0;
+
+	if (state->mode != SAMPLERATE_POLYPHASE) {
+		sample_t samples[input_num];
+		int16_to_samples_scale(samples, input, 1, input_num, factor);
+		samplerate_upsample(state, samples, input_num, output, output_num);
+		return;
+	}
+
+	for (i = 0; i < output_num; i++) {
+		output[i] = poly_output(poly);
+		poly->phase += poly->step;
+		while (poly->phase >= poly->phases) {
+			if (idx == input_num) {
+				fprintf(stderr, "Given input_num is too small, please fix!\n");
+				poly->phase -= poly->phases;
+				continue;
+			}
+			poly_push(poly, (sample_t)input[idx++] * factor);
+			poly->phase -= poly->phases;
+		}
+	}
+	if (idx < input_num) {
+		fprintf(stderr, "Given input_num is too large, please fix!\n");
+		abort();
+	}
 }
 
 /* convert low sample rate to high sample rate */
 void samplerate_upsample(samplerate_t *state, sample_t *input, int input_num, sample_t *output, int output_num)
 {
 	int i, idx;
-	double factor = 1.0 / state->factor, in_index;
+	uint64_t den = state->up.den, step = state->up.step, in_index;
+	double diff;
 	sample_t buff[output_num];
 	sample_t *samples, current_sample, last_sample;
 
@@ -159,23 +422,30 @@ void samplerate_upsample(samplerate_t *state, sample_t *input, int input_num, sa
 	else
 		samples = output;
 
+	if (state->mode == SAMPLERATE_POLYPHASE) {
+		poly_upsample(&state->up.poly, input, input_num, samples, output_num);
+		goto copy;
+	}
+
 	/* resample input */
 	in_index = state->up.in_index;
 	idx = 0;
 
 	for (i = 0; i < output_num; i++) {
 		/* linear interpolation */
-		samples[i] = last_sample * (1.0 - in_index) + current_sample * in_index;
+		diff = (double)in_index / (double)den;
+		samples[i] = last_sample * (1.0 - diff) + current_sample * diff;
 		/* increment input index */
-		in_index += factor;
+		in_index += step;
 		/* get next sample on overflow */
-		if (in_index >= 1.0) {
+		if (in_index >= den) {
 			if (idx == input_num) {
 				fprintf(stderr, "Given input_num is too small, please fix!\n");
+			} else {
+				last_sample = current_sample;
+				current_sample = input[idx++];
 			}
-			last_sample = current_sample;
-			current_sample = input[idx++];
-			in_index -= 1.0;
+			in_index -= den;
 		}
 	}
 	if (idx < input_num) {
@@ -192,10 +462,10 @@ void samplerate_upsample(samplerate_t *state, sample_t *input, int input_num, sa
 	if (state->filter_cutoff)
 		iir_process(&state->up.lp, samples, output_num);
 
+copy:
 	if (input == output) {
 		/* copy samples */
 		for (i = 0; i < output_num; i++)
 			*output++ = samples[i];
 	}
 }
-
@@ -1,23 +1,46 @@
 #include "../libfilter/iir_filter.h"
 
+#define SAMPLERATE_LINEAR	0	/* IIR low-pass and linear interpolation */
+#define SAMPLERATE_POLYPHASE	1	/* polyphase FIR low-pass at rational ratio */
+
+#define SAMPLERATE_MAX_PHASES	4096	/* maximum interpolation or decimation factor */
+#define SAMPLERATE_MAX_TAPS	256	/* maximum taps of each polyphase branch */
+
+/* polyphase resampler, from input rate to input rate * phases / step */
+typedef struct samplerate_poly {
+	int phases;		/* interpolation factor = number of branches */
+	int step;		/* decimation factor */
+	int taps;		/* taps of each branch */
+	const double *coeff;	/* branches, shared by all resamplers with same ratio */
+	int phase;		/* position of next output after newest input, in 1/phases of input samples */
+	sample_t hist[SAMPLERATE_MAX_TAPS * 2]; /* input history, stored twice to avoid wrapping */
+	int hist_pos;
+} samplerate_poly_t;
+
 typedef struct samplerate {
+	int mode;
 	double factor;
 	double filter_cutoff;
 	struct {
 		iir_filter_t lp;
 		sample_t last_sample;
-		double in_index;
+		uint64_t in_index;	/* position of next output in input samples, in 1/den */
+		uint64_t den, step;	/* index increment per output is step/den */
+		samplerate_poly_t poly;
 	} down;
 	struct {
 		iir_filter_t lp;
 		sample_t current_sample;
 		sample_t last_sample;
-		double in_index;
+		uint64_t in_index;	/* position of next output between last and current sample, in 1/den */
+		uint64_t den, step;
+		samplerate_poly_t poly;
 	} up;
 } samplerate_t;
 
-int init_samplerate(samplerate_t *state, double low_samplerate, double high_samplerate, double filter_cutoff);
+int init_samplerate(samplerate_t *state, double low_samplerate, double high_samplerate, double filter_cutoff, int mode);
 int samplerate_downsample(samplerate_t *state, sample_t *samples, int input_num);
 int samplerate_upsample_input_num(samplerate_t *state, int output_num);
 int samplerate_upsample_output_num(samplerate_t *state, int input_num);
 void samplerate_upsample(samplerate_t *state, sample_t *input, int input_num, sample_t *output, int output_num);
+void samplerate_upsample_int16(samplerate_t *state, const int16_t *input, int input_num, double factor, sample_t *output, int output_num);
@@ -17,9 +17,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdint.h>
 #include <math.h>
 #include "../libsample/sample.h"
+#include "../liblogging/logging.h"
 #include "scrambler.h"
 
 #define PI		M_PI
@@ -35,6 +37,10 @@
  * The filter must be tuned to get that loss. */
 #define TEST_1000HZ_DB	55.0
 
+/* If the carrier repeats after a few samples, one period is precomputed. The
+ * carrier frequency may then be off by this value. */
+#define PERIOD_TOLERANCE_HZ	0.5
+
 /* sine wave for carrier to modulate to */
 static double carrier[65536];
 
@@ -50,8 +56,49 @@ void scrambler_init(void)
 
 void scrambler_setup(scrambler_t *scrambler, int samplerate)
 {
+	int p, cycles, i;
+
 	iir_lowpass_init(&scrambler->lp, CARRIER_HZ - FILTER_BELOW, samplerate, FILTER_TURNS);
 	scrambler->carrier_phaseshift65536 = 65536.0 / ((double)samplerate / CARRIER_HZ);
+
+	/* find the shortest number of samples that hold whole cycles of the carrier */
+	scrambler->period = 0;
+	scrambler->period_pos = 0;
+	for (p = 1; p <= SCRAMBLER_PERIOD_MAX; p++) {
+		cycles = (int)round((double)p * CARRIER_HZ / (double)samplerate);
+		if (cycles && fabs((double)cycles * (double)samplerate / (double)p - CARRIER_HZ) < PERIOD_TOLERANCE_HZ)
+			break;
+	}
+	if (p > SCRAMBLER_PERIOD_MAX) {
+		LOGP(DDSP, LOGL_DEBUG, "Carrier of scrambler does not repeat within %d samples at %d Hz, using phase accumulator.\n", SCRAMBLER_PERIOD_MAX, samplerate);
+		return;
+	}
+	for (i = 0; i < p; i++)
+		scrambler->period_carrier[i] = sin(2.0 * PI * (double)cycles * (double)i / (double)p) * 2.0;
+	scrambler->period = p;
+	LOGP(DDSP, LOGL_DEBUG, "Carrier of scrambler repeats after %d samples (%d cycles) at %d Hz.\n", p, cycles, samplerate);
+}
+
+/* Multiply by the precomputed period of carrier. Each run up to the end of
+ * the period is a loop that the compiler vectorizes.
+ */
+static void modulate_period(scrambler_t *scrambler, sample_t *samples, int length)
+{
+	const sample_t *carrier = scrambler->period_carrier;
+	int pos = scrambler->period_pos, n, i;
+
+	for (; length > 0; length -= n, samples += n) {
+		n = scrambler->period - pos;
+		if (n > length)
+			n = length;
+		for (i = 0; i < n; i++)
+			samples[i] *= carrier[pos + i];
+		pos += n;
+		if (pos == scrambler->period)
+			pos = 0;
+	}
+
+	scrambler->period_pos = pos;
 }
 
 /* Modulate samples to carriere that is twice the mirror frequency.
@@ -63,6 +110,11 @@ void scrambler(scrambler_t *scrambler, sample_t *samples, int length)
 	double phaseshift, phase;
 	int i;
 
+	if (scrambler->period) {
+		modulate_period(scrambler, samples, length);
+		goto filter;
+	}
+
 	phaseshift = scrambler->carrier_phaseshift65536;
 	phase = scrambler->carrier_phase65536;
 
@@ -76,6 +128,7 @@ void scrambler(scrambler_t *scrambler, sample_t *samples, int length)
 
 	scrambler->carrier_phase65536 = phase;
 
+filter:
 	/* cut off carrier frequency and modulation above carrier frequency */
 	iir_process(&scrambler->lp, samples, length);
 }
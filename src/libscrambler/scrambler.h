@@ -1,8 +1,14 @@
 #include "../libfilter/iir_filter.h"
 
+/* longest period of carrier to precompute */
+#define SCRAMBLER_PERIOD_MAX	512
+
 typedef struct scrambler {
 	double		carrier_phaseshift65536;/* carrier phase shift per sample */
 	double		carrier_phase65536;	/* current phase of carrier frequency */
+	int		period;			/* samples of one period of carrier, 0 if not precomputed */
+	int		period_pos;		/* current position in period */
+	sample_t	period_carrier[SCRAMBLER_PERIOD_MAX]; /* carrier of one period */
 	iir_filter_t	lp;			/* filter to remove carrier frequency */
 } scrambler_t;
 
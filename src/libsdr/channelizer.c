@@ -0,0 +1,538 @@
+/* Polyphase filter bank channelizer
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* How it works (RX):
+ *
+ * The IQ spectrum is split into 'bins' equally spaced sub bands, using one
+ * prototype low-pass filter and one FFT for all sub bands. The filter is
+ * split into 'bins' polyphase branches. Every 'decimation' input samples,
+ * the history of input samples is weighted by the branches and folded into
+ * the FFT buffer. An inverse FFT then gives the output of all sub bands at
+ * once. Each sub band is shifted to base band by a rotation vector.
+ *
+ * We use a decimation of half the number of bins (2 times oversampled), so
+ * that a channel can be located anywhere inside a bin: The prototype filter
+ * has its cut-off at the border of the neighbor bins, so the channel's
+ * bandwidth passes, even if the channel is located at the edge of its bin.
+ * Aliasing only falls outside of the channel's bandwidth.
+ *
+ * The channel's demodulator then runs at the reduced sample rate, including
+ * the residual offset between channel and bin center. The demodulated
+ * signal is converted back to full rate by linear interpolation.
+ *
+ * How it works (TX):
+ *
+ * The audio of each channel is decimated to the channel rate by averaging
+ * 'decimation' samples. (The phase of the FM modulator is the integral of
+ * the frequency, so it is exact at the decimated sample points.) Then each
+ * channel is modulated at channel rate with its residual offset. The
+ * synthesis filter bank places each channel's base band into its bin, does
+ * one inverse FFT for all bins and distributes the result over the
+ * polyphase branches of the prototype filter (overlap-add). The result is
+ * delayed by one decimation period, so that every call returns exactly the
+ * number of samples that were given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "../libsample/sample.h"
+#include "../libfft/fft.h"
+#include "../liblogging/logging.h"
+#include "channelizer.h"
+#ifdef HAVE_OPENCL
+#include "channelizer_cl.h"
+#endif
+
+/* limits of filter bank */
+#define PFB_MIN_BINS		4
+#define PFB_MAX_BINS		1024
+#define PFB_MIN_TAPS_PER_BIN	4
+
+/* generate prototype filter: windowed sinc with cut-off at 'cutoff' (normalized to sample rate) */
+static void pfb_kernel(double *taps, int ntaps, double cutoff)
+{
+	double sum, x;
+	int i;
+
+	for (i = 0; i < ntaps; i++) {
+		x = (double)i - (double)(ntaps - 1) / 2.0;
+		/* gen sinc */
+		if (x == 0.0)
+			taps[i] = 2.0 * cutoff;
+		else
+			taps[i] = sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+		/* blackman window */
+		taps[i] *= 0.42 - 0.50 * cos(2.0 * M_PI * (double)i / (double)(ntaps - 1))
+				+ 0.08 * cos(4.0 * M_PI * (double)i / (double)(ntaps - 1));
+	}
+
+	/* normalize, so DC has a gain of 1 */
+	sum = 0.0;
+	for (i = 0; i < ntaps; i++)
+		sum += taps[i];
+	for (i = 0; i < ntaps; i++)
+		taps[i] /= sum;
+}
+
+/* find the largest number of bins, so that the transition band is at least
+ * half of a bin, then get the number of taps for the transition band
+ *
+ * bandwidth is the bandwidth of each channel (both side bands)
+ * returns -EINVAL, if channels are too wide for a filter bank to make sense */
+static int pfb_design(double samplerate, double bandwidth, int *m_p, int *bins_p, int *taps_per_bin_p)
+{
+	double transition;
+	int bins, m, taps_per_bin;
+
+	if (bandwidth <= 0.0) {
+		LOGP(DSDR, LOGL_NOTICE, "No channel bandwidth given, cannot use channelizer.\n");
+		return -EINVAL;
+	}
+
+	for (m = 0, bins = 1; bins * 2 <= PFB_MAX_BINS && (double)(bins * 2) <= 0.5 * samplerate / bandwidth; m++, bins *= 2);
+	if (bins < PFB_MIN_BINS) {
+		LOGP(DSDR, LOGL_NOTICE, "Channel bandwidth of %.0f Hz is too large for channelizer at sample rate of %.0f Hz.\n", bandwidth, samplerate);
+		return -EINVAL;
+	}
+
+	/* transition band (relative to bin spacing) between pass band edge and alias band */
+	transition = 1.0 - bandwidth * (double)bins / samplerate;
+	taps_per_bin = (int)ceil(5.5 / transition);
+	if (taps_per_bin < PFB_MIN_TAPS_PER_BIN)
+		taps_per_bin = PFB_MIN_TAPS_PER_BIN;
+
+	*m_p = m;
+	*bins_p = bins;
+	*taps_per_bin_p = taps_per_bin;
+
+	return 0;
+}
+
+/* rotation to shift bin 'k' at output 'n' to base band: exp(-j * 2pi * k * n * decimation / bins) */
+static void pfb_rotation(double *rot_i, double *rot_q, int bins)
+{
+	int i;
+
+	for (i = 0; i < bins; i++) {
+		rot_i[i] = cos(2.0 * M_PI * (double)i / (double)bins);
+		rot_q[i] = -sin(2.0 * M_PI * (double)i / (double)bins);
+	}
+}
+
+/* get bin of channel and residual offset between channel and bin center */
+static int pfb_assign(double samplerate, int bins, double offset, double *residual)
+{
+	int k = (int)round(offset * (double)bins / samplerate);
+
+	*residual = offset - (double)k * samplerate / (double)bins;
+	if (k < 0)
+		k += bins;
+
+	return k;
+}
+
+/* init analysis filter bank for the given channel offsets */
+int pfb_analysis_init(pfb_analysis_t *pfb, double samplerate, double bandwidth, double *offset, int channels)
+{
+	int c;
+	int rc;
+
+	memset(pfb, 0, sizeof(*pfb));
+
+	rc = pfb_design(samplerate, bandwidth, &pfb->m, &pfb->bins, &pfb->taps_per_bin);
+	if (rc < 0)
+		return rc;
+	pfb->decimation = pfb->bins / 2;
+	pfb->samplerate = samplerate;
+	pfb->chan_samplerate = samplerate / (double)pfb->decimation;
+	pfb->ntaps = pfb->taps_per_bin * pfb->bins;
+	pfb->channels = channels;
+
+	LOGP(DSDR, LOGL_INFO, "RX channelizer uses %d bins with %d taps each, channel sample rate is %.0f Hz.\n", pfb->bins, pfb->taps_per_bin, pfb->chan_samplerate);
+
+	pfb->taps = calloc(pfb->ntaps, sizeof(*pfb->taps));
+	pfb->hist_i = calloc(pfb->ntaps * 2, sizeof(*pfb->hist_i));
+	pfb->hist_q = calloc(pfb->ntaps * 2, sizeof(*pfb->hist_q));
+	pfb->fft_i = calloc(pfb->bins, sizeof(*pfb->fft_i));
+	pfb->fft_q = calloc(pfb->bins, sizeof(*pfb->fft_q));
+	pfb->rot_i = calloc(pfb->bins, sizeof(*pfb->rot_i));
+	pfb->rot_q = calloc(pfb->bins, sizeof(*pfb->rot_q));
+	pfb->chan = calloc(channels, sizeof(*pfb->chan));
+	if (!pfb->taps || !pfb->hist_i || !pfb->hist_q || !pfb->fft_i || !pfb->fft_q || !pfb->rot_i || !pfb->rot_q || !pfb->chan) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		rc = -ENOMEM;
+		goto error;
+	}
+
+	/* cut-off at the bin spacing, so pass band covers the whole bin plus half of the channel */
+	pfb_kernel(pfb->taps, pfb->ntaps, 1.0 / (double)pfb->bins);
+
+	pfb_rotation(pfb->rot_i, pfb->rot_q, pfb->bins);
+
+	/* assign channels to bins */
+	for (c = 0; c < channels; c++) {
+		pfb->chan[c].bin = pfb_assign(samplerate, pfb->bins, offset[c], &pfb->chan[c].residual);
+		LOGP(DSDR, LOGL_DEBUG, "RX channel #%d: bin %d, residual offset %.0f Hz\n", c, pfb->chan[c].bin, pfb->chan[c].residual);
+	}
+
+	return 0;
+
+error:
+	pfb_analysis_exit(pfb);
+	return rc;
+}
+
+void pfb_analysis_exit(pfb_analysis_t *pfb)
+{
+#ifdef HAVE_OPENCL
+	pfb_cl_analysis_exit(pfb);
+#endif
+	free(pfb->taps);
+	free(pfb->hist_i);
+	free(pfb->hist_q);
+	free(pfb->fft_i);
+	free(pfb->fft_q);
+	free(pfb->rot_i);
+	free(pfb->rot_q);
+	free(pfb->chan);
+	memset(pfb, 0, sizeof(*pfb));
+}
+
+/* run filter bank on GPU, max_num is the maximum number of samples processed at once
+ *
+ * returns -ENOTSUP, if not compiled with OpenCL, the CPU is used then */
+int pfb_analysis_gpu(pfb_analysis_t __attribute__((unused)) *pfb, int __attribute__((unused)) max_num)
+{
+#ifdef HAVE_OPENCL
+	return pfb_cl_analysis_init(pfb, max_num);
+#else
+	LOGP(DSDR, LOGL_NOTICE, "Not compiled with OpenCL support.\n");
+	return -ENOTSUP;
+#endif
+}
+
+/* maximum number of output samples per channel, when processing 'num' input samples */
+int pfb_analysis_max_output(pfb_analysis_t *pfb, int num)
+{
+	return num / pfb->decimation + 1;
+}
+
+/* move channel to another offset, e.g. to a carrier that was found by scanning
+ *
+ * returns -ENOTSUP, if the filter bank runs on GPU, because the bins are uploaded once */
+int pfb_analysis_tune(pfb_analysis_t *pfb, int c, double offset)
+{
+	if (pfb->cl)
+		return -ENOTSUP;
+
+	pfb->chan[c].bin = pfb_assign(pfb->samplerate, pfb->bins, offset, &pfb->chan[c].residual);
+	pfb->chan[c].last[0] = pfb->chan[c].last[1] = 0.0;
+	LOGP(DSDR, LOGL_DEBUG, "RX channel #%d: bin %d, residual offset %.0f Hz\n", c, pfb->chan[c].bin, pfb->chan[c].residual);
+
+	return 0;
+}
+
+/* split baseband into channels; returns number of samples written to each chan_baseband */
+int pfb_analysis_process(pfb_analysis_t *pfb, float *baseband, int num, float **chan_baseband)
+{
+	int ntaps = pfb->ntaps, bins = pfb->bins, decimation = pfb->decimation;
+	double *taps = pfb->taps, *hist_i = pfb->hist_i, *hist_q = pfb->hist_q;
+	double *fft_i = pfb->fft_i, *fft_q = pfb->fft_q;
+	double *h_i, *h_q, *t, vi, vq, ri, rq;
+	int pos = pfb->hist_pos, phase = pfb->phase;
+	int s, r, l, c, k, count = 0;
+
+#ifdef HAVE_OPENCL
+	if (pfb->cl)
+		return pfb_cl_analysis_process(pfb, baseband, num, chan_baseband);
+#endif
+
+	pfb->block_phase = phase;
+
+	for (s = 0; s < num; s++) {
+		/* store sample twice, so that history is continuous from 'pos' */
+		if (--pos < 0)
+			pos = ntaps - 1;
+		hist_i[pos] = hist_i[pos + ntaps] = *baseband++;
+		hist_q[pos] = hist_q[pos + ntaps] = *baseband++;
+		if (++phase < decimation)
+			continue;
+		phase = 0;
+
+		/* fold history into polyphase branches */
+		h_i = hist_i + pos;
+		h_q = hist_q + pos;
+		for (r = 0; r < bins; r++) {
+			vi = vq = 0.0;
+			t = taps + r;
+			for (l = 0; l < ntaps; l += bins) {
+				vi += t[l] * h_i[r + l];
+				vq += t[l] * h_q[r + l];
+			}
+			fft_i[r] = vi;
+			fft_q[r] = vq;
+		}
+
+		/* inverse FFT gives all bins at once */
+		fft_process(-1, pfb->m, fft_i, fft_q);
+
+		/* shift each channel's bin into base band */
+		for (c = 0; c < pfb->channels; c++) {
+			k = pfb->chan[c].bin;
+			r = (k * pfb->rot_pos) % bins;
+			ri = pfb->rot_i[r];
+			rq = pfb->rot_q[r];
+			chan_baseband[c][count * 2] = fft_i[k] * ri - fft_q[k] * rq;
+			chan_baseband[c][count * 2 + 1] = fft_i[k] * rq + fft_q[k] * ri;
+		}
+		pfb->rot_pos = (pfb->rot_pos + decimation) % bins;
+		count++;
+	}
+
+	pfb->hist_pos = pos;
+	pfb->phase = phase;
+
+	return count;
+}
+
+/* convert demodulated channel samples of last processed block back to full rate
+ *
+ * 'in' holds the demodulated samples of the channel, 'num' is the number of
+ * input samples of the last block processed by pfb_analysis_process() */
+void pfb_analysis_interpolate(pfb_analysis_t *pfb, int c, sample_t *in, sample_t *out, int num)
+{
+	int decimation = pfb->decimation;
+	int phase = pfb->block_phase;
+	double prev = pfb->chan[c].last[0];
+	double cur = pfb->chan[c].last[1];
+	int s;
+
+	for (s = 0; s < num; s++) {
+		if (++phase == decimation) {
+			phase = 0;
+			prev = cur;
+			cur = *in++;
+		}
+		/* ramp from previous to current output over one decimation period */
+		out[s] = prev + (cur - prev) * (double)phase / (double)decimation;
+	}
+
+	pfb->chan[c].last[0] = prev;
+	pfb->chan[c].last[1] = cur;
+}
+
+/* init synthesis filter bank for the given channel offsets
+ *
+ * max_num is the maximum number of samples processed at once */
+int pfb_synthesis_init(pfb_synthesis_t *pfb, double samplerate, double bandwidth, double *offset, int channels, int max_num)
+{
+	int c, i;
+	int rc;
+
+	memset(pfb, 0, sizeof(*pfb));
+
+	rc = pfb_design(samplerate, bandwidth, &pfb->m, &pfb->bins, &pfb->taps_per_bin);
+	if (rc < 0)
+		return rc;
+	pfb->decimation = pfb->bins / 2;
+	pfb->samplerate = samplerate;
+	pfb->chan_samplerate = samplerate / (double)pfb->decimation;
+	pfb->ntaps = pfb->taps_per_bin * pfb->bins;
+	pfb->channels = channels;
+
+	LOGP(DSDR, LOGL_INFO, "TX channelizer uses %d bins with %d taps each, channel sample rate is %.0f Hz.\n", pfb->bins, pfb->taps_per_bin, pfb->chan_samplerate);
+
+	pfb->taps = calloc(pfb->ntaps, sizeof(*pfb->taps));
+	pfb->acc_i = calloc(pfb->ntaps, sizeof(*pfb->acc_i));
+	pfb->acc_q = calloc(pfb->ntaps, sizeof(*pfb->acc_q));
+	pfb->fft_i = calloc(pfb->bins, sizeof(*pfb->fft_i));
+	pfb->fft_q = calloc(pfb->bins, sizeof(*pfb->fft_q));
+	pfb->rot_i = calloc(pfb->bins, sizeof(*pfb->rot_i));
+	pfb->rot_q = calloc(pfb->bins, sizeof(*pfb->rot_q));
+	pfb->fifo = calloc((max_num + pfb->decimation * 2) * 2, sizeof(*pfb->fifo));
+	pfb->chan = calloc(channels, sizeof(*pfb->chan));
+	if (!pfb->taps || !pfb->acc_i || !pfb->acc_q || !pfb->fft_i || !pfb->fft_q || !pfb->rot_i || !pfb->rot_q || !pfb->fifo || !pfb->chan) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		rc = -ENOMEM;
+		goto error;
+	}
+
+	/* same prototype as RX, but with gain of decimation factor, to compensate interpolation */
+	pfb_kernel(pfb->taps, pfb->ntaps, 1.0 / (double)pfb->bins);
+	for (i = 0; i < pfb->ntaps; i++)
+		pfb->taps[i] *= (double)pfb->decimation;
+
+	pfb_rotation(pfb->rot_i, pfb->rot_q, pfb->bins);
+
+	/* initial delay of one decimation period */
+	pfb->fifo_fill = pfb->decimation;
+
+	/* assign channels to bins */
+	for (c = 0; c < channels; c++) {
+		pfb->chan[c].bin = pfb_assign(samplerate, pfb->bins, offset[c], &pfb->chan[c].residual);
+		LOGP(DSDR, LOGL_DEBUG, "TX channel #%d: bin %d, residual offset %.0f Hz\n", c, pfb->chan[c].bin, pfb->chan[c].residual);
+	}
+
+	return 0;
+
+error:
+	pfb_synthesis_exit(pfb);
+	return rc;
+}
+
+void pfb_synthesis_exit(pfb_synthesis_t *pfb)
+{
+#ifdef HAVE_OPENCL
+	pfb_cl_synthesis_exit(pfb);
+#endif
+	free(pfb->taps);
+	free(pfb->acc_i);
+	free(pfb->acc_q);
+	free(pfb->fft_i);
+	free(pfb->fft_q);
+	free(pfb->rot_i);
+	free(pfb->rot_q);
+	free(pfb->fifo);
+	free(pfb->chan);
+	memset(pfb, 0, sizeof(*pfb));
+}
+
+/* run filter bank on GPU, max_num is the maximum number of samples processed at once
+ *
+ * returns -ENOTSUP, if not compiled with OpenCL, the CPU is used then */
+int pfb_synthesis_gpu(pfb_synthesis_t __attribute__((unused)) *pfb, int __attribute__((unused)) max_num)
+{
+#ifdef HAVE_OPENCL
+	return pfb_cl_synthesis_init(pfb, max_num);
+#else
+	LOGP(DSDR, LOGL_NOTICE, "Not compiled with OpenCL support.\n");
+	return -ENOTSUP;
+#endif
+}
+
+/* maximum number of channel samples, when processing 'num' samples */
+int pfb_synthesis_max_input(pfb_synthesis_t *pfb, int num)
+{
+	return num / pfb->decimation + 1;
+}
+
+/* start processing of 'num' samples; returns number of samples at channel rate */
+int pfb_synthesis_prepare(pfb_synthesis_t *pfb, int num)
+{
+	return (pfb->phase + num) / pfb->decimation;
+}
+
+/* decimate audio of channel 'c' to channel rate, must be called after pfb_synthesis_prepare() */
+void pfb_synthesis_decimate(pfb_synthesis_t *pfb, int c, sample_t *in, uint8_t *power, int num, sample_t *out, uint8_t *out_power)
+{
+	int decimation = pfb->decimation;
+	int phase = pfb->phase;
+	double sum = pfb->chan[c].sum;
+	int s;
+
+	for (s = 0; s < num; s++) {
+		sum += *in++;
+		if (++phase < decimation)
+			continue;
+		phase = 0;
+		*out++ = sum / (double)decimation;
+		*out_power++ = power[s];
+		sum = 0.0;
+	}
+
+	pfb->chan[c].sum = sum;
+}
+
+/* combine modulated channels and add 'num' samples to baseband
+ *
+ * 'count' is the number of samples of each chan_baseband, as returned by pfb_synthesis_prepare() */
+void pfb_synthesis_process(pfb_synthesis_t *pfb, float **chan_baseband, int count, int num, float *baseband)
+{
+	int ntaps = pfb->ntaps, bins = pfb->bins, decimation = pfb->decimation;
+	double *taps = pfb->taps, *acc_i = pfb->acc_i, *acc_q = pfb->acc_q;
+	double *fft_i = pfb->fft_i, *fft_q = pfb->fft_q;
+	double *t, *a_i, *a_q, x, y, ri, rq, wi, wq;
+	float *out;
+	int n, r, l, c, k, s;
+
+	out = pfb->fifo + pfb->fifo_fill * 2;
+
+#ifdef HAVE_OPENCL
+	if (pfb->cl) {
+		pfb_cl_synthesis_process(pfb, chan_baseband, count, out);
+		count = 0;
+	}
+#endif
+	for (n = 0; n < count; n++) {
+		/* place each channel into its bin, shifted up from base band */
+		memset(fft_i, 0, sizeof(*fft_i) * bins);
+		memset(fft_q, 0, sizeof(*fft_q) * bins);
+		for (c = 0; c < pfb->channels; c++) {
+			k = pfb->chan[c].bin;
+			r = (k * pfb->rot_pos) % bins;
+			ri = pfb->rot_i[r];
+			rq = -pfb->rot_q[r];
+			x = chan_baseband[c][n * 2];
+			y = chan_baseband[c][n * 2 + 1];
+			fft_i[k] += x * ri - y * rq;
+			fft_q[k] += x * rq + y * ri;
+		}
+		pfb->rot_pos = (pfb->rot_pos + decimation) % bins;
+
+		/* inverse FFT gives the sum of all bins */
+		fft_process(-1, pfb->m, fft_i, fft_q);
+
+		/* distribute over polyphase branches (overlap-add) */
+		for (r = 0; r < bins; r++) {
+			wi = fft_i[r];
+			wq = fft_q[r];
+			t = taps + r;
+			a_i = acc_i + r;
+			a_q = acc_q + r;
+			for (l = 0; l < ntaps; l += bins) {
+				a_i[l] += t[l] * wi;
+				a_q[l] += t[l] * wq;
+			}
+		}
+
+		/* output one decimation period and shift accumulator */
+		for (s = 0; s < decimation; s++) {
+			*out++ = acc_i[s];
+			*out++ = acc_q[s];
+		}
+		memmove(acc_i, acc_i + decimation, sizeof(*acc_i) * (ntaps - decimation));
+		memmove(acc_q, acc_q + decimation, sizeof(*acc_q) * (ntaps - decimation));
+		memset(acc_i + ntaps - decimation, 0, sizeof(*acc_i) * decimation);
+		memset(acc_q + ntaps - decimation, 0, sizeof(*acc_q) * decimation);
+	}
+	pfb->fifo_fill += count * decimation;
+
+	/* add requested samples to baseband, keep the rest */
+	for (s = 0; s < num * 2; s++)
+		baseband[s] += pfb->fifo[s];
+	pfb->fifo_fill -= num;
+	memmove(pfb->fifo, pfb->fifo + num * 2, sizeof(*pfb->fifo) * pfb->fifo_fill * 2);
+
+	pfb->phase = (pfb->phase + num) % decimation;
+}
+
@@ -0,0 +1,81 @@
+
+/* polyphase filter bank (PFB) analysis channelizer (RX) */
+
+typedef struct pfb_analysis_chan {
+	int		bin;		/* FFT bin that carries this channel */
+	double		residual;	/* offset of channel to center of bin */
+	double		last[2];	/* last two demodulated values (interpolation) */
+} pfb_analysis_chan_t;
+
+typedef struct pfb_analysis {
+	int		m;		/* log2 of number of bins */
+	int		bins;		/* number of bins (FFT size) */
+	int		decimation;	/* decimation factor = bins / 2 */
+	double		samplerate;	/* input sample rate */
+	double		chan_samplerate;/* output sample rate of each channel */
+	int		taps_per_bin;	/* length of each polyphase branch */
+	int		ntaps;		/* number of taps of prototype filter */
+	double		*taps;		/* prototype low-pass filter */
+	double		*hist_i;	/* history of input samples (twice ntaps) */
+	double		*hist_q;
+	int		hist_pos;	/* position of newest sample in history */
+	double		*fft_i;		/* FFT buffer */
+	double		*fft_q;
+	double		*rot_i;		/* table of rotation vectors to shift bins to base band */
+	double		*rot_q;
+	int		rot_pos;	/* rotation index of current output (n * decimation % bins) */
+	int		phase;		/* input samples since last output */
+	int		block_phase;	/* phase at beginning of last processed block */
+	int		channels;	/* number of channels */
+	pfb_analysis_chan_t *chan;
+	struct pfb_cl	*cl;		/* filter bank runs on GPU, if set */
+} pfb_analysis_t;
+
+int pfb_analysis_init(pfb_analysis_t *pfb, double samplerate, double bandwidth, double *offset, int channels);
+void pfb_analysis_exit(pfb_analysis_t *pfb);
+int pfb_analysis_gpu(pfb_analysis_t *pfb, int max_num);
+int pfb_analysis_max_output(pfb_analysis_t *pfb, int num);
+int pfb_analysis_tune(pfb_analysis_t *pfb, int c, double offset);
+int pfb_analysis_process(pfb_analysis_t *pfb, float *baseband, int num, float **chan_baseband);
+void pfb_analysis_interpolate(pfb_analysis_t *pfb, int c, sample_t *in, sample_t *out, int num);
+
+/* polyphase filter bank (PFB) synthesis channelizer (TX) */
+
+typedef struct pfb_synthesis_chan {
+	int		bin;		/* FFT bin that carries this channel */
+	double		residual;	/* offset of channel to center of bin */
+	double		sum;		/* sum of audio samples of current decimation period */
+} pfb_synthesis_chan_t;
+
+typedef struct pfb_synthesis {
+	int		m;		/* log2 of number of bins */
+	int		bins;		/* number of bins (FFT size) */
+	int		decimation;	/* interpolation factor = bins / 2 */
+	double		samplerate;	/* output sample rate */
+	double		chan_samplerate;/* input sample rate of each channel */
+	int		taps_per_bin;	/* length of each polyphase branch */
+	int		ntaps;		/* number of taps of prototype filter */
+	double		*taps;		/* prototype low-pass filter */
+	double		*acc_i;		/* overlap-add accumulator */
+	double		*acc_q;
+	double		*fft_i;		/* FFT buffer */
+	double		*fft_q;
+	double		*rot_i;		/* table of rotation vectors to shift base band to bins */
+	double		*rot_q;
+	int		rot_pos;	/* rotation index of current input (n * decimation % bins) */
+	float		*fifo;		/* output samples that are not yet returned */
+	int		fifo_fill;
+	int		phase;		/* samples since last channel sample */
+	int		channels;	/* number of channels */
+	pfb_synthesis_chan_t *chan;
+	struct pfb_cl	*cl;		/* filter bank runs on GPU, if set */
+} pfb_synthesis_t;
+
+int pfb_synthesis_init(pfb_synthesis_t *pfb, double samplerate, double bandwidth, double *offset, int channels, int max_num);
+void pfb_synthesis_exit(pfb_synthesis_t *pfb);
+int pfb_synthesis_gpu(pfb_synthesis_t *pfb, int max_num);
+int pfb_synthesis_max_input(pfb_synthesis_t *pfb, int num);
+int pfb_synthesis_prepare(pfb_synthesis_t *pfb, int num);
+void pfb_synthesis_decimate(pfb_synthesis_t *pfb, int c, sample_t *in, uint8_t *power, int num, sample_t *out, uint8_t *out_power);
+void pfb_synthesis_process(pfb_synthesis_t *pfb, float **chan_baseband, int count, int num, float *baseband);
+
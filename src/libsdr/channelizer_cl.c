@@ -0,0 +1,565 @@
+/* Polyphase filter bank channelizer on GPU (OpenCL)
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* How it works:
+ *
+ * The same filter bank as in channelizer.c is calculated, but all outputs of
+ * a block are calculated in parallel. Instead of a full FFT, only the bins
+ * that carry a channel are calculated by a DFT, because each work item can
+ * do that independently. The GPU calculates in single precision.
+ *
+ * RX: The first kernel folds the input samples into the polyphase branches
+ * for every output of the block. The second kernel calculates the bin of
+ * every channel for every output and shifts it to base band. The history of
+ * input samples is kept by the host and uploaded in front of each block.
+ *
+ * TX: The first kernel places the channels into their bins and calculates
+ * the inverse DFT of every input. The second kernel does the overlap-add of
+ * the polyphase branches. The results of the inverse DFT of previous inputs
+ * are kept in device memory. Two buffers are used alternately, so the
+ * history is copied from one to the other without overlapping.
+ *
+ * Each block is processed in two halves. While the first half is calculated,
+ * the second half is uploaded, and while the second half is calculated, the
+ * result of the first half is downloaded. Transfers use a separate command
+ * queue. The whole block is finished before returning, so no latency is
+ * added to the channelizer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#define CL_TARGET_OPENCL_VERSION 120
+#include <CL/cl.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "channelizer.h"
+#include "channelizer_cl.h"
+
+static const char *pfb_cl_source =
+"__kernel void pfb_fold(__global const float2 *in, __global const float *taps, __global float2 *fold, int ntaps, int bins, int decimation, int first)\n"
+"{\n"
+"	int j = get_global_id(0), r = get_global_id(1);\n"
+"	__global const float2 *x = in + first + j * decimation - r;\n"
+"	float2 v = (float2)(0.0f, 0.0f);\n"
+"	for (int l = 0; l < ntaps; l += bins)\n"
+"		v += taps[r + l] * x[-l];\n"
+"	fold[j * bins + r] = v;\n"
+"}\n"
+"\n"
+"__kernel void pfb_bins(__global const float2 *fold, __global const float2 *tw, __global const int *bin, __global float2 *out, int channels, int bins, int decimation, int rot_pos)\n"
+"{\n"
+"	int j = get_global_id(0), c = get_global_id(1), k = bin[c];\n"
+"	__global const float2 *f = fold + j * bins;\n"
+"	float2 x = (float2)(0.0f, 0.0f), w;\n"
+"	for (int r = 0; r < bins; r++) {\n"
+"		w = tw[(r * k) & (bins - 1)];\n"
+"		x += (float2)(f[r].x * w.x - f[r].y * w.y, f[r].x * w.y + f[r].y * w.x);\n"
+"	}\n"
+"	w = tw[(k * ((rot_pos + j * decimation) & (bins - 1))) & (bins - 1)];\n"
+"	out[j * channels + c] = (float2)(x.x * w.x + x.y * w.y, x.y * w.x - x.x * w.y);\n"
+"}\n"
+"\n"
+"__kernel void pfb_spread(__global const float2 *in, __global const float2 *tw, __global const int *bin, __global float2 *w, int channels, int bins, int decimation, int rot_pos, int hist)\n"
+"{\n"
+"	int n = get_global_id(0), r = get_global_id(1);\n"
+"	int p = (r + rot_pos + n * decimation) & (bins - 1);\n"
+"	__global const float2 *y = in + n * channels;\n"
+"	float2 x = (float2)(0.0f, 0.0f), t;\n"
+"	for (int c = 0; c < channels; c++) {\n"
+"		t = tw[(bin[c] * p) & (bins - 1)];\n"
+"		x += (float2)(y[c].x * t.x - y[c].y * t.y, y[c].x * t.y + y[c].y * t.x);\n"
+"	}\n"
+"	w[(hist + n) * bins + r] = x;\n"
+"}\n"
+"\n"
+"__kernel void pfb_overlap(__global const float2 *w, __global const float *taps, __global float2 *out, int ntaps, int bins, int decimation, int hist)\n"
+"{\n"
+"	int n = get_global_id(0), s = get_global_id(1);\n"
+"	float2 y = (float2)(0.0f, 0.0f);\n"
+"	for (int m = 0, i = s; i < ntaps; m++, i += decimation)\n"
+"		y += taps[i] * w[(hist + n - m) * bins + (i & (bins - 1))];\n"
+"	out[n * decimation + s] = y;\n"
+"}\n";
+
+struct pfb_cl {
+	cl_context		context;
+	cl_command_queue	compute;	/* queue for kernels */
+	cl_command_queue	transfer;	/* queue for host <-> device transfers */
+	cl_program		program;
+	cl_kernel		kernel[2];	/* fold + bins (RX) or spread + overlap (TX) */
+	cl_mem			taps;		/* prototype filter */
+	cl_mem			tw;		/* exp(+j * 2pi * i / bins) */
+	cl_mem			bin;		/* bin of each channel */
+	cl_mem			in;		/* input of block */
+	cl_mem			work[2];	/* folded branches (RX) or history + inverse DFT (TX, alternating) */
+	cl_mem			out;		/* output of block */
+	int			work_cur;
+	int			hist;		/* RX: input samples of history, TX: inverse DFTs of history */
+	int			max_in, max_out;
+	float			*in_host;
+	float			*out_host;
+	int			error_logged;
+};
+
+static void pfb_cl_free(struct pfb_cl *cl)
+{
+	int i;
+
+	if (!cl)
+		return;
+	for (i = 0; i < 2; i++) {
+		if (cl->kernel[i])
+			clReleaseKernel(cl->kernel[i]);
+		if (cl->work[i])
+			clReleaseMemObject(cl->work[i]);
+	}
+	if (cl->taps)
+		clReleaseMemObject(cl->taps);
+	if (cl->tw)
+		clReleaseMemObject(cl->tw);
+	if (cl->bin)
+		clReleaseMemObject(cl->bin);
+	if (cl->in)
+		clReleaseMemObject(cl->in);
+	if (cl->out)
+		clReleaseMemObject(cl->out);
+	if (cl->program)
+		clReleaseProgram(cl->program);
+	if (cl->transfer)
+		clReleaseCommandQueue(cl->transfer);
+	if (cl->compute)
+		clReleaseCommandQueue(cl->compute);
+	if (cl->context)
+		clReleaseContext(cl->context);
+	free(cl->in_host);
+	free(cl->out_host);
+	free(cl);
+}
+
+/* prefer a GPU, but accept any OpenCL device */
+static cl_device_id pfb_cl_device(void)
+{
+	cl_platform_id platforms[8];
+	cl_uint num_platforms, num;
+	cl_device_id device = NULL;
+	char name[128];
+	cl_uint i;
+
+	if (clGetPlatformIDs(8, platforms, &num_platforms) != CL_SUCCESS || !num_platforms)
+		return NULL;
+	if (num_platforms > 8)
+		num_platforms = 8;
+	for (i = 0; i < num_platforms && !device; i++) {
+		if (clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU, 1, &device, &num) != CL_SUCCESS)
+			device = NULL;
+	}
+	for (i = 0; i < num_platforms && !device; i++) {
+		if (clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, 1, &device, &num) != CL_SUCCESS)
+			device = NULL;
+	}
+	if (device && clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, NULL) == CL_SUCCESS) {
+		name[sizeof(name) - 1] = '\0';
+		LOGP(DSDR, LOGL_INFO, "Channelizer uses OpenCL device '%s'.\n", name);
+	}
+
+	return device;
+}
+
+/* create context, queues, kernels and constant buffers */
+static struct pfb_cl *pfb_cl_create(const char *kernel1, const char *kernel2, double *taps, int ntaps, int bins, pfb_analysis_chan_t *rx_chan, pfb_synthesis_chan_t *tx_chan, int channels)
+{
+	struct pfb_cl *cl;
+	cl_device_id device;
+	cl_int err;
+	float *taps_f = NULL, *tw_f = NULL;
+	int *bin = NULL;
+	char log[1024];
+	int i;
+
+	device = pfb_cl_device();
+	if (!device) {
+		LOGP(DSDR, LOGL_ERROR, "No OpenCL device found.\n");
+		return NULL;
+	}
+
+	cl = calloc(1, sizeof(*cl));
+	taps_f = calloc(ntaps, sizeof(*taps_f));
+	tw_f = calloc(bins * 2, sizeof(*tw_f));
+	bin = calloc(channels, sizeof(*bin));
+	if (!cl || !taps_f || !tw_f || !bin) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		goto error;
+	}
+	for (i = 0; i < ntaps; i++)
+		taps_f[i] = taps[i];
+	for (i = 0; i < bins; i++) {
+		tw_f[i * 2] = cos(2.0 * M_PI * (double)i / (double)bins);
+		tw_f[i * 2 + 1] = sin(2.0 * M_PI * (double)i / (double)bins);
+	}
+	for (i = 0; i < channels; i++)
+		bin[i] = (rx_chan) ? rx_chan[i].bin : tx_chan[i].bin;
+
+	cl->context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->compute = clCreateCommandQueue(cl->context, device, 0, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->transfer = clCreateCommandQueue(cl->context, device, 0, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->program = clCreateProgramWithSource(cl->context, 1, &pfb_cl_source, NULL, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	err = clBuildProgram(cl->program, 1, &device, "-cl-fast-relaxed-math", NULL, NULL);
+	if (err != CL_SUCCESS) {
+		if (clGetProgramBuildInfo(cl->program, device, CL_PROGRAM_BUILD_LOG, sizeof(log), log, NULL) == CL_SUCCESS) {
+			log[sizeof(log) - 1] = '\0';
+			LOGP(DSDR, LOGL_ERROR, "Build log of OpenCL kernels:\n%s\n", log);
+		}
+		goto cl_error;
+	}
+	cl->kernel[0] = clCreateKernel(cl->program, kernel1, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->kernel[1] = clCreateKernel(cl->program, kernel2, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->taps = clCreateBuffer(cl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(*taps_f) * ntaps, taps_f, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->tw = clCreateBuffer(cl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(*tw_f) * bins * 2, tw_f, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	cl->bin = clCreateBuffer(cl->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(*bin) * channels, bin, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+
+	free(taps_f);
+	free(tw_f);
+	free(bin);
+	return cl;
+
+cl_error:
+	LOGP(DSDR, LOGL_ERROR, "Failed to set up OpenCL (error %d).\n", err);
+error:
+	free(taps_f);
+	free(tw_f);
+	free(bin);
+	pfb_cl_free(cl);
+	return NULL;
+}
+
+/* allocate buffers of a block, sizes are number of complex samples */
+static int pfb_cl_buffers(struct pfb_cl *cl, size_t in_size, size_t work_size, size_t out_size)
+{
+	cl_int err;
+	float *zero;
+	int i;
+
+	cl->in_host = calloc(in_size * 2, sizeof(*cl->in_host));
+	cl->out_host = calloc(out_size * 2, sizeof(*cl->out_host));
+	zero = calloc(work_size * 2, sizeof(*zero));
+	if (!cl->in_host || !cl->out_host || !zero) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		free(zero);
+		return -ENOMEM;
+	}
+	cl->in = clCreateBuffer(cl->context, CL_MEM_READ_ONLY, sizeof(cl_float2) * in_size, NULL, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	for (i = 0; i < 2; i++) {
+		/* history of TX must start with silence */
+		cl->work[i] = clCreateBuffer(cl->context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_float2) * work_size, zero, &err);
+		if (err != CL_SUCCESS)
+			goto cl_error;
+	}
+	cl->out = clCreateBuffer(cl->context, CL_MEM_WRITE_ONLY, sizeof(cl_float2) * out_size, NULL, &err);
+	if (err != CL_SUCCESS)
+		goto cl_error;
+	free(zero);
+	return 0;
+
+cl_error:
+	LOGP(DSDR, LOGL_ERROR, "Failed to allocate OpenCL buffers (error %d).\n", err);
+	free(zero);
+	return -EIO;
+}
+
+static void pfb_cl_error(struct pfb_cl *cl, cl_int err)
+{
+	if (cl->error_logged)
+		return;
+	LOGP(DSDR, LOGL_ERROR, "Processing of channelizer on OpenCL device failed (error %d), output is muted.\n", err);
+	cl->error_logged = 1;
+}
+
+/* Upload 'in_end' of two halves of input, run both kernels for each half of
+ * outputs, download each half of output. The two kernels of a half have a
+ * 2D range of (outputs of half) x (range1 / range2).
+ */
+static cl_int pfb_cl_run(struct pfb_cl *cl, size_t *in_end, size_t *out_end, size_t elem_out, size_t range1, size_t range2)
+{
+	cl_event written[2] = { NULL, NULL }, done[2] = { NULL, NULL };
+	size_t offset[2], size[2], in_start = 0, out_start = 0;
+	cl_int err = CL_SUCCESS;
+	int h;
+
+	for (h = 0; h < 2; h++) {
+		if (in_end[h] > in_start) {
+			err = clEnqueueWriteBuffer(cl->transfer, cl->in, CL_FALSE, sizeof(cl_float2) * in_start, sizeof(cl_float2) * (in_end[h] - in_start), cl->in_host + in_start * 2, 0, NULL, &written[h]);
+			if (err != CL_SUCCESS)
+				goto out;
+		}
+		in_start = in_end[h];
+	}
+	/* start uploading, while kernels are queued */
+	clFlush(cl->transfer);
+	for (h = 0; h < 2; h++) {
+		if (out_end[h] == out_start)
+			continue;
+		offset[0] = out_start;
+		offset[1] = 0;
+		size[0] = out_end[h] - out_start;
+		size[1] = range1;
+		err = clEnqueueNDRangeKernel(cl->compute, cl->kernel[0], 2, offset, size, NULL, (written[h]) ? 1 : 0, (written[h]) ? &written[h] : NULL, NULL);
+		if (err != CL_SUCCESS)
+			goto out;
+		size[1] = range2;
+		err = clEnqueueNDRangeKernel(cl->compute, cl->kernel[1], 2, offset, size, NULL, 0, NULL, &done[h]);
+		if (err != CL_SUCCESS)
+			goto out;
+		out_start = out_end[h];
+	}
+	clFlush(cl->compute);
+	out_start = 0;
+	for (h = 0; h < 2; h++) {
+		if (out_end[h] == out_start)
+			continue;
+		err = clEnqueueReadBuffer(cl->transfer, cl->out, CL_FALSE, sizeof(cl_float2) * out_start * elem_out, sizeof(cl_float2) * (out_end[h] - out_start) * elem_out, cl->out_host + out_start * elem_out * 2, 1, &done[h], NULL);
+		if (err != CL_SUCCESS)
+			goto out;
+		out_start = out_end[h];
+	}
+
+out:
+	/* host buffers must not be touched until transfers are done */
+	clFinish(cl->transfer);
+	clFinish(cl->compute);
+	for (h = 0; h < 2; h++) {
+		if (written[h])
+			clReleaseEvent(written[h]);
+		if (done[h])
+			clReleaseEvent(done[h]);
+	}
+	return err;
+}
+
+int pfb_cl_analysis_init(pfb_analysis_t *pfb, int max_num)
+{
+	struct pfb_cl *cl;
+	int rc;
+
+	cl = pfb_cl_create("pfb_fold", "pfb_bins", pfb->taps, pfb->ntaps, pfb->bins, pfb->chan, NULL, pfb->channels);
+	if (!cl)
+		return -EIO;
+	cl->hist = pfb->ntaps - 1;
+	cl->max_in = cl->hist + max_num;
+	cl->max_out = pfb_analysis_max_output(pfb, max_num);
+	rc = pfb_cl_buffers(cl, cl->max_in, cl->max_out * pfb->bins, cl->max_out * pfb->channels);
+	if (rc < 0) {
+		pfb_cl_free(cl);
+		return rc;
+	}
+	pfb->cl = cl;
+
+	return 0;
+}
+
+void pfb_cl_analysis_exit(pfb_analysis_t *pfb)
+{
+	pfb_cl_free(pfb->cl);
+	pfb->cl = NULL;
+}
+
+int pfb_cl_analysis_process(pfb_analysis_t *pfb, float *baseband, int num, float **chan_baseband)
+{
+	struct pfb_cl *cl = pfb->cl;
+	int decimation = pfb->decimation, channels = pfb->channels;
+	int first, count, half, j, c;
+	int ntaps = pfb->ntaps, bins = pfb->bins, rot_pos = pfb->rot_pos;
+	size_t in_end[2], out_end[2];
+	float *out;
+	cl_int err = CL_SUCCESS;
+
+	if (num > cl->max_in - cl->hist) {
+		LOGP(DSDR, LOGL_ERROR, "Block of %d samples exceeds channelizer buffer, please fix!\n", num);
+		abort();
+	}
+
+	pfb->block_phase = pfb->phase;
+
+	/* new samples follow the history */
+	memcpy(cl->in_host + cl->hist * 2, baseband, sizeof(*baseband) * num * 2);
+
+	/* position of input sample that completes the first output */
+	first = cl->hist + decimation - pfb->phase - 1;
+	count = (pfb->phase + num) / decimation;
+	half = count / 2;
+	out_end[0] = half;
+	out_end[1] = count;
+	in_end[0] = (half) ? first + (half - 1) * decimation + 1 : 0;
+	in_end[1] = (count) ? first + (count - 1) * decimation + 1 : 0;
+
+	if (count) {
+		clSetKernelArg(cl->kernel[0], 0, sizeof(cl_mem), &cl->in);
+		clSetKernelArg(cl->kernel[0], 1, sizeof(cl_mem), &cl->taps);
+		clSetKernelArg(cl->kernel[0], 2, sizeof(cl_mem), &cl->work[0]);
+		clSetKernelArg(cl->kernel[0], 3, sizeof(int), &ntaps);
+		clSetKernelArg(cl->kernel[0], 4, sizeof(int), &bins);
+		clSetKernelArg(cl->kernel[0], 5, sizeof(int), &decimation);
+		clSetKernelArg(cl->kernel[0], 6, sizeof(int), &first);
+		clSetKernelArg(cl->kernel[1], 0, sizeof(cl_mem), &cl->work[0]);
+		clSetKernelArg(cl->kernel[1], 1, sizeof(cl_mem), &cl->tw);
+		clSetKernelArg(cl->kernel[1], 2, sizeof(cl_mem), &cl->bin);
+		clSetKernelArg(cl->kernel[1], 3, sizeof(cl_mem), &cl->out);
+		clSetKernelArg(cl->kernel[1], 4, sizeof(int), &channels);
+		clSetKernelArg(cl->kernel[1], 5, sizeof(int), &bins);
+		clSetKernelArg(cl->kernel[1], 6, sizeof(int), &decimation);
+		clSetKernelArg(cl->kernel[1], 7, sizeof(int), &rot_pos);
+		err = pfb_cl_run(cl, in_end, out_end, channels, bins, channels);
+		if (err != CL_SUCCESS) {
+			pfb_cl_error(cl, err);
+			memset(cl->out_host, 0, sizeof(*cl->out_host) * count * channels * 2);
+		}
+	}
+
+	/* output is ordered by sample, then channel */
+	for (c = 0; c < channels; c++) {
+		out = cl->out_host + c * 2;
+		for (j = 0; j < count; j++) {
+			chan_baseband[c][j * 2] = out[0];
+			chan_baseband[c][j * 2 + 1] = out[1];
+			out += channels * 2;
+		}
+	}
+
+	/* keep history for next block */
+	memmove(cl->in_host, cl->in_host + num * 2, sizeof(*cl->in_host) * cl->hist * 2);
+	pfb->rot_pos = (pfb->rot_pos + count * decimation) % bins;
+	pfb->phase = (pfb->phase + num) % decimation;
+
+	return count;
+}
+
+int pfb_cl_synthesis_init(pfb_synthesis_t *pfb, int max_num)
+{
+	struct pfb_cl *cl;
+	int rc;
+
+	cl = pfb_cl_create("pfb_spread", "pfb_overlap", pfb->taps, pfb->ntaps, pfb->bins, NULL, pfb->chan, pfb->channels);
+	if (!cl)
+		return -EIO;
+	/* inverse DFTs that still contribute to the overlap-add */
+	cl->hist = pfb->ntaps / pfb->decimation - 1;
+	cl->max_in = pfb_synthesis_max_input(pfb, max_num);
+	cl->max_out = cl->max_in * pfb->decimation;
+	rc = pfb_cl_buffers(cl, cl->max_in * pfb->channels, (cl->hist + cl->max_in) * pfb->bins, cl->max_out);
+	if (rc < 0) {
+		pfb_cl_free(cl);
+		return rc;
+	}
+	pfb->cl = cl;
+
+	return 0;
+}
+
+void pfb_cl_synthesis_exit(pfb_synthesis_t *pfb)
+{
+	pfb_cl_free(pfb->cl);
+	pfb->cl = NULL;
+}
+
+/* write 'count' decimation periods to 'out' */
+void pfb_cl_synthesis_process(pfb_synthesis_t *pfb, float **chan_baseband, int count, float *out)
+{
+	struct pfb_cl *cl = pfb->cl;
+	int decimation = pfb->decimation, channels = pfb->channels;
+	int ntaps = pfb->ntaps, bins = pfb->bins, rot_pos = pfb->rot_pos, hist = cl->hist;
+	size_t in_end[2], out_end[2];
+	cl_mem work = cl->work[cl->work_cur], next = cl->work[!cl->work_cur];
+	float *in;
+	int half, n, c;
+	cl_int err;
+
+	if (!count)
+		return;
+
+	/* input is ordered by sample, then channel */
+	for (c = 0; c < channels; c++) {
+		in = cl->in_host + c * 2;
+		for (n = 0; n < count; n++) {
+			in[0] = chan_baseband[c][n * 2];
+			in[1] = chan_baseband[c][n * 2 + 1];
+			in += channels * 2;
+		}
+	}
+
+	half = count / 2;
+	in_end[0] = half * channels;
+	in_end[1] = count * channels;
+	out_end[0] = half;
+	out_end[1] = count;
+
+	clSetKernelArg(cl->kernel[0], 0, sizeof(cl_mem), &cl->in);
+	clSetKernelArg(cl->kernel[0], 1, sizeof(cl_mem), &cl->tw);
+	clSetKernelArg(cl->kernel[0], 2, sizeof(cl_mem), &cl->bin);
+	clSetKernelArg(cl->kernel[0], 3, sizeof(cl_mem), &work);
+	clSetKernelArg(cl->kernel[0], 4, sizeof(int), &channels);
+	clSetKernelArg(cl->kernel[0], 5, sizeof(int), &bins);
+	clSetKernelArg(cl->kernel[0], 6, sizeof(int), &decimation);
+	clSetKernelArg(cl->kernel[0], 7, sizeof(int), &rot_pos);
+	clSetKernelArg(cl->kernel[0], 8, sizeof(int), &hist);
+	clSetKernelArg(cl->kernel[1], 0, sizeof(cl_mem), &work);
+	clSetKernelArg(cl->kernel[1], 1, sizeof(cl_mem), &cl->taps);
+	clSetKernelArg(cl->kernel[1], 2, sizeof(cl_mem), &cl->out);
+	clSetKernelArg(cl->kernel[1], 3, sizeof(int), &ntaps);
+	clSetKernelArg(cl->kernel[1], 4, sizeof(int), &bins);
+	clSetKernelArg(cl->kernel[1], 5, sizeof(int), &decimation);
+	clSetKernelArg(cl->kernel[1], 6, sizeof(int), &hist);
+	err = pfb_cl_run(cl, in_end, out_end, decimation, bins, decimation);
+	if (err == CL_SUCCESS) {
+		/* history of next block goes to the other buffer */
+		err = clEnqueueCopyBuffer(cl->compute, work, next, sizeof(cl_float2) * count * bins, 0, sizeof(cl_float2) * hist * bins, 0, NULL, NULL);
+		clFlush(cl->compute);
+		cl->work_cur = !cl->work_cur;
+	}
+	if (err != CL_SUCCESS) {
+		pfb_cl_error(cl, err);
+		memset(cl->out_host, 0, sizeof(*cl->out_host) * count * decimation * 2);
+	}
+
+	memcpy(out, cl->out_host, sizeof(*out) * count * decimation * 2);
+	pfb->rot_pos = (pfb->rot_pos + count * decimation) % bins;
+}
+
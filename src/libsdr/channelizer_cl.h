@@ -0,0 +1,8 @@
+
+int pfb_cl_analysis_init(pfb_analysis_t *pfb, int max_num);
+void pfb_cl_analysis_exit(pfb_analysis_t *pfb);
+int pfb_cl_analysis_process(pfb_analysis_t *pfb, float *baseband, int num, float **chan_baseband);
+int pfb_cl_synthesis_init(pfb_synthesis_t *pfb, int max_num);
+void pfb_cl_synthesis_exit(pfb_synthesis_t *pfb);
+void pfb_cl_synthesis_process(pfb_synthesis_t *pfb, float **chan_baseband, int count, float *out);
+
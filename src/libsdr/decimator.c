@@ -0,0 +1,420 @@
+/* Decimation / interpolation chain for IQ samples
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* How it works:
+ *
+ * The rate is changed in two stages. The last stage (at low rate) is a FIR
+ * filter that changes the rate by 2 (half-band filter) or by the smallest
+ * prime factor of an odd rate. It defines the pass band (75% of the low
+ * rate) and removes the alias. The remaining factor is done by a CIC filter
+ * at high rate, which requires additions only. The CIC stage removes the
+ * alias near multiples of the FIR stage's high rate, the droop of its pass
+ * band is compensated by a 3 tap FIR filter at low rate.
+ *
+ * The CIC filter uses integer arithmetic, so the integrators may wrap
+ * around without loss of precision.
+ *
+ * Both FIR stages are polyphase: When decimating, only the samples that are
+ * kept are calculated. When interpolating, only the non-zero input samples
+ * are convolved.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include "decimator.h"
+
+#define HALFBAND_PAIRS	12	/* non-zero taps on each side of center: 47 taps */
+#define POLY_TAPS	22	/* taps per phase of generic FIR stage */
+#define COMP_FREQUENCY	0.3	/* frequency where CIC droop is compensated (relative to low rate) */
+
+static double blackman(int i, int n)
+{
+	return 0.42 - 0.50 * cos(2.0 * M_PI * (double)i / (double)(n - 1))
+		+ 0.08 * cos(4.0 * M_PI * (double)i / (double)(n - 1));
+}
+
+/* CIC stage */
+
+static int cic_init(cic_filter_t *cic, int factor, int gain_order)
+{
+	int bits;
+
+	memset(cic, 0, sizeof(*cic));
+	cic->factor = factor;
+
+	/* growth of integer range, keep two bits for overshoot of input */
+	bits = 62 - (int)ceil(log2((double)factor) * (double)CIC_ORDER) - 2;
+	if (bits > 30)
+		bits = 30;
+	if (bits < 12)
+		return -EINVAL;
+	cic->scale_in = ldexp(1.0, bits);
+	cic->scale_out = 1.0 / cic->scale_in / pow((double)factor, (double)gain_order);
+
+	return 0;
+}
+
+static int cic_decimate(cic_filter_t *cic, float *in, int num, float *out)
+{
+	int factor = cic->factor, phase = cic->phase;
+	uint64_t v, t;
+	int i, c, s, count = 0;
+
+	for (i = 0; i < num; i++) {
+		for (c = 0; c < 2; c++) {
+			v = (uint64_t)llrint((double)*in++ * cic->scale_in);
+			for (s = 0; s < CIC_ORDER; s++)
+				v = cic->integ[c][s] += v;
+		}
+		if (++phase < factor)
+			continue;
+		phase = 0;
+		for (c = 0; c < 2; c++) {
+			v = cic->integ[c][CIC_ORDER - 1];
+			for (s = 0; s < CIC_ORDER; s++) {
+				t = v;
+				v -= cic->comb[c][s];
+				cic->comb[c][s] = t;
+			}
+			*out++ = (double)(int64_t)v * cic->scale_out;
+		}
+		count++;
+	}
+	cic->phase = phase;
+
+	return count;
+}
+
+/* 'out' may be the end of 'in' buffer (see interpolator_process) */
+static void cic_interpolate(cic_filter_t *cic, float *in, int num, float *out)
+{
+	int factor = cic->factor;
+	uint64_t v[2], t, acc;
+	int i, c, s, r;
+
+	for (i = 0; i < num; i++) {
+		for (c = 0; c < 2; c++) {
+			v[c] = (uint64_t)llrint((double)*in++ * cic->scale_in);
+			for (s = 0; s < CIC_ORDER; s++) {
+				t = v[c];
+				v[c] -= cic->comb[c][s];
+				cic->comb[c][s] = t;
+			}
+		}
+		for (r = 0; r < factor; r++) {
+			for (c = 0; c < 2; c++) {
+				acc = (r == 0) ? v[c] : 0;
+				for (s = 0; s < CIC_ORDER; s++)
+					acc = cic->integ[c][s] += acc;
+				*out++ = (double)(int64_t)acc * cic->scale_out;
+			}
+		}
+	}
+}
+
+/* FIR stage */
+
+static int poly_init(poly_filter_t *fir, int factor, int interpolate)
+{
+	double sum, x;
+	int i, k, c;
+
+	memset(fir, 0, sizeof(*fir));
+	fir->factor = factor;
+
+	if (factor == 2) {
+		/* half-band filter: center tap is 0.5, taps at even offsets are zero */
+		fir->halfband = 1;
+		fir->ntaps = HALFBAND_PAIRS * 4 - 1;
+		fir->hist_size = (interpolate) ? HALFBAND_PAIRS * 2 : fir->ntaps;
+		fir->taps = calloc(HALFBAND_PAIRS, sizeof(*fir->taps));
+		if (!fir->taps)
+			return -ENOMEM;
+		c = fir->ntaps / 2;
+		sum = 0.0;
+		for (i = 0; i < HALFBAND_PAIRS; i++) {
+			k = i * 2 + 1;
+			x = M_PI * (double)k / 2.0;
+			fir->taps[i] = sin(x) / x * 0.5 * blackman(c + k, fir->ntaps);
+			sum += fir->taps[i];
+		}
+		/* both sides sum up to 0.5 */
+		for (i = 0; i < HALFBAND_PAIRS; i++)
+			fir->taps[i] *= 0.25 / sum;
+		if (interpolate) {
+			for (i = 0; i < HALFBAND_PAIRS; i++)
+				fir->taps[i] *= 2.0;
+		}
+	} else {
+		/* low-pass at half of the low rate */
+		fir->ntaps = factor * POLY_TAPS;
+		fir->hist_size = (interpolate) ? POLY_TAPS : fir->ntaps;
+		fir->taps = calloc(fir->ntaps, sizeof(*fir->taps));
+		if (!fir->taps)
+			return -ENOMEM;
+		sum = 0.0;
+		for (i = 0; i < fir->ntaps; i++) {
+			x = M_PI * ((double)i - (double)(fir->ntaps - 1) / 2.0) / (double)factor;
+			fir->taps[i] = ((x == 0.0) ? 1.0 : sin(x) / x) * blackman(i, fir->ntaps);
+			sum += fir->taps[i];
+		}
+		for (i = 0; i < fir->ntaps; i++)
+			fir->taps[i] *= ((interpolate) ? (double)factor : 1.0) / sum;
+	}
+
+	fir->hist = calloc(fir->hist_size * 2 * 2, sizeof(*fir->hist));
+	if (!fir->hist)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void poly_exit(poly_filter_t *fir)
+{
+	free(fir->taps);
+	free(fir->hist);
+	memset(fir, 0, sizeof(*fir));
+}
+
+/* store sample, so that x[k] = hist[(pos + k) * 2] is the sample 'k' samples ago */
+static float *poly_store(poly_filter_t *fir, float i, float q)
+{
+	float *h;
+
+	if (--fir->hist_pos < 0)
+		fir->hist_pos = fir->hist_size - 1;
+	h = fir->hist + fir->hist_pos * 2;
+	h[0] = h[fir->hist_size * 2] = i;
+	h[1] = h[fir->hist_size * 2 + 1] = q;
+
+	return h;
+}
+
+static int poly_decimate(poly_filter_t *fir, float *in, int num, float *out)
+{
+	int factor = fir->factor, ntaps = fir->ntaps;
+	double *taps = fir->taps;
+	double y_i, y_q;
+	float *x;
+	int i, k, m, count = 0;
+	int c = ntaps / 2;
+
+	for (i = 0; i < num; i++, in += 2) {
+		x = poly_store(fir, in[0], in[1]);
+		if (++fir->phase < factor)
+			continue;
+		fir->phase = 0;
+		if (fir->halfband) {
+			y_i = 0.5 * x[c * 2];
+			y_q = 0.5 * x[c * 2 + 1];
+			for (m = 0; m < HALFBAND_PAIRS; m++) {
+				k = m * 2 + 1;
+				y_i += taps[m] * (x[(c - k) * 2] + x[(c + k) * 2]);
+				y_q += taps[m] * (x[(c - k) * 2 + 1] + x[(c + k) * 2 + 1]);
+			}
+		} else {
+			y_i = y_q = 0.0;
+			for (k = 0; k < ntaps; k++) {
+				y_i += taps[k] * x[k * 2];
+				y_q += taps[k] * x[k * 2 + 1];
+			}
+		}
+		*out++ = y_i;
+		*out++ = y_q;
+		count++;
+	}
+
+	return count;
+}
+
+static void poly_interpolate(poly_filter_t *fir, float *in, int num, float *out)
+{
+	int factor = fir->factor;
+	double *taps = fir->taps;
+	double y_i, y_q;
+	float *x;
+	int i, m, q, r;
+
+	for (i = 0; i < num; i++, in += 2) {
+		x = poly_store(fir, in[0], in[1]);
+		if (fir->halfband) {
+			y_i = y_q = 0.0;
+			for (m = 0; m < HALFBAND_PAIRS; m++) {
+				y_i += taps[m] * (x[(HALFBAND_PAIRS - 1 - m) * 2] + x[(HALFBAND_PAIRS + m) * 2]);
+				y_q += taps[m] * (x[(HALFBAND_PAIRS - 1 - m) * 2 + 1] + x[(HALFBAND_PAIRS + m) * 2 + 1]);
+			}
+			*out++ = y_i;
+			*out++ = y_q;
+			/* center tap is 0.5 * 2 */
+			*out++ = x[(HALFBAND_PAIRS - 1) * 2];
+			*out++ = x[(HALFBAND_PAIRS - 1) * 2 + 1];
+			continue;
+		}
+		for (r = 0; r < factor; r++) {
+			y_i = y_q = 0.0;
+			for (q = 0; q < POLY_TAPS; q++) {
+				y_i += taps[q * factor + r] * x[q * 2];
+				y_q += taps[q * factor + r] * x[q * 2 + 1];
+			}
+			*out++ = y_i;
+			*out++ = y_q;
+		}
+	}
+}
+
+/* droop compensation */
+
+static void comp_init(decimator_t *dec, int cic_factor, int fir_factor)
+{
+	double x, droop;
+
+	/* frequency relative to CIC's high rate */
+	x = COMP_FREQUENCY / (double)fir_factor / (double)cic_factor;
+	droop = pow(fabs(sin(M_PI * (double)cic_factor * x) / ((double)cic_factor * sin(M_PI * x))), (double)CIC_ORDER);
+	dec->comp_a = (1.0 / droop - 1.0) / (2.0 * (1.0 - cos(2.0 * M_PI * COMP_FREQUENCY)));
+}
+
+/* may be processed in place */
+static void comp_process(decimator_t *dec, float *in, int num, float *out)
+{
+	double a = dec->comp_a, b = 1.0 + 2.0 * dec->comp_a;
+	float x;
+	int i, c;
+
+	for (i = 0; i < num; i++) {
+		for (c = 0; c < 2; c++) {
+			x = *in++;
+			*out++ = b * dec->comp_hist[c][0] - a * (x + dec->comp_hist[c][1]);
+			dec->comp_hist[c][1] = dec->comp_hist[c][0];
+			dec->comp_hist[c][0] = x;
+		}
+	}
+}
+
+/* chain */
+
+static int chain_init(decimator_t *dec, int factor, int interpolate)
+{
+	int fir_factor, cic_factor;
+	int rc;
+
+	memset(dec, 0, sizeof(*dec));
+
+	if (factor < 2)
+		return -EINVAL;
+	dec->factor = factor;
+
+	/* FIR stage changes rate by 2 or by smallest prime factor */
+	if (!(factor & 1))
+		fir_factor = 2;
+	else {
+		for (fir_factor = 3; factor % fir_factor; fir_factor += 2);
+	}
+	cic_factor = factor / fir_factor;
+
+	rc = poly_init(&dec->fir, fir_factor, interpolate);
+	if (rc < 0)
+		goto error;
+
+	if (cic_factor > 1) {
+		dec->use_cic = 1;
+		/* interpolation inserts zeros, so gain is one order less */
+		rc = cic_init(&dec->cic, cic_factor, (interpolate) ? CIC_ORDER - 1 : CIC_ORDER);
+		if (rc < 0)
+			goto error;
+		comp_init(dec, cic_factor, fir_factor);
+	}
+
+	return 0;
+
+error:
+	poly_exit(&dec->fir);
+	return rc;
+}
+
+/* init decimation by 'factor' */
+int decimator_init(decimator_t *dec, int factor)
+{
+	return chain_init(dec, factor, 0);
+}
+
+void decimator_exit(decimator_t *dec)
+{
+	poly_exit(&dec->fir);
+}
+
+/* decimate 'num' IQ samples, returns number of output samples
+ *
+ * 'out' may be the same as 'in' */
+int decimator_process(decimator_t *dec, float *in, int num, float *out)
+{
+	int count = num;
+
+	if (dec->use_cic) {
+		count = cic_decimate(&dec->cic, in, num, out);
+		in = out;
+	}
+	count = poly_decimate(&dec->fir, in, count, out);
+	if (dec->use_cic)
+		comp_process(dec, out, count, out);
+
+	return count;
+}
+
+/* init interpolation by 'factor' */
+int interpolator_init(decimator_t *ip, int factor)
+{
+	return chain_init(ip, factor, 1);
+}
+
+void interpolator_exit(decimator_t *ip)
+{
+	poly_exit(&ip->fir);
+}
+
+/* interpolate 'num' IQ samples to 'num' * factor samples
+ *
+ * 'in' is not modified, 'out' must not overlap with 'in' */
+void interpolator_process(decimator_t *ip, float *in, int num, float *out)
+{
+	int fir_factor = ip->fir.factor;
+	float comp[256 * 2], *tail, *p;
+	int chunk, n;
+
+	if (!ip->use_cic) {
+		poly_interpolate(&ip->fir, in, num, out);
+		return;
+	}
+
+	/* FIR output is stored at the end of the output buffer, so the CIC
+	 * stage can expand it towards the beginning */
+	tail = out + (num * ip->factor - num * fir_factor) * 2;
+	for (p = tail, n = num; n; n -= chunk) {
+		chunk = (n > 256) ? 256 : n;
+		comp_process(ip, in, chunk, comp);
+		poly_interpolate(&ip->fir, comp, chunk, p);
+		in += chunk * 2;
+		p += chunk * fir_factor * 2;
+	}
+	cic_interpolate(&ip->cic, tail, num * fir_factor, out);
+}
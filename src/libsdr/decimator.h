@@ -0,0 +1,44 @@
+#ifndef _DECIMATOR_H
+#define _DECIMATOR_H
+
+/* decimation / interpolation chain for interleaved IQ samples */
+
+#define CIC_ORDER	4
+
+typedef struct cic_filter {
+	int		factor;		/* rate change of CIC stage */
+	double		scale_in;	/* float to integer */
+	double		scale_out;	/* integer to float, includes gain of CIC */
+	uint64_t	integ[2][CIC_ORDER]; /* integrator states (wrap around is intended) */
+	uint64_t	comb[2][CIC_ORDER]; /* previous values of comb stages */
+	int		phase;
+} cic_filter_t;
+
+typedef struct poly_filter {
+	int		factor;		/* rate change of FIR stage */
+	int		halfband;	/* use half-band filter (factor 2) */
+	int		ntaps;		/* number of taps */
+	double		*taps;		/* FIR taps (half-band: only taps at odd offsets from center) */
+	int		hist_size;	/* number of samples in history */
+	float		*hist;		/* history of IQ samples (stored twice, so no wrap is required) */
+	int		hist_pos;	/* position of newest sample in history */
+	int		phase;
+} poly_filter_t;
+
+typedef struct decimator {
+	int		factor;		/* total rate change */
+	int		use_cic;
+	cic_filter_t	cic;		/* CIC stage at full rate */
+	poly_filter_t	fir;		/* FIR stage at reduced rate */
+	double		comp_a;		/* 3 tap CIC droop compensation: -a, 1 + 2a, -a */
+	float		comp_hist[2][2];
+} decimator_t;
+
+int decimator_init(decimator_t *dec, int factor);
+void decimator_exit(decimator_t *dec);
+int decimator_process(decimator_t *dec, float *in, int num, float *out);
+int interpolator_init(decimator_t *ip, int factor);
+void interpolator_exit(decimator_t *ip);
+void interpolator_process(decimator_t *ip, float *in, int num, float *out);
+
+#endif /* _DECIMATOR_H */
@@ -0,0 +1,150 @@
+/* Continuous DC offset and IQ imbalance correction
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The DC offset of cheap SDRs drifts with temperature, and a gain or phase
+ * mismatch between I and Q mirrors each carrier to the other side of the
+ * center frequency, where it may fall onto another channel.
+ *
+ * The correction is done while converting from the wire format, so the
+ * samples are touched once. The loop only adds the moments (mean, power and
+ * cross correlation) of the raw samples. After each block, the moments are
+ * averaged and new coefficients are calculated, which are applied to the
+ * next block. So the loop has no dependency on its own results and does not
+ * branch.
+ *
+ * The imbalance is removed blindly by making Q orthogonal to I and scaling
+ * it to the power of I:
+ *
+ *	I' = I - dc_I
+ *	Q' = gain * ((Q - dc_Q) - phase * I')
+ *
+ * This works, because the received spectrum is (on average) symmetrical
+ * enough, so that I and Q of a balanced receiver are uncorrelated and have
+ * equal power.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "wire_format.h"
+#include "iq_correct.h"
+
+/* time_constant is the time (seconds) it takes to follow a change of offset or imbalance */
+void iq_correct_init(iq_correct_t *corr, double samplerate, double time_constant)
+{
+	memset(corr, 0, sizeof(*corr));
+	corr->alpha = 1.0 / (samplerate * time_constant);
+	corr->gain = 1.0;
+}
+
+/* calculate coefficients from moments of the last block */
+static void iq_correct_update(iq_correct_t *corr, int num, double sum_I, double sum_Q, double sum_II, double sum_QQ, double sum_IQ)
+{
+	double alpha, var_I, var_Q, cov, var_Q_orth;
+
+	sum_I /= num;
+	sum_Q /= num;
+	sum_II /= num;
+	sum_QQ /= num;
+	sum_IQ /= num;
+
+	/* first block initializes the average */
+	alpha = (corr->valid) ? corr->alpha * num : 1.0;
+	if (alpha > 1.0)
+		alpha = 1.0;
+	corr->mean_I += alpha * (sum_I - corr->mean_I);
+	corr->mean_Q += alpha * (sum_Q - corr->mean_Q);
+	corr->pow_I += alpha * (sum_II - corr->pow_I);
+	corr->pow_Q += alpha * (sum_QQ - corr->pow_Q);
+	corr->cross += alpha * (sum_IQ - corr->cross);
+	corr->valid = 1;
+
+	/* remove DC from moments */
+	var_I = corr->pow_I - corr->mean_I * corr->mean_I;
+	var_Q = corr->pow_Q - corr->mean_Q * corr->mean_Q;
+	cov = corr->cross - corr->mean_I * corr->mean_Q;
+
+	corr->dc_I = corr->mean_I;
+	corr->dc_Q = corr->mean_Q;
+	/* no signal, keep last coefficients */
+	if (var_I <= 0.0 || var_Q <= 0.0)
+		return;
+	var_Q_orth = var_Q - cov * cov / var_I;
+	if (var_Q_orth <= 0.0)
+		return;
+	corr->phase = cov / var_I;
+	corr->gain = sqrt(var_I / var_Q_orth);
+	corr->gain_db = 10.0 * log10(var_Q / var_I);
+	corr->phase_deg = asin(cov / sqrt(var_I * var_Q)) * 180.0 / M_PI;
+}
+
+#define CORRECT_LOOP(in_I, in_Q) \
+	for (i = 0; i < num; i++) { \
+		I = in_I; \
+		Q = in_Q; \
+		sum_I += I; \
+		sum_Q += Q; \
+		sum_II += I * I; \
+		sum_QQ += Q * Q; \
+		sum_IQ += I * Q; \
+		I -= dc_I; \
+		Q -= dc_Q; \
+		out[i * 2] = I; \
+		out[i * 2 + 1] = gain * (Q - phase * I); \
+	}
+
+/* convert num IQ pairs from given format to float, remove DC offset and IQ
+ * imbalance, in and out may be equal for SDR_WIRE_CF32
+ * if corr is NULL, samples are just converted */
+void iq_correct_to_float(iq_correct_t *corr, int format, const void *in, float *out, int num)
+{
+	const float *inf = in;
+	const int16_t *in16 = in;
+	const int8_t *in8 = in;
+	float dc_I, dc_Q, phase, gain;
+	float I, Q;
+	double sum_I = 0.0, sum_Q = 0.0, sum_II = 0.0, sum_QQ = 0.0, sum_IQ = 0.0;
+	int i;
+
+	if (!corr) {
+		if (in != out)
+			wire_format_to_float(format, in, out, num);
+		return;
+	}
+	if (num <= 0)
+		return;
+
+	dc_I = corr->dc_I;
+	dc_Q = corr->dc_Q;
+	phase = corr->phase;
+	gain = corr->gain;
+
+	switch (format) {
+	case SDR_WIRE_CS16:
+		CORRECT_LOOP((float)in16[i * 2] * (1.0f / 32768.0f), (float)in16[i * 2 + 1] * (1.0f / 32768.0f))
+		break;
+	case SDR_WIRE_CS8:
+		CORRECT_LOOP((float)in8[i * 2] * (1.0f / 128.0f), (float)in8[i * 2 + 1] * (1.0f / 128.0f))
+		break;
+	default:
+		CORRECT_LOOP(inf[i * 2], inf[i * 2 + 1])
+	}
+
+	iq_correct_update(corr, num, sum_I, sum_Q, sum_II, sum_QQ, sum_IQ);
+}
@@ -0,0 +1,23 @@
+#ifndef _IQ_CORRECT_H
+#define _IQ_CORRECT_H
+
+/* continuous correction of DC offset and IQ imbalance of received samples */
+typedef struct iq_correct {
+	double		alpha;		/* averaging factor per sample */
+	int		valid;		/* estimates are available */
+	/* moments of raw samples, averaged over blocks */
+	double		mean_I, mean_Q;
+	double		pow_I, pow_Q, cross;
+	/* coefficients that are applied to the next block */
+	float		dc_I, dc_Q;	/* DC offset */
+	float		phase;		/* part of I that leaks into Q */
+	float		gain;		/* gain of Q after removing the leak */
+	/* estimated imbalance, for telemetry */
+	double		gain_db;	/* amplitude of Q relative to I */
+	double		phase_deg;	/* deviation from 90 degrees between I and Q */
+} iq_correct_t;
+
+void iq_correct_init(iq_correct_t *corr, double samplerate, double time_constant);
+void iq_correct_to_float(iq_correct_t *corr, int format, const void *in, float *out, int num);
+
+#endif /* _IQ_CORRECT_H */
@@ -0,0 +1,111 @@
+/* IQ loopback in memory
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The transmitted IQ stream is received again, as if the antenna of the
+ * receiver were connected to the transmitter. The TX spectrum is shifted to
+ * the RX center frequency, so only channels that receive on their transmit
+ * frequency (external loopback) receive something.
+ *
+ * The loop never blocks. How much can be sent is only limited by what has not
+ * been received yet, so the DSP runs as fast as the CPU allows.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../liblogging/logging.h"
+#include "iqloop.h"
+
+int iqloop_open(iqloop_t *loop, double tx_frequency, double rx_frequency, double rate, int size)
+{
+	memset(loop, 0, sizeof(*loop));
+	loop->ring = calloc(size * 2, sizeof(*loop->ring));
+	if (!loop->ring) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		return -ENOMEM;
+	}
+	loop->size = size;
+	iqshm_mixer_init(&loop->mixer, tx_frequency - rx_frequency, rate);
+
+	LOGP(DSDR, LOGL_NOTICE, "SDR loops TX back to RX, no hardware is used.\n");
+	if (tx_frequency != rx_frequency)
+		LOGP(DSDR, LOGL_NOTICE, "TX and RX center frequencies differ, use external loopback ('-l 2') to receive what is sent.\n");
+
+	return 0;
+}
+
+void iqloop_close(iqloop_t *loop)
+{
+	free(loop->ring);
+	loop->ring = NULL;
+}
+
+int iqloop_send(iqloop_t *loop, float *buff, int num)
+{
+	int chunk, sent = 0;
+
+	if (num > loop->size - loop->fill)
+		num = loop->size - loop->fill;
+
+	while (sent < num) {
+		chunk = loop->size - loop->in;
+		if (chunk > num - sent)
+			chunk = num - sent;
+		iqshm_mixer_process(&loop->mixer, loop->ring + loop->in * 2, buff + sent * 2, chunk);
+		loop->in = (loop->in + chunk) % loop->size;
+		sent += chunk;
+	}
+	loop->fill += num;
+
+	return num;
+}
+
+int iqloop_receive(iqloop_t *loop, float *buff, int max)
+{
+	int chunk, count = 0;
+
+	if (max > loop->fill)
+		max = loop->fill;
+
+	while (count < max) {
+		chunk = loop->size - loop->out;
+		if (chunk > max - count)
+			chunk = max - count;
+		memcpy(buff + count * 2, loop->ring + loop->out * 2, chunk * 2 * sizeof(*buff));
+		loop->out = (loop->out + chunk) % loop->size;
+		count += chunk;
+	}
+	loop->fill -= max;
+
+	return max;
+}
+
+/* send as much as has been received, so the loop does not grow */
+int iqloop_get_tosend(iqloop_t *loop, int buffer_size)
+{
+	int count;
+
+	count = buffer_size - loop->fill;
+	if (count < 0)
+		count = 0;
+
+	return count;
+}
@@ -0,0 +1,20 @@
+#ifndef _LIBSDR_IQLOOP_H
+#define _LIBSDR_IQLOOP_H
+
+#include "iqshm.h"
+
+/* TX samples are looped back to RX in memory, no hardware is attached */
+typedef struct iqloop {
+	float			*ring;
+	int			size;		/* complex samples in ring */
+	int			in, out, fill;
+	iqshm_mixer_t		mixer;		/* shift from TX to RX center frequency */
+} iqloop_t;
+
+int iqloop_open(iqloop_t *loop, double tx_frequency, double rx_frequency, double rate, int size);
+void iqloop_close(iqloop_t *loop);
+int iqloop_send(iqloop_t *loop, float *buff, int num);
+int iqloop_receive(iqloop_t *loop, float *buff, int max);
+int iqloop_get_tosend(iqloop_t *loop, int buffer_size);
+
+#endif /* _LIBSDR_IQLOOP_H */
@@ -0,0 +1,684 @@
+/* IQ stream transport via UDP, for remote radio heads
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The hub next to the antenna streams received samples to one client and
+ * transmits the samples it gets from the client. The client announces itself
+ * with a hello packet, which it repeats every second. The hub replies with
+ * its sample rate and center frequencies.
+ *
+ * Each packet carries a sequence number and the time stamp of its first
+ * sample. The receiving side places samples by time stamp into a jitter
+ * buffer, so reordered packets are fixed and lost packets become silence.
+ *
+ * Integer samples may be delta coded: The difference of each I and Q value to
+ * the previous one of the packet is zig-zag mapped and written as variable
+ * length integer. This is lossless and each packet can be decoded on its own.
+ * If coding does not make the packet smaller, it is sent raw.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "iqnet.h"
+#include "wire_format.h"
+#include "../liblogging/logging.h"
+
+#define HELLO_SIZE	20
+#define HELLO_TRIES	3
+
+struct packet {
+	int		type;
+	int		format;
+	int		flags;
+	int		count;
+	uint32_t	seq;
+	uint64_t	timestamp;
+};
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = v >> 8; p[1] = v; }
+static void put32(uint8_t *p, uint32_t v) { put16(p, v >> 16); put16(p + 2, v); }
+static void put64(uint8_t *p, uint64_t v) { put32(p, v >> 32); put32(p + 4, v); }
+static uint16_t get16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t get32(const uint8_t *p) { return ((uint32_t)get16(p) << 16) | get16(p + 2); }
+static uint64_t get64(const uint8_t *p) { return ((uint64_t)get32(p) << 32) | get32(p + 4); }
+
+static void encode_header(uint8_t *p, const struct packet *pkt)
+{
+	put16(p, IQNET_MAGIC);
+	p[2] = IQNET_VERSION;
+	p[3] = pkt->type;
+	p[4] = pkt->format;
+	p[5] = pkt->flags;
+	put16(p + 6, pkt->count);
+	put32(p + 8, pkt->seq);
+	put64(p + 12, pkt->timestamp);
+}
+
+static int decode_header(const uint8_t *p, int len, struct packet *pkt)
+{
+	if (len < IQNET_HEADER_SIZE || get16(p) != IQNET_MAGIC || p[2] != IQNET_VERSION)
+		return -EINVAL;
+	pkt->type = p[3];
+	pkt->format = p[4];
+	pkt->flags = p[5];
+	pkt->count = get16(p + 6);
+	pkt->seq = get32(p + 8);
+	pkt->timestamp = get64(p + 12);
+	if (pkt->format > SDR_WIRE_CS8)
+		return -EINVAL;
+	if (pkt->count > IQNET_MAX_PAYLOAD / wire_format_size(pkt->format))
+		return -EINVAL;
+
+	return 0;
+}
+
+/* encode samples to payload, return length */
+static int encode_samples(int format, int compress, const float *in, int num, uint8_t *out, int *flags)
+{
+	uint8_t values[IQNET_MAX_PAYLOAD];
+	int16_t *v16 = (int16_t *)values;
+	int8_t *v8 = (int8_t *)values;
+	int raw_size = num * wire_format_size(format);
+	int prev[2] = { 0, 0 };
+	int32_t v, d;
+	uint32_t u;
+	int i, len;
+
+	*flags = 0;
+	if (format == SDR_WIRE_CF32) {
+		/* float samples are sent in host byte order */
+		memcpy(out, in, raw_size);
+		return raw_size;
+	}
+
+	wire_format_from_float(format, in, values, num);
+
+	if (compress) {
+		len = 0;
+		for (i = 0; i < num * 2 && len < raw_size; i++) {
+			v = (format == SDR_WIRE_CS16) ? v16[i] : v8[i];
+			d = v - prev[i & 1];
+			prev[i & 1] = v;
+			u = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+			while (u >= 0x80) {
+				out[len++] = u | 0x80;
+				u >>= 7;
+			}
+			out[len++] = u;
+		}
+		if (len < raw_size) {
+			*flags = IQNET_FLAG_COMPRESS;
+			return len;
+		}
+	}
+
+	if (format == SDR_WIRE_CS16) {
+		/* little endian, like the wire format of most devices */
+		for (i = 0; i < num * 2; i++) {
+			out[i * 2] = v16[i];
+			out[i * 2 + 1] = (uint16_t)v16[i] >> 8;
+		}
+	} else
+		memcpy(out, values, raw_size);
+
+	return raw_size;
+}
+
+/* decode payload to samples */
+static int decode_samples(const struct packet *pkt, const uint8_t *in, int len, float *out)
+{
+	uint8_t values[IQNET_MAX_PAYLOAD];
+	int16_t *v16 = (int16_t *)values;
+	int8_t *v8 = (int8_t *)values;
+	int num = pkt->count;
+	int prev[2] = { 0, 0 };
+	uint32_t u;
+	int32_t v;
+	int i, pos, shift;
+
+	if (pkt->format == SDR_WIRE_CF32) {
+		if (len != num * wire_format_size(pkt->format))
+			return -EINVAL;
+		memcpy(out, in, len);
+		return 0;
+	}
+
+	if ((pkt->flags & IQNET_FLAG_COMPRESS)) {
+		pos = 0;
+		for (i = 0; i < num * 2; i++) {
+			u = 0;
+			shift = 0;
+			do {
+				if (pos == len || shift > 28)
+					return -EINVAL;
+				u |= (uint32_t)(in[pos] & 0x7f) << shift;
+				shift += 7;
+			} while ((in[pos++] & 0x80));
+			v = prev[i & 1] + (int32_t)((u >> 1) ^ -(u & 1));
+			prev[i & 1] = v;
+			if (pkt->format == SDR_WIRE_CS16)
+				v16[i] = v;
+			else
+				v8[i] = v;
+		}
+		if (pos != len)
+			return -EINVAL;
+	} else {
+		if (len != num * wire_format_size(pkt->format))
+			return -EINVAL;
+		if (pkt->format == SDR_WIRE_CS16) {
+			for (i = 0; i < num * 2; i++)
+				v16[i] = in[i * 2] | (in[i * 2 + 1] << 8);
+		} else
+			memcpy(values, in, len);
+	}
+
+	wire_format_to_float(pkt->format, values, out, num);
+
+	return 0;
+}
+
+static int jitter_init(iqnet_jitter_t *j, int size, int delay)
+{
+	memset(j, 0, sizeof(*j));
+	if (delay > size / 2)
+		delay = size / 2;
+	j->size = size;
+	j->delay = delay;
+	j->ring = calloc(size * 2, sizeof(*j->ring));
+	if (!j->ring) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void jitter_exit(iqnet_jitter_t *j)
+{
+	free(j->ring);
+	j->ring = NULL;
+}
+
+static void jitter_reset(iqnet_jitter_t *j)
+{
+	j->started = 0;
+	j->playing = 0;
+	memset(j->ring, 0, j->size * 2 * sizeof(*j->ring));
+}
+
+static void jitter_put(iqnet_jitter_t *j, const struct packet *pkt, const float *samples)
+{
+	uint64_t ts = pkt->timestamp;
+	int num = pkt->count;
+	int skip, pos, chunk;
+
+	if (!j->started || ts + num + j->size < j->read_pos || ts + num > j->read_pos + j->size) {
+		/* first packet, or peer restarted */
+		if (j->started)
+			LOGP(DSDR, LOGL_NOTICE, "Time stamp jumped, resyncing jitter buffer\n");
+		jitter_reset(j);
+		j->started = 1;
+		j->read_pos = ts;
+		j->high = ts;
+		j->seq = pkt->seq;
+	}
+
+	if ((int32_t)(pkt->seq - j->seq) > 0) {
+		j->lost += pkt->seq - j->seq;
+		LOGP(DSDR, LOGL_DEBUG, "Lost %u packets\n", pkt->seq - j->seq);
+	}
+	if ((int32_t)(pkt->seq - j->seq) >= 0)
+		j->seq = pkt->seq + 1;
+
+	if (ts + num <= j->read_pos) {
+		j->late++;
+		LOGP(DSDR, LOGL_DEBUG, "Dropping late packet\n");
+		return;
+	}
+
+	skip = (ts < j->read_pos) ? j->read_pos - ts : 0;
+	samples += skip * 2;
+	ts += skip;
+	num -= skip;
+	while (num) {
+		pos = ts % j->size;
+		chunk = j->size - pos;
+		if (chunk > num)
+			chunk = num;
+		memcpy(j->ring + pos * 2, samples, chunk * 2 * sizeof(*samples));
+		samples += chunk * 2;
+		ts += chunk;
+		num -= chunk;
+	}
+	if (ts > j->high)
+		j->high = ts;
+}
+
+/* read (or add) samples, clear them in the ring, so missing samples are silence next round */
+static void jitter_read(iqnet_jitter_t *j, float *out, int num, int add)
+{
+	int pos, chunk, s;
+
+	while (num) {
+		pos = j->read_pos % j->size;
+		chunk = j->size - pos;
+		if (chunk > num)
+			chunk = num;
+		if (add) {
+			for (s = 0; s < chunk * 2; s++)
+				out[s] += j->ring[pos * 2 + s];
+		} else
+			memcpy(out, j->ring + pos * 2, chunk * 2 * sizeof(*out));
+		memset(j->ring + pos * 2, 0, chunk * 2 * sizeof(*out));
+		out += chunk * 2;
+		j->read_pos += chunk;
+		num -= chunk;
+	}
+}
+
+static void send_packet(iqnet_t *net, const uint8_t *data, int len)
+{
+	int rc;
+
+	if (net->hub)
+		rc = sendto(net->sock, data, len, MSG_DONTWAIT, (struct sockaddr *)&net->peer, sizeof(net->peer));
+	else
+		rc = send(net->sock, data, len, MSG_DONTWAIT);
+	if (rc < 0 && errno != EAGAIN && errno != ECONNREFUSED)
+		LOGP(DSDR, LOGL_DEBUG, "Failed to send packet (%s)\n", strerror(errno));
+}
+
+static void send_hello(iqnet_t *net)
+{
+	uint8_t data[IQNET_HEADER_SIZE + HELLO_SIZE];
+	struct packet pkt;
+
+	memset(&pkt, 0, sizeof(pkt));
+	pkt.type = IQNET_TYPE_HELLO;
+	pkt.format = net->format;
+	pkt.flags = (net->compress) ? IQNET_FLAG_COMPRESS : 0;
+	pkt.seq = net->seq;
+	pkt.timestamp = net->tx_write;
+	encode_header(data, &pkt);
+	put32(data + IQNET_HEADER_SIZE, net->samplerate);
+	put64(data + IQNET_HEADER_SIZE + 4, llround(net->tx_frequency));
+	put64(data + IQNET_HEADER_SIZE + 12, llround(net->rx_frequency));
+	send_packet(net, data, sizeof(data));
+}
+
+static void send_samples(iqnet_t *net, int type, const float *buff, int num)
+{
+	uint8_t data[IQNET_HEADER_SIZE + IQNET_MAX_PAYLOAD + 8];
+	struct packet pkt;
+	int chunk, len;
+
+	while (num) {
+		chunk = (num > net->spp) ? net->spp : num;
+		len = encode_samples(net->format, net->compress, buff, chunk, data + IQNET_HEADER_SIZE, &pkt.flags);
+		pkt.type = type;
+		pkt.format = net->format;
+		pkt.count = chunk;
+		pkt.seq = net->seq++;
+		pkt.timestamp = net->tx_write;
+		encode_header(data, &pkt);
+		send_packet(net, data, IQNET_HEADER_SIZE + len);
+		buff += chunk * 2;
+		net->tx_write += chunk;
+		num -= chunk;
+	}
+}
+
+/* receive all pending packets, return -EAGAIN if none */
+static int receive_packets(iqnet_t *net)
+{
+	uint8_t data[IQNET_HEADER_SIZE + IQNET_MAX_PAYLOAD + 8];
+	float samples[IQNET_MAX_PAYLOAD * 2];
+	struct sockaddr_in from;
+	socklen_t from_len;
+	struct packet pkt;
+	int len, match, got = 0;
+
+	while (42) {
+		from_len = sizeof(from);
+		len = recvfrom(net->sock, data, sizeof(data), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+		if (len < 0)
+			break;
+		if (decode_header(data, len, &pkt) < 0)
+			continue;
+		got = 1;
+		if (pkt.type == IQNET_TYPE_HELLO) {
+			if (net->hub && len >= IQNET_HEADER_SIZE + HELLO_SIZE) {
+				double tx_frequency = get64(data + IQNET_HEADER_SIZE + 4);
+				double rx_frequency = get64(data + IQNET_HEADER_SIZE + 12);
+
+				/* only stream to clients that match */
+				match = ((int)get32(data + IQNET_HEADER_SIZE) == net->samplerate && fabs(tx_frequency - net->tx_frequency) <= 1.0 && fabs(rx_frequency - net->rx_frequency) <= 1.0);
+				if (match && (!net->peer_valid || from.sin_addr.s_addr != net->peer.sin_addr.s_addr || from.sin_port != net->peer.sin_port)) {
+					LOGP(DSDR, LOGL_INFO, "Remote client %s:%d attached (%s%s)\n", inet_ntoa(from.sin_addr), ntohs(from.sin_port), wire_format_name(pkt.format), (pkt.flags & IQNET_FLAG_COMPRESS) ? ", compressed" : "");
+					jitter_reset(&net->jitter);
+				}
+				/* reply our parameters, so client can check them */
+				net->peer = from;
+				net->peer_valid = match;
+				net->idle = 0;
+				send_hello(net);
+				if (!match)
+					continue;
+				net->format = pkt.format;
+				net->compress = !!(pkt.flags & IQNET_FLAG_COMPRESS);
+				net->spp = IQNET_MAX_PAYLOAD / wire_format_size(net->format);
+			}
+			continue;
+		}
+		if (pkt.type != ((net->hub) ? IQNET_TYPE_TX : IQNET_TYPE_RX))
+			continue;
+		if (net->hub && (!net->peer_valid || from.sin_addr.s_addr != net->peer.sin_addr.s_addr || from.sin_port != net->peer.sin_port))
+			continue;
+		if (decode_samples(&pkt, data + IQNET_HEADER_SIZE, len - IQNET_HEADER_SIZE, samples) < 0) {
+			LOGP(DSDR, LOGL_DEBUG, "Dropping corrupt packet\n");
+			continue;
+		}
+		jitter_put(&net->jitter, &pkt, samples);
+	}
+
+	return (got) ? 0 : -EAGAIN;
+}
+
+static int parse_address(const char *address, struct sockaddr_in *sin)
+{
+	struct addrinfo hints, *res;
+	char host[256];
+	const char *colon;
+	int rc;
+
+	colon = strrchr(address, ':');
+	if (!colon || colon == address || (size_t)(colon - address) >= sizeof(host)) {
+		LOGP(DSDR, LOGL_ERROR, "Address '%s' must be given as <host>:<port>!\n", address);
+		return -EINVAL;
+	}
+	memcpy(host, address, colon - address);
+	host[colon - address] = '\0';
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	rc = getaddrinfo(host, colon + 1, &hints, &res);
+	if (rc) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to resolve '%s' (%s)\n", address, gai_strerror(rc));
+		return -EINVAL;
+	}
+	memcpy(sin, res->ai_addr, sizeof(*sin));
+	freeaddrinfo(res);
+
+	return 0;
+}
+
+int iqnet_open(iqnet_t *net, const char *address, int format, int compress, double tx_frequency, double rx_frequency, double rate, int jitter_size, int delay)
+{
+	uint8_t data[IQNET_HEADER_SIZE + IQNET_MAX_PAYLOAD + 8];
+	struct sockaddr_in sin;
+	struct pollfd pfd;
+	struct packet pkt;
+	int hub_rate = 0;
+	double hub_tx = 0.0, hub_rx = 0.0;
+	int rc, len, tries;
+
+	memset(net, 0, sizeof(*net));
+	net->sock = -1;
+	net->samplerate = rate;
+	net->tx_frequency = tx_frequency;
+	net->rx_frequency = rx_frequency;
+	net->format = format;
+	net->compress = compress;
+	net->spp = IQNET_MAX_PAYLOAD / wire_format_size(format);
+
+	rc = parse_address(address, &sin);
+	if (rc < 0)
+		return rc;
+
+	net->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (net->sock < 0 || connect(net->sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to create socket to '%s' (%s)\n", address, strerror(errno));
+		goto error;
+	}
+
+	/* ask hub for its parameters */
+	pfd.fd = net->sock;
+	pfd.events = POLLIN;
+	for (tries = 0; tries < HELLO_TRIES && !hub_rate; tries++) {
+		send_hello(net);
+		while (poll(&pfd, 1, 1000) > 0) {
+			len = recv(net->sock, data, sizeof(data), MSG_DONTWAIT);
+			if (len < IQNET_HEADER_SIZE + HELLO_SIZE || decode_header(data, len, &pkt) < 0 || pkt.type != IQNET_TYPE_HELLO)
+				continue;
+			hub_rate = get32(data + IQNET_HEADER_SIZE);
+			hub_tx = get64(data + IQNET_HEADER_SIZE + 4);
+			hub_rx = get64(data + IQNET_HEADER_SIZE + 12);
+			break;
+		}
+	}
+	if (!hub_rate) {
+		LOGP(DSDR, LOGL_ERROR, "No reply from IQ hub at '%s'!\n", address);
+		goto error;
+	}
+	if ((double)hub_rate != rate) {
+		LOGP(DSDR, LOGL_ERROR, "Sample rate %.0f does not match the hub's rate, use '--sdr-samplerate %d'!\n", rate, hub_rate);
+		goto error;
+	}
+	if (fabs(hub_tx - tx_frequency) > 1.0 || fabs(hub_rx - rx_frequency) > 1.0) {
+		LOGP(DSDR, LOGL_ERROR, "Center frequency TX %.6f MHz, RX %.6f MHz does not match the hub's TX %.6f MHz, RX %.6f MHz!\n", tx_frequency / 1e6, rx_frequency / 1e6, hub_tx / 1e6, hub_rx / 1e6);
+		goto error;
+	}
+
+	rc = jitter_init(&net->jitter, jitter_size, delay);
+	if (rc < 0)
+		goto error;
+
+	LOGP(DSDR, LOGL_INFO, "Connected to IQ hub at '%s' (%s%s)\n", address, wire_format_name(format), (compress) ? ", compressed" : "");
+
+	return 0;
+
+error:
+	iqnet_close(net);
+	return -EIO;
+}
+
+int iqnet_start(iqnet_t *net)
+{
+	jitter_reset(&net->jitter);
+	net->tx_started = 0;
+	send_hello(net);
+
+	return 0;
+}
+
+void iqnet_close(iqnet_t *net)
+{
+	/* instance may be zeroed, if never opened */
+	if (net->sock > 0)
+		close(net->sock);
+	net->sock = -1;
+	jitter_exit(&net->jitter);
+}
+
+int iqnet_send(iqnet_t *net, float *buff, int num)
+{
+	send_samples(net, IQNET_TYPE_TX, buff, num);
+
+	return num;
+}
+
+int iqnet_receive(iqnet_t *net, float *buff, int max, double timeout)
+{
+	iqnet_jitter_t *j = &net->jitter;
+	struct pollfd pfd;
+	int num = 0;
+
+	pfd.fd = net->sock;
+	pfd.events = POLLIN;
+	while (42) {
+		receive_packets(net);
+		/* hold back delay, so late packets can still be placed */
+		if (j->started && j->high > j->read_pos + j->delay)
+			num = j->high - j->delay - j->read_pos;
+		if (num || timeout <= 0.0)
+			break;
+		if (poll(&pfd, 1, ceil(timeout * 1000.0)) <= 0)
+			break;
+		timeout = 0.0;
+	}
+	if (num > max)
+		num = max;
+	jitter_read(j, buff, num, 0);
+
+	/* keep alive */
+	net->hello_count += num;
+	if (net->hello_count >= net->samplerate) {
+		net->hello_count = 0;
+		send_hello(net);
+		if (j->lost || j->late)
+			LOGP(DSDR, LOGL_NOTICE, "Lost %u and dropped %u late packets\n", j->lost, j->late);
+		j->lost = j->late = 0;
+	}
+
+	return num;
+}
+
+int iqnet_get_tosend(iqnet_t *net, int buffer_size)
+{
+	iqnet_jitter_t *j = &net->jitter;
+	int64_t tosend;
+
+	/* transmit in advance of what we received */
+	if (!j->started)
+		return 0;
+	if (!net->tx_started) {
+		net->tx_started = 1;
+		net->tx_write = j->read_pos;
+	}
+	tosend = (int64_t)(j->read_pos + buffer_size - net->tx_write);
+	if (tosend < 0)
+		tosend = 0;
+	if (tosend > buffer_size)
+		tosend = buffer_size;
+
+	return tosend;
+}
+
+int iqnet_hub_create(iqnet_t *net, int port, double tx_frequency, double rx_frequency, int rate, int jitter_size, int delay)
+{
+	struct sockaddr_in sin;
+	int rc;
+
+	memset(net, 0, sizeof(*net));
+	net->hub = 1;
+	net->samplerate = rate;
+	net->tx_frequency = tx_frequency;
+	net->rx_frequency = rx_frequency;
+	net->format = SDR_WIRE_CS16;
+	net->spp = IQNET_MAX_PAYLOAD / wire_format_size(net->format);
+
+	net->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (net->sock < 0) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to create socket (%s)\n", strerror(errno));
+		return -EIO;
+	}
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	sin.sin_port = htons(port);
+	if (bind(net->sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to bind UDP port %d (%s)\n", port, strerror(errno));
+		iqnet_hub_destroy(net);
+		return -EIO;
+	}
+
+	rc = jitter_init(&net->jitter, jitter_size, delay);
+	if (rc < 0) {
+		iqnet_hub_destroy(net);
+		return rc;
+	}
+
+	LOGP(DSDR, LOGL_INFO, "Waiting for remote client on UDP port %d\n", port);
+
+	return 0;
+}
+
+void iqnet_hub_destroy(iqnet_t *net)
+{
+	iqnet_close(net);
+}
+
+void iqnet_hub_poll(iqnet_t *net)
+{
+	receive_packets(net);
+}
+
+/* stream received samples to client */
+void iqnet_hub_rx(iqnet_t *net, const float *buff, int num)
+{
+	if (!net->peer_valid) {
+		net->tx_write += num;
+		return;
+	}
+
+	send_samples(net, IQNET_TYPE_RX, buff, num);
+
+	/* client vanished */
+	net->hello_count += num;
+	if (net->hello_count >= net->samplerate) {
+		net->hello_count = 0;
+		if (++net->idle == 5) {
+			LOGP(DSDR, LOGL_INFO, "Remote client %s:%d detached\n", inet_ntoa(net->peer.sin_addr), ntohs(net->peer.sin_port));
+			net->peer_valid = 0;
+			jitter_reset(&net->jitter);
+		}
+		if (net->jitter.lost || net->jitter.late)
+			LOGP(DSDR, LOGL_NOTICE, "Lost %u and dropped %u late packets\n", net->jitter.lost, net->jitter.late);
+		net->jitter.lost = net->jitter.late = 0;
+	}
+}
+
+/* add samples from client to what is transmitted */
+void iqnet_hub_tx(iqnet_t *net, float *mix, int num)
+{
+	iqnet_jitter_t *j = &net->jitter;
+
+	if (!net->peer_valid || !j->started)
+		return;
+	if (!j->playing) {
+		if (j->high < j->read_pos + j->delay)
+			return;
+		j->playing = 1;
+	}
+	jitter_read(j, mix, num, 1);
+	if (j->read_pos >= j->high) {
+		LOGP(DSDR, LOGL_NOTICE, "TX underrun of remote client, refilling jitter buffer\n");
+		j->playing = 0;
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef _LIBSDR_IQNET_H
+#define _LIBSDR_IQNET_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+#define IQNET_MAGIC		0x4951		/* "IQ" */
+#define IQNET_VERSION		1
+#define IQNET_TYPE_HELLO	1		/* client announces itself, hub replies with its parameters */
+#define IQNET_TYPE_RX		2		/* received samples, hub -> client */
+#define IQNET_TYPE_TX		3		/* samples to transmit, client -> hub */
+#define IQNET_FLAG_COMPRESS	0x01		/* payload is delta coded */
+#define IQNET_HEADER_SIZE	20
+#define IQNET_MAX_PAYLOAD	1400		/* raw payload, so packets are not fragmented */
+
+/* reorder buffer, samples are placed by time stamp, missing samples become silence */
+typedef struct iqnet_jitter {
+	float			*ring;
+	int			size;		/* complex samples in ring */
+	int			delay;		/* samples held back to wait for late packets */
+	int			started;	/* got first packet */
+	int			playing;	/* buffer was filled up to delay (hub only) */
+	uint64_t		read_pos;	/* next sample to read */
+	uint64_t		high;		/* end of latest sample written */
+	uint32_t		seq;		/* expected sequence number */
+	unsigned int		lost, late;	/* statistics */
+} iqnet_jitter_t;
+
+/* instance of a network IQ transport (client or hub) */
+typedef struct iqnet {
+	int			hub;		/* we serve a remote client */
+	int			sock;
+	struct sockaddr_in	peer;		/* client's address (hub only) */
+	int			peer_valid;
+	int			idle;		/* seconds without hello from peer (hub only) */
+	int			samplerate;
+	double			tx_frequency, rx_frequency;
+	int			format;		/* SDR_WIRE_* on the network */
+	int			compress;	/* delta code the payload */
+	int			spp;		/* samples per packet */
+	uint32_t		seq;		/* sequence number of transmitted packets */
+	uint64_t		tx_write;	/* time stamp of next sample to send */
+	int			tx_started;
+	int			hello_count;	/* samples since last hello */
+	iqnet_jitter_t		jitter;		/* RX at client, TX at hub */
+} iqnet_t;
+
+int iqnet_open(iqnet_t *net, const char *address, int format, int compress, double tx_frequency, double rx_frequency, double rate, int jitter_size, int delay);
+int iqnet_start(iqnet_t *net);
+void iqnet_close(iqnet_t *net);
+int iqnet_send(iqnet_t *net, float *buff, int num);
+int iqnet_receive(iqnet_t *net, float *buff, int max, double timeout);
+int iqnet_get_tosend(iqnet_t *net, int buffer_size);
+
+int iqnet_hub_create(iqnet_t *net, int port, double tx_frequency, double rx_frequency, int rate, int jitter_size, int delay);
+void iqnet_hub_destroy(iqnet_t *net);
+void iqnet_hub_poll(iqnet_t *net);
+void iqnet_hub_rx(iqnet_t *net, const float *buff, int num);
+void iqnet_hub_tx(iqnet_t *net, float *mix, int num);
+
+#endif /* _LIBSDR_IQNET_H */
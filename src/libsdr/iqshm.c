@@ -0,0 +1,447 @@
+/* IQ stream fan-out between processes via shared memory
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The hub owns the SDR device. It writes every received sample into the RX
+ * ring and advances 'rx_write'. Each client reads the ring from its own
+ * position, so there is no limit on the number of readers.
+ *
+ * Each client slot has its own TX ring. A client writes samples ahead of the
+ * hub's 'tx_read' position. The hub sums all slots at 'tx_read' and sends the
+ * result to the device. Samples of a client that is late are skipped.
+ *
+ * Clients may use a different center frequency than the hub. Their samples
+ * are shifted by the difference, so the channels stay within the spectrum of
+ * the device. All positions are written by one side only, so no locking is
+ * required.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "iqshm.h"
+#include "../liblogging/logging.h"
+
+#define HEADER_SIZE	((sizeof(struct iqshm_header) + 63) & ~(size_t)63)
+
+static size_t shm_size(int ring_size)
+{
+	return HEADER_SIZE + (size_t)(1 + IQSHM_MAX_CLIENTS) * ring_size * 2 * sizeof(float);
+}
+
+/* shm_open requires a name with leading slash */
+static void shm_path(char *path, size_t size, const char *name)
+{
+	snprintf(path, size, "%s%s", (name[0] == '/') ? "" : "/", name);
+}
+
+static void shm_map(iqshm_t *shm, void *base)
+{
+	shm->header = base;
+	shm->rx_ring = (float *)((uint8_t *)base + HEADER_SIZE);
+	shm->tx_rings = shm->rx_ring + shm->header->ring_size * 2;
+}
+
+void iqshm_mixer_init(iqshm_mixer_t *mixer, double offset, double rate)
+{
+	memset(mixer, 0, sizeof(*mixer));
+	mixer->enabled = (offset != 0.0);
+	mixer->phasor_I = 1.0;
+	mixer->phasor_Q = 0.0;
+	mixer->rot_I = cos(2.0 * M_PI * offset / rate);
+	mixer->rot_Q = sin(2.0 * M_PI * offset / rate);
+}
+
+/* out = in * phasor, phasor rotates each sample */
+void iqshm_mixer_process(iqshm_mixer_t *mixer, float *out, const float *in, int num)
+{
+	double p_I = mixer->phasor_I, p_Q = mixer->phasor_Q;
+	double r_I = mixer->rot_I, r_Q = mixer->rot_Q;
+	double I, Q, mag;
+	int s;
+
+	if (!mixer->enabled) {
+		memcpy(out, in, num * 2 * sizeof(*out));
+		return;
+	}
+
+	for (s = 0; s < num; s++) {
+		I = in[s * 2];
+		Q = in[s * 2 + 1];
+		out[s * 2] = I * p_I - Q * p_Q;
+		out[s * 2 + 1] = I * p_Q + Q * p_I;
+		I = p_I * r_I - p_Q * r_Q;
+		p_Q = p_I * r_Q + p_Q * r_I;
+		p_I = I;
+	}
+
+	/* keep the phasor on the unit circle */
+	mixer->count += num;
+	if (mixer->count >= 1024) {
+		mixer->count = 0;
+		mag = sqrt(p_I * p_I + p_Q * p_Q);
+		p_I /= mag;
+		p_Q /= mag;
+	}
+	mixer->phasor_I = p_I;
+	mixer->phasor_Q = p_Q;
+}
+
+static int pid_alive(int pid)
+{
+	return (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+int iqshm_open(iqshm_t *shm, const char *name, double tx_frequency, double rx_frequency, double rate)
+{
+	struct iqshm_header *header;
+	struct stat st;
+	char path[256];
+	void *base;
+	int expected;
+	int fd, i;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->name = name;
+	shm->slot = -1;
+
+	shm_path(path, sizeof(path), name);
+	fd = shm_open(path, O_RDWR, 0);
+	if (fd < 0) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to open shared memory '%s', is the hub running? (%s)\n", path, strerror(errno));
+		return -EIO;
+	}
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*header)) {
+		LOGP(DSDR, LOGL_ERROR, "Shared memory '%s' is not initialized!\n", path);
+		close(fd);
+		return -EIO;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to map shared memory '%s' (%s)\n", path, strerror(errno));
+		return -EIO;
+	}
+	header = base;
+	shm->size = st.st_size;
+	if (header->magic != IQSHM_MAGIC || header->version != IQSHM_VERSION || shm_size(header->ring_size) > shm->size) {
+		LOGP(DSDR, LOGL_ERROR, "Shared memory '%s' is not an IQ hub of this version!\n", path);
+		munmap(base, shm->size);
+		return -EINVAL;
+	}
+	shm_map(shm, base);
+
+	if ((double)header->samplerate != rate) {
+		LOGP(DSDR, LOGL_ERROR, "Sample rate %.0f does not match the hub's rate, use '--sdr-samplerate %d'!\n", rate, header->samplerate);
+		goto error;
+	}
+	if (fabs(tx_frequency - header->tx_frequency) > rate / 2.0 || fabs(rx_frequency - header->rx_frequency) > rate / 2.0) {
+		LOGP(DSDR, LOGL_ERROR, "Center frequency is outside the hub's spectrum (TX %.6f MHz, RX %.6f MHz)!\n", header->tx_frequency / 1e6, header->rx_frequency / 1e6);
+		goto error;
+	}
+
+	/* claim a slot, take over slots of processes that died */
+	for (i = 0; i < IQSHM_MAX_CLIENTS; i++) {
+		if (__atomic_load_n(&header->client[i].used, __ATOMIC_ACQUIRE) && !pid_alive(header->client[i].pid))
+			__atomic_store_n(&header->client[i].used, 0, __ATOMIC_RELEASE);
+		expected = 0;
+		if (__atomic_compare_exchange_n(&header->client[i].used, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			break;
+	}
+	if (i == IQSHM_MAX_CLIENTS) {
+		LOGP(DSDR, LOGL_ERROR, "All %d client slots of the hub are in use!\n", IQSHM_MAX_CLIENTS);
+		goto error;
+	}
+	shm->slot = i;
+	header->client[i].pid = getpid();
+	__atomic_store_n(&header->client[i].tx_write, __atomic_load_n(&header->tx_read, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+	/* hub spectrum -> our spectrum and back */
+	iqshm_mixer_init(&shm->rx_mixer, header->rx_frequency - rx_frequency, rate);
+	iqshm_mixer_init(&shm->tx_mixer, tx_frequency - header->tx_frequency, rate);
+
+	LOGP(DSDR, LOGL_INFO, "Attached to IQ hub '%s' at slot %d, offset TX %.0f Hz, RX %.0f Hz\n", path, i, tx_frequency - header->tx_frequency, rx_frequency - header->rx_frequency);
+
+	return 0;
+
+error:
+	iqshm_close(shm);
+	return -EINVAL;
+}
+
+int iqshm_start(iqshm_t *shm)
+{
+	struct iqshm_header *header = shm->header;
+
+	if (!__atomic_load_n(&header->running, __ATOMIC_ACQUIRE)) {
+		LOGP(DSDR, LOGL_ERROR, "IQ hub '%s' is not streaming!\n", shm->name);
+		return -EIO;
+	}
+
+	/* start with the latest samples */
+	shm->rx_read = __atomic_load_n(&header->rx_write, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&header->client[shm->slot].tx_write, __atomic_load_n(&header->tx_read, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void iqshm_close(iqshm_t *shm)
+{
+	if (!shm->header)
+		return;
+
+	if (shm->hub) {
+		iqshm_hub_destroy(shm);
+		return;
+	}
+
+	if (shm->slot >= 0)
+		__atomic_store_n(&shm->header->client[shm->slot].used, 0, __ATOMIC_RELEASE);
+	munmap(shm->header, shm->size);
+	shm->header = NULL;
+}
+
+int iqshm_send(iqshm_t *shm, float *buff, int num)
+{
+	struct iqshm_header *header = shm->header;
+	struct iqshm_client *client = &header->client[shm->slot];
+	float *ring = shm->tx_rings + (size_t)shm->slot * header->ring_size * 2;
+	int ring_size = header->ring_size;
+	uint64_t tx_read, tx_write;
+	int space, pos, chunk;
+
+	tx_read = __atomic_load_n(&header->tx_read, __ATOMIC_ACQUIRE);
+	tx_write = client->tx_write;
+	/* hub passed us, continue at its position */
+	if (tx_write < tx_read)
+		tx_write = tx_read;
+	space = ring_size - (int)(tx_write - tx_read);
+	if (num > space)
+		num = space;
+
+	pos = tx_write % ring_size;
+	chunk = ring_size - pos;
+	if (chunk > num)
+		chunk = num;
+	iqshm_mixer_process(&shm->tx_mixer, ring + pos * 2, buff, chunk);
+	if (num > chunk)
+		iqshm_mixer_process(&shm->tx_mixer, ring, buff + chunk * 2, num - chunk);
+
+	__atomic_store_n(&client->tx_write, tx_write + num, __ATOMIC_RELEASE);
+
+	return num;
+}
+
+int iqshm_receive(iqshm_t *shm, float *buff, int max, double timeout)
+{
+	struct iqshm_header *header = shm->header;
+	int ring_size = header->ring_size;
+	uint64_t rx_write;
+	int num, pos, chunk;
+
+	while (42) {
+		if (!__atomic_load_n(&header->running, __ATOMIC_ACQUIRE)) {
+			LOGP(DSDR, LOGL_ERROR, "IQ hub '%s' has stopped!\n", shm->name);
+			return -EIO;
+		}
+		rx_write = __atomic_load_n(&header->rx_write, __ATOMIC_ACQUIRE);
+		if (rx_write != shm->rx_read || timeout <= 0.0)
+			break;
+		usleep(1000);
+		timeout -= 0.001;
+	}
+
+	/* hub overwrote what we did not read */
+	if (rx_write - shm->rx_read > (uint64_t)ring_size) {
+		LOGP(DSDR, LOGL_NOTICE, "RX overflow, dropping %llu samples\n", (unsigned long long)(rx_write - shm->rx_read - ring_size / 2));
+		shm->rx_read = rx_write - ring_size / 2;
+	}
+
+	num = rx_write - shm->rx_read;
+	if (num > max)
+		num = max;
+
+	pos = shm->rx_read % ring_size;
+	chunk = ring_size - pos;
+	if (chunk > num)
+		chunk = num;
+	iqshm_mixer_process(&shm->rx_mixer, buff, shm->rx_ring + pos * 2, chunk);
+	if (num > chunk)
+		iqshm_mixer_process(&shm->rx_mixer, buff + chunk * 2, shm->rx_ring, num - chunk);
+	shm->rx_read += num;
+
+	return num;
+}
+
+int iqshm_get_tosend(iqshm_t *shm, int buffer_size)
+{
+	struct iqshm_header *header = shm->header;
+	uint64_t tx_read, tx_write;
+	int fill = 0, tosend;
+
+	tx_read = __atomic_load_n(&header->tx_read, __ATOMIC_ACQUIRE);
+	tx_write = header->client[shm->slot].tx_write;
+	if (tx_write > tx_read)
+		fill = tx_write - tx_read;
+	if (buffer_size > header->ring_size)
+		buffer_size = header->ring_size;
+	tosend = buffer_size - fill;
+	if (tosend < 0)
+		tosend = 0;
+
+	return tosend;
+}
+
+int iqshm_hub_create(iqshm_t *shm, const char *name, double tx_frequency, double rx_frequency, int rate, int ring_size)
+{
+	struct iqshm_header *header;
+	char path[256];
+	void *base;
+	int fd;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->name = name;
+	shm->hub = 1;
+	shm->slot = -1;
+	shm->size = shm_size(ring_size);
+
+	shm_path(path, sizeof(path), name);
+	fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0660);
+	if (fd < 0) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to create shared memory '%s' (%s), is another hub running? If not, remove /dev/shm%s.\n", path, strerror(errno), path);
+		return -EIO;
+	}
+	if (ftruncate(fd, shm->size) < 0) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to resize shared memory '%s' (%s)\n", path, strerror(errno));
+		close(fd);
+		shm_unlink(path);
+		return -EIO;
+	}
+	base = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to map shared memory '%s' (%s)\n", path, strerror(errno));
+		shm_unlink(path);
+		return -EIO;
+	}
+
+	/* the mapping is zeroed by ftruncate */
+	header = base;
+	header->samplerate = rate;
+	header->tx_frequency = tx_frequency;
+	header->rx_frequency = rx_frequency;
+	header->ring_size = ring_size;
+	header->version = IQSHM_VERSION;
+	shm_map(shm, base);
+
+	shm->tx_mix = calloc(ring_size * 2, sizeof(*shm->tx_mix));
+	if (!shm->tx_mix) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		iqshm_hub_destroy(shm);
+		return -ENOMEM;
+	}
+	shm->tx_mix_size = ring_size;
+
+	/* clients may attach from now on */
+	__atomic_store_n(&header->running, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->magic, IQSHM_MAGIC, __ATOMIC_RELEASE);
+
+	LOGP(DSDR, LOGL_INFO, "Created IQ hub '%s' with %d samples per ring\n", path, ring_size);
+
+	return 0;
+}
+
+void iqshm_hub_destroy(iqshm_t *shm)
+{
+	char path[256];
+
+	if (shm->header) {
+		__atomic_store_n(&shm->header->running, 0, __ATOMIC_RELEASE);
+		munmap(shm->header, shm->size);
+		shm->header = NULL;
+		shm_path(path, sizeof(path), shm->name);
+		shm_unlink(path);
+	}
+	free(shm->tx_mix);
+	shm->tx_mix = NULL;
+}
+
+/* publish received samples to all clients */
+void iqshm_hub_rx(iqshm_t *shm, const float *buff, int num)
+{
+	struct iqshm_header *header = shm->header;
+	int ring_size = header->ring_size;
+	uint64_t rx_write = header->rx_write;
+	int pos, chunk;
+
+	while (num) {
+		pos = rx_write % ring_size;
+		chunk = ring_size - pos;
+		if (chunk > num)
+			chunk = num;
+		memcpy(shm->rx_ring + pos * 2, buff, chunk * 2 * sizeof(*buff));
+		buff += chunk * 2;
+		num -= chunk;
+		rx_write += chunk;
+	}
+
+	__atomic_store_n(&header->rx_write, rx_write, __ATOMIC_RELEASE);
+}
+
+/* sum the next 'num' samples of all clients, return buffer to send */
+float *iqshm_hub_tx(iqshm_t *shm, int num)
+{
+	struct iqshm_header *header = shm->header;
+	int ring_size = header->ring_size;
+	uint64_t tx_read = header->tx_read, tx_write;
+	float *ring;
+	int c, s, avail, pos;
+
+	if (num > shm->tx_mix_size)
+		num = shm->tx_mix_size;
+	memset(shm->tx_mix, 0, num * 2 * sizeof(*shm->tx_mix));
+
+	for (c = 0; c < IQSHM_MAX_CLIENTS; c++) {
+		if (!__atomic_load_n(&header->client[c].used, __ATOMIC_ACQUIRE))
+			continue;
+		tx_write = __atomic_load_n(&header->client[c].tx_write, __ATOMIC_ACQUIRE);
+		if (tx_write <= tx_read)
+			continue;
+		avail = (tx_write - tx_read > (uint64_t)num) ? num : (int)(tx_write - tx_read);
+		ring = shm->tx_rings + (size_t)c * ring_size * 2;
+		pos = tx_read % ring_size;
+		for (s = 0; s < avail; s++) {
+			shm->tx_mix[s * 2] += ring[pos * 2];
+			shm->tx_mix[s * 2 + 1] += ring[pos * 2 + 1];
+			if (++pos == ring_size)
+				pos = 0;
+		}
+	}
+
+	__atomic_store_n(&header->tx_read, tx_read + num, __ATOMIC_RELEASE);
+
+	return shm->tx_mix;
+}
@@ -0,0 +1,71 @@
+#ifndef _LIBSDR_IQSHM_H
+#define _LIBSDR_IQSHM_H
+
+#include <stdint.h>
+
+#define IQSHM_MAGIC		0x4d485149	/* "IQHM" */
+#define IQSHM_VERSION		1
+#define IQSHM_MAX_CLIENTS	8
+
+/* slot of one network process, attached to the hub */
+struct iqshm_client {
+	int			used;		/* slot is taken */
+	int			pid;		/* process that owns the slot */
+	uint64_t		tx_write;	/* absolute sample position written to TX ring */
+};
+
+/* header at the start of the shared memory, followed by RX ring and TX rings
+ * all positions count complex samples since the hub has been started
+ */
+struct iqshm_header {
+	uint32_t		magic;
+	uint32_t		version;
+	int			samplerate;	/* sample rate of the device */
+	double			tx_frequency;	/* center frequency of the device */
+	double			rx_frequency;
+	int			ring_size;	/* complex samples in each ring */
+	int			running;	/* hub is streaming */
+	uint64_t		rx_write;	/* absolute sample position written to RX ring */
+	uint64_t		tx_read;	/* absolute sample position mixed into device */
+	struct iqshm_client	client[IQSHM_MAX_CLIENTS];
+};
+
+/* shifting a channel between client and hub center frequency */
+typedef struct iqshm_mixer {
+	int			enabled;	/* offset is not 0 */
+	double			phasor_I, phasor_Q;
+	double			rot_I, rot_Q;	/* rotation per sample */
+	int			count;		/* samples since the phasor has been normalized */
+} iqshm_mixer_t;
+
+/* instance of a shared memory attachment (client or hub) */
+typedef struct iqshm {
+	const char		*name;
+	int			hub;		/* we created the shared memory */
+	struct iqshm_header	*header;
+	size_t			size;		/* size of mapping */
+	float			*rx_ring;
+	float			*tx_rings;	/* ring of each client slot */
+	int			slot;		/* client slot */
+	uint64_t		rx_read;	/* absolute sample position read from RX ring */
+	iqshm_mixer_t		rx_mixer, tx_mixer;
+	float			*tx_mix;	/* sum of all clients (hub only) */
+	int			tx_mix_size;
+} iqshm_t;
+
+void iqshm_mixer_init(iqshm_mixer_t *mixer, double offset, double rate);
+void iqshm_mixer_process(iqshm_mixer_t *mixer, float *out, const float *in, int num);
+
+int iqshm_open(iqshm_t *shm, const char *name, double tx_frequency, double rx_frequency, double rate);
+int iqshm_start(iqshm_t *shm);
+void iqshm_close(iqshm_t *shm);
+int iqshm_send(iqshm_t *shm, float *buff, int num);
+int iqshm_receive(iqshm_t *shm, float *buff, int max, double timeout);
+int iqshm_get_tosend(iqshm_t *shm, int buffer_size);
+
+int iqshm_hub_create(iqshm_t *shm, const char *name, double tx_frequency, double rx_frequency, int rate, int ring_size);
+void iqshm_hub_destroy(iqshm_t *shm);
+void iqshm_hub_rx(iqshm_t *shm, const float *buff, int num);
+float *iqshm_hub_tx(iqshm_t *shm, int num);
+
+#endif /* _LIBSDR_IQSHM_H */
@@ -0,0 +1,274 @@
+/* Occupancy detector for wide band monitoring with decoder slots
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* At each interval, a few blocks of the received IQ stream are windowed and
+ * transformed. Their power is averaged into one spectrum. The median of all
+ * bins is taken as noise floor, so the floor is not raised by carriers, as
+ * long as less than half of the band is occupied.
+ *
+ * The usable band is divided into raster channels. The level of each raster
+ * channel is the average of the bins around its center, relative to the noise
+ * floor. A raster channel is occupied, if its level exceeds the threshold and
+ * if it is not lower than the level of its neighbors, so that the sidebands
+ * of a strong carrier do not occupy the neighbor channels. The bins near DC
+ * are not measured, because the DC offset of the SDR would look like a
+ * carrier.
+ *
+ * When a raster channel becomes occupied, a free slot is attached to it. When
+ * its carrier has been quiet for the hold time, the slot is released. The
+ * tune function is called in both cases, so that the channel of the slot can
+ * be tuned to the carrier and demodulation can be started or stopped.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "../liblogging/logging.h"
+#include "scanner.h"
+
+#define SCANNER_INTERVAL	0.1	/* time between evaluations */
+#define SCANNER_AVERAGES	8	/* spectra of each evaluation */
+#define SCANNER_MIN_M		8	/* 256 bins */
+#define SCANNER_MAX_M		14	/* 16384 bins */
+#define SCANNER_BIN_RASTER	8	/* bins per raster channel, at least */
+#define SCANNER_MEASURE		0.8	/* part of raster channel that is measured */
+
+static int compare_power(const void *a, const void *b)
+{
+	double pa = *(const double *)a, pb = *(const double *)b;
+
+	return (pa > pb) - (pa < pb);
+}
+
+int scanner_init(scanner_t *scan, int samplerate, double center_frequency, double usable_bandwidth, double raster, double threshold_db, double hold_time, int slots, void (*tune)(void *priv, int slot, int attach, double offset, double level_db), void *priv)
+{
+	double low, high;
+	int m, i, rc;
+
+	memset(scan, 0, sizeof(*scan));
+	scan->samplerate = samplerate;
+	scan->center_frequency = center_frequency;
+	scan->threshold = pow(10.0, threshold_db / 10.0);
+	scan->hold = (int)ceil(hold_time / SCANNER_INTERVAL);
+	scan->raster = raster;
+	scan->slots = slots;
+	scan->tune = tune;
+	scan->priv = priv;
+
+	/* resolution that gives enough bins for each raster channel */
+	for (m = SCANNER_MIN_M; m < SCANNER_MAX_M; m++) {
+		if ((double)samplerate / (double)(1 << m) <= raster / SCANNER_BIN_RASTER)
+			break;
+	}
+	scan->fft_size = 1 << m;
+	scan->interval = (int)((double)samplerate * SCANNER_INTERVAL);
+	if (scan->interval < scan->fft_size)
+		scan->interval = scan->fft_size;
+	scan->averages = scan->interval / scan->fft_size;
+	if (scan->averages > SCANNER_AVERAGES)
+		scan->averages = SCANNER_AVERAGES;
+	scan->raster_bins = (int)round(raster * SCANNER_MEASURE * (double)scan->fft_size / (double)samplerate);
+	if (scan->raster_bins < 1)
+		scan->raster_bins = 1;
+
+	/* raster channels within the usable band, at multiples of the raster */
+	low = center_frequency - usable_bandwidth / 2.0 + raster / 2.0;
+	high = center_frequency + usable_bandwidth / 2.0 - raster / 2.0;
+	scan->raster_first = ceil(low / raster) * raster - center_frequency;
+	scan->raster_num = (int)floor((high - center_frequency - scan->raster_first) / raster) + 1;
+	if (scan->raster_num < 1) {
+		LOGP(DSDR, LOGL_ERROR, "Scan raster of %.1f kHz is too large for the sample rate of %d Hz.\n", raster / 1e3, samplerate);
+		return -EINVAL;
+	}
+
+	rc = fft_plan_init(&scan->plan, m);
+	if (rc < 0)
+		return rc;
+	scan->window = calloc(scan->fft_size, sizeof(*scan->window));
+	scan->data = calloc(scan->fft_size * 2, sizeof(*scan->data));
+	scan->power = calloc(scan->fft_size, sizeof(*scan->power));
+	scan->sorted = calloc(scan->fft_size, sizeof(*scan->sorted));
+	scan->raster_level = calloc(scan->raster_num, sizeof(*scan->raster_level));
+	scan->raster_slot = calloc(scan->raster_num, sizeof(*scan->raster_slot));
+	scan->slot = calloc(slots, sizeof(*scan->slot));
+	if (!scan->window || !scan->data || !scan->power || !scan->sorted || !scan->raster_level || !scan->raster_slot || !scan->slot) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		scanner_exit(scan);
+		return -ENOMEM;
+	}
+	for (i = 0; i < scan->fft_size; i++)
+		scan->window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * (double)i / (double)scan->fft_size);
+	for (i = 0; i < scan->raster_num; i++)
+		scan->raster_slot[i] = -1;
+
+	LOGP(DSDR, LOGL_INFO, "Scanning %d raster channels of %.1f kHz from %.4f MHz to %.4f MHz with %d decoder slots.\n", scan->raster_num, raster / 1e3, (center_frequency + scan->raster_first) / 1e6, (center_frequency + scan->raster_first + (double)(scan->raster_num - 1) * raster) / 1e6, slots);
+	LOGP(DSDR, LOGL_DEBUG, "Scanner uses %d bins, %d of them for each raster channel.\n", scan->fft_size, scan->raster_bins);
+
+	return 0;
+}
+
+void scanner_exit(scanner_t *scan)
+{
+	if (scan->slot)
+		LOGP(DSDR, LOGL_INFO, "Scanner: %" PRIu64 " carriers got a decoder slot, %" PRIu64 " found no free slot.\n", scan->attached, scan->missed);
+	fft_plan_exit(&scan->plan);
+	free(scan->window);
+	free(scan->data);
+	free(scan->power);
+	free(scan->sorted);
+	free(scan->raster_level);
+	free(scan->raster_slot);
+	free(scan->slot);
+	memset(scan, 0, sizeof(*scan));
+}
+
+static double raster_offset(scanner_t *scan, int r)
+{
+	return scan->raster_first + (double)r * scan->raster;
+}
+
+/* level of each raster channel relative to the noise floor */
+static void measure(scanner_t *scan)
+{
+	int n = scan->fft_size, nbins = scan->raster_bins;
+	double floor, sum;
+	int r, b, k, count;
+
+	memcpy(scan->sorted, scan->power, n * sizeof(*scan->sorted));
+	qsort(scan->sorted, n, sizeof(*scan->sorted), compare_power);
+	floor = scan->sorted[n / 2] + 1e-30;
+
+	for (r = 0; r < scan->raster_num; r++) {
+		k = (int)round(raster_offset(scan, r) * (double)n / (double)scan->samplerate) - nbins / 2;
+		sum = 0.0;
+		count = 0;
+		for (b = 0; b < nbins; b++) {
+			/* skip DC */
+			if (k + b >= -1 && k + b <= 1)
+				continue;
+			sum += scan->power[(k + b + n) % n];
+			count++;
+		}
+		scan->raster_level[r] = (count) ? sum / (double)count / floor : 0.0;
+	}
+}
+
+static int occupied(scanner_t *scan, int r)
+{
+	double level = scan->raster_level[r];
+
+	if (level < scan->threshold)
+		return 0;
+	if (r > 0 && scan->raster_level[r - 1] > level)
+		return 0;
+	if (r < scan->raster_num - 1 && scan->raster_level[r + 1] > level)
+		return 0;
+	return 1;
+}
+
+static void evaluate(scanner_t *scan)
+{
+	scanner_slot_t *slot;
+	int r, s;
+
+	measure(scan);
+
+	/* release slots of carriers that went quiet */
+	for (s = 0; s < scan->slots; s++) {
+		slot = &scan->slot[s];
+		if (!slot->attached)
+			continue;
+		if (occupied(scan, slot->raster)) {
+			slot->quiet = 0;
+			continue;
+		}
+		if (++slot->quiet <= scan->hold)
+			continue;
+		slot->attached = 0;
+		scan->raster_slot[slot->raster] = -1;
+		scan->tune(scan->priv, s, 0, raster_offset(scan, slot->raster), 10.0 * log10(scan->raster_level[slot->raster] + 1e-30));
+	}
+
+	/* attach free slots to new carriers */
+	for (r = 0; r < scan->raster_num; r++) {
+		if (scan->raster_slot[r] >= 0 || !occupied(scan, r))
+			continue;
+		for (s = 0; s < scan->slots; s++) {
+			if (!scan->slot[s].attached)
+				break;
+		}
+		if (s == scan->slots) {
+			LOGP(DSDR, LOGL_DEBUG, "Scanner: No free decoder slot for carrier at %.4f MHz.\n", (scan->center_frequency + raster_offset(scan, r)) / 1e6);
+			scan->missed++;
+			continue;
+		}
+		slot = &scan->slot[s];
+		slot->attached = 1;
+		slot->raster = r;
+		slot->quiet = 0;
+		scan->raster_slot[r] = s;
+		scan->attached++;
+		scan->tune(scan->priv, s, 1, raster_offset(scan, r), 10.0 * log10(scan->raster_level[r]));
+	}
+}
+
+/* feed received IQ samples, slots are tuned from here */
+void scanner_process(scanner_t *scan, const float *buff, int count)
+{
+	int n = scan->fft_size, take, i;
+
+	while (count) {
+		/* capture blocks at the start of each interval */
+		if (scan->block < scan->averages) {
+			take = n - scan->fill;
+			if (take > count)
+				take = count;
+			for (i = 0; i < take; i++) {
+				scan->data[(scan->fill + i) * 2] = buff[i * 2] * scan->window[scan->fill + i];
+				scan->data[(scan->fill + i) * 2 + 1] = buff[i * 2 + 1] * scan->window[scan->fill + i];
+			}
+			scan->fill += take;
+			if (scan->fill == n) {
+				fft_plan_complex(&scan->plan, 1, scan->data);
+				if (scan->block == 0)
+					memset(scan->power, 0, n * sizeof(*scan->power));
+				for (i = 0; i < n; i++)
+					scan->power[i] += (double)scan->data[i * 2] * scan->data[i * 2] + (double)scan->data[i * 2 + 1] * scan->data[i * 2 + 1];
+				scan->fill = 0;
+				scan->block++;
+			}
+		} else {
+			take = scan->interval - scan->pos;
+			if (take > count)
+				take = count;
+		}
+		buff += take * 2;
+		count -= take;
+		scan->pos += take;
+		if (scan->pos == scan->interval) {
+			evaluate(scan);
+			scan->pos = 0;
+			scan->block = 0;
+		}
+	}
+}
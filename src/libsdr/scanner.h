@@ -0,0 +1,45 @@
+
+#include "../libfft/fft.h"
+
+/* decoder slot, that is a channel that is tuned to a carrier while it is active */
+typedef struct scanner_slot {
+	int		attached;	/* slot is tuned to a carrier */
+	int		raster;		/* raster channel of carrier */
+	int		quiet;		/* evaluations without carrier */
+} scanner_slot_t;
+
+/* occupancy detector of the whole received band */
+typedef struct scanner {
+	int		samplerate;
+	double		center_frequency;
+	double		threshold;	/* power ratio of carrier above noise floor */
+	int		hold;		/* evaluations a quiet carrier keeps its slot */
+	int		interval;	/* samples between evaluations */
+	int		pos;		/* position within interval */
+	fft_plan_t	plan;
+	int		fft_size;
+	int		averages;	/* spectra averaged for each evaluation */
+	int		block;		/* spectra taken in current interval */
+	int		fill;		/* samples in FFT buffer */
+	float		*window;
+	float		*data;
+	double		*power;		/* sum of power of each bin */
+	double		*sorted;	/* copy of power to find noise floor */
+	double		raster;		/* channel raster */
+	double		raster_first;	/* offset of first raster channel to center frequency */
+	int		raster_num;	/* raster channels within usable band */
+	int		raster_bins;	/* bins that are measured for each raster channel */
+	double		*raster_level;	/* level above noise floor of each raster channel */
+	int		*raster_slot;	/* slot that is tuned to raster channel, or -1 */
+	int		slots;
+	scanner_slot_t	*slot;
+	void		(*tune)(void *priv, int slot, int attach, double offset, double level_db);
+	void		*priv;
+	uint64_t	attached;	/* carriers that got a slot */
+	uint64_t	missed;		/* carriers that found no free slot */
+} scanner_t;
+
+int scanner_init(scanner_t *scan, int samplerate, double center_frequency, double usable_bandwidth, double raster, double threshold_db, double hold_time, int slots, void (*tune)(void *priv, int slot, int attach, double offset, double level_db), void *priv);
+void scanner_exit(scanner_t *scan);
+void scanner_process(scanner_t *scan, const float *buff, int count);
+
@@ -27,21 +27,38 @@ enum paging_signal;
 #include <math.h>
 #define __USE_GNU
 #include <pthread.h>
+#include <stdatomic.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include "../libsample/sample.h"
 #include "../libfm/fm.h"
 #include "../libam/am.h"
+#include "../libfilter/iir_bank.h"
 #include <osmocom/core/timer.h>
 #include "../libmobile/sender.h"
 #include "sdr_config.h"
 #include "sdr.h"
+#include "channelizer.h"
+#include "decimator.h"
+#include "../libsample/ringbuffer.h"
+#include "../libsample/arena.h"
+#include "sdr_stats.h"
+#include "wire_format.h"
+#include "iq_correct.h"
+#include "waterfall.h"
+#include "scanner.h"
 #ifdef HAVE_UHD
 #include "uhd.h"
 #endif
 #ifdef HAVE_SOAPY
 #include "soapy.h"
 #endif
+#include "iqshm.h"
+#include "iqloop.h"
+#include "iqnet.h"
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 
 /* enable to debug buffer handling */
 //#define DEBUG_BUFFER
@@ -55,18 +72,34 @@ enum paging_signal;
 /* limit the IQ level to prevent IIR filter from exceeding range of -1 .. 1 */
 #define LIMIT_IQ_LEVEL		0.95
 
+/* time to follow drift of DC offset and IQ imbalance */
+#define IQ_CORRECT_TIME		1.0
+
+/* keep demodulating after the RF level dropped below the gate level */
+#define RX_GATE_HOLD		1.0
+
+/* closed-loop TX lead control: raise lead on underrun, lower it again slowly */
+#define TX_LEAD_RAISE		1.25	/* factor to raise lead on underrun */
+#define TX_LEAD_LOWER		0.001	/* seconds to lower lead ... */
+#define TX_LEAD_STABLE		10.0	/* ... after this time without underrun */
+
 int sdr_rx_overflow = 0;
+void (*sdr_scan_notify)(struct sender *sender, double frequency, int attached, double level_db) = NULL;
+int sdr_rx_gate_forced = 0; /* gate idle channels, due to overload */
+int sdr_tx_underrun = 0;
 
 typedef struct sdr_thread {
 	int use;
 	volatile int running, exit;	/* flags to control exit of threads */
-	int buffer_size;
-	volatile float *buffer;
+	ringbuffer_t ring;		/* IQ sample pairs between thread and main loop */
+	ringbuffer_t segments;		/* TX burst mode: samples (> 0) or gap (< 0) of each write, in order */
+	int segment;			/* samples left of current segment */
+	atomic_int gap;			/* samples of gaps in segments that are not sent yet */
 	float *buffer2;
-	volatile int in, out;		/* in and out pointers (atomic, so no locking required) */
+	int event_fd;			/* wake up thread when data has been committed (TX), or -1 */
 	int max_fill;			/* measure maximum buffer fill */
 	double max_fill_timer;		/* timer to display/reset maximum fill */
-	iir_filter_t lp[2];		/* filter for upsample/downsample IQ data */
+	decimator_t dec;		/* filter chain for upsample/downsample IQ data */
 } sdr_thread_t;
 
 typedef struct sdr_chan {
@@ -80,9 +113,28 @@ typedef struct sdr_chan {
 	dispmeasparam_t	*dmp_rf_level;
 	dispmeasparam_t	*dmp_freq_offset;
 	dispmeasparam_t	*dmp_deviation;
+	sample_t	*pfb_demod;	/* demodulated samples at channelizer rate */
+	int		gate_hold;	/* samples to demodulate until gate closes */
+	sender_t	*sender;	/* sender that receives on this channel, resolved when opening */
 } sdr_chan_t;
 
 typedef struct sdr {
+	int		device;		/* index of SDR device, if channels are shared across devices */
+#ifdef HAVE_UHD
+	uhd_t		uhd;		/* UHD device instance */
+#endif
+#ifdef HAVE_SOAPY
+	soapy_t		soapy;		/* SoapySDR device instance */
+#endif
+	iqshm_t		iqshm;		/* shared memory of IQ hub */
+	iqnet_t		iqnet;		/* network connection to IQ hub */
+	iqloop_t	iqloop;		/* TX looped back to RX */
+	arena_t		arena;		/* sample buffers of this device */
+	int		bias_calibration; /* calibration request that has been handled */
+	double		bias_I, bias_Q;	/* calculated bias */
+	int		bias_count;	/* number of calculations */
+	int		use_iq_correct;	/* correct DC offset and IQ imbalance, if not done by driver */
+	iq_correct_t	iq_correct;	/* state of correction */
 	int		threads;	/* use threads */
 	int		oversample;	/* oversample IQ rate */
 	sdr_thread_t	thread_read,
@@ -93,18 +145,40 @@ typedef struct sdr {
 	int		channels;	/* number of frequencies */
 	double		amplitude;	/* amplitude of each carrier */
 	int		samplerate;	/* sample rate of audio data */
+	double		bandwidth;	/* bandwidth of each channel */
 	int		buffer_size;	/* buffer in audio samples */
 	double		interval;	/* how often to process the loop */
 	wave_rec_t	wave_rx_rec;
 	wave_rec_t	wave_tx_rec;
 	wave_play_t	wave_rx_play;
 	wave_play_t	wave_tx_play;
+	waterfall_t	waterfall;
+	int		use_scanner;	/* channels are decoder slots of the scanner */
+	scanner_t	scanner;
+	double		rx_center_frequency;
+	double		modulation_index; /* of AM demodulators, to tune them again */
 	float		*modbuff;	/* buffer for transmodulation */
 	sample_t	*modbuff_I;
 	sample_t	*modbuff_Q;
 	sample_t	*modbuff_carrier;
 	sample_t	*wavespl0;	/* sample buffer for wave generation */
 	sample_t	*wavespl1;
+	int		use_rx_pfb;	/* use channelizer for RX */
+	pfb_analysis_t	rx_pfb;		/* RX channelizer */
+	float		**rx_pfb_baseband; /* baseband of each channel at channelizer rate */
+	int		use_rx_bank;	/* filter IQ vectors of all FM demodulators together */
+	iir_bank_t	rx_bank;	/* filter bank for I and Q of each channel */
+	sample_t	**rx_bank_iq;	/* I and Q buffer of each channel (2 * channels) */
+	int		use_tx_pfb;	/* use channelizer for TX */
+	pfb_synthesis_t	tx_pfb;		/* TX channelizer */
+	float		**tx_pfb_baseband; /* baseband of each carrier (including paging) at channelizer rate */
+	sample_t	*tx_pfb_samples; /* audio samples at channelizer rate */
+	uint8_t		*tx_pfb_power;
+	sdr_stats_t	stats;		/* buffer and latency statistics */
+	int		tx_lead;	/* current target lead of TX over RX in audio samples (0 = buffer size) */
+	int		tx_lead_min;	/* configured target lead in audio samples */
+	double		tx_lead_timer;	/* time of last underrun or lead reduction */
+	int		tx_burst;	/* suspend TX stream while all channels are off */
 } sdr_t;
 
 static void show_spectrum(const char *direction, double halfbandwidth, double center, double *frequency, double paging_frequency, int num)
@@ -137,7 +211,198 @@ static void show_spectrum(const char *direction, double halfbandwidth, double ce
 		LOGP(DSDR, LOGL_INFO, "Frequency P = %.4f MHz (Paging Frequency)\n", paging_frequency / 1e6);
 }
 
-void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute__((__unused__)) *device, double *tx_frequency, double *rx_frequency, int *am, int channels, double paging_frequency, int samplerate, int buffer_size, double interval, double max_deviation, double max_modulation, double modulation_index)
+/* Plan the center frequency, so the lowest sample rate can be used.
+ *
+ * The center must not fall into the bandwidth of a channel, because of the
+ * DC offset of the SDR. Candidates are the middle of each gap between
+ * channels that is wide enough for the DC level, and the positions right
+ * below the lowest and above the highest channel. The candidate with the
+ * smallest range of both sidebands wins; a tie is broken by the candidate
+ * closest to the middle of all channels.
+ *
+ * Return the center frequency, the required range is stored.
+ */
+static int compare_frequency(const void *a, const void *b)
+{
+	double fa = *(const double *)a, fb = *(const double *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+static double plan_range(const double *sorted, int num, double bandwidth, double center)
+{
+	double low_side, high_side;
+
+	low_side = center - sorted[0] + bandwidth / 2.0;
+	high_side = sorted[num - 1] - center + bandwidth / 2.0;
+	return ((low_side > high_side) ? low_side : high_side) * 2.0;
+}
+
+static double plan_center(const double *frequency, int num, double paging_frequency, double bandwidth, double *range)
+{
+	double sorted[num + 1], middle, center, best_center, best_range, r;
+	int i;
+
+	memcpy(sorted, frequency, num * sizeof(*sorted));
+	if (paging_frequency)
+		sorted[num++] = paging_frequency;
+	qsort(sorted, num, sizeof(*sorted), compare_frequency);
+	middle = (sorted[0] + sorted[num - 1]) / 2.0;
+
+	/* below all channels */
+	best_center = sorted[0] - bandwidth;
+	best_range = plan_range(sorted, num, bandwidth, best_center);
+
+	/* above all channels */
+	center = sorted[num - 1] + bandwidth;
+	r = plan_range(sorted, num, bandwidth, center);
+	if (r < best_range) {
+		best_range = r;
+		best_center = center;
+	}
+
+	/* in a gap between channels */
+	for (i = 1; i < num; i++) {
+		if (sorted[i] - sorted[i - 1] < bandwidth)
+			continue;
+		center = (sorted[i] + sorted[i - 1]) / 2.0;
+		r = plan_range(sorted, num, bandwidth, center);
+		if (r < best_range || (r == best_range && fabs(center - middle) < fabs(best_center - middle))) {
+			best_range = r;
+			best_center = center;
+		}
+	}
+
+	*range = best_range;
+	return best_center;
+}
+
+/* check if the planned range fits into the sample rate, if not, tell the lowest rate that does */
+static int plan_check(const char *direction, double range, int samplerate)
+{
+	int lowest;
+
+	/* lowest rate in steps of 1 kHz */
+	lowest = (int)ceil(range / USABLE_BANDWIDTH / 1000.0) * 1000;
+	LOGP(DSDR, LOGL_INFO, "Total bandwidth (two sidebands) for all %s Frequencies: %.0f Hz\n", direction, range);
+	if (range > samplerate * USABLE_BANDWIDTH) {
+		LOGP(DSDR, LOGL_NOTICE, "*******************************************************************************\n");
+		LOGP(DSDR, LOGL_NOTICE, "The required bandwidth of %.0f Hz exceeds %.0f%% of the sample rate.\n", range, USABLE_BANDWIDTH * 100.0);
+		LOGP(DSDR, LOGL_NOTICE, "Please increase samplerate to %d Hz at least!\n", lowest);
+		if (sdr_config->samplerate != samplerate)
+			LOGP(DSDR, LOGL_NOTICE, "The SDR sample rate must be a multiple of it.\n");
+		LOGP(DSDR, LOGL_NOTICE, "*******************************************************************************\n");
+		return -EINVAL;
+	}
+	if (lowest < samplerate)
+		LOGP(DSDR, LOGL_INFO, "A sample rate of %d Hz would be sufficient for the %s frequencies, using less CPU.\n", lowest, direction);
+	return 0;
+}
+
+/* open instances, to print statistics */
+static sdr_t *sdr_instance[SDR_MAX_DEVICES];
+
+/* frequency range covered by each SDR device */
+static struct sdr_device_range {
+	int		channels;
+	double		tx_low, tx_high;
+	double		rx_low, rx_high;
+} device_range[SDR_MAX_DEVICES];
+
+/* select the first SDR device that can cover the given transceiver within its usable bandwidth
+ * returns the index of the device */
+int sdr_assign_device(double tx_frequency, double rx_frequency, int samplerate)
+{
+	struct sdr_device_range *r;
+	double usable = USABLE_BANDWIDTH * (double)samplerate;
+	int d;
+
+	for (d = 0; d < sdr_config->devices; d++) {
+		r = &device_range[d];
+		if (!r->channels)
+			break;
+		if (fmax(r->tx_high, tx_frequency) - fmin(r->tx_low, tx_frequency) >= usable)
+			continue;
+		if (fmax(r->rx_high, rx_frequency) - fmin(r->rx_low, rx_frequency) >= usable)
+			continue;
+		r->tx_low = fmin(r->tx_low, tx_frequency);
+		r->tx_high = fmax(r->tx_high, tx_frequency);
+		r->rx_low = fmin(r->rx_low, rx_frequency);
+		r->rx_high = fmax(r->rx_high, rx_frequency);
+		r->channels++;
+		return d;
+	}
+	if (d == sdr_config->devices) {
+		LOGP(DSDR, LOGL_ERROR, "Frequency %.4f MHz does not fit into the bandwidth of any of the %d SDR devices, add more devices or increase sample rate!\n", tx_frequency / 1e6, sdr_config->devices);
+		return -EINVAL;
+	}
+
+	/* use next unused device */
+	r = &device_range[d];
+	r->tx_low = r->tx_high = tx_frequency;
+	r->rx_low = r->rx_high = rx_frequency;
+	r->channels = 1;
+	LOGP(DSDR, LOGL_DEBUG, "Frequency %.4f MHz uses SDR device #%d\n", tx_frequency / 1e6, d + 1);
+	return d;
+}
+
+/* describe IQ recording in its SigMF metadata */
+static void sdr_meta_init(wave_rec_t *rec, const char *direction, double center_frequency, double gain)
+{
+	char hw[128];
+
+	snprintf(hw, sizeof(hw), "%s '%s', %s gain %.1f dB", (sdr_config->shm || sdr_config->udp) ? "IQ hub" : (sdr_config->loopback) ? "Loopback" : (sdr_config->uhd) ? "UHD" : "SoapySDR", (sdr_config->shm) ? sdr_config->shm : (sdr_config->udp) ? sdr_config->udp : (sdr_config->loopback) ? "memory" : sdr_config->device_args[0], direction, gain);
+	wave_meta_hw(rec, hw);
+	wave_meta_capture(rec, center_frequency);
+}
+
+/* annotate frequency range of each channel over the whole recording */
+static void sdr_meta_channels(sdr_t *sdr, wave_rec_t *rec, int tx)
+{
+	char comment[32];
+	double frequency;
+	int c;
+
+	if (!rec->fp)
+		return;
+	for (c = 0; c < sdr->channels; c++) {
+		frequency = (tx) ? sdr->chan[c].tx_frequency : sdr->chan[c].rx_frequency;
+		snprintf(comment, sizeof(comment), "channel #%d", c);
+		wave_meta_annotate(rec, -(int64_t)rec->written, rec->written, frequency - sdr->bandwidth / 2.0, frequency + sdr->bandwidth / 2.0, "channel", comment);
+	}
+}
+
+/* tune channel to a carrier that was found by the scanner, or release it */
+static void sdr_scan_tune(void *priv, int c, int attach, double offset, double level_db)
+{
+	sdr_t *sdr = priv;
+	sdr_chan_t *chan = &sdr->chan[c];
+	double rx_offset = offset, rx_samplerate = sdr->samplerate;
+
+	chan->rx_frequency = sdr->rx_center_frequency + offset;
+	if (attach) {
+		/* with channelizer, demodulate the carrier's bin at reduced rate */
+		if (sdr->use_rx_pfb) {
+			pfb_analysis_tune(&sdr->rx_pfb, c, offset);
+			rx_offset = sdr->rx_pfb.chan[c].residual;
+			rx_samplerate = sdr->rx_pfb.chan_samplerate;
+		}
+		if (chan->am) {
+			am_demod_exit(&chan->am_demod);
+			am_demod_init(&chan->am_demod, rx_samplerate, rx_offset, sdr->bandwidth / 2.0, 1.0 / sdr->modulation_index);
+		} else {
+			fm_demod_exit(&chan->fm_demod);
+			fm_demod_init(&chan->fm_demod, rx_samplerate, rx_offset, sdr->bandwidth);
+		}
+		LOGP(DSDR, LOGL_INFO, "Scanner: Carrier at %.4f MHz (%.1f dB above noise floor), channel #%d is receiving.\n", chan->rx_frequency / 1e6, level_db, c);
+	} else
+		LOGP(DSDR, LOGL_INFO, "Scanner: Carrier at %.4f MHz is gone, channel #%d is free.\n", chan->rx_frequency / 1e6, c);
+
+	if (chan->sender && sdr_scan_notify)
+		sdr_scan_notify(chan->sender, chan->rx_frequency, attach, level_db);
+}
+
+void *sdr_open(int __attribute__((__unused__)) direction, const char *device, double *tx_frequency, double *rx_frequency, int *am, int channels, double paging_frequency, int samplerate, int buffer_size, double interval, double max_deviation, double max_modulation, double modulation_index)
 {
 	sdr_t *sdr;
 	int threads = 1, oversample = 1; /* always use threads */
@@ -162,6 +427,11 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 		oversample = sdr_config->samplerate / samplerate;
 		threads = 1;
 	}
+	/* the loop never blocks and does not need the device's rate */
+	if (sdr_config->loopback) {
+		threads = 0;
+		oversample = 1;
+	}
 
 	bandwidth = 2.0 * (max_deviation + max_modulation);
 	if (bandwidth)
@@ -172,78 +442,125 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
 	}
+	memacct_add(MEMACCT_SDR, "SDR", sizeof(*sdr));
 	sdr->channels = channels;
+	sdr->bandwidth = bandwidth;
+	sdr->modulation_index = modulation_index;
 	sdr->amplitude = 1.0 / (double)channels;
 	sdr->samplerate = samplerate;
 	sdr->buffer_size = buffer_size;
 	sdr->interval = interval;
 	sdr->threads = threads; /* always required, because write may block */
 	sdr->oversample = oversample;
+	sdr->thread_write.event_fd = -1;
+	/* sample buffers of the device are kept together, more slabs are added if channelizers need them */
+	arena_init(&sdr->arena, MEMACCT_SDR, "SDR", (size_t)buffer_size * 16 * sizeof(double));
+	/* transceivers have been assigned to a device by sdr_assign_device() */
+	if (sdr_config->devices > 1 && device) {
+		if (sscanf(device, "sdr%d", &sdr->device) != 1 || sdr->device < 0 || sdr->device >= sdr_config->devices) {
+			LOGP(DSDR, LOGL_ERROR, "Invalid SDR device '%s', please fix!\n", device);
+			goto error;
+		}
+		LOGP(DSDR, LOGL_INFO, "Opening SDR device #%d with args \"%s\"\n", sdr->device + 1, sdr_config->device_args[sdr->device]);
+	}
+	if (sdr_config->tx_lead) {
+		sdr->tx_lead_min = (int)(sdr_config->tx_lead / 1000.0 * (double)samplerate);
+		if (sdr->tx_lead_min < 1)
+			sdr->tx_lead_min = 1;
+		if (sdr->tx_lead_min > sdr->buffer_size) {
+			LOGP(DSDR, LOGL_NOTICE, "Given TX lead of %.1f ms exceeds buffer size, using %.1f ms.\n", sdr_config->tx_lead, (double)sdr->buffer_size / (double)samplerate * 1000.0);
+			sdr->tx_lead_min = sdr->buffer_size;
+		}
+		sdr->tx_lead = sdr->tx_lead_min;
+	}
+	if (sdr_config->tx_burst) {
+		if ((sdr_config->uhd || sdr_config->soapy) && sdr_config->timestamps && !sdr_config->mimo && threads)
+			sdr->tx_burst = 1;
+		else
+			LOGP(DSDR, LOGL_NOTICE, "TX burst mode requires UHD or SoapySDR with time stamps and a single channel, transmitting continuously.\n");
+	}
 
 	if (threads) {
 		memset(&sdr->thread_read, 0, sizeof(sdr->thread_read));
-		sdr->thread_read.buffer_size = sdr->buffer_size * 2 * sdr->oversample + 2;
-		sdr->thread_read.buffer = calloc(sdr->thread_read.buffer_size, sizeof(*sdr->thread_read.buffer));
-		if (!sdr->thread_read.buffer) {
+		rc = ringbuffer_init(&sdr->thread_read.ring, sdr->buffer_size, sizeof(float) * 2);
+		if (rc < 0) {
 			LOGP(DSDR, LOGL_ERROR, "No mem!\n");
 			goto error;
 		}
-		sdr->thread_read.buffer2 = calloc(sdr->thread_read.buffer_size, sizeof(*sdr->thread_read.buffer2));
+		sdr->thread_read.buffer2 = arena_alloc(&sdr->arena, sdr->buffer_size * 2 * sdr->oversample, sizeof(*sdr->thread_read.buffer2));
 		if (!sdr->thread_read.buffer2) {
 			LOGP(DSDR, LOGL_ERROR, "No mem!\n");
 			goto error;
 		}
-		sdr->thread_read.in = sdr->thread_read.out = 0;
 		if (oversample > 1) {
-			iir_lowpass_init(&sdr->thread_read.lp[0], samplerate / 2.0, sdr_config->samplerate, 2);
-			iir_lowpass_init(&sdr->thread_read.lp[1], samplerate / 2.0, sdr_config->samplerate, 2);
+			rc = decimator_init(&sdr->thread_read.dec, oversample);
+			if (rc < 0) {
+				LOGP(DSDR, LOGL_ERROR, "Failed to init decimator for oversampling factor %d!\n", oversample);
+				goto error;
+			}
 		}
 		memset(&sdr->thread_write, 0, sizeof(sdr->thread_write));
-		sdr->thread_write.buffer_size = sdr->buffer_size * 2 + 2;
-		sdr->thread_write.buffer = calloc(sdr->thread_write.buffer_size, sizeof(*sdr->thread_write.buffer));
-		if (!sdr->thread_write.buffer) {
+		sdr->thread_write.event_fd = -1;
+		rc = ringbuffer_init(&sdr->thread_write.ring, sdr->buffer_size, sizeof(float) * 2);
+		if (rc < 0) {
 			LOGP(DSDR, LOGL_ERROR, "No mem!\n");
 			goto error;
 		}
-		sdr->thread_write.buffer2 = calloc(sdr->thread_write.buffer_size * sdr->oversample, sizeof(*sdr->thread_write.buffer2));
+		sdr->thread_write.buffer2 = arena_alloc(&sdr->arena, sdr->buffer_size * 2 * sdr->oversample, sizeof(*sdr->thread_write.buffer2));
 		if (!sdr->thread_write.buffer2) {
 			LOGP(DSDR, LOGL_ERROR, "No mem!\n");
 			goto error;
 		}
-		sdr->thread_write.in = sdr->thread_write.out = 0;
+		if (sdr->tx_burst) {
+			rc = ringbuffer_init(&sdr->thread_write.segments, sdr->buffer_size, sizeof(int));
+			if (rc < 0) {
+				LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+				goto error;
+			}
+		}
+		if (sdr_config->event_threads) {
+			sdr->thread_write.event_fd = eventfd(0, EFD_NONBLOCK);
+			if (sdr->thread_write.event_fd < 0) {
+				LOGP(DSDR, LOGL_ERROR, "Failed to create event for TX thread! (errno %d)\n", errno);
+				goto error;
+			}
+		}
 		if (oversample > 1) {
-			iir_lowpass_init(&sdr->thread_write.lp[0], samplerate / 2.0, sdr_config->samplerate, 2);
-			iir_lowpass_init(&sdr->thread_write.lp[1], samplerate / 2.0, sdr_config->samplerate, 2);
+			rc = interpolator_init(&sdr->thread_write.dec, oversample);
+			if (rc < 0) {
+				LOGP(DSDR, LOGL_ERROR, "Failed to init interpolator for oversampling factor %d!\n", oversample);
+				goto error;
+			}
 		}
 	}
 
 	/* alloc fm modulation buffers */
-	sdr->modbuff = calloc(sdr->buffer_size * 2, sizeof(*sdr->modbuff));
+	sdr->modbuff = arena_alloc(&sdr->arena, sdr->buffer_size * 2, sizeof(*sdr->modbuff));
 	if (!sdr->modbuff) {
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
 	}
-	sdr->modbuff_I = calloc(sdr->buffer_size, sizeof(*sdr->modbuff_I));
+	sdr->modbuff_I = arena_alloc(&sdr->arena, sdr->buffer_size, sizeof(*sdr->modbuff_I));
 	if (!sdr->modbuff_I) {
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
 	}
-	sdr->modbuff_Q = calloc(sdr->buffer_size, sizeof(*sdr->modbuff_Q));
+	sdr->modbuff_Q = arena_alloc(&sdr->arena, sdr->buffer_size, sizeof(*sdr->modbuff_Q));
 	if (!sdr->modbuff_Q) {
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
 	}
-	sdr->modbuff_carrier = calloc(sdr->buffer_size, sizeof(*sdr->modbuff_carrier));
+	sdr->modbuff_carrier = arena_alloc(&sdr->arena, sdr->buffer_size, sizeof(*sdr->modbuff_carrier));
 	if (!sdr->modbuff_carrier) {
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
 	}
-	sdr->wavespl0 = calloc(sdr->buffer_size, sizeof(*sdr->wavespl0));
+	sdr->wavespl0 = arena_alloc(&sdr->arena, sdr->buffer_size, sizeof(*sdr->wavespl0));
 	if (!sdr->wavespl0) {
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
 	}
-	sdr->wavespl1 = calloc(sdr->buffer_size, sizeof(*sdr->wavespl1));
+	sdr->wavespl1 = arena_alloc(&sdr->arena, sdr->buffer_size, sizeof(*sdr->wavespl1));
 	if (!sdr->wavespl1) {
 		LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 		goto error;
@@ -262,6 +579,7 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 			LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
 			goto error;
 		}
+		memacct_add(MEMACCT_SDR, "SDR", sizeof(*sdr->chan) * (channels + (sdr->paging_channel != 0)));
 	}
 
 	/* swap links, if required */
@@ -276,130 +594,127 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 	if (tx_frequency && !channels)
 		tx_center_frequency = tx_frequency[0];
 	if (tx_frequency && channels) {
-		/* calculate required bandwidth (IQ rate) */
+		double range;
 
-		double tx_low_frequency = 0.0, tx_high_frequency = 0.0;
-		for (c = 0; c < channels; c++) {
+		for (c = 0; c < channels; c++)
 			sdr->chan[c].tx_frequency = tx_frequency[c];
-			if (c == 0 || sdr->chan[c].tx_frequency < tx_low_frequency)
-				tx_low_frequency = sdr->chan[c].tx_frequency;
-			if (c == 0 || sdr->chan[c].tx_frequency > tx_high_frequency)
-				tx_high_frequency = sdr->chan[c].tx_frequency;
-		}
-		if (sdr->paging_channel) {
+		if (sdr->paging_channel)
 			sdr->chan[sdr->paging_channel].tx_frequency = paging_frequency;
-			if (sdr->chan[sdr->paging_channel].tx_frequency < tx_low_frequency)
-				tx_low_frequency = sdr->chan[sdr->paging_channel].tx_frequency;
-			if (sdr->chan[sdr->paging_channel].tx_frequency > tx_high_frequency)
-				tx_high_frequency = sdr->chan[sdr->paging_channel].tx_frequency;
-		}
-		tx_center_frequency = (tx_high_frequency + tx_low_frequency) / 2.0;
-
-		/* prevent channel bandwidth from overlapping with the center frequency */
-		if (channels == 1 && !sdr->paging_channel) {
-			/* simple: just move off the center by two times half of the bandwidth */
-			tx_center_frequency -= 2.0 * bandwidth / 2.0;
-			/* Note: tx_low_frequency is kept at old center.
-			   Calculation of 'low_side' will become 0.
-			   This is correct, since there is no bandwidth
-			   below new center frequency.
-			 */
-			LOGP(DSDR, LOGL_INFO, "We shift center frequency %.0f KHz down (half bandwidth), to prevent channel from overlapping with DC level.\n", bandwidth / 2.0 / 1e3);
-		} else {
-			/* find two channels that are aside the center */
-			double low_dist = 0, high_dist = 0, dist;
-			int low_c = -1, high_c = -1;
-			for (c = 0; c < channels; c++) {
-				dist = fabs(tx_center_frequency - sdr->chan[c].tx_frequency);
-				if (round(sdr->chan[c].tx_frequency) >= round(tx_center_frequency)) {
-					if (high_c < 0 || dist < high_dist) {
-						high_dist = dist;
-						high_c = c;
-					}
-				} else {
-					if (low_c < 0 || dist < low_dist) {
-						low_dist = dist;
-						low_c = c;
-					}
-				}
-			}
-			if (sdr->paging_channel) {
-				dist = fabs(tx_center_frequency - sdr->chan[sdr->paging_channel].tx_frequency);
-				if (round(sdr->chan[sdr->paging_channel].tx_frequency) >= round(tx_center_frequency)) {
-					if (high_c < 0 || dist < high_dist) {
-						high_dist = dist;
-						high_c = sdr->paging_channel;
-					}
-				} else {
-					if (low_c < 0 || dist < low_dist) {
-						low_dist = dist;
-						low_c = sdr->paging_channel;
-					}
-				}
-			}
-			/* new center = center of the two frequencies aside old center */
-			if (low_c >= 0 && high_c >= 0) {
-				tx_center_frequency =
-					((sdr->chan[low_c].tx_frequency) +
-					 (sdr->chan[high_c].tx_frequency)) / 2.0;
-				LOGP(DSDR, LOGL_INFO, "We move center frequency between the two channels in the middle, to prevent them from overlapping with DC level.\n");
-			}
-		}
+
+		/* place center frequency, clear of DC level, at lowest IQ rate */
+		tx_center_frequency = plan_center(tx_frequency, channels, (sdr->paging_channel) ? paging_frequency : 0.0, bandwidth, &range);
 
 		/* show spectrum */
 		show_spectrum("TX", (double)samplerate / 2.0, tx_center_frequency, tx_frequency, paging_frequency, channels);
 
-		/* range of TX */
-		double low_side, high_side, range;
-		low_side = (tx_center_frequency - tx_low_frequency) + bandwidth / 2.0;
-		high_side = (tx_high_frequency - tx_center_frequency) + bandwidth / 2.0;
-		range = ((low_side > high_side) ? low_side : high_side) * 2.0;
-		LOGP(DSDR, LOGL_INFO, "Total bandwidth (two sidebands) for all TX Frequencies: %.0f Hz\n", range);
-		if (range > samplerate * USABLE_BANDWIDTH) {
-			LOGP(DSDR, LOGL_NOTICE, "*******************************************************************************\n");
-			LOGP(DSDR, LOGL_NOTICE, "The required bandwidth of %.0f Hz exceeds %.0f%% of the sample rate.\n", range, USABLE_BANDWIDTH * 100.0);
-			LOGP(DSDR, LOGL_NOTICE, "Please increase samplerate!\n");
-			LOGP(DSDR, LOGL_NOTICE, "*******************************************************************************\n");
+		if (plan_check("TX", range, samplerate) < 0)
 			goto error;
-		}
 		LOGP(DSDR, LOGL_INFO, "Using center frequency: TX %.6f MHz\n", tx_center_frequency / 1e6);
+		/* init channelizer, if requested (paging frequency is an extra carrier) */
+		if (sdr_config->channelizer & SDR_CHANNELIZER_TX) {
+			int carriers = channels + (sdr->paging_channel != 0);
+			double tx_offsets[carriers];
+			for (c = 0; c < carriers; c++)
+				tx_offsets[c] = sdr->chan[c].tx_frequency - tx_center_frequency;
+			rc = pfb_synthesis_init(&sdr->tx_pfb, samplerate, bandwidth, tx_offsets, carriers, sdr->buffer_size);
+			if (rc == -ENOMEM)
+				goto error;
+			if (rc < 0)
+				LOGP(DSDR, LOGL_NOTICE, "Channelizer cannot be used, modulating each channel at full rate.\n");
+			else
+				sdr->use_tx_pfb = 1;
+			if (sdr->use_tx_pfb && sdr_config->channelizer_gpu && pfb_synthesis_gpu(&sdr->tx_pfb, sdr->buffer_size) < 0)
+				LOGP(DSDR, LOGL_NOTICE, "TX channelizer cannot use GPU, running on CPU.\n");
+		}
+		if (sdr->use_tx_pfb) {
+			int max_input = pfb_synthesis_max_input(&sdr->tx_pfb, sdr->buffer_size);
+			sdr->tx_pfb_baseband = calloc(sdr->tx_pfb.channels, sizeof(*sdr->tx_pfb_baseband));
+			sdr->tx_pfb_samples = arena_alloc(&sdr->arena, max_input, sizeof(*sdr->tx_pfb_samples));
+			sdr->tx_pfb_power = arena_alloc(&sdr->arena, max_input, sizeof(*sdr->tx_pfb_power));
+			if (!sdr->tx_pfb_baseband || !sdr->tx_pfb_samples || !sdr->tx_pfb_power) {
+				LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
+				goto error;
+			}
+			for (c = 0; c < sdr->tx_pfb.channels; c++) {
+				sdr->tx_pfb_baseband[c] = arena_alloc(&sdr->arena, max_input * 2, sizeof(*sdr->tx_pfb_baseband[c]));
+				if (!sdr->tx_pfb_baseband[c]) {
+					LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
+					goto error;
+				}
+			}
+		}
 		/* set offsets to center frequency */
 		for (c = 0; c < channels; c++) {
-			double tx_offset;
+			double tx_offset, tx_samplerate;
 			tx_offset = sdr->chan[c].tx_frequency - tx_center_frequency;
 			LOGP(DSDR, LOGL_DEBUG, "Frequency #%d: TX offset: %.6f MHz\n", c, tx_offset / 1e6);
+			tx_samplerate = samplerate;
+			/* with channelizer, modulate the channel's bin at reduced rate */
+			if (sdr->use_tx_pfb) {
+				tx_offset = sdr->tx_pfb.chan[c].residual;
+				tx_samplerate = sdr->tx_pfb.chan_samplerate;
+			}
 			sdr->chan[c].am = am[c];
 			if (am[c]) {
 				double gain, bias;
 				gain = modulation_index / 2.0;
 				bias = 1.0 - gain;
-				rc = am_mod_init(&sdr->chan[c].am_mod, samplerate, tx_offset, sdr->amplitude * gain, sdr->amplitude * bias);
+				rc = am_mod_init(&sdr->chan[c].am_mod, tx_samplerate, tx_offset, sdr->amplitude * gain, sdr->amplitude * bias);
 			} else
-				rc = fm_mod_init(&sdr->chan[c].fm_mod, samplerate, tx_offset, sdr->amplitude);
+				rc = fm_mod_init(&sdr->chan[c].fm_mod, tx_samplerate, tx_offset, sdr->amplitude);
 			if (rc < 0)
 				goto error;
 		}
 		if (sdr->paging_channel) {
-			double tx_offset;
+			double tx_offset, tx_samplerate;
 			tx_offset = sdr->chan[sdr->paging_channel].tx_frequency - tx_center_frequency;
 			LOGP(DSDR, LOGL_DEBUG, "Paging Frequency: TX offset: %.6f MHz\n", tx_offset / 1e6);
-			rc = fm_mod_init(&sdr->chan[sdr->paging_channel].fm_mod, samplerate, tx_offset, sdr->amplitude);
+			tx_samplerate = samplerate;
+			if (sdr->use_tx_pfb) {
+				tx_offset = sdr->tx_pfb.chan[sdr->paging_channel].residual;
+				tx_samplerate = sdr->tx_pfb.chan_samplerate;
+			}
+			rc = fm_mod_init(&sdr->chan[sdr->paging_channel].fm_mod, tx_samplerate, tx_offset, sdr->amplitude);
+			if (rc < 0)
+				goto error;
+		}
+		/* with many FM channels, filter all IQ vectors together, the filters are equal */
+		for (c = 0; c < channels; c++) {
+			if (am[c])
+				break;
+		}
+		if (channels > 1 && c == channels) {
+			rc = iir_bank_init(&sdr->rx_bank, &sdr->chan[0].fm_demod.lp[0], channels * 2);
 			if (rc < 0)
 				goto error;
+			sdr->rx_bank_iq = calloc(channels * 2, sizeof(*sdr->rx_bank_iq));
+			if (!sdr->rx_bank_iq) {
+				LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
+				goto error;
+			}
+			for (c = 0; c < channels * 2; c++) {
+				sdr->rx_bank_iq[c] = arena_alloc(&sdr->arena, sdr->buffer_size, sizeof(*sdr->rx_bank_iq[c]));
+				if (!sdr->rx_bank_iq[c]) {
+					LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
+					goto error;
+				}
+			}
+			sdr->use_rx_bank = 1;
 		}
 		/* show gain */
 		LOGP(DSDR, LOGL_INFO, "Using gain: TX %.1f dB\n", sdr_config->tx_gain);
-		/* open wave */
-		if (sdr_config->write_iq_tx_wave) {
-			rc = wave_create_record(&sdr->wave_tx_rec, sdr_config->write_iq_tx_wave, samplerate, 2, 1.0);
+		/* open wave (only the first device is recorded or played back) */
+		if (sdr_config->write_iq_tx_wave && sdr->device == 0) {
+			rc = wave_create_record(&sdr->wave_tx_rec, sdr_config->write_iq_tx_wave, samplerate, 2, 1.0, WAVE_FLAG_MMAP | ((sdr_config->iq_sigmf) ? WAVE_FLAG_SIGMF : 0) | sdr_config->iq_wave_format);
 			if (rc < 0) {
 				LOGP(DSDR, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 				goto error;
 			}
+			sdr_meta_init(&sdr->wave_tx_rec, "TX", tx_center_frequency, sdr_config->tx_gain);
 		}
-		if (sdr_config->read_iq_tx_wave) {
+		if (sdr_config->read_iq_tx_wave && sdr->device == 0) {
 			int two = 2;
-			rc = wave_create_playback(&sdr->wave_tx_play, sdr_config->read_iq_tx_wave, &samplerate, &two, 1.0);
+			rc = wave_create_playback(&sdr->wave_tx_play, sdr_config->read_iq_tx_wave, &samplerate, &two, 1.0, WAVE_FLAG_MMAP | sdr_config->iq_wave_format);
 			if (rc < 0) {
 				LOGP(DSDR, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 				goto error;
@@ -410,97 +725,94 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 	if (rx_frequency && !channels)
 		rx_center_frequency = rx_frequency[0];
 	if (rx_frequency && channels) {
-		/* calculate required bandwidth (IQ rate) */
-		double rx_low_frequency = 0.0, rx_high_frequency = 0.0;
-		for (c = 0; c < channels; c++) {
+		double range;
+
+		for (c = 0; c < channels; c++)
 			sdr->chan[c].rx_frequency = rx_frequency[c];
-			if (c == 0 || sdr->chan[c].rx_frequency < rx_low_frequency)
-				rx_low_frequency = sdr->chan[c].rx_frequency;
-			if (c == 0 || sdr->chan[c].rx_frequency > rx_high_frequency)
-				rx_high_frequency = sdr->chan[c].rx_frequency;
-		}
-		rx_center_frequency = (rx_high_frequency + rx_low_frequency) / 2.0;
-
-		/* prevent channel bandwidth from overlapping with the center frequency */
-		if (channels == 1) {
-			/* simple: just move off the center by two times half of the bandwidth */
-			rx_center_frequency -= 2.0 * bandwidth / 2.0;
-			/* Note: rx_low_frequency is kept at old center.
-			   Calculation of 'low_side' will become 0.
-			   This is correct, since there is no bandwidth
-			   below new center frequency.
-			 */
-			LOGP(DSDR, LOGL_INFO, "We shift center frequency %.0f KHz down (half bandwidth), to prevent channel from overlapping with DC level.\n", bandwidth / 2.0 / 1e3);
-		} else {
-			/* find two channels that are aside the center */
-			double low_dist, high_dist, dist;
-			int low_c = -1, high_c = -1;
-			for (c = 0; c < channels; c++) {
-				dist = fabs(rx_center_frequency - sdr->chan[c].rx_frequency);
-				if (round(sdr->chan[c].rx_frequency) >= round(rx_center_frequency)) {
-					if (high_c < 0 || dist < high_dist) {
-						high_dist = dist;
-						high_c = c;
-					}
-				} else {
-					if (low_c < 0 || dist < low_dist) {
-						low_dist = dist;
-						low_c = c;
-					}
-				}
-			}
-			/* new center = center of the two frequencies aside old center */
-			if (low_c >= 0 && high_c >= 0) {
-				rx_center_frequency =
-					((sdr->chan[low_c].rx_frequency) +
-					 (sdr->chan[high_c].rx_frequency)) / 2.0;
-				LOGP(DSDR, LOGL_INFO, "We move center frequency between the two channels in the middle, to prevent them from overlapping with DC level.\n");
-			}
-		}
+
+		/* place center frequency, clear of DC level, at lowest IQ rate */
+		rx_center_frequency = plan_center(rx_frequency, channels, 0.0, bandwidth, &range);
 
 		/* show spectrum */
 		show_spectrum("RX", (double)samplerate / 2.0, rx_center_frequency, rx_frequency, 0.0, channels);
 
-		/* range of RX */
-		double low_side, high_side, range;
-		low_side = (rx_center_frequency - rx_low_frequency) + bandwidth / 2.0;
-		high_side = (rx_high_frequency - rx_center_frequency) + bandwidth / 2.0;
-		range = ((low_side > high_side) ? low_side : high_side) * 2.0;
-		LOGP(DSDR, LOGL_INFO, "Total bandwidth (two sidebands) for all RX Frequencies: %.0f Hz\n", range);
-		if (range > samplerate * USABLE_BANDWIDTH) {
-			LOGP(DSDR, LOGL_NOTICE, "*******************************************************************************\n");
-			LOGP(DSDR, LOGL_NOTICE, "The required bandwidth of %.0f Hz exceeds %.0f%% of the sample rate.\n", range, USABLE_BANDWIDTH * 100.0);
-			LOGP(DSDR, LOGL_NOTICE, "Please increase samplerate!\n");
-			LOGP(DSDR, LOGL_NOTICE, "*******************************************************************************\n");
+		if (plan_check("RX", range, samplerate) < 0)
 			goto error;
-		}
 		LOGP(DSDR, LOGL_INFO, "Using center frequency: RX %.6f MHz\n", rx_center_frequency / 1e6);
+		sdr->rx_center_frequency = rx_center_frequency;
+		/* init channelizer, if requested */
+		if (sdr_config->channelizer & SDR_CHANNELIZER_RX) {
+			double rx_offsets[channels];
+			for (c = 0; c < channels; c++)
+				rx_offsets[c] = sdr->chan[c].rx_frequency - rx_center_frequency;
+			rc = pfb_analysis_init(&sdr->rx_pfb, samplerate, bandwidth, rx_offsets, channels);
+			if (rc == -ENOMEM)
+				goto error;
+			if (rc < 0)
+				LOGP(DSDR, LOGL_NOTICE, "Channelizer cannot be used, demodulating each channel at full rate.\n");
+			else
+				sdr->use_rx_pfb = 1;
+			if (sdr->use_rx_pfb && sdr_config->channelizer_gpu && sdr_config->scan_raster)
+				LOGP(DSDR, LOGL_NOTICE, "Scanning tunes the channels of the RX channelizer, running it on CPU.\n");
+			else if (sdr->use_rx_pfb && sdr_config->channelizer_gpu && pfb_analysis_gpu(&sdr->rx_pfb, sdr->buffer_size) < 0)
+				LOGP(DSDR, LOGL_NOTICE, "RX channelizer cannot use GPU, running on CPU.\n");
+		}
+		if (sdr->use_rx_pfb) {
+			int max_output = pfb_analysis_max_output(&sdr->rx_pfb, sdr->buffer_size);
+			sdr->rx_pfb_baseband = calloc(channels, sizeof(*sdr->rx_pfb_baseband));
+			if (!sdr->rx_pfb_baseband) {
+				LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
+				goto error;
+			}
+			for (c = 0; c < channels; c++) {
+				sdr->rx_pfb_baseband[c] = arena_alloc(&sdr->arena, max_output * 2, sizeof(*sdr->rx_pfb_baseband[c]));
+				sdr->chan[c].pfb_demod = arena_alloc(&sdr->arena, max_output, sizeof(*sdr->chan[c].pfb_demod));
+				if (!sdr->rx_pfb_baseband[c] || !sdr->chan[c].pfb_demod) {
+					LOGP(DSDR, LOGL_ERROR, "NO MEM!\n");
+					goto error;
+				}
+			}
+		}
 		/* set offsets to center frequency */
 		for (c = 0; c < channels; c++) {
-			double rx_offset;
+			double rx_offset, rx_samplerate;
 			rx_offset = sdr->chan[c].rx_frequency - rx_center_frequency;
 			LOGP(DSDR, LOGL_DEBUG, "Frequency #%d: RX offset: %.6f MHz\n", c, rx_offset / 1e6);
+			rx_samplerate = samplerate;
+			/* with channelizer, demodulate the channel's bin at reduced rate */
+			if (sdr->use_rx_pfb) {
+				rx_offset = sdr->rx_pfb.chan[c].residual;
+				rx_samplerate = sdr->rx_pfb.chan_samplerate;
+			}
 			sdr->chan[c].am = am[c];
 			if (am[c])
-				rc = am_demod_init(&sdr->chan[c].am_demod, samplerate, rx_offset, bandwidth / 2.0, 1.0 / modulation_index); /* bandwidth is only one side band */
+				rc = am_demod_init(&sdr->chan[c].am_demod, rx_samplerate, rx_offset, bandwidth / 2.0, 1.0 / modulation_index); /* bandwidth is only one side band */
 			else
-				rc = fm_demod_init(&sdr->chan[c].fm_demod, samplerate, rx_offset, bandwidth); /* bandwidth are deviation and both sidebands */
+				rc = fm_demod_init(&sdr->chan[c].fm_demod, rx_samplerate, rx_offset, bandwidth); /* bandwidth are deviation and both sidebands */
+			if (rc < 0)
+				goto error;
+		}
+		/* channels are tuned when carriers are found */
+		if (sdr_config->scan_raster) {
+			rc = scanner_init(&sdr->scanner, samplerate, rx_center_frequency, USABLE_BANDWIDTH * (double)samplerate, sdr_config->scan_raster, sdr_config->scan_threshold, sdr_config->scan_hold, channels, sdr_scan_tune, sdr);
 			if (rc < 0)
 				goto error;
+			sdr->use_scanner = 1;
 		}
 		/* show gain */
 		LOGP(DSDR, LOGL_INFO, "Using gain: RX %.1f dB\n", sdr_config->rx_gain);
-		/* open wave */
-		if (sdr_config->write_iq_rx_wave) {
-			rc = wave_create_record(&sdr->wave_rx_rec, sdr_config->write_iq_rx_wave, samplerate, 2, 1.0);
+		/* open wave (only the first device is recorded or played back) */
+		if (sdr_config->write_iq_rx_wave && sdr->device == 0) {
+			rc = wave_create_record(&sdr->wave_rx_rec, sdr_config->write_iq_rx_wave, samplerate, 2, 1.0, WAVE_FLAG_MMAP | ((sdr_config->iq_sigmf) ? WAVE_FLAG_SIGMF : 0) | sdr_config->iq_wave_format);
 			if (rc < 0) {
 				LOGP(DSDR, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 				goto error;
 			}
+			sdr_meta_init(&sdr->wave_rx_rec, "RX", rx_center_frequency, sdr_config->rx_gain);
 		}
-		if (sdr_config->read_iq_rx_wave) {
+		if (sdr_config->read_iq_rx_wave && sdr->device == 0) {
 			int two = 2;
-			rc = wave_create_playback(&sdr->wave_rx_play, sdr_config->read_iq_rx_wave, &samplerate, &two, 1.0);
+			rc = wave_create_playback(&sdr->wave_rx_play, sdr_config->read_iq_rx_wave, &samplerate, &two, 1.0, WAVE_FLAG_MMAP | WAVE_FLAG_WINDOW | sdr_config->iq_wave_format);
 			if (rc < 0) {
 				LOGP(DSDR, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 				goto error;
@@ -508,7 +820,7 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 		}
 		/* init measurements display */
 		for (c = 0; c < channels; c++) {
-			sender_t *sender = get_sender_by_empfangsfrequenz(sdr->chan[c].rx_frequency);
+			sender_t *sender = sdr->chan[c].sender = get_sender_by_empfangsfrequenz(sdr->chan[c].rx_frequency);
 			if (!sender)
 				continue;
 			sdr->chan[c].dmp_rf_level = display_measurements_add(&sender->dispmeas, "RF Level", "%.1f dB", DISPLAY_MEAS_AVG, DISPLAY_MEAS_LEFT, -96.0, 0.0, -INFINITY);
@@ -519,14 +831,22 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 		}
 	}
 
-	display_iq_init(samplerate);
-	display_spectrum_init(samplerate, rx_center_frequency);
+	/* IQ and spectrum display show the first device only */
+	if (sdr->device == 0) {
+		display_iq_init(samplerate);
+		display_spectrum_init(samplerate, rx_center_frequency);
+		if (sdr_config->waterfall) {
+			rc = waterfall_open(&sdr->waterfall, sdr_config->waterfall, samplerate, rx_center_frequency, sdr_config->waterfall_rate);
+			if (rc < 0)
+				goto error;
+		}
+	}
 
 	LOGP(DSDR, LOGL_INFO, "Using local oscillator offset: %.0f Hz\n", sdr_config->lo_offset);
 
 #ifdef HAVE_UHD
 	if (sdr_config->uhd) {
-		rc = uhd_open(sdr_config->channel, sdr_config->device_args, sdr_config->stream_args, sdr_config->tune_args, sdr_config->tx_antenna, sdr_config->rx_antenna, sdr_config->clock_source, tx_center_frequency, rx_center_frequency, sdr_config->lo_offset, sdr_config->samplerate, sdr_config->tx_gain, sdr_config->rx_gain, sdr_config->bandwidth, sdr_config->timestamps);
+		rc = uhd_open(&sdr->uhd, (sdr_config->mimo) ? sdr_config->channels[sdr->device] : sdr_config->channel, sdr_config->device_args[sdr->device], sdr_config->stream_args, sdr_config->tune_args, sdr_config->tx_antenna, sdr_config->rx_antenna, sdr_config->clock_source, tx_center_frequency, rx_center_frequency, sdr_config->lo_offset, sdr_config->samplerate, sdr_config->tx_gain, sdr_config->rx_gain, sdr_config->bandwidth, sdr_config->timestamps, sdr_config->wire_format, sdr_config->mimo);
 		if (rc)
 			goto error;
 	}
@@ -534,12 +854,54 @@ void *sdr_open(int __attribute__((__unused__)) direction, const char __attribute
 
 #ifdef HAVE_SOAPY
 	if (sdr_config->soapy) {
-		rc = soapy_open(sdr_config->channel, sdr_config->device_args, sdr_config->stream_args, sdr_config->tune_args, sdr_config->tx_antenna, sdr_config->rx_antenna, sdr_config->clock_source, tx_center_frequency, rx_center_frequency, sdr_config->lo_offset, sdr_config->samplerate, sdr_config->tx_gain, sdr_config->rx_gain, sdr_config->bandwidth, sdr_config->timestamps);
+		rc = soapy_open(&sdr->soapy, sdr_config->channel, sdr_config->device_args[sdr->device], sdr_config->stream_args, sdr_config->tune_args, sdr_config->tx_antenna, sdr_config->rx_antenna, sdr_config->clock_source, tx_center_frequency, rx_center_frequency, sdr_config->lo_offset, sdr_config->samplerate, sdr_config->tx_gain, sdr_config->rx_gain, sdr_config->bandwidth, sdr_config->timestamps, sdr_config->wire_format, sdr_config->direct_buffers);
 		if (rc)
 			goto error;
 	}
 #endif
 
+	if (sdr_config->shm) {
+		rc = iqshm_open(&sdr->iqshm, sdr_config->shm, tx_center_frequency, rx_center_frequency, sdr_config->samplerate);
+		if (rc)
+			goto error;
+	}
+
+	if (sdr_config->udp) {
+		rc = iqnet_open(&sdr->iqnet, sdr_config->udp, sdr_config->wire_format, sdr_config->udp_compress, tx_center_frequency, rx_center_frequency, sdr_config->samplerate, sdr_config->samplerate, sdr_config->samplerate * sdr_config->udp_jitter / 1000.0);
+		if (rc)
+			goto error;
+	}
+
+	if (sdr_config->loopback) {
+		rc = iqloop_open(&sdr->iqloop, tx_center_frequency, rx_center_frequency, samplerate, buffer_size * 2);
+		if (rc)
+			goto error;
+	}
+
+	/* integer wire formats are converted by us, so the correction is done while converting */
+	if (sdr_config->iq_correct) {
+		iq_correct_init(&sdr->iq_correct, (double)samplerate * sdr->oversample, IQ_CORRECT_TIME);
+		sdr->use_iq_correct = 1;
+#ifdef HAVE_UHD
+		if (sdr_config->uhd && sdr_config->wire_format != SDR_WIRE_CF32) {
+			sdr->uhd.rx_correct = &sdr->iq_correct;
+			sdr->use_iq_correct = 0;
+		}
+#endif
+#ifdef HAVE_SOAPY
+		if (sdr_config->soapy && sdr_config->wire_format != SDR_WIRE_CF32) {
+			sdr->soapy.rx_correct = &sdr->iq_correct;
+			sdr->use_iq_correct = 0;
+		}
+#endif
+	}
+
+	sdr_stats_init(&sdr->stats, sdr->buffer_size, sdr->buffer_size);
+	if (sdr_config->iq_correct)
+		sdr->stats.iq_correct = &sdr->iq_correct;
+	sdr_instance[sdr->device] = sdr;
+	arena_report(&sdr->arena);
+
 	return sdr;
 
 error:
@@ -547,82 +909,251 @@ error:
 	return NULL;
 }
 
-double bias_I, bias_Q; /* calculated bias */
-int bias_count = -1; /* number of calculations */
+/* print statistics of all SDR devices */
+void sdr_print_stats(void)
+{
+	int d;
+
+	for (d = 0; d < SDR_MAX_DEVICES; d++) {
+		if (sdr_instance[d])
+			sdr_stats_print(&sdr_instance[d]->stats, d, sdr_instance[d]->samplerate);
+	}
+}
+
+/* get statistics of given device, NULL if not open */
+struct sdr_stats *sdr_get_stats(int device, int *samplerate_p)
+{
+	if (device < 0 || device >= SDR_MAX_DEVICES || !sdr_instance[device])
+		return NULL;
+	*samplerate_p = sdr_instance[device]->samplerate;
+	return &sdr_instance[device]->stats;
+}
+
+static int bias_calibration = 0; /* incremented for each calibration request */
 
 void calibrate_bias(void)
 {
-	bias_count = 0;
-	bias_I = 0.0;
-	bias_Q = 0.0;
+	bias_calibration++;
 }
 
-static void sdr_bias(float *buffer, int count)
+static void sdr_bias(sdr_t *sdr, float *buffer, int count)
 {
 	int i;
 
-	if (bias_count < sdr_config->samplerate) {
+	/* start calibration of this device, if requested */
+	if (sdr->bias_calibration != bias_calibration) {
+		sdr->bias_calibration = bias_calibration;
+		sdr->bias_count = 0;
+		sdr->bias_I = 0.0;
+		sdr->bias_Q = 0.0;
+	}
+
+	if (sdr->bias_count < sdr_config->samplerate) {
 		for (i = 0; i < count; i++) {
-			bias_I += *buffer++;
-			bias_Q += *buffer++;
+			sdr->bias_I += *buffer++;
+			sdr->bias_Q += *buffer++;
 		}
-		bias_count += count;
-		if (bias_count >= sdr_config->samplerate) {
-			bias_I /= bias_count;
-			bias_Q /= bias_count;
+		sdr->bias_count += count;
+		if (sdr->bias_count >= sdr_config->samplerate) {
+			sdr->bias_I /= sdr->bias_count;
+			sdr->bias_Q /= sdr->bias_count;
 			LOGP(DSDR, LOGL_INFO, "DC bias calibration finished.\n");
 		}
 	} else {
 		for (i = 0; i < count; i++) {
-			*buffer++ -= bias_I;
-			*buffer++ -= bias_Q;
+			*buffer++ -= sdr->bias_I;
+			*buffer++ -= sdr->bias_Q;
 		}
 	}
 }
 
+/* wait until thread is woken up or timeout (ms) expires */
+static void sdr_thread_wait(sdr_thread_t *thread, double timeout)
+{
+	struct pollfd pfd;
+	eventfd_t value;
+
+	pfd.fd = thread->event_fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, (int)timeout) > 0)
+		eventfd_read(thread->event_fd, &value);
+}
+
+static void sdr_thread_wakeup(sdr_thread_t *thread)
+{
+	if (thread->event_fd >= 0)
+		eventfd_write(thread->event_fd, 1);
+}
+
+#ifdef HAVE_SOAPY
+/* upsample and scale into DMA buffers of the driver, return 0 if acquiring fails */
+static int sdr_write_soapy_direct(sdr_t *sdr, float *span, int num)
+{
+	float *buff;
+	int space, chunk, s;
+
+	while (num) {
+		space = soapy_send_acquire(&sdr->soapy, &buff) / sdr->oversample;
+		if (!space)
+			return 0;
+		chunk = (num < space) ? num : space;
+		if (sdr->oversample > 1) {
+			interpolator_process(&sdr->thread_write.dec, span, chunk, buff);
+			for (s = 0; s < chunk * 2 * sdr->oversample; s++)
+				buff[s] *= LIMIT_IQ_LEVEL;
+		} else {
+			for (s = 0; s < chunk * 2; s++)
+				buff[s] = span[s] * LIMIT_IQ_LEVEL;
+		}
+		soapy_send_release(&sdr->soapy, chunk * sdr->oversample);
+		span += chunk * 2;
+		num -= chunk;
+	}
+
+	return 1;
+}
+
+/* downsample from DMA buffers of the driver into the ring buffer, return number of samples */
+static int sdr_read_soapy_direct(sdr_t *sdr, int num, double timeout)
+{
+	const float *buff;
+	int count, copied = 0;
+
+	count = soapy_receive_acquire(&sdr->soapy, &buff, num, timeout);
+	if (count <= 0)
+		return 0;
+	/* DC bias is removed in place, so calibration needs a copy, the IQ correction is done while copying */
+	if (bias_calibration || sdr->use_iq_correct) {
+		iq_correct_to_float((sdr->use_iq_correct) ? &sdr->iq_correct : NULL, SDR_WIRE_CF32, buff, sdr->thread_read.buffer2, count);
+		soapy_receive_release(&sdr->soapy);
+		if (bias_calibration)
+			sdr_bias(sdr, sdr->thread_read.buffer2, count);
+		buff = sdr->thread_read.buffer2;
+		copied = 1;
+	}
+	/* filter spectrum and downsample, the decimator does not alter its input */
+	if (sdr->oversample > 1) {
+		count = decimator_process(&sdr->thread_read.dec, (float *)buff, count, sdr->thread_read.buffer2);
+		buff = sdr->thread_read.buffer2;
+	}
+	ringbuffer_write(&sdr->thread_read.ring, buff, count);
+	if (!copied)
+		soapy_receive_release(&sdr->soapy);
+
+	return count;
+}
+#endif
+
+/* upsample a span of the ring buffer, release it and forward it to SDR */
+static void sdr_write_span(sdr_t *sdr, float *span, int num)
+{
+	int s;
+	double start;
+
+#ifdef HAVE_SOAPY
+	/* upsample and filter spectrum straight into the buffers of the driver */
+	if (sdr_config->soapy && sdr->soapy.direct_tx) {
+		start = sdr_stats_time();
+		sdr_write_soapy_direct(sdr, span, num);
+		ringbuffer_read_release(&sdr->thread_write.ring, num);
+		sdr_stats_call(&sdr->stats.tx, start);
+		return;
+	}
+#endif
+	/* upsample and filter spectrum */
+	if (sdr->oversample > 1)
+		interpolator_process(&sdr->thread_write.dec, span, num, sdr->thread_write.buffer2);
+	else
+		memcpy(sdr->thread_write.buffer2, span, num * 2 * sizeof(*span));
+	ringbuffer_read_release(&sdr->thread_write.ring, num);
+	for (s = 0; s < num * 2 * sdr->oversample; s++)
+		sdr->thread_write.buffer2[s] *= LIMIT_IQ_LEVEL;
+	start = sdr_stats_time();
+#ifdef HAVE_UHD
+	if (sdr_config->uhd)
+		uhd_send(&sdr->uhd, sdr->thread_write.buffer2, num * sdr->oversample);
+#endif
+#ifdef HAVE_SOAPY
+	if (sdr_config->soapy)
+		soapy_send(&sdr->soapy, sdr->thread_write.buffer2, num * sdr->oversample);
+#endif
+	if (sdr_config->shm)
+		iqshm_send(&sdr->iqshm, sdr->thread_write.buffer2, num * sdr->oversample);
+	if (sdr_config->udp)
+		iqnet_send(&sdr->iqnet, sdr->thread_write.buffer2, num * sdr->oversample);
+	sdr_stats_call(&sdr->stats.tx, start);
+}
+
+/* end the TX burst and skip the time of 'num' samples, send silence if the device cannot do it */
+static void sdr_write_gap(sdr_t *sdr, int num)
+{
+	int sent = 0;
+
+#ifdef HAVE_UHD
+	if (sdr_config->uhd)
+		sent = uhd_send_gap(&sdr->uhd, num * sdr->oversample);
+#endif
+#ifdef HAVE_SOAPY
+	if (sdr_config->soapy)
+		sent = soapy_send_gap(&sdr->soapy, num * sdr->oversample);
+#endif
+	if (sent)
+		return;
+
+	/* time stamps got lost */
+	memset(sdr->thread_write.buffer2, 0, num * 2 * sdr->oversample * sizeof(*sdr->thread_write.buffer2));
+#ifdef HAVE_UHD
+	if (sdr_config->uhd)
+		uhd_send(&sdr->uhd, sdr->thread_write.buffer2, num * sdr->oversample);
+#endif
+#ifdef HAVE_SOAPY
+	if (sdr_config->soapy)
+		soapy_send(&sdr->soapy, sdr->thread_write.buffer2, num * sdr->oversample);
+#endif
+}
+
 static void *sdr_write_child(void *arg)
 {
 	sdr_t *sdr = (sdr_t *)arg;
-	int num;
-	int fill, out;
-	int s, ss, o;
+	int num, len;
+	float *span;
+
+	thread_prio_apply(THREAD_SDR_TX);
 
 	while (sdr->thread_write.running) {
-		/* write to SDR */
-		fill = (sdr->thread_write.in - sdr->thread_write.out + sdr->thread_write.buffer_size) % sdr->thread_write.buffer_size;
-		num = fill / 2;
-		if (num) {
-#ifdef DEBUG_BUFFER
-			printf("Thread found %d samples in write buffer and forwards them to SDR.\n", num);
-#endif
-			out = sdr->thread_write.out;
-			for (s = 0, ss = 0; s < num; s++) {
-				for (o = 0; o < sdr->oversample; o++) {
-					sdr->thread_write.buffer2[ss++] = sdr->thread_write.buffer[out] * LIMIT_IQ_LEVEL;
-					sdr->thread_write.buffer2[ss++] = sdr->thread_write.buffer[out + 1] * LIMIT_IQ_LEVEL;
+		/* write to SDR, one contiguous span at a time */
+		while (1) {
+			/* in burst mode, each span is limited to its segment and gaps are sent in between */
+			if (sdr->tx_burst && !sdr->thread_write.segment) {
+				if (!ringbuffer_read(&sdr->thread_write.segments, &len, 1))
+					break;
+				if (len < 0) {
+					sdr_write_gap(sdr, -len);
+					atomic_fetch_sub(&sdr->thread_write.gap, -len);
+					continue;
 				}
-				out = (out + 2) % sdr->thread_write.buffer_size;
+				sdr->thread_write.segment = len;
 			}
-			sdr->thread_write.out = out;
-#ifndef DISABLE_FILTER
-			/* filter spectrum */
-			if (sdr->oversample > 1) {
-				iir_process_baseband(&sdr->thread_write.lp[0], sdr->thread_write.buffer2, num * sdr->oversample);
-				iir_process_baseband(&sdr->thread_write.lp[1], sdr->thread_write.buffer2 + 1, num * sdr->oversample);
+			num = ringbuffer_read_span(&sdr->thread_write.ring, (void **)&span);
+			if (!num)
+				break;
+			if (sdr->tx_burst) {
+				if (num > sdr->thread_write.segment)
+					num = sdr->thread_write.segment;
+				sdr->thread_write.segment -= num;
 			}
+#ifdef DEBUG_BUFFER
+			printf("Thread found %d samples in write buffer and forwards them to SDR.\n", num);
 #endif
-#ifdef HAVE_UHD
-			if (sdr_config->uhd)
-				uhd_send(sdr->thread_write.buffer2, num * sdr->oversample);
-#endif
-#ifdef HAVE_SOAPY
-			if (sdr_config->soapy)
-				soapy_send(sdr->thread_write.buffer2, num * sdr->oversample);
-#endif
+			sdr_write_span(sdr, span, num);
 		}
 
-		/* delay some time */
-		usleep(sdr->interval * 1000.0);
+		/* wait for data or delay some time */
+		if (sdr->thread_write.event_fd >= 0)
+			sdr_thread_wait(&sdr->thread_write, sdr->interval);
+		else
+			usleep(sdr->interval * 1000.0);
 	}
 
 	LOGP(DSDR, LOGL_DEBUG, "Thread received exit!\n");
@@ -634,47 +1165,62 @@ static void *sdr_read_child(void *arg)
 {
 	sdr_t *sdr = (sdr_t *)arg;
 	int num, count = 0;
-	int space, in;
-	int s, ss;
+	double timeout = 0.0;
+	double start;
+
+	thread_prio_apply(THREAD_SDR_RX);
+
+	/* block on receiving, but return after interval to check for exit */
+	if (sdr_config->event_threads)
+		timeout = sdr->interval / 1000.0;
 
 	while (sdr->thread_read.running) {
-		/* read from SDR */
-		space = (sdr->thread_read.out - sdr->thread_read.in - 2 + sdr->thread_read.buffer_size) % sdr->thread_read.buffer_size;
-		num = space / 2;
+		/* read from SDR (the driver needs space for whole packets, so the span of the ring may be too small) */
+		num = ringbuffer_space(&sdr->thread_read.ring) * sdr->oversample;
 		if (num) {
+			start = sdr_stats_time();
+#ifdef HAVE_SOAPY
+			/* process samples in the buffers of the driver */
+			if (sdr_config->soapy && sdr->soapy.direct_rx) {
+				count = sdr_read_soapy_direct(sdr, num, timeout);
+				sdr_stats_call(&sdr->stats.rx, start);
+				goto delay;
+			}
+#endif
 #ifdef HAVE_UHD
 			if (sdr_config->uhd)
-				count = uhd_receive(sdr->thread_read.buffer2, num);
+				count = uhd_receive(&sdr->uhd, sdr->thread_read.buffer2, num, timeout);
 #endif
 #ifdef HAVE_SOAPY
 			if (sdr_config->soapy)
-				count = soapy_receive(sdr->thread_read.buffer2, num);
+				count = soapy_receive(&sdr->soapy, sdr->thread_read.buffer2, num, timeout);
 #endif
-			if (bias_count >= 0)
-				sdr_bias(sdr->thread_read.buffer2, count);
+			if (sdr_config->shm)
+				count = iqshm_receive(&sdr->iqshm, sdr->thread_read.buffer2, num, timeout);
+			if (sdr_config->udp)
+				count = iqnet_receive(&sdr->iqnet, sdr->thread_read.buffer2, num, timeout);
+			sdr_stats_call(&sdr->stats.rx, start);
+			if (sdr->use_iq_correct)
+				iq_correct_to_float(&sdr->iq_correct, SDR_WIRE_CF32, sdr->thread_read.buffer2, sdr->thread_read.buffer2, count);
+			if (bias_calibration)
+				sdr_bias(sdr, sdr->thread_read.buffer2, count);
 			if (count > 0) {
 #ifdef DEBUG_BUFFER
 				printf("Thread read %d samples from SDR and writes them to read buffer.\n", count);
 #endif
-#ifndef DISABLE_FILTER
-				/* filter spectrum */
-				if (sdr->oversample > 1) {
-					iir_process_baseband(&sdr->thread_read.lp[0], sdr->thread_read.buffer2, count);
-					iir_process_baseband(&sdr->thread_read.lp[1], sdr->thread_read.buffer2 + 1, count);
-				}
-#endif
-				in = sdr->thread_read.in;
-				for (s = 0, ss = 0; s < count; s++) {
-					sdr->thread_read.buffer[in++] = sdr->thread_read.buffer2[ss++];
-					sdr->thread_read.buffer[in++] = sdr->thread_read.buffer2[ss++];
-					in %= sdr->thread_read.buffer_size;
-				}
-				sdr->thread_read.in = in;
+				/* filter spectrum and downsample */
+				if (sdr->oversample > 1)
+					count = decimator_process(&sdr->thread_read.dec, sdr->thread_read.buffer2, count, sdr->thread_read.buffer2);
+				ringbuffer_write(&sdr->thread_read.ring, sdr->thread_read.buffer2, count);
 			}
 		}
 
-		/* delay some time */
-		usleep(sdr->interval * 1000.0);
+#ifdef HAVE_SOAPY
+delay:
+#endif
+		/* delay some time, unless receiving has waited already */
+		if (!timeout || !num)
+			usleep(sdr->interval * 1000.0);
 	}
 
 	LOGP(DSDR, LOGL_DEBUG, "Thread received exit!\n");
@@ -690,12 +1236,18 @@ int sdr_start(void *inst)
 
 #ifdef HAVE_UHD
 	if (sdr_config->uhd)
-		rc = uhd_start();
+		rc = uhd_start(&sdr->uhd);
 #endif
 #ifdef HAVE_SOAPY
 	if (sdr_config->soapy)
-		rc = soapy_start();
+		rc = soapy_start(&sdr->soapy);
 #endif
+	if (sdr_config->shm)
+		rc = iqshm_start(&sdr->iqshm);
+	if (sdr_config->udp)
+		rc = iqnet_start(&sdr->iqnet);
+	if (sdr_config->loopback)
+		rc = 0;
 	if (rc < 0)
 		return rc;
 
@@ -744,6 +1296,7 @@ void sdr_close(void *inst)
 		if (sdr->thread_write.running) {
 			LOGP(DSDR, LOGL_DEBUG, "Thread sending exit!\n");
 			sdr->thread_write.running = 0;
+			sdr_thread_wakeup(&sdr->thread_write);
 			while (sdr->thread_write.exit == 0)
 				usleep(1000);
 		}
@@ -755,36 +1308,48 @@ void sdr_close(void *inst)
 		}
 	}
 
-	if (sdr->thread_read.buffer)
-		free((void *)sdr->thread_read.buffer);
-	if (sdr->thread_read.buffer2)
-		free((void *)sdr->thread_read.buffer2);
-	if (sdr->thread_write.buffer)
-		free((void *)sdr->thread_write.buffer);
-	if (sdr->thread_write.buffer2)
-		free((void *)sdr->thread_write.buffer2);
+	if (sdr_instance[sdr->device] == sdr)
+		sdr_instance[sdr->device] = NULL;
+
+	ringbuffer_exit(&sdr->thread_read.ring);
+	ringbuffer_exit(&sdr->thread_write.ring);
+	ringbuffer_exit(&sdr->thread_write.segments);
+	decimator_exit(&sdr->thread_read.dec);
+	interpolator_exit(&sdr->thread_write.dec);
+	if (sdr->thread_write.event_fd >= 0)
+		close(sdr->thread_write.event_fd);
 
 #ifdef HAVE_UHD
 	if (sdr_config->uhd)
-		uhd_close();
+		uhd_close(&sdr->uhd);
 #endif
 
 #ifdef HAVE_SOAPY
 	if (sdr_config->soapy)
-		soapy_close();
+		soapy_close(&sdr->soapy);
 #endif
 
+	if (sdr_config->shm)
+		iqshm_close(&sdr->iqshm);
+
+	if (sdr_config->udp)
+		iqnet_close(&sdr->iqnet);
+
+	if (sdr_config->loopback)
+		iqloop_close(&sdr->iqloop);
+
 	if (sdr) {
-		free(sdr->modbuff);
-		free(sdr->modbuff_I);
-		free(sdr->modbuff_Q);
-		free(sdr->modbuff_carrier);
-		free(sdr->wavespl0);
-		free(sdr->wavespl1);
+		if (sdr->chan) {
+			sdr_meta_channels(sdr, &sdr->wave_rx_rec, 0);
+			sdr_meta_channels(sdr, &sdr->wave_tx_rec, 1);
+		}
 		wave_destroy_record(&sdr->wave_rx_rec);
 		wave_destroy_record(&sdr->wave_tx_rec);
 		wave_destroy_playback(&sdr->wave_rx_play);
 		wave_destroy_playback(&sdr->wave_tx_play);
+		waterfall_close(&sdr->waterfall);
+		if (sdr->use_scanner)
+			scanner_exit(&sdr->scanner);
 		if (sdr->chan) {
 			int c;
 
@@ -796,12 +1361,23 @@ void sdr_close(void *inst)
 			}
 			if (sdr->paging_channel)
 				fm_mod_exit(&sdr->chan[sdr->paging_channel].fm_mod);
+			memacct_add(MEMACCT_SDR, "SDR", -(ssize_t)(sizeof(*sdr->chan) * (sdr->channels + (sdr->paging_channel != 0))));
 			free(sdr->chan);
 		}
+		free(sdr->rx_pfb_baseband);
+		pfb_analysis_exit(&sdr->rx_pfb);
+		free(sdr->rx_bank_iq);
+		iir_bank_exit(&sdr->rx_bank);
+		free(sdr->tx_pfb_baseband);
+		pfb_synthesis_exit(&sdr->tx_pfb);
+		/* all sample buffers */
+		arena_free(&sdr->arena);
+		memacct_add(MEMACCT_SDR, "SDR", -(ssize_t)sizeof(*sdr));
 		free(sdr);
 		sdr = NULL;
 	}
 
+	display_iq_exit();
 	display_spectrum_exit();
 }
 
@@ -814,6 +1390,25 @@ static double get_time(void)
 	return (double)tv.tv_sec + (double)tv.tv_nsec / 1000000000.0;
 }
 
+/* all transmitters are off and have finished ramping down */
+static int sdr_tx_off(sdr_t *sdr, uint8_t **power, int num, int channels)
+{
+	int c, s;
+
+	if (sdr->paging_channel && sdr->chan[sdr->paging_channel].fm_mod.state != MOD_STATE_OFF)
+		return 0;
+	for (c = 0; c < channels; c++) {
+		if (!sdr->chan[c].am && sdr->chan[c].fm_mod.state != MOD_STATE_OFF)
+			return 0;
+		for (s = 0; s < num; s++) {
+			if (power[c][s])
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
 int sdr_write(void *inst, sample_t **samples, uint8_t **power, int num, enum paging_signal __attribute__((unused)) *paging_signal, int *on, int channels)
 {
 	sdr_t *sdr = (sdr_t *)inst;
@@ -830,8 +1425,42 @@ int sdr_write(void *inst, sample_t **samples, uint8_t **power, int num, enum pag
 		abort();
 	}
 
+	/* nothing to transmit, so the write thread ends the burst instead of sending silence */
+	if (sdr->tx_burst && channels && !sdr->wave_tx_rec.fp && !sdr->wave_tx_play.fp && sdr_tx_off(sdr, power, num, channels)) {
+		int gap = -num;
+
+		if (!ringbuffer_space(&sdr->thread_write.segments)) {
+			LOGP(DSDR, LOGL_ERROR, "Write SDR buffer overflow!\n");
+			return 0;
+		}
+		atomic_fetch_add(&sdr->thread_write.gap, num);
+		ringbuffer_write(&sdr->thread_write.segments, &gap, 1);
+		sdr_thread_wakeup(&sdr->thread_write);
+		return num;
+	}
+
 	/* process all channels */
-	if (channels) {
+	if (channels && sdr->use_tx_pfb) {
+		int count, carriers = sdr->tx_pfb.channels;
+		buff = sdr->modbuff;
+		memset(buff, 0, sizeof(*buff) * num * 2);
+		/* modulate each channel into its carrier at reduced rate */
+		count = pfb_synthesis_prepare(&sdr->tx_pfb, num);
+		for (c = 0; c < carriers; c++)
+			memset(sdr->tx_pfb_baseband[c], 0, sizeof(*sdr->tx_pfb_baseband[c]) * count * 2);
+		for (c = 0; c < channels; c++) {
+			pfb_synthesis_decimate(&sdr->tx_pfb, c, samples[c], power[c], num, sdr->tx_pfb_samples, sdr->tx_pfb_power);
+			/* switch to paging channel, if requested */
+			if (on[c] && sdr->paging_channel)
+				fm_modulate_complex(&sdr->chan[sdr->paging_channel].fm_mod, sdr->tx_pfb_samples, sdr->tx_pfb_power, count, sdr->tx_pfb_baseband[sdr->paging_channel]);
+			else if (sdr->chan[c].am)
+				am_modulate_complex(&sdr->chan[c].am_mod, sdr->tx_pfb_samples, sdr->tx_pfb_power, count, sdr->tx_pfb_baseband[c]);
+			else
+				fm_modulate_complex(&sdr->chan[c].fm_mod, sdr->tx_pfb_samples, sdr->tx_pfb_power, count, sdr->tx_pfb_baseband[c]);
+		}
+		/* combine all carriers */
+		pfb_synthesis_process(&sdr->tx_pfb, sdr->tx_pfb_baseband, count, num, buff);
+	} else if (channels) {
 		buff = sdr->modbuff;
 		memset(buff, 0, sizeof(*buff) * num * 2);
 		for (c = 0; c < channels; c++) {
@@ -866,10 +1495,10 @@ int sdr_write(void *inst, sample_t **samples, uint8_t **power, int num, enum pag
 
 	if (sdr->threads) {
 		/* store data towards SDR in ring buffer */
-		int fill, space, in;
+		int fill, space;
 
-		fill = (sdr->thread_write.in - sdr->thread_write.out + sdr->thread_write.buffer_size) % sdr->thread_write.buffer_size;
-		space = (sdr->thread_write.out - sdr->thread_write.in - 2 + sdr->thread_write.buffer_size) % sdr->thread_write.buffer_size;
+		fill = ringbuffer_fill(&sdr->thread_write.ring);
+		space = ringbuffer_space(&sdr->thread_write.ring);
 
 		/* debug fill level */
 		if (fill > sdr->thread_write.max_fill)
@@ -878,36 +1507,42 @@ int sdr_write(void *inst, sample_t **samples, uint8_t **power, int num, enum pag
 			sdr->thread_write.max_fill_timer = get_time();
 		if (get_time() - sdr->thread_write.max_fill_timer > 1.0) {
 			double delay;
-			delay = (double)sdr->thread_write.max_fill / 2.0 / (double)sdr->samplerate;
+			delay = (double)sdr->thread_write.max_fill / (double)sdr->samplerate;
 			sdr->thread_write.max_fill = 0;
 			sdr->thread_write.max_fill_timer += 1.0;
 			LOGP(DSDR, LOGL_DEBUG, "write delay = %.3f ms\n", delay * 1000.0);
 		}
 
-		if (space < num * 2) {
+		if (sdr->tx_burst && !ringbuffer_space(&sdr->thread_write.segments))
+			space = 0;
+		if (space < num) {
 			LOGP(DSDR, LOGL_ERROR, "Write SDR buffer overflow!\n");
-			num = space / 2;
+			num = space;
 		}
 #ifdef DEBUG_BUFFER
 		printf("Writing %d samples to write buffer.\n", num);
 #endif
-		in = sdr->thread_write.in;
-		for (s = 0, ss = 0; s < num; s++) {
-			sdr->thread_write.buffer[in++] = buff[ss++];
-			sdr->thread_write.buffer[in++] = buff[ss++];
-			in %= sdr->thread_write.buffer_size;
-		}
-		sdr->thread_write.in = in;
-		sent = num;
+		sent = ringbuffer_write(&sdr->thread_write.ring, buff, num);
+		/* the segment is stored after its samples, so the write thread finds them */
+		if (sdr->tx_burst && sent)
+			ringbuffer_write(&sdr->thread_write.segments, &sent, 1);
+		sdr_stats_fill(&sdr->stats.tx, fill + sent);
+		sdr_thread_wakeup(&sdr->thread_write);
 	} else {
 #ifdef HAVE_UHD
 		if (sdr_config->uhd)
-			sent = uhd_send(buff, num);
+			sent = uhd_send(&sdr->uhd, buff, num);
 #endif
 #ifdef HAVE_SOAPY
 		if (sdr_config->soapy)
-			sent = soapy_send(buff, num);
+			sent = soapy_send(&sdr->soapy, buff, num);
 #endif
+		if (sdr_config->shm)
+			sent = iqshm_send(&sdr->iqshm, buff, num);
+		if (sdr_config->udp)
+			sent = iqnet_send(&sdr->iqnet, buff, num);
+		if (sdr_config->loopback)
+			sent = iqloop_send(&sdr->iqloop, buff, num);
 		if (sent < 0)
 			return sent;
 	}
@@ -915,12 +1550,68 @@ int sdr_write(void *inst, sample_t **samples, uint8_t **power, int num, enum pag
 	return sent;
 }
 
+/* RMS level in dB of IQ vectors */
+static double sdr_iq_level(const sample_t *I, const sample_t *Q, int count)
+{
+	double avg = 0.0;
+	int s;
+
+	for (s = 0; s < count; s++) {
+		/* average the square length of vector */
+		avg += I[s] * I[s] + Q[s] * Q[s];
+	}
+	avg = sqrt(avg /(double)count); /* RMS */
+	return log10(avg) * 20;
+}
+
+/* RMS level in dB of interleaved baseband */
+static double sdr_baseband_level(const float *baseband, int count)
+{
+	double avg = 0.0;
+	int s;
+
+	for (s = 0; s < count * 2; s++)
+		avg += baseband[s] * baseband[s];
+	avg = sqrt(avg /(double)count);
+	return log10(avg) * 20;
+}
+
+/* activity gate: if the channel is idle, fill silence instead of demodulating and return 1 */
+static int sdr_rx_gate(sdr_t *sdr, int c, double level, sample_t *samples, int count, double *rf_level_db)
+{
+	sdr_chan_t *chan = &sdr->chan[c];
+
+	if (!chan->sender || chan->sender->rx_always_on || !count)
+		return 0;
+
+	if (level >= sdr_config->rx_gate_level) {
+		if (chan->gate_hold <= 0)
+			LOGP(DSDR, LOGL_DEBUG, "Channel #%d is active (%.1f dB), start demodulation.\n", c, level);
+		chan->gate_hold = (int)((double)sdr->samplerate * RX_GATE_HOLD);
+		return 0;
+	}
+	if (chan->gate_hold > 0) {
+		chan->gate_hold -= count;
+		if (chan->gate_hold > 0)
+			return 0;
+		LOGP(DSDR, LOGL_DEBUG, "Channel #%d is idle, stop demodulation.\n", c);
+	}
+
+	memset(samples, 0, count * sizeof(*samples));
+	display_measurements_update(chan->dmp_rf_level, level, 0.0);
+	if (rf_level_db)
+		rf_level_db[c] = level;
+	chan->sender->rx_gated = 1;
+	return 1;
+}
+
 int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db)
 {
 	sdr_t *sdr = (sdr_t *)inst;
 	float *buff = NULL;
 	int count = 0;
 	int c, s, ss;
+	int gate = sdr_config->rx_gate || sdr_rx_gate_forced;
 
 	if (num > sdr->buffer_size) {
 		fprintf(stderr, "exceeding maximum size given by sdr->buffer_size, please fix!\n");
@@ -935,9 +1626,9 @@ int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_l
 
 	if (sdr->threads) {
 		/* load data from SDR out of ring buffer */
-		int fill, out;
+		int fill;
 
-		fill = (sdr->thread_read.in - sdr->thread_read.out + sdr->thread_read.buffer_size) % sdr->thread_read.buffer_size;
+		fill = ringbuffer_fill(&sdr->thread_read.ring);
 
 		/* debug fill level */
 		if (fill > sdr->thread_read.max_fill)
@@ -946,36 +1637,42 @@ int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_l
 			sdr->thread_read.max_fill_timer = get_time();
 		if (get_time() - sdr->thread_read.max_fill_timer > 1.0) {
 			double delay;
-			delay = (double)sdr->thread_read.max_fill / 2.0 / (double)sdr_config->samplerate;
+			delay = (double)sdr->thread_read.max_fill / (double)sdr->samplerate;
 			sdr->thread_read.max_fill = 0;
 			sdr->thread_read.max_fill_timer += 1.0;
 			LOGP(DSDR, LOGL_DEBUG, "read delay = %.3f ms\n", delay * 1000.0);
 		}
 
-		if (fill / 2 / sdr->oversample < num)
-			num = fill / 2 / sdr->oversample;
+		/* the oldest sample has been waiting for the duration of the buffer fill */
+		sdr_stats_fill(&sdr->stats.rx, fill);
+		if (fill)
+			sdr_stats_latency(&sdr->stats, (double)fill / (double)sdr->samplerate);
+
+		if (fill < num)
+			num = fill;
 #ifdef DEBUG_BUFFER
 		printf("Reading %d samples from read buffer.\n", num);
 #endif
-		out = sdr->thread_read.out;
-		for (s = 0, ss = 0; s < num; s++) {
-			buff[ss++] = sdr->thread_read.buffer[out];
-			buff[ss++] = sdr->thread_read.buffer[out + 1];
-			out = (out + 2 * sdr->oversample) % sdr->thread_read.buffer_size;
-		}
-		sdr->thread_read.out = out;
-		count = num;
+		count = ringbuffer_read(&sdr->thread_read.ring, buff, num);
 	} else {
 #ifdef HAVE_UHD
 		if (sdr_config->uhd)
-			count = uhd_receive(buff, num);
+			count = uhd_receive(&sdr->uhd, buff, num, 0.0);
 #endif
 #ifdef HAVE_SOAPY
 		if (sdr_config->soapy)
-			count = soapy_receive(buff, num);
+			count = soapy_receive(&sdr->soapy, buff, num, 0.0);
 #endif
-		if (bias_count >= 0)
-			sdr_bias(buff, count);
+		if (sdr_config->shm)
+			count = iqshm_receive(&sdr->iqshm, buff, num, 0.0);
+		if (sdr_config->udp)
+			count = iqnet_receive(&sdr->iqnet, buff, num, 0.0);
+		if (sdr_config->loopback)
+			count = iqloop_receive(&sdr->iqloop, buff, num);
+		if (sdr->use_iq_correct)
+			iq_correct_to_float(&sdr->iq_correct, SDR_WIRE_CF32, buff, buff, count);
+		if (bias_calibration)
+			sdr_bias(sdr, buff, count);
 		if (count <= 0)
 			return count;
 	}
@@ -983,6 +1680,7 @@ int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_l
 	if (sdr_rx_overflow) {
 		LOGP(DSDR, LOGL_ERROR, "SDR RX overflow!\n");
 		sdr_rx_overflow = 0;
+		sdr_stats_event(&sdr->stats.rx);
 	}
 
 	if (sdr->wave_rx_rec.fp) {
@@ -1001,46 +1699,92 @@ int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_l
 			buff[ss++] = spl_list[1][s];
 		}
 	}
-	display_iq(buff, count);
-	display_spectrum(buff, count);
+	if (sdr->device == 0) {
+		display_iq(buff, count);
+		display_spectrum(buff, count);
+	}
+	if (sdr->waterfall.fp)
+		waterfall_feed(&sdr->waterfall, buff, count);
 
 	if (channels) {
+		int chan_count = count;
+
+		/* find carriers and tune the decoder slots to them */
+		if (sdr->use_scanner)
+			scanner_process(&sdr->scanner, buff, count);
+
+		/* split into channels at reduced rate */
+		if (sdr->use_rx_pfb)
+			chan_count = pfb_analysis_process(&sdr->rx_pfb, buff, count, sdr->rx_pfb_baseband);
+
+		/* shift all channels, then filter them together */
+		if (sdr->use_rx_bank) {
+			for (c = 0; c < channels; c++) {
+				if (sdr->use_scanner && !sdr->scanner.slot[c].attached)
+					continue;
+				fm_demodulate_rotate(&sdr->chan[c].fm_demod, chan_count, (sdr->use_rx_pfb) ? sdr->rx_pfb_baseband[c] : buff, sdr->rx_bank_iq[c * 2], sdr->rx_bank_iq[c * 2 + 1]);
+			}
+			iir_bank_process(&sdr->rx_bank, sdr->rx_bank_iq, chan_count);
+		}
+
 		for (c = 0; c < channels; c++) {
+			sample_t *I = sdr->modbuff_I, *Q = sdr->modbuff_Q;
 			if (rf_level_db)
 				rf_level_db[c] = NAN;
-			if (sdr->chan[c].am)
-				am_demodulate_complex(&sdr->chan[c].am_demod, samples[c], count, buff, sdr->modbuff_I, sdr->modbuff_Q, sdr->modbuff_carrier);
-			else
-				fm_demodulate_complex(&sdr->chan[c].fm_demod, samples[c], count, buff, sdr->modbuff_I, sdr->modbuff_Q);
-			sender_t *sender = get_sender_by_empfangsfrequenz(sdr->chan[c].rx_frequency);
-			if (!sender || !count)
+			if (sdr->chan[c].sender)
+				sdr->chan[c].sender->rx_gated = 0;
+			/* free decoder slots get silence, so their decoders are idle */
+			if (sdr->use_scanner && !sdr->scanner.slot[c].attached) {
+				memset(samples[c], 0, count * sizeof(*samples[c]));
+				if (sdr->chan[c].sender)
+					sdr->chan[c].sender->rx_gated = 1;
 				continue;
-			double min, max, avg;
-			avg = 0.0;
-			for (s = 0; s < count; s++) {
-				/* average the square length of vector */
-				avg += sdr->modbuff_I[s] * sdr->modbuff_I[s] + sdr->modbuff_Q[s] * sdr->modbuff_Q[s];
 			}
-			avg = sqrt(avg /(double)count); /* RMS */
-			avg = log10(avg) * 20;
-			display_measurements_update(sdr->chan[c].dmp_rf_level, avg, 0.0);
-			if (rf_level_db)
-				rf_level_db[c] = avg;
-			if (!sdr->chan[c].am) {
-				min = 0.0;
-				max = 0.0;
-				avg = 0.0;
-				for (s = 0; s < count; s++) {
-					avg += samples[c][s];
-					if (s == 0 || samples[c][s] > max)
-						max = samples[c][s];
-					if (s == 0 || samples[c][s] < min)
-						min = samples[c][s];
+			if (sdr->use_rx_bank) {
+				I = sdr->rx_bank_iq[c * 2];
+				Q = sdr->rx_bank_iq[c * 2 + 1];
+				if (gate && chan_count && sdr_rx_gate(sdr, c, sdr_iq_level(I, Q, chan_count), samples[c], count, rf_level_db))
+					continue;
+				if (sdr->use_rx_pfb) {
+					fm_demodulate_discriminate(&sdr->chan[c].fm_demod, sdr->chan[c].pfb_demod, chan_count, I, Q);
+					pfb_analysis_interpolate(&sdr->rx_pfb, c, sdr->chan[c].pfb_demod, samples[c], count);
+				} else
+					fm_demodulate_discriminate(&sdr->chan[c].fm_demod, samples[c], count, I, Q);
+			} else if (sdr->use_rx_pfb) {
+				if (gate && !sdr->chan[c].am && chan_count && sdr_rx_gate(sdr, c, sdr_baseband_level(sdr->rx_pfb_baseband[c], chan_count), samples[c], count, rf_level_db))
+					continue;
+				if (sdr->chan[c].am)
+					am_demodulate_complex(&sdr->chan[c].am_demod, sdr->chan[c].pfb_demod, chan_count, sdr->rx_pfb_baseband[c], sdr->modbuff_I, sdr->modbuff_Q, sdr->modbuff_carrier);
+				else
+					fm_demodulate_complex(&sdr->chan[c].fm_demod, sdr->chan[c].pfb_demod, chan_count, sdr->rx_pfb_baseband[c], sdr->modbuff_I, sdr->modbuff_Q);
+				pfb_analysis_interpolate(&sdr->rx_pfb, c, sdr->chan[c].pfb_demod, samples[c], count);
+			} else {
+				if (sdr->chan[c].am)
+					am_demodulate_complex(&sdr->chan[c].am_demod, samples[c], count, buff, sdr->modbuff_I, sdr->modbuff_Q, sdr->modbuff_carrier);
+				else {
+					/* the level of the filtered channel decides if it is discriminated */
+					fm_demodulate_filter(&sdr->chan[c].fm_demod, count, buff, I, Q);
+					if (gate && count && sdr_rx_gate(sdr, c, sdr_iq_level(I, Q, count), samples[c], count, rf_level_db))
+						continue;
+					fm_demodulate_discriminate(&sdr->chan[c].fm_demod, samples[c], count, I, Q);
 				}
-				avg /= (double)count;
-				display_measurements_update(sdr->chan[c].dmp_freq_offset, avg / 1000.0, 0.0);
+			}
+			if (!sdr->chan[c].sender || !count || !chan_count)
+				continue;
+			fm_demod_t *demod = &sdr->chan[c].fm_demod;
+			double level;
+			/* FM measurements are taken by the discriminator */
+			if (sdr->chan[c].am)
+				level = sdr_iq_level(I, Q, chan_count);
+			else
+				level = log10(demod->meas_power) * 10;
+			display_measurements_update(sdr->chan[c].dmp_rf_level, level, 0.0);
+			if (rf_level_db)
+				rf_level_db[c] = level;
+			if (!sdr->chan[c].am && !display_measurements_suspended) {
+				display_measurements_update(sdr->chan[c].dmp_freq_offset, demod->meas_avg / 1000.0, 0.0);
 				/* use half min and max, because we want the deviation above/below (+-) center frequency. */
-				display_measurements_update(sdr->chan[c].dmp_deviation, min / 2.0 / 1000.0, max / 2.0 / 1000.0);
+				display_measurements_update(sdr->chan[c].dmp_deviation, demod->meas_min / 2.0 / 1000.0, demod->meas_max / 2.0 / 1000.0);
 			}
 		}
 	}
@@ -1048,20 +1792,83 @@ int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_l
 	return count;
 }
 
+/* adjust TX lead: raise it on underrun, lower it towards the configured value when stable */
+static void tx_lead_control(sdr_t *sdr, int underrun)
+{
+	double now = get_time();
+	int lead;
+
+	if (sdr->tx_lead_timer == 0.0)
+		sdr->tx_lead_timer = now;
+
+	if (underrun) {
+		sdr->tx_lead_timer = now;
+		lead = (int)((double)sdr->tx_lead * TX_LEAD_RAISE) + 1;
+		if (lead > sdr->buffer_size)
+			lead = sdr->buffer_size;
+		if (lead != sdr->tx_lead) {
+			sdr->tx_lead = lead;
+			LOGP(DSDR, LOGL_NOTICE, "TX underrun, raising TX lead to %.1f ms.\n", (double)sdr->tx_lead / (double)sdr->samplerate * 1000.0);
+		}
+		return;
+	}
+
+	if (sdr->tx_lead > sdr->tx_lead_min && now - sdr->tx_lead_timer > TX_LEAD_STABLE) {
+		sdr->tx_lead_timer = now;
+		lead = sdr->tx_lead - (int)(TX_LEAD_LOWER * (double)sdr->samplerate);
+		if (lead < sdr->tx_lead_min)
+			lead = sdr->tx_lead_min;
+		sdr->tx_lead = lead;
+		LOGP(DSDR, LOGL_DEBUG, "TX is stable, lowering TX lead to %.1f ms.\n", (double)sdr->tx_lead / (double)sdr->samplerate * 1000.0);
+	}
+}
+
+/* mark a received frame in the RX recording, the frame ended just now */
+void sdr_annotate(void *inst, double frequency, double duration, const char *label)
+{
+	sdr_t *sdr = (sdr_t *)inst;
+	uint64_t count;
+
+	if (!sdr->wave_rx_rec.fp)
+		return;
+	count = duration * sdr->wave_rx_rec.samplerate;
+	wave_meta_annotate(&sdr->wave_rx_rec, -(int64_t)count, count, frequency - sdr->bandwidth / 2.0, frequency + sdr->bandwidth / 2.0, label, NULL);
+}
+
 /* how much do we need to send (in audio sample duration) to get the target delay (buffer size) */
 int sdr_get_tosend(void *inst, int buffer_size)
 {
 	sdr_t *sdr = (sdr_t *)inst;
 	int count = 0;
+	int underrun;
+
+	/* underrun has been detected by the driver during last call */
+	underrun = sdr_tx_underrun;
+	sdr_tx_underrun = 0;
+	if (underrun)
+		sdr_stats_event(&sdr->stats.tx);
+
+	/* schedule TX in advance of RX by target lead, rather than by the whole buffer */
+	if (sdr->tx_lead) {
+		tx_lead_control(sdr, underrun);
+		if (buffer_size > sdr->tx_lead)
+			buffer_size = sdr->tx_lead;
+	}
 
 #ifdef HAVE_UHD
 	if (sdr_config->uhd)
-		count = uhd_get_tosend(buffer_size * sdr->oversample);
+		count = uhd_get_tosend(&sdr->uhd, buffer_size * sdr->oversample);
 #endif
 #ifdef HAVE_SOAPY
 	if (sdr_config->soapy)
-		count = soapy_get_tosend(buffer_size * sdr->oversample);
+		count = soapy_get_tosend(&sdr->soapy, buffer_size * sdr->oversample);
 #endif
+	if (sdr_config->shm)
+		count = iqshm_get_tosend(&sdr->iqshm, buffer_size * sdr->oversample);
+	if (sdr_config->udp)
+		count = iqnet_get_tosend(&sdr->iqnet, buffer_size * sdr->oversample);
+	if (sdr_config->loopback)
+		count = iqloop_get_tosend(&sdr->iqloop, buffer_size);
 	if (count < 0)
 		return count;
 	/* rounding down, so we never overfill */
@@ -1071,8 +1878,9 @@ int sdr_get_tosend(void *inst, int buffer_size)
 		/* subtract what we have in write buffer, because this is not jet sent to the SDR */
 		int fill;
 
-		fill = (sdr->thread_write.in - sdr->thread_write.out + sdr->thread_write.buffer_size) % sdr->thread_write.buffer_size;
-		count -= fill / 2;
+		/* gaps of burst mode are not in the buffer, but are not jet sent either */
+		fill = ringbuffer_fill(&sdr->thread_write.ring) + atomic_load(&sdr->thread_write.gap);
+		count -= fill;
 		if (count < 0)
 			count = 0;
 	}
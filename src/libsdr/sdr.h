@@ -7,5 +7,12 @@ void sdr_close(void *inst);
 int sdr_write(void *inst, sample_t **samples, uint8_t **power, int num, enum paging_signal *paging_signal, int *on, int channels);
 int sdr_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db);
 int sdr_get_tosend(void *inst, int buffer_size);
+void sdr_annotate(void *inst, double frequency, double duration, const char *label);
 void calibrate_bias(void);
+extern int sdr_rx_gate_forced;
+struct sender;
+extern void (*sdr_scan_notify)(struct sender *sender, double frequency, int attached, double level_db);
+void sdr_print_stats(void);
+struct sdr_stats *sdr_get_stats(int device, int *samplerate_p);
+int sdr_assign_device(double tx_frequency, double rx_frequency, int samplerate);
 
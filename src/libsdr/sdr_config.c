@@ -24,12 +24,16 @@ enum paging_signal;
 #include <string.h>
 #include <stdint.h>
 #include <errno.h>
+#include <pthread.h>
 #include "../libsample/sample.h"
 #include "../liboptions/options.h"
+#include "../libwave/wave.h"
 #include "sdr.h"
 #include "sdr_config.h"
+#include "wire_format.h"
 
 static int got_init = 0;
+static int got_device_args = 0;
 extern int use_sdr;
 sdr_config_t *sdr_config = NULL;
 
@@ -37,11 +41,16 @@ void sdr_config_init(double lo_offset)
 {
 	sdr_config = calloc(1, sizeof(*sdr_config));
 	memset(sdr_config, 0, sizeof(*sdr_config));
-	sdr_config->device_args = "";
+	sdr_config->device_args[0] = "";
 	sdr_config->stream_args = "";
 	sdr_config->tune_args = "";
 	sdr_config->lo_offset = lo_offset;
 	sdr_config->timestamps = 1;
+	sdr_config->udp_jitter = 20.0;
+	sdr_config->rx_gate_level = -60.0; /* also used when gate is forced by overload */
+	sdr_config->waterfall_rate = 1.0;
+	sdr_config->scan_threshold = 10.0;
+	sdr_config->scan_hold = 2.0;
 
 	got_init = 1;
 }
@@ -58,13 +67,35 @@ void sdr_config_print_help(void)
 	printf("    --sdr-soapy\n");
 	printf("        Force SoapySDR driver\n");
 #endif
-	printf("    --sdr-channel <channel #>\n");
+	printf("    --sdr-shm <name>\n");
+	printf("        Attach to the IQ hub with given shared memory name, instead of opening\n");
+	printf("        an SDR device. The hub owns the device and shares it between processes.\n");
+	printf("        The sample rate must match the hub's rate, see '--sdr-samplerate'.\n");
+	printf("    --sdr-udp <host>:<port>\n");
+	printf("        Connect to the IQ hub at given address, to use its remote SDR device.\n");
+	printf("        Use '--sdr-wire-format cs16' or 'cs8' to reduce network load.\n");
+	printf("    --sdr-udp-compress\n");
+	printf("        Compress integer samples on the network, without loss.\n");
+	printf("    --sdr-udp-jitter <ms>\n");
+	printf("        Delay received samples, to wait for late packets. (default = %.0f)\n", sdr_config->udp_jitter);
+	printf("    --sdr-loopback\n");
+	printf("        Loop transmitted IQ samples back to the receiver in memory, no SDR\n");
+	printf("        hardware is used. Use it with external loopback ('-l 2'), for testing\n");
+	printf("        and benchmarking the DSP.\n");
+	printf("    --sdr-channel <channel #>[,<channel #>[,...]]\n");
 	printf("        Give channel number for multi channel SDR device (default = %d)\n", sdr_config->channel);
+	printf("        With UHD, give a list of channels (up to %d) to stream them together\n", SDR_MAX_DEVICES);
+	printf("        from one device, e.g. both RF chains of a B210. Channels are then\n");
+	printf("        distributed across the RF chains, like with multiple devices.\n");
 	printf("    --sdr-device-args <args>\n");
 	printf("    --sdr-stream-args <args>\n");
 	printf("    --sdr-tune-args <args>\n");
 	printf("        Optional SDR device arguments, separated by comma\n");
 	printf("        e.g. --sdr-device-args <key>=<value>[,<key>=<value>[,...]]\n");
+	printf("        Give --sdr-device-args multiple times (up to %d) to use multiple SDR\n", SDR_MAX_DEVICES);
+	printf("        devices. Channels are distributed across devices, so that each device\n");
+	printf("        covers its channels at its own center frequency. All other SDR options\n");
+	printf("        apply to every device.\n");
 	printf("    --sdr-samplerate <samplerate>\n");
 	printf("        Sample rate to use with SDR. By default it equals the regular sample\n");
 	printf("        rate.\n");
@@ -91,10 +122,91 @@ void sdr_config_print_help(void)
 	printf("        Replace received IQ data by given wave file.\n");
 	printf("    --read-iq-tx-wave <file>\n");
 	printf("        Replace transmitted IQ data by given wave file.\n");
+	printf("    --iq-wave-format pcm16 | float | cs16 | cf32 | iqz\n");
+	printf("        Sample format of IQ files. 'pcm16' and 'float' are WAVE files, 'float'\n");
+	printf("        replays received IQ data bit exact. 'cs16' and 'cf32' are raw files\n");
+	printf("        without header, as used by other SDR tools. WAVE files above 4 GB are\n");
+	printf("        written as RF64. 'iqz' is a lossless compressed 16 bit file with seek\n");
+	printf("        index, it is coded by the file thread. Compressed files are detected\n");
+	printf("        when reading. (default = %s)\n", wave_format_name(sdr_config->iq_wave_format));
+	printf("    --iq-sigmf\n");
+	printf("        Write a SigMF metadata file beside each IQ recording. It contains the\n");
+	printf("        center frequency, gain, start time, the frequency of each channel and\n");
+	printf("        annotations of frames that have been received by the decoders.\n");
 	printf("    --sdr-swap-links\n");
 	printf("        Swap RX and TX frequencies for loopback tests over the air.\n");
 	printf("    --sdr-timestamps 1 | 0\n");
 	printf("        Use TX timestamps on UHD device. (default = %d)\n", sdr_config->timestamps);
+	printf("    --sdr-channelizer rx | tx | both\n");
+	printf("        Split received IQ data into channels (rx) and/or combine transmitted\n");
+	printf("        channels (tx) using a polyphase filter bank, so each channel is\n");
+	printf("        demodulated/modulated at reduced sample rate. This reduces CPU load\n");
+	printf("        when using many channels.\n");
+#ifdef HAVE_OPENCL
+	printf("    --sdr-channelizer-gpu\n");
+	printf("        Run the polyphase filter bank of the channelizer on a GPU (OpenCL).\n");
+	printf("        This helps with wide band capture and many channels. If no device is\n");
+	printf("        found, the CPU is used.\n");
+#endif
+	printf("    --sdr-event-threads\n");
+	printf("        RX thread waits for data from the SDR device and TX thread waits for\n");
+	printf("        data to be transmitted, instead of polling each interval. This reduces\n");
+	printf("        latency and idle CPU load.\n");
+	printf("    --sdr-wire-format cf32 | cs16 | cs8\n");
+	printf("        Sample format of IQ stream between SDR driver and host. Integer\n");
+	printf("        formats are converted to/from float by this software, so the driver\n");
+	printf("        does not need to. With UHD, 'cs8' also halves the bus traffic.\n");
+	printf("        (default = %s)\n", wire_format_name(sdr_config->wire_format));
+#ifdef HAVE_SOAPY
+	printf("    --sdr-direct-buffers\n");
+	printf("        Process IQ samples directly in the DMA buffers of the SoapySDR driver\n");
+	printf("        instead of copying them through the read/write stream calls. If the\n");
+	printf("        driver does not support direct buffer access, samples are copied.\n");
+#endif
+	printf("    --sdr-tx-lead <ms>\n");
+	printf("        Schedule transmitted samples this many milliseconds in advance of the\n");
+	printf("        received time stamp, instead of filling the whole buffer. If the TX\n");
+	printf("        underruns, the lead is increased and slowly reduced again towards the\n");
+	printf("        given value, so the smallest stable TX latency is held. Use together\n");
+	printf("        with --sdr-timestamps 1. (default = 0 = use buffer size)\n");
+	printf("    --sdr-tx-burst\n");
+	printf("        Do not stream samples to the SDR while all channels are switched off,\n");
+	printf("        e.g. if a network transmits only when a call is active. The burst is\n");
+	printf("        ended and the next burst starts at the time stamp where it belongs,\n");
+	printf("        so the timing of the transmitted signal is kept. This requires UHD or\n");
+	printf("        SoapySDR with --sdr-timestamps 1.\n");
+	printf("    --sdr-rx-gate <dB>\n");
+	printf("        Do not demodulate received channels while their RF level is below the\n");
+	printf("        given level (see 'RF Level' in measurements display), e.g. '-60'.\n");
+	printf("        Idle channels get silence instead, which saves CPU load with many\n");
+	printf("        channels. Control channels are always demodulated. AM channels are\n");
+	printf("        not gated.\n");
+	printf("    --sdr-waterfall <file>\n");
+	printf("        Record averaged power spectra of the received IQ stream (first device)\n");
+	printf("        to given file, for later analysis of band usage and interference. The\n");
+	printf("        spectra are computed by a background thread from a short capture of\n");
+	printf("        each line interval, so the DSP path is not loaded. See 'waterfall.c'\n");
+	printf("        for the file format.\n");
+	printf("    --sdr-waterfall-rate <lines per second>\n");
+	printf("        Rate of waterfall lines (default = %.1f)\n", sdr_config->waterfall_rate);
+	printf("    --sdr-iq-correct\n");
+	printf("        Continuously remove DC offset and IQ gain/phase imbalance of received\n");
+	printf("        samples, while they are converted from the wire format. This follows\n");
+	printf("        the drift of cheap SDRs and removes mirror images of carriers on the\n");
+	printf("        other side of the center frequency. The estimates are shown with the\n");
+	printf("        statistics ('t' key) and in the metrics.\n");
+	printf("    --sdr-scan <raster kHz>\n");
+	printf("        Watch the whole received band for carriers on the given channel raster,\n");
+	printf("        e.g. '12.5', instead of receiving fixed frequencies. The configured\n");
+	printf("        channels are a pool of decoder slots: When a carrier appears, a free\n");
+	printf("        slot is tuned to it, and released when the carrier went quiet. The\n");
+	printf("        configured frequencies only define the center of the band. Free slots\n");
+	printf("        are not demodulated. Use this for receive only monitoring, carriers\n");
+	printf("        are written to the frame trace.\n");
+	printf("    --sdr-scan-threshold <dB>\n");
+	printf("        Level of a carrier above the noise floor (default = %.1f)\n", sdr_config->scan_threshold);
+	printf("    --sdr-scan-hold <seconds>\n");
+	printf("        Time a quiet carrier keeps its decoder slot (default = %.1f)\n", sdr_config->scan_hold);
 }
 
 void sdr_config_print_hotkeys(void)
@@ -102,6 +214,7 @@ void sdr_config_print_hotkeys(void)
 	printf("Press 'q' key to toggle display of RX I/Q vector.\n");
 	printf("Press 's' key to toggle display of RX spectrum.\n");
 	printf("Press 'b' key to remove DC level.\n");
+	printf("Press 't' key to show buffer and latency statistics.\n");
 }
 
 #define	OPT_SDR_UHD		1500
@@ -124,6 +237,27 @@ void sdr_config_print_hotkeys(void)
 #define	OPT_READ_IQ_TX_WAVE	1517
 #define	OPT_SDR_SWAP_LINKS	1518
 #define	OPT_SDR_TIMESTAMPS	1519
+#define	OPT_SDR_CHANNELIZER	1520
+#define	OPT_SDR_EVENT_THREADS	1521
+#define	OPT_SDR_WIRE_FORMAT	1522
+#define	OPT_SDR_TX_LEAD		1523
+#define	OPT_IQ_WAVE_FORMAT	1524
+#define	OPT_IQ_SIGMF		1525
+#define	OPT_SDR_SHM		1526
+#define	OPT_SDR_UDP		1527
+#define	OPT_SDR_UDP_COMPRESS	1528
+#define	OPT_SDR_UDP_JITTER	1529
+#define	OPT_SDR_LOOPBACK	1530
+#define	OPT_SDR_DIRECT_BUFFERS	1531
+#define	OPT_SDR_RX_GATE		1532
+#define	OPT_SDR_WATERFALL	1533
+#define	OPT_SDR_WATERFALL_RATE	1534
+#define	OPT_SDR_CHANNELIZER_GPU	1535
+#define	OPT_SDR_IQ_CORRECT	1536
+#define	OPT_SDR_SCAN		1537
+#define	OPT_SDR_SCAN_THRESHOLD	1538
+#define	OPT_SDR_SCAN_HOLD	1539
+#define	OPT_SDR_TX_BURST	1540
 
 void sdr_config_add_options(void)
 {
@@ -147,10 +281,34 @@ void sdr_config_add_options(void)
 	option_add(OPT_READ_IQ_TX_WAVE, "read-iq-tx-wave", 1);
 	option_add(OPT_SDR_SWAP_LINKS, "sdr-swap-links", 0);
 	option_add(OPT_SDR_TIMESTAMPS, "sdr-timestamps", 1);
+	option_add(OPT_SDR_CHANNELIZER, "sdr-channelizer", 1);
+	option_add(OPT_SDR_CHANNELIZER_GPU, "sdr-channelizer-gpu", 0);
+	option_add(OPT_SDR_EVENT_THREADS, "sdr-event-threads", 0);
+	option_add(OPT_SDR_WIRE_FORMAT, "sdr-wire-format", 1);
+	option_add(OPT_SDR_DIRECT_BUFFERS, "sdr-direct-buffers", 0);
+	option_add(OPT_SDR_TX_LEAD, "sdr-tx-lead", 1);
+	option_add(OPT_SDR_TX_BURST, "sdr-tx-burst", 0);
+	option_add(OPT_SDR_RX_GATE, "sdr-rx-gate", 1);
+	option_add(OPT_SDR_WATERFALL, "sdr-waterfall", 1);
+	option_add(OPT_SDR_WATERFALL_RATE, "sdr-waterfall-rate", 1);
+	option_add(OPT_SDR_IQ_CORRECT, "sdr-iq-correct", 0);
+	option_add(OPT_SDR_SCAN, "sdr-scan", 1);
+	option_add(OPT_SDR_SCAN_THRESHOLD, "sdr-scan-threshold", 1);
+	option_add(OPT_SDR_SCAN_HOLD, "sdr-scan-hold", 1);
+	option_add(OPT_IQ_WAVE_FORMAT, "iq-wave-format", 1);
+	option_add(OPT_IQ_SIGMF, "iq-sigmf", 0);
+	option_add(OPT_SDR_SHM, "sdr-shm", 1);
+	option_add(OPT_SDR_UDP, "sdr-udp", 1);
+	option_add(OPT_SDR_UDP_COMPRESS, "sdr-udp-compress", 0);
+	option_add(OPT_SDR_UDP_JITTER, "sdr-udp-jitter", 1);
+	option_add(OPT_SDR_LOOPBACK, "sdr-loopback", 0);
 }
 
 int sdr_config_handle_options(int short_option, int argi, char **argv)
 {
+	char *p;
+	int i;
+
 	switch (short_option) {
 	case OPT_SDR_UHD:
 #ifdef HAVE_UHD
@@ -171,10 +329,45 @@ int sdr_config_handle_options(int short_option, int argi, char **argv)
 #endif
 		break;
 	case OPT_SDR_CHANNEL:
-		sdr_config->channel = atoi(argv[argi]);
+		p = argv[argi];
+		sdr_config->num_channels = 0;
+		do {
+			if (sdr_config->num_channels == SDR_MAX_DEVICES) {
+				fprintf(stderr, "Too many SDR channels given, only %d are supported.\n", SDR_MAX_DEVICES);
+				return -EINVAL;
+			}
+			sdr_config->channels[sdr_config->num_channels++] = strtol(p, &p, 10);
+		} while (*p++ == ',');
+		sdr_config->channel = sdr_config->channels[0];
+		/* each channel of a list is used like a device of its own */
+		if (sdr_config->num_channels > 1) {
+			if (got_device_args > 1) {
+				fprintf(stderr, "A list of SDR channels cannot be used with multiple SDR devices.\n");
+				return -EINVAL;
+			}
+			for (i = 1; i < sdr_config->num_channels; i++)
+				sdr_config->device_args[i] = sdr_config->device_args[0];
+			sdr_config->devices = sdr_config->num_channels;
+			sdr_config->mimo = 1;
+		}
 		break;
 	case OPT_SDR_DEVICE_ARGS:
-		sdr_config->device_args = options_strdup(argv[argi]);
+		if (sdr_config->mimo) {
+			if (got_device_args++) {
+				fprintf(stderr, "A list of SDR channels cannot be used with multiple SDR devices.\n");
+				return -EINVAL;
+			}
+			sdr_config->device_args[0] = options_strdup(argv[argi]);
+			for (i = 1; i < sdr_config->devices; i++)
+				sdr_config->device_args[i] = sdr_config->device_args[0];
+			break;
+		}
+		got_device_args++;
+		if (sdr_config->devices == SDR_MAX_DEVICES) {
+			fprintf(stderr, "Too many SDR devices given, only %d are supported.\n", SDR_MAX_DEVICES);
+			return -EINVAL;
+		}
+		sdr_config->device_args[sdr_config->devices++] = options_strdup(argv[argi]);
 		break;
 	case OPT_SDR_STREAM_ARGS:
 		sdr_config->stream_args = options_strdup(argv[argi]);
@@ -224,6 +417,110 @@ int sdr_config_handle_options(int short_option, int argi, char **argv)
 	case OPT_SDR_TIMESTAMPS:
 		sdr_config->timestamps = atoi(argv[argi]);
 		break;
+	case OPT_SDR_CHANNELIZER:
+		if (!strcmp(argv[argi], "rx"))
+			sdr_config->channelizer = SDR_CHANNELIZER_RX;
+		else if (!strcmp(argv[argi], "tx"))
+			sdr_config->channelizer = SDR_CHANNELIZER_TX;
+		else if (!strcmp(argv[argi], "both"))
+			sdr_config->channelizer = SDR_CHANNELIZER_RX | SDR_CHANNELIZER_TX;
+		else {
+			fprintf(stderr, "Invalid channelizer direction '%s', use 'rx', 'tx' or 'both'.\n", argv[argi]);
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_CHANNELIZER_GPU:
+		sdr_config->channelizer_gpu = 1;
+		break;
+	case OPT_SDR_IQ_CORRECT:
+		sdr_config->iq_correct = 1;
+		break;
+	case OPT_SDR_SCAN:
+		sdr_config->scan_raster = atof(argv[argi]) * 1e3;
+		if (sdr_config->scan_raster <= 0.0) {
+			fprintf(stderr, "Scan raster must be greater than 0.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_SCAN_THRESHOLD:
+		sdr_config->scan_threshold = atof(argv[argi]);
+		break;
+	case OPT_SDR_SCAN_HOLD:
+		sdr_config->scan_hold = atof(argv[argi]);
+		if (sdr_config->scan_hold < 0.0) {
+			fprintf(stderr, "Scan hold time must not be negative.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_EVENT_THREADS:
+		sdr_config->event_threads = 1;
+		break;
+	case OPT_SDR_WIRE_FORMAT:
+		sdr_config->wire_format = wire_format_parse(argv[argi]);
+		if (sdr_config->wire_format < 0) {
+			fprintf(stderr, "Invalid wire format '%s', use 'cf32', 'cs16' or 'cs8'.\n", argv[argi]);
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_DIRECT_BUFFERS:
+		sdr_config->direct_buffers = 1;
+		break;
+	case OPT_IQ_WAVE_FORMAT:
+		sdr_config->iq_wave_format = wave_format_parse(argv[argi]);
+		if (sdr_config->iq_wave_format < 0) {
+			fprintf(stderr, "Invalid IQ wave format '%s', use 'pcm16', 'float', 'cs16', 'cf32' or 'iqz'.\n", argv[argi]);
+			return -EINVAL;
+		}
+		break;
+	case OPT_IQ_SIGMF:
+		sdr_config->iq_sigmf = 1;
+		break;
+	case OPT_SDR_RX_GATE:
+		sdr_config->rx_gate = 1;
+		sdr_config->rx_gate_level = atof(argv[argi]);
+		break;
+	case OPT_SDR_WATERFALL:
+		sdr_config->waterfall = options_strdup(argv[argi]);
+		break;
+	case OPT_SDR_WATERFALL_RATE:
+		sdr_config->waterfall_rate = atof(argv[argi]);
+		if (sdr_config->waterfall_rate <= 0.0) {
+			fprintf(stderr, "Waterfall rate must be greater than 0.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_TX_LEAD:
+		sdr_config->tx_lead = atof(argv[argi]);
+		if (sdr_config->tx_lead < 0) {
+			fprintf(stderr, "TX lead must not be negative.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_TX_BURST:
+		sdr_config->tx_burst = 1;
+		break;
+	case OPT_SDR_SHM:
+		sdr_config->shm = options_strdup(argv[argi]);
+		use_sdr = 1;
+		break;
+	case OPT_SDR_UDP:
+		sdr_config->udp = options_strdup(argv[argi]);
+		use_sdr = 1;
+		break;
+	case OPT_SDR_UDP_COMPRESS:
+		sdr_config->udp_compress = 1;
+		break;
+	case OPT_SDR_UDP_JITTER:
+		sdr_config->udp_jitter = atof(argv[argi]);
+		if (sdr_config->udp_jitter < 0) {
+			fprintf(stderr, "Jitter delay must not be negative.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_SDR_LOOPBACK:
+		sdr_config->loopback = 1;
+		use_sdr = 1;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -239,14 +536,19 @@ int sdr_configure(int samplerate)
 	}
 
 	/* no sdr selected -> return 0 */
-	if (!sdr_config->uhd && !sdr_config->soapy)
+	if (!sdr_config->uhd && !sdr_config->soapy && !sdr_config->shm && !sdr_config->udp && !sdr_config->loopback)
 		return 0;
 
-	if ((sdr_config->uhd == 1 && sdr_config->soapy == 1)) {
-		fprintf(stderr, "You must choose which one you want: --sdr-uhd or --sdr-soapy\n");
+	if (sdr_config->uhd + sdr_config->soapy + !!sdr_config->shm + !!sdr_config->udp + sdr_config->loopback > 1) {
+		fprintf(stderr, "You must choose which one you want: --sdr-uhd, --sdr-soapy, --sdr-shm, --sdr-udp or --sdr-loopback\n");
 		exit(0);
 	}
 
+	if (sdr_config->mimo && !sdr_config->uhd) {
+		fprintf(stderr, "A list of SDR channels is only supported with UHD.\n");
+		return -EINVAL;
+	}
+
 	if (sdr_config->samplerate == 0)
 		sdr_config->samplerate = samplerate;
 	if (sdr_config->bandwidth == 0.0)
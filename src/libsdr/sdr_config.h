@@ -1,10 +1,24 @@
 
+#define SDR_MAX_DEVICES		8
+
+#define SDR_CHANNELIZER_RX	1
+#define SDR_CHANNELIZER_TX	2
+
 typedef struct sdr_config {
 	int		uhd,			/* select UHD API */
 			soapy;			/* select Soapy SDR API */
+	const char	*shm;			/* attach to IQ hub with this shared memory name */
+	const char	*udp;			/* connect to IQ hub at this address */
+	int		udp_compress;		/* compress samples on the network */
+	double		udp_jitter;		/* delay (ms) of network jitter buffer */
+	int		loopback;		/* loop TX back to RX in memory */
 	int		channel;		/* channel number */
-	const char	*device_args,		/* arguments */
-			*stream_args,
+	int		channels[SDR_MAX_DEVICES]; /* channels of a MIMO stream */
+	int		num_channels;
+	int		mimo;			/* each channel of the device is used like a device of its own */
+	const char	*device_args[SDR_MAX_DEVICES]; /* arguments of each device */
+	int		devices;		/* number of devices */
+	const char	*stream_args,
 			*tune_args;
 	int		samplerate;		/* ADC/DAC sample rate */
 	double		lo_offset;		/* LO frequency offset */
@@ -20,8 +34,26 @@ typedef struct sdr_config {
 	const char	*read_iq_rx_wave;
 	int		swap_links;		/* swap DL and UL frequency */
 	int		timestamps;		/* use time stamps when transmitting */
+	int		channelizer;		/* use polyphase filter bank to split RX / combine TX channels */
+	int		channelizer_gpu;	/* run polyphase filter bank on OpenCL device */
+	int		event_threads;		/* threads wait for data instead of polling */
+	int		wire_format;		/* sample format of IQ stream (SDR_WIRE_*) */
+	int		direct_buffers;		/* access DMA buffers of SoapySDR driver */
+	int		iq_wave_format;		/* sample format of IQ files (WAVE_FORMAT_*) */
+	int		iq_sigmf;		/* write SigMF metadata of IQ recordings */
+	double		tx_lead;		/* target time (ms) that TX is in advance of RX (0 = buffer size) */
+	int		tx_burst;		/* suspend TX stream while all channels are off */
+	int		rx_gate;		/* do not demodulate idle channels */
+	double		rx_gate_level;		/* RF level (dB) of channel activity */
+	const char	*waterfall;		/* file to record spectrum waterfall */
+	double		waterfall_rate;		/* lines of waterfall per second */
+	int		iq_correct;		/* track DC offset and IQ imbalance of RX */
+	double		scan_raster;		/* watch band for carriers on this raster, channels are decoder slots (0 = off) */
+	double		scan_threshold;		/* level (dB) of carrier above noise floor */
+	double		scan_hold;		/* time (s) a quiet carrier keeps its decoder slot */
 } sdr_config_t;
 
+/* set by command line options before the SDR opens, read-only afterwards */
 extern sdr_config_t *sdr_config;
 
 void sdr_config_init(double lo_offset);
@@ -0,0 +1,129 @@
+/* Buffer and latency statistics of SDR path
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The counters are written by the thread that owns the direction (RX thread
+ * for driver calls of RX, main thread for fill levels, ...) and are read when
+ * statistics are printed. Reading is not locked, so printed values may be
+ * slightly inconsistent, which is acceptable for statistics.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../liblogging/logging.h"
+#include "sdr_stats.h"
+
+/* monotonic time in seconds */
+double sdr_stats_time(void)
+{
+	struct timespec tv;
+
+	clock_gettime(CLOCK_MONOTONIC, &tv);
+
+	return (double)tv.tv_sec + (double)tv.tv_nsec / 1000000000.0;
+}
+
+void sdr_stats_init(sdr_stats_t *stats, int rx_size, int tx_size)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->start = sdr_stats_time();
+	stats->rx.size = rx_size;
+	stats->tx.size = tx_size;
+}
+
+/* record fill level of buffer */
+void sdr_stats_fill(sdr_stats_dir_t *dir, int fill)
+{
+	int bin;
+
+	if (dir->size <= 0)
+		return;
+	bin = fill * SDR_STATS_FILL_BINS / dir->size;
+	if (bin >= SDR_STATS_FILL_BINS)
+		bin = SDR_STATS_FILL_BINS - 1;
+	if (bin < 0)
+		bin = 0;
+	dir->fill_hist[bin]++;
+	if (fill > dir->fill_max)
+		dir->fill_max = fill;
+}
+
+/* record overflow / underrun */
+void sdr_stats_event(sdr_stats_dir_t *dir)
+{
+	double now = sdr_stats_time();
+
+	if (!dir->events)
+		dir->first_event = now;
+	dir->last_event = now;
+	dir->events++;
+}
+
+/* record duration of a driver call that started at given time */
+void sdr_stats_call(sdr_stats_dir_t *dir, double start)
+{
+	double duration = sdr_stats_time() - start;
+
+	dir->calls++;
+	dir->call_time += duration;
+	if (duration > dir->call_max)
+		dir->call_max = duration;
+}
+
+/* record time between receiving and demodulating */
+void sdr_stats_latency(sdr_stats_t *stats, double latency)
+{
+	stats->latency_count++;
+	stats->latency_sum += latency;
+	if (latency > stats->latency_max)
+		stats->latency_max = latency;
+}
+
+static void print_dir(const char *name, sdr_stats_dir_t *dir, const char *event, double now, int samplerate)
+{
+	uint64_t total = 0;
+	char hist[128];
+	int i, pos = 0;
+
+	for (i = 0; i < SDR_STATS_FILL_BINS; i++)
+		total += dir->fill_hist[i];
+	for (i = 0; i < SDR_STATS_FILL_BINS; i++)
+		pos += snprintf(hist + pos, sizeof(hist) - pos, " %3.0f", (total) ? (double)dir->fill_hist[i] * 100.0 / (double)total : 0.0);
+	LOGP(DSDR, LOGL_NOTICE, " %s buffer: size %.1f ms, max fill %.1f ms\n", name, (double)dir->size / (double)samplerate * 1000.0, (double)dir->fill_max / (double)samplerate * 1000.0);
+	LOGP(DSDR, LOGL_NOTICE, " %s fill histogram (%% of time at 0..100%% fill):%s\n", name, hist);
+	if (dir->events)
+		LOGP(DSDR, LOGL_NOTICE, " %s %s: %llu, first %.1f s ago, last %.1f s ago\n", name, event, (unsigned long long)dir->events, now - dir->first_event, now - dir->last_event);
+	else
+		LOGP(DSDR, LOGL_NOTICE, " %s %s: none\n", name, event);
+	if (dir->calls)
+		LOGP(DSDR, LOGL_NOTICE, " %s driver calls: %llu, average %.3f ms, max %.3f ms\n", name, (unsigned long long)dir->calls, dir->call_time / (double)dir->calls * 1000.0, dir->call_max * 1000.0);
+}
+
+void sdr_stats_print(sdr_stats_t *stats, int device, int samplerate)
+{
+	double now = sdr_stats_time();
+
+	LOGP(DSDR, LOGL_NOTICE, "SDR device #%d statistics of last %.1f s:\n", device + 1, now - stats->start);
+	print_dir("RX", &stats->rx, "overflows", now, samplerate);
+	print_dir("TX", &stats->tx, "underruns", now, samplerate);
+	if (stats->latency_count)
+		LOGP(DSDR, LOGL_NOTICE, " RX latency until demodulation: average %.1f ms, max %.1f ms\n", stats->latency_sum / (double)stats->latency_count * 1000.0, stats->latency_max * 1000.0);
+	if (stats->iq_correct && stats->iq_correct->valid)
+		LOGP(DSDR, LOGL_NOTICE, " RX DC offset: I %.5f, Q %.5f, IQ imbalance: gain %.2f dB, phase %.2f deg\n", stats->iq_correct->dc_I, stats->iq_correct->dc_Q, stats->iq_correct->gain_db, stats->iq_correct->phase_deg);
+}
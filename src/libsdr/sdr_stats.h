@@ -0,0 +1,40 @@
+#ifndef _SDR_STATS_H
+#define _SDR_STATS_H
+
+#include <stdint.h>
+#include "iq_correct.h"
+
+/* number of bins for fill level histogram (each 10 % of buffer) */
+#define SDR_STATS_FILL_BINS	10
+
+/* statistics of one direction (RX or TX) */
+typedef struct sdr_stats_dir {
+	uint64_t	fill_hist[SDR_STATS_FILL_BINS]; /* histogram of buffer fill level */
+	int		fill_max;	/* highest fill level in samples */
+	int		size;		/* size of buffer in samples */
+	uint64_t	events;		/* number of overflows (RX) or underruns (TX) */
+	double		first_event;	/* time of first and last event */
+	double		last_event;
+	uint64_t	calls;		/* number of driver calls */
+	double		call_time;	/* total duration of driver calls */
+	double		call_max;	/* longest driver call */
+} sdr_stats_dir_t;
+
+typedef struct sdr_stats {
+	double		start;		/* time when statistics were started */
+	sdr_stats_dir_t	rx, tx;
+	uint64_t	latency_count;	/* number of RX latency measurements */
+	double		latency_sum;	/* RX latency until demodulation */
+	double		latency_max;
+	const iq_correct_t *iq_correct;	/* estimates of DC offset and IQ imbalance, if corrected */
+} sdr_stats_t;
+
+double sdr_stats_time(void);
+void sdr_stats_init(sdr_stats_t *stats, int rx_size, int tx_size);
+void sdr_stats_fill(sdr_stats_dir_t *dir, int fill);
+void sdr_stats_event(sdr_stats_dir_t *dir);
+void sdr_stats_call(sdr_stats_dir_t *dir, double start);
+void sdr_stats_latency(sdr_stats_t *stats, double latency);
+void sdr_stats_print(sdr_stats_t *stats, int device, int samplerate);
+
+#endif /* _SDR_STATS_H */
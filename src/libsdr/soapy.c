@@ -45,23 +45,25 @@
 #include <SoapySDR/Device.h>
 #include <SoapySDR/Formats.h>
 #include "soapy.h"
+#include "wire_format.h"
 #include "../liblogging/logging.h"
 #include "../liboptions/options.h"
 
 extern int sdr_rx_overflow;
+extern int sdr_tx_underrun;
 
-static SoapySDRDevice *sdr = NULL;
-SoapySDRStream *rxStream = NULL;
-SoapySDRStream *txStream = NULL;
-static int			tx_samps_per_buff, rx_samps_per_buff;
-static double			samplerate;
-static pthread_mutex_t		timestamp_mutex;
-static int			use_time_stamps;
-static int			rx_valid = 0;
-static long long		rx_timeNs = 0;
-static int			tx_valid = 0;
-static long long		tx_timeNs = 0;
-static long long		Ns_per_sample;
+/* get host format of streamer */
+static const char *stream_format(soapy_t *soapy)
+{
+	switch (soapy->wire_format) {
+	case SDR_WIRE_CS16:
+		return SOAPY_SDR_CS16;
+	case SDR_WIRE_CS8:
+		return SOAPY_SDR_CS8;
+	default:
+		return SOAPY_SDR_CF32;
+	}
+}
 
 static int parse_args(SoapySDRKwargs *args, const char *_args_string)
 {
@@ -73,7 +75,6 @@ static int parse_args(SoapySDRKwargs *args, const char *_args_string)
 		val = strchr(key, '=');
 		if (!val) {
 			LOGP(DSOAPY, LOGL_ERROR, "Error parsing SDR args: No '=' after key\n");
-			soapy_close();
 			return -EIO;
 		}
 		*val++ = '\0';
@@ -87,7 +88,7 @@ static int parse_args(SoapySDRKwargs *args, const char *_args_string)
 	return 0;
 }
 
-int soapy_open(size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps)
+int soapy_open(soapy_t *soapy, size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps, int _wire_format, int direct_buffers)
 {
 	double got_frequency, got_rate, got_gain, got_bandwidth;
 	const char *got_antenna, *got_clock;
@@ -97,13 +98,15 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 	SoapySDRKwargs tune_args;
 	int rc;
 
-	use_time_stamps = timestamps;
-	if (use_time_stamps && (1000000000LL % (long long)rate)) {
+	memset(soapy, 0, sizeof(*soapy));
+	soapy->use_time_stamps = timestamps;
+	soapy->wire_format = _wire_format;
+	if (soapy->use_time_stamps && (1000000000LL % (long long)rate)) {
 		LOGP(DSOAPY, LOGL_ERROR, "The given sample duration is not a multiple of a nano second. I.e. we can't divide 10^9 by sample rate of %.0f. Please choose a different sample rate for time stamp support!\n", rate);
-		use_time_stamps = 0;
+		soapy->use_time_stamps = 0;
 	}
-	Ns_per_sample = 1000000000LL / (long long)rate;
-	samplerate = rate;
+	soapy->Ns_per_sample = 1000000000LL / (long long)rate;
+	soapy->samplerate = rate;
 
 	/* parsing ARGS */
 	LOGP(DSOAPY, LOGL_INFO, "Using device args \"%s\"\n", _device_args);
@@ -127,10 +130,10 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 	}
 
 	/* create SoapySDR device */
-	sdr = SoapySDRDevice_make(&device_args);
-	if (!sdr) {
+	soapy->sdr = SoapySDRDevice_make(&device_args);
+	if (!soapy->sdr) {
 		LOGP(DSOAPY, LOGL_ERROR, "Failed to create SoapySDR\n");
-		soapy_close();
+		soapy_close(soapy);
 		return -EIO;
 	}
 
@@ -140,43 +143,43 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 			char **clocks;
 			size_t clocks_length;
 			int i;
-			clocks = SoapySDRDevice_listClockSources(sdr, &clocks_length);
+			clocks = SoapySDRDevice_listClockSources(soapy->sdr, &clocks_length);
 			if (!clocks) {
 				LOGP(DSOAPY, LOGL_ERROR, "Failed to request list of clock sources!\n");
-				soapy_close();
+				soapy_close(soapy);
 				return -EIO;
 			}
 			if (clocks_length) {
 				for (i = 0; i < (int)clocks_length; i++)
 					LOGP(DSOAPY, LOGL_NOTICE, "Clock source: '%s'\n", clocks[i]);
-				got_clock = SoapySDRDevice_getClockSource(sdr);
+				got_clock = SoapySDRDevice_getClockSource(soapy->sdr);
 				LOGP(DSOAPY, LOGL_NOTICE, "Default clock source: '%s'\n", got_clock);
 			} else
 				LOGP(DSOAPY, LOGL_NOTICE, "There are no clock sources configurable for this device.\n");
-			soapy_close();
+			soapy_close(soapy);
 			return 1;
 		}
 
-		if (SoapySDRDevice_setClockSource(sdr, clock_source) != 0) {
+		if (SoapySDRDevice_setClockSource(soapy->sdr, clock_source) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set clock source to '%s'\n", clock_source);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
-		got_clock = SoapySDRDevice_getClockSource(sdr);
+		got_clock = SoapySDRDevice_getClockSource(soapy->sdr);
 		if (!!strcasecmp(clock_source, got_clock)) {
 			LOGP(DSOAPY, LOGL_NOTICE, "Given clock source '%s' was accepted, but driver claims to use '%s'\n", clock_source, got_clock);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 	}
 
 	if (rx_frequency) {
 		/* get number of channels and check if requested channel is in range */
-		num_channels = SoapySDRDevice_getNumChannels(sdr, SOAPY_SDR_RX);
+		num_channels = SoapySDRDevice_getNumChannels(soapy->sdr, SOAPY_SDR_RX);
 		LOGP(DSOAPY, LOGL_DEBUG, "We have %d RX channel, selecting channel #%d\n", (int)num_channels, (int)channel);
 		if (channel >= num_channels) {
 			LOGP(DSOAPY, LOGL_ERROR, "Requested channel #%d (capable of RX) does not exist. Please select channel %d..%d!\n", (int)channel, 0, (int)num_channels - 1);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
@@ -186,58 +189,58 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 				char **antennas;
 				size_t antennas_length;
 				int i;
-				antennas = SoapySDRDevice_listAntennas(sdr, SOAPY_SDR_RX, channel, &antennas_length);
+				antennas = SoapySDRDevice_listAntennas(soapy->sdr, SOAPY_SDR_RX, channel, &antennas_length);
 				if (!antennas) {
 					LOGP(DSOAPY, LOGL_ERROR, "Failed to request list of RX antennas!\n");
-					soapy_close();
+					soapy_close(soapy);
 					return -EIO;
 				}
 				for (i = 0; i < (int)antennas_length; i++)
 					LOGP(DSOAPY, LOGL_NOTICE, "RX Antenna: '%s'\n", antennas[i]);
-				got_antenna = SoapySDRDevice_getAntenna(sdr, SOAPY_SDR_RX, channel);
+				got_antenna = SoapySDRDevice_getAntenna(soapy->sdr, SOAPY_SDR_RX, channel);
 				LOGP(DSOAPY, LOGL_NOTICE, "Default RX Antenna: '%s'\n", got_antenna);
-				soapy_close();
+				soapy_close(soapy);
 				return 1;
 			}
 
-			if (SoapySDRDevice_setAntenna(sdr, SOAPY_SDR_RX, channel, rx_antenna) != 0) {
+			if (SoapySDRDevice_setAntenna(soapy->sdr, SOAPY_SDR_RX, channel, rx_antenna) != 0) {
 				LOGP(DSOAPY, LOGL_ERROR, "Failed to set RX antenna to '%s'\n", rx_antenna);
-				soapy_close();
+				soapy_close(soapy);
 				return -EIO;
 			}
-			got_antenna = SoapySDRDevice_getAntenna(sdr, SOAPY_SDR_RX, channel);
+			got_antenna = SoapySDRDevice_getAntenna(soapy->sdr, SOAPY_SDR_RX, channel);
 			if (!!strcasecmp(rx_antenna, got_antenna)) {
 				LOGP(DSOAPY, LOGL_NOTICE, "Given RX antenna '%s' was accepted, but driver claims to use '%s'\n", rx_antenna, got_antenna);
-				soapy_close();
+				soapy_close(soapy);
 				return -EINVAL;
 			}
 		}
 
 		/* set rate */
-		if (SoapySDRDevice_setSampleRate(sdr, SOAPY_SDR_RX, channel, rate) != 0) {
+		if (SoapySDRDevice_setSampleRate(soapy->sdr, SOAPY_SDR_RX, channel, rate) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set RX rate to %.0f Hz\n", rate);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* see what rate actually is */
-		got_rate = SoapySDRDevice_getSampleRate(sdr, SOAPY_SDR_RX, channel);
+		got_rate = SoapySDRDevice_getSampleRate(soapy->sdr, SOAPY_SDR_RX, channel);
 		if (fabs(got_rate - rate) > 1.0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Given RX rate %.3f Hz is not supported, try %.3f Hz\n", rate, got_rate);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 
 		if (rx_gain) {
 			/* set gain */
-			if (SoapySDRDevice_setGain(sdr, SOAPY_SDR_RX, channel, rx_gain) != 0) {
+			if (SoapySDRDevice_setGain(soapy->sdr, SOAPY_SDR_RX, channel, rx_gain) != 0) {
 				LOGP(DSOAPY, LOGL_ERROR, "Failed to set RX gain to %.0f\n", rx_gain);
-				soapy_close();
+				soapy_close(soapy);
 				return -EIO;
 			}
 
 			/* see what gain actually is */
-			got_gain = SoapySDRDevice_getGain(sdr, SOAPY_SDR_RX, channel);
+			got_gain = SoapySDRDevice_getGain(soapy->sdr, SOAPY_SDR_RX, channel);
 			if (fabs(got_gain - rx_gain) > 0.001) {
 				LOGP(DSOAPY, LOGL_NOTICE, "Given RX gain %.3f is not supported, we use %.3f\n", rx_gain, got_gain);
 				rx_gain = got_gain;
@@ -249,63 +252,88 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 			rx_frequency += 1.0;
 
 		/* set frequency */
-		if (SoapySDRDevice_setFrequency(sdr, SOAPY_SDR_RX, channel, rx_frequency, &tune_args) != 0) {
+		if (SoapySDRDevice_setFrequency(soapy->sdr, SOAPY_SDR_RX, channel, rx_frequency, &tune_args) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set RX frequency to %.0f Hz\n", rx_frequency);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* see what frequency actually is */
-		got_frequency = SoapySDRDevice_getFrequency(sdr, SOAPY_SDR_RX, channel);
+		got_frequency = SoapySDRDevice_getFrequency(soapy->sdr, SOAPY_SDR_RX, channel);
 		if (fabs(got_frequency - rx_frequency) > 100.0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Given RX frequency %.0f Hz is not supported, try %.0f Hz\n", rx_frequency, got_frequency);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 
 		/* set bandwidth */
-		if (SoapySDRDevice_setBandwidth(sdr, SOAPY_SDR_RX, channel, bandwidth) != 0) {
+		if (SoapySDRDevice_setBandwidth(soapy->sdr, SOAPY_SDR_RX, channel, bandwidth) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set RX bandwidth to %.0f Hz\n", bandwidth);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* see what bandwidth actually is */
-		got_bandwidth = SoapySDRDevice_getBandwidth(sdr, SOAPY_SDR_RX, channel);
+		got_bandwidth = SoapySDRDevice_getBandwidth(soapy->sdr, SOAPY_SDR_RX, channel);
 		if (fabs(got_bandwidth - bandwidth) > 100.0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Given RX bandwidth %.0f Hz is not supported, try %.0f Hz\n", bandwidth, got_bandwidth);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 
 		/* set up streamer */
 #ifdef SOAPY_0_8_0_OR_HIGHER
-		if (!(rxStream = SoapySDRDevice_setupStream(sdr, SOAPY_SDR_RX, SOAPY_SDR_CF32, &channel, 1, &stream_args)))
+		if (!(soapy->rxStream = SoapySDRDevice_setupStream(soapy->sdr, SOAPY_SDR_RX, stream_format(soapy), &channel, 1, &stream_args)))
 #else
-		if (SoapySDRDevice_setupStream(sdr, &rxStream, SOAPY_SDR_RX, SOAPY_SDR_CF32, &channel, 1, &stream_args) != 0)
+		if (SoapySDRDevice_setupStream(soapy->sdr, &soapy->rxStream, SOAPY_SDR_RX, stream_format(soapy), &channel, 1, &stream_args) != 0)
 #endif
 		{
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set RX streamer args\n");
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* get buffer sizes */
-		rx_samps_per_buff = SoapySDRDevice_getStreamMTU(sdr, rxStream);
-		if (rx_samps_per_buff == 0) {
+		soapy->rx_samps_per_buff = SoapySDRDevice_getStreamMTU(soapy->sdr, soapy->rxStream);
+		if (soapy->rx_samps_per_buff == 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to get RX streamer sample buffer\n");
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
+		if (soapy->wire_format != SDR_WIRE_CF32) {
+			soapy->rx_wire_buff = malloc(soapy->rx_samps_per_buff * wire_format_size(soapy->wire_format));
+			if (!soapy->rx_wire_buff) {
+				LOGP(DSOAPY, LOGL_ERROR, "No mem!\n");
+				soapy_close(soapy);
+				return -ENOMEM;
+			}
+		}
+
+		if (direct_buffers) {
+			if (SoapySDRDevice_getNumDirectAccessBuffers(soapy->sdr, soapy->rxStream) > 0) {
+				LOGP(DSOAPY, LOGL_INFO, "Using direct access to RX buffers of driver.\n");
+				soapy->direct_rx = 1;
+			} else
+				LOGP(DSOAPY, LOGL_NOTICE, "Driver does not support direct access to RX buffers, copying samples.\n");
+		}
+		/* integer samples are converted from the DMA buffer */
+		if (soapy->direct_rx && soapy->wire_format != SDR_WIRE_CF32) {
+			soapy->rx_direct_buff = malloc(soapy->rx_samps_per_buff * 2 * sizeof(float));
+			if (!soapy->rx_direct_buff) {
+				LOGP(DSOAPY, LOGL_ERROR, "No mem!\n");
+				soapy_close(soapy);
+				return -ENOMEM;
+			}
+		}
 	}
 
 	if (tx_frequency) {
 		/* get number of channels and check if requested channel is in range */
-		num_channels = SoapySDRDevice_getNumChannels(sdr, SOAPY_SDR_TX);
+		num_channels = SoapySDRDevice_getNumChannels(soapy->sdr, SOAPY_SDR_TX);
 		LOGP(DSOAPY, LOGL_DEBUG, "We have %d TX channel, selecting channel #%d\n", (int)num_channels, (int)channel);
 		if (channel >= num_channels) {
 			LOGP(DSOAPY, LOGL_ERROR, "Requested channel #%d (capable of TX) does not exist. Please select channel %d..%d!\n", (int)channel, 0, (int)num_channels - 1);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
@@ -315,58 +343,58 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 				char **antennas;
 				size_t antennas_length;
 				int i;
-				antennas = SoapySDRDevice_listAntennas(sdr, SOAPY_SDR_TX, channel, &antennas_length);
+				antennas = SoapySDRDevice_listAntennas(soapy->sdr, SOAPY_SDR_TX, channel, &antennas_length);
 				if (!antennas) {
 					LOGP(DSOAPY, LOGL_ERROR, "Failed to request list of TX antennas!\n");
-					soapy_close();
+					soapy_close(soapy);
 					return -EIO;
 				}
 				for (i = 0; i < (int)antennas_length; i++)
 					LOGP(DSOAPY, LOGL_NOTICE, "TX Antenna: '%s'\n", antennas[i]);
-				got_antenna = SoapySDRDevice_getAntenna(sdr, SOAPY_SDR_TX, channel);
+				got_antenna = SoapySDRDevice_getAntenna(soapy->sdr, SOAPY_SDR_TX, channel);
 				LOGP(DSOAPY, LOGL_NOTICE, "Default TX Antenna: '%s'\n", got_antenna);
-				soapy_close();
+				soapy_close(soapy);
 				return 1;
 			}
 
-			if (SoapySDRDevice_setAntenna(sdr, SOAPY_SDR_TX, channel, tx_antenna) != 0) {
+			if (SoapySDRDevice_setAntenna(soapy->sdr, SOAPY_SDR_TX, channel, tx_antenna) != 0) {
 				LOGP(DSOAPY, LOGL_ERROR, "Failed to set TX antenna to '%s'\n", tx_antenna);
-				soapy_close();
+				soapy_close(soapy);
 				return -EIO;
 			}
-			got_antenna = SoapySDRDevice_getAntenna(sdr, SOAPY_SDR_TX, channel);
+			got_antenna = SoapySDRDevice_getAntenna(soapy->sdr, SOAPY_SDR_TX, channel);
 			if (!!strcasecmp(tx_antenna, got_antenna)) {
 				LOGP(DSOAPY, LOGL_NOTICE, "Given TX antenna '%s' was accepted, but driver claims to use '%s'\n", tx_antenna, got_antenna);
-				soapy_close();
+				soapy_close(soapy);
 				return -EINVAL;
 			}
 		}
 
 		/* set rate */
-		if (SoapySDRDevice_setSampleRate(sdr, SOAPY_SDR_TX, channel, rate) != 0) {
+		if (SoapySDRDevice_setSampleRate(soapy->sdr, SOAPY_SDR_TX, channel, rate) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set TX rate to %.0f Hz\n", rate);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* see what rate actually is */
-		got_rate = SoapySDRDevice_getSampleRate(sdr, SOAPY_SDR_TX, channel);
+		got_rate = SoapySDRDevice_getSampleRate(soapy->sdr, SOAPY_SDR_TX, channel);
 		if (fabs(got_rate - rate) > 1.0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Given TX rate %.3f Hz is not supported, try %.3f Hz\n", rate, got_rate);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 
 		if (tx_gain) {
 			/* set gain */
-			if (SoapySDRDevice_setGain(sdr, SOAPY_SDR_TX, channel, tx_gain) != 0) {
+			if (SoapySDRDevice_setGain(soapy->sdr, SOAPY_SDR_TX, channel, tx_gain) != 0) {
 				LOGP(DSOAPY, LOGL_ERROR, "Failed to set TX gain to %.0f\n", tx_gain);
-				soapy_close();
+				soapy_close(soapy);
 				return -EIO;
 			}
 
 			/* see what gain actually is */
-			got_gain = SoapySDRDevice_getGain(sdr, SOAPY_SDR_TX, channel);
+			got_gain = SoapySDRDevice_getGain(soapy->sdr, SOAPY_SDR_TX, channel);
 			if (fabs(got_gain - tx_gain) > 0.001) {
 				LOGP(DSOAPY, LOGL_NOTICE, "Given TX gain %.3f is not supported, we use %.3f\n", tx_gain, got_gain);
 				tx_gain = got_gain;
@@ -374,58 +402,83 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 		}
 
 		/* set frequency */
-		if (SoapySDRDevice_setFrequency(sdr, SOAPY_SDR_TX, channel, tx_frequency, &tune_args) != 0) {
+		if (SoapySDRDevice_setFrequency(soapy->sdr, SOAPY_SDR_TX, channel, tx_frequency, &tune_args) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set TX frequency to %.0f Hz\n", tx_frequency);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* see what frequency actually is */
-		got_frequency = SoapySDRDevice_getFrequency(sdr, SOAPY_SDR_TX, channel);
+		got_frequency = SoapySDRDevice_getFrequency(soapy->sdr, SOAPY_SDR_TX, channel);
 		if (fabs(got_frequency - tx_frequency) > 100.0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Given TX frequency %.0f Hz is not supported, try %.0f Hz\n", tx_frequency, got_frequency);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 
 		/* set bandwidth */
-		if (SoapySDRDevice_setBandwidth(sdr, SOAPY_SDR_TX, channel, bandwidth) != 0) {
+		if (SoapySDRDevice_setBandwidth(soapy->sdr, SOAPY_SDR_TX, channel, bandwidth) != 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set TX bandwidth to %.0f Hz\n", bandwidth);
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* see what bandwidth actually is */
-		got_bandwidth = SoapySDRDevice_getBandwidth(sdr, SOAPY_SDR_TX, channel);
+		got_bandwidth = SoapySDRDevice_getBandwidth(soapy->sdr, SOAPY_SDR_TX, channel);
 		if (fabs(got_bandwidth - bandwidth) > 100.0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Given TX bandwidth %.0f Hz is not supported, try %.0f Hz\n", bandwidth, got_bandwidth);
-			soapy_close();
+			soapy_close(soapy);
 			return -EINVAL;
 		}
 
 		/* set up streamer */
 #ifdef SOAPY_0_8_0_OR_HIGHER
-		if (!(txStream = SoapySDRDevice_setupStream(sdr, SOAPY_SDR_TX, SOAPY_SDR_CF32, &channel, 1, &stream_args)))
+		if (!(soapy->txStream = SoapySDRDevice_setupStream(soapy->sdr, SOAPY_SDR_TX, stream_format(soapy), &channel, 1, &stream_args)))
 #else
-		if (SoapySDRDevice_setupStream(sdr, &txStream, SOAPY_SDR_TX, SOAPY_SDR_CF32, &channel, 1, &stream_args) != 0)
+		if (SoapySDRDevice_setupStream(soapy->sdr, &soapy->txStream, SOAPY_SDR_TX, stream_format(soapy), &channel, 1, &stream_args) != 0)
 #endif
 		{
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to set TX streamer args\n");
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
 
 		/* get buffer sizes */
-		tx_samps_per_buff = SoapySDRDevice_getStreamMTU(sdr, txStream);
-		if (tx_samps_per_buff == 0) {
+		soapy->tx_samps_per_buff = SoapySDRDevice_getStreamMTU(soapy->sdr, soapy->txStream);
+		if (soapy->tx_samps_per_buff == 0) {
 			LOGP(DSOAPY, LOGL_ERROR, "Failed to get TX streamer sample buffer\n");
-			soapy_close();
+			soapy_close(soapy);
 			return -EIO;
 		}
+		if (soapy->wire_format != SDR_WIRE_CF32) {
+			soapy->tx_wire_buff = malloc(soapy->tx_samps_per_buff * wire_format_size(soapy->wire_format));
+			if (!soapy->tx_wire_buff) {
+				LOGP(DSOAPY, LOGL_ERROR, "No mem!\n");
+				soapy_close(soapy);
+				return -ENOMEM;
+			}
+		}
+
+		if (direct_buffers) {
+			if (SoapySDRDevice_getNumDirectAccessBuffers(soapy->sdr, soapy->txStream) > 0) {
+				LOGP(DSOAPY, LOGL_INFO, "Using direct access to TX buffers of driver.\n");
+				soapy->direct_tx = 1;
+			} else
+				LOGP(DSOAPY, LOGL_NOTICE, "Driver does not support direct access to TX buffers, copying samples.\n");
+		}
+		/* integer samples are converted into the DMA buffer */
+		if (soapy->direct_tx && soapy->wire_format != SDR_WIRE_CF32) {
+			soapy->tx_direct_buff = malloc(soapy->tx_samps_per_buff * 2 * sizeof(float));
+			if (!soapy->tx_direct_buff) {
+				LOGP(DSOAPY, LOGL_ERROR, "No mem!\n");
+				soapy_close(soapy);
+				return -ENOMEM;
+			}
+		}
 	}
 
 	/* create mutex for time stamp protection */
-	rc = pthread_mutex_init(&timestamp_mutex, NULL);
+	rc = pthread_mutex_init(&soapy->timestamp_mutex, NULL);
 	if (rc < 0) {
 		LOGP(DSOAPY, LOGL_ERROR, "Mutex init failed!\n");
 		return rc;
@@ -435,43 +488,84 @@ int soapy_open(size_t channel, const char *_device_args, const char *_stream_arg
 }
 
 /* start streaming */
-int soapy_start(void)
+int soapy_start(soapy_t *soapy)
 {
 	/* enable rx stream */
-	if (SoapySDRDevice_activateStream(sdr, rxStream, 0, 0, 0) != 0) {
+	if (SoapySDRDevice_activateStream(soapy->sdr, soapy->rxStream, 0, 0, 0) != 0) {
 		LOGP(DSOAPY, LOGL_ERROR, "Failed to issue RX stream command\n");
 		return -EIO;
 	}
 
 	/* enable tx stream */
-	if (SoapySDRDevice_activateStream(sdr, txStream, 0, 0, 0) != 0) {
+	if (SoapySDRDevice_activateStream(soapy->sdr, soapy->txStream, 0, 0, 0) != 0) {
 		LOGP(DSOAPY, LOGL_ERROR, "Failed to issue TX stream command\n");
 		return -EIO;
 	}
 	return 0;
 }
 
-void soapy_close(void)
+void soapy_close(soapy_t *soapy)
 {
 	LOGP(DSOAPY, LOGL_DEBUG, "Clean up SoapySDR\n");
-	if (txStream) {
-		SoapySDRDevice_deactivateStream(sdr, txStream, 0, 0);
-		SoapySDRDevice_closeStream(sdr, txStream);
-		txStream = NULL;
+	if (soapy->txStream) {
+		SoapySDRDevice_deactivateStream(soapy->sdr, soapy->txStream, 0, 0);
+		SoapySDRDevice_closeStream(soapy->sdr, soapy->txStream);
+		soapy->txStream = NULL;
+	}
+	if (soapy->rxStream) {
+		SoapySDRDevice_deactivateStream(soapy->sdr, soapy->rxStream, 0, 0);
+		SoapySDRDevice_closeStream(soapy->sdr, soapy->rxStream);
+		soapy->rxStream = NULL;
+	}
+	if (soapy->sdr) {
+		SoapySDRDevice_unmake(soapy->sdr);
+		soapy->sdr = NULL;
+		pthread_mutex_destroy(&soapy->timestamp_mutex);
+	}
+	free(soapy->tx_wire_buff);
+	soapy->tx_wire_buff = NULL;
+	free(soapy->rx_wire_buff);
+	soapy->rx_wire_buff = NULL;
+	free(soapy->tx_direct_buff);
+	soapy->tx_direct_buff = NULL;
+	free(soapy->rx_direct_buff);
+	soapy->rx_direct_buff = NULL;
+}
+
+/* process TX time stamp of transmitted samples */
+static void tx_timestamp(soapy_t *soapy, int count)
+{
+	if (!soapy->tx_valid)
+		LOGP(DSOAPY, LOGL_ERROR, "SDR TX: tosend() was not called before, prease fix!\n");
+	else {
+		pthread_mutex_lock(&soapy->timestamp_mutex);
+		soapy->tx_timeNs += count * soapy->Ns_per_sample;
+		pthread_mutex_unlock(&soapy->timestamp_mutex);
 	}
-	if (rxStream) {
-		SoapySDRDevice_deactivateStream(sdr, rxStream, 0, 0);
-		SoapySDRDevice_closeStream(sdr, rxStream);
-		rxStream = NULL;
+}
+
+/* process RX time stamp of received samples */
+static void rx_timestamp(soapy_t *soapy, int count, int flags, long long timeNs)
+{
+	if (!soapy->use_time_stamps || !(flags & SOAPY_SDR_HAS_TIME)) {
+		if (soapy->use_time_stamps) {
+			LOGP(DSOAPY, LOGL_ERROR, "SDR RX: No time stamps available. This may cause little gaps and problems with time slot based networks, like C-Netz.\n");
+			soapy->use_time_stamps = 0;
+		}
+		timeNs = soapy->rx_timeNs;
 	}
-	if (sdr) {
-		SoapySDRDevice_unmake(sdr);
-		sdr = NULL;
-		pthread_mutex_destroy(&timestamp_mutex);
+	if (!soapy->rx_valid) {
+		soapy->rx_timeNs = timeNs;
+		soapy->rx_valid = 1;
 	}
+	pthread_mutex_lock(&soapy->timestamp_mutex);
+	if (soapy->rx_timeNs != timeNs)
+		LOGP(DSOAPY, LOGL_ERROR, "SDR RX overflow, seems we are too slow. Use lower SDR sample rate, if this happens too often.\n");
+	soapy->rx_timeNs = timeNs + count * soapy->Ns_per_sample;
+	pthread_mutex_unlock(&soapy->timestamp_mutex);
 }
 
-int soapy_send(float *buff, int num)
+int soapy_send(soapy_t *soapy, float *buff, int num)
 {
     	const void *buffs_ptr[1];
 	int chunk;
@@ -480,25 +574,24 @@ int soapy_send(float *buff, int num)
 
 	while (num) {
 		chunk = num;
-		if (chunk > tx_samps_per_buff)
-			chunk = tx_samps_per_buff;
+		if (chunk > soapy->tx_samps_per_buff)
+			chunk = soapy->tx_samps_per_buff;
 		/* write TX stream */
-		buffs_ptr[0] = buff;
-		if (use_time_stamps)
+		if (soapy->tx_wire_buff) {
+			/* convert to native stream format */
+			wire_format_from_float(soapy->wire_format, buff, soapy->tx_wire_buff, chunk);
+			buffs_ptr[0] = soapy->tx_wire_buff;
+		} else
+			buffs_ptr[0] = buff;
+		if (soapy->use_time_stamps)
 			flags |= SOAPY_SDR_HAS_TIME;
-		count = SoapySDRDevice_writeStream(sdr, txStream, buffs_ptr, chunk, &flags, tx_timeNs, 1000000);
+		count = SoapySDRDevice_writeStream(soapy->sdr, soapy->txStream, buffs_ptr, chunk, &flags, soapy->tx_timeNs, 1000000);
 		if (count <= 0) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to write to TX streamer (error=%d)\n", count);
 			break;
 		}
-		/* process TX time stamp */
-		if (!tx_valid)
-			LOGP(DSOAPY, LOGL_ERROR, "SDR TX: tosend() was not called before, prease fix!\n");
-		else {
-			pthread_mutex_lock(&timestamp_mutex);
-			tx_timeNs += count * Ns_per_sample;
-			pthread_mutex_unlock(&timestamp_mutex);
-		}
+		tx_timestamp(soapy, count);
+		soapy->tx_gap = 0;
 		/* increment transmit counters */
 		sent += count;
 		buff += count * 2;
@@ -508,8 +601,32 @@ int soapy_send(float *buff, int num)
 	return sent;
 }
 
-/* read what we got, return 0, if buffer is empty, otherwise return the number of samples */
-int soapy_receive(float *buff, int max)
+/* do not transmit the given number of samples: end the current burst and
+ * skip the time stamp, so that the next burst is transmitted in time */
+int soapy_send_gap(soapy_t *soapy, int num)
+{
+	const void *buffs_ptr[1];
+	int flags = SOAPY_SDR_END_BURST | SOAPY_SDR_HAS_TIME;
+	int rc;
+
+	if (!soapy->use_time_stamps)
+		return 0;
+
+	if (!soapy->tx_gap) {
+		buffs_ptr[0] = (soapy->tx_wire_buff) ? soapy->tx_wire_buff : soapy->tx_direct_buff;
+		rc = SoapySDRDevice_writeStream(soapy->sdr, soapy->txStream, buffs_ptr, 0, &flags, soapy->tx_timeNs, 1000000);
+		if (rc < 0)
+			LOGP(DSOAPY, LOGL_ERROR, "Failed to end burst of TX streamer (error=%d)\n", rc);
+		soapy->tx_gap = 1;
+	}
+	tx_timestamp(soapy, num);
+
+	return num;
+}
+
+/* read what we got, return 0, if buffer is empty, otherwise return the number of samples
+ * wait up to 'timeout' seconds for the first packet */
+int soapy_receive(soapy_t *soapy, float *buff, int max, double timeout)
 {
     	void *buffs_ptr[1];
 	int got = 0, count;
@@ -517,32 +634,21 @@ int soapy_receive(float *buff, int max)
 	int flags = 0;
 
 	while (1) {
-		if (max < rx_samps_per_buff) {
+		if (max < soapy->rx_samps_per_buff) {
 			/* no more space this time */
 			sdr_rx_overflow = 1;
 			break;
 		}
 		/* read RX stream */
-		buffs_ptr[0] = buff;
-		count = SoapySDRDevice_readStream(sdr, rxStream, buffs_ptr, rx_samps_per_buff, &flags, &timeNs, 0);
+		buffs_ptr[0] = (soapy->rx_wire_buff) ? soapy->rx_wire_buff : buff;
+		count = SoapySDRDevice_readStream(soapy->sdr, soapy->rxStream, buffs_ptr, soapy->rx_samps_per_buff, &flags, &timeNs, (long)(timeout * 1e6));
+		timeout = 0.0;
 		if (count > 0) {
-			if (!use_time_stamps || !(flags & SOAPY_SDR_HAS_TIME)) {
-				if (use_time_stamps) {
-					LOGP(DSOAPY, LOGL_ERROR, "SDR RX: No time stamps available. This may cause little gaps and problems with time slot based networks, like C-Netz.\n");
-					use_time_stamps = 0;
-				}
-				timeNs = rx_timeNs;
-			}
 			/* process RX time stamp */
-			if (!rx_valid) {
-				rx_timeNs = timeNs;
-				rx_valid = 1;
-			}
-			pthread_mutex_lock(&timestamp_mutex);
-			if (rx_timeNs != timeNs)
-				LOGP(DSOAPY, LOGL_ERROR, "SDR RX overflow, seems we are too slow. Use lower SDR sample rate, if this happens too often.\n");
-			rx_timeNs = timeNs + count * Ns_per_sample;
-			pthread_mutex_unlock(&timestamp_mutex);
+			rx_timestamp(soapy, count, flags, timeNs);
+			/* convert from native stream format */
+			if (soapy->rx_wire_buff)
+				iq_correct_to_float(soapy->rx_correct, soapy->wire_format, soapy->rx_wire_buff, buff, count);
 			/* commit received data to buffer */
 			got += count;
 			buff += count * 2;
@@ -556,30 +662,107 @@ int soapy_receive(float *buff, int max)
 	return got;
 }
 
+/* get space in a DMA buffer of the driver, the samples are committed by soapy_send_release()
+ * return number of samples that fit, 0 if there is no buffer */
+int soapy_send_acquire(soapy_t *soapy, float **buff)
+{
+	void *buffs_ptr[1];
+	int count;
+
+	count = SoapySDRDevice_acquireWriteBuffer(soapy->sdr, soapy->txStream, &soapy->tx_handle, buffs_ptr, 1000000);
+	if (count <= 0) {
+		LOGP(DSOAPY, LOGL_ERROR, "Failed to acquire TX buffer (error=%d)\n", count);
+		return 0;
+	}
+	soapy->tx_direct_addr = buffs_ptr[0];
+	if (soapy->tx_direct_buff) {
+		if (count > soapy->tx_samps_per_buff)
+			count = soapy->tx_samps_per_buff;
+		*buff = soapy->tx_direct_buff;
+	} else
+		*buff = buffs_ptr[0];
+
+	return count;
+}
+
+/* commit 'num' samples of the acquired buffer to the driver */
+void soapy_send_release(soapy_t *soapy, int num)
+{
+	int flags = 0;
+
+	if (soapy->tx_direct_buff)
+		wire_format_from_float(soapy->wire_format, soapy->tx_direct_buff, soapy->tx_direct_addr, num);
+	if (soapy->use_time_stamps)
+		flags |= SOAPY_SDR_HAS_TIME;
+	SoapySDRDevice_releaseWriteBuffer(soapy->sdr, soapy->txStream, soapy->tx_handle, num, &flags, soapy->tx_timeNs, 1000000);
+	tx_timestamp(soapy, num);
+	soapy->tx_gap = 0;
+}
+
+/* get received samples straight from a DMA buffer of the driver, release it by soapy_receive_release() after processing
+ * return 0, if there is no buffer, otherwise the number of samples
+ * wait up to 'timeout' seconds for the buffer */
+int soapy_receive_acquire(soapy_t *soapy, const float **buff, int max, double timeout)
+{
+	const void *buffs_ptr[1];
+	long long timeNs;
+	int flags = 0;
+	int count, limit;
+
+	if (max < soapy->rx_samps_per_buff) {
+		/* no more space this time */
+		sdr_rx_overflow = 1;
+		return 0;
+	}
+	count = SoapySDRDevice_acquireReadBuffer(soapy->sdr, soapy->rxStream, &soapy->rx_handle, buffs_ptr, &flags, &timeNs, (long)(timeout * 1e6));
+	if (count <= 0)
+		return 0;
+	/* buffers of the driver may be larger than its MTU, drop the rest */
+	limit = (soapy->rx_direct_buff) ? soapy->rx_samps_per_buff : max;
+	if (count > limit) {
+		sdr_rx_overflow = 1;
+		count = limit;
+	}
+	rx_timestamp(soapy, count, flags, timeNs);
+	if (soapy->rx_direct_buff) {
+		iq_correct_to_float(soapy->rx_correct, soapy->wire_format, buffs_ptr[0], soapy->rx_direct_buff, count);
+		*buff = soapy->rx_direct_buff;
+	} else
+		*buff = buffs_ptr[0];
+
+	return count;
+}
+
+void soapy_receive_release(soapy_t *soapy)
+{
+	SoapySDRDevice_releaseReadBuffer(soapy->sdr, soapy->rxStream, soapy->rx_handle);
+}
+
 /* estimate number of samples that can be sent */
-int soapy_get_tosend(int buffer_size)
+int soapy_get_tosend(soapy_t *soapy, int buffer_size)
 {
 	int tosend;
 
 	/* if no RX time stamp is set, we must wait until we receive a valid time stamp */
-	if (!rx_valid)
+	if (!soapy->rx_valid)
 		return 0;
 
 	/* RX time stamp is valid the first time, set the TX time stamp in advance */
-	if (!tx_valid) {
-		tx_timeNs = rx_timeNs + buffer_size * Ns_per_sample;
-		tx_valid = 1;
+	if (!soapy->tx_valid) {
+		soapy->tx_timeNs = soapy->rx_timeNs + buffer_size * soapy->Ns_per_sample;
+		soapy->tx_valid = 1;
 		return 0;
 	}
 
 	/* we check how advance our transmitted time stamp is */
-	pthread_mutex_lock(&timestamp_mutex);
-	tosend = buffer_size - (tx_timeNs - rx_timeNs) / Ns_per_sample;
-	pthread_mutex_unlock(&timestamp_mutex);
+	pthread_mutex_lock(&soapy->timestamp_mutex);
+	tosend = buffer_size - (soapy->tx_timeNs - soapy->rx_timeNs) / soapy->Ns_per_sample;
+	pthread_mutex_unlock(&soapy->timestamp_mutex);
 
 	/* in case of underrun */
 	if (tosend > buffer_size) {
 		LOGP(DSOAPY, LOGL_ERROR, "SDR TX underrun, seems we are too slow. Use lower SDR sample rate.\n");
+		sdr_tx_underrun = 1;
 		tosend = buffer_size;
 	}
 
@@ -1,8 +1,46 @@
+#ifndef _LIBSDR_SOAPY_H
+#define _LIBSDR_SOAPY_H
 
-int soapy_open(size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps);
-int soapy_start(void);
-void soapy_close(void);
-int soapy_send(float *buff, int num);
-int soapy_receive(float *buff, int max);
-int soapy_get_tosend(int buffer_size);
+#include <pthread.h>
+#include <SoapySDR/Device.h>
+#include "iq_correct.h"
 
+/* instance of one SoapySDR device */
+typedef struct soapy {
+	SoapySDRDevice		*sdr;
+	SoapySDRStream		*rxStream;
+	SoapySDRStream		*txStream;
+	int			tx_samps_per_buff, rx_samps_per_buff;
+	double			samplerate;
+	pthread_mutex_t		timestamp_mutex;
+	int			use_time_stamps;
+	int			rx_valid;
+	long long		rx_timeNs;
+	int			tx_valid;
+	long long		tx_timeNs;
+	int			tx_gap;		/* burst was ended, next samples start a new one */
+	long long		Ns_per_sample;
+	int			wire_format;	/* SDR_WIRE_* */
+	void			*tx_wire_buff;	/* conversion buffers for integer wire formats */
+	void			*rx_wire_buff;
+	iq_correct_t		*rx_correct;	/* correct DC and IQ imbalance while converting, if set */
+	int			direct_rx, direct_tx;	/* access DMA buffers of the driver */
+	size_t			rx_handle, tx_handle;	/* acquired DMA buffers */
+	void			*tx_direct_addr;
+	float			*rx_direct_buff;	/* conversion buffers for DMA buffers of integer wire formats */
+	float			*tx_direct_buff;
+} soapy_t;
+
+int soapy_open(soapy_t *soapy, size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps, int _wire_format, int direct_buffers);
+int soapy_start(soapy_t *soapy);
+void soapy_close(soapy_t *soapy);
+int soapy_send(soapy_t *soapy, float *buff, int num);
+int soapy_send_gap(soapy_t *soapy, int num);
+int soapy_receive(soapy_t *soapy, float *buff, int max, double timeout);
+int soapy_send_acquire(soapy_t *soapy, float **buff);
+void soapy_send_release(soapy_t *soapy, int num);
+int soapy_receive_acquire(soapy_t *soapy, const float **buff, int max, double timeout);
+void soapy_receive_release(soapy_t *soapy);
+int soapy_get_tosend(soapy_t *soapy, int buffer_size);
+
+#endif /* _LIBSDR_SOAPY_H */
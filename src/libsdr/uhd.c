@@ -22,50 +22,314 @@
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
 #include <uhd.h>
 #include <uhd/usrp/usrp.h>
 #include "uhd.h"
+#include "wire_format.h"
+#include "../libsample/ringbuffer.h"
 #include "../liblogging/logging.h"
 #include "../liboptions/options.h"
 
 extern int sdr_rx_overflow;
+extern int sdr_tx_underrun;
 
-static uhd_usrp_handle		usrp = NULL;
-static uhd_tx_streamer_handle	tx_streamer = NULL;
-static uhd_rx_streamer_handle	rx_streamer = NULL;
-static uhd_tx_metadata_handle	tx_metadata = NULL;
-static uhd_rx_metadata_handle	rx_metadata = NULL;
-static uhd_tune_request_t	tune_request;
-static uhd_tune_result_t	tune_result;
-static uhd_stream_args_t	stream_args;
-static uhd_stream_cmd_t		stream_cmd;
-static size_t tx_samps_per_buff, rx_samps_per_buff;
-static double			samplerate;
-static time_t			rx_time_secs = 0;
-static double			rx_time_fract_sec = 0.0;
-static time_t			tx_time_secs = 0;
-static double			tx_time_fract_sec = 0.0;
-static int			tx_timestamps;
-
-int uhd_open(size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps)
+#define MIMO_MAX_CHANNELS	8
+#define MIMO_BUFFER_DURATION	0.5	/* duration of samples buffered for each channel */
+
+/* channels of one USRP that are streamed together, each channel is opened as uhd_t instance of its own */
+struct uhd_mimo {
+	struct uhd_mimo		*next;
+	const char		*device_args;
+	const char		*stream_args;
+	pthread_mutex_t		mutex;
+	int			users;		/* number of channels that opened the USRP */
+	int			started;	/* streamers are created */
+	int			closing;	/* a channel is closed, so the stream is incomplete */
+	uhd_t			shared;		/* USRP, streamers and time stamps of all channels */
+	uhd_t			*tx[MIMO_MAX_CHANNELS];
+	uhd_t			*rx[MIMO_MAX_CHANNELS];
+	int			tx_num, rx_num;
+	size_t			tx_channels[MIMO_MAX_CHANNELS];
+	size_t			rx_channels[MIMO_MAX_CHANNELS];
+	float			*rx_buff[MIMO_MAX_CHANNELS]; /* received packet of each channel */
+};
+
+static struct uhd_mimo *mimo_list = NULL;
+
+/* select host and wire format of streamer */
+static void set_stream_format(uhd_t *uhd, uhd_stream_args_t *args)
+{
+	switch (uhd->wire_format) {
+	case SDR_WIRE_CS16:
+		args->cpu_format = "sc16";
+		args->otw_format = "sc16";
+		break;
+	case SDR_WIRE_CS8:
+		args->cpu_format = "sc8";
+		args->otw_format = "sc8";
+		break;
+	default:
+		args->cpu_format = "fc32";
+		args->otw_format = "sc16";
+	}
+}
+
+/* create TX streamer of given channels, all channels must be sent at once */
+static int create_tx_streamer(uhd_t *uhd, size_t *channel_list, int n_channels, const char *_stream_args)
 {
 	uhd_error error;
-	double got_frequency, got_rate, got_gain, got_bandwidth;
-	char got_antenna[64], got_clock[64];
 
-	samplerate = rate;
-	tx_timestamps = timestamps;
+	error = uhd_tx_streamer_make(&uhd->tx_streamer);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to create TX streamer\n");
+		return -EIO;
+	}
 
-	LOGP(DUHD, LOGL_INFO, "Using device args \"%s\"\n", _device_args);
-	LOGP(DUHD, LOGL_INFO, "Using stream args \"%s\"\n", _stream_args);
-	LOGP(DUHD, LOGL_INFO, "Using tune args \"%s\"\n", _tune_args);
+	memset(&uhd->stream_args, 0, sizeof(uhd->stream_args));
+	set_stream_format(uhd, &uhd->stream_args);
+	uhd->stream_args.args = options_strdup(_stream_args);
+	uhd->stream_args.channel_list = channel_list;
+	uhd->stream_args.n_channels = n_channels;
+	error = uhd_usrp_get_tx_stream(uhd->usrp, &uhd->stream_args, uhd->tx_streamer);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to set TX streamer args\n");
+		return -EIO;
+	}
+
+	/* get buffer sizes */
+	error = uhd_tx_streamer_max_num_samps(uhd->tx_streamer, &uhd->tx_samps_per_buff);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to get TX streamer sample buffer\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* create RX streamer of given channels, all channels are received at once */
+static int create_rx_streamer(uhd_t *uhd, size_t *channel_list, int n_channels, const char *_stream_args)
+{
+	uhd_error error;
+
+	error = uhd_rx_streamer_make(&uhd->rx_streamer);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to create RX streamer\n");
+		return -EIO;
+	}
+
+	/* create metadata */
+	error = uhd_rx_metadata_make(&uhd->rx_metadata);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to create RX metadata\n");
+		return -EIO;
+	}
+
+	memset(&uhd->stream_args, 0, sizeof(uhd->stream_args));
+	set_stream_format(uhd, &uhd->stream_args);
+	uhd->stream_args.args = options_strdup(_stream_args);
+	uhd->stream_args.channel_list = channel_list;
+	uhd->stream_args.n_channels = n_channels;
+	error = uhd_usrp_get_rx_stream(uhd->usrp, &uhd->stream_args, uhd->rx_streamer);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to set RX streamer args\n");
+		return -EIO;
+	}
+
+	/* get buffer sizes */
+	error = uhd_rx_streamer_max_num_samps(uhd->rx_streamer, &uhd->rx_samps_per_buff);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to get RX streamer sample buffer\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* get the MIMO stream of the given device or create it */
+static int mimo_attach(uhd_t *uhd, const char *_device_args, const char *_stream_args)
+{
+	struct uhd_mimo *mimo;
+
+	for (mimo = mimo_list; mimo; mimo = mimo->next) {
+		if (!strcmp(mimo->device_args, _device_args))
+			break;
+	}
+	if (!mimo) {
+		mimo = calloc(1, sizeof(*mimo));
+		if (!mimo) {
+			LOGP(DUHD, LOGL_ERROR, "No mem!\n");
+			return -ENOMEM;
+		}
+		mimo->device_args = options_strdup(_device_args);
+		mimo->stream_args = options_strdup(_stream_args);
+		pthread_mutex_init(&mimo->mutex, NULL);
+		mimo->shared.samplerate = uhd->samplerate;
+		mimo->shared.tx_timestamps = uhd->tx_timestamps;
+		mimo->shared.wire_format = uhd->wire_format;
+		mimo->next = mimo_list;
+		mimo_list = mimo;
+	}
+	if (mimo->started) {
+		LOGP(DUHD, LOGL_ERROR, "Channel %zu is opened after the MIMO stream has been started, please fix!\n", uhd->channel);
+		return -EINVAL;
+	}
+	mimo->users++;
+	uhd->mimo = mimo;
+
+	return 0;
+}
+
+static int mimo_add_channel(uhd_t **list, int *num, uhd_t *uhd)
+{
+	int i;
+
+	for (i = 0; i < *num; i++) {
+		if (list[i]->channel == uhd->channel) {
+			LOGP(DUHD, LOGL_ERROR, "Channel %zu is used twice in MIMO stream.\n", uhd->channel);
+			return -EINVAL;
+		}
+	}
+	if (*num == MIMO_MAX_CHANNELS) {
+		LOGP(DUHD, LOGL_ERROR, "Too many channels in MIMO stream, only %d are supported.\n", MIMO_MAX_CHANNELS);
+		return -EINVAL;
+	}
+	list[(*num)++] = uhd;
+
+	return 0;
+}
+
+static void mimo_detach(uhd_t *uhd)
+{
+	struct uhd_mimo *mimo = uhd->mimo, **mimop;
+	int i;
+
+	pthread_mutex_lock(&mimo->mutex);
+	/* remaining channels cannot be streamed without this one */
+	if (mimo->started)
+		mimo->closing = 1;
+	for (i = 0; i < mimo->tx_num; i++) {
+		if (mimo->tx[i] == uhd)
+			mimo->tx[i] = mimo->tx[--mimo->tx_num];
+	}
+	for (i = 0; i < mimo->rx_num; i++) {
+		if (mimo->rx[i] == uhd)
+			mimo->rx[i] = mimo->rx[--mimo->rx_num];
+	}
+	ringbuffer_exit(&uhd->tx_ring);
+	ringbuffer_exit(&uhd->rx_ring);
+	uhd->mimo = NULL;
+	pthread_mutex_unlock(&mimo->mutex);
+
+	if (--mimo->users)
+		return;
+
+	/* last channel closes the USRP */
+	for (mimop = &mimo_list; *mimop; mimop = &(*mimop)->next) {
+		if (*mimop == mimo) {
+			*mimop = mimo->next;
+			break;
+		}
+	}
+	uhd_close(&mimo->shared);
+	for (i = 0; i < MIMO_MAX_CHANNELS; i++)
+		free(mimo->rx_buff[i]);
+	pthread_mutex_destroy(&mimo->mutex);
+	free(mimo);
+}
+
+/* create streamers of all channels and start streaming, so that all channels are aligned */
+static int mimo_start(struct uhd_mimo *mimo)
+{
+	uhd_t *shared = &mimo->shared;
+	int64_t secs;
+	double fract;
+	uhd_error error;
+	int size, i, rc;
+
+	for (i = 0; i < mimo->tx_num; i++)
+		mimo->tx_channels[i] = mimo->tx[i]->channel;
+	for (i = 0; i < mimo->rx_num; i++)
+		mimo->rx_channels[i] = mimo->rx[i]->channel;
+	LOGP(DUHD, LOGL_INFO, "Starting MIMO stream with %d TX and %d RX channels\n", mimo->tx_num, mimo->rx_num);
+	if (mimo->tx_num) {
+		rc = create_tx_streamer(shared, mimo->tx_channels, mimo->tx_num, mimo->stream_args);
+		if (rc < 0)
+			return rc;
+	}
+	if (mimo->rx_num) {
+		rc = create_rx_streamer(shared, mimo->rx_channels, mimo->rx_num, mimo->stream_args);
+		if (rc < 0)
+			return rc;
+	}
+
+	/* buffer samples of each channel */
+	size = (int)(shared->samplerate * MIMO_BUFFER_DURATION);
+	for (i = 0; i < mimo->tx_num; i++) {
+		if (ringbuffer_init(&mimo->tx[i]->tx_ring, size, sizeof(float) * 2) < 0)
+			goto nomem;
+		if (shared->wire_format != SDR_WIRE_CF32) {
+			mimo->tx[i]->tx_wire_buff = malloc(shared->tx_samps_per_buff * wire_format_size(shared->wire_format));
+			if (!mimo->tx[i]->tx_wire_buff)
+				goto nomem;
+		}
+	}
+	for (i = 0; i < mimo->rx_num; i++) {
+		if (ringbuffer_init(&mimo->rx[i]->rx_ring, size, sizeof(float) * 2) < 0)
+			goto nomem;
+		mimo->rx_buff[i] = malloc(shared->rx_samps_per_buff * 2 * sizeof(float));
+		if (!mimo->rx_buff[i])
+			goto nomem;
+		if (shared->wire_format != SDR_WIRE_CF32) {
+			mimo->rx[i]->rx_wire_buff = malloc(shared->rx_samps_per_buff * wire_format_size(shared->wire_format));
+			if (!mimo->rx[i]->rx_wire_buff)
+				goto nomem;
+		}
+	}
+
+	if (!mimo->rx_num)
+		return 0;
+
+	/* start all RX channels at the same time in the near future */
+	memset(&shared->stream_cmd, 0, sizeof(shared->stream_cmd));
+	shared->stream_cmd.stream_mode = UHD_STREAM_MODE_START_CONTINUOUS;
+	error = uhd_usrp_get_time_now(shared->usrp, 0, &secs, &fract);
+	if (error)
+		shared->stream_cmd.stream_now = true;
+	else {
+		fract += 0.1;
+		if (fract >= 1.0) {
+			fract -= 1.0;
+			secs++;
+		}
+		shared->stream_cmd.stream_now = false;
+		shared->stream_cmd.time_spec_full_secs = secs;
+		shared->stream_cmd.time_spec_frac_secs = fract;
+	}
+	error = uhd_rx_streamer_issue_stream_cmd(shared->rx_streamer, &shared->stream_cmd);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to issue RX stream command\n");
+		return -EIO;
+	}
+
+	return 0;
+
+nomem:
+	LOGP(DUHD, LOGL_ERROR, "No mem!\n");
+	return -ENOMEM;
+}
+
+static int create_usrp(uhd_t *uhd, const char *_device_args, const char *clock_source)
+{
+	uhd_error error;
+	char got_clock[64];
 
 	/* create USRP */
 	LOGP(DUHD, LOGL_INFO, "Creating USRP with args \"%s\"...\n", _device_args);
-	error = uhd_usrp_make(&usrp, _device_args);
+	error = uhd_usrp_make(&uhd->usrp, _device_args);
 	if (error) {
 		LOGP(DUHD, LOGL_ERROR, "Failed to create USRP\n");
-		uhd_close();
+		uhd_close(uhd);
 		return -EIO;
 	}
 
@@ -79,13 +343,13 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 			if (error) {
 				clock_vector_error:
 				LOGP(DUHD, LOGL_ERROR, "Failed to handle UHD vector, please fix!\n");
-				uhd_close();
+				uhd_close(uhd);
 				return -EIO;
 			}
-			error = uhd_usrp_get_clock_sources(usrp, 0, &clocks);
+			error = uhd_usrp_get_clock_sources(uhd->usrp, 0, &clocks);
 			if (error) {
 				LOGP(DUHD, LOGL_ERROR, "Failed to request list of clock sources!\n");
-				uhd_close();
+				uhd_close(uhd);
 				return -EIO;
 			}
 			error = uhd_string_vector_size(clocks, &clocks_length);
@@ -98,35 +362,72 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 				LOGP(DUHD, LOGL_NOTICE, "Clock source: '%s'\n", got_clock);
 			}
 			uhd_string_vector_free(&clocks);
-			error = uhd_usrp_get_clock_source(usrp, 0, got_clock, sizeof(got_clock));
+			error = uhd_usrp_get_clock_source(uhd->usrp, 0, got_clock, sizeof(got_clock));
 			if (error) {
 				LOGP(DUHD, LOGL_ERROR, "Failed to get clock source\n");
-				uhd_close();
+				uhd_close(uhd);
 				return -EINVAL;
 			}
 			LOGP(DUHD, LOGL_NOTICE, "Default clock source: '%s'\n", got_clock);
-			uhd_close();
+			uhd_close(uhd);
 			return 1;
 		}
-		error = uhd_usrp_set_clock_source(usrp, clock_source, 0);
+		error = uhd_usrp_set_clock_source(uhd->usrp, clock_source, 0);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set clock source to '%s'\n", clock_source);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
-		error = uhd_usrp_get_clock_source(usrp, 0, got_clock, sizeof(got_clock));
+		error = uhd_usrp_get_clock_source(uhd->usrp, 0, got_clock, sizeof(got_clock));
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get clock source\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 		if (!!strcasecmp(clock_source, got_clock)) {
 			LOGP(DUHD, LOGL_NOTICE, "Given clock source '%s' was accepted, but driver claims to use '%s'\n", clock_source, got_clock);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 	}
 
+	return 0;
+}
+
+int uhd_open(uhd_t *uhd, size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps, int _wire_format, int mimo)
+{
+	uhd_error error;
+	double got_frequency, got_rate, got_gain, got_bandwidth;
+	char got_antenna[64];
+	int rc;
+
+	memset(uhd, 0, sizeof(*uhd));
+	uhd->samplerate = rate;
+	uhd->tx_timestamps = timestamps;
+	uhd->wire_format = _wire_format;
+	uhd->channel = channel;
+
+	LOGP(DUHD, LOGL_INFO, "Using device args \"%s\"\n", _device_args);
+	LOGP(DUHD, LOGL_INFO, "Using stream args \"%s\"\n", _stream_args);
+	LOGP(DUHD, LOGL_INFO, "Using tune args \"%s\"\n", _tune_args);
+
+	/* channels of a MIMO stream share the USRP, the first channel creates it */
+	if (mimo) {
+		rc = mimo_attach(uhd, _device_args, _stream_args);
+		if (rc < 0)
+			return rc;
+	}
+	if (uhd->mimo && uhd->mimo->shared.usrp) {
+		LOGP(DUHD, LOGL_INFO, "Using channel %zu of USRP with args \"%s\"\n", channel, _device_args);
+		uhd->usrp = uhd->mimo->shared.usrp;
+	} else {
+		rc = create_usrp(uhd, _device_args, clock_source);
+		if (rc)
+			return rc;
+		if (uhd->mimo)
+			uhd->mimo->shared.usrp = uhd->usrp;
+	}
+
 	if (tx_frequency) {
 		/* antenna */
 		if (tx_antenna && tx_antenna[0]) {
@@ -138,13 +439,13 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 				if (error) {
 					tx_vector_error:
 					LOGP(DUHD, LOGL_ERROR, "Failed to handle UHD vector, please fix!\n");
-					uhd_close();
+					uhd_close(uhd);
 					return -EIO;
 				}
-				error = uhd_usrp_get_tx_antennas(usrp, channel, &antennas);
+				error = uhd_usrp_get_tx_antennas(uhd->usrp, channel, &antennas);
 				if (error) {
 					LOGP(DUHD, LOGL_ERROR, "Failed to request list of TX antennas!\n");
-					uhd_close();
+					uhd_close(uhd);
 					return -EIO;
 				}
 				error = uhd_string_vector_size(antennas, &antennas_length);
@@ -157,77 +458,69 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 					LOGP(DUHD, LOGL_NOTICE, "TX Antenna: '%s'\n", got_antenna);
 				}
 				uhd_string_vector_free(&antennas);
-				error = uhd_usrp_get_tx_antenna(usrp, channel, got_antenna, sizeof(got_antenna));
+				error = uhd_usrp_get_tx_antenna(uhd->usrp, channel, got_antenna, sizeof(got_antenna));
 				if (error) {
 					LOGP(DUHD, LOGL_ERROR, "Failed to get TX antenna\n");
-					uhd_close();
+					uhd_close(uhd);
 					return -EINVAL;
 				}
 				LOGP(DUHD, LOGL_NOTICE, "Default TX Antenna: '%s'\n", got_antenna);
-				uhd_close();
+				uhd_close(uhd);
 				return 1;
 			}
-			error = uhd_usrp_set_tx_antenna(usrp, tx_antenna, channel);
+			error = uhd_usrp_set_tx_antenna(uhd->usrp, tx_antenna, channel);
 			if (error) {
 				LOGP(DUHD, LOGL_ERROR, "Failed to set TX antenna to '%s'\n", tx_antenna);
-				uhd_close();
+				uhd_close(uhd);
 				return -EIO;
 			}
-			error = uhd_usrp_get_tx_antenna(usrp, channel, got_antenna, sizeof(got_antenna));
+			error = uhd_usrp_get_tx_antenna(uhd->usrp, channel, got_antenna, sizeof(got_antenna));
 			if (error) {
 				LOGP(DUHD, LOGL_ERROR, "Failed to get TX antenna\n");
-				uhd_close();
+				uhd_close(uhd);
 				return -EINVAL;
 			}
 			if (!!strcasecmp(tx_antenna, got_antenna)) {
 				LOGP(DUHD, LOGL_NOTICE, "Given TX antenna '%s' was accepted, but driver claims to use '%s'\n", tx_antenna, got_antenna);
-				uhd_close();
+				uhd_close(uhd);
 				return -EINVAL;
 			}
 		}
 
-		/* create streamers */
-		error = uhd_tx_streamer_make(&tx_streamer);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to create TX streamer\n");
-			uhd_close();
-			return -EIO;
-		}
-
 		/* set rate */
-		error = uhd_usrp_set_tx_rate(usrp, rate, channel);
+		error = uhd_usrp_set_tx_rate(uhd->usrp, rate, channel);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set TX rate to %.0f Hz\n", rate);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what rate actually is */
-		error = uhd_usrp_get_tx_rate(usrp, channel, &got_rate);
+		error = uhd_usrp_get_tx_rate(uhd->usrp, channel, &got_rate);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get TX rate\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_rate - rate) > 1.0) {
 			LOGP(DUHD, LOGL_ERROR, "Given TX rate %.0f Hz is not supported, try %.0f Hz\n", rate, got_rate);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 
 		/* set gain */
-		error = uhd_usrp_set_tx_gain(usrp, tx_gain, channel, "");
+		error = uhd_usrp_set_tx_gain(uhd->usrp, tx_gain, channel, "");
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set TX gain to %.0f\n", tx_gain);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what gain actually is */
-		error = uhd_usrp_get_tx_gain(usrp, channel, "", &got_gain);
+		error = uhd_usrp_get_tx_gain(uhd->usrp, channel, "", &got_gain);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get TX gain\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_gain - tx_gain) > 0.001) {
@@ -236,75 +529,71 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 		}
 
 		/* set frequency */
-		memset(&tune_request, 0, sizeof(tune_request));
-		tune_request.target_freq = tx_frequency;
+		memset(&uhd->tune_request, 0, sizeof(uhd->tune_request));
+		uhd->tune_request.target_freq = tx_frequency;
 		if (lo_offset) {
-			tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_MANUAL;
-			tune_request.rf_freq = tx_frequency + lo_offset;
+			uhd->tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_MANUAL;
+			uhd->tune_request.rf_freq = tx_frequency + lo_offset;
 		} else
-			tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
-		tune_request.dsp_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
-		tune_request.args = options_strdup(_tune_args);
-		error = uhd_usrp_set_tx_freq(usrp, &tune_request, channel, &tune_result);
+			uhd->tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
+		uhd->tune_request.dsp_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
+		uhd->tune_request.args = options_strdup(_tune_args);
+		error = uhd_usrp_set_tx_freq(uhd->usrp, &uhd->tune_request, channel, &uhd->tune_result);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set TX frequency to %.0f Hz\n", tx_frequency);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what frequency actually is */
-		error = uhd_usrp_get_tx_freq(usrp, channel, &got_frequency);
+		error = uhd_usrp_get_tx_freq(uhd->usrp, channel, &got_frequency);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get TX frequency\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_frequency - tx_frequency) > 100.0) {
 			LOGP(DUHD, LOGL_ERROR, "Given TX frequency %.0f Hz is not supported, try %.0f Hz\n", tx_frequency, got_frequency);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 
 		/* set bandwidth */
-		if (uhd_usrp_set_tx_bandwidth(usrp, bandwidth, channel) != 0) {
+		if (uhd_usrp_set_tx_bandwidth(uhd->usrp, bandwidth, channel) != 0) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set TX bandwidth to %.0f Hz\n", bandwidth);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what bandwidth actually is */
-		error = uhd_usrp_get_tx_bandwidth(usrp, channel, &got_bandwidth);
+		error = uhd_usrp_get_tx_bandwidth(uhd->usrp, channel, &got_bandwidth);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get TX bandwidth\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_bandwidth - bandwidth) > 100.0) {
 			LOGP(DUHD, LOGL_ERROR, "Given TX bandwidth %.0f Hz is not supported, try %.0f Hz\n", bandwidth, got_bandwidth);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 
-		/* set up streamer */
-		memset(&stream_args, 0, sizeof(stream_args));
-		stream_args.cpu_format = "fc32";
-		stream_args.otw_format = "sc16";
-		stream_args.args = options_strdup(_stream_args);
-		stream_args.channel_list = &channel;
-		stream_args.n_channels = 1;
-		error = uhd_usrp_get_tx_stream(usrp, &stream_args, tx_streamer);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to set TX streamer args\n");
-			uhd_close();
-			return -EIO;
+		/* set up streamer, a MIMO stream is set up when starting */
+		if (uhd->mimo)
+			rc = mimo_add_channel(uhd->mimo->tx, &uhd->mimo->tx_num, uhd);
+		else
+			rc = create_tx_streamer(uhd, &uhd->channel, 1, _stream_args);
+		if (rc < 0) {
+			uhd_close(uhd);
+			return rc;
 		}
-
-		/* get buffer sizes */
-		error = uhd_tx_streamer_max_num_samps(tx_streamer, &tx_samps_per_buff);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to get TX streamer sample buffer\n");
-			uhd_close();
-			return -EIO;
+		if (!uhd->mimo && uhd->wire_format != SDR_WIRE_CF32) {
+			uhd->tx_wire_buff = malloc(uhd->tx_samps_per_buff * wire_format_size(uhd->wire_format));
+			if (!uhd->tx_wire_buff) {
+				LOGP(DUHD, LOGL_ERROR, "No mem!\n");
+				uhd_close(uhd);
+				return -ENOMEM;
+			}
 		}
 	}
 
@@ -319,13 +608,13 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 				if (error) {
 					rx_vector_error:
 					LOGP(DUHD, LOGL_ERROR, "Failed to handle UHD vector, please fix!\n");
-					uhd_close();
+					uhd_close(uhd);
 					return -EIO;
 				}
-				error = uhd_usrp_get_rx_antennas(usrp, channel, &antennas);
+				error = uhd_usrp_get_rx_antennas(uhd->usrp, channel, &antennas);
 				if (error) {
 					LOGP(DUHD, LOGL_ERROR, "Failed to request list of RX antennas!\n");
-					uhd_close();
+					uhd_close(uhd);
 					return -EIO;
 				}
 				error = uhd_string_vector_size(antennas, &antennas_length);
@@ -338,84 +627,68 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 					LOGP(DUHD, LOGL_NOTICE, "RX Antenna: '%s'\n", got_antenna);
 				}
 				uhd_string_vector_free(&antennas);
-				error = uhd_usrp_get_rx_antenna(usrp, channel, got_antenna, sizeof(got_antenna));
+				error = uhd_usrp_get_rx_antenna(uhd->usrp, channel, got_antenna, sizeof(got_antenna));
 				if (error) {
 					LOGP(DUHD, LOGL_ERROR, "Failed to get RX antenna\n");
-					uhd_close();
+					uhd_close(uhd);
 					return -EINVAL;
 				}
 				LOGP(DUHD, LOGL_NOTICE, "Default RX Antenna: '%s'\n", got_antenna);
-				uhd_close();
+				uhd_close(uhd);
 				return 1;
 			}
-			error = uhd_usrp_set_rx_antenna(usrp, rx_antenna, channel);
+			error = uhd_usrp_set_rx_antenna(uhd->usrp, rx_antenna, channel);
 			if (error) {
 				LOGP(DUHD, LOGL_ERROR, "Failed to set RX antenna to '%s'\n", rx_antenna);
-				uhd_close();
+				uhd_close(uhd);
 				return -EIO;
 			}
-			error = uhd_usrp_get_rx_antenna(usrp, channel, got_antenna, sizeof(got_antenna));
+			error = uhd_usrp_get_rx_antenna(uhd->usrp, channel, got_antenna, sizeof(got_antenna));
 			if (error) {
 				LOGP(DUHD, LOGL_ERROR, "Failed to get RX antenna\n");
-				uhd_close();
+				uhd_close(uhd);
 				return -EINVAL;
 			}
 			if (!!strcasecmp(rx_antenna, got_antenna)) {
 				LOGP(DUHD, LOGL_NOTICE, "Given RX antenna '%s' was accepted, but driver claims to use '%s'\n", rx_antenna, got_antenna);
-				uhd_close();
+				uhd_close(uhd);
 				return -EINVAL;
 			}
 		}
-		/* create streamers */
-		error = uhd_rx_streamer_make(&rx_streamer);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to create RX streamer\n");
-			uhd_close();
-			return -EIO;
-		}
-
-		/* create metadata */
-		error = uhd_rx_metadata_make(&rx_metadata);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to create RX metadata\n");
-			uhd_close();
-			return -EIO;
-		}
-
 		/* set rate */
-		error = uhd_usrp_set_rx_rate(usrp, rate, channel);
+		error = uhd_usrp_set_rx_rate(uhd->usrp, rate, channel);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set RX rate to %.0f Hz\n", rate);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what rate actually is */
-		error = uhd_usrp_get_rx_rate(usrp, channel, &got_rate);
+		error = uhd_usrp_get_rx_rate(uhd->usrp, channel, &got_rate);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get RX rate\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_rate - rate) > 1.0) {
 			LOGP(DUHD, LOGL_ERROR, "Given RX rate %.0f Hz is not supported, try %.0f Hz\n", rate, got_rate);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 
 		/* set gain */
-		error = uhd_usrp_set_rx_gain(usrp, rx_gain, channel, "");
+		error = uhd_usrp_set_rx_gain(uhd->usrp, rx_gain, channel, "");
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set RX gain to %.0f\n", rx_gain);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what gain actually is */
-		error = uhd_usrp_get_rx_gain(usrp, channel, "", &got_gain);
+		error = uhd_usrp_get_rx_gain(uhd->usrp, channel, "", &got_gain);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get RX gain\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_gain - rx_gain) > 0.001) {
@@ -424,75 +697,71 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 		}
 
 		/* set frequency */
-		memset(&tune_request, 0, sizeof(tune_request));
-		tune_request.target_freq = rx_frequency;
+		memset(&uhd->tune_request, 0, sizeof(uhd->tune_request));
+		uhd->tune_request.target_freq = rx_frequency;
 		if (lo_offset) {
-			tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_MANUAL;
-			tune_request.rf_freq = rx_frequency + lo_offset;
+			uhd->tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_MANUAL;
+			uhd->tune_request.rf_freq = rx_frequency + lo_offset;
 		} else
-			tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
-		tune_request.dsp_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
-		tune_request.args = options_strdup(_tune_args);
-		error = uhd_usrp_set_rx_freq(usrp, &tune_request, channel, &tune_result);
+			uhd->tune_request.rf_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
+		uhd->tune_request.dsp_freq_policy = UHD_TUNE_REQUEST_POLICY_AUTO;
+		uhd->tune_request.args = options_strdup(_tune_args);
+		error = uhd_usrp_set_rx_freq(uhd->usrp, &uhd->tune_request, channel, &uhd->tune_result);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set RX frequency to %.0f Hz\n", rx_frequency);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what frequency actually is */
-		error = uhd_usrp_get_rx_freq(usrp, channel, &got_frequency);
+		error = uhd_usrp_get_rx_freq(uhd->usrp, channel, &got_frequency);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get RX frequency\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_frequency - rx_frequency) > 100.0) {
 			LOGP(DUHD, LOGL_ERROR, "Given RX frequency %.0f Hz is not supported, try %.0f Hz\n", rx_frequency, got_frequency);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 
 		/* set bandwidth */
-		if (uhd_usrp_set_rx_bandwidth(usrp, bandwidth, channel) != 0) {
+		if (uhd_usrp_set_rx_bandwidth(uhd->usrp, bandwidth, channel) != 0) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to set RX bandwidth to %.0f Hz\n", bandwidth);
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 
 		/* see what bandwidth actually is */
-		error = uhd_usrp_get_rx_bandwidth(usrp, channel, &got_bandwidth);
+		error = uhd_usrp_get_rx_bandwidth(uhd->usrp, channel, &got_bandwidth);
 		if (error) {
 			LOGP(DUHD, LOGL_ERROR, "Failed to get RX bandwidth\n");
-			uhd_close();
+			uhd_close(uhd);
 			return -EIO;
 		}
 		if (fabs(got_bandwidth - bandwidth) > 100.0) {
 			LOGP(DUHD, LOGL_ERROR, "Given RX bandwidth %.0f Hz is not supported, try %.0f Hz\n", bandwidth, got_bandwidth);
-			uhd_close();
+			uhd_close(uhd);
 			return -EINVAL;
 		}
 
-		/* set up streamer */
-		memset(&stream_args, 0, sizeof(stream_args));
-		stream_args.cpu_format = "fc32";
-		stream_args.otw_format = "sc16";
-		stream_args.args = options_strdup(_stream_args);
-		stream_args.channel_list = &channel;
-		stream_args.n_channels = 1;
-		error = uhd_usrp_get_rx_stream(usrp, &stream_args, rx_streamer);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to set RX streamer args\n");
-			uhd_close();
-			return -EIO;
+		/* set up streamer, a MIMO stream is set up when starting */
+		if (uhd->mimo)
+			rc = mimo_add_channel(uhd->mimo->rx, &uhd->mimo->rx_num, uhd);
+		else
+			rc = create_rx_streamer(uhd, &uhd->channel, 1, _stream_args);
+		if (rc < 0) {
+			uhd_close(uhd);
+			return rc;
 		}
-
-		/* get buffer sizes */
-		error = uhd_rx_streamer_max_num_samps(rx_streamer, &rx_samps_per_buff);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to get RX streamer sample buffer\n");
-			uhd_close();
-			return -EIO;
+		if (!uhd->mimo && uhd->wire_format != SDR_WIRE_CF32) {
+			uhd->rx_wire_buff = malloc(uhd->rx_samps_per_buff * wire_format_size(uhd->wire_format));
+			if (!uhd->rx_wire_buff) {
+				LOGP(DUHD, LOGL_ERROR, "No mem!\n");
+				uhd_close(uhd);
+				return -ENOMEM;
+			}
 		}
 	}
 
@@ -500,15 +769,28 @@ int uhd_open(size_t channel, const char *_device_args, const char *_stream_args,
 }
 
 /* start streaming */
-int uhd_start(void)
+int uhd_start(uhd_t *uhd)
 {
 	uhd_error error;
+	int rc = 0;
+
+	/* the first channel starts the MIMO stream */
+	if (uhd->mimo) {
+		pthread_mutex_lock(&uhd->mimo->mutex);
+		if (!uhd->mimo->started) {
+			rc = mimo_start(uhd->mimo);
+			if (rc == 0)
+				uhd->mimo->started = 1;
+		}
+		pthread_mutex_unlock(&uhd->mimo->mutex);
+		return rc;
+	}
 
 	/* enable rx stream */
-	memset(&stream_cmd, 0, sizeof(stream_cmd));
-	stream_cmd.stream_mode = UHD_STREAM_MODE_START_CONTINUOUS;
-	stream_cmd.stream_now = true;
-	error = uhd_rx_streamer_issue_stream_cmd(rx_streamer, &stream_cmd);
+	memset(&uhd->stream_cmd, 0, sizeof(uhd->stream_cmd));
+	uhd->stream_cmd.stream_mode = UHD_STREAM_MODE_START_CONTINUOUS;
+	uhd->stream_cmd.stream_now = true;
+	error = uhd_rx_streamer_issue_stream_cmd(uhd->rx_streamer, &uhd->stream_cmd);
 	if (error) {
 		LOGP(DUHD, LOGL_ERROR, "Failed to issue RX stream command\n");
 		return -EIO;
@@ -516,57 +798,174 @@ int uhd_start(void)
 	return 0;
 }
 
-void uhd_close(void)
+void uhd_close(uhd_t *uhd)
 {
 	LOGP(DUHD, LOGL_DEBUG, "Clean up UHD\n");
-	if (tx_metadata)
-        	uhd_tx_metadata_free(&tx_metadata);
-	if (rx_metadata)
-        	uhd_rx_metadata_free(&rx_metadata);
-	if (tx_streamer)
-	        uhd_tx_streamer_free(&tx_streamer);
-	if (rx_streamer)
-	        uhd_rx_streamer_free(&rx_streamer);
-	if (usrp)
-	        uhd_usrp_free(&usrp);
+	/* the USRP is freed by the last channel of a MIMO stream */
+	if (uhd->mimo) {
+		mimo_detach(uhd);
+		uhd->usrp = NULL;
+	}
+	if (uhd->tx_metadata)
+        	uhd_tx_metadata_free(&uhd->tx_metadata);
+	if (uhd->rx_metadata)
+        	uhd_rx_metadata_free(&uhd->rx_metadata);
+	if (uhd->tx_streamer)
+	        uhd_tx_streamer_free(&uhd->tx_streamer);
+	if (uhd->rx_streamer)
+	        uhd_rx_streamer_free(&uhd->rx_streamer);
+	if (uhd->usrp)
+	        uhd_usrp_free(&uhd->usrp);
+	free(uhd->tx_wire_buff);
+	uhd->tx_wire_buff = NULL;
+	free(uhd->rx_wire_buff);
+	uhd->rx_wire_buff = NULL;
+}
+
+/* advance TX time stamp by given number of samples */
+static void tx_time_advance(uhd_t *uhd, size_t count)
+{
+	uhd->tx_time_fract_sec += (double)count / uhd->samplerate;
+	while (uhd->tx_time_fract_sec >= 1.0) {
+		uhd->tx_time_secs++;
+		uhd->tx_time_fract_sec -= 1.0;
+	}
 }
 
-int uhd_send(float *buff, int num)
+/* send one packet of all channels, return number of samples that have been sent */
+static size_t send_packet(uhd_t *uhd, const void **buffs_ptr, int chunk)
+{
+	size_t count = 0;
+	uhd_error error;
+
+	/* create tx metadata, the first packet after a gap starts a new burst */
+	if (uhd->tx_timestamps) {
+		error = uhd_tx_metadata_make(&uhd->tx_metadata, true, uhd->tx_time_secs, uhd->tx_time_fract_sec, uhd->tx_gap, false);
+		uhd->tx_gap = 0;
+	} else
+		error = uhd_tx_metadata_make(&uhd->tx_metadata, false, 0, 0.0, false, false);
+	if (error)
+		LOGP(DUHD, LOGL_ERROR, "Failed to create TX metadata\n");
+	error = uhd_tx_streamer_send(uhd->tx_streamer, buffs_ptr, chunk, &uhd->tx_metadata, 1.0, &count);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to write to TX streamer\n");
+		return 0;
+	}
+
+	/* increment time stamp */
+	tx_time_advance(uhd, count);
+//printf("adv=%.3f\n", ((double)uhd->tx_time_secs + uhd->tx_time_fract_sec) - ((double)uhd->rx_time_secs + uhd->rx_time_fract_sec));
+
+	return count;
+}
+
+/* receive one packet of all channels, return number of samples that have been received */
+static size_t recv_packet(uhd_t *uhd, void **buffs_ptr, double timeout)
+{
+	size_t count = 0;
+	uhd_error error;
+	bool has_time_spec;
+	int rc;
+
+	error = uhd_rx_streamer_recv(uhd->rx_streamer, buffs_ptr, uhd->rx_samps_per_buff, &uhd->rx_metadata, timeout, false, &count);
+	if (error) {
+		LOGP(DUHD, LOGL_ERROR, "Failed to read from UHD device.\n");
+		return 0;
+	}
+	if (!count)
+		return 0;
+
+	if (uhd->tx_timestamps) {
+		/* get time stamp of received RX packet */
+		rc = uhd_rx_metadata_has_time_spec(uhd->rx_metadata, &has_time_spec);
+		if (rc == 0 && has_time_spec)
+			rc = uhd_rx_metadata_time_spec(uhd->rx_metadata, &uhd->rx_time_secs, &uhd->rx_time_fract_sec);
+		if (rc < 0 || !has_time_spec) {
+			LOGP(DSOAPY, LOGL_ERROR, "SDR RX: No time stamps available. This may cuse little gaps and problems with time slot based networks, like C-Netz.\n");
+			uhd->tx_timestamps = 0;
+		}
+	}
+	if (!uhd->tx_timestamps) {
+		/* increment time stamp */
+		uhd->rx_time_fract_sec += (double)count / uhd->samplerate;
+		if (uhd->rx_time_fract_sec >= 1.0) {
+			uhd->rx_time_secs++;
+			uhd->rx_time_fract_sec -= 1.0;
+		}
+	}
+
+	return count;
+}
+
+/* queue samples of this channel and send what is queued for all channels of the MIMO stream */
+static int mimo_send(uhd_t *uhd, float *buff, int num)
+{
+	struct uhd_mimo *mimo = uhd->mimo;
+	uhd_t *shared = &mimo->shared;
+	const void *buffs_ptr[MIMO_MAX_CHANNELS];
+	void *span[MIMO_MAX_CHANNELS];
+	int chunk, len, i;
+	size_t count;
+
+	pthread_mutex_lock(&mimo->mutex);
+	if (mimo->closing) {
+		pthread_mutex_unlock(&mimo->mutex);
+		return 0;
+	}
+	if (ringbuffer_write(&uhd->tx_ring, buff, num) < num)
+		LOGP(DUHD, LOGL_ERROR, "TX buffer of channel %zu overflows, other channels of MIMO stream do not send.\n", uhd->channel);
+
+	while (1) {
+		chunk = shared->tx_samps_per_buff;
+		for (i = 0; i < mimo->tx_num; i++) {
+			len = ringbuffer_read_span(&mimo->tx[i]->tx_ring, &span[i]);
+			if (len < chunk)
+				chunk = len;
+		}
+		if (!chunk)
+			break;
+		for (i = 0; i < mimo->tx_num; i++) {
+			if (mimo->tx[i]->tx_wire_buff) {
+				/* convert to native stream format */
+				wire_format_from_float(shared->wire_format, span[i], mimo->tx[i]->tx_wire_buff, chunk);
+				buffs_ptr[i] = mimo->tx[i]->tx_wire_buff;
+			} else
+				buffs_ptr[i] = span[i];
+		}
+		count = send_packet(shared, buffs_ptr, chunk);
+		if (count == 0)
+			break;
+		for (i = 0; i < mimo->tx_num; i++)
+			ringbuffer_read_release(&mimo->tx[i]->tx_ring, count);
+	}
+	pthread_mutex_unlock(&mimo->mutex);
+
+	return num;
+}
+
+int uhd_send(uhd_t *uhd, float *buff, int num)
 {
     	const void *buffs_ptr[1];
 	int chunk;
 	size_t sent = 0, count;
-	uhd_error error;
+
+	if (uhd->mimo)
+		return mimo_send(uhd, buff, num);
 
 	while (num) {
 		chunk = num;
-		if (chunk > (int)tx_samps_per_buff)
-			chunk = (int)tx_samps_per_buff;
-		/* create tx metadata */
-		if (tx_timestamps)
-			error = uhd_tx_metadata_make(&tx_metadata, true, tx_time_secs, tx_time_fract_sec, false, false);
-		else
-			error = uhd_tx_metadata_make(&tx_metadata, false, 0, 0.0, false, false);
-		if (error)
-			LOGP(DUHD, LOGL_ERROR, "Failed to create TX metadata\n");
-		buffs_ptr[0] = buff;
-		count = 0;
-		error = uhd_tx_streamer_send(tx_streamer, buffs_ptr, chunk, &tx_metadata, 1.0, &count);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to write to TX streamer\n");
-			break;
-		}
+		if (chunk > (int)uhd->tx_samps_per_buff)
+			chunk = (int)uhd->tx_samps_per_buff;
+		if (uhd->tx_wire_buff) {
+			/* convert to native stream format */
+			wire_format_from_float(uhd->wire_format, buff, uhd->tx_wire_buff, chunk);
+			buffs_ptr[0] = uhd->tx_wire_buff;
+		} else
+			buffs_ptr[0] = buff;
+		count = send_packet(uhd, buffs_ptr, chunk);
 		if (count == 0)
 			break;
 
-		/* increment time stamp */
-		tx_time_fract_sec += (double)count / samplerate;
-		if (tx_time_fract_sec >= 1.0) {
-			tx_time_secs++;
-			tx_time_fract_sec -= 1.0;
-		}
-//printf("adv=%.3f\n", ((double)tx_time_secs + tx_time_fract_sec) - ((double)rx_time_secs + rx_time_fract_sec));
-
 		sent += count;
 		buff += count * 2;
 		num -= count;
@@ -575,48 +974,91 @@ int uhd_send(float *buff, int num)
 	return sent;
 }
 
-/* read what we got, return 0, if buffer is empty, otherwise return the number of samples */
-int uhd_receive(float *buff, int max)
+/* do not transmit the given number of samples: end the current burst and
+ * skip the time stamp, so that the next burst is transmitted in time */
+int uhd_send_gap(uhd_t *uhd, int num)
+{
+	const void *buffs_ptr[1];
+	size_t count = 0;
+	uhd_error error;
+
+	if (!uhd->tx_timestamps || uhd->mimo)
+		return 0;
+
+	if (!uhd->tx_gap) {
+		buffs_ptr[0] = uhd->tx_wire_buff;
+		error = uhd_tx_metadata_make(&uhd->tx_metadata, true, uhd->tx_time_secs, uhd->tx_time_fract_sec, false, true);
+		if (error)
+			LOGP(DUHD, LOGL_ERROR, "Failed to create TX metadata\n");
+		error = uhd_tx_streamer_send(uhd->tx_streamer, buffs_ptr, 0, &uhd->tx_metadata, 1.0, &count);
+		if (error)
+			LOGP(DUHD, LOGL_ERROR, "Failed to end burst of TX streamer\n");
+		uhd->tx_gap = 1;
+	}
+	tx_time_advance(uhd, num);
+
+	return num;
+}
+
+/* receive packets of all channels of the MIMO stream, until this channel has enough samples */
+static int mimo_receive(uhd_t *uhd, float *buff, int max, double timeout)
+{
+	struct uhd_mimo *mimo = uhd->mimo;
+	uhd_t *shared = &mimo->shared;
+	void *buffs_ptr[MIMO_MAX_CHANNELS];
+	size_t count;
+	int got, i;
+
+	pthread_mutex_lock(&mimo->mutex);
+	if (mimo->closing) {
+		pthread_mutex_unlock(&mimo->mutex);
+		return 0;
+	}
+	while (ringbuffer_fill(&uhd->rx_ring) + (int)shared->rx_samps_per_buff <= max) {
+		for (i = 0; i < mimo->rx_num; i++)
+			buffs_ptr[i] = (mimo->rx[i]->rx_wire_buff) ? mimo->rx[i]->rx_wire_buff : (void *)mimo->rx_buff[i];
+		count = recv_packet(shared, buffs_ptr, timeout);
+		timeout = 0.0;
+		if (count == 0)
+			break;
+		/* interleaved samples of each channel go to the channel's buffer */
+		for (i = 0; i < mimo->rx_num; i++) {
+			if (mimo->rx[i]->rx_wire_buff)
+				iq_correct_to_float(mimo->rx[i]->rx_correct, shared->wire_format, mimo->rx[i]->rx_wire_buff, mimo->rx_buff[i], count);
+			if (ringbuffer_write(&mimo->rx[i]->rx_ring, mimo->rx_buff[i], count) < (int)count)
+				sdr_rx_overflow = 1;
+		}
+	}
+	got = ringbuffer_read(&uhd->rx_ring, buff, max);
+	pthread_mutex_unlock(&mimo->mutex);
+
+	return got;
+}
+
+/* read what we got, return 0, if buffer is empty, otherwise return the number of samples
+ * wait up to 'timeout' seconds for the first packet */
+int uhd_receive(uhd_t *uhd, float *buff, int max, double timeout)
 {
     	void *buffs_ptr[1];
 	size_t got = 0, count;
-	uhd_error error;
-	bool has_time_spec;
-	int rc;
+
+	if (uhd->mimo)
+		return mimo_receive(uhd, buff, max, timeout);
 
 	while (1) {
-		if (max < (int)rx_samps_per_buff) {
+		if (max < (int)uhd->rx_samps_per_buff) {
 			/* no more space this time */
 			sdr_rx_overflow = 1;
 			break;
 		}
 		/* read RX stream */
-		buffs_ptr[0] = buff;
-		count = 0;
-		error = uhd_rx_streamer_recv(rx_streamer, buffs_ptr, rx_samps_per_buff, &rx_metadata, 0.0, false, &count);
-		if (error) {
-			LOGP(DUHD, LOGL_ERROR, "Failed to read from UHD device.\n");
-			break;
-		}
+		buffs_ptr[0] = (uhd->rx_wire_buff) ? uhd->rx_wire_buff : buff;
+		count = recv_packet(uhd, buffs_ptr, timeout);
+		timeout = 0.0;
 		if (count) {
-			if (tx_timestamps) {
-				/* get time stamp of received RX packet */
-				rc = uhd_rx_metadata_has_time_spec(rx_metadata, &has_time_spec);
-				if (rc == 0 && has_time_spec)
-					rc = uhd_rx_metadata_time_spec(rx_metadata, &rx_time_secs, &rx_time_fract_sec);
-				if (rc < 0 || !has_time_spec) {
-					LOGP(DSOAPY, LOGL_ERROR, "SDR RX: No time stamps available. This may cuse little gaps and problems with time slot based networks, like C-Netz.\n");
-					tx_timestamps = 0;
-				}
-			}
-			if (!tx_timestamps) {
-				/* increment time stamp */
-				rx_time_fract_sec += (double)count / samplerate;
-				if (rx_time_fract_sec >= 1.0) {
-					rx_time_secs++;
-					rx_time_fract_sec -= 1.0;
-				}
-			}
+			/* convert from native stream format */
+			if (uhd->rx_wire_buff)
+				iq_correct_to_float(uhd->rx_correct, uhd->wire_format, uhd->rx_wire_buff, buff, count);
 			/* commit received data to buffer */
 			got += count;
 			buff += count * 2;
@@ -631,36 +1073,45 @@ int uhd_receive(float *buff, int max)
 }
 
 /* estimate number of samples that can be sent */
-int uhd_get_tosend(int buffer_size)
+int uhd_get_tosend(uhd_t *uhd, int buffer_size)
 {
 	double advance;
 	int tosend;
 
+	/* samples of this channel that are queued for the MIMO stream are sent in advance too */
+	if (uhd->mimo) {
+		pthread_mutex_lock(&uhd->mimo->mutex);
+		tosend = uhd_get_tosend(&uhd->mimo->shared, buffer_size) - ringbuffer_fill(&uhd->tx_ring);
+		pthread_mutex_unlock(&uhd->mimo->mutex);
+		return (tosend < 0) ? 0 : tosend;
+	}
+
 	/* we need the rx time stamp to determine how much data is already sent in advance */
-	if (rx_time_secs == 0 && rx_time_fract_sec == 0.0)
+	if (uhd->rx_time_secs == 0 && uhd->rx_time_fract_sec == 0.0)
 		return 0;
 
 	/* if we have not yet sent any data, we set initial tx time stamp */
-	if (tx_time_secs == 0 && tx_time_fract_sec == 0.0) {
-		tx_time_secs = rx_time_secs;
-		tx_time_fract_sec = rx_time_fract_sec;
-		if (tx_timestamps) {
-			tx_time_fract_sec += (double)buffer_size / samplerate;
-			if (tx_time_fract_sec >= 1.0) {
-				tx_time_fract_sec -= 1.0;
-				tx_time_secs++;
+	if (uhd->tx_time_secs == 0 && uhd->tx_time_fract_sec == 0.0) {
+		uhd->tx_time_secs = uhd->rx_time_secs;
+		uhd->tx_time_fract_sec = uhd->rx_time_fract_sec;
+		if (uhd->tx_timestamps) {
+			uhd->tx_time_fract_sec += (double)buffer_size / uhd->samplerate;
+			if (uhd->tx_time_fract_sec >= 1.0) {
+				uhd->tx_time_fract_sec -= 1.0;
+				uhd->tx_time_secs++;
 			}
 		}
 	}
 
 	/* we check how advance our transmitted time stamp is */
-	advance = ((double)tx_time_secs + tx_time_fract_sec) - ((double)rx_time_secs + rx_time_fract_sec);
+	advance = ((double)uhd->tx_time_secs + uhd->tx_time_fract_sec) - ((double)uhd->rx_time_secs + uhd->rx_time_fract_sec);
 	/* in case of underrun: */
 	if (advance < 0) {
 		LOGP(DSOAPY, LOGL_ERROR, "SDR TX underrun, seems we are too slow. Use lower SDR sample rate.\n");
+		sdr_tx_underrun = 1;
 		advance = 0;
 	}
-	tosend = buffer_size - (int)(advance * samplerate);
+	tosend = buffer_size - (int)(advance * uhd->samplerate);
 	if (tosend < 0)
 		tosend = 0;
 
@@ -1,8 +1,44 @@
+#ifndef _LIBSDR_UHD_H
+#define _LIBSDR_UHD_H
 
-int uhd_open(size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps);
-int uhd_start(void);
-void uhd_close(void);
-int uhd_send(float *buff, int num);
-int uhd_receive(float *buff, int max);
-int uhd_get_tosend(int buffer_size);
+#include <uhd/usrp/usrp.h>
+#include "../libsample/ringbuffer.h"
+#include "iq_correct.h"
 
+/* instance of one UHD device */
+typedef struct uhd {
+	uhd_usrp_handle		usrp;
+	uhd_tx_streamer_handle	tx_streamer;
+	uhd_rx_streamer_handle	rx_streamer;
+	uhd_tx_metadata_handle	tx_metadata;
+	uhd_rx_metadata_handle	rx_metadata;
+	uhd_tune_request_t	tune_request;
+	uhd_tune_result_t	tune_result;
+	uhd_stream_args_t	stream_args;
+	uhd_stream_cmd_t	stream_cmd;
+	size_t			tx_samps_per_buff, rx_samps_per_buff;
+	double			samplerate;
+	time_t			rx_time_secs;
+	double			rx_time_fract_sec;
+	time_t			tx_time_secs;
+	double			tx_time_fract_sec;
+	int			tx_timestamps;
+	int			tx_gap;		/* burst was ended, next packet starts a new one */
+	int			wire_format;	/* SDR_WIRE_* */
+	void			*tx_wire_buff;	/* conversion buffers for integer wire formats */
+	void			*rx_wire_buff;
+	iq_correct_t		*rx_correct;	/* correct DC and IQ imbalance while converting, if set */
+	size_t			channel;
+	struct uhd_mimo		*mimo;		/* channels of one USRP that are streamed together */
+	ringbuffer_t		tx_ring, rx_ring; /* samples of this channel in the MIMO stream */
+} uhd_t;
+
+int uhd_open(uhd_t *uhd, size_t channel, const char *_device_args, const char *_stream_args, const char *_tune_args, const char *tx_antenna, const char *rx_antenna, const char *clock_source, double tx_frequency, double rx_frequency, double lo_offset, double rate, double tx_gain, double rx_gain, double bandwidth, int timestamps, int _wire_format, int mimo);
+int uhd_start(uhd_t *uhd);
+void uhd_close(uhd_t *uhd);
+int uhd_send(uhd_t *uhd, float *buff, int num);
+int uhd_send_gap(uhd_t *uhd, int num);
+int uhd_receive(uhd_t *uhd, float *buff, int max, double timeout);
+int uhd_get_tosend(uhd_t *uhd, int buffer_size);
+
+#endif /* _LIBSDR_UHD_H */
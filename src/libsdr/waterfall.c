@@ -0,0 +1,250 @@
+/* Recorder of spectrum waterfall
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The DSP path copies a short capture of the IQ stream at each line interval
+ * into a ring buffer, the rest of the stream is skipped. If the ring is
+ * full, the line is dropped, so the DSP path never waits. A background thread
+ * takes the capture in blocks of FFT size, applies a Hann window and averages
+ * the power of all blocks into one line.
+ *
+ * The file starts with a header of 32 bytes (little endian):
+ *
+ *   char[8]   "WATERFAL"
+ *   uint32    version (1)
+ *   uint32    FFT size (number of bins)
+ *   double    sample rate
+ *   double    center frequency
+ *
+ * Each line follows with a double of the start time (UNIX time) and one byte
+ * for each bin, from lowest to highest frequency. A byte of value v is a power
+ * of -v/2 dB relative to a carrier with full scale amplitude, so a line covers
+ * 0 .. -127.5 dBFS.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
+#include "waterfall.h"
+
+#define WATERFALL_FFT_M		10	/* 1024 bins */
+#define WATERFALL_AVERAGES	16	/* spectra of each line */
+#define WATERFALL_LINES		8	/* lines that can be queued towards thread */
+#define WATERFALL_POLL		10000	/* interval of thread (us) */
+
+static double real_time(void)
+{
+	struct timespec tv;
+
+	clock_gettime(CLOCK_REALTIME, &tv);
+
+	return (double)tv.tv_sec + (double)tv.tv_nsec / 1000000000.0;
+}
+
+static void write_line(waterfall_t *wf, double time)
+{
+	int n = wf->fft_size, i, v;
+	double db;
+
+	for (i = 0; i < n; i++) {
+		/* lowest frequency first */
+		db = 10.0 * log10(wf->power[(i + n / 2) % n] / (double)wf->averages / wf->window_power + 1e-30);
+		v = (int)(-db * 2.0 + 0.5);
+		wf->line[i] = (v < 0) ? 0 : ((v > 255) ? 255 : v);
+	}
+	fwrite(&time, sizeof(time), 1, wf->fp);
+	fwrite(wf->line, 1, n, wf->fp);
+	wf->lines++;
+}
+
+static void *waterfall_thread(void *arg)
+{
+	waterfall_t *wf = arg;
+	int n = wf->fft_size, block = 0, i;
+	double time = 0.0;
+
+	thread_prio_apply(THREAD_WAVE);
+
+	while (!atomic_load(&wf->quit)) {
+		if (ringbuffer_fill(&wf->iq_ring) < n) {
+			usleep(WATERFALL_POLL);
+			continue;
+		}
+		if (block == 0) {
+			ringbuffer_read(&wf->time_ring, &time, 1);
+			memset(wf->power, 0, n * sizeof(*wf->power));
+		}
+		ringbuffer_read(&wf->iq_ring, wf->data, n);
+		for (i = 0; i < n; i++) {
+			wf->data[i * 2] *= wf->window[i];
+			wf->data[i * 2 + 1] *= wf->window[i];
+		}
+		fft_plan_complex(&wf->plan, 1, wf->data);
+		for (i = 0; i < n; i++)
+			wf->power[i] += (double)wf->data[i * 2] * wf->data[i * 2] + (double)wf->data[i * 2 + 1] * wf->data[i * 2 + 1];
+		if (++block == wf->averages) {
+			write_line(wf, time);
+			block = 0;
+		}
+	}
+
+	return NULL;
+}
+
+/* rate is the number of lines per second */
+int waterfall_open(waterfall_t *wf, const char *filename, int samplerate, double center_frequency, double rate)
+{
+	uint32_t version = 1, size;
+	double rate_d = samplerate, sum = 0.0;
+	int i, rc;
+
+	memset(wf, 0, sizeof(*wf));
+	wf->samplerate = samplerate;
+	wf->fft_size = 1 << WATERFALL_FFT_M;
+	wf->averages = WATERFALL_AVERAGES;
+	wf->line_samples = (int)((double)samplerate / rate);
+	if (wf->line_samples < wf->fft_size * wf->averages) {
+		LOGP(DSDR, LOGL_ERROR, "Waterfall rate of %.1f lines per second is too high for sample rate %d.\n", rate, samplerate);
+		return -EINVAL;
+	}
+
+	rc = fft_plan_init(&wf->plan, WATERFALL_FFT_M);
+	if (rc < 0)
+		return rc;
+	wf->window = calloc(wf->fft_size, sizeof(*wf->window));
+	wf->data = calloc(wf->fft_size * 2, sizeof(*wf->data));
+	wf->power = calloc(wf->fft_size, sizeof(*wf->power));
+	wf->line = calloc(wf->fft_size, 1);
+	if (!wf->window || !wf->data || !wf->power || !wf->line) {
+		LOGP(DSDR, LOGL_ERROR, "No mem!\n");
+		rc = -ENOMEM;
+		goto error;
+	}
+	for (i = 0; i < wf->fft_size; i++) {
+		wf->window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * (double)i / (double)wf->fft_size);
+		sum += wf->window[i];
+	}
+	wf->window_power = sum * sum;
+
+	rc = ringbuffer_init(&wf->iq_ring, wf->fft_size * wf->averages * WATERFALL_LINES + 1, sizeof(float) * 2);
+	if (rc < 0)
+		goto error;
+	rc = ringbuffer_init(&wf->time_ring, WATERFALL_LINES + 1, sizeof(double));
+	if (rc < 0)
+		goto error;
+
+	wf->fp = fopen(filename, "w");
+	if (!wf->fp) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to create waterfall file '%s' (%s).\n", filename, strerror(errno));
+		rc = -errno;
+		goto error;
+	}
+	size = wf->fft_size;
+	fwrite("WATERFAL", 8, 1, wf->fp);
+	fwrite(&version, sizeof(version), 1, wf->fp);
+	fwrite(&size, sizeof(size), 1, wf->fp);
+	fwrite(&rate_d, sizeof(rate_d), 1, wf->fp);
+	fwrite(&center_frequency, sizeof(center_frequency), 1, wf->fp);
+
+	rc = pthread_create(&wf->tid, NULL, waterfall_thread, wf);
+	if (rc) {
+		LOGP(DSDR, LOGL_ERROR, "Failed to create waterfall thread (rc = %d).\n", rc);
+		rc = -rc;
+		goto error;
+	}
+	wf->running = 1;
+
+	LOGP(DSDR, LOGL_INFO, "Recording waterfall with %d bins at %.2f lines per second to '%s'.\n", wf->fft_size, rate, filename);
+
+	return 0;
+
+error:
+	waterfall_close(wf);
+	return rc;
+}
+
+void waterfall_close(waterfall_t *wf)
+{
+	if (wf->running) {
+		atomic_store(&wf->quit, 1);
+		pthread_join(wf->tid, NULL);
+		wf->running = 0;
+		LOGP(DSDR, LOGL_INFO, "Waterfall: %" PRIu64 " lines written, %" PRIu64 " dropped.\n", wf->lines, wf->dropped);
+	}
+	if (wf->fp) {
+		fclose(wf->fp);
+		wf->fp = NULL;
+	}
+	ringbuffer_exit(&wf->iq_ring);
+	ringbuffer_exit(&wf->time_ring);
+	fft_plan_exit(&wf->plan);
+	free(wf->window);
+	free(wf->data);
+	free(wf->power);
+	free(wf->line);
+	wf->window = wf->data = NULL;
+	wf->power = NULL;
+	wf->line = NULL;
+}
+
+/* called by DSP path with interleaved IQ samples */
+void waterfall_feed(waterfall_t *wf, const float *buff, int count)
+{
+	int capture = wf->fft_size * wf->averages;
+	int n;
+	double time;
+
+	while (count) {
+		/* start of line: capture only if the thread has space for it */
+		if (wf->pos == 0) {
+			if (ringbuffer_space(&wf->iq_ring) >= capture && ringbuffer_space(&wf->time_ring) >= 1) {
+				time = real_time();
+				ringbuffer_write(&wf->time_ring, &time, 1);
+				wf->capturing = 1;
+			} else {
+				wf->capturing = 0;
+				wf->dropped++;
+			}
+		}
+		if (wf->pos < capture) {
+			n = capture - wf->pos;
+			if (n > count)
+				n = count;
+			if (wf->capturing)
+				ringbuffer_write(&wf->iq_ring, buff, n);
+		} else {
+			n = wf->line_samples - wf->pos;
+			if (n > count)
+				n = count;
+		}
+		buff += n * 2;
+		count -= n;
+		wf->pos += n;
+		if (wf->pos == wf->line_samples)
+			wf->pos = 0;
+	}
+}
+
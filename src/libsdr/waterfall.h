@@ -0,0 +1,33 @@
+
+#include <pthread.h>
+#include "../libsample/ringbuffer.h"
+#include "../libfft/fft.h"
+
+/* recorder of averaged power spectra */
+typedef struct waterfall {
+	FILE		*fp;
+	int		samplerate;
+	int		fft_size;
+	int		averages;	/* spectra that are averaged for each line */
+	int		line_samples;	/* samples between start of lines */
+	int		pos;		/* position within line interval (DSP path) */
+	int		capturing;	/* line is being captured (DSP path) */
+	ringbuffer_t	iq_ring;	/* captured IQ samples towards thread */
+	ringbuffer_t	time_ring;	/* start time of captured lines */
+	fft_plan_t	plan;
+	float		*window;
+	float		*data;
+	double		*power;
+	uint8_t		*line;
+	double		window_power;	/* power of window, to normalize */
+	pthread_t	tid;
+	int		running;
+	atomic_int	quit;
+	uint64_t	lines;		/* lines written */
+	uint64_t	dropped;	/* lines not captured, because thread was behind */
+} waterfall_t;
+
+int waterfall_open(waterfall_t *wf, const char *filename, int samplerate, double center_frequency, double rate);
+void waterfall_close(waterfall_t *wf);
+void waterfall_feed(waterfall_t *wf, const float *buff, int count);
+
@@ -0,0 +1,110 @@
+/* Conversion between float baseband and native integer IQ stream formats
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Streaming CS16 or CS8 instead of CF32 lets the driver pass the samples
+ * as they come from the device. The conversion is done here in simple
+ * loops without branches, so the compiler can vectorize them.
+ *
+ * Float samples are expected to be within -1.0 .. 1.0 (LIMIT_IQ_LEVEL),
+ * so no clipping is required when converting to integer.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "wire_format.h"
+
+int wire_format_parse(const char *name)
+{
+	if (!strcmp(name, "cf32"))
+		return SDR_WIRE_CF32;
+	if (!strcmp(name, "cs16"))
+		return SDR_WIRE_CS16;
+	if (!strcmp(name, "cs8"))
+		return SDR_WIRE_CS8;
+	return -1;
+}
+
+const char *wire_format_name(int format)
+{
+	switch (format) {
+	case SDR_WIRE_CS16:
+		return "cs16";
+	case SDR_WIRE_CS8:
+		return "cs8";
+	default:
+		return "cf32";
+	}
+}
+
+/* bytes per IQ pair */
+int wire_format_size(int format)
+{
+	switch (format) {
+	case SDR_WIRE_CS16:
+		return 2 * sizeof(int16_t);
+	case SDR_WIRE_CS8:
+		return 2 * sizeof(int8_t);
+	default:
+		return 2 * sizeof(float);
+	}
+}
+
+/* convert num IQ pairs from float to given format */
+void wire_format_from_float(int format, const float *in, void *out, int num)
+{
+	int16_t *out16 = out;
+	int8_t *out8 = out;
+	int i;
+
+	num *= 2;
+	switch (format) {
+	case SDR_WIRE_CS16:
+		for (i = 0; i < num; i++)
+			out16[i] = (int16_t)(in[i] * 32767.0f);
+		break;
+	case SDR_WIRE_CS8:
+		for (i = 0; i < num; i++)
+			out8[i] = (int8_t)(in[i] * 127.0f);
+		break;
+	default:
+		memcpy(out, in, num * sizeof(float));
+	}
+}
+
+/* convert num IQ pairs from given format to float */
+void wire_format_to_float(int format, const void *in, float *out, int num)
+{
+	const int16_t *in16 = in;
+	const int8_t *in8 = in;
+	int i;
+
+	num *= 2;
+	switch (format) {
+	case SDR_WIRE_CS16:
+		for (i = 0; i < num; i++)
+			out[i] = (float)in16[i] * (1.0f / 32768.0f);
+		break;
+	case SDR_WIRE_CS8:
+		for (i = 0; i < num; i++)
+			out[i] = (float)in8[i] * (1.0f / 128.0f);
+		break;
+	default:
+		memcpy(out, in, num * sizeof(float));
+	}
+}
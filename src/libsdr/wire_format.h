@@ -0,0 +1,15 @@
+#ifndef _WIRE_FORMAT_H
+#define _WIRE_FORMAT_H
+
+/* sample format of IQ stream between driver and host */
+#define SDR_WIRE_CF32	0	/* complex float, driver converts */
+#define SDR_WIRE_CS16	1	/* complex int16 */
+#define SDR_WIRE_CS8	2	/* complex int8 */
+
+int wire_format_parse(const char *name);
+const char *wire_format_name(int format);
+int wire_format_size(int format);
+void wire_format_from_float(int format, const float *in, void *out, int num);
+void wire_format_to_float(int format, const void *in, float *out, int num);
+
+#endif /* _WIRE_FORMAT_H */
@@ -70,46 +70,59 @@ void init_sendevolumenregler(sendevolumenregler_t *state, double samplerate, dou
  * 'envelope' will not fall below 'minimum_level' (maximum amplification)
  * if 'peak' is 'maximum_level' above 'envelope', raise 'envelope' to 'maximum_level' below 'peak'
  */
+#define REGLER_BLOCK	64
+
 void sendevolumenregler(sendevolumenregler_t *state, sample_t *samples, int num)
 {
-	double value, peak, envelope, step_up, step_down, maximum_level, minimum_level, db0_level;
-	int i;
+	double value, peak, envelope, step_up_inv, step_down, maximum_level, maximum_level_inv, minimum_level, db0_level_inv;
+	sample_t env[REGLER_BLOCK];
+	int i, n;
 
-	db0_level = state->db0_level;
-	step_up = state->step_up;
+	/* divisions by constants are done as multiplication */
+	db0_level_inv = 1.0 / state->db0_level;
+	step_up_inv = 1.0 / state->step_up;
 	step_down = state->step_down;
 	maximum_level = state->maximum_level;
+	maximum_level_inv = 1.0 / state->maximum_level;
 	minimum_level = state->minimum_level;
 	peak = state->peak;
 	envelope = state->envelope;
 
-	for (i = 0; i < num; i++) {
-		/* normalize sample value to db0_level level */
-		value = *samples / db0_level;
+	/* The envelope is tracked for a block of samples, then the samples of
+	 * the block are divided by it in a loop that the compiler vectorizes.
+	 * The level is normalized to db0_level for tracking only, because
+	 * normalizing and restoring the samples cancels out.
+	 */
+	for (; num > 0; num -= n, samples += n) {
+		n = (num < REGLER_BLOCK) ? num : REGLER_BLOCK;
+		for (i = 0; i < n; i++) {
+			value = fabs(samples[i]) * db0_level_inv;
 
-		/* 'peak' is the level that raises directly with the value
-		 * level, but falls as specified by step_up. */
-		if (fabs(value) > peak)
-			peak = fabs(value);
-		else
-			peak /= step_up;
-		/* 'evelope' is the level that raises with the specified step_down
-		 * to 'peak', but falls with 'peak'. */
-		if (peak > envelope)
-			envelope *= step_down;
-		else
-			envelope = peak;
-		/* no envelope below minimum level */
-		if (envelope < minimum_level)
-			envelope = minimum_level;
-		/* raise envelope, if 'peak' exceeds maximum level */ 
-		if (peak / envelope > maximum_level)
-			envelope = peak / maximum_level;
+			/* 'peak' is the level that raises directly with the value
+			 * level, but falls as specified by step_up. */
+			if (value > peak)
+				peak = value;
+			else
+				peak *= step_up_inv;
+			/* 'evelope' is the level that raises with the specified step_down
+			 * to 'peak', but falls with 'peak'. */
+			if (peak > envelope)
+				envelope *= step_down;
+			else
+				envelope = peak;
+			/* no envelope below minimum level */
+			if (envelope < minimum_level)
+				envelope = minimum_level;
+			/* raise envelope, if 'peak' exceeds maximum level */
+			if (peak > envelope * maximum_level)
+				envelope = peak * maximum_level_inv;
 
-		*samples++ = value / envelope * db0_level;
+			env[i] = envelope;
+		}
+		for (i = 0; i < n; i++)
+			samples[i] /= env[i];
 	}
 
 	state->envelope = envelope;
 	state->peak = peak;
 }
-
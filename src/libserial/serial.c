@@ -20,11 +20,13 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
 #include <fcntl.h>
 #include "serial.h"
 
@@ -223,6 +225,8 @@ void serial_close(serial_t *serial)
 	if (serial == 0)
 		return;
 
+	if (serial->poll)
+		serial_poll_remove(serial->poll, serial);
 	tcsetattr(serial->handle,TCSANOW,&serial->old_termios);
 	close(serial->handle);
 	free(serial);
@@ -462,3 +466,167 @@ int serial_handle(serial_t *serial)
 	return serial->handle;
 }
 
+
+/*
+poll = serial_poll_create();
+
+creates an event loop for one or more serial devices. on failure, a NULL
+will be returned and serial_errno is set.
+*/
+
+serial_poll_t *serial_poll_create(void)
+{
+	serial_poll_t *poll;
+
+	serial_errno = 0;
+	poll = calloc(1, sizeof(*poll));
+	if (!poll) {
+		serial_errno = -ENOMEM;
+		serial_errnostr = "not enough memory for handle";
+		return NULL;
+	}
+	poll->epoll_fd = epoll_create1(0);
+	if (poll->epoll_fd < 0) {
+		serial_errno = -EIO;
+		serial_errnostr = "Cannot create epoll.";
+		free(poll);
+		return NULL;
+	}
+
+	return poll;
+}
+
+/*
+serial_poll_destroy(poll);
+
+destroys the event loop. all serial devices must be removed or closed before.
+*/
+
+void serial_poll_destroy(serial_poll_t *poll)
+{
+	if (!poll)
+		return;
+
+	close(poll->epoll_fd);
+	free(poll);
+}
+
+/*
+ok = serial_poll_add(poll, serial, rx_size, receive, priv);
+
+adds the serial device to the event loop. the device is switched to
+non-blocking mode. whenever data is received, up to "rx_size" bytes are read
+at once and given to the "receive" function as one span.
+*/
+
+int serial_poll_add(serial_poll_t *poll, serial_t *serial, int rx_size, void (*receive)(serial_t *serial, void *priv, const uint8_t *data, int len), void *priv)
+{
+	struct epoll_event event;
+	int flags;
+
+	serial_errno = 0;
+	if (!poll || !serial || serial->poll || rx_size <= 0) {
+		serial_errno = -EINVAL;
+		serial_errnostr = "Invalid arguments.";
+		return -1;
+	}
+
+	serial->rx_buffer = malloc(rx_size);
+	if (!serial->rx_buffer) {
+		serial_errno = -ENOMEM;
+		serial_errnostr = "not enough memory for buffer";
+		return -1;
+	}
+	serial->rx_size = rx_size;
+	serial->receive = receive;
+	serial->priv = priv;
+
+	if ((flags = fcntl(serial->handle, F_GETFL, 0)) < 0
+	 || fcntl(serial->handle, F_SETFL, flags | O_NONBLOCK) < 0) {
+		serial_errno = -EIO;
+		serial_errnostr = "Cannot set fcntl.";
+		goto error;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = serial;
+	if (epoll_ctl(poll->epoll_fd, EPOLL_CTL_ADD, serial->handle, &event) < 0) {
+		serial_errno = -EIO;
+		serial_errnostr = "Cannot add to epoll.";
+		goto error;
+	}
+	serial->poll = poll;
+	poll->num++;
+
+	return 0;
+
+error:
+	free(serial->rx_buffer);
+	serial->rx_buffer = NULL;
+	return -1;
+}
+
+/*
+serial_poll_remove(poll, serial);
+
+removes the serial device from the event loop and switches back to blocking
+mode.
+*/
+
+void serial_poll_remove(serial_poll_t *poll, serial_t *serial)
+{
+	int flags;
+
+	if (!poll || !serial || serial->poll != poll)
+		return;
+
+	epoll_ctl(poll->epoll_fd, EPOLL_CTL_DEL, serial->handle, NULL);
+	if ((flags = fcntl(serial->handle, F_GETFL, 0)) >= 0)
+		fcntl(serial->handle, F_SETFL, flags & ~O_NONBLOCK);
+	serial->poll = NULL;
+	poll->num--;
+	free(serial->rx_buffer);
+	serial->rx_buffer = NULL;
+}
+
+/*
+got = serial_poll_wait(poll, timeout_ms);
+
+waits up to "timeout_ms" milliseconds (0 = don't wait, -1 = forever) for
+received data and delivers it to the receive function of each device.
+"got" gives the number of bytes received by all devices, or -1 on error.
+*/
+
+int serial_poll_wait(serial_poll_t *poll, int timeout_ms)
+{
+	struct epoll_event events[16];
+	serial_t *serial;
+	int n, i, len, got = 0;
+
+	serial_errno = 0;
+	if (!poll)
+		return 0;
+
+	n = epoll_wait(poll->epoll_fd, events, 16, timeout_ms);
+	if (n < 0) {
+		/* a signal is no error */
+		if (errno == EINTR)
+			return 0;
+		serial_errno = -EIO;
+		serial_errnostr = "Cannot wait for epoll.";
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		serial = events[i].data.ptr;
+		/* read pending data at once, large spans are read in multiple rounds */
+		len = read(serial->handle, serial->rx_buffer, serial->rx_size);
+		if (len <= 0)
+			continue;
+		got += len;
+		serial->receive(serial, serial->priv, serial->rx_buffer, len);
+	}
+
+	return got;
+}
@@ -20,8 +20,20 @@ typedef struct _serial {
 	int handle;
 	struct termios com_termios;
 	struct termios old_termios;
+
+	/* event driven reception */
+	struct serial_poll *poll;
+	void (*receive)(struct _serial *serial, void *priv, const uint8_t *data, int len);
+	void *priv;
+	uint8_t *rx_buffer;
+	int rx_size;
 } serial_t;
 
+typedef struct serial_poll {
+	int epoll_fd;
+	int num;
+} serial_poll_t;
+
 serial_t *serial_open(const char *serial_device, int serial_baud, int serial_databits, char serial_parity, int serial_stopbits, char serial_xonxoff, char serial_rtscts, int serial_getbreak, float serial_txtimeout, float serial_rxtimeout);
 void serial_close(serial_t *serial);
 int serial_read(serial_t *serial, uint8_t *buffer, size_t size);
@@ -35,4 +47,9 @@ int serial_rtson(serial_t *serial);
 int serial_rtsoff(serial_t *serial);
 int serial_break(serial_t *serial, int on);
 int serial_handle(serial_t *serial);
+serial_poll_t *serial_poll_create(void);
+void serial_poll_destroy(serial_poll_t *poll);
+int serial_poll_add(serial_poll_t *poll, serial_t *serial, int rx_size, void (*receive)(serial_t *serial, void *priv, const uint8_t *data, int len), void *priv);
+void serial_poll_remove(serial_poll_t *poll, serial_t *serial);
+int serial_poll_wait(serial_poll_t *poll, int timeout_ms);
 
@@ -1,5 +1,6 @@
 
 enum paging_signal;
+struct pollfd;
 
 enum sound_direction {
 	SOUND_DIR_PLAY,
@@ -7,12 +8,34 @@ enum sound_direction {
 	SOUND_DIR_DUPLEX,
 };
 
+extern int sound_mmap;
+extern int sound_poll;
+
 void *sound_open(int direction, const char *audiodev, double *tx_frequency, double *rx_frequency, int *am, int channels, double paging_frequency, int samplerate, int buffer_size, double interval, double max_deviation, double max_modulation, double modulation_index);
 int sound_start(void *inst);
 void sound_close(void *inst);
 int sound_write(void *inst, sample_t **samples, uint8_t **power, int num, enum paging_signal *paging_signal, int *on, int channels);
 int sound_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db);
+int sound_get_delay(void *inst);
 int sound_get_tosend(void *inst, int buffer_size);
+int sound_get_poll(void *inst, struct pollfd *pfds, int space);
+int sound_poll_ready(void *inst, struct pollfd *pfds, int num);
+void *sound_aggregate_open(int direction, const char *audiodev, double *tx_frequency, double *rx_frequency, int *am, int channels, double paging_frequency, int samplerate, int buffer_size, double interval, double max_deviation, double max_modulation, double modulation_index);
+int sound_aggregate_start(void *inst);
+void sound_aggregate_close(void *inst);
+int sound_aggregate_write(void *inst, sample_t **samples, uint8_t **power, int num, enum paging_signal *paging_signal, int *on, int channels);
+int sound_aggregate_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db);
+int sound_aggregate_get_tosend(void *inst, int buffer_size);
+int sound_aggregate_get_poll(void *inst, struct pollfd *pfds, int space);
+int sound_aggregate_poll_ready(void *inst, struct pollfd *pfds, int num);
+void *sound_jack_open(int direction, const char *audiodev, double *tx_frequency, double *rx_frequency, int *am, int channels, double paging_frequency, int samplerate, int buffer_size, double interval, double max_deviation, double max_modulation, double modulation_index);
+int sound_jack_start(void *inst);
+void sound_jack_close(void *inst);
+int sound_jack_write(void *inst, sample_t **samples, uint8_t **power, int num, enum paging_signal *paging_signal, int *on, int channels);
+int sound_jack_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db);
+int sound_jack_get_tosend(void *inst, int buffer_size);
+int sound_jack_get_poll(void *inst, struct pollfd *pfds, int space);
+int sound_jack_poll_ready(void *inst, struct pollfd *pfds, int num);
 int sound_is_stereo_capture(void *inst);
 int sound_is_stereo_playback(void *inst);
 
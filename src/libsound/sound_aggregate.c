@@ -0,0 +1,369 @@
+/* Aggregation of sound cards
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Several sound cards are opened as one device, e.g. 'hw:0,0+hw:1,0+hw:2,0'.
+ * Each card carries two channels. A multichannel card carries as many
+ * channels as given after '*', e.g. 'hw:0,0*8+hw:1,0'. The last card may
+ * carry less channels.
+ *
+ * The first card is the clock reference. The playback delay of each other
+ * card is compared with the delay of the reference. A PI loop estimates the
+ * drift of the card's clock from that difference and a fine-step resampler
+ * corrects it, for TX and RX. So all channels are processed in one block
+ * with the buffer target of the reference card.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#ifdef HAVE_MOBILE
+#include "../libmobile/sender.h"
+#else
+#include "sound.h"
+#endif
+
+#define MAX_CARDS	8
+#define MAX_CHANNELS	32
+#define DRIFT_KP	0.05	/* ratio correction per second of delay difference */
+#define DRIFT_KI	0.001	/* ratio correction per second of delay difference and second of time */
+#define DRIFT_MAX	0.001	/* clocks of cards differ by less than 1000 ppm */
+
+/* paging signal is only known by mobile applications */
+#ifdef HAVE_MOBILE
+#define CARD_PAGING(p, card)	((p) ? (p) + (card)->offset : NULL)
+#else
+#define CARD_PAGING(p, card)	NULL
+#endif
+
+/* cubic interpolator with variable ratio, all channels of a card share the position */
+typedef struct drift {
+	double		pos;			/* position of next output after hist[1], in input samples */
+	sample_t	hist[MAX_CHANNELS][4];
+} drift_t;
+
+typedef struct aggregate_card {
+	char		audiodev[64];
+	void		*sound;
+	int		offset;			/* first channel of aggregated device */
+	int		channels;
+	double		ratio;			/* samples of card per sample of reference */
+	double		integral;
+	drift_t		tx_drift, rx_drift;
+	sample_t	*tx_buff[MAX_CHANNELS];	/* TX samples, resampled to card */
+	sample_t	*rx_buff[MAX_CHANNELS];	/* RX samples, as read from card */
+	sample_t	*rx_fifo[MAX_CHANNELS];	/* RX samples, resampled to reference */
+	int		rx_fill;
+} aggregate_card_t;
+
+typedef struct aggregate {
+	enum sound_direction direction;
+	int		num_cards;
+	aggregate_card_t card[MAX_CARDS];
+	int		samplerate;
+	int		buffer_size;
+	int		written;		/* samples written to the reference since last drift update */
+} aggregate_t;
+
+static inline sample_t cubic(const sample_t *h, double mu)
+{
+	double a, b, c;
+
+	a = -0.5 * h[0] + 1.5 * h[1] - 1.5 * h[2] + 0.5 * h[3];
+	b = h[0] - 2.5 * h[1] + 2.0 * h[2] - 0.5 * h[3];
+	c = -0.5 * h[0] + 0.5 * h[2];
+
+	return ((a * mu + b) * mu + c) * mu + h[1];
+}
+
+/* resample by given ratio of output to input samples, return number of output samples */
+static int drift_resample(drift_t *drift, int channels, sample_t **in, int num, sample_t **out, int out_offset, double ratio)
+{
+	double step = 1.0 / ratio, pos = drift->pos;
+	sample_t *h, *o;
+	int c, i, n = 0;
+
+	for (c = 0; c < channels; c++) {
+		h = drift->hist[c];
+		o = out[c] + out_offset;
+		pos = drift->pos;
+		n = 0;
+		for (i = 0; i < num; i++) {
+			h[0] = h[1];
+			h[1] = h[2];
+			h[2] = h[3];
+			h[3] = in[c][i];
+			while (pos < 1.0) {
+				o[n++] = cubic(h, pos);
+				pos += step;
+			}
+			pos -= 1.0;
+		}
+	}
+	drift->pos = pos;
+
+	return n;
+}
+
+/* the delay of a card is compared with the delay of the reference */
+static void drift_update(aggregate_t *agg, aggregate_card_t *card, int diff)
+{
+	double error = (double)diff / (double)agg->samplerate;
+	double dt = (double)agg->written / (double)agg->samplerate;
+
+	/* more samples are queued: the card is slower, so it gets less samples */
+	card->integral += DRIFT_KI * error * dt;
+	if (card->integral > DRIFT_MAX)
+		card->integral = DRIFT_MAX;
+	if (card->integral < -DRIFT_MAX)
+		card->integral = -DRIFT_MAX;
+	card->ratio = 1.0 - (DRIFT_KP * error + card->integral);
+	if (card->ratio > 1.0 + DRIFT_MAX)
+		card->ratio = 1.0 + DRIFT_MAX;
+	if (card->ratio < 1.0 - DRIFT_MAX)
+		card->ratio = 1.0 - DRIFT_MAX;
+}
+
+void *sound_aggregate_open(int direction, const char *audiodev, double *tx_frequency, double *rx_frequency, int *am, int channels, double paging_frequency, int samplerate, int buffer_size, double interval, double max_deviation, double max_modulation, double modulation_index)
+{
+	aggregate_t *agg;
+	aggregate_card_t *card;
+	char devices[256], *dev, *next, *p;
+	int offset = 0, c, size;
+
+	agg = calloc(1, sizeof(*agg));
+	if (!agg) {
+		LOGP(DSOUND, LOGL_ERROR, "No mem!\n");
+		return NULL;
+	}
+	agg->direction = direction;
+	agg->samplerate = samplerate;
+	agg->buffer_size = buffer_size;
+
+	/* resampled buffers differ from nominal size by the drift */
+	size = buffer_size * 2 + 16;
+
+	strncpy(devices, audiodev, sizeof(devices) - 1);
+	devices[sizeof(devices) - 1] = '\0';
+	for (dev = devices; dev; dev = next) {
+		next = strchr(dev, '+');
+		if (next)
+			*next++ = '\0';
+		if (offset == channels) {
+			LOGP(DSOUND, LOGL_ERROR, "Sound card '%s' is not used, there are only %d channels!\n", dev, channels);
+			goto error;
+		}
+		if (agg->num_cards == MAX_CARDS) {
+			LOGP(DSOUND, LOGL_ERROR, "Cannot aggregate more than %d sound cards!\n", MAX_CARDS);
+			goto error;
+		}
+		card = &agg->card[agg->num_cards++];
+		card->channels = 2;
+		if ((p = strchr(dev, '*'))) {
+			*p++ = '\0';
+			card->channels = atoi(p);
+			if (card->channels < 1) {
+				LOGP(DSOUND, LOGL_ERROR, "Invalid number of channels for sound card '%s'!\n", dev);
+				goto error;
+			}
+		}
+		if (card->channels > channels - offset)
+			card->channels = channels - offset;
+		strncpy(card->audiodev, dev, sizeof(card->audiodev) - 1);
+		card->offset = offset;
+		card->ratio = 1.0;
+		offset += card->channels;
+
+		card->sound = sound_open(direction, card->audiodev, (tx_frequency) ? tx_frequency + card->offset : NULL, (rx_frequency) ? rx_frequency + card->offset : NULL, (am) ? am + card->offset : NULL, card->channels, paging_frequency, samplerate, buffer_size, interval, max_deviation, max_modulation, modulation_index);
+		if (!card->sound)
+			goto error;
+
+		/* the reference card is not resampled */
+		if (card == agg->card)
+			continue;
+		for (c = 0; c < card->channels; c++) {
+			card->tx_buff[c] = calloc(size, sizeof(sample_t));
+			card->rx_buff[c] = calloc(size, sizeof(sample_t));
+			card->rx_fifo[c] = calloc(size * 2, sizeof(sample_t));
+			if (!card->tx_buff[c] || !card->rx_buff[c] || !card->rx_fifo[c]) {
+				LOGP(DSOUND, LOGL_ERROR, "No mem!\n");
+				goto error;
+			}
+		}
+		LOGP(DSOUND, LOGL_DEBUG, "Sound card '%s' carries channels %d..%d.\n", card->audiodev, card->offset + 1, card->offset + card->channels);
+	}
+	if (offset < channels) {
+		LOGP(DSOUND, LOGL_ERROR, "Aggregated sound cards carry %d channels, but %d channels are required!\n", offset, channels);
+		goto error;
+	}
+
+	return agg;
+
+error:
+	sound_aggregate_close(agg);
+	return NULL;
+}
+
+int sound_aggregate_start(void *inst)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+	int i, rc;
+
+	for (i = 0; i < agg->num_cards; i++) {
+		rc = sound_start(agg->card[i].sound);
+		if (rc < 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+void sound_aggregate_close(void *inst)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+	aggregate_card_t *card;
+	int i, c;
+
+	for (i = 0; i < agg->num_cards; i++) {
+		card = &agg->card[i];
+		if (i && card->sound)
+			LOGP(DSOUND, LOGL_INFO, "Clock of sound card '%s' differs by %.1f ppm from '%s'.\n", card->audiodev, (card->ratio - 1.0) * 1e6, agg->card[0].audiodev);
+		if (card->sound)
+			sound_close(card->sound);
+		for (c = 0; c < MAX_CHANNELS; c++) {
+			free(card->tx_buff[c]);
+			free(card->rx_buff[c]);
+			free(card->rx_fifo[c]);
+		}
+	}
+	free(agg);
+}
+
+int sound_aggregate_write(void *inst, sample_t **samples, uint8_t **power, int num, enum paging_signal *paging_signal, int *on, int __attribute__((unused)) channels)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+	aggregate_card_t *card;
+	int i, n, rc, result = num;
+
+	for (i = 0; i < agg->num_cards; i++) {
+		card = &agg->card[i];
+		if (i == 0)
+			rc = sound_write(card->sound, samples, power, num, paging_signal, on, card->channels);
+		else {
+			n = drift_resample(&card->tx_drift, card->channels, samples + card->offset, num, card->tx_buff, 0, card->ratio);
+			rc = sound_write(card->sound, card->tx_buff, NULL, n, CARD_PAGING(paging_signal, card), (on) ? on + card->offset : NULL, card->channels);
+		}
+		/* other cards are written anyway, so they stay aligned */
+		if (rc < 0)
+			result = rc;
+	}
+	agg->written += num;
+
+	return result;
+}
+
+int sound_aggregate_read(void *inst, sample_t **samples, int num, int __attribute__((unused)) channels, double *rf_level_db)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+	aggregate_card_t *card;
+	sample_t *fifo[MAX_CHANNELS];
+	int i, c, n, count, space, rc;
+
+	/* the reference tells how many samples are received */
+	count = sound_read(agg->card[0].sound, samples, num, agg->card[0].channels, rf_level_db);
+	if (count < 0)
+		return count;
+
+	for (i = 1; i < agg->num_cards; i++) {
+		card = &agg->card[i];
+		rc = sound_read(card->sound, card->rx_buff, agg->buffer_size * 2, card->channels, (rf_level_db) ? rf_level_db + card->offset : NULL);
+		if (rc < 0) {
+			card->rx_fill = 0;
+			return rc;
+		}
+		if (rc > 0) {
+			/* drop oldest samples, if the fifo overflows */
+			space = agg->buffer_size * 4 + 32 - card->rx_fill;
+			if (space < rc * 2 + 4) {
+				LOGP(DSOUND, LOGL_DEBUG, "RX of sound card '%s' overflows, dropping samples.\n", card->audiodev);
+				card->rx_fill = 0;
+			}
+			for (c = 0; c < card->channels; c++)
+				fifo[c] = card->rx_fifo[c];
+			card->rx_fill += drift_resample(&card->rx_drift, card->channels, card->rx_buff, rc, fifo, card->rx_fill, 1.0 / card->ratio);
+		}
+		if (!count)
+			continue;
+		/* take as many samples as the reference gave, fill with silence if there are not enough */
+		n = (card->rx_fill < count) ? card->rx_fill : count;
+		if (n < count)
+			LOGP(DSOUND, LOGL_DEBUG, "RX of sound card '%s' underruns, inserting silence.\n", card->audiodev);
+		for (c = 0; c < card->channels; c++) {
+			memcpy(samples[card->offset + c], card->rx_fifo[c], n * sizeof(sample_t));
+			memset(samples[card->offset + c] + n, 0, (count - n) * sizeof(sample_t));
+			memmove(card->rx_fifo[c], card->rx_fifo[c] + n, (card->rx_fill - n) * sizeof(sample_t));
+		}
+		card->rx_fill -= n;
+	}
+
+	return count;
+}
+
+int sound_aggregate_get_tosend(void *inst, int buffer_size)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+	int i, tosend, delay_ref, delay;
+
+	delay_ref = sound_get_delay(agg->card[0].sound);
+	if (delay_ref < 0)
+		return delay_ref;
+	tosend = buffer_size - delay_ref;
+	if (tosend < 0)
+		tosend = 0;
+
+	for (i = 1; i < agg->num_cards; i++) {
+		delay = sound_get_delay(agg->card[i].sound);
+		if (delay < 0)
+			return delay;
+		if (agg->written)
+			drift_update(agg, &agg->card[i], delay - delay_ref);
+	}
+	agg->written = 0;
+
+	return tosend;
+}
+
+/* the reference card drives the processing */
+int sound_aggregate_get_poll(void *inst, struct pollfd *pfds, int space)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+
+	return sound_get_poll(agg->card[0].sound, pfds, space);
+}
+
+int sound_aggregate_poll_ready(void *inst, struct pollfd *pfds, int num)
+{
+	aggregate_t *agg = (aggregate_t *)inst;
+
+	return sound_poll_ready(agg->card[0].sound, pfds, num);
+}
+
@@ -29,8 +29,14 @@
 #include "sound.h"
 #endif
 
+/* more than two channels are used by multi line applications, like a modem pool */
+#define MAX_CHANNELS	32
+
 static int KEEP_FRAMES=8;		/* minimum frames not to read, to prevent reading from buffer before data has been received (seems to be a bug in ALSA) */
 
+int sound_mmap = 0;			/* convert samples directly in the DMA ring of the device */
+int sound_poll = 0;			/* processing is driven by poll descriptors of the device */
+
 typedef struct sound {
 	enum sound_direction direction;
 	snd_pcm_t *phandle, *chandle;
@@ -39,15 +45,17 @@ typedef struct sound {
 	int samplerate;			/* required sample rate */
 	char *caudiodev, *paudiodev;	/* required device */
 	double spl_deviation;		/* how much deviation is one sample step */
+	int mmap;			/* use mmap access instead of read/write */
+	int period;			/* period size in mmap or poll mode */
 #ifdef HAVE_MOBILE
 	double paging_phaseshift;	/* phase to shift every sample */
 	double paging_phase;	 	/* current phase */
-	double rx_frequency[2];		/* rx frequency of radio connected to channel */
-	dispmeasparam_t *dmp[2];
+	double rx_frequency[MAX_CHANNELS]; /* rx frequency of radio connected to channel */
+	dispmeasparam_t *dmp[MAX_CHANNELS];
 #endif
 } sound_t;
 
-static int set_hw_params(snd_pcm_t *handle, int samplerate, int *channels)
+static int set_hw_params(snd_pcm_t *handle, int samplerate, int *channels, int required, int mmap, int period)
 {
 	snd_pcm_hw_params_t *hw_params = NULL;
 	int rc;
@@ -71,9 +79,9 @@ static int set_hw_params(snd_pcm_t *handle, int samplerate, int *channels)
 		goto error;
 	}
 
-	rc = snd_pcm_hw_params_set_access (handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+	rc = snd_pcm_hw_params_set_access (handle, hw_params, (mmap) ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED);
 	if (rc < 0) {
-		LOGP(DSOUND, LOGL_ERROR, "cannot set access to interleaved (%s)\n", snd_strerror(rc));
+		LOGP(DSOUND, LOGL_ERROR, "cannot set access to %sinterleaved (%s)\n", (mmap) ? "mmap " : "", snd_strerror(rc));
 		goto error;
 	}
 
@@ -95,15 +103,36 @@ static int set_hw_params(snd_pcm_t *handle, int samplerate, int *channels)
 		goto error;
 	}
 
-	*channels = 1;
-	rc = snd_pcm_hw_params_set_channels(handle, hw_params, *channels);
-	if (rc < 0) {
-		*channels = 2;
+	if (required > 2) {
+		/* multi channel device, all channels are required */
+		*channels = required;
 		rc = snd_pcm_hw_params_set_channels(handle, hw_params, *channels);
 		if (rc < 0) {
-			LOGP(DSOUND, LOGL_ERROR, "cannot set channel count to 1 nor 2 (%s)\n", snd_strerror(rc));
+			LOGP(DSOUND, LOGL_ERROR, "cannot set channel count to %d (%s)\n", required, snd_strerror(rc));
 			goto error;
 		}
+	} else {
+		*channels = 1;
+		rc = snd_pcm_hw_params_set_channels(handle, hw_params, *channels);
+		if (rc < 0) {
+			*channels = 2;
+			rc = snd_pcm_hw_params_set_channels(handle, hw_params, *channels);
+			if (rc < 0) {
+				LOGP(DSOUND, LOGL_ERROR, "cannot set channel count to 1 nor 2 (%s)\n", snd_strerror(rc));
+				goto error;
+			}
+		}
+	}
+
+	/* small periods, so the ring is refilled at every interval of the processing loop */
+	if (period > 0) {
+		snd_pcm_uframes_t period_size = period;
+		rc = snd_pcm_hw_params_set_period_size_near(handle, hw_params, &period_size, 0);
+		if (rc < 0) {
+			LOGP(DSOUND, LOGL_ERROR, "cannot set period size (%s)\n", snd_strerror(rc));
+			goto error;
+		}
+		LOGP(DSOUND, LOGL_DEBUG, "Period size is %d frames.\n", (int)period_size);
 	}
 
 	rc = snd_pcm_hw_params(handle, hw_params);
@@ -124,6 +153,47 @@ error:
 	return rc;
 }
 
+/* wake up when a period has been captured */
+static int set_sw_params(snd_pcm_t *handle, int period)
+{
+	snd_pcm_sw_params_t *sw_params = NULL;
+	int rc;
+
+	rc = snd_pcm_sw_params_malloc(&sw_params);
+	if (rc < 0) {
+		LOGP(DSOUND, LOGL_ERROR, "Failed to allocate sw_params! (%s)\n", snd_strerror(rc));
+		goto error;
+	}
+
+	rc = snd_pcm_sw_params_current(handle, sw_params);
+	if (rc < 0) {
+		LOGP(DSOUND, LOGL_ERROR, "cannot get software parameters (%s)\n", snd_strerror(rc));
+		goto error;
+	}
+
+	rc = snd_pcm_sw_params_set_avail_min(handle, sw_params, period);
+	if (rc < 0) {
+		LOGP(DSOUND, LOGL_ERROR, "cannot set minimum available frames (%s)\n", snd_strerror(rc));
+		goto error;
+	}
+
+	rc = snd_pcm_sw_params(handle, sw_params);
+	if (rc < 0) {
+		LOGP(DSOUND, LOGL_ERROR, "cannot set software parameters (%s)\n", snd_strerror(rc));
+		goto error;
+	}
+
+	snd_pcm_sw_params_free(sw_params);
+
+	return 0;
+
+error:
+	if (sw_params)
+		snd_pcm_sw_params_free(sw_params);
+
+	return rc;
+}
+
 static int dev_open(sound_t *sound)
 {
 	int rc, rc_rec = 0, rc_play = 0;
@@ -142,7 +212,7 @@ static int dev_open(sound_t *sound)
 		return (rc_play < 0) ? rc_play : rc_rec;
 
 	if (sound->direction == SOUND_DIR_PLAY || sound->direction == SOUND_DIR_DUPLEX) {
-		rc = set_hw_params(sound->phandle, sound->samplerate, &sound->pchannels);
+		rc = set_hw_params(sound->phandle, sound->samplerate, &sound->pchannels, sound->channels, sound->mmap, sound->period);
 		if (rc < 0) {
 			LOGP(DSOUND, LOGL_ERROR, "Failed to set playback hw params\n");
 			return rc;
@@ -161,7 +231,7 @@ static int dev_open(sound_t *sound)
 	}
 
 	if (sound->direction == SOUND_DIR_REC || sound->direction == SOUND_DIR_DUPLEX) {
-		rc = set_hw_params(sound->chandle, sound->samplerate, &sound->cchannels);
+		rc = set_hw_params(sound->chandle, sound->samplerate, &sound->cchannels, sound->channels, sound->mmap, sound->period);
 		if (rc < 0) {
 			LOGP(DSOUND, LOGL_ERROR, "Failed to set capture hw params\n");
 			return rc;
@@ -172,6 +242,14 @@ static int dev_open(sound_t *sound)
 		}
 		LOGP(DSOUND, LOGL_DEBUG, "Capture with %d channels.\n", sound->cchannels);
 
+		if (sound->period > 0) {
+			rc = set_sw_params(sound->chandle, sound->period);
+			if (rc < 0) {
+				LOGP(DSOUND, LOGL_ERROR, "Failed to set capture sw params\n");
+				return rc;
+			}
+		}
+
 		rc = snd_pcm_prepare(sound->chandle);
 		if (rc < 0) {
 			LOGP(DSOUND, LOGL_ERROR, "cannot prepare audio interface for use (%s)\n", snd_strerror(rc));
@@ -190,15 +268,15 @@ static void dev_close(sound_t *sound)
 		snd_pcm_close(sound->chandle);
 }
 
-void *sound_open(int direction, const char *audiodev, double __attribute__((unused)) *tx_frequency, double __attribute__((unused)) *rx_frequency, int __attribute__((unused)) *am, int channels, double __attribute__((unused)) paging_frequency, int samplerate, int __attribute((unused)) buffer_size, double __attribute__((unused)) interval, double max_deviation, double __attribute__((unused)) max_modulation, double __attribute__((unused)) modulation_index)
+void *sound_open(int direction, const char *audiodev, double __attribute__((unused)) *tx_frequency, double __attribute__((unused)) *rx_frequency, int __attribute__((unused)) *am, int channels, double __attribute__((unused)) paging_frequency, int samplerate, int __attribute((unused)) buffer_size, double interval, double max_deviation, double __attribute__((unused)) max_modulation, double __attribute__((unused)) modulation_index)
 {
 	sound_t *sound;
 	const char *env;
 	char *p;
 	int rc;
 
-	if (channels < 1 || channels > 2) {
-		LOGP(DSOUND, LOGL_ERROR, "Cannot use more than two channels with the same sound card!\n");
+	if (channels < 1 || channels > MAX_CHANNELS) {
+		LOGP(DSOUND, LOGL_ERROR, "Cannot use more than %d channels with the same sound card!\n", MAX_CHANNELS);
 		return NULL;
 	}
 
@@ -219,6 +297,9 @@ void *sound_open(int direction, const char *audiodev, double __attribute__((unus
 	sound->channels = channels;
 	sound->samplerate = samplerate;
 	sound->spl_deviation = max_deviation / 32767.0;
+	sound->mmap = sound_mmap;
+	if (sound_mmap || sound_poll)
+		sound->period = (int)((double)samplerate * interval / 1000.0);
 #ifdef HAVE_MOBILE
 	sound->paging_phaseshift = 1.0 / ((double)samplerate / 1000.0);
 #endif
@@ -257,12 +338,23 @@ error:
 int sound_start(void *inst)
 {
 	sound_t *sound = (sound_t *)inst;
-	int16_t buff[2];
+	int16_t buff[MAX_CHANNELS];
+	int rc;
 
 	if (sound->direction != SOUND_DIR_REC && sound->direction != SOUND_DIR_DUPLEX)
 		return -EINVAL;
 
-	/* trigger capturing */
+	/* there is no read in mmap mode, so start explicitly */
+	if (sound->mmap) {
+		rc = snd_pcm_start(sound->chandle);
+		if (rc < 0) {
+			LOGP(DSOUND, LOGL_ERROR, "cannot start capture (%s)\n", snd_strerror(rc));
+			return rc;
+		}
+		return 0;
+	}
+
+	/* trigger capturing (one frame) */
 	snd_pcm_readi(sound->chandle, buff, 1);
 
 	return 0;
@@ -323,73 +415,105 @@ static void gen_paging_tone(sound_t *sound, int16_t *samples, int length, enum p
 }
 #endif
 
-int sound_write(void *inst, sample_t **samples, uint8_t __attribute__((unused)) **power, int num, enum paging_signal __attribute__((unused)) *paging_signal, int __attribute__((unused)) *on, int channels)
+/* convert samples into interleaved frames of play buffer */
+static void play_frames(sound_t *sound, int16_t *buff, sample_t **samples, int pos, int num, enum paging_signal __attribute__((unused)) *paging_signal, int __attribute__((unused)) *on, int channels)
 {
-	sound_t *sound = (sound_t *)inst;
 	double spl_deviation = sound->spl_deviation;
-	int32_t value;
-	int16_t buff[num << 1];
-	int rc;
-	int i, ii;
-
-	if (sound->direction != SOUND_DIR_PLAY && sound->direction != SOUND_DIR_DUPLEX)
-		return -EINVAL;
+	int i;
 
+	if (sound->pchannels > 2) {
+		/* multi channel, one channel for each line */
+		for (i = 0; i < sound->pchannels; i++)
+			samples_to_int16_scale(buff + i, sound->pchannels, samples[i] + pos, num, 1.0 / spl_deviation);
+	} else
 	if (sound->pchannels == 2) {
 		/* two channels */
 #ifdef HAVE_MOBILE
 		if (paging_signal && on && paging_signal[0] != PAGING_SIGNAL_NONE) {
 			int16_t paging[num << 1];
 			gen_paging_tone(sound, paging, num, paging_signal[0], on[0]);
-			for (i = 0, ii = 0; i < num; i++) {
-				value = samples[0][i] / spl_deviation;
-				if (value > 32767)
-					value = 32767;
-				else if (value < -32767)
-					value = -32767;
-				buff[ii++] = value;
-				buff[ii++] = paging[i];
-			}
+			samples_to_int16_scale(buff, 2, samples[0] + pos, num, 1.0 / spl_deviation);
+			for (i = 0; i < num; i++)
+				buff[(i << 1) + 1] = paging[i];
 		} else
 #endif
 		if (channels == 2) {
-			for (i = 0, ii = 0; i < num; i++) {
-				value = samples[0][i] / spl_deviation;
-				if (value > 32767)
-					value = 32767;
-				else if (value < -32767)
-					value = -32767;
-				buff[ii++] = value;
-				value = samples[1][i] / spl_deviation;
-				if (value > 32767)
-					value = 32767;
-				else if (value < -32767)
-					value = -32767;
-				buff[ii++] = value;
-			}
+			samples_to_int16_scale(buff, 2, samples[0] + pos, num, 1.0 / spl_deviation);
+			samples_to_int16_scale(buff + 1, 2, samples[1] + pos, num, 1.0 / spl_deviation);
 		} else {
-			for (i = 0, ii = 0; i < num; i++) {
-				value = samples[0][i] / spl_deviation;
-				if (value > 32767)
-					value = 32767;
-				else if (value < -32767)
-					value = -32767;
-				buff[ii++] = value;
-				buff[ii++] = value;
-			}
+			samples_to_int16_scale(buff, 2, samples[0] + pos, num, 1.0 / spl_deviation);
+			for (i = 0; i < num; i++)
+				buff[(i << 1) + 1] = buff[i << 1];
 		}
 	} else {
 		/* one channel */
-		for (i = 0, ii = 0; i < num; i++) {
-			value = samples[0][i] / spl_deviation;
-			if (value > 32767)
-				value = 32767;
-			else if (value < -32767)
-				value = -32767;
-			buff[ii++] = value;
-		}
+		samples_to_int16_scale(buff, 1, samples[0] + pos, num, 1.0 / spl_deviation);
+	}
+}
+
+/* frames of the DMA ring at given offset, the access is interleaved */
+static int16_t *mmap_frames(const snd_pcm_channel_area_t *areas, snd_pcm_uframes_t offset, int channels)
+{
+	return (int16_t *)((uint8_t *)areas[0].addr + areas[0].first / 8) + offset * channels;
+}
+
+/* write directly into the DMA ring, the ring may wrap, so it takes more than one chunk */
+static int mmap_write(sound_t *sound, sample_t **samples, int num, enum paging_signal *paging_signal, int *on, int channels)
+{
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames;
+	snd_pcm_sframes_t avail, committed;
+	int pos = 0;
+	int rc;
+
+	avail = snd_pcm_avail_update(sound->phandle);
+	if (avail < 0)
+		return avail;
+	if (num > avail)
+		num = avail;
+
+	while (pos < num) {
+		frames = num - pos;
+		rc = snd_pcm_mmap_begin(sound->phandle, &areas, &offset, &frames);
+		if (rc < 0)
+			return rc;
+		if (!frames)
+			break;
+		play_frames(sound, mmap_frames(areas, offset, sound->pchannels), samples, pos, frames, paging_signal, on, channels);
+		committed = snd_pcm_mmap_commit(sound->phandle, offset, frames);
+		if (committed < 0)
+			return committed;
+		pos += committed;
+		if ((snd_pcm_uframes_t)committed != frames)
+			break;
+	}
+
+	/* the device does not start by itself when the ring is written directly */
+	if (pos && snd_pcm_state(sound->phandle) == SND_PCM_STATE_PREPARED) {
+		rc = snd_pcm_start(sound->phandle);
+		if (rc < 0)
+			return rc;
+	}
+
+	return pos;
+}
+
+int sound_write(void *inst, sample_t **samples, uint8_t __attribute__((unused)) **power, int num, enum paging_signal *paging_signal, int *on, int channels)
+{
+	sound_t *sound = (sound_t *)inst;
+	int rc;
+
+	if (sound->direction != SOUND_DIR_PLAY && sound->direction != SOUND_DIR_DUPLEX)
+		return -EINVAL;
+
+	if (sound->mmap)
+		rc = mmap_write(sound, samples, num, paging_signal, on, channels);
+	else {
+		int16_t buff[num * ((sound->pchannels > 2) ? sound->pchannels : 2)];
+
+		play_frames(sound, buff, samples, 0, num, paging_signal, on, channels);
+		rc = snd_pcm_writei(sound->phandle, buff, num);
 	}
-	rc = snd_pcm_writei(sound->phandle, buff, num);
 
 	if (rc < 0) {
 		LOGP(DSOUND, LOGL_ERROR, "failed to write audio to interface (%s)\n", snd_strerror(rc));
@@ -410,36 +534,132 @@ int sound_write(void *inst, sample_t **samples, uint8_t __attribute__((unused))
 	return rc;
 }
 
+/* peak of absolute values, used for level measurement */
+static int32_t peak_int16(const int16_t *spl, int stride, int num)
+{
+	int32_t max = 0, a;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		a = spl[i * stride];
+		a = (a >= 0) ? a : -a;
+		max = (a > max) ? a : max;
+	}
+
+	return max;
+}
+
+/* convert interleaved frames of record buffer into samples, raise peak levels */
+static void rec_frames(sound_t *sound, sample_t **samples, const int16_t *buff, int pos, int num, int channels, int32_t *max)
+{
+	double spl_deviation = sound->spl_deviation;
+	int32_t spl, a;
+	int i, ii;
+
+	if (sound->cchannels > 2) {
+		/* multi channel, one channel for each line */
+		for (i = 0; i < sound->cchannels; i++) {
+			int16_to_samples_scale(samples[i] + pos, buff + i, sound->cchannels, num, spl_deviation);
+			a = peak_int16(buff + i, sound->cchannels, num);
+			max[i] = (a > max[i]) ? a : max[i];
+		}
+	} else
+	if (sound->cchannels == 2) {
+		if (channels < 2) {
+			for (i = 0, ii = 0; i < num; i++) {
+				spl = buff[ii++];
+				spl += buff[ii++];
+				a = (spl >= 0) ? spl : -spl;
+				if (a > max[0])
+					max[0] = a;
+				samples[0][pos + i] = (double)spl * spl_deviation;
+			}
+		} else {
+			int16_to_samples_scale(samples[0] + pos, buff, 2, num, spl_deviation);
+			int16_to_samples_scale(samples[1] + pos, buff + 1, 2, num, spl_deviation);
+			a = peak_int16(buff, 2, num);
+			max[0] = (a > max[0]) ? a : max[0];
+			a = peak_int16(buff + 1, 2, num);
+			max[1] = (a > max[1]) ? a : max[1];
+		}
+	} else {
+		int16_to_samples_scale(samples[0] + pos, buff, 1, num, spl_deviation);
+		a = peak_int16(buff, 1, num);
+		max[0] = (a > max[0]) ? a : max[0];
+	}
+}
+
+/* read directly from the DMA ring, KEEP_FRAMES is not required, because nothing is copied by ALSA */
+static int mmap_read(sound_t *sound, sample_t **samples, int num, int channels, int32_t *max)
+{
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t offset, frames;
+	snd_pcm_sframes_t avail, committed;
+	int pos = 0;
+	int rc;
+
+	avail = snd_pcm_avail_update(sound->chandle);
+	if (avail < 0)
+		return avail;
+	if (num > avail)
+		num = avail;
+
+	while (pos < num) {
+		frames = num - pos;
+		rc = snd_pcm_mmap_begin(sound->chandle, &areas, &offset, &frames);
+		if (rc < 0)
+			return rc;
+		if (!frames)
+			break;
+		rec_frames(sound, samples, mmap_frames(areas, offset, sound->cchannels), pos, frames, channels, max);
+		committed = snd_pcm_mmap_commit(sound->chandle, offset, frames);
+		if (committed < 0)
+			return committed;
+		pos += committed;
+		if ((snd_pcm_uframes_t)committed != frames)
+			break;
+	}
+
+	return pos;
+}
+
 int sound_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db)
 {
 	sound_t *sound = (sound_t *)inst;
-	double spl_deviation = sound->spl_deviation;
-	int16_t buff[num << 1];
-	int32_t spl;
-	int32_t max[2], a;
+	int32_t max[MAX_CHANNELS];
 	int in, rc;
-	int i, ii;
+	int i;
 
 	if (sound->direction != SOUND_DIR_REC && sound->direction != SOUND_DIR_DUPLEX)
 		return -EINVAL;
 
-	/* get samples in rx buffer */
-	in = snd_pcm_avail(sound->chandle);
-	/* if not more than KEEP_FRAMES frames available, try next time */
-	if (in <= KEEP_FRAMES)
-		return 0;
-	/* read some frames less than in buffer, because snd_pcm_readi() seems
-	 * to corrupt last frames */
-	in -= KEEP_FRAMES;
-	if (in > num)
-		in = num;
+	memset(max, 0, sizeof(max));
 
-	/* make valgrind happy, because snd_pcm_readi() does not seem to initially fill buffer with values */
-	memset(buff, 0, sizeof(*buff) * sound->cchannels * in);
+	if (sound->mmap)
+		rc = mmap_read(sound, samples, num, channels, max);
+	else {
+		int16_t buff[num * ((sound->cchannels > 2) ? sound->cchannels : 2)];
 
-	rc = snd_pcm_readi(sound->chandle, buff, in);
+		/* get samples in rx buffer */
+		in = snd_pcm_avail(sound->chandle);
+		/* if not more than KEEP_FRAMES frames available, try next time */
+		if (in <= KEEP_FRAMES)
+			return 0;
+		/* read some frames less than in buffer, because snd_pcm_readi() seems
+		 * to corrupt last frames */
+		in -= KEEP_FRAMES;
+		if (in > num)
+			in = num;
+
+		/* make valgrind happy, because snd_pcm_readi() does not seem to initially fill buffer with values */
+		memset(buff, 0, sizeof(*buff) * sound->cchannels * in);
+
+		rc = snd_pcm_readi(sound->chandle, buff, in);
+		if (rc > 0)
+			rec_frames(sound, samples, buff, 0, rc, channels, max);
+	}
 	if (rc < 0) {
-		if (errno == EAGAIN)
+		if (rc == -EAGAIN || errno == EAGAIN)
 			return 0;
 		LOGP(DSOUND, LOGL_ERROR, "failed to read audio from interface (%s)\n", snd_strerror(rc));
 		/* recover read */
@@ -455,47 +675,13 @@ int sound_read(void *inst, sample_t **samples, int num, int channels, double *rf
 	}
 	if (rc == 0)
 		return rc;
-	if (sound->cchannels == 2) {
-		if (channels < 2) {
-			for (i = 0, ii = 0; i < rc; i++) {
-				spl = buff[ii++];
-				spl += buff[ii++];
-				a = (spl >= 0) ? spl : -spl;
-				if (i == 0 || a > max[0])
-					max[0] = a;
-				samples[0][i] = (double)spl * spl_deviation;
-			}
-		} else {
-			for (i = 0, ii = 0; i < rc; i++) {
-				spl = buff[ii++];
-				a = (spl >= 0) ? spl : -spl;
-				if (i == 0 || a > max[0])
-					max[0] = a;
-				samples[0][i] = (double)spl * spl_deviation;
-				spl = buff[ii++];
-				a = (spl >= 0) ? spl : -spl;
-				if (i == 0 || a > max[1])
-					max[1] = a;
-				samples[1][i] = (double)spl * spl_deviation;
-			}
-		}
-	} else {
-		for (i = 0, ii = 0; i < rc; i++) {
-			spl = buff[ii++];
-			a = (spl >= 0) ? spl : -spl;
-			if (i == 0 || a > max[0])
-				max[0] = a;
-			samples[0][i] = (double)spl * spl_deviation;
-		}
-	}
 
 #ifdef HAVE_MOBILE
-	sender_t *sender;
 	for (i = 0; i < channels; i++) {
 		if (rf_level_db)
 			rf_level_db[i] = NAN;
-		sender = get_sender_by_empfangsfrequenz(sound->rx_frequency[i]);
-		if (!sender)
+		/* sender was resolved when opening, no measurement if there is none */
+		if (!sound->dmp[i])
 			continue;
 		display_measurements_update(sound->dmp[i], log10((double)max[i] / 32768.0) * 20, 0.0);
 	}
@@ -509,16 +695,12 @@ int sound_read(void *inst, sample_t **samples, int num, int channels, double *rf
 	return rc;
 }
 
-/* 
- * get playback buffer space
- *
- * return number of samples to be sent */
-int sound_get_tosend(void *inst, int buffer_size)
+/* get number of samples in playback buffer, that have not been played yet */
+int sound_get_delay(void *inst)
 {
 	sound_t *sound = (sound_t *)inst;
 	int rc;
 	snd_pcm_sframes_t delay;
-	int tosend;
 
 	if (sound->direction != SOUND_DIR_PLAY && sound->direction != SOUND_DIR_DUPLEX)
 		return -EINVAL;
@@ -540,12 +722,59 @@ int sound_get_tosend(void *inst, int buffer_size)
 		return rc;
 	}
 
+	return (delay > 0) ? delay : 0;
+}
+
+/* 
+ * get playback buffer space
+ *
+ * return number of samples to be sent */
+int sound_get_tosend(void *inst, int buffer_size)
+{
+	int delay;
+	int tosend;
+
+	delay = sound_get_delay(inst);
+	if (delay < 0)
+		return delay;
+
 	tosend = buffer_size - delay;
 	if (tosend < 0)
 		tosend = 0;
 	return tosend;
 }
 
+/* get poll descriptors that wake up when a period has been captured
+ *
+ * return number of descriptors, 0 if processing must be driven by the timer */
+int sound_get_poll(void *inst, struct pollfd *pfds, int space)
+{
+	sound_t *sound = (sound_t *)inst;
+	int num;
+
+	/* playback only: the ring is larger than our buffer, so it would always be writable */
+	if (!sound_poll || !sound->chandle)
+		return 0;
+
+	num = snd_pcm_poll_descriptors_count(sound->chandle);
+	if (num <= 0 || num > space)
+		return 0;
+
+	return snd_pcm_poll_descriptors(sound->chandle, pfds, num);
+}
+
+/* return 1, if the events of poll descriptors tell that a period has been captured or an error occurred */
+int sound_poll_ready(void *inst, struct pollfd *pfds, int num)
+{
+	sound_t *sound = (sound_t *)inst;
+	unsigned short revents;
+
+	if (snd_pcm_poll_descriptors_revents(sound->chandle, pfds, num, &revents) < 0)
+		return 1;
+
+	return (revents & (POLLIN | POLLERR)) ? 1 : 0;
+}
+
 int sound_is_stereo_capture(void *inst)
 {
 	sound_t *sound = (sound_t *)inst;
@@ -0,0 +1,413 @@
+/* JACK audio client
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The device is given as "jack" or "jack:<client name>". PipeWire provides
+ * the same API, so it is served by this client also.
+ *
+ * JACK calls the process function from its real time thread once per period
+ * of the server. Each port has a ring buffer of float samples, so that the
+ * process function just copies the port buffers from and to the rings. There
+ * is no conversion and no locking in the real time thread. Conversion and
+ * scaling are done when the rings are read or written by the application.
+ *
+ * After each period, the process function signals an event descriptor. It is
+ * returned as poll descriptor, so processing is done with the period of the
+ * server instead of the timer of the main loop.
+ *
+ * The ports are connected to the physical ports of the server in order. If
+ * this is not desired, they can be connected by any patchbay afterwards.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <math.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <jack/jack.h>
+#include "../libsample/sample.h"
+#include "../libsample/ringbuffer.h"
+#include "../liblogging/logging.h"
+#ifdef HAVE_MOBILE
+#include "../libmobile/sender.h"
+#else
+#include "sound.h"
+#endif
+
+#define MAX_CHANNELS	32
+
+typedef struct sound_jack {
+	enum sound_direction direction;
+	jack_client_t *client;
+	int channels;			/* number of ports in each direction */
+	jack_port_t *cport[MAX_CHANNELS], *pport[MAX_CHANNELS];
+	ringbuffer_t crb[MAX_CHANNELS], prb[MAX_CHANNELS];
+	int period;			/* frames of each period of the server */
+	int efd;			/* event descriptor that is signaled each period */
+	double spl_deviation;		/* how much deviation is a sample value of 1.0 */
+	atomic_int overruns, underruns;	/* counted by the real time thread */
+	atomic_int shutdown;		/* server has gone away */
+#ifdef HAVE_MOBILE
+	double rx_frequency[MAX_CHANNELS]; /* rx frequency of radio connected to channel */
+	dispmeasparam_t *dmp[MAX_CHANNELS];
+#endif
+} sound_jack_t;
+
+/* real time thread: copy port buffers from and to the rings, do nothing else here */
+static int jack_process(jack_nframes_t nframes, void *arg)
+{
+	sound_jack_t *sound = arg;
+	uint64_t event = 1;
+	int __attribute__((unused)) rc;
+	float *buf;
+	void *span;
+	int i, pos, len;
+
+	for (i = 0; i < sound->channels; i++) {
+		if (sound->cport[i]) {
+			buf = jack_port_get_buffer(sound->cport[i], nframes);
+			/* drop the period, if the application does not keep up */
+			if (ringbuffer_space(&sound->crb[i]) < (int)nframes)
+				atomic_fetch_add(&sound->overruns, 1);
+			else
+				ringbuffer_write(&sound->crb[i], buf, nframes);
+		}
+		if (sound->pport[i]) {
+			buf = jack_port_get_buffer(sound->pport[i], nframes);
+			for (pos = 0; pos < (int)nframes; pos += len) {
+				len = ringbuffer_read_span(&sound->prb[i], &span);
+				if (!len)
+					break;
+				if (len > (int)nframes - pos)
+					len = nframes - pos;
+				memcpy(buf + pos, span, len * sizeof(float));
+				ringbuffer_read_release(&sound->prb[i], len);
+			}
+			if (pos < (int)nframes) {
+				memset(buf + pos, 0, (nframes - pos) * sizeof(float));
+				if (i == 0)
+					atomic_fetch_add(&sound->underruns, 1);
+			}
+		}
+	}
+
+	/* wake up the application */
+	rc = write(sound->efd, &event, sizeof(event));
+
+	return 0;
+}
+
+static void jack_shutdown(void *arg)
+{
+	sound_jack_t *sound = arg;
+	uint64_t event = 1;
+	int __attribute__((unused)) rc;
+
+	/* wake up, so that the application does not wait for periods that never come */
+	atomic_store(&sound->shutdown, 1);
+	rc = write(sound->efd, &event, sizeof(event));
+}
+
+/* connect our ports to the physical ports of the server in order */
+static void connect_ports(sound_jack_t *sound)
+{
+	const char **ports;
+	int i, rc;
+
+	ports = jack_get_ports(sound->client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsOutput);
+	for (i = 0; ports && ports[i] && i < sound->channels; i++) {
+		if (!sound->cport[i])
+			break;
+		rc = jack_connect(sound->client, ports[i], jack_port_name(sound->cport[i]));
+		if (rc && rc != EEXIST)
+			LOGP(DSOUND, LOGL_NOTICE, "Cannot connect '%s' to '%s', please connect it yourself.\n", ports[i], jack_port_name(sound->cport[i]));
+	}
+	jack_free(ports);
+
+	ports = jack_get_ports(sound->client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+	for (i = 0; ports && ports[i] && i < sound->channels; i++) {
+		if (!sound->pport[i])
+			break;
+		rc = jack_connect(sound->client, jack_port_name(sound->pport[i]), ports[i]);
+		if (rc && rc != EEXIST)
+			LOGP(DSOUND, LOGL_NOTICE, "Cannot connect '%s' to '%s', please connect it yourself.\n", jack_port_name(sound->pport[i]), ports[i]);
+	}
+	jack_free(ports);
+}
+
+void *sound_jack_open(int direction, const char *audiodev, double __attribute__((unused)) *tx_frequency, double __attribute__((unused)) *rx_frequency, int __attribute__((unused)) *am, int channels, double __attribute__((unused)) paging_frequency, int samplerate, int buffer_size, double __attribute__((unused)) interval, double max_deviation, double __attribute__((unused)) max_modulation, double __attribute__((unused)) modulation_index)
+{
+	sound_jack_t *sound;
+	const char *name = "osmocom-analog";
+	char port_name[32];
+	jack_status_t status;
+	int size;
+	int i;
+
+	if (channels < 1 || channels > MAX_CHANNELS) {
+		LOGP(DSOUND, LOGL_ERROR, "Cannot use more than %d channels with the same JACK client!\n", MAX_CHANNELS);
+		return NULL;
+	}
+
+	sound = calloc(1, sizeof(sound_jack_t));
+	if (!sound) {
+		LOGP(DSOUND, LOGL_ERROR, "Failed to alloc memory!\n");
+		return NULL;
+	}
+	sound->direction = direction;
+	sound->channels = channels;
+	sound->spl_deviation = max_deviation;
+	sound->efd = -1;
+
+	if (!strncmp(audiodev, "jack:", 5) && audiodev[5])
+		name = audiodev + 5;
+
+	sound->client = jack_client_open(name, JackNoStartServer, &status);
+	if (!sound->client) {
+		LOGP(DSOUND, LOGL_ERROR, "Cannot connect to JACK server (status 0x%x), is it running?\n", status);
+		goto error;
+	}
+	if ((int)jack_get_sample_rate(sound->client) != samplerate) {
+		LOGP(DSOUND, LOGL_ERROR, "JACK server runs at %d Hz, but sample rate of %d Hz is required. Please change the sample rate of the server or the application.\n", (int)jack_get_sample_rate(sound->client), samplerate);
+		goto error;
+	}
+	sound->period = jack_get_buffer_size(sound->client);
+
+	sound->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (sound->efd < 0) {
+		LOGP(DSOUND, LOGL_ERROR, "Failed to create event descriptor (%s)\n", strerror(errno));
+		goto error;
+	}
+
+	/* the rings hold the buffer of the application and some periods of the server */
+	size = buffer_size + sound->period * 4;
+	for (i = 0; i < channels; i++) {
+		if (direction == SOUND_DIR_REC || direction == SOUND_DIR_DUPLEX) {
+			sprintf(port_name, "rx%d", i + 1);
+			sound->cport[i] = jack_port_register(sound->client, port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0);
+			if (!sound->cport[i] || ringbuffer_init(&sound->crb[i], size, sizeof(float)) < 0) {
+				LOGP(DSOUND, LOGL_ERROR, "Failed to register JACK port '%s'\n", port_name);
+				goto error;
+			}
+		}
+		if (direction == SOUND_DIR_PLAY || direction == SOUND_DIR_DUPLEX) {
+			sprintf(port_name, "tx%d", i + 1);
+			sound->pport[i] = jack_port_register(sound->client, port_name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+			if (!sound->pport[i] || ringbuffer_init(&sound->prb[i], size, sizeof(float)) < 0) {
+				LOGP(DSOUND, LOGL_ERROR, "Failed to register JACK port '%s'\n", port_name);
+				goto error;
+			}
+		}
+	}
+
+	jack_set_process_callback(sound->client, jack_process, sound);
+	jack_on_shutdown(sound->client, jack_shutdown, sound);
+
+#ifdef HAVE_MOBILE
+	if (rx_frequency) {
+		sender_t *sender;
+		for (i = 0; i < channels; i++) {
+			sound->rx_frequency[i] = rx_frequency[i];
+			sender = get_sender_by_empfangsfrequenz(sound->rx_frequency[i]);
+			if (!sender)
+				continue;
+			sound->dmp[i] = display_measurements_add(&sender->dispmeas, "RX Level", "%.1f dB", DISPLAY_MEAS_PEAK, DISPLAY_MEAS_LEFT, -96.0, 0.0, -INFINITY);
+		}
+	}
+#endif
+
+	LOGP(DSOUND, LOGL_INFO, "JACK client '%s' uses %d channel(s) with a period of %d frames.\n", jack_get_client_name(sound->client), channels, sound->period);
+
+	return sound;
+
+error:
+	sound_jack_close(sound);
+	return NULL;
+}
+
+/* start streaming */
+int sound_jack_start(void *inst)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+	int rc;
+
+	rc = jack_activate(sound->client);
+	if (rc) {
+		LOGP(DSOUND, LOGL_ERROR, "Cannot activate JACK client\n");
+		return -EIO;
+	}
+	connect_ports(sound);
+
+	return 0;
+}
+
+void sound_jack_close(void *inst)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+	int i;
+
+	if (sound->client) {
+		jack_deactivate(sound->client);
+		jack_client_close(sound->client);
+	}
+	if (atomic_load(&sound->overruns) || atomic_load(&sound->underruns))
+		LOGP(DSOUND, LOGL_NOTICE, "JACK client had %d overrun(s) and %d underrun(s).\n", atomic_load(&sound->overruns), atomic_load(&sound->underruns));
+	for (i = 0; i < MAX_CHANNELS; i++) {
+		ringbuffer_exit(&sound->crb[i]);
+		ringbuffer_exit(&sound->prb[i]);
+	}
+	if (sound->efd >= 0)
+		close(sound->efd);
+	free(sound);
+}
+
+int sound_jack_write(void *inst, sample_t **samples, uint8_t __attribute__((unused)) **power, int num, enum paging_signal __attribute__((unused)) *paging_signal, int __attribute__((unused)) *on, int __attribute__((unused)) channels)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+	float scale = 1.0 / sound->spl_deviation;
+	sample_t *s;
+	float *span;
+	int i, pos, len, j;
+
+	if (sound->direction != SOUND_DIR_PLAY && sound->direction != SOUND_DIR_DUPLEX)
+		return -EINVAL;
+	if (atomic_load(&sound->shutdown))
+		return -EIO;
+
+	if (num > ringbuffer_space(&sound->prb[0]))
+		num = ringbuffer_space(&sound->prb[0]);
+
+	for (i = 0; i < sound->channels; i++) {
+		s = samples[i];
+		for (pos = 0; pos < num; pos += len) {
+			len = ringbuffer_write_span(&sound->prb[i], (void **)&span);
+			if (len > num - pos)
+				len = num - pos;
+			for (j = 0; j < len; j++)
+				span[j] = s[pos + j] * scale;
+			ringbuffer_write_commit(&sound->prb[i], len);
+		}
+	}
+
+	return num;
+}
+
+int sound_jack_read(void *inst, sample_t **samples, int num, int channels, double *rf_level_db)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+	sample_t spl_deviation = sound->spl_deviation;
+	float max[MAX_CHANNELS], a;
+	float *span;
+	sample_t *s;
+	int i, pos, len, j, fill;
+
+	if (sound->direction != SOUND_DIR_REC && sound->direction != SOUND_DIR_DUPLEX)
+		return -EINVAL;
+	if (atomic_load(&sound->shutdown))
+		return -EIO;
+
+	/* the ports are written one after another, so take what all of them have */
+	for (i = 0; i < sound->channels; i++) {
+		fill = ringbuffer_fill(&sound->crb[i]);
+		if (num > fill)
+			num = fill;
+	}
+
+	memset(max, 0, sizeof(max));
+	for (i = 0; i < sound->channels; i++) {
+		s = samples[i];
+		for (pos = 0; pos < num; pos += len) {
+			len = ringbuffer_read_span(&sound->crb[i], (void **)&span);
+			if (len > num - pos)
+				len = num - pos;
+			for (j = 0; j < len; j++) {
+				a = fabsf(span[j]);
+				max[i] = (a > max[i]) ? a : max[i];
+				s[pos + j] = span[j] * spl_deviation;
+			}
+			ringbuffer_read_release(&sound->crb[i], len);
+		}
+	}
+	if (num == 0)
+		return 0;
+
+	for (i = 0; i < channels; i++) {
+		if (rf_level_db)
+			rf_level_db[i] = NAN;
+#ifdef HAVE_MOBILE
+		/* sender was resolved when opening, no measurement if there is none */
+		if (!sound->dmp[i])
+			continue;
+		display_measurements_update(sound->dmp[i], log10(max[i]) * 20, 0.0);
+#endif
+	}
+
+	return num;
+}
+
+/* get number of samples in playback ring, that have not been played yet */
+int sound_jack_get_tosend(void *inst, int buffer_size)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+	int tosend;
+
+	if (atomic_load(&sound->shutdown))
+		return -EIO;
+	if (!sound->pport[0])
+		return buffer_size;
+
+	tosend = buffer_size - ringbuffer_fill(&sound->prb[0]);
+	if (tosend < 0)
+		tosend = 0;
+	return tosend;
+}
+
+/* the event descriptor wakes up after each period of the server */
+int sound_jack_get_poll(void *inst, struct pollfd *pfds, int space)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+
+	if (space < 1)
+		return 0;
+
+	pfds[0].fd = sound->efd;
+	pfds[0].events = POLLIN;
+	pfds[0].revents = 0;
+
+	return 1;
+}
+
+int sound_jack_poll_ready(void *inst, struct pollfd *pfds, int __attribute__((unused)) num)
+{
+	sound_jack_t *sound = (sound_jack_t *)inst;
+	uint64_t events;
+	int __attribute__((unused)) rc;
+
+	if (!(pfds[0].revents & (POLLIN | POLLERR)))
+		return 0;
+
+	/* clear the counter, periods that were missed are processed at once */
+	rc = read(sound->efd, &events, sizeof(events));
+
+	return 1;
+}
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <math.h>
 #include <stdint.h>
+#include "../libsample/sample.h"
 #include "../liblogging/logging.h"
 #include "squelch.h"
 
@@ -42,18 +43,40 @@
  * If the mute state is set, the loss counter is incremented. If the mute state
  * is not set, the loss counter is reset. When the loss counter reaches
  * loss_time, the 'loss' condition is returned.
+ *
+ * The level is processed as linear power, so no logarithm is required for each
+ * chunk. squelch_power() takes the power of each sample, as it is calculated
+ * from the I/Q vectors, squelch() takes the level of the whole chunk in dB.
+ *
+ * Automatic threshold: The average power of each calibration window is stored
+ * in a history, if the window contains noise only. The noise floor is a low
+ * percentile of that history, so it follows the floor in both directions,
+ * while short carriers or fading do not change it. A window contains noise
+ * only, if the squelch was muted during the window, or if the power samples
+ * spread like noise: The power of noise is exponentially distributed, so the
+ * standard deviation equals the average. The power of a carrier with noise
+ * spreads much less. A fading carrier spreads like noise also, but noise
+ * averages out within each chunk, while fading is much slower. So the average
+ * power of the chunks must be steady. This way the floor can rise above the
+ * threshold and still be detected, while a received carrier never raises the
+ * threshold itself.
  */
 
 /* NOTE: SQUELCH must be calibrated !AFTER! DC bias, to get the actual noise floor */
 #define SQUELCH_INIT_TIME	0.1	/* wait some time before performing squelch */
 #define SQUELCH_AUTO_TIME	0.5	/* duration of squelch quelch calibration */
 #define SQUELCH_AUTO_OFFSET	10.0	/* auto calibration: offset above noise floor */
+#define SQUELCH_AUTO_PERCENTILE	0.25	/* auto calibration: percentile of history that is the noise floor */
+#define SQUELCH_AUTO_SPREAD	0.5	/* auto calibration: variance / average^2 of samples above this is noise */
+#define SQUELCH_AUTO_STEADY	0.05	/* auto calibration: variance / average^2 of chunks below this is noise */
+#define SQUELCH_AUTO_HYSTERESIS	0.1	/* auto calibration: change of threshold in dB to be applied */
 
 void squelch_init(squelch_t *squelch, const char *kanal, double threshold_db, double mute_time, double loss_time)
 {
 	memset(squelch, 0, sizeof(*squelch));
 	squelch->kanal = kanal;
 	squelch->threshold_db = threshold_db;
+	squelch->threshold = pow(10.0, threshold_db / 10.0);
 	/* wait for init condition */
 	squelch->init_count = 0.0;
 	/* measure noise floor for auto threshold mode */
@@ -74,8 +97,95 @@ void squelch_init(squelch_t *squelch, const char *kanal, double threshold_db, do
 	squelch->loss_state = 1;
 }
 
-enum squelch_result squelch(squelch_t *squelch, double rf_level_db, double duration)
+/* change threshold at run time, squelch starts over as on init */
+void squelch_set_threshold(squelch_t *squelch, double threshold_db)
+{
+	squelch_init(squelch, squelch->kanal, threshold_db, squelch->mute_time, squelch->loss_time);
+}
+
+/* noise floor is a low percentile of the recent windows of noise */
+static double noise_floor(squelch_t *squelch)
+{
+	double sorted[SQUELCH_AUTO_HISTORY], power;
+	int num = squelch->auto_history_num;
+	int i, j;
+
+	/* insertion sort, the history is small */
+	for (i = 0; i < num; i++) {
+		power = squelch->auto_history[i];
+		for (j = i; j > 0 && sorted[j - 1] > power; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = power;
+	}
+
+	return sorted[(int)((double)(num - 1) * SQUELCH_AUTO_PERCENTILE)];
+}
+
+/* end of calibration window: store noise and set threshold above the noise floor */
+static void calibrate(squelch_t *squelch)
 {
+	double average, variance, chunk_average, chunk_variance, threshold;
+	int noise;
+
+	average = squelch->auto_power_sum / (double)squelch->auto_power_count;
+	variance = squelch->auto_square_sum / (double)squelch->auto_power_count - average * average;
+	chunk_average = squelch->auto_chunk_sum / (double)squelch->auto_chunk_count;
+	chunk_variance = squelch->auto_chunk_square_sum / (double)squelch->auto_chunk_count - chunk_average * chunk_average;
+	noise = !squelch->auto_carrier
+	     || (variance > SQUELCH_AUTO_SPREAD * average * average && chunk_variance < SQUELCH_AUTO_STEADY * chunk_average * chunk_average);
+
+	squelch->auto_count = 0.0;
+	squelch->auto_power_sum = 0.0;
+	squelch->auto_square_sum = 0.0;
+	squelch->auto_power_count = 0;
+	squelch->auto_chunk_sum = 0.0;
+	squelch->auto_chunk_square_sum = 0.0;
+	squelch->auto_chunk_count = 0;
+	squelch->auto_carrier = !squelch->mute_state;
+
+	if (!noise || !(average > 0.0))
+		return;
+	squelch->auto_history[squelch->auto_history_pos] = average;
+	squelch->auto_history_pos = (squelch->auto_history_pos + 1) % SQUELCH_AUTO_HISTORY;
+	if (squelch->auto_history_num < SQUELCH_AUTO_HISTORY)
+		squelch->auto_history_num++;
+
+	threshold = noise_floor(squelch) * pow(10.0, SQUELCH_AUTO_OFFSET / 10.0);
+	/* must change by 0.1 dB, so we prevent repeated debugging message with similar value */
+	if (threshold > squelch->threshold * pow(10.0, -SQUELCH_AUTO_HYSTERESIS / 10.0)
+	 && threshold < squelch->threshold * pow(10.0, SQUELCH_AUTO_HYSTERESIS / 10.0))
+		return;
+	squelch->threshold = threshold;
+	squelch->threshold_db = log10(threshold) * 10.0;
+	LOGP_CHAN(DDSP, LOGL_INFO, "RF signal measurement: %.1f dB noise floor, using squelch threshold of %.1f dB\n", squelch->threshold_db - SQUELCH_AUTO_OFFSET, squelch->threshold_db);
+}
+
+/* sum of power and squared power, four independent sums, so the loop can be vectorized */
+static void power_sums(const sample_t *power, int num, double *sum, double *square_sum)
+{
+	double s[4] = { 0.0, 0.0, 0.0, 0.0 }, q[4] = { 0.0, 0.0, 0.0, 0.0 };
+	int i, j;
+
+	for (i = 0; i + 4 <= num; i += 4) {
+		for (j = 0; j < 4; j++) {
+			s[j] += power[i + j];
+			q[j] += (double)power[i + j] * power[i + j];
+		}
+	}
+	for (; i < num; i++) {
+		s[0] += power[i];
+		q[0] += (double)power[i] * power[i];
+	}
+
+	*sum = s[0] + s[1] + s[2] + s[3];
+	*square_sum = q[0] + q[1] + q[2] + q[3];
+}
+
+/* process a chunk, given by the power of each sample */
+enum squelch_result squelch_power(squelch_t *squelch, const sample_t *power, int num, double duration)
+{
+	double sum, square_sum, average;
+
 	/* squelch disabled */
 	if (isinf(squelch->threshold_db))
 		return SQUELCH_OPEN;
@@ -85,32 +195,32 @@ enum squelch_result squelch(squelch_t *squelch, double rf_level_db, double durat
 	if (squelch->init_count < SQUELCH_INIT_TIME)
 		return SQUELCH_MUTE;
 
-	/* measure noise floor and calibrate threashold_db */
+	if (num < 1)
+		return (squelch->mute_state) ? SQUELCH_MUTE : SQUELCH_OPEN;
+	power_sums(power, num, &sum, &square_sum);
+	average = sum / (double)num;
+
+	/* measure noise floor and calibrate threashold */
 	if (squelch->auto_state) {
 		squelch->auto_count += duration;
-		squelch->auto_level_sum += rf_level_db;
-		squelch->auto_level_count++;
-		if (squelch->auto_count >= SQUELCH_AUTO_TIME) {
-			double noise_db, threshold_db;
-			noise_db = squelch->auto_level_sum / (double) squelch->auto_level_count;
-			threshold_db = noise_db + SQUELCH_AUTO_OFFSET;
-			/* must be 0.1 dB smaller, so we prevent repeated debugging message with similar value */
-			if (threshold_db < squelch->threshold_db - 0.1) {
-				squelch->threshold_db = threshold_db;
-				LOGP_CHAN(DDSP, LOGL_INFO, "RF signal measurement: %.1f dB noise floor, using squelch threshold of %.1f dB\n", noise_db, threshold_db);
-			}
-			squelch->auto_count = 0.0;
-			squelch->auto_level_count = 0;
-			squelch->auto_level_sum = 0.0;
-		}
+		squelch->auto_power_sum += sum;
+		squelch->auto_square_sum += square_sum;
+		squelch->auto_power_count += num;
+		squelch->auto_chunk_sum += average;
+		squelch->auto_chunk_square_sum += average * average;
+		squelch->auto_chunk_count++;
+		if (!squelch->mute_state)
+			squelch->auto_carrier = 1;
+		if (squelch->auto_count >= SQUELCH_AUTO_TIME)
+			calibrate(squelch);
 	}
 
 	/* enough RF level, so we unmute when mute_count reached 0 */
-	if (rf_level_db >= squelch->threshold_db) {
+	if (average >= squelch->threshold) {
 		squelch->mute_count -= duration;
 		if (squelch->mute_count <= 0.0) {
 			if (squelch->mute_state) {
-				LOGP_CHAN(DDSP, LOGL_INFO, "RF signal strong: Unmuting audio (RF %.1f >= %.1f dB)\n", rf_level_db, squelch->threshold_db);
+				LOGP_CHAN(DDSP, LOGL_INFO, "RF signal strong: Unmuting audio (RF %.1f >= %.1f dB)\n", log10(average) * 10.0, squelch->threshold_db);
 				squelch->mute_state = 0;
 			}
 			squelch->mute_count = 0.0;
@@ -120,7 +230,7 @@ enum squelch_result squelch(squelch_t *squelch, double rf_level_db, double durat
 		squelch->mute_count += duration;
 		if (squelch->mute_count >= squelch->mute_time) {
 			if (!squelch->mute_state) {
-				LOGP_CHAN(DDSP, LOGL_INFO, "RF signal weak: Muting audio (RF %.1f < %.1f dB)\n", rf_level_db, squelch->threshold_db);
+				LOGP_CHAN(DDSP, LOGL_INFO, "RF signal weak: Muting audio (RF %.1f < %.1f dB)\n", log10(average) * 10.0, squelch->threshold_db);
 				squelch->mute_state = 1;
 			}
 			squelch->mute_count = squelch->mute_time;
@@ -146,3 +256,10 @@ enum squelch_result squelch(squelch_t *squelch, double rf_level_db, double durat
 	}
 }
 
+/* process a chunk, given by its level */
+enum squelch_result squelch(squelch_t *squelch, double rf_level_db, double duration)
+{
+	sample_t power = pow(10.0, rf_level_db / 10.0);
+
+	return squelch_power(squelch, &power, 1, duration);
+}
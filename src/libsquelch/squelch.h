@@ -1,12 +1,23 @@
 
+#define SQUELCH_AUTO_HISTORY	16	/* windows of noise that are kept to estimate the noise floor */
+
 typedef struct squelch {
 	const char *kanal;	/* channel number */
 	double	threshold_db;	/* threshold level to mute or loss of signal */
+	double	threshold;	/* same as linear power */
 	double	init_count;	/* duration counter for starting squelch process */
 	int	auto_state;	/* set if auto threshold calibration is performed */
 	double	auto_count;	/* duration counter for calibration process */
-	double	auto_level_sum;	/* sum of rf level while calibrating */
-	int	auto_level_count; /* counter for rf levels that are summed */
+	double	auto_power_sum;	/* sum of power samples while calibrating */
+	double	auto_square_sum; /* sum of squared power samples while calibrating */
+	int	auto_power_count; /* counter for power samples that are summed */
+	double	auto_chunk_sum;	/* sum of average power of each chunk while calibrating */
+	double	auto_chunk_square_sum; /* sum of squared average power of each chunk */
+	int	auto_chunk_count; /* counter for chunks that are summed */
+	int	auto_carrier;	/* set if the squelch was open during the window */
+	double	auto_history[SQUELCH_AUTO_HISTORY]; /* average power of recent windows of noise */
+	int	auto_history_num; /* number of windows in history */
+	int	auto_history_pos; /* next window to replace */
 	double	mute_time;	/* time to indicate mute after being below threshold */
 	int	mute_state;	/* set, if we are currently at mute condition */
 	double	mute_count;	/* duration counter for mute condition */
@@ -22,5 +33,7 @@ enum squelch_result {
 };
 
 void squelch_init(squelch_t *squelch, const char *kanal, double threshold_db, double mute_time, double loss_time);
+void squelch_set_threshold(squelch_t *squelch, double threshold_db);
 enum squelch_result squelch(squelch_t *squelch, double rf_level_db, double duration);
+enum squelch_result squelch_power(squelch_t *squelch, const sample_t *power, int num, double duration);
 
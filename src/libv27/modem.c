@@ -24,23 +24,41 @@
 #include "../libsample/sample.h"
 #include "modem.h"
 
+/* get 8 bits in advance and scramble them at once */
 static int psk_send_bit(void *inst)
 {
 	v27modem_t *modem = (v27modem_t *)inst;
 	uint8_t bit;
-
-	bit = modem->send_bit(modem->inst);
-	bit = v27_scrambler_bit(&modem->scrambler, bit);
+	int i;
+
+	if (modem->tx_count == 0) {
+		modem->tx_byte = 0;
+		for (i = 0; i < 8; i++)
+			modem->tx_byte |= (modem->send_bit(modem->inst) & 1) << i;
+		v27_scrambler_block(&modem->scrambler, &modem->tx_byte, 1);
+		modem->tx_count = 8;
+	}
+	bit = modem->tx_byte & 1;
+	modem->tx_byte >>= 1;
+	modem->tx_count--;
 
 	return bit;
 }
 
+/* collect 8 bits and descramble them at once */
 static void psk_receive_bit(void *inst, int bit)
 {
 	v27modem_t *modem = (v27modem_t *)inst;
-
-	bit = v27_scrambler_bit(&modem->descrambler, bit);
-	modem->receive_bit(modem->inst, bit);
+	int i;
+
+	modem->rx_byte |= (bit & 1) << modem->rx_count;
+	if (++modem->rx_count < 8)
+		return;
+	v27_scrambler_block(&modem->descrambler, &modem->rx_byte, 1);
+	for (i = 0; i < 8; i++)
+		modem->receive_bit(modem->inst, (modem->rx_byte >> i) & 1);
+	modem->rx_byte = 0;
+	modem->rx_count = 0;
 }
 
 /* init psk */
@@ -7,6 +7,8 @@ typedef struct v27modem {
 	void		*inst;
 
 	v27scrambler_t	scrambler, descrambler;
+	uint8_t		tx_byte, rx_byte;	/* bits are scrambled/descrambled byte wise */
+	int		tx_count, rx_count;	/* number of bits in byte */
 	psk_mod_t	psk_mod;
 	psk_demod_t	psk_demod;
 } v27modem_t;
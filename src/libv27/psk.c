@@ -22,26 +22,21 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <math.h>
 #include "../liblogging/logging.h"
 #include "../libsample/sample.h"
 #include "psk.h"
 
-/* bits to phase change */
-double phase_change8[8] = {
-	2.0 * M_PI * 1.0 / 8.0,
-	2.0 * M_PI * 0.0 / 8.0,
-	2.0 * M_PI * 2.0 / 8.0,
-	2.0 * M_PI * 3.0 / 8.0,
-	2.0 * M_PI * 6.0 / 8.0,
-	2.0 * M_PI * 7.0 / 8.0,
-	2.0 * M_PI * 5.0 / 8.0,
-	2.0 * M_PI * 4.0 / 8.0,
-};
+/* bits to phase change in 1/8 of 360 degrees */
+static const uint8_t phase_index8[8] = { 1, 0, 2, 3, 6, 7, 5, 4 };
 
 /* phase change to bits */
 uint8_t phase2bits[8] = { 1, 0, 2, 3, 7, 6, 4, 5 };
 
+/* phasor of each phase index */
+static double phase_I[8], phase_Q[8];
+
 /* debug decoder */
 //#define DEBUG_DECODER
 
@@ -123,18 +118,47 @@ int psk_mod_init(psk_mod_t *psk, void *inst, int (*send_bit)(void *inst), int sa
 		return -EINVAL;
 	}
 
+	int i;
+	double sum;
+
 	/* fixme: make correct filter */
 	cutoff = RX_CARRIER - 100;
 	transitionband = 200;
 	psk->lp[0] = fir_lowpass_init((double)samplerate, cutoff, transitionband);
-	psk->lp[1] = fir_lowpass_init((double)samplerate, cutoff, transitionband);
+	if (!psk->lp[0])
+		return -ENOMEM;
         LOGP(DDSP, LOGL_DEBUG, "Cut off frequency is at %.1f Hz and %.1f Hz.\n", TX_CARRIER + cutoff, TX_CARRIER - cutoff);
 
 	psk->symbols_per_sample = symbolrate / (double)samplerate;
 	LOGP(DDSP, LOGL_DEBUG, "Symbol duration of %.4f symbols per sample @ %d.\n", psk->symbols_per_sample, samplerate);
 
-	psk->carrier_phaseshift = 2.0 * M_PI * TX_CARRIER / (double)samplerate;
-	LOGP(DDSP, LOGL_DEBUG, "Carrier phase shift of %.4f per sample @ %d.\n", psk->carrier_phaseshift, samplerate);
+	/* the phasor is constant during a symbol, so the filtered phasor is the
+	 * sum of the filter's step response, weighted by each symbol change */
+	psk->step_len = psk->lp[0]->ntaps;
+	psk->step = calloc(psk->step_len, sizeof(*psk->step));
+	psk->change_size = (int)ceil((double)psk->step_len * psk->symbols_per_sample) + 2;
+	psk->change = calloc(psk->change_size, sizeof(*psk->change));
+	if (!psk->step || !psk->change) {
+		LOGP(DDSP, LOGL_ERROR, "No mem!\n");
+		return -ENOMEM;
+	}
+	/* the newest sample is multiplied with the last tap */
+	for (i = 0, sum = 0.0; i < psk->step_len; i++) {
+		sum += psk->lp[0]->taps[psk->step_len - 1 - i];
+		psk->step[i] = sum;
+	}
+	for (i = 0; i < 8; i++) {
+		phase_I[i] = cos(2.0 * M_PI * (double)i / 8.0);
+		phase_Q[i] = sin(2.0 * M_PI * (double)i / 8.0);
+	}
+	/* the filter's input changes from silence to the first phasor */
+	psk->change[0].I = phase_I[0];
+	psk->change_num = 1;
+
+	psk->carrier_re = 1.0;
+	psk->rotate_re = cos(2.0 * M_PI * TX_CARRIER / (double)samplerate);
+	psk->rotate_im = sin(2.0 * M_PI * TX_CARRIER / (double)samplerate);
+	LOGP(DDSP, LOGL_DEBUG, "Carrier phase shift of %.4f per sample @ %d.\n", 2.0 * M_PI * TX_CARRIER / (double)samplerate, samplerate);
 #endif
 
 	return 0;
@@ -150,6 +174,10 @@ void psk_mod_exit(psk_mod_t *psk)
 		fir_exit(psk->lp[1]);
 		psk->lp[1] = NULL;
 	}
+	free(psk->step);
+	psk->step = NULL;
+	free(psk->change);
+	psk->change = NULL;
 }
 
 void psk_mod(psk_mod_t *psk, sample_t *sample, int length)
@@ -188,10 +216,12 @@ void psk_mod(psk_mod_t *psk, sample_t *sample, int length)
 	}
 	fir_process(psk->lp[0], sample, length);
 #else
-	sample_t I[length], Q[length];
+	struct psk_change *c;
+	double I, Q, re, im, scale;
+	int i, n, index;
 
-	/* count symbol and get new bits for next symbol */
 	for (s = 0; s < length; s++) {
+		/* count symbol and get new bits for next symbol */
 		psk->symbol_pos += psk->symbols_per_sample;
 		if (psk->symbol_pos >= 1.0) {
 			psk->symbol_pos -= 1.0;
@@ -207,28 +237,48 @@ void psk_mod(psk_mod_t *psk, sample_t *sample, int length)
 			bits = nextbit;
 #endif
 
-			/* change phase_shift */
-			psk->phase_shift += phase_change8[bits];
-			if (psk->phase_shift > M_PI)
-				psk->phase_shift -= 2.0 * M_PI;
+			/* change phase and store change of phasor */
+			index = (psk->phase_index + phase_index8[bits]) & 7;
+			c = &psk->change[(psk->change_head + psk->change_num++) % psk->change_size];
+			c->age = 0;
+			c->I = phase_I[index] - phase_I[psk->phase_index];
+			c->Q = phase_Q[index] - phase_Q[psk->phase_index];
+			psk->phase_index = index;
 		}
 
-		I[s] = cos(psk->phase_shift);
-		Q[s] = sin(psk->phase_shift);
-	}
-
-	/* filter phase_shift to limit bandwidth */
-	fir_process(psk->lp[0], I, length);
-	fir_process(psk->lp[1], Q, length);
+		/* filter phasor to limit bandwidth */
+		I = psk->base_I;
+		Q = psk->base_Q;
+		for (i = 0, n = psk->change_head; i < psk->change_num; i++) {
+			c = &psk->change[n];
+			I += c->I * psk->step[c->age];
+			Q += c->Q * psk->step[c->age];
+			c->age++;
+			if (++n == psk->change_size)
+				n = 0;
+		}
+		/* oldest change has passed the filter */
+		c = &psk->change[psk->change_head];
+		if (psk->change_num && c->age == psk->step_len) {
+			psk->base_I += c->I * psk->step[psk->step_len - 1];
+			psk->base_Q += c->Q * psk->step[psk->step_len - 1];
+			if (++psk->change_head == psk->change_size)
+				psk->change_head = 0;
+			psk->change_num--;
+		}
 
-	/* modulate with carrier frequency */
-	for (s = 0; s < length; s++) {
-		/* compensate overshooting of filter */
-		*sample++ = (I[s] * cos(psk->carrier_phase) - Q[s] * sin(psk->carrier_phase)) * 0.7;
-		psk->carrier_phase += psk->carrier_phaseshift;
-		if (psk->carrier_phase >= 2.0 * M_PI)
-			psk->carrier_phase -= 2.0 * M_PI;
+		/* modulate with carrier frequency, compensate overshooting of filter */
+		*sample++ = (I * psk->carrier_re - Q * psk->carrier_im) * 0.7;
+		re = psk->carrier_re * psk->rotate_re - psk->carrier_im * psk->rotate_im;
+		im = psk->carrier_re * psk->rotate_im + psk->carrier_im * psk->rotate_re;
+		psk->carrier_re = re;
+		psk->carrier_im = im;
 	}
+
+	/* keep phasor at unit length */
+	scale = (3.0 - (psk->carrier_re * psk->carrier_re + psk->carrier_im * psk->carrier_im)) / 2.0;
+	psk->carrier_re *= scale;
+	psk->carrier_im *= scale;
 #endif
 }
 
@@ -254,12 +304,14 @@ int psk_demod_init(psk_demod_t *psk, void *inst, void (*receive_bit)(void *inst,
 	psk->lp[1] = fir_lowpass_init((double)samplerate, cutoff, transitionband);
 	iir_lowpass_init(&psk->lp_error[0], 50.0, samplerate, 2);
 	iir_lowpass_init(&psk->lp_error[1], 50.0, samplerate, 2);
-	iir_bandpass_init(&psk->lp_clock, symbolrate, samplerate, 40);
+	iir_bandpass_cascade_init(&psk->lp_clock, symbolrate, samplerate, 40);
 	psk->sample_delay = (int)floor((double)samplerate / symbolrate * 0.25); /* percent of sine duration behind zero crossing */
 	LOGP(DDSP, LOGL_DEBUG, "Cut off frequency is at %.1f Hz and %.1f Hz.\n", RX_CARRIER + cutoff, RX_CARRIER - cutoff);
 
-	psk->carrier_phaseshift = 2.0 * M_PI * -RX_CARRIER / (double)samplerate;
-	LOGP(DDSP, LOGL_DEBUG, "Carrier phase shift of %.4f per sample @ %d.\n", psk->carrier_phaseshift, samplerate);
+	psk->carrier_re = 1.0;
+	psk->rotate_re = cos(2.0 * M_PI * -RX_CARRIER / (double)samplerate);
+	psk->rotate_im = sin(2.0 * M_PI * -RX_CARRIER / (double)samplerate);
+	LOGP(DDSP, LOGL_DEBUG, "Carrier phase shift of %.4f per sample @ %d.\n", 2.0 * M_PI * -RX_CARRIER / (double)samplerate, samplerate);
 
 	return 0;
 }
@@ -343,39 +395,53 @@ static void debug_phase(double phase, double amplitude, double error, double amp
 
 void psk_demod(psk_demod_t *psk, sample_t *sample, int length)
 {
-	sample_t I[length], Q[length], i;
+	sample_t I[length], Q[length];
 	sample_t Ip[length], Qp[length];
-	double phases[length];
-	sample_t amplitudes[length], amplitudes2[length];
-	double phaseshift, phase, phase_error, angle_error;
+	sample_t amplitudes2[length];
+	double re, im, rotate_re, rotate_im, r2, a, scale, re8, im8;
+	double phase, phase_error, angle_error;
 	uint16_t phase_error_int, offset;
-	int s, ss;
+	int s;
 	uint8_t sector, rotation, bits;
 
-	/* demodulate phase from carrier */
-	phaseshift = psk->carrier_phaseshift;
-	phase = psk->carrier_phase;
-	for (s = 0, ss = 0; s < length; s++) {
-		phase += phaseshift;
-		i = sample[ss++];
-		if (phase < 0)
-			phase += 2.0 * M_PI;
-		else if (phase >= 2.0 * M_PI)
-			phase -= 2.0 * M_PI;
-		I[s] = i * cos(phase);
-		Q[s] = i * sin(phase);
+	/* demodulate phase from carrier, the phasor is rotated before use */
+	re = psk->carrier_re;
+	im = psk->carrier_im;
+	rotate_re = psk->rotate_re;
+	rotate_im = psk->rotate_im;
+	for (s = 0; s < length; s++) {
+		a = re * rotate_re - im * rotate_im;
+		im = re * rotate_im + im * rotate_re;
+		re = a;
+		I[s] = sample[s] * re;
+		Q[s] = sample[s] * im;
 	}
-	psk->carrier_phase = phase;
-	fir_process(psk->lp[0], I, length);
-	fir_process(psk->lp[1], Q, length);
-
-	/* get phase error */
-	for (s = 0, ss = 0; s < length; s++) {
-		phases[s] = atan2(Q[s], I[s]);
-		amplitudes[s] = sqrt(Q[s] * Q[s] + I[s] * I[s]) * 2.0;
-		amplitudes2[s] = amplitudes[s];
-		Ip[s] = amplitudes[s] * cos(phases[s] * 8.0) * 2.0;
-		Qp[s] = amplitudes[s] * sin(phases[s] * 8.0) * 2.0;
+	/* keep phasor at unit length */
+	scale = (3.0 - (re * re + im * im)) / 2.0;
+	psk->carrier_re = re * scale;
+	psk->carrier_im = im * scale;
+	fir_process_iq(psk->lp[0], psk->lp[1], I, Q, length);
+
+	/* get phase error: the phasor with 8 times the phase angle is z^8 / |z|^7 */
+	for (s = 0; s < length; s++) {
+		r2 = Q[s] * Q[s] + I[s] * I[s];
+		a = sqrt(r2);
+		amplitudes2[s] = a * 2.0;
+		if (a < 1e-30) {
+			Ip[s] = Qp[s] = 0.0;
+			continue;
+		}
+		/* z^2, z^4, z^8 */
+		re8 = I[s] * I[s] - Q[s] * Q[s];
+		im8 = 2.0 * I[s] * Q[s];
+		re = re8 * re8 - im8 * im8;
+		im = 2.0 * re8 * im8;
+		re8 = re * re - im * im;
+		im8 = 2.0 * re * im;
+		/* amplitude (2 * |z|) * 2 / |z|^8 */
+		scale = 4.0 / (r2 * r2 * r2 * r2) * a;
+		Ip[s] = re8 * scale;
+		Qp[s] = im8 * scale;
 	}
 	iir_process(&psk->lp_error[0], Ip, length);
 	iir_process(&psk->lp_error[1], Qp, length);
@@ -383,7 +449,7 @@ void psk_demod(psk_demod_t *psk, sample_t *sample, int length)
 	/* filter amplitude to get symbol clock */
 	/* NOTE: the filter biases the amplitude, so that we have positive and negative peaks.
 	   positive peak is the sample point */
-	iir_process(&psk->lp_clock, amplitudes2, length);
+	iir_cascade_process(&psk->lp_clock, amplitudes2, length);
 
 	for (s = 0; s < length; s++) {
 		/* calculate change of phase error angle within one sample */
@@ -403,7 +469,7 @@ void psk_demod(psk_demod_t *psk, sample_t *sample, int length)
 		/* if we have reached a zero crossing of the amplitude signal, wait for sample point */
 		if (psk->sample_timer && --psk->sample_timer == 0) {
 			/* sample point reached */
-			phase = fmod(phases[s] - phase_error + 4.0 * M_PI, 2.0 * M_PI);
+			phase = fmod(atan2(Q[s], I[s]) - phase_error + 4.0 * M_PI, 2.0 * M_PI);
 			if (phase < 2.0 * M_PI / 16.0 * 1.0)
 				sector = 0;
 			else if (phase < 2.0 * M_PI / 16.0 * 3.0)
@@ -448,7 +514,7 @@ void psk_demod(psk_demod_t *psk, sample_t *sample, int length)
 		if (++when > 10000) {
 			printf("\0337\033[H");
 			/* display amplitude between 0.0 and 1.0, aplitude2 between -0.5 and 0.5 */
-			debug_phase(phases[s], amplitudes[s], phase_error, amplitudes2[s]);
+			debug_phase(atan2(Q[s], I[s]), sqrt(Q[s] * Q[s] + I[s] * I[s]) * 2.0, phase_error, amplitudes2[s]);
 			printf("phase2 = %.4f offset = %d, error = %d (error & 0xffff = %d)\n", phase_error, offset, psk->phase_error, psk->phase_error & 0xffff);
 			printf("\033[0;39m\0338"); fflush(stdout);
 			usleep(50000);
@@ -7,11 +7,20 @@ typedef struct psk_mod {
 
 	double		symbol_pos;		/* current position in symbol */
 	double		symbols_per_sample;	/* change of position per sample */
-	double		phase_shift;		/* carrier phase shift */
-	double		carrier_phase;		/* current carrier phase */
-	double		carrier_phaseshift;	/* shift of phase per sample */
+	int		phase_index;		/* carrier phase shift in 1/8 of 360 degrees */
+	double		carrier_re, carrier_im;	/* current carrier phasor */
+	double		rotate_re, rotate_im;	/* rotation of phasor per sample */
 
 	fir_filter_t	*lp[2];			/* filter for limiting spectrum */
+	double		*step;			/* step response of filter */
+	int		step_len;		/* length of step response */
+	struct psk_change {
+		int	age;			/* samples since change */
+		double	I, Q;			/* change of phasor */
+	}		*change;		/* ring of symbol changes within step response */
+	int		change_size;		/* size of ring */
+	int		change_head, change_num;/* oldest entry and number of entries */
+	double		base_I, base_Q;		/* sum of changes older than step response */
 
 	int		spl_count;		/* SIT: counter for 30 samples (symbol duration) */
 	int		sym_list[5];		/* SIT: list of 5 symbols */
@@ -22,12 +31,12 @@ typedef struct psk_demod {
 	void		(*receive_bit)(void *inst, int bit);
 	void		*inst;
 
-	double		carrier_phase;		/* current carrier phase */
-	double		carrier_phaseshift;	/* shift of phase per sample */
+	double		carrier_re, carrier_im;	/* current carrier phasor */
+	double		rotate_re, rotate_im;	/* rotation of phasor per sample */
 
 	fir_filter_t	*lp[2];			/* filter for limiting spectrum */
 	iir_filter_t	lp_error[2];		/* filter for phase correction */
-	iir_filter_t	lp_clock;		/* filter for symbol clock */
+	iir_cascade_t	lp_clock;		/* filter for symbol clock */
 
 	uint16_t	last_phase_error;	/* error phase of last sample */
 	int32_t		phase_error;		/* current phase error */
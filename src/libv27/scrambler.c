@@ -82,9 +82,62 @@
 
 #define GUARD_COUNT	34
 
+/* Tables for processing a whole byte at once, as long as the guard counter
+ * cannot expire within that byte.
+ *
+ * The bits of a byte are processed LSB first. For the bit parallel
+ * operations, the stored bits (input of descrambler, output of scrambler)
+ * are held in time reversed order, like the shift register does: The last
+ * bit of the byte is at bit 0, older bits are at higher positions.
+ *
+ * The scrambler is recursive. Because it is linear, the output byte is the
+ * sum (XOR) of the output for the input byte with cleared shift register and
+ * the output for the previous 7 output bits with zero input.
+ */
+static int tables_init = 0;
+static uint8_t reverse_table[256];		/* reverse bit order */
+static uint8_t scramble_in_table[256];		/* output of input byte */
+static uint8_t scramble_shift_table[128];	/* output of last 7 output bits */
+
+static void init_tables(void)
+{
+	int i, j;
+	uint16_t shift;
+	uint8_t bit, out;
+
+	for (i = 0; i < 256; i++) {
+		for (j = 0, out = 0; j < 8; j++)
+			out |= ((i >> j) & 1) << (7 - j);
+		reverse_table[i] = out;
+	}
+
+	/* shift register holds previous output bits at bits 1..7 */
+	for (i = 0; i < 256; i++) {
+		for (j = 0, shift = 0, out = 0; j < 8; j++) {
+			bit = ((i >> j) & 1) ^ ((shift >> 6) & 1) ^ ((shift >> 7) & 1);
+			shift = (shift | bit) << 1;
+			out |= bit << j;
+		}
+		scramble_in_table[i] = out;
+	}
+	for (i = 0; i < 128; i++) {
+		for (j = 0, shift = i << 1, out = 0; j < 8; j++) {
+			bit = ((shift >> 6) & 1) ^ ((shift >> 7) & 1);
+			shift = (shift | bit) << 1;
+			out |= bit << j;
+		}
+		scramble_shift_table[i] = out;
+	}
+
+	tables_init = 1;
+}
+
 /* init scrambler */
 void v27_scrambler_init(v27scrambler_t *scram, int bis, int descramble)
 {
+	if (!tables_init)
+		init_tables();
+
 	memset(scram, 0, sizeof(*scram));
 
 	scram->descramble = descramble;
@@ -143,21 +196,63 @@ uint8_t v27_scrambler_bit(v27scrambler_t *scram, uint8_t in)
 	return bit0;
 }
 
+/* scramble/descramble one byte bit by bit */
+static uint8_t scrambler_byte_slow(v27scrambler_t *scram, uint8_t in)
+{
+	uint8_t out = 0;
+	int j;
+
+	for (j = 0; j < 8; j++) {
+		out >>= 1;
+		// Note: 'in' will be masked to bit 0 only
+		out |= v27_scrambler_bit(scram, in) << 7;
+		in >>= 1;
+	}
+
+	return out;
+}
+
 /* scramble/descramble block of bytes (LSB first) */
 void v27_scrambler_block(v27scrambler_t *scram, uint8_t *data, int len)
 {
-	int i, j;
-	uint8_t in, out = 0;
+	uint16_t resetmask = scram->resetmask;
+	uint32_t stored, reset;
+	uint8_t in, out;
+	int i;
 
 	for (i = 0; i < len; i++) {
 		in = data[i];
-		for (j = 0; j < 8; j++) {
-			out >>= 1;
-			// Note: 'in' will be masked to bit 0 only
-			out |= v27_scrambler_bit(scram, in) << 7;
-			in >>= 1;
+
+		/* the guard counter may expire, so the inversion must be done bit by bit */
+		if (scram->counter <= 8) {
+			data[i] = scrambler_byte_slow(scram, in);
+			continue;
+		}
+
+		if (scram->descramble) {
+			stored = (uint32_t)scram->shift << 7 | reverse_table[in];
+			/* xor each bit with bits 6 and 7 */
+			out = reverse_table[(uint8_t)(stored ^ (stored >> 6) ^ (stored >> 7))];
+		} else {
+			out = scramble_in_table[in] ^ scramble_shift_table[(scram->shift >> 1) & 0x7f];
+			stored = (uint32_t)scram->shift << 7 | reverse_table[out];
 		}
 		data[i] = out;
+
+		/* get bits where none of the bits (8),9,12 is a repetition */
+		reset = 0xff;
+		if ((resetmask & 0x0100))
+			reset &= stored ^ (stored >> 8);
+		reset &= stored ^ (stored >> 9);
+		reset &= stored ^ (stored >> 12);
+		reset &= 0xff;
+
+		/* restart counter at the last reset within this byte (lowest bit) */
+		if (reset)
+			scram->counter = GUARD_COUNT - __builtin_ctz(reset);
+		else
+			scram->counter -= 8;
+		scram->shift = stored << 1;
 	}
 }
 
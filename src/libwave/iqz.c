@@ -0,0 +1,718 @@
+/* lossless compressed IQ/audio files
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* File layout (all values little endian):
+ *
+ * header:	"IQZ1", samplerate (32), channels (16), frames per block (16),
+ *		total frames (64), offset of index (64), reserved (32)
+ * block:	size of block data (32), frames (16), channels (16), data
+ * data:	for each channel: order (8), shift (8), then either the raw
+ *		samples (order 255) or 'order' warm up samples (16 each),
+ *		followed by a bit stream of partitions. Each partition has a Rice
+ *		parameter (5 bits) and Rice coded residuals. The bit stream is
+ *		padded to full bytes.
+ * index:	"IDX ", number of blocks (32), offset of each block (64)
+ *
+ * The shift removes low bits that are zero in all samples of a channel. If
+ * the index is missing (recording was not finished), it is rebuilt by
+ * scanning the block headers. Because blocks have a fixed number of frames,
+ * the index allows seeking to any frame.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <endian.h>
+#include "../liblogging/logging.h"
+#include "iqz.h"
+
+#define ORDER_RAW	255
+#define ESCAPE		31	/* unary value that escapes to a raw residual */
+#define ESCAPE_BITS	24
+#define MAX_RICE	20
+#define BLOCK_HEADER	8
+/* worst case: escape for every residual */
+#define MAX_CODED(frames)	(2 + IQZ_MAX_ORDER * 2 + ((frames) / IQZ_PARTITION + 1) + (frames) * (ESCAPE + 1 + ESCAPE_BITS + 7) / 8)
+
+static void put16(uint8_t *b, uint16_t v)
+{
+	b[0] = v;
+	b[1] = v >> 8;
+}
+
+static void put32(uint8_t *b, uint32_t v)
+{
+	put16(b, v);
+	put16(b + 2, v >> 16);
+}
+
+static void put64(uint8_t *b, uint64_t v)
+{
+	put32(b, v);
+	put32(b + 4, v >> 32);
+}
+
+static uint16_t get16(const uint8_t *b)
+{
+	return b[0] | (b[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *b)
+{
+	return get16(b) | ((uint32_t)get16(b + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t *b)
+{
+	return get32(b) | ((uint64_t)get32(b + 4) << 32);
+}
+
+/*
+ * bit stream
+ */
+
+typedef struct bitstream {
+	uint8_t		*p, *end;
+	uint64_t	acc;
+	int		bits;
+} bitstream_t;
+
+static inline void put_bits(bitstream_t *bs, uint32_t value, int n)
+{
+	bs->acc = (bs->acc << n) | value;
+	bs->bits += n;
+	while (bs->bits >= 8) {
+		bs->bits -= 8;
+		*bs->p++ = bs->acc >> bs->bits;
+	}
+}
+
+static void put_flush(bitstream_t *bs)
+{
+	if (bs->bits)
+		put_bits(bs, 0, 8 - bs->bits);
+}
+
+static inline uint32_t get_bits(bitstream_t *bs, int n)
+{
+	while (bs->bits < n) {
+		/* read zeros beyond end, the caller checks for overrun */
+		bs->acc = (bs->acc << 8) | ((bs->p < bs->end) ? *bs->p : 0);
+		bs->p++;
+		bs->bits += 8;
+	}
+	bs->bits -= n;
+	return (bs->acc >> bs->bits) & ((1ULL << n) - 1);
+}
+
+/* align to byte and return number of bytes read */
+static size_t get_flush(bitstream_t *bs, const uint8_t *start)
+{
+	bs->bits = 0;
+	return bs->p - start;
+}
+
+/*
+ * prediction
+ */
+
+static void residual(const int32_t *x, int32_t *r, int num, int order)
+{
+	int i;
+
+	switch (order) {
+	case 0:
+		for (i = 0; i < num; i++)
+			r[i] = x[i];
+		break;
+	case 1:
+		for (i = 1; i < num; i++)
+			r[i] = x[i] - x[i - 1];
+		break;
+	case 2:
+		for (i = 2; i < num; i++)
+			r[i] = x[i] - 2 * x[i - 1] + x[i - 2];
+		break;
+	case 3:
+		for (i = 3; i < num; i++)
+			r[i] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+		break;
+	case 4:
+		for (i = 4; i < num; i++)
+			r[i] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+		break;
+	}
+}
+
+static void restore(int32_t *x, const int32_t *r, int num, int order)
+{
+	int i;
+
+	switch (order) {
+	case 0:
+		for (i = 0; i < num; i++)
+			x[i] = r[i];
+		break;
+	case 1:
+		for (i = 1; i < num; i++)
+			x[i] = r[i] + x[i - 1];
+		break;
+	case 2:
+		for (i = 2; i < num; i++)
+			x[i] = r[i] + 2 * x[i - 1] - x[i - 2];
+		break;
+	case 3:
+		for (i = 3; i < num; i++)
+			x[i] = r[i] + 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3];
+		break;
+	case 4:
+		for (i = 4; i < num; i++)
+			x[i] = r[i] + 4 * x[i - 1] - 6 * x[i - 2] + 4 * x[i - 3] - x[i - 4];
+		break;
+	}
+}
+
+/* select the order with smallest sum of absolute residuals, using the
+ * differences of each order to calculate the next order */
+static int select_order(const int32_t *x, int num)
+{
+	int32_t last[IQZ_MAX_ORDER + 1], d[IQZ_MAX_ORDER + 1];
+	uint64_t sum[IQZ_MAX_ORDER + 1];
+	int i, o, best;
+
+	if (num <= IQZ_MAX_ORDER)
+		return 0;
+
+	memset(sum, 0, sizeof(sum));
+	memset(last, 0, sizeof(last));
+	for (i = 0; i < num; i++) {
+		d[0] = x[i];
+		for (o = 1; o <= IQZ_MAX_ORDER; o++)
+			d[o] = d[o - 1] - last[o - 1];
+		if (i >= IQZ_MAX_ORDER) {
+			for (o = 0; o <= IQZ_MAX_ORDER; o++)
+				sum[o] += abs(d[o]);
+		}
+		memcpy(last, d, sizeof(last));
+	}
+
+	best = 0;
+	for (o = 1; o <= IQZ_MAX_ORDER; o++) {
+		if (sum[o] < sum[best])
+			best = o;
+	}
+
+	return best;
+}
+
+static inline uint32_t zigzag(int32_t r)
+{
+	return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t u)
+{
+	return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static int rice_param(const uint32_t *u, int num)
+{
+	uint64_t sum = 0;
+	int i, k;
+
+	for (i = 0; i < num; i++)
+		sum += u[i];
+	for (k = 0; k < MAX_RICE && ((uint64_t)num << (k + 1)) <= sum; k++)
+		;
+
+	return k;
+}
+
+/* code one channel of a block, return number of bytes */
+static size_t encode_channel(uint8_t *out, const int16_t *spl, int num)
+{
+	int32_t x[IQZ_BLOCK], r[IQZ_BLOCK];
+	uint32_t u[IQZ_PARTITION];
+	bitstream_t bs;
+	int i, j, p, n, k, order, shift;
+	uint32_t q, or = 0;
+
+	/* remove low bits that are always zero */
+	for (i = 0; i < num; i++)
+		or |= (uint16_t)spl[i];
+	for (shift = 0; shift < 15 && or && !(or & (1 << shift)); shift++)
+		;
+	for (i = 0; i < num; i++)
+		x[i] = spl[i] >> shift;
+
+	order = select_order(x, num);
+	if (order > num)
+		order = 0;
+	residual(x, r, num, order);
+
+	out[0] = order;
+	out[1] = shift;
+	for (i = 0; i < order; i++)
+		put16(out + 2 + i * 2, x[i]);
+
+	bs.p = out + 2 + order * 2;
+	bs.acc = 0;
+	bs.bits = 0;
+	for (p = order; p < num; p += n) {
+		/* partitions are aligned to the block, the first one is shorter */
+		n = (p / IQZ_PARTITION + 1) * IQZ_PARTITION - p;
+		if (n > num - p)
+			n = num - p;
+		for (j = 0; j < n; j++)
+			u[j] = zigzag(r[p + j]);
+		k = rice_param(u, n);
+		put_bits(&bs, k, 5);
+		for (j = 0; j < n; j++) {
+			q = u[j] >> k;
+			if (q < ESCAPE) {
+				put_bits(&bs, 1, q + 1);
+				put_bits(&bs, u[j] & ((1 << k) - 1), k);
+			} else {
+				put_bits(&bs, 1, ESCAPE + 1);
+				put_bits(&bs, u[j], ESCAPE_BITS);
+			}
+		}
+	}
+	put_flush(&bs);
+
+	/* store raw samples, if coding does not reduce the size */
+	if ((size_t)(bs.p - out) >= 2 + (size_t)num * 2) {
+		out[0] = ORDER_RAW;
+		out[1] = 0;
+		for (i = 0; i < num; i++)
+			put16(out + 2 + i * 2, spl[i]);
+		return 2 + num * 2;
+	}
+
+	return bs.p - out;
+}
+
+/* decode one channel of a block, return number of bytes or error */
+static int decode_channel(const uint8_t *in, size_t size, int16_t *spl, int num)
+{
+	int32_t x[IQZ_BLOCK], r[IQZ_BLOCK];
+	bitstream_t bs;
+	int i, j, p, n, k, order, shift;
+	uint32_t q, u;
+	size_t len;
+
+	if (size < 2)
+		return -EINVAL;
+	order = in[0];
+	shift = in[1];
+
+	if (order == ORDER_RAW) {
+		if (size < 2 + (size_t)num * 2)
+			return -EINVAL;
+		for (i = 0; i < num; i++)
+			spl[i] = get16(in + 2 + i * 2);
+		return 2 + num * 2;
+	}
+	if (order > IQZ_MAX_ORDER || order > num || shift > 15 || size < 2 + (size_t)order * 2)
+		return -EINVAL;
+
+	for (i = 0; i < order; i++)
+		x[i] = (int16_t)get16(in + 2 + i * 2);
+
+	bs.p = (uint8_t *)in + 2 + order * 2;
+	bs.end = (uint8_t *)in + size;
+	bs.acc = 0;
+	bs.bits = 0;
+	for (p = order; p < num; p += n) {
+		n = (p / IQZ_PARTITION + 1) * IQZ_PARTITION - p;
+		if (n > num - p)
+			n = num - p;
+		k = get_bits(&bs, 5);
+		if (k > MAX_RICE)
+			return -EINVAL;
+		for (j = 0; j < n; j++) {
+			for (q = 0; q < ESCAPE && !get_bits(&bs, 1); q++)
+				;
+			if (q == ESCAPE) {
+				if (!get_bits(&bs, 1))
+					return -EINVAL;
+				u = get_bits(&bs, ESCAPE_BITS);
+			} else
+				u = (q << k) | get_bits(&bs, k);
+			r[p + j] = unzigzag(u);
+		}
+		if (bs.p > bs.end)
+			return -EINVAL;
+	}
+	len = get_flush(&bs, in);
+	if (len > size)
+		return -EINVAL;
+
+	restore(x, r, num, order);
+	for (i = 0; i < num; i++)
+		spl[i] = (uint32_t)x[i] << shift;
+
+	return len;
+}
+
+/*
+ * encoder
+ */
+
+static int write_header(iqz_enc_t *enc, uint64_t index_offset)
+{
+	uint8_t header[IQZ_HEADER_SIZE];
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, IQZ_MAGIC, 4);
+	put32(header + 4, enc->samplerate);
+	put16(header + 8, enc->channels);
+	put16(header + 10, IQZ_BLOCK);
+	put64(header + 12, enc->frames);
+	put64(header + 20, index_offset);
+	if (fwrite(header, 1, sizeof(header), enc->fp) != sizeof(header))
+		return -EIO;
+
+	return 0;
+}
+
+int iqz_enc_init(iqz_enc_t *enc, FILE *fp, int samplerate, int channels)
+{
+	memset(enc, 0, sizeof(*enc));
+	if (channels < 1 || channels > IQZ_MAX_CHANNELS)
+		return -EINVAL;
+	enc->fp = fp;
+	enc->samplerate = samplerate;
+	enc->channels = channels;
+
+	enc->block = calloc(channels * IQZ_BLOCK, sizeof(*enc->block));
+	enc->out = malloc(BLOCK_HEADER + channels * MAX_CODED(IQZ_BLOCK));
+	if (!enc->block || !enc->out) {
+		LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+		iqz_enc_exit(enc);
+		return -ENOMEM;
+	}
+
+	/* frames and index are written when finished */
+	enc->offset = IQZ_HEADER_SIZE;
+	return write_header(enc, 0);
+}
+
+static int encode_block(iqz_enc_t *enc)
+{
+	size_t size = BLOCK_HEADER;
+	uint64_t *index;
+	int c;
+
+	if (!enc->fill)
+		return 0;
+
+	for (c = 0; c < enc->channels; c++)
+		size += encode_channel(enc->out + size, enc->block + c * IQZ_BLOCK, enc->fill);
+	put32(enc->out, size - BLOCK_HEADER);
+	put16(enc->out + 4, enc->fill);
+	put16(enc->out + 6, enc->channels);
+
+	if (enc->index_num == enc->index_size) {
+		enc->index_size = (enc->index_size) ? enc->index_size * 2 : 1024;
+		index = realloc(enc->index, enc->index_size * sizeof(*index));
+		if (!index) {
+			LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+			return -ENOMEM;
+		}
+		enc->index = index;
+	}
+	enc->index[enc->index_num++] = enc->offset;
+
+	if (fwrite(enc->out, 1, size, enc->fp) != size)
+		return -EIO;
+	enc->offset += size;
+	enc->frames += enc->fill;
+	enc->fill = 0;
+
+	return 0;
+}
+
+/* add interleaved little endian frames, code each complete block */
+int iqz_enc_write(iqz_enc_t *enc, const int16_t *frames, int num)
+{
+	int i, c, n, rc;
+
+	while (num) {
+		n = IQZ_BLOCK - enc->fill;
+		if (n > num)
+			n = num;
+		for (c = 0; c < enc->channels; c++) {
+			int16_t *row = enc->block + c * IQZ_BLOCK + enc->fill;
+			for (i = 0; i < n; i++)
+				row[i] = le16toh(frames[i * enc->channels + c]);
+		}
+		enc->fill += n;
+		frames += n * enc->channels;
+		num -= n;
+		if (enc->fill == IQZ_BLOCK) {
+			rc = encode_block(enc);
+			if (rc < 0)
+				return rc;
+		}
+	}
+
+	return 0;
+}
+
+/* code last block, write index and complete header */
+int iqz_enc_finish(iqz_enc_t *enc)
+{
+	uint8_t buffer[8];
+	int i, rc;
+
+	rc = encode_block(enc);
+	if (rc < 0)
+		return rc;
+
+	memcpy(buffer, "IDX ", 4);
+	put32(buffer + 4, enc->index_num);
+	if (fwrite(buffer, 1, 8, enc->fp) != 8)
+		return -EIO;
+	for (i = 0; i < enc->index_num; i++) {
+		put64(buffer, enc->index[i]);
+		if (fwrite(buffer, 1, 8, enc->fp) != 8)
+			return -EIO;
+	}
+
+	fseek(enc->fp, 0, SEEK_SET);
+	return write_header(enc, enc->offset);
+}
+
+void iqz_enc_exit(iqz_enc_t *enc)
+{
+	free(enc->block);
+	enc->block = NULL;
+	free(enc->out);
+	enc->out = NULL;
+	free(enc->index);
+	enc->index = NULL;
+}
+
+/*
+ * decoder
+ */
+
+/* rebuild index of an unfinished file by scanning the block headers */
+static int scan_blocks(iqz_dec_t *dec)
+{
+	uint8_t header[BLOCK_HEADER];
+	uint64_t offset = IQZ_HEADER_SIZE, *index;
+	int index_size = 0;
+
+	dec->frames = 0;
+	while (1) {
+		fseek(dec->fp, offset, SEEK_SET);
+		if (fread(header, 1, BLOCK_HEADER, dec->fp) != BLOCK_HEADER)
+			break;
+		if (get16(header + 6) != dec->channels || get16(header + 4) > dec->block_frames)
+			break;
+		if (dec->index_num == index_size) {
+			index_size = (index_size) ? index_size * 2 : 1024;
+			index = realloc(dec->index, index_size * sizeof(*index));
+			if (!index) {
+				LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+				return -ENOMEM;
+			}
+			dec->index = index;
+		}
+		dec->index[dec->index_num++] = offset;
+		dec->frames += get16(header + 4);
+		offset += BLOCK_HEADER + get32(header);
+	}
+
+	/* the last block may be truncated */
+	if (dec->index_num) {
+		fseek(dec->fp, 0, SEEK_END);
+		if ((uint64_t)ftell(dec->fp) < offset) {
+			dec->index_num--;
+			dec->frames = (uint64_t)dec->index_num * dec->block_frames;
+		}
+	}
+	LOGP(DWAVE, LOGL_NOTICE, "Compressed file was not finished, recovered %d blocks.\n", dec->index_num);
+
+	return 0;
+}
+
+int iqz_dec_init(iqz_dec_t *dec, FILE *fp, int *samplerate_p, int *channels_p)
+{
+	uint8_t header[IQZ_HEADER_SIZE], buffer[8];
+	uint64_t index_offset;
+	int i, rc;
+
+	memset(dec, 0, sizeof(*dec));
+	dec->fp = fp;
+
+	if (fread(header, 1, sizeof(header), fp) != sizeof(header) || !!memcmp(header, IQZ_MAGIC, 4)) {
+		LOGP(DWAVE, LOGL_ERROR, "Missing IQZ header, seems that this is no compressed file!\n");
+		return -EINVAL;
+	}
+	*samplerate_p = get32(header + 4);
+	*channels_p = dec->channels = get16(header + 8);
+	dec->block_frames = get16(header + 10);
+	dec->frames = get64(header + 12);
+	index_offset = get64(header + 20);
+	if (dec->channels < 1 || dec->channels > IQZ_MAX_CHANNELS || dec->block_frames < 1 || dec->block_frames > IQZ_BLOCK) {
+		LOGP(DWAVE, LOGL_ERROR, "Unsupported IQZ file: %d channels, %d frames per block!\n", dec->channels, dec->block_frames);
+		return -EINVAL;
+	}
+
+	dec->block = calloc(dec->channels * dec->block_frames, sizeof(*dec->block));
+	dec->in = malloc(dec->channels * MAX_CODED(dec->block_frames));
+	if (!dec->block || !dec->in) {
+		LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+		iqz_dec_exit(dec);
+		return -ENOMEM;
+	}
+
+	if (!index_offset) {
+		rc = scan_blocks(dec);
+		if (rc < 0) {
+			iqz_dec_exit(dec);
+			return rc;
+		}
+	} else {
+		fseek(fp, index_offset, SEEK_SET);
+		if (fread(buffer, 1, 8, fp) != 8 || !!memcmp(buffer, "IDX ", 4)) {
+			LOGP(DWAVE, LOGL_ERROR, "IQZ file has corrupt index!\n");
+			iqz_dec_exit(dec);
+			return -EINVAL;
+		}
+		dec->index_num = get32(buffer + 4);
+		dec->index = malloc(dec->index_num * sizeof(*dec->index) + 1);
+		if (!dec->index) {
+			LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+			iqz_dec_exit(dec);
+			return -ENOMEM;
+		}
+		for (i = 0; i < dec->index_num; i++) {
+			if (fread(buffer, 1, 8, fp) != 8) {
+				LOGP(DWAVE, LOGL_ERROR, "IQZ file has short index!\n");
+				iqz_dec_exit(dec);
+				return -EINVAL;
+			}
+			dec->index[i] = get64(buffer);
+		}
+	}
+
+	return iqz_dec_seek(dec, 0);
+}
+
+static int decode_block(iqz_dec_t *dec)
+{
+	uint8_t header[BLOCK_HEADER];
+	size_t size, pos = 0;
+	int frames, c, rc;
+
+	/* the index follows the last block */
+	if (dec->next >= dec->index_num)
+		return 0;
+	if (fread(header, 1, BLOCK_HEADER, dec->fp) != BLOCK_HEADER)
+		return 0;
+	size = get32(header);
+	frames = get16(header + 4);
+	if (get16(header + 6) != dec->channels || frames > dec->block_frames || size > (size_t)dec->channels * MAX_CODED(dec->block_frames))
+		return -EINVAL;
+	if (fread(dec->in, 1, size, dec->fp) != size)
+		return 0;
+
+	for (c = 0; c < dec->channels; c++) {
+		rc = decode_channel(dec->in + pos, size - pos, dec->block + c * dec->block_frames, frames);
+		if (rc < 0)
+			return rc;
+		pos += rc;
+	}
+
+	dec->fill = frames;
+	dec->pos = 0;
+	dec->next++;
+	return frames;
+}
+
+/* read interleaved little endian frames, return number of frames read */
+int iqz_dec_read(iqz_dec_t *dec, int16_t *frames, int num)
+{
+	int got = 0, i, c, n, rc;
+
+	while (got < num) {
+		if (dec->pos == dec->fill) {
+			rc = decode_block(dec);
+			if (rc < 0) {
+				LOGP(DWAVE, LOGL_ERROR, "IQZ file has corrupt block!\n");
+				return rc;
+			}
+			if (rc == 0)
+				break;
+		}
+		n = dec->fill - dec->pos;
+		if (n > num - got)
+			n = num - got;
+		for (c = 0; c < dec->channels; c++) {
+			const int16_t *row = dec->block + c * dec->block_frames + dec->pos;
+			for (i = 0; i < n; i++)
+				frames[i * dec->channels + c] = htole16(row[i]);
+		}
+		frames += n * dec->channels;
+		dec->pos += n;
+		got += n;
+	}
+
+	return got;
+}
+
+/* seek to given frame, using the index */
+int iqz_dec_seek(iqz_dec_t *dec, uint64_t frame)
+{
+	uint64_t block = frame / dec->block_frames;
+	int rc;
+
+	dec->fill = dec->pos = 0;
+	if (block >= (uint64_t)dec->index_num) {
+		/* end of file */
+		dec->next = dec->index_num;
+		return 0;
+	}
+	fseek(dec->fp, dec->index[block], SEEK_SET);
+	dec->next = block;
+	rc = decode_block(dec);
+	if (rc < 0)
+		return rc;
+	dec->pos = frame - block * dec->block_frames;
+	if (dec->pos > dec->fill)
+		dec->pos = dec->fill;
+
+	return 0;
+}
+
+void iqz_dec_exit(iqz_dec_t *dec)
+{
+	free(dec->block);
+	dec->block = NULL;
+	free(dec->in);
+	dec->in = NULL;
+	free(dec->index);
+	dec->index = NULL;
+}
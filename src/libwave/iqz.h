@@ -0,0 +1,54 @@
+#ifndef _IQZ_H
+#define _IQZ_H
+
+/* lossless compressed IQ/audio files
+ *
+ * The file consists of a header, blocks of compressed 16 bit samples and an
+ * index of block offsets at the end. Each channel of a block is coded with a
+ * fixed polynomial predictor (order 0..4) and Rice coded residuals.
+ */
+
+#define IQZ_MAGIC		"IQZ1"
+#define IQZ_HEADER_SIZE		32
+#define IQZ_BLOCK		4096	/* frames per block */
+#define IQZ_MAX_ORDER		4
+#define IQZ_PARTITION		256	/* residuals per Rice parameter */
+#define IQZ_MAX_CHANNELS	8
+
+typedef struct iqz_enc {
+	FILE		*fp;
+	int		samplerate;
+	int		channels;
+	int16_t		*block;		/* samples of current block, one row per channel */
+	int		fill;		/* frames in current block */
+	uint8_t		*out;		/* coded block */
+	uint64_t	frames;		/* total frames written */
+	uint64_t	offset;		/* file offset of next block */
+	uint64_t	*index;		/* offset of each block */
+	int		index_num, index_size;
+} iqz_enc_t;
+
+typedef struct iqz_dec {
+	FILE		*fp;
+	int		channels;
+	int		block_frames;	/* frames per block, as written */
+	int16_t		*block;		/* decoded samples of current block */
+	int		fill;		/* frames in current block */
+	int		pos;		/* next frame to return from block */
+	int		next;		/* next block to decode */
+	uint8_t		*in;		/* coded block */
+	uint64_t	frames;		/* total frames in file */
+	uint64_t	*index;		/* offset of each block */
+	int		index_num;
+} iqz_dec_t;
+
+int iqz_enc_init(iqz_enc_t *enc, FILE *fp, int samplerate, int channels);
+int iqz_enc_write(iqz_enc_t *enc, const int16_t *frames, int num);
+int iqz_enc_finish(iqz_enc_t *enc);
+void iqz_enc_exit(iqz_enc_t *enc);
+int iqz_dec_init(iqz_dec_t *dec, FILE *fp, int *samplerate_p, int *channels_p);
+int iqz_dec_read(iqz_dec_t *dec, int16_t *frames, int num);
+int iqz_dec_seek(iqz_dec_t *dec, uint64_t frame);
+void iqz_dec_exit(iqz_dec_t *dec);
+
+#endif /* _IQZ_H */
@@ -0,0 +1,222 @@
+/* SigMF metadata sidecar of a recording
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The recording is a non-conforming dataset (e.g. 'rx.wav'), so the sidecar
+ * ('rx.sigmf-meta') refers to it with 'core:dataset' and skips the WAVE
+ * header with 'core:header_bytes'. Captures and annotations are collected
+ * while recording and the file is written when the recording ends.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include "../liblogging/logging.h"
+#include "sigmf.h"
+
+#define SIGMF_VERSION	"1.2.0"
+
+int sigmf_init(sigmf_t *meta, const char *data_filename, const char *datatype, int samplerate, size_t header_bytes)
+{
+	const char *base, *ext;
+	int len;
+
+	memset(meta, 0, sizeof(*meta));
+	strncpy(meta->datatype, datatype, sizeof(meta->datatype) - 1);
+	meta->samplerate = samplerate;
+	meta->header_bytes = header_bytes;
+
+	/* replace extension of data file by '.sigmf-meta' */
+	base = strrchr(data_filename, '/');
+	base = (base) ? base + 1 : data_filename;
+	ext = strrchr(base, '.');
+	len = (ext && ext != base) ? ext - data_filename : (int)strlen(data_filename);
+	meta->filename = malloc(len + 12);
+	meta->dataset = strdup(base);
+	if (!meta->filename || !meta->dataset) {
+		LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+		sigmf_exit(meta);
+		return -ENOMEM;
+	}
+	memcpy(meta->filename, data_filename, len);
+	strcpy(meta->filename + len, ".sigmf-meta");
+
+	return 0;
+}
+
+void sigmf_hw(sigmf_t *meta, const char *hw)
+{
+	strncpy(meta->hw, hw, sizeof(meta->hw) - 1);
+}
+
+/* add capture segment, starting at given sample with current time */
+int sigmf_capture(sigmf_t *meta, uint64_t sample_start, double frequency)
+{
+	sigmf_capture_t *capture;
+	struct timeval tv;
+	struct tm tm;
+	int len;
+
+	if (meta->captures_num == meta->captures_size) {
+		meta->captures_size = (meta->captures_size) ? meta->captures_size * 2 : 4;
+		capture = realloc(meta->captures, meta->captures_size * sizeof(*capture));
+		if (!capture) {
+			LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+			return -ENOMEM;
+		}
+		meta->captures = capture;
+	}
+	capture = &meta->captures[meta->captures_num++];
+	capture->sample_start = sample_start;
+	capture->frequency = frequency;
+	gettimeofday(&tv, NULL);
+	gmtime_r(&tv.tv_sec, &tm);
+	len = strftime(capture->datetime, sizeof(capture->datetime), "%Y-%m-%dT%H:%M:%S", &tm);
+	snprintf(capture->datetime + len, sizeof(capture->datetime) - len, ".%06ldZ", (long)tv.tv_usec);
+
+	return 0;
+}
+
+int sigmf_annotate(sigmf_t *meta, uint64_t sample_start, uint64_t sample_count, double freq_lower, double freq_upper, const char *label, const char *comment)
+{
+	sigmf_annotation_t *annotation;
+
+	if (meta->annotations_num == meta->annotations_size) {
+		meta->annotations_size = (meta->annotations_size) ? meta->annotations_size * 2 : 256;
+		annotation = realloc(meta->annotations, meta->annotations_size * sizeof(*annotation));
+		if (!annotation) {
+			LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+			return -ENOMEM;
+		}
+		meta->annotations = annotation;
+	}
+	annotation = &meta->annotations[meta->annotations_num++];
+	memset(annotation, 0, sizeof(*annotation));
+	annotation->sample_start = sample_start;
+	annotation->sample_count = sample_count;
+	annotation->freq_lower = freq_lower;
+	annotation->freq_upper = freq_upper;
+	if (label)
+		strncpy(annotation->label, label, sizeof(annotation->label) - 1);
+	if (comment)
+		strncpy(annotation->comment, comment, sizeof(annotation->comment) - 1);
+
+	return 0;
+}
+
+static void write_string(FILE *fp, const char *string)
+{
+	fputc('"', fp);
+	for (; *string; string++) {
+		if (*string == '"' || *string == '\\')
+			fprintf(fp, "\\%c", *string);
+		else if ((uint8_t)*string < 0x20)
+			fprintf(fp, "\\u%04x", (uint8_t)*string);
+		else
+			fputc(*string, fp);
+	}
+	fputc('"', fp);
+}
+
+/* SigMF requires annotations to be sorted by start sample */
+static int compare_annotation(const void *a, const void *b)
+{
+	const sigmf_annotation_t *x = a, *y = b;
+
+	return (x->sample_start > y->sample_start) - (x->sample_start < y->sample_start);
+}
+
+int sigmf_write(sigmf_t *meta)
+{
+	FILE *fp;
+	int i;
+
+	fp = fopen(meta->filename, "w");
+	if (!fp) {
+		LOGP(DWAVE, LOGL_ERROR, "Failed to create SigMF metadata file '%s'! (errno %d)\n", meta->filename, errno);
+		return -errno;
+	}
+
+	fprintf(fp, "{\n    \"global\": {\n");
+	fprintf(fp, "        \"core:datatype\": \"%s\",\n", meta->datatype);
+	fprintf(fp, "        \"core:sample_rate\": %d,\n", meta->samplerate);
+	fprintf(fp, "        \"core:version\": \"%s\",\n", SIGMF_VERSION);
+	fprintf(fp, "        \"core:dataset\": ");
+	write_string(fp, meta->dataset);
+	fprintf(fp, ",\n");
+	if (meta->hw[0]) {
+		fprintf(fp, "        \"core:hw\": ");
+		write_string(fp, meta->hw);
+		fprintf(fp, ",\n");
+	}
+	fprintf(fp, "        \"core:recorder\": \"osmocom-analog\"\n");
+	fprintf(fp, "    },\n    \"captures\": [");
+	for (i = 0; i < meta->captures_num; i++) {
+		fprintf(fp, "%s\n        {\n", (i) ? "," : "");
+		fprintf(fp, "            \"core:sample_start\": %llu,\n", (unsigned long long)meta->captures[i].sample_start);
+		if (i == 0 && meta->header_bytes)
+			fprintf(fp, "            \"core:header_bytes\": %zu,\n", meta->header_bytes);
+		fprintf(fp, "            \"core:frequency\": %.3f,\n", meta->captures[i].frequency);
+		fprintf(fp, "            \"core:datetime\": \"%s\"\n", meta->captures[i].datetime);
+		fprintf(fp, "        }");
+	}
+	fprintf(fp, "\n    ],\n    \"annotations\": [");
+	qsort(meta->annotations, meta->annotations_num, sizeof(*meta->annotations), compare_annotation);
+	for (i = 0; i < meta->annotations_num; i++) {
+		sigmf_annotation_t *a = &meta->annotations[i];
+		fprintf(fp, "%s\n        {\n", (i) ? "," : "");
+		fprintf(fp, "            \"core:sample_start\": %llu,\n", (unsigned long long)a->sample_start);
+		fprintf(fp, "            \"core:sample_count\": %llu", (unsigned long long)a->sample_count);
+		if (a->freq_lower || a->freq_upper) {
+			fprintf(fp, ",\n            \"core:freq_lower_edge\": %.3f", a->freq_lower);
+			fprintf(fp, ",\n            \"core:freq_upper_edge\": %.3f", a->freq_upper);
+		}
+		if (a->label[0]) {
+			fprintf(fp, ",\n            \"core:label\": ");
+			write_string(fp, a->label);
+		}
+		if (a->comment[0]) {
+			fprintf(fp, ",\n            \"core:comment\": ");
+			write_string(fp, a->comment);
+		}
+		fprintf(fp, "\n        }");
+	}
+	fprintf(fp, "\n    ]\n}\n");
+
+	fclose(fp);
+
+	LOGP(DWAVE, LOGL_NOTICE, "*** SigMF metadata written to %s.\n", meta->filename);
+
+	return 0;
+}
+
+void sigmf_exit(sigmf_t *meta)
+{
+	free(meta->filename);
+	meta->filename = NULL;
+	free(meta->dataset);
+	meta->dataset = NULL;
+	free(meta->captures);
+	meta->captures = NULL;
+	free(meta->annotations);
+	meta->annotations = NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef _SIGMF_H
+#define _SIGMF_H
+
+/* SigMF metadata sidecar of a recording */
+
+typedef struct sigmf_capture {
+	uint64_t	sample_start;
+	double		frequency;
+	char		datetime[32];	/* ISO 8601 UTC */
+} sigmf_capture_t;
+
+typedef struct sigmf_annotation {
+	uint64_t	sample_start;
+	uint64_t	sample_count;
+	double		freq_lower, freq_upper; /* 0 if not given */
+	char		label[32];
+	char		comment[64];
+} sigmf_annotation_t;
+
+typedef struct sigmf {
+	char		*filename;	/* name of metadata file */
+	char		*dataset;	/* name of data file, without path */
+	char		datatype[16];	/* e.g. 'ci16_le' or 'cf32_le' */
+	int		samplerate;
+	size_t		header_bytes;	/* bytes before first sample in data file */
+	char		hw[128];	/* description of hardware */
+	sigmf_capture_t	*captures;
+	int		captures_num, captures_size;
+	sigmf_annotation_t *annotations;
+	int		annotations_num, annotations_size;
+} sigmf_t;
+
+int sigmf_init(sigmf_t *meta, const char *data_filename, const char *datatype, int samplerate, size_t header_bytes);
+void sigmf_hw(sigmf_t *meta, const char *hw);
+int sigmf_capture(sigmf_t *meta, uint64_t sample_start, double frequency);
+int sigmf_annotate(sigmf_t *meta, uint64_t sample_start, uint64_t sample_count, double freq_lower, double freq_upper, const char *label, const char *comment);
+int sigmf_write(sigmf_t *meta);
+void sigmf_exit(sigmf_t *meta);
+
+#endif /* _SIGMF_H */
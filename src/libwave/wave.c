@@ -24,31 +24,184 @@
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include "../libsample/sample.h"
+#include "../libsample/memacct.h"
 #include "../liblogging/logging.h"
+#include "../liblogging/thread_prio.h"
 #include "wave.h"
+#include "iqz.h"
+#include "sigmf.h"
 
-/* NOTE: No locking required for writing and reading buffer pointers, since 'int' is atomic on >=32 bit machines */
+/* NOTE: The ring buffer holds one frame (all channels of one sample) per element. */
+
+/* number of playbacks that reached the end of their file */
+int wave_playbacks_finished = 0;
+
+/* part of recordings to play, if WAVE_FLAG_WINDOW is given */
+static double window_start = 0.0, window_duration = 0.0;
+
+int wave_format_parse(const char *name)
+{
+	if (!strcmp(name, "pcm16"))
+		return WAVE_FORMAT_PCM16;
+	if (!strcmp(name, "float"))
+		return WAVE_FORMAT_FLOAT;
+	if (!strcmp(name, "cs16"))
+		return WAVE_FORMAT_CS16;
+	if (!strcmp(name, "cf32"))
+		return WAVE_FORMAT_CF32;
+	if (!strcmp(name, "iqz"))
+		return WAVE_FORMAT_IQZ;
+	return -EINVAL;
+}
+
+const char *wave_format_name(int flags)
+{
+	switch (flags & WAVE_FORMAT_MASK) {
+	case WAVE_FORMAT_FLOAT:
+		return "float";
+	case WAVE_FORMAT_CS16:
+		return "cs16";
+	case WAVE_FORMAT_CF32:
+		return "cf32";
+	case WAVE_FORMAT_IQZ:
+		return "iqz";
+	}
+	return "pcm16";
+}
+
+/* raw formats have no header */
+static int is_raw(int flags)
+{
+	return (flags & WAVE_FORMAT_MASK) == WAVE_FORMAT_CS16 || (flags & WAVE_FORMAT_MASK) == WAVE_FORMAT_CF32;
+}
+
+static int format_bytes(int flags)
+{
+	return ((flags & WAVE_FORMAT_MASK) == WAVE_FORMAT_FLOAT || (flags & WAVE_FORMAT_MASK) == WAVE_FORMAT_CF32) ? 4 : 2;
+}
+
+/* Convert samples to interleaved little endian frames of 16 bit integer or
+ * 32 bit float. The loops are simple, so that they can be vectorized. */
+static void samples_to_int16(int16_t *spl, sample_t **samples, int offset, int num, int channels, double max_deviation)
+{
+	double scale = 32767.0 / max_deviation;
+	int c;
+
+	for (c = 0; c < channels; c++)
+		samples_to_int16_scale(spl + c, channels, samples[c] + offset, num, scale);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	int i;
+	for (i = 0; i < num * channels; i++)
+		spl[i] = __builtin_bswap16(spl[i]);
+#endif
+}
+
+static void samples_to_float(float *spl, sample_t **samples, int offset, int num, int channels, double max_deviation)
+{
+	float scale = 1.0 / max_deviation;
+	sample_t *in;
+	int i, c;
+
+	for (c = 0; c < channels; c++) {
+		in = samples[c] + offset;
+		if (max_deviation == 1.0) {
+			/* no multiplication, so that float samples are stored bit exact */
+			for (i = 0; i < num; i++)
+				spl[i * channels + c] = in[i];
+		} else {
+			for (i = 0; i < num; i++)
+				spl[i * channels + c] = in[i] * scale;
+		}
+	}
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	uint32_t *word = (uint32_t *)spl;
+	for (i = 0; i < num * channels; i++)
+		word[i] = __builtin_bswap32(word[i]);
+#endif
+}
+
+static void samples_to_frames(uint8_t *frames, sample_t **samples, int offset, int num, int channels, int bytes, double max_deviation)
+{
+	if (bytes == 4)
+		samples_to_float((float *)frames, samples, offset, num, channels, max_deviation);
+	else
+		samples_to_int16((int16_t *)frames, samples, offset, num, channels, max_deviation);
+}
+
+static void int16_to_samples(sample_t **samples, int offset, const int16_t *spl, int num, int channels, double max_deviation)
+{
+	double scale = max_deviation / 32767.0;
+	int c;
+
+	for (c = 0; c < channels; c++) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		sample_t *out = samples[c] + offset;
+		int i;
+		for (i = 0; i < num; i++)
+			out[i] = (double)(int16_t)__builtin_bswap16(spl[i * channels + c]) * scale;
+#else
+		int16_to_samples_scale(samples[c] + offset, spl + c, channels, num, scale);
+#endif
+	}
+}
+
+static void float_to_samples(sample_t **samples, int offset, const float *spl, int num, int channels, double max_deviation)
+{
+	sample_t *out;
+	int i, c;
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	float swapped[num * channels];
+	const uint32_t *word = (const uint32_t *)spl;
+	for (i = 0; i < num * channels; i++) {
+		uint32_t w = __builtin_bswap32(word[i]);
+		memcpy(&swapped[i], &w, 4);
+	}
+	spl = swapped;
+#endif
+	for (c = 0; c < channels; c++) {
+		out = samples[c] + offset;
+		if (max_deviation == 1.0) {
+			for (i = 0; i < num; i++)
+				out[i] = spl[i * channels + c];
+		} else {
+			for (i = 0; i < num; i++)
+				out[i] = (double)spl[i * channels + c] * max_deviation;
+		}
+	}
+}
+
+static void frames_to_samples(sample_t **samples, int offset, const uint8_t *frames, int num, int channels, int bytes, double max_deviation)
+{
+	if (bytes == 4)
+		float_to_samples(samples, offset, (const float *)frames, num, channels, max_deviation);
+	else
+		int16_to_samples(samples, offset, (const int16_t *)frames, num, channels, max_deviation);
+}
 
 static void *record_child(void *arg)
 {
 	wave_rec_t *rec = (wave_rec_t *)arg;
-	int to_write, to_end, len;
+	int to_write, len;
+	void *span;
+
+	thread_prio_apply(THREAD_WAVE);
 
-	while (!rec->finish || rec->buffer_writep != rec->buffer_readp) {
-		/* how much data is in buffer */
-		to_write = (rec->buffer_size + rec->buffer_writep - rec->buffer_readp) % rec->buffer_size;
+	while (!rec->finish || ringbuffer_fill(&rec->ring)) {
+		/* how much data is in buffer, up to the end of buffer */
+		to_write = ringbuffer_read_span(&rec->ring, &span);
 		if (to_write == 0) {
 			usleep(10000);
 			continue;
 		}
-		/* only write up to the end of buffer */
-		to_end = rec->buffer_size - rec->buffer_readp;
-		if (to_end < to_write)
-			to_write = to_end;
-		/* write */
+		/* write or compress */
 		errno = 0;
-		len = fwrite(rec->buffer + rec->buffer_readp, 1, to_write, rec->fp);
+		if (rec->iqz)
+			len = (iqz_enc_write(rec->iqz, span, to_write) < 0) ? -1 : to_write;
+		else
+			len = fwrite(span, rec->ring.element_size, to_write, rec->fp);
 		/* quit on error */
 		if (len < 0) {
 error:
@@ -57,9 +210,7 @@ error:
 			return NULL;
 		}
 		/* increment read pointer */
-		rec->buffer_readp += len;
-		if (rec->buffer_readp == rec->buffer_size)
-			rec->buffer_readp = 0;
+		ringbuffer_read_release(&rec->ring, len);
 		/* quit on end of file */
 		if (len != to_write)
 			goto error;
@@ -71,21 +222,23 @@ error:
 static void *playback_child(void *arg)
 {
 	wave_play_t *play = (wave_play_t *)arg;
-	int to_read, to_end, len;
+	int to_read, len;
+	void *span;
+
+	thread_prio_apply(THREAD_WAVE);
 
 	while(!play->finish) {
-		/* how much space is in buffer */
-		to_read = (play->buffer_size + play->buffer_readp - play->buffer_writep - 1) % play->buffer_size;
+		/* how much space is in buffer, up to the end of buffer */
+		to_read = ringbuffer_write_span(&play->ring, &span);
 		if (to_read == 0) {
 			usleep(10000);
 			continue;
 		}
-		/* only read up to the end of buffer */
-		to_end = play->buffer_size - play->buffer_writep;
-		if (to_end < to_read)
-			to_read = to_end;
-		/* read */
-		len = fread(play->buffer + play->buffer_writep, 1, to_read, play->fp);
+		/* read or decompress */
+		if (play->iqz)
+			len = iqz_dec_read(play->iqz, span, to_read);
+		else
+			len = fread(span, play->ring.element_size, to_read, play->fp);
 		/* quit on error */
 		if (len < 0) {
 			LOGP(DWAVE, LOGL_ERROR, "Failed to read from playback WAVE file! (errno %d)\n", errno);
@@ -93,9 +246,7 @@ static void *playback_child(void *arg)
 			return NULL;
 		}
 		/* increment write pointer */
-		play->buffer_writep += len;
-		if (play->buffer_writep == play->buffer_size)
-			play->buffer_writep = 0;
+		ringbuffer_write_commit(&play->ring, len);
 		/* quit on end of file */
 		if (len != to_read) {
 			play->finish = 1;
@@ -106,6 +257,28 @@ static void *playback_child(void *arg)
 	return NULL;
 }
 
+/* resize recording file and its mapping */
+static int wave_grow_map(wave_rec_t *rec, size_t size)
+{
+	if (rec->map) {
+		munmap(rec->map, rec->map_size);
+		rec->map = NULL;
+	}
+	if (ftruncate(fileno(rec->fp), size) < 0) {
+		LOGP(DWAVE, LOGL_ERROR, "Failed to grow recording WAVE file! (errno %d)\n", errno);
+		return -errno;
+	}
+	rec->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(rec->fp), 0);
+	if (rec->map == MAP_FAILED) {
+		rec->map = NULL;
+		LOGP(DWAVE, LOGL_ERROR, "Failed to map recording WAVE file! (errno %d)\n", errno);
+		return -errno;
+	}
+	rec->map_size = size;
+
+	return 0;
+}
+
 struct fmt {
 	uint16_t	format; /* 1 = pcm, 2 = adpcm */
 	uint16_t	channels; /* number of channels */
@@ -115,32 +288,138 @@ struct fmt {
 	uint16_t	bits_sample; /* bits per sample (one channel) */
 };
 
-int wave_create_record(wave_rec_t *rec, const char *filename, int samplerate, int channels, double max_deviation)
+/* RIFFxxxxWAVE, JUNKxxxx(ds64 size), fmt xxxx(fmt size), dataxxxx ...
+ * The JUNK chunk reserves space for the ds64 chunk, if the file becomes an
+ * RF64 file, larger than 4 GB. */
+#define DS64_SIZE	28
+#define HEADER_SIZE	(4 + 4 + 4 + 4 + 4 + DS64_SIZE + 4 + 4 + sizeof(struct fmt) + 4 + 4)
+
+/* the sample position of captures and annotations is the number of frames written */
+static int wave_meta_init(wave_rec_t *rec, const char *filename)
+{
+	char datatype[16];
+	int rc;
+
+	if (rec->iqz) {
+		LOGP(DWAVE, LOGL_NOTICE, "SigMF metadata is not available for compressed files.\n");
+		return 0;
+	}
+
+	snprintf(datatype, sizeof(datatype), "%c%s_le", (rec->channels == 2) ? 'c' : 'r', (rec->bytes == 4) ? "f32" : "i16");
+	rec->meta = calloc(1, sizeof(*rec->meta));
+	if (!rec->meta) {
+		LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+		return -ENOMEM;
+	}
+	rc = sigmf_init(rec->meta, filename, datatype, rec->samplerate, rec->data_offset);
+	if (rc < 0) {
+		free(rec->meta);
+		rec->meta = NULL;
+	}
+
+	return rc;
+}
+
+static void wave_meta_exit(wave_rec_t *rec, int write)
+{
+	if (!rec->meta)
+		return;
+	if (write)
+		sigmf_write(rec->meta);
+	sigmf_exit(rec->meta);
+	free(rec->meta);
+	rec->meta = NULL;
+}
+
+void wave_meta_hw(wave_rec_t *rec, const char *hw)
+{
+	if (rec->meta)
+		sigmf_hw(rec->meta, hw);
+}
+
+/* start new capture segment at current position */
+int wave_meta_capture(wave_rec_t *rec, double frequency)
+{
+	if (!rec->meta)
+		return 0;
+	return sigmf_capture(rec->meta, rec->written, frequency);
+}
+
+/* annotate samples, starting at given offset (negative = in the past) from current position */
+int wave_meta_annotate(wave_rec_t *rec, int64_t offset, uint64_t count, double freq_lower, double freq_upper, const char *label, const char *comment)
+{
+	int64_t start;
+
+	if (!rec->meta)
+		return 0;
+	start = (int64_t)rec->written + offset;
+	if (start < 0) {
+		count = (count > (uint64_t)-start) ? count + start : 0;
+		start = 0;
+	}
+	return sigmf_annotate(rec->meta, start, count, freq_lower, freq_upper, label, comment);
+}
+
+int wave_create_record(wave_rec_t *rec, const char *filename, int samplerate, int channels, double max_deviation, int flags)
 {
-	/* RIFFxxxxWAVEfmt xxxx(fmt size)dataxxxx... */
-	char dummyheader[4 + 4 + 4 + 4 + 4 + sizeof(struct fmt) + 4 + 4];
+	char dummyheader[HEADER_SIZE];
 	int __attribute__((__unused__)) len;
 	int rc;
 
+	/* the encoder runs on the file io thread */
+	if ((flags & WAVE_FORMAT_MASK) == WAVE_FORMAT_IQZ)
+		flags &= ~WAVE_FLAG_MMAP;
+
 	memset(rec, 0, sizeof(*rec));
 	rec->samplerate = samplerate;
 	rec->channels = channels;
+	rec->bytes = format_bytes(flags);
 	rec->max_deviation = max_deviation;
+	rec->flags = flags;
 
-	rec->fp = fopen(filename, "w");
+	/* the mapping requires read access to the file */
+	rec->fp = fopen(filename, (flags & WAVE_FLAG_MMAP) ? "w+" : "w");
 	if (!rec->fp) {
 		LOGP(DWAVE, LOGL_ERROR, "Failed to open recording file '%s'! (errno %d)\n", filename, errno);
 		return -errno;
 	}
 
-	memset(&dummyheader, 0, sizeof(dummyheader));
-	len = fwrite(dummyheader, 1, sizeof(dummyheader), rec->fp);
+	if ((flags & WAVE_FORMAT_MASK) == WAVE_FORMAT_IQZ) {
+		rec->iqz = calloc(1, sizeof(*rec->iqz));
+		if (!rec->iqz) {
+			LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+			rc = -ENOMEM;
+			goto error;
+		}
+		rc = iqz_enc_init(rec->iqz, rec->fp, samplerate, channels);
+		if (rc < 0) {
+			LOGP(DWAVE, LOGL_ERROR, "Failed to start compressed recording! (rc %d)\n", rc);
+			goto error;
+		}
+	} else if (!is_raw(flags)) {
+		memset(&dummyheader, 0, sizeof(dummyheader));
+		len = fwrite(dummyheader, 1, sizeof(dummyheader), rec->fp);
+		rec->data_offset = sizeof(dummyheader);
+	}
+
+	if ((flags & WAVE_FLAG_SIGMF)) {
+		rc = wave_meta_init(rec, filename);
+		if (rc < 0)
+			goto error;
+	}
 
-	rec->buffer_size = samplerate * 2 * channels;
-	rec->buffer = calloc(rec->buffer_size, 1);
-	if (!rec->buffer) {
+	if ((flags & WAVE_FLAG_MMAP)) {
+		fflush(rec->fp);
+		rc = wave_grow_map(rec, rec->data_offset + WAVE_MMAP_CHUNK);
+		if (rc < 0)
+			goto error;
+		LOGP(DWAVE, LOGL_NOTICE, "*** Writing WAVE file to %s. (memory mapped)\n", filename);
+		return 0;
+	}
+
+	rc = ringbuffer_init(&rec->ring, samplerate, rec->bytes * channels);
+	if (rc < 0) {
 		LOGP(DWAVE, LOGL_NOTICE, "No mem!\n");
-		rc = ENOMEM;
 		goto error;
 	}
 
@@ -150,14 +429,18 @@ int wave_create_record(wave_rec_t *rec, const char *filename, int samplerate, in
 		goto error;
 	}
 
+	memacct_add(MEMACCT_WAVE, NULL, (ssize_t)rec->ring.size * rec->ring.element_size);
 	LOGP(DWAVE, LOGL_NOTICE, "*** Writing WAVE file to %s.\n", filename);
 
 	return 0;
 
 error:
-	if (rec->buffer) {
-		free(rec->buffer);
-		rec->buffer = NULL;
+	ringbuffer_exit(&rec->ring);
+	wave_meta_exit(rec, 0);
+	if (rec->iqz) {
+		iqz_enc_exit(rec->iqz);
+		free(rec->iqz);
+		rec->iqz = NULL;
 	}
 	if (rec->fp) {
 		fclose(rec->fp);
@@ -166,17 +449,55 @@ error:
 	return rc;
 }
 
-int wave_create_playback(wave_play_t *play, const char *filename, int *samplerate_p, int *channels_p, double max_deviation)
+static void put32(uint8_t *b, uint32_t v)
+{
+	b[0] = v;
+	b[1] = v >> 8;
+	b[2] = v >> 16;
+	b[3] = v >> 24;
+}
+
+static void put64(uint8_t *b, uint64_t v)
+{
+	put32(b, v);
+	put32(b + 4, v >> 32);
+}
+
+static uint32_t get32(const uint8_t *b)
+{
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static uint64_t get64(const uint8_t *b)
+{
+	return get32(b) | ((uint64_t)get32(b + 4) << 32);
+}
+
+/* Set the part of a recording to play, in seconds from its beginning.
+ * A duration of 0 plays until the end.
+ */
+void wave_playback_window(double start, double duration)
+{
+	window_start = start;
+	window_duration = duration;
+}
+
+int wave_create_playback(wave_play_t *play, const char *filename, int *samplerate_p, int *channels_p, double max_deviation, int flags)
 {
 	uint8_t buffer[256];
 	struct fmt fmt;
-	int32_t size, chunk, len;
+	int64_t size, chunk;
+	uint64_t ds64_riff = 0, ds64_data = 0;
+	int len, rf64 = 0;
 	int gotfmt = 0, gotdata = 0;
+	long offset;
+	uint64_t skip = 0, limit;
 	int rc = -EINVAL;
 
 	memset(&fmt, 0, sizeof(fmt));
 	memset(play, 0, sizeof(*play));
 	play->max_deviation = max_deviation;
+	play->flags = flags;
 
 	play->fp = fopen(filename, "r");
 	if (!play->fp) {
@@ -184,18 +505,62 @@ int wave_create_playback(wave_play_t *play, const char *filename, int *samplerat
 		return -errno;
 	}
 
+	/* raw file: sample rate and channels must be given, everything is sample data */
+	if (is_raw(flags)) {
+		if (!*samplerate_p || !*channels_p) {
+			LOGP(DWAVE, LOGL_ERROR, "Raw %s file requires given sample rate and number of channels!\n", wave_format_name(flags));
+			rc = -EINVAL;
+			goto error;
+		}
+		play->bytes = format_bytes(flags);
+		fseek(play->fp, 0, SEEK_END);
+		chunk = ftell(play->fp);
+		fseek(play->fp, 0, SEEK_SET);
+		goto start;
+	}
+
 	len = fread(buffer, 1, 12, play->fp);
 	if (len != 12) {
 		LOGP(DWAVE, LOGL_ERROR, "Failed to read RIFF header!\n");
 		rc = -EIO;
 		goto error;
 	}
-	if (!!strncmp((char *)buffer, "RIFF", 4)) {
+	/* compressed file, the decoder runs on the file io thread */
+	if (!memcmp(buffer, IQZ_MAGIC, 4)) {
+		int samplerate, channels;
+
+		fseek(play->fp, 0, SEEK_SET);
+		play->iqz = calloc(1, sizeof(*play->iqz));
+		if (!play->iqz) {
+			LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
+			rc = -ENOMEM;
+			goto error;
+		}
+		rc = iqz_dec_init(play->iqz, play->fp, &samplerate, &channels);
+		if (rc < 0)
+			goto error;
+		if (*channels_p == 0)
+			*channels_p = channels;
+		if (*samplerate_p == 0)
+			*samplerate_p = samplerate;
+		if (channels != *channels_p || samplerate != *samplerate_p) {
+			LOGP(DWAVE, LOGL_ERROR, "Compressed file has %d channel(s) at %d Hz, but we expect %d channel(s) at %d Hz!\n", channels, samplerate, *channels_p, *samplerate_p);
+			rc = -EINVAL;
+			goto error;
+		}
+		play->bytes = 2;
+		play->flags = flags = (flags & ~WAVE_FLAG_MMAP);
+		chunk = play->iqz->frames * play->bytes * channels;
+		goto start;
+	}
+	if (!strncmp((char *)buffer, "RF64", 4) || !strncmp((char *)buffer, "BW64", 4))
+		rf64 = 1;
+	else if (!!strncmp((char *)buffer, "RIFF", 4)) {
 		LOGP(DWAVE, LOGL_ERROR, "Missing RIFF header, seems that this is no WAVE file!\n");
 		rc = -EINVAL;
 		goto error;
 	}
-	size = buffer[4] + (buffer[5] << 8) + (buffer[6] << 16) + (buffer[7] << 24);
+	size = get32(buffer + 4);
 	if (!!strncmp((char *)buffer + 8, "WAVE", 4)) {
 		LOGP(DWAVE, LOGL_ERROR, "Missing WAVE header, seems that this is no WAVE file!\n");
 		rc = -EINVAL;
@@ -214,13 +579,28 @@ int wave_create_playback(wave_play_t *play, const char *filename, int *samplerat
 			rc = -EIO;
 			goto error;
 		}
-		chunk = buffer[4] + (buffer[5] << 8) + (buffer[6] << 16) + (buffer[7] << 24);
+		chunk = get32(buffer + 4);
+		/* RF64 stores sizes of RIFF and data in ds64 chunk */
+		if (rf64 && !strncmp((char *)buffer, "data", 4) && chunk == 0xffffffff)
+			chunk = ds64_data;
 		size -= 8 + chunk;
 		if (size < 0) {
-			LOGP(DWAVE, LOGL_ERROR, "WAVE error: Chunk '%c%c%c%c' overflows file size!\n", buffer[4], buffer[5], buffer[6], buffer[7]);
+			LOGP(DWAVE, LOGL_ERROR, "WAVE error: Chunk '%c%c%c%c' overflows file size!\n", buffer[0], buffer[1], buffer[2], buffer[3]);
 			rc = -EIO;
 			goto error;
 		}
+		if (!strncmp((char *)buffer, "ds64", 4)) {
+			if (!rf64 || chunk < 24 || chunk > (int)sizeof(buffer)) {
+				LOGP(DWAVE, LOGL_ERROR, "WAVE error: Unexpected or corrupt 'ds64' chunk!\n");
+				rc = -EINVAL;
+				goto error;
+			}
+			len = fread(buffer, 1, chunk, play->fp);
+			ds64_riff = get64(buffer);
+			ds64_data = get64(buffer + 8);
+			/* now we know the real size, minus 'WAVE' and this chunk */
+			size = ds64_riff - 4 - 8 - chunk;
+		} else
 		if (!strncmp((char *)buffer, "fmt ", 4)) {
 			if (chunk < 16 || chunk > (int)sizeof(buffer)) {
 				LOGP(DWAVE, LOGL_ERROR, "WAVE error: Short or corrupt 'fmt' chunk!\n");
@@ -230,8 +610,8 @@ int wave_create_playback(wave_play_t *play, const char *filename, int *samplerat
 			len = fread(buffer, 1, chunk, play->fp);
 			fmt.format = buffer[0] + (buffer[1] << 8);
 			fmt.channels = buffer[2] + (buffer[3] << 8);
-			fmt.sample_rate = buffer[4] + (buffer[5] << 8) + (buffer[6] << 16) + (buffer[7] << 24);
-			fmt.data_rate = buffer[8] + (buffer[9] << 8) + (buffer[10] << 16) + (buffer[11] << 24);
+			fmt.sample_rate = get32(buffer + 4);
+			fmt.data_rate = get32(buffer + 8);
 			fmt.bytes_sample = buffer[12] + (buffer[13] << 8);
 			fmt.bits_sample = buffer[14] + (buffer[15] << 8);
 			gotfmt = 1;
@@ -260,8 +640,12 @@ int wave_create_playback(wave_play_t *play, const char *filename, int *samplerat
 		goto error;
 	}
 
-	if (fmt.format != 1) {
-		LOGP(DWAVE, LOGL_ERROR, "WAVE error: We support only PCM files!\n");
+	if (fmt.format == 1 && fmt.bits_sample == 16)
+		play->bytes = 2;
+	else if (fmt.format == 3 && fmt.bits_sample == 32)
+		play->bytes = 4;
+	else {
+		LOGP(DWAVE, LOGL_ERROR, "WAVE error: We support only 16 bit PCM and 32 bit float files!\n");
 		rc = -EINVAL;
 		goto error;
 	}
@@ -279,30 +663,57 @@ int wave_create_playback(wave_play_t *play, const char *filename, int *samplerat
 		rc = -EINVAL;
 		goto error;
 	}
-	if ((int)fmt.data_rate != 2 * *channels_p * *samplerate_p) {
-		LOGP(DWAVE, LOGL_ERROR, "WAVE error: The WAVE file's data rate is only %d bytes per second, but we expect %d bytes per second (2 bytes per sample * channels * samplerate)!\n", fmt.data_rate, 2 * *channels_p * *samplerate_p);
-		rc = -EINVAL;
-		goto error;
-	}
-	if (fmt.bytes_sample != 2 * *channels_p) {
-		LOGP(DWAVE, LOGL_ERROR, "WAVE error: The WAVE file's bytes per sample is only %d, but we expect %d bytes sample (2 bytes per sample * channels)!\n", fmt.bytes_sample, 2 * *channels_p);
+	if ((int)fmt.data_rate != play->bytes * *channels_p * *samplerate_p) {
+		LOGP(DWAVE, LOGL_ERROR, "WAVE error: The WAVE file's data rate is only %d bytes per second, but we expect %d bytes per second (%d bytes per sample * channels * samplerate)!\n", fmt.data_rate, play->bytes * *channels_p * *samplerate_p, play->bytes);
 		rc = -EINVAL;
 		goto error;
 	}
-	if (fmt.bits_sample != 16) {
-		LOGP(DWAVE, LOGL_ERROR, "WAVE error: We support only 16 bit files!\n");
+	if (fmt.bytes_sample != play->bytes * *channels_p) {
+		LOGP(DWAVE, LOGL_ERROR, "WAVE error: The WAVE file's bytes per sample is only %d, but we expect %d bytes sample (%d bytes per sample * channels)!\n", fmt.bytes_sample, play->bytes * *channels_p, play->bytes);
 		rc = -EINVAL;
 		goto error;
 	}
 
+start:
 	play->channels = *channels_p;
-	play->left = chunk / 2 / *channels_p;
+	play->left = chunk / play->bytes / *channels_p;
+
+	if ((flags & WAVE_FLAG_WINDOW)) {
+		skip = (uint64_t)(window_start * (double)*samplerate_p);
+		if (skip > play->left)
+			skip = play->left;
+		if (skip && play->iqz) {
+			LOGP(DWAVE, LOGL_ERROR, "Cannot start playback within a compressed file!\n");
+			rc = -EINVAL;
+			goto error;
+		}
+		play->left -= skip;
+		limit = (uint64_t)(window_duration * (double)*samplerate_p);
+		if (limit && limit < play->left)
+			play->left = limit;
+		skip *= play->bytes * *channels_p;
+	}
+
+	if ((flags & WAVE_FLAG_MMAP)) {
+		offset = ftell(play->fp);
+		play->map_size = offset + chunk;
+		play->map = mmap(NULL, play->map_size, PROT_READ, MAP_PRIVATE, fileno(play->fp), 0);
+		if (play->map != MAP_FAILED) {
+			madvise(play->map, play->map_size, MADV_SEQUENTIAL);
+			play->data = play->map + offset + skip;
+			LOGP(DWAVE, LOGL_NOTICE, "*** Reading WAVE file from %s. (memory mapped)\n", filename);
+			return 0;
+		}
+		/* not a regular file, use thread */
+		play->map = NULL;
+		LOGP(DWAVE, LOGL_INFO, "Failed to map WAVE file, reading it by thread. (errno %d)\n", errno);
+	}
+	if (skip)
+		fseek(play->fp, skip, SEEK_CUR);
 
-	play->buffer_size = *samplerate_p * 2 * *channels_p;
-	play->buffer = calloc(play->buffer_size, 1);
-	if (!play->buffer) {
+	rc = ringbuffer_init(&play->ring, *samplerate_p, play->bytes * *channels_p);
+	if (rc < 0) {
 		LOGP(DWAVE, LOGL_ERROR, "No mem!\n");
-		rc = -ENOMEM;
 		goto error;
 	}
 
@@ -312,14 +723,17 @@ int wave_create_playback(wave_play_t *play, const char *filename, int *samplerat
 		goto error;
 	}
 
+	memacct_add(MEMACCT_WAVE, NULL, (ssize_t)play->ring.size * play->ring.element_size);
 	LOGP(DWAVE, LOGL_NOTICE, "*** Reading WAVE file from %s.\n", filename);
 
 	return 0;
 
 error:
-	if (play->buffer) {
-		free(play->buffer);
-		play->buffer = NULL;
+	ringbuffer_exit(&play->ring);
+	if (play->iqz) {
+		iqz_dec_exit(play->iqz);
+		free(play->iqz);
+		play->iqz = NULL;
 	}
 	if (play->fp) {
 		fclose(play->fp);
@@ -330,19 +744,29 @@ error:
 
 int wave_write(wave_rec_t *rec, sample_t **samples, int length)
 {
-	double max_deviation = rec->max_deviation;
-	int32_t value;
-	int __attribute__((__unused__)) len;
-	int i, c;
+	size_t frame = rec->bytes * rec->channels, need;
+	int i, span_len;
 	int to_write;
+	uint8_t *span;
 
 	/* on error, don't write more */
 	if (rec->finish)
 		return 0;
 
+	/* write directly into the mapping, grow the file if required */
+	if (rec->map) {
+		need = rec->data_offset + ((size_t)rec->written + length) * frame;
+		if (need > rec->map_size && wave_grow_map(rec, need + WAVE_MMAP_CHUNK) < 0) {
+			rec->finish = 1;
+			return 0;
+		}
+		samples_to_frames(rec->map + rec->data_offset + (size_t)rec->written * frame, samples, 0, length, rec->channels, rec->bytes, rec->max_deviation);
+		rec->written += length;
+		return length;
+	}
+
 	/* how much space is in buffer */
-	to_write = (rec->buffer_size + rec->buffer_readp - rec->buffer_writep - 1) % rec->buffer_size;
-	to_write /= 2 * rec->channels;
+	to_write = ringbuffer_space(&rec->ring);
 	if (to_write < length)
 		LOGP(DWAVE, LOGL_NOTICE, "Record WAVE buffer overflow.\n");
 	else
@@ -350,18 +774,13 @@ int wave_write(wave_rec_t *rec, sample_t **samples, int length)
 	if (to_write == 0)
 		return 0;
 
-	for (i = 0; i < to_write; i++) {
-		for (c = 0; c < rec->channels; c++) {
-			value = samples[c][i] / max_deviation * 32767.0;
-			if (value > 32767)
-				value = 32767;
-			else if (value < -32767)
-				value = -32767;
-			rec->buffer[rec->buffer_writep] = value;
-			rec->buffer_writep = (rec->buffer_writep + 1) % rec->buffer_size;
-			rec->buffer[rec->buffer_writep] = value >> 8;
-			rec->buffer_writep = (rec->buffer_writep + 1) % rec->buffer_size;
-		}
+	/* convert directly into the buffer, one contiguous span at a time */
+	for (i = 0; i < to_write; i += span_len) {
+		span_len = ringbuffer_write_span(&rec->ring, (void **)&span);
+		if (span_len > to_write - i)
+			span_len = to_write - i;
+		samples_to_frames(span, samples, i, span_len, rec->channels, rec->bytes, rec->max_deviation);
+		ringbuffer_write_commit(&rec->ring, span_len);
 	}
 	rec->written += to_write;
 
@@ -370,12 +789,10 @@ int wave_write(wave_rec_t *rec, sample_t **samples, int length)
 
 int wave_read(wave_play_t *play, sample_t **samples, int length)
 {
-	double max_deviation = play->max_deviation;
-	int16_t value; /* must be int16, so assembling bytes work */
-	int __attribute__((__unused__)) len;
-	int i, c;
+	int i, c, span_len;
 	int to_read;
 	int got = 0;
+	uint8_t *span;
 
 	/* we have finished */
 	if (play->left == 0) {
@@ -388,10 +805,27 @@ read_empty:
 		return got;
 	}
 
+	/* read directly from the mapping */
+	if (play->map) {
+		to_read = length;
+		if ((uint64_t)to_read > play->left)
+			to_read = play->left;
+		frames_to_samples(samples, 0, play->data, to_read, play->channels, play->bytes, play->max_deviation);
+		play->data += (size_t)to_read * play->bytes * play->channels;
+		got += to_read;
+		play->left -= to_read;
+		if (!play->left) {
+			LOGP(DWAVE, LOGL_NOTICE, "*** Finished reading WAVE file.\n");
+			__atomic_add_fetch(&wave_playbacks_finished, 1, __ATOMIC_RELAXED);
+		}
+		if (to_read < length)
+			goto read_empty;
+		return got;
+	}
+
 	/* how much do we read from buffer */
-	to_read = (play->buffer_size + play->buffer_writep - play->buffer_readp) % play->buffer_size;
-	to_read /= 2 * play->channels;
-	if (to_read > (int)play->left)
+	to_read = ringbuffer_fill(&play->ring);
+	if ((uint64_t)to_read > play->left)
 		to_read = play->left;
 	if (to_read > length)
 		to_read = length;
@@ -400,25 +834,26 @@ read_empty:
 		if (play->left) {
 			LOGP(DWAVE, LOGL_NOTICE, "*** Finished reading WAVE file. (short read)\n");
 			play->left = 0;
+			__atomic_add_fetch(&wave_playbacks_finished, 1, __ATOMIC_RELAXED);
 		}
 		goto read_empty;
 	}
 
-	/* read from buffer */
-	for (i = 0; i < to_read; i++) {
-		for (c = 0; c < play->channels; c++) {
-			value = play->buffer[play->buffer_readp];
-			play->buffer_readp = (play->buffer_readp + 1) % play->buffer_size;
-			value |= play->buffer[play->buffer_readp] << 8;
-			play->buffer_readp = (play->buffer_readp + 1) % play->buffer_size;
-			samples[c][i] = (double)value / 32767.0 * max_deviation;
-		}
+	/* read from buffer, one contiguous span at a time */
+	for (i = 0; i < to_read; i += span_len) {
+		span_len = ringbuffer_read_span(&play->ring, (void **)&span);
+		if (span_len > to_read - i)
+			span_len = to_read - i;
+		frames_to_samples(samples, i, span, span_len, play->channels, play->bytes, play->max_deviation);
+		ringbuffer_read_release(&play->ring, span_len);
 	}
 	got += to_read;
 	play->left -= to_read;
 
-	if (!play->left)
+	if (!play->left) {
 		LOGP(DWAVE, LOGL_NOTICE, "*** Finished reading WAVE file.\n");
+		__atomic_add_fetch(&wave_playbacks_finished, 1, __ATOMIC_RELAXED);
+	}
 
 	if (to_read < length)
 		goto read_empty;
@@ -429,23 +864,58 @@ read_empty:
 void wave_destroy_record(wave_rec_t *rec)
 {
 	uint8_t buffer[256];
-	uint32_t size, wsize;
+	uint64_t size, wsize;
 	struct fmt fmt;
+	int rf64;
 	int __attribute__((__unused__)) len;
 
 	if (!rec->fp)
 		return;
 
+	/* remove mapping and cut file after last sample */
+	if ((rec->flags & WAVE_FLAG_MMAP)) {
+		if (rec->map) {
+			munmap(rec->map, rec->map_size);
+			rec->map = NULL;
+		}
+		if (ftruncate(fileno(rec->fp), rec->data_offset + rec->written * rec->bytes * rec->channels) < 0)
+			rec->finish = 1;
+		fseek(rec->fp, 0, SEEK_END);
+	}
+
 	/* on error, thread has terminated */
 	if (rec->finish) {
+		wave_meta_exit(rec, 1);
+		if (rec->iqz) {
+			iqz_enc_exit(rec->iqz);
+			free(rec->iqz);
+			rec->iqz = NULL;
+		}
 		fclose(rec->fp);
 		rec->fp = NULL;
 		return;
 	}
 
 	/* finish thread */
-	rec->finish = 1;
-	pthread_join(rec->tid, NULL);
+	if (!(rec->flags & WAVE_FLAG_MMAP)) {
+		rec->finish = 1;
+		pthread_join(rec->tid, NULL);
+		memacct_add(MEMACCT_WAVE, NULL, -(ssize_t)rec->ring.size * rec->ring.element_size);
+	}
+
+	/* compressed file: code last block, write index and header */
+	if (rec->iqz) {
+		if (iqz_enc_finish(rec->iqz) < 0)
+			LOGP(DWAVE, LOGL_ERROR, "Failed to complete compressed recording! (errno %d)\n", errno);
+		iqz_enc_exit(rec->iqz);
+		free(rec->iqz);
+		rec->iqz = NULL;
+		goto done;
+	}
+
+	/* raw file has no header and trailer */
+	if (is_raw(rec->flags))
+		goto done;
 
 	/* cue */
 	fprintf(rec->fp, "cue %c%c%c%c%c%c%c%c", 4, 0, 0, 0, 0,0,0,0);
@@ -456,23 +926,37 @@ void wave_destroy_record(wave_rec_t *rec)
 	/* go to header */
 	fseek(rec->fp, 0, SEEK_SET);
 
-	size = 2 * rec->written * rec->channels;
-	wsize = 4 + 8 + sizeof(fmt) + 8 + size + 8 + 4 + 8 + 4;
+	size = (uint64_t)rec->bytes * rec->written * rec->channels;
+	wsize = 4 + 8 + DS64_SIZE + 8 + sizeof(fmt) + 8 + size + 8 + 4 + 8 + 4;
+	/* files above 4 GB become RF64, the JUNK chunk reserves the space for ds64 */
+	rf64 = (wsize > 0xffffffff);
 
 	/* RIFF */
-	fprintf(rec->fp, "RIFF%c%c%c%c", wsize & 0xff, (wsize >> 8) & 0xff, (wsize >> 16) & 0xff, wsize >> 24);
+	put32(buffer, (rf64) ? 0xffffffff : wsize);
+	fprintf(rec->fp, "%s", (rf64) ? "RF64" : "RIFF");
+	len = fwrite(buffer, 1, 4, rec->fp);
 
 	/* WAVE */
 	fprintf(rec->fp, "WAVE");
 
+	/* ds64 or JUNK */
+	memset(buffer, 0, DS64_SIZE);
+	if (rf64) {
+		put64(buffer, wsize);
+		put64(buffer + 8, size);
+		put64(buffer + 16, rec->written);
+	}
+	fprintf(rec->fp, "%s%c%c%c%c", (rf64) ? "ds64" : "JUNK", DS64_SIZE, 0, 0, 0);
+	len = fwrite(buffer, 1, DS64_SIZE, rec->fp);
+
 	/* fmt */
 	fprintf(rec->fp, "fmt %c%c%c%c", (uint8_t)sizeof(fmt), 0, 0, 0);
-	fmt.format = 1;
+	fmt.format = (rec->bytes == 4) ? 3 : 1;
 	fmt.channels = rec->channels;
 	fmt.sample_rate = rec->samplerate; /* samples/sec */
-	fmt.data_rate = rec->samplerate * 2 * rec->channels; /* full data rate */
-	fmt.bytes_sample = 2 * rec->channels; /* all channels */
-	fmt.bits_sample = 16; /* one channel */
+	fmt.data_rate = rec->samplerate * rec->bytes * rec->channels; /* full data rate */
+	fmt.bytes_sample = rec->bytes * rec->channels; /* all channels */
+	fmt.bits_sample = rec->bytes * 8; /* one channel */
 	buffer[0] = fmt.format;
 	buffer[1] = fmt.format >> 8;
 	buffer[2] = fmt.channels;
@@ -492,10 +976,13 @@ void wave_destroy_record(wave_rec_t *rec)
 	len = fwrite(buffer, 1, sizeof(fmt), rec->fp);
 
 	/* data */
-	fprintf(rec->fp, "data%c%c%c%c", size & 0xff, (size >> 8) & 0xff, (size >> 16) & 0xff, size >> 24);
+	put32(buffer, (rf64) ? 0xffffffff : size);
+	fprintf(rec->fp, "data");
+	len = fwrite(buffer, 1, 4, rec->fp);
 
-	free(rec->buffer);
-	rec->buffer = NULL;
+done:
+	wave_meta_exit(rec, 1);
+	ringbuffer_exit(&rec->ring);
 	fclose(rec->fp);
 	rec->fp = NULL;
 
@@ -507,12 +994,25 @@ void wave_destroy_playback(wave_play_t *play)
 	if (!play->fp)
 		return;
 
+	if (play->map) {
+		munmap(play->map, play->map_size);
+		play->map = NULL;
+		fclose(play->fp);
+		play->fp = NULL;
+		return;
+	}
+
 	/* finish thread if not already */
 	play->finish = 1;
 	pthread_join(play->tid, NULL);
 
-	free(play->buffer);
-	play->buffer = NULL;
+	if (play->iqz) {
+		iqz_dec_exit(play->iqz);
+		free(play->iqz);
+		play->iqz = NULL;
+	}
+	memacct_add(MEMACCT_WAVE, NULL, -(ssize_t)play->ring.size * play->ring.element_size);
+	ringbuffer_exit(&play->ring);
 	fclose(play->fp);
 	play->fp = NULL;
 }
@@ -1,37 +1,72 @@
+#include "../libsample/ringbuffer.h"
+
+#define WAVE_FLAG_MMAP		0x01	/* access file through memory mapping, no thread */
+#define WAVE_FLAG_SIGMF		0x02	/* write SigMF metadata file beside recording */
+#define WAVE_FLAG_WINDOW	0x04	/* play only the window given by wave_playback_window() */
+
+/* sample format, part of flags */
+#define WAVE_FORMAT_MASK	0x70
+#define WAVE_FORMAT_PCM16	0x00	/* WAVE file with 16 bit PCM */
+#define WAVE_FORMAT_FLOAT	0x10	/* WAVE file with 32 bit IEEE float */
+#define WAVE_FORMAT_CS16	0x20	/* raw interleaved 16 bit integer, no header */
+#define WAVE_FORMAT_CF32	0x30	/* raw interleaved 32 bit float, no header */
+#define WAVE_FORMAT_IQZ		0x40	/* lossless compressed 16 bit (see iqz.h), no mmap */
+
+#define WAVE_MMAP_CHUNK		(16 << 20) /* grow mapping of recording in these steps */
 
 typedef struct wave_rec {
 	FILE		*fp;
+	int		flags;
 	int		channels;
+	int		bytes;		/* bytes per sample of one channel */
 	double		max_deviation;
 	int		samplerate;
-	uint32_t	written;	/* how much samples written */
+	uint64_t	written;	/* how much samples written */
 	/* thread stuff */
 	pthread_t	tid;		/* file io thread id */
 	int		finish;		/* indicates end of thread */
-	uint8_t		*buffer;	/* buffer to store sample data */
-	int		buffer_size;	/* size of buffer in bytes */
-	int		buffer_readp;	/* read pointer to next byte in buffer */
-	int		buffer_writep;	/* write pointer to next byte in buffer */
+	ringbuffer_t	ring;		/* buffer to store sample data */
+	/* mmap stuff */
+	uint8_t		*map;		/* mapping of file */
+	size_t		map_size;	/* size of mapping (and file) */
+	size_t		data_offset;	/* offset of sample data in file */
+	/* compression */
+	struct iqz_enc	*iqz;		/* encoder, runs on file io thread */
+	/* metadata */
+	struct sigmf	*meta;		/* SigMF captures and annotations */
 } wave_rec_t;
 
 typedef struct wave_play {
 	FILE		*fp;
+	int		flags;
 	int		channels;
+	int		bytes;		/* bytes per sample of one channel */
 	double		max_deviation;
-	uint32_t	left;		/* how much samples left */
+	uint64_t	left;		/* how much samples left */
 	/* thread stuff */
 	pthread_t	tid;		/* file io thread id */
 	int		finish;		/* indicates end of thread */
-	uint8_t		*buffer;	/* buffer to store sample data */
-	int		buffer_size;	/* size of buffer in bytes */
-	int		buffer_readp;	/* read pointer to next byte in buffer */
-	int		buffer_writep;	/* write pointer to next byte in buffer */
+	ringbuffer_t	ring;		/* buffer to store sample data */
+	/* mmap stuff */
+	uint8_t		*map;		/* mapping of file */
+	size_t		map_size;	/* size of mapping */
+	uint8_t		*data;		/* next sample data to read */
+	/* compression */
+	struct iqz_dec	*iqz;		/* decoder, runs on file io thread */
 } wave_play_t;
 
-int wave_create_record(wave_rec_t *rec, const char *filename, int samplerate, int channels, double max_deviation);
-int wave_create_playback(wave_play_t *play, const char *filename, int *samplerate_p, int *channels_p, double max_deviation);
+extern int wave_playbacks_finished;
+
+int wave_format_parse(const char *name);
+const char *wave_format_name(int flags);
+int wave_create_record(wave_rec_t *rec, const char *filename, int samplerate, int channels, double max_deviation, int flags);
+void wave_playback_window(double start, double duration);
+int wave_create_playback(wave_play_t *play, const char *filename, int *samplerate_p, int *channels_p, double max_deviation, int flags);
 int wave_read(wave_play_t *play, sample_t **samples, int length);
 int wave_write(wave_rec_t *rec, sample_t **samples, int length);
+void wave_meta_hw(wave_rec_t *rec, const char *hw);
+int wave_meta_capture(wave_rec_t *rec, double frequency);
+int wave_meta_annotate(wave_rec_t *rec, int64_t offset, uint64_t count, double freq_lower, double freq_upper, const char *label, const char *comment);
 void wave_destroy_record(wave_rec_t *rec);
 void wave_destroy_playback(wave_play_t *play);
 
@@ -252,7 +252,7 @@ inval_number:
 		wave_rec_t wave_rec;
 
 		/* open wave file */
-		rc = wave_create_record(&wave_rec, wave_file, dsp_samplerate, 1, 1.0);
+		rc = wave_create_record(&wave_rec, wave_file, dsp_samplerate, 1, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DRADIO, LOGL_ERROR, "Failed to create WAVE record instance!\n");
 			goto error;
@@ -284,7 +284,7 @@ int main(int argc, char *argv[])
 
 	/* open wave */
 	if (write_tx_wave) {
-		rc = wave_create_record(&wave_tx_rec, write_tx_wave, dsp_samplerate, 1, 1.0);
+		rc = wave_create_record(&wave_tx_rec, write_tx_wave, dsp_samplerate, 1, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DDSP, LOGL_ERROR, "Failed to create WAVE recoding instance!\n");
 			goto exit;
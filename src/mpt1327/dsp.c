@@ -55,6 +55,10 @@ void dsp_init(void)
 
 static int fsk_send_bit(void *inst);
 static void fsk_receive_bit(void *inst, int bit, double quality, double level);
+static void fsk_receive_bits(void *inst, const fsk_soft_bit_t *bits, int count);
+
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
 
 /* Init FSK of transceiver */
 int dsp_init_sender(mpt1327_t *mpt1327, double squelch_db)
@@ -63,6 +67,10 @@ int dsp_init_sender(mpt1327_t *mpt1327, double squelch_db)
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for Transceiver.\n");
 
+	/* protocol of this channel */
+	mpt1327->sender.send = send_audio;
+	mpt1327->sender.receive = receive_audio;
+
 	/* init squelch */
 	squelch_init(&mpt1327->squelch, mpt1327->sender.kanal, squelch_db, MUTE_TIME, MUTE_TIME);
 
@@ -80,6 +88,7 @@ int dsp_init_sender(mpt1327_t *mpt1327, double squelch_db)
 		LOGP_CHAN(DDSP, LOGL_ERROR, "FSK init failed!\n");
 		return -EINVAL;
 	}
+	fsk_demod_set_receive_bits(&mpt1327->fsk_demod, fsk_receive_bits);
 
 	mpt1327->dmp_frame_level = display_measurements_add(&mpt1327->sender.dispmeas, "Frame Level", "%.1f %% (last)", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 150.0, 100.0);
 	mpt1327->dmp_frame_quality = display_measurements_add(&mpt1327->sender.dispmeas, "Frame Quality", "%.1f %% (last)", DISPLAY_MEAS_LAST, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
@@ -90,6 +99,8 @@ int dsp_init_sender(mpt1327_t *mpt1327, double squelch_db)
 		LOGP(DDSP, LOGL_ERROR, "Failed to create and init repeater buffer!\n");
 		goto error;
 	}
+	sender_account_dsp(&mpt1327->sender, sizeof(*mpt1327) - sizeof(mpt1327->sender));
+
 	return 0;
 
 error:
@@ -188,8 +199,17 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 	mpt1327_receive_codeword(mpt1327, mpt1327->rx_bits, quality, level);
 }
 
+/* receive bits of one chunk */
+static void fsk_receive_bits(void *inst, const fsk_soft_bit_t *bits, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		fsk_receive_bit(inst, bits[i].bit, bits[i].quality, bits[i].level);
+}
+
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	mpt1327_t *mpt1327 = (mpt1327_t *) sender;
 	sample_t *spl;
@@ -197,6 +217,7 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 	int i;
 	int was_mute = mpt1327->rx_mute; /* remember, so always mute whole chunk */
 	int was_pressel_on = mpt1327->pressel_on;
+	enum squelch_result sq = SQUELCH_OPEN;
 
 	/* if channel is off, do nothing */
 	if (mpt1327->dsp_mode == DSP_MODE_OFF) {
@@ -206,15 +227,22 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 		return;
 	}
 
-	/* fsk signal */
-	fsk_demod_receive(&mpt1327->fsk_demod, samples, length);
+	/* use squelch as carrier detector on traffic channel */
+	if (mpt1327->dsp_mode == DSP_MODE_TRAFFIC && !isinf(mpt1327->squelch.threshold_db))
+		sq = squelch(&mpt1327->squelch, rf_level_db, (double)length / (double)mpt1327->sender.samplerate);
+
+	/* fsk signal, skipped on traffic channel without carrier, unless a codeword is received */
+	if (sq == SQUELCH_OPEN || mpt1327->rx_in_sync)
+		fsk_demod_receive(&mpt1327->fsk_demod, samples, length);
+	else
+		mpt1327_reset_sync(mpt1327);
 
 	/* on traffic channel mute and indicate signal strength */
 	if (mpt1327->dsp_mode == DSP_MODE_TRAFFIC) {
 		/* process signal mute/loss, also for signalling tone */
 		if (!isinf(mpt1327->squelch.threshold_db)) {
 			/* use squelch to unmute and reset call timer */
-			switch (squelch(&mpt1327->squelch, rf_level_db, (double)length / (double)mpt1327->sender.samplerate)) {
+			switch (sq) {
 			case SQUELCH_LOSS:
 			case SQUELCH_MUTE:
 				memset(samples, 0, sizeof(*samples) * length);
@@ -236,7 +264,7 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 		/* if repeater mode, store sample in jitter buffer */
 		if (mpt1327->repeater)  {
 			jitter_frame_t *jf;
-			jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)samples, length * sizeof(*samples), 0, mpt1327->repeater_sequence, mpt1327->repeater_timestamp, 123);
+			jf = jitter_frame_alloc(&mpt1327->repeater_dejitter, NULL, NULL, (uint8_t *)samples, length * sizeof(*samples), 0, mpt1327->repeater_sequence, mpt1327->repeater_timestamp, 123);
 			if (jf)
 				jitter_save(&mpt1327->repeater_dejitter, jf);
 			mpt1327->repeater_sequence += 1;
@@ -281,10 +309,9 @@ static int fsk_send_bit(void *inst)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	mpt1327_t *mpt1327 = (mpt1327_t *) sender;
-	int input_num;
 
 	if (mpt1327->dsp_mode == DSP_MODE_OFF) {
 		memset(power, 0, length);
@@ -295,13 +322,7 @@ void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length
 	memset(power, 1, length);
 
 	if (mpt1327->dsp_mode == DSP_MODE_TRAFFIC) {
-		input_num = samplerate_upsample_input_num(&sender->srstate, length);
-		{
-			int16_t spl[input_num];
-			jitter_load_samples(&sender->dejitter, (uint8_t *)spl, input_num, sizeof(*spl), jitter_conceal_s16, NULL);
-			int16_to_samples_speech(samples, spl, input_num);
-		}
-		samplerate_upsample(&sender->srstate, samples, input_num, samples, length);
+		sender_load_speech(&sender->dejitter, &sender->srstate, samples, length);
 		/* if repeater mode, sum samples from jitter buffer to samples */
 		if (mpt1327->repeater) {
 			sample_t uplink[length];
@@ -374,7 +395,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (unit->tc->state == STATE_BUSY && unit->tc->dsp_mode == DSP_MODE_TRAFFIC) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&unit->tc->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&unit->tc->sender.dejitter, jf);
 	}
@@ -43,7 +43,7 @@ int num_freq = 0;
 static int num_chan_type = 0;
 static double squelch_db = -INFINITY;
 static enum mpt1327_band band = BAND_REGIONET43_SUB1;
-static enum mpt1327_chan_type chan_type[MAX_SENDER] = { CHAN_TYPE_CC_TC };
+static enum mpt1327_chan_type *chan_type = NULL;
 static int16_t sys = -1;
 static int wt = 10;
 static int per = 5;
@@ -59,7 +59,7 @@ void print_help(const char *arg0)
 	printf(" -B --band <name> | list\n");
 	printf("        Select frequency Band (default = '%s')\n", mpt1327_band_name(band));
 	printf(" -T --channel-type <channel type> | list\n");
-	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(chan_type[0]));
+	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(CHAN_TYPE_CC_TC));
 	printf(" -O --operator <OPID> <NDD> <LAB>\n");
 	printf("         -> decimal, '0x' for hex or all binary digits\n");
 	printf("        Give System Identity Code of regional network (1st bit = 0)\n");
@@ -292,26 +292,25 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 		/* set channel types for more than 1 channel */
 		if (num_kanal > 1 && num_chan_type == 0) {
-			chan_type[0] = CHAN_TYPE_CC;
+			OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC)
 			for (i = 1; i < num_kanal; i++)
-				chan_type[i] = CHAN_TYPE_TC;
-			num_chan_type = num_kanal;
+				OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_TC)
 		}
 
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
 	}
 	if (num_kanal == 1 && num_chan_type == 0)
-		num_chan_type = 1; /* use default */
+		OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC_TC) /* use default */
 	if (num_kanal != num_chan_type) {
 		fprintf(stderr, "You need to specify as many channel types as you have channels.\n");
 		exit(0);
@@ -256,6 +256,26 @@ static void _CHECK_MAX_BITS(int bits, const char *name)
 	}
 }
 
+/* check bit table for one byte of data, inverted check bit not applied */
+static uint16_t check_table[256];
+
+static void init_check(void)
+{
+	uint16_t check;
+	int i, b;
+
+	for (i = 0; i < 256; i++) {
+		check = i << 8;
+		for (b = 0; b < 8; b++) {
+			if ((check & 0x8000))
+				check = (check << 1) ^ 0xd02a;
+			else
+				check <<= 1;
+		}
+		check_table[i] = check;
+	}
+}
+
 void init_codeword(void)
 {
 	uint64_t bits, mask;
@@ -373,30 +393,38 @@ void init_codeword(void)
 			abort();
 		}
 	}
+
+	init_check();
+}
+
+/* calculate parity of all bits */
+static inline uint16_t parity64(uint64_t bits)
+{
+	bits ^= bits >> 32;
+	bits ^= bits >> 16;
+	bits ^= bits >> 8;
+	bits ^= bits >> 4;
+	bits ^= bits >> 2;
+	bits ^= bits >> 1;
+	return bits & 1;
 }
 
-/* calculate check bits, ispired by olle@toolcrypt.org (snable) */
+/* calculate check bits, ispired by olle@toolcrypt.org (snable)
+ * the generator polynomial 0x6815 is processed one byte at a time */
 uint16_t mpt1327_checkbits(uint64_t bits, uint16_t *parityp)
 {
-	uint16_t check = 0x0000, parity = 0;
-	int bit;
+	uint16_t check = 0x0000, parity;
 	int b;
 
 	/* calculate check at upper 15 bits */
-	for (b = 0; b < 48; b++) {
-		bit = (bits >> (63 - b)) & 1;
-		parity ^= bit;
-		if (bit != (check >> 15))
-			check ^= 0x6815;
-		check <<= 1;
-	}
+	for (b = 56; b >= 16; b -= 8)
+		check = (check << 8) ^ check_table[((check >> 8) ^ (bits >> b)) & 0xff];
 
 	/* invert lowest check bit (of 15 upper bits) */
 	check ^= 0x0002;
 
-	/* finish parity and append as lest bit (bit 0) */
-	for (b = 1; b < 16; b++)
-		parity ^= (check >> b) & 1;
+	/* parity over data and check bits, append as lest bit (bit 0) */
+	parity = parity64((bits >> 16) ^ (check >> 1));
 	check ^= parity;
 
 	if (parityp)
@@ -506,24 +506,20 @@ const char *chan_type_long_name(enum mpt1327_chan_type chan_type)
  * MPT processing
  */
 
+/* idle traffic channels, combined CC/TC are the second alternative */
+static chan_list_t tc_list, cc_tc_list;
+
 static mpt1327_t *search_free_tc(void)
 {
 	sender_t *sender;
-	mpt1327_t *tc, *cc_tc = NULL;
-
-	for (sender = sender_head; sender; sender = sender->next) {
-		tc = (mpt1327_t *) sender;
-		if (tc->state != STATE_IDLE)
-			continue;
-		/* remember combined voice/control/paging channel as second alternative */
-		if (tc->chan_type == CHAN_TYPE_CC_TC)
-			cc_tc = tc;
-		if (tc->chan_type == CHAN_TYPE_TC)
-			return tc;
-	}
 
-	return cc_tc;
+	if ((sender = chan_alloc(&tc_list)))
+		return (mpt1327_t *) sender;
+	/* combined voice/control/paging channel is the second alternative */
+	if ((sender = chan_alloc(&cc_tc_list)))
+		return (mpt1327_t *) sender;
 
+	return NULL;
 }
 
 static mpt1327_t *search_cc(void)
@@ -598,6 +594,7 @@ static void mpt1327_new_state(mpt1327_t *mpt1327, enum mpt1327_state new_state,
 	}
 
 	mpt1327->state = new_state;
+	chan_alloc_set_idle(&mpt1327->sender, new_state == STATE_IDLE);
 	mpt1327_display_status();
 }
 
@@ -649,6 +646,14 @@ int mpt1327_create(enum mpt1327_band band, const char *kanal, enum mpt1327_chan_
 
 	mpt1327->band = band;
 	mpt1327->chan_type = chan_type;
+	/* traffic channels are allocated from lists */
+	if (chan_type == CHAN_TYPE_TC || chan_type == CHAN_TYPE_CC_TC) {
+		rc = chan_list_add((chan_type == CHAN_TYPE_CC_TC) ? &cc_tc_list : &tc_list, &mpt1327->sender, mpt1327->state == STATE_IDLE);
+		if (rc < 0)
+			goto error;
+	}
+	/* control channels must be demodulated, even if no signal is received */
+	mpt1327->sender.rx_always_on = (chan_type != CHAN_TYPE_TC);
 
 	/* only accept these valued */
 	if (sysdef.framelength != 1 && sysdef.framelength != 3 && sysdef.framelength != 6) {
@@ -718,6 +723,7 @@ void mpt1327_destroy(sender_t *sender)
 
 	dsp_cleanup_sender(mpt1327);
 	osmo_timer_del(&mpt1327->timer);
+	chan_list_remove(&mpt1327->sender);
 	sender_destroy(&mpt1327->sender);
 	free(sender);
 }
@@ -1505,6 +1511,7 @@ void mpt1327_receive_codeword(mpt1327_t *mpt1327, uint64_t bits, double quality,
 	LOGP_CHAN(DDSP, LOGL_INFO, "RX Level: %.0f%% Quality=%.0f%%\n", level * 100.0, quality * 100.0);
 
 	rc = mpt1327_decode_codeword(&codeword, (mpt1327->rx_sched.data_num) ? mpt1327->rx_sched.data_word : -1, (mpt1327->sender.loopback) ? MPT_DOWN : MPT_UP, bits);
+	sender_rx_frame(&mpt1327->sender, (rc < 0) ? -1 : 0);
 	if (rc < 0) {
 		mpt1327->rx_sched.data_num = 0;
 		mpt1327_reset_sync(mpt1327); /* message complete */
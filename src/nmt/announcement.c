@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "announcement.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0007, 0x0008, 0x0008, 0x0009, 0x0006, 0x000b, 0x0004, 0x000a,
 	0x0008, 0x0006, 0x000a, 0x0005, 0x0007, 0x0009, 0x0006, 0x0009,
 	0x0006, 0x0008, 0x000a, 0x0005, 0x000b, 0x0004, 0x0009, 0x000a,
@@ -7147,7 +7147,7 @@ static int16_t pattern[] = {
 	0xff85, 0xff83, 0xff8e, 0xff82, 0xff82, 0xff8a, 0xff87, 0xff93,
 };
 
-extern int16_t *outoforder_spl;
+extern const int16_t *outoforder_spl;
 extern int outoforder_size;
 extern int outoforder_max;
 
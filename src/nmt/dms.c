@@ -37,27 +37,37 @@ int dms_allow_loopback = 0;
  * support
  */
 
-/* calculate CRC from the bits of label and data and 16 zeroes.
- * the result is the remainder of the polynomial division and
- * conforms to DMS standard.
+static uint16_t crc_table[256];
+
+static void crc16_init(void)
+{
+	uint16_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i << 8;
+		for (j = 0; j < 8; j++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		crc_table[i] = crc;
+	}
+}
+
+/* calculate CRC from the 7 bit characters of label and data.
+ * the result is the remainder of the polynomial division of the 63 bits
+ * followed by 16 zeroes and conforms to DMS standard.
+ * a leading zero bit does not change the remainder, so the 63 bits are
+ * packed into 8 bytes and the CRC is calculated byte by byte.
  */
-static uint16_t crc16(uint8_t *bits, int len)
+static uint16_t crc16(const uint8_t *data)
 {
-	uint16_t generator = 0x1021;
+	uint64_t bits = 0;
 	uint16_t crc = 0; /* init crc register with 0 */
 	int i;
 
-	for (i = 0; i < len; i++) {
-		/* check if MSB is set */
-		if ((crc & 0x8000)) {   /* MSB set, shift it out of the register */
-			/* shift in next bit of input stream */
-			crc = (crc << 1) | bits[i];
-			/* Perform the 'division' by XORing the crc register with the generator polynomial */
-			crc = crc ^ generator;
-		} else {   /* MSB not set, shift it out and shift in next bit of input stream. Same as above, just no division */
-			crc = (crc << 1) | bits[i];
-		}
-	}
+	for (i = 0; i < 9; i++)
+		bits = (bits << 7) | (data[i] & 0x7f);
+	for (i = 56; i >= 0; i -= 8)
+		crc = (crc << 8) ^ crc_table[((crc >> 8) ^ (bits >> i)) & 0xff];
 
 	return crc;
 }
@@ -105,51 +115,25 @@ static const char *print_ct_dt(uint8_t s, uint8_t n, uint8_t *data, int eight_bi
 	return text;
 }
 
-/* link DMS frame to list of TX frames */
-static void link_dms_frame(nmt_t *nmt, struct dms_frame *frame)
-{
-	dms_t *dms = &nmt->dms;
-	struct dms_frame **framep;
-
-	LOGP(DDMS, LOGL_DEBUG, "link DMS frame\n");
-
-	/* attach to end of list */
-	framep = &dms->state.frame_list;
-	while (*framep)
-		framep = &((*framep)->next);
-	*framep = frame;
-}
-
-/* unlink DMS frame from list of TX frames */
-static void unlink_dms_frame(nmt_t *nmt, struct dms_frame *frame)
+/* get queued TX frame, 0 is the oldest, NULL if there are less frames */
+static struct dms_frame *dms_frame_queued(dms_t *dms, unsigned int index)
 {
-	dms_t *dms = &nmt->dms;
-	struct dms_frame **framep;
-
-	LOGP(DDMS, LOGL_DEBUG, "unlink DMS frame\n");
-
-	/* unlink */
-	framep = &dms->state.frame_list;
-	while (*framep && *framep != frame)
-		framep = &((*framep)->next);
-	if (!(*framep)) {
-		LOGP(DTRANS, LOGL_ERROR, "Frame not in list, please fix!!\n");
-		abort();
-	}
-	*framep = frame->next;
+	if (index >= dms->state.frame_head - dms->state.frame_tail)
+		return NULL;
+	return &dms->state.frame_ring[(dms->state.frame_tail + index) & (DMS_FRAME_RING - 1)];
 }
 
-/* add DMS frame to list of TX frames */
+/* add DMS frame to ring of TX frames */
 static void dms_frame_add(nmt_t *nmt, int s, const uint8_t *data)
 {
 	dms_t *dms = &nmt->dms;
 	struct dms_frame *dms_frame;
 
-	dms_frame = calloc(1, sizeof(*dms_frame));
-	if (!dms_frame) {
-		LOGP(DDMS, LOGL_ERROR, "No memory!\n");
-			return;
+	if (dms->state.frame_head - dms->state.frame_tail == DMS_FRAME_RING) {
+		LOGP(DDMS, LOGL_ERROR, "Too many DMS frames queued, dropping!\n");
+		return;
 	}
+	dms_frame = &dms->state.frame_ring[dms->state.frame_head & (DMS_FRAME_RING - 1)];
 
 	dms_frame->s = s;
 	dms_frame->n = dms->state.n_count;
@@ -158,17 +142,18 @@ static void dms_frame_add(nmt_t *nmt, int s, const uint8_t *data)
 
 	LOGP(DDMS, LOGL_DEBUG, "add DMS %cT(%d) frame to queue\n", dms_frame->s + 'C', dms_frame->n);
 
-	link_dms_frame(nmt, dms_frame);
+	dms->state.frame_head++;
 }
 
-/* delete DMS frame from list of TX frames */
-static void dms_frame_delete(nmt_t *nmt, struct dms_frame *dms_frame)
+/* delete oldest DMS frame from ring of TX frames */
+static void dms_frame_delete(nmt_t *nmt)
 {
-	LOGP(DDMS, LOGL_DEBUG, "delete DMS frame %cT(%d) from queue\n", dms_frame->s + 'C', dms_frame->n);
+	dms_t *dms = &nmt->dms;
+	struct dms_frame *dms_frame = dms_frame_queued(dms, 0);
 
-	unlink_dms_frame(nmt, dms_frame);
+	LOGP(DDMS, LOGL_DEBUG, "delete DMS frame %cT(%d) from queue\n", dms_frame->s + 'C', dms_frame->n);
 
-	free(dms_frame);
+	dms->state.frame_tail++;
 }
 
 /* add DT frame */
@@ -226,6 +211,8 @@ int dms_init_sender(nmt_t __attribute__((unused)) *nmt)
 	/* we need some simple random */
 	srandom((unsigned int)(get_time() * 1000));
 
+	crc16_init();
+
 	return 0;
 }
 
@@ -245,7 +232,6 @@ static void dms_encode_dt(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n, uint8_t *
 	dms_t *dms = &nmt->dms;
 	char frame[127];
 	uint8_t data[12];
-	uint8_t bits[63 + 16];
 	uint16_t crc;
 	int i, j;
 
@@ -254,13 +240,7 @@ static void dms_encode_dt(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n, uint8_t *
 	/* generate label */
 	data[0] = (d << 6) | (s << 5) | (3 << 3) | n;
 	memcpy(data + 1, _data, 8);
-	for (i = 0; i < 9; i++) {
-		for (j = 0; j < 7; j++)
-			bits[i * 7 + j] = (data[i] >> (6 - j)) & 1;
-	}
-	for (i = 0; i < 16; i++)
-		bits[63 + i] = 0;
-	crc = crc16(bits, 63 + 16);
+	crc = crc16(data);
 	data[9] = crc >> 9;
 	data[10] = crc >> 2;
 	data[11] = crc & 0x3;
@@ -346,7 +326,7 @@ static void dms_encode_rr(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n)
 void trigger_frame_transmission(nmt_t *nmt)
 {
 	dms_t *dms = &nmt->dms;
-	struct dms_frame *dms_frame;
+	struct dms_frame *dms_frame, *next;
 	int i;
 
 	/* ongoing transmission, so we wait */
@@ -363,15 +343,17 @@ void trigger_frame_transmission(nmt_t *nmt)
 
 	/* get next frame to send */
 	/* loop 4 times, because only 4 unacked frames may be transmitted */
-	dms_frame = dms->state.frame_list;
+	dms_frame = dms_frame_queued(dms, 0);
 	for (i = 0; i < 4 && dms_frame; i++) {
+		next = dms_frame_queued(dms, i + 1);
 		/* stop before DT frame, if RAND was not acked */
-		if (dms_frame->next && dms_frame->next->s == 1 && !dms->state.established)
+		if (next && next->s == 1 && !dms->state.established)
 			break;
 		if (dms_frame->n == dms->state.n_s)
 			break;
-		dms_frame = dms_frame->next;
+		dms_frame = next;
 	}
+	next = dms_frame_queued(dms, i + 1);
 
 	/* check if outstanding frame */
 	if (!dms_frame) {
@@ -389,20 +371,20 @@ void trigger_frame_transmission(nmt_t *nmt)
 	 * if there is no next frame, set it to the first frame (cycle).
 	 * also if RAND was not acked, but next frame is DT, send first frame.
 	 */
-	if (!dms_frame->next) {
-		dms->state.n_s = dms->state.frame_list->n;
+	if (!next) {
+		dms->state.n_s = dms_frame_queued(dms, 0)->n;
 		LOGP(DDMS, LOGL_DEBUG, " -> Next sequence number is %d, because this was the last frame in queue.\n", dms->state.n_s);
-	} else if (!dms->state.established && dms_frame->next->s == 1) {
-		dms->state.n_s = dms->state.frame_list->n;
+	} else if (!dms->state.established && next->s == 1) {
+		dms->state.n_s = dms_frame_queued(dms, 0)->n;
 		LOGP(DDMS, LOGL_DEBUG, " -> Next sequence number is %d, because this was the last frame before DT queue, and RAND has not been acked yet.\n", dms->state.n_s);
 	} else if (i == 3) {
-		dms->state.n_s = dms->state.frame_list->n;
+		dms->state.n_s = dms_frame_queued(dms, 0)->n;
 		LOGP(DDMS, LOGL_DEBUG, " -> Next sequence number is %d, because we reached max number of unacknowledged frames.\n", dms->state.n_s);
-	} else if (!dms->state.established && dms_frame->next->s == 0) {
-		dms->state.n_s = dms_frame->next->n;
+	} else if (!dms->state.established && next->s == 0) {
+		dms->state.n_s = next->n;
 		LOGP(DDMS, LOGL_DEBUG, " -> Next sequence number is %d, because this is the next CT frame in queue.\n", dms->state.n_s);
 	} else {
-		dms->state.n_s = dms_frame->next->n;
+		dms->state.n_s = next->n;
 		LOGP(DDMS, LOGL_DEBUG, " -> Next sequence number is %d, because this is the next frame in queue.\n", dms->state.n_s);
 	}
 
@@ -519,7 +501,7 @@ static void dms_rx_dt(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n, uint8_t *data
 static void dms_rx_rr(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n)
 {
 	dms_t *dms = &nmt->dms;
-	struct dms_frame *dms_frame, *dms_frame_next;
+	struct dms_frame *dms_frame;
 	int i, j;
 
 	if (!dms->state.started)
@@ -533,11 +515,10 @@ static void dms_rx_rr(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n)
 
 	/* check to which entry in the list of frames this ack belongs to */
 	/* loop 4 times, because only 4 unacked frames may have been transmitted */
-	dms_frame = dms->state.frame_list;
-	for (i = 0; i < 4 && dms_frame; i++) {
-		if (dms_frame->n == ((n - 1) & 7))
+	for (i = 0; i < 4; i++) {
+		dms_frame = dms_frame_queued(dms, i);
+		if (!dms_frame || dms_frame->n == ((n - 1) & 7))
 			break;
-		dms_frame = dms_frame->next;
 	}
 
 	/* if we don't find a frame, it must have been already acked, so we ignore RR */
@@ -549,8 +530,8 @@ static void dms_rx_rr(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n)
 	LOGP(DDMS, LOGL_INFO, "Received valid DMS frame: RR(%d) (s = %d)\n", n, s);
 
 	/* flush all acked frames. */
-	dms_frame = dms->state.frame_list;
 	for (j = 0; j <= i; j++) {
+		dms_frame = dms_frame_queued(dms, 0);
 		if (dms_frame->data[0] == 82) { /* RAND */
 			LOGP(DDMS, LOGL_DEBUG, "RAND frame has been acknowledged, so we can continue to send DT frame\n");
 			dms->state.established = 1;
@@ -563,9 +544,7 @@ static void dms_rx_rr(nmt_t *nmt, uint8_t d, uint8_t s, uint8_t n)
 			LOGP(DDMS, LOGL_DEBUG, "Raising next frame to send to #%d\n", dms->state.n_s);
 		}
 		LOGP(DDMS, LOGL_DEBUG, "Removing acked frame #%d\n", dms_frame->n);
-		dms_frame_next = dms_frame->next;
-		dms_frame_delete(nmt, dms_frame);
-		dms_frame = dms_frame_next;
+		dms_frame_delete(nmt);
 	}
 
 	/* now trigger frame transmission */
@@ -689,18 +668,10 @@ void fsk_receive_bit_dms(nmt_t *nmt, int bit, double quality, double level)
 		}
 		if (dms->rx_bit_count == 2) {
 			uint16_t crc_got, crc_calc;
-			uint8_t bits[63 + 16];
-			int i, j;
 			dms->rx_bit_count = 0;
 			LOGP(DDMS, LOGL_DEBUG, "Got DMS CRC 0x%x\n", dms->rx_frame[dms->rx_frame_count]);
 			crc_got = (dms->rx_frame[9] << 9) | (dms->rx_frame[10] << 2) | dms->rx_frame[11];
-			for (i = 0; i < 9; i++) {
-				for (j = 0; j < 7; j++)
-					bits[i * 7 + j] = (dms->rx_frame[i] >> (6 - j)) & 1;
-			}
-			for (i = 0; i < 16; i++)
-				bits[63 + i] = 0;
-			crc_calc = crc16(bits, 63 + 16);
+			crc_calc = crc16(dms->rx_frame);
 			LOGP(DDMS, LOGL_DEBUG, "DMS CRC = 0x%04x %s\n", crc_got, (crc_calc == crc_got) ? "(OK)" : "(CRC error)");
 			if (crc_calc == crc_got)
 				dms_rx_dt(nmt, dms->rx_label.d, dms->rx_label.s, dms->rx_label.n, dms->rx_frame + 1);
@@ -844,8 +815,5 @@ void dms_reset(nmt_t *nmt)
 	memset(&dms->state, 0, sizeof(dms->state));
 
 	dms->tx_frame_valid = 0;
-
-	while (dms->state.frame_list)
-		dms_frame_delete(nmt, dms->state.frame_list);
 }
 
@@ -1,6 +1,7 @@
 
+#define DMS_FRAME_RING		256	/* frames that can be queued, power of two */
+
 struct dms_frame {
-	struct dms_frame	*next;
 	uint8_t			s;			/* CT/DT frame */
 	uint8_t			n;			/* sequence number */
 	uint8_t			data[8];		/* data */
@@ -14,10 +15,12 @@ struct dms_state {
 	uint8_t			n_r;			/* next expected frame to be received */
 	uint8_t			n_s;			/* next frame to be sent */
 	uint8_t			n_a;			/* next frame to be acked */
-	uint8_t			n_count;		/* counts frames that are stored in list */
+	uint8_t			n_count;		/* counts frames that are stored in ring */
 	uint8_t			dir;			/* direction */
 	int			eight_bits;		/* what mode are used for DT frames */
-	struct dms_frame	*frame_list;		/* list of frames to transmit */
+	struct dms_frame	frame_ring[DMS_FRAME_RING]; /* frames to transmit, oldest first */
+	unsigned int		frame_head;		/* where to add next frame */
+	unsigned int		frame_tail;		/* oldest frame, not yet acked */
 	int			send_rr;		/* RR must be sent next */
 };
 
@@ -101,20 +101,99 @@ void dsp_init(void)
 	compandor_init();
 }
 
-static int fsk_send_bit(void *inst);
-static void fsk_receive_bit(void *inst, int bit, double quality, double level);
+/* Idle frames repeat all the time, so their samples are cached.
+ * The samples only depend on the frame bits and the state of the FFSK
+ * waveform table at the start of the frame. Because the encoded frame is the
+ * key, a change of channel, area or clock in the idle frame is just a miss.
+ * Frames that are not sent anymore will be replaced.
+ */
+static void frame_cache_flush(nmt_t *nmt)
+{
+	int i;
 
-/* Init FSK of transceiver */
-int dsp_init_sender(nmt_t *nmt, double deviation_factor)
+	for (i = 0; i < FRAME_CACHE_NUM; i++) {
+		free(nmt->frame_cache[i].spl);
+		nmt->frame_cache[i].spl = NULL;
+		nmt->frame_cache[i].count = 0;
+	}
+}
+
+static struct frame_cache *frame_cache_lookup(nmt_t *nmt, const uint8_t *bits)
 {
-	sample_t *spl;
+	struct frame_cache *cache;
 	int i;
 
+	nmt->frame_cache_use++;
+	for (i = 0; i < FRAME_CACHE_NUM; i++) {
+		cache = &nmt->frame_cache[i];
+		if (cache->count
+		 && cache->table_bit == nmt->fsk_mod.tx_table_bit
+		 && cache->table_phase == nmt->fsk_mod.tx_table_phase
+		 && !memcmp(cache->bits, bits, sizeof(cache->bits))) {
+			cache->last_used = nmt->frame_cache_use;
+			return cache;
+		}
+	}
+
+	return NULL;
+}
+
+static struct frame_cache *frame_cache_store(nmt_t *nmt, const uint8_t *bits, int table_bit, int table_phase, const sample_t *spl, int count)
+{
+	struct frame_cache *cache = NULL;
+	sample_t *cache_spl;
+	int i;
+
+	/* use unused entry or replace least recently used entry */
+	for (i = 0; i < FRAME_CACHE_NUM; i++) {
+		if (!nmt->frame_cache[i].count) {
+			cache = &nmt->frame_cache[i];
+			break;
+		}
+		if (!cache || nmt->frame_cache_use - nmt->frame_cache[i].last_used > nmt->frame_cache_use - cache->last_used)
+			cache = &nmt->frame_cache[i];
+	}
+
+	cache_spl = realloc(cache->spl, sizeof(*spl) * count);
+	if (!cache_spl) {
+		LOGP_CHAN(DDSP, LOGL_ERROR, "No memory!\n");
+		cache->count = 0;
+		return NULL;
+	}
+	memcpy(cache_spl, spl, sizeof(*spl) * count);
+	memcpy(cache->bits, bits, sizeof(cache->bits));
+	cache->table_bit = table_bit;
+	cache->table_phase = table_phase;
+	cache->next_table_bit = nmt->fsk_mod.tx_table_bit;
+	cache->next_table_phase = nmt->fsk_mod.tx_table_phase;
+	cache->spl = cache_spl;
+	cache->count = count;
+	cache->last_used = nmt->frame_cache_use;
+
+	return cache;
+}
+
+static int fsk_send_bits(void *inst, uint32_t *bits);
+static void fsk_receive_bit(void *inst, int bit, double quality, double level);
+static void fsk_receive_bits(void *inst, const fsk_soft_bit_t *bits, int count);
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
+/* Init FSK of transceiver, super_hop is the interval of supervisory measurements in ms, 0 for window length */
+int dsp_init_sender(nmt_t *nmt, double deviation_factor, int super_hop)
+{
+	double freq[2];
+	int i, rc;
+
 	/* attack (3ms) and recovery time (13.5ms) according to NMT specs */
 	setup_compandor(&nmt->cstate, 8000, 3.0, 13.5);
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for Transceiver.\n");
 
+	/* protocol of this channel */
+	nmt->sender.send = send_audio;
+	nmt->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	sender_set_fm(&nmt->sender, MAX_DEVIATION * deviation_factor, MAX_MODULATION * deviation_factor, SPEECH_DEVIATION * deviation_factor, MAX_DISPLAY);
 
@@ -122,33 +201,51 @@ int dsp_init_sender(nmt_t *nmt, double deviation_factor)
 	LOGP(DDSP, LOGL_DEBUG, "Using Supervisory level of %.3f (%.3f KHz deviation @ 4015 Hz)\n", TX_PEAK_SUPER * deviation_factor, 0.3 * deviation_factor);
 
 	/* init fsk */
-	if (fsk_mod_init(&nmt->fsk_mod, nmt, fsk_send_bit, nmt->sender.samplerate, BIT_RATE, F0, F1, TX_PEAK_FSK, 1, 0) < 0) {
+	if (fsk_mod_init(&nmt->fsk_mod, nmt, NULL, nmt->sender.samplerate, BIT_RATE, F0, F1, TX_PEAK_FSK, 1, 0) < 0) {
 		LOGP_CHAN(DDSP, LOGL_ERROR, "FSK init failed!\n");
 		return -EINVAL;
 	}
+	fsk_mod_set_send_bits(&nmt->fsk_mod, fsk_send_bits);
+	/* frames are rendered at once, if FFSK waveform table is used */
+	if (nmt->fsk_mod.table_bits) {
+		nmt->tx_frame_buffer = calloc(NMT_FRAME_BITS * nmt->fsk_mod.table_size, sizeof(*nmt->tx_frame_buffer));
+		if (!nmt->tx_frame_buffer) {
+			LOGP_CHAN(DDSP, LOGL_ERROR, "No memory!\n");
+			return -ENOMEM;
+		}
+	}
 	if (fsk_demod_init(&nmt->fsk_demod, nmt, fsk_receive_bit, nmt->sender.samplerate, BIT_RATE, F0, F1, BIT_ADJUST) < 0) {
 		LOGP_CHAN(DDSP, LOGL_ERROR, "FSK init failed!\n");
 		return -EINVAL;
 	}
+	fsk_demod_set_receive_bits(&nmt->fsk_demod, fsk_receive_bits);
 
-	/* allocate ring buffer for SAT signal detection
-	 * the bandwidth of the Goertzel filter is the reciprocal of the duration
-	 * we half our bandwidth, so that other supervisory signals will be canceled out completely by goertzel filter
+	/* window for SAT signal detection
+	 * the bandwidth of the filter is the reciprocal of the duration
+	 * we half our bandwidth, so that other supervisory signals will be canceled out completely by the filter
 	 */
 	nmt->super_samples = (int)((double)nmt->sender.samplerate * (1.0 / (SUPER_BANDWIDTH / 2)) + 0.5);
-	spl = calloc(1, nmt->super_samples * sizeof(*spl));
-	if (!spl) {
-		LOGP(DDSP, LOGL_ERROR, "No memory!\n");
-		return -ENOMEM;
+	nmt->super_hop = (super_hop) ? nmt->sender.samplerate * super_hop / 1000 : nmt->super_samples;
+	if (nmt->super_hop < 1 || nmt->super_hop > nmt->super_samples) {
+		LOGP_CHAN(DDSP, LOGL_ERROR, "Supervisory hop of %d ms is out of range, it must not exceed the window of %d ms!\n", super_hop, nmt->super_samples * 1000 / nmt->sender.samplerate);
+		return -EINVAL;
 	}
-	nmt->super_filter_spl = spl;
+	/* print every SUPER_PRINT windows, regardless of the hop */
+	nmt->super_print_count = SUPER_PRINT * nmt->super_samples / nmt->super_hop;
+
+	/* track the selected supervisory tone and the noise floor, the window slides by one hop per measurement */
+	if (nmt->supervisory) {
+		freq[0] = super_freq[nmt->supervisory - 1];
+		freq[1] = super_freq[4];
+		rc = tone_track_init(&nmt->super_track, freq, 2, nmt->sender.samplerate, nmt->super_samples);
+		if (rc < 0)
+			return rc;
+	}
+	nmt->super_hop_pos = 0;
 
 	/* count supervidory tones */
-	for (i = 0; i < 5; i++) {
-		audio_goertzel_init(&nmt->super_goertzel[i], super_freq[i], nmt->sender.samplerate);
-		if (i < 4)
-			nmt->super_phaseshift65536[i] = 65536.0 / ((double)nmt->sender.samplerate / super_freq[i]);
-	}
+	for (i = 0; i < 4; i++)
+		nmt->super_phaseshift65536[i] = 65536.0 / ((double)nmt->sender.samplerate / super_freq[i]);
 	super_reset(nmt);
 
 	/* dial tone */
@@ -164,6 +261,8 @@ int dsp_init_sender(nmt_t *nmt, double deviation_factor)
 		nmt->dmp_super_quality = display_measurements_add(&nmt->sender.dispmeas, "Super Quality", "%.1f %%", DISPLAY_MEAS_AVG, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 	}
 
+	sender_account_dsp(&nmt->sender, sizeof(*nmt) - sizeof(nmt->sender) + sizeof(sample_t) * NMT_FRAME_BITS * nmt->fsk_mod.table_size * (FRAME_CACHE_NUM + 1));
+
 	return 0;
 }
 
@@ -172,13 +271,14 @@ void dsp_cleanup_sender(nmt_t *nmt)
 {
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Cleanup DSP for Transceiver.\n");
 
+	frame_cache_flush(nmt);
+	free(nmt->tx_frame_buffer);
+	nmt->tx_frame_buffer = NULL;
+
 	fsk_mod_cleanup(&nmt->fsk_mod);
 	fsk_demod_cleanup(&nmt->fsk_demod);
 
-	if (nmt->super_filter_spl) {
-		free(nmt->super_filter_spl);
-		nmt->super_filter_spl = NULL;
-	}
+	tone_track_exit(&nmt->super_track);
 }
 
 /* Check for SYNC bits, then collect data bits */
@@ -230,6 +330,7 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 		nmt->rx_sync = 0;
 		nmt->rx_in_sync = 1;
 		nmt->rx_count = 0;
+		memset(nmt->rx_frame, 0, sizeof(nmt->rx_frame));
 
 		/* set muting of receive path */
 		nmt->rx_mute = (int)((double)nmt->sender.samplerate * MUTE_DURATION);
@@ -237,14 +338,13 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 	}
 
 	/* read bits */
-	nmt->rx_frame[nmt->rx_count] = bit + '0';
+	nmt->rx_frame[nmt->rx_count >> 3] |= bit << (7 - (nmt->rx_count & 7));
 	nmt->rx_level[nmt->rx_count] = level;
 	nmt->rx_quality[nmt->rx_count] = quality;
-	if (++nmt->rx_count != 140)
+	if (++nmt->rx_count != NMT_CODE_BITS)
 		return;
 
 	/* end of frame */
-	nmt->rx_frame[140] = '\0';
 	nmt->rx_in_sync = 0;
 
 	/* average level and quality */
@@ -261,17 +361,27 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 
 	/* send telegramm */
 	frames_elapsed = (nmt->rx_bits_count_current - nmt->rx_bits_count_last + 83) / 166; /* round to nearest frame */
+	/* mark frame in IQ recording */
+	sender_annotate(&nmt->sender, 166.0 / BIT_RATE, "NMT frame");
 	/* convert level so that received level at TX_PEAK_FSK results in 1.0 (100%) */
 	nmt_receive_frame(nmt, nmt->rx_frame, quality, level, frames_elapsed);
 }
 
+/* receive bits of one chunk */
+static void fsk_receive_bits(void *inst, const fsk_soft_bit_t *bits, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		fsk_receive_bit(inst, bits[i].bit, bits[i].quality, bits[i].level);
+}
+
 /* compare supervisory signal against noise floor around 3895 Hz */
-static void super_decode(nmt_t *nmt, sample_t *samples, int length)
+static void super_decode(nmt_t *nmt)
 {
 	double result[2], level, quality;
 
-	audio_goertzel(&nmt->super_goertzel[nmt->supervisory - 1], samples, length, 0, &result[0], 1);
-	audio_goertzel(&nmt->super_goertzel[4], samples, length, 0, &result[1], 1); /* noise floor detection */
+	tone_track_levels(&nmt->super_track, result);
 
 	/* normalize supervisory level */
 	level = result[0] / TX_PEAK_SUPER;
@@ -281,7 +391,7 @@ static void super_decode(nmt_t *nmt, sample_t *samples, int length)
 		quality = 0;
 
 	if (nmt->state == STATE_ACTIVE) {
-		if (++nmt->super_print == SUPER_PRINT) {
+		if (++nmt->super_print >= nmt->super_print_count) {
 			nmt->super_print = 0;
 			LOGP_CHAN(DDSP, LOGL_NOTICE, "Supervisory level %.0f%% quality %.0f%%\n", level * 100.0, quality * 100.0);
 		}
@@ -324,26 +434,25 @@ void super_reset(nmt_t *nmt)
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	nmt_t *nmt = (nmt_t *) sender;
 	sample_t *spl;
-	int max, pos;
-	int i;
-
-	/* write received samples to decode buffer */
-	max = nmt->super_samples;
-	spl = nmt->super_filter_spl;
-	pos = nmt->super_filter_pos;
-	for (i = 0; i < length; i++) {
-		spl[pos++] = samples[i];
-		if (pos == max) {
-			pos = 0;
-			if (nmt->supervisory)
-				super_decode(nmt, spl, max);
+	int pos;
+	int i, n;
+
+	/* slide supervisory window, measure after each hop */
+	for (i = 0; nmt->supervisory && i < length; i += n) {
+		n = nmt->super_hop - nmt->super_hop_pos;
+		if (n > length - i)
+			n = length - i;
+		tone_track_process(&nmt->super_track, samples + i, n);
+		nmt->super_hop_pos += n;
+		if (nmt->super_hop_pos == nmt->super_hop) {
+			nmt->super_hop_pos = 0;
+			super_decode(nmt);
 		}
 	}
-	nmt->super_filter_pos = pos;
 
 	/* fsk signal */
 	fsk_demod_receive(&nmt->fsk_demod, samples, length);
@@ -383,10 +492,13 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 		nmt->sender.rxbuf_pos = 0;
 }
 
-static int fsk_send_bit(void *inst)
+/* return up to 32 bits of the current frame, or one DMS bit */
+static int fsk_send_bits(void *inst, uint32_t *bits)
 {
 	nmt_t *nmt = (nmt_t *)inst;
-	const char *frame;
+	const uint8_t *frame;
+	int i, n;
+	int bit;
 
 	/* send frame bit (prio) */
 	if (nmt->dsp_mode == DSP_MODE_FRAME) {
@@ -398,16 +510,78 @@ static int fsk_send_bit(void *inst)
 				LOGP_CHAN(DDSP, LOGL_DEBUG, "Stop sending frames.\n");
 				return -1;
 			}
-			memcpy(nmt->tx_frame, frame, 166);
-			nmt->tx_frame_length = 166;
+			memcpy(nmt->tx_frame, frame, NMT_FRAME_BYTES);
+			nmt->tx_frame_length = NMT_FRAME_BITS;
 			nmt->tx_frame_pos = 0;
 		}
 
-		return nmt->tx_frame[nmt->tx_frame_pos++];
+		n = nmt->tx_frame_length - nmt->tx_frame_pos;
+		if (n > 32)
+			n = 32;
+		*bits = 0;
+		for (i = 0; i < n; i++, nmt->tx_frame_pos++)
+			*bits |= (uint32_t)((nmt->tx_frame[nmt->tx_frame_pos >> 3] >> (7 - (nmt->tx_frame_pos & 7))) & 1) << i;
+		return n;
 	}
 
 	/* send dms bit */
-	return dms_send_bit(nmt);
+	bit = dms_send_bit(nmt);
+	if (bit < 0)
+		return 0;
+	*bits = bit;
+	return 1;
+}
+
+/* Send samples of frames, get next frame, if all samples of current frame have been sent.
+ * Idle frames are taken from cache, other frames are rendered. */
+static int frame_send(nmt_t *nmt, sample_t *samples, int length)
+{
+	struct frame_cache *cache;
+	const uint8_t *frame;
+	int table_bit, table_phase;
+	int count = 0, n;
+
+	while (count < length) {
+		if (nmt->tx_frame_spl_pos == nmt->tx_frame_spl_count) {
+			/* request frame */
+			frame = nmt_get_frame(nmt);
+			if (!frame) {
+				nmt->tx_frame_spl_count = nmt->tx_frame_spl_pos = 0;
+				fsk_mod_reset(&nmt->fsk_mod);
+				LOGP_CHAN(DDSP, LOGL_DEBUG, "Stop sending frames.\n");
+				break;
+			}
+			nmt->tx_frame_spl_pos = 0;
+			cache = NULL;
+			if (nmt->tx_last_frame_idle)
+				cache = frame_cache_lookup(nmt, frame);
+			if (cache) {
+				nmt->fsk_mod.tx_table_bit = cache->next_table_bit;
+				nmt->fsk_mod.tx_table_phase = cache->next_table_phase;
+			} else {
+				table_bit = nmt->fsk_mod.tx_table_bit;
+				table_phase = nmt->fsk_mod.tx_table_phase;
+				n = fsk_mod_render(&nmt->fsk_mod, frame, NMT_FRAME_BITS, nmt->tx_frame_buffer);
+				if (nmt->tx_last_frame_idle)
+					cache = frame_cache_store(nmt, frame, table_bit, table_phase, nmt->tx_frame_buffer, n);
+			}
+			if (cache) {
+				nmt->tx_frame_spl = cache->spl;
+				nmt->tx_frame_spl_count = cache->count;
+			} else {
+				nmt->tx_frame_spl = nmt->tx_frame_buffer;
+				nmt->tx_frame_spl_count = n;
+			}
+		}
+		n = nmt->tx_frame_spl_count - nmt->tx_frame_spl_pos;
+		if (n > length - count)
+			n = length - count;
+		memcpy(samples + count, nmt->tx_frame_spl + nmt->tx_frame_spl_pos, n * sizeof(*samples));
+		nmt->tx_frame_spl_pos += n;
+		count += n;
+	}
+
+	return count;
 }
 
 /* Generate audio stream with supervisory signal. Keep phase for next call of function. */
@@ -449,7 +623,7 @@ static void dial_tone(nmt_t *nmt, sample_t *samples, int length)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	nmt_t *nmt = (nmt_t *) sender;
 	int count, input_num;
@@ -486,7 +660,10 @@ again:
 	case DSP_MODE_FRAME:
 		/* Encode frame into audio stream. If frames have
 		 * stopped, process again for rest of stream. */
-		count = fsk_mod_send(&nmt->fsk_mod, samples, length, 0);
+		if (nmt->tx_frame_buffer)
+			count = frame_send(nmt, samples, length);
+		else
+			count = fsk_mod_send(&nmt->fsk_mod, samples, length, 0);
 		/* special case: add supervisory signal to frame at loop test */
 		if (nmt->sender.loopback && nmt->supervisory)
 			super_encode(nmt, samples, count);
@@ -525,6 +702,7 @@ void nmt_set_dsp_mode(nmt_t *nmt, enum dsp_mode mode)
 	if (mode == DSP_MODE_FRAME && nmt->dsp_mode != mode) {
 		fsk_mod_reset(&nmt->fsk_mod);
 		nmt->tx_frame_length = 0;
+		nmt->tx_frame_spl_count = nmt->tx_frame_spl_pos = 0;
 	}
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "DSP mode %s -> %s\n", nmt_dsp_mode_name(nmt->dsp_mode), nmt_dsp_mode_name(mode));
@@ -549,7 +727,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 
 	if (nmt->dsp_mode == DSP_MODE_AUDIO || nmt->dsp_mode == DSP_MODE_DTMF) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&nmt->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&nmt->sender.dejitter, jf);
 	}
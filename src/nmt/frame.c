@@ -624,6 +624,7 @@ static const char *param_waiting(uint64_t value, int __attribute__((unused)) ndi
 {
 	static char result[128];
 
+	result[0] = '\0';
 	if (value & 0x01)
 		strcat(result, "SMS ");
 	if (value & 0x02)
@@ -677,14 +678,25 @@ static struct nmt_parameter {
 	{ 0,	0,	NULL,				NULL }
 };
 
+/* get digit of frame word, digit 0 is the first digit (MSB) */
+#define DIGIT(word, i)	(((word) >> (60 - 4 * (i))) & 0xf)
+
+/* fields of each message type, created by init_frame() */
+static struct nmt_field {
+	char	digit;
+	uint8_t	shift;		/* position of last digit in frame word */
+	uint8_t	ndigits;
+} nmt_field[NMT_MESSAGE_UKN_BS_MS + 1][16];
+static int nmt_field_num[NMT_MESSAGE_UKN_BS_MS + 1];
+
 /* Depending on P-value, direction and additional info, frame index (used for
  * nmt_frame[]) is decoded.
  */
-static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction direction, int callack)
+static enum nmt_mt decode_frame_mt(uint64_t word, enum nmt_direction direction, int callack)
 {
 	if (direction == MS_TO_MTX || direction == BS_TO_MTX || direction == XX_TO_MTX) {
 		/* MS/BS TO MTX */
-		switch (digits[3]) {
+		switch (DIGIT(word, 3)) {
 		case 0:
 			return NMT_MESSAGE_15;
 		case 1:
@@ -702,17 +714,17 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 		case 6:
 			return NMT_MESSAGE_10c;
 		case 7:
-			if (digits[11] == 0)
+			if (DIGIT(word, 11) == 0)
 				return NMT_MESSAGE_14a;
-			if (digits[11] == 15)
+			if (DIGIT(word, 11) == 15)
 				return NMT_MESSAGE_14b;
 			break;
 		case 8:
-			if (digits[11] == 2)
+			if (DIGIT(word, 11) == 2)
 				return NMT_MESSAGE_13b;
 			return NMT_MESSAGE_13a;
 		case 9:
-			switch((digits[13] << 8) + (digits[14] << 4) + digits[15]) {
+			switch(word & 0xfff) {
 			case 2:
 			case 6:
 				return NMT_MESSAGE_25_2;
@@ -740,7 +752,7 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 		return NMT_MESSAGE_UKN_BS_MS;
 	} else {
 		/* MTX to MS/BS */
-		switch (digits[3]) {
+		switch (DIGIT(word, 3)) {
 		case 0:
 			return NMT_MESSAGE_6;
 		case 1:
@@ -748,17 +760,17 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 		case 2:
 			return NMT_MESSAGE_5c;
 		case 3:
-			if (digits[6] == 15)
+			if (DIGIT(word, 6) == 15)
 				return NMT_MESSAGE_21b;
 			return NMT_MESSAGE_4;
 		case 4:
-			if (digits[6] || digits[7] || digits[8] || digits[9] || digits[10] || digits[11] || digits[12])
+			if (DIGIT(word, 6) || DIGIT(word, 7) || DIGIT(word, 8) || DIGIT(word, 9) || DIGIT(word, 10) || DIGIT(word, 11) || DIGIT(word, 12))
 				return NMT_MESSAGE_2e;
 			return NMT_MESSAGE_1b;
 		case 5:
-			if (digits[6] == 15)
+			if (DIGIT(word, 6) == 15)
 				return NMT_MESSAGE_21c;
-			switch((digits[13] << 8) + (digits[14] << 4) + digits[15]) {
+			switch(word & 0xfff) {
 			case 0x3f3:
 			case 0x3f4:
 			case 0x3f5:
@@ -769,11 +781,11 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 				return NMT_MESSAGE_3a;
 			}
 		case 6:
-			if (digits[13] == 0)
+			if (DIGIT(word, 13) == 0)
 				return NMT_MESSAGE_5b;
 			return NMT_MESSAGE_5a;
 		case 7:
-			switch((digits[13] << 8) + (digits[14] << 4) + digits[15]) {
+			switch(word & 0xfff) {
 			case 0x3f3:
 			case 0x3f4:
 			case 0x3f5:
@@ -793,15 +805,15 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 			return NMT_MESSAGE_1a_a;
 		case 12:
 			/* no subscriber */
-			if (digits[6] == 0)
+			if (DIGIT(word, 6) == 0)
 				return NMT_MESSAGE_1a;
 			/* battery saving */
-			if (digits[6] == 14)
+			if (DIGIT(word, 6) == 14)
 				return NMT_MESSAGE_1a;
 			/* info to BS (should not happen here) */
-			if (digits[6] == 15)
+			if (DIGIT(word, 6) == 15)
 				return NMT_MESSAGE_1a;
-			switch((digits[13] << 8) + (digits[14] << 4) + digits[15]) {
+			switch(word & 0xfff) {
 			case 0x3f3:
 			case 0x3f4:
 			case 0x3f5:
@@ -820,13 +832,13 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 		case 13:
 			return NMT_MESSAGE_1a_b;
 		case 14:
-			if (digits[13] != 15)
+			if (DIGIT(word, 13) != 15)
 				break;
 			return NMT_MESSAGE_22;
 		case 15:
-			if (digits[13] != 15)
+			if (DIGIT(word, 13) != 15)
 				break;
-			switch (digits[10]) {
+			switch (DIGIT(word, 10)) {
 			case 3:
 				return NMT_MESSAGE_20_1;
 			case 6:
@@ -847,6 +859,7 @@ static enum nmt_mt decode_frame_mt(const uint8_t *digits, enum nmt_direction dir
 
 int init_frame(void)
 {
+	struct nmt_field *field;
 	int i, j, k;
 	char digit;
 
@@ -857,6 +870,10 @@ int init_frame(void)
 			LOGP(DFRAME, LOGL_ERROR, "Message type at message index #%d does not have a value of %d, but has %d, please fix!\n", i, i + 1, nmt_frame[i].message_type);
 			return -1;
 		}
+		if (i > NMT_MESSAGE_UKN_BS_MS) {
+			LOGP(DFRAME, LOGL_ERROR, "Message index #%d exceeds table of fields, please fix!\n", i);
+			return -1;
+		}
 		/* check IEs */
 		for (j = 0; j < 16; j++) {
 			digit = nmt_frame[i].digits[j];
@@ -871,45 +888,62 @@ int init_frame(void)
 				return -1;
 			}
 		}
+		/* each run of equal digits is one field */
+		nmt_field_num[i] = 0;
+		for (j = 0; j < 16; j++) {
+			digit = nmt_frame[i].digits[j];
+			if (digit == '-')
+				continue;
+			field = &nmt_field[i][nmt_field_num[i]++];
+			field->digit = digit;
+			field->ndigits = 1;
+			while (j + 1 < 16 && nmt_frame[i].digits[j + 1] == digit) {
+				field->ndigits++;
+				j++;
+			}
+			field->shift = 60 - 4 * j;
+		}
 	}
 	num_frames = i;
 
 	return 0;
 }
 
-/* decode 16 digits frame */
-static void disassemble_frame(int nmt_system, frame_t *frame, const uint8_t *digits, enum nmt_direction direction, int callack)
+static void debug_param(int nmt_system, char digit, uint64_t value, int ndigits, enum nmt_direction direction)
+{
+	int j;
+
+	for (j = 0; nmt_parameter[j].digit; j++) {
+		if (nmt_parameter[j].system != 0 && nmt_parameter[j].system != nmt_system)
+			continue;
+		if (nmt_parameter[j].digit == digit) {
+			LOGP(DFRAME, LOGL_DEBUG, " %c: %s\n", digit, nmt_parameter[j].decoder(value, ndigits, direction));
+		}
+	}
+}
+
+/* decode frame word of 16 digits */
+static void disassemble_frame(int nmt_system, frame_t *frame, uint64_t word, enum nmt_direction direction, int callack)
 {
 	enum nmt_mt mt;
-	int i, j, ndigits;
-	char digit;
+	struct nmt_field *field;
+	int i;
 	uint64_t value;
 
 	memset(frame, 0, sizeof(*frame));
 
 	/* message type of frame */
-	mt = decode_frame_mt(digits, direction, callack);
+	mt = decode_frame_mt(word, direction, callack);
 	frame->mt = mt;
 
 	/* update direction */
 	direction = nmt_frame[mt].direction;
 
-	LOGP(DFRAME, LOGL_DEBUG, "Decoding %s %s %s\n", nmt_dir_name(direction), nmt_frame[mt].nr, nmt_frame[mt].description);
+	LOGP_HOT(DFRAME, LOGL_DEBUG, "Decoding %s %s %s\n", nmt_dir_name(direction), nmt_frame[mt].nr, nmt_frame[mt].description);
 
-	for (i = 0; i < 16; i++) {
-		digit = nmt_frame[mt].digits[i];
-		if (digit == '-')
-			continue;
-		value = digits[i];
-		ndigits = 1;
-		for (j = i + 1; j < 16; j++) {
-			if (nmt_frame[mt].digits[j] != digit)
-				break;
-			value = (value << 4) | digits[j];
-			ndigits++;
-			i++;
-		}
-		switch (digit) {
+	for (i = 0, field = nmt_field[mt]; i < nmt_field_num[mt]; i++, field++) {
+		value = (word >> field->shift) & (~0ULL >> (64 - 4 * field->ndigits));
+		switch (field->digit) {
 		case 'N':
 			frame->channel_no = value;
 			break;
@@ -983,38 +1017,26 @@ static void disassemble_frame(int nmt_system, frame_t *frame, const uint8_t *dig
 			frame->waiting_info = value;
 			break;
 		default:
-			LOGP(DFRAME, LOGL_ERROR, "Digit '%c' does not exist, please fix!\n", digit);
+			LOGP(DFRAME, LOGL_ERROR, "Digit '%c' does not exist, please fix!\n", field->digit);
 			abort();
 		}
-		if (loglevel <= LOGL_DEBUG) {
-			for (j = 0; nmt_parameter[j].digit; j++) {
-				if (nmt_parameter[j].system != 0 && nmt_parameter[j].system != nmt_system)
-					continue;
-				if (nmt_parameter[j].digit == digit) {
-					LOGP(DFRAME, LOGL_DEBUG, " %c: %s\n", digit, nmt_parameter[j].decoder(value, ndigits, direction));
-				}
-			}
-		}
+		if (LOGLEVEL_HOT(LOGL_DEBUG))
+			debug_param(nmt_system, field->digit, value, field->ndigits, direction);
 	}
 
-	if (loglevel <= LOGL_DEBUG) {
-		char debug_digits[17];
-
-		for (i = 0; i < 16; i++)
-			debug_digits[i] = "0123456789abcdef"[digits[i]];
-		debug_digits[i] = '\0';
+	if (LOGLEVEL_HOT(LOGL_DEBUG)) {
 		LOGP(DFRAME, LOGL_DEBUG, "%s\n", nmt_frame[mt].digits);
-		LOGP(DFRAME, LOGL_DEBUG, "%s\n", debug_digits);
+		LOGP(DFRAME, LOGL_DEBUG, "%016" PRIx64 "\n", word);
 	}
 }
 
-/* encode 16 digits frame */
-static void assemble_frame(int nmt_system, frame_t *frame, uint8_t *digits, int debug)
+/* encode frame word of 16 digits */
+static uint64_t assemble_frame(int nmt_system, frame_t *frame, int debug)
 {
 	enum nmt_mt mt;
-	int i, j;
-	char digit;
-	uint64_t value;
+	struct nmt_field *field;
+	int i;
+	uint64_t value, word = 0;
 	enum nmt_direction direction;
 
 	mt = frame->mt;
@@ -1033,13 +1055,8 @@ static void assemble_frame(int nmt_system, frame_t *frame, uint8_t *digits, int
 	if (debug)
 		LOGP(DFRAME, LOGL_DEBUG, "Coding %s %s %s\n", nmt_dir_name(direction), nmt_frame[mt].nr, nmt_frame[mt].description);
 
-	for (i = 15; i >= 0; i--) {
-		digit = nmt_frame[mt].digits[i];
-		if (digit == '-') {
-			digits[i] = 0;
-			continue;
-		}
-		switch (digit) {
+	for (i = 0, field = nmt_field[mt]; i < nmt_field_num[mt]; i++, field++) {
+		switch (field->digit) {
 		case 'N':
 			value = frame->channel_no;
 			break;
@@ -1113,95 +1130,68 @@ static void assemble_frame(int nmt_system, frame_t *frame, uint8_t *digits, int
 			value = frame->waiting_info;
 			break;
 		default:
-			LOGP(DFRAME, LOGL_ERROR, "Digit '%c' does not exist, please fix!\n", digit);
+			LOGP(DFRAME, LOGL_ERROR, "Digit '%c' does not exist, please fix!\n", field->digit);
 			abort();
 		}
-
-		digits[i] = (value & 0xf);
-		value >>= 4;
-		for (j = i - 1; j >= 0; j--) {
-			if (nmt_frame[mt].digits[j] != digit)
-				break;
-			digits[j] = (value & 0xf);
-			value >>= 4;
-			i--;
-		}
+		value &= ~0ULL >> (64 - 4 * field->ndigits);
+		word |= value << field->shift;
+		if (debug && LOGLEVEL_HOT(LOGL_DEBUG))
+			debug_param(nmt_system, field->digit, value, field->ndigits, direction);
 	}
-	if (debug && loglevel <= LOGL_DEBUG) {
-		char debug_digits[17];
-		int ndigits;
-
-		for (i = 0; i < 16; i++) {
-			digit = nmt_frame[mt].digits[i];
-			if (digit == '-')
-				continue;
-			value = digits[i];
-			ndigits = 1;
-			for (j = i + 1; j < 16; j++) {
-				if (nmt_frame[mt].digits[j] != digit)
-					break;
-				value = (value << 4) | digits[j];
-				ndigits++;
-				i++;
-			}
-			for (j = 0; nmt_parameter[j].digit; j++) {
-				if (nmt_parameter[j].system != 0 && nmt_parameter[j].system != nmt_system)
-					continue;
-				if (nmt_parameter[j].digit == digit) {
-					LOGP(DFRAME, LOGL_DEBUG, " %c: %s\n", digit, nmt_parameter[j].decoder(value, ndigits, direction));
-				}
-			}
-		}
-
-		for (i = 0; i < 16; i++)
-			debug_digits[i] = "0123456789abcdef"[digits[i]];
-		debug_digits[i] = '\0';
+	if (debug && LOGLEVEL_HOT(LOGL_DEBUG)) {
 		LOGP(DFRAME, LOGL_DEBUG, "%s\n", nmt_frame[mt].digits);
-		LOGP(DFRAME, LOGL_DEBUG, "%s\n", debug_digits);
+		LOGP(DFRAME, LOGL_DEBUG, "%016" PRIx64 "\n", word);
 	}
+
+	return word;
 }
 
-/* encode frame to bits
+/* encode frame to bits, including sync, see NMT_FRAME_BYTES
  * debug can be turned on or off
  */
-const char *encode_frame(int nmt_system, frame_t *frame, int debug)
+const uint8_t *encode_frame(int nmt_system, frame_t *frame, int debug)
 {
-	uint8_t digits[16], message[9], code[18];
-	static char bits[166];
+	uint8_t message[9], code[18];
+	static uint8_t bits[NMT_FRAME_BYTES];
+	uint64_t word;
 	int i;
 
-	assemble_frame(nmt_system, frame, digits, debug);
+	word = assemble_frame(nmt_system, frame, debug);
 
 	/* hagelbarger code */
-	message[8] = 0x00;
 	for (i = 0; i < 8; i++)
-		message[i] = (digits[i * 2] << 4) | digits[i * 2 + 1];
+		message[i] = word >> (56 - 8 * i);
+	message[8] = 0x00;
 	hagelbarger_encode(message, code, 70);
-	memcpy(bits, "10101010101010111100010010", 26);
-	for (i = 0; i < 140; i++)
-		bits[i + 26] = ((code[i / 8] >> (7 - (i & 7))) & 1) + '0';
+	code[17] &= 0xf0;
+
+	/* 26 bits of sync (10101010101010111100010010), followed by 140 bits of code */
+	bits[0] = 0xaa;
+	bits[1] = 0xab;
+	bits[2] = 0xc4;
+	bits[3] = 0x80 | (code[0] >> 2);
+	for (i = 1; i < 18; i++)
+		bits[i + 3] = (code[i - 1] << 6) | (code[i] >> 2);
 
 	return bits;
 }
 
-/* decode bits to frame */
-int decode_frame(int nmt_system, frame_t *frame, const char *bits, enum nmt_direction direction, int callack)
+/* decode frame from code bits, see NMT_CODE_BYTES */
+int decode_frame(int nmt_system, frame_t *frame, const uint8_t *bits, enum nmt_direction direction, int callack)
 {
-	uint8_t digits[16], message[8], code[19];
+	uint8_t message[8], code[19];
+	uint64_t word = 0;
 	int i;
 
 	/* hagelbarger code */
-	memset(code, 0x00, sizeof(code));
-	for (i = 0; i < 140; i++)
-		code[i / 8] |= (bits[i] & 1) << (7 - (i & 7));
+	memcpy(code, bits, NMT_CODE_BYTES);
+	code[17] &= 0xf0;
+	code[18] = 0x00;
 	hagelbarger_decode(code, message, 64);
-	for (i = 0; i < 8; i++) {
-		digits[i * 2] = message[i] >> 4;
-		digits[i * 2 + 1] = message[i] & 0x0f;
-	}
+	for (i = 0; i < 8; i++)
+		word = (word << 8) | message[i];
 
-	disassemble_frame(nmt_system, frame, digits, direction, callack);
+	disassemble_frame(nmt_system, frame, word, direction, callack);
 
 	return 0;
 }
-
@@ -98,6 +98,6 @@ int nmt_encode_a_number(frame_t *frame, int index, enum number_type type, const
 
 const char *nmt_frame_name(enum nmt_mt mt);
 
-const char *encode_frame(int nmt_system, frame_t *frame, int debug);
-int decode_frame(int nmt_system, frame_t *frame, const char *bits, enum nmt_direction direction, int callack);
+const uint8_t *encode_frame(int nmt_system, frame_t *frame, int debug);
+int decode_frame(int nmt_system, frame_t *frame, const uint8_t *bits, enum nmt_direction direction, int callack);
 
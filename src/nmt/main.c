@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include "../libsample/sample.h"
 #include "../libmobile/main_mobile.h"
+#include "../libmobile/startup.h"
 #include "../liblogging/logging.h"
 #include "../liboptions/options.h"
 #include "nmt.h"
@@ -44,7 +45,7 @@ static int sms_deliver_fd = -1;
 /* settings */
 int nmt_system = 450;
 int num_chan_type = 0;
-enum nmt_chan_type chan_type[MAX_SENDER] = { CHAN_TYPE_CC_TC };
+enum nmt_chan_type *chan_type = NULL;
 int ms_power = 1; /* 0..3 */
 char country[16] = "";
 uint8_t traffic_area;
@@ -52,7 +53,8 @@ int traffic_area_given = 0;
 char area_no = 0;
 int compandor = 1;
 int num_supervisory = 0;
-int supervisory[MAX_SENDER] = { 1 };
+int *supervisory = NULL;
+int super_hop = 0;
 const char *smsc_number = "767";
 int send_callerid = 0;
 int send_clock = 0;
@@ -65,7 +67,7 @@ void print_help(const char *arg0)
 	printf("        Give NMT type as first parameter. (default = '%d')\n", nmt_system);
 	printf("        Note: This option must be given at first!\n");
 	printf(" -T --channel-type <channel type> | list\n");
-	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(nmt_system, chan_type[0]));
+	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(nmt_system, CHAN_TYPE_CC_TC));
 	printf(" -P --ms-power <power level>\n");
 	printf("        Give power level of the mobile station 0..3. (default = '%d')\n", ms_power);
     if (nmt_system == 450) {
@@ -88,7 +90,12 @@ void print_help(const char *arg0)
 	printf("        Make use of the compandor to reduce noise during call. (default = '%d')\n", compandor);
 	printf(" -0 --supervisory 1..4 | 0\n");
 	printf("        Use supervisory signal 1..4 to detect loss of signal from mobile\n");
-	printf("        station, use 0 to disable. (default = '%d')\n", supervisory[0]);
+	printf("        station, use 0 to disable. (default = '%d')\n", 1);
+	printf("    --super-hop <ms>\n");
+	printf("        Measure supervisory signal after every given milliseconds, instead of\n");
+	printf("        every window of 67 ms. The signal is detected or lost after a number\n");
+	printf("        of measurements, so a shorter hop reduces the detection latency.\n");
+	printf("        (default = window length)\n");
 	printf(" -S --smsc-number <digits>\n");
 	printf("        If this number is dialed, the mobile is connected to the SMSC (Short\n");
 	printf("        Message Service Center). (default = '%s')\n", smsc_number);
@@ -101,6 +108,8 @@ void print_help(const char *arg0)
 	main_mobile_print_hotkeys();
 }
 
+#define OPT_SUPER_HOP	256
+
 static void add_options(void)
 {
 	main_mobile_add_options();
@@ -111,6 +120,7 @@ static void add_options(void)
 	option_add('A', "area-number", 1);
 	option_add('C', "compandor", 1);
 	option_add('0', "supervisory", 1);
+	option_add(OPT_SUPER_HOP, "super-hop", 1);
 	option_add('S', "smsc-number", 1);
 	option_add('I', "caller-id", 1);
 	option_add('U', "clock", 1);
@@ -205,6 +215,13 @@ error_ta:
 		}
 		OPT_ARRAY(num_supervisory, supervisory, super)
 		break;
+	case OPT_SUPER_HOP:
+		super_hop = atoi(argv[argi]);
+		if (super_hop < 1) {
+			fprintf(stderr, "Given supervisory hop is wrong, use '-h' for help!\n");
+			return -EINVAL;
+		}
+		break;
 	case 'S':
 		smsc_number = options_strdup(argv[argi]);
 		break;
@@ -292,6 +309,7 @@ int main(int argc, char *argv[])
 	argi = options_command_line(argc, argv, handle_options);
 	if (argi <= 0)
 		return argi;
+	startup_step("options");
 
 	if (argi < argc) {
 		station_id = argv[argi];
@@ -306,38 +324,36 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 		/* set channel types for more than 1 channel */
 		if (num_kanal > 1 && num_chan_type == 0) {
 			if (loopback)
-				chan_type[0] = CHAN_TYPE_TEST;
+				OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_TEST)
 			else
-				chan_type[0] = CHAN_TYPE_CC;
+				OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC)
 			for (i = 1; i < num_kanal; i++) {
 				if (loopback)
-					chan_type[i] = CHAN_TYPE_TEST;
+					OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_TEST)
 				else
-					chan_type[i] = CHAN_TYPE_TC;
+					OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_TC)
 			}
-			num_chan_type = num_kanal;
 		}
 		if (num_supervisory == 0) {
 			/* set supervisory signal */
 			for (i = 0; i < num_kanal; i++)
-				supervisory[i] = (i % 4) + 1;
-			num_supervisory = num_kanal;
+				OPT_ARRAY(num_supervisory, supervisory, (i % 4) + 1)
 		}
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		return -EINVAL;
 	}
 	if (num_kanal == 1 && num_chan_type == 0) {
-		num_chan_type = 1; /* use default */
+		OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC_TC) /* use default */
 		if (loopback)
 			chan_type[0] = CHAN_TYPE_TEST;
 	}
@@ -346,7 +362,7 @@ int main(int argc, char *argv[])
 		return -EINVAL;
 	}
 	if (num_kanal == 1 && num_supervisory == 0)
-		num_supervisory = 1; /* use default */
+		OPT_ARRAY(num_supervisory, supervisory, 1) /* use default */
 	if (num_kanal != num_supervisory) {
 		fprintf(stderr, "You need to specify as many supervisory signals as you have channels.\n");
 		fprintf(stderr, "They shall be different at channels that are close to each other.\n");
@@ -394,12 +410,15 @@ int main(int argc, char *argv[])
 
 	/* inits */
 	fm_init(fast_math);
+	startup_step("fm_init");
 	rc = init_frame();
 	if (rc < 0) {
 		fprintf(stderr, "Failed to setup frames. Quitting!\n");
 		return -1;
 	}
+	startup_step("init_frame");
 	dsp_init();
+	startup_step("dsp_init");
 
 	/* SDR always requires emphasis */
 	if (use_sdr) {
@@ -409,7 +428,7 @@ int main(int argc, char *argv[])
 
 	/* create transceiver instance */
 	for (i = 0; i < num_kanal; i++) {
-		rc = nmt_create(nmt_system, country, kanal[i], chan_type[i], dsp_device[i], use_sdr, dsp_samplerate, rx_gain, tx_gain, do_pre_emphasis, do_de_emphasis, write_rx_wave, write_tx_wave, read_rx_wave, read_tx_wave, ms_power, traffic_area, area_no, compandor, supervisory[i], smsc_number, send_callerid, send_clock, loopback);
+		rc = nmt_create(nmt_system, country, kanal[i], chan_type[i], dsp_device[i], use_sdr, dsp_samplerate, rx_gain, tx_gain, do_pre_emphasis, do_de_emphasis, write_rx_wave, write_tx_wave, read_rx_wave, read_tx_wave, ms_power, traffic_area, area_no, compandor, supervisory[i], super_hop, smsc_number, send_callerid, send_clock, loopback);
 		if (rc < 0) {
 			fprintf(stderr, "Failed to create transceiver instance. Quitting!\n");
 			goto fail;
@@ -418,6 +437,7 @@ int main(int argc, char *argv[])
 	}
 
 	nmt_check_channels(nmt_system);
+	startup_step("create instances");
 
 	main_mobile_loop("nmt", &quit, myhandler, station_id);
 
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 #include "../libsample/sample.h"
 #include "../liblogging/logging.h"
 #include "../libmobile/cause.h"
@@ -32,6 +33,7 @@
 #include "../libmobile/console.h"
 #include <osmocom/cc/message.h>
 #include "nmt.h"
+#include "../libmobile/frametrace.h"
 #include "transaction.h"
 #include "dsp.h"
 #include "frame.h"
@@ -131,6 +133,7 @@ static void nmt_new_state(nmt_t *nmt, enum nmt_state new_state)
 		return;
 	LOGP_CHAN(DNMT, LOGL_DEBUG, "State change: %s -> %s\n", nmt_state_name(nmt->state), nmt_state_name(new_state));
 	nmt->state = new_state;
+	chan_alloc_set_idle(&nmt->sender, new_state == STATE_IDLE);
 	nmt_display_status();
 }
 
@@ -261,10 +264,13 @@ static inline int is_chan_class_tc(enum nmt_chan_type chan_type)
 	return 0;
 }
 
+/* idle traffic channels, combined CC/TC are the second alternative */
+static chan_list_t tc_list, cc_tc_list;
+
 static void nmt_timeout(void *data);
 
 /* Create transceiver instance and link to a list. */
-int nmt_create(int nmt_system, const char *country, const char *kanal, enum nmt_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint8_t ms_power, uint8_t traffic_area, uint8_t area_no, int compandor, int supervisory, const char *smsc_number, int send_callerid, int send_clock, int loopback)
+int nmt_create(int nmt_system, const char *country, const char *kanal, enum nmt_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint8_t ms_power, uint8_t traffic_area, uint8_t area_no, int compandor, int supervisory, int super_hop, const char *smsc_number, int send_callerid, int send_clock, int loopback)
 {
 	nmt_t *nmt;
 	int rc;
@@ -316,6 +322,14 @@ int nmt_create(int nmt_system, const char *country, const char *kanal, enum nmt_
 	osmo_timer_setup(&nmt->timer, nmt_timeout, nmt);
 	nmt->sysinfo.system = nmt_system;
 	nmt->sysinfo.chan_type = chan_type;
+	/* traffic channels are allocated from lists */
+	if (is_chan_class_tc(chan_type)) {
+		rc = chan_list_add((chan_type == CHAN_TYPE_CC_TC) ? &cc_tc_list : &tc_list, &nmt->sender, nmt->state == STATE_IDLE);
+		if (rc < 0)
+			goto error;
+	}
+	/* calling channels must be demodulated, even if no signal is received */
+	nmt->sender.rx_always_on = (chan_type != CHAN_TYPE_TC);
 	nmt->sysinfo.ms_power = ms_power;
 	nmt->sysinfo.traffic_area = traffic_area;
 	nmt->sysinfo.area_no = area_no;
@@ -326,7 +340,7 @@ int nmt_create(int nmt_system, const char *country, const char *kanal, enum nmt_
 	strncpy(nmt->smsc_number, smsc_number, sizeof(nmt->smsc_number) - 1);
 
 	/* init audio processing */
-	rc = dsp_init_sender(nmt, deviation_factor);
+	rc = dsp_init_sender(nmt, deviation_factor, super_hop);
 	if (rc < 0) {
 		LOGP(DNMT, LOGL_ERROR, "Failed to init audio processing!\n");
 		goto error;
@@ -435,6 +449,7 @@ void nmt_destroy(sender_t *sender)
 	dms_cleanup_sender(nmt);
 	sms_cleanup_sender(nmt);
 	osmo_timer_del(&nmt->timer);
+	chan_list_remove(&nmt->sender);
 	sender_destroy(&nmt->sender);
 	free(nmt);
 }
@@ -505,22 +520,18 @@ static void nmt_page(transaction_t *trans, int try)
 static nmt_t *search_free_tc(nmt_t *own)
 {
 	sender_t *sender;
-	nmt_t *nmt, *cc_tc = NULL;
 
-	for (sender = sender_head; sender; sender = sender->next) {
-		nmt = (nmt_t *) sender;
-		/* if our CC is used, we don't care about busy state,
-		 * because it can be used, if it is CC/TC type */
-		if (nmt != own && nmt->state != STATE_IDLE)
-			continue;
-		/* remember combined voice/control/paging channel as second alternative */
-		if (nmt->sysinfo.chan_type == CHAN_TYPE_CC_TC)
-			cc_tc = nmt;
-		else if (is_chan_class_tc(nmt->sysinfo.chan_type))
-			return nmt;
-	}
+	if ((sender = chan_alloc(&tc_list)))
+		return (nmt_t *) sender;
+	/* combined voice/control/paging channel is the second alternative */
+	if ((sender = chan_alloc(&cc_tc_list)))
+		return (nmt_t *) sender;
+	/* if our CC is used, we don't care about busy state,
+	 * because it can be used, if it is CC/TC type */
+	if (own && is_chan_class_tc(own->sysinfo.chan_type))
+		return own;
 
-	return cc_tc;
+	return NULL;
 }
 
 
@@ -1587,7 +1598,7 @@ static void tx_active(nmt_t *nmt, frame_t *frame)
  * general handlers to call sub handling
  */
 
-void nmt_receive_frame(nmt_t *nmt, const char *bits, double quality, double level, int frames_elapsed)
+void nmt_receive_frame(nmt_t *nmt, const uint8_t *bits, double quality, double level, int frames_elapsed)
 {
 	frame_t frame;
 	int rc;
@@ -1595,6 +1606,8 @@ void nmt_receive_frame(nmt_t *nmt, const char *bits, double quality, double leve
 	LOGP_CHAN(DDSP, LOGL_INFO, "RX Level: %.0f%% Quality=%.0f%%\n", level * 100.0, quality * 100.0);
 
 	rc = decode_frame(nmt->sysinfo.system, &frame, bits, (nmt->sender.loopback) ? MTX_TO_XX : XX_TO_MTX, (nmt->state == STATE_MT_PAGING));
+	sender_rx_frame(&nmt->sender, (rc < 0) ? -1 : 0);
+	frametrace_frame(&nmt->sender, FRAMETRACE_RX, bits, NMT_CODE_BITS, (rc < 0) ? -1 : 0, level);
 	if (rc < 0) {
 		LOGP_CHAN(DNMT, (nmt->sender.loopback) ? LOGL_NOTICE : LOGL_DEBUG, "Received invalid frame.\n");
 		return;
@@ -1704,10 +1717,10 @@ static void nmt_timeout(void *data)
 
 /* FSK processing requests next frame after transmission of previous
    frame has been finished. */
-const char *nmt_get_frame(nmt_t *nmt)
+const uint8_t *nmt_get_frame(nmt_t *nmt)
 {
 	frame_t frame;
-	const char *bits;
+	const uint8_t *bits;
 	int last_frame_idle, debug = 1;
 
 	memset(&frame, 0, sizeof(frame));
@@ -1786,6 +1799,8 @@ const char *nmt_get_frame(nmt_t *nmt)
 		return NULL;
 
 	bits = encode_frame(nmt->sysinfo.system, &frame, debug);
+	/* unlike received frames, this includes the sync */
+	frametrace_frame(&nmt->sender, FRAMETRACE_TX, bits, NMT_FRAME_BITS, 0, NAN);
 
 	if (debug)
 		LOGP_CHAN(DNMT, LOGL_DEBUG, "Sending frame %s.\n", nmt_frame_name(frame.mt));
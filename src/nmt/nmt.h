@@ -55,6 +55,12 @@ enum nmt_active_state {
 	ACTIVE_STATE_MFT_OUT,	/* ack MFT converter out */
 };
 
+/* bits of a frame are packed MSB first */
+#define NMT_FRAME_BITS		166	/* sync and code */
+#define NMT_FRAME_BYTES		21
+#define NMT_CODE_BITS		140	/* code only */
+#define NMT_CODE_BYTES		18
+
 enum nmt_direction {
 	MTX_TO_MS,
 	MTX_TO_BS,
@@ -74,6 +80,19 @@ typedef struct nmt_sysinfo {
 
 const char *nmt_dir_name(enum nmt_direction dir);
 
+/* waveform of a rendered idle frame */
+#define FRAME_CACHE_NUM	8
+struct frame_cache {
+	uint8_t			bits[NMT_FRAME_BYTES];	/* frame, including sync */
+	int			table_bit;		/* state of FSK waveform table at start */
+	int			table_phase;
+	int			next_table_bit;		/* state of FSK waveform table at end */
+	int			next_table_phase;
+	sample_t		*spl;			/* samples */
+	int			count;			/* number of samples, 0 if unused */
+	uint32_t		last_used;		/* to replace least recently used */
+};
+
 struct nmt {
 	sender_t		sender;
 	nmt_sysinfo_t		sysinfo;
@@ -108,10 +127,11 @@ struct nmt {
 	enum dsp_mode		dsp_mode;		/* current mode: audio, durable tone 0 or 1, paging */
 	fsk_mod_t		fsk_mod;		/* fsk processing */
 	fsk_demod_t		fsk_demod;
-	int			super_samples;		/* number of samples in buffer for supervisory detection */
-	goertzel_t		super_goertzel[5];	/* filter for supervisory decoding */
-	sample_t		*super_filter_spl;	/* array with sample buffer for supervisory detection */
-	int			super_filter_pos;	/* current sample position in filter_spl */
+	int			super_samples;		/* number of samples in window for supervisory detection */
+	tone_track_t		super_track;		/* sliding filter for supervisory tone and noise floor */
+	int			super_hop;		/* number of samples between two measurements */
+	int			super_hop_pos;		/* samples since last measurement */
+	int			super_print_count;	/* number of measurements between two prints */
 	double			super_phaseshift65536[4];/* how much the phase of sine wave changes per sample */
 	double			super_phase65536;	/* current phase */
 	int			super_print;		/* counts when to print result */
@@ -120,7 +140,7 @@ struct nmt {
 	uint16_t		rx_sync;		/* shift register to detect sync */
 	int			rx_in_sync;		/* if we are in sync and receive bits */
 	int			rx_mute;		/* mute count down after sync */
-	char			rx_frame[141];		/* receive frame (one extra byte to terminate string) */
+	uint8_t			rx_frame[NMT_CODE_BYTES]; /* receive frame, packed MSB first */
 	int			rx_count;		/* next bit to receive */
 	double			rx_level[256];		/* level infos */
 	double			rx_quality[256];	/* quality infos */
@@ -129,10 +149,16 @@ struct nmt {
 	uint64_t		rx_bits_count_last;	/* sample counter of last frame */
 	int			super_detected;		/* current detection state flag */
 	int			super_detect_count;	/* current number of consecutive detections/losses */
-	char			tx_frame[166];		/* carries bits of one frame to transmit */
+	uint8_t			tx_frame[NMT_FRAME_BYTES]; /* carries bits of one frame to transmit, packed MSB first */
 	int			tx_frame_length;
 	int			tx_frame_pos;
 	int			tx_last_frame_idle;	/* indicator to prevent debugging all idle frames */
+	struct frame_cache	frame_cache[FRAME_CACHE_NUM]; /* cache of idle frames */
+	uint32_t		frame_cache_use;	/* counter for least recently used entry */
+	sample_t		*tx_frame_buffer;	/* samples of a rendered frame, if not cached */
+	const sample_t		*tx_frame_spl;		/* samples of current frame */
+	int			tx_frame_spl_count;
+	int			tx_frame_spl_pos;
 
 	/* DMS/SMS states */
 	dms_t			dms;			/* DMS states */
@@ -145,12 +171,12 @@ void nmt_channel_list(int nmt_system);
 int nmt_channel_by_short_name(int nmt_system, const char *short_name);
 const char *chan_type_short_name(int nmt_system, enum nmt_chan_type chan_type);
 const char *chan_type_long_name(int nmt_system, enum nmt_chan_type chan_type);
-int nmt_create(int nmt_system, const char *country, const char *kanal, enum nmt_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint8_t ms_power, uint8_t traffic_area, uint8_t area_no, int compandor, int supervisory, const char *smsc_number, int send_callerid, int send_clock, int loopback);
+int nmt_create(int nmt_system, const char *country, const char *kanal, enum nmt_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint8_t ms_power, uint8_t traffic_area, uint8_t area_no, int compandor, int supervisory, int super_hop, const char *smsc_number, int send_callerid, int send_clock, int loopback);
 void nmt_check_channels(int nmt_system);
 void nmt_destroy(sender_t *sender);
 void nmt_go_idle(nmt_t *nmt);
-void nmt_receive_frame(nmt_t *nmt, const char *bits, double quality, double level, int frames_elapsed);
-const char *nmt_get_frame(nmt_t *nmt);
+void nmt_receive_frame(nmt_t *nmt, const uint8_t *bits, double quality, double level, int frames_elapsed);
+const uint8_t *nmt_get_frame(nmt_t *nmt);
 void nmt_rx_super(nmt_t *nmt, int tone, double quality);
 void timeout_mt_paging(struct transaction *trans);
 void deliver_sms(const char *sms);
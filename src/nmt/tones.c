@@ -2,20 +2,20 @@
 #include <stdint.h>
 #include "tones.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0, 5320, 10063, 13716, 15883, 16328, 15004, 12054, 7798, 2697, -2697, -7798, -12054, -15004, -16328, -15883, -13716, -10063, -5320,
 	//0, 2660, 5032, 6858, 7941, 8164, 7502, 6027, 3899, 1348, -1348, -3899, -6027, -7502, -8164, -7941, -6858, -5032, -2660,
 };
 
 static int16_t tone[7999];
 
-extern int16_t *ringback_spl;
+extern const int16_t *ringback_spl;
 extern int ringback_size;
 extern int ringback_max;
-extern int16_t *busy_spl;
+extern const int16_t *busy_spl;
 extern int busy_size;
 extern int busy_max;
-extern int16_t *congestion_spl;
+extern const int16_t *congestion_spl;
 extern int congestion_size;
 extern int congestion_max;
 
@@ -35,6 +35,10 @@
 
 #define MAX_DISPLAY	1.4	/* something above speech level, no emphasis */
 
+#define PREAMBLE_RUNS	32	/* runs of one bit duration that wake a slicer */
+#define PREAMBLE_BITS	576	/* a sleeping slicer is woken within the preamble */
+#define SYNC_TIMEOUT	(PREAMBLE_BITS + 64) /* bits without sync until slicer sleeps again */
+
 static void dsp_init_ramp(pocsag_t *pocsag)
 {
         double c;
@@ -54,19 +58,40 @@ static void dsp_init_ramp(pocsag_t *pocsag)
         }
 }
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init transceiver instance. */
-int dsp_init_sender(pocsag_t *pocsag, int samplerate, int baudrate, double deviation, double polarity)
+int dsp_init_sender(pocsag_t *pocsag, int samplerate, int baudrate, double deviation, double polarity, int rx_all_baud)
 {
-	int rc;
+	static const int all_baudrates[POCSAG_MAX_SLICERS] = { 512, 1200, 2400 };
+	pocsag_slicer_t *slicer;
+	int rc, i;
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for transceiver.\n");
 
+	/* protocol of this channel */
+	pocsag->sender.send = send_audio;
+	pocsag->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	// NOTE: baudrate equals modulation, because we have a raised cosine ramp of beta = 0.5
-	sender_set_fm(&pocsag->sender, deviation, baudrate, deviation, MAX_DISPLAY);
+	sender_set_fm(&pocsag->sender, deviation, (rx_all_baud) ? all_baudrates[POCSAG_MAX_SLICERS - 1] : baudrate, deviation, MAX_DISPLAY);
+
+	/* one slicer for each baud rate, the sliced signal is shared */
+	pocsag->fsk_rx_slicers = (rx_all_baud) ? POCSAG_MAX_SLICERS : 1;
+	for (i = 0; i < pocsag->fsk_rx_slicers; i++) {
+		slicer = &pocsag->fsk_rx_slicer[i];
+		slicer->baudrate = (rx_all_baud) ? all_baudrates[i] : baudrate;
+		slicer->bitduration = (double)samplerate / (double)slicer->baudrate;
+		slicer->bitstep = 1.0 / slicer->bitduration;
+		/* a single slicer is always awake */
+		slicer->awake = (pocsag->fsk_rx_slicers == 1);
+	}
+	if (rx_all_baud)
+		LOGP_CHAN(DDSP, LOGL_INFO, "Receiving at 512, 1200 and 2400 baud.\n");
 
 	pocsag->fsk_bitduration = (double)samplerate / (double)baudrate;
-	pocsag->fsk_bitstep = 1.0 / pocsag->fsk_bitduration;
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Use %.4f samples for one bit duration @ %d.\n", pocsag->fsk_bitduration, pocsag->sender.samplerate);
 
 	pocsag->fsk_tx_buffer_size = pocsag->fsk_bitduration * 32.0 + 10; /* 32 bit, add some extra to prevent short buffer due to rounding */
@@ -81,6 +106,11 @@ int dsp_init_sender(pocsag_t *pocsag, int samplerate, int baudrate, double devia
 	pocsag->fsk_deviation = 1.0; // equals what we st at sender_set_fm()
 	pocsag->fsk_polarity = polarity;
 	dsp_init_ramp(pocsag);
+	rc = fsk_burst_init(&pocsag->fsk_tx_burst, pocsag->fsk_bitduration, pocsag->fsk_ramp_up, pocsag->fsk_ramp_down, pocsag->fsk_deviation * pocsag->fsk_polarity);
+	if (rc < 0)
+		goto error;
+
+	sender_account_dsp(&pocsag->sender, sizeof(*pocsag) - sizeof(pocsag->sender) + sizeof(sample_t) * pocsag->fsk_tx_buffer_size);
 
 	return 0;
 
@@ -100,6 +130,7 @@ void dsp_cleanup_sender(pocsag_t *pocsag)
 		free(pocsag->fsk_tx_buffer);
 		pocsag->fsk_tx_buffer = NULL;
 	}
+	fsk_burst_cleanup(&pocsag->fsk_tx_burst);
 }
 
 
@@ -109,137 +140,127 @@ void dsp_cleanup_sender(pocsag_t *pocsag)
  * return number of samples */
 static int fsk_block_encode(pocsag_t *pocsag, uint32_t word)
 {
-	/* alloc samples, add 1 in case there is a rest */
-	sample_t *spl;
-	double phase, bitstep, devpol;
-	int i, count;
-	uint8_t lastbit;
-
-	devpol = pocsag->fsk_deviation * pocsag->fsk_polarity;
-	spl = pocsag->fsk_tx_buffer;
-	phase = pocsag->fsk_tx_phase;
-	lastbit = pocsag->fsk_tx_lastbit;
-	bitstep = pocsag->fsk_bitstep * 256.0;
-
-	/* add 32 bits */
-	for (i = 0; i < 32; i++) {
-		if (lastbit) {
-			if ((word & 0x80000000)) {
-				/* stay up */
-				do {
-					*spl++ = devpol;
-					phase += bitstep;
-				} while (phase < 256.0);
-				phase -= 256.0;
-			} else {
-				/* ramp down */
-				do {
-					*spl++ = pocsag->fsk_ramp_down[(uint8_t)phase];
-					phase += bitstep;
-				} while (phase < 256.0);
-				phase -= 256.0;
-				lastbit = 0;
-			}
-		} else {
-			if ((word & 0x80000000)) {
-				/* ramp up */
-				do {
-					*spl++ = pocsag->fsk_ramp_up[(uint8_t)phase];
-					phase += bitstep;
-				} while (phase < 256.0);
-				phase -= 256.0;
-				lastbit = 1;
-			} else {
-				/* stay down */
-				do {
-					*spl++ = -devpol;
-					phase += bitstep;
-				} while (phase < 256.0);
-				phase -= 256.0;
-			}
-		}
-		word <<= 1;
-	}
-
-	/* depending on the number of samples, return the number */
-	count = ((uintptr_t)spl - (uintptr_t)pocsag->fsk_tx_buffer) / sizeof(*spl);
-
-	pocsag->fsk_tx_phase = phase;
-	pocsag->fsk_tx_lastbit = lastbit;
-
-	return count;
+	return fsk_burst_encode(&pocsag->fsk_tx_burst, pocsag->fsk_tx_buffer, word, 32, 0);
 }
 
-static void fsk_block_decode(pocsag_t *pocsag, uint8_t bit)
+static void fsk_block_decode(pocsag_t *pocsag, pocsag_slicer_t *slicer, uint8_t bit)
 {
-	if (!pocsag->fsk_rx_sync) {
-		pocsag->fsk_rx_word = (pocsag->fsk_rx_word << 1) | bit;
-		if (pocsag->fsk_rx_word == CODEWORD_SYNC) {
-			put_codeword(pocsag, pocsag->fsk_rx_word, -1, -1);
-			pocsag->fsk_rx_sync = 16;
-			pocsag->fsk_rx_index = 0;
+	if (!slicer->sync) {
+		slicer->word = (slicer->word << 1) | bit;
+		if (slicer->word == CODEWORD_SYNC) {
+			if (pocsag->fsk_rx_slicers > 1 && pocsag->fsk_rx_baudrate != slicer->baudrate)
+				LOGP_CHAN(DDSP, LOGL_INFO, "Receiving at %d baud.\n", slicer->baudrate);
+			pocsag->fsk_rx_baudrate = slicer->baudrate;
+			put_codeword(pocsag, slicer->word, -1, -1);
+			slicer->sync = 16;
+			slicer->index = 0;
+			slicer->idle_bits = 0;
 		} else
-		if (pocsag->fsk_rx_word == (uint32_t)(~CODEWORD_SYNC))
+		if (slicer->word == (uint32_t)(~CODEWORD_SYNC))
 			LOGP_CHAN(DDSP, LOGL_NOTICE, "Received inverted sync, caused by wrong polarity or by radio noise. Verify correct polarity!\n");
+		else
+		if (pocsag->fsk_rx_slicers > 1 && ++slicer->idle_bits > SYNC_TIMEOUT) {
+			/* no sync after preamble or after last batch, wait for next preamble */
+			slicer->awake = 0;
+			slicer->preamble_runs = 0;
+		}
 	} else {
-		pocsag->fsk_rx_word = (pocsag->fsk_rx_word << 1) | bit;
-		if (++pocsag->fsk_rx_index == 32) {
-			pocsag->fsk_rx_index = 0;
-			put_codeword(pocsag, pocsag->fsk_rx_word, (16 - pocsag->fsk_rx_sync) >> 1, pocsag->fsk_rx_sync & 1);
-			--pocsag->fsk_rx_sync;
+		slicer->word = (slicer->word << 1) | bit;
+		if (++slicer->index == 32) {
+			slicer->index = 0;
+			slicer->batch[16 - slicer->sync] = slicer->word;
+			if (--slicer->sync == 0)
+				put_batch(pocsag, slicer->batch);
 		}
 	}
 }
 
+/* A run is a number of samples of equal level. Each run, except a run that
+ * continues from the previous chunk, starts with a transition. The bit clock
+ * is synchronized to the transition, then a bit is sampled at each bit
+ * duration while the level stays.
+ */
+static void slice_runs(pocsag_t *pocsag, pocsag_slicer_t *slicer, const uint8_t *run_bit, const int *run_length, int runs, int continues)
+{
+	double phase = slicer->phase;
+	int i, length;
+
+	for (i = 0; i < runs; i++) {
+		length = run_length[i];
+		if (!slicer->awake) {
+			/* cheap detection of preamble: consecutive runs of one bit duration */
+			if (i == 0 && continues)
+				continue;
+			if (length > slicer->bitduration * 0.75 && length < slicer->bitduration * 1.25) {
+				if (++slicer->preamble_runs < PREAMBLE_RUNS)
+					continue;
+				LOGP_CHAN(DDSP, LOGL_DEBUG, "Detected preamble at %d baud.\n", slicer->baudrate);
+				slicer->awake = 1;
+				slicer->idle_bits = 0;
+				slicer->sync = 0;
+			} else {
+				slicer->preamble_runs = 0;
+				continue;
+			}
+		}
+		if (i > 0 || !continues) {
+			/* transition */
+			phase = -0.5;
+			fsk_block_decode(pocsag, slicer, run_bit[i]);
+			length--;
+		}
+		/* stay */
+		phase += (double)length * slicer->bitstep;
+		while (phase >= 1.0) {
+			phase -= 1.0;
+			fsk_block_decode(pocsag, slicer, run_bit[i]);
+		}
+	}
+
+	slicer->phase = phase;
+}
+
+/* slice the signal once into runs, then feed all slicers */
 static void fsk_decode(pocsag_t *pocsag, sample_t *spl, int length)
 {
-	double phase, bitstep, polarity;
+	uint8_t run_bit[length], lastbit, bit;
+	int run_length[length];
+	int runs = 0, continues = 1;
+	double polarity;
 	int i;
-	uint8_t lastbit;
+
+	if (!length)
+		return;
 
 	polarity = pocsag->fsk_polarity;
-	phase = pocsag->fsk_rx_phase;
 	lastbit = pocsag->fsk_rx_lastbit;
-	bitstep = pocsag->fsk_bitstep;
 
+	run_bit[0] = lastbit;
+	run_length[0] = 0;
 	for (i = 0; i < length; i++) {
-		if (*spl++ * polarity > 0.0) {
-			if (lastbit) {
-				/* stay up */
-				phase += bitstep;
-				if (phase >= 1.0) {
-					phase -= 1.0;
-					fsk_block_decode(pocsag, 1);
-				}
-			} else {
-				/* ramp up */
-				phase = -0.5;
-				fsk_block_decode(pocsag, 1);
-				lastbit = 1;
-			}
-		} else {
-			if (lastbit) {
-				/* ramp down */
-				phase = -0.5;
-				fsk_block_decode(pocsag, 0);
-				lastbit = 0;
-			} else {
-				/* stay down */
-				phase += bitstep;
-				if (phase >= 1.0) {
-					phase -= 1.0;
-					fsk_block_decode(pocsag, 0);
-				}
-			}
+		bit = (spl[i] * polarity > 0.0);
+		if (bit != lastbit) {
+			/* only the first run can be empty, if the chunk starts with a transition */
+			if (run_length[runs])
+				runs++;
+			else
+				continues = 0;
+			run_bit[runs] = bit;
+			run_length[runs] = 0;
+			lastbit = bit;
 		}
+		run_length[runs]++;
 	}
+	runs++;
+
+	for (i = 0; i < pocsag->fsk_rx_slicers; i++)
+		slice_runs(pocsag, &pocsag->fsk_rx_slicer[i], run_bit, run_length, runs, continues);
 
-	pocsag->fsk_rx_phase = phase;
 	pocsag->fsk_rx_lastbit = lastbit;
 }
 
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	pocsag_t *pocsag = (pocsag_t *) sender;
 
@@ -248,7 +269,7 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	pocsag_t *pocsag = (pocsag_t *) sender;
 
@@ -1,4 +1,4 @@
 
-int dsp_init_sender(pocsag_t *pocsag, int samplerate, int baudrate, double deviation, double polarity);
+int dsp_init_sender(pocsag_t *pocsag, int samplerate, int baudrate, double deviation, double polarity, int rx_all_baud);
 void dsp_cleanup_sender(pocsag_t *pocsag);
 
@@ -22,9 +22,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
 #include "../libsample/sample.h"
 #include "../liblogging/logging.h"
 #include "pocsag.h"
+#include "../libmobile/frametrace.h"
 #include "frame.h"
 
 #define CHAN pocsag->sender.kanal
@@ -147,7 +149,23 @@ int scan_message(const char *message_input, int message_input_length, char *mess
 	return ii;
 }
 
-static uint32_t pocsag_crc(uint32_t word)
+/* remainder of 8 bit chunks at bit position 0, 8 and 16 of the 21 data bits */
+static uint16_t crc_table[3][256];
+/* error pattern of 1 or 2 bits in the 31 BCH bits for each syndrome, 0 if none */
+static uint32_t syndrome_error[1024];
+
+static uint32_t pocsag_parity(uint32_t word)
+{
+	word ^= word >> 16;
+	word ^= word >> 8;
+	word ^= word >> 4;
+	word ^= word >> 2;
+	word ^= word >> 1;
+
+	return word & 1;
+}
+
+static uint32_t pocsag_crc_serial(uint32_t word)
 {
 	uint32_t denominator = 0x76900000;
 	int i;
@@ -163,20 +181,71 @@ static uint32_t pocsag_crc(uint32_t word)
 	return word & 0x3ff;
 }
 
-static uint32_t pocsag_parity(uint32_t word)
+static uint32_t pocsag_crc(uint32_t word)
 {
-	word ^= word >> 16;
-	word ^= word >> 8;
-	word ^= word >> 4;
-	word ^= word >> 2;
-	word ^= word >> 1;
+	return crc_table[0][word & 0xff] ^ crc_table[1][(word >> 8) & 0xff] ^ crc_table[2][(word >> 16) & 0x1f];
+}
 
-	return word & 1;
+/* syndrome of the BCH part (bits 31..1) of a codeword, 0 if valid */
+static uint32_t pocsag_syndrome(uint32_t word)
+{
+	return pocsag_crc(word >> 11) ^ ((word >> 1) & 0x3ff);
+}
+
+
+int init_codeword(void)
+{
+	uint32_t error;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc_table[0][i] = pocsag_crc_serial(i);
+		crc_table[1][i] = pocsag_crc_serial(i << 8);
+		crc_table[2][i] = pocsag_crc_serial((i << 16) & 0x1fffff);
+	}
+
+	/* BCH(31,21) has a distance of 5, so all single and double errors have different syndromes */
+	memset(syndrome_error, 0, sizeof(syndrome_error));
+	for (i = 1; i < 32; i++) {
+		for (j = i; j < 32; j++) {
+			error = (1u << i) | (1u << j);
+			syndrome_error[pocsag_syndrome(error)] = error;
+		}
+	}
+
+	return 0;
+}
+
+/* correct up to 2 bit errors, including the parity bit
+ * return the number of corrected bits or -EINVAL, if the codeword cannot be corrected
+ */
+static int correct_codeword(uint32_t *word)
+{
+	uint32_t syndrome, error = 0, corrected;
+	int bits = 0;
+
+	syndrome = pocsag_syndrome(*word);
+	if (syndrome) {
+		error = syndrome_error[syndrome];
+		if (!error)
+			return -EINVAL;
+		bits = __builtin_popcount(error);
+	}
+	corrected = *word ^ error;
+	if (pocsag_parity(corrected)) {
+		corrected ^= 1;
+		bits++;
+	}
+	if (bits > 2)
+		return -EINVAL;
+
+	*word = corrected;
+	return bits;
 }
 
 static int debug_word(uint32_t word, int slot)
 {
-	if (pocsag_crc(word >> 11) != ((word >> 1) & 0x3ff)) {
+	if (pocsag_syndrome(word)) {
 		LOGP(DPOCSAG, LOGL_NOTICE, "CRC error in codeword 0x%08x.\n", word);
 		return -EINVAL;
 	}
@@ -187,19 +256,19 @@ static int debug_word(uint32_t word, int slot)
 	}
 
 	if (word == CODEWORD_SYNC) {
-		LOGP(DPOCSAG, LOGL_DEBUG, "-> valid sync word\n");
+		LOGP_HOT(DPOCSAG, LOGL_DEBUG, "-> valid sync word\n");
 		return 0;
 	}
 
 	if (word == CODEWORD_IDLE) {
-		LOGP(DPOCSAG, LOGL_DEBUG, "-> valid idle word\n");
+		LOGP_HOT(DPOCSAG, LOGL_DEBUG, "-> valid idle word\n");
 		return 0;
 	}
 
 	if (!(word & 0x80000000)) {
-		LOGP(DPOCSAG, LOGL_DEBUG, "-> valid address word: RIC = '%d', function = '%d' (%s)\n", ((word >> 10) & 0x1ffff8) + slot, (word >> 11) & 0x3, pocsag_function_name[(word >> 11) & 0x3]);
+		LOGP_HOT(DPOCSAG, LOGL_DEBUG, "-> valid address word: RIC = '%d', function = '%d' (%s)\n", ((word >> 10) & 0x1ffff8) + slot, (word >> 11) & 0x3, pocsag_function_name[(word >> 11) & 0x3]);
 	} else {
-		LOGP(DPOCSAG, LOGL_DEBUG, "-> valid message word: message = '0x%05x'\n", (word >> 11) & 0xfffff);
+		LOGP_HOT(DPOCSAG, LOGL_DEBUG, "-> valid message word: message = '0x%05x'\n", (word >> 11) & 0xfffff);
 	}
 
 	return 0;
@@ -359,6 +428,26 @@ static void decode_hex(pocsag_t *pocsag, uint32_t word)
 	}
 }
 
+/* encode address and all message codewords, so they are ready when the frame of the RIC is due */
+void encode_message(pocsag_msg_t *msg)
+{
+	msg->codeword_count = 0;
+	msg->codeword_index = 0;
+	msg->codeword[msg->codeword_count++] = encode_address(msg);
+
+	if (msg->function != POCSAG_FUNCTION_NUMERIC && msg->function != POCSAG_FUNCTION_ALPHA)
+		return;
+
+	msg->data_index = 0;
+	msg->bit_index = 0;
+	do {
+		if (msg->function == POCSAG_FUNCTION_NUMERIC)
+			msg->codeword[msg->codeword_count++] = encode_numeric(msg);
+		else
+			msg->codeword[msg->codeword_count++] = encode_alpha(msg);
+	} while (msg->data_index < msg->data_length && msg->codeword_count < POCSAG_MAX_CODEWORDS);
+}
+
 /* get codeword from scheduler */
 int64_t get_codeword(pocsag_t *pocsag)
 {
@@ -379,7 +468,7 @@ int64_t get_codeword(pocsag_t *pocsag)
 		if (!pocsag->word_count)
 			LOGP_CHAN(DPOCSAG, LOGL_INFO, "Sending preamble.\n");
 		/* transmit preamble */
-		LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of preamble pattern 0x%08x.\n", CODEWORD_PREAMBLE);
+		LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of preamble pattern 0x%08x.\n", CODEWORD_PREAMBLE);
 		if (++pocsag->word_count == PREAMBLE_COUNT) {
 			pocsag_new_state(pocsag, POCSAG_MESSAGE);
 			pocsag->word_count = 0; 
@@ -392,7 +481,7 @@ int64_t get_codeword(pocsag_t *pocsag)
 			LOGP_CHAN(DPOCSAG, LOGL_INFO, "Sending batch.\n");
 		/* send sync */
 		if (pocsag->word_count == 0) {
-			LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of sync pattern 0x%08x.\n", CODEWORD_SYNC);
+			LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of sync pattern 0x%08x.\n", CODEWORD_SYNC);
 			/* count codewords */
 			++pocsag->word_count;
 			word = CODEWORD_SYNC;
@@ -402,50 +491,37 @@ int64_t get_codeword(pocsag_t *pocsag)
 		if ((msg = pocsag->current_msg)) {
 			/* reset idle counter */
 			pocsag->idle_count = 0;
-			/* encode data */
-			switch (msg->function) {
-			case POCSAG_FUNCTION_NUMERIC:
-				word = encode_numeric(msg);
-				break;
-			case POCSAG_FUNCTION_ALPHA:
-				word = encode_alpha(msg);
-				break;
-			default:
-				word = CODEWORD_IDLE; /* should never happen */
-			}
-			/* if message is complete, reset index and remove message */
-			if (msg->data_index == msg->data_length) {
+			/* get encoded data */
+			word = msg->codeword[msg->codeword_index++];
+			/* if message is complete, remove message */
+			if (msg->codeword_index == msg->codeword_count) {
 				pocsag->current_msg = NULL;
-				msg->data_index = 0;
 				pocsag_msg_destroy(msg);
 				pocsag_msg_done(pocsag);
 			}
 			/* prevent 'use-after-free' from this point on */
 			msg = NULL;
-			LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of message codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
+			LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of message codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
 			/* count codewords */
 			if (++pocsag->word_count == 17)
 				pocsag->word_count = 0;
 			break;
 		}
-		/* if we are about to send an address codeword, we search for a pending message */
-		for (msg = pocsag->msg_list; msg; msg = msg->next) {
-			/* if a message matches the right time slot */
-			if ((msg->ric & 7) == slot)
-				break;
-		}
-		if (msg) {
+		/* if we are about to send an address codeword, we take the next message queued for this frame */
+		if ((msg = pocsag->frame_queue[slot])) {
 			LOGP_CHAN(DPOCSAG, LOGL_INFO, "Sending message to RIC '%d' / function '%d' (%s)\n", msg->ric, msg->function, pocsag_function_name[msg->function]);
 			/* reset idle counter */
 			pocsag->idle_count = 0;
-			/* encode address */
-			word = encode_address(msg);
+			/* remove from queue */
+			pocsag->frame_queue[slot] = msg->frame_next;
+			msg->frame_next = NULL;
+			/* get encoded address */
+			word = msg->codeword[0];
+			msg->codeword_index = 1;
 			/* link message, if there is data to be sent */
-			if (msg->function == POCSAG_FUNCTION_NUMERIC || msg->function == POCSAG_FUNCTION_ALPHA) {
+			if (msg->codeword_index < msg->codeword_count) {
 				LOGP_CHAN(DPOCSAG, LOGL_INFO, " -> Message text is \"%s\".\n", print_message(msg->data, msg->data_length));
 				pocsag->current_msg = msg;
-				msg->data_index = 0;
-				msg->bit_index = 0;
 			} else {
 				/* remove message */
 				pocsag_msg_destroy(msg);
@@ -453,21 +529,21 @@ int64_t get_codeword(pocsag_t *pocsag)
 				/* prevent 'use-after-free' from this point on */
 				msg = NULL;
 			}
-			LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of address codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
+			LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of address codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
 			/* count codewords */
 			if (++pocsag->word_count == 17)
 				pocsag->word_count = 0;
 			break;
 		}
 		/* no message, so we send idle pattern */
-		LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of idle pattern 0x%08x (frame %d.%d).\n", CODEWORD_IDLE, slot, subslot);
+		LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Sending 32 bits of idle pattern 0x%08x (frame %d.%d).\n", CODEWORD_IDLE, slot, subslot);
 		/* count codewords */
 		if (++pocsag->word_count == 17) {
 			pocsag->word_count = 0;
 			/* if no message has been scheduled during transmission and idle counter is reached, stop transmitter */
 			if (!pocsag->msg_list && pocsag->idle_count++ == IDLE_BATCHES) {
 				LOGP_CHAN(DPOCSAG, LOGL_INFO, "Transmission done.\n");
-				LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Reached %d of idle batches, turning transmitter off.\n", IDLE_BATCHES);
+				LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Reached %d of idle batches, turning transmitter off.\n", IDLE_BATCHES);
 				pocsag_new_state(pocsag, POCSAG_IDLE);
 			}
 		}
@@ -475,8 +551,10 @@ int64_t get_codeword(pocsag_t *pocsag)
 		break;
 	}
 
-	if (word != CODEWORD_PREAMBLE)
+	if (word != CODEWORD_PREAMBLE) {
 		debug_word(word, slot);
+		frametrace_word(&pocsag->sender, FRAMETRACE_TX, word, 32, 0, NAN);
+	}
 
 	return word;
 }
@@ -502,17 +580,17 @@ void put_codeword(pocsag_t *pocsag, uint32_t word, int8_t slot, int8_t subslot)
 	int rc;
 
 	if (slot < 0 && word == CODEWORD_SYNC) {
-		LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Received 32 bits of sync pattern 0x%08x.\n", CODEWORD_SYNC);
+		LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Received 32 bits of sync pattern 0x%08x.\n", CODEWORD_SYNC);
 		return;
 	}
 
 	if (word == CODEWORD_IDLE) {
-		LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Received 32 bits of idle pattern 0x%08x.\n", CODEWORD_IDLE);
+		LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Received 32 bits of idle pattern 0x%08x.\n", CODEWORD_IDLE);
 	} else
 	if (!(word & 0x80000000))
-		LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Received 32 bits of address codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
+		LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Received 32 bits of address codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
 	else
-		LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Received 32 bits of message codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
+		LOGP_CHAN_HOT(DPOCSAG, LOGL_DEBUG, "Received 32 bits of message codeword 0x%08x (frame %d.%d).\n", word, slot, subslot);
 	rc = debug_word(word, slot);
 	if (rc < 0) {
 		done_rx_msg(pocsag);
@@ -547,3 +625,18 @@ void put_codeword(pocsag_t *pocsag, uint32_t word, int8_t slot, int8_t subslot)
 	}
 }
 
+/* correct and process the 16 codewords of a batch */
+void put_batch(pocsag_t *pocsag, uint32_t *words)
+{
+	int i, rc;
+
+	for (i = 0; i < 16; i++) {
+		rc = correct_codeword(&words[i]);
+		sender_rx_frame(&pocsag->sender, rc);
+		frametrace_word(&pocsag->sender, FRAMETRACE_RX, words[i], 32, rc, NAN);
+		if (rc > 0)
+			LOGP_CHAN(DPOCSAG, LOGL_DEBUG, "Corrected %d bit error(s) in codeword %d of batch.\n", rc, i);
+		put_codeword(pocsag, words[i], i >> 1, i & 1);
+	}
+}
+
@@ -30,6 +30,7 @@
 #include "../liblogging/logging.h"
 #include "../libmobile/call.h"
 #include "../libmobile/main_mobile.h"
+#include "../libmobile/page_socket.h"
 #include "../liboptions/options.h"
 #include "../libfm/fm.h"
 #include "../anetz/besetztton.h"
@@ -54,6 +55,9 @@ static char padding = 4;
 static enum pocsag_language language = LANGUAGE_DEFAULT;
 static uint32_t scan_from = 0;
 static uint32_t scan_to = 0;
+static const char *page_socket = NULL;
+static int page_queue = 1000;
+static int rx_all_baud = 0;
 
 void print_help(const char *arg0)
 {
@@ -66,6 +70,9 @@ void print_help(const char *arg0)
 	printf("        If none of the options -T nor -R is given, only transmitter is enabled.\n");
 	printf(" -B --baud-rate 512 | 1200 | 2400\n");
 	printf("        Choose baud rate of transmitter.\n");
+	printf("    --rx-all-baud-rates\n");
+	printf("        Receive 512, 1200 and 2400 baud on the same channel. The signal is\n");
+	printf("        sliced once, a decoder for each baud rate wakes up on its preamble.\n");
 	printf(" -D --deviation wide | 4.5 | narrow | 2.5 | <other KHz>\n");
 	printf("        Choose deviation of FFSK signal (default %.0f KHz).\n", deviation / 1000.0);
 	printf(" -P --polarity -1 | nagative | 1 | positive\n");
@@ -90,6 +97,13 @@ void print_help(const char *arg0)
 	printf("        message (2 digits hexadecimal), if alphanumeric function was selected.\n");
 	printf("    --padding 4 | 0 | ...\n");
 	printf("        Text message padding uses 4 (EOT) by default. Old pagers want 0 (NUL).\n");
+	printf("    --page-socket <path>\n");
+	printf("        Receive pages in bulk on this UNIX socket. Write one page per line in\n");
+	printf("        the format of the file below and an empty line after each batch. Each\n");
+	printf("        batch is answered by \"<accepted> <rejected> <queue depth>\".\n");
+	printf("    --page-queue <max>\n");
+	printf("        Stop reading from page socket while this number of messages is queued.\n");
+	printf("        (default = %d)\n", page_queue);
 	printf("\n");
 	printf("File: %s\n", MSG_SEND);
 	printf("        Write \"<ric>,0,message\" to it to send a numerical message.\n");
@@ -109,6 +123,9 @@ void print_help(const char *arg0)
 }
 
 #define OPT_PADDING	256
+#define OPT_PAGE_SOCKET	257
+#define OPT_PAGE_QUEUE	258
+#define OPT_RX_ALL_BAUD	259
 
 static void add_options(void)
 {
@@ -123,6 +140,9 @@ static void add_options(void)
 	option_add('L', "language", 0);
 	option_add('S', "scan", 2);
 	option_add(OPT_PADDING, "padding", 1);
+	option_add(OPT_PAGE_SOCKET, "page-socket", 1);
+	option_add(OPT_PAGE_QUEUE, "page-queue", 1);
+	option_add(OPT_RX_ALL_BAUD, "rx-all-baud-rates", 0);
 }
 
 static int handle_options(int short_option, int argi, char **argv)
@@ -205,6 +225,19 @@ static int handle_options(int short_option, int argi, char **argv)
 	case OPT_PADDING:
 		padding = atoi(argv[argi++]);
 		break;
+	case OPT_PAGE_SOCKET:
+		page_socket = options_strdup(argv[argi]);
+		break;
+	case OPT_PAGE_QUEUE:
+		page_queue = atoi(argv[argi]);
+		if (page_queue < 1) {
+			fprintf(stderr, "Given page queue size must be 1 or more!\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_RX_ALL_BAUD:
+		rx_all_baud = 1;
+		break;
 	default:
 		return main_mobile_handle_options(short_option, argi, argv);
 	}
@@ -212,6 +245,13 @@ static int handle_options(int short_option, int argi, char **argv)
 	return 1;
 }
 
+static int page_received(const char *text)
+{
+	if (!tx)
+		return -EINVAL;
+	return pocsag_msg_send(language, text, strlen(text));
+}
+
 static void myhandler(void)
 {
 	static char buffer[256];
@@ -239,6 +279,8 @@ static void myhandler(void)
 				LOGP(DPOCSAG, LOGL_ERROR, "Failed to send message, transmitter is not enabled!\n");
 		}
 	}
+
+	page_socket_work();
 }
 
 int msg_receive(const char *text)
@@ -309,12 +351,12 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		goto fail;
@@ -359,7 +401,7 @@ int main(int argc, char *argv[])
 			printf("Invalid channel '%s', Use '-k list' to get a list of all channels.\n\n", kanal[i]);
 			goto fail;
 		}
-		rc = pocsag_create(kanal[i], frequency, dsp_device[i], use_sdr, dsp_samplerate, rx_gain, tx_gain, tx, rx, language, baudrate, deviation, polarity, function, message, padding, scan_from, scan_to, write_rx_wave, write_tx_wave, read_rx_wave, read_tx_wave, loopback);
+		rc = pocsag_create(kanal[i], frequency, dsp_device[i], use_sdr, dsp_samplerate, rx_gain, tx_gain, tx, rx, language, baudrate, deviation, polarity, function, message, padding, scan_from, scan_to, rx_all_baud, write_rx_wave, write_tx_wave, read_rx_wave, read_tx_wave, loopback);
 		if (rc < 0) {
 			fprintf(stderr, "Failed to create \"Sender\" instance. Quitting!\n");
 			goto fail;
@@ -367,9 +409,17 @@ int main(int argc, char *argv[])
 		printf("Base station ready, please tune transmitter (or receiver) to %.4f MHz\n", frequency / 1e6);
 	}
 
+	if (page_socket) {
+		rc = page_socket_open(page_socket, page_queue, page_received, pocsag_queue_depth);
+		if (rc < 0)
+			goto fail;
+	}
+
 	main_mobile_loop("pocsag", &quit, myhandler, station_id);
 
 fail:
+	page_socket_close();
+
 	/* pipe */
 	if (msg_send_fd > 0)
 		close(msg_send_fd);
@@ -162,7 +162,7 @@ const char *pocsag_number_valid(const char *number)
 
 int pocsag_init(void)
 {
-	return 0;
+	return init_codeword();
 }
 
 void pocsag_exit(void)
@@ -228,6 +228,7 @@ static pocsag_msg_t *pocsag_msg_create(pocsag_t *pocsag, uint32_t callref, uint3
 	memcpy(msg->data, message, message_length);
 	msg->data_length = message_length;
 	msg->padding = pocsag->padding;
+	encode_message(msg);
 
 	/* link */
 	msg->pocsag = pocsag;
@@ -235,6 +236,11 @@ static pocsag_msg_t *pocsag_msg_create(pocsag_t *pocsag, uint32_t callref, uint3
 	while ((*msgp))
 		msgp = &(*msgp)->next;
 	(*msgp) = msg;
+	pocsag->msg_count++;
+	msgp = &pocsag->frame_queue[ric & 7];
+	while ((*msgp))
+		msgp = &(*msgp)->frame_next;
+	(*msgp) = msg;
 
 	/* kick transmitter */
 	if (pocsag->state == POCSAG_IDLE) {
@@ -256,6 +262,14 @@ void pocsag_msg_destroy(pocsag_msg_t *msg)
 	while ((*msgp) != msg)
 		msgp = &(*msgp)->next;
 	(*msgp) = msg->next;
+	msg->pocsag->msg_count--;
+
+	/* unlink from frame queue, if not yet transmitted */
+	msgp = &msg->pocsag->frame_queue[msg->ric & 7];
+	while ((*msgp) && (*msgp) != msg)
+		msgp = &(*msgp)->frame_next;
+	if ((*msgp))
+		(*msgp) = msg->frame_next;
 
 	/* remove from current transmitting message */
 	if (msg == msg->pocsag->current_msg)
@@ -340,7 +354,7 @@ void pocsag_msg_receive(enum pocsag_language language, const char *channel, uint
 }
 
 /* Create transceiver instance and link to a list. */
-int pocsag_create(const char *kanal, double frequency, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int tx, int rx, enum pocsag_language language, int baudrate, double deviation, double polarity, enum pocsag_function function, const char *message, char padding, uint32_t scan_from, uint32_t scan_to, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback)
+int pocsag_create(const char *kanal, double frequency, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int tx, int rx, enum pocsag_language language, int baudrate, double deviation, double polarity, enum pocsag_function function, const char *message, char padding, uint32_t scan_from, uint32_t scan_to, int rx_all_baud, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback)
 {
 	pocsag_t *pocsag;
 	int rc;
@@ -361,7 +375,7 @@ int pocsag_create(const char *kanal, double frequency, const char *device, int u
 	}
 
 	/* init audio processing */
-	rc = dsp_init_sender(pocsag, samplerate, (double)baudrate, deviation, polarity);
+	rc = dsp_init_sender(pocsag, samplerate, baudrate, deviation, polarity, rx_all_baud);
 	if (rc < 0) {
 		LOGP(DPOCSAG, LOGL_ERROR, "Failed to init audio processing!\n");
 		goto error;
@@ -405,7 +419,8 @@ void pocsag_destroy(sender_t *sender)
 }
 
 /* application sends us a message, we need to deliver */
-void pocsag_msg_send(enum pocsag_language language, const char *text, size_t text_length)
+/* send message given as "RIC,function[,message]", return -EINVAL, if malformed */
+int pocsag_msg_send(enum pocsag_language language, const char *text, size_t text_length)
 {
 	char ric_string[text_length + 1];
 	char function_string[text_length + 1];
@@ -427,7 +442,7 @@ void pocsag_msg_send(enum pocsag_language language, const char *text, size_t tex
 	if (!text_length) {
 inval:
 		LOGP(DNMT, LOGL_NOTICE, "Given message MUST be in the following format: RIC,function[,<message with comma and spaces>] (function must be A = 0 = numeric, B = 1 or C = 2 = beep, D = 3 = alphanumeric)\n");
-		return;
+		return -EINVAL;
 	}
 	text++;
 	text_length--;
@@ -499,6 +514,20 @@ inval:
 
 	pocsag = (pocsag_t *) sender_head;
 	pocsag_msg_create(pocsag, 0, ric, function, message, message_length);
+
+	return 0;
+}
+
+/* number of messages waiting to be transmitted */
+int pocsag_queue_depth(void)
+{
+	sender_t *sender;
+	int depth = 0;
+
+	for (sender = sender_head; sender; sender = sender->next)
+		depth += ((pocsag_t *)sender)->msg_count;
+
+	return depth;
 }
 
 void call_down_clock(void)
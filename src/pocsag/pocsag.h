@@ -1,4 +1,5 @@
 #include "../libmobile/sender.h"
+#include "../libfsk/fsk.h"
 
 enum pocsag_function {
 	POCSAG_FUNCTION_NUMERIC = 0,
@@ -22,9 +23,13 @@ enum pocsag_language {
 
 struct pocsag;
 
+/* address codeword and message codewords of up to 256 alphanumeric characters */
+#define POCSAG_MAX_CODEWORDS	(1 + (256 * 7 + 19) / 20)
+
 /* instance of outgoing message */
 typedef struct pocsag_msg {
 	struct pocsag_msg	*next;
+	struct pocsag_msg	*frame_next;		/* next message in queue of same frame */
 	struct pocsag		*pocsag;
 	int			callref;		/* call reference */
 	uint32_t		ric;			/* current pager ID */
@@ -34,8 +39,28 @@ typedef struct pocsag_msg {
 	int			data_index;		/* current character transmitting */
 	int			bit_index;		/* current bit transmitting */
 	char			padding;		/* EOT or other padding */
+	uint32_t		codeword[POCSAG_MAX_CODEWORDS]; /* encoded when queued */
+	int			codeword_count;		/* number of encoded codewords */
+	int			codeword_index;		/* next codeword to transmit */
 } pocsag_msg_t;
 
+/* bit slicer for one baud rate, fed by the runs of the received signal */
+#define POCSAG_MAX_SLICERS	3
+
+typedef struct pocsag_slicer {
+	int			baudrate;
+	double			bitduration;		/* duration of a bit in samples */
+	double			bitstep;		/* fraction of a bit each sample */
+	int			awake;			/* decoding, preamble was detected */
+	int			preamble_runs;		/* counts runs of one bit duration while asleep */
+	int			idle_bits;		/* counts bits without sync while awake */
+	double			phase;			/* current sample position */
+	uint32_t		word;			/* shift register to receive codeword */
+	int			sync;			/* counts down to next sync */
+	int			index;			/* counts bits of received codeword */
+	uint32_t		batch[16];		/* codewords of current batch, corrected when complete */
+} pocsag_slicer_t;
+
 /* instance of pocsag transmitter/receiver */
 typedef struct pocsag {
 	sender_t		sender;
@@ -65,6 +90,8 @@ typedef struct pocsag {
 
 	/* calls */
 	pocsag_msg_t		*msg_list;		/* linked list of all calls */
+	int			msg_count;		/* number of messages in list */
+	pocsag_msg_t		*frame_queue[8];	/* messages waiting for each frame (RIC & 7) */
 
 	/* dsp states */
 	double			fsk_deviation;		/* deviation of FSK signal on sound card */
@@ -72,18 +99,15 @@ typedef struct pocsag {
 	sample_t		fsk_ramp_up[256];	/* samples of upward ramp shape */
 	sample_t		fsk_ramp_down[256];	/* samples of downward ramp shape */
 	double			fsk_bitduration;	/* duration of a bit in samples */
-	double			fsk_bitstep;		/* fraction of a bit each sample */
 	sample_t		*fsk_tx_buffer;		/* tx buffer for one data block */
 	int			fsk_tx_buffer_size;	/* size of tx buffer (in samples) */
 	int			fsk_tx_buffer_length;	/* usage of buffer (in samples) */
 	int			fsk_tx_buffer_pos;	/* current position sending buffer */
-	double			fsk_tx_phase;		/* current bit position */
-	uint8_t			fsk_tx_lastbit;		/* last bit of last message, to correctly ramp */
-	double			fsk_rx_phase;		/* current sample position */
+	fsk_burst_t		fsk_tx_burst;		/* waveforms and current bit position */
 	uint8_t			fsk_rx_lastbit;		/* last bit of last message, to detect level */
-	uint32_t		fsk_rx_word;		/* shift register to receive codeword */
-	int			fsk_rx_sync;		/* counts down to next sync */
-	int			fsk_rx_index;		/* counts bits of received codeword */
+	pocsag_slicer_t		fsk_rx_slicer[POCSAG_MAX_SLICERS]; /* one for each baud rate to receive */
+	int			fsk_rx_slicers;		/* number of slicers, sleep until preamble, if more than one */
+	int			fsk_rx_baudrate;	/* baud rate of last received sync */
 } pocsag_t;
 
 int msg_receive(const char *text);
@@ -99,9 +123,10 @@ int pocsag_init(void);
 void pocsag_exit(void);
 void pocsag_new_state(pocsag_t *pocsag, enum pocsag_state new_state);
 void pocsag_msg_receive(enum pocsag_language language, const char *channel, uint32_t ric, enum pocsag_function function, const char *message);
-int pocsag_create(const char *kanal, double frequency, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int tx, int rx, enum pocsag_language language, int baudrate, double deviation, double polarity, enum pocsag_function function, const char *message, char padding, uint32_t scan_from, uint32_t scan_to, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback);
+int pocsag_create(const char *kanal, double frequency, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int tx, int rx, enum pocsag_language language, int baudrate, double deviation, double polarity, enum pocsag_function function, const char *message, char padding, uint32_t scan_from, uint32_t scan_to, int rx_all_baud, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, int loopback);
 void pocsag_destroy(sender_t *sender);
-void pocsag_msg_send(enum pocsag_language language, const char *text, size_t text_length);
+int pocsag_msg_send(enum pocsag_language language, const char *text, size_t text_length);
+int pocsag_queue_depth(void);
 void pocsag_msg_destroy(pocsag_msg_t *msg);
 void pocsag_get_id(pocsag_t *euro, char *id);
 void pocsag_receive_id(pocsag_t *euro, char *id);
@@ -59,6 +59,7 @@
 #define SUPER_F0		136.0
 #define SUPER_F1		164.0
 #define SUPER_CUTOFF_H		400.0	/* filter to remove spectrum of supervisory signal */
+#define SUPER_MIN_RATE		2000	/* lowest sample rate of decimated supervisory demodulator */
 #define MAX_DISPLAY		1.4	/* something above speech level */
 
 /* global init for FSK */
@@ -72,14 +73,21 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level);
 static int super_send_bit(void *inst);
 static void super_receive_bit(void *inst, int bit, double quality, double level);
 
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length);
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double rf_level_db);
+
 /* Init FSK of transceiver */
-int dsp_init_sender(r2000_t *r2000)
+int dsp_init_sender(r2000_t *r2000, int super_decimation)
 {
 	/* attack (3ms) and recovery time (13.5ms) according to NMT specs */
 	setup_compandor(&r2000->cstate, 8000, 3.0, 13.5);
 
 	LOGP_CHAN(DDSP, LOGL_DEBUG, "Init DSP for Transceiver.\n");
 
+	/* protocol of this channel */
+	r2000->sender.send = send_audio;
+	r2000->sender.receive = receive_audio;
+
 	/* set modulation parameters */
 	sender_set_fm(&r2000->sender, MAX_DEVIATION, MAX_MODULATION, SPEECH_DEVIATION, MAX_DISPLAY);
 
@@ -104,10 +112,21 @@ int dsp_init_sender(r2000_t *r2000)
 		LOGP_CHAN(DDSP, LOGL_ERROR, "FSK init failed!\n");
 		return -EINVAL;
 	}
-	if (fsk_demod_init(&r2000->super_fsk_demod, r2000, super_receive_bit, r2000->sender.samplerate, SUPER_BIT_RATE, SUPER_F0, SUPER_F1, SUPER_BIT_ADJUST) < 0) {
+	if (super_decimation < 1
+	 || r2000->sender.samplerate % super_decimation
+	 || r2000->sender.samplerate / super_decimation < SUPER_MIN_RATE) {
+		LOGP_CHAN(DDSP, LOGL_ERROR, "Supervisory decimation %d must divide sample rate %d into a rate of %d Hz or above!\n", super_decimation, r2000->sender.samplerate, SUPER_MIN_RATE);
+		return -EINVAL;
+	}
+	r2000->super_decimation = super_decimation;
+	if (fsk_demod_init(&r2000->super_fsk_demod, r2000, super_receive_bit, r2000->sender.samplerate / super_decimation, SUPER_BIT_RATE, SUPER_F0, SUPER_F1, SUPER_BIT_ADJUST) < 0) {
 		LOGP_CHAN(DDSP, LOGL_ERROR, "FSK init failed!\n");
 		return -EINVAL;
 	}
+	if (super_decimation > 1) {
+		LOGP_CHAN(DDSP, LOGL_DEBUG, "Supervisory demodulator runs at %d Hz.\n", r2000->sender.samplerate / super_decimation);
+		iir_lowpass_init(&r2000->super_rx_lp, SUPER_CUTOFF_H, r2000->sender.samplerate, 4);
+	}
 
 	/* remove frequencies of supervisory spectrum:
 	 * TX = remove low frequencies from speech to be transmitted
@@ -123,6 +142,8 @@ int dsp_init_sender(r2000_t *r2000)
 		r2000->dmp_super_quality = display_measurements_add(&r2000->sender.dispmeas, "Super Quality", "%.1f %%", DISPLAY_MEAS_AVG, DISPLAY_MEAS_LEFT, 0.0, 100.0, 100.0);
 	}
 
+	sender_account_dsp(&r2000->sender, sizeof(*r2000) - sizeof(r2000->sender));
+
 	return 0;
 }
 
@@ -154,8 +175,8 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 		r2000->rx_sync = (r2000->rx_sync << 1) | bit;
 
 		/* level and quality */
-		r2000->rx_level[r2000->rx_count & 0xff] = level;
-		r2000->rx_quality[r2000->rx_count & 0xff] = quality;
+		r2000->rx_level[r2000->rx_count & 0xf] = level;
+		r2000->rx_quality[r2000->rx_count & 0xf] = quality;
 		r2000->rx_count++;
 
 		/* check if pattern 1010111100010010 matches */
@@ -165,8 +186,8 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 		/* average level and quality */
 		level = quality = 0;
 		for (i = 0; i < 16; i++) {
-			level += r2000->rx_level[(r2000->rx_count - 1 - i) & 0xff];
-			quality += r2000->rx_quality[(r2000->rx_count - 1 - i) & 0xff];
+			level += r2000->rx_level[i];
+			quality += r2000->rx_quality[i];
 		}
 		level /= 16.0; quality /= 16.0;
 //		printf("sync (level = %.2f, quality = %.2f\n", level, quality);
@@ -183,35 +204,33 @@ static void fsk_receive_bit(void *inst, int bit, double quality, double level)
 		r2000->rx_sync = 0;
 		r2000->rx_in_sync = 1;
 		r2000->rx_count = 0;
+		memset(r2000->rx_frame, 0, sizeof(r2000->rx_frame));
+		r2000->rx_level_sum = r2000->rx_quality_sum = 0;
 
 		return;
 	}
 
 	/* read bits */
-	r2000->rx_frame[r2000->rx_count] = bit + '0';
-	r2000->rx_level[r2000->rx_count] = level;
-	r2000->rx_quality[r2000->rx_count] = quality;
+	if (bit)
+		r2000->rx_frame[r2000->rx_count >> 3] |= 0x80 >> (r2000->rx_count & 7);
+	r2000->rx_level_sum += level;
+	r2000->rx_quality_sum += quality;
 	if (++r2000->rx_count != r2000->rx_max)
 		return;
 
 	/* end of frame */
-	r2000->rx_frame[r2000->rx_max] = '\0';
 	r2000->rx_in_sync = 0;
 
 	/* average level and quality */
-	level = quality = 0;
-	for (i = 0; i < r2000->rx_max; i++) {
-		level += r2000->rx_level[i];
-		quality += r2000->rx_quality[i];
-	}
-	level /= (double)r2000->rx_max; quality /= (double)r2000->rx_max;
+	level = r2000->rx_level_sum / (double)r2000->rx_max;
+	quality = r2000->rx_quality_sum / (double)r2000->rx_max;
 
 	/* update measurements */
 	display_measurements_update(r2000->dmp_frame_level, level * 100.0, 0.0);
 	display_measurements_update(r2000->dmp_frame_quality, quality * 100.0, 0.0);
 
 	/* send frame to upper layer */
-	r2000_receive_frame(r2000, r2000->rx_frame, quality, level);
+	r2000_receive_frame(r2000, r2000->rx_frame, r2000->rx_max, quality, level);
 }
 
 static void super_receive_bit(void *inst, int bit, double quality, double level)
@@ -249,8 +268,23 @@ static void super_receive_bit(void *inst, int bit, double quality, double level)
 	r2000_receive_super(r2000, (r2000->super_rx_word >> 1) & 0x7f, quality, level);
 }
 
+/* filter and decimate samples before demodulating supervisory signal */
+static void super_receive_decimated(r2000_t *r2000, sample_t *samples, int length)
+{
+	sample_t spl[length];
+	int i, count = 0;
+
+	memcpy(spl, samples, sizeof(*spl) * length);
+	iir_process(&r2000->super_rx_lp, spl, length);
+	for (i = r2000->super_decimation_pos; i < length; i += r2000->super_decimation)
+		spl[count++] = spl[i];
+	r2000->super_decimation_pos = i - length;
+
+	fsk_demod_receive(&r2000->super_fsk_demod, spl, count);
+}
+
 /* Process received audio stream from radio unit. */
-void sender_receive(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
+static void receive_audio(sender_t *sender, sample_t *samples, int length, double __attribute__((unused)) rf_level_db)
 {
 	r2000_t *r2000 = (r2000_t *) sender;
 	sample_t *spl;
@@ -264,8 +298,12 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 	/* supervisory signal */
 	if (r2000->dsp_mode == DSP_MODE_AUDIO_TX
 	 || r2000->dsp_mode == DSP_MODE_AUDIO_TX_RX
-	 || r2000->sender.loopback)
-		fsk_demod_receive(&r2000->super_fsk_demod, samples, length);
+	 || r2000->sender.loopback) {
+		if (r2000->super_decimation > 1)
+			super_receive_decimated(r2000, samples, length);
+		else
+			fsk_demod_receive(&r2000->super_fsk_demod, samples, length);
+	}
 
 	/* do de-emphasis */
 	if (r2000->de_emphasis)
@@ -303,7 +341,8 @@ void sender_receive(sender_t *sender, sample_t *samples, int length, double __at
 static int fsk_send_bit(void *inst)
 {
 	r2000_t *r2000 = (r2000_t *)inst;
-	const char *frame;
+	const uint8_t *frame;
+	int pos;
 
 	if (!r2000->tx_frame_length || r2000->tx_frame_pos == r2000->tx_frame_length) {
 		frame = r2000_get_frame(r2000);
@@ -312,12 +351,13 @@ static int fsk_send_bit(void *inst)
 			LOGP_CHAN(DDSP, LOGL_DEBUG, "Stop sending frames.\n");
 			return -1;
 		}
-		memcpy(r2000->tx_frame, frame, 208);
+		memcpy(r2000->tx_frame, frame, sizeof(r2000->tx_frame));
 		r2000->tx_frame_length = 208;
 		r2000->tx_frame_pos = 0;
 	}
 
-	return r2000->tx_frame[r2000->tx_frame_pos++];
+	pos = r2000->tx_frame_pos++;
+	return (r2000->tx_frame[pos >> 3] >> (7 - (pos & 7))) & 1;
 }
 
 static int super_send_bit(void *inst)
@@ -333,7 +373,7 @@ static int super_send_bit(void *inst)
 }
 
 /* Provide stream of audio toward radio unit */
-void sender_send(sender_t *sender, sample_t *samples, uint8_t *power, int length)
+static void send_audio(sender_t *sender, sample_t *samples, uint8_t *power, int length)
 {
 	r2000_t *r2000 = (r2000_t *) sender;
 	int count, input_num;
@@ -447,7 +487,7 @@ void call_down_audio(void *decoder, void *decoder_priv, int callref, uint16_t se
 	if (r2000->dsp_mode == DSP_MODE_AUDIO_TX
 	 || r2000->dsp_mode == DSP_MODE_AUDIO_TX_RX) {
 		jitter_frame_t *jf;
-		jf = jitter_frame_alloc(decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
+		jf = jitter_frame_alloc(&r2000->sender.dejitter, decoder, decoder_priv, payload, payload_len, marker, sequence, timestamp, ssrc);
 		if (jf)
 			jitter_save(&r2000->sender.dejitter, jf);
 	}
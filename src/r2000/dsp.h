@@ -1,6 +1,6 @@
 
 void dsp_init(void);
-int dsp_init_sender(r2000_t *r2000);
+int dsp_init_sender(r2000_t *r2000, int super_decimation);
 void dsp_cleanup_sender(r2000_t *r2000);
 void r2000_set_dsp_mode(r2000_t *r2000, enum dsp_mode mode, int super);
 
@@ -375,16 +375,82 @@ static struct r2000_frame {
 	{ 0, 0, NULL, NULL }
 };
 
-static const char *get_frame_def(uint8_t message, int dir)
+#define FRAME_DEF_NUM	(sizeof(r2000_frame_def) / sizeof(r2000_frame_def[0]))
+
+/* elements of each frame definition, created by init_frame() */
+static struct r2000_field {
+	char	element;
+	uint8_t	pos;		/* position of first bit in message */
+	uint8_t	bits;
+} r2000_field[FRAME_DEF_NUM][24];
+static int r2000_field_num[FRAME_DEF_NUM];
+
+int init_frame(void)
+{
+	struct r2000_field *field;
+	const char *def;
+	int i, j;
+
+	for (i = 0; r2000_frame_def[i].def; i++) {
+		def = r2000_frame_def[i].def;
+		/* each run of equal characters is one element */
+		r2000_field_num[i] = 0;
+		for (j = 0; def[j]; j++) {
+			if (def[j] == '-' || (j && def[j] == def[j - 1]))
+				continue;
+			if (r2000_field_num[i] == (int)(sizeof(r2000_field[i]) / sizeof(r2000_field[i][0]))) {
+				LOGP(DFRAME, LOGL_ERROR, "Too many elements in frame definition #%d, please fix!\n", i);
+				return -EINVAL;
+			}
+			field = &r2000_field[i][r2000_field_num[i]++];
+			field->element = def[j];
+			field->pos = j;
+			field->bits = 0;
+			while (def[j + field->bits] == def[j])
+				field->bits++;
+		}
+	}
+
+	return 0;
+}
+
+/* get index of frame definition or -1 */
+static int get_frame_index(uint8_t message, int dir)
 {
 	int i;
 
 	for (i = 0; r2000_frame_def[i].def; i++) {
 		if (r2000_frame_def[i].message == message && r2000_frame_def[i].dir == dir)
-			return r2000_frame_def[i].def;
+			return i;
 	}
 
-	return NULL;
+	return -1;
+}
+
+/* get bits of a message that is packed MSB first */
+static uint64_t get_bits(const uint8_t *message, int pos, int bits)
+{
+	int end = pos + bits - 1;
+	uint64_t value = 0;
+	int i;
+
+	for (i = pos >> 3; i <= end >> 3; i++)
+		value = (value << 8) | message[i];
+
+	return (value >> (7 - (end & 7))) & (~(uint64_t)0 >> (64 - bits));
+}
+
+/* add bits to a message that is packed MSB first */
+static void put_bits(uint8_t *message, int pos, int bits, uint64_t value)
+{
+	int end = pos + bits - 1;
+	int i;
+
+	value = (value & (~(uint64_t)0 >> (64 - bits))) << (7 - (end & 7));
+	for (i = end >> 3; i >= pos >> 3; i--) {
+		message[i] |= value;
+		value >>= 8;
+	}
 }
 
 static const char *r2000_dir_name(int dir)
@@ -428,51 +494,46 @@ static void display_bits(const char *def, const uint8_t *message, int num, int d
 
 static int dissassemble_frame(frame_t *frame, const uint8_t *message, int num)
 {
-	int i;
-	const char *def;
+	struct r2000_field *field;
+	int i, index;
 	uint64_t value;
 	int dir = (num == 80) ? REL_TO_SM : SM_TO_REL;
 
 	memset(frame, 0, sizeof(*frame));
 
 	frame->message = message[2] & 0x1f;
-	def = get_frame_def(frame->message, dir);
-	if (!def) {
+	index = get_frame_index(frame->message, dir);
+	if (index < 0) {
 		LOGP(DFRAME, LOGL_NOTICE, "Received unknown message type %d (maybe radio noise)\n", frame->message);
 		display_bits(NULL, message, num, LOGL_NOTICE);
 		return -EINVAL;
 	}
 
-	LOGP(DFRAME, LOGL_DEBUG, "Decoding frame %s %s\n", r2000_dir_name(dir), r2000_frame_name(frame->message, dir));
+	LOGP_HOT(DFRAME, LOGL_DEBUG, "Decoding frame %s %s\n", r2000_dir_name(dir), r2000_frame_name(frame->message, dir));
 
 	/* disassemble elements elements */
-	value = 0;
-	for (i = 0; i < num; i++) {
-		value = (value << 1) | ((message[i / 8] >> (7 - (i & 7))) & 1);
-		if (def[i + 1] != def[i]) {
-			if (def[i] != '-') {
-				print_element(def[i], value, dir, LOGL_DEBUG);
-				store_element(frame, def[i], value);
-			}
-			value = 0;
-		}
+	for (i = 0; i < r2000_field_num[index]; i++) {
+		field = &r2000_field[index][i];
+		value = get_bits(message, field->pos, field->bits);
+		if (loglevel <= LOGL_DEBUG)
+			print_element(field->element, value, dir, LOGL_DEBUG);
+		store_element(frame, field->element, value);
 	}
 
-	display_bits(def, message, num, LOGL_DEBUG);
+	display_bits(r2000_frame_def[index].def, message, num, LOGL_DEBUG);
 
 	return 0;
 }
 
 static int assemble_frame(frame_t *frame, uint8_t *message, int num, int debug)
 {
-	int i;
-	const char *def;
-	uint64_t value = 0; // make GCC happy
-	char element;
+	struct r2000_field *field;
+	int i, index;
+	uint64_t value;
 	int dir = (num == 80) ? REL_TO_SM : SM_TO_REL;
 
-	def = get_frame_def(frame->message, dir);
-	if (!def) {
+	index = get_frame_index(frame->message, dir);
+	if (index < 0) {
 		LOGP(DFRAME, LOGL_ERROR, "Cannot assemble unknown message type %d, please define/fix!\n", frame->message);
 		abort();
 	}
@@ -482,74 +543,62 @@ static int assemble_frame(frame_t *frame, uint8_t *message, int num, int debug)
 		LOGP(DFRAME, LOGL_DEBUG, "Ccoding frame %s %s\n", r2000_dir_name(dir), r2000_frame_name(frame->message, dir));
 
 	/* assemble elements elements */
-	element = 0;
-	for (i = num - 1; i >= 0; i--) {
-		if (element != def[i]) {
-			element = def[i];
-			switch (def[i]) {
-			case '-':
-				value = 0;
-				break;
-			case '+':
-				value = 0xffffffffffffffff;
-				break;
-			default:
-				value = fetch_element(frame, element);
-			}
-		}
-		message[i / 8] |= (value & 1) << (7 - (i & 7));
-		value >>= 1;
+	for (i = 0; i < r2000_field_num[index]; i++) {
+		field = &r2000_field[index][i];
+		if (field->element == '+')
+			value = 0xffffffffffffffff;
+		else
+			value = fetch_element(frame, field->element);
+		put_bits(message, field->pos, field->bits, value);
 	}
 
 	if (debug) {
-		for (i = 0; i < num; i++) {
-			if (def[i + 1] != def[i] && def[i] != '-' && def[i] != '+') {
-				value = fetch_element(frame, def[i]);
-					print_element(def[i], value, dir, LOGL_DEBUG);
-			}
+		for (i = 0; i < r2000_field_num[index]; i++) {
+			field = &r2000_field[index][i];
+			if (field->element != '+')
+				print_element(field->element, fetch_element(frame, field->element), dir, LOGL_DEBUG);
 		}
 
-		display_bits(def, message, num, LOGL_DEBUG);
+		display_bits(r2000_frame_def[index].def, message, num, LOGL_DEBUG);
 	}
 
 	return 0;
 }
 
-/* encode frame to bits
+/* encode frame to 208 bits of sync and code, packed MSB first
  */
-const char *encode_frame(frame_t *frame, int debug)
+const uint8_t *encode_frame(frame_t *frame, int debug)
 {
-	uint8_t message[11], code[23];
-	static char bits[32 + 176 + 1];
-	int i;
+	uint8_t message[11];
+	static uint8_t bits[(32 + 176) / 8] = { 0xaa, 0xaa, 0xaf, 0x12 };
 
 	assemble_frame(frame, message, 80, debug);
 
 	/* hagelbarger code */
-	hagelbarger_encode(message, code, 88);
-	memcpy(bits, "10101010101010101010111100010010", 32);
-	for (i = 0; i < 176; i++)
-		bits[i + 32] = ((code[i / 8] >> (7 - (i & 7))) & 1) + '0';
-	bits[208] = '\0';
+	hagelbarger_encode(message, bits + 4, 88);
 
 	return bits;
 }
 
 //#define GEGENPROBE
 
-/* decode bits to frame */
-int decode_frame(frame_t *frame, const char *bits)
+/* decode given number of code bits, packed MSB first, to frame */
+int decode_frame(frame_t *frame, const uint8_t *bits, int num)
 {
 	uint8_t message[11], code[23];
-	int i, num = strlen(bits);
-
 #ifdef GEGENPROBE
-	printf("bits as received=%s\n", bits);
+	int i;
 #endif
+
 	/* hagelbarger code */
 	memset(code, 0x00, sizeof(code));
+	memcpy(code, bits, (num + 7) / 8);
+#ifdef GEGENPROBE
+	printf("bits as received=");
 	for (i = 0; i < num; i++)
-		code[i / 8] |= (bits[i] & 1) << (7 - (i & 7));
+		printf("%d", (code[i / 8] >> (7 - (i & 7))) & 1);
+	printf("\n");
+#endif
 	hagelbarger_decode(code, message, num / 2 - 6);
 
 #if 0
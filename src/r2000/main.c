@@ -47,7 +47,8 @@ static int taxe = 0;
 static int crins = 0, destruction = 0; /* neven set CRINS to 3 and destruction to other than 0 here! */
 static int nconv = 0;
 static int recall = 0;
-enum r2000_chan_type chan_type[MAX_SENDER] = { CHAN_TYPE_CC_TC };
+static int super_decimation = 1;
+enum r2000_chan_type *chan_type = NULL;
 
 void print_help(const char *arg0)
 {
@@ -57,7 +58,7 @@ void print_help(const char *arg0)
 	printf(" -B --bande <number> | list\n");
 	printf("        Give frequency band, use 'list' to get a list. (default = '%d')\n", band);
 	printf(" -T --channel-type <channel type> | list\n");
-	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(chan_type[0]));
+	printf("        Give channel type, use 'list' to get a list. (default = '%s')\n", chan_type_short_name(CHAN_TYPE_CC_TC));
 	printf(" -R --relais <relais number>\n");
 	printf("        Give relais number (base station ID) 1..511. (default = '%d')\n", relais);
 	printf("        Be sure to set the station mobile to the same relais number!\n");
@@ -92,6 +93,10 @@ void print_help(const char *arg0)
 	printf(" -S --recall\n");
 	printf("        Suspend outgoing call after dialing and recall when called party has\n");
 	printf("        answered.\n");
+	printf(" --super-decimation <factor>\n");
+	printf("        Decimate received signal by this factor before demodulating the\n");
+	printf("        supervisory signal. It must divide the sample rate and leave at least\n");
+	printf("        2000 Hz. (default = '%d' = no decimation)\n", super_decimation);
 	printf("\nstation-id: Give 1 digit of station mobile type + 3 digits of home relais ID\n");
 	printf("        + 5 digits of mobile ID.\n");
 	printf("        (e.g. 103200819 = type 1, relais ID 32, mobile ID 819)\n");
@@ -102,6 +107,7 @@ void print_help(const char *arg0)
 #define OPT_DEPORT	257
 #define OPT_TAXE	258
 #define OPT_DESTRUCTION	259
+#define OPT_SUPER_DECIMATION 260
 
 static void add_options(void)
 {
@@ -118,6 +124,7 @@ static void add_options(void)
 	option_add(OPT_DESTRUCTION, "destruction", 1);
 	option_add('N', "nconv", 1);
 	option_add('S', "recall", 0);
+	option_add(OPT_SUPER_DECIMATION, "super-decimation", 1);
 }
 
 static int handle_options(int short_option, int argi, char **argv)
@@ -241,6 +248,13 @@ static int handle_options(int short_option, int argi, char **argv)
 	case 'S':
 		recall = 1;
 		break;
+	case OPT_SUPER_DECIMATION:
+		super_decimation = atoi(argv[argi]);
+		if (super_decimation < 1) {
+			fprintf(stderr, "Given supervisory decimation must be 1 or more!\n");
+			return -EINVAL;
+		}
+		break;
 	default:
 		return main_mobile_handle_options(short_option, argi, argv);
 	}
@@ -289,26 +303,25 @@ int main(int argc, char *argv[])
 	}
 	if (use_sdr) {
 		/* set device */
+		num_device = 0;
 		for (i = 0; i < num_kanal; i++)
-			dsp_device[i] = "sdr";
-		num_device = num_kanal;
+			OPT_ARRAY(num_device, dsp_device, "sdr")
 		/* set channel types for more than 1 channel */
 		if (num_kanal > 1 && num_chan_type == 0) {
-			chan_type[0] = CHAN_TYPE_CC;
+			OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC)
 			for (i = 1; i < num_kanal; i++)
-				chan_type[i] = CHAN_TYPE_TC;
-			num_chan_type = num_kanal;
+				OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_TC)
 		}
 
 	}
 	if (num_kanal == 1 && num_device == 0)
-		num_device = 1; /* use default */
+		OPT_ARRAY(num_device, dsp_device, DSP_DEVICE_DEFAULT) /* use default */
 	if (num_kanal != num_device) {
 		fprintf(stderr, "You need to specify as many sound devices as you have channels.\n");
 		exit(0);
 	}
 	if (num_kanal == 1 && num_chan_type == 0)
-		num_chan_type = 1; /* use default */
+		OPT_ARRAY(num_chan_type, chan_type, CHAN_TYPE_CC_TC) /* use default */
 	if (num_kanal != num_chan_type) {
 		fprintf(stderr, "You need to specify as many channel types as you have channels.\n");
 		exit(0);
@@ -341,6 +354,11 @@ int main(int argc, char *argv[])
 	/* inits */
 	fm_init(fast_math);
 	dsp_init();
+	rc = init_frame();
+	if (rc < 0) {
+		fprintf(stderr, "Failed to initialize frame definitions. Quitting!\n");
+		goto fail;
+	}
 
 	/* SDR always requires emphasis */
 	if (use_sdr) {
@@ -359,7 +377,7 @@ int main(int argc, char *argv[])
 
 	/* create transceiver instance */
 	for (i = 0; i < num_kanal; i++) {
-		rc = r2000_create(band, kanal[i], chan_type[i], dsp_device[i], use_sdr, dsp_samplerate, rx_gain, tx_gain, do_pre_emphasis, do_de_emphasis, write_rx_wave, write_tx_wave, read_rx_wave, read_tx_wave, relais, deport, agi, sm_power, taxe, crins, destruction, nconv, recall, loopback);
+		rc = r2000_create(band, kanal[i], chan_type[i], dsp_device[i], use_sdr, dsp_samplerate, rx_gain, tx_gain, do_pre_emphasis, do_de_emphasis, write_rx_wave, write_tx_wave, read_rx_wave, read_tx_wave, relais, deport, agi, sm_power, taxe, crins, destruction, nconv, recall, super_decimation, loopback);
 		if (rc < 0) {
 			fprintf(stderr, "Failed to create transceiver instance. Quitting!\n");
 			goto fail;
@@ -1,7 +1,7 @@
 #include <stdint.h>
 #include "outoforder.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0000, 0x0000, 0x0003, 0xfff8, 0xfff6, 0xfff2, 0xfffd, 0xfffc,
 	0xfffd, 0x0004, 0xfffb, 0xfffb, 0xffff, 0x0001, 0x0000, 0x0000,
 	0x0000, 0x0000, 0xfffa, 0xfffa, 0xfffd, 0xffff, 0x0002, 0xffff,
@@ -6801,7 +6801,7 @@ static int16_t pattern[] = {
 	0xfff8, 0xfff1, 0xfff8, 0xfff3, 0xfff5, 0xfff5, 0xfff5, 0xfff4,
 };
 
-extern int16_t *outoforder_spl;
+extern const int16_t *outoforder_spl;
 extern int outoforder_size;
 extern int outoforder_max;
 
@@ -386,7 +386,7 @@ static uint8_t r2000_encode_super(r2000_t *r2000)
 static void r2000_timeout(void *data);
 
 /* Create transceiver instance and link to a list. */
-int r2000_create(int band, const char *kanal, enum r2000_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint16_t relais, uint8_t deport, uint8_t agi, uint8_t sm_power, uint8_t taxe, uint8_t crins, int destruction, uint8_t nconv, int recall, int loopback)
+int r2000_create(int band, const char *kanal, enum r2000_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint16_t relais, uint8_t deport, uint8_t agi, uint8_t sm_power, uint8_t taxe, uint8_t crins, int destruction, uint8_t nconv, int recall, int super_decimation, int loopback)
 {
 	sender_t *sender;
 	r2000_t *r2000 = NULL;
@@ -423,6 +423,8 @@ int r2000_create(int band, const char *kanal, enum r2000_chan_type chan_type, co
 	osmo_timer_setup(&r2000->timer, r2000_timeout, r2000);
 	r2000->sysinfo.relais = relais;
 	r2000->sysinfo.chan_type = chan_type;
+	/* calling channels must be demodulated, even if no signal is received */
+	r2000->sender.rx_always_on = (chan_type != CHAN_TYPE_TC);
 	r2000->sysinfo.deport = deport;
 	r2000->sysinfo.agi = agi;
 	r2000->sysinfo.sm_power = sm_power;
@@ -444,7 +446,7 @@ int r2000_create(int band, const char *kanal, enum r2000_chan_type chan_type, co
 		goto error;
 
 	/* init audio processing */
-	rc = dsp_init_sender(r2000);
+	rc = dsp_init_sender(r2000, super_decimation);
 	if (rc < 0) {
 		LOGP(DR2000, LOGL_ERROR, "Failed to init audio processing!\n");
 		goto error;
@@ -1151,10 +1153,10 @@ static void timeout_release_tc(r2000_t *r2000)
 
 /* FSK processing requests next frame after transmission of previous
    frame has been finished. */
-const char *r2000_get_frame(r2000_t *r2000)
+const uint8_t *r2000_get_frame(r2000_t *r2000)
 {
 	frame_t frame;
-	const char *bits;
+	const uint8_t *bits;
 	int last_frame_idle, debug = 1;
 
 	r2000->tx_frame_count++;
@@ -1231,14 +1233,15 @@ const char *r2000_get_frame(r2000_t *r2000)
 	return bits;
 }
 
-void r2000_receive_frame(r2000_t *r2000, const char *bits, double quality, double level)
+void r2000_receive_frame(r2000_t *r2000, const uint8_t *bits, int num, double quality, double level)
 {
 	frame_t frame;
 	int rc;
 
 	LOGP_CHAN(DDSP, LOGL_INFO, "RX Level: %.0f%% Quality=%.0f\n", level * 100.0, quality * 100.0);
 
-	rc = decode_frame(&frame, bits);
+	rc = decode_frame(&frame, bits, num);
+	sender_rx_frame(&r2000->sender, (rc < 0) ? -1 : 0);
 	if (rc < 0) {
 		LOGP_CHAN(DR2000, (r2000->sender.loopback) ? LOGL_NOTICE : LOGL_DEBUG, "Received invalid frame.\n");
 		return;
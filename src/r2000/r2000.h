@@ -87,7 +87,7 @@ typedef struct r2000 {
 	enum dsp_mode		dsp_mode;		/* current mode: audio, durable tone 0 or 1, paging */
 	fsk_mod_t		fsk_mod;		/* fsk processing */
 	fsk_demod_t		fsk_demod;
-	char			tx_frame[208];		/* carries bits of one frame to transmit */
+	uint8_t			tx_frame[208 / 8];	/* carries bits of one frame to transmit (MSB first) */
 	int			tx_frame_length;
 	int			tx_frame_pos;
 	int			tx_last_frame_idle;	/* indicator to prevent debugging all idle frames */
@@ -95,10 +95,12 @@ typedef struct r2000 {
 	int			rx_in_sync;		/* if we are in sync and receive bits */
 	int			rx_mute;		/* mute count down after sync */
 	int			rx_max;			/* maximum bits to receive (including 32 bits sync sequence) */
-	char			rx_frame[177];		/* receive frame (one extra byte to terminate string) */
+	uint8_t			rx_frame[176 / 8];	/* receive frame (MSB first) */
 	int			rx_count;		/* next bit to receive */
-	double			rx_level[256];		/* level infos */
-	double			rx_quality[256];	/* quality infos */
+	double			rx_level[16];		/* level infos of sync */
+	double			rx_quality[16];		/* quality infos of sync */
+	double			rx_level_sum;		/* sum of level infos of frame */
+	double			rx_quality_sum;		/* sum of quality infos of frame */
 	uint64_t		rx_bits_count;		/* sample counter */
 	uint64_t		rx_bits_count_current;	/* sample counter of current frame */
 	uint64_t		rx_bits_count_last;	/* sample counter of last frame */
@@ -115,6 +117,9 @@ typedef struct r2000 {
 	double			super_rx_quality[20];	/* quality infos */
 	int			super_rx_index;		/* index for level and quality buffer */
 	iir_filter_t		super_rx_hp;		/* filters away the supervisory */
+	int			super_decimation;	/* factor to reduce sample rate of supervisory demodulator */
+	int			super_decimation_pos;	/* next sample to pick */
+	iir_filter_t		super_rx_lp;		/* filters away spectrum above supervisory before decimation */
 double super_bittime;
 double super_bitpos;
 
@@ -124,14 +129,14 @@ void r2000_channel_list(void);
 int r2000_channel_by_short_name(const char *short_name);
 const char *chan_type_short_name(enum r2000_chan_type chan_type);
 const char *chan_type_long_name(enum r2000_chan_type chan_type);
-int r2000_create(int band, const char *kanal, enum r2000_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint16_t relais, uint8_t deport, uint8_t agi, uint8_t sm_power, uint8_t taxe, uint8_t crins, int destruction, uint8_t nconv, int recall, int loopback);
+int r2000_create(int band, const char *kanal, enum r2000_chan_type chan_type, const char *device, int use_sdr, int samplerate, double rx_gain, double tx_gain, int pre_emphasis, int de_emphasis, const char *write_rx_wave, const char *write_tx_wave, const char *read_rx_wave, const char *read_tx_wave, uint16_t relais, uint8_t deport, uint8_t agi, uint8_t sm_power, uint8_t taxe, uint8_t crins, int destruction, uint8_t nconv, int recall, int super_decimation, int loopback);
 void r2000_check_channels(void);
 void r2000_destroy(sender_t *sender);
 void r2000_go_idle(r2000_t *r2000);
 void r2000_band_list(void);
 double r2000_channel2freq(int band, int channel, int uplink);
 const char *r2000_number_valid(const char *number);
-const char *r2000_get_frame(r2000_t *r2000);
-void r2000_receive_frame(r2000_t *r2000, const char *bits, double quality, double level);
+const uint8_t *r2000_get_frame(r2000_t *r2000);
+void r2000_receive_frame(r2000_t *r2000, const uint8_t *bits, int num, double quality, double level);
 void r2000_receive_super(r2000_t *r2000, uint8_t super, double quality, double level);
 
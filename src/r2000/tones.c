@@ -2,7 +2,7 @@
 #include <stdint.h>
 #include "tones.h"
 
-static int16_t pattern[] = {
+static const int16_t pattern[] = {
 	0x0000, 0x1483,
 	0x269d, 0x3420, 0x3b7d, 0x3bd3, 0x3510, 0x280f, 0x164c, 0x01e5,
 	0xed4c, 0xdadd, 0xcce2, 0xc4e1, 0xc3ee, 0xca06, 0xd68e, 0xe7f0,
@@ -33,13 +33,13 @@ static int16_t pattern[] = {
 
 static int16_t tone[12000];
 
-extern int16_t *ringback_spl;
+extern const int16_t *ringback_spl;
 extern int ringback_size;
 extern int ringback_max;
-extern int16_t *busy_spl;
+extern const int16_t *busy_spl;
 extern int busy_size;
 extern int busy_max;
-extern int16_t *congestion_spl;
+extern const int16_t *congestion_spl;
 extern int congestion_size;
 extern int congestion_max;
 
@@ -26,6 +26,7 @@ enum paging_signal;
 #include <stdlib.h>
 #include <signal.h>
 #include <sched.h>
+#include <pthread.h>
 #include <errno.h>
 #include <math.h>
 #include <termios.h>
@@ -68,6 +69,9 @@ static double volume = 1.0;
 static int stereo = 0;
 static int rds = 0;
 static int rds2 = 0;
+static uint16_t rds_pi = 0xd000;
+static const char *rds_ps = "OSMORADI";
+static int pipeline = 0;
 
 /* global variable to quit main loop */
 int quit = 0;
@@ -125,9 +129,11 @@ static void print_help(const char *arg0)
 	printf("        Output received audio to wave file\n");
 	printf(" -a --audio-device hw:<card>,<device>\n");
 	printf("        Input audio from sound card's device number\n");
-	printf(" -M --modulation fm | am | usb | lsb\n");
+	printf(" -M --modulation fm | am | sam | usb | lsb\n");
 	printf("        fm = Frequency modulation to be used for VHF.\n");
 	printf("        am = Amplitude modulation to be used for long/medium/short wave.\n");
+	printf("        sam = Like am, but synchronous demodulation on the phase of the carrier.\n");
+	printf("              The carrier must be tuned within a few Hz.\n");
 	printf("        usb = Amplitude modulation with upper side band only.\n");
 	printf("        lsb = Amplitude modulation with lower side band only.\n");
 	printf(" -R --rx\n");
@@ -150,8 +156,20 @@ static void print_help(const char *arg0)
 	printf(" -S --stereo\n");
 	printf("        Enables stereo carrier for frequency modulated UHF broadcast.\n");
 	printf("        It uses the 'Pilot-tone' system.\n");
+	printf("    --rds\n");
+	printf("        Enables RDS with program identification and program service name.\n");
+	printf("    --rds-pi <hex>\n");
+	printf("        Program identification code of RDS. (default = %04X)\n", rds_pi);
+	printf("    --rds-ps <name>\n");
+	printf("        Program service name of RDS, up to 8 characters. (default = '%s')\n", rds_ps);
+	printf("    --pipeline\n");
+	printf("        Run audio I/O and resampling in separate threads, so modulation and\n");
+	printf("        demodulation at high sample rates get a CPU core of their own.\n");
 	printf("    --fast-math\n");
 	printf("        Use fast math approximation for slow CPU / ARM based systems.\n");
+	printf("    --vector-math\n");
+	printf("        Like --fast-math, but modulation and demodulation use float math on\n");
+	printf("        blocks of samples, which can be vectorized by the compiler.\n");
 	printf("    --limesdr\n");
 	printf("        Auto-select several required options for LimeSDR\n");
 	printf("    --limesdr-mini\n");
@@ -160,8 +178,13 @@ static void print_help(const char *arg0)
 }
 
 #define	OPT_FAST_MATH		1007
+#define	OPT_VECTOR_MATH		1008
 #define OPT_LIMESDR		1100
 #define OPT_LIMESDR_MINI	1101
+#define OPT_RDS			1102
+#define OPT_RDS_PI		1103
+#define OPT_RDS_PS		1104
+#define OPT_PIPELINE		1105
 
 static void add_options(void)
 {
@@ -180,7 +203,12 @@ static void add_options(void)
 	option_add('E', "emphasis", 1);
 	option_add('V', "volume", 1);
 	option_add('S', "stereo", 0);
+	option_add(OPT_RDS, "rds", 0);
+	option_add(OPT_RDS_PI, "rds-pi", 1);
+	option_add(OPT_RDS_PS, "rds-ps", 1);
+	option_add(OPT_PIPELINE, "pipeline", 0);
 	option_add(OPT_FAST_MATH, "fast-math", 0);
+	option_add(OPT_VECTOR_MATH, "vector-math", 0);
 	option_add(OPT_LIMESDR, "limesdr", 0);
 	option_add(OPT_LIMESDR_MINI, "limesdr-mini", 0);
         sdr_config_add_options();
@@ -215,6 +243,9 @@ static int handle_options(int short_option, int argi, char **argv)
 		if (!strcasecmp(argv[argi], "am"))
 			modulation = MODULATION_AM_DSB;
 		else
+		if (!strcasecmp(argv[argi], "sam"))
+			modulation = MODULATION_AM_SYNC;
+		else
 		if (!strcasecmp(argv[argi], "usb"))
 			modulation = MODULATION_AM_USB;
 		else
@@ -254,9 +285,28 @@ static int handle_options(int short_option, int argi, char **argv)
 	case 'S':
 		stereo = 1;
 		break;
+	case OPT_RDS:
+		rds = 1;
+		break;
+	case OPT_RDS_PI:
+		rds_pi = strtoul(argv[argi], NULL, 16);
+		break;
+	case OPT_RDS_PS:
+		rds_ps = options_strdup(argv[argi]);
+		if (strlen(rds_ps) > 8) {
+			fprintf(stderr, "Given RDS program service name must be up to 8 characters long.\n");
+			return -EINVAL;
+		}
+		break;
+	case OPT_PIPELINE:
+		pipeline = 1;
+		break;
 	case OPT_FAST_MATH:
 		fast_math = 1;
 		break;
+	case OPT_VECTOR_MATH:
+		fast_math = 2;
+		break;
 	case OPT_LIMESDR:
 		{
 			char *argv_lime[] = { argv[0],
@@ -349,6 +399,10 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "Stereo works with FM only, use '-h' for help!\n");
 		exit(0);
 	}
+	if (rds && modulation != MODULATION_FM) {
+		fprintf(stderr, "RDS works with FM only, use '-h' for help!\n");
+		exit(0);
+	}
 	if (!rx && !tx) {
 		fprintf(stderr, "You need to specify --rx (receiver) and/or --tx (transmitter), use '-h' for help!\n");
 		exit(0);
@@ -364,7 +418,7 @@ int main(int argc, char *argv[])
 	/* now we have buffer size and sample rate */
 	buffer_size = dsp_samplerate * dsp_buffer / 1000;
 
-	rc = radio_init(&radio, buffer_size, dsp_samplerate, frequency, tx_wave_file, rx_wave_file, (tx) ? tx_audiodev : NULL, (rx) ? rx_audiodev : NULL, modulation, bandwidth, deviation, modulation_index, time_constant_us, volume, stereo, rds, rds2);
+	rc = radio_init(&radio, buffer_size, dsp_samplerate, frequency, tx_wave_file, rx_wave_file, (tx) ? tx_audiodev : NULL, (rx) ? rx_audiodev : NULL, modulation, bandwidth, deviation, modulation_index, time_constant_us, volume, stereo, rds, rds2, rds_pi, rds_ps);
 	if (rc < 0) {
 		fprintf(stderr, "Failed to initialize radio with given options, exitting!\n");
 		exit(0);
@@ -418,7 +472,7 @@ int main(int argc, char *argv[])
 	signal(SIGPIPE, sighandler);
 
 	printf("Starting radio...\n");
-	rc = radio_start(&radio);
+	rc = radio_start(&radio, pipeline);
 	if (rc < 0) {
 		fprintf(stderr, "Failed to start radio's streaming, exitting!\n");
 		goto error_start;
@@ -497,6 +551,9 @@ next_char:
 		case 'b':
 			calibrate_bias();
 			goto next_char;
+		case 't':
+			sdr_print_stats();
+			goto next_char;
 		}
 	}
 
@@ -23,6 +23,7 @@
 #include <string.h>
 #include <math.h>
 #include <errno.h>
+#include <unistd.h>
 #include <pthread.h>
 #include "../libsample/sample.h"
 #include "../liblogging/logging.h"
@@ -35,10 +36,15 @@
 #define STEREO_BW	15000.0
 #define PILOT_FREQ	19000.0
 #define PILOT_BW	5.0
+#define PILOT_LEVEL	0.1
+#define RDS_LEVEL	0.04	/* 3 kHz of 75 kHz deviation */
+
+/* number of pilot phasors that are rotated together */
+#define MPX_LANES	4
 
 static char freq_name[2][64];
 
-int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency, const char *tx_wave_file, const char *rx_wave_file, const char *tx_audiodev, const char *rx_audiodev, enum modulation modulation, double bandwidth, double deviation, double modulation_index, double time_constant_us, double volume, int stereo, int rds, int rds2)
+int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency, const char *tx_wave_file, const char *rx_wave_file, const char *tx_audiodev, const char *rx_audiodev, enum modulation modulation, double bandwidth, double deviation, double modulation_index, double time_constant_us, double volume, int stereo, int rds, int rds2, uint16_t rds_pi, const char *rds_ps)
 {
 	int rc = -EINVAL;
 
@@ -69,6 +75,7 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
 			radio->signal_bandwidth = deviation + 80000.0;
 		break;
 	case MODULATION_AM_DSB:
+	case MODULATION_AM_SYNC:
 	case MODULATION_AM_USB:
 	case MODULATION_AM_LSB:
 		/* level is 1.0, which is full amplitude */
@@ -83,7 +90,7 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
 		/* open wave file */
 		int _samplerate = 0;
 		radio->tx_audio_channels = 0;
-		rc = wave_create_playback(&radio->wave_tx_play, tx_wave_file, &_samplerate, &radio->tx_audio_channels, 1.0);
+		rc = wave_create_playback(&radio->wave_tx_play, tx_wave_file, &_samplerate, &radio->tx_audio_channels, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DRADIO, LOGL_ERROR, "Failed to create WAVE playback instance!\n");
 			goto error;
@@ -151,7 +158,7 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
 		/* open wave file */
 		radio->rx_audio_samplerate = 48000;
 		radio->rx_audio_channels = (radio->stereo) ? 2 : 1;
-		rc = wave_create_record(&radio->wave_rx_rec, rx_wave_file, radio->rx_audio_samplerate, radio->rx_audio_channels, 1.0);
+		rc = wave_create_record(&radio->wave_rx_rec, rx_wave_file, radio->rx_audio_samplerate, radio->rx_audio_channels, 1.0, 0);
 		if (rc < 0) {
 			LOGP(DRADIO, LOGL_ERROR, "Failed to create WAVE record instance!\n");
 			goto error;
@@ -218,16 +225,16 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
         iir_lowpass_init(&radio->rx_lp_diff, STEREO_BW, radio->signal_samplerate, 2);
 
 	/* init sample rate conversion, use complete bandwidth for resample filter */
-	rc = init_samplerate(&radio->tx_resampler[0], radio->tx_audio_samplerate, radio->signal_samplerate, radio->tx_audio_samplerate / 2.0);
+	rc = init_samplerate(&radio->tx_resampler[0], radio->tx_audio_samplerate, radio->signal_samplerate, radio->tx_audio_samplerate / 2.0, SAMPLERATE_POLYPHASE);
 	if (rc < 0)
 		goto error;
-	rc = init_samplerate(&radio->tx_resampler[1], radio->tx_audio_samplerate, radio->signal_samplerate, radio->tx_audio_samplerate / 2.0);
+	rc = init_samplerate(&radio->tx_resampler[1], radio->tx_audio_samplerate, radio->signal_samplerate, radio->tx_audio_samplerate / 2.0, SAMPLERATE_POLYPHASE);
 	if (rc < 0)
 		goto error;
-	rc = init_samplerate(&radio->rx_resampler[0], radio->rx_audio_samplerate, radio->signal_samplerate, radio->rx_audio_samplerate / 2.0);
+	rc = init_samplerate(&radio->rx_resampler[0], radio->rx_audio_samplerate, radio->signal_samplerate, radio->rx_audio_samplerate / 2.0, SAMPLERATE_POLYPHASE);
 	if (rc < 0)
 		goto error;
-	rc = init_samplerate(&radio->rx_resampler[1], radio->rx_audio_samplerate, radio->signal_samplerate, radio->rx_audio_samplerate / 2.0);
+	rc = init_samplerate(&radio->rx_resampler[1], radio->rx_audio_samplerate, radio->signal_samplerate, radio->rx_audio_samplerate / 2.0, SAMPLERATE_POLYPHASE);
 	if (rc < 0)
 		goto error;
 
@@ -255,6 +262,11 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
 		rc = fm_demod_init(&radio->fm_demod, radio->signal_samplerate, 0.0, 2 * radio->signal_bandwidth);
 		if (rc < 0)
 			goto error;
+		if (rds) {
+			rc = rds_init(&radio->rds_enc, radio->signal_samplerate, rds_pi, rds_ps);
+			if (rc < 0)
+				goto error;
+		}
 		if (stereo) {
 			sprintf(freq_name[0], "%.4f MHz left", frequency / 1e6);
 			sprintf(freq_name[1], "%.4f MHz right", frequency / 1e6);
@@ -262,6 +274,7 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
 		}
 		break;
 	case MODULATION_AM_DSB:
+	case MODULATION_AM_SYNC:
 		iir_lowpass_init(&radio->tx_am_bw_limit, radio->audio_bandwidth, radio->signal_samplerate, 1);
 		/* modulation index 0.0 = no envelope, bias 1.0
 		 * modulation index 1.0 = envelope +-0.5, bias 0.5
@@ -275,6 +288,7 @@ int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency
 		rc = am_demod_init(&radio->am_demod, radio->signal_samplerate, 0.0, radio->signal_bandwidth, 1.0 / modulation_index);
 		if (rc < 0)
 			goto error;
+		am_demod_sync(&radio->am_demod, (radio->modulation == MODULATION_AM_SYNC));
 		break;
 	case MODULATION_AM_USB:
 		iir_lowpass_init(&radio->tx_am_bw_limit, radio->audio_bandwidth, radio->signal_samplerate, 1);
@@ -352,8 +366,56 @@ error:
 	return rc;
 }
 
+static void *tx_audio_child(void *arg);
+static void *rx_audio_child(void *arg);
+
+static int stage_start(radio_t *radio, radio_stage_t *stage, void *(*child)(void *), const char *name)
+{
+	int rc;
+
+	/* two channels per element, a bit more than twice the buffer size */
+	rc = ringbuffer_init(&stage->ring, radio->buffer_size * 2 + 10, 2 * sizeof(sample_t));
+	stage->audio_buffer = calloc(radio->audio_buffer_size * 2, sizeof(*stage->audio_buffer));
+	stage->signal_buffer = calloc(radio->signal_buffer_size * 2, sizeof(*stage->signal_buffer));
+	if (rc < 0 || !stage->audio_buffer || !stage->signal_buffer) {
+		LOGP(DRADIO, LOGL_ERROR, "No memory!!\n");
+		return -ENOMEM;
+	}
+
+	stage->finish = 0;
+	stage->error = 0;
+	rc = pthread_create(&stage->tid, NULL, child, radio);
+	if (rc) {
+		LOGP(DRADIO, LOGL_ERROR, "Failed to create %s audio thread! (error %d)\n", name, rc);
+		return -rc;
+	}
+	stage->running = 1;
+
+	return 0;
+}
+
+static void stage_stop(radio_stage_t *stage)
+{
+	if (stage->running) {
+		stage->finish = 1;
+		pthread_join(stage->tid, NULL);
+		stage->running = 0;
+	}
+	ringbuffer_exit(&stage->ring);
+	free(stage->audio_buffer);
+	stage->audio_buffer = NULL;
+	free(stage->signal_buffer);
+	stage->signal_buffer = NULL;
+}
+
 void radio_exit(radio_t *radio)
 {
+	/* stop audio stages first, they use everything below */
+	stage_stop(&radio->tx_stage);
+	stage_stop(&radio->rx_stage);
+	rds_exit(&radio->rds_enc);
+	display_wave_exit(&radio->dispwav[0]);
+	display_wave_exit(&radio->dispwav[1]);
 	if (radio->audio_buffer) {
 		free(radio->audio_buffer);
 		radio->audio_buffer = NULL;
@@ -415,7 +477,10 @@ void radio_exit(radio_t *radio)
 		am_mod_exit(&radio->am_mod);
 }
 
-int radio_start(radio_t __attribute__((unused)) *radio)
+/* start radio, if pipeline is set, audio I/O and resampling run in a separate
+ * thread for each direction, so modulation can use a core of its own
+ */
+int radio_start(radio_t *radio, int pipeline)
 {
 	int rc = 0;
 
@@ -427,44 +492,70 @@ int radio_start(radio_t __attribute__((unused)) *radio)
 	if (radio->tx_sound && radio->tx_sound != radio->rx_sound) 
 		rc = sound_start(radio->tx_sound);
 #endif
+	if (rc < 0)
+		return rc;
+
+	if (pipeline && radio->tx_audio_mode) {
+		rc = stage_start(radio, &radio->tx_stage, tx_audio_child, "TX");
+		if (rc < 0)
+			return rc;
+	}
+	if (pipeline && radio->rx_audio_mode) {
+		rc = stage_start(radio, &radio->rx_stage, rx_audio_child, "RX");
+		if (rc < 0)
+			return rc;
+	}
+	if (pipeline)
+		LOGP(DRADIO, LOGL_INFO, "Audio stages run in separate threads.\n");
 
 	return rc;
 }
 
-int radio_tx(radio_t *radio, float *baseband, int signal_num)
+/* Add pilot tone and differential signal (if diff is set) and RDS (if rds is set)
+ * to the sum signal.
+ *
+ * Pilot, 38 kHz and 57 kHz carriers are derived from one pilot phasor:
+ * sin(2p) = 2 sin(p) cos(p) and sin(3p) = sin(p) (3 - 4 sin(p)^2). Instead of
+ * a sine per sample, MPX_LANES phasors of consecutive samples are rotated by
+ * MPX_LANES steps each round. They are calculated again for every buffer, so
+ * rounding errors do not add up.
+ */
+static void mpx_assemble(sample_t *sum, const sample_t *diff, const sample_t *rds, int length, double phase, double step)
 {
-	int i;
-	int __attribute__((unused)) rc;
-	int audio_num;
-	sample_t *audio_samples[2];
-	sample_t *signal_samples[3];
-	uint8_t *signal_power;
-	jitter_frame_t *jf;
+	double re[MPX_LANES], im[MPX_LANES], rot_re, rot_im, r, s, c;
+	int i, l;
 
-	if (signal_num > radio->buffer_size) {
-		LOGP(DRADIO, LOGL_ERROR, "signal_num > buffer_size, please fix!.\n");
-		abort();
+	for (l = 0; l < MPX_LANES; l++) {
+		re[l] = cos(phase + step * (double)l);
+		im[l] = sin(phase + step * (double)l);
 	}
+	rot_re = cos(step * (double)MPX_LANES);
+	rot_im = sin(step * (double)MPX_LANES);
 
-	/* audio buffers: how many sample for audio (rounded down) */
-	audio_num = (int)((double)signal_num / radio->tx_resampler[0].factor);
-	if (audio_num > radio->audio_buffer_size) {
-		LOGP(DRADIO, LOGL_ERROR, "audio_num > audio_buffer_size, please fix!.\n");
-		abort();
+	for (i = 0; i < length; i += MPX_LANES) {
+		for (l = 0; l < MPX_LANES && i + l < length; l++) {
+			s = im[l];
+			c = re[l];
+			if (diff)
+				sum[i + l] += s * PILOT_LEVEL + diff[i + l] * 2.0 * s * c;
+			if (rds)
+				sum[i + l] += rds[i + l] * RDS_LEVEL * s * (3.0 - 4.0 * s * s);
+			r = re[l] * rot_re - im[l] * rot_im;
+			im[l] = re[l] * rot_im + im[l] * rot_re;
+			re[l] = r;
+		}
 	}
-	audio_samples[0] = radio->audio_buffer;
-	audio_samples[1] = radio->audio_buffer + radio->audio_buffer_size;
+}
 
-	/* signal buffers: a bit more samples to be safe */
-	signal_num = (int)((double)audio_num * radio->tx_resampler[0].factor + 0.5) + 10;
-	if (signal_num > radio->signal_buffer_size) {
-		LOGP(DRADIO, LOGL_ERROR, "signal_num > signal_buffer_size, please fix!.\n");
-		abort();
-	}
-	signal_samples[0] = radio->signal_buffer;
-	signal_samples[1] = radio->signal_buffer + radio->signal_buffer_size;
-	signal_samples[2] = radio->signal_buffer + radio->signal_buffer_size * 2;
-	signal_power = radio->signal_power_buffer;
+/* audio stage of transmitter: read audio, convert mono/stereo and upsample
+ * to signal rate, return number of signal samples
+ */
+static int tx_audio(radio_t *radio, sample_t *audio_samples[2], int audio_num, sample_t *signal_samples[2])
+{
+	int i;
+	int __attribute__((unused)) rc;
+	int signal_num;
+	jitter_frame_t __attribute__((unused)) *jf;
 
 	/* get audio to be sent */
 	switch (radio->tx_audio_mode) {
@@ -475,7 +566,7 @@ int radio_tx(radio_t *radio, float *baseband, int signal_num)
 			int rc;
 			int _samplerate = 0;
 			wave_destroy_playback(&radio->wave_tx_play);
-			rc = wave_create_playback(&radio->wave_tx_play, radio->tx_wave_file, &_samplerate, &radio->tx_audio_channels, 1.0);
+			rc = wave_create_playback(&radio->wave_tx_play, radio->tx_wave_file, &_samplerate, &radio->tx_audio_channels, 1.0, 0);
 			if (rc < 0) {
 				LOGP(DRADIO, LOGL_ERROR, "Failed to re-open wave file.\n");
 				return rc;
@@ -492,14 +583,14 @@ int radio_tx(radio_t *radio, float *baseband, int signal_num)
 			else
 				return 0;
 		}
-		jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)audio_samples[0], rc * sizeof(*(audio_samples[0])), 0, radio->tx_sequence[0], radio->tx_timestamp[0], 123);
+		jf = jitter_frame_alloc(&radio->tx_dejitter[0], NULL, NULL, (uint8_t *)audio_samples[0], rc * sizeof(*(audio_samples[0])), 0, radio->tx_sequence[0], radio->tx_timestamp[0], 123);
 		if (jf)
 			jitter_save(&radio->tx_dejitter[0], jf);
 		radio->tx_sequence[0] += 1;
 		radio->tx_timestamp[0] += rc;
 		jitter_load_samples(&radio->tx_dejitter[0], (uint8_t *)audio_samples[0], audio_num, sizeof(*(audio_samples[0])), NULL, NULL);
 		if (radio->tx_audio_channels == 2) {
-			jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)audio_samples[1], rc * sizeof(*(audio_samples[1])), 0, radio->tx_sequence[1], radio->tx_timestamp[1], 123);
+			jf = jitter_frame_alloc(&radio->tx_dejitter[1], NULL, NULL, (uint8_t *)audio_samples[1], rc * sizeof(*(audio_samples[1])), 0, radio->tx_sequence[1], radio->tx_timestamp[1], 123);
 			if (jf)
 				jitter_save(&radio->tx_dejitter[1], jf);
 			radio->tx_sequence[1] += 1;
@@ -565,6 +656,14 @@ int radio_tx(radio_t *radio, float *baseband, int signal_num)
 	if (radio->stereo)
 		samplerate_upsample(&radio->tx_resampler[1], audio_samples[1], audio_num, signal_samples[1], signal_num);
 
+	return signal_num;
+}
+
+/* modulation stage of transmitter: emphasis, stereo/RDS and modulation */
+static void tx_modulate(radio_t *radio, sample_t *signal_samples[3], uint8_t *signal_power, int signal_num, float *baseband)
+{
+	int i;
+
 	/* prepare baseband */
 	memset(baseband, 0, sizeof(float) * 2 * signal_num);
 	memset(signal_power, 1, signal_num);
@@ -580,23 +679,20 @@ int radio_tx(radio_t *radio, float *baseband, int signal_num)
 			if (radio->emphasis)
 				pre_emphasis(&radio->fm_emphasis[1], signal_samples[1], signal_num);
 			clipper_process(signal_samples[1], signal_num);
-			/* add pilot tone */
-			double phasestep = radio->pilot_phasestep;
-			double phase = radio->tx_pilot_phase;
-			for (i = 0; i < signal_num; i++) {
-				signal_samples[0][i] += sin(phase) * 0.1;
-				signal_samples[0][i] += signal_samples[1][i] * sin(phase * 2);
-				phase += phasestep;
-				if (phase >= 2.0 * M_PI)
-					phase -= 2.0 * M_PI;
-			}
-			radio->tx_pilot_phase = phase;
+		}
+		/* add pilot tone, differential signal and RDS */
+		if (radio->stereo || radio->rds) {
+			if (radio->rds)
+				rds_encode(&radio->rds_enc, signal_samples[2], signal_num);
+			mpx_assemble(signal_samples[0], (radio->stereo) ? signal_samples[1] : NULL, (radio->rds) ? signal_samples[2] : NULL, signal_num, radio->tx_pilot_phase, radio->pilot_phasestep);
+			radio->tx_pilot_phase = fmod(radio->tx_pilot_phase + radio->pilot_phasestep * (double)signal_num, 2.0 * M_PI);
 		}
 		for (i = 0; i < signal_num; i++)
 			signal_samples[0][i] *= radio->fm_deviation;
 		fm_modulate_complex(&radio->fm_mod, signal_samples[0], signal_power, signal_num, baseband);
 		break;
 	case MODULATION_AM_DSB:
+	case MODULATION_AM_SYNC:
 		/* also clip to prevent overshooting after audio filtering */
 		clipper_process(signal_samples[0], signal_num);
 		iir_process(&radio->tx_am_bw_limit, signal_samples[0], signal_num);
@@ -612,30 +708,132 @@ int radio_tx(radio_t *radio, float *baseband, int signal_num)
 	default:
 		break;
 	}
+}
 
-	return signal_num;
+/* audio stage thread of transmitter, keeps the ring filled with frames of sum
+ * and differential signal at signal rate
+ */
+static void *tx_audio_child(void *arg)
+{
+	radio_t *radio = (radio_t *)arg;
+	radio_stage_t *stage = &radio->tx_stage;
+	sample_t *audio_samples[2], *signal_samples[2];
+	sample_t *frame;
+	void *span;
+	int audio_num, signal_num, num, i, j;
+
+	audio_samples[0] = stage->audio_buffer;
+	audio_samples[1] = stage->audio_buffer + radio->audio_buffer_size;
+	signal_samples[0] = stage->signal_buffer;
+	signal_samples[1] = stage->signal_buffer + radio->signal_buffer_size;
+
+	while (!stage->finish) {
+		/* how much audio fits into the ring and buffers (up to 10 samples more after upsampling) */
+		num = ringbuffer_space(&stage->ring);
+		if (num > radio->signal_buffer_size)
+			num = radio->signal_buffer_size;
+		audio_num = (int)((double)(num - 10) / radio->tx_resampler[0].factor);
+		if (audio_num > radio->audio_buffer_size)
+			audio_num = radio->audio_buffer_size;
+		if (audio_num < 1) {
+			usleep(1000);
+			continue;
+		}
+		signal_num = tx_audio(radio, audio_samples, audio_num, signal_samples);
+		if (signal_num < 0) {
+			stage->error = signal_num;
+			break;
+		}
+		/* interleave into ring */
+		for (i = 0; i < signal_num; i += num) {
+			num = ringbuffer_write_span(&stage->ring, &span);
+			if (num > signal_num - i)
+				num = signal_num - i;
+			frame = span;
+			for (j = 0; j < num; j++) {
+				*frame++ = signal_samples[0][i + j];
+				*frame++ = signal_samples[1][i + j];
+			}
+			ringbuffer_write_commit(&stage->ring, num);
+		}
+	}
+
+	return NULL;
 }
 
-int radio_rx(radio_t *radio, float *baseband, int signal_num)
+int radio_tx(radio_t *radio, float *baseband, int signal_num)
 {
-	int i;
 	int audio_num;
-	sample_t *samples[3];
-	double p;
-	jitter_frame_t *jf;
+	sample_t *audio_samples[2];
+	sample_t *signal_samples[3];
+	uint8_t *signal_power;
 
 	if (signal_num > radio->buffer_size) {
 		LOGP(DRADIO, LOGL_ERROR, "signal_num > buffer_size, please fix!.\n");
 		abort();
 	}
 
+	signal_samples[0] = radio->signal_buffer;
+	signal_samples[1] = radio->signal_buffer + radio->signal_buffer_size;
+	signal_samples[2] = radio->signal_buffer + radio->signal_buffer_size * 2;
+	signal_power = radio->signal_power_buffer;
+
+	/* pipeline: take what the audio stage has upsampled */
+	if (radio->tx_stage.running) {
+		const sample_t *frame;
+		void *span;
+		int i, j, num;
+
+		if (radio->tx_stage.error)
+			return radio->tx_stage.error;
+		num = ringbuffer_fill(&radio->tx_stage.ring);
+		if (signal_num > num)
+			signal_num = num;
+		for (i = 0; i < signal_num; i += num) {
+			num = ringbuffer_read_span(&radio->tx_stage.ring, &span);
+			if (num > signal_num - i)
+				num = signal_num - i;
+			frame = span;
+			for (j = 0; j < num; j++) {
+				signal_samples[0][i + j] = *frame++;
+				signal_samples[1][i + j] = *frame++;
+			}
+			ringbuffer_read_release(&radio->tx_stage.ring, num);
+		}
+		tx_modulate(radio, signal_samples, signal_power, signal_num, baseband);
+		return signal_num;
+	}
+
+	/* audio buffers: how many sample for audio (rounded down) */
+	audio_num = (int)((double)signal_num / radio->tx_resampler[0].factor);
+	if (audio_num > radio->audio_buffer_size) {
+		LOGP(DRADIO, LOGL_ERROR, "audio_num > audio_buffer_size, please fix!.\n");
+		abort();
+	}
+	audio_samples[0] = radio->audio_buffer;
+	audio_samples[1] = radio->audio_buffer + radio->audio_buffer_size;
+
+	/* signal buffers: a bit more samples to be safe */
+	signal_num = (int)((double)audio_num * radio->tx_resampler[0].factor + 0.5) + 10;
 	if (signal_num > radio->signal_buffer_size) {
 		LOGP(DRADIO, LOGL_ERROR, "signal_num > signal_buffer_size, please fix!.\n");
 		abort();
 	}
-	samples[0] = radio->signal_buffer;
-	samples[1] = radio->signal_buffer + radio->signal_buffer_size;
-	samples[2] = radio->signal_buffer + radio->signal_buffer_size * 2;
+
+	signal_num = tx_audio(radio, audio_samples, audio_num, signal_samples);
+	if (signal_num <= 0)
+		return signal_num;
+
+	tx_modulate(radio, signal_samples, signal_power, signal_num, baseband);
+
+	return signal_num;
+}
+
+/* modulation stage of receiver: demodulation, stereo and de-emphasis */
+static void rx_demodulate(radio_t *radio, sample_t *samples[3], int signal_num, float *baseband)
+{
+	int i;
+	double p;
 
 	switch (radio->modulation) {
 	case MODULATION_FM:
@@ -677,6 +875,7 @@ int radio_rx(radio_t *radio, float *baseband, int signal_num)
 		}
 		break;
 	case MODULATION_AM_DSB:
+	case MODULATION_AM_SYNC:
 		am_demodulate_complex(&radio->am_demod, samples[0], signal_num, baseband, radio->I_buffer, radio->Q_buffer, radio->carrier_buffer);
 		break;
 	case MODULATION_AM_USB:
@@ -686,6 +885,14 @@ int radio_rx(radio_t *radio, float *baseband, int signal_num)
 	default:
 		break;
 	}
+}
+
+/* audio stage of receiver: downsample, convert mono/stereo and write audio */
+static int rx_audio(radio_t *radio, sample_t *samples[2], int signal_num)
+{
+	int i;
+	int audio_num;
+	jitter_frame_t __attribute__((unused)) *jf;
 
 	/* downsample */
 	audio_num = samplerate_downsample(&radio->rx_resampler[0], samples[0], signal_num);
@@ -735,13 +942,13 @@ int radio_rx(radio_t *radio, float *baseband, int signal_num)
 		wave_write(&radio->wave_rx_rec, samples, audio_num);
 #ifdef HAVE_ALSA
 	if ((radio->rx_audio_mode & AUDIO_MODE_AUDIODEV)) {
-		jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)samples[0], audio_num * sizeof(*(samples[0])), 0, radio->rx_sequence[0], radio->rx_timestamp[0], 123);
+		jf = jitter_frame_alloc(&radio->rx_dejitter[0], NULL, NULL, (uint8_t *)samples[0], audio_num * sizeof(*(samples[0])), 0, radio->rx_sequence[0], radio->rx_timestamp[0], 123);
 		if (jf)
 			jitter_save(&radio->rx_dejitter[0], jf);
 		radio->rx_sequence[0] += 1;
 		radio->rx_timestamp[0] += audio_num;
 		if (radio->rx_audio_channels == 2) {
-			jf = jitter_frame_alloc(NULL, NULL, (uint8_t *)samples[1], audio_num * sizeof(*(samples[1])), 0, radio->rx_sequence[1], radio->rx_timestamp[1], 123);
+			jf = jitter_frame_alloc(&radio->rx_dejitter[1], NULL, NULL, (uint8_t *)samples[1], audio_num * sizeof(*(samples[1])), 0, radio->rx_sequence[1], radio->rx_timestamp[1], 123);
 			if (jf)
 				jitter_save(&radio->rx_dejitter[1], jf);
 			radio->rx_sequence[1] += 1;
@@ -765,3 +972,90 @@ int radio_rx(radio_t *radio, float *baseband, int signal_num)
 	return signal_num;
 }
 
+/* audio stage thread of receiver, takes frames of sum and differential signal
+ * from the ring
+ */
+static void *rx_audio_child(void *arg)
+{
+	radio_t *radio = (radio_t *)arg;
+	radio_stage_t *stage = &radio->rx_stage;
+	sample_t *samples[2];
+	const sample_t *frame;
+	void *span;
+	int signal_num, num, i, j;
+
+	samples[0] = stage->signal_buffer;
+	samples[1] = stage->signal_buffer + radio->signal_buffer_size;
+
+	while (!stage->finish) {
+		signal_num = ringbuffer_fill(&stage->ring);
+		if (signal_num > radio->signal_buffer_size)
+			signal_num = radio->signal_buffer_size;
+		if (signal_num == 0) {
+			usleep(1000);
+			continue;
+		}
+		/* deinterleave from ring */
+		for (i = 0; i < signal_num; i += num) {
+			num = ringbuffer_read_span(&stage->ring, &span);
+			if (num > signal_num - i)
+				num = signal_num - i;
+			frame = span;
+			for (j = 0; j < num; j++) {
+				samples[0][i + j] = *frame++;
+				samples[1][i + j] = *frame++;
+			}
+			ringbuffer_read_release(&stage->ring, num);
+		}
+		rx_audio(radio, samples, signal_num);
+	}
+
+	return NULL;
+}
+
+int radio_rx(radio_t *radio, float *baseband, int signal_num)
+{
+	sample_t *samples[3];
+
+	if (signal_num > radio->buffer_size) {
+		LOGP(DRADIO, LOGL_ERROR, "signal_num > buffer_size, please fix!.\n");
+		abort();
+	}
+
+	if (signal_num > radio->signal_buffer_size) {
+		LOGP(DRADIO, LOGL_ERROR, "signal_num > signal_buffer_size, please fix!.\n");
+		abort();
+	}
+	samples[0] = radio->signal_buffer;
+	samples[1] = radio->signal_buffer + radio->signal_buffer_size;
+	samples[2] = radio->signal_buffer + radio->signal_buffer_size * 2;
+
+	rx_demodulate(radio, samples, signal_num, baseband);
+
+	/* pipeline: hand demodulated signal to the audio stage */
+	if (radio->rx_stage.running) {
+		sample_t *frame;
+		void *span;
+		int i, j, num, space;
+
+		space = ringbuffer_space(&radio->rx_stage.ring);
+		if (space < signal_num) {
+			LOGP(DRADIO, LOGL_DEBUG, "Audio stage is too slow, dropping %d samples.\n", signal_num - space);
+			signal_num = space;
+		}
+		for (i = 0; i < signal_num; i += num) {
+			num = ringbuffer_write_span(&radio->rx_stage.ring, &span);
+			if (num > signal_num - i)
+				num = signal_num - i;
+			frame = span;
+			for (j = 0; j < num; j++) {
+				*frame++ = samples[0][i + j];
+				*frame++ = samples[1][i + j];
+			}
+			ringbuffer_write_commit(&radio->rx_stage.ring, num);
+		}
+		return signal_num;
+	}
+
+	return rx_audio(radio, samples, signal_num);
+}
@@ -6,11 +6,14 @@
 #include "../libfm/fm.h"
 #include "../libam/am.h"
 #include "../libdisplay/display.h"
+#include "../libsample/ringbuffer.h"
+#include "rds.h"
 
 enum modulation {
 	MODULATION_NONE = 0,
 	MODULATION_FM,
 	MODULATION_AM_DSB,
+	MODULATION_AM_SYNC,
 	MODULATION_AM_USB,
 	MODULATION_AM_LSB,
 };
@@ -22,6 +25,17 @@ enum audio_mode {
 	AUDIO_MODE_TESTTONE = 4,
 };
 
+/* audio stage that runs in a separate thread, if pipelined */
+typedef struct radio_stage {
+	int		running;		/* thread has been started */
+	pthread_t	tid;			/* thread id */
+	volatile int	finish;			/* tells thread to finish */
+	volatile int	error;			/* error that stopped the thread */
+	ringbuffer_t	ring;			/* frames of sum and differential signal at signal rate */
+	sample_t	*audio_buffer;		/* buffers of this stage */
+	sample_t	*signal_buffer;
+} radio_stage_t;
+
 typedef struct radio {
 	/* modes */
 	int		buffer_size;		/* maximum number of samples */
@@ -66,6 +80,7 @@ typedef struct radio {
 	double		pilot_phasestep;	/* phase change of pilot tone for each sample */
 	double		tx_pilot_phase;		/* current phase of tx sine */
 	double		rx_pilot_phase;		/* current phase of rx mixer */
+	rds_t		rds_enc;		/* RDS encoder */
 	iir_filter_t	tx_dc_removal[2];	/* AM/FM DC level removal */
 	iir_filter_t	tx_am_bw_limit;		/* AM bandwidth limiter */
 	iir_filter_t	rx_lp_pilot_I;		/* low pass filter for pilot tone extraction */
@@ -83,11 +98,14 @@ typedef struct radio {
 	sample_t	*I_buffer;
 	sample_t	*Q_buffer;
 	sample_t	*carrier_buffer;
+	/* pipeline */
+	radio_stage_t	tx_stage;		/* audio stage of transmitter */
+	radio_stage_t	rx_stage;		/* audio stage of receiver */
 } radio_t;
 
-int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency, const char *tx_wave_file, const char *rx_wave_file, const char *tx_audiodev, const char *rx_audiodev, enum modulation modulation, double bandwidth, double deviation, double modulation_index, double time_constant, double volume, int stereo, int rds, int rds2);
+int radio_init(radio_t *radio, int buffer_size, int samplerate, double frequency, const char *tx_wave_file, const char *rx_wave_file, const char *tx_audiodev, const char *rx_audiodev, enum modulation modulation, double bandwidth, double deviation, double modulation_index, double time_constant, double volume, int stereo, int rds, int rds2, uint16_t rds_pi, const char *rds_ps);
 void radio_exit(radio_t *radio);
-int radio_start(radio_t *radio);
+int radio_start(radio_t *radio, int pipeline);
 int radio_tx(radio_t *radio, float *baseband, int num);
 int radio_rx(radio_t *radio, float *baseband, int num);
 
@@ -0,0 +1,184 @@
+/* RDS encoder
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Groups of type 0A are sent, to transmit PI code and PS name. Each bit is
+ * differentially encoded and sent as a biphase symbol: An impulse at the
+ * start of the bit and an inverted impulse at the middle of the bit, shaped
+ * by the data filter of EN 50067: H(f) = cos(pi * f * td / 4) up to 2 / td.
+ *
+ * The shaped symbol is rendered once for RDS_PHASES sub sample phases.
+ * Symbols overlap, so each symbol is added to a ring of samples, which
+ * takes one add per sample of the symbol.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "rds.h"
+
+#define RDS_BITRATE	1187.5
+#define SYMBOL_BEFORE	1.5	/* bit durations of the shaped symbol before its start */
+#define SYMBOL_LENGTH	4.0	/* bit durations of the shaped symbol */
+#define CHECK_POLY	0x5b9	/* x^10 + x^8 + x^7 + x^5 + x^4 + x^3 + 1 */
+
+/* offset words A, B, C, D */
+static const uint16_t offset_word[4] = { 0x0fc, 0x198, 0x168, 0x1b4 };
+
+/* impulse response of the data filter, t in bit durations */
+static double data_filter(double t)
+{
+	double a = M_PI / 4.0, w = 2.0 * M_PI * t, b = 2.0;
+
+	/* integral of cos(a * f) * cos(w * f) from -b to b, f in bitrate */
+	if (fabs(a - w) < 1e-9 || fabs(a + w) < 1e-9)
+		return b + sin(2.0 * a * b) / (2.0 * a);
+	return sin((a - w) * b) / (a - w) + sin((a + w) * b) / (a + w);
+}
+
+/* biphase symbol, t in bit durations from start of bit */
+static double symbol(double t)
+{
+	return data_filter(t) - data_filter(t - 0.5);
+}
+
+static uint32_t checkword(uint16_t data, int block)
+{
+	uint32_t reg = (uint32_t)data << 10;
+	int i;
+
+	for (i = 25; i >= 10; i--) {
+		if ((reg >> i) & 1)
+			reg ^= CHECK_POLY << (i - 10);
+	}
+	return ((uint32_t)data << 10) | ((reg & 0x3ff) ^ offset_word[block]);
+}
+
+/* build next group 0A */
+static void next_group(rds_t *rds)
+{
+	int seg = rds->segment;
+
+	rds->block[0] = checkword(rds->pi, 0);
+	/* group 0A, no TP, no PTY, no TA, music, no DI, segment */
+	rds->block[1] = checkword((0 << 12) | (1 << 3) | seg, 1);
+	/* no alternative frequencies */
+	rds->block[2] = checkword(0xe0cd, 2);
+	rds->block[3] = checkword(((uint8_t)rds->ps[seg * 2] << 8) | (uint8_t)rds->ps[seg * 2 + 1], 3);
+	rds->segment = (seg + 1) & 3;
+	rds->bit = 0;
+}
+
+int rds_init(rds_t *rds, double samplerate, uint16_t pi, const char *ps)
+{
+	double peak = 0, v;
+	int p, j;
+
+	memset(rds, 0, sizeof(*rds));
+	rds->samples_per_bit = samplerate / RDS_BITRATE;
+	rds->span = ceil(rds->samples_per_bit * SYMBOL_LENGTH) + 1;
+	rds->pulse = calloc(RDS_PHASES * rds->span, sizeof(*rds->pulse));
+	rds->acc = calloc(rds->span, sizeof(*rds->acc));
+	if (!rds->pulse || !rds->acc) {
+		LOGP(DRADIO, LOGL_ERROR, "No memory!\n");
+		rds_exit(rds);
+		return -ENOMEM;
+	}
+
+	/* symbol sample j of phase p is at time j - p / RDS_PHASES after start of symbol */
+	for (p = 0; p < RDS_PHASES; p++) {
+		for (j = 0; j < rds->span; j++) {
+			v = symbol(((double)j - (double)p / RDS_PHASES) / rds->samples_per_bit - SYMBOL_BEFORE);
+			rds->pulse[p * rds->span + j] = v;
+			if (fabs(v) > peak)
+				peak = fabs(v);
+		}
+	}
+	/* normalize, so that the peak of a single symbol is 1 */
+	for (j = 0; j < RDS_PHASES * rds->span; j++)
+		rds->pulse[j] /= peak;
+
+	rds->pi = pi;
+	memset(rds->ps, ' ', sizeof(rds->ps));
+	if (ps)
+		memcpy(rds->ps, ps, (strlen(ps) < sizeof(rds->ps)) ? strlen(ps) : sizeof(rds->ps));
+	next_group(rds);
+
+	LOGP(DRADIO, LOGL_INFO, "RDS with PI 0x%04x and PS '%.8s', %.1f samples per bit.\n", rds->pi, rds->ps, rds->samples_per_bit);
+
+	return 0;
+}
+
+void rds_exit(rds_t *rds)
+{
+	free(rds->pulse);
+	rds->pulse = NULL;
+	free(rds->acc);
+	rds->acc = NULL;
+}
+
+/* add next symbol to the ring, starting at the current sample */
+static void add_symbol(rds_t *rds, double frac)
+{
+	int span = rds->span, pos = rds->acc_pos, j, n;
+	const sample_t *pulse;
+	int bit;
+
+	bit = (rds->block[rds->bit / 26] >> (25 - rds->bit % 26)) & 1;
+	if (++rds->bit == 104)
+		next_group(rds);
+	rds->diff ^= bit;
+
+	pulse = rds->pulse + (int)(frac * RDS_PHASES) * span;
+	/* two linear parts of the ring */
+	n = span - pos;
+	if (rds->diff) {
+		for (j = 0; j < n; j++)
+			rds->acc[pos + j] += pulse[j];
+		for (; j < span; j++)
+			rds->acc[j - n] += pulse[j];
+	} else {
+		for (j = 0; j < n; j++)
+			rds->acc[pos + j] -= pulse[j];
+		for (; j < span; j++)
+			rds->acc[j - n] -= pulse[j];
+	}
+}
+
+/* render RDS base band, peak level of a symbol is 1 */
+void rds_encode(rds_t *rds, sample_t *samples, int length)
+{
+	int i;
+
+	for (i = 0; i < length; i++) {
+		while (rds->next < 1.0) {
+			add_symbol(rds, rds->next);
+			rds->next += rds->samples_per_bit;
+		}
+		samples[i] = rds->acc[rds->acc_pos];
+		rds->acc[rds->acc_pos] = 0;
+		if (++rds->acc_pos == rds->span)
+			rds->acc_pos = 0;
+		rds->next -= 1.0;
+	}
+}
@@ -0,0 +1,22 @@
+
+/* number of sub sample phases of the pulse table */
+#define RDS_PHASES	16
+
+typedef struct rds {
+	double		samples_per_bit;	/* signal samples per RDS bit */
+	int		span;			/* length of one shaped symbol */
+	sample_t	*pulse;			/* symbol for each sub sample phase */
+	sample_t	*acc;			/* ring of overlapping symbols */
+	int		acc_pos;
+	double		next;			/* samples until next symbol starts */
+	uint16_t	pi;			/* program identification */
+	char		ps[8];			/* program service name */
+	uint32_t	block[4];		/* current group with check words */
+	int		bit;			/* next bit of group */
+	int		segment;		/* segment of PS name */
+	int		diff;			/* state of differential encoder */
+} rds_t;
+
+int rds_init(rds_t *rds, double samplerate, uint16_t pi, const char *ps);
+void rds_exit(rds_t *rds);
+void rds_encode(rds_t *rds, sample_t *samples, int length);
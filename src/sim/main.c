@@ -229,37 +229,83 @@ size_t eeprom_length(void)
 
 /* main loop for interfacing serial with sim / sniffer */
 
+struct loop_state {
+	int sniffer;
+	int cts;
+	int skip_bytes;
+	double now, timer;
+};
+
+/* received bytes are delivered as one span */
+static void receive_span(serial_t __attribute__((unused)) *serial, void *priv, const uint8_t *data, int len)
+{
+	struct loop_state *s = priv;
+	int i;
+
+	/* ignore while reset is low */
+	if (s->cts)
+		return;
+
+	for (i = 0; i < len; i++) {
+		s->timer = s->now;
+		/* count length, to remove echo from transmission */
+		if (!s->skip_bytes) {
+			if (s->sniffer == 1)
+				sniffer_rx(&sim_sniffer, data[i]);
+			else
+				sim_rx(&sim_sim, data[i]);
+		} else {
+			/* done eliminating TX data, so we reset timer */
+			if (--s->skip_bytes == 0)
+				s->timer = 0;
+		}
+	}
+}
+
 static int main_loop(serial_t *serial, int sniffer)
 {
-	int rc, cts = 0, last_cts = 0;
+	serial_poll_t *poll;
+	struct loop_state s;
+	int rc, last_cts = 0;
 	uint8_t byte;
-	int skip_bytes = 0;
 	int work = 0;
 
 	struct timeval tv;
-	double now, timer = 0;
+
+	poll = serial_poll_create();
+	if (!poll) {
+		printf("Serial failed: %s\n", serial_errnostr);
+		return -1;
+	}
+	memset(&s, 0, sizeof(s));
+	s.sniffer = sniffer;
+	if (serial_poll_add(poll, serial, 4096, receive_span, &s) < 0) {
+		printf("Serial failed: %s\n", serial_errnostr);
+		serial_poll_destroy(poll);
+		return -1;
+	}
 
 	quit = 0;
 
 	while (!quit) {
 		gettimeofday(&tv, NULL);
-		now = (double)tv.tv_usec * 0.000001 + tv.tv_sec;
+		s.now = (double)tv.tv_usec * 0.000001 + tv.tv_sec;
 
 		/* only check CTS when no work was done
 		 * this is because USB query may take some time
 		 * and we don't want to block transfer
 		 */
 		if (!work) {
-			cts = serial_cts(serial);
+			s.cts = serial_cts(serial);
 			/* initially AND when CTS becomes 1 (pulled to low by reset line) */
-			if (last_cts != cts) {
+			if (last_cts != s.cts) {
 				if (sniffer == 1)
 					sniffer_reset(&sim_sniffer);
 				else
-					sim_reset(&sim_sim, cts);
-				timer = 0;
+					sim_reset(&sim_sim, s.cts);
+				s.timer = 0;
 			}
-			last_cts = cts;
+			last_cts = s.cts;
 		}
 		work = 0;
 
@@ -269,47 +315,32 @@ static int main_loop(serial_t *serial, int sniffer)
 				byte = rc;
 				serial_write(serial, &byte, 1);
 				work = 1;
-				skip_bytes++;
+				s.skip_bytes++;
 			}
 		}
 
-		rc = serial_read(serial, &byte, 1);
+		/* wait some time if there is nothing to transmit */
+		rc = serial_poll_wait(poll, (work) ? 0 : 1);
 		if (rc > 0)
 			work = 1;
 		/* ignore while reset is low */
-		if (cts)
+		if (s.cts)
 			continue;
-		if (rc == 1) {
-			timer = now;
-			/* count length, to remove echo from transmission */
-			if (!skip_bytes) {
-				if (sniffer == 1)
-					sniffer_rx(&sim_sniffer, byte);
-				else
-					sim_rx(&sim_sim, byte);
-			} else {
-				/* done eliminating TX data, so we reset timer */
-				if (--skip_bytes == 0)
-					timer = 0;
-			}
-		} else {
-			rc = -1;
-			if (timer && now - timer > 12.0 * 5.0 / (double)baudrate) {
+		if (rc <= 0) {
+			if (s.timer && s.now - s.timer > 12.0 * 5.0 / (double)baudrate) {
 				if (sniffer == 1)
 					sniffer_timeout(&sim_sniffer);
 				else
 					sim_timeout(&sim_sim);
-				timer = 0;
-				skip_bytes = 0;
+				s.timer = 0;
+				s.skip_bytes = 0;
 			}
 		}
-
-		if (!work) {
-			/* sleep some time if nothing was received */
-			usleep(100);
-		}
 	}
 
+	serial_poll_remove(poll, serial);
+	serial_poll_destroy(poll);
+
 	return quit;
 }
 
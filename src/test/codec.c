@@ -0,0 +1,117 @@
+/* driver of frame codec tests
+ *
+ * Each codec is driven with valid, corrupted and random frames, as fast as
+ * possible for a given time. Valid frames must decode to the same frame
+ * (round trip), otherwise the test fails. Corrupted and random frames must
+ * just not crash. For corrupted frames, the share of bit errors that are
+ * corrected or detected is reported, for random frames the share that is
+ * accepted as frame.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include "codec.h"
+
+static double duration = 0.5;
+static uint32_t seed = 0x12345678;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* xorshift, so the runs can be repeated with the same seed */
+uint32_t codec_random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* fill given number of bits, packed MSB first */
+void codec_random_bits(uint8_t *bits, int num)
+{
+	int i;
+
+	for (i = 0; i < (num + 7) / 8; i++)
+		bits[i] = codec_random();
+	if ((num & 7))
+		bits[num / 8] &= 0xff << (8 - (num & 7));
+}
+
+void codec_flip_bits(uint8_t *bits, int num, int errors)
+{
+	int i, b;
+
+	for (i = 0; i < errors; i++) {
+		b = codec_random() % num;
+		bits[b / 8] ^= 0x80 >> (b & 7);
+	}
+}
+
+/* return number of failed frames */
+static int run(const char *codec, const char *kind, int (*fn)(int i))
+{
+	double begin, elapsed;
+	int i = 0, ok = 0, j;
+
+	if (!fn)
+		return 0;
+
+	begin = now();
+	do {
+		for (j = 0; j < 256; j++, i++) {
+			if (fn(i) == 0)
+				ok++;
+		}
+		elapsed = now() - begin;
+	} while (elapsed < duration);
+
+	printf("%-10s %-8s %12.0f frames/s %6.1f%% ok\n", codec, kind, (double)i / elapsed, (double)ok / (double)i * 100.0);
+
+	return i - ok;
+}
+
+int codec_run(int argc, char *argv[], const struct codec_test *tests, int num)
+{
+	int c, t, failed = 0, f;
+
+	while ((c = getopt(argc, argv, "ht:s:")) != -1) {
+		switch (c) {
+		case 't':
+			duration = atof(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0) ? : 1;
+			break;
+		default:
+			printf("Usage: %s [-t <seconds per test>] [-s <seed>]\n", argv[0]);
+			return 0;
+		}
+	}
+
+	for (t = 0; t < num; t++) {
+		f = run(tests[t].name, "valid", tests[t].valid);
+		if (f) {
+			printf("%s: %d frame(s) failed round trip!\n", tests[t].name, f);
+			failed++;
+		}
+		run(tests[t].name, "corrupt", tests[t].corrupt);
+		run(tests[t].name, "random", tests[t].random);
+	}
+
+	if (failed) {
+		printf("\n******************** FAILED ********************\n\n");
+		return 1;
+	}
+	printf("\n OK ;->\n\n");
+	return 0;
+}
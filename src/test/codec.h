@@ -0,0 +1,14 @@
+
+/* one frame codec, each function processes frame number 'i' and returns 0 on success */
+struct codec_test {
+	const char	*name;
+	int		(*valid)(int i);	/* encode, decode and compare (round trip) */
+	int		(*corrupt)(int i);	/* decode a valid frame with bit errors, 0 if corrected or detected */
+	int		(*random)(int i);	/* decode random bits, 0 if accepted as frame */
+};
+
+uint32_t codec_random(void);
+void codec_random_bits(uint8_t *bits, int num);
+void codec_flip_bits(uint8_t *bits, int num, int errors);
+int codec_run(int argc, char *argv[], const struct codec_test *tests, int num);
+
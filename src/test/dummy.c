@@ -10,9 +10,5 @@ void call_down_answer(void);
 void call_down_answer() { }
 void print_help(void);
 void print_help() { }
-void sender_send(void);
-void sender_send() { }
-void sender_receive(void);
-void sender_receive() { }
 void dump_info(void);
 void dump_info() {}
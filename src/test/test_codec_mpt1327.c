@@ -0,0 +1,89 @@
+/* codec test of MPT1327 codewords */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../liblogging/logging.h"
+#include "../mpt1327/message.h"
+#include "codec.h"
+
+static uint64_t encode(int i)
+{
+	mpt1327_codeword_t codeword;
+	int p;
+
+	memset(&codeword, 0, sizeof(codeword));
+	codeword.type = i % _NUM_MPT_DEFINITIONS;
+	/* start of data is sent like CCSC, the receiver knows it by context only */
+	if (codeword.type == MPT_START_SYNC || codeword.type == MPT_START_SYNT)
+		codeword.type = MPT_CCSC;
+	for (p = 0; p < _NUM_MPT_PARAMETERS; p++)
+		codeword.params[p] = ((uint64_t)codec_random() << 32) | codec_random();
+
+	return mpt1327_encode_codeword(&codeword);
+}
+
+/* check parity and decode, like the receiver does */
+static int decode(mpt1327_codeword_t *codeword, int specific, enum mpt1327_codeword_dir dir, uint64_t bits)
+{
+	if (mpt1327_checkbits(bits, NULL) != (bits & 0xffff))
+		return -1;
+
+	return mpt1327_decode_codeword(codeword, specific, dir, bits);
+}
+
+/* the direction is not known, so try both, some codewords must be given by type */
+static int mpt1327_valid(int i)
+{
+	static const enum mpt1327_codeword_dir dir[2] = { MPT_DOWN, MPT_UP };
+	mpt1327_codeword_t codeword;
+	uint64_t bits;
+	int d;
+
+	bits = encode(i);
+	for (d = 0; d < 4; d++) {
+		if (decode(&codeword, (d < 2) ? -1 : i % _NUM_MPT_DEFINITIONS, dir[d & 1], bits) < 0)
+			continue;
+		if (mpt1327_encode_codeword(&codeword) == bits)
+			return 0;
+	}
+
+	return -1;
+}
+
+/* success, if the bit errors are detected */
+static int mpt1327_corrupt(int i)
+{
+	mpt1327_codeword_t codeword;
+	uint64_t bits;
+
+	bits = encode(i);
+	codec_flip_bits((uint8_t *)&bits, 64, 1 + i % 2);
+
+	return (decode(&codeword, -1, MPT_UP, bits) < 0) ? 0 : -1;
+}
+
+static int mpt1327_random(int __attribute__((unused)) i)
+{
+	mpt1327_codeword_t codeword;
+	uint64_t bits;
+
+	codec_random_bits((uint8_t *)&bits, 64);
+
+	return decode(&codeword, -1, MPT_UP, bits);
+}
+
+static const struct codec_test tests[] = {
+	{ "mpt1327", mpt1327_valid, mpt1327_corrupt, mpt1327_random },
+};
+
+int main(int argc, char *argv[])
+{
+	loglevel = LOGL_ERROR;
+	logging_init();
+
+	init_codeword();
+
+	return codec_run(argc, argv, tests, sizeof(tests) / sizeof(*tests));
+}
@@ -0,0 +1,131 @@
+/* codec test of NMT frames */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../libsample/sample.h"
+#include "../liblogging/logging.h"
+#include "../nmt/nmt.h"
+#include "../nmt/frame.h"
+#include "codec.h"
+
+#define NUM_MT		NMT_MESSAGE_UKN_MTX
+
+const char *nmt_dir_name(enum nmt_direction __attribute__((unused)) dir)
+{
+	return "";
+}
+
+static void random_frame(frame_t *frame, enum nmt_mt mt)
+{
+	memset(frame, 0, sizeof(*frame));
+	frame->mt = mt;
+	frame->channel_no = codec_random();
+	frame->tc_no = codec_random();
+	frame->traffic_area = codec_random();
+	frame->ms_country = codec_random() % 10;
+	frame->ms_number = codec_random() % 1000000;
+	frame->tariff_class = codec_random();
+	frame->line_signal = codec_random();
+	frame->digit = codec_random();
+	frame->idle = 0; /* filler, some messages differ by their filler */
+	frame->chan_act = codec_random();
+	frame->meas_order = codec_random();
+	frame->meas = codec_random();
+	frame->prefix = codec_random();
+	frame->supervisory = codec_random();
+	frame->ms_password = codec_random();
+	frame->area_info = codec_random();
+	frame->additional_info = codec_random();
+	frame->rand = codec_random();
+	frame->sres = codec_random();
+	frame->limit_strength_eval = codec_random();
+	frame->c = codec_random();
+	frame->seq_number = codec_random();
+	frame->checksum = codec_random();
+	frame->waiting_info = codec_random();
+}
+
+/* strip 26 bits of sync from encoded frame */
+static void frame2code(const uint8_t *bits, uint8_t *code)
+{
+	int i;
+
+	for (i = 0; i < NMT_CODE_BYTES; i++)
+		code[i] = (bits[i + 3] << 2) | ((i + 4 < NMT_FRAME_BYTES) ? bits[i + 4] >> 6 : 0);
+	code[NMT_CODE_BYTES - 1] &= 0xf0;
+}
+
+static int encode(enum nmt_mt mt, uint8_t *code)
+{
+	frame_t frame;
+
+	random_frame(&frame, mt);
+	frame2code(encode_frame(450, &frame, 0), code);
+
+	return 0;
+}
+
+/* decode and encode again, the direction is not known, so try both */
+static int round_trip(const uint8_t *code, const uint8_t *expect)
+{
+	static const enum nmt_direction dir[2] = { MTX_TO_XX, XX_TO_MTX };
+	uint8_t again[NMT_CODE_BYTES];
+	frame_t frame;
+	int d;
+
+	for (d = 0; d < 2; d++) {
+		decode_frame(450, &frame, code, dir[d], 0);
+		frame2code(encode_frame(450, &frame, 0), again);
+		if (!memcmp(expect, again, NMT_CODE_BYTES))
+			return 0;
+	}
+
+	return -1;
+}
+
+static int nmt_valid(int i)
+{
+	uint8_t code[NMT_CODE_BYTES];
+
+	encode(i % NUM_MT, code);
+
+	return round_trip(code, code);
+}
+
+/* success, if the bit errors are corrected */
+static int nmt_corrupt(int i)
+{
+	uint8_t code[NMT_CODE_BYTES], corrupt[NMT_CODE_BYTES];
+
+	encode(i % NUM_MT, code);
+	memcpy(corrupt, code, NMT_CODE_BYTES);
+	codec_flip_bits(corrupt, 140, 1 + i % 4);
+
+	return round_trip(corrupt, code);
+}
+
+static int nmt_random(int __attribute__((unused)) i)
+{
+	uint8_t code[NMT_CODE_BYTES];
+	frame_t frame;
+
+	codec_random_bits(code, 140);
+
+	return decode_frame(450, &frame, code, XX_TO_MTX, 0);
+}
+
+static const struct codec_test tests[] = {
+	{ "nmt", nmt_valid, nmt_corrupt, nmt_random },
+};
+
+int main(int argc, char *argv[])
+{
+	loglevel = LOGL_ERROR;
+	logging_init();
+
+	init_frame();
+
+	return codec_run(argc, argv, tests, sizeof(tests) / sizeof(*tests));
+}
@@ -0,0 +1,115 @@
+/* codec test of Radiocom 2000 frames */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../liblogging/logging.h"
+#include "../r2000/frame.h"
+#include "codec.h"
+
+#define CODE_BYTES	22	/* 176 bits from relais to mobile station */
+
+static uint8_t messages[32];
+static int num_messages = 0;
+
+static void random_frame(frame_t *frame, uint8_t message)
+{
+	int i;
+
+	memset(frame, 0, sizeof(*frame));
+	frame->voie = codec_random();
+	frame->channel = codec_random();
+	frame->relais = codec_random();
+	frame->message = message;
+	frame->deport = codec_random();
+	frame->agi = codec_random();
+	frame->sm_power = codec_random();
+	frame->taxe = codec_random();
+	frame->sm_type = codec_random();
+	frame->sm_relais = codec_random();
+	frame->sm_flotte = codec_random();
+	frame->sm_mor = codec_random();
+	frame->sm_mop_demandee = codec_random();
+	frame->chan_assign = codec_random();
+	frame->crins = codec_random();
+	frame->sequence = codec_random();
+	frame->invitation = codec_random();
+	frame->nconv = codec_random();
+	for (i = 0; i < 10; i++)
+		frame->digit[i] = codec_random() % 10;
+}
+
+/* code without 32 bits of sync */
+static void encode(int i, uint8_t *code)
+{
+	frame_t frame;
+
+	random_frame(&frame, messages[i % num_messages]);
+	memcpy(code, encode_frame(&frame, 0) + 4, CODE_BYTES);
+}
+
+static int round_trip(const uint8_t *code, const uint8_t *expect)
+{
+	frame_t frame;
+
+	if (decode_frame(&frame, code, CODE_BYTES * 8) < 0)
+		return -1;
+
+	return memcmp(expect, encode_frame(&frame, 0) + 4, CODE_BYTES) ? -1 : 0;
+}
+
+static int r2000_valid(int i)
+{
+	uint8_t code[CODE_BYTES];
+
+	encode(i, code);
+
+	return round_trip(code, code);
+}
+
+/* success, if the bit errors are corrected */
+static int r2000_corrupt(int i)
+{
+	uint8_t code[CODE_BYTES], corrupt[CODE_BYTES];
+
+	encode(i, code);
+	memcpy(corrupt, code, CODE_BYTES);
+	codec_flip_bits(corrupt, CODE_BYTES * 8, 1 + i % 4);
+
+	return round_trip(corrupt, code);
+}
+
+/* alternate between both directions, mobile stations send 144 bits */
+static int r2000_random(int i)
+{
+	uint8_t code[CODE_BYTES];
+	frame_t frame;
+	int num = (i & 1) ? 144 : CODE_BYTES * 8;
+
+	codec_random_bits(code, num);
+
+	return decode_frame(&frame, code, num);
+}
+
+static const struct codec_test tests[] = {
+	{ "r2000", r2000_valid, r2000_corrupt, r2000_random },
+};
+
+int main(int argc, char *argv[])
+{
+	int m;
+
+	loglevel = LOGL_ERROR;
+	logging_init();
+
+	init_frame();
+
+	/* only messages that the relais sends can be encoded */
+	for (m = 0; m < 32; m++) {
+		if (strncmp(r2000_frame_name(m, REL_TO_SM), "UNKNOWN", 7))
+			messages[num_messages++] = m;
+	}
+
+	return codec_run(argc, argv, tests, sizeof(tests) / sizeof(*tests));
+}
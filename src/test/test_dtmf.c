@@ -60,13 +60,13 @@ int main(void)
 	dtmf_dec_t dtmf_dec;
 	dtmf_enc_t dtmf_enc;
 	sample_t frequency1[SAMPLERATE], frequency2[SAMPLERATE], amplitude1[SAMPLERATE], amplitude2[SAMPLERATE];
-	int f, i;
+	int f, i, m;
 	double target;
 
 	fm_init(0);
 
 	/* decoder uses a strict frequency offset of 0.1 percent. */
-	dtmf_decode_init(&dtmf_dec, NULL, recv_digit, SAMPLERATE, db2level(0), db2level(-30.0), 0.1);
+	dtmf_decode_init(&dtmf_dec, NULL, recv_digit, SAMPLERATE, db2level(0), db2level(-30.0), 0.1, DTMF_DECODE_FM);
 
 	for (f = 0; f < 8; f++) {
 		printf("Testing filter with frequency %.0f Hz:\n", test_frequency[f]);
@@ -94,20 +94,27 @@ int main(void)
 
 	dtmf_encode_init(&dtmf_enc, SAMPLERATE, 1.0);
 
-	for (i = 0; i < 16; i++) {
-		printf("Testing digit '%c' encoding and decoding:\n", test_digits[i]);
-		memset(samples, 0, sizeof(samples[0]) * SAMPLERATE);
-		dtmf_encode_set_tone(&dtmf_enc, test_digits[i], 1.0, 0.0);
-		dtmf_encode(&dtmf_enc, samples + SAMPLERATE / 10, SAMPLERATE / 20);
-		got_digit = 0;
-		dtmf_decode(&dtmf_dec, samples, SAMPLERATE);
-		if (got_digit == 0)
-			printf("**** ERROR: we expected to decode digit '%c', but nothing was decoded\n", test_digits[i]);
-		else if (got_digit != test_digits[i])
-			printf("**** ERROR: we expected to decode digit '%c', but we decoded digit '%c'\n", test_digits[i], got_digit);
-		else
-			printf("OK!\n");
-		puts("");
+	for (m = 0; m < 2; m++) {
+		if (m == 1) {
+			/* same test with Goertzel filter bank, frequency is measured less accurate, so use default offset */
+			dtmf_decode_exit(&dtmf_dec);
+			dtmf_decode_init(&dtmf_dec, NULL, recv_digit, SAMPLERATE, db2level(0), db2level(-30.0), DTMF_FREQ_MARGIN_PERCENT_DEFAULT, DTMF_DECODE_GOERTZEL);
+		}
+		for (i = 0; i < 16; i++) {
+			printf("Testing digit '%c' encoding and decoding:\n", test_digits[i]);
+			memset(samples, 0, sizeof(samples[0]) * SAMPLERATE);
+			dtmf_encode_set_tone(&dtmf_enc, test_digits[i], 1.0, 0.0);
+			dtmf_encode(&dtmf_enc, samples + SAMPLERATE / 10, SAMPLERATE / 20);
+			got_digit = 0;
+			dtmf_decode(&dtmf_dec, samples, SAMPLERATE);
+			if (got_digit == 0)
+				printf("**** ERROR: we expected to decode digit '%c', but nothing was decoded\n", test_digits[i]);
+			else if (got_digit != test_digits[i])
+				printf("**** ERROR: we expected to decode digit '%c', but we decoded digit '%c'\n", test_digits[i], got_digit);
+			else
+				printf("OK!\n");
+			puts("");
+		}
 	}
 
 	dtmf_decode_exit(&dtmf_dec);
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <math.h>
 #include <string.h>
+#include <sys/time.h>
 #include "../libsample/sample.h"
 #include "../libfilter/iir_filter.h"
 #include "../libfilter/fir_filter.h"
@@ -35,6 +36,26 @@ static void gen_samples(sample_t *samples, double freq)
 	}
 }
 
+static double get_level_num(sample_t *samples, int num)
+{
+	int i;
+	double envelope = 0;
+	for (i = num/2; i < num; i++) {
+		if (samples[i] > envelope)
+			envelope = samples[i];
+	}
+
+	return envelope;
+}
+
+static double get_time(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
 int num_kanal;
 
 int main(void)
@@ -42,10 +63,13 @@ int main(void)
 	iir_filter_t filter_low;
 	iir_filter_t filter_high;
 	fir_filter_t	*fir_low/*, *fir_high*/;
+	fir_filter_t	*fir_dec, *fir_int;
 	sample_t samples[SAMPLERATE];
-	double level;
+	static sample_t samples_int[SAMPLERATE * 4];
+	double level, t;
 	int iter = 2;
-	int i;
+	int factor = 4;
+	int i, n, rounds;
 
 	printf("testing low-pass filter with %d iterations\n", iter);
 
@@ -142,6 +166,58 @@ int main(void)
 	}
 	fir_exit(fir_low);
 
+	printf("testing decimating FIR filter by %d with %.0fHz transition bandwidth\n", factor, tb);
+
+	fir_dec = fir_decimate_init(SAMPLERATE, factor, freq, tb);
+
+	for (i = 0; i < 4001; i += 100) {
+		gen_samples(samples, (double)i);
+		n = fir_decimate_process(fir_dec, samples, SAMPLERATE, samples);
+		level = get_level_num(samples, n);
+		printf("%s%s%4d Hz: %.1f dB", debug_amplitude(level), debug_db(level), i, level2db(level));
+		if (i == freq)
+			printf(" cutoff\n");
+		else
+			printf("\n");
+	}
+
+	printf("testing interpolating FIR filter by %d with %.0fHz transition bandwidth\n", factor, tb);
+
+	fir_int = fir_interpolate_init(SAMPLERATE * factor, factor, freq, tb);
+
+	for (i = 0; i < 4001; i += 100) {
+		gen_samples(samples, (double)i);
+		n = fir_interpolate_process(fir_int, samples, SAMPLERATE, samples_int);
+		level = get_level_num(samples_int, n);
+		printf("%s%s%4d Hz: %.1f dB", debug_amplitude(level), debug_db(level), i, level2db(level));
+		if (i == freq)
+			printf(" cutoff\n");
+		else
+			printf("\n");
+	}
+
+	/* compare with filtering all samples at the high rate, no FFT, so the
+	 * direct convolution is compared */
+	rounds = 10;
+	gen_samples(samples, 1000.0);
+	fir_low = fir_lowpass_init(SAMPLERATE, freq, tb);
+	fir_low->fft_m = 0;
+	t = get_time();
+	for (i = 0; i < rounds; i++)
+		fir_process(fir_low, samples, SAMPLERATE);
+	printf("full rate FIR filter: %.3f mega samples/sec\n", (double)(SAMPLERATE * rounds) / (get_time() - t) / 1e6);
+	fir_exit(fir_low);
+	t = get_time();
+	for (i = 0; i < rounds; i++)
+		fir_decimate_process(fir_dec, samples, SAMPLERATE, samples_int);
+	printf("decimating FIR filter: %.3f mega samples/sec (input)\n", (double)(SAMPLERATE * rounds) / (get_time() - t) / 1e6);
+	t = get_time();
+	for (i = 0; i < rounds; i++)
+		fir_interpolate_process(fir_int, samples, SAMPLERATE, samples_int);
+	printf("interpolating FIR filter: %.3f mega samples/sec (output)\n", (double)(SAMPLERATE * factor * rounds) / (get_time() - t) / 1e6);
+	fir_exit(fir_dec);
+	fir_exit(fir_int);
+
 #if 0
 	double freq1 = 1000.0, freq2 = 2000.0;
 	tb = 100.0;
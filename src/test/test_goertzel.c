@@ -27,6 +27,7 @@ int num_kanal;
 int main(void)
 {
 	goertzel_t goertzel;
+	tone_track_t tt;
 	sample_t samples[SAMPLERATE];
 	double frequency = 1000;
 	double duration = 1.0/100.0;
@@ -46,6 +47,23 @@ int main(void)
 			printf("\n");
 	}
 
+	printf("testing sliding DFT with frequency %.1f and duration 1 / %.0f\n", frequency, 1.0 / duration);
+
+	tone_track_init(&tt, &frequency, 1, SAMPLERATE, SAMPLERATE * duration);
+	for (i = 700; i < 1301; i = i + 50) {
+		gen_samples(samples, (double)i);
+		/* slide over the whole second, level must not drift */
+		tone_track_reset(&tt);
+		tone_track_process(&tt, samples, SAMPLERATE);
+		tone_track_levels(&tt, &level);
+		printf("%s%.0f Hz: %.1f dB", debug_db(level), i, level2db(level));
+		if ((int)round(i) == (int)round(frequency))
+			printf(" level=%.6f\n", level);
+		else
+			printf("\n");
+	}
+	tone_track_exit(&tt);
+
 	return 0;
 }
 
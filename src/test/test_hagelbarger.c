@@ -16,6 +16,7 @@ int main(void)
 	hagelbarger_encode(message, code, 70);
 
 	/* decode */
+	printf("Parity failures without corruption: %d (must be 0)\n", hagelbarger_check(code, 64));
 	hagelbarger_decode(code, message, 64);
 	printf("Decoded without corruption: %s (must be the same as above)\n", message);
 
@@ -25,6 +26,7 @@ int main(void)
 	code[7] ^= 0xfc;
 
 	/* decode */
+	printf("Parity failures with corruption: %d (must not be 0)\n", hagelbarger_check(code, 64));
 	hagelbarger_decode(code, message, 64);
 	printf("Decoded with corruption: %s (must be the same as above)\n", message);
 
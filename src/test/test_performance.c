@@ -1,91 +1,869 @@
+/* benchmark of DSP libraries
+ *
+ * Every benchmark processes blocks of samples at the block size and sample
+ * rate that is used by the networks. After a warm-up, each benchmark is
+ * repeated. The result is the throughput of each repetition and percentiles of
+ * the time that each block took. Use '-j' to get JSON output that can be
+ * compared between builds and CPUs.
+ */
+
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <math.h>
 #include <string.h>
-#include <sys/time.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/utsname.h>
 #include "../libsample/sample.h"
+#include "../libsample/kernels.h"
 #include "../libfilter/iir_filter.h"
+#include "../libfilter/fir_filter.h"
 #include "../libfm/fm.h"
+#include "../libam/am.h"
+#include "../libfft/fft.h"
+#include "../libsamplerate/samplerate.h"
+#include "../libgoertzel/goertzel.h"
+#include "../libdtmf/dtmf_encode.h"
+#include "../libdtmf/dtmf_decode.h"
+#include "../libfsk/fsk.h"
+#include "../libv27/modem.h"
+#include "../libcompandor/compandor.h"
+#include "../libclipper/clipper.h"
+#include "../libsendevolumenregler/sendevolumenregler.h"
+#include "../libemphasis/emphasis.h"
+#include "../libscrambler/scrambler.h"
+#include "../libjitter/jitter.h"
 #include "../liblogging/logging.h"
 
-struct timeval start_tv, tv;
-double duration;
-int tot_samples;
+#define MAX_BLOCK	8192
 
-#define T_START() \
-	gettimeofday(&start_tv, NULL); \
-	tot_samples = 0; \
-	while (1) {
+struct bench {
+	const char	*name;
+	const char	*library;
+	int		samplerate;	/* 0, if the kernel is not bound to a rate */
+	int		block;		/* samples per call */
+	int		math;		/* fast math mode of libfm and libam, mode of libsamplerate */
+	int		param;
+	int		(*init)(struct bench *b);
+	void		(*run)(struct bench *b);
+	void		(*exit)(struct bench *b);
+};
 
-#define T_STOP(what, samples) \
-		gettimeofday(&tv, NULL); \
-		duration = (double)tv.tv_sec + (double)tv.tv_usec / 1e6; \
-		duration -= (double)start_tv.tv_sec + (double)start_tv.tv_usec / 1e6; \
-		tot_samples += samples; \
-		if (duration >= 2) \
-			break; \
-	} \
-	printf("%s: %.3f mega samples/sec\n", what, (double)tot_samples / duration / 1e6); \
+/* input is a 1 KHz tone with 2.5 KHz deviation, in-place kernels process a copy of it */
+static sample_t input[MAX_BLOCK], speech[MAX_BLOCK], work[MAX_BLOCK * 8], I[MAX_BLOCK], Q[MAX_BLOCK], carrier[MAX_BLOCK];
+static uint8_t power[MAX_BLOCK];
+static int16_t spl[MAX_BLOCK];
+static float baseband[MAX_BLOCK * 2];
+static uint8_t bytes[MAX_BLOCK];
 
+static fm_mod_t fm_mod;
+static fm_demod_t fm_demod;
+static am_mod_t am_mod;
+static am_demod_t am_demod;
+static iir_filter_t iir;
+static fir_filter_t *fir;
+static fft_plan_t fft;
+static samplerate_t resampler;
+static goertzel_t goertzel[2];
+static tone_track_t tone_track;
+static dtmf_enc_t dtmf_enc;
+static dtmf_dec_t dtmf_dec;
+static fsk_mod_t fsk_mod;
+static fsk_demod_t fsk_demod;
+static v27modem_t v27_modem;
+static v27scrambler_t v27_scrambler;
+static compandor_t compandor;
+static sendevolumenregler_t sendevolumenregler_state;
+static emphasis_t emphasis;
+static scrambler_t scrambler_state;
+static jitter_t jitter;
+static uint16_t jitter_sequence;
+static uint32_t jitter_timestamp;
 
-#define SAMPLES 1000
-sample_t samples[SAMPLES], I[SAMPLES], Q[SAMPLES];
-uint8_t power[SAMPLES];
-float buff[SAMPLES * 2];
-fm_mod_t mod;
-fm_demod_t demod;
-iir_filter_t lp;
+static const double tones[2] = { 1209.0, 1633.0 };
 
-int main(void)
+static void copy_input(int block)
 {
-	memset(power, 1, sizeof(power));
+	memcpy(work, input, block * sizeof(*work));
+}
+
+static void copy_speech(int block)
+{
+	memcpy(work, speech, block * sizeof(*work));
+}
+
+static int send_bit(void __attribute__((unused)) *inst)
+{
+	static uint32_t lfsr = 1;
+
+	lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xd0000001);
+	return lfsr & 1;
+}
+
+static void receive_fsk_bit(void __attribute__((unused)) *inst, int __attribute__((unused)) bit, double __attribute__((unused)) quality, double __attribute__((unused)) level)
+{
+}
+
+static void receive_v27_bit(void __attribute__((unused)) *inst, int __attribute__((unused)) bit)
+{
+}
+
+static void recv_digit(void __attribute__((unused)) *priv, char __attribute__((unused)) digit, dtmf_meas_t __attribute__((unused)) *meas)
+{
+}
+
+/* libsample */
+
+static void run_to_int16(struct bench *b)
+{
+	samples_to_int16_scale(spl, 1, input, b->block, 10.0);
+}
+
+static void run_from_int16(struct bench *b)
+{
+	int16_to_samples_scale(work, spl, 1, b->block, 0.1);
+}
+
+/* libfm / libam */
+
+static int init_fm_mod(struct bench *b)
+{
+	return fm_mod_init(&fm_mod, b->samplerate, 0, 0.333);
+}
+
+static void run_fm_mod(struct bench *b)
+{
+	fm_modulate_complex(&fm_mod, input, power, b->block, baseband);
+}
+
+static void exit_fm_mod(struct bench __attribute__((unused)) *b)
+{
+	fm_mod_exit(&fm_mod);
+}
+
+static int init_fm_demod(struct bench *b)
+{
+	int rc;
+
+	/* demodulate what the modulator produced */
+	rc = fm_mod_init(&fm_mod, b->samplerate, b->param, 0.333);
+	if (rc < 0)
+		return rc;
+	fm_modulate_complex(&fm_mod, input, power, b->block, baseband);
+	fm_mod_exit(&fm_mod);
+	return fm_demod_init(&fm_demod, b->samplerate, b->param, 10000.0);
+}
+
+static void run_fm_demod(struct bench *b)
+{
+	fm_demodulate_complex(&fm_demod, work, b->block, baseband, I, Q);
+}
+
+static void exit_fm_demod(struct bench __attribute__((unused)) *b)
+{
+	fm_demod_exit(&fm_demod);
+}
+
+static int init_am_mod(struct bench *b)
+{
+	return am_mod_init(&am_mod, b->samplerate, 0, 0.5, 0.5);
+}
+
+static void run_am_mod(struct bench *b)
+{
+	am_modulate_complex(&am_mod, input, power, b->block, baseband);
+}
+
+static void exit_am_mod(struct bench __attribute__((unused)) *b)
+{
+	am_mod_exit(&am_mod);
+}
+
+static int init_am_demod(struct bench *b)
+{
+	int rc;
+
+	rc = am_mod_init(&am_mod, b->samplerate, 0, 0.5, 0.5);
+	if (rc < 0)
+		return rc;
+	am_modulate_complex(&am_mod, input, power, b->block, baseband);
+	am_mod_exit(&am_mod);
+	rc = am_demod_init(&am_demod, b->samplerate, 0, 0.5, 0.5);
+	if (rc < 0)
+		return rc;
+	/* param selects synchronous demodulation */
+	am_demod_sync(&am_demod, b->param);
+	return 0;
+}
+
+static void run_am_demod(struct bench *b)
+{
+	am_demodulate_complex(&am_demod, work, b->block, baseband, I, Q, carrier);
+}
+
+static void exit_am_demod(struct bench __attribute__((unused)) *b)
+{
+	am_demod_exit(&am_demod);
+}
+
+/* libfilter */
+
+static int init_iir(struct bench *b)
+{
+	iir_lowpass_init(&iir, 3400.0, b->samplerate, b->param);
+	return 0;
+}
+
+static void run_iir(struct bench *b)
+{
+	copy_input(b->block);
+	iir_process(&iir, work, b->block);
+}
+
+static int init_fir(struct bench *b)
+{
+	fir = fir_lowpass_init(b->samplerate, 3400.0, 500.0);
+	return (fir) ? 0 : -1;
+}
+
+static void run_fir(struct bench *b)
+{
+	copy_input(b->block);
+	fir_process(fir, work, b->block);
+}
+
+static int init_fir_decimate(struct bench *b)
+{
+	fir = fir_decimate_init(b->samplerate, b->param, 3400.0, 500.0);
+	return (fir) ? 0 : -1;
+}
+
+static void run_fir_decimate(struct bench *b)
+{
+	fir_decimate_process(fir, input, b->block, work);
+}
+
+static void exit_fir(struct bench __attribute__((unused)) *b)
+{
+	fir_exit(fir);
+	fir = NULL;
+}
+
+/* libfft */
+
+static int init_fft(struct bench *b)
+{
+	int m;
+
+	for (m = 0; (1 << m) < b->block; m++);
+	return fft_plan_init(&fft, m);
+}
+
+static void run_fft_complex(struct bench *b)
+{
+	int i;
+
+	for (i = 0; i < b->block; i++) {
+		baseband[i * 2] = input[i];
+		baseband[i * 2 + 1] = 0.0;
+	}
+	fft_plan_complex(&fft, 1, baseband);
+}
+
+static void run_fft_real(struct bench *b)
+{
+	int i;
+
+	for (i = 0; i < b->block; i++)
+		baseband[i] = input[i];
+	fft_plan_real(&fft, baseband, baseband + b->block);
+}
+
+static void exit_fft(struct bench __attribute__((unused)) *b)
+{
+	fft_plan_exit(&fft);
+}
+
+/* libsamplerate, param is the lower sample rate */
+
+static int init_resample(struct bench *b)
+{
+	if (b->samplerate > b->param)
+		return init_samplerate(&resampler, b->param, b->samplerate, 3300.0, b->math);
+	return init_samplerate(&resampler, b->samplerate, b->param, 3300.0, b->math);
+}
+
+static void run_downsample(struct bench *b)
+{
+	copy_input(b->block);
+	samplerate_downsample(&resampler, work, b->block);
+}
+
+static void run_upsample(struct bench *b)
+{
+	int num;
+
+	num = samplerate_upsample_output_num(&resampler, b->block);
+	samplerate_upsample(&resampler, input, b->block, work, num);
+}
+
+/* libgoertzel */
+
+static int init_goertzel(struct bench *b)
+{
+	audio_goertzel_init(&goertzel[0], tones[0], b->samplerate);
+	audio_goertzel_init(&goertzel[1], tones[1], b->samplerate);
+	return 0;
+}
+
+static void run_goertzel(struct bench *b)
+{
+	double result[2];
+
+	audio_goertzel(goertzel, input, b->block, 0, result, 2);
+}
+
+static int init_tone_track(struct bench *b)
+{
+	return tone_track_init(&tone_track, tones, 2, b->samplerate, b->block);
+}
+
+static void run_tone_track(struct bench *b)
+{
+	double result[2];
+
+	tone_track_process(&tone_track, input, b->block);
+	tone_track_levels(&tone_track, result);
+}
+
+static void exit_tone_track(struct bench __attribute__((unused)) *b)
+{
+	tone_track_exit(&tone_track);
+}
+
+/* libdtmf */
+
+static int init_dtmf_encode(struct bench *b)
+{
+	dtmf_encode_init(&dtmf_enc, b->samplerate, 0.0);
+	return 0;
+}
+
+static void run_dtmf_encode(struct bench *b)
+{
+	int count;
+
+	count = dtmf_encode(&dtmf_enc, work, b->block);
+	if (count < b->block)
+		dtmf_encode_set_tone(&dtmf_enc, '5', 0.060, 0.040);
+}
+
+static int init_dtmf_decode(struct bench *b)
+{
+	int i;
+
+	/* decode continuous digits */
+	dtmf_encode_init(&dtmf_enc, b->samplerate, 0.0);
+	for (i = 0; i < b->block * 8; i += b->block) {
+		if (dtmf_encode(&dtmf_enc, work + i, b->block) < b->block)
+			dtmf_encode_set_tone(&dtmf_enc, '5', 0.060, 0.040);
+	}
+	return dtmf_decode_init(&dtmf_dec, NULL, recv_digit, b->samplerate, 1.0, 0.01, DTMF_FREQ_MARGIN_PERCENT_DEFAULT, b->param);
+}
+
+static void run_dtmf_decode(struct bench *b)
+{
+	static int pos = 0;
+
+	dtmf_decode(&dtmf_dec, work + pos * b->block, b->block);
+	pos = (pos + 1) & 7;
+}
+
+static void exit_dtmf_decode(struct bench __attribute__((unused)) *b)
+{
+	dtmf_decode_exit(&dtmf_dec);
+}
+
+/* libfsk, param is the bit rate */
+
+static int init_fsk_mod(struct bench *b)
+{
+	return fsk_mod_init(&fsk_mod, NULL, send_bit, b->samplerate, b->param, 1800.0, 1200.0, 1.0, 1, 0);
+}
+
+static void run_fsk_mod(struct bench *b)
+{
+	fsk_mod_send(&fsk_mod, work, b->block, 0);
+}
+
+static void exit_fsk_mod(struct bench __attribute__((unused)) *b)
+{
+	fsk_mod_cleanup(&fsk_mod);
+}
+
+static int init_fsk_demod(struct bench *b)
+{
+	int rc, i;
+
+	rc = fsk_mod_init(&fsk_mod, NULL, send_bit, b->samplerate, b->param, 1800.0, 1200.0, 1.0, 1, 0);
+	if (rc < 0)
+		return rc;
+	for (i = 0; i < b->block * 8; i += b->block)
+		fsk_mod_send(&fsk_mod, work + i, b->block, 0);
+	fsk_mod_cleanup(&fsk_mod);
+	return fsk_demod_init(&fsk_demod, NULL, receive_fsk_bit, b->samplerate, b->param, 1800.0, 1200.0, 0.1);
+}
 
-	fm_init(0);
+static void run_fsk_demod(struct bench *b)
+{
+	static int pos = 0;
 
-	fm_mod_init(&mod, 50000, 0, 0.333);
-	T_START()
-	fm_modulate_complex(&mod, samples, power, SAMPLES, buff);
-	T_STOP("FM modulate", SAMPLES)
-	fm_mod_exit(&mod);
+	fsk_demod_receive(&fsk_demod, work + pos * b->block, b->block);
+	pos = (pos + 1) & 7;
+}
 
-	fm_demod_init(&demod, 50000, 0, 10000.0);
-	T_START()
-	fm_demodulate_complex(&demod, samples, SAMPLES, buff, I, Q);
-	T_STOP("FM demodulate", SAMPLES)
-	fm_demod_exit(&demod);
+static void exit_fsk_demod(struct bench __attribute__((unused)) *b)
+{
+	fsk_demod_cleanup(&fsk_demod);
+}
 
-	fm_exit();
-	fm_init(1);
+/* libv27 */
 
-	fm_mod_init(&mod, 50000, 0, 0.333);
-	T_START()
-	fm_modulate_complex(&mod, samples, power, SAMPLES, buff);
-	T_STOP("FM modulate (fast math)", SAMPLES)
-	fm_mod_exit(&mod);
+static int init_v27(struct bench *b)
+{
+	int rc, i;
 
-	fm_demod_init(&demod, 50000, 0, 10000.0);
-	T_START()
-	fm_demodulate_complex(&demod, samples, SAMPLES, buff, I, Q);
-	T_STOP("FM demodulate (fast math)", SAMPLES)
-	fm_demod_exit(&demod);
+	rc = v27_modem_init(&v27_modem, NULL, send_bit, receive_v27_bit, b->samplerate, 1);
+	if (rc < 0)
+		return rc;
+	for (i = 0; i < b->block * 8; i += b->block)
+		v27_modem_send(&v27_modem, work + i, b->block);
+	return 0;
+}
 
-	iir_lowpass_init(&lp, 10000.0 / 2.0, 50000, 1);
-	T_START()
-	iir_process(&lp, samples, SAMPLES);
-	T_STOP("low-pass filter (second order)", SAMPLES)
+static void run_v27_send(struct bench *b)
+{
+	v27_modem_send(&v27_modem, I, b->block);
+}
 
-	iir_lowpass_init(&lp, 10000.0 / 2.0, 50000, 2);
-	T_START()
-	iir_process(&lp, samples, SAMPLES);
-	T_STOP("low-pass filter (fourth order)", SAMPLES)
+static void run_v27_receive(struct bench *b)
+{
+	static int pos = 0;
 
-	iir_lowpass_init(&lp, 10000.0 / 2.0, 50000, 4);
-	T_START()
-	iir_process(&lp, samples, SAMPLES);
-	T_STOP("low-pass filter (eighth order)", SAMPLES)
+	v27_modem_receive(&v27_modem, work + pos * b->block, b->block);
+	pos = (pos + 1) & 7;
+}
 
-	fm_exit();
+static void exit_v27(struct bench __attribute__((unused)) *b)
+{
+	v27_modem_exit(&v27_modem);
+}
 
+/* the block of the V.27 scrambler is given in bits */
+static int init_v27_scrambler(struct bench __attribute__((unused)) *b)
+{
+	v27_scrambler_init(&v27_scrambler, 1, 0);
 	return 0;
 }
 
+static void run_v27_scrambler(struct bench *b)
+{
+	v27_scrambler_block(&v27_scrambler, bytes, b->block / 8);
+}
+
+/* libcompandor */
+
+static int init_compandor(struct bench *b)
+{
+	setup_compandor(&compandor, b->samplerate, 3.0, 13.5);
+	return 0;
+}
+
+static void run_compress(struct bench *b)
+{
+	copy_input(b->block);
+	compress_audio(&compandor, work, b->block);
+}
+
+static void run_expand(struct bench *b)
+{
+	copy_input(b->block);
+	expand_audio(&compandor, work, b->block);
+}
+
+/* libclipper */
+
+static int init_clipper(struct bench *b)
+{
+	clipper_init((double)b->param / 100.0);
+	return 0;
+}
+
+static void run_clipper(struct bench *b)
+{
+	copy_speech(b->block);
+	clipper_process(work, b->block);
+}
+
+/* libsendevolumenregler */
+
+static int init_regler(struct bench *b)
+{
+	init_sendevolumenregler(&sendevolumenregler_state, b->samplerate, -1000.0, 4.3, 2.6, -16.0, SPEECH_LEVEL);
+	return 0;
+}
+
+static void run_regler(struct bench *b)
+{
+	copy_speech(b->block);
+	sendevolumenregler(&sendevolumenregler_state, work, b->block);
+}
+
+/* libemphasis */
+
+static int init_emphasis_state(struct bench *b)
+{
+	return init_emphasis(&emphasis, b->samplerate, CUT_OFF_EMPHASIS_DEFAULT, CUT_OFF_HIGHPASS_DEFAULT, CUT_OFF_LOWPASS_DEFAULT);
+}
+
+static void run_pre_emphasis(struct bench *b)
+{
+	copy_input(b->block);
+	pre_emphasis(&emphasis, work, b->block);
+}
+
+static void run_de_emphasis(struct bench *b)
+{
+	copy_input(b->block);
+	de_emphasis(&emphasis, work, b->block);
+}
+
+/* libscrambler */
+
+static int init_scrambler(struct bench *b)
+{
+	scrambler_setup(&scrambler_state, b->samplerate);
+	return 0;
+}
+
+static void run_scrambler(struct bench *b)
+{
+	copy_input(b->block);
+	scrambler(&scrambler_state, work, b->block);
+}
+
+/* libjitter, one frame is stored and one frame is read */
+
+static int init_jitter(struct bench *b)
+{
+	jitter_sequence = 0;
+	jitter_timestamp = 0;
+	return jitter_create(&jitter, "benchmark", b->samplerate, JITTER_AUDIO);
+}
+
+static void run_jitter(struct bench *b)
+{
+	jitter_frame_t *jf;
+
+	jf = jitter_frame_alloc(&jitter, NULL, NULL, (uint8_t *)spl, b->block * sizeof(*spl), 0, jitter_sequence, jitter_timestamp, 1);
+	if (jf)
+		jitter_save(&jitter, jf);
+	jitter_sequence++;
+	jitter_timestamp += b->block;
+	jitter_load_samples(&jitter, (uint8_t *)(spl + b->block), b->block, sizeof(*spl), jitter_conceal_s16, NULL);
+}
+
+static void exit_jitter(struct bench __attribute__((unused)) *b)
+{
+	jitter_destroy(&jitter);
+}
+
+static struct bench benchmarks[] = {
+	{ "samples to int16", "libsample", 48000, 480, 0, 0, NULL, run_to_int16, NULL },
+	{ "int16 to samples", "libsample", 48000, 480, 0, 0, NULL, run_from_int16, NULL },
+	{ "FM modulate", "libfm", 50000, 500, FM_MATH_LIBM, 0, init_fm_mod, run_fm_mod, exit_fm_mod },
+	{ "FM modulate (fast math)", "libfm", 50000, 500, FM_MATH_TABLE, 0, init_fm_mod, run_fm_mod, exit_fm_mod },
+	{ "FM modulate (vector math)", "libfm", 50000, 500, FM_MATH_VECTOR, 0, init_fm_mod, run_fm_mod, exit_fm_mod },
+	{ "FM demodulate", "libfm", 50000, 500, FM_MATH_LIBM, 0, init_fm_demod, run_fm_demod, exit_fm_demod },
+	{ "FM demodulate (fast math)", "libfm", 50000, 500, FM_MATH_TABLE, 0, init_fm_demod, run_fm_demod, exit_fm_demod },
+	{ "FM demodulate (vector math)", "libfm", 50000, 500, FM_MATH_VECTOR, 0, init_fm_demod, run_fm_demod, exit_fm_demod },
+	{ "FM demodulate (phasor math)", "libfm", 50000, 500, FM_MATH_PHASOR, 10000, init_fm_demod, run_fm_demod, exit_fm_demod },
+	{ "AM modulate", "libam", 50000, 500, AM_MATH_LIBM, 0, init_am_mod, run_am_mod, exit_am_mod },
+	{ "AM modulate (fast math)", "libam", 50000, 500, AM_MATH_TABLE, 0, init_am_mod, run_am_mod, exit_am_mod },
+	{ "AM modulate (vector math)", "libam", 50000, 500, AM_MATH_VECTOR, 0, init_am_mod, run_am_mod, exit_am_mod },
+	{ "AM demodulate", "libam", 50000, 500, AM_MATH_LIBM, 0, init_am_demod, run_am_demod, exit_am_demod },
+	{ "AM demodulate (fast math)", "libam", 50000, 500, AM_MATH_TABLE, 0, init_am_demod, run_am_demod, exit_am_demod },
+	{ "AM demodulate (vector math)", "libam", 50000, 500, AM_MATH_VECTOR, 0, init_am_demod, run_am_demod, exit_am_demod },
+	{ "AM demodulate (synchronous)", "libam", 50000, 500, AM_MATH_VECTOR, 1, init_am_demod, run_am_demod, exit_am_demod },
+	{ "low-pass filter (second order)", "libfilter", 48000, 480, 0, 1, init_iir, run_iir, NULL },
+	{ "low-pass filter (fourth order)", "libfilter", 48000, 480, 0, 2, init_iir, run_iir, NULL },
+	{ "low-pass filter (eighth order)", "libfilter", 48000, 480, 0, 4, init_iir, run_iir, NULL },
+	{ "FIR low-pass filter", "libfilter", 48000, 480, 0, 0, init_fir, run_fir, exit_fir },
+	{ "FIR decimate by 6", "libfilter", 48000, 480, 0, 6, init_fir_decimate, run_fir_decimate, exit_fir },
+	{ "FFT complex 1024", "libfft", 0, 1024, 0, 0, init_fft, run_fft_complex, exit_fft },
+	{ "FFT real 1024", "libfft", 0, 1024, 0, 0, init_fft, run_fft_real, exit_fft },
+	{ "downsample 48000 to 8000 (linear)", "libsamplerate", 48000, 480, SAMPLERATE_LINEAR, 8000, init_resample, run_downsample, NULL },
+	{ "downsample 48000 to 8000 (polyphase)", "libsamplerate", 48000, 480, SAMPLERATE_POLYPHASE, 8000, init_resample, run_downsample, NULL },
+	{ "upsample 8000 to 48000 (linear)", "libsamplerate", 8000, 80, SAMPLERATE_LINEAR, 48000, init_resample, run_upsample, NULL },
+	{ "upsample 8000 to 48000 (polyphase)", "libsamplerate", 8000, 80, SAMPLERATE_POLYPHASE, 48000, init_resample, run_upsample, NULL },
+	{ "Goertzel (two tones)", "libgoertzel", 8000, 160, 0, 0, init_goertzel, run_goertzel, NULL },
+	{ "tone track (two tones)", "libgoertzel", 8000, 160, 0, 0, init_tone_track, run_tone_track, exit_tone_track },
+	{ "DTMF encode", "libdtmf", 8000, 160, 0, 0, init_dtmf_encode, run_dtmf_encode, NULL },
+	{ "DTMF decode (FM)", "libdtmf", 8000, 160, 0, DTMF_DECODE_FM, init_dtmf_decode, run_dtmf_decode, exit_dtmf_decode },
+	{ "DTMF decode (Goertzel)", "libdtmf", 8000, 160, 0, DTMF_DECODE_GOERTZEL, init_dtmf_decode, run_dtmf_decode, exit_dtmf_decode },
+	{ "FSK modulate 1200 baud", "libfsk", 48000, 480, 0, 1200, init_fsk_mod, run_fsk_mod, exit_fsk_mod },
+	{ "FSK demodulate 1200 baud", "libfsk", 48000, 480, 0, 1200, init_fsk_demod, run_fsk_demod, exit_fsk_demod },
+	{ "V.27 modulate", "libv27", 48000, 480, 0, 0, init_v27, run_v27_send, exit_v27 },
+	{ "V.27 demodulate", "libv27", 48000, 480, 0, 0, init_v27, run_v27_receive, exit_v27 },
+	{ "V.27 scrambler", "libv27", 4800, 480, 0, 0, init_v27_scrambler, run_v27_scrambler, NULL },
+	{ "compress", "libcompandor", 8000, 160, 0, 0, init_compandor, run_compress, NULL },
+	{ "expand", "libcompandor", 8000, 160, 0, 0, init_compandor, run_expand, NULL },
+	{ "clipper (below clipping point)", "libclipper", 8000, 160, 0, 90, init_clipper, run_clipper, NULL },
+	{ "clipper (clipping)", "libclipper", 8000, 160, 0, 10, init_clipper, run_clipper, NULL },
+	{ "Sendevolumenregler", "libsendevolumenregler", 8000, 160, 0, 0, init_regler, run_regler, NULL },
+	{ "pre-emphasis", "libemphasis", 48000, 480, 0, 0, init_emphasis_state, run_pre_emphasis, NULL },
+	{ "de-emphasis", "libemphasis", 48000, 480, 0, 0, init_emphasis_state, run_de_emphasis, NULL },
+	{ "scrambler", "libscrambler", 48000, 480, 0, 0, init_scrambler, run_scrambler, NULL },
+	{ "jitter buffer (save and load)", "libjitter", 8000, 160, 0, 0, init_jitter, run_jitter, exit_jitter },
+	{ NULL, NULL, 0, 0, 0, 0, NULL, NULL, NULL },
+};
+
+/* measurement */
+
+struct result {
+	int		repetitions;
+	double		*mss;		/* mega samples/sec of each repetition */
+	int		num_blocks;
+	double		*block_ns;	/* time of each block */
+	int		blocks_size;
+};
+
+static double warmup_ms = 200.0, repetition_ms = 400.0;
+static int repetitions = 5;
+static int json = 0;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* nearest rank of sorted values */
+static double percentile(const double *sorted, int num, double p)
+{
+	int i;
+
+	if (!num)
+		return 0.0;
+	i = (int)ceil(p / 100.0 * num) - 1;
+	if (i < 0)
+		i = 0;
+	if (i >= num)
+		i = num - 1;
+	return sorted[i];
+}
+
+static int measure(struct bench *b, struct result *r)
+{
+	double start, begin, end;
+	int rep, blocks;
+
+	memset(r, 0, sizeof(*r));
+	r->mss = calloc(repetitions, sizeof(*r->mss));
+	if (!r->mss)
+		return -1;
+
+	/* warm up caches, branch predictors and CPU clock */
+	start = now_ns();
+	do
+		b->run(b);
+	while (now_ns() - start < warmup_ms * 1e6);
+
+	for (rep = 0; rep < repetitions; rep++) {
+		blocks = 0;
+		start = end = now_ns();
+		do {
+			begin = end;
+			b->run(b);
+			end = now_ns();
+			if (r->num_blocks == r->blocks_size) {
+				double *p;
+				p = realloc(r->block_ns, (r->blocks_size + 65536) * sizeof(*p));
+				if (!p)
+					return -1;
+				r->block_ns = p;
+				r->blocks_size += 65536;
+			}
+			r->block_ns[r->num_blocks++] = end - begin;
+			blocks++;
+		} while (end - start < repetition_ms * 1e6);
+		r->mss[rep] = (double)blocks * b->block / ((end - start) / 1e9) / 1e6;
+		r->repetitions++;
+	}
+
+	qsort(r->mss, r->repetitions, sizeof(*r->mss), compare_double);
+	qsort(r->block_ns, r->num_blocks, sizeof(*r->block_ns), compare_double);
+
+	return 0;
+}
+
+static void print_result(struct bench *b, struct result *r, int first)
+{
+	double median = percentile(r->mss, r->repetitions, 50.0);
+
+	if (!json) {
+		printf("%s: %.3f mega samples/sec (min %.3f, max %.3f)", b->name, median, r->mss[0], r->mss[r->repetitions - 1]);
+		if (b->samplerate)
+			printf(", %.0f x realtime", median * 1e6 / b->samplerate);
+		printf(", block of %d: p50 %.2f us, p99 %.2f us\n", b->block, percentile(r->block_ns, r->num_blocks, 50.0) / 1e3, percentile(r->block_ns, r->num_blocks, 99.0) / 1e3);
+		return;
+	}
+
+	printf("%s\n    {\"name\": \"%s\", \"library\": \"%s\", \"samplerate\": %d, \"block\": %d, \"repetitions\": %d, \"blocks\": %d,\n", (first) ? "" : ",", b->name, b->library, b->samplerate, b->block, r->repetitions, r->num_blocks);
+	printf("     \"msps\": {\"min\": %.4f, \"median\": %.4f, \"max\": %.4f},\n", r->mss[0], median, r->mss[r->repetitions - 1]);
+	printf("     \"block_ns\": {\"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f}}", percentile(r->block_ns, r->num_blocks, 50.0), percentile(r->block_ns, r->num_blocks, 90.0), percentile(r->block_ns, r->num_blocks, 99.0), r->block_ns[r->num_blocks - 1]);
+}
+
+static void print_header(void)
+{
+	struct utsname uts;
+
+	if (uname(&uts) < 0)
+		strcpy(uts.machine, "unknown");
+
+	if (!json) {
+		printf("DSP kernels: sample conversion = %s\n", dsp_kernels_variant("sample conversion"));
+		return;
+	}
+
+	printf("{\n  \"machine\": \"%s\",\n", uts.machine);
+#ifdef __VERSION__
+	printf("  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+	printf("  \"sample_t\": \"%s\",\n", (sizeof(sample_t) == sizeof(float)) ? "float" : "double");
+	printf("  \"dsp_kernels\": {\"sample conversion\": \"%s\"},\n", dsp_kernels_variant("sample conversion"));
+	printf("  \"warmup_ms\": %.0f,\n  \"repetition_ms\": %.0f,\n", warmup_ms, repetition_ms);
+	printf("  \"benchmarks\": [");
+}
+
+static void print_usage(const char *arg0)
+{
+	printf("Usage: %s [-w <ms>] [-r <count>] [-t <ms>] [-k <variant>] [-j] [-l] [<name> ...]\n", arg0);
+	printf(" -w    Warm-up time before each benchmark. (default = %.0f)\n", warmup_ms);
+	printf(" -r    Repetitions of each benchmark. (default = %d)\n", repetitions);
+	printf(" -t    Time of each repetition. (default = %.0f)\n", repetition_ms);
+	printf(" -k    Force variant of DSP kernels.\n");
+	printf(" -j    Output JSON.\n");
+	printf(" -l    List benchmarks.\n");
+	printf("Only benchmarks whose name or library contain any of the given names run.\n");
+}
+
+static int selected(struct bench *b, int argc, char *argv[])
+{
+	int i;
+
+	if (!argc)
+		return 1;
+	for (i = 0; i < argc; i++) {
+		if (strstr(b->name, argv[i]) || strstr(b->library, argv[i]))
+			return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench *b;
+	struct result r;
+	int i, c, first = 1;
+
+	dsp_kernels_init();
+
+	while ((c = getopt(argc, argv, "w:r:t:k:jlh")) != -1) {
+		switch (c) {
+		case 'w':
+			warmup_ms = atof(optarg);
+			break;
+		case 'r':
+			repetitions = atoi(optarg);
+			if (repetitions < 1)
+				repetitions = 1;
+			break;
+		case 't':
+			repetition_ms = atof(optarg);
+			break;
+		case 'k':
+			if (dsp_kernels_force(optarg) < 0)
+				return 1;
+			break;
+		case 'j':
+			json = 1;
+			break;
+		case 'l':
+			for (b = benchmarks; b->name; b++)
+				printf("%s (%s)\n", b->name, b->library);
+			return 0;
+		default:
+			print_usage(argv[0]);
+			return (c == 'h') ? 0 : 1;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	/* 1 KHz tone with 2.5 KHz deviation */
+	for (i = 0; i < MAX_BLOCK; i++)
+		input[i] = 2500.0 * sin(2.0 * M_PI * 1000.0 * (double)i / 50000.0);
+	/* 1 KHz tone at speech level */
+	for (i = 0; i < MAX_BLOCK; i++)
+		speech[i] = SPEECH_LEVEL * sin(2.0 * M_PI * 1000.0 * (double)i / 8000.0);
+	memset(power, 1, sizeof(power));
+	samples_to_int16_scale(spl, 1, input, MAX_BLOCK, 10.0);
+	for (i = 0; i < MAX_BLOCK; i++)
+		bytes[i] = i * 77;
+
+	compandor_init();
+	scrambler_init();
+
+	print_header();
+
+	for (b = benchmarks; b->name; b++) {
+		if (!selected(b, argc, argv))
+			continue;
+		fm_init(b->math);
+		am_init(b->math);
+		if (b->init && b->init(b) < 0) {
+			fprintf(stderr, "Failed to init benchmark '%s'\n", b->name);
+			fm_exit();
+			am_exit();
+			continue;
+		}
+		if (measure(b, &r) == 0) {
+			print_result(b, &r, first);
+			first = 0;
+		}
+		free(r.mss);
+		free(r.block_ns);
+		if (b->exit)
+			b->exit(b);
+		fm_exit();
+		am_exit();
+		fflush(stdout);
+	}
+
+	if (json)
+		printf("\n  ]\n}\n");
+
+	return 0;
+}
@@ -0,0 +1,266 @@
+/* regression test of networks with recorded IQ and audio corpora
+ *
+ * The corpus directory has a file 'corpus.conf'. Each line gives the name of
+ * a test, followed by the command line of a network that reads a recording,
+ * e.g.:
+ *
+ *   cnetz_call cnetz -k 131 --read-iq-rx-wave cnetz_call.wav
+ *
+ * The command is run inside the corpus directory with '--offline --report'
+ * appended. The report is compared with '<name>.report' of the corpus:
+ * The decode results must be equal, the throughput must not drop and the
+ * memory use must not grow by more than the given thresholds. So a speed-up
+ * that breaks decoding fails as well as a slow-down. Use '-u' to store the
+ * results as new reference.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#define MAX_KEYS	32
+
+/* how each value of a report is compared */
+enum compare {
+	COMPARE_NONE,		/* informational */
+	COMPARE_EQUAL,		/* decode results */
+	COMPARE_HIGHER,		/* throughput, must not be lower */
+	COMPARE_LOWER,		/* memory, must not be higher */
+};
+
+static struct key {
+	const char	*name;
+	enum compare	compare;
+} keys[] = {
+	{ "channels",		COMPARE_EQUAL },
+	{ "frames_decoded",	COMPARE_EQUAL },
+	{ "frames_bad",		COMPARE_EQUAL },
+	{ "bit_errors",		COMPARE_EQUAL },
+	{ "calls_setup",	COMPARE_EQUAL },
+	{ "calls_answered",	COMPARE_EQUAL },
+	{ "signal_seconds",	COMPARE_NONE },
+	{ "cpu_seconds",	COMPARE_NONE },
+	{ "realtime_factor",	COMPARE_HIGHER },
+	{ "arena_bytes",	COMPARE_LOWER },
+	{ "arena_slabs",	COMPARE_LOWER },
+	{ NULL,			COMPARE_NONE },
+};
+
+struct report {
+	int		num;
+	char		name[MAX_KEYS][32];
+	double		value[MAX_KEYS];
+};
+
+static double speed_threshold = 10.0;
+static double memory_threshold = 10.0;
+static int update = 0;
+
+static void print_help(const char *arg0)
+{
+	printf("Usage: %s [options] <corpus directory> [<test name> ...]\n", arg0);
+	printf(" -t <percent>    Fail if throughput drops by more than this. (default %.0f)\n", speed_threshold);
+	printf(" -m <percent>    Fail if memory use grows by more than this. (default %.0f)\n", memory_threshold);
+	printf(" -u              Store results as new reference.\n");
+	printf("Give test names to run only these tests.\n");
+}
+
+static int read_report(const char *filename, struct report *report)
+{
+	char line[256];
+	FILE *fp;
+
+	report->num = 0;
+	fp = fopen(filename, "r");
+	if (!fp)
+		return -errno;
+	while (fgets(line, sizeof(line), fp) && report->num < MAX_KEYS) {
+		if (sscanf(line, "%31s %lf", report->name[report->num], &report->value[report->num]) == 2)
+			report->num++;
+	}
+	fclose(fp);
+
+	return 0;
+}
+
+static int find_value(const struct report *report, const char *name, double *value)
+{
+	int i;
+
+	for (i = 0; i < report->num; i++) {
+		if (!strcmp(report->name[i], name)) {
+			*value = report->value[i];
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/* return number of failed values */
+static int compare_reports(const char *test, const struct report *ref, const struct report *result)
+{
+	double r, v;
+	int k, failed = 0;
+
+	for (k = 0; keys[k].name; k++) {
+		if (find_value(ref, keys[k].name, &r) < 0)
+			continue;
+		if (find_value(result, keys[k].name, &v) < 0) {
+			printf("%s: '%s' missing in result\n", test, keys[k].name);
+			failed++;
+			continue;
+		}
+		switch (keys[k].compare) {
+		case COMPARE_EQUAL:
+			if (v != r) {
+				printf("%s: '%s' changed from %.0f to %.0f\n", test, keys[k].name, r, v);
+				failed++;
+			}
+			break;
+		case COMPARE_HIGHER:
+			if (v < r * (1.0 - speed_threshold / 100.0)) {
+				printf("%s: '%s' dropped from %.3f to %.3f (%.1f%%)\n", test, keys[k].name, r, v, (v - r) / r * 100.0);
+				failed++;
+			}
+			break;
+		case COMPARE_LOWER:
+			if (v > r * (1.0 + memory_threshold / 100.0)) {
+				printf("%s: '%s' grew from %.0f to %.0f\n", test, keys[k].name, r, v);
+				failed++;
+			}
+			break;
+		default:
+			;
+		}
+	}
+
+	return failed;
+}
+
+static int run_test(const char *corpus, const char *test, const char *command)
+{
+	char cmd[1024], ref_file[512], result_file[512];
+	struct report ref, result;
+	double r, v;
+	int rc;
+
+	snprintf(ref_file, sizeof(ref_file), "%s/%s.report", corpus, test);
+	snprintf(result_file, sizeof(result_file), "%s/%s.report.new", corpus, test);
+	unlink(result_file);
+
+	snprintf(cmd, sizeof(cmd), "cd '%s' && %s --offline --report '%s.report.new' >'%s.log' 2>&1", corpus, command, test, test);
+	rc = system(cmd);
+	if (rc != 0)
+		printf("%s: program exited with %d, see '%s/%s.log'\n", test, rc, corpus, test);
+
+	if (read_report(result_file, &result) < 0) {
+		printf("%s: FAILED, no report written\n", test);
+		return -EIO;
+	}
+
+	if (update) {
+		if (rename(result_file, ref_file) < 0) {
+			printf("%s: failed to store reference (%s)\n", test, strerror(errno));
+			return -EIO;
+		}
+		printf("%s: reference stored\n", test);
+		return 0;
+	}
+
+	if (read_report(ref_file, &ref) < 0) {
+		printf("%s: FAILED, no reference '%s', use '-u' to create it\n", test, ref_file);
+		return -EIO;
+	}
+
+	if (compare_reports(test, &ref, &result)) {
+		printf("%s: FAILED\n", test);
+		return -EINVAL;
+	}
+
+	if (find_value(&ref, "realtime_factor", &r) == 0 && find_value(&result, "realtime_factor", &v) == 0 && r > 0.0)
+		printf("%s: ok (realtime factor %.1f, %+.1f%%)\n", test, v, (v - r) / r * 100.0);
+	else
+		printf("%s: ok\n", test);
+
+	return 0;
+}
+
+static int selected(const char *test, int argc, char *argv[])
+{
+	int i;
+
+	if (argc == 0)
+		return 1;
+	for (i = 0; i < argc; i++) {
+		if (!strcmp(test, argv[i]))
+			return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char conf_file[512], line[1024], test[64], *command, *p;
+	const char *corpus;
+	int num = 0, failed = 0;
+	FILE *fp;
+	int c, n;
+
+	while ((c = getopt(argc, argv, "ht:m:u")) != -1) {
+		switch (c) {
+		case 't':
+			speed_threshold = atof(optarg);
+			break;
+		case 'm':
+			memory_threshold = atof(optarg);
+			break;
+		case 'u':
+			update = 1;
+			break;
+		default:
+			print_help(argv[0]);
+			return 0;
+		}
+	}
+	if (optind >= argc) {
+		print_help(argv[0]);
+		return 0;
+	}
+	corpus = argv[optind++];
+
+	snprintf(conf_file, sizeof(conf_file), "%s/corpus.conf", corpus);
+	fp = fopen(conf_file, "r");
+	if (!fp) {
+		fprintf(stderr, "Failed to open '%s' (%s)\n", conf_file, strerror(errno));
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		p = strchr(line, '\n');
+		if (p)
+			*p = '\0';
+		if (line[0] == '#' || sscanf(line, "%63s %n", test, &n) != 1)
+			continue;
+		command = line + n;
+		if (!*command) {
+			printf("%s: no command given\n", test);
+			failed++;
+			continue;
+		}
+		if (!selected(test, argc - optind, argv + optind))
+			continue;
+		num++;
+		if (run_test(corpus, test, command) < 0)
+			failed++;
+	}
+	fclose(fp);
+
+	printf("%d of %d test(s) failed.\n", failed, num);
+
+	return (failed) ? 1 : 0;
+}
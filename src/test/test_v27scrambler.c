@@ -128,6 +128,36 @@ int main(void)
 	}
 	printf("Repetition detected after %d bits from start %d, good!\n", ret, 6);
 	
+	printf("\n");
+
+	printf("Block processing must equal bit processing, also with repetitions:\n");
+
+	for (ret = 0; ret < 4; ret++) {
+		uint8_t block[256], bits[256], in, out;
+		int i, j;
+
+		for (i = 0; i < 256; i++)
+			block[i] = bits[i] = (i & 32) ? 0x7e : i * 37;
+		v27_scrambler_init(&scram, ret & 1, ret >> 1);
+		v27_scrambler_init(&descram, ret & 1, ret >> 1);
+		for (i = 0; i < 256; i += 13)
+			v27_scrambler_block(&scram, block + i, (i + 13 > 256) ? 256 - i : 13);
+		for (i = 0; i < 256; i++) {
+			in = bits[i];
+			for (j = 0, out = 0; j < 8; j++) {
+				out >>= 1;
+				out |= v27_scrambler_bit(&descram, in) << 7;
+				in >>= 1;
+			}
+			bits[i] = out;
+		}
+		if (memcmp(block, bits, sizeof(block))) {
+			printf("Block processing differs (bis=%d descramble=%d), please fix!\n", ret & 1, ret >> 1);
+			return 1;
+		}
+	}
+	printf("Yes!\n");
+
 	return 0;
 }
 
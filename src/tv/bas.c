@@ -17,8 +17,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <math.h>
 #include "../libsample/sample.h"
 #include "../libfilter/iir_filter.h"
@@ -52,8 +55,84 @@
 #define BURST_AMPLITUDE	0.3
 #define COLOR_FILTER_ITER 1
 
-void bas_init(bas_t *bas, double samplerate, enum bas_type type, int fbas, double circle_radius, int color_bar, int grid_only, const char *station_id, int grid_width, unsigned short *img, int width, int height)
+/* number of color carrier phasors that are rotated together */
+#define CHROMA_LANES	4
+
+/* render image part of a line */
+static int gen_image(bas_t *bas, sample_t *sample, double x, sample_t *color_u, sample_t *color_v, int middlefield_line)
+{
+	int i = 0;
+
+	switch (bas->type) {
+	case BAS_FUBK:
+		/* render FUBK test image */
+		i = fubk_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, middlefield_line, bas->circle_radius, bas->color_bar, bas->grid_only, bas->station_id);
+		break;
+	case BAS_CONVERGENCE:
+		/* render color convergence test image */
+		i = convergence_gen_line(sample, x, bas->samplerate, H_LINE_START, H_LINE_END, middlefield_line, (bas->grid_width) > 1 ? 1.0: 0.5);
+		break;
+	case BAS_BLACK:
+	case BAS_BLUE:
+	case BAS_RED:
+	case BAS_MAGENTA:
+	case BAS_GREEN:
+	case BAS_CYAN:
+	case BAS_YELLOW:
+	case BAS_WHITE:
+		/* single color test image */
+		i = color_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, bas->type);
+		break;
+	case BAS_EBU:
+		/* EBU test image */
+		i = ebu_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END);
+		break;
+	case BAS_IMAGE: {
+		/* 574 lines of image are to be rendered */
+		int img_line = middlefield_line - (BAS_IMAGE_LINES - bas->img_height) / 2;
+		if (img_line >= 0 && img_line < bas->img_height) {
+			/* render image data */
+			i = image_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, bas->img + bas->img_width * img_line * 3, bas->img_width);
+		}
+	    }
+	    	break;
+	case BAS_VCR:
+		/* render VCR test image */
+		i = vcr_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, middlefield_line / 2);
+		break;
+	}
+
+	return i;
+}
+
+/* Images that are equal on every line only change with the polarity of V.
+ * The convergence grid has no color, but three different types of lines.
+ * Return -1, if the line must be rendered.
+ */
+static int cache_slot(bas_t *bas, int middlefield_line)
 {
+	switch (bas->type) {
+	case BAS_CONVERGENCE:
+		return convergence_line_type(middlefield_line, (bas->grid_width) > 1 ? 1.0: 0.5);
+	case BAS_BLACK:
+	case BAS_BLUE:
+	case BAS_RED:
+	case BAS_MAGENTA:
+	case BAS_GREEN:
+	case BAS_CYAN:
+	case BAS_YELLOW:
+	case BAS_WHITE:
+	case BAS_EBU:
+		return (bas->v_polarity > 0) ? 0 : 1;
+	default:
+		return -1;
+	}
+}
+
+int bas_init(bas_t *bas, double samplerate, enum bas_type type, int fbas, double circle_radius, int color_bar, int grid_only, const char *station_id, int grid_width, unsigned short *img, int width, int height)
+{
+	int i;
+
 	memset(bas, 0, sizeof(*bas));
 	bas->samplerate = samplerate;
 	bas->type = type;
@@ -67,12 +146,69 @@ void bas_init(bas_t *bas, double samplerate, enum bas_type type, int fbas, doubl
 	bas->img = img;
 	bas->img_width = width;
 	bas->img_height = height;
+	bas->line_size = BAS_LINE_SIZE(samplerate);
+	for (i = 0; i < BAS_CACHE_SLOTS; i++)
+		bas->cache_len[i] = -1;
 
 	/* filter color signal */
 	iir_lowpass_init(&bas->lp_u, 1300000.0, samplerate, COLOR_FILTER_ITER);
 	iir_lowpass_init(&bas->lp_v, 1300000.0, samplerate, COLOR_FILTER_ITER);
 	/* filter final FBAS, so we prevent from being in the audio carrier spectrum */
 	iir_lowpass_init(&bas->lp_y, 4500000.0, samplerate, COLOR_FILTER_ITER);
+
+	/* image lines that repeat are rendered once, if every line starts at the same sample phase */
+	if (fmod(samplerate, 15625.0) == 0.0 && cache_slot(bas, 0) >= 0) {
+		bas->cache = calloc(BAS_CACHE_SLOTS * 3 * bas->line_size, sizeof(*bas->cache));
+		if (!bas->cache) {
+			fprintf(stderr, "No mem!\n");
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+void bas_exit(bas_t *bas)
+{
+	free(bas->cache);
+	bas->cache = NULL;
+	free(bas->frame_cache);
+	bas->frame_cache = NULL;
+	free(bas->frame_cache_len);
+	bas->frame_cache_len = NULL;
+}
+
+/* The image does not change while streaming, so the image part of each line
+ * is rendered once and copied in all following frames. Each frame starts at
+ * x = 0, so a line of a frame always starts at the same sample phase, even if
+ * the sample rate is not a multiple of the line rate. Because there is an odd
+ * number of lines per frame, the polarity of V changes with every frame, so
+ * both polarities are stored.
+ *
+ * Do not use it, if the image is replaced during transmission.
+ */
+int bas_cache_frame(bas_t *bas)
+{
+	int slot;
+
+	/* repeating lines are cached already */
+	if (bas->cache)
+		return 0;
+
+	bas->frame_cache = calloc((size_t)BAS_FRAME_SLOTS * 3 * bas->line_size, sizeof(*bas->frame_cache));
+	bas->frame_cache_len = calloc(BAS_FRAME_SLOTS, sizeof(*bas->frame_cache_len));
+	if (!bas->frame_cache || !bas->frame_cache_len) {
+		fprintf(stderr, "No mem!\n");
+		free(bas->frame_cache);
+		bas->frame_cache = NULL;
+		free(bas->frame_cache_len);
+		bas->frame_cache_len = NULL;
+		return -ENOMEM;
+	}
+	for (slot = 0; slot < BAS_FRAME_SLOTS; slot++)
+		bas->frame_cache_len[slot] = -1;
+
+	return 0;
 }
 
 static inline double ramp(double x)
@@ -80,227 +216,268 @@ static inline double ramp(double x)
 	return 0.5 - 0.5 * cos(x * M_PI);
 }
 
-int bas_generate(bas_t *bas, sample_t *sample)
+/* render image part of a line or copy it from cache */
+static void gen_image_cached(bas_t *bas, sample_t *sample, double x, sample_t *color_u, sample_t *color_v, int middlefield_line)
+{
+	int size = bas->line_size, slot = -1, n;
+	int *cache_len;
+	sample_t *cache;
+
+	if (bas->cache)
+		slot = cache_slot(bas, middlefield_line);
+	else if (bas->frame_cache && middlefield_line < BAS_IMAGE_LINES)
+		slot = middlefield_line * 2 + ((bas->v_polarity > 0) ? 0 : 1);
+	if (slot < 0) {
+		gen_image(bas, sample, x, color_u, color_v, middlefield_line);
+		return;
+	}
+	if (bas->cache) {
+		cache = bas->cache + (size_t)slot * 3 * size;
+		cache_len = &bas->cache_len[slot];
+	} else {
+		cache = bas->frame_cache + (size_t)slot * 3 * size;
+		cache_len = &bas->frame_cache_len[slot];
+	}
+
+	n = *cache_len;
+	if (n < 0) {
+		n = gen_image(bas, sample, x, color_u, color_v, middlefield_line);
+		if (n > size)
+			n = size;
+		/* some patterns set color beyond the returned length, so store whole color lines */
+		memcpy(cache, sample, n * sizeof(*cache));
+		memcpy(cache + size, color_u, size * sizeof(*cache));
+		memcpy(cache + size * 2, color_v, size * sizeof(*cache));
+		*cache_len = n;
+		return;
+	}
+	memcpy(sample, cache, n * sizeof(*cache));
+	memcpy(color_u, cache + size, size * sizeof(*cache));
+	memcpy(color_v, cache + size * 2, size * sizeof(*cache));
+}
+
+/* Add color carrier, modulated by U and V, to the samples.
+ *
+ * The first sample has a carrier phase of 'phase + step'. Instead of a sine
+ * and cosine per sample, CHROMA_LANES phasors of consecutive samples are
+ * rotated by CHROMA_LANES steps each round. They are calculated for every
+ * line, so rounding errors do not add up.
+ */
+static void chroma_modulate(sample_t *sample, const sample_t *color_u, const sample_t *color_v, int length, double phase, double step, double scale)
+{
+	double re[CHROMA_LANES], im[CHROMA_LANES], rot_re, rot_im, r;
+	int c, l;
+
+	for (l = 0; l < CHROMA_LANES; l++) {
+		re[l] = cos(phase + step * (double)(l + 1));
+		im[l] = sin(phase + step * (double)(l + 1));
+	}
+	rot_re = cos(step * (double)CHROMA_LANES);
+	rot_im = sin(step * (double)CHROMA_LANES);
+
+	for (c = 0; c + CHROMA_LANES <= length; c += CHROMA_LANES) {
+		for (l = 0; l < CHROMA_LANES; l++) {
+			sample[c + l] += (color_u[c + l] * re[l] - color_v[c + l] * im[l]) * scale;
+			r = re[l] * rot_re - im[l] * rot_im;
+			im[l] = re[l] * rot_im + im[l] * rot_re;
+			re[l] = r;
+		}
+	}
+	for (l = 0; c + l < length; l++)
+		sample[c + l] += (color_u[c + l] * re[l] - color_v[c + l] * im[l]) * scale;
+}
+
+/* render next line, return number of samples, at most line_size */
+int bas_generate_line(bas_t *bas, sample_t *sample)
 {
 	double step = 1.0 / bas->samplerate;
-	int total_i = 0, i, c, line, middlefield_line;
-	double x = 0, render_start, render_end;
+	int i, line = bas->line, middlefield_line;
+	double x = bas->x, render_start, render_end;
 	int have_image;
-	sample_t color_u[(int)(bas->samplerate / 15625.0) + 10];
-	sample_t color_v[(int)(bas->samplerate / 15625.0) + 10];
-	double _sin, _cos, chroma;
+	sample_t color_u[bas->line_size];
+	sample_t color_v[bas->line_size];
 	double color_step = COLOR_CARRIER / bas->samplerate * 2 * M_PI;
 	/* the offset is specified by delaying Y signal by 0.4 uS. */
 // additianlly we compensate the delay caused by the color filter, that is 2 samples per iteration */
 	int color_offset = (int)(bas->samplerate * COLOR_OFFSET); // + 2 * COLOR_FILTER_ITER;
 
-	for (line = 0; line < 625; line++) {
-		/* reset color */
-		memset(color_u, 0, sizeof(color_u));
-		memset(color_v, 0, sizeof(color_v));
+	/* reset color */
+	memset(color_u, 0, sizeof(color_u));
+	memset(color_v, 0, sizeof(color_v));
 
-		/* render image interlaced */
-		have_image = 1;
+	/* render image interlaced */
+	have_image = 1;
 /* switch off to have black image */
 #if 1
-		if (line >= 24-1 && line <= 310-1)
-			middlefield_line = (line - (24-1)) * 2 + 1;
-		else if (line >= 336-1 && line <= 622-1)
-			middlefield_line = (line - (336-1)) * 2;
-		else
-			have_image = 0;
-		if (have_image) {
-			switch (bas->type) {
-			case BAS_FUBK:
-				/* render FUBK test image */
-				fubk_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, middlefield_line, bas->circle_radius, bas->color_bar, bas->grid_only, bas->station_id);
-				break;
-			case BAS_CONVERGENCE:
-				/* render color convergence test image */
-				convergence_gen_line(sample, x, bas->samplerate, H_LINE_START, H_LINE_END, middlefield_line, (bas->grid_width) > 1 ? 1.0: 0.5);
-				break;
-			case BAS_BLACK:
-			case BAS_BLUE:
-			case BAS_RED:
-			case BAS_MAGENTA:
-			case BAS_GREEN:
-			case BAS_CYAN:
-			case BAS_YELLOW:
-			case BAS_WHITE:
-				/* single color test image */
-				color_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, bas->type);
-				break;
-			case BAS_EBU:
-				/* EBU test image */
-				ebu_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END);
-				break;
-			case BAS_IMAGE: {
-				/* 574 lines of image are to be rendered */
-				int img_line = middlefield_line - (574 - bas->img_height) / 2;
-				if (img_line >= 0 && img_line < bas->img_height) {
-					/* render image data */
-					image_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, bas->img + bas->img_width * img_line * 3, bas->img_width);
-				}
-			    }
-			    	break;
-			case BAS_VCR:
-				/* render VCR test image */
-				vcr_gen_line(sample, x, bas->samplerate, color_u, color_v, bas->v_polarity, H_LINE_START, H_LINE_END, middlefield_line / 2);
-				break;
-			}
-		}
+	if (line >= 24-1 && line <= 310-1)
+		middlefield_line = (line - (24-1)) * 2 + 1;
+	else if (line >= 336-1 && line <= 622-1)
+		middlefield_line = (line - (336-1)) * 2;
+	else
+		have_image = 0;
+	if (have_image)
+		gen_image_cached(bas, sample, x, color_u, color_v, middlefield_line);
 #endif
 
-		i = 0;
+	i = 0;
 
-		/* porch before sync */
-		render_start = H_SYNC_START - SYNC_RAMP / 2;
+	/* porch before sync */
+	render_start = H_SYNC_START - SYNC_RAMP / 2;
+	while (x < render_start) {
+		sample[i++] = PORCH_LEVEL;
+		x += step;
+	}
+	/* ramp to sync level */
+	render_end = render_start + SYNC_RAMP;
+	while (x < render_end) {
+		sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (SYNC_LEVEL - PORCH_LEVEL) + PORCH_LEVEL;
+		x += step;
+	}
+	/* sync (long sync for vertical blank) */
+	if (line <= 3-1 || line == 314-1 || line == 315-1)
+		render_start = V_SYNC_STOP - SYNC_RAMP / 2;
+	else
+		render_start = H_SYNC_STOP - SYNC_RAMP / 2;
+	while (x < render_start) {
+		sample[i++] = SYNC_LEVEL;
+		x += step;
+	}
+	/* ramp to porch level */
+	render_end = render_start + SYNC_RAMP;
+	while (x < render_end) {
+		sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (PORCH_LEVEL - SYNC_LEVEL) + SYNC_LEVEL;
+		x += step;
+	}
+	if (have_image) {
+		/* porch after sync, before color burst */
+		render_start = H_CBURST_START;
 		while (x < render_start) {
 			sample[i++] = PORCH_LEVEL;
 			x += step;
 		}
-		/* ramp to sync level */
-		render_end = render_start + SYNC_RAMP;
+		/* porch after sync, color burst */
+		render_start = H_CBURST_STOP;
+		while (x < render_start) {
+			/* shift color burst to the right, it is shifted back when modulating */
+			color_u[i+color_offset] = -0.5 * BURST_AMPLITUDE; /* - 180 degrees */
+			color_v[i+color_offset] = 0.5 * BURST_AMPLITUDE * (double)bas->v_polarity; /* +- 90 degrees */
+			sample[i++] = PORCH_LEVEL;
+			x += step;
+		}
+		/* porch after sync, after color burst */
+		render_start = H_LINE_START;
+		while (x < render_start) {
+			sample[i++] = PORCH_LEVEL;
+			x += step;
+		}
+		/* ramp to image */
+		render_end = render_start + IMAGE_RAMP;
 		while (x < render_end) {
-			sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (SYNC_LEVEL - PORCH_LEVEL) + PORCH_LEVEL;
+			/* scale level of image to range of BAS signal */
+			sample[i] = sample[i] * (WHITE_LEVEL - BLACK_LEVEL) + BLACK_LEVEL;
+			/* ramp from porch level to image level */
+			sample[i] = ramp((x - render_start) / IMAGE_RAMP) * (sample[i] - PORCH_LEVEL) + PORCH_LEVEL;
+			i++;
 			x += step;
 		}
-		/* sync (long sync for vertical blank) */
-		if (line <= 3-1 || line == 314-1 || line == 315-1)
-			render_start = V_SYNC_STOP - SYNC_RAMP / 2;
-		else
-			render_start = H_SYNC_STOP - SYNC_RAMP / 2;
+		/* image */
+		render_start = H_LINE_END - IMAGE_RAMP;
 		while (x < render_start) {
-			sample[i++] = SYNC_LEVEL;
+			/* scale level of image to range of BAS signal */
+			sample[i] = sample[i] * (WHITE_LEVEL - BLACK_LEVEL) + BLACK_LEVEL;
+			i++;
 			x += step;
 		}
 		/* ramp to porch level */
-		render_end = render_start + SYNC_RAMP;
+		render_end = H_LINE_END;
 		while (x < render_end) {
-			sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (PORCH_LEVEL - SYNC_LEVEL) + SYNC_LEVEL;
+			/* scale level of image to range of BAS signal */
+			sample[i] = sample[i] * (WHITE_LEVEL - BLACK_LEVEL) + BLACK_LEVEL;
+			/* ramp from image level to porch level */
+			sample[i] = ramp((x - render_start) / IMAGE_RAMP) * (PORCH_LEVEL - sample[i]) + sample[i];
+			i++;
 			x += step;
 		}
-		if (have_image) {
-			/* porch after sync, before color burst */
-			render_start = H_CBURST_START;
+	} else {
+		/* draw porch to second sync */
+		if (line <= 5-1 || (line >= 311-1 && line <= 317-1) || line >= 623-1) {
+			/* porch before sync */
+			render_start = H_SYNC2_START - SYNC_RAMP / 2;
 			while (x < render_start) {
 				sample[i++] = PORCH_LEVEL;
 				x += step;
 			}
-			/* porch after sync, color burst */
-			render_start = H_CBURST_STOP;
-			while (x < render_start) {
-				/* shift color burst to the right, it is shifted back when modulating */
-				color_u[i+color_offset] = -0.5 * BURST_AMPLITUDE; /* - 180 degrees */
-				color_v[i+color_offset] = 0.5 * BURST_AMPLITUDE * (double)bas->v_polarity; /* +- 90 degrees */
-				sample[i++] = PORCH_LEVEL;
-				x += step;
-			}
-			/* porch after sync, after color burst */
-			render_start = H_LINE_START;
-			while (x < render_start) {
-				sample[i++] = PORCH_LEVEL;
-				x += step;
-			}
-			/* ramp to image */
-			render_end = render_start + IMAGE_RAMP;
+			/* ramp to sync level */
+			render_end = render_start + SYNC_RAMP;
 			while (x < render_end) {
-				/* scale level of image to range of BAS signal */
-				sample[i] = sample[i] * (WHITE_LEVEL - BLACK_LEVEL) + BLACK_LEVEL;
-				/* ramp from porch level to image level */
-				sample[i] = ramp((x - render_start) / IMAGE_RAMP) * (sample[i] - PORCH_LEVEL) + PORCH_LEVEL;
-				i++;
+				sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (SYNC_LEVEL - PORCH_LEVEL) + PORCH_LEVEL;
 				x += step;
 			}
-			/* image */
-			render_start = H_LINE_END - IMAGE_RAMP;
+			/* sync (long sync for vertical blank) */
+			if (line <= 2-1 || line == 313-1 || line == 314-1 || line == 315-1)
+				render_start = V_SYNC2_STOP - SYNC_RAMP / 2;
+			else
+				render_start = H_SYNC2_STOP - SYNC_RAMP / 2;
 			while (x < render_start) {
-				/* scale level of image to range of BAS signal */
-				sample[i] = sample[i] * (WHITE_LEVEL - BLACK_LEVEL) + BLACK_LEVEL;
-				i++;
+				sample[i++] = SYNC_LEVEL;
 				x += step;
 			}
 			/* ramp to porch level */
-			render_end = H_LINE_END;
+			render_end = render_start + SYNC_RAMP;
 			while (x < render_end) {
-				/* scale level of image to range of BAS signal */
-				sample[i] = sample[i] * (WHITE_LEVEL - BLACK_LEVEL) + BLACK_LEVEL;
-				/* ramp from image level to porch level */
-				sample[i] = ramp((x - render_start) / IMAGE_RAMP) * (PORCH_LEVEL - sample[i]) + sample[i];
-				i++;
-				x += step;
-			}
-		} else {
-			/* draw porch to second sync */
-			if (line <= 5-1 || (line >= 311-1 && line <= 317-1) || line >= 623-1) {
-				/* porch before sync */
-				render_start = H_SYNC2_START - SYNC_RAMP / 2;
-				while (x < render_start) {
-					sample[i++] = PORCH_LEVEL;
-					x += step;
-				}
-				/* ramp to sync level */
-				render_end = render_start + SYNC_RAMP;
-				while (x < render_end) {
-					sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (SYNC_LEVEL - PORCH_LEVEL) + PORCH_LEVEL;
-					x += step;
-				}
-				/* sync (long sync for vertical blank) */
-				if (line <= 2-1 || line == 313-1 || line == 314-1 || line == 315-1)
-					render_start = V_SYNC2_STOP - SYNC_RAMP / 2;
-				else
-					render_start = H_SYNC2_STOP - SYNC_RAMP / 2;
-				while (x < render_start) {
-					sample[i++] = SYNC_LEVEL;
-					x += step;
-				}
-				/* ramp to porch level */
-				render_end = render_start + SYNC_RAMP;
-				while (x < render_end) {
-					sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (PORCH_LEVEL - SYNC_LEVEL) + SYNC_LEVEL;
-					x += step;
-				}
-			}
-			/* porch to end of line */
-			render_end = H_LINE_END;
-			while (x < render_end) {
-				sample[i++] = PORCH_LEVEL;
+				sample[i++] = ramp((x - render_start) / SYNC_RAMP) * (PORCH_LEVEL - SYNC_LEVEL) + SYNC_LEVEL;
 				x += step;
 			}
 		}
+		/* porch to end of line */
+		render_end = H_LINE_END;
+		while (x < render_end) {
+			sample[i++] = PORCH_LEVEL;
+			x += step;
+		}
+	}
 
-		if (bas->fbas) {
-			/* filter color carrier */
-			iir_process(&bas->lp_u, color_u, i);
-			iir_process(&bas->lp_v, color_v, i);
-
-			/* modulate color to sample */
-			bas->color_phase = fmod(bas->color_phase + color_step * (double)color_offset, 2.0 * M_PI);
-			for (c = color_offset; c < i; c++) {
-				bas->color_phase += color_step;
-				if (bas->color_phase >= 2.0 * M_PI)
-					bas->color_phase -= 2.0 * M_PI;
-				_sin = sin(bas->color_phase);
-				_cos = cos(bas->color_phase);
-				chroma = color_u[c] * _cos - color_v[c] * _sin;
-				/* scale level of chroma to range of BAS signal */
-				sample[c-color_offset] += chroma * (WHITE_LEVEL - BLACK_LEVEL);
-			}
+	if (bas->fbas) {
+		/* filter color carrier */
+		iir_process(&bas->lp_u, color_u, i);
+		iir_process(&bas->lp_v, color_v, i);
 
-			/* filter bas signal */
-			iir_process(&bas->lp_y, sample, i);
+		/* modulate color to sample */
+		bas->color_phase = fmod(bas->color_phase + color_step * (double)color_offset, 2.0 * M_PI);
+		if (i > color_offset) {
+			/* scale level of chroma to range of BAS signal */
+			chroma_modulate(sample, color_u + color_offset, color_v + color_offset, i - color_offset, bas->color_phase, color_step, WHITE_LEVEL - BLACK_LEVEL);
+			bas->color_phase = fmod(bas->color_phase + color_step * (double)(i - color_offset), 2.0 * M_PI);
 		}
 
-		/* flip polarity of V signal */
-		bas->v_polarity = -bas->v_polarity;
+		/* filter bas signal */
+		iir_process(&bas->lp_y, sample, i);
+	}
+
+	/* flip polarity of V signal */
+	bas->v_polarity = -bas->v_polarity;
 
-		/* increment sample buffer to next line */
-		sample += i;
-		/* return x */
-		x -= H_LINE_END;
-		/* sum total i */
-		total_i += i;
+	/* return x */
+	x -= H_LINE_END;
+	/* next line, each frame starts at x = 0 */
+	if (++line == 625) {
+		line = 0;
+		x = 0;
 	}
+	bas->line = line;
+	bas->x = x;
+
+	return i;
+}
+
+/* render a frame of 625 lines, starting at the first line, return number of samples */
+int bas_generate(bas_t *bas, sample_t *sample)
+{
+	int total_i = 0;
+
+	do
+		total_i += bas_generate_line(bas, sample + total_i);
+	while (bas->line);
 
 	return total_i;
 }
@@ -15,6 +15,13 @@ enum bas_type {
 	BAS_IMAGE,
 };
 
+/* different image lines that are cached: 2 polarities or 3 grid lines */
+#define BAS_CACHE_SLOTS	3
+
+/* number of image lines of a frame, each with 2 polarities of V */
+#define BAS_IMAGE_LINES	574
+#define BAS_FRAME_SLOTS	(BAS_IMAGE_LINES * 2)
+
 typedef struct bas {
 	double		samplerate;
 	enum bas_type	type;
@@ -29,8 +36,21 @@ typedef struct bas {
 	unsigned short	*img;			/* image data, if it should be used */
 	int		img_width, img_height;	/* size of image */
 	iir_filter_t	lp_y, lp_u, lp_v;	/* low pass filters */
+	int		line;			/* next line to render */
+	double		x;			/* time of next sample within the line */
+	int		line_size;		/* maximum number of samples per line */
+	sample_t	*cache;			/* rendered image lines that repeat */
+	int		cache_len[BAS_CACHE_SLOTS]; /* -1, if not rendered yet */
+	sample_t	*frame_cache;		/* rendered image lines of a still image */
+	int		*frame_cache_len;	/* -1, if not rendered yet */
 } bas_t;
 
-void bas_init(bas_t *bas, double samplerate, enum bas_type type, int fbas, double circle_radius, int color_bar, int grid_only, const char *station_id, int grid_width, unsigned short *img, int width, int height);
+/* number of samples a line buffer must hold */
+#define BAS_LINE_SIZE(samplerate) ((int)((samplerate) / 15625.0) + 10)
+
+int bas_init(bas_t *bas, double samplerate, enum bas_type type, int fbas, double circle_radius, int color_bar, int grid_only, const char *station_id, int grid_width, unsigned short *img, int width, int height);
+void bas_exit(bas_t *bas);
+int bas_cache_frame(bas_t *bas);
+int bas_generate_line(bas_t *bas, sample_t *sample);
 int bas_generate(bas_t *bas, sample_t *sample);
 
@@ -41,6 +41,16 @@ static inline double ramp(double x)
 	return 0.5 - 0.5 * cos(x * M_PI);
 }
 
+/* lines of same type are equal: 0 = grid line, 1 = fine grid, 2 = grid */
+int convergence_line_type(int line, double thick)
+{
+	if (((line - CENTER_LINE + GRID_HEIGHT*40) % GRID_HEIGHT) < GRID_LINES)
+		return 0;
+	if (((line - CENTER_LINE + GRID_HEIGHT2*40) % GRID_HEIGHT2) < GRID_LINES)
+		return 1;
+	return 2;
+}
+
 int convergence_gen_line(sample_t *sample, double x, double samplerate, double line_start, double line_end, int line, double thick)
 {
 	double step = 1.0 / samplerate;
@@ -1,3 +1,4 @@
 
+int convergence_line_type(int line, double thick);
 int convergence_gen_line(sample_t *sample, double x, double samplerate, double line_start, double line_end, int line, double thick);
 
@@ -34,8 +34,8 @@ int image_gen_line(sample_t *sample, double x, double samplerate, sample_t *colo
 	double img_x = 0;
 	double step = 1.0 / samplerate;
 	double img_step = (double)width / (samplerate * (line_end - line_start));
-	int i = 0;
-	double R, G, B, Y, U, V;
+	int i = 0, pixel, last_pixel = -1;
+	double R, G, B, Y = 0, U = 0, V = 0;
 
 	/* skip x to line_start */
 	while (x < line_start && x < line_end) {
@@ -47,12 +47,17 @@ int image_gen_line(sample_t *sample, double x, double samplerate, sample_t *colo
 
 	/* draw pixle into image */
 	while (x < line_end) {
-		R = (double)(img[(int)img_x*3+0]) / 65535.0;
-		G = (double)(img[(int)img_x*3+1]) / 65535.0;
-		B = (double)(img[(int)img_x*3+2]) / 65535.0;
-		Y = 0.299 * R + 0.587 * G + 0.114 * B;
-		U = 0.492 * (B - Y);
-		V = 0.877 * (R - Y);
+		/* each pixel lasts several samples, so convert it only once */
+		pixel = (int)img_x;
+		if (pixel != last_pixel) {
+			R = (double)(img[pixel*3+0]) / 65535.0;
+			G = (double)(img[pixel*3+1]) / 65535.0;
+			B = (double)(img[pixel*3+2]) / 65535.0;
+			Y = 0.299 * R + 0.587 * G + 0.114 * B;
+			U = 0.492 * (B - Y);
+			V = 0.877 * (R - Y);
+			last_pixel = pixel;
+		}
 		sample[i] = Y;
 		color_u[i] = U;
 		color_v[i] = V * (double)v_polarity;
@@ -41,6 +41,7 @@ enum paging_signal;
 #include "../liboptions/options.h"
 #include <osmocom/cc/misc.h>
 #include "bas.h"
+#include "video.h"
 #include "tv_modulate.h"
 #include "channels.h"
 
@@ -66,6 +67,8 @@ static int grid_width = 0;
 static int __attribute__((__unused__)) dsp_buffer = 200;
 static double dsp_samplerate = 10e6;
 static const char *wave_file = NULL;
+static int stream = 0;
+static int video_width = 764, video_height = 574;
 
 /* global variable to quit main loop */
 int quit = 0;
@@ -103,6 +106,10 @@ static void print_help(const char *arg0)
 	printf("        tx-vcr           Transmit Jolly's VCR test pattern\n");
 	printf("        tx-img [<image>] Transmit natural image or given image file\n");
 	printf("                         Use 4:3 image with 574 lines for best result.\n");
+	printf("        tx-video [<file>] Transmit raw RGB24 frames from file, pipe or stdin.\n");
+	printf("                         Frames of --video-size are shown at 25 per second.\n");
+	printf("                         Example: ffmpeg -re -i <input> -vf scale=764:574 -r 25\n");
+	printf("                         -f rawvideo -pix_fmt rgb24 - | %s ... tx-video\n", arg0);
 	printf("\ngeneral options:\n");
 	printf(" -h --help\n");
 	printf("        This help\n");
@@ -120,6 +127,12 @@ static void print_help(const char *arg0)
 	printf("        Output to wave file instead of SDR\n");
 	printf(" -r --realtime <prio>\n");
 	printf("        Set prio: 0 to disable, 99 for maximum (default = %d)\n", rt_prio);
+	printf("    --stream\n");
+	printf("        Render and modulate the image line by line while transmitting, rather\n");
+	printf("        than rendering four frames before. Memory use does not grow with the\n");
+	printf("        sample rate, but rendering must keep up with the SDR.\n");
+	printf("    --video-size <width>x<height>\n");
+	printf("        Size of raw frames for tx-video, at most 574 lines. (default = %dx%d)\n", video_width, video_height);
 	printf("\nsignal options:\n");
 	printf(" -F --fbas 1 | 0\n");
 	printf("        Turn color on or off. (default = %d)\n", fbas);
@@ -150,6 +163,8 @@ static void print_help(const char *arg0)
 
 #define OPT_LIMESDR		1100
 #define OPT_LIMESDR_MINI	1101
+#define OPT_STREAM		1102
+#define OPT_VIDEO_SIZE		1103
 
 static void add_options(void)
 {
@@ -166,6 +181,8 @@ static void add_options(void)
 	option_add('G', "grid-only", 1);
 	option_add('I', "station-id", 1);
 	option_add('W', "grid-width", 1);
+	option_add(OPT_STREAM, "stream", 0);
+	option_add(OPT_VIDEO_SIZE, "video-size", 1);
 #ifdef HAVE_SDR
 	option_add(OPT_LIMESDR, "limesdr", 0);
 	option_add(OPT_LIMESDR_MINI, "limesdr-mini", 0);
@@ -221,6 +238,15 @@ static int handle_options(int short_option, int argi, char **argv)
 	case 'W':
 		grid_width = atoi(argv[argi]);
 		break;
+	case OPT_STREAM:
+		stream = 1;
+		break;
+	case OPT_VIDEO_SIZE:
+		if (sscanf(argv[argi], "%dx%d", &video_width, &video_height) != 2 || video_width < 1 || video_height < 1 || video_height > 574) {
+			fprintf(stderr, "Given video size is invalid, use <width>x<height> with up to 574 lines.\n");
+			return -EINVAL;
+		}
+		break;
 	case 'I':
 		station_id = options_strdup(argv[argi]);
 		if (strlen(station_id) != 12) {
@@ -268,7 +294,91 @@ static int handle_options(int short_option, int argi, char **argv)
 	return 1;
 }
 
-static void tx_bas(sample_t *sample_bas, __attribute__((__unused__)) sample_t *sample_tone, __attribute__((__unused__)) uint8_t *power_tone, int samples)
+/* streaming state: render and modulate one line at a time */
+typedef struct tx_stream {
+	bas_t		*bas;
+	video_source_t	*video;		/* replaces the image at every frame, if set */
+	int		with_tone;
+	sample_t	*spl_bas;
+	sample_t	*spl_tone;
+	uint8_t		*power_tone;
+	double		tone_phase;
+#ifdef HAVE_SDR
+	fm_mod_t	mod;
+#endif
+} tx_stream_t;
+
+static int tx_stream_init(tx_stream_t *stream, bas_t *bas, int with_tone)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->bas = bas;
+	stream->with_tone = with_tone;
+	stream->spl_bas = calloc(bas->line_size, sizeof(*stream->spl_bas));
+	stream->spl_tone = calloc(bas->line_size, sizeof(*stream->spl_tone));
+	stream->power_tone = calloc(bas->line_size, sizeof(*stream->power_tone));
+	if (!stream->spl_bas || !stream->spl_tone || !stream->power_tone) {
+		fprintf(stderr, "No mem!\n");
+		return -ENOMEM;
+	}
+	memset(stream->power_tone, 1, bas->line_size);
+#ifdef HAVE_SDR
+	if (with_tone) {
+		fm_mod_init(&stream->mod, dsp_samplerate, audio_offset, modulation * 0.1);
+		stream->mod.state = MOD_STATE_ON; /* do not ramp up */
+	}
+#endif
+
+	return 0;
+}
+
+static void tx_stream_exit(tx_stream_t *stream)
+{
+#ifdef HAVE_SDR
+	if (stream->with_tone)
+		fm_mod_exit(&stream->mod);
+#endif
+	free(stream->spl_bas);
+	free(stream->spl_tone);
+	free(stream->power_tone);
+}
+
+/* render next line, return number of samples */
+static int tx_stream_render(tx_stream_t *stream)
+{
+	/* take the latest frame, before the first field is rendered */
+	if (stream->video && stream->bas->line == 0)
+		stream->bas->img = video_get_frame(stream->video);
+
+	return bas_generate_line(stream->bas, stream->spl_bas);
+}
+
+#ifdef HAVE_SDR
+/* render and modulate next line, return number of I/Q samples */
+static int tx_stream_line(tx_stream_t *stream, float *buff)
+{
+	double tone_step = 2.0 * M_PI * 1000.0 / dsp_samplerate;
+	int count, i;
+
+	count = tx_stream_render(stream);
+	tv_modulate(buff, count, stream->spl_bas, modulation);
+
+	if (stream->with_tone) {
+		/* same 1000 Hz tone as the rendered test picture */
+		for (i = 0; i < count; i++) {
+			stream->spl_tone[i] = sin(stream->tone_phase) * 50000;
+			stream->tone_phase += tone_step;
+			if (stream->tone_phase >= 2.0 * M_PI)
+				stream->tone_phase -= 2.0 * M_PI;
+		}
+		fm_modulate_complex(&stream->mod, stream->spl_tone, stream->power_tone, count, buff);
+	}
+
+	return count;
+}
+#endif
+
+/* transmit rendered samples in a loop, or stream lines, if sample_bas is NULL */
+static void tx_bas(tx_stream_t *stream, sample_t *sample_bas, __attribute__((__unused__)) sample_t *sample_tone, __attribute__((__unused__)) uint8_t *power_tone, int samples)
 {
 	/* catch signals */
 	signal(SIGINT, sighandler);
@@ -281,14 +391,31 @@ static void tx_bas(sample_t *sample_bas, __attribute__((__unused__)) sample_t *s
 		int rc;
 		sample_t *buffers[1];
 
-		rc = wave_create_record(&rec, wave_file, dsp_samplerate, 1, 1.0);
+		rc = wave_create_record(&rec, wave_file, dsp_samplerate, 1, 1.0, 0);
 		if (rc < 0) {
 			// FIXME cleanup
 			exit(0);
 		}
 
-		buffers[0] = sample_bas;
-		wave_write(&rec, buffers, samples);
+		if (sample_bas) {
+			buffers[0] = sample_bas;
+			wave_write(&rec, buffers, samples);
+		} else {
+			/* write four frames, like the rendered test picture, or all frames of the video */
+			int line, count;
+
+			buffers[0] = stream->spl_bas;
+			for (line = 0; !quit; line++) {
+				if (stream->bas->line == 0) {
+					if (!stream->video && line == 625 * 4)
+						break;
+					if (stream->video && !video_next_frame(stream->video))
+						break;
+				}
+				count = tx_stream_render(stream);
+				wave_write(&rec, buffers, count);
+			}
+		}
 
 		wave_destroy_record(&rec);
 	} else {
@@ -309,20 +436,29 @@ static void tx_bas(sample_t *sample_bas, __attribute__((__unused__)) sample_t *s
 			goto error;
 		}
 
-		/* modulate */
-		buff = calloc(samples + 10.0, sizeof(sample_t) * 2);
-		if (!buff) {
-			fprintf(stderr, "No mem!\n");
-			goto error;
-		}
-		tv_modulate(buff, samples, sample_bas, modulation);
-
-		if (sample_tone) {
-			/* bandwidth is 2*(deviation + 2*f(sig)) = 2 * (50 + 2*15) = 160khz */
-			fm_mod_t mod;
-			fm_mod_init(&mod, dsp_samplerate, audio_offset, modulation * 0.1);
-			mod.state = MOD_STATE_ON; /* do not ramp up */
-			fm_modulate_complex(&mod, sample_tone, power_tone, samples, buff);
+		if (sample_bas) {
+			/* modulate */
+			buff = calloc(samples + 10.0, sizeof(sample_t) * 2);
+			if (!buff) {
+				fprintf(stderr, "No mem!\n");
+				goto error;
+			}
+			tv_modulate(buff, samples, sample_bas, modulation);
+
+			if (sample_tone) {
+				/* bandwidth is 2*(deviation + 2*f(sig)) = 2 * (50 + 2*15) = 160khz */
+				fm_mod_t mod;
+				fm_mod_init(&mod, dsp_samplerate, audio_offset, modulation * 0.1);
+				mod.state = MOD_STATE_ON; /* do not ramp up */
+				fm_modulate_complex(&mod, sample_tone, power_tone, samples, buff);
+			}
+		} else {
+			/* one modulated line */
+			buff = calloc(stream->bas->line_size, sizeof(*buff) * 2);
+			if (!buff) {
+				fprintf(stderr, "No mem!\n");
+				goto error;
+			}
 		}
 
 		/* real time priority */
@@ -351,6 +487,8 @@ static void tx_bas(sample_t *sample_bas, __attribute__((__unused__)) sample_t *s
 
 		int pos = 0, max = samples * 2;
 		int s, ss, tosend;
+		if (!sample_bas)
+			max = tx_stream_line(stream, buff) * 2;
 		while (!quit) {
 			usleep(1000);
 			sdr_read(sdr, (void *)sendbuff, buffer_size, 0, NULL);
@@ -365,6 +503,9 @@ static void tx_bas(sample_t *sample_bas, __attribute__((__unused__)) sample_t *s
 				sendbuff[ss++] = buff[pos++];
 				if (pos == max) {
 					pos = 0;
+					/* render next line when streaming */
+					if (!sample_bas)
+						max = tx_stream_line(stream, buff) * 2;
 				}
 			}
 			sdr_write(sdr, (void *)sendbuff, NULL, tosend, NULL, NULL, 0);
@@ -398,6 +539,7 @@ static void tx_bas(sample_t *sample_bas, __attribute__((__unused__)) sample_t *s
 static int tx_test_picture(enum bas_type type)
 {
 	bas_t bas;
+	tx_stream_t tx_stream;
 	sample_t *test_bas = NULL;
 	sample_t *test_tone = NULL;
 	uint8_t *test_power = NULL;
@@ -405,13 +547,30 @@ static int tx_test_picture(enum bas_type type)
 	int ret = -1;
 	int count;
 
+	if (bas_init(&bas, dsp_samplerate, type, fbas, circle_radius, color_bar, grid_only, station_id, grid_width, NULL, 0, 0) < 0)
+		return -1;
+
+	if (stream) {
+		/* the test picture does not change, so render it only once */
+		if (bas_cache_frame(&bas) < 0) {
+			bas_exit(&bas);
+			return -1;
+		}
+		if (tx_stream_init(&tx_stream, &bas, tone) == 0) {
+			tx_bas(&tx_stream, NULL, NULL, NULL, 0);
+			ret = 0;
+		}
+		tx_stream_exit(&tx_stream);
+		bas_exit(&bas);
+		return ret;
+	}
+
 	/* test image, add some samples in case of overflow due to rounding errors */
 	test_bas = calloc(dsp_samplerate / 25.0 * 4.0 + 10.0, sizeof(sample_t));
 	if (!test_bas) {
 		fprintf(stderr, "No mem!\n");
 		goto error;
 	}
-	bas_init(&bas, dsp_samplerate, type, fbas, circle_radius, color_bar, grid_only, station_id, grid_width, NULL, 0, 0);
 	count = bas_generate(&bas, test_bas);
 	count += bas_generate(&bas, test_bas + count);
 	count += bas_generate(&bas, test_bas + count);
@@ -435,10 +594,11 @@ static int tx_test_picture(enum bas_type type)
 		memset(test_power, 1, count);
 	}
 
-	tx_bas(test_bas, test_tone, test_power, count);
+	tx_bas(NULL, test_bas, test_tone, test_power, count);
 
 	ret = 0;
 error:
+	bas_exit(&bas);
 	free(test_bas);
 	free(test_tone);
 	free(test_power);
@@ -452,6 +612,7 @@ static int tx_img(const char *filename)
 	unsigned short *img = NULL;
 	int width, height;
 	bas_t bas;
+	tx_stream_t tx_stream;
 	sample_t *img_bas = NULL;
 	int ret = -1;
 	int count;
@@ -473,28 +634,70 @@ static int tx_img(const char *filename)
 			img[i] = le16toh(img[i]);
 	}
 
+	if (bas_init(&bas, dsp_samplerate, BAS_IMAGE, fbas, circle_radius, color_bar, grid_only, NULL, grid_width, img, width, height) < 0)
+		goto error;
+
+	if (stream) {
+		/* the image does not change, so render it only once */
+		if (bas_cache_frame(&bas) < 0)
+			goto error;
+		if (tx_stream_init(&tx_stream, &bas, 0) == 0) {
+			tx_bas(&tx_stream, NULL, NULL, NULL, 0);
+			ret = 0;
+		}
+		tx_stream_exit(&tx_stream);
+		goto error;
+	}
+
 	/* test image, add some samples in case of overflow due to rounding errors */
 	img_bas = calloc(dsp_samplerate / 25.0 * 4.0 + 10.0, sizeof(sample_t));
 	if (!img_bas) {
 		fprintf(stderr, "No mem!\n");
 		goto error;
 	}
-	bas_init(&bas, dsp_samplerate, BAS_IMAGE, fbas, circle_radius, color_bar, grid_only, NULL, grid_width, img, width, height);
 	count = bas_generate(&bas, img_bas);
 	count += bas_generate(&bas, img_bas + count);
 	count += bas_generate(&bas, img_bas + count);
 	count += bas_generate(&bas, img_bas + count);
 
-	tx_bas(img_bas, NULL, NULL, count);
+	tx_bas(NULL, img_bas, NULL, NULL, count);
 
 	ret = 0;
 error:
+	bas_exit(&bas);
 	free(img_bas);
 	if (filename)
 		free(img);
 	return ret;
 }
 
+/* transmit live frames, always streaming */
+static int tx_video(const char *filename)
+{
+	video_source_t video;
+	bas_t bas;
+	tx_stream_t tx_stream;
+	int ret = -1;
+
+	if (video_open(&video, filename, video_width, video_height, (wave_file != NULL)) < 0)
+		return -1;
+
+	if (bas_init(&bas, dsp_samplerate, BAS_IMAGE, fbas, circle_radius, color_bar, grid_only, NULL, grid_width, video.frame[video.front], video_width, video_height) < 0)
+		goto error;
+
+	if (tx_stream_init(&tx_stream, &bas, 0) == 0) {
+		tx_stream.video = &video;
+		tx_bas(&tx_stream, NULL, NULL, NULL, 0);
+		ret = 0;
+	}
+	tx_stream_exit(&tx_stream);
+
+error:
+	bas_exit(&bas);
+	video_close(&video);
+	return ret;
+}
+
 int main(int argc, char *argv[])
 {
 	int __attribute__((__unused__)) rc, argi;
@@ -560,6 +763,8 @@ int main(int argc, char *argv[])
 		tx_test_picture(BAS_VCR);
 	} else if (!strcmp(argv[argi], "tx-img")) {
 		tx_img((argi + 1 < argc) ? argv[argi + 1] : NULL);
+	} else if (!strcmp(argv[argi], "tx-video")) {
+		tx_video((argi + 1 < argc) ? argv[argi + 1] : NULL);
 	} else {
 		fprintf(stderr, "Unknown command '%s', use '-h' for help!\n", argv[argi]);
 		return -EINVAL;
@@ -24,12 +24,17 @@
 
 #define WHITE_MODULATION	0.1
 
+/* negative AM: sync level gives full amplitude, white level gives WHITE_MODULATION
+ * the level is a linear function of the BAS signal, so the loop is a single multiply-add
+ */
 void tv_modulate(float *buff, int count, sample_t *bas, double amplitude)
 {
-	int i, ss = 0;
+	double gain = -(1.0 - WHITE_MODULATION) * amplitude;
+	double offset = amplitude;
+	int i;
 
 	for (i = 0; i < count; i++) {
-		buff[ss++] = ((1.0 - bas[i]) * (1.0 - WHITE_MODULATION) + WHITE_MODULATION) * amplitude;
-		buff[ss++] = 0;
+		buff[i * 2] = bas[i] * gain + offset;
+		buff[i * 2 + 1] = 0;
 	}
 }
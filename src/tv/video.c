@@ -0,0 +1,183 @@
+/* live frame source for the TV transmitter
+ *
+ * (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Raw RGB24 frames are read from a file or pipe by a thread, so a slow or
+ * stalling source never blocks the transmitter. Each frame is converted and
+ * then swapped into 'ready'. At the start of every TV frame, the renderer
+ * swaps 'ready' into 'front', if a new frame arrived. If the source is
+ * faster than 25 frames per second, frames are dropped, if it is slower,
+ * the current frame is repeated. A frame is never changed while it is
+ * rendered, so both fields show the same picture.
+ *
+ * When writing to a file, there is no real time. Then the reader waits until
+ * each frame was taken, so every frame is rendered once.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "video.h"
+
+static void *video_child(void *arg)
+{
+	video_source_t *video = (video_source_t *)arg;
+	size_t frame_bytes = (size_t)video->width * video->height * 3;
+	unsigned short *frame;
+	int i, swap;
+
+	while (1) {
+		if (fread(video->raw, frame_bytes, 1, video->fp) != 1)
+			break;
+		/* 8 bit to 16 bit per color */
+		frame = video->frame[video->back];
+		for (i = 0; i < (int)frame_bytes; i++)
+			frame[i] = video->raw[i] * 257;
+		pthread_mutex_lock(&video->lock);
+		while (video->wait && video->fresh) {
+			pthread_mutex_unlock(&video->lock);
+			usleep(1000);
+			pthread_mutex_lock(&video->lock);
+		}
+		if (video->fresh)
+			video->frames_dropped++;
+		swap = video->ready;
+		video->ready = video->back;
+		video->back = swap;
+		video->fresh = 1;
+		video->frames_read++;
+		pthread_mutex_unlock(&video->lock);
+	}
+
+	pthread_mutex_lock(&video->lock);
+	video->eof = 1;
+	pthread_mutex_unlock(&video->lock);
+	return NULL;
+}
+
+/* open raw RGB24 source, "-" is stdin
+ * if 'wait' is set, no frame is dropped and video_next_frame() must be used */
+int video_open(video_source_t *video, const char *filename, int width, int height, int wait)
+{
+	size_t pixels = (size_t)width * height;
+	int i, rc;
+
+	memset(video, 0, sizeof(*video));
+	video->width = width;
+	video->height = height;
+	video->wait = wait;
+	video->front = 0;
+	video->ready = 1;
+	video->back = 2;
+	pthread_mutex_init(&video->lock, NULL);
+
+	if (!filename || !strcmp(filename, "-"))
+		video->fp = stdin;
+	else
+		video->fp = fopen(filename, "r");
+	if (!video->fp) {
+		fprintf(stderr, "Failed to open video source '%s'! (errno %d)\n", filename, errno);
+		rc = -EIO;
+		goto error;
+	}
+
+	video->raw = malloc(pixels * 3);
+	for (i = 0; i < 3; i++)
+		video->frame[i] = calloc(pixels * 3, sizeof(unsigned short));
+	if (!video->raw || !video->frame[0] || !video->frame[1] || !video->frame[2]) {
+		fprintf(stderr, "No mem!\n");
+		rc = -ENOMEM;
+		goto error;
+	}
+
+	rc = pthread_create(&video->tid, NULL, video_child, video);
+	if (rc) {
+		fprintf(stderr, "Failed to create thread to read video source! (errno %d)\n", rc);
+		rc = -EIO;
+		goto error;
+	}
+	video->running = 1;
+
+	return 0;
+
+error:
+	video_close(video);
+	return rc;
+}
+
+void video_close(video_source_t *video)
+{
+	int i;
+
+	/* the thread may be blocked reading, so cancel it */
+	if (video->running) {
+		pthread_cancel(video->tid);
+		pthread_join(video->tid, NULL);
+		video->running = 0;
+		printf("Video: %" PRIu64 " frames read, %" PRIu64 " dropped, %" PRIu64 " repeated\n", video->frames_read, video->frames_dropped, video->frames_repeated);
+	}
+	if (video->fp && video->fp != stdin)
+		fclose(video->fp);
+	video->fp = NULL;
+	free(video->raw);
+	video->raw = NULL;
+	for (i = 0; i < 3; i++) {
+		free(video->frame[i]);
+		video->frame[i] = NULL;
+	}
+	pthread_mutex_destroy(&video->lock);
+}
+
+/* get frame to render next TV frame, black until the first frame arrived */
+unsigned short *video_get_frame(video_source_t *video)
+{
+	int swap;
+
+	pthread_mutex_lock(&video->lock);
+	if (video->fresh) {
+		swap = video->front;
+		video->front = video->ready;
+		video->ready = swap;
+		video->fresh = 0;
+	} else if (video->frames_read)
+		video->frames_repeated++;
+	pthread_mutex_unlock(&video->lock);
+
+	return video->frame[video->front];
+}
+
+/* wait for next frame, return 0 if the source has ended */
+int video_next_frame(video_source_t *video)
+{
+	int rc;
+
+	pthread_mutex_lock(&video->lock);
+	while (!video->fresh && !video->eof) {
+		pthread_mutex_unlock(&video->lock);
+		usleep(1000);
+		pthread_mutex_lock(&video->lock);
+	}
+	rc = video->fresh;
+	pthread_mutex_unlock(&video->lock);
+
+	return rc;
+}
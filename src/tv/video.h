@@ -0,0 +1,23 @@
+#include <pthread.h>
+
+/* frame store: the reader fills 'back', the renderer uses 'front', the latest
+ * complete frame waits in 'ready' */
+typedef struct video_source {
+	FILE		*fp;
+	int		width, height;
+	uint8_t		*raw;		/* one raw RGB24 frame as read */
+	unsigned short	*frame[3];	/* RGB frames in libimage format */
+	int		front, ready, back;
+	int		fresh;		/* 'ready' holds a frame not rendered yet */
+	int		eof;		/* no more frames from source */
+	int		wait;		/* reader waits until the frame was taken */
+	uint64_t	frames_read, frames_dropped, frames_repeated;
+	pthread_mutex_t	lock;
+	pthread_t	tid;		/* reader thread id */
+	int		running;	/* thread was created */
+} video_source_t;
+
+int video_open(video_source_t *video, const char *filename, int width, int height, int wait);
+void video_close(video_source_t *video);
+unsigned short *video_get_frame(video_source_t *video);
+int video_next_frame(video_source_t *video);
@@ -28,7 +28,6 @@
 #include "../libmobile/main_mobile.h"
 #include "../liboptions/options.h"
 #include "zeitansage.h"
-#include "samples.h"
 
 double audio_level_dBm = -16.0;
 int alerting = 0;
@@ -81,9 +80,6 @@ int main(int argc, char *argv[])
 
 	allow_sdr = 0;
 
-	/* init system specific tones */
-	init_samples();
-
 	/* init mobile interface */
 	main_mobile_init("0123456789", number_lengths, NULL, NULL);
 
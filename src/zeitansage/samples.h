@@ -1,3 +1,13 @@
 
-void init_samples(void);
+/* fragment ids, in the order of the sample block */
+#define SAMPLE_BNTIE		0
+#define SAMPLE_URRR(h)		(1 + (h))
+#define SAMPLE_MINUTEN(m)	(25 + (m))
+#define SAMPLE_SEKUNDEN(s)	(((s) % 10) ? -1 : 85 + (s) / 10)
+#define SAMPLE_TUT		91
+#define SAMPLE_NUM		92
+
+int sample_size(int id);
+const int16_t *sample_get(int id);
+void samples_exit(void);
 
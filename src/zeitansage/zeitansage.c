@@ -30,6 +30,7 @@
 #include "../libmobile/cause.h"
 #include "../libmobile/get_time.h"
 #include "zeitansage.h"
+#include "samples.h"
 
 #define db2level(db)	pow(10, (double)(db) / 20.0)
 
@@ -41,20 +42,10 @@ double early_audio;
 
 #define	BEEP_TIME	16000	/* adjust distance from beep in samples */
 
-int16_t *bntie_spl;
-int bntie_size;
 int bntie_time; /* sample index when intro is over */
-int16_t *urrr_spl[24];
-int urrr_size[24];
 int urrr_time; /* sample index when hour is over */
-int16_t *minuten_spl[60];
-int minuten_size[60];
 int minuten_time; /* sample index when minute is over */
-int16_t *sekunden_spl[60];
-int sekunden_size[60];
 int sekunden_time; /* sample index when second is over */
-int16_t *tut_spl;
-int tut_size;
 int tut_time; /* sample index when beep is over */
 
 static const char *call_state_name(enum zeit_call_state state)
@@ -114,23 +105,23 @@ int zeit_init(double audio_level_dBm, int alerting)
 
 	/* get maximum length for each speech segment */
 	tut_time = BEEP_TIME;
-	bntie_time = bntie_size + tut_time;
+	bntie_time = sample_size(SAMPLE_BNTIE) + tut_time;
 	urrr_time = 0;
 	for (i = 0; i < 24; i++) {
-		if (urrr_size[i] > urrr_time)
-			urrr_time = urrr_size[i];
+		if (sample_size(SAMPLE_URRR(i)) > urrr_time)
+			urrr_time = sample_size(SAMPLE_URRR(i));
 	}
 	urrr_time += bntie_time;
 	minuten_time = 0;
 	for (i = 0; i < 60; i++) {
-		if (minuten_size[i] > minuten_time)
-			minuten_time = minuten_size[i];
+		if (sample_size(SAMPLE_MINUTEN(i)) > minuten_time)
+			minuten_time = sample_size(SAMPLE_MINUTEN(i));
 	}
 	minuten_time += urrr_time;
 	sekunden_time = 0;
 	for (i = 0; i < 60; i += 10) {
-		if (sekunden_size[i] > sekunden_time)
-			sekunden_time = sekunden_size[i];
+		if (sample_size(SAMPLE_SEKUNDEN(i)) > sekunden_time)
+			sekunden_time = sample_size(SAMPLE_SEKUNDEN(i));
 	}
 	sekunden_time += minuten_time;
 
@@ -140,8 +131,12 @@ int zeit_init(double audio_level_dBm, int alerting)
 }
 
 /* global exit */
+static void free_slots(void);
+
 void zeit_exit(void)
 {
+	free_slots();
+	samples_exit();
 }
 
 /* calculate what time to speak */
@@ -221,65 +216,72 @@ static void zeit_call_destroy(zeit_call_t *call)
 	zeit_display_status();
 }
 
-/* play samples for one call */
-static void call_play(zeit_call_t *call)
+/* state of announcement at given sample time */
+static enum zeit_call_state spl_state(int spl_time)
+{
+	if (spl_time < tut_time)
+		return ZEIT_CALL_BEEP;
+	if (spl_time < bntie_time)
+		return ZEIT_CALL_INTRO;
+	if (spl_time < urrr_time)
+		return ZEIT_CALL_HOUR;
+	if (spl_time < minuten_time)
+		return ZEIT_CALL_MINUTE;
+	if (spl_time < sekunden_time)
+		return ZEIT_CALL_SECOND;
+	return ZEIT_CALL_PAUSE;
+}
+
+/* assemble announcement of given time from fragments, starting at spl_time
+ * the sample time after the last sample is returned, it stops at the pause
+ */
+static int assemble(int16_t *chunk, int length, int spl_time, int h, int m, int s)
 {
 	int i = 0;
-	int16_t chunk[160];
-	sample_t spl[160];
-	int16_t *play_spl;	/* current sample */
+	const int16_t *play_spl;	/* current sample */
+	int play_id;		/* current fragment */
 	int play_size;		/* current size of sample*/
 	int play_index;		/* current sample index */
 	int play_max;		/* total length to plax */
-	int spl_time;		/* sample offset from start of 10 minutes */
-
-	spl_time = call->spl_time;
 
 next_sample:
 	/* select sample from current sample time stamp */
 	if (spl_time < tut_time) {
 		play_index = spl_time;
 		play_max = tut_time;
-		play_size = tut_size;
-		play_spl = tut_spl;
-		call_new_state(call, ZEIT_CALL_BEEP);
+		play_id = SAMPLE_TUT;
 	} else
 	if (spl_time < bntie_time) {
 		play_index = spl_time - tut_time;
 		play_max = bntie_time - tut_time;
-		play_size = bntie_size;
-		play_spl = bntie_spl;
-		call_new_state(call, ZEIT_CALL_INTRO);
+		play_id = SAMPLE_BNTIE;
 	} else
 	if (spl_time < urrr_time) {
 		play_index = spl_time - bntie_time;
 		play_max = urrr_time - bntie_time;
-		play_size = urrr_size[call->h];
-		play_spl = urrr_spl[call->h];
-		call_new_state(call, ZEIT_CALL_HOUR);
+		play_id = SAMPLE_URRR(h);
 	} else
 	if (spl_time < minuten_time) {
 		play_index = spl_time - urrr_time;
 		play_max = minuten_time - urrr_time;
-		play_size = minuten_size[call->m];
-		play_spl = minuten_spl[call->m];
-		call_new_state(call, ZEIT_CALL_MINUTE);
+		play_id = SAMPLE_MINUTEN(m);
 	} else
 	if (spl_time < sekunden_time) {
 		play_index = spl_time - minuten_time;
 		play_max = sekunden_time - minuten_time;
-		play_size = sekunden_size[call->s];
-		play_spl = sekunden_spl[call->s];
-		call_new_state(call, ZEIT_CALL_SECOND);
+		play_id = SAMPLE_SEKUNDEN(s);
 	} else {
 		play_index = 0;
 		play_max = 0;
-		play_size = 0;
-		play_spl = NULL;
-		call_new_state(call, ZEIT_CALL_PAUSE);
+		play_id = -1;
 	}
+	/* fragment is decoded on first use */
+	play_size = sample_size(play_id);
+	play_spl = (play_size) ? sample_get(play_id) : NULL;
+	if (!play_spl)
+		play_size = 0;
 
-	while (i < 160) {
+	while (i < length) {
 		if (!play_size) {
 			chunk[i++] = 0.0;
 			continue;
@@ -296,7 +298,110 @@ next_sample:
 		spl_time++;
 	}
 
-	call->spl_time = spl_time;
+	return spl_time;
+}
+
+/* Announcements that are rendered for the current and the upcoming 10 seconds.
+ * All calls that wait for the same beep hear the same announcement, so it is
+ * assembled and encoded once and each call streams from its own offset.
+ */
+#define ZEIT_SLOTS	2
+
+static struct zeit_slot {
+	int			time;		/* h * 3600 + m * 60 + s, -1 if unused */
+	int			end;		/* sample time where the pause starts */
+	call_audio_buffer_t	*buffer;	/* announcement, followed by one frame of silence */
+	unsigned int		used;		/* last use, to replace the least recently used slot */
+} zeit_slot[ZEIT_SLOTS] = { { .time = -1 }, { .time = -1 } };
+
+static unsigned int zeit_slot_use;
+
+static struct zeit_slot *get_slot(int h, int m, int s)
+{
+	struct zeit_slot *slot = &zeit_slot[0];
+	int time = h * 3600 + m * 60 + s;
+	int16_t *chunk;
+	sample_t *spl;
+	int i;
+
+	zeit_slot_use++;
+	for (i = 0; i < ZEIT_SLOTS; i++) {
+		if (zeit_slot[i].time == time) {
+			zeit_slot[i].used = zeit_slot_use;
+			return &zeit_slot[i];
+		}
+		if (zeit_slot_use - zeit_slot[i].used > zeit_slot_use - slot->used)
+			slot = &zeit_slot[i];
+	}
+
+	call_audio_buffer_destroy(slot->buffer);
+	slot->buffer = NULL;
+	slot->time = -1;
+
+	/* render announcement */
+	chunk = malloc((sekunden_time + 160) * sizeof(*chunk));
+	spl = malloc((sekunden_time + 160) * sizeof(*spl));
+	if (!chunk || !spl) {
+		LOGP(DZEIT, LOGL_ERROR, "No mem!\n");
+		free(chunk);
+		free(spl);
+		return NULL;
+	}
+	slot->end = assemble(chunk, sekunden_time + 160, 0, h, m, s);
+	int16_to_samples_speech(spl, chunk, sekunden_time + 160);
+	for (i = 0; i < sekunden_time + 160; i++)
+		spl[i] *= audio_gain;
+	slot->buffer = call_audio_buffer_create(spl, sekunden_time + 160);
+	free(chunk);
+	free(spl);
+	if (!slot->buffer)
+		return NULL;
+	slot->time = time;
+	slot->used = zeit_slot_use;
+
+	LOGP(DZEIT, LOGL_DEBUG, "Rendered announcement for %d:%02d:%02d\n", h, m, s);
+
+	return slot;
+}
+
+static void free_slots(void)
+{
+	int i;
+
+	for (i = 0; i < ZEIT_SLOTS; i++) {
+		call_audio_buffer_destroy(zeit_slot[i].buffer);
+		zeit_slot[i].buffer = NULL;
+		zeit_slot[i].time = -1;
+	}
+}
+
+/* play samples for one call */
+static void call_play(zeit_call_t *call)
+{
+	int i;
+	int16_t chunk[160];
+	sample_t spl[160];
+	struct zeit_slot *slot;
+
+	/* stream from rendered announcement */
+	slot = get_slot(call->h, call->m, call->s);
+	if (slot) {
+		/* sample time does not advance during pause */
+		if (call->spl_time >= slot->end) {
+			call_up_audio_buffer(call->callref, slot->buffer, slot->end, 160);
+		} else {
+			call_up_audio_buffer(call->callref, slot->buffer, call->spl_time, 160);
+			call->spl_time += 160;
+			if (call->spl_time > slot->end)
+				call->spl_time = slot->end;
+		}
+		call_new_state(call, spl_state(call->spl_time));
+		return;
+	}
+
+	/* if rendering failed, assemble for this call only */
+	call->spl_time = assemble(chunk, 160, call->spl_time, call->h, call->m, call->s);
+	call_new_state(call, spl_state(call->spl_time));
 
 	/* convert to samples, apply gain and send toward fixed network */
 	int16_to_samples_speech(spl, chunk, 160);
@@ -309,6 +414,7 @@ next_sample:
 void call_down_clock(void)
 {
 	zeit_call_t *call;
+	int h = -1, m = 0, s = 0;
 
 	for (call = zeit_call_list; call; call = call->next) {
 		/* no callref */
@@ -316,6 +422,25 @@ void call_down_clock(void)
 			continue;
 		/* beep or announcement */
 		call_play(call);
+		if (call->state == ZEIT_CALL_PAUSE) {
+			h = call->h;
+			m = call->m;
+			s = call->s;
+		}
+	}
+
+	/* during the pause, render the announcement of the next 10 seconds ahead */
+	if (h >= 0) {
+		s += 10;
+		if (s >= 60) {
+			s -= 60;
+			if (++m == 60) {
+				m = 0;
+				if (++h == 24)
+					h = 0;
+			}
+		}
+		get_slot(h, m, s);
 	}
 }
 
@@ -404,6 +529,3 @@ void call_down_audio(void __attribute__((unused)) *decoder, void __attribute__((
 
 void dump_info(void) {}
 
-void sender_receive(sender_t __attribute__((unused)) *sender, sample_t __attribute__((unused)) *samples, int __attribute__((unused)) length, double __attribute__((unused)) rf_level_db) {}
-void sender_send(sender_t __attribute__((unused)) *sender, sample_t __attribute__((unused)) *samples, uint8_t __attribute__((unused)) *power, int __attribute__((unused)) length) {}
-